@@ -38,8 +38,14 @@ set(VKB_WARNINGS_AS_ERRORS ON CACHE BOOL "Enable Warnings as Errors")
 set(VKB_ENTRYPOINTS OFF CACHE BOOL "Enable create entrypoint project for every application.")
 set(VKB_SYMLINKS OFF CACHE BOOL "Enable create symlink folders for every application.")
 set(VKB_VALIDATION_LAYERS OFF CACHE BOOL "Enable validation layers for every application.")
+set(VKB_ATRACE OFF CACHE BOOL "Emit the scopes of the CPU profiler as ATrace sections on Android.")
+set(VKB_ALLOCATION_TRACKING OFF CACHE BOOL "Count the heap allocations of each frame by replacing the global operator new and delete.")
+set(VKB_PERF_BUILD OFF CACHE BOOL "Compile out debug logs, debug labels and assertions, to measure the CPU time of the frames.")
+set(VKB_LOG_LEVEL "DEBUG" CACHE STRING "Lowest level of the log messages compiled in: DEBUG, INFO, WARN or ERROR.")
 set(VKB_BUILD_SAMPLES ON CACHE BOOL "Enable generation and building of Vulkan best practice samples.")
 set(VKB_BUILD_TESTS OFF CACHE BOOL "Enable generation and building of Vulkan best practice tests.")
+set(VKB_BUILD_BENCHMARKS OFF CACHE BOOL "Enable generation and building of the microbenchmarks of the framework.")
+set(VKB_BUILD_TOOLS OFF CACHE BOOL "Enable generation and building of the offline asset tools.")
 
 set(CMAKE_RUNTIME_OUTPUT_DIRECTORY "bin/${CMAKE_BUILD_TYPE}/${TARGET_ARCH}")
 set(CMAKE_LIBRARY_OUTPUT_DIRECTORY "lib/${CMAKE_BUILD_TYPE}/${TARGET_ARCH}")
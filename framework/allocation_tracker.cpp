@@ -0,0 +1,178 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "allocation_tracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace vkb
+{
+namespace
+{
+constexpr size_t scope_count = static_cast<size_t>(AllocationScope::Count);
+
+// Constant initialized, so that allocations made before main are counted safely
+std::atomic<uint64_t> allocation_counts[scope_count];
+
+std::atomic<uint64_t> allocation_bytes[scope_count];
+
+thread_local AllocationScope current_scope{AllocationScope::Other};
+}        // namespace
+
+bool AllocationTracker::is_enabled()
+{
+#if defined(VKB_ALLOCATION_TRACKING)
+	return true;
+#else
+	return false;
+#endif
+}
+
+void AllocationTracker::record(size_t size)
+{
+	auto scope = static_cast<size_t>(current_scope);
+
+	allocation_counts[scope].fetch_add(1, std::memory_order_relaxed);
+	allocation_bytes[scope].fetch_add(size, std::memory_order_relaxed);
+}
+
+ScopedAllocationCounters AllocationTracker::get_counters()
+{
+	ScopedAllocationCounters counters;
+
+	for (size_t i = 0; i < scope_count; i++)
+	{
+		counters[i].count = allocation_counts[i].load(std::memory_order_relaxed);
+		counters[i].bytes = allocation_bytes[i].load(std::memory_order_relaxed);
+	}
+
+	return counters;
+}
+
+AllocationCounters AllocationTracker::get_total(const ScopedAllocationCounters &counters)
+{
+	AllocationCounters total;
+
+	for (auto &scope_counters : counters)
+	{
+		total += scope_counters;
+	}
+
+	return total;
+}
+
+const char *AllocationTracker::get_scope_name(AllocationScope scope)
+{
+	switch (scope)
+	{
+		case AllocationScope::SceneGraph:
+			return "scene_graph";
+		case AllocationScope::Rendering:
+			return "rendering";
+		case AllocationScope::Gui:
+			return "gui";
+		default:
+			return "other";
+	}
+}
+
+AllocationScope AllocationTracker::set_scope(AllocationScope scope)
+{
+	auto previous_scope = current_scope;
+
+	current_scope = scope;
+
+	return previous_scope;
+}
+
+AllocationZone::AllocationZone(AllocationScope scope) :
+    previous_scope{AllocationTracker::set_scope(scope)}
+{
+}
+
+AllocationZone::~AllocationZone()
+{
+	AllocationTracker::set_scope(previous_scope);
+}
+}        // namespace vkb
+
+#if defined(VKB_ALLOCATION_TRACKING)
+// Replacements of the global operators, the other forms of new and delete forward to these
+void *operator new(std::size_t size)
+{
+	vkb::AllocationTracker::record(size);
+
+	if (void *ptr = std::malloc(size == 0 ? 1 : size))
+	{
+		return ptr;
+	}
+
+	throw std::bad_alloc{};
+}
+
+void *operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+	vkb::AllocationTracker::record(size);
+
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+#endif
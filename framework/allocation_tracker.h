@@ -0,0 +1,131 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace vkb
+{
+/**
+ * @brief Subsystems the heap allocations of a thread are attributed to, while one of their scopes is open
+ */
+enum class AllocationScope
+{
+	Other,
+	SceneGraph,
+	Rendering,
+	Gui,
+	Count
+};
+
+/**
+ * @brief Number and total size of heap allocations
+ */
+struct AllocationCounters
+{
+	uint64_t count{0};
+
+	uint64_t bytes{0};
+
+	AllocationCounters operator-(const AllocationCounters &other) const
+	{
+		return {count - other.count, bytes - other.bytes};
+	}
+
+	AllocationCounters &operator+=(const AllocationCounters &other)
+	{
+		count += other.count;
+		bytes += other.bytes;
+
+		return *this;
+	}
+};
+
+/// Counters of each allocation scope
+using ScopedAllocationCounters = std::array<AllocationCounters, static_cast<size_t>(AllocationScope::Count)>;
+
+/**
+ * @brief Counts the heap allocations made by any thread through the global operator new.
+ *        Builds with VKB_ALLOCATION_TRACKING replace the global operators to count allocations, other builds count nothing.
+ *        Frees are not counted, the counters only ever grow and are compared before and after the code measured.
+ */
+class AllocationTracker
+{
+  public:
+	/**
+	 * @return Whether the build counts allocations
+	 */
+	static bool is_enabled();
+
+	/**
+	 * @brief Adds an allocation to the scope open on the calling thread, called by the global operator new
+	 */
+	static void record(size_t size);
+
+	/**
+	 * @return The allocations of each scope since the application started
+	 */
+	static ScopedAllocationCounters get_counters();
+
+	/**
+	 * @return The sum of the counters of all scopes
+	 */
+	static AllocationCounters get_total(const ScopedAllocationCounters &counters);
+
+	static const char *get_scope_name(AllocationScope scope);
+
+	/**
+	 * @brief Opens a scope on the calling thread
+	 * @return The scope previously open, to restore when this one closes
+	 */
+	static AllocationScope set_scope(AllocationScope scope);
+};
+
+/**
+ * @brief Attributes the allocations of the calling thread to a subsystem from its construction to its destruction
+ */
+class AllocationZone
+{
+  public:
+	explicit AllocationZone(AllocationScope scope);
+
+	~AllocationZone();
+
+	AllocationZone(const AllocationZone &) = delete;
+
+	AllocationZone &operator=(const AllocationZone &) = delete;
+
+  private:
+	AllocationScope previous_scope;
+};
+}        // namespace vkb
+
+#define VKB_ALLOCATION_CONCAT_IMPL(a, b) a##b
+#define VKB_ALLOCATION_CONCAT(a, b) VKB_ALLOCATION_CONCAT_IMPL(a, b)
+
+#if defined(VKB_ALLOCATION_TRACKING)
+/// Attributes the allocations of the enclosing scope to a subsystem
+#	define VKB_ALLOCATION_SCOPE(scope) vkb::AllocationZone VKB_ALLOCATION_CONCAT(allocation_zone_, __LINE__)(vkb::AllocationScope::scope)
+#else
+#	define VKB_ALLOCATION_SCOPE(scope)
+#endif
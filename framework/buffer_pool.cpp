@@ -28,31 +28,40 @@
 
 namespace vkb
 {
-BufferBlock::BufferBlock(Device &device, VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memory_usage) :
-    buffer{device, size, usage, memory_usage}
+namespace
+{
+VkDeviceSize get_buffer_alignment(Device &device, VkBufferUsageFlags usage)
 {
 	if (usage == VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
 	{
-		alignment = device.get_properties().limits.minUniformBufferOffsetAlignment;
+		return device.get_properties().limits.minUniformBufferOffsetAlignment;
 	}
 	else if (usage == VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
 	{
-		alignment = device.get_properties().limits.minStorageBufferOffsetAlignment;
+		return device.get_properties().limits.minStorageBufferOffsetAlignment;
 	}
 	else if (usage == VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT)
 	{
-		alignment = device.get_properties().limits.minTexelBufferOffsetAlignment;
+		return device.get_properties().limits.minTexelBufferOffsetAlignment;
 	}
 	else if (usage == VK_BUFFER_USAGE_INDEX_BUFFER_BIT || usage == VK_BUFFER_USAGE_VERTEX_BUFFER_BIT || usage == VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)
 	{
 		// Used to calculate the offset, required when allocating memory (its value should be power of 2)
-		alignment = 16;
+		return 16;
 	}
 	else
 	{
 		throw std::runtime_error("Usage not recognised");
 	}
+}
+}        // namespace
 
+BufferBlock::BufferBlock(Device &device, VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memory_usage) :
+    buffer{device, size, usage, memory_usage, AllocationCategory::PoolBlock},
+    usage{usage},
+    memory_usage{memory_usage},
+    alignment{get_buffer_alignment(device, usage)}
+{
 	buffer.map();
 }
 
@@ -78,11 +87,123 @@ VkDeviceSize BufferBlock::get_size() const
 	return buffer.get_size();
 }
 
+VkBufferUsageFlags BufferBlock::get_usage() const
+{
+	return usage;
+}
+
+VmaMemoryUsage BufferBlock::get_memory_usage() const
+{
+	return memory_usage;
+}
+
 void BufferBlock::reset()
 {
 	offset = 0;
 }
 
+BufferBlockFreeList::BufferBlockFreeList(VkDeviceSize max_size) :
+    max_size{max_size}
+{
+}
+
+std::unique_ptr<BufferBlock> BufferBlockFreeList::acquire(VkBufferUsageFlags usage, VmaMemoryUsage memory_usage, VkDeviceSize minimum_size)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	auto best_it = buffer_blocks.end();
+
+	for (auto it = buffer_blocks.begin(); it != buffer_blocks.end(); ++it)
+	{
+		auto &block = *it;
+
+		if (block->get_usage() == usage && block->get_memory_usage() == memory_usage && block->get_size() >= minimum_size &&
+		    (best_it == buffer_blocks.end() || block->get_size() < (*best_it)->get_size()))
+		{
+			best_it = it;
+		}
+	}
+
+	if (best_it == buffer_blocks.end())
+	{
+		return nullptr;
+	}
+
+	auto block = std::move(*best_it);
+	buffer_blocks.erase(best_it);
+
+	size -= block->get_size();
+
+	return block;
+}
+
+void BufferBlockFreeList::release(std::unique_ptr<BufferBlock> &&block)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	if (size + block->get_size() > max_size)
+	{
+		// Destroy the block
+		return;
+	}
+
+	size += block->get_size();
+
+	block->reset();
+	buffer_blocks.push_back(std::move(block));
+}
+
+VkDeviceSize BufferBlockFreeList::get_size()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	return size;
+}
+
+void BufferBlockFreeList::clear()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	buffer_blocks.clear();
+
+	size = 0;
+}
+
+LinearBufferAllocator::LinearBufferAllocator(Device &device, VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memory_usage) :
+    buffer{device, size, usage, memory_usage, AllocationCategory::PoolBlock},
+    alignment{get_buffer_alignment(device, usage)}
+{
+	buffer.map();
+}
+
+BufferAllocation LinearBufferAllocator::allocate(const VkDeviceSize allocate_size)
+{
+	assert(allocate_size > 0 && "Allocation size must be greater than zero");
+
+	// Rounding the size keeps every offset aligned, so a single fetch_add is enough
+	auto aligned_size = (allocate_size + alignment - 1) & ~(alignment - 1);
+
+	auto aligned_offset = offset.fetch_add(aligned_size, std::memory_order_relaxed);
+
+	if (aligned_offset + allocate_size > buffer.get_size())
+	{
+		// No more space available from the buffer, return empty allocation
+		return BufferAllocation{};
+	}
+
+	return BufferAllocation{buffer, allocate_size, aligned_offset};
+}
+
+VkDeviceSize LinearBufferAllocator::get_size() const
+{
+	return buffer.get_size();
+}
+
+void LinearBufferAllocator::reset()
+{
+	offset = 0;
+}
+
 BufferPool::BufferPool(Device &device, VkDeviceSize block_size, VkBufferUsageFlags usage, VmaMemoryUsage memory_usage) :
     device{device},
     block_size{block_size},
@@ -93,38 +214,115 @@ BufferPool::BufferPool(Device &device, VkDeviceSize block_size, VkBufferUsageFla
 
 BufferBlock &BufferPool::request_buffer_block(const VkDeviceSize minimum_size)
 {
-	// Find the first block in the range of the inactive blocks
+	// Find the smallest block in the range of the inactive blocks
 	// which size is greater than the minimum size
-	auto it = std::upper_bound(buffer_blocks.begin() + active_buffer_block_count, buffer_blocks.end(), minimum_size,
-	                           [](const VkDeviceSize &a, const std::unique_ptr<BufferBlock> &b) -> bool { return a < b->get_size(); });
+	auto it = buffer_blocks.end();
 
-	if (it != buffer_blocks.end())
+	for (auto block_it = buffer_blocks.begin() + active_buffer_block_count; block_it != buffer_blocks.end(); ++block_it)
 	{
-		// Recycle inactive block
-		active_buffer_block_count++;
-		return *it->get();
+		if ((*block_it)->get_size() >= minimum_size && (it == buffer_blocks.end() || (*block_it)->get_size() < (*it)->get_size()))
+		{
+			it = block_it;
+		}
 	}
 
-	LOGD("Building #{} buffer block ({})", buffer_blocks.size(), usage);
+	if (it == buffer_blocks.end())
+	{
+		VkDeviceSize active_size = 0;
+
+		for (uint32_t i = 0; i < active_buffer_block_count; ++i)
+		{
+			active_size += buffer_blocks[i]->get_size();
+		}
 
-	// Create a new block, store and return it
-	buffer_blocks.emplace_back(std::make_unique<BufferBlock>(device, std::max(block_size, minimum_size), usage, memory_usage));
+		// Size the block to cover what recent frames needed beyond the active blocks, in multiples of the block size
+		auto new_block_size = std::max(block_size, minimum_size);
 
-	auto &block = buffer_blocks[active_buffer_block_count++];
+		if (peak_size > active_size + new_block_size)
+		{
+			new_block_size = ((peak_size - active_size + block_size - 1) / block_size) * block_size;
+		}
 
-	return *block.get();
+		auto block = device.get_buffer_block_free_list().acquire(usage, memory_usage, new_block_size);
+
+		if (!block)
+		{
+			LOGD("Building #{} buffer block ({})", buffer_blocks.size(), usage);
+
+			block = std::make_unique<BufferBlock>(device, new_block_size, usage, memory_usage);
+		}
+
+		buffer_blocks.push_back(std::move(block));
+		idle_frame_counts.push_back(0);
+
+		it = buffer_blocks.end() - 1;
+	}
+
+	// Keep the active blocks at the start of the list
+	auto index = active_buffer_block_count++;
+	std::iter_swap(buffer_blocks.begin() + index, it);
+	std::swap(idle_frame_counts[index], idle_frame_counts[std::distance(buffer_blocks.begin(), it)]);
+
+	return *buffer_blocks[index];
 }
 
 void BufferPool::reset()
 {
-	for (auto &buffer_block : buffer_blocks)
+	VkDeviceSize active_size = 0;
+
+	for (uint32_t i = 0; i < active_buffer_block_count; ++i)
+	{
+		active_size += buffer_blocks[i]->get_size();
+	}
+
+	// The peak decays once it has not been reached for a while
+	if (active_size >= peak_size || ++frames_since_peak > max_idle_frames)
+	{
+		peak_size         = active_size;
+		frames_since_peak = 0;
+	}
+
+	for (size_t i = 0; i < buffer_blocks.size(); ++i)
+	{
+		buffer_blocks[i]->reset();
+
+		idle_frame_counts[i] = i < active_buffer_block_count ? 0 : idle_frame_counts[i] + 1;
+	}
+
+	// Release the blocks which have not been used for too long, the GPU is done with them
+	for (size_t i = buffer_blocks.size(); i-- > active_buffer_block_count;)
 	{
-		buffer_block->reset();
+		if (idle_frame_counts[i] > max_idle_frames)
+		{
+			LOGD("Releasing idle buffer block ({})", usage);
+
+			device.get_buffer_block_free_list().release(std::move(buffer_blocks[i]));
+
+			buffer_blocks.erase(buffer_blocks.begin() + i);
+			idle_frame_counts.erase(idle_frame_counts.begin() + i);
+		}
 	}
 
 	active_buffer_block_count = 0;
 }
 
+void BufferPool::set_max_idle_frames(uint32_t new_max_idle_frames)
+{
+	max_idle_frames = new_max_idle_frames;
+}
+
+VkDeviceSize BufferPool::get_size() const
+{
+	VkDeviceSize total_size = 0;
+
+	for (auto &buffer_block : buffer_blocks)
+	{
+		total_size += buffer_block->get_size();
+	}
+
+	return total_size;
+}
+
 BufferAllocation::BufferAllocation(core::Buffer &buffer, VkDeviceSize size, VkDeviceSize offset) :
     buffer{&buffer},
     size{size},
@@ -132,13 +330,13 @@ BufferAllocation::BufferAllocation(core::Buffer &buffer, VkDeviceSize size, VkDe
 {
 }
 
-void BufferAllocation::update(const std::vector<uint8_t> &data, uint32_t offset)
+void BufferAllocation::update(const uint8_t *data, size_t data_size, uint32_t offset)
 {
 	assert(buffer && "Invalid buffer pointer");
 
-	if (offset + data.size() <= size)
+	if (offset + data_size <= size)
 	{
-		buffer->update(data, static_cast<size_t>(base_offset) + offset);
+		buffer->update(data, data_size, static_cast<size_t>(base_offset) + offset);
 	}
 	else
 	{
@@ -146,6 +344,35 @@ void BufferAllocation::update(const std::vector<uint8_t> &data, uint32_t offset)
 	}
 }
 
+void BufferAllocation::update(const std::vector<uint8_t> &data, uint32_t offset)
+{
+	update(data.data(), data.size(), offset);
+}
+
+uint8_t *BufferAllocation::map_data(size_t data_size, uint32_t offset)
+{
+	assert(buffer && "Invalid buffer pointer");
+
+	if (offset + data_size > size)
+	{
+		LOGE("Ignore buffer allocation map");
+		return nullptr;
+	}
+
+	return buffer->map() + base_offset + offset;
+}
+
+void BufferAllocation::flush()
+{
+	assert(buffer && "Invalid buffer pointer");
+
+	buffer->flush();
+
+#if defined(__APPLE__)
+	buffer->unmap();        // Same MoltenVK workaround as core::Buffer::update
+#endif
+}
+
 bool BufferAllocation::empty() const
 {
 	return size == 0 || buffer == nullptr;
@@ -167,4 +394,10 @@ core::Buffer &BufferAllocation::get_buffer()
 	return *buffer;
 }
 
+const core::Buffer &BufferAllocation::get_buffer() const
+{
+	assert(buffer && "Invalid buffer pointer");
+	return *buffer;
+}
+
 }        // namespace vkb
@@ -20,6 +20,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <mutex>
+
 #include "common/helpers.h"
 #include "core/buffer.h"
 
@@ -46,16 +49,40 @@ class BufferAllocation
 
 	BufferAllocation &operator=(BufferAllocation &&) = default;
 
+	/**
+	 * @brief Copies data into the allocation
+	 * @param data Pointer to the data to copy
+	 * @param size Size of the data in bytes
+	 * @param offset Offset from the start of the allocation
+	 */
+	void update(const uint8_t *data, size_t size, uint32_t offset = 0);
+
 	void update(const std::vector<uint8_t> &data, uint32_t offset = 0);
 
 	template <class T>
 	void update(const T &value, uint32_t offset = 0)
 	{
-		update(std::vector<uint8_t>{reinterpret_cast<const uint8_t *>(&value),
-		                            reinterpret_cast<const uint8_t *>(&value) + sizeof(T)},
-		       offset);
+		update(reinterpret_cast<const uint8_t *>(&value), sizeof(T), offset);
 	}
 
+	/**
+	 * @brief Maps the allocation so that it can be written in place. The buffer stays
+	 *        mapped, call flush() once the writes are done. The memory may be write-combined,
+	 *        so it should only be written to, not read back.
+	 * @param offset Offset from the start of the allocation
+	 * @return Typed pointer to host visible memory, nullptr if T does not fit in the allocation
+	 */
+	template <class T>
+	T *map(uint32_t offset = 0)
+	{
+		return reinterpret_cast<T *>(map_data(sizeof(T), offset));
+	}
+
+	/**
+	 * @brief Makes the writes done through map() visible to the device
+	 */
+	void flush();
+
 	bool empty() const;
 
 	VkDeviceSize get_size() const;
@@ -64,9 +91,13 @@ class BufferAllocation
 
 	core::Buffer &get_buffer();
 
+	const core::Buffer &get_buffer() const;
+
   private:
 	core::Buffer *buffer{nullptr};
 
+	uint8_t *map_data(size_t size, uint32_t offset);
+
 	VkDeviceSize base_offset{0};
 
 	VkDeviceSize size{0};
@@ -87,11 +118,19 @@ class BufferBlock
 
 	VkDeviceSize get_size() const;
 
+	VkBufferUsageFlags get_usage() const;
+
+	VmaMemoryUsage get_memory_usage() const;
+
 	void reset();
 
   private:
 	core::Buffer buffer;
 
+	VkBufferUsageFlags usage{};
+
+	VmaMemoryUsage memory_usage{};
+
 	// Memory alignment, it may change according to the usage
 	VkDeviceSize alignment{0};
 
@@ -99,6 +138,93 @@ class BufferBlock
 	VkDeviceSize offset{0};
 };
 
+/**
+ * @brief Device-wide list of idle buffer blocks. Blocks a BufferPool has not used for a while
+ *        are released to it, so that the pools of other frames can take them over instead
+ *        of creating new ones. It is thread safe.
+ */
+class BufferBlockFreeList
+{
+  public:
+	/**
+	 * @param max_size Total size of the idle blocks kept, released blocks over it are destroyed
+	 */
+	BufferBlockFreeList(VkDeviceSize max_size = 16 * 1024 * 1024);
+
+	BufferBlockFreeList(const BufferBlockFreeList &) = delete;
+
+	BufferBlockFreeList(BufferBlockFreeList &&) = delete;
+
+	BufferBlockFreeList &operator=(const BufferBlockFreeList &) = delete;
+
+	BufferBlockFreeList &operator=(BufferBlockFreeList &&) = delete;
+
+	/**
+	 * @brief Takes the smallest idle block which fits
+	 * @return The block, or nullptr if none is suitable
+	 */
+	std::unique_ptr<BufferBlock> acquire(VkBufferUsageFlags usage, VmaMemoryUsage memory_usage, VkDeviceSize minimum_size);
+
+	/**
+	 * @brief Gives a block back, it must not be in use by the GPU anymore
+	 */
+	void release(std::unique_ptr<BufferBlock> &&block);
+
+	/**
+	 * @return The total size of the idle blocks
+	 */
+	VkDeviceSize get_size();
+
+	void clear();
+
+  private:
+	std::mutex mutex;
+
+	std::vector<std::unique_ptr<BufferBlock>> buffer_blocks;
+
+	VkDeviceSize max_size{0};
+
+	VkDeviceSize size{0};
+};
+
+/**
+ * @brief Linear allocator over a single persistently mapped buffer.
+ *        An allocation is one atomic bump of the offset, so several threads can allocate
+ *        from it at once without locking. The whole buffer is recycled when it is reset,
+ *        so with one allocator per frame in flight the frames use it as a ring.
+ */
+class LinearBufferAllocator
+{
+  public:
+	LinearBufferAllocator(Device &device, VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memory_usage = VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	LinearBufferAllocator(const LinearBufferAllocator &) = delete;
+
+	LinearBufferAllocator(LinearBufferAllocator &&) = delete;
+
+	LinearBufferAllocator &operator=(const LinearBufferAllocator &) = delete;
+
+	LinearBufferAllocator &operator=(LinearBufferAllocator &&) = delete;
+
+	/**
+	 * @return An usable view on a portion of the buffer, empty if the buffer is full
+	 */
+	BufferAllocation allocate(VkDeviceSize size);
+
+	VkDeviceSize get_size() const;
+
+	void reset();
+
+  private:
+	core::Buffer buffer;
+
+	// Memory alignment, every allocation is rounded up to it
+	VkDeviceSize alignment{0};
+
+	// Current offset, it increases on every allocation
+	std::atomic<VkDeviceSize> offset{0};
+};
+
 /**
  * @brief A pool of buffer blocks for a specific usage.
  * It may contain inactive blocks that can be recycled.
@@ -112,6 +238,11 @@ class BufferBlock
  * overwritten. The minimum allocation size is 256 kb, if you ask for more you get a dedicated
  * buffer allocation.
  *
+ * Blocks which stay unused for a number of frames are released to the device's
+ * BufferBlockFreeList, so a spike in one frame does not keep its memory forever.
+ * New blocks are sized after the peak usage of the recent frames, so that a pool which
+ * regularly needs more than one block converges to a single larger one.
+ *
  * We re-use descriptor sets: we only need one for the corresponding buffer infos (and we only
  * have one VkBuffer per BufferBlock), then it is bound and we use dynamic offsets.
  */
@@ -124,6 +255,16 @@ class BufferPool
 
 	void reset();
 
+	/**
+	 * @param max_idle_frames Number of resets after which unused blocks are released
+	 */
+	void set_max_idle_frames(uint32_t max_idle_frames);
+
+	/**
+	 * @return The total size of the blocks owned by the pool
+	 */
+	VkDeviceSize get_size() const;
+
   private:
 	Device &device;
 
@@ -139,5 +280,15 @@ class BufferPool
 
 	/// Numbers of active blocks from the start of buffer_blocks
 	uint32_t active_buffer_block_count{0};
+
+	/// Number of resets each block has gone through without being used
+	std::vector<uint32_t> idle_frame_counts;
+
+	uint32_t max_idle_frames{60};
+
+	/// Largest total size of the active blocks over the recent frames
+	VkDeviceSize peak_size{0};
+
+	uint32_t frames_since_peak{0};
 };
 }        // namespace vkb
@@ -0,0 +1,554 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "common/resource_map.h"
+
+namespace vkb
+{
+/// Distance kept between counters written by different threads, so that they do not share a cache line
+const std::size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * @brief Index of the calling thread, threads are numbered in the order they first ask for it.
+ *        Used to pick the shard of per-thread state a thread writes to.
+ */
+inline std::size_t get_thread_shard()
+{
+	static std::atomic<std::size_t> thread_count{0};
+
+	thread_local std::size_t thread_shard = thread_count.fetch_add(1, std::memory_order_relaxed);
+
+	return thread_shard;
+}
+
+/**
+ * @brief Open addressing hash map of cached resources, whose lookups run concurrently with each other
+ *        and with a writer without taking any lock. Writers (insertions, removals and iterations) must
+ *        be serialized by the owner of the map.
+ *
+ *        Slots are only ever filled or marked as removed in place, so a lookup finds any resource which
+ *        stays in the map while it runs. Tables outgrown and entries removed are destroyed once the
+ *        lookups which may still read them are over: each lookup counts itself in the shard of its
+ *        thread for the current epoch, and writers advance the epoch then wait for the counts of the
+ *        previous one to drop to zero. Lookups only compare keys, so writers never wait long.
+ *
+ *        Resources are allocated once and do not move while cached, so references to them stay
+ *        valid until they are erased.
+ * @tparam M Bookkeeping kept with each resource, such as when it was last used
+ */
+template <class T, class M>
+class ConcurrentResourceMap
+{
+  public:
+	using mapped_type = T;
+
+	struct Entry
+	{
+		Entry(std::size_t hash, std::vector<uint8_t> &&key, T &&value) :
+		    first{hash},
+		    key{std::move(key)},
+		    second{std::move(value)}
+		{}
+
+		/// Hash of the resource, named after std::pair so the map iterates like std::unordered_map
+		const std::size_t first;
+
+		/// Serialized parameters the resource was created with
+		const std::vector<uint8_t> key;
+
+		T second;
+
+		M metadata;
+
+		/// Index in the list of entries, only used by writers
+		std::size_t position{0};
+	};
+
+	using iterator = ResourceMapIterator<Entry, typename std::vector<std::unique_ptr<Entry>>::iterator>;
+
+	using const_iterator = ResourceMapIterator<const Entry, typename std::vector<std::unique_ptr<Entry>>::const_iterator>;
+
+	ConcurrentResourceMap() = default;
+
+	ConcurrentResourceMap(const ConcurrentResourceMap &) = delete;
+
+	ConcurrentResourceMap(ConcurrentResourceMap &&) = delete;
+
+	ConcurrentResourceMap &operator=(const ConcurrentResourceMap &) = delete;
+
+	ConcurrentResourceMap &operator=(ConcurrentResourceMap &&) = delete;
+
+	iterator begin()
+	{
+		return entries.begin();
+	}
+
+	iterator end()
+	{
+		return entries.end();
+	}
+
+	const_iterator begin() const
+	{
+		return entries.begin();
+	}
+
+	const_iterator end() const
+	{
+		return entries.end();
+	}
+
+	std::size_t size() const
+	{
+		return entries.size();
+	}
+
+	bool empty() const
+	{
+		return entries.empty();
+	}
+
+	/**
+	 * @brief Looks up a resource, can be called concurrently with any other member function
+	 * @param hash The hash of the resource
+	 * @param key The serialized parameters of the resource
+	 * @param on_found Called on the entry of the resource before the lookup ends, so that it cannot be
+	 *        destroyed meanwhile
+	 * @returns A pointer to the resource, nullptr if it is not in the map
+	 */
+	template <class F>
+	T *find(std::size_t hash, const std::vector<uint8_t> &key, F on_found)
+	{
+		auto &reader_count = begin_read();
+
+		auto entry = probe(table.load(std::memory_order_acquire), hash, key);
+
+		if (entry)
+		{
+			on_found(*entry);
+		}
+
+		reader_count.fetch_sub(1, std::memory_order_release);
+
+		return entry ? &entry->second : nullptr;
+	}
+
+	T *find(std::size_t hash, const std::vector<uint8_t> &key)
+	{
+		return find(hash, key, [](Entry &) {});
+	}
+
+	const T *find(std::size_t hash, const std::vector<uint8_t> &key) const
+	{
+		return const_cast<ConcurrentResourceMap *>(this)->find(hash, key);
+	}
+
+	/**
+	 * @brief Inserts a resource, unless one with the same key is already in the map
+	 * @param on_emplaced Called on the entry of the resource in the map
+	 * @returns The resource in the map and whether it was inserted
+	 */
+	template <class F>
+	std::pair<T *, bool> emplace(std::size_t hash, std::vector<uint8_t> key, T &&value, F on_emplaced)
+	{
+		if (auto entry = probe(current_table.get(), hash, key))
+		{
+			on_emplaced(*entry);
+
+			return {&entry->second, false};
+		}
+
+		auto entry = link(std::make_unique<Entry>(hash, std::move(key), std::move(value)));
+
+		on_emplaced(*entry);
+
+		reclaim();
+
+		return {&entry->second, true};
+	}
+
+	std::pair<T *, bool> emplace(std::size_t hash, std::vector<uint8_t> key, T &&value)
+	{
+		return emplace(hash, std::move(key), std::move(value), [](Entry &) {});
+	}
+
+	/**
+	 * @brief Removes a resource
+	 * @returns Whether the resource was in the map
+	 */
+	bool erase(std::size_t hash, const std::vector<uint8_t> &key)
+	{
+		auto entry = probe(current_table.get(), hash, key);
+
+		if (!entry)
+		{
+			return false;
+		}
+
+		retired_entries.push_back(unlink(*entry));
+
+		reclaim();
+
+		return true;
+	}
+
+	/**
+	 * @brief Removes resources found by an iteration. Lookups may find them until they are unlinked,
+	 *        so each one is checked again once no lookup can reach it anymore.
+	 * @param candidates The entries to remove
+	 * @param keep Called on each entry once no lookup can reach it, returns whether to put it back in the map
+	 * @param on_erase Called on each resource not kept before it is destroyed
+	 * @returns The number of resources removed
+	 */
+	template <class K, class F>
+	std::size_t erase_if(const std::vector<Entry *> &candidates, K keep, F on_erase)
+	{
+		std::vector<std::unique_ptr<Entry>> unlinked;
+
+		for (auto entry : candidates)
+		{
+			unlinked.push_back(unlink(*entry));
+		}
+
+		// The lookups which found the entries are over, and what they wrote to them is visible
+		wait_for_readers();
+
+		std::size_t count{0};
+
+		for (auto &entry : unlinked)
+		{
+			if (keep(*entry))
+			{
+				link(std::move(entry));
+			}
+			else
+			{
+				on_erase(entry->second);
+				++count;
+			}
+		}
+
+		// No lookup can reach the entries left, so they are destroyed right away
+		unlinked.clear();
+
+		reclaim();
+
+		return count;
+	}
+
+	/**
+	 * @brief Removes resources found by an iteration
+	 * @param on_erase Called on each resource before it is destroyed
+	 * @returns The number of resources removed
+	 */
+	template <class F>
+	std::size_t erase(const std::vector<Entry *> &erased, F on_erase)
+	{
+		return erase_if(
+		    erased, [](Entry &) { return false; }, on_erase);
+	}
+
+	/**
+	 * @brief Removes all the resources, once no lookup may still read them
+	 * @returns The entries removed, for the caller to destroy when it is safe
+	 */
+	std::vector<std::unique_ptr<Entry>> take_entries()
+	{
+		table.store(nullptr, std::memory_order_release);
+
+		if (current_table)
+		{
+			retired_tables.push_back(std::move(current_table));
+		}
+
+		removed_count = 0;
+
+		reclaim();
+
+		std::vector<std::unique_ptr<Entry>> taken;
+		std::swap(taken, entries);
+
+		return taken;
+	}
+
+	void clear()
+	{
+		take_entries();
+	}
+
+  private:
+	struct Slot
+	{
+		/// Written before the entry is published, and never changed afterwards
+		std::size_t hash{0};
+
+		/// Null for an empty slot, get_removed_marker() for a removed entry
+		std::atomic<Entry *> entry{nullptr};
+	};
+
+	struct Table
+	{
+		Table(std::size_t slot_count) :
+		    mask{slot_count - 1},
+		    slots{new Slot[slot_count]}
+		{}
+
+		const std::size_t mask;
+
+		std::unique_ptr<Slot[]> slots;
+	};
+
+	/// Count of the lookups in progress in the shard of a thread, padded to a cache line of its own
+	struct ReaderCount
+	{
+		std::atomic<uint32_t> count{0};
+
+		uint8_t padding[CACHE_LINE_SIZE - sizeof(std::atomic<uint32_t>)];
+	};
+
+	static const std::size_t READER_SHARD_COUNT = 16;
+
+	/// The table lookups probe, owned by current_table
+	std::atomic<Table *> table{nullptr};
+
+	std::unique_ptr<Table> current_table;
+
+	std::vector<std::unique_ptr<Entry>> entries;
+
+	/// Slots of the current table marked as removed
+	std::size_t removed_count{0};
+
+	std::atomic<uint32_t> epoch{0};
+
+	/// Lookups in progress, by parity of the epoch they started in and by thread shard
+	std::array<std::array<ReaderCount, READER_SHARD_COUNT>, 2> readers;
+
+	/// Tables and entries removed, destroyed once no lookup may read them
+	std::vector<std::unique_ptr<Table>> retired_tables;
+
+	std::vector<std::unique_ptr<Entry>> retired_entries;
+
+	static Entry *get_removed_marker()
+	{
+		static uint8_t marker;
+
+		return reinterpret_cast<Entry *>(&marker);
+	}
+
+	std::size_t slot_count() const
+	{
+		return current_table ? current_table->mask + 1 : 0;
+	}
+
+	static Entry *probe(const Table *probed_table, std::size_t hash, const std::vector<uint8_t> &key)
+	{
+		if (!probed_table)
+		{
+			return nullptr;
+		}
+
+		for (std::size_t i = hash & probed_table->mask;; i = (i + 1) & probed_table->mask)
+		{
+			auto &slot  = probed_table->slots[i];
+			auto  entry = slot.entry.load(std::memory_order_acquire);
+
+			if (!entry)
+			{
+				return nullptr;
+			}
+
+			if (entry != get_removed_marker() && slot.hash == hash &&
+			    entry->key.size() == key.size() && std::memcmp(entry->key.data(), key.data(), key.size()) == 0)
+			{
+				return entry;
+			}
+		}
+	}
+
+	static void insert_slot(Table &inserted_table, Entry *entry)
+	{
+		std::size_t i = entry->first & inserted_table.mask;
+
+		while (inserted_table.slots[i].entry.load(std::memory_order_relaxed))
+		{
+			i = (i + 1) & inserted_table.mask;
+		}
+
+		inserted_table.slots[i].hash = entry->first;
+		inserted_table.slots[i].entry.store(entry, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Moves the entries to a new table without removed slots, sized for a load factor
+	 *        of at most one quarter so that probe sequences stay short until the next rebuild
+	 */
+	void rebuild()
+	{
+		std::size_t new_slot_count = 16;
+
+		while ((entries.size() + 1) * 4 > new_slot_count)
+		{
+			new_slot_count *= 2;
+		}
+
+		auto new_table = std::make_unique<Table>(new_slot_count);
+
+		for (auto &entry : entries)
+		{
+			insert_slot(*new_table, entry.get());
+		}
+
+		table.store(new_table.get(), std::memory_order_release);
+
+		if (current_table)
+		{
+			retired_tables.push_back(std::move(current_table));
+		}
+
+		current_table = std::move(new_table);
+		removed_count = 0;
+	}
+
+	/**
+	 * @brief Adds an entry to the current table, which is rebuilt first if it is too full
+	 * @returns The entry, owned by the map
+	 */
+	Entry *link(std::unique_ptr<Entry> &&entry)
+	{
+		// Removed entries keep their slot until the table is rebuilt, so they count in the load factor
+		if ((entries.size() + removed_count + 1) * 2 > slot_count())
+		{
+			rebuild();
+		}
+
+		entry->position = entries.size();
+		entries.push_back(std::move(entry));
+
+		insert_slot(*current_table, entries.back().get());
+
+		return entries.back().get();
+	}
+
+	/**
+	 * @brief Marks the slot of an entry as removed, lookups starting from now on do not find it
+	 * @returns The entry, which lookups already running may still read
+	 */
+	std::unique_ptr<Entry> unlink(Entry &entry)
+	{
+		for (std::size_t i = entry.first & current_table->mask;; i = (i + 1) & current_table->mask)
+		{
+			auto &slot = current_table->slots[i];
+
+			if (slot.entry.load(std::memory_order_relaxed) == &entry)
+			{
+				slot.entry.store(get_removed_marker(), std::memory_order_release);
+				break;
+			}
+		}
+
+		++removed_count;
+
+		// Keep the entries dense by moving the last one into the hole
+		auto position = entry.position;
+
+		auto unlinked = std::move(entries[position]);
+
+		if (position != entries.size() - 1)
+		{
+			entries[position]           = std::move(entries.back());
+			entries[position]->position = position;
+		}
+
+		entries.pop_back();
+
+		return unlinked;
+	}
+
+	/**
+	 * @brief Counts a lookup in the shard of its thread for the current epoch
+	 * @returns The count to decrement once the lookup is over
+	 */
+	std::atomic<uint32_t> &begin_read()
+	{
+		auto shard_index = get_thread_shard() % READER_SHARD_COUNT;
+
+		while (true)
+		{
+			auto current_epoch = epoch.load(std::memory_order_seq_cst);
+
+			auto &reader_count = readers[current_epoch & 1][shard_index].count;
+
+			reader_count.fetch_add(1, std::memory_order_seq_cst);
+
+			// A writer which advanced the epoch meanwhile may not wait for this count, so count again
+			if (epoch.load(std::memory_order_seq_cst) == current_epoch)
+			{
+				return reader_count;
+			}
+
+			reader_count.fetch_sub(1, std::memory_order_release);
+		}
+	}
+
+	/**
+	 * @brief Waits for the lookups which started before the call to end
+	 */
+	void wait_for_readers()
+	{
+		// Lookups starting from now on count themselves in the other parity
+		auto previous_epoch = epoch.fetch_add(1, std::memory_order_seq_cst);
+
+		for (auto &reader : readers[previous_epoch & 1])
+		{
+			while (reader.count.load(std::memory_order_seq_cst) != 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	/**
+	 * @brief Destroys the retired tables and entries once the lookups which may read them are over
+	 */
+	void reclaim()
+	{
+		if (retired_tables.empty() && retired_entries.empty())
+		{
+			return;
+		}
+
+		wait_for_readers();
+
+		retired_entries.clear();
+		retired_tables.clear();
+	}
+};
+}        // namespace vkb
@@ -57,6 +57,15 @@
 		__pragma(warning(pop))
 #endif
 
+// Marks an intended fallthrough between switch cases, [[fallthrough]] is only standard from C++17
+#if defined(__clang__)
+#	define VKB_FALLTHROUGH [[clang::fallthrough]]
+#elif defined(__GNUC__) && __GNUC__ >= 7
+#	define VKB_FALLTHROUGH __attribute__((fallthrough))
+#else
+#	define VKB_FALLTHROUGH
+#endif
+
 namespace vkb
 {
 /**
@@ -23,6 +23,7 @@
 #include <algorithm>
 #include <array>
 #include <cstdio>
+#include <cstring>
 #include <cstdlib>
 #include <fstream>
 #include <functional>
@@ -46,13 +47,20 @@ VKBP_ENABLE_WARNINGS()
 
 namespace vkb
 {
+/// Whether debug logs, labels and checks are compiled out, see VKB_PERF_BUILD
+#if defined(VKB_PERF_BUILD)
+constexpr bool perf_build = true;
+#else
+constexpr bool perf_build = false;
+#endif
+
 template <typename T>
-inline void read(std::istringstream &is, T &value)
+inline void read(std::istream &is, T &value)
 {
 	is.read(reinterpret_cast<char *>(&value), sizeof(T));
 }
 
-inline void read(std::istringstream &is, std::string &value)
+inline void read(std::istream &is, std::string &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -61,7 +69,7 @@ inline void read(std::istringstream &is, std::string &value)
 }
 
 template <class T>
-inline void read(std::istringstream &is, std::set<T> &value)
+inline void read(std::istream &is, std::set<T> &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -74,7 +82,7 @@ inline void read(std::istringstream &is, std::set<T> &value)
 }
 
 template <class T>
-inline void read(std::istringstream &is, std::vector<T> &value)
+inline void read(std::istream &is, std::vector<T> &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -83,7 +91,7 @@ inline void read(std::istringstream &is, std::vector<T> &value)
 }
 
 template <class T, class S>
-inline void read(std::istringstream &is, std::map<T, S> &value)
+inline void read(std::istream &is, std::map<T, S> &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -99,13 +107,13 @@ inline void read(std::istringstream &is, std::map<T, S> &value)
 }
 
 template <class T, uint32_t N>
-inline void read(std::istringstream &is, std::array<T, N> &value)
+inline void read(std::istream &is, std::array<T, N> &value)
 {
 	is.read(reinterpret_cast<char *>(value.data()), N * sizeof(T));
 }
 
 template <typename T, typename... Args>
-inline void read(std::istringstream &is, T &first_arg, Args &... args)
+inline void read(std::istream &is, T &first_arg, Args &... args)
 {
 	read(is, first_arg);
 
@@ -178,6 +186,100 @@ inline void hash_combine(size_t &seed, const T &v)
 	glm::detail::hash_combine(seed, hasher(v));
 }
 
+/**
+ * @brief Fast non-cryptographic hash of a block of plain data, processed 8 bytes at a time (MurmurHash64A).
+ *        Only use on types without padding, as padding bytes are hashed too.
+ * @param data Pointer to the data
+ * @param size Size of the data in bytes
+ * @param seed Value to start hashing from, allows chaining calls
+ */
+inline size_t hash_bytes(const void *data, size_t size, uint64_t seed = 0)
+{
+	const uint64_t m = 0xc6a4a7935bd1e995ULL;
+	const int      r = 47;
+
+	uint64_t h = seed ^ (size * m);
+
+	auto bytes = reinterpret_cast<const uint8_t *>(data);
+	auto end   = bytes + (size & ~static_cast<size_t>(7));
+
+	for (; bytes != end; bytes += 8)
+	{
+		uint64_t k;
+		std::memcpy(&k, bytes, sizeof(k));
+
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+	}
+
+	switch (size & 7)
+	{
+		case 7:
+			h ^= static_cast<uint64_t>(bytes[6]) << 48;
+			VKB_FALLTHROUGH;
+		case 6:
+			h ^= static_cast<uint64_t>(bytes[5]) << 40;
+			VKB_FALLTHROUGH;
+		case 5:
+			h ^= static_cast<uint64_t>(bytes[4]) << 32;
+			VKB_FALLTHROUGH;
+		case 4:
+			h ^= static_cast<uint64_t>(bytes[3]) << 24;
+			VKB_FALLTHROUGH;
+		case 3:
+			h ^= static_cast<uint64_t>(bytes[2]) << 16;
+			VKB_FALLTHROUGH;
+		case 2:
+			h ^= static_cast<uint64_t>(bytes[1]) << 8;
+			VKB_FALLTHROUGH;
+		case 1:
+			h ^= static_cast<uint64_t>(bytes[0]);
+			h *= m;
+	}
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+
+	return static_cast<size_t>(h);
+}
+
+/**
+ * @brief Hash of a vector of plain data, see hash_bytes
+ */
+template <class T>
+inline size_t hash_bytes(const std::vector<T> &data, uint64_t seed = 0)
+{
+	return hash_bytes(data.data(), data.size() * sizeof(T), seed);
+}
+
+/**
+ * @brief Index of the lowest set bit of a bit mask, used to iterate over set bits
+ * @param value A non-zero bit mask
+ */
+inline uint32_t count_trailing_zeros(uint64_t value)
+{
+	assert(value != 0 && "Bit mask has no set bit");
+
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<uint32_t>(__builtin_ctzll(value));
+#else
+	uint32_t count = 0;
+
+	while ((value & 1) == 0)
+	{
+		value >>= 1;
+		++count;
+	}
+
+	return count;
+#endif
+}
+
 /**
  * @brief Helper function to convert a data type
  *        to string using output stream operator.
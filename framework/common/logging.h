@@ -28,7 +28,39 @@
 
 #define __FILENAME__ (static_cast<const char *>(__FILE__) + ROOT_PATH_SIZE)
 
-#define LOGI(...) spdlog::info(__VA_ARGS__);
-#define LOGW(...) spdlog::warn(__VA_ARGS__);
+#define VKB_LOG_LEVEL_DEBUG 0
+#define VKB_LOG_LEVEL_INFO 1
+#define VKB_LOG_LEVEL_WARN 2
+#define VKB_LOG_LEVEL_ERROR 3
+
+// Messages below this level are compiled out, their arguments are not evaluated either but still count as used
+#define VKB_LOG_DISABLED(function, ...) static_cast<void>(sizeof((function(__VA_ARGS__), 0)));
+
+#if !defined(VKB_LOG_LEVEL)
+#	define VKB_LOG_LEVEL VKB_LOG_LEVEL_DEBUG
+#endif
+
+#if defined(VKB_PERF_BUILD) && VKB_LOG_LEVEL < VKB_LOG_LEVEL_INFO
+#	undef VKB_LOG_LEVEL
+#	define VKB_LOG_LEVEL VKB_LOG_LEVEL_INFO
+#endif
+
+#if VKB_LOG_LEVEL <= VKB_LOG_LEVEL_INFO
+#	define LOGI(...) spdlog::info(__VA_ARGS__);
+#else
+#	define LOGI(...) VKB_LOG_DISABLED(spdlog::info, __VA_ARGS__)
+#endif
+
+#if VKB_LOG_LEVEL <= VKB_LOG_LEVEL_WARN
+#	define LOGW(...) spdlog::warn(__VA_ARGS__);
+#else
+#	define LOGW(...) VKB_LOG_DISABLED(spdlog::warn, __VA_ARGS__)
+#endif
+
 #define LOGE(...) spdlog::error("[{}:{}] {}", __FILENAME__, __LINE__, fmt::format(__VA_ARGS__));
-#define LOGD(...) spdlog::debug(__VA_ARGS__);
+
+#if VKB_LOG_LEVEL <= VKB_LOG_LEVEL_DEBUG
+#	define LOGD(...) spdlog::debug(__VA_ARGS__);
+#else
+#	define LOGD(...) VKB_LOG_DISABLED(spdlog::debug, __VA_ARGS__)
+#endif
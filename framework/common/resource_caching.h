@@ -30,6 +30,7 @@
 #include "resource_record.h"
 
 #include "common/helpers.h"
+#include "common/resource_map.h"
 
 namespace std
 {
@@ -147,6 +148,7 @@ struct hash<vkb::LoadStoreInfo>
 
 		vkb::hash_combine(result, static_cast<std::underlying_type<VkAttachmentLoadOp>::type>(load_store_info.load_op));
 		vkb::hash_combine(result, static_cast<std::underlying_type<VkAttachmentStoreOp>::type>(load_store_info.store_op));
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkImageLayout>::type>(load_store_info.preserved_layout));
 
 		return result;
 	}
@@ -169,6 +171,17 @@ struct hash<vkb::SubpassInfo>
 			vkb::hash_combine(result, input_attachment);
 		}
 
+		for (uint32_t resolve_attachment : subpass_info.color_resolve_attachments)
+		{
+			vkb::hash_combine(result, resolve_attachment);
+		}
+
+		vkb::hash_combine(result, subpass_info.rasterization_order_access);
+		vkb::hash_combine(result, subpass_info.shading_rate_attachment);
+		vkb::hash_combine(result, subpass_info.shading_rate_texel_size.width);
+		vkb::hash_combine(result, subpass_info.shading_rate_texel_size.height);
+		vkb::hash_combine(result, subpass_info.view_mask);
+
 		return result;
 	}
 };
@@ -211,6 +224,9 @@ struct hash<vkb::ShaderResource>
 		vkb::hash_combine(result, shader_resource.set);
 		vkb::hash_combine(result, shader_resource.binding);
 		vkb::hash_combine(result, static_cast<std::underlying_type<vkb::ShaderResourceType>::type>(shader_resource.type));
+		vkb::hash_combine(result, shader_resource.push_descriptor);
+		vkb::hash_combine(result, shader_resource.update_after_bind);
+		vkb::hash_combine(result, shader_resource.immutable_sampler);
 
 		return result;
 	}
@@ -335,6 +351,34 @@ struct hash<VkRect2D>
 	}
 };
 
+template <>
+struct hash<VkSamplerCreateInfo>
+{
+	std::size_t operator()(const VkSamplerCreateInfo &sampler_info) const
+	{
+		std::size_t result = 0;
+
+		vkb::hash_combine(result, sampler_info.flags);
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkFilter>::type>(sampler_info.magFilter));
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkFilter>::type>(sampler_info.minFilter));
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkSamplerMipmapMode>::type>(sampler_info.mipmapMode));
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkSamplerAddressMode>::type>(sampler_info.addressModeU));
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkSamplerAddressMode>::type>(sampler_info.addressModeV));
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkSamplerAddressMode>::type>(sampler_info.addressModeW));
+		vkb::hash_combine(result, sampler_info.mipLodBias);
+		vkb::hash_combine(result, sampler_info.anisotropyEnable);
+		vkb::hash_combine(result, sampler_info.maxAnisotropy);
+		vkb::hash_combine(result, sampler_info.compareEnable);
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkCompareOp>::type>(sampler_info.compareOp));
+		vkb::hash_combine(result, sampler_info.minLod);
+		vkb::hash_combine(result, sampler_info.maxLod);
+		vkb::hash_combine(result, static_cast<std::underlying_type<VkBorderColor>::type>(sampler_info.borderColor));
+		vkb::hash_combine(result, sampler_info.unnormalizedCoordinates);
+
+		return result;
+	}
+};
+
 template <>
 struct hash<VkViewport>
 {
@@ -378,14 +422,16 @@ struct hash<vkb::RenderTarget>
 {
 	std::size_t operator()(const vkb::RenderTarget &render_target) const
 	{
-		std::size_t result = 0;
-
-		for (auto &view : render_target.get_views())
-		{
-			vkb::hash_combine(result, view.get_handle());
-		}
+		return render_target.get_views_hash();
+	}
+};
 
-		return result;
+template <>
+struct hash<vkb::FramebufferAttachments>
+{
+	std::size_t operator()(const vkb::FramebufferAttachments &framebuffer_attachments) const
+	{
+		return framebuffer_attachments.hash;
 	}
 };
 
@@ -394,79 +440,7 @@ struct hash<vkb::PipelineState>
 {
 	std::size_t operator()(const vkb::PipelineState &pipeline_state) const
 	{
-		std::size_t result = 0;
-
-		vkb::hash_combine(result, pipeline_state.get_pipeline_layout().get_handle());
-
-		// For graphics only
-		if (auto render_pass = pipeline_state.get_render_pass())
-		{
-			vkb::hash_combine(result, render_pass->get_handle());
-		}
-
-		vkb::hash_combine(result, pipeline_state.get_specialization_constant_state());
-
-		vkb::hash_combine(result, pipeline_state.get_subpass_index());
-
-		for (auto stage : pipeline_state.get_pipeline_layout().get_shader_program().get_shader_modules())
-		{
-			vkb::hash_combine(result, stage->get_id());
-		}
-
-		// VkPipelineVertexInputStateCreateInfo
-		for (auto &attribute : pipeline_state.get_vertex_input_state().attributes)
-		{
-			vkb::hash_combine(result, attribute);
-		}
-
-		for (auto &binding : pipeline_state.get_vertex_input_state().bindings)
-		{
-			vkb::hash_combine(result, binding);
-		}
-
-		// VkPipelineInputAssemblyStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_input_assembly_state().primitive_restart_enable);
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkPrimitiveTopology>::type>(pipeline_state.get_input_assembly_state().topology));
-
-		//VkPipelineViewportStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_viewport_state().viewport_count);
-		vkb::hash_combine(result, pipeline_state.get_viewport_state().scissor_count);
-
-		// VkPipelineRasterizationStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_rasterization_state().cull_mode);
-		vkb::hash_combine(result, pipeline_state.get_rasterization_state().depth_bias_enable);
-		vkb::hash_combine(result, pipeline_state.get_rasterization_state().depth_clamp_enable);
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkFrontFace>::type>(pipeline_state.get_rasterization_state().front_face));
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkPolygonMode>::type>(pipeline_state.get_rasterization_state().polygon_mode));
-		vkb::hash_combine(result, pipeline_state.get_rasterization_state().rasterizer_discard_enable);
-
-		// VkPipelineMultisampleStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().alpha_to_coverage_enable);
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().alpha_to_one_enable);
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().min_sample_shading);
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkSampleCountFlagBits>::type>(pipeline_state.get_multisample_state().rasterization_samples));
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().sample_shading_enable);
-		vkb::hash_combine(result, pipeline_state.get_multisample_state().sample_mask);
-
-		// VkPipelineDepthStencilStateCreateInfo
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().back);
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().depth_bounds_test_enable);
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkCompareOp>::type>(pipeline_state.get_depth_stencil_state().depth_compare_op));
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().depth_test_enable);
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().depth_write_enable);
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().front);
-		vkb::hash_combine(result, pipeline_state.get_depth_stencil_state().stencil_test_enable);
-
-		// VkPipelineColorBlendStateCreateInfo
-		vkb::hash_combine(result, static_cast<std::underlying_type<VkLogicOp>::type>(pipeline_state.get_color_blend_state().logic_op));
-		vkb::hash_combine(result, pipeline_state.get_color_blend_state().logic_op_enable);
-
-		for (auto &attachment : pipeline_state.get_color_blend_state().attachments)
-		{
-			vkb::hash_combine(result, attachment);
-		}
-
-		return result;
+		return pipeline_state.get_hash();
 	}
 };
 }        // namespace std
@@ -583,6 +557,15 @@ inline void hash_param<std::map<uint32_t, std::map<uint32_t, VkDescriptorImageIn
 	}
 }
 
+template <>
+inline void hash_param<DescriptorSetInfos>(
+    size_t &                  seed,
+    const DescriptorSetInfos &value)
+{
+	// Hashed as the infos were added
+	hash_combine(seed, value.get_hash());
+}
+
 template <typename T, typename... Args>
 inline void hash_param(size_t &seed, const T &first_arg, const Args &... args)
 {
@@ -591,6 +574,340 @@ inline void hash_param(size_t &seed, const T &first_arg, const Args &... args)
 	hash_param(seed, args...);
 }
 
+inline void append_key(std::vector<uint8_t> &key, const void *data, size_t size)
+{
+	auto bytes = static_cast<const uint8_t *>(data);
+
+	key.insert(key.end(), bytes, bytes + size);
+}
+
+/**
+ * @brief Appends a parameter to the serialized key of a resource. Keys are compared byte by
+ *        byte on a cache hit, so they must only contain padding-free data.
+ */
+template <typename T>
+inline void serialize_param(std::vector<uint8_t> &key, const T &value)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Resource parameter cannot be serialized as bytes");
+
+	append_key(key, &value, sizeof(T));
+}
+
+/**
+ * @brief Appends a Vulkan handle, on 32-bit platforms these share their type with VkPipelineCache
+ */
+template <typename T>
+inline void serialize_handle(std::vector<uint8_t> &key, T handle)
+{
+	append_key(key, &handle, sizeof(T));
+}
+
+template <typename T>
+inline void serialize_vector(std::vector<uint8_t> &key, const std::vector<T> &value)
+{
+	serialize_param(key, value.size());
+
+	append_key(key, value.data(), value.size() * sizeof(T));
+}
+
+template <>
+inline void serialize_param(std::vector<uint8_t> & /*key*/, const VkPipelineCache & /*value*/)
+{
+}
+
+/**
+ * @brief Appends the members of a sampler create info following its pNext pointer,
+ *        which are all 32-bit wide. Chained structures are not supported.
+ */
+template <>
+inline void serialize_param<VkSamplerCreateInfo>(std::vector<uint8_t> &key, const VkSamplerCreateInfo &sampler_info)
+{
+	assert(sampler_info.pNext == nullptr && "Cached samplers cannot chain structures");
+
+	auto first = reinterpret_cast<const uint8_t *>(&sampler_info.flags);
+	auto last  = reinterpret_cast<const uint8_t *>(&sampler_info.unnormalizedCoordinates) + sizeof(sampler_info.unnormalizedCoordinates);
+
+	append_key(key, first, last - first);
+}
+
+template <>
+inline void serialize_param<bool>(std::vector<uint8_t> &key, const bool &value)
+{
+	key.push_back(value ? 1 : 0);
+}
+
+template <>
+inline void serialize_param<std::string>(std::vector<uint8_t> &key, const std::string &value)
+{
+	serialize_param(key, value.size());
+
+	append_key(key, value.data(), value.size());
+}
+
+template <>
+inline void serialize_param<std::vector<uint8_t>>(std::vector<uint8_t> &key, const std::vector<uint8_t> &value)
+{
+	serialize_vector(key, value);
+}
+
+template <>
+inline void serialize_param<ShaderSource>(std::vector<uint8_t> &key, const ShaderSource &shader_source)
+{
+	// Copying the whole source on every request would be too slow, its id already hashes all of it
+	serialize_param(key, shader_source.get_id());
+	serialize_param(key, shader_source.get_data().size());
+}
+
+template <>
+inline void serialize_param<ShaderVariant>(std::vector<uint8_t> &key, const ShaderVariant &shader_variant)
+{
+	serialize_param(key, shader_variant.get_preamble());
+}
+
+template <>
+inline void serialize_param<std::vector<ShaderModule *>>(std::vector<uint8_t> &key, const std::vector<ShaderModule *> &value)
+{
+	serialize_vector(key, value);
+}
+
+template <>
+inline void serialize_param<std::vector<ShaderResource>>(std::vector<uint8_t> &key, const std::vector<ShaderResource> &value)
+{
+	for (auto &resource : value)
+	{
+		if (resource.type == ShaderResourceType::Input ||
+		    resource.type == ShaderResourceType::Output ||
+		    resource.type == ShaderResourceType::PushConstant ||
+		    resource.type == ShaderResourceType::SpecializationConstant)
+		{
+			continue;
+		}
+
+		serialize_param(key, resource.set);
+		serialize_param(key, resource.binding);
+		serialize_param(key, resource.type);
+		serialize_param(key, resource.stages);
+		serialize_param(key, resource.array_size);
+		serialize_param(key, resource.push_descriptor);
+		serialize_param(key, resource.update_after_bind);
+		serialize_handle(key, resource.immutable_sampler);
+	}
+}
+
+template <>
+inline void serialize_param<DescriptorSetLayout>(std::vector<uint8_t> &key, const DescriptorSetLayout &descriptor_set_layout)
+{
+	serialize_handle(key, descriptor_set_layout.get_handle());
+}
+
+template <>
+inline void serialize_param<DescriptorPool>(std::vector<uint8_t> &key, const DescriptorPool &descriptor_pool)
+{
+	serialize_handle(key, descriptor_pool.get_descriptor_set_layout().get_handle());
+}
+
+template <>
+inline void serialize_param<VkDescriptorImageInfo>(std::vector<uint8_t> &key, const VkDescriptorImageInfo &descriptor_image_info)
+{
+	// Field by field, the struct has tail padding
+	serialize_handle(key, descriptor_image_info.sampler);
+	serialize_handle(key, descriptor_image_info.imageView);
+	serialize_param(key, descriptor_image_info.imageLayout);
+}
+
+template <>
+inline void serialize_param<BindingMap<VkDescriptorBufferInfo>>(std::vector<uint8_t> &key, const BindingMap<VkDescriptorBufferInfo> &value)
+{
+	serialize_param(key, value.size());
+
+	for (auto &binding_set : value)
+	{
+		serialize_param(key, binding_set.first);
+		serialize_param(key, binding_set.second.size());
+
+		for (auto &binding_element : binding_set.second)
+		{
+			serialize_param(key, binding_element.first);
+			serialize_param(key, binding_element.second);
+		}
+	}
+}
+
+template <>
+inline void serialize_param<BindingMap<VkDescriptorImageInfo>>(std::vector<uint8_t> &key, const BindingMap<VkDescriptorImageInfo> &value)
+{
+	serialize_param(key, value.size());
+
+	for (auto &binding_set : value)
+	{
+		serialize_param(key, binding_set.first);
+		serialize_param(key, binding_set.second.size());
+
+		for (auto &binding_element : binding_set.second)
+		{
+			serialize_param(key, binding_element.first);
+			serialize_param(key, binding_element.second);
+		}
+	}
+}
+
+template <>
+inline void serialize_param<DescriptorSetInfos>(std::vector<uint8_t> &key, const DescriptorSetInfos &value)
+{
+	serialize_param(key, value.get_buffer_info_count());
+
+	for (uint32_t i = 0; i < value.get_buffer_info_count(); i++)
+	{
+		auto &entry = value.get_buffer_info(i);
+
+		serialize_param(key, entry.binding);
+		serialize_param(key, entry.array_element);
+		serialize_param(key, entry.info);
+	}
+
+	serialize_param(key, value.get_image_info_count());
+
+	for (uint32_t i = 0; i < value.get_image_info_count(); i++)
+	{
+		auto &entry = value.get_image_info(i);
+
+		serialize_param(key, entry.binding);
+		serialize_param(key, entry.array_element);
+		serialize_param(key, entry.info);
+	}
+}
+
+template <>
+inline void serialize_param<std::vector<Attachment>>(std::vector<uint8_t> &key, const std::vector<Attachment> &value)
+{
+	serialize_vector(key, value);
+}
+
+template <>
+inline void serialize_param<std::vector<LoadStoreInfo>>(std::vector<uint8_t> &key, const std::vector<LoadStoreInfo> &value)
+{
+	serialize_vector(key, value);
+}
+
+template <>
+inline void serialize_param<std::vector<SubpassInfo>>(std::vector<uint8_t> &key, const std::vector<SubpassInfo> &value)
+{
+	serialize_param(key, value.size());
+
+	for (auto &subpass_info : value)
+	{
+		serialize_vector(key, subpass_info.input_attachments);
+		serialize_vector(key, subpass_info.output_attachments);
+		serialize_vector(key, subpass_info.color_resolve_attachments);
+		serialize_param(key, subpass_info.rasterization_order_access);
+		serialize_param(key, subpass_info.shading_rate_attachment);
+		serialize_param(key, subpass_info.shading_rate_texel_size);
+		serialize_param(key, subpass_info.view_mask);
+	}
+}
+
+template <>
+inline void serialize_param<RenderTarget>(std::vector<uint8_t> &key, const RenderTarget &render_target)
+{
+	auto &view_handles = render_target.get_view_handles();
+
+	serialize_param(key, view_handles.size());
+
+	append_key(key, view_handles.data(), view_handles.size() * sizeof(VkImageView));
+}
+
+template <>
+inline void serialize_param<FramebufferAttachments>(std::vector<uint8_t> &key, const FramebufferAttachments &framebuffer_attachments)
+{
+	serialize_param(key, framebuffer_attachments.extent);
+	serialize_vector(key, framebuffer_attachments.attachments);
+	serialize_vector(key, framebuffer_attachments.extents);
+	serialize_param(key, framebuffer_attachments.layers);
+}
+
+template <>
+inline void serialize_param<RenderPass>(std::vector<uint8_t> &key, const RenderPass &render_pass)
+{
+	serialize_handle(key, render_pass.get_handle());
+}
+
+template <>
+inline void serialize_param<PipelineState>(std::vector<uint8_t> &key, const PipelineState &pipeline_state)
+{
+	auto &pipeline_layout = pipeline_state.get_pipeline_layout();
+
+	serialize_handle(key, pipeline_layout.get_handle());
+
+	for (auto stage : pipeline_layout.get_shader_program().get_shader_modules())
+	{
+		serialize_param(key, stage->get_id());
+	}
+
+	// For graphics only, keyed by compatibility so that render passes differing in load/store operations share pipelines
+	if (pipeline_state.get_render_pass())
+	{
+		serialize_vector(key, pipeline_state.get_render_pass()->get_compatibility_key());
+	}
+	else
+	{
+		serialize_param(key, std::size_t{0});
+	}
+
+	serialize_param(key, pipeline_state.get_subpass_index());
+
+	auto &specialization_constants = pipeline_state.get_specialization_constant_state().get_specialization_constant_state();
+	serialize_param(key, specialization_constants.size());
+
+	for (auto &constant : specialization_constants)
+	{
+		serialize_param(key, constant.first);
+		serialize_vector(key, constant.second);
+	}
+
+	// The remaining states only hold 32-bit fields, so they are free of padding
+	serialize_vector(key, pipeline_state.get_vertex_input_state().bindings);
+	serialize_vector(key, pipeline_state.get_vertex_input_state().attributes);
+	serialize_param(key, pipeline_state.get_input_assembly_state());
+	serialize_param(key, pipeline_state.get_static_rasterization_state());
+	serialize_param(key, pipeline_state.get_viewport_state());
+	serialize_param(key, pipeline_state.get_multisample_state());
+	serialize_param(key, pipeline_state.get_static_depth_stencil_state());
+	serialize_param(key, pipeline_state.get_fragment_shading_rate_state());
+	serialize_param(key, pipeline_state.has_extended_dynamic_state());
+
+	auto &color_blend_state = pipeline_state.get_color_blend_state();
+	serialize_param(key, color_blend_state.logic_op_enable);
+	serialize_param(key, color_blend_state.logic_op);
+	serialize_vector(key, color_blend_state.attachments);
+}
+
+template <typename T, typename... Args>
+inline void serialize_param(std::vector<uint8_t> &key, const T &first_arg, const Args &... args)
+{
+	serialize_param(key, first_arg);
+
+	serialize_param(key, args...);
+}
+
+/**
+ * @brief Computes the hash and the serialized key of a resource
+ * @param hash Set to the hash of the resource
+ * @returns The key, stored in a per-thread buffer which is overwritten by the next call
+ */
+template <typename... A>
+inline const std::vector<uint8_t> &get_resource_key(std::size_t &hash, const A &... args)
+{
+	thread_local std::vector<uint8_t> key;
+
+	key.clear();
+	serialize_param(key, args...);
+
+	hash = 0U;
+	hash_param(hash, args...);
+
+	return key;
+}
+
 template <class T, class... A>
 struct RecordHelper
 {
@@ -661,57 +978,70 @@ struct RecordHelper<GraphicsPipeline, A...>
 };
 }        // namespace
 
-template <class T, class... A>
-T &request_resource(Device &device, ResourceRecord *recorder, std::unordered_map<std::size_t, T> &resources, A &... args)
+/**
+ * @brief Looks up a resource in the cache without creating it
+ * @param resources The cache to search
+ * @param args The parameters the resource would be created with
+ * @returns A pointer to the cached resource, nullptr if it is not present
+ */
+template <class M, class... A>
+typename M::mapped_type *find_resource(M &resources, A &... args)
+{
+	std::size_t hash{0U};
+	auto &      key = get_resource_key(hash, args...);
+
+	return resources.find(hash, key);
+}
+
+template <class M, class... A>
+typename M::mapped_type &request_resource(Device &device, ResourceRecord *recorder, M &resources, A &... args)
 {
+	using T = typename M::mapped_type;
+
 	RecordHelper<T, A...> record_helper;
 
 	std::size_t hash{0U};
-	hash_param(hash, args...);
+	auto &      key = get_resource_key(hash, args...);
 
-	auto res_it = resources.find(hash);
-
-	if (res_it != resources.end())
+	if (auto resource = resources.find(hash, key))
 	{
-		return res_it->second;
+		return *resource;
 	}
 
+	// Keep a copy of the key, creating the resource may request other resources
+	std::vector<uint8_t> resource_key{key};
+
 	// If we do not have it already, create and cache it
-	const char *res_type = typeid(T).name();
-	size_t      res_id   = resources.size();
+	LOGD("Building #{} cache object ({})", resources.size(), typeid(T).name());
 
-	LOGD("Building #{} cache object ({})", res_id, res_type);
+	T *res = nullptr;
+
+// Only error handle in release, performance builds let the exception through
+#if !defined(DEBUG) && !defined(VKB_PERF_BUILD)
+	size_t res_id = resources.size();
 
-// Only error handle in release
-#ifndef DEBUG
 	try
 	{
 #endif
 		T resource(device, args...);
 
-		auto res_ins_it = resources.emplace(hash, std::move(resource));
-
-		if (!res_ins_it.second)
-		{
-			throw std::runtime_error{std::string{"Insertion error for #"} + std::to_string(res_id) + "cache object (" + res_type + ")"};
-		}
-
-		res_it = res_ins_it.first;
+		// The lookup above missed, so the insertion cannot find an existing resource
+		res = resources.emplace(hash, std::move(resource_key), std::move(resource)).first;
 
 		if (recorder)
 		{
 			size_t index = record_helper.record(*recorder, args...);
-			record_helper.index(*recorder, index, res_it->second);
+			record_helper.index(*recorder, index, *res);
 		}
-#ifndef DEBUG
+#if !defined(DEBUG) && !defined(VKB_PERF_BUILD)
 	}
 	catch (const std::exception &e)
 	{
-		LOGE("Creation error for #{} cache object ({})", res_id, res_type);
+		LOGE("Creation error for #{} cache object ({})", res_id, typeid(T).name());
 		throw e;
 	}
 #endif
 
-	return res_it->second;
+	return *res;
 }
 }        // namespace vkb
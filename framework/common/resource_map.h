@@ -0,0 +1,359 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace vkb
+{
+/**
+ * @brief Iterates over the entries of a resource map, which it holds by pointer
+ */
+template <class E, class I>
+class ResourceMapIterator
+{
+  public:
+	ResourceMapIterator(I it) :
+	    it{it}
+	{}
+
+	E &operator*() const
+	{
+		return **it;
+	}
+
+	E *operator->() const
+	{
+		return it->get();
+	}
+
+	ResourceMapIterator &operator++()
+	{
+		++it;
+		return *this;
+	}
+
+	ResourceMapIterator operator++(int)
+	{
+		ResourceMapIterator result{*this};
+		++it;
+		return result;
+	}
+
+	bool operator==(const ResourceMapIterator &other) const
+	{
+		return it == other.it;
+	}
+
+	bool operator!=(const ResourceMapIterator &other) const
+	{
+		return it != other.it;
+	}
+
+  private:
+	I it;
+};
+
+/**
+ * @brief Open addressing hash map holding the cached resources of one type.
+ *        Entries are found by their hash and confirmed by comparing their serialized key,
+ *        so a hash collision never returns the wrong resource.
+ *        The probe table only stores hashes and indices, which keeps lookups within a
+ *        few cache lines. Resources are allocated once and do not move while cached,
+ *        so references to them stay valid until they are erased.
+ */
+template <class T>
+class ResourceMap
+{
+  public:
+	using mapped_type = T;
+
+	struct Entry
+	{
+		Entry(std::size_t hash, std::vector<uint8_t> &&key, T &&value) :
+		    first{hash},
+		    key{std::move(key)},
+		    second{std::move(value)}
+		{}
+
+		/// Hash of the resource, named after std::pair so the map iterates like std::unordered_map
+		const std::size_t first;
+
+		/// Serialized parameters the resource was created with
+		const std::vector<uint8_t> key;
+
+		T second;
+	};
+
+	using iterator = ResourceMapIterator<Entry, typename std::vector<std::unique_ptr<Entry>>::iterator>;
+
+	using const_iterator = ResourceMapIterator<const Entry, typename std::vector<std::unique_ptr<Entry>>::const_iterator>;
+
+	iterator begin()
+	{
+		return entries.begin();
+	}
+
+	iterator end()
+	{
+		return entries.end();
+	}
+
+	const_iterator begin() const
+	{
+		return entries.begin();
+	}
+
+	const_iterator end() const
+	{
+		return entries.end();
+	}
+
+	std::size_t size() const
+	{
+		return entries.size();
+	}
+
+	bool empty() const
+	{
+		return entries.empty();
+	}
+
+	/**
+	 * @brief Looks up a resource
+	 * @param hash The hash of the resource
+	 * @param key The serialized parameters of the resource
+	 * @returns A pointer to the resource, nullptr if it is not in the map
+	 */
+	T *find(std::size_t hash, const std::vector<uint8_t> &key)
+	{
+		auto slot = find_slot(hash, key);
+
+		return slot ? &entries[slot->index]->second : nullptr;
+	}
+
+	const T *find(std::size_t hash, const std::vector<uint8_t> &key) const
+	{
+		return const_cast<ResourceMap *>(this)->find(hash, key);
+	}
+
+	/**
+	 * @brief Inserts a resource, unless one with the same key is already in the map
+	 * @returns The resource in the map and whether it was inserted
+	 */
+	std::pair<T *, bool> emplace(std::size_t hash, std::vector<uint8_t> key, T &&value)
+	{
+		if (auto resource = find(hash, key))
+		{
+			return {resource, false};
+		}
+
+		// Keep the load factor under one half so that probe sequences stay short
+		if ((entries.size() + 1) * 2 > slots.size())
+		{
+			rehash(slots.empty() ? 16 : slots.size() * 2);
+		}
+
+		entries.emplace_back(std::make_unique<Entry>(hash, std::move(key), std::move(value)));
+
+		insert_slot(hash, static_cast<uint32_t>(entries.size() - 1));
+
+		return {&entries.back()->second, true};
+	}
+
+	/**
+	 * @brief Removes a resource
+	 * @returns Whether the resource was in the map
+	 */
+	bool erase(std::size_t hash, const std::vector<uint8_t> &key)
+	{
+		auto slot = find_slot(hash, key);
+
+		if (!slot)
+		{
+			return false;
+		}
+
+		erase_slot(static_cast<std::size_t>(slot - slots.data()));
+
+		return true;
+	}
+
+	/**
+	 * @brief Removes all the resources with a hash
+	 * @param on_erase Called on each resource before it is destroyed
+	 * @returns The number of resources removed
+	 */
+	template <class F>
+	std::size_t erase(std::size_t hash, F on_erase)
+	{
+		std::size_t count{0};
+
+		if (slots.empty())
+		{
+			return count;
+		}
+
+		std::size_t i = hash & mask();
+
+		while (!slots[i].is_empty())
+		{
+			if (slots[i].hash == hash)
+			{
+				on_erase(entries[slots[i].index]->second);
+
+				// An entry from further along the probe sequence may have shifted into this slot
+				erase_slot(i);
+				++count;
+			}
+			else
+			{
+				i = (i + 1) & mask();
+			}
+		}
+
+		return count;
+	}
+
+	void clear()
+	{
+		slots.clear();
+		entries.clear();
+	}
+
+  private:
+	struct Slot
+	{
+		std::size_t hash{0};
+
+		uint32_t index{~0U};
+
+		bool is_empty() const
+		{
+			return index == ~0U;
+		}
+	};
+
+	std::vector<Slot> slots;
+
+	std::vector<std::unique_ptr<Entry>> entries;
+
+	std::size_t mask() const
+	{
+		return slots.size() - 1;
+	}
+
+	Slot *find_slot(std::size_t hash, const std::vector<uint8_t> &key)
+	{
+		if (slots.empty())
+		{
+			return nullptr;
+		}
+
+		for (std::size_t i = hash & mask(); !slots[i].is_empty(); i = (i + 1) & mask())
+		{
+			if (slots[i].hash == hash)
+			{
+				auto &entry_key = entries[slots[i].index]->key;
+
+				if (entry_key.size() == key.size() && std::memcmp(entry_key.data(), key.data(), key.size()) == 0)
+				{
+					return &slots[i];
+				}
+			}
+		}
+
+		return nullptr;
+	}
+
+	void insert_slot(std::size_t hash, uint32_t index)
+	{
+		std::size_t i = hash & mask();
+
+		while (!slots[i].is_empty())
+		{
+			i = (i + 1) & mask();
+		}
+
+		slots[i].hash  = hash;
+		slots[i].index = index;
+	}
+
+	void rehash(std::size_t slot_count)
+	{
+		slots.assign(slot_count, Slot{});
+
+		for (std::size_t i = 0; i < entries.size(); ++i)
+		{
+			insert_slot(entries[i]->first, static_cast<uint32_t>(i));
+		}
+	}
+
+	/**
+	 * @brief Removes the entry of a slot, shifting back the following slots of the
+	 *        probe sequence so that no tombstones are needed
+	 */
+	void erase_slot(std::size_t i)
+	{
+		uint32_t index = slots[i].index;
+
+		slots[i] = {};
+
+		for (std::size_t j = (i + 1) & mask(); !slots[j].is_empty(); j = (j + 1) & mask())
+		{
+			std::size_t home = slots[j].hash & mask();
+
+			// Move the slot back unless its home lies cyclically within (i, j]
+			bool stays = i < j ? (home > i && home <= j) : (home > i || home <= j);
+
+			if (!stays)
+			{
+				slots[i] = slots[j];
+				slots[j] = {};
+				i        = j;
+			}
+		}
+
+		// Keep the entries dense by moving the last one into the hole
+		uint32_t last = static_cast<uint32_t>(entries.size() - 1);
+
+		if (index != last)
+		{
+			entries[index] = std::move(entries[last]);
+
+			for (std::size_t j = entries[index]->first & mask();; j = (j + 1) & mask())
+			{
+				if (slots[j].index == last)
+				{
+					slots[j].index = index;
+					break;
+				}
+			}
+		}
+
+		entries.pop_back();
+	}
+};
+}        // namespace vkb
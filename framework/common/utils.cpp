@@ -25,6 +25,7 @@
 
 #include "core/pipeline_layout.h"
 #include "core/shader_module.h"
+#include "job_system.h"
 #include "scene_graph/components/image.h"
 #include "scene_graph/components/material.h"
 #include "scene_graph/components/mesh.h"
@@ -59,8 +60,9 @@ void screenshot(RenderContext &render_context, const std::string &filename)
 	auto &frame          = render_context.get_last_rendered_frame();
 	auto &src_image_view = frame.get_render_target().get_views().at(0);
 
-	auto width  = render_context.get_surface_extent().width;
-	auto height = render_context.get_surface_extent().height;
+	// The swapchain images may be pre-rotated, the copy keeps their orientation
+	auto width  = frame.get_render_target().get_extent().width;
+	auto height = frame.get_render_target().get_extent().height;
 
 	core::Image dst_image{render_context.get_device(),
 	                      VkExtent3D{width, height, 1},
@@ -95,7 +97,7 @@ void screenshot(RenderContext &render_context, const std::string &filename)
 	// Enable framebuffer image view to be read from
 	{
 		ImageMemoryBarrier memory_barrier{};
-		memory_barrier.old_layout     = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		memory_barrier.old_layout     = render_context.get_present_layout();
 		memory_barrier.new_layout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 		memory_barrier.src_stage_mask = VK_PIPELINE_STAGE_TRANSFER_BIT;
 		memory_barrier.dst_stage_mask = VK_PIPELINE_STAGE_TRANSFER_BIT;
@@ -136,7 +138,7 @@ void screenshot(RenderContext &render_context, const std::string &filename)
 	{
 		ImageMemoryBarrier memory_barrier{};
 		memory_barrier.old_layout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		memory_barrier.new_layout     = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		memory_barrier.new_layout     = render_context.get_present_layout();
 		memory_barrier.src_stage_mask = VK_PIPELINE_STAGE_TRANSFER_BIT;
 		memory_barrier.dst_stage_mask = VK_PIPELINE_STAGE_TRANSFER_BIT;
 
@@ -347,4 +349,15 @@ sg::Node &add_free_camera(sg::Scene &scene, const std::string &node_name, VkExte
 	return *camera_node;
 }
 
+void parallel_for_ranges(JobSystem *job_system, uint32_t count, uint32_t range_size, const std::function<void(uint32_t, uint32_t)> &func)
+{
+	if (!job_system)
+	{
+		func(0, count);
+		return;
+	}
+
+	job_system->parallel_for(count, range_size, [&func](uint32_t begin, uint32_t end, size_t) { func(begin, end); });
+}
+
 }        // namespace vkb
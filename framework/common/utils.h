@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include "common/error.h"
 
 VKBP_DISABLE_WARNINGS()
@@ -35,6 +37,8 @@ VKBP_ENABLE_WARNINGS()
 
 namespace vkb
 {
+class JobSystem;
+
 /**
  * @brief Extracts the extension from an uri
  * @param uri An uniform Resource Identifier
@@ -49,7 +53,8 @@ std::string get_extension(const std::string &uri);
 std::string to_snake_case(const std::string &name);
 
 /**
- * @brief Takes a screenshot of the app by writing the swapchain image to file (slow function)
+ * @brief Takes a screenshot of the app by writing the swapchain image to file (slow function,
+ *        it waits for the queue to be idle, FrameCapture captures frames without stalling)
  * @param filename The name of the file to save the output to
  */
 void screenshot(RenderContext &render_context, const std::string &filename);
@@ -96,4 +101,15 @@ sg::Light &add_directional_light(sg::Scene &scene, const glm::quat &rotation, co
  */
 sg::Node &add_free_camera(sg::Scene &scene, const std::string &node_name, VkExtent2D extent);
 
+/**
+ * @brief Splits count items in ranges of range_size and calls func on each range [begin, end)
+ *        The calling thread runs jobs while it waits for the ranges, so that it does not deadlock
+ *        when it is itself a job of the same job system
+ * @param job_system Job system to run the ranges on, if null every item is processed on the calling thread
+ * @param count The number of items
+ * @param range_size The number of items per range
+ * @param func The function called for each range, it must be safe to call concurrently
+ */
+void parallel_for_ranges(JobSystem *job_system, uint32_t count, uint32_t range_size, const std::function<void(uint32_t, uint32_t)> &func);
+
 }        // namespace vkb
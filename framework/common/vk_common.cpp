@@ -77,6 +77,37 @@ bool is_depth_stencil_format(VkFormat format)
 	       is_depth_only_format(format);
 }
 
+std::vector<VkFormat> get_depth_format_priority_list(FormatPolicy policy)
+{
+	if (policy == FormatPolicy::Bandwidth)
+	{
+		return {VK_FORMAT_D16_UNORM, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D32_SFLOAT};
+	}
+
+	return {VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM};
+}
+
+VkFormat get_suitable_depth_format(VkPhysicalDevice physical_device, const std::vector<VkFormat> &depth_format_priority_list)
+{
+	for (auto &format : depth_format_priority_list)
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
+
+		if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+		{
+			return format;
+		}
+	}
+
+	return VK_FORMAT_UNDEFINED;
+}
+
+bool is_afbc_eligible(VkImageUsageFlags usage)
+{
+	return (usage & VK_IMAGE_USAGE_STORAGE_BIT) == 0;
+}
+
 bool is_dynamic_buffer_descriptor_type(VkDescriptorType descriptor_type)
 {
 	return descriptor_type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC ||
@@ -529,6 +560,104 @@ const std::string convert_format_to_string(VkFormat format)
 	}
 }
 
+ResourceAccess get_resource_access(ResourceUsage usage)
+{
+	switch (usage)
+	{
+		case ResourceUsage::TransferSrc:
+			return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL};
+		case ResourceUsage::TransferDst:
+			return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL};
+		case ResourceUsage::VertexBuffer:
+			return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+		case ResourceUsage::IndexBuffer:
+			return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+		case ResourceUsage::IndirectBuffer:
+			return {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+		case ResourceUsage::UniformBuffer:
+			return {VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+		case ResourceUsage::VertexShaderRead:
+			return {VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+		case ResourceUsage::FragmentShaderRead:
+			return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+		case ResourceUsage::ComputeShaderRead:
+			return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+		case ResourceUsage::ComputeShaderWrite:
+			return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL};
+		case ResourceUsage::ColorAttachment:
+			return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+		case ResourceUsage::DepthStencilAttachment:
+			return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+		case ResourceUsage::DepthStencilReadOnly:
+			return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+		case ResourceUsage::InputAttachment:
+			return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_INPUT_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+		case ResourceUsage::HostRead:
+			return {VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, VK_IMAGE_LAYOUT_GENERAL};
+		case ResourceUsage::Present:
+			return {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR};
+		default:
+			throw std::runtime_error("Unknown resource usage");
+	}
+}
+
+bool update_resource_state(ResourceState &state, const ResourceAccess &access, ImageMemoryBarrier &barrier)
+{
+	const VkAccessFlags write_accesses = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+	                                     VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	const bool writes = (access.access_mask & write_accesses) != 0;
+
+	const bool transition = access.layout != state.layout;
+
+	bool needed = false;
+
+	if (writes || transition)
+	{
+		// Wait for every access since the last write, only written memory has to be made available
+		barrier.src_stage_mask  = state.write_stage_mask | state.read_stage_mask;
+		barrier.src_access_mask = state.write_access_mask;
+
+		needed = transition || barrier.src_stage_mask != 0;
+
+		state.write_stage_mask  = access.stage_mask;
+		state.write_access_mask = access.access_mask & write_accesses;
+
+		// The access waits for the transition already
+		state.read_stage_mask  = writes ? 0 : access.stage_mask;
+		state.read_access_mask = writes ? 0 : access.access_mask;
+	}
+	else
+	{
+		// Reads wait for the last write once per stage and access
+		barrier.src_stage_mask  = state.write_stage_mask;
+		barrier.src_access_mask = state.write_access_mask;
+
+		needed = state.write_stage_mask != 0 &&
+		         ((access.stage_mask & ~state.read_stage_mask) != 0 || (access.access_mask & ~state.read_access_mask) != 0);
+
+		state.read_stage_mask |= access.stage_mask;
+		state.read_access_mask |= access.access_mask;
+	}
+
+	if (needed)
+	{
+		if (barrier.src_stage_mask == 0)
+		{
+			barrier.src_stage_mask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		}
+
+		barrier.dst_stage_mask  = access.stage_mask;
+		barrier.dst_access_mask = access.access_mask;
+		barrier.old_layout      = state.layout;
+		barrier.new_layout      = access.layout;
+	}
+
+	state.layout = access.layout;
+
+	return needed;
+}
+
 namespace gbuffer
 {
 std::vector<LoadStoreInfo> get_load_all_store_swapchain()
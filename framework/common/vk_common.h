@@ -52,6 +52,40 @@ bool is_depth_only_format(VkFormat format);
  */
 bool is_depth_stencil_format(VkFormat format);
 
+/**
+ * @brief Trade-off made when selecting the formats of the attachments
+ */
+enum class FormatPolicy
+{
+	/// The most precise formats, D32 depth first
+	Precision,
+
+	/// The formats with the fewest bytes per pixel, D16 depth first which the reverse-Z projection keeps usable
+	Bandwidth
+};
+
+/**
+ * @brief Helper function to get the depth formats of a policy.
+ * @param policy The trade-off between precision and bandwidth.
+ * @return The depth only formats, from the most to the least preferred.
+ */
+std::vector<VkFormat> get_depth_format_priority_list(FormatPolicy policy);
+
+/**
+ * @brief Helper function to determine a suitable supported depth format based on a priority list.
+ * @param physical_device The physical device to check the depth formats against.
+ * @param depth_format_priority_list The depth formats from the most to the least preferred.
+ * @return The first format usable as an optimally tiled depth attachment, VK_FORMAT_UNDEFINED if none is.
+ */
+VkFormat get_suitable_depth_format(VkPhysicalDevice physical_device, const std::vector<VkFormat> &depth_format_priority_list);
+
+/**
+ * @brief Helper function to determine if images with a usage can be compressed with AFBC on Mali GPUs.
+ * @param usage Vulkan image usage to check.
+ * @return False if the usage prevents the compression, which storage usage does.
+ */
+bool is_afbc_eligible(VkImageUsageFlags usage);
+
 /**
  * @brief Helper function to determine if a Vulkan descriptor type is a dynamic storage buffer or dynamic uniform buffer.
  * @param descriptor_type Vulkan descriptor type to check.
@@ -97,6 +131,10 @@ struct ImageMemoryBarrier
 	VkImageLayout old_layout{VK_IMAGE_LAYOUT_UNDEFINED};
 
 	VkImageLayout new_layout{VK_IMAGE_LAYOUT_UNDEFINED};
+
+	uint32_t old_queue_family{VK_QUEUE_FAMILY_IGNORED};
+
+	uint32_t new_queue_family{VK_QUEUE_FAMILY_IGNORED};
 };
 
 /**
@@ -112,6 +150,94 @@ struct BufferMemoryBarrier
 	VkAccessFlags src_access_mask{0};
 
 	VkAccessFlags dst_access_mask{0};
+
+	uint32_t old_queue_family{VK_QUEUE_FAMILY_IGNORED};
+
+	uint32_t new_queue_family{VK_QUEUE_FAMILY_IGNORED};
+};
+
+/**
+ * @brief How a command uses a resource, see CommandBuffer::transition
+ */
+enum class ResourceUsage
+{
+	TransferSrc,
+	TransferDst,
+	VertexBuffer,
+	IndexBuffer,
+	IndirectBuffer,
+	UniformBuffer,
+	VertexShaderRead,
+	FragmentShaderRead,
+	ComputeShaderRead,
+	ComputeShaderWrite,
+	ColorAttachment,
+	DepthStencilAttachment,
+	DepthStencilReadOnly,
+	InputAttachment,
+	HostRead,
+	Present
+};
+
+/**
+ * @brief Stages, accesses and image layout of a resource usage
+ */
+struct ResourceAccess
+{
+	VkPipelineStageFlags stage_mask{VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT};
+
+	VkAccessFlags access_mask{0};
+
+	VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+};
+
+/**
+ * @brief State of a buffer or an image subresource, tracked while commands are recorded
+ */
+struct ResourceState
+{
+	VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+
+	/// Stages and accesses of the last write or layout transition
+	VkPipelineStageFlags write_stage_mask{0};
+
+	VkAccessFlags write_access_mask{0};
+
+	/// Stages and accesses of the reads since, which already wait for the write
+	VkPipelineStageFlags read_stage_mask{0};
+
+	VkAccessFlags read_access_mask{0};
+};
+
+/**
+ * @return The stages, accesses and image layout of a resource usage
+ */
+ResourceAccess get_resource_access(ResourceUsage usage);
+
+/**
+ * @brief Computes the minimal barrier before a resource access and updates its state:
+ *        reads wait for the last write unless they already did, while writes and layout
+ *        transitions wait for every access since the last write (no memory barrier is
+ *        needed after reads)
+ * @param state State of the resource, updated with the access
+ * @param access The next access, a buffer access should have an undefined layout
+ * @param barrier Filled with the barrier when one is needed
+ * @return Whether the access needs a barrier
+ */
+bool update_resource_state(ResourceState &state, const ResourceAccess &access, ImageMemoryBarrier &barrier);
+
+/**
+ * @brief Kinds of device memory allocations, counted by the device
+ */
+enum class AllocationCategory
+{
+	Buffer,
+	Image,
+	/// Buffers only used as the source of transfers
+	Staging,
+	/// Buffers of the blocks of the buffer pools
+	PoolBlock,
+	Count
 };
 
 /**
@@ -122,6 +248,10 @@ struct LoadStoreInfo
 	VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_CLEAR;
 
 	VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_STORE;
+
+	/// Layout kept through the render pass by an attachment which none of its subpasses use,
+	/// such as an image sampled during it. Undefined lets the render pass discard the attachment
+	VkImageLayout preserved_layout = VK_IMAGE_LAYOUT_UNDEFINED;
 };
 
 namespace gbuffer
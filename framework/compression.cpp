@@ -0,0 +1,605 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "compression.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+
+#include "common/helpers.h"
+#include "common/utils.h"
+#include "job_system.h"
+
+namespace vkb
+{
+namespace
+{
+const uint32_t BLOB_MAGIC = 0x5a424b56;
+
+/// Set in the size of a chunk of the table when the chunk is stored uncompressed
+const uint32_t STORED_CHUNK_BIT = 0x80000000;
+
+struct BlobHeader
+{
+	uint32_t magic;
+
+	uint32_t codec;
+
+	uint64_t uncompressed_size;
+
+	uint32_t chunk_size;
+
+	/// The table of the compressed sizes of the chunks follows the header
+	uint32_t chunk_count;
+};
+
+const size_t MIN_MATCH = 4;
+
+/// The last bytes of a block are always literals
+const size_t LAST_LITERALS = 5;
+
+/// A match cannot start in the last bytes of a block
+const size_t MATCH_LIMIT = 12;
+
+const size_t MAX_OFFSET = 65535;
+
+const uint32_t HASH_BITS = 16;
+
+inline uint32_t read_u32(const uint8_t *data)
+{
+	uint32_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+inline uint32_t hash_sequence(uint32_t sequence)
+{
+	return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/**
+ * @brief Writes a length which does not fit in the 4 bits of the token as a run of bytes
+ */
+inline uint8_t *write_length(uint8_t *dst, size_t length)
+{
+	while (length >= 255)
+	{
+		*dst++ = 255;
+		length -= 255;
+	}
+
+	*dst++ = static_cast<uint8_t>(length);
+
+	return dst;
+}
+
+inline bool read_length(const uint8_t *&src, const uint8_t *src_end, size_t &length)
+{
+	uint8_t byte;
+
+	do
+	{
+		if (src == src_end)
+		{
+			return false;
+		}
+
+		byte = *src++;
+		length += byte;
+	} while (byte == 255);
+
+	return true;
+}
+
+uint8_t *write_sequence(uint8_t *dst, const uint8_t *literals, size_t literal_length, size_t offset, size_t match_length)
+{
+	uint8_t *token = dst++;
+
+	*token = static_cast<uint8_t>(std::min<size_t>(literal_length, 15) << 4);
+
+	if (literal_length >= 15)
+	{
+		dst = write_length(dst, literal_length - 15);
+	}
+
+	std::memcpy(dst, literals, literal_length);
+	dst += literal_length;
+
+	// The last sequence only has literals
+	if (match_length == 0)
+	{
+		return dst;
+	}
+
+	*dst++ = static_cast<uint8_t>(offset & 0xff);
+	*dst++ = static_cast<uint8_t>(offset >> 8);
+
+	match_length -= MIN_MATCH;
+
+	*token |= static_cast<uint8_t>(std::min<size_t>(match_length, 15));
+
+	if (match_length >= 15)
+	{
+		dst = write_length(dst, match_length - 15);
+	}
+
+	return dst;
+}
+}        // namespace
+
+size_t lz4_compress_bound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t lz4_compress(const uint8_t *src, size_t size, uint8_t *dst)
+{
+	uint8_t *out = dst;
+
+	size_t anchor = 0;
+
+	if (size > MATCH_LIMIT)
+	{
+		// Positions are stored plus one, so that zero is an empty entry
+		std::vector<uint32_t> table(size_t{1} << HASH_BITS, 0);
+
+		size_t match_end_limit = size - LAST_LITERALS;
+
+		size_t pos = 0;
+
+		while (pos < size - MATCH_LIMIT)
+		{
+			uint32_t sequence = read_u32(src + pos);
+			uint32_t &entry   = table[hash_sequence(sequence)];
+
+			size_t candidate = entry;
+			entry            = static_cast<uint32_t>(pos + 1);
+
+			if (candidate == 0 || pos + 1 - candidate > MAX_OFFSET || read_u32(src + candidate - 1) != sequence)
+			{
+				++pos;
+				continue;
+			}
+
+			size_t match = candidate - 1;
+
+			size_t match_length = MIN_MATCH;
+			while (pos + match_length < match_end_limit && src[match + match_length] == src[pos + match_length])
+			{
+				++match_length;
+			}
+
+			out = write_sequence(out, src + anchor, pos - anchor, pos - match, match_length);
+
+			pos += match_length;
+			anchor = pos;
+		}
+	}
+
+	out = write_sequence(out, src + anchor, size - anchor, 0, 0);
+
+	return static_cast<size_t>(out - dst);
+}
+
+bool lz4_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_size)
+{
+	const uint8_t *src_end = src + size;
+
+	size_t out = 0;
+
+	while (src < src_end)
+	{
+		uint8_t token = *src++;
+
+		size_t literal_length = token >> 4;
+		if (literal_length == 15 && !read_length(src, src_end, literal_length))
+		{
+			return false;
+		}
+
+		if (literal_length > static_cast<size_t>(src_end - src) || literal_length > dst_size - out)
+		{
+			return false;
+		}
+
+		std::memcpy(dst + out, src, literal_length);
+		src += literal_length;
+		out += literal_length;
+
+		// The last sequence ends the block after its literals
+		if (src == src_end)
+		{
+			break;
+		}
+
+		if (src_end - src < 2)
+		{
+			return false;
+		}
+
+		size_t offset = src[0] | (src[1] << 8);
+		src += 2;
+
+		if (offset == 0 || offset > out)
+		{
+			return false;
+		}
+
+		size_t match_length = token & 0xf;
+		if (match_length == 15 && !read_length(src, src_end, match_length))
+		{
+			return false;
+		}
+
+		match_length += MIN_MATCH;
+
+		if (match_length > dst_size - out)
+		{
+			return false;
+		}
+
+		// Matches may overlap the bytes they produce, so they are copied forward a byte at a time
+		const uint8_t *match = dst + out - offset;
+		for (size_t i = 0; i < match_length; ++i)
+		{
+			dst[out + i] = match[i];
+		}
+
+		out += match_length;
+	}
+
+	return out == dst_size;
+}
+
+bool is_compressed_blob(const uint8_t *data, size_t size)
+{
+	return size >= sizeof(BlobHeader) && read_u32(data) == BLOB_MAGIC;
+}
+
+namespace
+{
+/**
+ * @brief Header and chunk table of a blob, checked against the size of the blob
+ */
+struct BlobLayout
+{
+	BlobHeader header;
+
+	/// Compressed sizes of the chunks, with STORED_CHUNK_BIT set on the chunks stored as they are
+	std::vector<uint32_t> chunk_sizes;
+
+	/// Offsets of the chunks in the blob
+	std::vector<size_t> chunk_offsets;
+};
+
+/**
+ * @brief Chunks of a blob decompressed together, while the previous ones are consumed
+ */
+struct ChunkWindow
+{
+	uint32_t first{0};
+
+	uint32_t count{0};
+
+	std::vector<uint8_t> data;
+
+	std::atomic<bool> corrupt{false};
+
+	JobSystem::Counter counter;
+};
+
+/**
+ * @brief Reads the header and the chunk table of a blob
+ * @throws runtime_error if the blob is corrupt or uses an unknown codec
+ */
+BlobLayout read_blob_layout(const uint8_t *data, size_t size)
+{
+	if (!is_compressed_blob(data, size))
+	{
+		throw std::runtime_error("Data is not a compressed blob");
+	}
+
+	BlobLayout layout;
+
+	auto &header = layout.header;
+	std::memcpy(&header, data, sizeof(header));
+
+	if (header.codec != static_cast<uint32_t>(CompressionCodec::LZ4))
+	{
+		throw std::runtime_error("Compressed blob uses an unknown codec: " + std::to_string(header.codec));
+	}
+
+	// The header is validated before anything is allocated from it, so that a corrupt blob cannot request huge buffers
+	if (header.chunk_size == 0 || header.chunk_size > COMPRESSION_CHUNK_SIZE)
+	{
+		throw std::runtime_error("Compressed blob has an invalid chunk size: " + std::to_string(header.chunk_size));
+	}
+
+	// Every chunk but the last is full, and the last one is not empty
+	uint64_t chunk_count = header.uncompressed_size / header.chunk_size + (header.uncompressed_size % header.chunk_size != 0);
+
+	if (chunk_count != header.chunk_count || header.uncompressed_size > std::numeric_limits<size_t>::max() ||
+	    (size - sizeof(header)) / sizeof(uint32_t) < header.chunk_count)
+	{
+		throw std::runtime_error("Compressed blob has an invalid header");
+	}
+
+	layout.chunk_sizes.resize(header.chunk_count);
+	for (uint32_t i = 0; i < header.chunk_count; ++i)
+	{
+		layout.chunk_sizes[i] = read_u32(data + sizeof(header) + i * sizeof(uint32_t));
+	}
+
+	// The chunks are decompressed out of order, so their offsets are found first
+	layout.chunk_offsets.resize(header.chunk_count);
+
+	size_t offset = sizeof(header) + layout.chunk_sizes.size() * sizeof(uint32_t);
+
+	for (uint32_t i = 0; i < header.chunk_count; ++i)
+	{
+		size_t chunk_size = layout.chunk_sizes[i] & ~STORED_CHUNK_BIT;
+
+		if (chunk_size > size - offset)
+		{
+			throw std::runtime_error("Compressed blob is truncated");
+		}
+
+		layout.chunk_offsets[i] = offset;
+		offset += chunk_size;
+	}
+
+	return layout;
+}
+
+/**
+ * @return The size of a chunk once decompressed, only the last one may be smaller than the chunk size
+ */
+size_t get_chunk_size(const BlobHeader &header, uint32_t index)
+{
+	return static_cast<size_t>(std::min<uint64_t>(header.chunk_size, header.uncompressed_size - static_cast<uint64_t>(index) * header.chunk_size));
+}
+
+/**
+ * @brief Decompresses a chunk of a blob
+ * @param dst Receives the chunk, of get_chunk_size bytes
+ * @return False if the chunk is corrupt
+ */
+bool decompress_chunk(const uint8_t *data, const BlobLayout &layout, uint32_t index, uint8_t *dst)
+{
+	size_t src_size = layout.chunk_sizes[index] & ~STORED_CHUNK_BIT;
+	size_t dst_size = get_chunk_size(layout.header, index);
+
+	if (layout.chunk_sizes[index] & STORED_CHUNK_BIT)
+	{
+		if (src_size != dst_size)
+		{
+			return false;
+		}
+
+		std::memcpy(dst, data + layout.chunk_offsets[index], src_size);
+
+		return true;
+	}
+
+	return lz4_decompress(data + layout.chunk_offsets[index], src_size, dst, dst_size);
+}
+}        // namespace
+
+std::vector<uint8_t> compress_blob(const uint8_t *data, size_t size, JobSystem *job_system)
+{
+	BlobHeader header{};
+	header.magic             = BLOB_MAGIC;
+	header.codec             = static_cast<uint32_t>(CompressionCodec::LZ4);
+	header.uncompressed_size = size;
+	header.chunk_size        = static_cast<uint32_t>(COMPRESSION_CHUNK_SIZE);
+	header.chunk_count       = to_u32((size + COMPRESSION_CHUNK_SIZE - 1) / COMPRESSION_CHUNK_SIZE);
+
+	std::vector<std::vector<uint8_t>> chunks(header.chunk_count);
+	std::vector<uint32_t>             chunk_sizes(header.chunk_count);
+
+	parallel_for_ranges(job_system, header.chunk_count, 1, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			size_t chunk_offset = i * COMPRESSION_CHUNK_SIZE;
+			size_t chunk_size   = std::min(COMPRESSION_CHUNK_SIZE, size - chunk_offset);
+
+			auto &chunk = chunks[i];
+			chunk.resize(lz4_compress_bound(chunk_size));
+
+			size_t compressed_size = lz4_compress(data + chunk_offset, chunk_size, chunk.data());
+
+			if (compressed_size < chunk_size)
+			{
+				chunk.resize(compressed_size);
+				chunk_sizes[i] = to_u32(compressed_size);
+			}
+			else
+			{
+				chunk.assign(data + chunk_offset, data + chunk_offset + chunk_size);
+				chunk_sizes[i] = to_u32(chunk_size) | STORED_CHUNK_BIT;
+			}
+		}
+	});
+
+	size_t blob_size = sizeof(header) + chunk_sizes.size() * sizeof(uint32_t);
+	for (auto &chunk : chunks)
+	{
+		blob_size += chunk.size();
+	}
+
+	std::vector<uint8_t> blob;
+	blob.reserve(blob_size);
+
+	auto header_data = reinterpret_cast<const uint8_t *>(&header);
+	blob.insert(blob.end(), header_data, header_data + sizeof(header));
+
+	for (auto chunk_size : chunk_sizes)
+	{
+		auto chunk_size_data = reinterpret_cast<const uint8_t *>(&chunk_size);
+		blob.insert(blob.end(), chunk_size_data, chunk_size_data + sizeof(chunk_size));
+	}
+
+	for (auto &chunk : chunks)
+	{
+		blob.insert(blob.end(), chunk.begin(), chunk.end());
+	}
+
+	return blob;
+}
+
+std::vector<uint8_t> decompress_blob(const uint8_t *data, size_t size, JobSystem *job_system)
+{
+	auto layout = read_blob_layout(data, size);
+
+	std::vector<uint8_t> result(static_cast<size_t>(layout.header.uncompressed_size));
+
+	std::atomic<bool> corrupt{false};
+
+	parallel_for_ranges(job_system, layout.header.chunk_count, 1, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			if (!decompress_chunk(data, layout, i, result.data() + static_cast<size_t>(i) * layout.header.chunk_size))
+			{
+				corrupt = true;
+			}
+		}
+	});
+
+	if (corrupt)
+	{
+		throw std::runtime_error("Compressed blob is corrupt");
+	}
+
+	return result;
+}
+
+bool decompress_blob(const uint8_t *data, size_t size, const std::function<bool(const uint8_t *chunk, size_t chunk_size)> &on_chunk, JobSystem *job_system)
+{
+	auto layout = read_blob_layout(data, size);
+
+	uint32_t chunk_count = layout.header.chunk_count;
+
+	// A chunk per thread, so that a window is decompressed in about the time of a chunk
+	uint32_t window_size = job_system ? to_u32(job_system->get_thread_count()) : 1;
+
+	std::array<ChunkWindow, 2> windows;
+
+	auto start_window = [&](ChunkWindow &window, uint32_t first) {
+		window.first   = first;
+		window.count   = std::min(window_size, chunk_count - first);
+		window.corrupt = false;
+		window.data.resize(static_cast<size_t>(window.count) * layout.header.chunk_size);
+
+		for (uint32_t i = 0; i < window.count; ++i)
+		{
+			auto job = [data, &layout, &window, i](size_t) {
+				if (!decompress_chunk(data, layout, window.first + i, window.data.data() + static_cast<size_t>(i) * layout.header.chunk_size))
+				{
+					window.corrupt = true;
+				}
+			};
+
+			if (job_system)
+			{
+				job_system->run(job, &window.counter);
+			}
+			else
+			{
+				job(0);
+			}
+		}
+	};
+
+	if (chunk_count > 0)
+	{
+		start_window(windows[0], 0);
+	}
+
+	for (uint32_t first = 0, current = 0; first < chunk_count; first += window_size, current ^= 1)
+	{
+		auto &window = windows[current];
+		auto &next   = windows[current ^ 1];
+
+		bool has_next = chunk_count - first > window_size;
+
+		if (job_system)
+		{
+			job_system->wait(window.counter);
+
+			// The next chunks are decompressed while the consumer goes through these ones
+			if (has_next)
+			{
+				start_window(next, first + window_size);
+			}
+		}
+
+		std::exception_ptr exception;
+
+		bool stopped = false;
+
+		if (window.corrupt)
+		{
+			exception = std::make_exception_ptr(std::runtime_error("Compressed blob is corrupt"));
+		}
+		else
+		{
+			try
+			{
+				for (uint32_t i = 0; i < window.count && !stopped; ++i)
+				{
+					stopped = !on_chunk(window.data.data() + static_cast<size_t>(i) * layout.header.chunk_size, get_chunk_size(layout.header, window.first + i));
+				}
+			}
+			catch (...)
+			{
+				exception = std::current_exception();
+			}
+		}
+
+		if (exception || stopped)
+		{
+			// The jobs of the next window write to the buffers of this function
+			if (job_system && has_next)
+			{
+				job_system->wait(next.counter);
+			}
+
+			if (exception)
+			{
+				std::rethrow_exception(exception);
+			}
+
+			return false;
+		}
+
+		if (!job_system && has_next)
+		{
+			start_window(next, first + window_size);
+		}
+	}
+
+	return true;
+}
+}        // namespace vkb
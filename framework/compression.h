@@ -0,0 +1,98 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace vkb
+{
+class JobSystem;
+
+/**
+ * @brief Codecs of the compressed blobs, stored in their header
+ */
+enum class CompressionCodec : uint32_t
+{
+	/// LZ4 block format, which favours the decompression speed over the ratio
+	LZ4 = 1
+};
+
+/// Blobs are split in chunks of this size, which are compressed and decompressed independently
+constexpr size_t COMPRESSION_CHUNK_SIZE = 256 * 1024;
+
+/**
+ * @return The largest size of the LZ4 block compressed from size bytes
+ */
+size_t lz4_compress_bound(size_t size);
+
+/**
+ * @brief Compresses data to an LZ4 block
+ * @param src The data to compress
+ * @param size The size of the data
+ * @param dst Receives the block, of at least lz4_compress_bound(size) bytes
+ * @return The size of the block
+ */
+size_t lz4_compress(const uint8_t *src, size_t size, uint8_t *dst);
+
+/**
+ * @brief Decompresses an LZ4 block, every read and write is bounds checked
+ * @param src The block
+ * @param size The size of the block
+ * @param dst Receives the data
+ * @param dst_size The size of the data the block was compressed from
+ * @return False if the block is corrupt or does not decompress to exactly dst_size bytes
+ */
+bool lz4_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_size);
+
+/**
+ * @return Whether the data starts with the header of a blob written by compress_blob
+ */
+bool is_compressed_blob(const uint8_t *data, size_t size);
+
+/**
+ * @brief Compresses data to a blob, the chunks which do not compress are stored as they are
+ * @param job_system Job system to compress the chunks on, if null they are compressed on the calling thread
+ * @return The header, the table of the chunk sizes and the chunks
+ */
+std::vector<uint8_t> compress_blob(const uint8_t *data, size_t size, JobSystem *job_system = nullptr);
+
+/**
+ * @brief Decompresses a blob written by compress_blob
+ * @param job_system Job system to decompress the chunks on, if null they are decompressed on the calling thread
+ * @throws runtime_error if the blob is corrupt or uses an unknown codec
+ * @return The data the blob was compressed from
+ */
+std::vector<uint8_t> decompress_blob(const uint8_t *data, size_t size, JobSystem *job_system = nullptr);
+
+/**
+ * @brief Decompresses a blob written by compress_blob chunk by chunk, in order, so that the data is consumed
+ *        as it is decompressed and without holding all of it. The chunks are decompressed on the job system a
+ *        window ahead of the one consumed, or one at a time on the calling thread without a job system
+ * @param on_chunk Called with each chunk of the data in order, the chunk is only valid during the call.
+ *        Returning false stops the decompression
+ * @throws runtime_error if the blob is corrupt or uses an unknown codec
+ * @return False if on_chunk stopped the decompression
+ */
+bool decompress_blob(const uint8_t *data, size_t size, const std::function<bool(const uint8_t *chunk, size_t chunk_size)> &on_chunk, JobSystem *job_system = nullptr);
+}        // namespace vkb
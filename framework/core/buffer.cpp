@@ -20,15 +20,29 @@
 
 #include "buffer.h"
 
+#include <set>
+#include <utility>
+
 #include "device.h"
 
 namespace vkb
 {
 namespace core
 {
-Buffer::Buffer(Device &device, VkDeviceSize size, VkBufferUsageFlags buffer_usage, VmaMemoryUsage memory_usage, VmaAllocationCreateFlags flags) :
+Buffer::Buffer(Device &device, VkDeviceSize size, VkBufferUsageFlags buffer_usage, VmaMemoryUsage memory_usage, VmaAllocationCreateFlags flags,
+               const std::vector<uint32_t> &queue_family_indices) :
+    Buffer{device, size, buffer_usage, memory_usage,
+           buffer_usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT ? AllocationCategory::Staging : AllocationCategory::Buffer,
+           flags, queue_family_indices}
+{
+}
+
+Buffer::Buffer(Device &device, VkDeviceSize size, VkBufferUsageFlags buffer_usage, VmaMemoryUsage memory_usage, AllocationCategory allocation_category,
+               VmaAllocationCreateFlags flags, const std::vector<uint32_t> &queue_family_indices) :
     device{device},
-    size{size}
+    size{size},
+    usage{buffer_usage},
+    allocation_category{allocation_category}
 {
 	assert(((flags & VMA_ALLOCATION_CREATE_MAPPED_BIT) == 0) && "Buffer memory should be mapped explicitly outside the constructor");
 
@@ -36,20 +50,52 @@ Buffer::Buffer(Device &device, VkDeviceSize size, VkBufferUsageFlags buffer_usag
 	buffer_info.usage = buffer_usage;
 	buffer_info.size  = size;
 
+	// Concurrent sharing avoids ownership transfers between the queue families
+	std::set<uint32_t> families{queue_family_indices.begin(), queue_family_indices.end()};
+	std::vector<uint32_t> unique_families{families.begin(), families.end()};
+
+	if (unique_families.size() > 1)
+	{
+		queue_families = std::move(unique_families);
+
+		buffer_info.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+		buffer_info.queueFamilyIndexCount = to_u32(queue_families.size());
+		buffer_info.pQueueFamilyIndices   = queue_families.data();
+	}
+
 	VmaAllocationCreateInfo memory_info{};
 	memory_info.flags = flags;
 	memory_info.usage = memory_usage;
 
+	if (allocation_category == AllocationCategory::Staging)
+	{
+		device.get_memory_pools().select_pool(MemoryPoolClass::Staging, buffer_info, memory_info);
+	}
+	else if (allocation_category == AllocationCategory::PoolBlock)
+	{
+		device.get_memory_pools().select_pool(MemoryPoolClass::FrameRing, buffer_info, memory_info);
+	}
+
 	VmaAllocationInfo alloc_info{};
 	auto              result = vmaCreateBuffer(device.get_memory_allocator(),
                                   &buffer_info, &memory_info,
                                   &handle, &memory,
                                   &alloc_info);
 
+	// A full pool falls back to the default allocator
+	if (result != VK_SUCCESS && memory_info.pool != VK_NULL_HANDLE)
+	{
+		memory_info.pool = VK_NULL_HANDLE;
+
+		result = vmaCreateBuffer(device.get_memory_allocator(), &buffer_info, &memory_info, &handle, &memory, &alloc_info);
+	}
+
 	if (result != VK_SUCCESS)
 	{
 		throw VulkanException{result, "Cannot create Buffer"};
 	}
+
+	device.add_allocation(allocation_category);
 }
 
 Buffer::Buffer(Buffer &&other) :
@@ -57,6 +103,10 @@ Buffer::Buffer(Buffer &&other) :
     handle{other.handle},
     memory{other.memory},
     size{other.size},
+    usage{other.usage},
+    queue_families{std::move(other.queue_families)},
+    allocation_category{other.allocation_category},
+    state{other.state},
     mapped_data{other.mapped_data},
     mapped{other.mapped}
 {
@@ -73,6 +123,8 @@ Buffer::~Buffer()
 	{
 		unmap();
 		vmaDestroyBuffer(device.get_memory_allocator(), handle, memory);
+
+		device.remove_allocation(allocation_category);
 	}
 }
 
@@ -91,11 +143,65 @@ VmaAllocation Buffer::get_memory() const
 	return memory;
 }
 
+void Buffer::set_allocation_category(AllocationCategory category)
+{
+	device.remove_allocation(allocation_category);
+	device.add_allocation(category);
+
+	allocation_category = category;
+}
+
+VkBuffer Buffer::rebind_memory()
+{
+	VkBufferCreateInfo buffer_info{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+	buffer_info.usage = usage;
+	buffer_info.size  = size;
+
+	if (!queue_families.empty())
+	{
+		buffer_info.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+		buffer_info.queueFamilyIndexCount = to_u32(queue_families.size());
+		buffer_info.pQueueFamilyIndices   = queue_families.data();
+	}
+
+	VkBuffer new_handle{VK_NULL_HANDLE};
+
+	auto result = vkCreateBuffer(device.get_handle(), &buffer_info, nullptr, &new_handle);
+
+	if (result != VK_SUCCESS)
+	{
+		throw VulkanException{result, "Cannot recreate Buffer"};
+	}
+
+	result = vmaBindBufferMemory(device.get_memory_allocator(), memory, new_handle);
+
+	if (result != VK_SUCCESS)
+	{
+		vkDestroyBuffer(device.get_handle(), new_handle, nullptr);
+
+		throw VulkanException{result, "Cannot bind the memory of Buffer"};
+	}
+
+	std::swap(handle, new_handle);
+
+	return new_handle;
+}
+
+void Buffer::set_debug_name(const std::string &name)
+{
+	device.set_debug_name(VK_OBJECT_TYPE_BUFFER, (uint64_t) handle, name);
+}
+
 VkDeviceSize Buffer::get_size() const
 {
 	return size;
 }
 
+ResourceState &Buffer::get_state()
+{
+	return state;
+}
+
 uint8_t *Buffer::map()
 {
 	if (!mapped_data)
@@ -121,6 +227,11 @@ void Buffer::flush()
 	vmaFlushAllocation(device.get_memory_allocator(), memory, 0, size);
 }
 
+void Buffer::invalidate()
+{
+	vmaInvalidateAllocation(device.get_memory_allocator(), memory, 0, size);
+}
+
 void Buffer::update(const std::vector<uint8_t> &data, size_t offset)
 {
 	update(data.data(), data.size(), offset);
@@ -131,7 +242,11 @@ void Buffer::update(const uint8_t *src, const size_t size, const size_t offset)
 	map();
 	std::copy(src, src + size, mapped_data + offset);
 	flush();
+
+	// Elsewhere the buffer stays mapped, so that frequent updates do not map it again every time
+#if defined(__APPLE__)
 	unmap();        // Workaround for Mac MoltenVK requiring unmapping (https://github.com/KhronosGroup/MoltenVK/issues/175)
+#endif
 }
 
 }        // namespace core
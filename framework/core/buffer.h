@@ -32,7 +32,19 @@ namespace core
 class Buffer
 {
   public:
-	Buffer(Device &device, VkDeviceSize size, VkBufferUsageFlags buffer_usage, VmaMemoryUsage memory_usage, VmaAllocationCreateFlags flags = 0);
+	/**
+	 * @brief Creates a buffer
+	 * @param queue_family_indices Families of the queues using the buffer, it is shared concurrently if they differ
+	 */
+	Buffer(Device &device, VkDeviceSize size, VkBufferUsageFlags buffer_usage, VmaMemoryUsage memory_usage, VmaAllocationCreateFlags flags = 0,
+	       const std::vector<uint32_t> &queue_family_indices = {});
+
+	/**
+	 * @brief Creates a buffer of an allocation category, staging buffers and pool blocks are allocated
+	 *        from the memory pools of their class
+	 */
+	Buffer(Device &device, VkDeviceSize size, VkBufferUsageFlags buffer_usage, VmaMemoryUsage memory_usage, AllocationCategory allocation_category,
+	       VmaAllocationCreateFlags flags = 0, const std::vector<uint32_t> &queue_family_indices = {});
 
 	Buffer(const Buffer &) = delete;
 
@@ -50,6 +62,22 @@ class Buffer
 
 	VmaAllocation get_memory() const;
 
+	/**
+	 * @brief Changes the category the allocation of the buffer is counted in by the device
+	 */
+	void set_allocation_category(AllocationCategory category);
+
+	/**
+	 * @brief Recreates the buffer handle bound to its allocation, after a defragmentation moved the allocation
+	 * @return The previous handle, to be destroyed by the caller once the frames which may use it have completed
+	 */
+	VkBuffer rebind_memory();
+
+	/**
+	 * @brief Names the buffer for debuggers and profilers, if the device uses debug utils
+	 */
+	void set_debug_name(const std::string &name);
+
 	/**
 	 * @brief Maps vulkan memory to an host visible address
 	 * @return Pointer to host visible memory
@@ -66,13 +94,23 @@ class Buffer
 	 */
 	void flush();
 
+	/**
+	 * @brief Invalidates memory if it is HOST_VISIBLE and not HOST_COHERENT, before the host reads data written by the device
+	 */
+	void invalidate();
+
 	/**
 	 * @return The size of the buffer
 	 */
 	VkDeviceSize get_size() const;
 
 	/**
-	 * @brief Updates the content of the buffer
+	 * @return The state of the buffer tracked by CommandBuffer::transition, in recording order
+	 */
+	ResourceState &get_state();
+
+	/**
+	 * @brief Updates the content of the buffer, which is left mapped (except on macOS)
 	 * @param offset Offset from which to start uploading
 	 * @param data Data to upload
 	 */
@@ -100,6 +138,15 @@ class Buffer
 
 	VkDeviceSize size{0};
 
+	VkBufferUsageFlags usage{0};
+
+	/// Families the buffer is shared by concurrently, empty if exclusive
+	std::vector<uint32_t> queue_families;
+
+	AllocationCategory allocation_category{AllocationCategory::Buffer};
+
+	ResourceState state;
+
 	uint8_t *mapped_data{nullptr};
 
 	/// Whether it has been mapped with vmaMapMemory
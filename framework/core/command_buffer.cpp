@@ -22,6 +22,7 @@
 
 #include "command_pool.h"
 #include "common/error.h"
+#include "cpu_profiler.h"
 #include "device.h"
 #include "rendering/render_frame.h"
 #include "rendering/shader_program.h"
@@ -83,10 +84,28 @@ bool CommandBuffer::is_recording() const
 
 void CommandBuffer::clear(VkClearAttachment attachment, VkClearRect rect)
 {
+	// Clearing part of the attachments is fine, clearing them all should be done by the load operation
+	if (!subpass_drawn && rect.rect.extent.width >= render_area.width && rect.rect.extent.height >= render_area.height)
+	{
+		get_device().get_perf_lint().report(PerfIssue::ClearAtSubpassStart, get_lint_tag());
+	}
+
 	vkCmdClearAttachments(handle, 1, &attachment, 1, &rect);
 }
 
 VkResult CommandBuffer::begin(VkCommandBufferUsageFlags flags, CommandBuffer *primary_cmd_buf)
+{
+	return begin_recording(flags, primary_cmd_buf, primary_cmd_buf ? primary_cmd_buf->get_current_subpass_index() : 0);
+}
+
+VkResult CommandBuffer::begin(VkCommandBufferUsageFlags flags, CommandBuffer &primary_cmd_buf, uint32_t subpass_index)
+{
+	assert(level == VK_COMMAND_BUFFER_LEVEL_SECONDARY && "Only secondary command buffers inherit a subpass");
+
+	return begin_recording(flags, &primary_cmd_buf, subpass_index);
+}
+
+VkResult CommandBuffer::begin_recording(VkCommandBufferUsageFlags flags, CommandBuffer *primary_cmd_buf, uint32_t subpass_index)
 {
 	assert(!is_recording() && "Command buffer is already recording, please call end before beginning again");
 
@@ -97,16 +116,34 @@ VkResult CommandBuffer::begin(VkCommandBufferUsageFlags flags, CommandBuffer *pr
 
 	state = State::Recording;
 
+	usage_flags = flags;
+	profiled    = true;
+
 	// Reset state
 	pipeline_state.reset();
+	pipeline_state.set_extended_dynamic_state(get_device().uses_extended_dynamic_state());
 	resource_binding_state.reset();
 	descriptor_set_layout_binding_state.clear();
+	frame_descriptor_set_count = 0;
+	dynamic_state_valid        = false;
 	stored_push_constants.clear();
+	bind_stats = {};
+	reset_bound_state();
+	viewports.clear();
+	scissors.clear();
+	lint_labels.clear();
+	lint_preserved_images.clear();
+	subpass_drawn = false;
 
 	VkCommandBufferBeginInfo       begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
 	VkCommandBufferInheritanceInfo inheritance = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
 	begin_info.flags                           = flags;
 
+#if defined(VK_KHR_dynamic_rendering)
+	VkCommandBufferInheritanceRenderingInfoKHR rendering_inheritance{VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR};
+	std::vector<VkFormat>                      rendering_formats;
+#endif
+
 	if (level == VK_COMMAND_BUFFER_LEVEL_SECONDARY)
 	{
 		assert(primary_cmd_buf && "A primary command buffer pointer must be provided when calling begin from a secondary one");
@@ -115,14 +152,79 @@ VkResult CommandBuffer::begin(VkCommandBufferUsageFlags flags, CommandBuffer *pr
 		current_render_pass.render_pass = render_pass_binding.render_pass;
 		current_render_pass.framebuffer = render_pass_binding.framebuffer;
 
-		inheritance.renderPass  = current_render_pass.render_pass->get_handle();
-		inheritance.framebuffer = current_render_pass.framebuffer->get_handle();
-		inheritance.subpass     = primary_cmd_buf->get_current_subpass_index();
+		inheritance.subpass = subpass_index;
 
 		begin_info.pInheritanceInfo = &inheritance;
+
+#if defined(VK_KHR_dynamic_rendering)
+		if (current_render_pass.render_pass->is_dynamic())
+		{
+			// Dynamic render passes are inherited from their formats, the flags of the primary are left out
+			rendering_formats = current_render_pass.render_pass->get_color_formats(inheritance.subpass);
+
+			rendering_inheritance.viewMask                = current_render_pass.render_pass->get_view_mask(inheritance.subpass);
+			rendering_inheritance.colorAttachmentCount    = to_u32(rendering_formats.size());
+			rendering_inheritance.pColorAttachmentFormats = rendering_formats.data();
+			rendering_inheritance.rasterizationSamples    = current_render_pass.render_pass->get_sample_count(inheritance.subpass);
+
+			auto depth_stencil_format = current_render_pass.render_pass->get_depth_stencil_format(inheritance.subpass);
+
+			if (depth_stencil_format != VK_FORMAT_S8_UINT)
+			{
+				rendering_inheritance.depthAttachmentFormat = depth_stencil_format;
+			}
+			if (depth_stencil_format != VK_FORMAT_UNDEFINED && !is_depth_only_format(depth_stencil_format))
+			{
+				rendering_inheritance.stencilAttachmentFormat = depth_stencil_format;
+			}
+
+			inheritance.pNext = &rendering_inheritance;
+		}
+		else
+#endif
+		{
+			inheritance.renderPass  = current_render_pass.render_pass->get_handle();
+			inheritance.framebuffer = current_render_pass.framebuffer->get_handle();
+		}
+
+		// Other secondary command buffers may have drawn in the subpass already
+		render_area   = primary_cmd_buf->render_area;
+		subpass_drawn = true;
+
+		if (get_device().get_perf_lint().is_enabled())
+		{
+			lint_labels.push_back(primary_cmd_buf->get_lint_tag());
+		}
+
+		// Record the draws for the subpass of the primary command buffer
+		pipeline_state.set_subpass_index(inheritance.subpass);
+
+		auto blend_state = pipeline_state.get_color_blend_state();
+		blend_state.attachments.resize(current_render_pass.render_pass->get_color_output_count(inheritance.subpass));
+		pipeline_state.set_color_blend_state(blend_state);
+
+		auto multisample_state                  = pipeline_state.get_multisample_state();
+		multisample_state.rasterization_samples = current_render_pass.render_pass->get_sample_count(inheritance.subpass);
+		pipeline_state.set_multisample_state(multisample_state);
+	}
+
+	VkResult result = vkBeginCommandBuffer(get_handle(), &begin_info);
+
+	// Dynamic state is not inherited by secondary command buffers
+	if (result == VK_SUCCESS && level == VK_COMMAND_BUFFER_LEVEL_SECONDARY)
+	{
+		if (!primary_cmd_buf->viewports.empty())
+		{
+			set_viewport(0, primary_cmd_buf->viewports);
+		}
+
+		if (!primary_cmd_buf->scissors.empty())
+		{
+			set_scissor(0, primary_cmd_buf->scissors);
+		}
 	}
 
-	return vkBeginCommandBuffer(get_handle(), &begin_info);
+	return result;
 }
 
 VkResult CommandBuffer::end()
@@ -134,6 +236,8 @@ VkResult CommandBuffer::end()
 		return VK_NOT_READY;
 	}
 
+	flush_barriers();
+
 	vkEndCommandBuffer(get_handle());
 
 	state = State::Executable;
@@ -141,6 +245,48 @@ VkResult CommandBuffer::end()
 	return VK_SUCCESS;
 }
 
+CommandBuffer &CommandBuffer::split()
+{
+	assert(level == VK_COMMAND_BUFFER_LEVEL_PRIMARY && is_recording() && "Only a primary command buffer being recorded can be split");
+
+	flush_barriers();
+
+	auto &head = command_pool.request_command_buffer(level);
+
+	// The command buffer of the pool takes the commands recorded so far, and this one a command buffer ready to begin
+	std::swap(handle, head.handle);
+
+	vkEndCommandBuffer(head.handle);
+
+	head.state = State::Executable;
+
+	VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+	begin_info.flags = usage_flags;
+
+	vkBeginCommandBuffer(handle, &begin_info);
+
+	// The state bound in the other command buffer is not inherited
+	pipeline_state.reset();
+	pipeline_state.set_extended_dynamic_state(get_device().uses_extended_dynamic_state());
+	resource_binding_state.reset();
+	descriptor_set_layout_binding_state.clear();
+	stored_push_constants.clear();
+	dynamic_state_valid = false;
+	reset_bound_state();
+
+	if (!viewports.empty())
+	{
+		vkCmdSetViewport(handle, 0, to_u32(viewports.size()), viewports.data());
+	}
+
+	if (!scissors.empty())
+	{
+		vkCmdSetScissor(handle, 0, to_u32(scissors.size()), scissors.data());
+	}
+
+	return head;
+}
+
 void CommandBuffer::begin_render_pass(const RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store_infos, const std::vector<VkClearValue> &clear_values, const std::vector<std::unique_ptr<Subpass>> &subpasses, VkSubpassContents contents)
 {
 	// Reset state
@@ -148,37 +294,96 @@ void CommandBuffer::begin_render_pass(const RenderTarget &render_target, const s
 	resource_binding_state.reset();
 	descriptor_set_layout_binding_state.clear();
 
+	// Barriers cannot be recorded in the render pass without a self-dependency
+	flush_barriers();
+
+	// Render passes are profiled, the timestamp is written outside of the render pass
+	begin_gpu_scope("Render pass");
+
+	// Performance counters are queried around whole render passes
+	auto render_frame = command_pool.get_render_frame();
+
+	if (render_frame && profiled)
+	{
+		render_frame->get_performance_queries().begin_render_pass(*this, command_pool.get_queue_family_index());
+
+		render_frame->get_bandwidth_estimator().add_render_pass(render_target, load_store_infos, subpasses.empty() ? "" : subpasses[0]->get_debug_name());
+	}
+
+	begin_debug_label("Render pass");
+
 	// Create render pass
 	assert(subpasses.size() > 0 && "Cannot create a render pass without any subpass");
 	std::vector<SubpassInfo> subpass_infos(subpasses.size());
 	auto                     subpass_info_it = subpass_infos.begin();
 	for (auto &subpass : subpasses)
 	{
-		subpass_info_it->input_attachments  = subpass->get_input_attachments();
-		subpass_info_it->output_attachments = subpass->get_output_attachments();
+		subpass_info_it->input_attachments          = subpass->get_input_attachments();
+		subpass_info_it->output_attachments         = subpass->get_output_attachments();
+		subpass_info_it->color_resolve_attachments  = subpass->get_color_resolve_attachments();
+		subpass_info_it->rasterization_order_access = subpass->uses_rasterization_order_access();
+		subpass_info_it->shading_rate_attachment    = subpass->get_shading_rate_attachment();
+		subpass_info_it->shading_rate_texel_size    = subpass->get_shading_rate_texel_size();
+		subpass_info_it->view_mask                  = subpass->get_view_mask();
 
 		++subpass_info_it;
 	}
 	current_render_pass.render_pass = &get_device().get_resource_cache().request_render_pass(render_target.get_attachments(), load_store_infos, subpass_infos);
-	current_render_pass.framebuffer = &get_device().get_resource_cache().request_framebuffer(render_target, *current_render_pass.render_pass);
+	current_render_pass.framebuffer = nullptr;
+
+	if (get_device().get_perf_lint().is_enabled())
+	{
+		lint_render_pass(render_target, load_store_infos);
+	}
+
+	render_area   = render_target.get_render_extent();
+	subpass_drawn = false;
+
+#if defined(VK_KHR_dynamic_rendering)
+	if (current_render_pass.render_pass->is_dynamic())
+	{
+		begin_rendering(render_target, load_store_infos, clear_values, contents);
+	}
+	else
+#endif
+	{
+		current_render_pass.framebuffer = &get_device().get_resource_cache().request_framebuffer(render_target, *current_render_pass.render_pass);
+
+		// Begin render pass
+		VkRenderPassBeginInfo begin_info{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+		begin_info.renderPass        = current_render_pass.render_pass->get_handle();
+		begin_info.framebuffer       = current_render_pass.framebuffer->get_handle();
+		begin_info.renderArea.extent = render_target.get_render_extent();
+		begin_info.clearValueCount   = to_u32(clear_values.size());
+		begin_info.pClearValues      = clear_values.data();
+
+		VkRenderPassAttachmentBeginInfoKHR attachment_begin_info{VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO_KHR};
+
+		if (current_render_pass.framebuffer->is_imageless())
+		{
+			auto &view_handles = render_target.get_view_handles();
+
+			attachment_begin_info.attachmentCount = to_u32(view_handles.size());
+			attachment_begin_info.pAttachments    = view_handles.data();
 
-	// Begin render pass
-	VkRenderPassBeginInfo begin_info{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
-	begin_info.renderPass        = current_render_pass.render_pass->get_handle();
-	begin_info.framebuffer       = current_render_pass.framebuffer->get_handle();
-	begin_info.renderArea.extent = render_target.get_extent();
-	begin_info.clearValueCount   = to_u32(clear_values.size());
-	begin_info.pClearValues      = clear_values.data();
+			begin_info.pNext = &attachment_begin_info;
+		}
 
-	vkCmdBeginRenderPass(get_handle(), &begin_info, contents);
+		vkCmdBeginRenderPass(get_handle(), &begin_info, contents);
+	}
 
 	// Update blend state attachments for first subpass
 	auto blend_state = pipeline_state.get_color_blend_state();
 	blend_state.attachments.resize(current_render_pass.render_pass->get_color_output_count(pipeline_state.get_subpass_index()));
 	pipeline_state.set_color_blend_state(blend_state);
+
+	// Pipelines rasterize with the sample count of the attachments
+	auto multisample_state                  = pipeline_state.get_multisample_state();
+	multisample_state.rasterization_samples = current_render_pass.render_pass->get_sample_count(pipeline_state.get_subpass_index());
+	pipeline_state.set_multisample_state(multisample_state);
 }
 
-void CommandBuffer::next_subpass()
+void CommandBuffer::next_subpass(VkSubpassContents contents)
 {
 	// Increment subpass index
 	pipeline_state.set_subpass_index(pipeline_state.get_subpass_index() + 1);
@@ -188,6 +393,10 @@ void CommandBuffer::next_subpass()
 	blend_state.attachments.resize(current_render_pass.render_pass->get_color_output_count(pipeline_state.get_subpass_index()));
 	pipeline_state.set_color_blend_state(blend_state);
 
+	auto multisample_state                  = pipeline_state.get_multisample_state();
+	multisample_state.rasterization_samples = current_render_pass.render_pass->get_sample_count(pipeline_state.get_subpass_index());
+	pipeline_state.set_multisample_state(multisample_state);
+
 	// Reset descriptor sets
 	resource_binding_state.reset();
 	descriptor_set_layout_binding_state.clear();
@@ -195,25 +404,68 @@ void CommandBuffer::next_subpass()
 	// Clear stored push constants
 	stored_push_constants.clear();
 
-	vkCmdNextSubpass(get_handle(), VK_SUBPASS_CONTENTS_INLINE);
+	subpass_drawn = false;
+
+	vkCmdNextSubpass(get_handle(), contents);
 }
 
 void CommandBuffer::execute_commands(CommandBuffer &secondary_command_buffer)
 {
 	vkCmdExecuteCommands(get_handle(), 1, &secondary_command_buffer.get_handle());
+
+	bind_stats += secondary_command_buffer.get_bind_stats();
+
+	subpass_drawn = true;
+
+	// The bound state is undefined after executing secondary command buffers
+	reset_bound_state();
 }
 
 void CommandBuffer::execute_commands(std::vector<CommandBuffer *> &secondary_command_buffers)
 {
-	std::vector<VkCommandBuffer> sec_cmd_buf_handles(secondary_command_buffers.size(), VK_NULL_HANDLE);
-	std::transform(secondary_command_buffers.begin(), secondary_command_buffers.end(), sec_cmd_buf_handles.begin(),
+	execute_commands(secondary_command_buffers.data(), secondary_command_buffers.size());
+}
+
+void CommandBuffer::execute_commands(CommandBuffer *const *secondary_command_buffers, size_t count)
+{
+	FrameVector<VkCommandBuffer> sec_cmd_buf_handles(count, VK_NULL_HANDLE, get_frame_arena());
+	std::transform(secondary_command_buffers, secondary_command_buffers + count, sec_cmd_buf_handles.begin(),
 	               [](const vkb::CommandBuffer *sec_cmd_buf) { return sec_cmd_buf->get_handle(); });
 	vkCmdExecuteCommands(get_handle(), to_u32(sec_cmd_buf_handles.size()), sec_cmd_buf_handles.data());
+
+	for (size_t i = 0; i < count; i++)
+	{
+		bind_stats += secondary_command_buffers[i]->get_bind_stats();
+	}
+
+	subpass_drawn = true;
+
+	reset_bound_state();
 }
 
 void CommandBuffer::end_render_pass()
 {
-	vkCmdEndRenderPass(get_handle());
+#if defined(VK_KHR_dynamic_rendering)
+	if (current_render_pass.render_pass->is_dynamic())
+	{
+		vkCmdEndRenderingKHR(get_handle());
+	}
+	else
+#endif
+	{
+		vkCmdEndRenderPass(get_handle());
+	}
+
+	end_debug_label();
+
+	auto render_frame = command_pool.get_render_frame();
+
+	if (render_frame && profiled)
+	{
+		render_frame->get_performance_queries().end_render_pass(*this);
+	}
+
+	end_gpu_scope();
 }
 
 void CommandBuffer::bind_pipeline_layout(PipelineLayout &pipeline_layout)
@@ -223,7 +475,12 @@ void CommandBuffer::bind_pipeline_layout(PipelineLayout &pipeline_layout)
 
 void CommandBuffer::set_specialization_constant(uint32_t constant_id, const std::vector<uint8_t> &data)
 {
-	pipeline_state.set_specialization_constant(constant_id, data);
+	set_specialization_constant(constant_id, data.data(), data.size());
+}
+
+void CommandBuffer::set_specialization_constant(uint32_t constant_id, const uint8_t *data, size_t size)
+{
+	pipeline_state.set_specialization_constant(constant_id, data, size);
 }
 
 void CommandBuffer::set_push_constants(const std::vector<uint8_t> &values)
@@ -233,28 +490,41 @@ void CommandBuffer::set_push_constants(const std::vector<uint8_t> &values)
 
 void CommandBuffer::push_constants_accumulated(const std::vector<uint8_t> &values, uint32_t offset)
 {
-	auto accumulated_values = stored_push_constants;
-	accumulated_values.insert(accumulated_values.end(), values.begin(), values.end());
+	push_constants_accumulated(values.data(), values.size(), offset);
+}
+
+void CommandBuffer::push_constants_accumulated(const uint8_t *data, size_t size, uint32_t offset)
+{
+	if (stored_push_constants.empty())
+	{
+		push_constants(offset, data, size);
+		return;
+	}
 
-	push_constants(offset, accumulated_values);
+	accumulated_push_constants.assign(stored_push_constants.begin(), stored_push_constants.end());
+	accumulated_push_constants.insert(accumulated_push_constants.end(), data, data + size);
+
+	push_constants(offset, accumulated_push_constants.data(), accumulated_push_constants.size());
 }
 
 void CommandBuffer::push_constants(uint32_t offset, const std::vector<uint8_t> &values)
 {
-	auto accumulated_values = stored_push_constants;
-	accumulated_values.insert(accumulated_values.end(), values.begin(), values.end());
+	push_constants(offset, values.data(), values.size());
+}
 
+void CommandBuffer::push_constants(uint32_t offset, const uint8_t *data, size_t size)
+{
 	const PipelineLayout &pipeline_layout = pipeline_state.get_pipeline_layout();
 
-	VkShaderStageFlags shader_stage = pipeline_layout.get_push_constant_range_stage(offset, to_u32(values.size()));
+	VkShaderStageFlags shader_stage = pipeline_layout.get_push_constant_range_stage(offset, to_u32(size));
 
 	if (shader_stage)
 	{
-		vkCmdPushConstants(get_handle(), pipeline_layout.get_handle(), shader_stage, offset, to_u32(values.size()), values.data());
+		vkCmdPushConstants(get_handle(), pipeline_layout.get_handle(), shader_stage, offset, to_u32(size), data);
 	}
 	else
 	{
-		LOGW("Push constant range [{}, {}] not found", offset, values.size());
+		LOGW("Push constant range [{}, {}] not found", offset, size);
 	}
 }
 
@@ -273,17 +543,204 @@ void CommandBuffer::bind_input(const core::ImageView &image_view, uint32_t set,
 	resource_binding_state.bind_input(image_view, set, binding, array_element);
 }
 
+bool CommandBuffer::bind_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize range, const std::string &name, uint32_t array_element)
+{
+	auto resource_binding = pipeline_state.get_pipeline_layout().find_binding(name);
+
+	if (resource_binding)
+	{
+		resource_binding_state.bind_buffer(buffer, offset, range, resource_binding->set, resource_binding->binding, array_element);
+	}
+
+	return resource_binding != nullptr;
+}
+
+bool CommandBuffer::bind_image(const core::ImageView &image_view, const core::Sampler &sampler, const std::string &name, uint32_t array_element)
+{
+	auto resource_binding = pipeline_state.get_pipeline_layout().find_binding(name);
+
+	if (resource_binding)
+	{
+		resource_binding_state.bind_image(image_view, sampler, resource_binding->set, resource_binding->binding, array_element);
+	}
+
+	return resource_binding != nullptr;
+}
+
+void CommandBuffer::bind_descriptor_set(const DescriptorSet &descriptor_set, uint32_t set, VkPipelineBindPoint pipeline_bind_point)
+{
+	bind_descriptor_set_handle(pipeline_bind_point, pipeline_state.get_pipeline_layout(), set, descriptor_set.get_handle(), nullptr, 0);
+}
+
 void CommandBuffer::bind_vertex_buffers(uint32_t first_binding, const std::vector<std::reference_wrapper<const vkb::core::Buffer>> &buffers, const std::vector<VkDeviceSize> &offsets)
 {
-	std::vector<VkBuffer> buffer_handles(buffers.size(), VK_NULL_HANDLE);
+	bool already_bound = true;
+
+	for (size_t i = 0; i < buffers.size() && already_bound; i++)
+	{
+		auto bound_it = bound_vertex_buffers.find(first_binding + to_u32(i));
+
+		already_bound = bound_it != bound_vertex_buffers.end() &&
+		                bound_it->second.first == buffers[i].get().get_handle() &&
+		                bound_it->second.second == offsets[i];
+	}
+
+	if (already_bound)
+	{
+		bind_stats.vertex_buffer_binds_skipped++;
+		return;
+	}
+
+	bind_stats.vertex_buffer_binds++;
+
+	FrameVector<VkBuffer> buffer_handles(buffers.size(), VK_NULL_HANDLE, get_frame_arena());
 	std::transform(buffers.begin(), buffers.end(), buffer_handles.begin(),
 	               [](const core::Buffer &buffer) { return buffer.get_handle(); });
 	vkCmdBindVertexBuffers(get_handle(), first_binding, to_u32(buffer_handles.size()), buffer_handles.data(), offsets.data());
+
+	for (size_t i = 0; i < buffers.size(); i++)
+	{
+		bound_vertex_buffers[first_binding + to_u32(i)] = std::make_pair(buffer_handles[i], offsets[i]);
+	}
+}
+
+void CommandBuffer::bind_vertex_buffer(uint32_t binding, const core::Buffer &buffer, VkDeviceSize offset)
+{
+	VkBuffer buffer_handle = buffer.get_handle();
+
+	auto bound_it = bound_vertex_buffers.find(binding);
+
+	if (bound_it != bound_vertex_buffers.end() && bound_it->second.first == buffer_handle && bound_it->second.second == offset)
+	{
+		bind_stats.vertex_buffer_binds_skipped++;
+		return;
+	}
+
+	bind_stats.vertex_buffer_binds++;
+
+	vkCmdBindVertexBuffers(get_handle(), binding, 1, &buffer_handle, &offset);
+
+	bound_vertex_buffers[binding] = std::make_pair(buffer_handle, offset);
 }
 
 void CommandBuffer::bind_index_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkIndexType index_type)
 {
+	if (bound_index_buffer == buffer.get_handle() && bound_index_offset == offset && bound_index_type == index_type)
+	{
+		bind_stats.index_buffer_binds_skipped++;
+		return;
+	}
+
+	bind_stats.index_buffer_binds++;
+
 	vkCmdBindIndexBuffer(get_handle(), buffer.get_handle(), offset, index_type);
+
+	bound_index_buffer = buffer.get_handle();
+	bound_index_offset = offset;
+	bound_index_type   = index_type;
+}
+
+FrameArena *CommandBuffer::get_frame_arena()
+{
+	auto render_frame = command_pool.get_render_frame();
+
+	return render_frame ? &render_frame->get_arena(command_pool.get_thread_index()) : nullptr;
+}
+
+void CommandBuffer::reset_bound_state()
+{
+	bound_vertex_buffers.clear();
+	bound_index_buffer      = VK_NULL_HANDLE;
+	bound_index_offset      = 0;
+	bound_index_type        = VK_INDEX_TYPE_MAX_ENUM;
+	bound_graphics_pipeline = VK_NULL_HANDLE;
+	bound_compute_pipeline  = VK_NULL_HANDLE;
+
+	// Keep the storage of the dynamic offsets
+	for (auto &bound_descriptor_set : bound_descriptor_sets)
+	{
+		bound_descriptor_set.handle = VK_NULL_HANDLE;
+	}
+}
+
+void CommandBuffer::bind_descriptor_set_handle(VkPipelineBindPoint pipeline_bind_point, const PipelineLayout &pipeline_layout, uint32_t set,
+                                               VkDescriptorSet descriptor_set, const uint32_t *dynamic_offsets, uint32_t dynamic_offset_count)
+{
+	auto compatibility_hash = pipeline_layout.get_set_compatibility_hash(set);
+
+	if (set < bound_descriptor_sets.size())
+	{
+		auto &bound = bound_descriptor_sets[set];
+
+		if (bound.handle == descriptor_set && bound.compatibility_hash == compatibility_hash &&
+		    bound.pipeline_bind_point == pipeline_bind_point && bound.dynamic_offsets.size() == dynamic_offset_count &&
+		    std::equal(bound.dynamic_offsets.begin(), bound.dynamic_offsets.end(), dynamic_offsets))
+		{
+			bind_stats.descriptor_set_binds_skipped++;
+			return;
+		}
+	}
+
+	vkCmdBindDescriptorSets(get_handle(),
+	                        pipeline_bind_point,
+	                        pipeline_layout.get_handle(),
+	                        set,
+	                        1, &descriptor_set,
+	                        dynamic_offset_count,
+	                        dynamic_offsets);
+
+	bind_stats.descriptor_set_binds++;
+
+	invalidate_bound_descriptor_sets(pipeline_bind_point, pipeline_layout, set);
+
+	if (bound_descriptor_sets.size() <= set)
+	{
+		bound_descriptor_sets.resize(set + 1);
+	}
+
+	auto &bound = bound_descriptor_sets[set];
+
+	bound.handle              = descriptor_set;
+	bound.compatibility_hash  = compatibility_hash;
+	bound.pipeline_bind_point = pipeline_bind_point;
+	bound.dynamic_offsets.assign(dynamic_offsets, dynamic_offsets + dynamic_offset_count);
+}
+
+void CommandBuffer::invalidate_bound_descriptor_sets(VkPipelineBindPoint pipeline_bind_point, const PipelineLayout &pipeline_layout, uint32_t set)
+{
+	// Binding a set disturbs the lower numbered sets bound with a layout incompatible for them. The higher
+	// numbered sets stay bound only if the set itself was bound with a layout compatible for it
+	bool higher_sets_kept = set < bound_descriptor_sets.size() &&
+	                        bound_descriptor_sets[set].pipeline_bind_point == pipeline_bind_point &&
+	                        bound_descriptor_sets[set].handle != VK_NULL_HANDLE &&
+	                        bound_descriptor_sets[set].compatibility_hash == pipeline_layout.get_set_compatibility_hash(set);
+
+	for (uint32_t i = 0; i < bound_descriptor_sets.size(); i++)
+	{
+		auto &bound = bound_descriptor_sets[i];
+
+		if (bound.pipeline_bind_point != pipeline_bind_point || bound.handle == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		bool kept = false;
+
+		if (i < set)
+		{
+			kept = bound.compatibility_hash == pipeline_layout.get_set_compatibility_hash(i);
+		}
+		else if (i > set)
+		{
+			kept = higher_sets_kept && pipeline_layout.has_descriptor_set_layout(i) &&
+			       bound.compatibility_hash == pipeline_layout.get_set_compatibility_hash(i);
+		}
+
+		if (!kept)
+		{
+			bound.handle = VK_NULL_HANDLE;
+		}
+	}
 }
 
 void CommandBuffer::set_viewport_state(const ViewportState &state_info)
@@ -321,14 +778,25 @@ void CommandBuffer::set_color_blend_state(const ColorBlendState &state_info)
 	pipeline_state.set_color_blend_state(state_info);
 }
 
-void CommandBuffer::set_viewport(uint32_t first_viewport, const std::vector<VkViewport> &viewports)
+void CommandBuffer::set_fragment_shading_rate_state(const FragmentShadingRateState &state_info)
+{
+	pipeline_state.set_fragment_shading_rate_state(state_info);
+}
+
+void CommandBuffer::set_viewport(uint32_t first_viewport, const std::vector<VkViewport> &new_viewports)
 {
-	vkCmdSetViewport(get_handle(), first_viewport, to_u32(viewports.size()), viewports.data());
+	vkCmdSetViewport(get_handle(), first_viewport, to_u32(new_viewports.size()), new_viewports.data());
+
+	viewports.resize(std::max(viewports.size(), first_viewport + new_viewports.size()));
+	std::copy(new_viewports.begin(), new_viewports.end(), viewports.begin() + first_viewport);
 }
 
-void CommandBuffer::set_scissor(uint32_t first_scissor, const std::vector<VkRect2D> &scissors)
+void CommandBuffer::set_scissor(uint32_t first_scissor, const std::vector<VkRect2D> &new_scissors)
 {
-	vkCmdSetScissor(get_handle(), first_scissor, to_u32(scissors.size()), scissors.data());
+	vkCmdSetScissor(get_handle(), first_scissor, to_u32(new_scissors.size()), new_scissors.data());
+
+	scissors.resize(std::max(scissors.size(), first_scissor + new_scissors.size()));
+	std::copy(new_scissors.begin(), new_scissors.end(), scissors.begin() + first_scissor);
 }
 
 void CommandBuffer::set_line_width(float line_width)
@@ -351,39 +819,88 @@ void CommandBuffer::set_depth_bounds(float min_depth_bounds, float max_depth_bou
 	vkCmdSetDepthBounds(get_handle(), min_depth_bounds, max_depth_bounds);
 }
 
+bool CommandBuffer::is_pipeline_ready()
+{
+	if (current_render_pass.render_pass)
+	{
+		pipeline_state.set_render_pass(*current_render_pass.render_pass);
+	}
+
+	return get_device().get_resource_cache().is_graphics_pipeline_ready(pipeline_state);
+}
+
 void CommandBuffer::draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance)
 {
-	flush_pipeline_state(VK_PIPELINE_BIND_POINT_GRAPHICS);
+	if (!flush_pipeline_state(VK_PIPELINE_BIND_POINT_GRAPHICS))
+	{
+		return;
+	}
 
 	flush_descriptor_state(VK_PIPELINE_BIND_POINT_GRAPHICS);
 
+	flush_barriers();
+
+	subpass_drawn = true;
+
 	vkCmdDraw(get_handle(), vertex_count, instance_count, first_vertex, first_instance);
 }
 
 void CommandBuffer::draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
 {
-	flush_pipeline_state(VK_PIPELINE_BIND_POINT_GRAPHICS);
+	if (!flush_pipeline_state(VK_PIPELINE_BIND_POINT_GRAPHICS))
+	{
+		return;
+	}
 
 	flush_descriptor_state(VK_PIPELINE_BIND_POINT_GRAPHICS);
 
+	flush_barriers();
+
+	subpass_drawn = true;
+
 	vkCmdDrawIndexed(get_handle(), index_count, instance_count, first_index, vertex_offset, first_instance);
 }
 
 void CommandBuffer::draw_indexed_indirect(const core::Buffer &buffer, VkDeviceSize offset, uint32_t draw_count, uint32_t stride)
 {
-	flush_pipeline_state(VK_PIPELINE_BIND_POINT_GRAPHICS);
+	if (!flush_pipeline_state(VK_PIPELINE_BIND_POINT_GRAPHICS))
+	{
+		return;
+	}
 
 	flush_descriptor_state(VK_PIPELINE_BIND_POINT_GRAPHICS);
 
+	flush_barriers();
+
+	subpass_drawn = true;
+
 	vkCmdDrawIndexedIndirect(get_handle(), buffer.get_handle(), offset, draw_count, stride);
 }
 
+void CommandBuffer::draw_indexed_indirect_count(const core::Buffer &buffer, VkDeviceSize offset, const core::Buffer &count_buffer, VkDeviceSize count_offset, uint32_t max_draw_count, uint32_t stride)
+{
+	if (!flush_pipeline_state(VK_PIPELINE_BIND_POINT_GRAPHICS))
+	{
+		return;
+	}
+
+	flush_descriptor_state(VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+	flush_barriers();
+
+	subpass_drawn = true;
+
+	vkCmdDrawIndexedIndirectCountKHR(get_handle(), buffer.get_handle(), offset, count_buffer.get_handle(), count_offset, max_draw_count, stride);
+}
+
 void CommandBuffer::dispatch(uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
 {
 	flush_pipeline_state(VK_PIPELINE_BIND_POINT_COMPUTE);
 
 	flush_descriptor_state(VK_PIPELINE_BIND_POINT_COMPUTE);
 
+	flush_barriers();
+
 	vkCmdDispatch(get_handle(), group_count_x, group_count_y, group_count_z);
 }
 
@@ -393,23 +910,40 @@ void CommandBuffer::dispatch_indirect(const core::Buffer &buffer, VkDeviceSize o
 
 	flush_descriptor_state(VK_PIPELINE_BIND_POINT_COMPUTE);
 
+	flush_barriers();
+
 	vkCmdDispatchIndirect(get_handle(), buffer.get_handle(), offset);
 }
 
 void CommandBuffer::update_buffer(const core::Buffer &buffer, VkDeviceSize offset, const std::vector<uint8_t> &data)
 {
+	flush_barriers();
+
 	vkCmdUpdateBuffer(get_handle(), buffer.get_handle(), offset, data.size(), data.data());
 }
 
-void CommandBuffer::blit_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageBlit> &regions)
+void CommandBuffer::blit_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageBlit> &regions, VkFilter filter)
 {
+	flush_barriers();
+
 	vkCmdBlitImage(get_handle(), src_img.get_handle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 	               dst_img.get_handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-	               to_u32(regions.size()), regions.data(), VK_FILTER_NEAREST);
+	               to_u32(regions.size()), regions.data(), filter);
+}
+
+void CommandBuffer::resolve_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageResolve> &regions)
+{
+	flush_barriers();
+
+	vkCmdResolveImage(get_handle(), src_img.get_handle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+	                  dst_img.get_handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+	                  to_u32(regions.size()), regions.data());
 }
 
 void CommandBuffer::copy_buffer(const core::Buffer &src_buffer, const core::Buffer &dst_buffer, VkDeviceSize size)
 {
+	flush_barriers();
+
 	VkBufferCopy copy_region = {};
 	copy_region.size         = size;
 	vkCmdCopyBuffer(get_handle(), src_buffer.get_handle(), dst_buffer.get_handle(), 1, &copy_region);
@@ -417,6 +951,8 @@ void CommandBuffer::copy_buffer(const core::Buffer &src_buffer, const core::Buff
 
 void CommandBuffer::copy_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageCopy> &regions)
 {
+	flush_barriers();
+
 	vkCmdCopyImage(get_handle(), src_img.get_handle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 	               dst_img.get_handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 	               to_u32(regions.size()), regions.data());
@@ -424,24 +960,51 @@ void CommandBuffer::copy_image(const core::Image &src_img, const core::Image &ds
 
 void CommandBuffer::copy_buffer_to_image(const core::Buffer &buffer, const core::Image &image, const std::vector<VkBufferImageCopy> &regions)
 {
+	flush_barriers();
+
 	vkCmdCopyBufferToImage(get_handle(), buffer.get_handle(),
 	                       image.get_handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 	                       to_u32(regions.size()), regions.data());
 }
 
+void CommandBuffer::copy_image_to_buffer(const core::Image &image, VkImageLayout image_layout, const core::Buffer &buffer, const std::vector<VkBufferImageCopy> &regions)
+{
+	flush_barriers();
+
+	vkCmdCopyImageToBuffer(get_handle(), image.get_handle(), image_layout,
+	                       buffer.get_handle(),
+	                       to_u32(regions.size()), regions.data());
+}
+
 void CommandBuffer::image_memory_barrier(const core::ImageView &image_view, const ImageMemoryBarrier &memory_barrier)
 {
+	image_memory_barrier(image_view, image_view.get_subresource_range(), memory_barrier);
+}
+
+void CommandBuffer::image_memory_barrier(const core::ImageView &image_view, const VkImageSubresourceRange &subresource_range, const ImageMemoryBarrier &memory_barrier)
+{
+	flush_barriers();
+
 	VkImageMemoryBarrier image_memory_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
-	image_memory_barrier.oldLayout        = memory_barrier.old_layout;
-	image_memory_barrier.newLayout        = memory_barrier.new_layout;
-	image_memory_barrier.image            = image_view.get_image().get_handle();
-	image_memory_barrier.subresourceRange = image_view.get_subresource_range();
-	image_memory_barrier.srcAccessMask    = memory_barrier.src_access_mask;
-	image_memory_barrier.dstAccessMask    = memory_barrier.dst_access_mask;
+	image_memory_barrier.oldLayout           = memory_barrier.old_layout;
+	image_memory_barrier.newLayout           = memory_barrier.new_layout;
+	image_memory_barrier.image               = image_view.get_image().get_handle();
+	image_memory_barrier.subresourceRange    = subresource_range;
+	image_memory_barrier.srcAccessMask       = memory_barrier.src_access_mask;
+	image_memory_barrier.dstAccessMask       = memory_barrier.dst_access_mask;
+	image_memory_barrier.srcQueueFamilyIndex = memory_barrier.old_queue_family;
+	image_memory_barrier.dstQueueFamilyIndex = memory_barrier.new_queue_family;
 
 	VkPipelineStageFlags src_stage_mask = memory_barrier.src_stage_mask;
 	VkPipelineStageFlags dst_stage_mask = memory_barrier.dst_stage_mask;
 
+	if (get_device().get_perf_lint().is_enabled())
+	{
+		lint_barrier(src_stage_mask, dst_stage_mask);
+
+		lint_image_barrier(image_memory_barrier);
+	}
+
 	vkCmdPipelineBarrier(
 	    get_handle(),
 	    src_stage_mask,
@@ -455,16 +1018,25 @@ void CommandBuffer::image_memory_barrier(const core::ImageView &image_view, cons
 
 void CommandBuffer::buffer_memory_barrier(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize size, const BufferMemoryBarrier &memory_barrier)
 {
+	flush_barriers();
+
 	VkBufferMemoryBarrier buffer_memory_barrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
-	buffer_memory_barrier.srcAccessMask = memory_barrier.src_access_mask;
-	buffer_memory_barrier.dstAccessMask = memory_barrier.dst_access_mask;
-	buffer_memory_barrier.buffer        = buffer.get_handle();
-	buffer_memory_barrier.offset        = offset;
-	buffer_memory_barrier.size          = size;
+	buffer_memory_barrier.srcAccessMask       = memory_barrier.src_access_mask;
+	buffer_memory_barrier.dstAccessMask       = memory_barrier.dst_access_mask;
+	buffer_memory_barrier.buffer              = buffer.get_handle();
+	buffer_memory_barrier.offset              = offset;
+	buffer_memory_barrier.size                = size;
+	buffer_memory_barrier.srcQueueFamilyIndex = memory_barrier.old_queue_family;
+	buffer_memory_barrier.dstQueueFamilyIndex = memory_barrier.new_queue_family;
 
 	VkPipelineStageFlags src_stage_mask = memory_barrier.src_stage_mask;
 	VkPipelineStageFlags dst_stage_mask = memory_barrier.dst_stage_mask;
 
+	if (get_device().get_perf_lint().is_enabled())
+	{
+		lint_barrier(src_stage_mask, dst_stage_mask);
+	}
+
 	vkCmdPipelineBarrier(
 	    get_handle(),
 	    src_stage_mask,
@@ -475,49 +1047,388 @@ void CommandBuffer::buffer_memory_barrier(const core::Buffer &buffer, VkDeviceSi
 	    0, nullptr);
 }
 
-void CommandBuffer::flush_pipeline_state(VkPipelineBindPoint pipeline_bind_point)
+void CommandBuffer::transition(core::Image &image, ResourceUsage usage, bool discard)
 {
-	// Create a new pipeline only if the graphics state changed
-	if (!pipeline_state.is_dirty())
+	VkImageSubresourceRange subresource_range{};
+	subresource_range.levelCount = VK_REMAINING_MIP_LEVELS;
+	subresource_range.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+	if (is_depth_stencil_format(image.get_format()))
+	{
+		subresource_range.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+		if (!is_depth_only_format(image.get_format()))
+		{
+			subresource_range.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+	}
+	else
+	{
+		subresource_range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+
+	transition(image, subresource_range, usage, discard);
+}
+
+void CommandBuffer::transition(core::Image &image, const VkImageSubresourceRange &subresource_range, ResourceUsage usage, bool discard)
+{
+	auto access      = get_resource_access(usage);
+	auto subresource = image.get_subresource();
+
+	uint32_t level_count = subresource_range.levelCount == VK_REMAINING_MIP_LEVELS ? subresource.mipLevel - subresource_range.baseMipLevel : subresource_range.levelCount;
+	uint32_t layer_count = subresource_range.layerCount == VK_REMAINING_ARRAY_LAYERS ? subresource.arrayLayer - subresource_range.baseArrayLayer : subresource_range.layerCount;
+
+	for (uint32_t level = subresource_range.baseMipLevel; level < subresource_range.baseMipLevel + level_count; ++level)
+	{
+		for (uint32_t layer = subresource_range.baseArrayLayer; layer < subresource_range.baseArrayLayer + layer_count; ++layer)
+		{
+			auto &state = image.get_subresource_state(level, layer);
+
+			if (discard)
+			{
+				state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+
+			ImageMemoryBarrier memory_barrier{};
+
+			if (!update_resource_state(state, access, memory_barrier))
+			{
+				continue;
+			}
+
+			VkImageMemoryBarrier image_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+			image_barrier.oldLayout                       = memory_barrier.old_layout;
+			image_barrier.newLayout                       = memory_barrier.new_layout;
+			image_barrier.image                           = image.get_handle();
+			image_barrier.subresourceRange.aspectMask     = subresource_range.aspectMask;
+			image_barrier.subresourceRange.baseMipLevel   = level;
+			image_barrier.subresourceRange.levelCount     = 1;
+			image_barrier.subresourceRange.baseArrayLayer = layer;
+			image_barrier.subresourceRange.layerCount     = 1;
+			image_barrier.srcAccessMask                   = memory_barrier.src_access_mask;
+			image_barrier.dstAccessMask                   = memory_barrier.dst_access_mask;
+			image_barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+			image_barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+
+			if (get_device().get_perf_lint().is_enabled())
+			{
+				lint_image_barrier(image_barrier);
+			}
+
+			add_pending_barrier(image_barrier);
+
+			pending_src_stage_mask |= memory_barrier.src_stage_mask;
+			pending_dst_stage_mask |= memory_barrier.dst_stage_mask;
+		}
+	}
+}
+
+void CommandBuffer::transition(core::Buffer &buffer, ResourceUsage usage)
+{
+	auto access   = get_resource_access(usage);
+	access.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	ImageMemoryBarrier memory_barrier{};
+
+	if (!update_resource_state(buffer.get_state(), access, memory_barrier))
 	{
 		return;
 	}
 
-	pipeline_state.clear_dirty();
+	VkBufferMemoryBarrier buffer_barrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+	buffer_barrier.srcAccessMask       = memory_barrier.src_access_mask;
+	buffer_barrier.dstAccessMask       = memory_barrier.dst_access_mask;
+	buffer_barrier.buffer              = buffer.get_handle();
+	buffer_barrier.offset              = 0;
+	buffer_barrier.size                = VK_WHOLE_SIZE;
+	buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+	pending_buffer_barriers.push_back(buffer_barrier);
+
+	pending_src_stage_mask |= memory_barrier.src_stage_mask;
+	pending_dst_stage_mask |= memory_barrier.dst_stage_mask;
+}
+
+void CommandBuffer::add_pending_barrier(const VkImageMemoryBarrier &image_barrier)
+{
+	auto merge = [](VkImageMemoryBarrier &into, const VkImageMemoryBarrier &other) {
+		if (into.image != other.image || into.oldLayout != other.oldLayout || into.newLayout != other.newLayout ||
+		    into.srcAccessMask != other.srcAccessMask || into.dstAccessMask != other.dstAccessMask ||
+		    into.subresourceRange.aspectMask != other.subresourceRange.aspectMask)
+		{
+			return false;
+		}
+
+		auto &range       = into.subresourceRange;
+		auto &other_range = other.subresourceRange;
+
+		if (range.baseMipLevel == other_range.baseMipLevel && range.levelCount == other_range.levelCount &&
+		    range.baseArrayLayer + range.layerCount == other_range.baseArrayLayer)
+		{
+			range.layerCount += other_range.layerCount;
+			return true;
+		}
+
+		if (range.baseArrayLayer == other_range.baseArrayLayer && range.layerCount == other_range.layerCount &&
+		    range.baseMipLevel + range.levelCount == other_range.baseMipLevel)
+		{
+			range.levelCount += other_range.levelCount;
+			return true;
+		}
+
+		return false;
+	};
+
+	if (!pending_image_barriers.empty() && merge(pending_image_barriers.back(), image_barrier))
+	{
+		// Layers of a level merge first, then the merged level can merge with the one before
+		if (pending_image_barriers.size() > 1 && merge(pending_image_barriers[pending_image_barriers.size() - 2], pending_image_barriers.back()))
+		{
+			pending_image_barriers.pop_back();
+		}
 
-	// Create and bind pipeline
+		return;
+	}
+
+	pending_image_barriers.push_back(image_barrier);
+}
+
+void CommandBuffer::flush_barriers()
+{
+	if (pending_image_barriers.empty() && pending_buffer_barriers.empty())
+	{
+		return;
+	}
+
+	if (get_device().get_perf_lint().is_enabled())
+	{
+		lint_barrier(pending_src_stage_mask, pending_dst_stage_mask);
+	}
+
+	vkCmdPipelineBarrier(
+	    get_handle(),
+	    pending_src_stage_mask,
+	    pending_dst_stage_mask,
+	    0,
+	    0, nullptr,
+	    to_u32(pending_buffer_barriers.size()), pending_buffer_barriers.data(),
+	    to_u32(pending_image_barriers.size()), pending_image_barriers.data());
+
+	pending_image_barriers.clear();
+	pending_buffer_barriers.clear();
+
+	pending_src_stage_mask = 0;
+	pending_dst_stage_mask = 0;
+}
+
+void CommandBuffer::reset_query_pool(const QueryPool &query_pool, uint32_t first_query, uint32_t query_count)
+{
+	vkCmdResetQueryPool(get_handle(), query_pool.get_handle(), first_query, query_count);
+}
+
+void CommandBuffer::write_timestamp(VkPipelineStageFlagBits pipeline_stage, const QueryPool &query_pool, uint32_t query)
+{
+	vkCmdWriteTimestamp(get_handle(), pipeline_stage, query_pool.get_handle(), query);
+}
+
+void CommandBuffer::begin_query(const QueryPool &query_pool, uint32_t query, VkQueryControlFlags flags)
+{
+	vkCmdBeginQuery(get_handle(), query_pool.get_handle(), query, flags);
+}
+
+void CommandBuffer::end_query(const QueryPool &query_pool, uint32_t query)
+{
+	vkCmdEndQuery(get_handle(), query_pool.get_handle(), query);
+}
+
+void CommandBuffer::begin_debug_label(const std::string &name)
+{
+	if (get_device().get_perf_lint().is_enabled())
+	{
+		lint_labels.push_back(name);
+	}
+
+	if (get_device().uses_debug_utils())
+	{
+		VkDebugUtilsLabelEXT label{VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT};
+		label.pLabelName = name.c_str();
+
+		vkCmdBeginDebugUtilsLabelEXT(get_handle(), &label);
+	}
+}
+
+void CommandBuffer::end_debug_label()
+{
+	if (!lint_labels.empty())
+	{
+		lint_labels.pop_back();
+	}
+
+	if (get_device().uses_debug_utils())
+	{
+		vkCmdEndDebugUtilsLabelEXT(get_handle());
+	}
+}
+
+void CommandBuffer::begin_gpu_scope(const std::string &name, bool pipeline_statistics)
+{
+	auto render_frame = command_pool.get_render_frame();
+
+	if (render_frame && profiled)
+	{
+		render_frame->get_gpu_profiler().begin_scope(*this, name, pipeline_statistics);
+	}
+}
+
+void CommandBuffer::end_gpu_scope()
+{
+	auto render_frame = command_pool.get_render_frame();
+
+	if (render_frame && profiled)
+	{
+		render_frame->get_gpu_profiler().end_scope(*this);
+	}
+}
+
+void CommandBuffer::set_profiled(bool enabled)
+{
+	profiled = enabled;
+}
+
+bool CommandBuffer::flush_pipeline_state(VkPipelineBindPoint pipeline_bind_point)
+{
+	// Create a new pipeline only if the graphics state changed
+	if (pipeline_state.is_dirty() && !bind_pipeline(pipeline_bind_point))
+	{
+		return false;
+	}
+
+	if (pipeline_bind_point == VK_PIPELINE_BIND_POINT_GRAPHICS && pipeline_state.has_extended_dynamic_state())
+	{
+		flush_extended_dynamic_state();
+	}
+
+	return true;
+}
+
+bool CommandBuffer::bind_pipeline(VkPipelineBindPoint pipeline_bind_point)
+{
 	if (pipeline_bind_point == VK_PIPELINE_BIND_POINT_GRAPHICS)
 	{
 		pipeline_state.set_render_pass(*current_render_pass.render_pass);
-		auto &pipeline = get_device().get_resource_cache().request_graphics_pipeline(pipeline_state);
+		auto &resource_cache = get_device().get_resource_cache();
+		auto  pipeline       = resource_cache.request_graphics_pipeline_async(pipeline_state);
+
+		if (!pipeline)
+		{
+			// Still compiling, keep the state dirty to request it again with the next draw
+			return false;
+		}
+
+		// States which only differ by dynamic state share a pipeline
+		if (pipeline->get_handle() == bound_graphics_pipeline)
+		{
+			bind_stats.pipeline_binds_skipped++;
+		}
+		else
+		{
+			vkCmdBindPipeline(get_handle(),
+			                  pipeline_bind_point,
+			                  pipeline->get_handle());
+
+			bound_graphics_pipeline = pipeline->get_handle();
+			bind_stats.pipeline_binds++;
+
+			// Binding a pipeline with static state invalidates the dynamic state set before
+			if (!pipeline->get_state().has_extended_dynamic_state())
+			{
+				dynamic_state_valid = false;
+			}
+		}
 
-		vkCmdBindPipeline(get_handle(),
-		                  pipeline_bind_point,
-		                  pipeline.get_handle());
+		// A fallback pipeline is bound only until the requested one is ready, the other policies bind the requested one
+		if (resource_cache.get_pipeline_compilation() != PipelineCompilation::AsyncFallback ||
+		    resource_cache.is_graphics_pipeline_ready(pipeline_state))
+		{
+			pipeline_state.clear_dirty();
+		}
 	}
 	else if (pipeline_bind_point == VK_PIPELINE_BIND_POINT_COMPUTE)
 	{
+		pipeline_state.clear_dirty();
+
 		auto &pipeline = get_device().get_resource_cache().request_compute_pipeline(pipeline_state);
 
-		vkCmdBindPipeline(get_handle(),
-		                  pipeline_bind_point,
-		                  pipeline.get_handle());
+		if (pipeline.get_handle() == bound_compute_pipeline)
+		{
+			bind_stats.pipeline_binds_skipped++;
+		}
+		else
+		{
+			vkCmdBindPipeline(get_handle(),
+			                  pipeline_bind_point,
+			                  pipeline.get_handle());
+
+			bound_compute_pipeline = pipeline.get_handle();
+			bind_stats.pipeline_binds++;
+		}
 	}
 	else
 	{
 		throw "Only graphics and compute pipeline bind points are supported now";
 	}
+
+	return true;
+}
+
+void CommandBuffer::flush_extended_dynamic_state()
+{
+	auto &rasterization_state = pipeline_state.get_rasterization_state();
+	auto &depth_stencil_state = pipeline_state.get_depth_stencil_state();
+
+	if (!dynamic_state_valid || dynamic_rasterization_state.cull_mode != rasterization_state.cull_mode)
+	{
+		vkCmdSetCullModeEXT(get_handle(), rasterization_state.cull_mode);
+	}
+
+	if (!dynamic_state_valid || dynamic_rasterization_state.front_face != rasterization_state.front_face)
+	{
+		vkCmdSetFrontFaceEXT(get_handle(), rasterization_state.front_face);
+	}
+
+	if (!dynamic_state_valid || dynamic_depth_stencil_state.depth_test_enable != depth_stencil_state.depth_test_enable)
+	{
+		vkCmdSetDepthTestEnableEXT(get_handle(), depth_stencil_state.depth_test_enable);
+	}
+
+	if (!dynamic_state_valid || dynamic_depth_stencil_state.depth_write_enable != depth_stencil_state.depth_write_enable)
+	{
+		vkCmdSetDepthWriteEnableEXT(get_handle(), depth_stencil_state.depth_write_enable);
+	}
+
+	if (!dynamic_state_valid || dynamic_depth_stencil_state.depth_compare_op != depth_stencil_state.depth_compare_op)
+	{
+		vkCmdSetDepthCompareOpEXT(get_handle(), depth_stencil_state.depth_compare_op);
+	}
+
+	dynamic_rasterization_state = rasterization_state;
+	dynamic_depth_stencil_state = depth_stencil_state;
+	dynamic_state_valid         = true;
 }
 
 void CommandBuffer::flush_descriptor_state(VkPipelineBindPoint pipeline_bind_point)
 {
+	VKB_PROFILE_FUNCTION();
+
 	assert(command_pool.get_render_frame() && "The command pool must be associated to a render frame");
 
 	const auto &pipeline_layout = pipeline_state.get_pipeline_layout();
 
 	const auto &shader_program = pipeline_layout.get_shader_program();
 
-	std::unordered_set<uint32_t> update_descriptor_sets;
+	// One bit per descriptor set index
+	uint32_t update_descriptor_sets = 0;
 
 	// Iterate over the shader sets to check if they have already been bound
 	// If they have, add the set so that the command buffer later updates it
@@ -527,11 +1438,19 @@ void CommandBuffer::flush_descriptor_state(VkPipelineBindPoint pipeline_bind_poi
 
 		auto descriptor_set_layout_it = descriptor_set_layout_binding_state.find(descriptor_set_id);
 
-		if (descriptor_set_layout_it != descriptor_set_layout_binding_state.end())
+		// Resources can only be bound to the first sets
+		if (descriptor_set_id < ResourceBindingState::MAX_SETS && descriptor_set_layout_it != descriptor_set_layout_binding_state.end())
 		{
 			if (descriptor_set_layout_it->second->get_handle() != pipeline_layout.get_descriptor_set_layout(descriptor_set_id).get_handle())
 			{
-				update_descriptor_sets.emplace(descriptor_set_id);
+				update_descriptor_sets |= 1u << descriptor_set_id;
+			}
+
+			// A set of the same layout stays bound only if it was bound with a pipeline layout compatible for it
+			else if (descriptor_set_id < bound_descriptor_sets.size() && bound_descriptor_sets[descriptor_set_id].handle != VK_NULL_HANDLE &&
+			         bound_descriptor_sets[descriptor_set_id].compatibility_hash != pipeline_layout.get_set_compatibility_hash(descriptor_set_id))
+			{
+				update_descriptor_sets |= 1u << descriptor_set_id;
 			}
 		}
 	}
@@ -550,21 +1469,26 @@ void CommandBuffer::flush_descriptor_state(VkPipelineBindPoint pipeline_bind_poi
 	}
 
 	// Check if a descriptor set needs to be created
-	if (resource_binding_state.is_dirty() || !update_descriptor_sets.empty())
+	if (resource_binding_state.is_dirty() || update_descriptor_sets != 0)
 	{
 		resource_binding_state.clear_dirty();
 
-		// Iterate over all of the resource sets bound by the command buffer
-		for (auto &resource_set_it : resource_binding_state.get_resource_sets())
+		// Only update the resource sets bound by the command buffer which are in the update list OR whose state changed
+		uint32_t flush_sets = (resource_binding_state.get_dirty_sets() | update_descriptor_sets) & resource_binding_state.get_bound_sets();
+
+		bool reads_in_rasterization_order = false;
+
+#if defined(VK_EXT_rasterization_order_attachment_access)
+		reads_in_rasterization_order = pipeline_bind_point == VK_PIPELINE_BIND_POINT_GRAPHICS && current_render_pass.render_pass &&
+		                               (current_render_pass.render_pass->get_subpass_flags(pipeline_state.get_subpass_index()) &
+		                                VK_SUBPASS_DESCRIPTION_RASTERIZATION_ORDER_ATTACHMENT_COLOR_ACCESS_BIT_EXT) != 0;
+#endif
+
+		for (; flush_sets != 0; flush_sets &= flush_sets - 1)
 		{
-			uint32_t descriptor_set_id = resource_set_it.first;
-			auto &   resource_set      = resource_set_it.second;
+			uint32_t descriptor_set_id = count_trailing_zeros(flush_sets);
 
-			// Don't update resource set if it's not in the update list OR its state hasn't changed
-			if (!resource_set.is_dirty() && (update_descriptor_sets.find(descriptor_set_id) == update_descriptor_sets.end()))
-			{
-				continue;
-			}
+			auto &resource_set = resource_binding_state.get_resource_set(descriptor_set_id);
 
 			// Clear dirty flag for resource set
 			resource_binding_state.clear_dirty(descriptor_set_id);
@@ -580,105 +1504,174 @@ void CommandBuffer::flush_descriptor_state(VkPipelineBindPoint pipeline_bind_poi
 			// Make descriptor set layout bound for current set
 			descriptor_set_layout_binding_state[descriptor_set_id] = &descriptor_set_layout;
 
-			BindingMap<VkDescriptorBufferInfo> buffer_infos;
-			BindingMap<VkDescriptorImageInfo>  image_infos;
+			static_assert(ResourceSet::MAX_BINDINGS * ResourceSet::MAX_ARRAY_ELEMENTS <= DescriptorSetInfos::MAX_DESCRIPTORS,
+			              "Descriptor set infos cannot hold all the resources of a set");
 
-			std::vector<uint32_t> dynamic_offsets;
+			descriptor_set_infos.clear();
 
-			// Iterate over all resource bindings
-			for (auto &binding_it : resource_set.get_resource_bindings())
+			// Layout binding of the resources being iterated, looked up once per binding
+			const VkDescriptorSetLayoutBinding *binding_info{nullptr};
+			uint32_t                            binding_info_index = ResourceSet::MAX_BINDINGS;
+
+			// Iterate over all bound resources, in binding then array element order
+			for (uint64_t resource_mask = resource_set.get_bound_mask(); resource_mask != 0; resource_mask &= resource_mask - 1)
 			{
-				auto  binding_index     = binding_it.first;
-				auto &binding_resources = binding_it.second;
+				uint32_t resource_index = count_trailing_zeros(resource_mask);
+
+				uint32_t binding_index = resource_index / ResourceSet::MAX_ARRAY_ELEMENTS;
+				uint32_t array_element = resource_index % ResourceSet::MAX_ARRAY_ELEMENTS;
+
+				if (binding_index != binding_info_index)
+				{
+					binding_info       = descriptor_set_layout.get_layout_binding(binding_index);
+					binding_info_index = binding_index;
+				}
 
 				// Check if binding exists in the pipeline layout
-				if (auto binding_info = descriptor_set_layout.get_layout_binding(binding_index))
+				if (!binding_info)
 				{
-					// Iterate over all binding resources
-					for (auto &element_it : binding_resources)
-					{
-						auto  array_element = element_it.first;
-						auto &resource_info = element_it.second;
+					continue;
+				}
 
-						// Pointer references
-						auto &buffer     = resource_info.buffer;
-						auto &sampler    = resource_info.sampler;
-						auto &image_view = resource_info.image_view;
+				auto &resource_info = resource_set.get_resource_info(binding_index, array_element);
 
-						// Get buffer info
-						if (buffer != nullptr && is_buffer_descriptor_type(binding_info->descriptorType))
-						{
-							VkDescriptorBufferInfo buffer_info{};
+				// Pointer references
+				auto &buffer     = resource_info.buffer;
+				auto &sampler    = resource_info.sampler;
+				auto &image_view = resource_info.image_view;
 
-							buffer_info.buffer = resource_info.buffer->get_handle();
-							buffer_info.offset = resource_info.offset;
-							buffer_info.range  = resource_info.range;
+				// Get buffer info
+				if (buffer != nullptr && is_buffer_descriptor_type(binding_info->descriptorType))
+				{
+					VkDescriptorBufferInfo buffer_info{};
 
-							if (is_dynamic_buffer_descriptor_type(binding_info->descriptorType))
-							{
-								dynamic_offsets.push_back(to_u32(buffer_info.offset));
+					buffer_info.buffer = resource_info.buffer->get_handle();
+					buffer_info.offset = resource_info.offset;
+					buffer_info.range  = resource_info.range;
 
-								buffer_info.offset = 0;
-							}
+					if (is_dynamic_buffer_descriptor_type(binding_info->descriptorType))
+					{
+						descriptor_set_infos.add_dynamic_offset(to_u32(buffer_info.offset));
 
-							buffer_infos[binding_index][array_element] = buffer_info;
-						}
+						buffer_info.offset = 0;
+					}
+
+					descriptor_set_infos.add_buffer_info(binding_index, array_element, buffer_info);
+				}
+
+				// Get image info
+				else if (image_view != nullptr || sampler != VK_NULL_HANDLE)
+				{
+					// Can be null for input attachments
+					VkDescriptorImageInfo image_info{};
+					image_info.sampler   = sampler ? sampler->get_handle() : VK_NULL_HANDLE;
+					image_info.imageView = image_view->get_handle();
 
-						// Get image info
-						else if (image_view != nullptr || sampler != VK_NULL_HANDLE)
+					if (image_view != nullptr)
+					{
+						// Add image layout info based on descriptor type
+						switch (binding_info->descriptorType)
 						{
-							// Can be null for input attachments
-							VkDescriptorImageInfo image_info{};
-							image_info.sampler   = sampler ? sampler->get_handle() : VK_NULL_HANDLE;
-							image_info.imageView = image_view->get_handle();
-
-							if (image_view != nullptr)
-							{
-								// Add image layout info based on descriptor type
-								switch (binding_info->descriptorType)
+							case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+							case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+								if (binding_info->descriptorType == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT && reads_in_rasterization_order)
+								{
+									// Subpasses reading in rasterization order have their input attachments in the general layout
+									image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+								}
+								else if (is_depth_stencil_format(image_view->get_format()))
+								{
+									image_info.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+								}
+								else
 								{
-									case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
-									case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
-										if (is_depth_stencil_format(image_view->get_format()))
-										{
-											image_info.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-										}
-										else
-										{
-											image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-										}
-										break;
-									case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
-										image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-										break;
-
-									default:
-										continue;
+									image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 								}
-							}
+								break;
+							case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+								image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+								break;
 
-							image_infos[binding_index][array_element] = std::move(image_info);
+							default:
+								continue;
 						}
 					}
+
+					descriptor_set_infos.add_image_info(binding_index, array_element, image_info);
 				}
 			}
 
-			auto &descriptor_set = command_pool.get_render_frame()->request_descriptor_set(descriptor_set_layout, buffer_infos, image_infos, command_pool.get_thread_index());
+			// Push descriptors are written straight into the command buffer, without a descriptor set
+			if (descriptor_set_layout.is_push_descriptor())
+			{
+				push_descriptor_set(pipeline_bind_point, pipeline_layout, descriptor_set_id, descriptor_set_infos);
 
-			VkDescriptorSet descriptor_set_handle = descriptor_set.get_handle();
+				continue;
+			}
+
+			auto &descriptor_set = command_pool.get_render_frame()->request_descriptor_set(descriptor_set_layout, descriptor_set_infos, command_pool.get_thread_index());
+
+			frame_descriptor_set_count++;
 
-			// Bind descriptor set
-			vkCmdBindDescriptorSets(get_handle(),
-			                        pipeline_bind_point,
-			                        pipeline_layout.get_handle(),
-			                        descriptor_set_id,
-			                        1, &descriptor_set_handle,
-			                        to_u32(dynamic_offsets.size()),
-			                        dynamic_offsets.data());
+			// Sets with the same resources are found in the frame cache, and are often bound already
+			bind_descriptor_set_handle(pipeline_bind_point, pipeline_layout, descriptor_set_id, descriptor_set.get_handle(),
+			                           descriptor_set_infos.get_dynamic_offsets(), descriptor_set_infos.get_dynamic_offset_count());
 		}
 	}
 }
 
+void CommandBuffer::push_descriptor_set(VkPipelineBindPoint       pipeline_bind_point,
+                                        const PipelineLayout &    pipeline_layout,
+                                        uint32_t                  descriptor_set_id,
+                                        const DescriptorSetInfos &infos)
+{
+	auto &descriptor_set_layout = pipeline_layout.get_descriptor_set_layout(descriptor_set_id);
+
+	push_descriptor_writes.clear();
+
+	for (uint32_t i = 0; i < infos.get_buffer_info_count(); i++)
+	{
+		auto &entry = infos.get_buffer_info(i);
+
+		VkWriteDescriptorSet write_descriptor_set{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+
+		write_descriptor_set.dstBinding      = entry.binding;
+		write_descriptor_set.dstArrayElement = entry.array_element;
+		write_descriptor_set.descriptorCount = 1;
+		write_descriptor_set.descriptorType  = descriptor_set_layout.get_layout_binding(entry.binding)->descriptorType;
+		write_descriptor_set.pBufferInfo     = &entry.info;
+
+		push_descriptor_writes.push_back(write_descriptor_set);
+	}
+
+	for (uint32_t i = 0; i < infos.get_image_info_count(); i++)
+	{
+		auto &entry = infos.get_image_info(i);
+
+		VkWriteDescriptorSet write_descriptor_set{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+
+		write_descriptor_set.dstBinding      = entry.binding;
+		write_descriptor_set.dstArrayElement = entry.array_element;
+		write_descriptor_set.descriptorCount = 1;
+		write_descriptor_set.descriptorType  = descriptor_set_layout.get_layout_binding(entry.binding)->descriptorType;
+		write_descriptor_set.pImageInfo      = &entry.info;
+
+		push_descriptor_writes.push_back(write_descriptor_set);
+	}
+
+	if (!push_descriptor_writes.empty())
+	{
+		invalidate_bound_descriptor_sets(pipeline_bind_point, pipeline_layout, descriptor_set_id);
+
+		vkCmdPushDescriptorSetKHR(get_handle(),
+		                          pipeline_bind_point,
+		                          pipeline_layout.get_handle(),
+		                          descriptor_set_id,
+		                          to_u32(push_descriptor_writes.size()),
+		                          push_descriptor_writes.data());
+	}
+}
+
 const CommandBuffer::State CommandBuffer::get_state() const
 {
 	return state;
@@ -689,6 +1682,168 @@ const CommandBuffer::RenderPassBinding &CommandBuffer::get_current_render_pass()
 	return current_render_pass;
 }
 
+uint32_t CommandBuffer::get_color_output_count() const
+{
+	assert(current_render_pass.render_pass && "Command buffer is not in a render pass");
+
+	return current_render_pass.render_pass->get_color_output_count(pipeline_state.get_subpass_index());
+}
+
+uint32_t CommandBuffer::get_frame_descriptor_set_count() const
+{
+	return frame_descriptor_set_count;
+}
+
+const CommandBuffer::BindStats &CommandBuffer::get_bind_stats() const
+{
+	return bind_stats;
+}
+
+CommandBuffer::BindStats &CommandBuffer::BindStats::operator+=(const BindStats &other)
+{
+	pipeline_binds += other.pipeline_binds;
+	pipeline_binds_skipped += other.pipeline_binds_skipped;
+	descriptor_set_binds += other.descriptor_set_binds;
+	descriptor_set_binds_skipped += other.descriptor_set_binds_skipped;
+	vertex_buffer_binds += other.vertex_buffer_binds;
+	vertex_buffer_binds_skipped += other.vertex_buffer_binds_skipped;
+	index_buffer_binds += other.index_buffer_binds;
+	index_buffer_binds_skipped += other.index_buffer_binds_skipped;
+
+	return *this;
+}
+
+const std::string &CommandBuffer::get_lint_tag() const
+{
+	static const std::string untagged{"Command buffer"};
+
+	return lint_labels.empty() ? untagged : lint_labels.back();
+}
+
+void CommandBuffer::lint_barrier(VkPipelineStageFlags src_stage_mask, VkPipelineStageFlags dst_stage_mask)
+{
+	const VkPipelineStageFlags all_src_stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_ALL_COMMANDS_BIT | VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
+	const VkPipelineStageFlags all_dst_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_ALL_COMMANDS_BIT | VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
+
+	if ((src_stage_mask & all_src_stages) && (dst_stage_mask & all_dst_stages))
+	{
+		get_device().get_perf_lint().report(PerfIssue::BottomToTopBarrier, get_lint_tag());
+	}
+}
+
+void CommandBuffer::lint_image_barrier(const VkImageMemoryBarrier &image_barrier)
+{
+	if (image_barrier.oldLayout != VK_IMAGE_LAYOUT_UNDEFINED &&
+	    (image_barrier.newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL || image_barrier.newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL))
+	{
+		lint_preserved_images.push_back(image_barrier.image);
+	}
+}
+
+#if defined(VK_KHR_dynamic_rendering)
+void CommandBuffer::begin_rendering(const RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store_infos, const std::vector<VkClearValue> &clear_values, VkSubpassContents contents)
+{
+	auto &render_pass = *current_render_pass.render_pass;
+	auto &views       = render_target.get_views();
+
+	auto make_attachment_info = [&](uint32_t attachment, VkImageLayout layout) {
+		VkRenderingAttachmentInfoKHR info{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR};
+		info.imageView   = views[attachment].get_handle();
+		info.imageLayout = layout;
+		if (attachment < load_store_infos.size())
+		{
+			info.loadOp  = load_store_infos[attachment].load_op;
+			info.storeOp = load_store_infos[attachment].store_op;
+		}
+		if (attachment < clear_values.size())
+		{
+			info.clearValue = clear_values[attachment];
+		}
+		return info;
+	};
+
+	auto &color_references   = render_pass.get_color_references(0);
+	auto &resolve_references = render_pass.get_color_resolve_references(0);
+
+	std::vector<VkRenderingAttachmentInfoKHR> color_infos;
+	color_infos.reserve(color_references.size());
+
+	for (size_t i = 0; i < color_references.size(); ++i)
+	{
+		auto info = make_attachment_info(color_references[i].attachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+		if (i < resolve_references.size() && resolve_references[i].attachment != VK_ATTACHMENT_UNUSED)
+		{
+			info.resolveMode        = VK_RESOLVE_MODE_AVERAGE_BIT_KHR;
+			info.resolveImageView   = views[resolve_references[i].attachment].get_handle();
+			info.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		}
+
+		color_infos.push_back(info);
+	}
+
+	VkRenderingInfoKHR rendering_info{VK_STRUCTURE_TYPE_RENDERING_INFO_KHR};
+	rendering_info.renderArea.extent    = render_target.get_render_extent();
+	rendering_info.layerCount           = 1;
+	rendering_info.viewMask             = render_pass.get_view_mask(0);
+	rendering_info.colorAttachmentCount = to_u32(color_infos.size());
+	rendering_info.pColorAttachments    = color_infos.data();
+
+	if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+	{
+		rendering_info.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR;
+	}
+
+	VkRenderingAttachmentInfoKHR depth_stencil_info{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR};
+
+	if (auto depth_stencil_reference = render_pass.get_depth_stencil_reference(0))
+	{
+		auto format = render_pass.get_depth_stencil_format(0);
+
+		depth_stencil_info = make_attachment_info(depth_stencil_reference->attachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+		if (format != VK_FORMAT_S8_UINT)
+		{
+			rendering_info.pDepthAttachment = &depth_stencil_info;
+		}
+		if (!is_depth_only_format(format))
+		{
+			// As with the render pass, the stencil aspect is loaded and stored like the depth one
+			rendering_info.pStencilAttachment = &depth_stencil_info;
+		}
+	}
+
+	vkCmdBeginRenderingKHR(get_handle(), &rendering_info);
+}
+#endif
+
+void CommandBuffer::lint_render_pass(const RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store_infos)
+{
+	auto &attachments = render_target.get_attachments();
+	auto &views       = render_target.get_views();
+
+	auto &perf_lint = get_device().get_perf_lint();
+
+	for (size_t i = 0; i < load_store_infos.size() && i < attachments.size(); ++i)
+	{
+		auto &load_store = load_store_infos[i];
+
+		if ((attachments[i].usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) &&
+		    (load_store.store_op == VK_ATTACHMENT_STORE_OP_STORE || load_store.load_op == VK_ATTACHMENT_LOAD_OP_LOAD))
+		{
+			perf_lint.report(PerfIssue::TransientAttachmentStored, get_lint_tag());
+		}
+
+		if (load_store.load_op != VK_ATTACHMENT_LOAD_OP_LOAD && i < views.size() &&
+		    std::find(lint_preserved_images.begin(), lint_preserved_images.end(), views[i].get_image().get_handle()) != lint_preserved_images.end())
+		{
+			perf_lint.report(PerfIssue::DiscardedContentsPreserved, get_lint_tag());
+		}
+	}
+
+	lint_preserved_images.clear();
+}
+
 const uint32_t CommandBuffer::get_current_subpass_index() const
 {
 	return pipeline_state.get_subpass_index();
@@ -698,12 +1853,18 @@ VkResult CommandBuffer::reset(ResetMode reset_mode)
 {
 	VkResult result = VK_SUCCESS;
 
-	assert(reset_mode == command_pool.get_reset_mode() && "Command buffer reset mode must match the one used by the pool to allocate it");
+	assert(reset_mode == command_pool.get_active_reset_mode() && "Command buffer reset mode must match the one used by the pool to allocate it");
 
 	state = State::Initial;
 
 	if (reset_mode == ResetMode::ResetIndividually)
 	{
+		// Adaptive pools measure this mode, and only keep it if it is the cheapest
+		if (command_pool.get_reset_mode() == ResetMode::ResetIndividually)
+		{
+			get_device().get_perf_lint().report(PerfIssue::IndividualCommandBufferReset, "CommandPool");
+		}
+
 		result = vkResetCommandBuffer(handle, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
 	}
 
@@ -25,9 +25,12 @@
 #include "common/helpers.h"
 #include "common/vk_common.h"
 #include "core/buffer.h"
+#include "core/descriptor_set.h"
 #include "core/image.h"
 #include "core/image_view.h"
+#include "core/query_pool.h"
 #include "core/sampler.h"
+#include "frame_arena.h"
 #include "rendering/pipeline_state.h"
 #include "rendering/render_target.h"
 #include "resource_binding_state.h"
@@ -55,6 +58,8 @@ class CommandBuffer
 		ResetPool,
 		ResetIndividually,
 		AlwaysAllocate,
+		/// The pool measures the other modes and uses the cheapest one
+		Adaptive,
 	};
 
 	enum class State
@@ -70,9 +75,34 @@ class CommandBuffer
 	 */
 	struct RenderPassBinding
 	{
-		const RenderPass *render_pass;
+		const RenderPass *render_pass{nullptr};
 
-		const Framebuffer *framebuffer;
+		/// Null if the render pass is dynamic, see RenderPass::is_dynamic
+		const Framebuffer *framebuffer{nullptr};
+	};
+
+	/**
+	 * @brief Number of binds recorded, and of binds skipped as the same state was bound already
+	 */
+	struct BindStats
+	{
+		uint32_t pipeline_binds{0};
+
+		uint32_t pipeline_binds_skipped{0};
+
+		uint32_t descriptor_set_binds{0};
+
+		uint32_t descriptor_set_binds_skipped{0};
+
+		uint32_t vertex_buffer_binds{0};
+
+		uint32_t vertex_buffer_binds_skipped{0};
+
+		uint32_t index_buffer_binds{0};
+
+		uint32_t index_buffer_binds_skipped{0};
+
+		BindStats &operator+=(const BindStats &other);
 	};
 
 	CommandBuffer(CommandPool &command_pool, VkCommandBufferLevel level);
@@ -98,25 +128,67 @@ class CommandBuffer
 	/**
 	 * @brief Sets the command buffer so that it is ready for recording
 	 *        If it is a secondary command buffer, a pointer to the
-	 *        primary command buffer it inherits from must be provided
+	 *        primary command buffer it inherits from must be provided,
+	 *        its subpass, viewports and scissors are inherited
 	 * @param flags Usage behavior for the command buffer
 	 * @param primary_cmd_buf (optional)
 	 * @return Whether it succeded or not
 	 */
 	VkResult begin(VkCommandBufferUsageFlags flags, CommandBuffer *primary_cmd_buf = nullptr);
 
+	/**
+	 * @brief Sets the secondary command buffer so that it is ready for recording the draws of a subpass
+	 *        of the render pass of a primary command buffer, which may not have reached that subpass yet.
+	 *        The subpasses can then be recorded on several threads while the primary command buffer moves
+	 *        through them, as long as it does not change its viewports and scissors meanwhile
+	 * @param flags Usage behavior for the command buffer
+	 * @param primary_cmd_buf The primary command buffer it inherits from, recording the render pass
+	 * @param subpass_index Index of the subpass in the render pass
+	 * @return Whether it succeded or not
+	 */
+	VkResult begin(VkCommandBufferUsageFlags flags, CommandBuffer &primary_cmd_buf, uint32_t subpass_index);
+
 	VkResult end();
 
+	/**
+	 * @brief Moves the commands recorded so far to another primary command buffer of the pool, which is ended,
+	 *        so that command buffers recorded elsewhere can be submitted between it and the commands recorded
+	 *        next. This one continues with nothing bound, as after beginning a render pass, and its dynamic
+	 *        viewports and scissors set again. It must not be called within a render pass
+	 * @return The command buffer of the commands recorded so far, to be submitted ahead of this one
+	 */
+	CommandBuffer &split();
+
+	const RenderPassBinding &get_current_render_pass() const;
+
+	/**
+	 * @return Number of color attachments of the current subpass
+	 */
+	uint32_t get_color_output_count() const;
+
+	/**
+	 * @return Number of descriptor sets requested from the render frame since begin. Those sets stay valid
+	 *         only while the frame keeps requesting them, so a command buffer which uses some can't be reused
+	 */
+	uint32_t get_frame_descriptor_set_count() const;
+
+	/**
+	 * @return Binds recorded and skipped since begin, including those of the secondary command buffers executed
+	 */
+	const BindStats &get_bind_stats() const;
+
 	void clear(VkClearAttachment info, VkClearRect rect);
 
 	void begin_render_pass(const RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store_infos, const std::vector<VkClearValue> &clear_values, const std::vector<std::unique_ptr<Subpass>> &subpasses, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 
-	void next_subpass();
+	void next_subpass(VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 
 	void execute_commands(CommandBuffer &secondary_command_buffer);
 
 	void execute_commands(std::vector<CommandBuffer *> &secondary_command_buffers);
 
+	void execute_commands(CommandBuffer *const *secondary_command_buffers, size_t count);
+
 	void end_render_pass();
 
 	void bind_pipeline_layout(PipelineLayout &pipeline_layout);
@@ -126,6 +198,8 @@ class CommandBuffer
 
 	void set_specialization_constant(uint32_t constant_id, const std::vector<uint8_t> &data);
 
+	void set_specialization_constant(uint32_t constant_id, const uint8_t *data, size_t size);
+
 	/**
 	 * @brief Stores additional data which is prepended to the
 	 *        values passed to the push_constants_accumulated() function
@@ -138,22 +212,26 @@ class CommandBuffer
 
 	void push_constants_accumulated(const std::vector<uint8_t> &values, uint32_t offset = 0);
 
+	/**
+	 * @brief Pushes the stored push constants followed by some data,
+	 *        the data is gathered in a reused buffer so no allocation happens per call
+	 */
+	void push_constants_accumulated(const uint8_t *data, size_t size, uint32_t offset = 0);
+
 	template <typename T>
 	void push_constants_accumulated(const T &value, uint32_t offset = 0)
 	{
-		push_constants_accumulated(std::vector<uint8_t>{reinterpret_cast<const uint8_t *>(&value),
-		                                                reinterpret_cast<const uint8_t *>(&value) + sizeof(T)},
-		                           offset);
+		push_constants_accumulated(reinterpret_cast<const uint8_t *>(&value), sizeof(T), offset);
 	}
 
 	void push_constants(uint32_t offset, const std::vector<uint8_t> &values);
 
+	void push_constants(uint32_t offset, const uint8_t *data, size_t size);
+
 	template <typename T>
 	void push_constants(uint32_t offset, const T &value)
 	{
-		push_constants(offset,
-		               std::vector<uint8_t>{reinterpret_cast<const uint8_t *>(&value),
-		                                    reinterpret_cast<const uint8_t *>(&value) + sizeof(T)});
+		push_constants(offset, reinterpret_cast<const uint8_t *>(&value), sizeof(T));
 	}
 
 	void bind_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t set, uint32_t binding, uint32_t array_element);
@@ -162,8 +240,31 @@ class CommandBuffer
 
 	void bind_input(const core::ImageView &image_view, uint32_t set, uint32_t binding, uint32_t array_element);
 
+	/**
+	 * @brief Binds a buffer to a resource of the bound pipeline layout by name, see PipelineLayout::find_binding
+	 * @return Whether the shaders of the layout have the resource
+	 */
+	bool bind_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize range, const std::string &name, uint32_t array_element = 0);
+
+	/**
+	 * @brief Binds an image to a resource of the bound pipeline layout by name, see PipelineLayout::find_binding
+	 * @return Whether the shaders of the layout have the resource
+	 */
+	bool bind_image(const core::ImageView &image_view, const core::Sampler &sampler, const std::string &name, uint32_t array_element = 0);
+
+	/**
+	 * @brief Binds a descriptor set managed outside of the command buffer, with the current pipeline layout
+	 *        The set index must not receive resources through bind_buffer, bind_image or bind_input
+	 */
+	void bind_descriptor_set(const DescriptorSet &descriptor_set, uint32_t set, VkPipelineBindPoint pipeline_bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS);
+
 	void bind_vertex_buffers(uint32_t first_binding, const std::vector<std::reference_wrapper<const vkb::core::Buffer>> &buffers, const std::vector<VkDeviceSize> &offsets);
 
+	/**
+	 * @brief Binds a single vertex buffer, without building the vectors bind_vertex_buffers takes
+	 */
+	void bind_vertex_buffer(uint32_t binding, const vkb::core::Buffer &buffer, VkDeviceSize offset);
+
 	void bind_index_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkIndexType index_type);
 
 	void set_viewport_state(const ViewportState &state_info);
@@ -180,6 +281,11 @@ class CommandBuffer
 
 	void set_color_blend_state(const ColorBlendState &state_info);
 
+	/**
+	 * @brief Sets the shading rate of the next draws, see PipelineState::set_fragment_shading_rate_state
+	 */
+	void set_fragment_shading_rate_state(const FragmentShadingRateState &state_info);
+
 	void set_viewport(uint32_t first_viewport, const std::vector<VkViewport> &viewports);
 
 	void set_scissor(uint32_t first_scissor, const std::vector<VkRect2D> &scissors);
@@ -192,19 +298,36 @@ class CommandBuffer
 
 	void set_depth_bounds(float min_depth_bounds, float max_depth_bounds);
 
+	/**
+	 * @brief Checks whether the graphics pipeline for the current state is built,
+	 *        so that draws will not stall or be skipped by an asynchronous compilation policy
+	 */
+	bool is_pipeline_ready();
+
 	void draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance);
 
 	void draw_indexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance);
 
 	void draw_indexed_indirect(const core::Buffer &buffer, VkDeviceSize offset, uint32_t draw_count, uint32_t stride);
 
+	/**
+	 * @brief Indexed indirect draw with the draw count read from a buffer,
+	 *        requires VK_KHR_draw_indirect_count to be enabled
+	 */
+	void draw_indexed_indirect_count(const core::Buffer &buffer, VkDeviceSize offset, const core::Buffer &count_buffer, VkDeviceSize count_offset, uint32_t max_draw_count, uint32_t stride);
+
 	void dispatch(uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z);
 
 	void dispatch_indirect(const core::Buffer &buffer, VkDeviceSize offset);
 
 	void update_buffer(const core::Buffer &buffer, VkDeviceSize offset, const std::vector<uint8_t> &data);
 
-	void blit_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageBlit> &regions);
+	void blit_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageBlit> &regions, VkFilter filter = VK_FILTER_NEAREST);
+
+	/**
+	 * @brief Resolves a multisampled image in memory, prefer resolve attachments which resolve on-tile
+	 */
+	void resolve_image(const core::Image &src_img, const core::Image &dst_img, const std::vector<VkImageResolve> &regions);
 
 	void copy_buffer(const core::Buffer &src_buffer, const core::Buffer &dst_buffer, VkDeviceSize size);
 
@@ -212,10 +335,81 @@ class CommandBuffer
 
 	void copy_buffer_to_image(const core::Buffer &buffer, const core::Image &image, const std::vector<VkBufferImageCopy> &regions);
 
+	void copy_image_to_buffer(const core::Image &image, VkImageLayout image_layout, const core::Buffer &buffer, const std::vector<VkBufferImageCopy> &regions);
+
 	void image_memory_barrier(const core::ImageView &image_view, const ImageMemoryBarrier &memory_barrier);
 
+	/**
+	 * @brief Image memory barrier restricted to part of the subresources of an image view
+	 */
+	void image_memory_barrier(const core::ImageView &image_view, const VkImageSubresourceRange &subresource_range, const ImageMemoryBarrier &memory_barrier);
+
 	void buffer_memory_barrier(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize size, const BufferMemoryBarrier &memory_barrier);
 
+	/**
+	 * @brief Adds the minimal barrier needed before the next commands use all subresources of an image
+	 *        as given, from the state tracked on the image. Pending barriers are recorded together by
+	 *        the next command which can depend on them. Layout transitions done by render passes are
+	 *        not tracked, the state of their attachments must be set with a transition afterwards.
+	 * @param image The image, its state is updated
+	 * @param usage How the next commands use the image
+	 * @param discard Whether the content of the image can be discarded, so it transitions from an undefined layout
+	 */
+	void transition(core::Image &image, ResourceUsage usage, bool discard = false);
+
+	/**
+	 * @brief Adds the minimal barrier needed before the next commands use part of the subresources of an image
+	 */
+	void transition(core::Image &image, const VkImageSubresourceRange &subresource_range, ResourceUsage usage, bool discard = false);
+
+	/**
+	 * @brief Adds the minimal barrier needed before the next commands use a buffer as given
+	 */
+	void transition(core::Buffer &buffer, ResourceUsage usage);
+
+	/**
+	 * @brief Records the barriers added by transition in a single pipeline barrier
+	 */
+	void flush_barriers();
+
+	void reset_query_pool(const QueryPool &query_pool, uint32_t first_query, uint32_t query_count);
+
+	void write_timestamp(VkPipelineStageFlagBits pipeline_stage, const QueryPool &query_pool, uint32_t query);
+
+	void begin_query(const QueryPool &query_pool, uint32_t query, VkQueryControlFlags flags);
+
+	void end_query(const QueryPool &query_pool, uint32_t query);
+
+	/**
+	 * @brief Opens a debug label shown by debuggers and profilers, does nothing unless the device uses debug utils
+	 * @param name The name of the label
+	 */
+	void begin_debug_label(const std::string &name);
+
+	/**
+	 * @brief Closes the last debug label opened by begin_debug_label
+	 */
+	void end_debug_label();
+
+	/**
+	 * @brief Begins a scope measured by the GPU profiler of the render frame, if any and enabled
+	 * @param name The name of the scope, shown in the stats
+	 * @param pipeline_statistics Whether the pipeline statistics of the scope are collected
+	 */
+	void begin_gpu_scope(const std::string &name, bool pipeline_statistics = false);
+
+	/**
+	 * @brief Ends the last scope begun with begin_gpu_scope
+	 */
+	void end_gpu_scope();
+
+	/**
+	 * @brief Sets whether the GPU profiler, the performance queries and the bandwidth estimator of the render
+	 *        frame measure the command buffer. They are not thread-safe, so command buffers recorded on other
+	 *        threads than the one driving the frame are left out. Reset to measured by begin
+	 */
+	void set_profiled(bool enabled);
+
 	const State get_state() const;
 
 	/**
@@ -233,6 +427,11 @@ class CommandBuffer
 
 	VkCommandBuffer handle{VK_NULL_HANDLE};
 
+	/// Flags given to begin, which split begins the command buffer continuing the recording with
+	VkCommandBufferUsageFlags usage_flags{0};
+
+	bool profiled{true};
+
 	RenderPassBinding current_render_pass;
 
 	PipelineState pipeline_state;
@@ -241,19 +440,165 @@ class CommandBuffer
 
 	std::unordered_map<uint32_t, DescriptorSetLayout *> descriptor_set_layout_binding_state;
 
-	const RenderPassBinding &get_current_render_pass() const;
+	uint32_t frame_descriptor_set_count{0};
+
+	/// Scratch storage of push_constants_accumulated(), kept to reuse its allocation
+	std::vector<uint8_t> accumulated_push_constants;
+
+	/// Scratch storage of flush_descriptor_state(), filled again for each descriptor set without allocating
+	DescriptorSetInfos descriptor_set_infos;
+
+	/// Scratch storage of push_descriptor_set(), kept to reuse its allocation
+	std::vector<VkWriteDescriptorSet> push_descriptor_writes;
+
+	/// Buffer and offset bound at each vertex input binding, to skip redundant binds
+	std::unordered_map<uint32_t, std::pair<VkBuffer, VkDeviceSize>> bound_vertex_buffers;
+
+	VkBuffer bound_index_buffer{VK_NULL_HANDLE};
+
+	VkDeviceSize bound_index_offset{0};
+
+	VkIndexType bound_index_type{VK_INDEX_TYPE_MAX_ENUM};
+
+	/// Pipelines last bound, to skip binding them again when the state changes back and forth
+	VkPipeline bound_graphics_pipeline{VK_NULL_HANDLE};
+
+	VkPipeline bound_compute_pipeline{VK_NULL_HANDLE};
+
+	/**
+	 * @brief A descriptor set bound at a set index, with what it was bound with
+	 */
+	struct BoundDescriptorSet
+	{
+		VkDescriptorSet handle{VK_NULL_HANDLE};
+
+		/// Compatibility hash for the set of the pipeline layout the set was bound with
+		size_t compatibility_hash{0};
+
+		VkPipelineBindPoint pipeline_bind_point{VK_PIPELINE_BIND_POINT_MAX_ENUM};
+
+		std::vector<uint32_t> dynamic_offsets;
+	};
+
+	/// Descriptor sets bound at each set index, to skip redundant binds
+	std::vector<BoundDescriptorSet> bound_descriptor_sets;
+
+	BindStats bind_stats;
+
+	/// Dynamic viewports and scissors last set, recorded again in the secondary command buffers which inherit from this one
+	std::vector<VkViewport> viewports;
+
+	std::vector<VkRect2D> scissors;
+
+	/// Extended dynamic state last set, only valid while the pipelines bound have it dynamic
+	RasterizationState dynamic_rasterization_state;
+
+	DepthStencilState dynamic_depth_stencil_state;
+
+	bool dynamic_state_valid{false};
+
+	/// Render area of the render pass begun, and whether the current subpass recorded draws, for the perf lint
+	VkExtent2D render_area{};
+
+	bool subpass_drawn{false};
+
+	/// Debug labels open while the perf lint is enabled, the last one tags the issues found
+	std::vector<std::string> lint_labels;
+
+	/// Images transitioned from their last layout to an attachment layout since the last render pass began
+	std::vector<VkImage> lint_preserved_images;
+
+	/// Barriers added by transition and not recorded yet
+	std::vector<VkImageMemoryBarrier> pending_image_barriers;
+
+	std::vector<VkBufferMemoryBarrier> pending_buffer_barriers;
+
+	VkPipelineStageFlags pending_src_stage_mask{0};
+
+	VkPipelineStageFlags pending_dst_stage_mask{0};
+
+	/**
+	 * @brief Adds an image barrier to the pending ones, merging it with the last if they cover adjacent subresources
+	 */
+	void add_pending_barrier(const VkImageMemoryBarrier &image_barrier);
+
+	/**
+	 * @return Where the commands being recorded are, for the issues reported to the perf lint
+	 */
+	const std::string &get_lint_tag() const;
+
+	void lint_barrier(VkPipelineStageFlags src_stage_mask, VkPipelineStageFlags dst_stage_mask);
+
+	void lint_image_barrier(const VkImageMemoryBarrier &image_barrier);
+
+	void lint_render_pass(const RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store_infos);
+
+	/**
+	 * @brief Begins recording, a secondary command buffer for the subpass of the render pass of the primary one
+	 */
+	VkResult begin_recording(VkCommandBufferUsageFlags flags, CommandBuffer *primary_cmd_buf, uint32_t subpass_index);
+
+#if defined(VK_KHR_dynamic_rendering)
+	/**
+	 * @brief Begins a dynamic render pass with vkCmdBeginRenderingKHR, rendering to the attachments of its single subpass
+	 */
+	void begin_rendering(const RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store_infos, const std::vector<VkClearValue> &clear_values, VkSubpassContents contents);
+#endif
+
+	/**
+	 * @return The arena of the frame and thread the command buffer records for, nullptr if its pool has no frame
+	 */
+	FrameArena *get_frame_arena();
+
+	/**
+	 * @brief Forgets the bound pipelines, descriptor sets, vertex and index buffers, after which they are bound again
+	 */
+	void reset_bound_state();
+
+	/**
+	 * @brief Binds a descriptor set unless it is bound already, with the same dynamic offsets and
+	 *        a pipeline layout compatible for the set, which may be another one than the current layout
+	 */
+	void bind_descriptor_set_handle(VkPipelineBindPoint pipeline_bind_point, const PipelineLayout &pipeline_layout, uint32_t set,
+	                                VkDescriptorSet descriptor_set, const uint32_t *dynamic_offsets, uint32_t dynamic_offset_count);
+
+	/**
+	 * @brief Forgets the descriptor set bound at a set index, and those which binding it with
+	 *        the pipeline layout disturbs as they were bound with an incompatible one
+	 */
+	void invalidate_bound_descriptor_sets(VkPipelineBindPoint pipeline_bind_point, const PipelineLayout &pipeline_layout, uint32_t set);
 
 	const uint32_t get_current_subpass_index() const;
 
 	/**
 	 * @brief Flush the piplines state
+	 * @returns False if there is no pipeline to draw with yet
 	 */
-	void flush_pipeline_state(VkPipelineBindPoint pipeline_bind_point);
+	bool flush_pipeline_state(VkPipelineBindPoint pipeline_bind_point);
+
+	/**
+	 * @brief Binds the pipeline of the current state
+	 * @returns False if there is no pipeline to draw with yet
+	 */
+	bool bind_pipeline(VkPipelineBindPoint pipeline_bind_point);
+
+	/**
+	 * @brief Sets the parts of the state left out of the pipelines by VK_EXT_extended_dynamic_state which changed
+	 */
+	void flush_extended_dynamic_state();
 
 	/**
 	 * @brief Flush the descriptor set state
 	 */
 	void flush_descriptor_state(VkPipelineBindPoint pipeline_bind_point);
+
+	/**
+	 * @brief Writes the descriptors of a push descriptor set directly into the command buffer
+	 */
+	void push_descriptor_set(VkPipelineBindPoint       pipeline_bind_point,
+	                         const PipelineLayout &    pipeline_layout,
+	                         uint32_t                  descriptor_set_id,
+	                         const DescriptorSetInfos &infos);
 };
 
 template <class T>
@@ -277,9 +622,7 @@ inline void CommandBuffer::set_push_constants<bool>(const bool &data)
 template <class T>
 inline void CommandBuffer::set_specialization_constant(uint32_t constant_id, const T &data)
 {
-	set_specialization_constant(constant_id,
-	                            {reinterpret_cast<const uint8_t *>(&data),
-	                             reinterpret_cast<const uint8_t *>(&data) + sizeof(T)});
+	set_specialization_constant(constant_id, reinterpret_cast<const uint8_t *>(&data), sizeof(T));
 }
 
 template <>
@@ -287,9 +630,6 @@ inline void CommandBuffer::set_specialization_constant<bool>(std::uint32_t const
 {
 	uint32_t value = to_u32(data);
 
-	set_specialization_constant(
-	    constant_id,
-	    {reinterpret_cast<const uint8_t *>(&value),
-	     reinterpret_cast<const uint8_t *>(&value) + sizeof(std::uint32_t)});
+	set_specialization_constant(constant_id, reinterpret_cast<const uint8_t *>(&value), sizeof(std::uint32_t));
 }
 }        // namespace vkb
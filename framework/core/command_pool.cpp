@@ -20,22 +20,45 @@
 
 #include "command_pool.h"
 
+#include <cmath>
+
+#include "common/logging.h"
 #include "device.h"
 #include "rendering/render_frame.h"
+#include "timer.h"
 
 namespace vkb
 {
+namespace
+{
+/// Modes an adaptive pool chooses from
+const std::array<CommandBuffer::ResetMode, 3> ADAPTIVE_RESET_MODES{
+    CommandBuffer::ResetMode::ResetPool,
+    CommandBuffer::ResetMode::ResetIndividually,
+    CommandBuffer::ResetMode::AlwaysAllocate,
+};
+
+/// Frames each mode is measured for, after one frame to warm it up
+const uint32_t ADAPTIVE_TRIAL_FRAMES = 16;
+
+/// Relative change of the command buffers requested per frame after which the modes are measured again
+const float ADAPTIVE_USAGE_CHANGE = 0.5f;
+}        // namespace
+
 CommandPool::CommandPool(Device &d, uint32_t queue_family_index, RenderFrame *render_frame, size_t thread_index, CommandBuffer::ResetMode reset_mode) :
     device{d},
     render_frame{render_frame},
     thread_index{thread_index},
-    reset_mode{reset_mode}
+    queue_family_index{queue_family_index},
+    reset_mode{reset_mode},
+    active_reset_mode{reset_mode == CommandBuffer::ResetMode::Adaptive ? ADAPTIVE_RESET_MODES[0] : reset_mode}
 {
 	VkCommandPoolCreateFlags flags;
 	switch (reset_mode)
 	{
 		case CommandBuffer::ResetMode::ResetIndividually:
 		case CommandBuffer::ResetMode::AlwaysAllocate:
+		case CommandBuffer::ResetMode::Adaptive:
 			flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 			break;
 		case CommandBuffer::ResetMode::ResetPool:
@@ -79,7 +102,13 @@ CommandPool::CommandPool(CommandPool &&other) :
     active_secondary_command_buffer_count{other.active_secondary_command_buffer_count},
     render_frame{other.render_frame},
     thread_index{other.thread_index},
-    reset_mode{other.reset_mode}
+    reset_mode{other.reset_mode},
+    active_reset_mode{other.active_reset_mode},
+    counters{other.counters},
+    trial_mode_index{other.trial_mode_index},
+    trial_frame_count{other.trial_frame_count},
+    trial_costs{other.trial_costs},
+    selected_usage{other.selected_usage}
 {
 	other.handle = VK_NULL_HANDLE;
 
@@ -119,16 +148,31 @@ VkResult CommandPool::reset_pool()
 {
 	VkResult result = VK_SUCCESS;
 
-	switch (reset_mode)
+	if (reset_mode == CommandBuffer::ResetMode::Adaptive)
+	{
+		update_adaptive_mode();
+	}
+
+	counters = {};
+
+	Timer timer;
+	timer.start();
+
+	// The pool of an adaptive pool allows all modes, so it can switch between them at any reset
+	switch (active_reset_mode)
 	{
 		case CommandBuffer::ResetMode::ResetIndividually:
 		{
+			counters.resets = to_u32(primary_command_buffers.size() + secondary_command_buffers.size());
+
 			result = reset_command_buffers();
 
 			break;
 		}
 		case CommandBuffer::ResetMode::ResetPool:
 		{
+			counters.resets = to_u32(primary_command_buffers.size() + secondary_command_buffers.size());
+
 			result = vkResetCommandPool(device.get_handle(), handle, 0);
 
 			if (result != VK_SUCCESS)
@@ -154,16 +198,59 @@ VkResult CommandPool::reset_pool()
 			throw std::runtime_error("Unknown reset mode for command pools");
 	}
 
+	counters.reset_time = timer.stop<Timer::Milliseconds>();
+
 	return result;
 }
 
+void CommandPool::update_adaptive_mode()
+{
+	uint32_t usage = counters.allocations + counters.reuses;
+
+	if (trial_mode_index < ADAPTIVE_RESET_MODES.size())
+	{
+		// The first frame of a mode pays for switching to it, it is left out
+		if (trial_frame_count++ > 0)
+		{
+			trial_costs[trial_mode_index] += counters.reset_time + counters.allocation_time;
+		}
+
+		if (trial_frame_count > ADAPTIVE_TRIAL_FRAMES)
+		{
+			trial_frame_count = 0;
+
+			if (++trial_mode_index == ADAPTIVE_RESET_MODES.size())
+			{
+				auto cheapest = std::min_element(trial_costs.begin(), trial_costs.end()) - trial_costs.begin();
+
+				active_reset_mode = ADAPTIVE_RESET_MODES[cheapest];
+				selected_usage    = usage;
+
+				LOGD("Command pool #{} chose reset mode {} ({:.3f} ms/frame)", thread_index, static_cast<int>(active_reset_mode), trial_costs[cheapest] / ADAPTIVE_TRIAL_FRAMES);
+
+				return;
+			}
+		}
+
+		active_reset_mode = ADAPTIVE_RESET_MODES[trial_mode_index];
+	}
+	else if (std::abs(static_cast<float>(usage) - static_cast<float>(selected_usage)) > ADAPTIVE_USAGE_CHANGE * std::max(selected_usage, 1U))
+	{
+		// The cheapest mode depends on how many command buffers are used
+		trial_mode_index  = 0;
+		trial_frame_count = 0;
+		trial_costs       = {};
+		active_reset_mode = ADAPTIVE_RESET_MODES[0];
+	}
+}
+
 VkResult CommandPool::reset_command_buffers()
 {
 	VkResult result = VK_SUCCESS;
 
 	for (auto &cmd_buf : primary_command_buffers)
 	{
-		result = cmd_buf->reset(reset_mode);
+		result = cmd_buf->reset(active_reset_mode);
 
 		if (result != VK_SUCCESS)
 		{
@@ -175,7 +262,7 @@ VkResult CommandPool::reset_command_buffers()
 
 	for (auto &cmd_buf : secondary_command_buffers)
 	{
-		result = cmd_buf->reset(reset_mode);
+		result = cmd_buf->reset(active_reset_mode);
 
 		if (result != VK_SUCCESS)
 		{
@@ -190,36 +277,41 @@ VkResult CommandPool::reset_command_buffers()
 
 CommandBuffer &CommandPool::request_command_buffer(VkCommandBufferLevel level)
 {
-	if (level == VK_COMMAND_BUFFER_LEVEL_PRIMARY)
+	auto &command_buffers     = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? primary_command_buffers : secondary_command_buffers;
+	auto &active_buffer_count = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? active_primary_command_buffer_count : active_secondary_command_buffer_count;
+
+	if (active_buffer_count < command_buffers.size())
 	{
-		if (active_primary_command_buffer_count < primary_command_buffers.size())
-		{
-			return *primary_command_buffers.at(active_primary_command_buffer_count++);
-		}
+		++counters.reuses;
 
-		primary_command_buffers.emplace_back(std::make_unique<CommandBuffer>(*this, level));
+		return *command_buffers.at(active_buffer_count++);
+	}
 
-		active_primary_command_buffer_count++;
+	Timer timer;
+	timer.start();
 
-		return *primary_command_buffers.back();
-	}
-	else
-	{
-		if (active_secondary_command_buffer_count < secondary_command_buffers.size())
-		{
-			return *secondary_command_buffers.at(active_secondary_command_buffer_count++);
-		}
+	command_buffers.emplace_back(std::make_unique<CommandBuffer>(*this, level));
 
-		secondary_command_buffers.emplace_back(std::make_unique<CommandBuffer>(*this, level));
+	counters.allocation_time += timer.stop<Timer::Milliseconds>();
+	++counters.allocations;
 
-		active_secondary_command_buffer_count++;
+	active_buffer_count++;
 
-		return *secondary_command_buffers.back();
-	}
+	return *command_buffers.back();
 }
 
 CommandBuffer::ResetMode const CommandPool::get_reset_mode() const
 {
 	return reset_mode;
 }
+
+CommandBuffer::ResetMode CommandPool::get_active_reset_mode() const
+{
+	return active_reset_mode;
+}
+
+const CommandPoolCounters &CommandPool::get_counters() const
+{
+	return counters;
+}
 }        // namespace vkb
@@ -29,6 +29,27 @@ namespace vkb
 class Device;
 class RenderFrame;
 
+/**
+ * @brief Command buffer management counters of a pool, since it was last reset
+ */
+struct CommandPoolCounters
+{
+	/// Command buffers allocated with vkAllocateCommandBuffers
+	uint32_t allocations{0};
+
+	/// Command buffers requested which had been allocated before
+	uint32_t reuses{0};
+
+	/// Command buffers reset, individually or with their pool
+	uint32_t resets{0};
+
+	/// Time spent resetting the pool, or resetting or freeing its command buffers, in milliseconds
+	double reset_time{0.0};
+
+	/// Time spent allocating command buffers, in milliseconds
+	double allocation_time{0.0};
+};
+
 class CommandPool
 {
   public:
@@ -62,6 +83,16 @@ class CommandPool
 
 	const CommandBuffer::ResetMode get_reset_mode() const;
 
+	/**
+	 * @return The reset mode applied to the command buffers, which an adaptive pool chooses
+	 */
+	CommandBuffer::ResetMode get_active_reset_mode() const;
+
+	/**
+	 * @return The counters since the pool was last reset, including the time of that reset
+	 */
+	const CommandPoolCounters &get_counters() const;
+
   private:
 	Device &device;
 
@@ -83,6 +114,27 @@ class CommandPool
 
 	CommandBuffer::ResetMode reset_mode{CommandBuffer::ResetMode::ResetPool};
 
+	CommandBuffer::ResetMode active_reset_mode{CommandBuffer::ResetMode::ResetPool};
+
+	CommandPoolCounters counters;
+
+	/// Index of the mode an adaptive pool measures, past the last mode once one was chosen
+	size_t trial_mode_index{0};
+
+	uint32_t trial_frame_count{0};
+
+	/// Total cost of each mode measured so far, in milliseconds
+	std::array<double, 3> trial_costs{};
+
+	/// Command buffers requested per frame when the mode was chosen
+	uint32_t selected_usage{0};
+
 	VkResult reset_command_buffers();
+
+	/**
+	 * @brief Accounts the cost of the last frame to the mode measured by an adaptive pool,
+	 *        and chooses the mode the pool is reset with
+	 */
+	void update_adaptive_mode();
 };
 }        // namespace vkb
@@ -28,9 +28,11 @@ namespace vkb
 {
 DescriptorPool::DescriptorPool(Device &                   device,
                                const DescriptorSetLayout &descriptor_set_layout,
-                               uint32_t                   pool_size) :
+                               uint32_t                   pool_size,
+                               bool                       free_descriptor_sets) :
     device{device},
-    descriptor_set_layout{&descriptor_set_layout}
+    descriptor_set_layout{&descriptor_set_layout},
+    free_descriptor_sets{free_descriptor_sets}
 {
 	const auto &bindings = descriptor_set_layout.get_bindings();
 
@@ -47,12 +49,12 @@ DescriptorPool::DescriptorPool(Device &                   device,
 
 	auto pool_size_it = pool_sizes.begin();
 
-	// Fill pool size for each descriptor type count multiplied by the pool size
+	// Fill pool size for each descriptor type count, multiplied by the pool size when a pool is created
 	for (auto &it : descriptor_type_counts)
 	{
 		pool_size_it->type = it.first;
 
-		pool_size_it->descriptorCount = it.second * pool_size;
+		pool_size_it->descriptorCount = it.second;
 
 		++pool_size_it;
 	}
@@ -132,6 +134,8 @@ VkDescriptorSet DescriptorPool::allocate()
 
 VkResult DescriptorPool::free(VkDescriptorSet descriptor_set)
 {
+	assert(free_descriptor_sets && "Descriptor pool was not created to free its sets");
+
 	// Get the pool index of the descriptor set
 	auto it = set_pool_mapping.find(descriptor_set);
 
@@ -162,13 +166,33 @@ std::uint32_t DescriptorPool::find_available_pool(std::uint32_t search_index)
 	// Create a new pool
 	if (pools.size() <= search_index)
 	{
+		// Grow geometrically, so that busy layouts need few pools
+		uint32_t max_sets = pool_max_sets;
+
+		if (!pools_max_sets.empty())
+		{
+			max_sets = std::max(max_sets, std::min(pools_max_sets.back() * 2, MAX_SETS_PER_GROWN_POOL));
+		}
+
+		std::vector<VkDescriptorPoolSize> max_pool_sizes{pool_sizes};
+
+		for (auto &max_pool_size : max_pool_sizes)
+		{
+			max_pool_size.descriptorCount *= max_sets;
+		}
+
 		VkDescriptorPoolCreateInfo create_info{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
 
-		// We do not set FREE_DESCRIPTOR_SET_BIT as we do not need to free individual descriptor sets
-		create_info.flags         = 0;
-		create_info.poolSizeCount = to_u32(pool_sizes.size());
-		create_info.pPoolSizes    = pool_sizes.data();
-		create_info.maxSets       = pool_max_sets;
+		// Only the pools whose sets are evicted one by one can free them, the others are reset
+		create_info.flags         = free_descriptor_sets ? VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT : 0;
+		create_info.poolSizeCount = to_u32(max_pool_sizes.size());
+		create_info.pPoolSizes    = max_pool_sizes.data();
+		create_info.maxSets       = max_sets;
+
+		if (get_descriptor_set_layout().is_update_after_bind())
+		{
+			create_info.flags |= VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+		}
 
 		VkDescriptorPool handle = VK_NULL_HANDLE;
 
@@ -186,9 +210,11 @@ std::uint32_t DescriptorPool::find_available_pool(std::uint32_t search_index)
 		// Add set count for the descriptor pool
 		pool_sets_count.push_back(0);
 
+		pools_max_sets.push_back(max_sets);
+
 		return search_index;
 	}
-	else if (pool_sets_count[search_index] < pool_max_sets)
+	else if (pool_sets_count[search_index] < pools_max_sets[search_index])
 	{
 		return search_index;
 	}
@@ -31,16 +31,27 @@ class Device;
 class DescriptorSetLayout;
 
 /**
- * @brief Manages an array of fixed size VkDescriptorPool and is able to allocate descriptor sets
+ * @brief Manages a chain of VkDescriptorPool and is able to allocate descriptor sets.
+ *        Each new pool of the chain holds twice the sets of the previous one, up to MAX_SETS_PER_GROWN_POOL.
  */
 class DescriptorPool
 {
   public:
 	static const uint32_t MAX_SETS_PER_POOL = 16;
 
+	static const uint32_t MAX_SETS_PER_GROWN_POOL = 1024;
+
+	/**
+	 * @param device The device the pools are created on
+	 * @param descriptor_set_layout The layout of the sets allocated
+	 * @param pool_size The number of sets of the first pool
+	 * @param free_descriptor_sets Whether the sets can be freed one by one, which fragments the pools
+	 *        on some drivers. Pools which are only reset do not need it
+	 */
 	DescriptorPool(Device &                   device,
 	               const DescriptorSetLayout &descriptor_set_layout,
-	               uint32_t                   pool_size = MAX_SETS_PER_POOL);
+	               uint32_t                   pool_size            = MAX_SETS_PER_POOL,
+	               bool                       free_descriptor_sets = false);
 
 	DescriptorPool(const DescriptorPool &) = delete;
 
@@ -60,6 +71,9 @@ class DescriptorPool
 
 	VkDescriptorSet allocate();
 
+	/**
+	 * @brief Returns a set to its pool, the pool must have been created to free its sets
+	 */
 	VkResult free(VkDescriptorSet descriptor_set);
 
   private:
@@ -67,15 +81,21 @@ class DescriptorPool
 
 	const DescriptorSetLayout *descriptor_set_layout{nullptr};
 
-	// Descriptor pool size
+	// Descriptor counts of a single set
 	std::vector<VkDescriptorPoolSize> pool_sizes;
 
-	// Number of sets to allocate for each pool
+	// Number of sets to allocate for the first pool
 	uint32_t pool_max_sets{0};
 
+	// Whether the sets can be freed individually
+	bool free_descriptor_sets{false};
+
 	// Total descriptor pools created
 	std::vector<VkDescriptorPool> pools;
 
+	// Number of sets of each pool
+	std::vector<uint32_t> pools_max_sets;
+
 	// Count sets for each pool
 	std::vector<uint32_t> pool_sets_count;
 
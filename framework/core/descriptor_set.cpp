@@ -27,6 +27,106 @@
 
 namespace vkb
 {
+void DescriptorSetInfos::clear()
+{
+	buffer_info_count    = 0;
+	image_info_count     = 0;
+	dynamic_offset_count = 0;
+	hash                 = 0;
+}
+
+void DescriptorSetInfos::add_buffer_info(uint32_t binding, uint32_t array_element, const VkDescriptorBufferInfo &buffer_info)
+{
+	assert(buffer_info_count < MAX_DESCRIPTORS && "Too many buffer descriptors in the set");
+
+	buffer_infos[buffer_info_count++] = {binding, array_element, buffer_info};
+
+	hash_combine(hash, binding);
+	hash_combine(hash, array_element);
+	hash_combine(hash, buffer_info.buffer);
+	hash_combine(hash, buffer_info.offset);
+	hash_combine(hash, buffer_info.range);
+}
+
+void DescriptorSetInfos::add_image_info(uint32_t binding, uint32_t array_element, const VkDescriptorImageInfo &image_info)
+{
+	assert(image_info_count < MAX_DESCRIPTORS && "Too many image descriptors in the set");
+
+	image_infos[image_info_count++] = {binding, array_element, image_info};
+
+	hash_combine(hash, binding);
+	hash_combine(hash, array_element);
+	hash_combine(hash, image_info.sampler);
+	hash_combine(hash, image_info.imageView);
+	hash_combine(hash, static_cast<std::underlying_type<VkImageLayout>::type>(image_info.imageLayout));
+}
+
+void DescriptorSetInfos::add_dynamic_offset(uint32_t dynamic_offset)
+{
+	assert(dynamic_offset_count < MAX_DESCRIPTORS && "Too many dynamic offsets in the set");
+
+	dynamic_offsets[dynamic_offset_count++] = dynamic_offset;
+}
+
+uint32_t DescriptorSetInfos::get_buffer_info_count() const
+{
+	return buffer_info_count;
+}
+
+const DescriptorSetInfos::Entry<VkDescriptorBufferInfo> &DescriptorSetInfos::get_buffer_info(uint32_t index) const
+{
+	return buffer_infos[index];
+}
+
+uint32_t DescriptorSetInfos::get_image_info_count() const
+{
+	return image_info_count;
+}
+
+const DescriptorSetInfos::Entry<VkDescriptorImageInfo> &DescriptorSetInfos::get_image_info(uint32_t index) const
+{
+	return image_infos[index];
+}
+
+uint32_t DescriptorSetInfos::get_dynamic_offset_count() const
+{
+	return dynamic_offset_count;
+}
+
+const uint32_t *DescriptorSetInfos::get_dynamic_offsets() const
+{
+	return dynamic_offsets.data();
+}
+
+std::size_t DescriptorSetInfos::get_hash() const
+{
+	return hash;
+}
+
+BindingMap<VkDescriptorBufferInfo> DescriptorSetInfos::get_buffer_binding_map() const
+{
+	BindingMap<VkDescriptorBufferInfo> binding_map;
+
+	for (uint32_t i = 0; i < buffer_info_count; i++)
+	{
+		binding_map[buffer_infos[i].binding][buffer_infos[i].array_element] = buffer_infos[i].info;
+	}
+
+	return binding_map;
+}
+
+BindingMap<VkDescriptorImageInfo> DescriptorSetInfos::get_image_binding_map() const
+{
+	BindingMap<VkDescriptorImageInfo> binding_map;
+
+	for (uint32_t i = 0; i < image_info_count; i++)
+	{
+		binding_map[image_infos[i].binding][image_infos[i].array_element] = image_infos[i].info;
+	}
+
+	return binding_map;
+}
+
 DescriptorSet::DescriptorSet(Device &                                  device,
                              DescriptorSetLayout &                     descriptor_set_layout,
                              DescriptorPool &                          descriptor_pool,
@@ -43,11 +143,24 @@ DescriptorSet::DescriptorSet(Device &                                  device,
 	}
 }
 
+DescriptorSet::DescriptorSet(Device &                  device,
+                             DescriptorSetLayout &     descriptor_set_layout,
+                             DescriptorPool &          descriptor_pool,
+                             const DescriptorSetInfos &infos) :
+    DescriptorSet{device, descriptor_set_layout, descriptor_pool, infos.get_buffer_binding_map(), infos.get_image_binding_map()}
+{
+}
+
 void DescriptorSet::update(const BindingMap<VkDescriptorBufferInfo> &buffer_infos, const BindingMap<VkDescriptorImageInfo> &image_infos)
 {
 	this->buffer_infos = buffer_infos;
 	this->image_infos  = image_infos;
 
+	if (update_with_template(buffer_infos, image_infos))
+	{
+		return;
+	}
+
 	std::vector<VkWriteDescriptorSet> set_updates;
 
 	// Iterate over all buffer bindings
@@ -117,6 +230,77 @@ void DescriptorSet::update(const BindingMap<VkDescriptorBufferInfo> &buffer_info
 	vkUpdateDescriptorSets(device.get_handle(), to_u32(set_updates.size()), set_updates.data(), 0, nullptr);
 }
 
+bool DescriptorSet::update_with_template(const BindingMap<VkDescriptorBufferInfo> &buffer_infos, const BindingMap<VkDescriptorImageInfo> &image_infos)
+{
+	auto update_template = descriptor_set_layout.get_update_template();
+
+	if (update_template == VK_NULL_HANDLE || !device.uses_descriptor_update_templates())
+	{
+		return false;
+	}
+
+	// Reused across updates, so that writing a set does not allocate
+	thread_local std::vector<DescriptorUpdateInfo> update_infos;
+
+	update_infos.resize(descriptor_set_layout.get_descriptor_count());
+
+	uint32_t written_count = 0;
+
+	auto get_update_info = [this](uint32_t binding, uint32_t array_element) -> DescriptorUpdateInfo * {
+		auto binding_info = descriptor_set_layout.get_layout_binding(binding);
+		auto index        = descriptor_set_layout.get_update_template_index(binding);
+
+		if (!binding_info || index < 0 || array_element >= binding_info->descriptorCount)
+		{
+			return nullptr;
+		}
+
+		return &update_infos[index + array_element];
+	};
+
+	for (auto &binding_it : buffer_infos)
+	{
+		for (auto &element_it : binding_it.second)
+		{
+			auto update_info = get_update_info(binding_it.first, element_it.first);
+
+			if (!update_info)
+			{
+				return false;
+			}
+
+			update_info->buffer_info = element_it.second;
+			++written_count;
+		}
+	}
+
+	for (auto &binding_it : image_infos)
+	{
+		for (auto &element_it : binding_it.second)
+		{
+			auto update_info = get_update_info(binding_it.first, element_it.first);
+
+			if (!update_info)
+			{
+				return false;
+			}
+
+			update_info->image_info = element_it.second;
+			++written_count;
+		}
+	}
+
+	// A template writes every descriptor of the layout, partial updates need descriptor writes
+	if (written_count != update_infos.size())
+	{
+		return false;
+	}
+
+	vkUpdateDescriptorSetWithTemplateKHR(device.get_handle(), handle, update_template, update_infos.data());
+
+	return true;
+}
+
 DescriptorSet::DescriptorSet(DescriptorSet &&other) :
     device{other.device},
     descriptor_set_layout{other.descriptor_set_layout},
@@ -138,6 +322,11 @@ const DescriptorSetLayout &DescriptorSet::get_layout() const
 	return descriptor_set_layout;
 }
 
+DescriptorPool &DescriptorSet::get_pool()
+{
+	return descriptor_pool;
+}
+
 BindingMap<VkDescriptorBufferInfo> &DescriptorSet::get_buffer_infos()
 {
 	return buffer_infos;
@@ -29,6 +29,84 @@ class Device;
 class DescriptorSetLayout;
 class DescriptorPool;
 
+/**
+ * @brief The buffer and image infos written to the descriptors of a set, with the dynamic offsets to bind it with.
+ *        The storage is fixed, so that filling the infos again for every draw does not allocate,
+ *        and their hash is updated as they are added rather than computed from all of them on lookup.
+ */
+class DescriptorSetInfos
+{
+  public:
+	/// The most descriptors of a set, as many as a ResourceSet can hold
+	static const uint32_t MAX_DESCRIPTORS = 64;
+
+	/**
+	 * @brief The info of a descriptor, with where it is written in the set
+	 */
+	template <class T>
+	struct Entry
+	{
+		uint32_t binding;
+
+		uint32_t array_element;
+
+		T info;
+	};
+
+	void clear();
+
+	void add_buffer_info(uint32_t binding, uint32_t array_element, const VkDescriptorBufferInfo &buffer_info);
+
+	void add_image_info(uint32_t binding, uint32_t array_element, const VkDescriptorImageInfo &image_info);
+
+	/**
+	 * @brief Adds the offset of the next dynamic buffer, offsets are not part of the hash as they are not written to the set
+	 */
+	void add_dynamic_offset(uint32_t dynamic_offset);
+
+	uint32_t get_buffer_info_count() const;
+
+	const Entry<VkDescriptorBufferInfo> &get_buffer_info(uint32_t index) const;
+
+	uint32_t get_image_info_count() const;
+
+	const Entry<VkDescriptorImageInfo> &get_image_info(uint32_t index) const;
+
+	uint32_t get_dynamic_offset_count() const;
+
+	const uint32_t *get_dynamic_offsets() const;
+
+	/**
+	 * @return The hash of the buffer and image infos added since the last clear
+	 */
+	std::size_t get_hash() const;
+
+	/**
+	 * @brief Copies the buffer infos to a binding map, only needed to create a new descriptor set
+	 */
+	BindingMap<VkDescriptorBufferInfo> get_buffer_binding_map() const;
+
+	/**
+	 * @brief Copies the image infos to a binding map, only needed to create a new descriptor set
+	 */
+	BindingMap<VkDescriptorImageInfo> get_image_binding_map() const;
+
+  private:
+	std::array<Entry<VkDescriptorBufferInfo>, MAX_DESCRIPTORS> buffer_infos;
+
+	uint32_t buffer_info_count{0};
+
+	std::array<Entry<VkDescriptorImageInfo>, MAX_DESCRIPTORS> image_infos;
+
+	uint32_t image_info_count{0};
+
+	std::array<uint32_t, MAX_DESCRIPTORS> dynamic_offsets;
+
+	uint32_t dynamic_offset_count{0};
+
+	std::size_t hash{0};
+};
+
 /**
  * @brief A descriptor set handle allocated from a \ref DescriptorPool.
  *        Destroying the handle has no effect, as the pool manages the lifecycle of its descriptor sets.
@@ -42,6 +120,11 @@ class DescriptorSet
 	              const BindingMap<VkDescriptorBufferInfo> &buffer_infos = {},
 	              const BindingMap<VkDescriptorImageInfo> & image_infos  = {});
 
+	DescriptorSet(Device &                  device,
+	              DescriptorSetLayout &     descriptor_set_layout,
+	              DescriptorPool &          descriptor_pool,
+	              const DescriptorSetInfos &infos);
+
 	DescriptorSet(const DescriptorSet &) = delete;
 
 	DescriptorSet(DescriptorSet &&other);
@@ -58,6 +141,8 @@ class DescriptorSet
 
 	const DescriptorSetLayout &get_layout() const;
 
+	DescriptorPool &get_pool();
+
 	VkDescriptorSet get_handle() const;
 
 	BindingMap<VkDescriptorBufferInfo> &get_buffer_infos();
@@ -69,6 +154,13 @@ class DescriptorSet
 
 	DescriptorSetLayout &descriptor_set_layout;
 
+	/**
+	 * @brief Writes all the descriptors at once with the update template of the layout
+	 * @returns False if the template cannot be used, because some descriptors are missing
+	 */
+	bool update_with_template(const BindingMap<VkDescriptorBufferInfo> &buffer_infos,
+	                          const BindingMap<VkDescriptorImageInfo> & image_infos);
+
 	DescriptorPool &descriptor_pool;
 
 	BindingMap<VkDescriptorBufferInfo> buffer_infos;
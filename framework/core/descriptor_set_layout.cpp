@@ -71,24 +71,56 @@ inline VkDescriptorType find_descriptor_type(ShaderResourceType resource_type, b
 			break;
 	}
 }
+
+inline bool has_binding_point(const ShaderResource &resource)
+{
+	return resource.type != ShaderResourceType::Input &&
+	       resource.type != ShaderResourceType::Output &&
+	       resource.type != ShaderResourceType::PushConstant &&
+	       resource.type != ShaderResourceType::SpecializationConstant;
+}
 }        // namespace
 
 DescriptorSetLayout::DescriptorSetLayout(Device &device, const std::vector<ShaderResource> &resource_set, bool use_dynamic_resources) :
     device{device}
 {
+	// The whole set is pushed if any of its resources asks for it
+	if (device.is_enabled(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME))
+	{
+		uint32_t total_descriptor_count = 0;
+
+		for (auto &resource : resource_set)
+		{
+			if (has_binding_point(resource))
+			{
+				push_descriptor = push_descriptor || resource.push_descriptor;
+
+				total_descriptor_count += resource.array_size;
+			}
+		}
+
+		if (push_descriptor && total_descriptor_count > MAX_PUSH_DESCRIPTORS)
+		{
+			LOGW("Descriptor set {} has {} descriptors, too many to be pushed", resource_set.front().set, total_descriptor_count);
+
+			push_descriptor = false;
+		}
+	}
+
+	// Binding flags, only chained to the create info when a binding uses one
+	std::vector<VkDescriptorBindingFlagsEXT> binding_flags;
+
 	for (auto &resource : resource_set)
 	{
 		// Skip shader resources whitout a binding point
-		if (resource.type == ShaderResourceType::Input ||
-		    resource.type == ShaderResourceType::Output ||
-		    resource.type == ShaderResourceType::PushConstant ||
-		    resource.type == ShaderResourceType::SpecializationConstant)
+		if (!has_binding_point(resource))
 		{
 			continue;
 		}
 
 		// Convert from ShaderResourceType to VkDescriptorType.
-		auto descriptor_type = find_descriptor_type(resource.type, use_dynamic_resources);
+		// Dynamic descriptors cannot be pushed, their offset is pushed with the descriptor instead
+		auto descriptor_type = find_descriptor_type(resource.type, use_dynamic_resources && !push_descriptor);
 
 		// Convert ShaderResource to VkDescriptorSetLayoutBinding
 		VkDescriptorSetLayoutBinding layout_binding{};
@@ -98,8 +130,28 @@ DescriptorSetLayout::DescriptorSetLayout(Device &device, const std::vector<Shade
 		layout_binding.descriptorType  = descriptor_type;
 		layout_binding.stageFlags      = static_cast<VkShaderStageFlags>(resource.stages);
 
+		if (resource.immutable_sampler != VK_NULL_HANDLE)
+		{
+			// Every descriptor of the binding samples with the same sampler
+			immutable_samplers.emplace_back(resource.array_size, resource.immutable_sampler);
+
+			layout_binding.pImmutableSamplers = immutable_samplers.back().data();
+		}
+
 		bindings.push_back(layout_binding);
 
+		// Push descriptors are written at record time already
+		if (resource.update_after_bind && !push_descriptor && device.is_enabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+		{
+			binding_flags.push_back(VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT);
+
+			update_after_bind = true;
+		}
+		else
+		{
+			binding_flags.push_back(0);
+		}
+
 		// Store mapping between binding and the binding point
 		bindings_lookup.emplace(resource.binding, layout_binding);
 
@@ -111,6 +163,22 @@ DescriptorSetLayout::DescriptorSetLayout(Device &device, const std::vector<Shade
 	create_info.bindingCount = to_u32(bindings.size());
 	create_info.pBindings    = bindings.data();
 
+	if (push_descriptor)
+	{
+		create_info.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT binding_flags_create_info{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT};
+
+	if (update_after_bind)
+	{
+		binding_flags_create_info.bindingCount  = to_u32(binding_flags.size());
+		binding_flags_create_info.pBindingFlags = binding_flags.data();
+
+		create_info.pNext = &binding_flags_create_info;
+		create_info.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	}
+
 	// Create the Vulkan descriptor set layout handle
 	VkResult result = vkCreateDescriptorSetLayout(device.get_handle(), &create_info, nullptr, &handle);
 
@@ -118,6 +186,56 @@ DescriptorSetLayout::DescriptorSetLayout(Device &device, const std::vector<Shade
 	{
 		throw VulkanException{result, "Cannot create DescriptorSetLayout"};
 	}
+
+	for (auto &binding : bindings)
+	{
+		update_template_indices.emplace(binding.binding, descriptor_count);
+
+		descriptor_count += binding.descriptorCount;
+	}
+
+	// Push descriptor layouts never allocate descriptor sets to update
+	if (device.is_enabled(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME) && !bindings.empty() && !push_descriptor)
+	{
+		create_update_template();
+	}
+}
+
+void DescriptorSetLayout::create_update_template()
+{
+	// Each binding reads its descriptors from consecutive DescriptorUpdateInfo
+	std::vector<VkDescriptorUpdateTemplateEntryKHR> entries;
+
+	for (auto &binding : bindings)
+	{
+		VkDescriptorUpdateTemplateEntryKHR entry{};
+
+		entry.dstBinding      = binding.binding;
+		entry.dstArrayElement = 0;
+		entry.descriptorCount = binding.descriptorCount;
+		entry.descriptorType  = binding.descriptorType;
+		entry.offset          = update_template_indices.at(binding.binding) * sizeof(DescriptorUpdateInfo);
+		entry.stride          = sizeof(DescriptorUpdateInfo);
+
+		entries.push_back(entry);
+	}
+
+	VkDescriptorUpdateTemplateCreateInfoKHR create_info{VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR};
+
+	create_info.descriptorUpdateEntryCount = to_u32(entries.size());
+	create_info.pDescriptorUpdateEntries   = entries.data();
+	create_info.templateType               = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+	create_info.descriptorSetLayout        = handle;
+
+	VkResult result = vkCreateDescriptorUpdateTemplateKHR(device.get_handle(), &create_info, nullptr, &update_template);
+
+	if (result != VK_SUCCESS)
+	{
+		// Descriptor sets can still be written one descriptor at a time
+		LOGW("Cannot create descriptor update template ({}), falling back to descriptor writes", to_string(result));
+
+		update_template = VK_NULL_HANDLE;
+	}
 }
 
 DescriptorSetLayout::DescriptorSetLayout(DescriptorSetLayout &&other) :
@@ -125,13 +243,24 @@ DescriptorSetLayout::DescriptorSetLayout(DescriptorSetLayout &&other) :
     handle{other.handle},
     bindings{std::move(other.bindings)},
     bindings_lookup{std::move(other.bindings_lookup)},
-    resources_lookup{std::move(other.resources_lookup)}
+    resources_lookup{std::move(other.resources_lookup)},
+    update_template{other.update_template},
+    update_template_indices{std::move(other.update_template_indices)},
+    descriptor_count{other.descriptor_count},
+    push_descriptor{other.push_descriptor},
+    update_after_bind{other.update_after_bind}
 {
-	other.handle = VK_NULL_HANDLE;
+	other.handle          = VK_NULL_HANDLE;
+	other.update_template = VK_NULL_HANDLE;
 }
 
 DescriptorSetLayout::~DescriptorSetLayout()
 {
+	if (update_template != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorUpdateTemplateKHR(device.get_handle(), update_template, nullptr);
+	}
+
 	// Destroy descriptor set layout
 	if (handle != VK_NULL_HANDLE)
 	{
@@ -149,7 +278,7 @@ const std::vector<VkDescriptorSetLayoutBinding> &DescriptorSetLayout::get_bindin
 	return bindings;
 }
 
-std::unique_ptr<VkDescriptorSetLayoutBinding> DescriptorSetLayout::get_layout_binding(uint32_t binding_index) const
+const VkDescriptorSetLayoutBinding *DescriptorSetLayout::get_layout_binding(uint32_t binding_index) const
 {
 	auto it = bindings_lookup.find(binding_index);
 
@@ -158,10 +287,10 @@ std::unique_ptr<VkDescriptorSetLayoutBinding> DescriptorSetLayout::get_layout_bi
 		return nullptr;
 	}
 
-	return std::make_unique<VkDescriptorSetLayoutBinding>(it->second);
+	return &it->second;
 }
 
-std::unique_ptr<VkDescriptorSetLayoutBinding> DescriptorSetLayout::get_layout_binding(const std::string &name) const
+const VkDescriptorSetLayoutBinding *DescriptorSetLayout::get_layout_binding(const std::string &name) const
 {
 	auto it = resources_lookup.find(name);
 
@@ -172,4 +301,36 @@ std::unique_ptr<VkDescriptorSetLayoutBinding> DescriptorSetLayout::get_layout_bi
 
 	return get_layout_binding(it->second);
 }
+
+VkDescriptorUpdateTemplateKHR DescriptorSetLayout::get_update_template() const
+{
+	return update_template;
+}
+
+uint32_t DescriptorSetLayout::get_descriptor_count() const
+{
+	return descriptor_count;
+}
+
+int32_t DescriptorSetLayout::get_update_template_index(uint32_t binding_index) const
+{
+	auto it = update_template_indices.find(binding_index);
+
+	if (it == update_template_indices.end())
+	{
+		return -1;
+	}
+
+	return static_cast<int32_t>(it->second);
+}
+
+bool DescriptorSetLayout::is_push_descriptor() const
+{
+	return push_descriptor;
+}
+
+bool DescriptorSetLayout::is_update_after_bind() const
+{
+	return update_after_bind;
+}
 }        // namespace vkb
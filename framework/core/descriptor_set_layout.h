@@ -30,6 +30,16 @@ class Device;
 
 struct ShaderResource;
 
+/**
+ * @brief One descriptor of the packed data read by a descriptor update template
+ */
+union DescriptorUpdateInfo
+{
+	VkDescriptorBufferInfo buffer_info;
+
+	VkDescriptorImageInfo image_info;
+};
+
 /**
  * @brief Caches DescriptorSet objects for the shader's set index.
  *        Creates a DescriptorPool to allocate the DescriptorSet objects
@@ -59,9 +69,43 @@ class DescriptorSetLayout
 
 	const std::vector<VkDescriptorSetLayoutBinding> &get_bindings() const;
 
-	std::unique_ptr<VkDescriptorSetLayoutBinding> get_layout_binding(uint32_t binding_index) const;
+	/**
+	 * @return The layout binding at an index, nullptr if the layout has no such binding
+	 */
+	const VkDescriptorSetLayoutBinding *get_layout_binding(uint32_t binding_index) const;
+
+	const VkDescriptorSetLayoutBinding *get_layout_binding(const std::string &name) const;
+
+	/**
+	 * @return The template writing all the descriptors of the layout from an array of
+	 *         DescriptorUpdateInfo, VK_NULL_HANDLE if descriptor update templates are not supported
+	 */
+	VkDescriptorUpdateTemplateKHR get_update_template() const;
 
-	std::unique_ptr<VkDescriptorSetLayoutBinding> get_layout_binding(const std::string &name) const;
+	/**
+	 * @return The total number of descriptors in the layout, the size of the update template data
+	 */
+	uint32_t get_descriptor_count() const;
+
+	/**
+	 * @return The index in the update template data of the first descriptor of a binding, or -1
+	 */
+	int32_t get_update_template_index(uint32_t binding_index) const;
+
+	/**
+	 * @return Whether the layout was created for VK_KHR_push_descriptor, in which case its
+	 *         descriptors are pushed into command buffers instead of allocated from a pool
+	 */
+	bool is_push_descriptor() const;
+
+	/**
+	 * @return Whether some bindings can be written after the descriptor set is bound,
+	 *         in which case the descriptor sets must come from an update-after-bind pool
+	 */
+	bool is_update_after_bind() const;
+
+	/// Minimum number of push descriptors per set supported by all implementations
+	static const uint32_t MAX_PUSH_DESCRIPTORS = 32;
 
   private:
 	Device &device;
@@ -70,8 +114,24 @@ class DescriptorSetLayout
 
 	std::vector<VkDescriptorSetLayoutBinding> bindings;
 
+	/// Storage of the immutable samplers the bindings point to
+	std::vector<std::vector<VkSampler>> immutable_samplers;
+
 	std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings_lookup;
 
 	std::unordered_map<std::string, uint32_t> resources_lookup;
+
+	VkDescriptorUpdateTemplateKHR update_template{VK_NULL_HANDLE};
+
+	/// Index in the update template data of the first descriptor of each binding
+	std::unordered_map<uint32_t, uint32_t> update_template_indices;
+
+	uint32_t descriptor_count{0};
+
+	bool push_descriptor{false};
+
+	bool update_after_bind{false};
+
+	void create_update_template();
 };
 }        // namespace vkb
@@ -20,6 +20,8 @@
 
 #include "device.h"
 
+#include "glsl_compiler.h"
+
 VKBP_DISABLE_WARNINGS()
 #define VMA_IMPLEMENTATION
 #include <vk_mem_alloc.h>
@@ -38,10 +40,46 @@ Device::Device(VkPhysicalDevice physical_device, VkSurfaceKHR surface, std::vect
 		requested_features.textureCompressionASTC_LDR = VK_TRUE;
 	}
 
+	// Pipeline statistics are collected by the GPU profiler when enabled
+	if (features.pipelineStatisticsQuery)
+	{
+		requested_features.pipelineStatisticsQuery = VK_TRUE;
+	}
+
+	// Virtual textures record the pages sampled from the fragment shaders, and bind them sparsely where possible
+	if (features.fragmentStoresAndAtomics)
+	{
+		requested_features.fragmentStoresAndAtomics = VK_TRUE;
+	}
+
+	if (features.sparseBinding && features.sparseResidencyImage2D)
+	{
+		requested_features.sparseBinding          = VK_TRUE;
+		requested_features.sparseResidencyImage2D = VK_TRUE;
+	}
+
 	// Gpu properties
 	vkGetPhysicalDeviceProperties(physical_device, &properties);
 	LOGI("GPU: {}", properties.deviceName);
 
+	// Subgroup operations are core in Vulkan 1.1, which the instance uses whenever the loader supports it
+	if (properties.apiVersion >= VK_API_VERSION_1_1 && volkGetInstanceVersion() >= VK_API_VERSION_1_1 && vkGetPhysicalDeviceProperties2 != nullptr)
+	{
+		VkPhysicalDeviceProperties2 properties2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+		properties2.pNext = &subgroup_properties;
+
+		vkGetPhysicalDeviceProperties2(physical_device, &properties2);
+
+		LOGI("Subgroup size: {}", subgroup_properties.subgroupSize);
+
+		// Shaders using subgroup operations need SPIR-V 1.3
+		GLSLCompiler::set_target_environment(glslang::EShTargetSpv_1_3);
+	}
+	else
+	{
+		GLSLCompiler::set_target_environment(glslang::EShTargetSpv_1_0);
+	}
+
 	uint32_t queue_family_properties_count = 0;
 	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_properties_count, nullptr);
 
@@ -67,7 +105,7 @@ Device::Device(VkPhysicalDevice physical_device, VkSurfaceKHR surface, std::vect
 	// Check extensions to enable Vma Dedicated Allocation
 	uint32_t device_extension_count;
 	VK_CHECK(vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &device_extension_count, nullptr));
-	std::vector<VkExtensionProperties> device_extensions(device_extension_count);
+	device_extensions.resize(device_extension_count);
 	VK_CHECK(vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &device_extension_count, device_extensions.data()));
 
 	bool can_get_memory_requirements = std::find_if(std::begin(device_extensions),
@@ -84,6 +122,427 @@ Device::Device(VkPhysicalDevice physical_device, VkSurfaceKHR surface, std::vect
 		LOGI("Dedicated Allocation enabled");
 	}
 
+	if (is_extension_supported(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME))
+	{
+		extensions.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+		LOGI("Descriptor update templates enabled");
+	}
+
+	if (is_extension_supported(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME))
+	{
+		extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+		LOGI("Push descriptors enabled");
+	}
+
+	if (is_extension_supported(VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME))
+	{
+		extensions.push_back(VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME);
+		LOGI("Display timing enabled");
+	}
+
+	if (is_extension_supported(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME))
+	{
+		extensions.push_back(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+		LOGI("Incremental present enabled");
+	}
+
+	if (is_extension_supported(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME))
+	{
+		extensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+		LOGI("Pipeline creation feedback enabled");
+	}
+
+	if (is_extension_supported(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+	{
+		extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		LOGI("Draw indirect count enabled");
+	}
+
+	// VMA queries the budget with VK_KHR_get_physical_device_properties2 on the instance
+	bool has_memory_budget = is_extension_supported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) && vkGetPhysicalDeviceMemoryProperties2KHR != nullptr;
+
+	if (has_memory_budget)
+	{
+		extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		LOGI("Memory budget enabled");
+	}
+
+	// Chained to the device create info if descriptor indexing is enabled
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT};
+
+	bool has_descriptor_indexing = false;
+
+	// Querying the features needs VK_KHR_get_physical_device_properties2 on the instance
+	if (is_extension_supported(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_MAINTENANCE3_EXTENSION_NAME) &&
+	    vkGetPhysicalDeviceFeatures2KHR != nullptr)
+	{
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT};
+
+		VkPhysicalDeviceFeatures2KHR features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
+		features.pNext = &supported_features;
+
+		vkGetPhysicalDeviceFeatures2KHR(physical_device, &features);
+
+		// Features needed by update-after-bind texture arrays
+		if (supported_features.runtimeDescriptorArray &&
+		    supported_features.descriptorBindingPartiallyBound &&
+		    supported_features.descriptorBindingSampledImageUpdateAfterBind)
+		{
+			descriptor_indexing_features.runtimeDescriptorArray                       = VK_TRUE;
+			descriptor_indexing_features.descriptorBindingPartiallyBound              = VK_TRUE;
+			descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+
+			extensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+			extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+			has_descriptor_indexing = true;
+			LOGI("Descriptor indexing enabled");
+		}
+	}
+
+	// Chained to the device create info if timeline semaphores are enabled
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_semaphore_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR};
+
+	bool has_timeline_semaphore = false;
+
+	if (is_extension_supported(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) &&
+	    vkGetPhysicalDeviceFeatures2KHR != nullptr)
+	{
+		VkPhysicalDeviceTimelineSemaphoreFeaturesKHR supported_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR};
+
+		VkPhysicalDeviceFeatures2KHR features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
+		features.pNext = &supported_features;
+
+		vkGetPhysicalDeviceFeatures2KHR(physical_device, &features);
+
+		if (supported_features.timelineSemaphore)
+		{
+			timeline_semaphore_features.timelineSemaphore = VK_TRUE;
+
+			extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+			has_timeline_semaphore = true;
+			LOGI("Timeline semaphores enabled");
+		}
+	}
+
+	// Chained to the device create info if extended dynamic state is enabled
+	VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extended_dynamic_state_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT};
+
+	bool has_extended_dynamic_state = false;
+
+	if (is_extension_supported(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME) &&
+	    vkGetPhysicalDeviceFeatures2KHR != nullptr)
+	{
+		VkPhysicalDeviceExtendedDynamicStateFeaturesEXT supported_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT};
+
+		VkPhysicalDeviceFeatures2KHR features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
+		features.pNext = &supported_features;
+
+		vkGetPhysicalDeviceFeatures2KHR(physical_device, &features);
+
+		if (supported_features.extendedDynamicState)
+		{
+			extended_dynamic_state_features.extendedDynamicState = VK_TRUE;
+
+			extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+			has_extended_dynamic_state = true;
+			LOGI("Extended dynamic state enabled");
+		}
+	}
+
+	// Chained to the device create info if imageless framebuffers are enabled
+	VkPhysicalDeviceImagelessFramebufferFeaturesKHR imageless_framebuffer_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGELESS_FRAMEBUFFER_FEATURES_KHR};
+
+	if (is_extension_supported(VK_KHR_IMAGELESS_FRAMEBUFFER_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_MAINTENANCE2_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_IMAGE_FORMAT_LIST_EXTENSION_NAME) &&
+	    vkGetPhysicalDeviceFeatures2KHR != nullptr)
+	{
+		VkPhysicalDeviceImagelessFramebufferFeaturesKHR supported_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGELESS_FRAMEBUFFER_FEATURES_KHR};
+
+		VkPhysicalDeviceFeatures2KHR features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
+		features.pNext = &supported_features;
+
+		vkGetPhysicalDeviceFeatures2KHR(physical_device, &features);
+
+		if (supported_features.imagelessFramebuffer)
+		{
+			imageless_framebuffer_features.imagelessFramebuffer = VK_TRUE;
+
+			extensions.push_back(VK_KHR_MAINTENANCE2_EXTENSION_NAME);
+			extensions.push_back(VK_KHR_IMAGE_FORMAT_LIST_EXTENSION_NAME);
+			extensions.push_back(VK_KHR_IMAGELESS_FRAMEBUFFER_EXTENSION_NAME);
+			imageless_framebuffer = true;
+			LOGI("Imageless framebuffers enabled");
+		}
+	}
+
+	// Chained to the device create info if 16-bit float arithmetic is enabled
+	VkPhysicalDeviceFloat16Int8FeaturesKHR float16_int8_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FLOAT16_INT8_FEATURES_KHR};
+
+	if (is_extension_supported(VK_KHR_SHADER_FLOAT16_INT8_EXTENSION_NAME) &&
+	    vkGetPhysicalDeviceFeatures2KHR != nullptr)
+	{
+		VkPhysicalDeviceFloat16Int8FeaturesKHR supported_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FLOAT16_INT8_FEATURES_KHR};
+
+		VkPhysicalDeviceFeatures2KHR features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
+		features.pNext = &supported_features;
+
+		vkGetPhysicalDeviceFeatures2KHR(physical_device, &features);
+
+		if (supported_features.shaderFloat16)
+		{
+			float16_int8_features.shaderFloat16 = VK_TRUE;
+
+			extensions.push_back(VK_KHR_SHADER_FLOAT16_INT8_EXTENSION_NAME);
+			shader_float16 = true;
+			LOGI("16-bit float arithmetic enabled");
+		}
+	}
+
+	// Chained to the device create info if 16-bit storage is enabled
+	VkPhysicalDevice16BitStorageFeaturesKHR storage_16bit_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES_KHR};
+
+	if (is_extension_supported(VK_KHR_16BIT_STORAGE_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_STORAGE_BUFFER_STORAGE_CLASS_EXTENSION_NAME) &&
+	    vkGetPhysicalDeviceFeatures2KHR != nullptr)
+	{
+		VkPhysicalDevice16BitStorageFeaturesKHR supported_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES_KHR};
+
+		VkPhysicalDeviceFeatures2KHR features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
+		features.pNext = &supported_features;
+
+		vkGetPhysicalDeviceFeatures2KHR(physical_device, &features);
+
+		if (supported_features.storageBuffer16BitAccess)
+		{
+			storage_16bit_features.storageBuffer16BitAccess           = VK_TRUE;
+			storage_16bit_features.uniformAndStorageBuffer16BitAccess = supported_features.uniformAndStorageBuffer16BitAccess;
+			storage_16bit_features.storagePushConstant16              = supported_features.storagePushConstant16;
+
+			extensions.push_back(VK_KHR_STORAGE_BUFFER_STORAGE_CLASS_EXTENSION_NAME);
+			extensions.push_back(VK_KHR_16BIT_STORAGE_EXTENSION_NAME);
+			storage_16bit = true;
+			LOGI("16-bit storage enabled");
+		}
+	}
+
+	// The extension is left disabled when building against headers which do not declare it
+#if defined(VK_EXT_rasterization_order_attachment_access)
+	// Chained to the device create info if attachments can be read in rasterization order, both color and depth are needed
+	VkPhysicalDeviceRasterizationOrderAttachmentAccessFeaturesEXT rasterization_order_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RASTERIZATION_ORDER_ATTACHMENT_ACCESS_FEATURES_EXT};
+
+	bool has_rasterization_order_access = false;
+
+	if (is_extension_supported(VK_EXT_RASTERIZATION_ORDER_ATTACHMENT_ACCESS_EXTENSION_NAME) &&
+	    vkGetPhysicalDeviceFeatures2KHR != nullptr)
+	{
+		VkPhysicalDeviceRasterizationOrderAttachmentAccessFeaturesEXT supported_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RASTERIZATION_ORDER_ATTACHMENT_ACCESS_FEATURES_EXT};
+
+		VkPhysicalDeviceFeatures2KHR features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
+		features.pNext = &supported_features;
+
+		vkGetPhysicalDeviceFeatures2KHR(physical_device, &features);
+
+		if (supported_features.rasterizationOrderColorAttachmentAccess && supported_features.rasterizationOrderDepthAttachmentAccess)
+		{
+			rasterization_order_features.rasterizationOrderColorAttachmentAccess = VK_TRUE;
+			rasterization_order_features.rasterizationOrderDepthAttachmentAccess = VK_TRUE;
+
+			extensions.push_back(VK_EXT_RASTERIZATION_ORDER_ATTACHMENT_ACCESS_EXTENSION_NAME);
+			has_rasterization_order_access = true;
+			LOGI("Rasterization order attachment access enabled");
+		}
+	}
+#endif
+
+	// Chained to the device create info if subpasses can broadcast their draws to the layers of their attachments
+	VkPhysicalDeviceMultiviewFeaturesKHR multiview_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES_KHR};
+
+	if (is_extension_supported(VK_KHR_MULTIVIEW_EXTENSION_NAME) &&
+	    vkGetPhysicalDeviceFeatures2KHR != nullptr && vkGetPhysicalDeviceProperties2KHR != nullptr)
+	{
+		VkPhysicalDeviceMultiviewFeaturesKHR supported_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES_KHR};
+
+		VkPhysicalDeviceFeatures2KHR features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
+		features.pNext = &supported_features;
+
+		vkGetPhysicalDeviceFeatures2KHR(physical_device, &features);
+
+		if (supported_features.multiview)
+		{
+			multiview_features.multiview = VK_TRUE;
+
+			VkPhysicalDeviceProperties2KHR properties2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR};
+			properties2.pNext = &multiview_properties;
+
+			vkGetPhysicalDeviceProperties2KHR(physical_device, &properties2);
+
+			extensions.push_back(VK_KHR_MULTIVIEW_EXTENSION_NAME);
+			multiview = true;
+			LOGI("Multiview enabled, up to {} views", multiview_properties.maxMultiviewViewCount);
+		}
+	}
+
+	// Chained to the device create info if the shading rate can be coarser than a pixel, subpasses using
+	// a shading rate attachment are created with VK_KHR_create_renderpass2 to reference it
+	VkPhysicalDeviceFragmentShadingRateFeaturesKHR fragment_shading_rate_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_FEATURES_KHR};
+
+	if (is_extension_supported(VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_MULTIVIEW_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_MAINTENANCE2_EXTENSION_NAME) &&
+	    vkGetPhysicalDeviceFeatures2KHR != nullptr && vkGetPhysicalDeviceProperties2KHR != nullptr)
+	{
+		VkPhysicalDeviceFragmentShadingRateFeaturesKHR supported_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_FEATURES_KHR};
+
+		VkPhysicalDeviceFeatures2KHR features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
+		features.pNext = &supported_features;
+
+		vkGetPhysicalDeviceFeatures2KHR(physical_device, &features);
+
+		if (supported_features.pipelineFragmentShadingRate)
+		{
+			fragment_shading_rate_features.pipelineFragmentShadingRate   = VK_TRUE;
+			fragment_shading_rate_features.attachmentFragmentShadingRate = supported_features.attachmentFragmentShadingRate;
+
+			VkPhysicalDeviceProperties2KHR properties2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR};
+			properties2.pNext = &fragment_shading_rate_properties;
+
+			vkGetPhysicalDeviceProperties2KHR(physical_device, &properties2);
+
+			// VK_KHR_maintenance2 may be enabled for imageless framebuffers already, and VK_KHR_multiview for multiview
+			if (!imageless_framebuffer)
+			{
+				extensions.push_back(VK_KHR_MAINTENANCE2_EXTENSION_NAME);
+			}
+			if (!multiview)
+			{
+				extensions.push_back(VK_KHR_MULTIVIEW_EXTENSION_NAME);
+			}
+			extensions.push_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+			extensions.push_back(VK_KHR_FRAGMENT_SHADING_RATE_EXTENSION_NAME);
+			fragment_shading_rate   = true;
+			shading_rate_attachment = supported_features.attachmentFragmentShadingRate == VK_TRUE;
+			LOGI("Fragment shading rate enabled{}", shading_rate_attachment ? ", with attachments" : "");
+		}
+	}
+
+	// Render passes are never dynamic when building against headers which do not declare the extension
+#if defined(VK_KHR_dynamic_rendering)
+	// Chained to the device create info if passes of a single subpass can begin without render pass and framebuffer objects
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR};
+
+	if (is_extension_supported(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_MULTIVIEW_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_MAINTENANCE2_EXTENSION_NAME) &&
+	    vkGetPhysicalDeviceFeatures2KHR != nullptr)
+	{
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR supported_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR};
+
+		VkPhysicalDeviceFeatures2KHR features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
+		features.pNext = &supported_features;
+
+		vkGetPhysicalDeviceFeatures2KHR(physical_device, &features);
+
+		if (supported_features.dynamicRendering)
+		{
+			dynamic_rendering_features.dynamicRendering = VK_TRUE;
+
+			// The dependencies may be enabled for imageless framebuffers, multiview or the fragment shading rate already
+			if (!imageless_framebuffer && !fragment_shading_rate)
+			{
+				extensions.push_back(VK_KHR_MAINTENANCE2_EXTENSION_NAME);
+			}
+			if (!multiview && !fragment_shading_rate)
+			{
+				extensions.push_back(VK_KHR_MULTIVIEW_EXTENSION_NAME);
+			}
+			if (!fragment_shading_rate)
+			{
+				extensions.push_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+			}
+			extensions.push_back(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+			extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+			dynamic_rendering = true;
+			LOGI("Dynamic rendering enabled");
+		}
+	}
+#endif
+
+	// Chained to the device create info if performance counters can be queried, their queries are reset from the host
+	VkPhysicalDevicePerformanceQueryFeaturesKHR performance_query_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PERFORMANCE_QUERY_FEATURES_KHR};
+	VkPhysicalDeviceHostQueryResetFeaturesEXT   host_query_reset_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES_EXT};
+
+	bool has_performance_query = false;
+
+	if (is_extension_supported(VK_KHR_PERFORMANCE_QUERY_EXTENSION_NAME) &&
+	    is_extension_supported(VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME) &&
+	    vkGetPhysicalDeviceFeatures2KHR != nullptr)
+	{
+		VkPhysicalDevicePerformanceQueryFeaturesKHR supported_performance_query{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PERFORMANCE_QUERY_FEATURES_KHR};
+		VkPhysicalDeviceHostQueryResetFeaturesEXT   supported_host_query_reset{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES_EXT};
+		supported_performance_query.pNext = &supported_host_query_reset;
+
+		VkPhysicalDeviceFeatures2KHR features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
+		features.pNext = &supported_performance_query;
+
+		vkGetPhysicalDeviceFeatures2KHR(physical_device, &features);
+
+		if (supported_performance_query.performanceCounterQueryPools && supported_host_query_reset.hostQueryReset)
+		{
+			performance_query_features.performanceCounterQueryPools = VK_TRUE;
+			host_query_reset_features.hostQueryReset                = VK_TRUE;
+			performance_query_features.pNext                        = &host_query_reset_features;
+
+			extensions.push_back(VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME);
+			extensions.push_back(VK_KHR_PERFORMANCE_QUERY_EXTENSION_NAME);
+			has_performance_query = true;
+			LOGI("Performance queries enabled");
+		}
+	}
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+	// Chained to the device create info if hardware buffers can be imported, their YUV formats are sampled through a conversion
+	VkPhysicalDeviceSamplerYcbcrConversionFeaturesKHR ycbcr_conversion_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SAMPLER_YCBCR_CONVERSION_FEATURES_KHR};
+
+	bool has_hardware_buffer_import = false;
+
+	if (is_extension_supported(VK_ANDROID_EXTERNAL_MEMORY_ANDROID_HARDWARE_BUFFER_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_SAMPLER_YCBCR_CONVERSION_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME) &&
+	    is_extension_supported(VK_EXT_QUEUE_FAMILY_FOREIGN_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_MAINTENANCE1_EXTENSION_NAME) &&
+	    is_extension_supported(VK_KHR_BIND_MEMORY_2_EXTENSION_NAME) &&
+	    can_get_memory_requirements && has_dedicated_allocation &&
+	    vkGetPhysicalDeviceFeatures2KHR != nullptr)
+	{
+		VkPhysicalDeviceSamplerYcbcrConversionFeaturesKHR supported_features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SAMPLER_YCBCR_CONVERSION_FEATURES_KHR};
+
+		VkPhysicalDeviceFeatures2KHR features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR};
+		features.pNext = &supported_features;
+
+		vkGetPhysicalDeviceFeatures2KHR(physical_device, &features);
+
+		if (supported_features.samplerYcbcrConversion)
+		{
+			ycbcr_conversion_features.samplerYcbcrConversion = VK_TRUE;
+
+			// VK_KHR_get_memory_requirements2 and VK_KHR_dedicated_allocation are enabled for VMA already
+			extensions.push_back(VK_KHR_MAINTENANCE1_EXTENSION_NAME);
+			extensions.push_back(VK_KHR_BIND_MEMORY_2_EXTENSION_NAME);
+			extensions.push_back(VK_KHR_SAMPLER_YCBCR_CONVERSION_EXTENSION_NAME);
+			extensions.push_back(VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME);
+			extensions.push_back(VK_EXT_QUEUE_FAMILY_FOREIGN_EXTENSION_NAME);
+			extensions.push_back(VK_ANDROID_EXTERNAL_MEMORY_ANDROID_HARDWARE_BUFFER_EXTENSION_NAME);
+			has_hardware_buffer_import = true;
+			LOGI("Hardware buffer import enabled");
+		}
+	}
+#endif
+
 	VkDeviceCreateInfo create_info{VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
 
 	create_info.pQueueCreateInfos       = queue_create_infos.data();
@@ -92,6 +551,84 @@ Device::Device(VkPhysicalDevice physical_device, VkSurfaceKHR surface, std::vect
 	create_info.enabledExtensionCount   = to_u32(extensions.size());
 	create_info.ppEnabledExtensionNames = extensions.data();
 
+	if (has_descriptor_indexing)
+	{
+		descriptor_indexing_features.pNext = const_cast<void *>(create_info.pNext);
+		create_info.pNext                  = &descriptor_indexing_features;
+	}
+
+	if (has_timeline_semaphore)
+	{
+		timeline_semaphore_features.pNext = const_cast<void *>(create_info.pNext);
+		create_info.pNext                 = &timeline_semaphore_features;
+	}
+
+	if (has_extended_dynamic_state)
+	{
+		extended_dynamic_state_features.pNext = const_cast<void *>(create_info.pNext);
+		create_info.pNext                     = &extended_dynamic_state_features;
+	}
+
+	if (imageless_framebuffer)
+	{
+		imageless_framebuffer_features.pNext = const_cast<void *>(create_info.pNext);
+		create_info.pNext                    = &imageless_framebuffer_features;
+	}
+
+#if defined(VK_KHR_dynamic_rendering)
+	if (dynamic_rendering)
+	{
+		dynamic_rendering_features.pNext = const_cast<void *>(create_info.pNext);
+		create_info.pNext                = &dynamic_rendering_features;
+	}
+#endif
+
+	if (shader_float16)
+	{
+		float16_int8_features.pNext = const_cast<void *>(create_info.pNext);
+		create_info.pNext           = &float16_int8_features;
+	}
+
+	if (storage_16bit)
+	{
+		storage_16bit_features.pNext = const_cast<void *>(create_info.pNext);
+		create_info.pNext            = &storage_16bit_features;
+	}
+
+#if defined(VK_EXT_rasterization_order_attachment_access)
+	if (has_rasterization_order_access)
+	{
+		rasterization_order_features.pNext = const_cast<void *>(create_info.pNext);
+		create_info.pNext                  = &rasterization_order_features;
+	}
+#endif
+
+	if (multiview)
+	{
+		multiview_features.pNext = const_cast<void *>(create_info.pNext);
+		create_info.pNext        = &multiview_features;
+	}
+
+	if (fragment_shading_rate)
+	{
+		fragment_shading_rate_features.pNext = const_cast<void *>(create_info.pNext);
+		create_info.pNext                    = &fragment_shading_rate_features;
+	}
+
+	if (has_performance_query)
+	{
+		host_query_reset_features.pNext = const_cast<void *>(create_info.pNext);
+		create_info.pNext               = &performance_query_features;
+	}
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+	if (has_hardware_buffer_import)
+	{
+		ycbcr_conversion_features.pNext = const_cast<void *>(create_info.pNext);
+		create_info.pNext               = &ycbcr_conversion_features;
+	}
+#endif
+
 	VkResult result = vkCreateDevice(physical_device, &create_info, nullptr, &handle);
 
 	if (result != VK_SUCCESS)
@@ -99,6 +636,8 @@ Device::Device(VkPhysicalDevice physical_device, VkSurfaceKHR surface, std::vect
 		throw VulkanException{result, "Cannot create device"};
 	}
 
+	enabled_extensions = {extensions.begin(), extensions.end()};
+
 	queues.resize(queue_family_properties_count);
 
 	for (uint32_t queue_family_index = 0U; queue_family_index < queue_family_properties_count; ++queue_family_index)
@@ -123,6 +662,7 @@ Device::Device(VkPhysicalDevice physical_device, VkSurfaceKHR surface, std::vect
 	vma_vulkan_func.vkAllocateMemory                    = vkAllocateMemory;
 	vma_vulkan_func.vkBindBufferMemory                  = vkBindBufferMemory;
 	vma_vulkan_func.vkBindImageMemory                   = vkBindImageMemory;
+	vma_vulkan_func.vkCmdCopyBuffer                     = vkCmdCopyBuffer;
 	vma_vulkan_func.vkCreateBuffer                      = vkCreateBuffer;
 	vma_vulkan_func.vkCreateImage                       = vkCreateImage;
 	vma_vulkan_func.vkDestroyBuffer                     = vkDestroyBuffer;
@@ -148,6 +688,13 @@ Device::Device(VkPhysicalDevice physical_device, VkSurfaceKHR surface, std::vect
 		vma_vulkan_func.vkGetImageMemoryRequirements2KHR  = vkGetImageMemoryRequirements2KHR;
 	}
 
+	if (has_memory_budget)
+	{
+		allocator_info.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+		allocator_info.instance = volkGetLoadedInstance();
+		vma_vulkan_func.vkGetPhysicalDeviceMemoryProperties2KHR = vkGetPhysicalDeviceMemoryProperties2KHR;
+	}
+
 	allocator_info.pVulkanFunctions = &vma_vulkan_func;
 
 	result = vmaCreateAllocator(&allocator_info, &memory_allocator);
@@ -157,16 +704,42 @@ Device::Device(VkPhysicalDevice physical_device, VkSurfaceKHR surface, std::vect
 		throw VulkanException{result, "Cannot create allocator"};
 	}
 
+	memory_pools = std::make_unique<MemoryPools>(memory_allocator);
+
 	command_pool = std::make_unique<CommandPool>(*this, get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT, 0).get_family_index());
 	fence_pool   = std::make_unique<FencePool>(*this);
+
+	buffer_block_free_list = std::make_unique<BufferBlockFreeList>();
+
+	workgroup_tuner = std::make_unique<WorkgroupTuner>(*this);
+
+	memory_budget_callback = [](uint32_t heap_index, const HeapBudget &heap_budget) {
+		LOGW("Memory heap {} is nearing its budget: {} of {} MiB used", heap_index,
+		     heap_budget.usage / (1024 * 1024), heap_budget.budget / (1024 * 1024));
+	};
+
+	update_memory_budget(0);
+
+	set_format_policy(format_policy);
 }
 
 Device::~Device()
 {
+	release_profiling_lock();
+
 	resource_cache.clear();
 
+	// The device is idle, the resources released by the last frames can go
+	deletion_queue.flush();
+
+	// After the deletion queue, which reads back the timestamps of the last tuned dispatches
+	workgroup_tuner.reset();
+
 	command_pool.reset();
 	fence_pool.reset();
+	buffer_block_free_list.reset();
+
+	memory_pools.reset();
 
 	if (memory_allocator != VK_NULL_HANDLE)
 	{
@@ -296,6 +869,32 @@ const Queue &Device::get_suitable_graphics_queue()
 	return get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
 }
 
+const Queue &Device::get_async_compute_queue()
+{
+	for (uint32_t queue_family_index = 0U; queue_family_index < queues.size(); ++queue_family_index)
+	{
+		Queue &first_queue = queues[queue_family_index][0];
+
+		VkQueueFlags queue_flags = first_queue.get_properties().queueFlags;
+
+		if ((queue_flags & VK_QUEUE_COMPUTE_BIT) && !(queue_flags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			return first_queue;
+		}
+	}
+
+	auto &graphics_queue = get_suitable_graphics_queue();
+
+	auto &family_queues = queues[graphics_queue.get_family_index()];
+
+	if ((graphics_queue.get_properties().queueFlags & VK_QUEUE_COMPUTE_BIT) && family_queues.size() > 1)
+	{
+		return family_queues[1];
+	}
+
+	return get_queue_by_flags(VK_QUEUE_COMPUTE_BIT, 0);
+}
+
 CommandBuffer &Device::request_command_buffer()
 {
 	return command_pool->request_command_buffer();
@@ -315,4 +914,284 @@ ResourceCache &Device::get_resource_cache()
 {
 	return resource_cache;
 }
+
+DeletionQueue &Device::get_deletion_queue()
+{
+	return deletion_queue;
+}
+
+MemoryPools &Device::get_memory_pools()
+{
+	return *memory_pools;
+}
+
+PerfLint &Device::get_perf_lint()
+{
+	return perf_lint;
+}
+
+bool Device::is_extension_supported(const std::string &extension) const
+{
+	return std::find_if(device_extensions.begin(), device_extensions.end(),
+	                    [&extension](const VkExtensionProperties &device_extension) { return extension == device_extension.extensionName; }) != device_extensions.end();
+}
+
+bool Device::is_enabled(const char *extension) const
+{
+	return std::find_if(enabled_extensions.begin(), enabled_extensions.end(),
+	                    [extension](const std::string &enabled_extension) { return enabled_extension == extension; }) != enabled_extensions.end();
+}
+
+void Device::set_descriptor_update_templates(bool enable)
+{
+	descriptor_update_templates = enable;
+}
+
+bool Device::uses_descriptor_update_templates() const
+{
+	return descriptor_update_templates && is_enabled(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+}
+
+bool Device::uses_imageless_framebuffers() const
+{
+	return imageless_framebuffer;
+}
+
+bool Device::uses_dynamic_rendering() const
+{
+	return dynamic_rendering;
+}
+
+void Device::set_extended_dynamic_state(bool enable)
+{
+	extended_dynamic_state = enable;
+}
+
+bool Device::uses_extended_dynamic_state() const
+{
+	return extended_dynamic_state && is_enabled(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+}
+
+void Device::set_format_policy(FormatPolicy policy)
+{
+	format_policy = policy;
+
+	depth_format = get_suitable_depth_format(physical_device, get_depth_format_priority_list(policy));
+
+	if (depth_format == VK_FORMAT_UNDEFINED)
+	{
+		throw std::runtime_error("No suitable depth format could be determined");
+	}
+}
+
+FormatPolicy Device::get_format_policy() const
+{
+	return format_policy;
+}
+
+VkFormat Device::get_depth_format() const
+{
+	return depth_format;
+}
+
+void Device::update_memory_budget(uint64_t frame_number)
+{
+	// The budget of VK_EXT_memory_budget is fetched again when the frame index changes
+	vmaSetCurrentFrameIndex(memory_allocator, static_cast<uint32_t>(frame_number));
+
+	const VkPhysicalDeviceMemoryProperties *memory_properties{nullptr};
+	vmaGetMemoryProperties(memory_allocator, &memory_properties);
+
+	std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets{};
+	vmaGetBudget(memory_allocator, budgets.data());
+
+	heap_budgets.resize(memory_properties->memoryHeapCount);
+	heaps_over_budget_threshold.resize(memory_properties->memoryHeapCount, false);
+
+	for (uint32_t i = 0; i < memory_properties->memoryHeapCount; ++i)
+	{
+		heap_budgets[i].usage  = budgets[i].usage;
+		heap_budgets[i].budget = budgets[i].budget;
+
+		bool over_threshold = heap_budgets[i].usage > memory_budget_threshold * heap_budgets[i].budget;
+
+		if (over_threshold && !heaps_over_budget_threshold[i] && memory_budget_callback)
+		{
+			memory_budget_callback(i, heap_budgets[i]);
+		}
+
+		heaps_over_budget_threshold[i] = over_threshold;
+	}
+}
+
+const std::vector<HeapBudget> &Device::get_heap_budgets() const
+{
+	return heap_budgets;
+}
+
+void Device::set_memory_budget_callback(float threshold, MemoryBudgetCallback callback)
+{
+	memory_budget_threshold = threshold;
+	memory_budget_callback  = std::move(callback);
+}
+
+void Device::add_allocation(AllocationCategory category)
+{
+	++allocation_counts[static_cast<size_t>(category)];
+}
+
+void Device::remove_allocation(AllocationCategory category)
+{
+	--allocation_counts[static_cast<size_t>(category)];
+}
+
+uint32_t Device::get_allocation_count(AllocationCategory category) const
+{
+	return allocation_counts[static_cast<size_t>(category)];
+}
+
+void Device::set_debug_utils(bool enable)
+{
+	debug_utils = enable;
+}
+
+bool Device::uses_debug_utils() const
+{
+	return !perf_build && debug_utils;
+}
+
+void Device::set_debug_name(VkObjectType object_type, uint64_t object_handle, const std::string &name) const
+{
+	if (!debug_utils || name.empty())
+	{
+		return;
+	}
+
+	VkDebugUtilsObjectNameInfoEXT name_info{VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
+	name_info.objectType   = object_type;
+	name_info.objectHandle = object_handle;
+	name_info.pObjectName  = name.c_str();
+
+	vkSetDebugUtilsObjectNameEXT(handle, &name_info);
+}
+
+const VkPhysicalDeviceSubgroupProperties &Device::get_subgroup_properties() const
+{
+	return subgroup_properties;
+}
+
+bool Device::supports_subgroup_operations(VkShaderStageFlagBits stage, VkSubgroupFeatureFlags operations) const
+{
+	return (subgroup_properties.supportedStages & stage) && (subgroup_properties.supportedOperations & operations) == operations;
+}
+
+bool Device::supports_shader_float16() const
+{
+	return shader_float16;
+}
+
+bool Device::acquire_profiling_lock()
+{
+	if (profiling_lock || !is_enabled(VK_KHR_PERFORMANCE_QUERY_EXTENSION_NAME))
+	{
+		return profiling_lock;
+	}
+
+	VkAcquireProfilingLockInfoKHR lock_info{VK_STRUCTURE_TYPE_ACQUIRE_PROFILING_LOCK_INFO_KHR};
+	lock_info.timeout = UINT64_MAX;
+
+	VkResult result = vkAcquireProfilingLockKHR(handle, &lock_info);
+
+	if (result != VK_SUCCESS)
+	{
+		LOGW("Cannot acquire the profiling lock: {}", to_string(result));
+		return false;
+	}
+
+	profiling_lock = true;
+
+	return true;
+}
+
+void Device::release_profiling_lock()
+{
+	if (profiling_lock)
+	{
+		vkReleaseProfilingLockKHR(handle);
+
+		profiling_lock = false;
+	}
+}
+
+bool Device::supports_16bit_storage() const
+{
+	return storage_16bit;
+}
+
+bool Device::supports_fragment_shading_rate() const
+{
+	return fragment_shading_rate;
+}
+
+bool Device::supports_shading_rate_attachment() const
+{
+	return shading_rate_attachment;
+}
+
+const VkPhysicalDeviceFragmentShadingRatePropertiesKHR &Device::get_fragment_shading_rate_properties() const
+{
+	return fragment_shading_rate_properties;
+}
+
+bool Device::supports_multiview() const
+{
+	return multiview;
+}
+
+uint32_t Device::get_max_multiview_view_count() const
+{
+	return multiview ? multiview_properties.maxMultiviewViewCount : 1U;
+}
+
+std::vector<std::string> Device::get_capability_defines(VkShaderStageFlagBits stage) const
+{
+	static const std::vector<std::pair<VkSubgroupFeatureFlagBits, const char *>> subgroup_defines = {
+	    {VK_SUBGROUP_FEATURE_BASIC_BIT, "HAS_SUBGROUP_BASIC"},
+	    {VK_SUBGROUP_FEATURE_VOTE_BIT, "HAS_SUBGROUP_VOTE"},
+	    {VK_SUBGROUP_FEATURE_ARITHMETIC_BIT, "HAS_SUBGROUP_ARITHMETIC"},
+	    {VK_SUBGROUP_FEATURE_BALLOT_BIT, "HAS_SUBGROUP_BALLOT"},
+	    {VK_SUBGROUP_FEATURE_SHUFFLE_BIT, "HAS_SUBGROUP_SHUFFLE"}};
+
+	std::vector<std::string> defines;
+
+	for (auto &subgroup_define : subgroup_defines)
+	{
+		if (supports_subgroup_operations(stage, subgroup_define.first))
+		{
+			defines.push_back(subgroup_define.second);
+		}
+	}
+
+	if (shader_float16)
+	{
+		defines.push_back("HAS_FP16");
+	}
+
+	if (storage_16bit)
+	{
+		defines.push_back("HAS_16BIT_STORAGE");
+	}
+
+	return defines;
+}
+
+BufferBlockFreeList &Device::get_buffer_block_free_list()
+{
+	return *buffer_block_free_list;
+}
+
+WorkgroupTuner &Device::get_workgroup_tuner()
+{
+	return *workgroup_tuner;
+}
 }        // namespace vkb
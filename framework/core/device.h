@@ -20,6 +20,11 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <functional>
+
+#include "buffer_pool.h"
 #include "common/helpers.h"
 #include "common/logging.h"
 #include "common/vk_common.h"
@@ -35,10 +40,14 @@
 #include "core/render_pass.h"
 #include "core/shader_module.h"
 #include "core/swapchain.h"
+#include "deletion_queue.h"
+#include "memory_pools.h"
+#include "perf_lint.h"
 #include "fence_pool.h"
 #include "rendering/pipeline_state.h"
 #include "rendering/render_target.h"
 #include "resource_cache.h"
+#include "workgroup_tuner.h"
 
 namespace vkb
 {
@@ -49,6 +58,18 @@ struct DriverVersion
 	uint16_t patch;
 };
 
+/**
+ * @brief Device memory of a heap, in bytes
+ */
+struct HeapBudget
+{
+	/// Memory used by the process if VK_EXT_memory_budget is enabled, else allocated by VMA
+	VkDeviceSize usage{0};
+
+	/// Memory the process can use, estimated by VMA if VK_EXT_memory_budget is not enabled
+	VkDeviceSize budget{0};
+};
+
 class Device
 {
   public:
@@ -97,6 +118,12 @@ class Device
 	 */
 	const Queue &get_suitable_graphics_queue();
 
+	/**
+	 * @brief Returns a queue whose compute work can overlap the work of the graphics queue: the first queue
+	 *        of a compute only family, else another queue of the graphics family, otherwise the graphics queue
+	 */
+	const Queue &get_async_compute_queue();
+
 	/**
 	 * @return The command pool
 	 */
@@ -127,8 +154,200 @@ class Device
 
 	VkResult wait_idle();
 
+	/**
+	 * @return Whether the physical device supports a device extension
+	 */
+	bool is_extension_supported(const std::string &extension) const;
+
+	/**
+	 * @return Whether a device extension has been enabled on the device
+	 */
+	bool is_enabled(const char *extension) const;
+
+	/**
+	 * @brief Selects whether new descriptor sets are written with descriptor update templates,
+	 *        only effective if VK_KHR_descriptor_update_template is enabled
+	 */
+	void set_descriptor_update_templates(bool enable);
+
+	bool uses_descriptor_update_templates() const;
+
+	/**
+	 * @brief Selects whether the cull mode, front face and depth test, write and compare op
+	 *        are left out of new graphics pipelines and set by commands instead,
+	 *        only effective if VK_EXT_extended_dynamic_state is enabled. Off by default.
+	 */
+	void set_extended_dynamic_state(bool enable);
+
+	/**
+	 * @return Whether framebuffers are created without image views, enabled when VK_KHR_imageless_framebuffer is supported
+	 */
+	bool uses_imageless_framebuffers() const;
+
+	/**
+	 * @return Whether passes of a single subpass begin without render pass and framebuffer objects,
+	 *         enabled when VK_KHR_dynamic_rendering is supported, see RenderPass::is_dynamic
+	 */
+	bool uses_dynamic_rendering() const;
+
+	bool uses_extended_dynamic_state() const;
+
+	/**
+	 * @brief Selects the trade-off made by get_depth_format, for the render targets created from then on.
+	 *        Precision by default.
+	 */
+	void set_format_policy(FormatPolicy policy);
+
+	FormatPolicy get_format_policy() const;
+
+	/**
+	 * @return The depth format of the render targets, the first one of the format policy the device can render to
+	 */
+	VkFormat get_depth_format() const;
+
+	/**
+	 * @brief Selects whether command buffers record debug labels and objects are given debug names,
+	 *        to be enabled only if the instance enabled VK_EXT_debug_utils
+	 */
+	void set_debug_utils(bool enable);
+
+	bool uses_debug_utils() const;
+
+	/**
+	 * @brief Names a Vulkan object for debuggers and profilers, does nothing unless debug utils are used
+	 * @param object_type The type of the object
+	 * @param object_handle The handle of the object, cast to an integer
+	 * @param name The name of the object
+	 */
+	void set_debug_name(VkObjectType object_type, uint64_t object_handle, const std::string &name) const;
+
+	/**
+	 * @brief Called when a heap exceeds the budget threshold, once until it goes back below it
+	 */
+	using MemoryBudgetCallback = std::function<void(uint32_t heap_index, const HeapBudget &heap_budget)>;
+
+	/**
+	 * @brief Refreshes the budget of the heaps and warns about heaps over the threshold, once per frame
+	 * @param frame_number The number of the frame starting
+	 */
+	void update_memory_budget(uint64_t frame_number);
+
+	/**
+	 * @return The budget of the memory heaps, as of the last update_memory_budget
+	 */
+	const std::vector<HeapBudget> &get_heap_budgets() const;
+
+	/**
+	 * @brief Sets the hook called when a heap is nearing its budget, which logs a warning by default
+	 * @param threshold Fraction of the budget above which the callback is called
+	 * @param callback The function called, with the index of the heap and its budget
+	 */
+	void set_memory_budget_callback(float threshold, MemoryBudgetCallback callback);
+
+	/**
+	 * @brief Counts a new allocation, called by the resources holding device memory
+	 */
+	void add_allocation(AllocationCategory category);
+
+	void remove_allocation(AllocationCategory category);
+
+	/**
+	 * @return The number of live allocations of a category
+	 */
+	uint32_t get_allocation_count(AllocationCategory category) const;
+
+	/**
+	 * @return The size of the subgroups and the stages and operations supporting them,
+	 *         with no operations unless both the instance and the device use Vulkan 1.1
+	 */
+	const VkPhysicalDeviceSubgroupProperties &get_subgroup_properties() const;
+
+	/**
+	 * @return Whether shaders of a stage can use all the subgroup operations given
+	 */
+	bool supports_subgroup_operations(VkShaderStageFlagBits stage, VkSubgroupFeatureFlags operations) const;
+
+	/**
+	 * @return Whether shaders can do arithmetic on 16-bit floats, enabled when VK_KHR_shader_float16_int8 is supported
+	 */
+	bool supports_shader_float16() const;
+
+	/**
+	 * @return Whether storage buffers can hold 16-bit values, enabled when VK_KHR_16bit_storage is supported
+	 */
+	bool supports_16bit_storage() const;
+
+	/**
+	 * @return Whether pipelines can shade fragments covering several pixels, and which sizes, enabled when VK_KHR_fragment_shading_rate is supported
+	 */
+	bool supports_fragment_shading_rate() const;
+
+	/**
+	 * @return Whether subpasses can read their shading rates from an attachment, which needs VK_KHR_fragment_shading_rate
+	 */
+	bool supports_shading_rate_attachment() const;
+
+	/**
+	 * @return The texel sizes shading rate attachments can have, valid only if they are supported
+	 */
+	const VkPhysicalDeviceFragmentShadingRatePropertiesKHR &get_fragment_shading_rate_properties() const;
+
+	/**
+	 * @return Whether subpasses can render to several views at once, enabled when VK_KHR_multiview is supported
+	 */
+	bool supports_multiview() const;
+
+	/**
+	 * @return The number of views a multiview subpass can render to, 1 if multiview is not supported
+	 */
+	uint32_t get_max_multiview_view_count() const;
+
+	/**
+	 * @brief Acquires the profiling lock, which must be held while command buffers with performance queries
+	 *        are recorded and executed. It is kept until released or until the device is destroyed
+	 * @return Whether the lock is held, false if VK_KHR_performance_query is not enabled
+	 */
+	bool acquire_profiling_lock();
+
+	/**
+	 * @brief Releases the profiling lock, the command buffers with performance queries must have completed
+	 */
+	void release_profiling_lock();
+
+	/**
+	 * @brief Lists the defines added to the variant of every shader module of a stage, one per capability:
+	 *        HAS_SUBGROUP_BASIC, HAS_SUBGROUP_VOTE, HAS_SUBGROUP_ARITHMETIC, HAS_SUBGROUP_BALLOT,
+	 *        HAS_SUBGROUP_SHUFFLE, HAS_FP16 and HAS_16BIT_STORAGE
+	 */
+	std::vector<std::string> get_capability_defines(VkShaderStageFlagBits stage) const;
+
 	ResourceCache &get_resource_cache();
 
+	/**
+	 * @return The queue destroying the resources released during a frame once the frame has completed
+	 */
+	DeletionQueue &get_deletion_queue();
+
+	/**
+	 * @return The VMA pools the resources of the framework are allocated from, per resource class
+	 */
+	MemoryPools &get_memory_pools();
+
+	/**
+	 * @return The linter which the command buffers report their performance issues to, disabled by default
+	 */
+	PerfLint &get_perf_lint();
+
+	/**
+	 * @return The idle buffer blocks shared by the buffer pools of all frames
+	 */
+	BufferBlockFreeList &get_buffer_block_free_list();
+
+	/**
+	 * @return The tuner choosing the workgroup sizes of the compute kernels dispatched through it
+	 */
+	WorkgroupTuner &get_workgroup_tuner();
+
   private:
 	VkPhysicalDevice physical_device{VK_NULL_HANDLE};
 
@@ -140,8 +359,57 @@ class Device
 
 	VmaAllocator memory_allocator{VK_NULL_HANDLE};
 
+	std::unique_ptr<MemoryPools> memory_pools;
+
 	VkPhysicalDeviceProperties properties;
 
+	std::vector<VkExtensionProperties> device_extensions;
+
+	std::vector<std::string> enabled_extensions;
+
+	bool descriptor_update_templates{true};
+
+	bool extended_dynamic_state{false};
+
+	FormatPolicy format_policy{FormatPolicy::Precision};
+
+	VkFormat depth_format{VK_FORMAT_UNDEFINED};
+
+	bool imageless_framebuffer{false};
+
+	bool dynamic_rendering{false};
+
+	bool debug_utils{false};
+
+	VkPhysicalDeviceSubgroupProperties subgroup_properties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES};
+
+	bool shader_float16{false};
+
+	bool storage_16bit{false};
+
+	bool fragment_shading_rate{false};
+
+	bool shading_rate_attachment{false};
+
+	VkPhysicalDeviceFragmentShadingRatePropertiesKHR fragment_shading_rate_properties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADING_RATE_PROPERTIES_KHR};
+
+	bool multiview{false};
+
+	VkPhysicalDeviceMultiviewPropertiesKHR multiview_properties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_PROPERTIES_KHR};
+
+	bool profiling_lock{false};
+
+	std::vector<HeapBudget> heap_budgets;
+
+	/// Whether each heap was over the threshold at the last update
+	std::vector<bool> heaps_over_budget_threshold;
+
+	float memory_budget_threshold{0.9f};
+
+	MemoryBudgetCallback memory_budget_callback;
+
+	std::array<std::atomic<uint32_t>, static_cast<size_t>(AllocationCategory::Count)> allocation_counts{};
+
 	std::vector<std::vector<Queue>> queues;
 
 	/// A command pool associated to the primary queue
@@ -150,6 +418,14 @@ class Device
 	/// A fence pool associated to the primary queue
 	std::unique_ptr<FencePool> fence_pool;
 
+	std::unique_ptr<BufferBlockFreeList> buffer_block_free_list;
+
+	std::unique_ptr<WorkgroupTuner> workgroup_tuner;
+
 	ResourceCache resource_cache;
+
+	DeletionQueue deletion_queue;
+
+	PerfLint perf_lint;
 };
 }        // namespace vkb
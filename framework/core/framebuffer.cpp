@@ -29,23 +29,77 @@ VkFramebuffer Framebuffer::get_handle() const
 	return handle;
 }
 
+bool Framebuffer::is_imageless() const
+{
+	return imageless;
+}
+
+const std::vector<VkImageView> &Framebuffer::get_views() const
+{
+	return views;
+}
+
 Framebuffer::Framebuffer(Device &device, const RenderTarget &render_target, const RenderPass &render_pass) :
-    device{device}
+    device{device},
+    views{render_target.get_view_handles()}
 {
 	auto &extent = render_target.get_extent();
 
-	std::vector<VkImageView> attachments;
+	VkFramebufferCreateInfo create_info{VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
 
-	for (auto &view : render_target.get_views())
+	create_info.renderPass      = render_pass.get_handle();
+	create_info.attachmentCount = to_u32(views.size());
+	create_info.pAttachments    = views.data();
+	create_info.width           = extent.width;
+	create_info.height          = extent.height;
+
+	// Multiview render passes render to the layers of the views, with a single framebuffer layer
+	create_info.layers = 1;
+
+	auto result = vkCreateFramebuffer(device.get_handle(), &create_info, nullptr, &handle);
+
+	if (result != VK_SUCCESS)
 	{
-		attachments.emplace_back(view.get_handle());
+		throw VulkanException{result, "Cannot create Framebuffer"};
+	}
+}
+
+Framebuffer::Framebuffer(Device &device, const FramebufferAttachments &framebuffer_attachments, const RenderPass &render_pass) :
+    device{device},
+    imageless{true}
+{
+	auto &extent = framebuffer_attachments.extent;
+
+	std::vector<VkFramebufferAttachmentImageInfoKHR> image_infos;
+
+	for (size_t i = 0; i < framebuffer_attachments.attachments.size(); ++i)
+	{
+		auto &attachment = framebuffer_attachments.attachments[i];
+
+		VkFramebufferAttachmentImageInfoKHR image_info{VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENT_IMAGE_INFO_KHR};
+
+		// Shading rate attachments are smaller than the framebuffer
+		image_info.usage           = attachment.usage;
+		image_info.width           = framebuffer_attachments.extents[i].width;
+		image_info.height          = framebuffer_attachments.extents[i].height;
+		image_info.layerCount      = framebuffer_attachments.layers;
+		image_info.viewFormatCount = 1;
+		image_info.pViewFormats    = &attachment.format;
+
+		image_infos.push_back(image_info);
 	}
 
+	VkFramebufferAttachmentsCreateInfoKHR attachments_info{VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENTS_CREATE_INFO_KHR};
+
+	attachments_info.attachmentImageInfoCount = to_u32(image_infos.size());
+	attachments_info.pAttachmentImageInfos    = image_infos.data();
+
 	VkFramebufferCreateInfo create_info{VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
 
+	create_info.pNext           = &attachments_info;
+	create_info.flags           = VK_FRAMEBUFFER_CREATE_IMAGELESS_BIT_KHR;
 	create_info.renderPass      = render_pass.get_handle();
-	create_info.attachmentCount = to_u32(attachments.size());
-	create_info.pAttachments    = attachments.data();
+	create_info.attachmentCount = to_u32(image_infos.size());
 	create_info.width           = extent.width;
 	create_info.height          = extent.height;
 	create_info.layers          = 1;
@@ -54,13 +108,15 @@ Framebuffer::Framebuffer(Device &device, const RenderTarget &render_target, cons
 
 	if (result != VK_SUCCESS)
 	{
-		throw VulkanException{result, "Cannot create Framebuffer"};
+		throw VulkanException{result, "Cannot create imageless Framebuffer"};
 	}
 }
 
 Framebuffer::Framebuffer(Framebuffer &&other) :
     device{other.device},
-    handle{other.handle}
+    handle{other.handle},
+    imageless{other.imageless},
+    views{std::move(other.views)}
 {
 	other.handle = VK_NULL_HANDLE;
 }
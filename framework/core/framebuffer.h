@@ -34,6 +34,11 @@ class Framebuffer
   public:
 	Framebuffer(Device &device, const RenderTarget &render_target, const RenderPass &render_pass);
 
+	/**
+	 * @brief Creates an imageless framebuffer, which the views are given to when the render pass begins
+	 */
+	Framebuffer(Device &device, const FramebufferAttachments &framebuffer_attachments, const RenderPass &render_pass);
+
 	Framebuffer(const Framebuffer &) = delete;
 
 	Framebuffer(Framebuffer &&other);
@@ -46,9 +51,20 @@ class Framebuffer
 
 	VkFramebuffer get_handle() const;
 
+	bool is_imageless() const;
+
+	/**
+	 * @return The views the framebuffer was created with, none if it is imageless
+	 */
+	const std::vector<VkImageView> &get_views() const;
+
   private:
 	Device &device;
 
 	VkFramebuffer handle{VK_NULL_HANDLE};
+
+	bool imageless{false};
+
+	std::vector<VkImageView> views;
 };
 }        // namespace vkb
@@ -66,6 +66,13 @@ inline VkImageType find_image_type(VkExtent3D extent)
 
 	return result;
 }
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+inline bool is_ycbcr_format(VkFormat format)
+{
+	return format >= VK_FORMAT_G8B8G8R8_422_UNORM && format <= VK_FORMAT_G16_B16_R16_3PLANE_444_UNORM;
+}
+#endif
 }        // namespace
 
 namespace core
@@ -78,7 +85,8 @@ Image::Image(Device &              device,
              VkSampleCountFlagBits sample_count,
              const uint32_t        mip_levels,
              const uint32_t        array_layers,
-             VkImageTiling         tiling) :
+             VkImageTiling         tiling,
+             VkImageCreateFlags    flags) :
     device{device},
     type{find_image_type(extent)},
     extent{extent},
@@ -93,8 +101,11 @@ Image::Image(Device &              device,
 	subresource.mipLevel   = mip_levels;
 	subresource.arrayLayer = array_layers;
 
+	subresource_states.resize(mip_levels * array_layers);
+
 	VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
 
+	image_info.flags       = flags;
 	image_info.imageType   = type;
 	image_info.format      = format;
 	image_info.extent      = extent;
@@ -104,6 +115,21 @@ Image::Image(Device &              device,
 	image_info.tiling      = tiling;
 	image_info.usage       = image_usage;
 
+	// The memory of sparse images is bound by their owner through vkQueueBindSparse, which VMA cannot do
+	if (flags & VK_IMAGE_CREATE_SPARSE_BINDING_BIT)
+	{
+		auto result = vkCreateImage(device.get_handle(), &image_info, nullptr, &handle);
+
+		if (result != VK_SUCCESS)
+		{
+			throw VulkanException{result, "Cannot create sparse Image"};
+		}
+
+		sparse = true;
+
+		return;
+	}
+
 	VmaAllocationCreateInfo memory_info{};
 	memory_info.usage = memory_usage;
 
@@ -112,15 +138,27 @@ Image::Image(Device &              device,
 		memory_info.preferredFlags = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
 	}
 
+	device.get_memory_pools().select_pool(image_info, memory_info);
+
 	auto result = vmaCreateImage(device.get_memory_allocator(),
 	                             &image_info, &memory_info,
 	                             &handle, &memory,
 	                             nullptr);
 
+	// A full pool falls back to the default allocator
+	if (result != VK_SUCCESS && memory_info.pool != VK_NULL_HANDLE)
+	{
+		memory_info.pool = VK_NULL_HANDLE;
+
+		result = vmaCreateImage(device.get_memory_allocator(), &image_info, &memory_info, &handle, &memory, nullptr);
+	}
+
 	if (result != VK_SUCCESS)
 	{
 		throw VulkanException{result, "Cannot create Image"};
 	}
+
+	device.add_allocation(AllocationCategory::Image);
 }
 
 Image::Image(Device &device, VkImage handle, const VkExtent3D &extent, VkFormat format, VkImageUsageFlags image_usage) :
@@ -134,12 +172,140 @@ Image::Image(Device &device, VkImage handle, const VkExtent3D &extent, VkFormat
 {
 	subresource.mipLevel   = 1;
 	subresource.arrayLayer = 1;
+
+	subresource_states.resize(1);
 }
 
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+Image::Image(Device &device, AHardwareBuffer *hardware_buffer, const VkExtent2D &extent, VkImageUsageFlags image_usage) :
+    device{device},
+    type{VK_IMAGE_TYPE_2D},
+    extent{extent.width, extent.height, 1},
+    sample_count{VK_SAMPLE_COUNT_1_BIT},
+    usage{image_usage},
+    tiling{VK_IMAGE_TILING_OPTIMAL}
+{
+	subresource.mipLevel   = 1;
+	subresource.arrayLayer = 1;
+
+	subresource_states.resize(1);
+
+	VkAndroidHardwareBufferFormatPropertiesANDROID format_properties{VK_STRUCTURE_TYPE_ANDROID_HARDWARE_BUFFER_FORMAT_PROPERTIES_ANDROID};
+
+	VkAndroidHardwareBufferPropertiesANDROID properties{VK_STRUCTURE_TYPE_ANDROID_HARDWARE_BUFFER_PROPERTIES_ANDROID};
+	properties.pNext = &format_properties;
+
+	auto result = vkGetAndroidHardwareBufferPropertiesANDROID(device.get_handle(), hardware_buffer, &properties);
+
+	if (result != VK_SUCCESS)
+	{
+		throw VulkanException{result, "Cannot get the properties of the hardware buffer"};
+	}
+
+	format = format_properties.format;
+
+	// Formats without a Vulkan equivalent, such as the YUV formats of camera frames, are identified by an external format
+	VkExternalFormatANDROID external_format{VK_STRUCTURE_TYPE_EXTERNAL_FORMAT_ANDROID};
+	external_format.externalFormat = format == VK_FORMAT_UNDEFINED ? format_properties.externalFormat : 0;
+
+	VkExternalMemoryImageCreateInfoKHR external_memory_info{VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO_KHR};
+	external_memory_info.pNext       = &external_format;
+	external_memory_info.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_ANDROID_HARDWARE_BUFFER_BIT_ANDROID;
+
+	VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+
+	image_info.pNext         = &external_memory_info;
+	image_info.imageType     = type;
+	image_info.format        = format;
+	image_info.extent        = this->extent;
+	image_info.mipLevels     = 1;
+	image_info.arrayLayers   = 1;
+	image_info.samples       = sample_count;
+	image_info.tiling        = tiling;
+	image_info.usage         = image_usage;
+	image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	result = vkCreateImage(device.get_handle(), &image_info, nullptr, &handle);
+
+	if (result != VK_SUCCESS)
+	{
+		throw VulkanException{result, "Cannot create the image of the hardware buffer"};
+	}
+
+	// The memory of a hardware buffer is imported as a dedicated allocation of its image
+	VkImportAndroidHardwareBufferInfoANDROID import_info{VK_STRUCTURE_TYPE_IMPORT_ANDROID_HARDWARE_BUFFER_INFO_ANDROID};
+	import_info.buffer = hardware_buffer;
+
+	VkMemoryDedicatedAllocateInfoKHR dedicated_info{VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO_KHR};
+	dedicated_info.pNext = &import_info;
+	dedicated_info.image = handle;
+
+	VkMemoryAllocateInfo allocate_info{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+	allocate_info.pNext           = &dedicated_info;
+	allocate_info.allocationSize  = properties.allocationSize;
+	allocate_info.memoryTypeIndex = 0;
+
+	// Any of the memory types the hardware buffer can be imported as
+	while ((properties.memoryTypeBits & (1u << allocate_info.memoryTypeIndex)) == 0 && allocate_info.memoryTypeIndex < VK_MAX_MEMORY_TYPES)
+	{
+		allocate_info.memoryTypeIndex++;
+	}
+
+	result = vkAllocateMemory(device.get_handle(), &allocate_info, nullptr, &external_memory);
+
+	if (result == VK_SUCCESS)
+	{
+		result = vkBindImageMemory(device.get_handle(), handle, external_memory, 0);
+	}
+
+	if (result != VK_SUCCESS)
+	{
+		if (external_memory != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(device.get_handle(), external_memory, nullptr);
+		}
+
+		vkDestroyImage(device.get_handle(), handle, nullptr);
+
+		throw VulkanException{result, "Cannot import the memory of the hardware buffer"};
+	}
+
+	if (external_format.externalFormat == 0 && !is_ycbcr_format(format))
+	{
+		return;
+	}
+
+	// The conversion suggested by the driver matches the color space the producer wrote the buffer in
+	VkSamplerYcbcrConversionCreateInfoKHR conversion_info{VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_CREATE_INFO_KHR};
+
+	conversion_info.pNext         = &external_format;
+	conversion_info.format        = format;
+	conversion_info.ycbcrModel    = format_properties.suggestedYcbcrModel;
+	conversion_info.ycbcrRange    = format_properties.suggestedYcbcrRange;
+	conversion_info.components    = format_properties.samplerYcbcrConversionComponents;
+	conversion_info.xChromaOffset = format_properties.suggestedXChromaOffset;
+	conversion_info.yChromaOffset = format_properties.suggestedYChromaOffset;
+	conversion_info.chromaFilter  = (format_properties.formatFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_YCBCR_CONVERSION_LINEAR_FILTER_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+	result = vkCreateSamplerYcbcrConversionKHR(device.get_handle(), &conversion_info, nullptr, &ycbcr_conversion);
+
+	if (result != VK_SUCCESS)
+	{
+		vkFreeMemory(device.get_handle(), external_memory, nullptr);
+		vkDestroyImage(device.get_handle(), handle, nullptr);
+
+		throw VulkanException{result, "Cannot create the YCbCr conversion of the hardware buffer"};
+	}
+}
+#endif
+
 Image::Image(Image &&other) :
     device{other.device},
     handle{other.handle},
     memory{other.memory},
+    external_memory{other.external_memory},
+    ycbcr_conversion{other.ycbcr_conversion},
     type{other.type},
     extent{other.extent},
     format{other.format},
@@ -147,13 +313,20 @@ Image::Image(Image &&other) :
     usage{other.usage},
     tiling{other.tiling},
     subresource{other.subresource},
+    subresource_states{std::move(other.subresource_states)},
+    views{std::move(other.views)},
+    cached_views{std::move(other.cached_views)},
     mapped_data{other.mapped_data},
-    mapped{other.mapped}
+    mapped{other.mapped},
+    sparse{other.sparse}
 {
-	other.handle      = VK_NULL_HANDLE;
-	other.memory      = VK_NULL_HANDLE;
-	other.mapped_data = nullptr;
-	other.mapped      = false;
+	other.handle           = VK_NULL_HANDLE;
+	other.memory           = VK_NULL_HANDLE;
+	other.external_memory  = VK_NULL_HANDLE;
+	other.ycbcr_conversion = VK_NULL_HANDLE;
+	other.mapped_data      = nullptr;
+	other.mapped           = false;
+	other.sparse           = false;
 
 	// Update image views references to this image to avoid dangling pointers
 	for (auto &view : views)
@@ -164,10 +337,31 @@ Image::Image(Image &&other) :
 
 Image::~Image()
 {
+	// Destroy the views before the image they refer to
+	cached_views.clear();
+
 	if (handle != VK_NULL_HANDLE && memory != VK_NULL_HANDLE)
 	{
 		unmap();
 		vmaDestroyImage(device.get_memory_allocator(), handle, memory);
+
+		device.remove_allocation(AllocationCategory::Image);
+	}
+
+	if (external_memory != VK_NULL_HANDLE)
+	{
+		vkDestroyImage(device.get_handle(), handle, nullptr);
+		vkFreeMemory(device.get_handle(), external_memory, nullptr);
+	}
+
+	if (sparse && handle != VK_NULL_HANDLE)
+	{
+		vkDestroyImage(device.get_handle(), handle, nullptr);
+	}
+
+	if (ycbcr_conversion != VK_NULL_HANDLE)
+	{
+		vkDestroySamplerYcbcrConversionKHR(device.get_handle(), ycbcr_conversion, nullptr);
 	}
 }
 
@@ -186,6 +380,11 @@ VmaAllocation Image::get_memory() const
 	return memory;
 }
 
+void Image::set_debug_name(const std::string &name)
+{
+	device.set_debug_name(VK_OBJECT_TYPE_IMAGE, (uint64_t) handle, name);
+}
+
 uint8_t *Image::map()
 {
 	if (!mapped_data)
@@ -245,10 +444,56 @@ VkImageSubresource Image::get_subresource() const
 	return subresource;
 }
 
+VkSamplerYcbcrConversion Image::get_ycbcr_conversion() const
+{
+	return ycbcr_conversion;
+}
+
+ResourceState &Image::get_subresource_state(uint32_t mip_level, uint32_t array_layer)
+{
+	assert(mip_level < subresource.mipLevel && array_layer < subresource.arrayLayer && "Subresource out of range");
+
+	return subresource_states[mip_level * subresource.arrayLayer + array_layer];
+}
+
 std::unordered_set<ImageView *> &Image::get_views()
 {
 	return views;
 }
 
+ImageView &Image::request_view(VkImageViewType view_type, VkFormat view_format, uint32_t base_mip_level, uint32_t base_array_layer, uint32_t n_mip_levels, uint32_t n_array_layers)
+{
+	if (view_format == VK_FORMAT_UNDEFINED)
+	{
+		view_format = format;
+	}
+
+	if (n_mip_levels == 0)
+	{
+		n_mip_levels = subresource.mipLevel - base_mip_level;
+	}
+
+	if (n_array_layers == 0)
+	{
+		n_array_layers = subresource.arrayLayer - base_array_layer;
+	}
+
+	for (auto &view : cached_views)
+	{
+		auto range = view->get_subresource_range();
+
+		if (view->get_view_type() == view_type && view->get_format() == view_format &&
+		    range.baseMipLevel == base_mip_level && range.levelCount == n_mip_levels &&
+		    range.baseArrayLayer == base_array_layer && range.layerCount == n_array_layers)
+		{
+			return *view;
+		}
+	}
+
+	cached_views.emplace_back(std::make_unique<ImageView>(*this, view_type, view_format, base_mip_level, base_array_layer, n_mip_levels, n_array_layers));
+
+	return *cached_views.back();
+}
+
 }        // namespace core
 }        // namespace vkb
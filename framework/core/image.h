@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <memory>
 #include <unordered_set>
 
 #include "common/helpers.h"
@@ -41,6 +42,10 @@ class Image
 	      VkFormat          format,
 	      VkImageUsageFlags image_usage);
 
+	/**
+	 * @brief Creates an image with its memory allocated by VMA. Images created with VK_IMAGE_CREATE_SPARSE_BINDING_BIT
+	 *        are left without memory, which their owner binds through vkQueueBindSparse
+	 */
 	Image(Device &              device,
 	      const VkExtent3D &    extent,
 	      VkFormat              format,
@@ -49,7 +54,26 @@ class Image
 	      VkSampleCountFlagBits sample_count = VK_SAMPLE_COUNT_1_BIT,
 	      uint32_t              mip_levels   = 1,
 	      uint32_t              array_layers = 1,
-	      VkImageTiling         tiling       = VK_IMAGE_TILING_OPTIMAL);
+	      VkImageTiling         tiling       = VK_IMAGE_TILING_OPTIMAL,
+	      VkImageCreateFlags    flags        = 0);
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+	/**
+	 * @brief Imports an Android hardware buffer, such as a camera or video frame, without copying it.
+	 *        Formats without a Vulkan equivalent and YUV formats are sampled through the YCbCr conversion
+	 *        of the image, which the views and the samplers of the image must be created with.
+	 *        Requires VK_ANDROID_external_memory_android_hardware_buffer, see Device.
+	 * @param device A valid Vulkan device
+	 * @param hardware_buffer The hardware buffer, which must outlive the image
+	 * @param extent The size of the hardware buffer
+	 * @param image_usage The usage of the image, the hardware buffer must have been allocated to allow it
+	 * @throws VulkanException if the hardware buffer cannot be imported
+	 */
+	Image(Device &          device,
+	      AHardwareBuffer * hardware_buffer,
+	      const VkExtent2D &extent,
+	      VkImageUsageFlags image_usage = VK_IMAGE_USAGE_SAMPLED_BIT);
+#endif
 
 	Image(const Image &) = delete;
 
@@ -67,6 +91,11 @@ class Image
 
 	VmaAllocation get_memory() const;
 
+	/**
+	 * @brief Names the image for debuggers and profilers, if the device uses debug utils
+	 */
+	void set_debug_name(const std::string &name);
+
 	/**
 	 * @brief Maps vulkan memory to an host visible address
 	 * @return Pointer to host visible memory
@@ -92,8 +121,36 @@ class Image
 
 	VkImageSubresource get_subresource() const;
 
+	/**
+	 * @return The conversion the image must be sampled through, VK_NULL_HANDLE for images which are sampled directly
+	 */
+	VkSamplerYcbcrConversion get_ycbcr_conversion() const;
+
+	/**
+	 * @brief State of a subresource tracked by CommandBuffer::transition, in recording order
+	 */
+	ResourceState &get_subresource_state(uint32_t mip_level, uint32_t array_layer);
+
 	std::unordered_set<ImageView *> &get_views();
 
+	/**
+	 * @brief Requests a view of the image. Views with the same parameters are created once and shared,
+	 *        so that descriptor sets keyed on their handles are shared as well. The views are owned by the
+	 *        image and destroyed with it. Not thread-safe.
+	 * @param view_type The type of the view
+	 * @param format The format of the view, VK_FORMAT_UNDEFINED for the format of the image
+	 * @param base_mip_level The first mip level of the view
+	 * @param base_array_layer The first array layer of the view
+	 * @param n_mip_levels The number of mip levels of the view, 0 for the remaining ones
+	 * @param n_array_layers The number of array layers of the view, 0 for the remaining ones
+	 */
+	ImageView &request_view(VkImageViewType view_type,
+	                        VkFormat        format           = VK_FORMAT_UNDEFINED,
+	                        uint32_t        base_mip_level   = 0,
+	                        uint32_t        base_array_layer = 0,
+	                        uint32_t        n_mip_levels     = 0,
+	                        uint32_t        n_array_layers   = 0);
+
   private:
 	Device &device;
 
@@ -101,6 +158,11 @@ class Image
 
 	VmaAllocation memory{VK_NULL_HANDLE};
 
+	/// Memory of an imported hardware buffer, which is not allocated by VMA
+	VkDeviceMemory external_memory{VK_NULL_HANDLE};
+
+	VkSamplerYcbcrConversion ycbcr_conversion{VK_NULL_HANDLE};
+
 	VkImageType type{};
 
 	VkExtent3D extent{};
@@ -115,13 +177,22 @@ class Image
 
 	VkImageSubresource subresource{};
 
+	/// State of each subresource, layers of a mip level are consecutive
+	std::vector<ResourceState> subresource_states;
+
 	/// Image views referring to this image
 	std::unordered_set<ImageView *> views;
 
+	/// Image views created by request_view, images only have a handful of them
+	std::vector<std::unique_ptr<ImageView>> cached_views;
+
 	uint8_t *mapped_data{nullptr};
 
 	/// Whether it was mapped with vmaMapMemory
 	bool mapped{false};
+
+	/// Whether it was created with VK_IMAGE_CREATE_SPARSE_BINDING_BIT, without memory
+	bool sparse{false};
 };
 }        // namespace core
 }        // namespace vkb
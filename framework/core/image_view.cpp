@@ -27,18 +27,24 @@ namespace vkb
 {
 namespace core
 {
-ImageView::ImageView(Image &img, VkImageViewType view_type, VkFormat format) :
+ImageView::ImageView(Image &img, VkImageViewType view_type, VkFormat format,
+                     uint32_t base_mip_level, uint32_t base_array_layer, uint32_t n_mip_levels, uint32_t n_array_layers) :
     device{img.get_device()},
     image{&img},
-    format{format}
+    format{format},
+    view_type{view_type}
 {
 	if (format == VK_FORMAT_UNDEFINED)
 	{
 		this->format = format = image->get_format();
 	}
 
-	subresource_range.levelCount = image->get_subresource().mipLevel;
-	subresource_range.layerCount = image->get_subresource().arrayLayer;
+	assert(base_mip_level < image->get_subresource().mipLevel && base_array_layer < image->get_subresource().arrayLayer && "Subresource out of range");
+
+	subresource_range.baseMipLevel   = base_mip_level;
+	subresource_range.baseArrayLayer = base_array_layer;
+	subresource_range.levelCount     = n_mip_levels == 0 ? image->get_subresource().mipLevel - base_mip_level : n_mip_levels;
+	subresource_range.layerCount     = n_array_layers == 0 ? image->get_subresource().arrayLayer - base_array_layer : n_array_layers;
 
 	if (is_depth_only_format(format))
 	{
@@ -60,6 +66,15 @@ ImageView::ImageView(Image &img, VkImageViewType view_type, VkFormat format) :
 	view_info.format           = format;
 	view_info.subresourceRange = subresource_range;
 
+	// Views of an image sampled through a conversion must be created with it
+	VkSamplerYcbcrConversionInfoKHR conversion_info{VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_INFO_KHR};
+	conversion_info.conversion = image->get_ycbcr_conversion();
+
+	if (conversion_info.conversion != VK_NULL_HANDLE)
+	{
+		view_info.pNext = &conversion_info;
+	}
+
 	auto result = vkCreateImageView(device.get_handle(), &view_info, nullptr, &handle);
 
 	if (result != VK_SUCCESS)
@@ -77,6 +92,7 @@ ImageView::ImageView(ImageView &&other) :
     image{other.image},
     handle{other.handle},
     format{other.format},
+    view_type{other.view_type},
     subresource_range{other.subresource_range}
 {
 	// Remove old view from image set and add this new one
@@ -92,6 +108,8 @@ ImageView::~ImageView()
 	if (handle != VK_NULL_HANDLE)
 	{
 		vkDestroyImageView(device.get_handle(), handle, nullptr);
+
+		image->get_views().erase(this);
 	}
 }
 
@@ -116,6 +134,11 @@ VkFormat ImageView::get_format() const
 	return format;
 }
 
+VkImageViewType ImageView::get_view_type() const
+{
+	return view_type;
+}
+
 VkImageSubresourceRange ImageView::get_subresource_range() const
 {
 	return subresource_range;
@@ -31,7 +31,18 @@ namespace core
 class ImageView
 {
   public:
-	ImageView(Image &image, VkImageViewType view_type, VkFormat format = VK_FORMAT_UNDEFINED);
+	/**
+	 * @brief Creates a view of a range of subresources of an image
+	 * @param image The image to create a view of
+	 * @param view_type The type of the view
+	 * @param format The format of the view, VK_FORMAT_UNDEFINED for the format of the image
+	 * @param base_mip_level The first mip level of the view
+	 * @param base_array_layer The first array layer of the view
+	 * @param n_mip_levels The number of mip levels of the view, 0 for the remaining ones
+	 * @param n_array_layers The number of array layers of the view, 0 for the remaining ones
+	 */
+	ImageView(Image &image, VkImageViewType view_type, VkFormat format = VK_FORMAT_UNDEFINED,
+	          uint32_t base_mip_level = 0, uint32_t base_array_layer = 0, uint32_t n_mip_levels = 0, uint32_t n_array_layers = 0);
 
 	ImageView(ImageView &) = delete;
 
@@ -55,6 +66,8 @@ class ImageView
 
 	VkFormat get_format() const;
 
+	VkImageViewType get_view_type() const;
+
 	VkImageSubresourceRange get_subresource_range() const;
 
 	VkImageSubresourceLayers get_subresource_layers() const;
@@ -68,6 +81,8 @@ class ImageView
 
 	VkFormat format{};
 
+	VkImageViewType view_type{};
+
 	VkImageSubresourceRange subresource_range{};
 };
 }        // namespace core
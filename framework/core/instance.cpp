@@ -123,29 +123,42 @@ Instance::Instance(const std::string &              application_name,
 	extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 #endif
 
-	// Try to enable headless surface extension if it exists
+	// Headless rendering is offscreen, without any window system integration
 	if (headless)
 	{
-		bool headless_extension = false;
-		for (auto &available_extension : available_instance_extensions)
-		{
-			if (strcmp(available_extension.extensionName, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME) == 0)
-			{
-				headless_extension = true;
-				LOGI("{} is available, enabling it", VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
-				extensions.push_back(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
-			}
-		}
-		if (!headless_extension)
-		{
-			LOGW("{} is not available, disabling swapchain creation", VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
-		}
+		LOGI("Headless: rendering offscreen without a surface");
 	}
 	else
 	{
 		extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
 	}
 
+	for (auto &available_extension : available_instance_extensions)
+	{
+		// Required by device extensions such as VK_KHR_push_descriptor
+		if (strcmp(available_extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0)
+		{
+			LOGI("{} is available, enabling it", VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+			extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+		}
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+		// Required by VK_KHR_external_memory, which imports Android hardware buffers
+		if (strcmp(available_extension.extensionName, VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME) == 0)
+		{
+			LOGI("{} is available, enabling it", VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME);
+			extensions.push_back(VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME);
+		}
+#endif
+
+		// Labels and object names are shown by debuggers and profilers, in release builds as well but not in performance builds
+		if (!perf_build && strcmp(available_extension.extensionName, VK_EXT_DEBUG_UTILS_EXTENSION_NAME) == 0)
+		{
+			LOGI("{} is available, enabling it", VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+		}
+	}
+
 	if (!validate_extensions(extensions, available_instance_extensions))
 	{
 		throw std::runtime_error("Required instance extensions are missing.");
@@ -175,13 +188,16 @@ Instance::Instance(const std::string &              application_name,
 		throw std::runtime_error("Required validation layers are missing.");
 	}
 
+	// Vulkan 1.1 when the loader supports it, for the subgroup operations
+	uint32_t api_version = volkGetInstanceVersion() >= VK_API_VERSION_1_1 ? VK_API_VERSION_1_1 : VK_API_VERSION_1_0;
+
 	VkApplicationInfo app_info{VK_STRUCTURE_TYPE_APPLICATION_INFO};
 
 	app_info.pApplicationName   = application_name.c_str();
 	app_info.applicationVersion = 0;
 	app_info.pEngineName        = "Vulkan Best Practice";
 	app_info.engineVersion      = 0;
-	app_info.apiVersion         = VK_MAKE_VERSION(1, 0, 0);
+	app_info.apiVersion         = api_version;
 
 	VkInstanceCreateInfo instance_info = {VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
 
@@ -20,12 +20,80 @@
 
 #include "pipeline.h"
 
+#include "common/logging.h"
+#include "cpu_profiler.h"
 #include "device.h"
 #include "pipeline_layout.h"
 #include "shader_module.h"
 
 namespace vkb
 {
+namespace
+{
+/**
+ * @brief Describes the state of a pipeline with the parts which usually tell pipelines apart
+ * @param name The names of the shaders of the pipeline
+ */
+std::string describe_pipeline_state(const std::string &name, const PipelineState &pipeline_state, bool is_compute)
+{
+	std::string description = name;
+
+	if (!is_compute)
+	{
+		auto &attachments = pipeline_state.get_color_blend_state().attachments;
+
+		bool blended = std::any_of(attachments.begin(), attachments.end(), [](const ColorBlendAttachmentState &attachment) { return attachment.blend_enable == VK_TRUE; });
+
+		description += fmt::format(", subpass {}, {} vertex attributes, {} color attachments{}",
+		                           pipeline_state.get_subpass_index(),
+		                           pipeline_state.get_vertex_input_state().attributes.size(),
+		                           attachments.size(),
+		                           blended ? " (blended)" : "");
+
+		auto &shading_rate = pipeline_state.get_fragment_shading_rate_state();
+
+		if (shading_rate.fragment_size.width > 1 || shading_rate.fragment_size.height > 1)
+		{
+			description += fmt::format(", {}x{} shading rate", shading_rate.fragment_size.width, shading_rate.fragment_size.height);
+		}
+
+		if (shading_rate.combiner_ops[1] != VK_FRAGMENT_SHADING_RATE_COMBINER_OP_KEEP_KHR)
+		{
+			description += ", shading rate attachment";
+		}
+	}
+
+	auto constant_count = pipeline_state.get_specialization_constant_state().get_specialization_constant_state().size();
+
+	if (constant_count > 0)
+	{
+		description += fmt::format(", {} specialization constants", constant_count);
+	}
+
+	return description;
+}
+
+/**
+ * @brief Chains creation feedback to a pipeline create info if the device enabled VK_EXT_pipeline_creation_feedback
+ */
+template <typename T>
+void chain_creation_feedback(Device &device, T &create_info, VkPipelineCreationFeedbackCreateInfoEXT &feedback_info,
+                             VkPipelineCreationFeedbackEXT &pipeline_feedback, std::vector<VkPipelineCreationFeedbackEXT> &stage_feedbacks)
+{
+	if (!device.is_enabled(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME))
+	{
+		return;
+	}
+
+	feedback_info.pPipelineCreationFeedback          = &pipeline_feedback;
+	feedback_info.pipelineStageCreationFeedbackCount = to_u32(stage_feedbacks.size());
+	feedback_info.pPipelineStageCreationFeedbacks    = stage_feedbacks.data();
+
+	feedback_info.pNext = create_info.pNext;
+	create_info.pNext   = &feedback_info;
+}
+}        // namespace
+
 Pipeline::Pipeline(Device &device) :
     device{device}
 {}
@@ -33,7 +101,9 @@ Pipeline::Pipeline(Device &device) :
 Pipeline::Pipeline(Pipeline &&other) :
     device{other.device},
     handle{other.handle},
-    state{other.state}
+    state{other.state},
+    creation_feedback{other.creation_feedback},
+    summary{std::move(other.summary)}
 {
 	other.handle = VK_NULL_HANDLE;
 }
@@ -57,6 +127,33 @@ const PipelineState &Pipeline::get_state() const
 	return state;
 }
 
+const PipelineCreationFeedback &Pipeline::get_creation_feedback() const
+{
+	return creation_feedback;
+}
+
+const std::string &Pipeline::get_summary() const
+{
+	return summary;
+}
+
+void Pipeline::set_debug_name(const std::string &name)
+{
+	device.set_debug_name(VK_OBJECT_TYPE_PIPELINE, (uint64_t) handle, name);
+}
+
+void Pipeline::record_creation(const VkPipelineCreationFeedbackEXT &feedback, bool is_compute)
+{
+	if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT)
+	{
+		creation_feedback.valid     = true;
+		creation_feedback.cache_hit = (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) != 0;
+		creation_feedback.duration  = feedback.duration;
+	}
+
+	device.get_resource_cache().record_pipeline_creation(*this, is_compute);
+}
+
 ComputePipeline::ComputePipeline(Device &        device,
                                  VkPipelineCache pipeline_cache,
                                  PipelineState & pipeline_state) :
@@ -112,7 +209,18 @@ ComputePipeline::ComputePipeline(Device &        device,
 	create_info.layout = pipeline_state.get_pipeline_layout().get_handle();
 	create_info.stage  = stage;
 
-	result = vkCreateComputePipelines(device.get_handle(), pipeline_cache, 1, &create_info, nullptr, &handle);
+	VkPipelineCreationFeedbackEXT              pipeline_feedback{};
+	std::vector<VkPipelineCreationFeedbackEXT> stage_feedbacks(1);
+	VkPipelineCreationFeedbackCreateInfoEXT    feedback_info{VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT};
+
+	chain_creation_feedback(device, create_info, feedback_info, pipeline_feedback, stage_feedbacks);
+
+	{
+		// Compiles show up as stalls on the timeline of the frame
+		VKB_PROFILE_SCOPE("vkCreateComputePipelines");
+
+		result = vkCreateComputePipelines(device.get_handle(), pipeline_cache, 1, &create_info, nullptr, &handle);
+	}
 
 	if (result != VK_SUCCESS)
 	{
@@ -120,6 +228,12 @@ ComputePipeline::ComputePipeline(Device &        device,
 	}
 
 	vkDestroyShaderModule(device.get_handle(), stage.module, nullptr);
+
+	set_debug_name(shader_module->get_debug_name());
+
+	summary = describe_pipeline_state(shader_module->get_debug_name(), pipeline_state, true);
+
+	record_creation(pipeline_feedback, true);
 }
 
 GraphicsPipeline::GraphicsPipeline(Device &        device,
@@ -256,7 +370,22 @@ GraphicsPipeline::GraphicsPipeline(Device &        device,
 	color_blend_state.blendConstants[2] = 1.0f;
 	color_blend_state.blendConstants[3] = 1.0f;
 
-	std::array<VkDynamicState, 9> dynamic_states{
+#if defined(VK_EXT_rasterization_order_attachment_access)
+	// Subpasses reading their attachments in rasterization order need their pipelines to order the accesses too
+	auto subpass_flags = pipeline_state.get_render_pass()->get_subpass_flags(pipeline_state.get_subpass_index());
+
+	if (subpass_flags & VK_SUBPASS_DESCRIPTION_RASTERIZATION_ORDER_ATTACHMENT_COLOR_ACCESS_BIT_EXT)
+	{
+		color_blend_state.flags |= VK_PIPELINE_COLOR_BLEND_STATE_CREATE_RASTERIZATION_ORDER_ATTACHMENT_ACCESS_BIT_EXT;
+	}
+
+	if (subpass_flags & VK_SUBPASS_DESCRIPTION_RASTERIZATION_ORDER_ATTACHMENT_DEPTH_ACCESS_BIT_EXT)
+	{
+		depth_stencil_state.flags |= VK_PIPELINE_DEPTH_STENCIL_STATE_CREATE_RASTERIZATION_ORDER_ATTACHMENT_DEPTH_ACCESS_BIT_EXT;
+	}
+#endif
+
+	std::vector<VkDynamicState> dynamic_states{
 	    VK_DYNAMIC_STATE_VIEWPORT,
 	    VK_DYNAMIC_STATE_SCISSOR,
 	    VK_DYNAMIC_STATE_LINE_WIDTH,
@@ -268,6 +397,15 @@ GraphicsPipeline::GraphicsPipeline(Device &        device,
 	    VK_DYNAMIC_STATE_STENCIL_REFERENCE,
 	};
 
+	if (pipeline_state.has_extended_dynamic_state())
+	{
+		dynamic_states.push_back(VK_DYNAMIC_STATE_CULL_MODE_EXT);
+		dynamic_states.push_back(VK_DYNAMIC_STATE_FRONT_FACE_EXT);
+		dynamic_states.push_back(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT);
+		dynamic_states.push_back(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT);
+		dynamic_states.push_back(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT);
+	}
+
 	VkPipelineDynamicStateCreateInfo dynamic_state{VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
 
 	dynamic_state.pDynamicStates    = dynamic_states.data();
@@ -286,7 +424,96 @@ GraphicsPipeline::GraphicsPipeline(Device &        device,
 	create_info.renderPass = pipeline_state.get_render_pass()->get_handle();
 	create_info.subpass    = pipeline_state.get_subpass_index();
 
-	auto result = vkCreateGraphicsPipelines(device.get_handle(), pipeline_cache, 1, &create_info, nullptr, &handle);
+#if defined(VK_KHR_dynamic_rendering)
+	// Dynamic render passes have no handle, the pipeline is given the formats of their attachments instead
+	VkPipelineRenderingCreateInfoKHR rendering_create_info{VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR};
+
+	std::vector<VkFormat> color_formats;
+
+	auto render_pass = pipeline_state.get_render_pass();
+
+	if (render_pass->is_dynamic())
+	{
+		color_formats = render_pass->get_color_formats(0);
+
+		auto depth_stencil_format = render_pass->get_depth_stencil_format(0);
+
+		rendering_create_info.viewMask                = render_pass->get_view_mask(0);
+		rendering_create_info.colorAttachmentCount    = to_u32(color_formats.size());
+		rendering_create_info.pColorAttachmentFormats = color_formats.data();
+
+		if (depth_stencil_format != VK_FORMAT_S8_UINT)
+		{
+			rendering_create_info.depthAttachmentFormat = depth_stencil_format;
+		}
+		if (depth_stencil_format != VK_FORMAT_UNDEFINED && !is_depth_only_format(depth_stencil_format))
+		{
+			rendering_create_info.stencilAttachmentFormat = depth_stencil_format;
+		}
+
+		rendering_create_info.pNext = create_info.pNext;
+
+		create_info.pNext      = &rendering_create_info;
+		create_info.renderPass = VK_NULL_HANDLE;
+		create_info.subpass    = 0;
+	}
+#endif
+
+	// Pipelines which only differ by their fixed function state derive from the first one built
+	auto &resource_cache = device.get_resource_cache();
+
+	VkPipeline base_pipeline = VK_NULL_HANDLE;
+
+	if (resource_cache.is_using_pipeline_derivatives())
+	{
+		base_pipeline = resource_cache.get_base_pipeline(pipeline_state);
+
+		if (base_pipeline != VK_NULL_HANDLE)
+		{
+			create_info.flags |= VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+		}
+		else
+		{
+			create_info.flags |= VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
+
+			derivative_base = true;
+		}
+
+		create_info.basePipelineHandle = base_pipeline;
+		create_info.basePipelineIndex  = -1;
+	}
+
+	// Without the shading rate state, pipelines shade every pixel and ignore the primitive and attachment rates
+	VkPipelineFragmentShadingRateStateCreateInfoKHR shading_rate_state{VK_STRUCTURE_TYPE_PIPELINE_FRAGMENT_SHADING_RATE_STATE_CREATE_INFO_KHR};
+
+	if (device.supports_fragment_shading_rate())
+	{
+		auto &fragment_shading_rate_state = pipeline_state.get_fragment_shading_rate_state();
+
+		shading_rate_state.fragmentSize   = fragment_shading_rate_state.fragment_size;
+		shading_rate_state.combinerOps[0] = fragment_shading_rate_state.combiner_ops[0];
+		shading_rate_state.combinerOps[1] = fragment_shading_rate_state.combiner_ops[1];
+
+		assert((shading_rate_state.combinerOps[1] == VK_FRAGMENT_SHADING_RATE_COMBINER_OP_KEEP_KHR || device.supports_shading_rate_attachment()) &&
+		       "Shading rate attachments are not supported");
+
+		shading_rate_state.pNext = create_info.pNext;
+		create_info.pNext        = &shading_rate_state;
+	}
+
+	VkPipelineCreationFeedbackEXT              pipeline_feedback{};
+	std::vector<VkPipelineCreationFeedbackEXT> stage_feedbacks(stage_create_infos.size());
+	VkPipelineCreationFeedbackCreateInfoEXT    feedback_info{VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT};
+
+	chain_creation_feedback(device, create_info, feedback_info, pipeline_feedback, stage_feedbacks);
+
+	VkResult result;
+
+	{
+		VKB_PROFILE_SCOPE("vkCreateGraphicsPipelines");
+
+		result = vkCreateGraphicsPipelines(device.get_handle(), pipeline_cache, 1, &create_info, nullptr, &handle);
+	}
 
 	if (result != VK_SUCCESS)
 	{
@@ -298,6 +525,25 @@ GraphicsPipeline::GraphicsPipeline(Device &        device,
 		vkDestroyShaderModule(device.get_handle(), shader_module, nullptr);
 	}
 
+	// Named after its shaders, such as "base.vert base.frag"
+	std::string debug_name;
+
+	for (const ShaderModule *shader_module : pipeline_state.get_pipeline_layout().get_shader_program().get_shader_modules())
+	{
+		debug_name += debug_name.empty() ? shader_module->get_debug_name() : " " + shader_module->get_debug_name();
+	}
+
+	set_debug_name(debug_name);
+
 	state = pipeline_state;
+
+	summary = describe_pipeline_state(debug_name, pipeline_state, false);
+
+	record_creation(pipeline_feedback, false);
+}
+
+bool GraphicsPipeline::is_derivative_base() const
+{
+	return derivative_base;
 }
 }        // namespace vkb
@@ -28,6 +28,21 @@ namespace vkb
 {
 class Device;
 
+/**
+ * @brief How a pipeline was created, as reported by VK_EXT_pipeline_creation_feedback
+ */
+struct PipelineCreationFeedback
+{
+	/// Whether the driver reported the feedback, false if the extension is not enabled
+	bool valid{false};
+
+	/// Whether the pipeline was found in the pipeline cache without compilation
+	bool cache_hit{false};
+
+	/// Creation time in nanoseconds
+	uint64_t duration{0};
+};
+
 class Pipeline
 {
   public:
@@ -47,12 +62,35 @@ class Pipeline
 
 	const PipelineState &get_state() const;
 
+	const PipelineCreationFeedback &get_creation_feedback() const;
+
+	/**
+	 * @return A short description of the state the pipeline was created with, such as its shaders and subpass
+	 */
+	const std::string &get_summary() const;
+
+	/**
+	 * @brief Names the pipeline for debuggers and profilers, if the device uses debug utils
+	 */
+	void set_debug_name(const std::string &name);
+
   protected:
 	Device &device;
 
 	VkPipeline handle = VK_NULL_HANDLE;
 
 	PipelineState state;
+
+	PipelineCreationFeedback creation_feedback;
+
+	std::string summary;
+
+	/**
+	 * @brief Reads the feedback of the driver and reports the creation to the resource cache
+	 * @param feedback The feedback filled by the driver, if the extension is enabled
+	 * @param is_compute Whether the pipeline is a compute one
+	 */
+	void record_creation(const VkPipelineCreationFeedbackEXT &feedback, bool is_compute);
 };
 
 class ComputePipeline : public Pipeline
@@ -77,5 +115,13 @@ class GraphicsPipeline : public Pipeline
 	GraphicsPipeline(Device &        device,
 	                 VkPipelineCache pipeline_cache,
 	                 PipelineState & pipeline_state);
+
+	/**
+	 * @brief Whether the pipeline was created to be the base of derivative pipelines
+	 */
+	bool is_derivative_base() const;
+
+  private:
+	bool derivative_base{false};
 };
 }        // namespace vkb
@@ -31,10 +31,44 @@ PipelineLayout::PipelineLayout(Device &device, const std::vector<ShaderModule *>
     device{device},
     shader_program{shader_modules}
 {
+	bool has_push_descriptor_set = false;
+
 	// Create a descriptor set layout for each shader set in the shader program
 	for (auto &shader_set_it : shader_program.get_shader_sets())
 	{
-		descriptor_set_layouts.emplace(shader_set_it.first, &device.get_resource_cache().request_descriptor_set_layout(shader_set_it.second, use_dynamic_resources));
+		auto *descriptor_set_layout = &device.get_resource_cache().request_descriptor_set_layout(shader_set_it.second, use_dynamic_resources);
+
+		if (descriptor_set_layout->is_push_descriptor())
+		{
+			// Only one set of a pipeline layout can be pushed, the others fall back to descriptor pools
+			if (has_push_descriptor_set)
+			{
+				auto set_resources = shader_set_it.second;
+
+				for (auto &resource : set_resources)
+				{
+					resource.push_descriptor = false;
+				}
+
+				descriptor_set_layout = &device.get_resource_cache().request_descriptor_set_layout(set_resources, use_dynamic_resources);
+			}
+
+			has_push_descriptor_set = true;
+		}
+
+		descriptor_set_layouts.emplace(shader_set_it.first, descriptor_set_layout);
+
+		for (auto &resource : shader_set_it.second)
+		{
+			// Inputs, outputs and constants have no descriptors
+			if (resource.type != ShaderResourceType::Input &&
+			    resource.type != ShaderResourceType::Output &&
+			    resource.type != ShaderResourceType::PushConstant &&
+			    resource.type != ShaderResourceType::SpecializationConstant)
+			{
+				bindings.emplace(resource.name, ShaderResourceBinding{resource.set, resource.binding, resource.type});
+			}
+		}
 	}
 
 	// Collect all the descriptor set layout handles
@@ -43,8 +77,7 @@ PipelineLayout::PipelineLayout(Device &device, const std::vector<ShaderModule *>
 	               [](auto &descriptor_set_layout_it) { return descriptor_set_layout_it.second->get_handle(); });
 
 	// Collect all the push constant shader resources
-	std::vector<VkPushConstantRange> push_constant_ranges;
-	for (auto &push_constant_resource : shader_program.get_resources(ShaderResourceType::PushConstant))
+	for (auto &push_constant_resource : shader_program.get_resources_by_type(ShaderResourceType::PushConstant))
 	{
 		push_constant_ranges.push_back({push_constant_resource.stages, push_constant_resource.offset, push_constant_resource.size});
 	}
@@ -56,6 +89,25 @@ PipelineLayout::PipelineLayout(Device &device, const std::vector<ShaderModule *>
 	create_info.pushConstantRangeCount = to_u32(push_constant_ranges.size());
 	create_info.pPushConstantRanges    = push_constant_ranges.data();
 
+	// The descriptor set layouts are cached, so identical layouts have the same handle
+	size_t compatibility_hash = 0;
+
+	for (auto &range : push_constant_ranges)
+	{
+		hash_combine(compatibility_hash, range.stageFlags);
+		hash_combine(compatibility_hash, range.offset);
+		hash_combine(compatibility_hash, range.size);
+	}
+
+	for (uint32_t set_index = 0; set_index < descriptor_set_layouts.size(); set_index++)
+	{
+		auto layout_it = descriptor_set_layouts.find(set_index);
+
+		hash_combine(compatibility_hash, layout_it != descriptor_set_layouts.end() ? layout_it->second->get_handle() : VK_NULL_HANDLE);
+
+		set_compatibility_hashes.push_back(compatibility_hash);
+	}
+
 	// Create the Vulkan pipeline layout handle
 	auto result = vkCreatePipelineLayout(device.get_handle(), &create_info, nullptr, &handle);
 
@@ -69,7 +121,10 @@ PipelineLayout::PipelineLayout(PipelineLayout &&other) :
     device{other.device},
     handle{other.handle},
     shader_program{std::move(other.shader_program)},
-    descriptor_set_layouts{std::move(other.descriptor_set_layouts)}
+    descriptor_set_layouts{std::move(other.descriptor_set_layouts)},
+    set_compatibility_hashes{std::move(other.set_compatibility_hashes)},
+    push_constant_ranges{std::move(other.push_constant_ranges)},
+    bindings{std::move(other.bindings)}
 {
 	other.handle = VK_NULL_HANDLE;
 }
@@ -107,13 +162,30 @@ VkShaderStageFlags PipelineLayout::get_push_constant_range_stage(uint32_t offset
 {
 	VkShaderStageFlags stages = 0;
 
-	for (auto &push_constant_resource : shader_program.get_resources(ShaderResourceType::PushConstant))
+	for (auto &range : push_constant_ranges)
 	{
-		if (offset >= push_constant_resource.offset && offset + size <= push_constant_resource.offset + push_constant_resource.size)
+		if (offset >= range.offset && offset + size <= range.offset + range.size)
 		{
-			stages |= push_constant_resource.stages;
+			stages |= range.stageFlags;
 		}
 	}
 	return stages;
 }
+
+const std::vector<VkPushConstantRange> &PipelineLayout::get_push_constant_ranges() const
+{
+	return push_constant_ranges;
+}
+
+const ShaderResourceBinding *PipelineLayout::find_binding(const std::string &name) const
+{
+	auto it = bindings.find(name);
+
+	return it != bindings.end() ? &it->second : nullptr;
+}
+
+size_t PipelineLayout::get_set_compatibility_hash(uint32_t set_index) const
+{
+	return set_compatibility_hashes.at(set_index);
+}
 }        // namespace vkb
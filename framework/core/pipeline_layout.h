@@ -32,6 +32,18 @@ class Device;
 class ShaderModule;
 class DescriptorSetLayout;
 
+/**
+ * @brief Where a descriptor resource of a pipeline layout is bound
+ */
+struct ShaderResourceBinding
+{
+	uint32_t set;
+
+	uint32_t binding;
+
+	ShaderResourceType type;
+};
+
 class PipelineLayout
 {
   public:
@@ -57,6 +69,22 @@ class PipelineLayout
 
 	VkShaderStageFlags get_push_constant_range_stage(uint32_t offset, uint32_t size) const;
 
+	const std::vector<VkPushConstantRange> &get_push_constant_ranges() const;
+
+	/**
+	 * @brief Looks up a descriptor resource in the binding table built with the layout
+	 * @return The set and binding of the resource of a name, nullptr if the shaders have none
+	 */
+	const ShaderResourceBinding *find_binding(const std::string &name) const;
+
+	/**
+	 * @brief Pipeline layouts are compatible for a set if they have the same push constant ranges,
+	 *        and identical descriptor set layouts for that set and all the lower numbered ones.
+	 *        A descriptor set bound with a compatible layout stays bound for this one
+	 * @return Hash of everything the compatibility for a set depends on
+	 */
+	size_t get_set_compatibility_hash(uint32_t set_index) const;
+
   private:
 	Device &device;
 
@@ -65,5 +93,13 @@ class PipelineLayout
 	ShaderProgram shader_program;
 
 	std::unordered_map<uint32_t, DescriptorSetLayout *> descriptor_set_layouts;
+
+	/// Indexed by set
+	std::vector<size_t> set_compatibility_hashes;
+
+	std::vector<VkPushConstantRange> push_constant_ranges;
+
+	/// Set and binding of the descriptor resources, by name
+	std::unordered_map<std::string, ShaderResourceBinding> bindings;
 };
 }        // namespace vkb
@@ -0,0 +1,85 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+
+namespace vkb
+{
+class Device;
+
+/**
+ * @brief Represents a Vulkan Query Pool
+ */
+class QueryPool
+{
+  public:
+	/**
+	 * @brief Creates a Vulkan Query Pool
+	 * @param d The device to use
+	 * @param info Creation details
+	 */
+	QueryPool(Device &d, const VkQueryPoolCreateInfo &info);
+
+	QueryPool(const QueryPool &) = delete;
+
+	QueryPool(QueryPool &&pool);
+
+	~QueryPool();
+
+	QueryPool &operator=(const QueryPool &) = delete;
+
+	QueryPool &operator=(QueryPool &&) = delete;
+
+	/**
+	 * @return The vulkan query pool handle
+	 */
+	VkQueryPool get_handle() const;
+
+	/**
+	 * @brief Retrieves the results of a range of queries
+	 * @param first_query The first query to retrieve
+	 * @param num_queries The number of queries to retrieve
+	 * @param result_bytes The size of the results buffer in bytes
+	 * @param results The buffer the results are written to
+	 * @param stride The stride in bytes between the results of the queries
+	 * @param flags How and when the results are returned
+	 * @return VK_NOT_READY if some of the results are not available yet and VK_QUERY_RESULT_WAIT_BIT is not set
+	 */
+	VkResult get_results(uint32_t first_query, uint32_t num_queries,
+	                     size_t result_bytes, void *results, VkDeviceSize stride,
+	                     VkQueryResultFlags flags);
+
+	/**
+	 * @brief Resets a range of queries from the host, requires VK_EXT_host_query_reset.
+	 *        The queries must not be used by pending command buffers
+	 * @param first_query The first query to reset
+	 * @param num_queries The number of queries to reset
+	 */
+	void host_reset(uint32_t first_query, uint32_t num_queries);
+
+  private:
+	Device &device;
+
+	VkQueryPool handle{VK_NULL_HANDLE};
+};
+}        // namespace vkb
@@ -41,7 +41,8 @@ Queue::Queue(Queue &&other) :
     family_index{other.family_index},
     index{other.index},
     can_present{other.can_present},
-    properties{other.properties}
+    properties{other.properties},
+    mutex{std::move(other.mutex)}
 {
 	other.handle       = VK_NULL_HANDLE;
 	other.family_index = {};
@@ -82,6 +83,8 @@ VkBool32 Queue::support_present() const
 
 VkResult Queue::submit(const std::vector<VkSubmitInfo> &submit_infos, VkFence fence) const
 {
+	std::lock_guard<std::mutex> lock{*mutex};
+
 	return vkQueueSubmit(handle, to_u32(submit_infos.size()), submit_infos.data(), fence);
 }
 
@@ -101,11 +104,15 @@ VkResult Queue::present(const VkPresentInfoKHR &present_info) const
 		return VK_ERROR_INCOMPATIBLE_DISPLAY_KHR;
 	}
 
+	std::lock_guard<std::mutex> lock{*mutex};
+
 	return vkQueuePresentKHR(handle, &present_info);
 }        // namespace vkb
 
 VkResult Queue::wait_idle() const
 {
+	std::lock_guard<std::mutex> lock{*mutex};
+
 	return vkQueueWaitIdle(handle);
 }
 }        // namespace vkb
@@ -20,6 +20,9 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
+
 #include "common/helpers.h"
 #include "common/vk_common.h"
 #include "core/swapchain.h"
@@ -74,5 +77,8 @@ class Queue
 	VkBool32 can_present{VK_FALSE};
 
 	VkQueueFamilyProperties properties{};
+
+	/// Serializes the submissions, as scenes can be loaded on other threads than the render loop. Shared by copies
+	std::shared_ptr<std::mutex> mutex{std::make_shared<std::mutex>()};
 };
 }        // namespace vkb
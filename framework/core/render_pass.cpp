@@ -20,6 +20,8 @@
 
 #include "render_pass.h"
 
+#include <algorithm>
+#include <functional>
 #include <numeric>
 
 #include "device.h"
@@ -27,6 +29,168 @@
 
 namespace vkb
 {
+namespace
+{
+void add_compatibility_value(std::vector<uint8_t> &key, std::size_t &hash, uint32_t value)
+{
+	auto bytes = reinterpret_cast<const uint8_t *>(&value);
+
+	key.insert(key.end(), bytes, bytes + sizeof(value));
+
+	hash_combine(hash, value);
+}
+
+void add_compatibility_references(std::vector<uint8_t> &key, std::size_t &hash, const VkAttachmentReference *references, uint32_t count)
+{
+	add_compatibility_value(key, hash, references ? count : 0U);
+
+	for (uint32_t i = 0U; references && i < count; ++i)
+	{
+		add_compatibility_value(key, hash, references[i].attachment);
+	}
+}
+
+/**
+ * @brief Copies attachment references to their VK_KHR_create_renderpass2 equivalent,
+ *        with the aspects input attachments read
+ */
+std::vector<VkAttachmentReference2KHR> to_references2(const VkAttachmentReference *references, uint32_t count, const VkRenderPassCreateInfo &create_info)
+{
+	std::vector<VkAttachmentReference2KHR> references2;
+
+	for (uint32_t i = 0U; references && i < count; ++i)
+	{
+		VkAttachmentReference2KHR reference{VK_STRUCTURE_TYPE_ATTACHMENT_REFERENCE_2_KHR};
+		reference.attachment = references[i].attachment;
+		reference.layout     = references[i].layout;
+
+		if (reference.attachment != VK_ATTACHMENT_UNUSED)
+		{
+			reference.aspectMask = is_depth_stencil_format(create_info.pAttachments[reference.attachment].format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+
+		references2.push_back(reference);
+	}
+
+	return references2;
+}
+
+/**
+ * @brief Creates a render pass with VK_KHR_create_renderpass2, as shading rate attachments can only be referenced
+ *        by VkSubpassDescription2KHR. Everything else is copied from the create info, except the multiview
+ *        create info which VkSubpassDescription2KHR replaces with view masks
+ */
+VkResult create_render_pass2(Device &device, const VkRenderPassCreateInfo &create_info, const std::vector<SubpassInfo> &subpasses, VkRenderPass *handle)
+{
+	std::vector<VkAttachmentDescription2KHR> attachments;
+
+	for (uint32_t i = 0U; i < create_info.attachmentCount; ++i)
+	{
+		auto &description = create_info.pAttachments[i];
+
+		VkAttachmentDescription2KHR attachment{VK_STRUCTURE_TYPE_ATTACHMENT_DESCRIPTION_2_KHR};
+		attachment.flags          = description.flags;
+		attachment.format         = description.format;
+		attachment.samples        = description.samples;
+		attachment.loadOp         = description.loadOp;
+		attachment.storeOp        = description.storeOp;
+		attachment.stencilLoadOp  = description.stencilLoadOp;
+		attachment.stencilStoreOp = description.stencilStoreOp;
+		attachment.initialLayout  = description.initialLayout;
+		attachment.finalLayout    = description.finalLayout;
+
+		attachments.push_back(attachment);
+	}
+
+	// Kept until the render pass is created
+	std::vector<std::vector<VkAttachmentReference2KHR>> input_references;
+	std::vector<std::vector<VkAttachmentReference2KHR>> color_references;
+	std::vector<std::vector<VkAttachmentReference2KHR>> resolve_references;
+	std::vector<std::vector<VkAttachmentReference2KHR>> depth_stencil_references;
+	std::vector<VkAttachmentReference2KHR>              shading_rate_references(create_info.subpassCount, {VK_STRUCTURE_TYPE_ATTACHMENT_REFERENCE_2_KHR});
+	std::vector<VkFragmentShadingRateAttachmentInfoKHR> shading_rate_infos(create_info.subpassCount, {VK_STRUCTURE_TYPE_FRAGMENT_SHADING_RATE_ATTACHMENT_INFO_KHR});
+
+	for (uint32_t i = 0U; i < create_info.subpassCount; ++i)
+	{
+		auto &description = create_info.pSubpasses[i];
+
+		input_references.push_back(to_references2(description.pInputAttachments, description.inputAttachmentCount, create_info));
+		color_references.push_back(to_references2(description.pColorAttachments, description.colorAttachmentCount, create_info));
+		resolve_references.push_back(to_references2(description.pResolveAttachments, description.colorAttachmentCount, create_info));
+		depth_stencil_references.push_back(to_references2(description.pDepthStencilAttachment, 1U, create_info));
+	}
+
+	std::vector<VkSubpassDescription2KHR> subpass_descriptions;
+
+	for (uint32_t i = 0U; i < create_info.subpassCount; ++i)
+	{
+		auto &description = create_info.pSubpasses[i];
+
+		VkSubpassDescription2KHR subpass{VK_STRUCTURE_TYPE_SUBPASS_DESCRIPTION_2_KHR};
+		subpass.flags                   = description.flags;
+		subpass.pipelineBindPoint       = description.pipelineBindPoint;
+		subpass.inputAttachmentCount    = to_u32(input_references[i].size());
+		subpass.pInputAttachments       = input_references[i].empty() ? nullptr : input_references[i].data();
+		subpass.colorAttachmentCount    = to_u32(color_references[i].size());
+		subpass.pColorAttachments       = color_references[i].empty() ? nullptr : color_references[i].data();
+		subpass.pResolveAttachments     = resolve_references[i].empty() ? nullptr : resolve_references[i].data();
+		subpass.pDepthStencilAttachment = depth_stencil_references[i].empty() ? nullptr : depth_stencil_references[i].data();
+		subpass.viewMask                = i < subpasses.size() ? subpasses[i].view_mask : 0U;
+
+		if (i < subpasses.size() && subpasses[i].shading_rate_attachment != VK_ATTACHMENT_UNUSED)
+		{
+			shading_rate_references[i].attachment = subpasses[i].shading_rate_attachment;
+			shading_rate_references[i].layout     = VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR;
+
+			shading_rate_infos[i].pFragmentShadingRateAttachment = &shading_rate_references[i];
+			shading_rate_infos[i].shadingRateAttachmentTexelSize = subpasses[i].shading_rate_texel_size;
+
+			subpass.pNext = &shading_rate_infos[i];
+		}
+
+		subpass_descriptions.push_back(subpass);
+	}
+
+	std::vector<VkSubpassDependency2KHR> dependencies;
+
+	for (uint32_t i = 0U; i < create_info.dependencyCount; ++i)
+	{
+		auto &description = create_info.pDependencies[i];
+
+		VkSubpassDependency2KHR dependency{VK_STRUCTURE_TYPE_SUBPASS_DEPENDENCY_2_KHR};
+		dependency.srcSubpass      = description.srcSubpass;
+		dependency.dstSubpass      = description.dstSubpass;
+		dependency.srcStageMask    = description.srcStageMask;
+		dependency.dstStageMask    = description.dstStageMask;
+		dependency.srcAccessMask   = description.srcAccessMask;
+		dependency.dstAccessMask   = description.dstAccessMask;
+		dependency.dependencyFlags = description.dependencyFlags;
+
+		dependencies.push_back(dependency);
+	}
+
+	uint32_t correlation_mask = std::accumulate(subpass_descriptions.begin(), subpass_descriptions.end(), 0U,
+	                                            [](uint32_t mask, const VkSubpassDescription2KHR &subpass) { return mask | subpass.viewMask; });
+
+	VkRenderPassCreateInfo2KHR create_info2{VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO_2_KHR};
+
+	create_info2.attachmentCount = to_u32(attachments.size());
+	create_info2.pAttachments    = attachments.data();
+	create_info2.subpassCount    = to_u32(subpass_descriptions.size());
+	create_info2.pSubpasses      = subpass_descriptions.data();
+	create_info2.dependencyCount = to_u32(dependencies.size());
+	create_info2.pDependencies   = dependencies.data();
+
+	if (correlation_mask != 0U)
+	{
+		create_info2.correlatedViewMaskCount = 1U;
+		create_info2.pCorrelatedViewMasks    = &correlation_mask;
+	}
+
+	return vkCreateRenderPass2KHR(device.get_handle(), &create_info2, nullptr, handle);
+}
+}        // namespace
+
 VkRenderPass RenderPass::get_handle() const
 {
 	return handle;
@@ -37,10 +201,41 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
     subpass_count{std::max<size_t>(1, subpasses.size())},        // At least 1 subpass
     input_attachments{subpass_count},
     color_attachments{subpass_count},
-    depth_stencil_attachments{subpass_count}
+    depth_stencil_attachments{subpass_count},
+    color_resolve_attachments{subpass_count},
+    sample_counts(subpass_count, VK_SAMPLE_COUNT_1_BIT),
+    subpass_flags(subpass_count, 0)
 {
 	uint32_t depth_stencil_attachment{VK_ATTACHMENT_UNUSED};
 
+	// Attachments which subpasses only read their shading rates from
+	std::vector<bool> shading_rate_attachments(attachments.size(), false);
+
+	for (auto &subpass : subpasses)
+	{
+		if (subpass.shading_rate_attachment != VK_ATTACHMENT_UNUSED)
+		{
+			assert(device.supports_shading_rate_attachment() && "Shading rate attachments are not supported");
+			assert(subpass.shading_rate_attachment < attachments.size() && "Shading rate attachment out of range");
+
+			shading_rate_attachments[subpass.shading_rate_attachment] = true;
+		}
+	}
+
+	// Views each subpass broadcasts its draws to, none for the default subpass
+	view_masks.resize(subpass_count, 0U);
+
+	for (size_t i = 0; i < subpasses.size(); ++i)
+	{
+		view_masks[i] = subpasses[i].view_mask;
+	}
+
+	bool multiview = std::any_of(view_masks.begin(), view_masks.end(), [](uint32_t mask) { return mask != 0U; });
+
+	assert((!multiview || device.supports_multiview()) && "Multiview is not supported");
+	assert((!multiview || std::none_of(view_masks.begin(), view_masks.end(), [](uint32_t mask) { return mask == 0U; })) &&
+	       "Either all the subpasses of a render pass are multiview or none");
+
 	std::vector<VkAttachmentDescription> attachment_descriptions;
 
 	for (uint32_t i = 0U; i < attachments.size(); ++i)
@@ -66,28 +261,94 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
 		}
 
 		attachment_descriptions.push_back(std::move(attachment));
+
+		attachment_formats.push_back(attachments[i].format);
 	}
 
 	std::vector<VkSubpassDescription> subpass_descriptions;
 	subpass_descriptions.reserve(subpass_count);
 
+	// Layouts the attachments in the general layout of a subpass reading in rasterization order enter and leave the render pass with
+	std::vector<VkImageLayout> outer_layouts(attachment_descriptions.size(), VK_IMAGE_LAYOUT_UNDEFINED);
+
 	for (size_t i = 0; i < subpasses.size(); ++i)
 	{
 		auto &subpass = subpasses[i];
 
+		auto is_feedback = [&](uint32_t attachment) {
+			if (!subpass.rasterization_order_access ||
+			    std::find(subpass.input_attachments.begin(), subpass.input_attachments.end(), attachment) == subpass.input_attachments.end())
+			{
+				return false;
+			}
+
+			return attachment == depth_stencil_attachment ||
+			       std::find(subpass.output_attachments.begin(), subpass.output_attachments.end(), attachment) != subpass.output_attachments.end();
+		};
+
+#if defined(VK_EXT_rasterization_order_attachment_access)
+		if (subpass.rasterization_order_access)
+		{
+			subpass_flags[i] = VK_SUBPASS_DESCRIPTION_RASTERIZATION_ORDER_ATTACHMENT_COLOR_ACCESS_BIT_EXT;
+
+			if (depth_stencil_attachment != VK_ATTACHMENT_UNUSED && is_feedback(depth_stencil_attachment))
+			{
+				subpass_flags[i] |= VK_SUBPASS_DESCRIPTION_RASTERIZATION_ORDER_ATTACHMENT_DEPTH_ACCESS_BIT_EXT;
+			}
+		}
+#endif
+
 		// Fill color/depth attachments references
 		for (auto o_attachment : subpass.output_attachments)
 		{
 			if (o_attachment != depth_stencil_attachment)
 			{
-				color_attachments[i].push_back({o_attachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+				if (is_feedback(o_attachment))
+				{
+					color_attachments[i].push_back({o_attachment, VK_IMAGE_LAYOUT_GENERAL});
+					outer_layouts[o_attachment] = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				}
+				else
+				{
+					color_attachments[i].push_back({o_attachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+				}
 			}
 		}
 
-		// Fill input attachments references
+		// Fill color resolve attachments references, resolved on-tile at the end of the subpass
+		if (!subpass.color_resolve_attachments.empty())
+		{
+			assert(subpass.color_resolve_attachments.size() == color_attachments[i].size() && "Each color output needs a resolve attachment or VK_ATTACHMENT_UNUSED");
+
+			for (auto r_attachment : subpass.color_resolve_attachments)
+			{
+				if (r_attachment == VK_ATTACHMENT_UNUSED)
+				{
+					color_resolve_attachments[i].push_back({VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED});
+				}
+				else
+				{
+					color_resolve_attachments[i].push_back({r_attachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+				}
+			}
+		}
+
+		// Fill input attachments references, all in the general layout if read in rasterization order
 		for (auto i_attachment : subpass.input_attachments)
 		{
-			if (is_depth_stencil_format(attachment_descriptions[i_attachment].format))
+			bool depth_stencil = is_depth_stencil_format(attachment_descriptions[i_attachment].format);
+
+			if (subpass.rasterization_order_access)
+			{
+				input_attachments[i].push_back({i_attachment, VK_IMAGE_LAYOUT_GENERAL});
+
+				if (outer_layouts[i_attachment] == VK_IMAGE_LAYOUT_UNDEFINED)
+				{
+					outer_layouts[i_attachment] = depth_stencil ? (is_feedback(i_attachment) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL) :
+					                                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				}
+			}
+			else if (depth_stencil)
 			{
 				input_attachments[i].push_back({i_attachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL});
 			}
@@ -99,7 +360,18 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
 
 		if (depth_stencil_attachment != VK_ATTACHMENT_UNUSED)
 		{
-			depth_stencil_attachments[i].push_back({depth_stencil_attachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL});
+			auto layout = is_feedback(depth_stencil_attachment) ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			depth_stencil_attachments[i].push_back({depth_stencil_attachment, layout});
+		}
+
+		// The attachments a subpass renders to share their sample count
+		if (!color_attachments[i].empty())
+		{
+			sample_counts[i] = attachment_descriptions[color_attachments[i][0].attachment].samples;
+		}
+		else if (depth_stencil_attachment != VK_ATTACHMENT_UNUSED)
+		{
+			sample_counts[i] = attachment_descriptions[depth_stencil_attachment].samples;
 		}
 	}
 
@@ -108,6 +380,7 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
 		auto &subpass = subpasses[i];
 
 		VkSubpassDescription subpass_description{};
+		subpass_description.flags             = subpass_flags[i];
 		subpass_description.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 
 		subpass_description.pInputAttachments    = input_attachments[i].empty() ? nullptr : input_attachments[i].data();
@@ -116,6 +389,8 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
 		subpass_description.pColorAttachments    = color_attachments[i].empty() ? nullptr : color_attachments[i].data();
 		subpass_description.colorAttachmentCount = to_u32(color_attachments[i].size());
 
+		subpass_description.pResolveAttachments = color_resolve_attachments[i].empty() ? nullptr : color_resolve_attachments[i].data();
+
 		subpass_description.pDepthStencilAttachment = depth_stencil_attachments[i].empty() ? nullptr : depth_stencil_attachments[i].data();
 
 		subpass_descriptions.push_back(subpass_description);
@@ -129,7 +404,7 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
 
 		for (uint32_t k = 0U; k < attachment_descriptions.size(); ++k)
 		{
-			if (k == depth_stencil_attachment)
+			if (k == depth_stencil_attachment || (attachments[k].usage & VK_IMAGE_USAGE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR))
 			{
 				continue;
 			}
@@ -139,6 +414,11 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
 
 		subpass_description.pColorAttachments = color_attachments[0].data();
 
+		if (!attachment_descriptions.empty())
+		{
+			sample_counts[0] = attachment_descriptions[0].samples;
+		}
+
 		if (depth_stencil_attachment != VK_ATTACHMENT_UNUSED)
 		{
 			depth_stencil_attachments[0].push_back({depth_stencil_attachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL});
@@ -172,6 +452,16 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
 			}
 		}
 
+		for (uint32_t k = 0U; subpass.pResolveAttachments && k < subpass.colorAttachmentCount; ++k)
+		{
+			auto reference = subpass.pResolveAttachments[k];
+			// Set it only if not defined yet
+			if (reference.attachment != VK_ATTACHMENT_UNUSED && attachment_descriptions[reference.attachment].initialLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+			{
+				attachment_descriptions[reference.attachment].initialLayout = reference.layout;
+			}
+		}
+
 		if (subpass.pDepthStencilAttachment)
 		{
 			auto reference = *subpass.pDepthStencilAttachment;
@@ -183,9 +473,26 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
 		}
 	}
 
+	// Attachments which no subpass uses keep their layout if the load store info asks for it
+	for (uint32_t i = 0U; i < attachment_descriptions.size() && i < load_store_infos.size(); ++i)
+	{
+		auto &attachment = attachment_descriptions[i];
+
+		if (attachment.initialLayout == VK_IMAGE_LAYOUT_UNDEFINED && load_store_infos[i].preserved_layout != VK_IMAGE_LAYOUT_UNDEFINED)
+		{
+			attachment.initialLayout = load_store_infos[i].preserved_layout;
+			attachment.finalLayout   = load_store_infos[i].preserved_layout;
+		}
+	}
+
 	// Make the final layout same as the last subpass layout
 	{
-		auto &subpass = subpass_descriptions.back();
+		auto &subpass        = subpass_descriptions.back();
+		bool  depth_feedback = false;
+
+#if defined(VK_EXT_rasterization_order_attachment_access)
+		depth_feedback = (subpass.flags & VK_SUBPASS_DESCRIPTION_RASTERIZATION_ORDER_ATTACHMENT_DEPTH_ACCESS_BIT_EXT) != 0;
+#endif
 
 		for (uint32_t k = 0U; k < subpass.colorAttachmentCount; ++k)
 		{
@@ -194,14 +501,24 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
 			attachment_descriptions[reference.attachment].finalLayout = reference.layout;
 		}
 
+		for (uint32_t k = 0U; subpass.pResolveAttachments && k < subpass.colorAttachmentCount; ++k)
+		{
+			const auto &reference = subpass.pResolveAttachments[k];
+
+			if (reference.attachment != VK_ATTACHMENT_UNUSED)
+			{
+				attachment_descriptions[reference.attachment].finalLayout = reference.layout;
+			}
+		}
+
 		for (uint32_t k = 0U; k < subpass.inputAttachmentCount; ++k)
 		{
 			const auto &reference = subpass.pInputAttachments[k];
 
 			attachment_descriptions[reference.attachment].finalLayout = reference.layout;
 
-			// Do not use depth attachment if used as input
-			if (reference.attachment == depth_stencil_attachment)
+			// Do not use depth attachment if used as input, unless it is read in rasterization order
+			if (reference.attachment == depth_stencil_attachment && !depth_feedback)
 			{
 				subpass.pDepthStencilAttachment = nullptr;
 			}
@@ -215,6 +532,29 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
 		}
 	}
 
+	// Shading rate attachments stay in their layout, generated before the render pass
+	for (uint32_t i = 0U; i < attachment_descriptions.size(); ++i)
+	{
+		if (shading_rate_attachments[i])
+		{
+			attachment_descriptions[i].initialLayout = VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR;
+			attachment_descriptions[i].finalLayout   = VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR;
+		}
+	}
+
+	// Attachments read in rasterization order enter and leave the render pass in the layouts they have in other passes,
+	// the general layout of the subpass is only reached by the transitions of the render pass
+	for (uint32_t i = 0U; i < attachment_descriptions.size(); ++i)
+	{
+		auto &attachment = attachment_descriptions[i];
+
+		if (outer_layouts[i] != VK_IMAGE_LAYOUT_UNDEFINED)
+		{
+			attachment.initialLayout = attachment.initialLayout == VK_IMAGE_LAYOUT_GENERAL ? outer_layouts[i] : attachment.initialLayout;
+			attachment.finalLayout   = attachment.finalLayout == VK_IMAGE_LAYOUT_GENERAL ? outer_layouts[i] : attachment.finalLayout;
+		}
+	}
+
 	// Set subpass dependencies
 	std::vector<VkSubpassDependency> dependencies(subpass_count - 1);
 
@@ -222,15 +562,88 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
 	{
 		for (uint32_t i = 0; i < dependencies.size(); ++i)
 		{
-			// Transition input attachments from color attachment to shader read
+			// Transition input attachments from color attachment to shader read,
+			// and make the depth written by a subpass visible to the depth tests of the next one
 			dependencies[i].srcSubpass      = i;
 			dependencies[i].dstSubpass      = i + 1;
-			dependencies[i].srcStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			dependencies[i].dstStageMask    = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-			dependencies[i].srcAccessMask   = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-			dependencies[i].dstAccessMask   = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+			dependencies[i].srcStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			dependencies[i].dstStageMask    = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			dependencies[i].srcAccessMask   = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			dependencies[i].dstAccessMask   = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 			dependencies[i].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+			// Each view only depends on the same view of the previous subpass, so views stay independent on-tile
+			if (multiview)
+			{
+				dependencies[i].dependencyFlags |= VK_DEPENDENCY_VIEW_LOCAL_BIT_KHR;
+			}
+		}
+	}
+
+	// A single subpass rendering to all the attachments needs no render pass: its attachments keep the layouts
+	// of their references, so the render pass would not transition them, and no attachment is only loaded or stored
+	if (device.uses_dynamic_rendering() && subpasses.size() == 1 && subpasses[0].input_attachments.empty() &&
+	    subpasses[0].shading_rate_attachment == VK_ATTACHMENT_UNUSED && !subpasses[0].rasterization_order_access)
+	{
+		std::vector<bool> rendered(attachment_descriptions.size(), false);
+
+		for (auto &reference : color_attachments[0])
+		{
+			rendered[reference.attachment] = true;
+		}
+
+		for (auto &reference : color_resolve_attachments[0])
+		{
+			if (reference.attachment != VK_ATTACHMENT_UNUSED)
+			{
+				rendered[reference.attachment] = true;
+			}
 		}
+
+		for (auto &reference : depth_stencil_attachments[0])
+		{
+			rendered[reference.attachment] = true;
+		}
+
+		dynamic = std::all_of(rendered.begin(), rendered.end(), [](bool used) { return used; });
+	}
+
+	// Only the attachment formats and samples and the attachment references decide compatibility,
+	// the dependencies follow from the subpass count
+	add_compatibility_value(compatibility_key, compatibility_hash, dynamic ? 1U : 0U);
+
+	add_compatibility_value(compatibility_key, compatibility_hash, to_u32(attachment_descriptions.size()));
+
+	for (auto &attachment : attachment_descriptions)
+	{
+		add_compatibility_value(compatibility_key, compatibility_hash, attachment.format);
+		add_compatibility_value(compatibility_key, compatibility_hash, attachment.samples);
+	}
+
+	add_compatibility_value(compatibility_key, compatibility_hash, to_u32(subpass_descriptions.size()));
+
+	for (size_t i = 0; i < subpass_descriptions.size(); ++i)
+	{
+		auto &subpass = subpass_descriptions[i];
+
+		add_compatibility_value(compatibility_key, compatibility_hash, subpass.flags);
+		add_compatibility_references(compatibility_key, compatibility_hash, subpass.pInputAttachments, subpass.inputAttachmentCount);
+		add_compatibility_references(compatibility_key, compatibility_hash, subpass.pColorAttachments, subpass.colorAttachmentCount);
+		add_compatibility_references(compatibility_key, compatibility_hash, subpass.pResolveAttachments, subpass.colorAttachmentCount);
+		add_compatibility_references(compatibility_key, compatibility_hash, subpass.pDepthStencilAttachment, 1U);
+
+		if (i < subpasses.size())
+		{
+			add_compatibility_value(compatibility_key, compatibility_hash, subpasses[i].shading_rate_attachment);
+			add_compatibility_value(compatibility_key, compatibility_hash, subpasses[i].shading_rate_texel_size.width);
+			add_compatibility_value(compatibility_key, compatibility_hash, subpasses[i].shading_rate_texel_size.height);
+			add_compatibility_value(compatibility_key, compatibility_hash, subpasses[i].view_mask);
+		}
+	}
+
+	if (dynamic)
+	{
+		return;
 	}
 
 	// Create render pass
@@ -243,7 +656,25 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
 	create_info.dependencyCount = to_u32(dependencies.size());
 	create_info.pDependencies   = dependencies.data();
 
-	auto result = vkCreateRenderPass(device.get_handle(), &create_info, nullptr, &handle);
+	// The views are close to each other, as the eyes of a stereo pair, so implementations may render them concurrently
+	uint32_t correlation_mask = std::accumulate(view_masks.begin(), view_masks.end(), 0U, std::bit_or<uint32_t>());
+
+	VkRenderPassMultiviewCreateInfoKHR multiview_info{VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO_KHR};
+
+	if (multiview)
+	{
+		multiview_info.subpassCount         = to_u32(view_masks.size());
+		multiview_info.pViewMasks           = view_masks.data();
+		multiview_info.correlationMaskCount = 1U;
+		multiview_info.pCorrelationMasks    = &correlation_mask;
+
+		create_info.pNext = &multiview_info;
+	}
+
+	bool uses_shading_rate_attachment = std::any_of(shading_rate_attachments.begin(), shading_rate_attachments.end(), [](bool used) { return used; });
+
+	auto result = uses_shading_rate_attachment ? create_render_pass2(device, create_info, subpasses, &handle) :
+	                                             vkCreateRenderPass(device.get_handle(), &create_info, nullptr, &handle);
 
 	if (result != VK_SUCCESS)
 	{
@@ -254,10 +685,18 @@ RenderPass::RenderPass(Device &device, const std::vector<Attachment> &attachment
 RenderPass::RenderPass(RenderPass &&other) :
     device{other.device},
     handle{other.handle},
+    dynamic{other.dynamic},
     subpass_count{other.subpass_count},
     input_attachments{other.input_attachments},
     color_attachments{other.color_attachments},
-    depth_stencil_attachments{other.depth_stencil_attachments}
+    depth_stencil_attachments{other.depth_stencil_attachments},
+    color_resolve_attachments{other.color_resolve_attachments},
+    sample_counts{other.sample_counts},
+    subpass_flags{other.subpass_flags},
+    view_masks{other.view_masks},
+    attachment_formats{other.attachment_formats},
+    compatibility_key{std::move(other.compatibility_key)},
+    compatibility_hash{other.compatibility_hash}
 {
 	other.handle = VK_NULL_HANDLE;
 }
@@ -275,4 +714,68 @@ const uint32_t RenderPass::get_color_output_count(uint32_t subpass_index) const
 {
 	return to_u32(color_attachments[subpass_index].size());
 }
+
+VkSampleCountFlagBits RenderPass::get_sample_count(uint32_t subpass_index) const
+{
+	return sample_counts[subpass_index];
+}
+
+VkSubpassDescriptionFlags RenderPass::get_subpass_flags(uint32_t subpass_index) const
+{
+	return subpass_flags[subpass_index];
+}
+
+const std::vector<uint8_t> &RenderPass::get_compatibility_key() const
+{
+	return compatibility_key;
+}
+
+std::size_t RenderPass::get_compatibility_hash() const
+{
+	return compatibility_hash;
+}
+
+bool RenderPass::is_dynamic() const
+{
+	return dynamic;
+}
+
+const std::vector<VkAttachmentReference> &RenderPass::get_color_references(uint32_t subpass_index) const
+{
+	return color_attachments[subpass_index];
+}
+
+const std::vector<VkAttachmentReference> &RenderPass::get_color_resolve_references(uint32_t subpass_index) const
+{
+	return color_resolve_attachments[subpass_index];
+}
+
+const VkAttachmentReference *RenderPass::get_depth_stencil_reference(uint32_t subpass_index) const
+{
+	return depth_stencil_attachments[subpass_index].empty() ? nullptr : &depth_stencil_attachments[subpass_index][0];
+}
+
+std::vector<VkFormat> RenderPass::get_color_formats(uint32_t subpass_index) const
+{
+	std::vector<VkFormat> formats;
+
+	for (auto &reference : color_attachments[subpass_index])
+	{
+		formats.push_back(attachment_formats[reference.attachment]);
+	}
+
+	return formats;
+}
+
+VkFormat RenderPass::get_depth_stencil_format(uint32_t subpass_index) const
+{
+	auto reference = get_depth_stencil_reference(subpass_index);
+
+	return reference ? attachment_formats[reference->attachment] : VK_FORMAT_UNDEFINED;
+}
+
+uint32_t RenderPass::get_view_mask(uint32_t subpass_index) const
+{
+	return view_masks[subpass_index];
+}
 }        // namespace vkb
@@ -33,11 +33,38 @@ struct SubpassInfo
 	std::vector<uint32_t> input_attachments;
 
 	std::vector<uint32_t> output_attachments;
+
+	/// Attachments each color output is resolved to at the end of the subpass, VK_ATTACHMENT_UNUSED
+	/// for outputs which are not resolved. Empty if the subpass resolves nothing
+	std::vector<uint32_t> color_resolve_attachments;
+
+	/// Whether the subpass reads the attachments it also renders to, such as a G-buffer written by earlier draws,
+	/// in rasterization order with VK_EXT_rasterization_order_attachment_access. They are in the general layout in the subpass
+	bool rasterization_order_access{false};
+
+	/// Attachment the subpass reads its shading rates from with VK_KHR_fragment_shading_rate, VK_ATTACHMENT_UNUSED for none.
+	/// Render passes with shading rate attachments are created with VK_KHR_create_renderpass2
+	uint32_t shading_rate_attachment{VK_ATTACHMENT_UNUSED};
+
+	/// Pixels covered by each texel of the shading rate attachment
+	VkExtent2D shading_rate_texel_size{};
+
+	/// Views the subpass broadcasts its draws to with VK_KHR_multiview, one bit per array layer of the attachments,
+	/// 0 if the subpass is not multiview. Either all the subpasses of a render pass are multiview or none
+	uint32_t view_mask{0};
 };
 
+/**
+ * @brief Describes the attachments and subpasses of a pass. With VK_KHR_dynamic_rendering, a pass of a single
+ *        subpass which renders to all the attachments is dynamic: it has no VkRenderPass handle and begins with
+ *        vkCmdBeginRenderingKHR, without a framebuffer, its pipelines being created from its attachment formats
+ */
 class RenderPass
 {
   public:
+	/**
+	 * @return The render pass handle, VK_NULL_HANDLE if the pass is dynamic
+	 */
 	VkRenderPass get_handle() const;
 
 	RenderPass(Device &                          device,
@@ -57,11 +84,63 @@ class RenderPass
 
 	const uint32_t get_color_output_count(uint32_t subpass_index) const;
 
+	/**
+	 * @return The sample count of the attachments a subpass renders to, which its pipelines rasterize with
+	 */
+	VkSampleCountFlagBits get_sample_count(uint32_t subpass_index) const;
+
+	/**
+	 * @return The flags of a subpass, the pipelines of subpasses reading their attachments in rasterization order need to match them
+	 */
+	VkSubpassDescriptionFlags get_subpass_flags(uint32_t subpass_index) const;
+
+	/**
+	 * @brief The state compatible render passes share: the attachment formats and samples and the subpass structure.
+	 *        Load and store operations and layouts are left out, so a pipeline works with any pass of the same key
+	 */
+	const std::vector<uint8_t> &get_compatibility_key() const;
+
+	std::size_t get_compatibility_hash() const;
+
+	/**
+	 * @return Whether the pass begins with vkCmdBeginRenderingKHR instead of a render pass and framebuffer
+	 */
+	bool is_dynamic() const;
+
+	/**
+	 * @return The attachments a subpass renders its color outputs to, in the order of the outputs
+	 */
+	const std::vector<VkAttachmentReference> &get_color_references(uint32_t subpass_index) const;
+
+	/**
+	 * @return The attachments each color output of a subpass is resolved to, empty if the subpass resolves nothing
+	 */
+	const std::vector<VkAttachmentReference> &get_color_resolve_references(uint32_t subpass_index) const;
+
+	/**
+	 * @return The depth stencil attachment of a subpass, nullptr if it has none
+	 */
+	const VkAttachmentReference *get_depth_stencil_reference(uint32_t subpass_index) const;
+
+	/**
+	 * @return The formats of the color outputs of a subpass, which its pipelines are created with if the pass is dynamic
+	 */
+	std::vector<VkFormat> get_color_formats(uint32_t subpass_index) const;
+
+	/**
+	 * @return The format of the depth stencil attachment of a subpass, VK_FORMAT_UNDEFINED if it has none
+	 */
+	VkFormat get_depth_stencil_format(uint32_t subpass_index) const;
+
+	uint32_t get_view_mask(uint32_t subpass_index) const;
+
   private:
 	Device &device;
 
 	VkRenderPass handle{VK_NULL_HANDLE};
 
+	bool dynamic{false};
+
 	size_t subpass_count;
 
 	// Store attachments for every subpass
@@ -70,5 +149,19 @@ class RenderPass
 	std::vector<std::vector<VkAttachmentReference>> color_attachments;
 
 	std::vector<std::vector<VkAttachmentReference>> depth_stencil_attachments;
+
+	std::vector<std::vector<VkAttachmentReference>> color_resolve_attachments;
+
+	std::vector<VkSampleCountFlagBits> sample_counts;
+
+	std::vector<VkSubpassDescriptionFlags> subpass_flags;
+
+	std::vector<uint32_t> view_masks;
+
+	std::vector<VkFormat> attachment_formats;
+
+	std::vector<uint8_t> compatibility_key;
+
+	std::size_t compatibility_hash{0};
 };
 }        // namespace vkb
@@ -20,6 +20,11 @@
 
 #include "shader_module.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+
 #include "common/logging.h"
 #include "device.h"
 #include "glsl_compiler.h"
@@ -28,10 +33,199 @@
 
 namespace vkb
 {
+namespace
+{
+const uint32_t SHADER_CACHE_MAGIC = 0x43505356;        // "VSPC"
+
+/// To be increased whenever the reflection, the layout of a cache or the inputs of its key change
+const uint32_t SHADER_CACHE_VERSION = 2;
+
+/**
+ * @brief Computes the key of the cached module of a source and a variant
+ */
+uint64_t get_shader_cache_key(VkShaderStageFlagBits stage, const ShaderSource &glsl_source, const std::string &entry_point, const ShaderVariant &shader_variant)
+{
+	// The ids are hashes of the content, which unlike std::hash are the same from a run to the next
+	size_t key = glsl_source.get_id();
+
+	hash_combine(key, stage);
+	hash_combine(key, hash_bytes(entry_point.data(), entry_point.size()));
+	hash_combine(key, shader_variant.get_id());
+
+	for (auto &process : shader_variant.get_processes())
+	{
+		hash_combine(key, hash_bytes(process.data(), process.size()));
+	}
+
+	// Sorted, as the iteration order of the map depends on its history
+	std::vector<std::pair<std::string, size_t>> runtime_array_sizes{shader_variant.get_runtime_array_sizes().begin(), shader_variant.get_runtime_array_sizes().end()};
+	std::sort(runtime_array_sizes.begin(), runtime_array_sizes.end());
+
+	for (auto &runtime_array_size : runtime_array_sizes)
+	{
+		hash_combine(key, hash_bytes(runtime_array_size.first.data(), runtime_array_size.first.size()));
+		hash_combine(key, runtime_array_size.second);
+	}
+
+	auto compiler_version = GLSLCompiler::get_version();
+	hash_combine(key, hash_bytes(compiler_version.data(), compiler_version.size()));
+	hash_combine(key, static_cast<uint32_t>(GLSLCompiler::get_target_language_version()));
+
+	return key;
+}
+
+/**
+ * @brief Checks whether a specialization constant stands in for a define, which is the case if it is spelled like a macro
+ */
+bool is_define_constant(const std::string &name)
+{
+	return !name.empty() && std::none_of(name.begin(), name.end(), [](char c) { return std::islower(static_cast<unsigned char>(c)); });
+}
+
+/**
+ * @brief Name of a macro defined by a process, which is either "NAME", "NAME=value" or "NAME value"
+ */
+std::string get_define_name(const std::string &def)
+{
+	return def.substr(0, def.find_first_of("= "));
+}
+
+std::string get_shader_cache_filename(uint64_t key)
+{
+	return "shader_" + std::to_string(key) + ".bin";
+}
+
+/**
+ * @brief Reads a cached module, which holds a header, the SPIR-V and the reflected resources
+ * @return True if the cache was found and is valid
+ */
+bool read_shader_cache(uint64_t key, std::vector<uint32_t> &spirv, std::vector<ShaderResource> &resources)
+{
+	std::vector<uint8_t> cache;
+
+	try
+	{
+		cache = fs::read_temp_blob(get_shader_cache_filename(key));
+	}
+	catch (const std::runtime_error &)
+	{
+		return false;
+	}
+
+	size_t offset = 0;
+
+	auto read = [&cache, &offset](void *dst, size_t size) {
+		if (size > cache.size() - offset)
+		{
+			return false;
+		}
+
+		std::memcpy(dst, cache.data() + offset, size);
+		offset += size;
+
+		return true;
+	};
+
+	uint32_t header[4]{};
+	uint64_t cache_key{0};
+
+	if (!read(header, sizeof(header)) || !read(&cache_key, sizeof(cache_key)) ||
+	    header[0] != SHADER_CACHE_MAGIC || header[1] != SHADER_CACHE_VERSION || cache_key != key)
+	{
+		return false;
+	}
+
+	spirv.resize(header[2]);
+
+	if (!read(spirv.data(), spirv.size() * sizeof(uint32_t)))
+	{
+		return false;
+	}
+
+	resources.resize(header[3]);
+
+	for (auto &resource : resources)
+	{
+		uint32_t fields[12]{};
+		uint32_t name_size{0};
+
+		if (!read(fields, sizeof(fields)) || !read(&name_size, sizeof(name_size)))
+		{
+			return false;
+		}
+
+		resource.stages                 = fields[0];
+		resource.type                   = static_cast<ShaderResourceType>(fields[1]);
+		resource.set                    = fields[2];
+		resource.binding                = fields[3];
+		resource.location               = fields[4];
+		resource.input_attachment_index = fields[5];
+		resource.vec_size               = fields[6];
+		resource.columns                = fields[7];
+		resource.array_size             = fields[8];
+		resource.offset                 = fields[9];
+		resource.size                   = fields[10];
+		resource.constant_id            = fields[11];
+		resource.dynamic                = false;
+		resource.push_descriptor        = false;
+		resource.update_after_bind      = false;
+		resource.immutable_sampler      = VK_NULL_HANDLE;
+
+		resource.name.resize(name_size);
+
+		if (!read(&resource.name[0], name_size))
+		{
+			return false;
+		}
+	}
+
+	return offset == cache.size();
+}
+
+void write_shader_cache(uint64_t key, const std::vector<uint32_t> &spirv, const std::vector<ShaderResource> &resources)
+{
+	std::vector<uint8_t> cache;
+
+	auto write = [&cache](const void *src, size_t size) {
+		auto bytes = reinterpret_cast<const uint8_t *>(src);
+		cache.insert(cache.end(), bytes, bytes + size);
+	};
+
+	uint32_t header[4]{SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, to_u32(spirv.size()), to_u32(resources.size())};
+
+	write(header, sizeof(header));
+	write(&key, sizeof(key));
+	write(spirv.data(), spirv.size() * sizeof(uint32_t));
+
+	for (auto &resource : resources)
+	{
+		// The flags set after reflection are not stored, they are set again on the new module
+		uint32_t fields[12]{resource.stages, static_cast<uint32_t>(resource.type), resource.set, resource.binding,
+		                    resource.location, resource.input_attachment_index, resource.vec_size, resource.columns,
+		                    resource.array_size, resource.offset, resource.size, resource.constant_id};
+		uint32_t name_size = to_u32(resource.name.size());
+
+		write(fields, sizeof(fields));
+		write(&name_size, sizeof(name_size));
+		write(resource.name.data(), name_size);
+	}
+
+	try
+	{
+		fs::write_temp_blob(cache, get_shader_cache_filename(key));
+	}
+	catch (const std::runtime_error &e)
+	{
+		LOGW("Failed to write the shader cache: {}", e.what());
+	}
+}
+}        // namespace
+
 ShaderModule::ShaderModule(Device &device, VkShaderStageFlagBits stage, const ShaderSource &glsl_source, const std::string &entry_point, const ShaderVariant &shader_variant) :
     device{device},
     stage{stage},
-    entry_point{entry_point}
+    entry_point{entry_point},
+    debug_name{glsl_source.get_filename()}
 {
 	// Check if application is passing in GLSL source code to compile to SPIR-V
 	if (glsl_source.get_data().empty())
@@ -45,32 +239,56 @@ ShaderModule::ShaderModule(Device &device, VkShaderStageFlagBits stage, const Sh
 		throw VulkanException{VK_ERROR_INITIALIZATION_FAILED};
 	}
 
-	GLSLCompiler glsl_compiler;
+	// Shaders can test the capabilities of the device with the preprocessor
+	ShaderVariant device_variant = shader_variant;
+
+	for (auto &define : device.get_capability_defines(stage))
+	{
+		device_variant.add_define(define);
+	}
+
+	// Modules compiled in a previous run skip glslang and spirv-cross
+	auto cache_key = get_shader_cache_key(stage, glsl_source, entry_point, device_variant);
 
-	// Compile the GLSL source
-	if (!glsl_compiler.compile_to_spirv(stage, glsl_source.get_data(), entry_point, shader_variant, spirv, info_log))
+	if (!read_shader_cache(cache_key, spirv, resources))
 	{
-		if (glsl_source.get_filename().empty())
+		spirv.clear();
+		resources.clear();
+
+		GLSLCompiler glsl_compiler;
+
+		// Compile the GLSL source
+		if (!glsl_compiler.compile_to_spirv(stage, glsl_source.get_data(), entry_point, device_variant, spirv, info_log))
 		{
-			throw VulkanException{VK_ERROR_INITIALIZATION_FAILED, "Shader compilation failed:\n" + info_log};
+			if (glsl_source.get_filename().empty())
+			{
+				throw VulkanException{VK_ERROR_INITIALIZATION_FAILED, "Shader compilation failed:\n" + info_log};
+			}
+			else
+			{
+				throw VulkanException{VK_ERROR_INITIALIZATION_FAILED, "Compilation failed for shader \"" + glsl_source.get_filename() + "\":\n" + info_log};
+			}
 		}
-		else
+
+		SPIRVReflection spirv_reflection;
+
+		// Reflect all shader resouces
+		if (!spirv_reflection.reflect_shader_resources(stage, spirv, resources, device_variant))
 		{
-			throw VulkanException{VK_ERROR_INITIALIZATION_FAILED, "Compilation failed for shader \"" + glsl_source.get_filename() + "\":\n" + info_log};
+			throw VulkanException{VK_ERROR_INITIALIZATION_FAILED};
 		}
-	}
 
-	SPIRVReflection spirv_reflection;
+		write_shader_cache(cache_key, spirv, resources);
+	}
 
-	// Reflect all shader resouces
-	if (!spirv_reflection.reflect_shader_resources(stage, spirv, resources, shader_variant))
+	// The first resource of a name is the one flagged by name, as inputs and outputs can share it
+	for (size_t i = 0; i < resources.size(); i++)
 	{
-		throw VulkanException{VK_ERROR_INITIALIZATION_FAILED};
+		resource_indices.emplace(resources[i].name, i);
 	}
 
 	// Generate a unique id, determined by source and variant
-	std::hash<std::string> hasher{};
-	id = hasher(std::string{spirv.cbegin(), spirv.cend()});
+	id = hash_bytes(spirv);
 }
 
 ShaderModule::ShaderModule(ShaderModule &&other) :
@@ -78,8 +296,10 @@ ShaderModule::ShaderModule(ShaderModule &&other) :
     id{other.id},
     stage{other.stage},
     entry_point{other.entry_point},
+    debug_name{other.debug_name},
     spirv{other.spirv},
     resources{other.resources},
+    resource_indices{other.resource_indices},
     info_log{other.info_log}
 {
 	other.stage = {};
@@ -105,6 +325,36 @@ const std::vector<ShaderResource> &ShaderModule::get_resources() const
 	return resources;
 }
 
+std::map<uint32_t, std::vector<uint8_t>> ShaderModule::get_define_constants(const ShaderVariant &shader_variant) const
+{
+	std::map<uint32_t, std::vector<uint8_t>> constants;
+
+	for (auto &resource : resources)
+	{
+		if (resource.type != ShaderResourceType::SpecializationConstant || !is_define_constant(resource.name))
+		{
+			continue;
+		}
+
+		// As in a preprocessor condition, a macro which is not defined has the value 0
+		uint32_t    value = 0;
+		std::string def;
+
+		if (shader_variant.find_define(resource.name, def))
+		{
+			value = static_cast<uint32_t>(std::stol(def));
+		}
+
+		// Booleans are 32 bits wide in SPIR-V, as are the integers the defines stand in for
+		std::vector<uint8_t> data(sizeof(uint32_t));
+		std::memcpy(data.data(), &value, sizeof(uint32_t));
+
+		constants[resource.constant_id] = std::move(data);
+	}
+
+	return constants;
+}
+
 const std::string &ShaderModule::get_info_log() const
 {
 	return info_log;
@@ -115,11 +365,23 @@ const std::vector<uint32_t> &ShaderModule::get_binary() const
 	return spirv;
 }
 
+const std::string &ShaderModule::get_debug_name() const
+{
+	return debug_name;
+}
+
+ShaderResource *ShaderModule::find_resource(const std::string &resource_name)
+{
+	auto it = resource_indices.find(resource_name);
+
+	return it != resource_indices.end() ? &resources[it->second] : nullptr;
+}
+
 void ShaderModule::set_resource_dynamic(const std::string &resource_name)
 {
-	auto it = std::find_if(resources.begin(), resources.end(), [&resource_name](const ShaderResource &resource) { return resource.name == resource_name; });
+	auto it = find_resource(resource_name);
 
-	if (it != resources.end())
+	if (it != nullptr)
 	{
 		if (it->type == ShaderResourceType::BufferUniform || it->type == ShaderResourceType::BufferStorage)
 		{
@@ -136,6 +398,75 @@ void ShaderModule::set_resource_dynamic(const std::string &resource_name)
 	}
 }
 
+void ShaderModule::set_resource_push_descriptor(const std::string &resource_name)
+{
+	auto it = find_resource(resource_name);
+
+	if (it != nullptr)
+	{
+		if (it->type != ShaderResourceType::Input &&
+		    it->type != ShaderResourceType::Output &&
+		    it->type != ShaderResourceType::PushConstant &&
+		    it->type != ShaderResourceType::SpecializationConstant)
+		{
+			it->push_descriptor = true;
+		}
+		else
+		{
+			LOGW("Resource `{}` does not support push descriptors.", resource_name);
+		}
+	}
+	else
+	{
+		LOGW("Resource `{}` not found for shader.", resource_name);
+	}
+}
+
+void ShaderModule::set_resource_update_after_bind(const std::string &resource_name)
+{
+	auto it = find_resource(resource_name);
+
+	if (it != nullptr)
+	{
+		if (it->type == ShaderResourceType::ImageSampler ||
+		    it->type == ShaderResourceType::Image ||
+		    it->type == ShaderResourceType::Sampler)
+		{
+			it->update_after_bind = true;
+		}
+		else
+		{
+			LOGW("Resource `{}` does not support update after bind.", resource_name);
+		}
+	}
+	else
+	{
+		LOGW("Resource `{}` not found for shader.", resource_name);
+	}
+}
+
+void ShaderModule::set_resource_immutable_sampler(const std::string &resource_name, VkSampler sampler)
+{
+	auto it = find_resource(resource_name);
+
+	if (it != nullptr)
+	{
+		if (it->type == ShaderResourceType::ImageSampler ||
+		    it->type == ShaderResourceType::Sampler)
+		{
+			it->immutable_sampler = sampler;
+		}
+		else
+		{
+			LOGW("Resource `{}` does not support immutable samplers.", resource_name);
+		}
+	}
+	else
+	{
+		LOGW("Resource `{}` not found for shader.", resource_name);
+	}
+}
+
 ShaderVariant::ShaderVariant(std::string &&preamble, std::vector<std::string> &&processes) :
     preamble{std::move(preamble)},
     processes{std::move(processes)}
@@ -207,6 +538,58 @@ const std::unordered_map<std::string, size_t> &ShaderVariant::get_runtime_array_
 	return runtime_array_sizes;
 }
 
+bool ShaderVariant::find_define(const std::string &name, std::string &value) const
+{
+	bool defined = false;
+
+	for (auto &process : processes)
+	{
+		auto def = process.substr(1);
+
+		if (get_define_name(def) != name)
+		{
+			continue;
+		}
+
+		defined = process[0] == 'D';
+
+		if (defined)
+		{
+			value = def.size() > name.size() ? def.substr(name.size() + 1) : "1";
+		}
+	}
+
+	return defined;
+}
+
+ShaderVariant ShaderVariant::remove_defines(const std::vector<std::string> &names) const
+{
+	ShaderVariant variant;
+
+	for (auto &process : processes)
+	{
+		auto def = process.substr(1);
+
+		if (std::find(names.begin(), names.end(), get_define_name(def)) != names.end())
+		{
+			continue;
+		}
+
+		if (process[0] == 'D')
+		{
+			variant.add_define(def);
+		}
+		else
+		{
+			variant.add_undefine(def);
+		}
+	}
+
+	variant.set_runtime_array_sizes(runtime_array_sizes);
+
+	return variant;
+}
+
 void ShaderVariant::clear()
 {
 	preamble.clear();
@@ -217,23 +600,24 @@ void ShaderVariant::clear()
 
 void ShaderVariant::update_id()
 {
-	std::hash<std::string> hasher{};
-	id = hasher(preamble);
+	id = hash_bytes(preamble.data(), preamble.size());
 }
 
 ShaderSource::ShaderSource(std::vector<uint8_t> &&data) :
     data{std::move(data)}
 {
-	std::hash<std::string> hasher{};
-	id = hasher(std::string{this->data.cbegin(), this->data.cend()});
+	id = hash_bytes(this->data);
+
+	parse_define_constants();
 }
 
 ShaderSource::ShaderSource(const std::string &filename) :
     filename{filename},
     data{fs::read_shader(filename)}
 {
-	std::hash<std::string> hasher{};
-	id = hasher(std::string{this->data.cbegin(), this->data.cend()});
+	id = hash_bytes(this->data);
+
+	parse_define_constants();
 }
 
 size_t ShaderSource::get_id() const
@@ -250,4 +634,41 @@ const std::vector<uint8_t> &ShaderSource::get_data() const
 {
 	return data;
 }
+
+const std::vector<std::string> &ShaderSource::get_define_constant_names() const
+{
+	return define_constant_names;
+}
+
+void ShaderSource::parse_define_constants()
+{
+	// Declarations look like "layout(constant_id = 0) const bool NAME = false;", the name being the last word before the "="
+	std::istringstream stream{std::string{data.begin(), data.end()}};
+	std::string        line;
+
+	while (std::getline(stream, line))
+	{
+		auto layout_pos = line.find("constant_id");
+		auto end_pos    = line.find(')', layout_pos);
+
+		if (layout_pos == std::string::npos || end_pos == std::string::npos)
+		{
+			continue;
+		}
+
+		std::istringstream declaration{line.substr(end_pos + 1, line.find('=', end_pos) - end_pos - 1)};
+		std::string        word;
+		std::string        name;
+
+		while (declaration >> word)
+		{
+			name = word;
+		}
+
+		if (is_define_constant(name) && std::find(define_constant_names.begin(), define_constant_names.end(), name) == define_constant_names.end())
+		{
+			define_constant_names.push_back(name);
+		}
+	}
+}
 }        // namespace vkb
@@ -74,6 +74,13 @@ struct ShaderResource
 
 	bool dynamic;
 
+	bool push_descriptor;
+
+	bool update_after_bind;
+
+	/// Sampler baked into the descriptor set layout, required to sample images through a YCbCr conversion
+	VkSampler immutable_sampler{VK_NULL_HANDLE};
+
 	std::string name;
 };
 
@@ -107,6 +114,7 @@ class ShaderVariant
 	 * @param runtime_array_name String under which the runtime array is named in the shader
 	 * @param size Integer specifying the wanted size of the runtime array (in number of elements, not size in bytes), used for automatic allocation of buffers.
 	 * See get_declared_struct_size_runtime_array() in spirv_cross.h
+	 * For runtime arrays of descriptors, the size is the descriptor count of the binding.
 	 */
 	void add_runtime_array_size(const std::string &runtime_array_name, size_t size);
 
@@ -118,10 +126,24 @@ class ShaderVariant
 
 	const std::unordered_map<std::string, size_t> &get_runtime_array_sizes() const;
 
+	/**
+	 * @brief Looks up the value of a define, taking later undefines into account
+	 * @param name Name of the macro
+	 * @param value Set to the value of the macro, "1" for a define without value
+	 * @return True if the macro is defined by the variant
+	 */
+	bool find_define(const std::string &name, std::string &value) const;
+
+	/**
+	 * @brief Creates a copy of the variant without the defines and undefines of some macros
+	 * @param names Names of the macros to remove
+	 */
+	ShaderVariant remove_defines(const std::vector<std::string> &names) const;
+
 	void clear();
 
   private:
-	size_t id;
+	size_t id{0};
 
 	std::string preamble;
 
@@ -147,12 +169,23 @@ class ShaderSource
 
 	const std::vector<uint8_t> &get_data() const;
 
+	/**
+	 * @brief Names of the specialization constants which stand in for a define.
+	 *        A constant spelled like a macro (e.g. HAS_BASE_COLOR_TEXTURE) takes the value
+	 *        of the define of the same name, so variants differing only by such defines share one module.
+	 */
+	const std::vector<std::string> &get_define_constant_names() const;
+
   private:
-	size_t id;
+	size_t id{0};
 
 	std::string filename;
 
 	std::vector<uint8_t> data;
+
+	std::vector<std::string> define_constant_names;
+
+	void parse_define_constants();
 };
 
 /**
@@ -193,13 +226,48 @@ class ShaderModule
 
 	const std::vector<uint32_t> &get_binary() const;
 
+	/**
+	 * @return The file name of the source, empty if the source was not loaded from a file
+	 */
+	const std::string &get_debug_name() const;
+
+	/**
+	 * @brief Computes the values of the specialization constants standing in for a define,
+	 *        1 or the value of the define if the variant defines it, 0 otherwise
+	 * @param shader_variant Variant of the draw, which can differ from the variant the module was compiled with
+	 * @return Data of the constants, indexed by constant id
+	 */
+	std::map<uint32_t, std::vector<uint8_t>> get_define_constants(const ShaderVariant &shader_variant) const;
+
 	void set_resource_dynamic(const std::string &resource_name);
 
+	/**
+	 * @brief Flags a resource so that its descriptor set is pushed directly into the command buffer
+	 *        instead of being allocated from a descriptor pool, if VK_KHR_push_descriptor is enabled
+	 * @param resource_name The name of the shader resource
+	 */
+	void set_resource_push_descriptor(const std::string &resource_name);
+
+	/**
+	 * @brief Flags a resource so that its descriptors can be written after its descriptor set is bound,
+	 *        and left unwritten if unused, if VK_EXT_descriptor_indexing is enabled
+	 * @param resource_name The name of the shader resource
+	 */
+	void set_resource_update_after_bind(const std::string &resource_name);
+
+	/**
+	 * @brief Bakes a sampler into the descriptor set layout of a resource, the sampler bound with the image is then ignored.
+	 *        Images sampled through a YCbCr conversion can only be sampled with an immutable sampler
+	 * @param resource_name The name of the shader resource
+	 * @param sampler The sampler, which must outlive the pipelines using the resource
+	 */
+	void set_resource_immutable_sampler(const std::string &resource_name, VkSampler sampler);
+
   private:
 	Device &device;
 
 	/// Shader unique id
-	size_t id;
+	size_t id{0};
 
 	/// Stage of the shader (vertex, fragment, etc)
 	VkShaderStageFlagBits stage{};
@@ -207,11 +275,22 @@ class ShaderModule
 	/// Name of the main function
 	std::string entry_point;
 
+	/// Name of the source file
+	std::string debug_name;
+
 	/// Compiled source
 	std::vector<uint32_t> spirv;
 
 	std::vector<ShaderResource> resources;
 
+	/// Index of the resources by name, built once they are reflected
+	std::unordered_map<std::string, size_t> resource_indices;
+
 	std::string info_log;
+
+	/**
+	 * @return The resource of a name, nullptr if the module has none
+	 */
+	ShaderResource *find_resource(const std::string &resource_name);
 };
 }        // namespace vkb
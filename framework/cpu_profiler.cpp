@@ -0,0 +1,227 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cpu_profiler.h"
+
+#include "common/logging.h"
+#include "platform/filesystem.h"
+
+#if defined(VKB_ATRACE)
+#	include <android/trace.h>
+#endif
+
+namespace vkb
+{
+namespace
+{
+/// Events reserved for each thread, so that recording rarely allocates
+constexpr size_t THREAD_EVENTS_CAPACITY = 16384;
+}        // namespace
+
+constexpr size_t CpuProfiler::RECENT_EVENTS_CAPACITY;
+
+thread_local CpuProfiler::ThreadEvents *CpuProfiler::thread_events{nullptr};
+
+CpuProfiler &CpuProfiler::get()
+{
+	static CpuProfiler profiler;
+
+	return profiler;
+}
+
+CpuProfiler::CpuProfiler() :
+    origin{Timer::Clock::now()}
+{
+}
+
+void CpuProfiler::set_enabled(bool enable)
+{
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+void CpuProfiler::set_recent_events_enabled(bool enable)
+{
+	recent_events_enabled.store(enable, std::memory_order_relaxed);
+}
+
+uint64_t CpuProfiler::now() const
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Timer::Clock::now() - origin).count());
+}
+
+CpuProfiler::ThreadEvents &CpuProfiler::get_thread_events()
+{
+	if (!thread_events)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		threads.push_back(std::make_unique<ThreadEvents>());
+
+		thread_events            = threads.back().get();
+		thread_events->thread_id = static_cast<uint32_t>(threads.size());
+		thread_events->events.reserve(THREAD_EVENTS_CAPACITY);
+		thread_events->recent.resize(RECENT_EVENTS_CAPACITY);
+	}
+
+	return *thread_events;
+}
+
+void CpuProfiler::add_event(const char *name, uint64_t start, uint64_t end)
+{
+	auto &thread = get_thread_events();
+
+	if (is_enabled())
+	{
+		thread.events.push_back({name, start, end - start});
+	}
+
+	if (is_recent_events_enabled())
+	{
+		// Only this thread writes its ring, readers check the count to drop the entries overwritten meanwhile
+		uint64_t count = thread.recent_count.load(std::memory_order_relaxed);
+
+		thread.recent[count % RECENT_EVENTS_CAPACITY] = {name, start, end - start};
+
+		thread.recent_count.store(count + 1, std::memory_order_release);
+	}
+}
+
+const char *CpuProfiler::intern(const std::string &name)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	return names.insert(name).first->c_str();
+}
+
+void CpuProfiler::get_recent_events(uint64_t since, std::vector<ThreadEvent> &events)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	events.clear();
+
+	for (auto &thread : threads)
+	{
+		uint64_t count = thread->recent_count.load(std::memory_order_acquire);
+		uint64_t first = count > RECENT_EVENTS_CAPACITY / 2 ? count - RECENT_EVENTS_CAPACITY / 2 : 0;
+
+		size_t thread_begin = events.size();
+
+		for (uint64_t i = first; i < count; ++i)
+		{
+			auto &event = thread->recent[i % RECENT_EVENTS_CAPACITY];
+
+			if (event.start + event.duration >= since)
+			{
+				events.push_back({thread->thread_id, event});
+			}
+		}
+
+		// Events the thread wrapped around to while they were copied are unreliable
+		uint64_t overwritten = thread->recent_count.load(std::memory_order_acquire);
+
+		if (overwritten > first + RECENT_EVENTS_CAPACITY)
+		{
+			events.resize(thread_begin);
+		}
+	}
+}
+
+bool CpuProfiler::write_chrome_trace(const std::string &filename)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	nlohmann::json trace_events = nlohmann::json::array();
+
+	for (auto &thread : threads)
+	{
+		for (auto &event : thread->events)
+		{
+			// Complete events, with times in microseconds
+			trace_events.push_back({{"name", event.name},
+			                        {"ph", "X"},
+			                        {"pid", 0},
+			                        {"tid", thread->thread_id},
+			                        {"ts", event.start / 1000.0},
+			                        {"dur", event.duration / 1000.0}});
+		}
+	}
+
+	nlohmann::json trace{{"traceEvents", trace_events}, {"displayTimeUnit", "ms"}};
+
+	LOGI("Writing {} CPU profiler events to {}", trace_events.size(), filename);
+
+	return fs::write_json(trace, filename);
+}
+
+void CpuProfiler::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto &thread : threads)
+	{
+		thread->events.clear();
+	}
+}
+
+ProfileZone::ProfileZone(const char *name)
+{
+	auto &profiler = CpuProfiler::get();
+
+	if (profiler.is_recording())
+	{
+		this->name = name;
+		start      = profiler.now();
+
+#if defined(VKB_ATRACE)
+		ATrace_beginSection(name);
+#endif
+	}
+}
+
+ProfileZone::ProfileZone(const std::string &name)
+{
+	auto &profiler = CpuProfiler::get();
+
+	if (profiler.is_recording())
+	{
+		this->name = profiler.intern(name);
+		start      = profiler.now();
+
+#if defined(VKB_ATRACE)
+		ATrace_beginSection(this->name);
+#endif
+	}
+}
+
+ProfileZone::~ProfileZone()
+{
+	// Zones started while the profiler was not recording are not recorded
+	if (name)
+	{
+		auto &profiler = CpuProfiler::get();
+
+		profiler.add_event(name, start, profiler.now());
+
+#if defined(VKB_ATRACE)
+		ATrace_endSection();
+#endif
+	}
+}
+}        // namespace vkb
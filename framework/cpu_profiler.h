@@ -0,0 +1,211 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "timer.h"
+
+namespace vkb
+{
+/**
+ * @brief Records the CPU time spent in named scopes by any thread, and exports it as a Chrome trace
+ *        which chrome://tracing and Perfetto can open. Nothing is recorded until it is enabled.
+ *        On Android, building with VKB_ATRACE also emits the scopes as ATrace sections for systrace and Streamline.
+ *
+ * The most recent scopes of each thread can also be kept in a preallocated ring, for the timeline of the GUI,
+ * without recording a trace. Enabling either records the scopes.
+ */
+class CpuProfiler
+{
+  public:
+	/**
+	 * @brief A scope recorded by a thread, with times in nanoseconds since the profiler was created
+	 */
+	struct Event
+	{
+		const char *name;
+
+		uint64_t start;
+
+		uint64_t duration;
+	};
+
+	/**
+	 * @brief A scope copied from the recent events of a thread
+	 */
+	struct ThreadEvent
+	{
+		/// Index of the thread from 1, in the order of their first event
+		uint32_t thread_id;
+
+		Event event;
+	};
+
+	/// Recent events kept for each thread, the oldest ones are overwritten
+	static constexpr size_t RECENT_EVENTS_CAPACITY = 4096;
+
+	static CpuProfiler &get();
+
+	CpuProfiler(const CpuProfiler &) = delete;
+
+	CpuProfiler &operator=(const CpuProfiler &) = delete;
+
+	void set_enabled(bool enable);
+
+	bool is_enabled() const
+	{
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Keeps the recent events of each thread, whether the trace is enabled or not
+	 */
+	void set_recent_events_enabled(bool enable);
+
+	bool is_recent_events_enabled() const
+	{
+		return recent_events_enabled.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @return Whether the scopes are recorded, for the trace or the recent events
+	 */
+	bool is_recording() const
+	{
+		return is_enabled() || is_recent_events_enabled();
+	}
+
+	/**
+	 * @return Nanoseconds since the profiler was created
+	 */
+	uint64_t now() const;
+
+	/**
+	 * @brief Adds a scope to the events of the calling thread
+	 * @param name The name of the scope, which must stay valid until the events are cleared
+	 */
+	void add_event(const char *name, uint64_t start, uint64_t end);
+
+	/**
+	 * @brief Keeps a copy of a name which is not a string literal
+	 * @return A name valid for the lifetime of the profiler
+	 */
+	const char *intern(const std::string &name);
+
+	/**
+	 * @brief Copies the recent events of every thread which ended after a time. Threads may keep recording meanwhile,
+	 *        so only the newer half of the ring of a thread is read, and none of its events are copied if it wrapped around meanwhile.
+	 * @param since Time in nanoseconds since the profiler was created
+	 * @param events Cleared and filled with the events, in the order of each thread
+	 */
+	void get_recent_events(uint64_t since, std::vector<ThreadEvent> &events);
+
+	/**
+	 * @brief Writes the recorded events to the graphs directory, no thread should be recording meanwhile
+	 * @param filename The name of the trace file
+	 * @return True if the trace was written
+	 */
+	bool write_chrome_trace(const std::string &filename);
+
+	/**
+	 * @brief Drops the recorded events, no thread should be recording meanwhile
+	 */
+	void clear();
+
+  private:
+	CpuProfiler();
+
+	/**
+	 * @brief Events of a thread, only written by that thread
+	 */
+	struct ThreadEvents
+	{
+		uint32_t thread_id;
+
+		std::vector<Event> events;
+
+		/// Ring of the recent events, allocated when the thread registers
+		std::vector<Event> recent;
+
+		/// Events written to the ring so far, published after each write
+		std::atomic<uint64_t> recent_count{0};
+	};
+
+	/**
+	 * @return The events of the calling thread, registered on its first event
+	 */
+	ThreadEvents &get_thread_events();
+
+	/// Events of the calling thread, null until its first event
+	static thread_local ThreadEvents *thread_events;
+
+	std::atomic<bool> enabled{false};
+
+	std::atomic<bool> recent_events_enabled{false};
+
+	Timer::Clock::time_point origin;
+
+	/// Taken when a thread records its first event, when interning names and when exporting
+	std::mutex mutex;
+
+	std::vector<std::unique_ptr<ThreadEvents>> threads;
+
+	std::unordered_set<std::string> names;
+};
+
+/**
+ * @brief Records the time from its construction to its destruction as a scope of the CPU profiler
+ */
+class ProfileZone
+{
+  public:
+	explicit ProfileZone(const char *name);
+
+	explicit ProfileZone(const std::string &name);
+
+	~ProfileZone();
+
+	ProfileZone(const ProfileZone &) = delete;
+
+	ProfileZone &operator=(const ProfileZone &) = delete;
+
+  private:
+	const char *name{nullptr};
+
+	uint64_t start{0};
+};
+}        // namespace vkb
+
+#define VKB_PROFILE_CONCAT_IMPL(a, b) a##b
+#define VKB_PROFILE_CONCAT(a, b) VKB_PROFILE_CONCAT_IMPL(a, b)
+
+/// Profiles the enclosing scope under a name
+#define VKB_PROFILE_SCOPE(name) vkb::ProfileZone VKB_PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+
+/// Profiles the enclosing function
+#define VKB_PROFILE_FUNCTION() VKB_PROFILE_SCOPE(__FUNCTION__)
@@ -0,0 +1,198 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+#if defined(__ANDROID__) || defined(__linux__)
+#	include <pthread.h>
+#	include <sched.h>
+#	include <time.h>
+#endif
+
+#include "common/logging.h"
+
+namespace vkb
+{
+namespace
+{
+/// Cores probed, beyond any CPU the framework runs on
+constexpr uint32_t MAX_CORES = 256;
+
+/// Class of cores the calling thread was last restricted to
+thread_local CoreClass thread_core_class{CoreClass::Any};
+
+/**
+ * @return The value of a file of the CPU in sysfs, zero if it cannot be read
+ */
+uint64_t read_cpu_value(uint32_t core, const char *file)
+{
+	std::ifstream stream{"/sys/devices/system/cpu/cpu" + std::to_string(core) + "/" + file};
+
+	uint64_t value{0};
+
+	if (!(stream >> value))
+	{
+		return 0;
+	}
+
+	return value;
+}
+}        // namespace
+
+CpuTopology &CpuTopology::get()
+{
+	static CpuTopology topology;
+
+	return topology;
+}
+
+CpuTopology::CpuTopology()
+{
+#if defined(__ANDROID__) || defined(__linux__)
+	std::vector<uint64_t> capacities;
+
+	// The capacity is normalized to 1024 for the largest cores, the maximum frequency is a proxy on older kernels
+	const char *capacity_file = read_cpu_value(0, "cpu_capacity") > 0 ? "cpu_capacity" : "cpufreq/cpuinfo_max_freq";
+
+	for (uint32_t core = 0; core < MAX_CORES; ++core)
+	{
+		auto capacity = read_cpu_value(core, capacity_file);
+
+		if (capacity == 0)
+		{
+			break;
+		}
+
+		cores.push_back(core);
+		capacities.push_back(capacity);
+	}
+
+	if (cores.empty())
+	{
+		return;
+	}
+
+	auto lowest_capacity = *std::min_element(capacities.begin(), capacities.end());
+
+	for (size_t i = 0; i < cores.size(); ++i)
+	{
+		if (capacities[i] > lowest_capacity)
+		{
+			big_cores.push_back(cores[i]);
+		}
+		else
+		{
+			little_cores.push_back(cores[i]);
+		}
+	}
+
+	if (is_heterogeneous())
+	{
+		LOGI("CPU with {} big and {} little cores", big_cores.size(), little_cores.size());
+	}
+#endif
+}
+
+void CpuTopology::set_affinity_enabled(bool enable)
+{
+	affinity_enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool CpuTopology::is_affinity_enabled() const
+{
+	return affinity_enabled.load(std::memory_order_relaxed);
+}
+
+bool CpuTopology::is_heterogeneous() const
+{
+	return !big_cores.empty() && !little_cores.empty();
+}
+
+const std::vector<uint32_t> &CpuTopology::get_cores(CoreClass core_class) const
+{
+	switch (core_class)
+	{
+		case CoreClass::Big:
+			return big_cores;
+		case CoreClass::Little:
+			return little_cores;
+		default:
+			return cores;
+	}
+}
+
+bool CpuTopology::pin_current_thread(CoreClass core_class)
+{
+	auto target = is_affinity_enabled() && is_heterogeneous() ? core_class : CoreClass::Any;
+
+	if (target == thread_core_class)
+	{
+		return target != CoreClass::Any && target == core_class;
+	}
+
+#if defined(__ANDROID__) || defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+
+	for (auto core : get_cores(target))
+	{
+		CPU_SET(core, &set);
+	}
+
+	// Zero is the calling thread
+	if (sched_setaffinity(0, sizeof(set), &set) != 0)
+	{
+		LOGW("Could not set the affinity of a thread");
+
+		// Not retried for this thread
+		thread_core_class = target;
+		return false;
+	}
+
+	thread_core_class = target;
+
+	return target != CoreClass::Any && target == core_class;
+#else
+	return false;
+#endif
+}
+
+double CpuTopology::get_thread_cpu_time(std::thread::native_handle_type thread)
+{
+#if defined(__ANDROID__) || defined(__linux__)
+	clockid_t clock;
+	timespec  time;
+
+	if (pthread_getcpuclockid(thread, &clock) != 0 || clock_gettime(clock, &time) != 0)
+	{
+		return 0.0;
+	}
+
+	return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) * 1e-9;
+#else
+	(void) thread;
+	return 0.0;
+#endif
+}
+}        // namespace vkb
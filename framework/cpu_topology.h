@@ -0,0 +1,101 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace vkb
+{
+/**
+ * @brief Class of cores a thread runs on, on CPUs whose cores differ in capacity such as big.LITTLE
+ */
+enum class CoreClass
+{
+	/// Any core, as chosen by the scheduler
+	Any,
+
+	/// Cores above the lowest capacity, for the threads on the critical path of a frame
+	Big,
+
+	/// Cores of the lowest capacity, for background work such as streaming and decoding
+	Little
+};
+
+/**
+ * @brief Groups the cores of the CPU by capacity, and pins threads to a class of cores.
+ *
+ * The capacity of each core is read from /sys/devices/system/cpu/cpu<N>/cpu_capacity on Linux and Android,
+ * or from its maximum frequency on kernels without it. Threads are only pinned once the affinity is enabled,
+ * on CPUs whose cores differ in capacity, so that elsewhere the scheduler keeps placing them.
+ */
+class CpuTopology
+{
+  public:
+	static CpuTopology &get();
+
+	CpuTopology(const CpuTopology &) = delete;
+
+	CpuTopology &operator=(const CpuTopology &) = delete;
+
+	/**
+	 * @brief Enables the affinity of the threads, the job system reads it when it is created
+	 */
+	void set_affinity_enabled(bool enable);
+
+	bool is_affinity_enabled() const;
+
+	/**
+	 * @return Whether the cores differ in capacity
+	 */
+	bool is_heterogeneous() const;
+
+	/**
+	 * @return Indices of the cores of a class, all the cores found for CoreClass::Any
+	 */
+	const std::vector<uint32_t> &get_cores(CoreClass core_class) const;
+
+	/**
+	 * @brief Restricts the calling thread to a class of cores if the affinity is enabled, or lets it run on any core otherwise.
+	 *        The affinity is only changed when it differs from the last one set for the thread, so it is cheap to call per job.
+	 * @return Whether the thread is restricted to the class of cores
+	 */
+	bool pin_current_thread(CoreClass core_class);
+
+	/**
+	 * @return The CPU time a thread has run for in seconds, on Linux and Android, zero on other systems
+	 */
+	static double get_thread_cpu_time(std::thread::native_handle_type thread);
+
+  private:
+	CpuTopology();
+
+	std::atomic<bool> affinity_enabled{false};
+
+	std::vector<uint32_t> cores;
+
+	std::vector<uint32_t> big_cores;
+
+	std::vector<uint32_t> little_cores;
+};
+}        // namespace vkb
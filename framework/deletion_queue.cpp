@@ -0,0 +1,109 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "deletion_queue.h"
+
+namespace vkb
+{
+DeletionQueue::~DeletionQueue()
+{
+	flush();
+}
+
+void DeletionQueue::defer(std::function<void()> &&destroy)
+{
+	push({}, std::move(destroy));
+}
+
+void DeletionQueue::begin_frame(uint64_t new_frame_number, uint64_t completed_frame_number)
+{
+	std::deque<Entry> completed;
+
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+
+		frame_number = new_frame_number;
+
+		// Entries are released in frame order
+		while (!entries.empty() && entries.front().frame_number <= completed_frame_number)
+		{
+			completed.push_back(std::move(entries.front()));
+			entries.pop_front();
+		}
+	}
+
+	destroy_entries(completed);
+}
+
+void DeletionQueue::flush()
+{
+	// Destroying a resource may release others, such as a scene releasing its images
+	while (true)
+	{
+		std::deque<Entry> remaining;
+
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			std::swap(remaining, entries);
+		}
+
+		if (remaining.empty())
+		{
+			break;
+		}
+
+		destroy_entries(remaining);
+	}
+}
+
+size_t DeletionQueue::get_pending_count() const
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	return entries.size();
+}
+
+void DeletionQueue::push(std::shared_ptr<void> &&resource, std::function<void()> &&destroy)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	Entry entry;
+	entry.frame_number = frame_number;
+	entry.resource     = std::move(resource);
+	entry.destroy      = std::move(destroy);
+
+	entries.push_back(std::move(entry));
+}
+
+void DeletionQueue::destroy_entries(std::deque<Entry> &completed)
+{
+	for (auto &entry : completed)
+	{
+		if (entry.destroy)
+		{
+			entry.destroy();
+		}
+
+		entry.resource.reset();
+	}
+
+	completed.clear();
+}
+}        // namespace vkb
@@ -0,0 +1,123 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+namespace vkb
+{
+/**
+ * @brief Keeps the resources released while frames may still use them alive until the GPU has completed
+ *        those frames, so that they can be destroyed without waiting for the device to be idle.
+ *        Resources released during a frame are destroyed once that frame has completed.
+ *        The queue is fed the frame numbers by the render context, and can be used from any thread.
+ */
+class DeletionQueue
+{
+  public:
+	DeletionQueue() = default;
+
+	DeletionQueue(const DeletionQueue &) = delete;
+
+	DeletionQueue &operator=(const DeletionQueue &) = delete;
+
+	/**
+	 * @brief Destroys all the resources left, the device must be idle
+	 */
+	~DeletionQueue();
+
+	/**
+	 * @brief Takes ownership of a resource, such as a core::Buffer, core::Image, core::ImageView,
+	 *        pipeline or descriptor pool, until the frames which may use it have completed
+	 */
+	template <class T>
+	void release(std::unique_ptr<T> &&resource)
+	{
+		if (resource)
+		{
+			push(std::shared_ptr<void>{std::move(resource)}, {});
+		}
+	}
+
+	/**
+	 * @brief Moves a resource into the queue until the frames which may use it have completed
+	 */
+	template <class T>
+	void release(T &&resource)
+	{
+		static_assert(!std::is_lvalue_reference<T>::value, "Resources are moved into the queue");
+
+		push(std::make_shared<typename std::decay<T>::type>(std::move(resource)), {});
+	}
+
+	/**
+	 * @brief Defers the destruction of a raw Vulkan handle until the frames which may use it have completed
+	 * @param destroy Function destroying the handle
+	 */
+	void defer(std::function<void()> &&destroy);
+
+	/**
+	 * @brief Destroys the resources released in or before the completed frame
+	 * @param frame_number The number of the frame starting, resources released from now on are tagged with it
+	 * @param completed_frame_number The number of the last frame known to be completed by the GPU
+	 */
+	void begin_frame(uint64_t frame_number, uint64_t completed_frame_number);
+
+	/**
+	 * @brief Destroys all the resources left, the device must be idle
+	 */
+	void flush();
+
+	/**
+	 * @return The number of resources waiting for their frames to complete
+	 */
+	size_t get_pending_count() const;
+
+  private:
+	struct Entry
+	{
+		/// Number of the last frame which may use the resource
+		uint64_t frame_number{0};
+
+		std::shared_ptr<void> resource;
+
+		std::function<void()> destroy;
+	};
+
+	void push(std::shared_ptr<void> &&resource, std::function<void()> &&destroy);
+
+	/**
+	 * @brief Destroys the entries outside the lock, as releasing a resource may release others
+	 */
+	static void destroy_entries(std::deque<Entry> &completed);
+
+	mutable std::mutex mutex;
+
+	std::deque<Entry> entries;
+
+	uint64_t frame_number{0};
+};
+}        // namespace vkb
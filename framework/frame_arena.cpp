@@ -0,0 +1,103 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace vkb
+{
+FrameArena::FrameArena(size_t chunk_size) :
+    chunk_size{chunk_size}
+{
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment)
+{
+	assert((alignment & (alignment - 1)) == 0 && "Alignment must be a power of two");
+
+	for (; chunk_index < chunks.size(); chunk_index++, offset = 0)
+	{
+		auto &chunk = chunks[chunk_index];
+
+		auto address = reinterpret_cast<uintptr_t>(chunk.data.get()) + offset;
+		auto padding = (alignment - address % alignment) % alignment;
+
+		if (offset + padding + size <= chunk.size)
+		{
+			offset += padding + size;
+			used_size += padding + size;
+
+			return chunk.data.get() + offset - size;
+		}
+	}
+
+	// The memory of new chunks is aligned for any fundamental type, bigger alignments get padding
+	Chunk chunk;
+	chunk.size = std::max(chunk_size, size + alignment);
+	chunk.data = std::make_unique<uint8_t[]>(chunk.size);
+
+	chunks.push_back(std::move(chunk));
+
+	chunk_index = chunks.size() - 1;
+	offset      = 0;
+
+	return allocate(size, alignment);
+}
+
+void FrameArena::reset()
+{
+	// A single chunk fits the next frame if it is like this one, without moving between chunks
+	if (chunks.size() > 1)
+	{
+		auto capacity = get_capacity();
+
+		chunks.clear();
+
+		Chunk chunk;
+		chunk.size = capacity;
+		chunk.data = std::make_unique<uint8_t[]>(chunk.size);
+
+		chunks.push_back(std::move(chunk));
+	}
+
+	chunk_index = 0;
+	offset      = 0;
+	used_size   = 0;
+}
+
+size_t FrameArena::get_used_size() const
+{
+	return used_size;
+}
+
+size_t FrameArena::get_capacity() const
+{
+	size_t capacity = 0;
+
+	for (auto &chunk : chunks)
+	{
+		capacity += chunk.size;
+	}
+
+	return capacity;
+}
+}        // namespace vkb
@@ -0,0 +1,153 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace vkb
+{
+/**
+ * @brief Linear allocator of the transient CPU data recorded into a frame. Allocations are not freed
+ *        one by one, the whole arena is rewound when the frame is reset. A frame has one arena per
+ *        recording thread, so an arena needs no locking but must only be used by the thread it belongs to.
+ */
+class FrameArena
+{
+  public:
+	/// Size of the chunks of memory the arena is made of, unless an allocation needs a bigger one
+	static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+	explicit FrameArena(size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+	FrameArena(const FrameArena &) = delete;
+
+	FrameArena &operator=(const FrameArena &) = delete;
+
+	/**
+	 * @brief Allocates memory valid until the next reset, moving to another chunk when the current one is full
+	 * @param size Size in bytes
+	 * @param alignment Alignment in bytes, a power of two
+	 */
+	void *allocate(size_t size, size_t alignment);
+
+	/**
+	 * @brief Rewinds the arena, invalidating all of its allocations. If the allocations of the frame
+	 *        spanned several chunks, they are replaced by a single chunk as big as all of them.
+	 */
+	void reset();
+
+	/**
+	 * @return The bytes allocated since the last reset, alignment included
+	 */
+	size_t get_used_size() const;
+
+	/**
+	 * @return The bytes of all the chunks of the arena
+	 */
+	size_t get_capacity() const;
+
+  private:
+	struct Chunk
+	{
+		std::unique_ptr<uint8_t[]> data;
+
+		size_t size;
+	};
+
+	size_t chunk_size;
+
+	std::vector<Chunk> chunks;
+
+	/// Chunk allocated from, the ones before it are full
+	size_t chunk_index{0};
+
+	/// Offset of the next allocation in the current chunk
+	size_t offset{0};
+
+	size_t used_size{0};
+};
+
+/**
+ * @brief STL allocator taking its memory from a frame arena, deallocation is left to the reset of the arena.
+ *        Without an arena it falls back to the global heap, for code which may record outside of a frame.
+ */
+template <class T>
+class FrameAllocator
+{
+  public:
+	using value_type = T;
+
+	FrameAllocator(FrameArena *arena = nullptr) noexcept :
+	    arena{arena}
+	{}
+
+	template <class U>
+	FrameAllocator(const FrameAllocator<U> &other) noexcept :
+	    arena{other.get_arena()}
+	{}
+
+	T *allocate(size_t count)
+	{
+		if (arena)
+		{
+			return static_cast<T *>(arena->allocate(count * sizeof(T), alignof(T)));
+		}
+
+		return static_cast<T *>(::operator new(count * sizeof(T)));
+	}
+
+	void deallocate(T *ptr, size_t /*count*/) noexcept
+	{
+		if (!arena)
+		{
+			::operator delete(ptr);
+		}
+	}
+
+	FrameArena *get_arena() const noexcept
+	{
+		return arena;
+	}
+
+  private:
+	FrameArena *arena;
+};
+
+template <class T, class U>
+inline bool operator==(const FrameAllocator<T> &lhs, const FrameAllocator<U> &rhs) noexcept
+{
+	return lhs.get_arena() == rhs.get_arena();
+}
+
+template <class T, class U>
+inline bool operator!=(const FrameAllocator<T> &lhs, const FrameAllocator<U> &rhs) noexcept
+{
+	return !(lhs == rhs);
+}
+
+/// A vector of transient frame data, see FrameArena
+template <class T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+}        // namespace vkb
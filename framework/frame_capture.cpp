@@ -0,0 +1,265 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "frame_capture.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "common/logging.h"
+#include "core/buffer.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "core/image.h"
+#include "core/image_view.h"
+#include "job_system.h"
+#include "platform/filesystem.h"
+#include "utils/strings.h"
+
+namespace vkb
+{
+namespace
+{
+/// Formats of the swapchain images which can be written as 8-bit RGBA
+const VkFormat rgba_formats[] = {VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_R8G8B8A8_SNORM};
+
+const VkFormat bgra_formats[] = {VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_B8G8R8A8_SNORM};
+
+bool contains(const VkFormat (&formats)[3], VkFormat format)
+{
+	return std::find(std::begin(formats), std::end(formats), format) != std::end(formats);
+}
+}        // namespace
+
+FrameCapture::FrameCapture(Device &device, JobSystem &job_system) :
+    device{device},
+    job_system{job_system}
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+	flush();
+}
+
+void FrameCapture::request(const std::string &filename)
+{
+	requests.push_back(filename);
+}
+
+void FrameCapture::set_interval(uint32_t new_interval, const std::string &new_prefix)
+{
+	interval             = new_interval;
+	prefix               = new_prefix;
+	frames_since_capture = 0;
+}
+
+void FrameCapture::record(CommandBuffer &command_buffer, const core::ImageView &swapchain_view, VkImageLayout present_layout, uint64_t frame_number)
+{
+	std::string filename;
+
+	if (!requests.empty())
+	{
+		filename = std::move(requests.front());
+		requests.erase(requests.begin());
+	}
+	else if (interval > 0 && ++frames_since_capture >= interval)
+	{
+		filename = prefix + "-" + std::to_string(frame_number);
+	}
+	else
+	{
+		return;
+	}
+
+	frames_since_capture = 0;
+
+	auto &image  = swapchain_view.get_image();
+	auto  format = swapchain_view.get_format();
+
+	if (!contains(rgba_formats, format) && !contains(bgra_formats, format))
+	{
+		LOGW("Cannot capture {}: unsupported format {}", filename, to_string(format));
+		return;
+	}
+
+	Readback readback{};
+	readback.frame_number = frame_number;
+	readback.filename     = std::move(filename);
+	readback.extent       = {image.get_extent().width, image.get_extent().height};
+	readback.swizzle      = contains(bgra_formats, format);
+
+	VkDeviceSize size = readback.extent.width * readback.extent.height * 4;
+
+	auto buffer_it = std::find_if(free_buffers.begin(), free_buffers.end(),
+	                              [size](const std::unique_ptr<core::Buffer> &buffer) { return buffer->get_size() == size; });
+
+	if (buffer_it != free_buffers.end())
+	{
+		readback.buffer = std::move(*buffer_it);
+		free_buffers.erase(buffer_it);
+	}
+	else
+	{
+		readback.buffer = std::make_unique<core::Buffer>(device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+	}
+
+	{
+		ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = present_layout;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		memory_barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_TRANSFER_READ_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+		command_buffer.image_memory_barrier(swapchain_view, memory_barrier);
+	}
+
+	VkBufferImageCopy copy_region{};
+	copy_region.imageSubresource = swapchain_view.get_subresource_layers();
+	copy_region.imageExtent      = {readback.extent.width, readback.extent.height, 1};
+
+	command_buffer.copy_image_to_buffer(image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, *readback.buffer, {copy_region});
+
+	{
+		ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		memory_barrier.new_layout      = present_layout;
+		memory_barrier.src_access_mask = VK_ACCESS_TRANSFER_READ_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+		command_buffer.image_memory_barrier(swapchain_view, memory_barrier);
+	}
+
+	{
+		BufferMemoryBarrier memory_barrier{};
+		memory_barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_HOST_READ_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_HOST_BIT;
+
+		command_buffer.buffer_memory_barrier(*readback.buffer, 0, size, memory_barrier);
+	}
+
+	readbacks.push_back(std::move(readback));
+}
+
+void FrameCapture::update(uint64_t completed_frame_number)
+{
+	while (!readbacks.empty() && readbacks.front().frame_number <= completed_frame_number)
+	{
+		encode(std::move(readbacks.front()));
+		readbacks.pop_front();
+	}
+
+	// Buffers of the written captures are kept for the next ones
+	for (auto it = encodes.begin(); it != encodes.end();)
+	{
+		if (it->wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		try
+		{
+			free_buffers.push_back(it->get());
+		}
+		catch (const std::exception &e)
+		{
+			LOGE("Cannot write frame capture: {}", e.what());
+		}
+
+		it = encodes.erase(it);
+	}
+}
+
+void FrameCapture::flush()
+{
+	if (!readbacks.empty())
+	{
+		device.wait_idle();
+
+		update(readbacks.back().frame_number);
+	}
+
+	for (auto &fut : encodes)
+	{
+		fut.wait();
+	}
+
+	update(0);
+}
+
+bool FrameCapture::is_pending() const
+{
+	return !readbacks.empty() || !encodes.empty();
+}
+
+void FrameCapture::encode(Readback &&readback)
+{
+	auto task = [readback = std::move(readback)](size_t) mutable {
+		auto &buffer = *readback.buffer;
+
+		auto data = buffer.map();
+		buffer.invalidate();
+
+		auto width  = readback.extent.width;
+		auto height = readback.extent.height;
+
+		// Swaps the R and B components of BGR images and removes transparency
+		for (uint32_t i = 0; i < width * height; ++i)
+		{
+			auto pixel = data + i * 4;
+
+			if (readback.swizzle)
+			{
+				std::swap(pixel[0], pixel[2]);
+			}
+
+			pixel[3] = 255;
+		}
+
+		fs::write_image(data, readback.filename, width, height, 4, width * 4);
+
+		LOGI("Frame captured to {}.png", readback.filename);
+
+		buffer.unmap();
+
+		return std::move(readback.buffer);
+	};
+
+	// The job system only runs jobs on the calling thread while it waits for a counter
+	if (job_system.get_thread_count() > 1)
+	{
+		encodes.push_back(job_system.async(std::move(task), JobSystem::Priority::Background));
+	}
+	else
+	{
+		std::packaged_task<std::unique_ptr<core::Buffer>(size_t)> encode_task{std::move(task)};
+
+		encodes.push_back(encode_task.get_future());
+
+		encode_task(0);
+	}
+}
+}        // namespace vkb
@@ -0,0 +1,148 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class Device;
+class JobSystem;
+
+namespace core
+{
+class Buffer;
+class ImageView;
+}        // namespace core
+
+/**
+ * @brief Captures rendered frames to PNG files without stalling the frame loop.
+ *        The swapchain image of a frame is copied to a buffer in the frame's command buffer,
+ *        the buffer is read once the GPU has completed the frame, and the PNG is encoded on
+ *        the job system. Frames can be captured on request or every few frames, for videos
+ *        or comparisons with reference images.
+ */
+class FrameCapture
+{
+  public:
+	/**
+	 * @param job_system Encodes the images, they are encoded on the calling thread if it has no workers
+	 */
+	FrameCapture(Device &device, JobSystem &job_system);
+
+	FrameCapture(const FrameCapture &) = delete;
+
+	FrameCapture(FrameCapture &&) = delete;
+
+	/**
+	 * @brief Writes the captures still in flight
+	 */
+	~FrameCapture();
+
+	FrameCapture &operator=(const FrameCapture &) = delete;
+
+	FrameCapture &operator=(FrameCapture &&) = delete;
+
+	/**
+	 * @brief Captures the next recorded frame
+	 * @param filename Name of the file written, without extension
+	 */
+	void request(const std::string &filename);
+
+	/**
+	 * @brief Captures every interval-th recorded frame, to files named after the prefix and the frame number
+	 * @param interval Number of frames between captures, 0 stops capturing
+	 */
+	void set_interval(uint32_t interval, const std::string &prefix);
+
+	/**
+	 * @brief Records the copy of the frame if it is captured
+	 * @param command_buffer Command buffer of the frame, after the image is in the present layout
+	 * @param swapchain_view The view of the presented image
+	 * @param present_layout The layout of the presented image, see RenderContext::get_present_layout
+	 * @param frame_number The number of the frame, to know when the GPU has completed it
+	 */
+	void record(CommandBuffer &command_buffer, const core::ImageView &swapchain_view, VkImageLayout present_layout, uint64_t frame_number);
+
+	/**
+	 * @brief Encodes the captures of the frames the GPU has completed
+	 * @param completed_frame_number The number of the last frame known to be completed
+	 */
+	void update(uint64_t completed_frame_number);
+
+	/**
+	 * @brief Waits for the device and writes every capture recorded so far
+	 */
+	void flush();
+
+	/**
+	 * @return Whether captures are recorded but not written yet
+	 */
+	bool is_pending() const;
+
+  private:
+	struct Readback
+	{
+		uint64_t frame_number{0};
+
+		std::string filename;
+
+		std::unique_ptr<core::Buffer> buffer;
+
+		VkExtent2D extent{};
+
+		/// Whether the image is in a BGR format
+		bool swizzle{false};
+	};
+
+	/**
+	 * @brief Reads a buffer on the job system and writes it to file, the buffer is reused once written
+	 */
+	void encode(Readback &&readback);
+
+	Device &device;
+
+	JobSystem &job_system;
+
+	uint32_t interval{0};
+
+	std::string prefix;
+
+	uint32_t frames_since_capture{0};
+
+	std::vector<std::string> requests;
+
+	std::deque<Readback> readbacks;
+
+	std::vector<std::future<std::unique_ptr<core::Buffer>>> encodes;
+
+	/// Buffers of written captures, reused by later ones of the same size
+	std::vector<std::unique_ptr<core::Buffer>> free_buffers;
+};
+}        // namespace vkb
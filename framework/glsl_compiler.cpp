@@ -59,8 +59,37 @@ inline EShLanguage FindShaderLanguage(VkShaderStageFlagBits stage)
 			return EShLangVertex;
 	}
 }
+
+/**
+ * @brief Keeps glslang initialized from the first compile until the process exits
+ */
+class GlslangProcess
+{
+  public:
+	GlslangProcess()
+	{
+		glslang::InitializeProcess();
+	}
+
+	~GlslangProcess()
+	{
+		glslang::FinalizeProcess();
+	}
+};
 }        // namespace
 
+glslang::EShTargetLanguageVersion GLSLCompiler::target_language_version = glslang::EShTargetSpv_1_0;
+
+void GLSLCompiler::set_target_environment(glslang::EShTargetLanguageVersion target_language_version)
+{
+	GLSLCompiler::target_language_version = target_language_version;
+}
+
+glslang::EShTargetLanguageVersion GLSLCompiler::get_target_language_version()
+{
+	return target_language_version;
+}
+
 bool GLSLCompiler::compile_to_spirv(VkShaderStageFlagBits       stage,
                                     const std::vector<uint8_t> &glsl_source,
                                     const std::string &         entry_point,
@@ -68,8 +97,8 @@ bool GLSLCompiler::compile_to_spirv(VkShaderStageFlagBits       stage,
                                     std::vector<std::uint32_t> &spirv,
                                     std::string &               info_log)
 {
-	// Initialize glslang library.
-	glslang::InitializeProcess();
+	// Initialized by the first thread to get here, the others wait for it
+	static GlslangProcess glslang_process;
 
 	EShMessages messages = static_cast<EShMessages>(EShMsgDefault | EShMsgVulkanRules | EShMsgSpvRules);
 
@@ -85,6 +114,7 @@ bool GLSLCompiler::compile_to_spirv(VkShaderStageFlagBits       stage,
 	shader.setSourceEntryPoint(entry_point.c_str());
 	shader.setPreamble(shader_variant.get_preamble().c_str());
 	shader.addProcesses(shader_variant.get_processes());
+	shader.setEnvTarget(glslang::EShTargetSpv, target_language_version);
 
 	if (!shader.parse(&glslang::DefaultTBuiltInResource, 100, false, messages))
 	{
@@ -129,9 +159,11 @@ bool GLSLCompiler::compile_to_spirv(VkShaderStageFlagBits       stage,
 
 	info_log += logger.getAllMessages() + "\n";
 
-	// Shutdown glslang library.
-	glslang::FinalizeProcess();
-
 	return true;
 }
+
+std::string GLSLCompiler::get_version()
+{
+	return std::string{GLSLANG_REVISION} + " " + GLSLANG_DATE;
+}
 }        // namespace vkb
@@ -36,9 +36,18 @@ namespace vkb
 {
 /// Helper class to generate SPIRV code from GLSL source
 /// A very simple version of the glslValidator application
+/// glslang is initialized once for the process, so several threads can compile at once
 class GLSLCompiler
 {
   public:
+	/**
+	 * @brief Sets the SPIR-V version shaders are compiled to, 1.3 being needed by subgroup operations
+	 * @param target_language_version The SPIR-V version, which the device must support
+	 */
+	static void set_target_environment(glslang::EShTargetLanguageVersion target_language_version);
+
+	static glslang::EShTargetLanguageVersion get_target_language_version();
+
 	/**
 	 * @brief Compiles GLSL to SPIRV code
 	 * @param stage The Vulkan shader stage flag
@@ -54,5 +63,13 @@ class GLSLCompiler
 	                      const ShaderVariant &       shader_variant,
 	                      std::vector<std::uint32_t> &spirv,
 	                      std::string &               info_log);
+
+	/**
+	 * @return The revision of glslang, the SPIR-V it generates may differ between revisions
+	 */
+	static std::string get_version();
+
+  private:
+	static glslang::EShTargetLanguageVersion target_language_version;
 };
 }        // namespace vkb
@@ -21,13 +21,25 @@
 #define TINYGLTF_IMPLEMENTATION
 #include "gltf_loader.h"
 
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
 #include <limits>
+#include <list>
+#include <map>
+#include <numeric>
 #include <queue>
+#include <tuple>
 
 #include "common/error.h"
 
 VKBP_DISABLE_WARNINGS()
 #include "common/glm_common.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 VKBP_ENABLE_WARNINGS()
 
@@ -36,22 +48,31 @@ VKBP_ENABLE_WARNINGS()
 #include "common/vk_common.h"
 #include "core/device.h"
 #include "core/image.h"
+#include "cpu_profiler.h"
+#include "job_system.h"
+#include "mesh_optimizer.h"
+#include "meshopt_decoder.h"
 #include "platform/filesystem.h"
+#include "rendering/astc_decoder.h"
+#include "texture_streamer.h"
+#include "transfer_manager.h"
 #include "scene_graph/components/camera.h"
+#include "scene_graph/components/geometry_buffers.h"
 #include "scene_graph/components/image.h"
 #include "scene_graph/components/image/astc.h"
+#include "scene_graph/components/image/transcoder.h"
 #include "scene_graph/components/light.h"
 #include "scene_graph/components/mesh.h"
 #include "scene_graph/components/pbr_material.h"
 #include "scene_graph/components/perspective_camera.h"
 #include "scene_graph/components/sampler.h"
+#include "scene_graph/components/skin.h"
 #include "scene_graph/components/sub_mesh.h"
 #include "scene_graph/components/texture.h"
 #include "scene_graph/components/transform.h"
 #include "scene_graph/node.h"
 #include "scene_graph/scene.h"
-
-#include <ctpl_stl.h>
+#include "scene_graph/scripts/animation.h"
 
 namespace vkb
 {
@@ -278,10 +299,18 @@ inline std::vector<uint8_t> convert_underlying_data_stride(const std::vector<uin
 	return result;
 }
 
-inline void upload_image_to_gpu(CommandBuffer &command_buffer, core::Buffer &staging_buffer, sg::Image &image)
+inline void upload_image_to_gpu(TransferManager &transfer_manager, const core::Buffer &staging_buffer, VkDeviceSize staging_offset, sg::Image &image)
 {
+	auto &command_buffer = transfer_manager.get_command_buffer();
+
+	// Levels below the base level are left to the texture streamer
+	auto base_level = image.get_vk_base_level();
+
 	// Clean up the image data, as they are copied in the staging buffer
-	image.clear_data();
+	if (base_level == 0)
+	{
+		image.clear_data();
+	}
 
 	{
 		ImageMemoryBarrier memory_barrier{};
@@ -298,17 +327,17 @@ inline void upload_image_to_gpu(CommandBuffer &command_buffer, core::Buffer &sta
 	// Create a buffer image copy for every mip level
 	auto &mipmaps = image.get_mipmaps();
 
-	std::vector<VkBufferImageCopy> buffer_copy_regions(mipmaps.size());
+	std::vector<VkBufferImageCopy> buffer_copy_regions(mipmaps.size() - base_level);
 
-	for (size_t i = 0; i < mipmaps.size(); ++i)
+	for (size_t i = base_level; i < mipmaps.size(); ++i)
 	{
 		auto &mipmap      = mipmaps[i];
-		auto &copy_region = buffer_copy_regions[i];
+		auto &copy_region = buffer_copy_regions[i - base_level];
 
-		copy_region.bufferOffset     = mipmap.offset;
+		copy_region.bufferOffset     = staging_offset + mipmap.offset;
 		copy_region.imageSubresource = image.get_vk_image_view().get_subresource_layers();
 		// Update miplevel
-		copy_region.imageSubresource.mipLevel = mipmap.level;
+		copy_region.imageSubresource.mipLevel = mipmap.level - base_level;
 		copy_region.imageExtent               = mipmap.extent;
 	}
 
@@ -318,358 +347,2120 @@ inline void upload_image_to_gpu(CommandBuffer &command_buffer, core::Buffer &sta
 		ImageMemoryBarrier memory_barrier{};
 		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		memory_barrier.src_access_mask = 0;
+		memory_barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
 		memory_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
 		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
 		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
 
-		command_buffer.image_memory_barrier(image.get_vk_image_view(), memory_barrier);
+		// Images whose mip chain is generated are still written by blits on the graphics queue
+		if (image.get_gpu_mip_level_count() > 0)
+		{
+			memory_barrier.new_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			memory_barrier.dst_access_mask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+			memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		}
+
+		// Hands the image over to the graphics queue if the transfer queue is dedicated
+		transfer_manager.release_image(image.get_vk_image_view(), memory_barrier);
 	}
 }
-}        // namespace
-
-std::unordered_map<std::string, bool> GLTFLoader::supported_extensions = {
-    {KHR_LIGHTS_PUNCTUAL_EXTENSION, false}};
 
-GLTFLoader::GLTFLoader(Device &device) :
-    device{device}
+/**
+ * @brief Reads a file for tinygltf through a mapping
+ */
+/**
+ * @return The path of a file in the assets directory relative to it, empty if the file is elsewhere
+ */
+std::string get_asset_filename(const std::string &file_path)
 {
+	auto assets_path = fs::path::get(fs::path::Type::Assets);
+
+	return file_path.compare(0, assets_path.size(), assets_path) == 0 ? file_path.substr(assets_path.size()) : std::string{};
 }
 
-std::unique_ptr<sg::Scene> GLTFLoader::read_scene_from_file(const std::string &file_name, int scene_index)
+/**
+ * @brief Files in the assets directory may be served by the asset archive rather than exist on disk
+ */
+bool file_exists(const std::string &abs_filename, void *user_data)
 {
-	std::string err;
-	std::string warn;
+	auto asset_filename = get_asset_filename(abs_filename);
 
-	tinygltf::TinyGLTF gltf_loader;
-
-	std::string gltf_file = vkb::fs::path::get(vkb::fs::path::Type::Assets) + file_name;
+	if (!asset_filename.empty())
+	{
+		return fs::asset_exists(asset_filename);
+	}
 
-	bool importResult = gltf_loader.LoadASCIIFromFile(&model, &err, &warn, gltf_file.c_str());
+	return tinygltf::FileExists(abs_filename, user_data);
+}
 
-	if (!importResult)
+bool read_mapped_file(std::vector<unsigned char> *out, std::string *err, const std::string &file_path, void * /*user_data*/)
+{
+	try
 	{
-		LOGE("Failed to load gltf file {}.", gltf_file.c_str());
+		auto asset_filename = get_asset_filename(file_path);
 
-		return nullptr;
-	}
+		auto file = asset_filename.empty() ? fs::MappedFile{file_path} : fs::map_asset(asset_filename);
 
-	if (!err.empty())
+		out->assign(file.get_data(), file.get_data() + file.get_size());
+	}
+	catch (const std::runtime_error &e)
 	{
-		LOGE("Error loading gltf model: {}.", err.c_str());
+		if (err)
+		{
+			*err += e.what() + std::string("\n");
+		}
 
-		return nullptr;
+		return false;
 	}
 
-	if (!warn.empty())
-	{
-		LOGI("{}", warn.c_str());
-	}
+	return true;
+}
 
-	size_t pos = file_name.find_last_of('/');
+/// Staging memory used to upload images, regardless of the size of the scene
+const VkDeviceSize staging_ring_size = 64 * 1024 * 1024;
 
-	model_path = file_name.substr(0, pos);
+/**
+ * @brief Fixed-size staging memory split in segments. A segment is submitted to the transfer manager
+ *        when the next copy does not fit, and waited on before it is written again, so copies
+ *        overlap with the transfers of the previous segments.
+ */
+class StagingRing
+{
+  public:
+	StagingRing(Device &device, TransferManager &transfer_manager, VkDeviceSize size, uint32_t segment_count = 2) :
+	    device{device},
+	    transfer_manager{transfer_manager},
+	    segment_size{size / segment_count}
+	{
+		for (uint32_t i = 0; i < segment_count; i++)
+		{
+			segments.emplace_back(core::Buffer{device, segment_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY});
+		}
+	}
 
-	if (pos == std::string::npos)
+	~StagingRing()
 	{
-		model_path.clear();
+		// The transfers may still read from the staging memory
+		for (auto &segment : segments)
+		{
+			transfer_manager.wait(segment.submitted_value);
+		}
 	}
 
-	return std::make_unique<sg::Scene>(load_scene(scene_index));
-}
+	/**
+	 * @brief Copies data to staging memory, data larger than a segment gets a dedicated buffer.
+	 *        Copies from it are recorded in the command buffer of the transfer manager.
+	 * @param[out] buffer The buffer holding the data
+	 * @param[out] offset The offset of the data in the buffer
+	 */
+	void stage(const std::vector<uint8_t> &data, const core::Buffer *&buffer, VkDeviceSize &offset)
+	{
+		// Offsets of buffer to image copies must be a multiple of the texel block size
+		offset = segments[current].recording ? (segments[current].offset + 15) & ~static_cast<VkDeviceSize>(15) : 0;
 
-sg::Scene GLTFLoader::load_scene(int scene_index)
-{
-	auto scene = sg::Scene();
+		if (data.size() <= segment_size && offset + data.size() > segment_size)
+		{
+			submit();
 
-	scene.set_name("gltf_scene");
+			current = (current + 1) % segments.size();
+			offset  = 0;
+		}
 
-	// Check extensions
-	for (auto &used_extension : model.extensionsUsed)
-	{
-		auto it = supported_extensions.find(used_extension);
+		auto &segment = begin_segment();
 
-		// Check if extension isn't supported by the GLTFLoader
-		if (it == supported_extensions.end())
+		if (data.size() > segment_size)
 		{
-			// If extension is required then we shouldn't allow the scene to be loaded
-			if (std::find(model.extensionsRequired.begin(), model.extensionsRequired.end(), used_extension) != model.extensionsRequired.end())
-			{
-				throw std::runtime_error("Cannot load glTF file. Contains a required unsupported extension: " + used_extension);
-			}
-			else
-			{
-				// Otherwise, if extension isn't required (but is in the file) then print a warning to the user
-				LOGW("glTF file contains an unsupported extension, unexpected results may occur: {}", used_extension);
-			}
+			segment.dedicated_buffers.emplace_back(device, data.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+			segment.dedicated_buffers.back().update(data);
+
+			buffer = &segment.dedicated_buffers.back();
+			offset = 0;
 		}
 		else
 		{
-			// Extension is supported, so enable it
-			LOGI("glTF file contains extension: {}", used_extension);
-			it->second = true;
+			segment.buffer.update(data, static_cast<size_t>(offset));
+			segment.offset = offset + data.size();
+
+			buffer = &segment.buffer;
 		}
 	}
 
-	// Load lights
-	std::vector<std::unique_ptr<sg::Light>> light_components = parse_khr_lights_punctual();
+	/**
+	 * @brief Submits the copies recorded so far
+	 * @return The transfer value to wait for
+	 */
+	uint64_t submit()
+	{
+		auto &segment = segments[current];
 
-	scene.set_components(std::move(light_components));
+		if (!segment.recording)
+		{
+			return segment.submitted_value;
+		}
 
-	// Load samplers
-	std::vector<std::unique_ptr<sg::Sampler>>
-	    sampler_components(model.samplers.size());
+		segment.submitted_value = transfer_manager.submit();
+		segment.recording       = false;
 
-	for (size_t sampler_index = 0; sampler_index < model.samplers.size(); sampler_index++)
+		return segment.submitted_value;
+	}
+
+	/**
+	 * @brief Submits the copies recorded so far and moves to the next segment, so that the
+	 *        transfers start while the caller waits for more data
+	 */
+	void flush()
 	{
-		auto sampler                      = parse_sampler(model.samplers.at(sampler_index));
-		sampler_components[sampler_index] = std::move(sampler);
+		if (segments[current].recording)
+		{
+			submit();
+
+			current = (current + 1) % segments.size();
+		}
 	}
 
-	scene.set_components(std::move(sampler_components));
+  private:
+	struct Segment
+	{
+		Segment(core::Buffer &&buffer) :
+		    buffer{std::move(buffer)}
+		{}
 
-	Timer timer;
-	timer.start();
+		core::Buffer buffer;
 
-	// Load images
-	auto thread_count = std::thread::hardware_concurrency();
-	thread_count      = thread_count == 0 ? 1 : thread_count;
-	ctpl::thread_pool thread_pool(thread_count);
+		VkDeviceSize offset{0};
 
-	auto image_count = to_u32(model.images.size());
+		bool recording{false};
 
-	std::vector<std::future<std::unique_ptr<sg::Image>>> image_component_futures;
-	for (size_t image_index = 0; image_index < image_count; image_index++)
+		uint64_t submitted_value{0};
+
+		std::list<core::Buffer> dedicated_buffers;
+	};
+
+	Segment &begin_segment()
 	{
-		auto fut = thread_pool.push(
-		    [this, image_index](size_t) {
-			    auto image = parse_image(model.images.at(image_index));
+		auto &segment = segments[current];
 
-			    LOGI("Loaded gltf image #{} ({})", image_index, model.images.at(image_index).uri.c_str());
+		if (segment.recording)
+		{
+			return segment;
+		}
 
-			    return image;
-		    });
+		// Wait for the previous copies from this segment before overwriting it
+		transfer_manager.wait(segment.submitted_value);
 
-		image_component_futures.push_back(std::move(fut));
+		segment.dedicated_buffers.clear();
+		segment.offset    = 0;
+		segment.recording = true;
+
+		return segment;
 	}
 
-	std::vector<std::unique_ptr<sg::Image>> image_components;
-	for (auto &fut : image_component_futures)
+	Device &device;
+
+	TransferManager &transfer_manager;
+
+	VkDeviceSize segment_size;
+
+	std::vector<Segment> segments;
+
+	size_t current{0};
+};
+
+/**
+ * @brief Images handed from the decode jobs to the upload loop in the order they finish,
+ *        so that a slow image does not hold back the upload of the ones decoded after it
+ */
+class DecodedImageQueue
+{
+  public:
+	/**
+	 * @param image The decoded image, null if decoding failed
+	 */
+	void push(size_t index, std::unique_ptr<sg::Image> &&image)
 	{
-		image_components.push_back(fut.get());
+		{
+			std::lock_guard<std::mutex> lock{mutex};
+
+			images.emplace(index, std::move(image));
+		}
+
+		condition.notify_one();
 	}
 
-	// Upload images to GPU
-	std::vector<core::Buffer> transient_buffers;
+	bool try_pop(size_t &index, std::unique_ptr<sg::Image> &image)
+	{
+		std::lock_guard<std::mutex> lock{mutex};
 
-	auto &command_buffer = device.request_command_buffer();
+		if (images.empty())
+		{
+			return false;
+		}
 
-	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, 0);
+		index = images.front().first;
+		image = std::move(images.front().second);
+		images.pop();
 
-	for (size_t image_index = 0; image_index < image_count; image_index++)
+		return true;
+	}
+
+	void pop(size_t &index, std::unique_ptr<sg::Image> &image)
 	{
-		auto &image = image_components.at(image_index);
+		std::unique_lock<std::mutex> lock{mutex};
 
-		core::Buffer stage_buffer{device,
-		                          image->get_data().size(),
-		                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		                          VMA_MEMORY_USAGE_CPU_ONLY};
+		condition.wait(lock, [this] { return !images.empty(); });
 
-		stage_buffer.update(image->get_data());
+		index = images.front().first;
+		image = std::move(images.front().second);
+		images.pop();
+	}
 
-		upload_image_to_gpu(command_buffer, stage_buffer, *image);
+  private:
+	std::mutex mutex;
 
-		transient_buffers.push_back(std::move(stage_buffer));
-	}
+	std::condition_variable condition;
 
-	command_buffer.end();
+	std::queue<std::pair<size_t, std::unique_ptr<sg::Image>>> images;
+};
 
-	auto &queue = device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+/// Name of the vertex buffer holding the interleaved attributes of a sub mesh
+const std::string interleaved_buffer_name = "interleaved";
 
-	queue.submit(command_buffer, device.request_fence());
+/// Grid resolutions of the simplified levels of detail, from the finest to the coarsest
+const std::array<uint32_t, 3> lod_grid_resolutions = {32, 12, 4};
 
-	device.get_fence_pool().wait();
-	device.get_fence_pool().reset();
-	device.get_command_pool().reset_pool();
+/// A level is drawn once a cell of its grid covers about 4 pixels of a 1080 pixels high viewport
+const float lod_screen_size_per_cell = 4.0f / 1080.0f;
 
-	transient_buffers.clear();
+/// Levels which keep more than this fraction of the triangles of the previous level are skipped
+const float lod_min_reduction = 0.75f;
 
-	scene.set_components(std::move(image_components));
+/**
+ * @brief Vertex and index data of a primitive, kept until its buffers are created
+ */
+struct PrimitiveData
+{
+	sg::Mesh *mesh{nullptr};
 
-	auto elapsed_time = timer.stop();
+	sg::SubMesh *submesh{nullptr};
 
-	LOGI("Time spent loading images: {} seconds across {} threads.", vkb::to_string(elapsed_time), thread_count);
+	/// Vertex data per buffer, either named after its attribute or interleaved_buffer_name
+	std::unordered_map<std::string, std::vector<uint8_t>> vertex_data;
 
-	// Load textures
-	auto images          = scene.get_components<sg::Image>();
-	auto samplers        = scene.get_components<sg::Sampler>();
-	auto default_sampler = create_default_sampler();
+	std::unordered_map<std::string, uint32_t> vertex_strides;
 
-	for (auto &gltf_texture : model.textures)
-	{
-		auto texture = parse_texture(gltf_texture);
+	/// Attributes stored in the interleaved buffer
+	std::vector<std::string> interleaved_attributes;
 
-		texture->set_image(*images.at(gltf_texture.source));
+	std::vector<uint8_t> index_data;
 
-		if (gltf_texture.sampler >= 0 && gltf_texture.sampler < static_cast<int>(samplers.size()))
-		{
-			texture->set_sampler(*samplers.at(gltf_texture.sampler));
-		}
-		else
-		{
-			if (gltf_texture.name.empty())
-			{
-				gltf_texture.name = images.at(gltf_texture.source)->get_name();
-			}
+	const tinygltf::Primitive *gltf_primitive{nullptr};
 
-			LOGW("Sampler not found for texture {}, possible GLTF error", gltf_texture.name);
-			texture->set_sampler(*default_sampler);
-		}
+	bool triangle_list{false};
 
-		scene.add_component(std::move(texture));
+	bool merged{false};
+};
+
+/**
+ * @return The names of the attributes read from a vertex buffer of a primitive
+ */
+inline std::vector<std::string> get_buffer_attributes(const PrimitiveData &primitive, const std::string &buffer_name)
+{
+	if (buffer_name == interleaved_buffer_name)
+	{
+		return primitive.interleaved_attributes;
 	}
 
-	scene.add_component(std::move(default_sampler));
+	return {buffer_name};
+}
 
-	// Load materials
-	auto textures = scene.get_components<sg::Texture>();
+inline glm::vec2 encode_octahedral(glm::vec3 normal)
+{
+	float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
 
-	for (auto &gltf_material : model.materials)
+	if (length == 0.0f)
 	{
-		auto material = parse_material(gltf_material);
+		return glm::vec2{0.0f};
+	}
 
-		for (auto &gltf_value : gltf_material.values)
-		{
-			if (gltf_value.first.find("Texture") != std::string::npos)
-			{
-				std::string tex_name = to_snake_case(gltf_value.first);
+	normal /= length;
 
-				material->textures[tex_name] = textures.at(gltf_value.second.TextureIndex());
-			}
-		}
+	if (normal.z >= 0.0f)
+	{
+		return glm::vec2{normal.x, normal.y};
+	}
 
-		for (auto &gltf_value : gltf_material.additionalValues)
-		{
-			if (gltf_value.first.find("Texture") != std::string::npos)
-			{
-				std::string tex_name = to_snake_case(gltf_value.first);
+	// Fold the lower hemisphere over the diagonals
+	return glm::vec2{(1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f),
+	                 (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f)};
+}
 
-				material->textures[tex_name] = textures.at(gltf_value.second.TextureIndex());
-			}
-		}
+/**
+ * @brief Quantizes and interleaves the float positions, normals and texture coordinates of a primitive
+ */
+inline void convert_vertex_format(PrimitiveData &primitive, const VertexFormat &format)
+{
+	struct ConvertedAttribute
+	{
+		std::string name;
 
-		scene.add_component(std::move(material));
-	}
+		VkFormat format;
 
-	auto default_material = create_default_material();
+		uint32_t size;
 
-	// Load meshes
-	auto materials = scene.get_components<sg::PBRMaterial>();
+		std::vector<uint8_t> data;
+	};
 
-	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	auto &submesh = *primitive.submesh;
 
-	for (auto &gltf_mesh : model.meshes)
+	std::vector<ConvertedAttribute> converted_attributes;
+
+	for (std::string name : {"position", "normal", "texcoord_0"})
 	{
-		auto mesh = parse_mesh(gltf_mesh);
+		VkFormat float_format = name == "texcoord_0" ? VK_FORMAT_R32G32_SFLOAT : VK_FORMAT_R32G32B32_SFLOAT;
 
-		for (auto &gltf_primitive : gltf_mesh.primitives)
+		auto                data_it = primitive.vertex_data.find(name);
+		sg::VertexAttribute attribute;
+
+		if (data_it == primitive.vertex_data.end() ||
+		    !submesh.get_attribute(name, attribute) ||
+		    attribute.format != float_format ||
+		    data_it->second.size() < static_cast<size_t>(submesh.vertices_count) * attribute.stride)
 		{
-			auto submesh = std::make_unique<sg::SubMesh>();
+			continue;
+		}
 
-			for (auto &attribute : gltf_primitive.attributes)
-			{
-				std::string attrib_name = attribute.first;
-				std::transform(attrib_name.begin(), attrib_name.end(), attrib_name.begin(), ::tolower);
+		const uint8_t *src    = data_it->second.data();
+		uint32_t       stride = attribute.stride;
+
+		ConvertedAttribute converted{name, attribute.format, 0, {}};
+
+		if (name == "position")
+		{
+			converted.format = format.quantize_positions ? VK_FORMAT_R16G16B16A16_SFLOAT : VK_FORMAT_R32G32B32_SFLOAT;
+			converted.size   = format.quantize_positions ? 8 : 12;
+		}
+		else if (name == "normal")
+		{
+			converted.format = format.quantize_normals ? VK_FORMAT_R16G16_SNORM : VK_FORMAT_R32G32B32_SFLOAT;
+			converted.size   = format.quantize_normals ? 4 : 12;
+		}
+		else
+		{
+			converted.format = VK_FORMAT_R32G32_SFLOAT;
+			converted.size   = 8;
 
-				auto vertex_data = get_attribute_data(&model, attribute.second);
+			if (format.quantize_texcoords)
+			{
+				bool normalized = true;
 
-				if (attrib_name == "position")
+				for (uint32_t i = 0; i < submesh.vertices_count && normalized; i++)
 				{
-					submesh->vertices_count = to_u32(model.accessors.at(attribute.second).count);
+					auto uv    = *reinterpret_cast<const glm::vec2 *>(src + i * stride);
+					normalized = uv.x >= 0.0f && uv.x <= 1.0f && uv.y >= 0.0f && uv.y <= 1.0f;
 				}
 
-				core::Buffer buffer{device,
-				                    vertex_data.size(),
-				                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-				                    VMA_MEMORY_USAGE_GPU_TO_CPU};
-				buffer.update(vertex_data);
+				converted.format = normalized ? VK_FORMAT_R16G16_UNORM : VK_FORMAT_R16G16_SFLOAT;
+				converted.size   = 4;
+			}
+		}
 
-				submesh->vertex_buffers.insert(std::make_pair(attrib_name, std::move(buffer)));
+		converted.data.resize(static_cast<size_t>(submesh.vertices_count) * converted.size);
 
-				sg::VertexAttribute attrib;
-				attrib.format = get_attribute_format(&model, attribute.second);
-				attrib.stride = to_u32(get_attribute_stride(&model, attribute.second));
+		for (uint32_t i = 0; i < submesh.vertices_count; i++)
+		{
+			const uint8_t *src_vertex = src + i * stride;
+			uint8_t *      dst_vertex = converted.data.data() + i * converted.size;
 
-				submesh->set_attribute(attrib_name, attrib);
+			switch (converted.format)
+			{
+				case VK_FORMAT_R16G16B16A16_SFLOAT:
+				{
+					uint64_t packed = glm::packHalf4x16(glm::vec4(*reinterpret_cast<const glm::vec3 *>(src_vertex), 1.0f));
+					std::memcpy(dst_vertex, &packed, sizeof(packed));
+					break;
+				}
+				case VK_FORMAT_R16G16_SNORM:
+				{
+					uint32_t packed = glm::packSnorm2x16(encode_octahedral(*reinterpret_cast<const glm::vec3 *>(src_vertex)));
+					std::memcpy(dst_vertex, &packed, sizeof(packed));
+					break;
+				}
+				case VK_FORMAT_R16G16_UNORM:
+				{
+					uint32_t packed = glm::packUnorm2x16(*reinterpret_cast<const glm::vec2 *>(src_vertex));
+					std::memcpy(dst_vertex, &packed, sizeof(packed));
+					break;
+				}
+				case VK_FORMAT_R16G16_SFLOAT:
+				{
+					uint32_t packed = glm::packHalf2x16(*reinterpret_cast<const glm::vec2 *>(src_vertex));
+					std::memcpy(dst_vertex, &packed, sizeof(packed));
+					break;
+				}
+				default:
+				{
+					std::memcpy(dst_vertex, src_vertex, converted.size);
+					break;
+				}
 			}
+		}
 
-			if (gltf_primitive.indices >= 0)
-			{
-				submesh->vertex_indices = to_u32(get_attribute_size(&model, gltf_primitive.indices));
+		converted_attributes.push_back(std::move(converted));
+	}
 
-				auto format = get_attribute_format(&model, gltf_primitive.indices);
+	if (format.interleave && converted_attributes.size() > 1)
+	{
+		uint32_t stride = 0;
 
-				auto vertex_data = get_attribute_data(&model, gltf_primitive.indices);
-				auto index_data  = get_attribute_data(&model, gltf_primitive.indices);
+		for (auto &converted : converted_attributes)
+		{
+			stride += converted.size;
+		}
 
-				switch (format)
-				{
-					case VK_FORMAT_R8_UINT:
-						// Converts uint8 data into uint16 data, still represented by a uint8 vector
-						index_data          = convert_underlying_data_stride(index_data, 1, 2);
-						submesh->index_type = VK_INDEX_TYPE_UINT16;
-						break;
-					case VK_FORMAT_R16_UINT:
-						submesh->index_type = VK_INDEX_TYPE_UINT16;
-						break;
-					case VK_FORMAT_R32_UINT:
-						submesh->index_type = VK_INDEX_TYPE_UINT32;
-						break;
-					default:
-						LOGE("gltf primitive has invalid format type");
-						break;
-				}
+		std::vector<uint8_t> interleaved(static_cast<size_t>(submesh.vertices_count) * stride);
 
-				submesh->index_buffer = std::make_unique<core::Buffer>(device,
-				                                                       index_data.size(),
-				                                                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-				                                                       VMA_MEMORY_USAGE_GPU_TO_CPU);
+		uint32_t offset = 0;
 
-				submesh->index_buffer->update(index_data);
-			}
-			else
+		for (auto &converted : converted_attributes)
+		{
+			for (uint32_t i = 0; i < submesh.vertices_count; i++)
 			{
-				submesh->vertices_count = to_u32(get_attribute_size(&model, gltf_primitive.attributes.at("POSITION")));
+				std::memcpy(interleaved.data() + i * stride + offset, converted.data.data() + i * converted.size, converted.size);
 			}
 
-			if (gltf_primitive.material < 0)
-			{
-				submesh->set_material(*default_material);
-			}
-			else
-			{
-				submesh->set_material(*materials.at(gltf_primitive.material));
-			}
+			sg::VertexAttribute attribute;
+			attribute.format = converted.format;
+			attribute.stride = stride;
+			attribute.offset = offset;
 
-			mesh->add_submesh(*submesh);
+			submesh.set_attribute(converted.name, attribute);
 
-			scene.add_component(std::move(submesh));
+			primitive.vertex_data.erase(converted.name);
+			primitive.vertex_strides.erase(converted.name);
+			primitive.interleaved_attributes.push_back(converted.name);
+
+			offset += converted.size;
 		}
 
-		scene.add_component(std::move(mesh));
+		primitive.vertex_data[interleaved_buffer_name]    = std::move(interleaved);
+		primitive.vertex_strides[interleaved_buffer_name] = stride;
 	}
+	else
+	{
+		for (auto &converted : converted_attributes)
+		{
+			sg::VertexAttribute attribute;
+			attribute.format = converted.format;
+			attribute.stride = converted.size;
 
-	command_buffer.end();
-
-	queue.submit(command_buffer, device.request_fence());
+			submesh.set_attribute(converted.name, attribute);
 
-	device.get_fence_pool().wait();
-	device.get_fence_pool().reset();
-	device.get_command_pool().reset_pool();
+			primitive.vertex_data[converted.name]    = std::move(converted.data);
+			primitive.vertex_strides[converted.name] = converted.size;
+		}
+	}
+}
 
-	transient_buffers.clear();
+/**
+ * @return The indices of the full sub mesh of a primitive, widened to 32 bits
+ */
+inline std::vector<uint32_t> read_indices(const PrimitiveData &primitive)
+{
+	auto &submesh = *primitive.submesh;
 
-	scene.add_component(std::move(default_material));
+	std::vector<uint32_t> indices(submesh.vertex_indices);
+
+	for (uint32_t i = 0; i < submesh.vertex_indices; i++)
+	{
+		if (submesh.index_type == VK_INDEX_TYPE_UINT32)
+		{
+			indices[i] = reinterpret_cast<const uint32_t *>(primitive.index_data.data())[i];
+		}
+		else
+		{
+			indices[i] = reinterpret_cast<const uint16_t *>(primitive.index_data.data())[i];
+		}
+	}
+
+	return indices;
+}
+
+/**
+ * @brief Reorders the triangles and vertices of an indexed triangle list with float positions
+ * @return True if the primitive was optimized
+ */
+inline bool optimize_primitive(PrimitiveData &primitive, MeshOptimizerCache &cache)
+{
+	auto &submesh = *primitive.submesh;
+
+	sg::VertexAttribute position_attribute;
+
+	auto position_it = primitive.vertex_data.find("position");
+
+	if (!primitive.triangle_list || primitive.index_data.empty() || position_it == primitive.vertex_data.end() ||
+	    !submesh.get_attribute("position", position_attribute) || position_attribute.format != VK_FORMAT_R32G32B32_SFLOAT)
+	{
+		return false;
+	}
+
+	// Every attribute is remapped, so all of them need data for each vertex
+	for (auto &vertex_data : primitive.vertex_data)
+	{
+		if (vertex_data.second.size() < static_cast<size_t>(submesh.vertices_count) * primitive.vertex_strides.at(vertex_data.first))
+		{
+			return false;
+		}
+	}
+
+	auto indices = read_indices(primitive);
+
+	auto positions = position_it->second.data();
+
+	auto key = MeshOptimizerCache::get_key(indices, submesh.vertices_count, positions, position_attribute.stride);
+
+	OptimizedMesh mesh;
+
+	if (!cache.find(key, mesh))
+	{
+		mesh = optimize_mesh(indices, submesh.vertices_count, positions, position_attribute.stride);
+
+		cache.insert(key, mesh);
+	}
+
+	for (auto &vertex_data : primitive.vertex_data)
+	{
+		vertex_data.second = remap_vertex_data(vertex_data.second, primitive.vertex_strides.at(vertex_data.first), mesh);
+	}
+
+	// Fewer vertices are left, so the indices keep their type
+	for (uint32_t i = 0; i < submesh.vertex_indices; i++)
+	{
+		if (submesh.index_type == VK_INDEX_TYPE_UINT32)
+		{
+			reinterpret_cast<uint32_t *>(primitive.index_data.data())[i] = mesh.indices[i];
+		}
+		else
+		{
+			reinterpret_cast<uint16_t *>(primitive.index_data.data())[i] = static_cast<uint16_t>(mesh.indices[i]);
+		}
+	}
+
+	submesh.vertices_count = mesh.vertex_count;
+
+	return true;
+}
+
+/**
+ * @brief Simplifies an indexed triangle list with float positions, and appends the indices
+ *        of each level of detail after the ones of the full sub mesh
+ * @return Number of levels added
+ */
+inline uint32_t generate_lods(PrimitiveData &primitive)
+{
+	auto &submesh = *primitive.submesh;
+
+	sg::VertexAttribute position_attribute;
+
+	auto position_it = primitive.vertex_data.find("position");
+
+	if (!primitive.triangle_list || primitive.index_data.empty() || position_it == primitive.vertex_data.end() ||
+	    !submesh.get_attribute("position", position_attribute) || position_attribute.format != VK_FORMAT_R32G32B32_SFLOAT)
+	{
+		return 0;
+	}
+
+	auto indices = read_indices(primitive);
+
+	size_t previous_count = indices.size();
+
+	uint32_t index_size = submesh.index_type == VK_INDEX_TYPE_UINT32 ? 4 : 2;
+
+	for (auto grid_resolution : lod_grid_resolutions)
+	{
+		auto lod_indices = simplify_mesh(indices, submesh.vertices_count, position_it->second.data(), position_attribute.stride, grid_resolution);
+
+		if (lod_indices.empty() || static_cast<float>(lod_indices.size()) > static_cast<float>(previous_count) * lod_min_reduction)
+		{
+			continue;
+		}
+
+		sg::SubMeshLod lod;
+		lod.first_index = to_u32(primitive.index_data.size() / index_size);
+		lod.index_count = to_u32(lod_indices.size());
+		lod.screen_size = grid_resolution * lod_screen_size_per_cell;
+
+		// The levels index the vertices of the full sub mesh, so they fit in its index type
+		primitive.index_data.resize(primitive.index_data.size() + lod_indices.size() * index_size);
+
+		for (size_t i = 0; i < lod_indices.size(); i++)
+		{
+			if (submesh.index_type == VK_INDEX_TYPE_UINT32)
+			{
+				reinterpret_cast<uint32_t *>(primitive.index_data.data())[lod.first_index + i] = lod_indices[i];
+			}
+			else
+			{
+				reinterpret_cast<uint16_t *>(primitive.index_data.data())[lod.first_index + i] = static_cast<uint16_t>(lod_indices[i]);
+			}
+		}
+
+		submesh.lods.push_back(lod);
+
+		previous_count = lod_indices.size();
+	}
+
+	return to_u32(submesh.lods.size());
+}
+
+inline void create_submesh_buffers(Device &device, PrimitiveData &primitive)
+{
+	auto &submesh = *primitive.submesh;
+
+	for (auto &vertex_data : primitive.vertex_data)
+	{
+		// Also readable as storage buffers, for the subpasses pulling the vertices in their shaders
+		core::Buffer buffer{device,
+		                    vertex_data.second.size(),
+		                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		                    VMA_MEMORY_USAGE_GPU_TO_CPU};
+		buffer.update(vertex_data.second);
+		buffer.set_debug_name(primitive.mesh->get_name() + " " + vertex_data.first);
+
+		auto buffer_it = submesh.vertex_buffers.insert(std::make_pair(vertex_data.first, std::move(buffer))).first;
+
+		if (vertex_data.first == interleaved_buffer_name)
+		{
+			for (auto &attribute_name : primitive.interleaved_attributes)
+			{
+				submesh.shared_vertex_buffers[attribute_name] = &buffer_it->second;
+			}
+		}
+	}
+
+	if (!primitive.index_data.empty())
+	{
+		submesh.index_buffer = std::make_unique<core::Buffer>(device,
+		                                                      primitive.index_data.size(),
+		                                                      VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		                                                      VMA_MEMORY_USAGE_GPU_TO_CPU);
+
+		submesh.index_buffer->update(primitive.index_data);
+		submesh.index_buffer->set_debug_name(primitive.mesh->get_name() + " indices");
+	}
+}
+
+/**
+ * @brief Suballocates the geometry of the primitives from shared buffers. The vertices of a sub mesh
+ *        start at the same index in every vertex buffer, so the strides of a buffer must match
+ *        for all the merged primitives.
+ * @return The shared buffers, or nullptr if no primitive could be merged
+ */
+inline std::unique_ptr<sg::GeometryBuffers> create_geometry_buffers(Device &device, std::vector<PrimitiveData> &primitives)
+{
+	// The first primitive with a vertex buffer decides its stride
+	std::unordered_map<std::string, uint32_t> buffer_strides;
+
+	for (auto &primitive : primitives)
+	{
+		for (auto &vertex_stride : primitive.vertex_strides)
+		{
+			buffer_strides.emplace(vertex_stride.first, vertex_stride.second);
+		}
+	}
+
+	std::vector<PrimitiveData *> merged_primitives;
+
+	uint32_t vertex_count = 0;
+
+	std::map<VkIndexType, uint32_t> index_counts;
+
+	for (auto &primitive : primitives)
+	{
+		auto &submesh = *primitive.submesh;
+
+		bool strides_match = std::all_of(primitive.vertex_strides.begin(), primitive.vertex_strides.end(),
+		                                 [&](const std::pair<const std::string, uint32_t> &vertex_stride) {
+			                                 return vertex_stride.second == buffer_strides.at(vertex_stride.first);
+		                                 });
+
+		if (!strides_match)
+		{
+			continue;
+		}
+
+		submesh.vertex_offset = static_cast<int32_t>(vertex_count);
+		vertex_count += submesh.vertices_count;
+
+		if (!primitive.index_data.empty())
+		{
+			auto &index_count = index_counts[submesh.index_type];
+
+			// Levels of detail follow the indices of the full sub mesh
+			submesh.first_index = index_count;
+			index_count += to_u32(primitive.index_data.size() / (submesh.index_type == VK_INDEX_TYPE_UINT32 ? 4 : 2));
+		}
+
+		primitive.merged = true;
+
+		merged_primitives.push_back(&primitive);
+	}
+
+	if (merged_primitives.empty())
+	{
+		return nullptr;
+	}
+
+	auto geometry_buffers = std::make_unique<sg::GeometryBuffers>("gltf_geometry");
+
+	// Host visible memory which is preferably device local, as it is on the unified memory of mobile GPUs
+	for (auto &primitive : merged_primitives)
+	{
+		for (auto &vertex_data : primitive->vertex_data)
+		{
+			auto stride = buffer_strides.at(vertex_data.first);
+
+			auto buffer_it = geometry_buffers->vertex_buffers.find(vertex_data.first);
+
+			if (buffer_it == geometry_buffers->vertex_buffers.end())
+			{
+				core::Buffer buffer{device,
+				                    static_cast<VkDeviceSize>(vertex_count) * stride,
+				                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				                    VMA_MEMORY_USAGE_CPU_TO_GPU};
+				buffer.set_debug_name("Merged geometry " + vertex_data.first);
+
+				buffer_it = geometry_buffers->vertex_buffers.emplace(vertex_data.first, std::move(buffer)).first;
+			}
+
+			auto size = std::min<size_t>(vertex_data.second.size(), primitive->submesh->vertices_count * stride);
+
+			buffer_it->second.update(vertex_data.second.data(), size, primitive->submesh->vertex_offset * stride);
+
+			for (auto &attribute_name : get_buffer_attributes(*primitive, vertex_data.first))
+			{
+				primitive->submesh->shared_vertex_buffers[attribute_name] = &buffer_it->second;
+			}
+		}
+	}
+
+	for (auto &index_count : index_counts)
+	{
+		uint32_t index_size = index_count.first == VK_INDEX_TYPE_UINT32 ? 4 : 2;
+
+		core::Buffer buffer{device,
+		                    static_cast<VkDeviceSize>(index_count.second) * index_size,
+		                    VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		                    VMA_MEMORY_USAGE_CPU_TO_GPU};
+		buffer.set_debug_name("Merged geometry indices");
+
+		geometry_buffers->index_buffers.emplace(index_count.first, std::move(buffer));
+	}
+
+	for (auto &primitive : merged_primitives)
+	{
+		auto &submesh = *primitive->submesh;
+
+		if (primitive->index_data.empty())
+		{
+			continue;
+		}
+
+		auto &buffer = geometry_buffers->index_buffers.at(submesh.index_type);
+
+		uint32_t index_size = submesh.index_type == VK_INDEX_TYPE_UINT32 ? 4 : 2;
+
+		buffer.update(primitive->index_data.data(), primitive->index_data.size(), submesh.first_index * index_size);
+
+		submesh.shared_index_buffer = &buffer;
+	}
+
+	LOGI("Merged the geometry of {} out of {} sub meshes", merged_primitives.size(), primitives.size());
+
+	return geometry_buffers;
+}
+
+/**
+ * @return The scene of the model to load, the default one if the index is out of range, nullptr if the model has none
+ */
+inline const tinygltf::Scene *find_gltf_scene(const tinygltf::Model &model, int scene_index)
+{
+	if (scene_index >= 0 && scene_index < static_cast<int>(model.scenes.size()))
+	{
+		return &model.scenes[scene_index];
+	}
+	else if (model.defaultScene >= 0 && model.defaultScene < static_cast<int>(model.scenes.size()))
+	{
+		return &model.scenes[model.defaultScene];
+	}
+	else if (model.scenes.size() > 0)
+	{
+		return &model.scenes[0];
+	}
+
+	return nullptr;
+}
+
+inline glm::mat4 get_node_matrix(const tinygltf::Node &gltf_node)
+{
+	if (!gltf_node.matrix.empty())
+	{
+		glm::mat4 matrix;
+
+		std::transform(gltf_node.matrix.begin(), gltf_node.matrix.end(), glm::value_ptr(matrix), TypeCast<double, float>{});
+
+		return matrix;
+	}
+
+	glm::vec3 translation{0.0f};
+	glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+	glm::vec3 scale{1.0f};
+
+	std::transform(gltf_node.translation.begin(), gltf_node.translation.end(), glm::value_ptr(translation), TypeCast<double, float>{});
+	std::transform(gltf_node.rotation.begin(), gltf_node.rotation.end(), glm::value_ptr(rotation), TypeCast<double, float>{});
+	std::transform(gltf_node.scale.begin(), gltf_node.scale.end(), glm::value_ptr(scale), TypeCast<double, float>{});
+
+	return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+}
+
+/**
+ * @brief Finds the nodes of a scene whose transform never changes: those neither animated, skinned
+ *        nor joints, and not below such a node
+ * @param world_matrices Receives the world matrices of the nodes of the scene
+ * @return Whether each node of the model is static, the nodes outside the scene are not
+ */
+inline std::vector<bool> find_static_nodes(const tinygltf::Model &model, const tinygltf::Scene &gltf_scene, std::vector<glm::mat4> &world_matrices)
+{
+	std::vector<bool> moving(model.nodes.size(), false);
+
+	for (auto &gltf_animation : model.animations)
+	{
+		for (auto &channel : gltf_animation.channels)
+		{
+			if (channel.target_node >= 0 && static_cast<size_t>(channel.target_node) < moving.size())
+			{
+				moving[channel.target_node] = true;
+			}
+		}
+	}
+
+	for (auto &gltf_skin : model.skins)
+	{
+		for (auto joint : gltf_skin.joints)
+		{
+			moving.at(joint) = true;
+		}
+	}
+
+	for (size_t node_index = 0; node_index < model.nodes.size(); node_index++)
+	{
+		if (model.nodes[node_index].skin >= 0)
+		{
+			moving[node_index] = true;
+		}
+	}
+
+	std::vector<bool> static_nodes(model.nodes.size(), false);
+
+	world_matrices.assign(model.nodes.size(), glm::mat4(1.0f));
+
+	// Parents are visited before their children
+	std::queue<std::tuple<int, glm::mat4, bool>> traverse_nodes;
+
+	for (auto node_index : gltf_scene.nodes)
+	{
+		traverse_nodes.push(std::make_tuple(node_index, glm::mat4(1.0f), false));
+	}
+
+	while (!traverse_nodes.empty())
+	{
+		int       node_index;
+		glm::mat4 parent_matrix;
+		bool      parent_moving;
+		std::tie(node_index, parent_matrix, parent_moving) = traverse_nodes.front();
+		traverse_nodes.pop();
+
+		bool node_moving = parent_moving || moving.at(node_index);
+
+		world_matrices[node_index] = parent_matrix * get_node_matrix(model.nodes[node_index]);
+		static_nodes[node_index]   = !node_moving;
+
+		for (auto child_index : model.nodes[node_index].children)
+		{
+			traverse_nodes.push(std::make_tuple(child_index, world_matrices[node_index], node_moving));
+		}
+	}
+
+	return static_nodes;
+}
+
+/**
+ * @return Whether a primitive can be transformed into a static batch
+ */
+inline bool can_batch(const PrimitiveData &primitive)
+{
+	auto &submesh = *primitive.submesh;
+
+	// Blended sub meshes are sorted by the distance of their node
+	if (!primitive.triangle_list || !primitive.gltf_primitive->targets.empty() ||
+	    (submesh.get_material() && submesh.get_material()->alpha_mode == sg::AlphaMode::Blend))
+	{
+		return false;
+	}
+
+	static const std::map<std::string, VkFormat> transformed_formats = {{"position", VK_FORMAT_R32G32B32_SFLOAT},
+	                                                                    {"normal", VK_FORMAT_R32G32B32_SFLOAT},
+	                                                                    {"tangent", VK_FORMAT_R32G32B32A32_SFLOAT}};
+
+	sg::VertexAttribute attribute;
+
+	if (!submesh.get_attribute("position", attribute) || submesh.get_attribute("joints_0", attribute))
+	{
+		return false;
+	}
+
+	for (auto &vertex_data : primitive.vertex_data)
+	{
+		submesh.get_attribute(vertex_data.first, attribute);
+
+		auto format_it = transformed_formats.find(vertex_data.first);
+
+		if ((format_it != transformed_formats.end() && format_it->second != attribute.format) ||
+		    vertex_data.second.size() < static_cast<size_t>(submesh.vertices_count) * attribute.stride)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief A sub mesh of a static node to transform into a batch
+ */
+struct BatchedPrimitive
+{
+	size_t primitive_index;
+
+	glm::mat4 world_matrix;
+};
+
+/**
+ * @brief Transforms primitives sharing a material and vertex layout into world space, and appends them in a single primitive
+ */
+inline void merge_static_primitives(const std::vector<PrimitiveData> &primitives, const std::vector<BatchedPrimitive> &batch, PrimitiveData &merged)
+{
+	auto &first   = primitives[batch.front().primitive_index];
+	auto &submesh = *merged.submesh;
+
+	uint32_t vertex_count = 0;
+	uint32_t index_count  = 0;
+
+	for (auto &batched : batch)
+	{
+		auto &source = *primitives[batched.primitive_index].submesh;
+
+		vertex_count += source.vertices_count;
+		index_count += primitives[batched.primitive_index].index_data.empty() ? source.vertices_count : source.vertex_indices;
+	}
+
+	submesh.index_type     = vertex_count > std::numeric_limits<uint16_t>::max() ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+	submesh.vertices_count = vertex_count;
+	submesh.vertex_indices = index_count;
+	submesh.set_material(*first.submesh->get_material());
+
+	for (auto &vertex_data : first.vertex_data)
+	{
+		sg::VertexAttribute attribute;
+		first.submesh->get_attribute(vertex_data.first, attribute);
+
+		submesh.set_attribute(vertex_data.first, attribute);
+
+		merged.vertex_data[vertex_data.first].reserve(static_cast<size_t>(vertex_count) * attribute.stride);
+		merged.vertex_strides[vertex_data.first] = attribute.stride;
+	}
+
+	merged.index_data.resize(static_cast<size_t>(index_count) * (submesh.index_type == VK_INDEX_TYPE_UINT32 ? 4 : 2));
+	merged.triangle_list = true;
+
+	uint32_t base_vertex = 0;
+	uint32_t base_index  = 0;
+
+	for (auto &batched : batch)
+	{
+		auto &primitive = primitives[batched.primitive_index];
+		auto &source    = *primitive.submesh;
+
+		auto linear_matrix = glm::mat3(batched.world_matrix);
+		auto normal_matrix = glm::transpose(glm::inverse(linear_matrix));
+
+		// Mirroring transforms flip the winding of the triangles and the handedness of the tangent frames
+		bool mirrored = glm::determinant(linear_matrix) < 0.0f;
+
+		for (auto &vertex_data : primitive.vertex_data)
+		{
+			auto  stride = merged.vertex_strides.at(vertex_data.first);
+			auto &data   = merged.vertex_data.at(vertex_data.first);
+
+			size_t first_byte = data.size();
+			data.insert(data.end(), vertex_data.second.begin(), vertex_data.second.begin() + static_cast<size_t>(source.vertices_count) * stride);
+
+			for (uint32_t i = 0; i < source.vertices_count; i++)
+			{
+				auto vertex = data.data() + first_byte + static_cast<size_t>(i) * stride;
+
+				if (vertex_data.first == "position" || vertex_data.first == "normal")
+				{
+					glm::vec3 value;
+					std::memcpy(&value, vertex, sizeof(value));
+
+					value = vertex_data.first == "position" ? glm::vec3(batched.world_matrix * glm::vec4(value, 1.0f)) : glm::normalize(normal_matrix * value);
+
+					std::memcpy(vertex, &value, sizeof(value));
+				}
+				else if (vertex_data.first == "tangent")
+				{
+					glm::vec4 value;
+					std::memcpy(&value, vertex, sizeof(value));
+
+					value = glm::vec4(glm::normalize(linear_matrix * glm::vec3(value)), mirrored ? -value.w : value.w);
+
+					std::memcpy(vertex, &value, sizeof(value));
+				}
+			}
+		}
+
+		std::vector<uint32_t> indices;
+
+		if (primitive.index_data.empty())
+		{
+			indices.resize(source.vertices_count);
+			std::iota(indices.begin(), indices.end(), 0);
+		}
+		else
+		{
+			indices = read_indices(primitive);
+		}
+
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			// The last two vertices of each triangle are swapped to keep it front facing
+			size_t source_index = i;
+
+			if (mirrored && i % 3 == 1)
+			{
+				source_index = i + 1;
+			}
+			else if (mirrored && i % 3 == 2)
+			{
+				source_index = i - 1;
+			}
+
+			uint32_t index = base_vertex + indices[source_index];
+
+			if (submesh.index_type == VK_INDEX_TYPE_UINT32)
+			{
+				reinterpret_cast<uint32_t *>(merged.index_data.data())[base_index + i] = index;
+			}
+			else
+			{
+				reinterpret_cast<uint16_t *>(merged.index_data.data())[base_index + i] = static_cast<uint16_t>(index);
+			}
+		}
+
+		base_vertex += source.vertices_count;
+		base_index += to_u32(indices.size());
+	}
+}
+
+/**
+ * @brief Merges the primitives of the static nodes of a scene into batches per material, vertex layout and cell of a grid.
+ *        The batches are appended to the primitives with a mesh of their own, and the primitives of the meshes only
+ *        drawn by batches are removed along with their components
+ * @param cell_size Size of the cells of the grid, or 0 for a single cell
+ * @param first_primitives Index of the first primitive of each mesh, the primitives of a mesh being contiguous
+ * @param meshes The meshes of the model, the batch meshes are appended
+ * @param submeshes The sub meshes of the primitives, in the same order
+ * @param batched_nodes Receives whether the mesh of each node is drawn by the batches
+ * @return Number of batches
+ */
+inline size_t create_static_batches(const tinygltf::Model &model, const tinygltf::Scene &gltf_scene, float cell_size, const std::vector<size_t> &first_primitives,
+                                    std::vector<PrimitiveData> &primitives, std::vector<std::unique_ptr<sg::Mesh>> &meshes,
+                                    std::vector<std::unique_ptr<sg::SubMesh>> &submeshes, std::vector<bool> &batched_nodes)
+{
+	std::vector<glm::mat4> world_matrices;
+
+	auto static_nodes = find_static_nodes(model, gltf_scene, world_matrices);
+
+	auto get_primitive_count = [&](size_t mesh_index) {
+		return model.meshes[mesh_index].primitives.size();
+	};
+
+	// A node is batched as a whole, so all the sub meshes of its mesh must be batchable
+	std::vector<bool> batchable_meshes(model.meshes.size(), true);
+
+	for (size_t mesh_index = 0; mesh_index < model.meshes.size(); mesh_index++)
+	{
+		for (size_t i = 0; i < get_primitive_count(mesh_index); i++)
+		{
+			batchable_meshes[mesh_index] = batchable_meshes[mesh_index] && can_batch(primitives[first_primitives[mesh_index] + i]);
+		}
+	}
+
+	// Batches by material, vertex layout and cell
+	std::map<std::tuple<const sg::Material *, std::string, int, int, int>, std::vector<BatchedPrimitive>> batches;
+
+	batched_nodes.assign(model.nodes.size(), false);
+
+	for (size_t node_index = 0; node_index < model.nodes.size(); node_index++)
+	{
+		int mesh_index = model.nodes[node_index].mesh;
+
+		if (!static_nodes[node_index] || mesh_index < 0 || !batchable_meshes[mesh_index])
+		{
+			continue;
+		}
+
+		batched_nodes[node_index] = true;
+
+		auto &world_matrix = world_matrices[node_index];
+
+		for (size_t i = 0; i < get_primitive_count(mesh_index); i++)
+		{
+			auto  primitive_index = first_primitives[mesh_index] + i;
+			auto &primitive       = primitives[primitive_index];
+
+			std::string layout;
+
+			for (auto &vertex_data : std::map<std::string, std::vector<uint8_t>>(primitive.vertex_data.begin(), primitive.vertex_data.end()))
+			{
+				sg::VertexAttribute attribute;
+				primitive.submesh->get_attribute(vertex_data.first, attribute);
+
+				layout += vertex_data.first + ":" + std::to_string(attribute.format) + ":" + std::to_string(attribute.stride) + ";";
+			}
+
+			glm::ivec3 cell{0};
+
+			if (cell_size > 0.0f)
+			{
+				glm::vec3 min_position{std::numeric_limits<float>::max()};
+				glm::vec3 max_position{std::numeric_limits<float>::lowest()};
+
+				auto &positions = primitive.vertex_data.at("position");
+
+				sg::VertexAttribute attribute;
+				primitive.submesh->get_attribute("position", attribute);
+
+				for (uint32_t vertex = 0; vertex < primitive.submesh->vertices_count; vertex++)
+				{
+					glm::vec3 position;
+					std::memcpy(&position, positions.data() + static_cast<size_t>(vertex) * attribute.stride, sizeof(position));
+
+					min_position = glm::min(min_position, position);
+					max_position = glm::max(max_position, position);
+				}
+
+				// An affine transform keeps the center of a box at the center of the transformed box
+				auto center = glm::vec3(world_matrix * glm::vec4((min_position + max_position) * 0.5f, 1.0f));
+
+				cell = glm::ivec3(glm::floor(center / cell_size));
+			}
+
+			auto key = std::make_tuple(primitive.submesh->get_material(), layout, cell.x, cell.y, cell.z);
+
+			batches[key].push_back({primitive_index, world_matrix});
+		}
+	}
+
+	// Meshes only drawn by the batches are dropped
+	std::vector<bool> used_meshes(model.meshes.size(), false);
+	std::vector<bool> batched_meshes(model.meshes.size(), false);
+
+	for (size_t node_index = 0; node_index < model.nodes.size(); node_index++)
+	{
+		int mesh_index = model.nodes[node_index].mesh;
+
+		if (mesh_index >= 0 && batched_nodes[node_index])
+		{
+			batched_meshes[mesh_index] = true;
+		}
+		else if (mesh_index >= 0)
+		{
+			used_meshes[mesh_index] = true;
+		}
+	}
+
+	primitives.reserve(primitives.size() + batches.size());
+
+	for (auto &batch : batches)
+	{
+		auto mesh    = std::make_unique<sg::Mesh>("static_batch_" + std::to_string(meshes.size() - model.meshes.size()));
+		auto submesh = std::make_unique<sg::SubMesh>();
+
+		PrimitiveData merged{};
+		merged.mesh    = mesh.get();
+		merged.submesh = submesh.get();
+
+		merge_static_primitives(primitives, batch.second, merged);
+
+		primitives.push_back(std::move(merged));
+		submeshes.push_back(std::move(submesh));
+		meshes.push_back(std::move(mesh));
+	}
+
+	std::vector<bool> dropped_primitives(primitives.size(), false);
+
+	for (size_t mesh_index = 0; mesh_index < model.meshes.size(); mesh_index++)
+	{
+		if (!batched_meshes[mesh_index] || used_meshes[mesh_index])
+		{
+			continue;
+		}
+
+		for (size_t i = 0; i < get_primitive_count(mesh_index); i++)
+		{
+			dropped_primitives[first_primitives[mesh_index] + i] = true;
+			submeshes[first_primitives[mesh_index] + i].reset();
+		}
+
+		meshes[mesh_index].reset();
+	}
+
+	size_t kept_count = 0;
+
+	for (size_t i = 0; i < primitives.size(); i++)
+	{
+		if (dropped_primitives[i])
+		{
+			continue;
+		}
+
+		if (kept_count != i)
+		{
+			primitives[kept_count] = std::move(primitives[i]);
+		}
+
+		kept_count++;
+	}
+
+	primitives.erase(primitives.begin() + kept_count, primitives.end());
+
+	return batches.size();
+}
+
+/**
+ * @brief Reads an integer property of an extension object, which tinygltf may have parsed as a real number
+ */
+size_t get_size_property(const tinygltf::Value &object, const std::string &name, size_t default_value = 0)
+{
+	if (!object.Has(name))
+	{
+		return default_value;
+	}
+
+	auto &value = object.Get(name);
+
+	return value.IsInt() ? static_cast<size_t>(value.Get<int>()) : static_cast<size_t>(value.Get<double>());
+}
+
+/**
+ * @return Whether sg::Image::generate_mipmaps can filter the levels of a format, which has 8 bits per channel
+ */
+inline bool can_generate_mipmaps(VkFormat format)
+{
+	switch (format)
+	{
+		case VK_FORMAT_R8_UNORM:
+		case VK_FORMAT_R8_SRGB:
+		case VK_FORMAT_R8G8_UNORM:
+		case VK_FORMAT_R8G8_SRGB:
+		case VK_FORMAT_R8G8B8_UNORM:
+		case VK_FORMAT_R8G8B8_SRGB:
+		case VK_FORMAT_B8G8R8_UNORM:
+		case VK_FORMAT_B8G8R8_SRGB:
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_UNORM:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+			return true;
+		default:
+			return false;
+	}
+}
+}        // namespace
+
+std::unordered_map<std::string, bool> GLTFLoader::supported_extensions = {
+    {KHR_LIGHTS_PUNCTUAL_EXTENSION, false},
+    {EXT_MESHOPT_COMPRESSION_EXTENSION, false}};
+
+GLTFLoader::GLTFLoader(Device &device, JobSystem *job_system) :
+    device{device},
+    job_system{job_system}
+{
+	if (!job_system)
+	{
+		owned_job_system = std::make_unique<JobSystem>();
+		this->job_system = owned_job_system.get();
+	}
+}
+
+GLTFLoader::~GLTFLoader() = default;
+
+void GLTFLoader::set_merge_buffers(bool merge)
+{
+	merge_buffers = merge;
+}
+
+void GLTFLoader::set_vertex_format(const VertexFormat &format)
+{
+	vertex_format = format;
+}
+
+void GLTFLoader::set_optimize_meshes(bool optimize)
+{
+	optimize_meshes = optimize;
+}
+
+void GLTFLoader::set_generate_lods(bool generate)
+{
+	generate_lod_levels = generate;
+}
+
+void GLTFLoader::set_static_batching(bool batch, float cell_size)
+{
+	static_batching        = batch;
+	static_batch_cell_size = cell_size;
+}
+
+void GLTFLoader::set_texture_streaming(bool stream, uint32_t placeholder_size)
+{
+	texture_streaming        = stream;
+	texture_placeholder_size = placeholder_size;
+}
+
+void GLTFLoader::set_scene_cache(bool cache)
+{
+	use_scene_cache = cache;
+}
+
+void GLTFLoader::set_cook_package(bool cook)
+{
+	cook_package = cook;
+}
+
+void GLTFLoader::set_texture_compression(VkFormat format)
+{
+	texture_compression = format;
+}
+
+void GLTFLoader::set_default_components(bool add)
+{
+	add_default_components = add;
+}
+
+void GLTFLoader::set_gpu_astc_decode(bool decode)
+{
+	gpu_astc_decode = decode;
+}
+
+std::unique_ptr<sg::Scene> GLTFLoader::read_scene_from_file(const std::string &file_name, int scene_index)
+{
+	VKB_PROFILE_FUNCTION();
+
+	std::string err;
+	std::string warn;
+
+	tinygltf::TinyGLTF gltf_loader;
+
+	std::string gltf_file = vkb::fs::path::get(vkb::fs::path::Type::Assets) + file_name;
+
+	// External buffers are copied from a mapping of their file, without an intermediate stream buffer
+	tinygltf::FsCallbacks fs_callbacks{};
+	fs_callbacks.FileExists     = &file_exists;
+	fs_callbacks.ExpandFilePath = &tinygltf::ExpandFilePath;
+	fs_callbacks.ReadWholeFile  = &read_mapped_file;
+	fs_callbacks.WriteWholeFile = &tinygltf::WriteWholeFile;
+	gltf_loader.SetFsCallbacks(fs_callbacks);
+
+	bool importResult = false;
+
+	bool cache_hit = false;
+
+	uint64_t cache_key = 0;
+
+	uint64_t package_key = 0;
+
+	std::string cache_filename = "scene_" + std::to_string(std::hash<std::string>{}(file_name)) + ".bin";
+
+	try
+	{
+		// The JSON is parsed straight from the mapping of the file
+		auto gltf_mapping = fs::map_asset(file_name);
+
+		package_key = get_scene_package_key(gltf_mapping.get_data(), gltf_mapping.get_size());
+
+		bool package_hit = !cook_package && texture_compression == VK_FORMAT_UNDEFINED && read_scene_package(get_scene_package_filename(file_name), package_key, model, cached_images);
+
+		if (package_hit)
+		{
+			for (auto &cached : cached_images)
+			{
+				if (!device.is_image_format_supported(cached.format) && !(gpu_astc_decode && sg::is_astc(cached.format)))
+				{
+					LOGW("Device does not support the format {} of the scene package images, loading {}", vkb::to_string(cached.format), file_name);
+
+					model = {};
+					cached_images.clear();
+					package_hit = false;
+					break;
+				}
+			}
+		}
+
+		if (use_scene_cache && !package_hit && !cook_package)
+		{
+			cache_key = get_scene_cache_key(gltf_mapping.get_data(), gltf_mapping.get_size(), device);
+
+			// Images are cached as processed, so compressed images have caches of their own
+			if (texture_compression != VK_FORMAT_UNDEFINED)
+			{
+				cache_key = hash_bytes(&texture_compression, sizeof(texture_compression), cache_key);
+			}
+			if (gpu_astc_decode)
+			{
+				cache_key = hash_bytes(&gpu_astc_decode, sizeof(gpu_astc_decode), cache_key);
+			}
+			cache_hit = read_scene_cache(cache_filename, cache_key, model, cached_images, job_system);
+		}
+
+		if (package_hit)
+		{
+			LOGI("Loaded gltf model {} from its scene package", file_name);
+			importResult = true;
+
+			// Ready to upload, no need to cache it again
+			cache_hit = true;
+		}
+		else if (cache_hit)
+		{
+			LOGI("Loaded gltf model {} from the scene cache", file_name);
+			importResult = true;
+		}
+		else
+		{
+			auto base_dir_pos = gltf_file.find_last_of("/\\");
+			auto base_dir     = base_dir_pos == std::string::npos ? std::string{} : gltf_file.substr(0, base_dir_pos);
+
+			importResult = gltf_loader.LoadASCIIFromString(&model, &err, &warn, reinterpret_cast<const char *>(gltf_mapping.get_data()),
+			                                               to_u32(gltf_mapping.get_size()), base_dir);
+		}
+	}
+	catch (const std::runtime_error &e)
+	{
+		err = e.what();
+	}
+
+	if (!importResult)
+	{
+		LOGE("Failed to load gltf file {}.", gltf_file.c_str());
+
+		return nullptr;
+	}
+
+	if (!err.empty())
+	{
+		LOGE("Error loading gltf model: {}.", err.c_str());
+
+		return nullptr;
+	}
+
+	if (!warn.empty())
+	{
+		LOGI("{}", warn.c_str());
+	}
+
+	model_file = file_name;
+
+	size_t pos = file_name.find_last_of('/');
+
+	model_path = file_name.substr(0, pos);
+
+	if (pos == std::string::npos)
+	{
+		model_path.clear();
+	}
+
+	if ((use_scene_cache && !cache_hit) || cook_package)
+	{
+		images_to_cache.resize(model.images.size());
+	}
+
+	auto scene = std::make_unique<sg::Scene>(load_scene(scene_index));
+
+	if (cook_package)
+	{
+		write_scene_package(get_scene_package_filename(file_name), package_key, model, images_to_cache);
+	}
+	else if (use_scene_cache && !cache_hit)
+	{
+		write_scene_cache(cache_filename, cache_key, model, images_to_cache, job_system);
+	}
+
+	cached_images.clear();
+	images_to_cache.clear();
+
+	return scene;
+}
+
+sg::Scene GLTFLoader::load_scene(int scene_index)
+{
+	VKB_PROFILE_FUNCTION();
+
+	auto scene = sg::Scene();
+
+	scene.set_name("gltf_scene");
+
+	// Check extensions
+	for (auto &used_extension : model.extensionsUsed)
+	{
+		auto it = supported_extensions.find(used_extension);
+
+		// Check if extension isn't supported by the GLTFLoader
+		if (it == supported_extensions.end())
+		{
+			// If extension is required then we shouldn't allow the scene to be loaded
+			if (std::find(model.extensionsRequired.begin(), model.extensionsRequired.end(), used_extension) != model.extensionsRequired.end())
+			{
+				throw std::runtime_error("Cannot load glTF file. Contains a required unsupported extension: " + used_extension);
+			}
+			else
+			{
+				// Otherwise, if extension isn't required (but is in the file) then print a warning to the user
+				LOGW("glTF file contains an unsupported extension, unexpected results may occur: {}", used_extension);
+			}
+		}
+		else
+		{
+			// Extension is supported, so enable it
+			LOGI("glTF file contains extension: {}", used_extension);
+			it->second = true;
+		}
+	}
+
+	// Compressed geometry is decoded before any accessor reads it
+	decode_meshopt_buffer_views();
+
+	// Load lights
+	std::vector<std::unique_ptr<sg::Light>> light_components = parse_khr_lights_punctual();
+
+	scene.set_components(std::move(light_components));
+
+	// Load samplers
+	std::vector<std::unique_ptr<sg::Sampler>>
+	    sampler_components(model.samplers.size());
+
+	for (size_t sampler_index = 0; sampler_index < model.samplers.size(); sampler_index++)
+	{
+		auto sampler                      = parse_sampler(model.samplers.at(sampler_index));
+		sampler_components[sampler_index] = std::move(sampler);
+	}
+
+	scene.set_components(std::move(sampler_components));
+
+	Timer timer;
+	timer.start();
+
+	// Load images
+	auto thread_count = job_system->get_thread_count();
+
+	auto image_count = to_u32(model.images.size());
+
+	DecodedImageQueue decoded_images;
+
+	std::vector<std::future<void>> image_component_futures;
+	for (size_t image_index = 0; image_index < image_count; image_index++)
+	{
+		auto fut = job_system->async(
+		    [this, image_index, &decoded_images](size_t) {
+			    VKB_PROFILE_SCOPE("GLTFLoader::load_image");
+
+			    std::unique_ptr<sg::Image> image;
+
+			    // The upload loop rethrows the exception from the future
+			    try
+			    {
+				    if (!cached_images.empty())
+				    {
+					    // Processed on a previous run, only the Vulkan image is left to create
+					    auto &cached = cached_images.at(image_index);
+					    image        = std::make_unique<sg::TranscodedImage>(cached.name, std::move(cached.data), std::move(cached.mipmaps), cached.format);
+					    create_image_resources(*image, cached.mip_levels);
+				    }
+				    else if (cook_package)
+				    {
+					    // The package keeps the image as stored in its file, with all its levels
+					    auto file_image = read_image(model.images.at(image_index));
+
+					    if (file_image->get_mipmaps().size() == 1 && can_generate_mipmaps(file_image->get_format()))
+					    {
+						    file_image->generate_mipmaps(job_system);
+					    }
+
+					    auto &to_cache   = images_to_cache.at(image_index);
+					    to_cache.name    = file_image->get_name();
+					    to_cache.format  = file_image->get_format();
+					    to_cache.mipmaps = file_image->get_mipmaps();
+					    to_cache.data    = file_image->get_data();
+
+					    image = process_image(std::move(file_image));
+				    }
+				    else
+				    {
+					    image = parse_image(model.images.at(image_index));
+
+					    if (!images_to_cache.empty())
+					    {
+						    auto  base_level = image->get_vk_base_level();
+						    auto &to_cache   = images_to_cache.at(image_index);
+						    to_cache.name    = image->get_name();
+						    to_cache.format  = image->get_format();
+						    to_cache.mipmaps = image->get_mipmaps();
+						    to_cache.data    = image->get_data();
+
+						    // Streamed images only have a mip chain from their data
+						    to_cache.mip_levels = base_level == 0 ? image->get_vk_image().get_subresource().mipLevel : 0;
+					    }
+				    }
+			    }
+			    catch (...)
+			    {
+				    decoded_images.push(image_index, nullptr);
+				    throw;
+			    }
+
+			    LOGI("Loaded gltf image #{} ({})", image_index, model.images.at(image_index).uri.c_str());
+
+			    decoded_images.push(image_index, std::move(image));
+		    });
+
+		image_component_futures.push_back(std::move(fut));
+	}
+
+	// Upload images to GPU as they are decoded, through bounded staging memory. The transfers
+	// run while the rest of the scene loads, and the images are acquired with the mesh uploads
+	TransferManager transfer_manager{device};
+
+	StagingRing staging_ring{device, transfer_manager, staging_ring_size};
+
+	AstcDecoder astc_decoder{device};
+
+	std::vector<std::unique_ptr<sg::Image>> image_components(image_count);
+
+	for (uint32_t i = 0; i < image_count; i++)
+	{
+		size_t                     image_index{0};
+		std::unique_ptr<sg::Image> image;
+
+		// Start the copies staged so far rather than leave the transfer queue idle during decoding
+		if (!decoded_images.try_pop(image_index, image))
+		{
+			staging_ring.flush();
+
+			decoded_images.pop(image_index, image);
+		}
+
+		// The other jobs still push to the queue, let them finish before the exception unwinds it
+		if (!image)
+		{
+			for (auto &fut : image_component_futures)
+			{
+				fut.wait();
+			}
+
+			image_component_futures.at(image_index).get();
+		}
+
+		// ASTC blocks to decode on the GPU are uploaded by the decoder, and decoded on the graphics queue
+		if (image->get_vk_image().get_format() != image->get_format())
+		{
+			astc_decoder.add(*image);
+			image->clear_data();
+		}
+		else
+		{
+			const core::Buffer *staging_buffer{nullptr};
+			VkDeviceSize        staging_offset{0};
+
+			staging_ring.stage(image->get_data(), staging_buffer, staging_offset);
+
+			upload_image_to_gpu(transfer_manager, *staging_buffer, staging_offset, *image);
+		}
+
+		image_components[image_index] = std::move(image);
+	}
+
+	uint64_t image_upload_value = staging_ring.submit();
+
+	scene.set_components(std::move(image_components));
+
+	auto elapsed_time = timer.stop();
+
+	LOGI("Time spent loading images: {} seconds across {} threads.", vkb::to_string(elapsed_time), thread_count);
+
+	// Load textures
+	auto images          = scene.get_components<sg::Image>();
+	auto samplers        = scene.get_components<sg::Sampler>();
+	auto default_sampler = create_default_sampler();
+
+	for (auto &gltf_texture : model.textures)
+	{
+		auto texture = parse_texture(gltf_texture);
+
+		texture->set_image(*images.at(gltf_texture.source));
+
+		if (gltf_texture.sampler >= 0 && gltf_texture.sampler < static_cast<int>(samplers.size()))
+		{
+			texture->set_sampler(*samplers.at(gltf_texture.sampler));
+		}
+		else
+		{
+			if (gltf_texture.name.empty())
+			{
+				gltf_texture.name = images.at(gltf_texture.source)->get_name();
+			}
+
+			LOGW("Sampler not found for texture {}, possible GLTF error", gltf_texture.name);
+			texture->set_sampler(*default_sampler);
+		}
+
+		scene.add_component(std::move(texture));
+	}
+
+	scene.add_component(std::move(default_sampler));
+
+	// Load materials in parallel, they only read the glTF model and the textures
+	auto textures = scene.get_components<sg::Texture>();
+
+	std::vector<std::future<std::unique_ptr<sg::PBRMaterial>>> material_futures;
+
+	for (size_t material_index = 0; material_index < model.materials.size(); material_index++)
+	{
+		auto fut = job_system->async(
+		    [this, material_index, &textures](size_t) {
+			    VKB_PROFILE_SCOPE("GLTFLoader::load_material");
+
+			    auto &gltf_material = model.materials.at(material_index);
+
+			    auto material = parse_material(gltf_material);
+
+			    for (auto &gltf_value : gltf_material.values)
+			    {
+				    if (gltf_value.first.find("Texture") != std::string::npos)
+				    {
+					    std::string tex_name = to_snake_case(gltf_value.first);
+
+					    material->textures[tex_name] = textures.at(gltf_value.second.TextureIndex());
+				    }
+			    }
+
+			    for (auto &gltf_value : gltf_material.additionalValues)
+			    {
+				    if (gltf_value.first.find("Texture") != std::string::npos)
+				    {
+					    std::string tex_name = to_snake_case(gltf_value.first);
+
+					    material->textures[tex_name] = textures.at(gltf_value.second.TextureIndex());
+				    }
+			    }
+
+			    return material;
+		    });
+
+		material_futures.push_back(std::move(fut));
+	}
+
+	for (auto &fut : material_futures)
+	{
+		scene.add_component(fut.get());
+	}
+
+	auto default_material = create_default_material();
+
+	// Load meshes
+	auto materials = scene.get_components<sg::PBRMaterial>();
+
+	auto &queue = device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+
+	// The loader owns its pools, so that scenes can be loaded while another thread renders
+	CommandPool command_pool{device, queue.get_family_index()};
+
+	FencePool fence_pool{device};
+
+	auto &command_buffer = command_pool.request_command_buffer();
+
+	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	timer.start();
+
+	std::vector<PrimitiveData> primitives;
+
+	// Added to the scene once the static batches are known, as these replace some of them
+	std::vector<std::unique_ptr<sg::Mesh>> mesh_components;
+
+	std::vector<std::unique_ptr<sg::SubMesh>> submesh_components;
+
+	std::vector<size_t> first_primitives;
+
+	for (auto &gltf_mesh : model.meshes)
+	{
+		auto mesh = parse_mesh(gltf_mesh);
+
+		first_primitives.push_back(primitives.size());
+
+		for (auto &gltf_primitive : gltf_mesh.primitives)
+		{
+			auto submesh = std::make_unique<sg::SubMesh>();
+
+			PrimitiveData primitive{};
+			primitive.mesh           = mesh.get();
+			primitive.submesh        = submesh.get();
+			primitive.gltf_primitive = &gltf_primitive;
+
+			primitives.push_back(std::move(primitive));
+
+			submesh_components.push_back(std::move(submesh));
+		}
+
+		mesh_components.push_back(std::move(mesh));
+	}
+
+	// Decode, optimize and convert the vertex data of the primitives in parallel,
+	// only the creation of the Vulkan buffers is left to this thread
+	std::unique_ptr<MeshOptimizerCache> optimizer_cache;
+
+	if (optimize_meshes)
+	{
+		optimizer_cache = std::make_unique<MeshOptimizerCache>("mesh_optimizer_" + std::to_string(std::hash<std::string>{}(model_file)) + ".bin");
+	}
+
+	auto parse_primitive = [this, &materials, &default_material](PrimitiveData &primitive) {
+		VKB_PROFILE_SCOPE("GLTFLoader::parse_primitive");
+
+		auto &gltf_primitive = *primitive.gltf_primitive;
+		auto &submesh        = *primitive.submesh;
+
+		for (auto &attribute : gltf_primitive.attributes)
+		{
+			std::string attrib_name = attribute.first;
+			std::transform(attrib_name.begin(), attrib_name.end(), attrib_name.begin(), ::tolower);
+
+			if (attrib_name == "position")
+			{
+				submesh.vertices_count = to_u32(model.accessors.at(attribute.second).count);
+			}
+
+			primitive.vertex_data[attrib_name] = get_attribute_data(&model, attribute.second);
+
+			sg::VertexAttribute attrib;
+			attrib.format = get_attribute_format(&model, attribute.second);
+			attrib.stride = to_u32(get_attribute_stride(&model, attribute.second));
+
+			submesh.set_attribute(attrib_name, attrib);
+
+			primitive.vertex_strides[attrib_name] = attrib.stride;
+		}
+
+		primitive.triangle_list = gltf_primitive.mode == TINYGLTF_MODE_TRIANGLES;
+
+		if (gltf_primitive.indices >= 0)
+		{
+			submesh.vertex_indices = to_u32(get_attribute_size(&model, gltf_primitive.indices));
+
+			auto format = get_attribute_format(&model, gltf_primitive.indices);
+
+			auto index_data = get_attribute_data(&model, gltf_primitive.indices);
+
+			switch (format)
+			{
+				case VK_FORMAT_R8_UINT:
+					// Converts uint8 data into uint16 data, still represented by a uint8 vector
+					index_data         = convert_underlying_data_stride(index_data, 1, 2);
+					submesh.index_type = VK_INDEX_TYPE_UINT16;
+					break;
+				case VK_FORMAT_R16_UINT:
+					submesh.index_type = VK_INDEX_TYPE_UINT16;
+					break;
+				case VK_FORMAT_R32_UINT:
+					submesh.index_type = VK_INDEX_TYPE_UINT32;
+					break;
+				default:
+					LOGE("gltf primitive has invalid format type");
+					break;
+			}
+
+			primitive.index_data = std::move(index_data);
+		}
+		else
+		{
+			submesh.vertices_count = to_u32(get_attribute_size(&model, gltf_primitive.attributes.at("POSITION")));
+		}
+
+		if (gltf_primitive.material < 0)
+		{
+			submesh.set_material(*default_material);
+		}
+		else
+		{
+			submesh.set_material(*materials.at(gltf_primitive.material));
+		}
+	};
+
+	auto finish_primitive = [this](PrimitiveData &primitive) {
+		// Positions are simplified before they are converted to another format
+		if (generate_lod_levels)
+		{
+			generate_lods(primitive);
+		}
+
+		convert_vertex_format(primitive, vertex_format);
+	};
+
+	std::vector<std::future<bool>> primitive_futures;
+
+	for (auto &primitive : primitives)
+	{
+		auto fut = job_system->async(
+		    [this, &primitive, &parse_primitive, &finish_primitive, &optimizer_cache](size_t) {
+			    parse_primitive(primitive);
+
+			    bool optimized = optimizer_cache && optimize_primitive(primitive, *optimizer_cache);
+
+			    // Static batches are merged from the float vertices, then simplified and converted
+			    if (!static_batching)
+			    {
+				    finish_primitive(primitive);
+			    }
+
+			    return optimized;
+		    });
+
+		primitive_futures.push_back(std::move(fut));
+	}
+
+	size_t optimized_count = 0;
+
+	for (auto &fut : primitive_futures)
+	{
+		optimized_count += fut.get() ? 1 : 0;
+	}
+
+	if (optimizer_cache)
+	{
+		optimizer_cache->save();
+	}
+
+	// Whether the mesh of each node is drawn by the static batches rather than by the node
+	std::vector<bool> batched_nodes(model.nodes.size(), false);
+
+	if (static_batching)
+	{
+		auto gltf_scene = find_gltf_scene(model, scene_index);
+
+		if (gltf_scene)
+		{
+			auto primitive_count = primitives.size();
+
+			auto batch_count = create_static_batches(model, *gltf_scene, static_batch_cell_size, first_primitives,
+			                                         primitives, mesh_components, submesh_components, batched_nodes);
+
+			LOGI("Merged the sub meshes of {} static nodes into {} batches, {} of {} sub meshes left",
+			     std::count(batched_nodes.begin(), batched_nodes.end(), true), batch_count, primitives.size(), primitive_count);
+		}
+
+		std::vector<std::future<void>> finish_futures;
+
+		for (auto &primitive : primitives)
+		{
+			finish_futures.push_back(job_system->async([&primitive, &finish_primitive](size_t) { finish_primitive(primitive); }));
+		}
+
+		for (auto &fut : finish_futures)
+		{
+			fut.get();
+		}
+	}
+
+	// Meshes of the file by index, null if only drawn by the static batches, followed by the batches
+	std::vector<sg::Mesh *> meshes;
+
+	for (auto &submesh : submesh_components)
+	{
+		if (submesh)
+		{
+			scene.add_component(std::move(submesh));
+		}
+	}
+
+	for (auto &mesh : mesh_components)
+	{
+		meshes.push_back(mesh.get());
+
+		if (mesh)
+		{
+			scene.add_component(std::move(mesh));
+		}
+	}
+
+	elapsed_time = timer.stop();
+
+	LOGI("Time spent processing meshes: {} seconds across {} threads, {} of {} sub meshes optimized.",
+	     vkb::to_string(elapsed_time), thread_count, optimized_count, primitives.size());
+
+	if (merge_buffers)
+	{
+		if (auto geometry_buffers = create_geometry_buffers(device, primitives))
+		{
+			scene.add_component(std::move(geometry_buffers));
+		}
+	}
+
+	for (auto &primitive : primitives)
+	{
+		// Sub meshes which were not merged own their buffers
+		if (!primitive.merged)
+		{
+			create_submesh_buffers(device, primitive);
+		}
+
+		// The bounds are computed from the vertex data, which must be uploaded first
+		primitive.mesh->add_submesh(*primitive.submesh);
+	}
+
+	primitives.clear();
+
+	// Ownership of the images goes to the graphics queue once their transfers are done
+	transfer_manager.wait(image_upload_value);
+	transfer_manager.acquire(command_buffer);
+
+	astc_decoder.decode(command_buffer);
+
+	for (auto image : images)
+	{
+		if (image->get_gpu_mip_level_count() > 0)
+		{
+			image->generate_gpu_mipmaps(command_buffer);
+		}
+	}
+
+	command_buffer.end();
+
+	queue.submit(command_buffer, fence_pool.request_fence());
+
+	fence_pool.wait();
+	fence_pool.reset();
+	command_pool.reset_pool();
+
+	scene.add_component(std::move(default_material));
 
 	// Load cameras
 	for (auto &gltf_camera : model.cameras)
@@ -679,15 +2470,15 @@ sg::Scene GLTFLoader::load_scene(int scene_index)
 	}
 
 	// Load nodes
-	auto meshes = scene.get_components<sg::Mesh>();
-
 	std::vector<std::unique_ptr<sg::Node>> nodes;
 
-	for (auto &gltf_node : model.nodes)
+	for (size_t node_index = 0; node_index < model.nodes.size(); ++node_index)
 	{
+		auto &gltf_node = model.nodes[node_index];
+
 		auto node = parse_node(gltf_node);
 
-		if (gltf_node.mesh >= 0)
+		if (gltf_node.mesh >= 0 && !batched_nodes[node_index])
 		{
 			auto mesh = meshes.at(gltf_node.mesh);
 
@@ -719,24 +2510,37 @@ sg::Scene GLTFLoader::load_scene(int scene_index)
 		nodes.push_back(std::move(node));
 	}
 
-	// Load scenes
-	std::queue<std::pair<sg::Node &, int>> traverse_nodes;
+	// Load skins, which reference any node as a joint
+	for (size_t node_index = 0; node_index < model.nodes.size(); ++node_index)
+	{
+		auto &gltf_node = model.nodes[node_index];
 
-	tinygltf::Scene *gltf_scene{nullptr};
+		if (gltf_node.skin < 0 || gltf_node.mesh < 0)
+		{
+			continue;
+		}
 
-	if (scene_index >= 0 && scene_index < static_cast<int>(model.scenes.size()))
-	{
-		gltf_scene = &model.scenes[scene_index];
-	}
-	else if (model.defaultScene >= 0 && model.defaultScene < static_cast<int>(model.scenes.size()))
-	{
-		gltf_scene = &model.scenes[model.defaultScene];
-	}
-	else if (model.scenes.size() > 0)
-	{
-		gltf_scene = &model.scenes[0];
+		auto skin = parse_skin(model.skins.at(gltf_node.skin), nodes);
+
+		// Only the sub meshes with joints and weights are skinned, the others keep the transform of the node
+		for (auto sub_mesh : meshes.at(gltf_node.mesh)->get_submeshes())
+		{
+			sg::VertexAttribute attribute;
+
+			if (sub_mesh->get_attribute("joints_0", attribute) && sub_mesh->get_attribute("weights_0", attribute))
+			{
+				sub_mesh->get_mut_shader_variant().add_define("SKINNING");
+			}
+		}
+
+		scene.add_component(std::move(skin), *nodes[node_index]);
 	}
 
+	// Load scenes
+	std::queue<std::pair<sg::Node &, int>> traverse_nodes;
+
+	auto gltf_scene = find_gltf_scene(model, scene_index);
+
 	if (!gltf_scene)
 	{
 		throw std::runtime_error("Couldn't determine which scene to load!");
@@ -766,12 +2570,37 @@ sg::Scene GLTFLoader::load_scene(int scene_index)
 		}
 	}
 
+	// Static batches are in world space, below the root
+	for (size_t mesh_index = model.meshes.size(); mesh_index < meshes.size(); mesh_index++)
+	{
+		auto batch_node = std::make_unique<sg::Node>(meshes[mesh_index]->get_name());
+
+		batch_node->set_component(*meshes[mesh_index]);
+		meshes[mesh_index]->add_node(*batch_node);
+
+		batch_node->set_parent(*root_node);
+		root_node->add_child(*batch_node);
+
+		nodes.push_back(std::move(batch_node));
+	}
+
+	// Load animations, played by scripts of the root node
+	for (auto &gltf_animation : model.animations)
+	{
+		scene.add_component(parse_animation(gltf_animation, *root_node, nodes));
+	}
+
 	scene.set_root_node(*root_node);
 	nodes.push_back(std::move(root_node));
 
 	// Store nodes into the scene
 	scene.set_nodes(std::move(nodes));
 
+	if (!add_default_components)
+	{
+		return scene;
+	}
+
 	// Create node for the default camera
 	auto camera_node = std::make_unique<sg::Node>("default_camera");
 
@@ -837,6 +2666,121 @@ std::unique_ptr<sg::Node> GLTFLoader::parse_node(const tinygltf::Node &gltf_node
 	return node;
 }
 
+std::unique_ptr<sg::Skin> GLTFLoader::parse_skin(const tinygltf::Skin &gltf_skin, const std::vector<std::unique_ptr<sg::Node>> &nodes) const
+{
+	auto skin = std::make_unique<sg::Skin>(gltf_skin.name);
+
+	std::vector<uint8_t> inverse_bind_data;
+
+	if (gltf_skin.inverseBindMatrices >= 0)
+	{
+		inverse_bind_data = get_attribute_data(&model, gltf_skin.inverseBindMatrices);
+	}
+
+	for (size_t i = 0; i < gltf_skin.joints.size(); ++i)
+	{
+		// Joints without an inverse bind matrix are bound at the origin
+		glm::mat4 inverse_bind_matrix{1.0f};
+
+		if ((i + 1) * sizeof(glm::mat4) <= inverse_bind_data.size())
+		{
+			std::memcpy(glm::value_ptr(inverse_bind_matrix), inverse_bind_data.data() + i * sizeof(glm::mat4), sizeof(glm::mat4));
+		}
+
+		skin->add_joint(*nodes.at(gltf_skin.joints[i]), inverse_bind_matrix);
+	}
+
+	return skin;
+}
+
+std::unique_ptr<sg::Animation> GLTFLoader::parse_animation(const tinygltf::Animation &gltf_animation, sg::Node &script_node,
+                                                           const std::vector<std::unique_ptr<sg::Node>> &nodes) const
+{
+	auto animation = std::make_unique<sg::Animation>(script_node, gltf_animation.name);
+
+	// Index of the scene graph sampler of each glTF sampler, added once a channel uses it
+	std::vector<int> sampler_indices(gltf_animation.samplers.size(), -1);
+
+	for (auto &gltf_channel : gltf_animation.channels)
+	{
+		sg::AnimationChannel channel;
+
+		if (gltf_channel.target_path == "translation")
+		{
+			channel.path = sg::AnimationPath::Translation;
+		}
+		else if (gltf_channel.target_path == "rotation")
+		{
+			channel.path = sg::AnimationPath::Rotation;
+		}
+		else if (gltf_channel.target_path == "scale")
+		{
+			channel.path = sg::AnimationPath::Scale;
+		}
+		else
+		{
+			LOGW("Animation {} has an unsupported {} channel", gltf_animation.name, gltf_channel.target_path);
+			continue;
+		}
+
+		if (gltf_channel.target_node < 0)
+		{
+			continue;
+		}
+
+		auto &sampler_index = sampler_indices.at(gltf_channel.sampler);
+
+		if (sampler_index < 0)
+		{
+			auto &gltf_sampler  = gltf_animation.samplers[gltf_channel.sampler];
+			auto &input_access  = model.accessors.at(gltf_sampler.input);
+			auto &output_access = model.accessors.at(gltf_sampler.output);
+
+			if (input_access.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || output_access.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT)
+			{
+				LOGW("Animation {} has keyframes which are not floats", gltf_animation.name);
+				continue;
+			}
+
+			sg::AnimationSampler sampler;
+
+			if (gltf_sampler.interpolation == "STEP")
+			{
+				sampler.interpolation = sg::AnimationInterpolation::Step;
+			}
+			else if (gltf_sampler.interpolation == "CUBICSPLINE")
+			{
+				sampler.interpolation = sg::AnimationInterpolation::CubicSpline;
+			}
+
+			auto input_data = get_attribute_data(&model, gltf_sampler.input);
+
+			sampler.times.resize(input_access.count);
+			std::memcpy(sampler.times.data(), input_data.data(), sampler.times.size() * sizeof(float));
+
+			// Values are widened to four components, so that all the paths share a sampler type
+			auto   output_data     = get_attribute_data(&model, gltf_sampler.output);
+			size_t component_count = output_access.type == TINYGLTF_TYPE_VEC4 ? 4 : 3;
+
+			sampler.values.resize(output_access.count, glm::vec4{0.0f});
+
+			for (size_t i = 0; i < sampler.values.size(); ++i)
+			{
+				std::memcpy(glm::value_ptr(sampler.values[i]), output_data.data() + i * component_count * sizeof(float), component_count * sizeof(float));
+			}
+
+			sampler_index = static_cast<int>(animation->add_sampler(std::move(sampler)));
+		}
+
+		channel.node    = nodes.at(gltf_channel.target_node).get();
+		channel.sampler = static_cast<uint32_t>(sampler_index);
+
+		animation->add_channel(channel);
+	}
+
+	return animation;
+}
+
 std::unique_ptr<sg::Camera> GLTFLoader::parse_camera(const tinygltf::Camera &gltf_camera) const
 {
 	std::unique_ptr<sg::Camera> camera;
@@ -923,6 +2867,11 @@ std::unique_ptr<sg::PBRMaterial> GLTFLoader::parse_material(const tinygltf::Mate
 }
 
 std::unique_ptr<sg::Image> GLTFLoader::parse_image(tinygltf::Image &gltf_image) const
+{
+	return process_image(read_image(gltf_image));
+}
+
+std::unique_ptr<sg::Image> GLTFLoader::read_image(tinygltf::Image &gltf_image) const
 {
 	std::unique_ptr<sg::Image> image{nullptr};
 
@@ -945,22 +2894,98 @@ std::unique_ptr<sg::Image> GLTFLoader::parse_image(tinygltf::Image &gltf_image)
 		image          = sg::Image::load(gltf_image.name, image_uri);
 	}
 
+	return image;
+}
+
+std::unique_ptr<sg::Image> GLTFLoader::process_image(std::unique_ptr<sg::Image> &&image) const
+{
+	// Levels of the Vulkan image, 0 for the levels of the image data
+	uint32_t mip_levels = 0;
+
 	// Check whether the format is supported by the GPU
 	if (sg::is_astc(image->get_format()))
 	{
-		if (!device.is_image_format_supported(image->get_format()))
+		if (!device.is_image_format_supported(image->get_format()) && gpu_astc_decode)
+		{
+			LOGW("ASTC not supported: decoding {} on the GPU", image->get_name());
+
+			// Levels missing from the data are blitted from the decoded ones
+			auto decoded_format = AstcDecoder::get_decoded_format(image->get_format());
+
+			if (image->get_mipmaps().size() == 1 && sg::Image::supports_gpu_mipmaps(device, decoded_format))
+			{
+				auto &extent = image->get_extent();
+
+				mip_levels = 1 + static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height))));
+			}
+		}
+		else if (!device.is_image_format_supported(image->get_format()))
+		{
+			auto transcoded = sg::Image::transcode(device, *image, job_system);
+
+			if (transcoded)
+			{
+				LOGW("ASTC not supported: transcoded {} to {}", image->get_name(), vkb::to_string(transcoded->get_format()));
+				image = std::move(transcoded);
+			}
+			else
+			{
+				LOGW("ASTC not supported: decoding {}", image->get_name());
+				image = std::make_unique<sg::Astc>(*image, job_system);
+
+				// The mip chain is blitted on the GPU after the first level is uploaded if the format allows it
+				if (sg::Image::supports_gpu_mipmaps(device, image->get_format()))
+				{
+					auto &extent = image->get_extent();
+
+					mip_levels = 1 + static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height))));
+				}
+				else
+				{
+					image->generate_mipmaps(job_system);
+				}
+			}
+		}
+	}
+	else if (texture_compression != VK_FORMAT_UNDEFINED && image->get_format() == VK_FORMAT_R8G8B8A8_UNORM)
+	{
+		auto compressed = sg::Image::transcode(device, *image, texture_compression, job_system);
+
+		if (compressed)
+		{
+			image = std::move(compressed);
+		}
+		else
 		{
-			LOGW("ASTC not supported: decoding {}", image->get_name());
-			image = std::make_unique<sg::Astc>(*image);
-			image->generate_mipmaps();
+			LOGW("Cannot compress {} to {}, keeping it uncompressed", image->get_name(), vkb::to_string(texture_compression));
 		}
 	}
 
-	image->create_vk_image(device);
+	create_image_resources(*image, mip_levels);
 
 	return image;
 }
 
+void GLTFLoader::create_image_resources(sg::Image &image, uint32_t mip_levels) const
+{
+	auto tail_level = TextureStreamer::get_tail_level(image, texture_placeholder_size);
+
+	// Decoded on the GPU as a whole, the texture streamer uploads levels in their data format
+	if (gpu_astc_decode && sg::is_astc(image.get_format()) && !device.is_image_format_supported(image.get_format()))
+	{
+		image.create_vk_image(device, mip_levels, AstcDecoder::get_decoded_format(image.get_format()));
+	}
+	else if (texture_streaming && tail_level > 0)
+	{
+		std::unique_ptr<core::Image> retired_image;
+		image.create_streamed_vk_image(device, tail_level, retired_image);
+	}
+	else
+	{
+		image.create_vk_image(device, mip_levels);
+	}
+}
+
 std::unique_ptr<sg::Sampler> GLTFLoader::parse_sampler(const tinygltf::Sampler &gltf_sampler) const
 {
 	auto name = gltf_sampler.name;
@@ -985,9 +3010,9 @@ std::unique_ptr<sg::Sampler> GLTFLoader::parse_sampler(const tinygltf::Sampler &
 	sampler_info.borderColor  = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
 	sampler_info.maxLod       = std::numeric_limits<float>::max();
 
-	core::Sampler vk_sampler{device, sampler_info};
+	auto &vk_sampler = device.get_resource_cache().request_sampler(sampler_info);
 
-	return std::make_unique<sg::Sampler>(name, std::move(vk_sampler));
+	return std::make_unique<sg::Sampler>(name, vk_sampler);
 }
 
 std::unique_ptr<sg::Texture> GLTFLoader::parse_texture(const tinygltf::Texture &gltf_texture) const
@@ -1030,6 +3055,161 @@ std::unique_ptr<sg::Camera> GLTFLoader::create_default_camera()
 	return parse_camera(gltf_camera);
 }
 
+void GLTFLoader::decode_meshopt_buffer_views()
+{
+	if (!is_extension_enabled(EXT_MESHOPT_COMPRESSION_EXTENSION))
+	{
+		return;
+	}
+
+	VKB_PROFILE_FUNCTION();
+
+	struct CompressedView
+	{
+		size_t view_index;
+
+		size_t source_buffer;
+
+		size_t source_offset;
+
+		size_t source_size;
+
+		size_t count;
+
+		size_t stride;
+
+		MeshoptMode mode;
+
+		MeshoptFilter filter;
+	};
+
+	std::vector<CompressedView> compressed_views;
+
+	// Buffers holding compressed data, released once decoded unless a buffer view reads them directly
+	std::vector<bool> source_buffers(model.buffers.size(), false);
+
+	for (size_t view_index = 0; view_index < model.bufferViews.size(); view_index++)
+	{
+		auto &buffer_view = model.bufferViews[view_index];
+
+		auto extension = get_extension(buffer_view.extensions, EXT_MESHOPT_COMPRESSION_EXTENSION);
+
+		if (!extension)
+		{
+			continue;
+		}
+
+		CompressedView view{};
+		view.view_index    = view_index;
+		view.source_buffer = get_size_property(*extension, "buffer");
+		view.source_offset = get_size_property(*extension, "byteOffset");
+		view.source_size   = get_size_property(*extension, "byteLength");
+		view.count         = get_size_property(*extension, "count");
+		view.stride        = get_size_property(*extension, "byteStride");
+
+		auto mode = extension->Get("mode").Get<std::string>();
+
+		if (mode == "ATTRIBUTES")
+		{
+			view.mode = MeshoptMode::Attributes;
+		}
+		else if (mode == "TRIANGLES")
+		{
+			view.mode = MeshoptMode::Triangles;
+		}
+		else if (mode == "INDICES")
+		{
+			view.mode = MeshoptMode::Indices;
+		}
+		else
+		{
+			throw std::runtime_error("Couldn't load glTF file, EXT_meshopt_compression mode '" + mode + "' is invalid");
+		}
+
+		auto filter = extension->Has("filter") ? extension->Get("filter").Get<std::string>() : "NONE";
+
+		if (filter == "NONE")
+		{
+			view.filter = MeshoptFilter::None;
+		}
+		else if (filter == "OCTAHEDRAL")
+		{
+			view.filter = MeshoptFilter::Octahedral;
+		}
+		else if (filter == "QUATERNION")
+		{
+			view.filter = MeshoptFilter::Quaternion;
+		}
+		else if (filter == "EXPONENTIAL")
+		{
+			view.filter = MeshoptFilter::Exponential;
+		}
+		else
+		{
+			throw std::runtime_error("Couldn't load glTF file, EXT_meshopt_compression filter '" + filter + "' is invalid");
+		}
+
+		if (view.source_buffer >= model.buffers.size() ||
+		    view.source_offset + view.source_size > model.buffers[view.source_buffer].data.size() ||
+		    view.count * view.stride > buffer_view.byteLength)
+		{
+			throw std::runtime_error("Couldn't load glTF file, EXT_meshopt_compression buffer view is out of bounds");
+		}
+
+		// The fallback buffer receives the decoded data, it is empty if it only exists for the compressed views
+		auto &fallback_data = model.buffers.at(buffer_view.buffer).data;
+
+		fallback_data.resize(std::max(fallback_data.size(), buffer_view.byteOffset + buffer_view.byteLength));
+
+		source_buffers[view.source_buffer] = true;
+
+		compressed_views.push_back(view);
+	}
+
+	Timer timer;
+	timer.start();
+
+	// The views decode to separate ranges, in parallel
+	job_system->parallel_for(to_u32(compressed_views.size()), 1, [this, &compressed_views](uint32_t begin, uint32_t end, size_t) {
+		for (uint32_t i = begin; i < end; i++)
+		{
+			auto &view        = compressed_views[i];
+			auto &buffer_view = model.bufferViews[view.view_index];
+			auto &source      = model.buffers[view.source_buffer].data;
+
+			decode_meshopt(model.buffers[buffer_view.buffer].data.data() + buffer_view.byteOffset, view.count, view.stride,
+			               source.data() + view.source_offset, view.source_size, view.mode, view.filter);
+		}
+	});
+
+	// The decoded views are read as any other, and written uncompressed to the scene cache
+	for (auto &view : compressed_views)
+	{
+		model.bufferViews[view.view_index].extensions.erase(EXT_MESHOPT_COMPRESSION_EXTENSION);
+	}
+
+	for (auto &buffer_view : model.bufferViews)
+	{
+		if (buffer_view.buffer >= 0 && static_cast<size_t>(buffer_view.buffer) < source_buffers.size())
+		{
+			source_buffers[buffer_view.buffer] = false;
+		}
+	}
+
+	for (size_t buffer_index = 0; buffer_index < source_buffers.size(); buffer_index++)
+	{
+		if (source_buffers[buffer_index])
+		{
+			std::vector<unsigned char>().swap(model.buffers[buffer_index].data);
+		}
+	}
+
+	auto elapsed_time = timer.stop();
+
+	LOGI("Time spent decoding compressed geometry: {} seconds across {} threads, {} buffer views.",
+	     vkb::to_string(elapsed_time), job_system->get_thread_count(), compressed_views.size());
+}
+
 std::vector<std::unique_ptr<sg::Light>> GLTFLoader::parse_khr_lights_punctual()
 {
 	if (is_extension_enabled(KHR_LIGHTS_PUNCTUAL_EXTENSION) && model.extensions.at(KHR_LIGHTS_PUNCTUAL_EXTENSION).Has("lights"))
@@ -28,16 +28,21 @@
 #define TINYGLTF_NO_EXTERNAL_IMAGE
 #include <tiny_gltf.h>
 
+#include "scene_cache.h"
+#include "texture_streamer.h"
 #include "timer.h"
 
 #define KHR_LIGHTS_PUNCTUAL_EXTENSION "KHR_lights_punctual"
+#define EXT_MESHOPT_COMPRESSION_EXTENSION "EXT_meshopt_compression"
 
 namespace vkb
 {
+class JobSystem;
 class Device;
 
 namespace sg
 {
+class Animation;
 class Camera;
 class Image;
 class Light;
@@ -46,6 +51,7 @@ class Node;
 class PBRMaterial;
 class Sampler;
 class Scene;
+class Skin;
 class SubMesh;
 class Texture;
 }        // namespace sg
@@ -65,18 +71,119 @@ struct TypeCast
 	}
 };
 
+/**
+ * @brief Layout of the vertex data created by the GLTFLoader, by default it is kept as authored.
+ *        Only float positions, normals and first texture coordinates are converted
+ */
+struct VertexFormat
+{
+	/// Interleave positions, normals and texture coordinates in a single vertex buffer
+	bool interleave{false};
+
+	/// Store normals as octahedral encoded snorm16 pairs
+	bool quantize_normals{false};
+
+	/// Store texture coordinates as unorm16 if they are within [0, 1], as half floats otherwise
+	bool quantize_texcoords{false};
+
+	/// Store positions as half floats, which loses precision on large meshes
+	bool quantize_positions{false};
+};
+
 /// Read a gltf file and return a scene object. Converts the gltf objects
 /// to our internal scene implementation. Mesh data is copied to vulkan buffers and
 /// images are loaded from the folder of gltf file to vulkan images.
 class GLTFLoader
 {
   public:
-	GLTFLoader(Device &device);
+	/**
+	 * @param device The device creating the scene resources
+	 * @param job_system Optional job system running the loading jobs, the loader creates its own if null
+	 */
+	GLTFLoader(Device &device, JobSystem *job_system = nullptr);
 
-	virtual ~GLTFLoader() = default;
+	virtual ~GLTFLoader();
 
 	std::unique_ptr<sg::Scene> read_scene_from_file(const std::string &file_name, int scene_index = -1);
 
+	/**
+	 * @brief Suballocates the geometry of the sub meshes from a few large buffers, one per vertex
+	 *        attribute and one per index type, instead of creating buffers for every sub mesh.
+	 *        Sub meshes whose attribute strides differ from the first ones found keep their own buffers
+	 */
+	void set_merge_buffers(bool merge);
+
+	/**
+	 * @brief Sets the layout of the vertex data, the vertex attribute formats are updated
+	 *        so that pipelines pick it up
+	 */
+	void set_vertex_format(const VertexFormat &format);
+
+	/**
+	 * @brief Reorders the triangles and vertices of indexed triangle lists for the vertex cache,
+	 *        overdraw and vertex fetch. Results are cached in temporary storage per glTF file
+	 */
+	void set_optimize_meshes(bool optimize);
+
+	/**
+	 * @brief Generates simplified levels of detail for indexed triangle lists by vertex clustering,
+	 *        stored as index ranges after the indices of each sub mesh
+	 */
+	void set_generate_lods(bool generate);
+
+	/**
+	 * @brief Pre-transforms the sub meshes of static nodes to world space and merges those sharing a material
+	 *        and a vertex layout into batches, each drawn by a node of its own. Nodes are static unless they are
+	 *        animated, skinned or joints, and are batched if all the sub meshes of their mesh are triangle lists
+	 *        with float positions, normals and tangents, no morph targets and a material which is not blended.
+	 *        Instanced meshes are copied per node, which trades memory for fewer draws
+	 * @param cell_size Size of the cells of a world space grid splitting the batches, so that they keep bounds
+	 *        small enough to be culled. 0 merges each material as a whole, with the fewest draws
+	 */
+	void set_static_batching(bool batch, float cell_size = 0.0f);
+
+	/**
+	 * @brief Uploads only the smallest levels of images with a mip chain and keeps their data,
+	 *        so that a TextureStreamer can stream the larger levels later
+	 * @param placeholder_size Largest extent of the levels uploaded by the loader, which are sampled
+	 *        until the streamer uploads the others. Smaller sizes shorten the load
+	 */
+	void set_texture_streaming(bool stream, uint32_t placeholder_size = TextureStreamer::TAIL_SIZE);
+
+	/**
+	 * @brief Stores the parsed model and the processed images in temporary storage, and loads
+	 *        them instead of parsing the glTF file and decoding the images when the file is unchanged
+	 */
+	void set_scene_cache(bool cache);
+
+	/**
+	 * @brief Writes the package of the glTF file next to it in the assets directory, instead of using the scene cache.
+	 *        The images are kept in the formats of their files, with CPU generated levels for uncompressed ones,
+	 *        so that the package does not depend on the device. The loader reads the package of a file if it is
+	 *        up to date and the device supports its image formats, see vkb_asset_cooker
+	 */
+	void set_cook_package(bool cook);
+
+	/**
+	 * @brief Compresses the RGBA8 images to a block format at load time through the image transcoders,
+	 *        see sg::RgbaTranscoder. Images are kept uncompressed if the device does not support the format.
+	 *        Scene packages are not read meanwhile, as they keep the images of the files
+	 * @param format The UNORM variant of the format, or VK_FORMAT_UNDEFINED to keep the images uncompressed
+	 */
+	void set_texture_compression(VkFormat format);
+
+	/**
+	 * @brief Adds a default camera to the scene, and a directional light if the file has no lights.
+	 *        Enabled by default, disabled for scenes which are parts of a larger one
+	 */
+	void set_default_components(bool add);
+
+	/**
+	 * @brief Decodes the ASTC images with a compute shader if the device does not support ASTC, see AstcDecoder.
+	 *        Otherwise they are transcoded or decoded on the CPU. Scene packages with ASTC images can then be read
+	 */
+	void set_gpu_astc_decode(bool decode);
+
   protected:
 	virtual std::unique_ptr<sg::Node> parse_node(const tinygltf::Node &gltf_node) const;
 
@@ -88,10 +195,36 @@ class GLTFLoader
 
 	virtual std::unique_ptr<sg::Image> parse_image(tinygltf::Image &gltf_image) const;
 
+	/**
+	 * @brief Reads the image of a glTF image from the glTF file or its own file, as stored there
+	 */
+	std::unique_ptr<sg::Image> read_image(tinygltf::Image &gltf_image) const;
+
+	/**
+	 * @brief Converts an image read from a file to a format the device supports, and creates its Vulkan image
+	 */
+	std::unique_ptr<sg::Image> process_image(std::unique_ptr<sg::Image> &&image) const;
+
 	virtual std::unique_ptr<sg::Sampler> parse_sampler(const tinygltf::Sampler &gltf_sampler) const;
 
 	virtual std::unique_ptr<sg::Texture> parse_texture(const tinygltf::Texture &gltf_texture) const;
 
+	/**
+	 * @brief Reads the joints of a skin and their inverse bind matrices
+	 * @param gltf_skin The skin to parse
+	 * @param nodes The scene graph nodes, in the order of the glTF nodes
+	 */
+	virtual std::unique_ptr<sg::Skin> parse_skin(const tinygltf::Skin &gltf_skin, const std::vector<std::unique_ptr<sg::Node>> &nodes) const;
+
+	/**
+	 * @brief Reads the keyframes of the translation, rotation and scale channels of an animation
+	 * @param gltf_animation The animation to parse
+	 * @param script_node The node the animation script belongs to
+	 * @param nodes The scene graph nodes, in the order of the glTF nodes
+	 */
+	virtual std::unique_ptr<sg::Animation> parse_animation(const tinygltf::Animation &gltf_animation, sg::Node &script_node,
+	                                                       const std::vector<std::unique_ptr<sg::Node>> &nodes) const;
+
 	virtual std::unique_ptr<sg::PBRMaterial> create_default_material();
 
 	virtual std::unique_ptr<sg::Sampler> create_default_sampler();
@@ -103,6 +236,12 @@ class GLTFLoader
 	 */
 	std::vector<std::unique_ptr<sg::Light>> parse_khr_lights_punctual();
 
+	/**
+	 * @brief Decodes the buffer views compressed with the EXT_meshopt_compression extension in parallel,
+	 *        into their fallback buffers, so that the accessors read them as uncompressed data
+	 */
+	void decode_meshopt_buffer_views();
+
 	/**
 	 * @brief Checks if the GLTFLoader supports an extension, and that it is present in the glTF file
 	 * @param requested_extension The extension to check
@@ -124,10 +263,57 @@ class GLTFLoader
 
 	std::string model_path;
 
+	std::string model_file;
+
 	/// The extensions that the GLTFLoader can load mapped to whether they should be enabled or not
 	static std::unordered_map<std::string, bool> supported_extensions;
 
+	bool merge_buffers{false};
+
+	VertexFormat vertex_format;
+
+	bool optimize_meshes{false};
+
+	bool generate_lod_levels{false};
+
+	bool static_batching{false};
+
+	float static_batch_cell_size{0.0f};
+
+	bool texture_streaming{false};
+
+	uint32_t texture_placeholder_size{TextureStreamer::TAIL_SIZE};
+
+	bool use_scene_cache{false};
+
+	bool cook_package{false};
+
+	VkFormat texture_compression{VK_FORMAT_UNDEFINED};
+
+	bool add_default_components{true};
+
+	bool gpu_astc_decode{false};
+
+	/// Images read from the scene cache, in the order of the model images
+	std::vector<CachedImage> cached_images;
+
+	/// Images to write to the scene cache, filled by the image tasks when the cache is cold
+	std::vector<CachedImage> images_to_cache;
+
+	/// Runs the loading jobs, also used by the image jobs to split CPU decoding and mipmap generation
+	JobSystem *job_system{nullptr};
+
+	/// Created if no job system was given
+	std::unique_ptr<JobSystem> owned_job_system;
+
   private:
 	sg::Scene load_scene(int scene_index = -1);
+
+	/**
+	 * @brief Creates the Vulkan image of a processed image, only the tail of the mip chain if textures are streamed
+	 * @param image The image
+	 * @param mip_levels Levels of the Vulkan image, 0 for the levels of the image data
+	 */
+	void create_image_resources(sg::Image &image, uint32_t mip_levels) const;
 };
 }        // namespace vkb
@@ -20,9 +20,11 @@
 
 #include "gui.h"
 
+#include <algorithm>
 #include <map>
 #include <numeric>
 
+#include "allocation_tracker.h"
 #include "common/error.h"
 
 VKBP_DISABLE_WARNINGS()
@@ -30,7 +32,7 @@ VKBP_DISABLE_WARNINGS()
 #include <glm/gtc/matrix_transform.hpp>
 VKBP_ENABLE_WARNINGS()
 
-#include "buffer_pool.h"
+#include "common/helpers.h"
 #include "common/logging.h"
 #include "common/utils.h"
 #include "common/vk_common.h"
@@ -38,10 +40,12 @@ VKBP_ENABLE_WARNINGS()
 #include "core/descriptor_set_layout.h"
 #include "core/pipeline.h"
 #include "core/pipeline_layout.h"
+#include "core/render_pass.h"
 #include "core/shader_module.h"
 #include "imgui_internal.h"
 #include "platform/filesystem.h"
 #include "rendering/render_context.h"
+#include "rendering/subpass.h"
 #include "timer.h"
 #include "utils/graphs.h"
 #include "vulkan_sample.h"
@@ -59,6 +63,152 @@ inline void reset_graph_max_value(Gui::StatsView::GraphData &graph_data)
 		graph_data.max_value = 0.0f;
 	}
 }
+
+/**
+ * @return A colour for the scopes of a name, the same from frame to frame
+ */
+ImU32 get_timeline_color(const char *name)
+{
+	uint32_t hash{2166136261u};
+
+	for (; *name; ++name)
+	{
+		hash = (hash ^ static_cast<uint8_t>(*name)) * 16777619u;
+	}
+
+	return ImColor::HSV(static_cast<float>(hash % 360) / 360.0f, 0.5f, 0.7f);
+}
+
+/**
+ * @brief Hashes the vertices and indices of the draw data, which are all the buffers hold
+ */
+size_t hash_draw_data(const ImDrawData &draw_data)
+{
+	size_t seed{0};
+
+	auto hash_bytes = [&seed](const void *data, size_t size) {
+		auto bytes = static_cast<const uint8_t *>(data);
+
+		for (size_t offset = 0; offset < size; offset += sizeof(size_t))
+		{
+			size_t word{0};
+			std::memcpy(&word, bytes + offset, std::min(sizeof(size_t), size - offset));
+			hash_combine(seed, word);
+		}
+	};
+
+	for (int n = 0; n < draw_data.CmdListsCount; n++)
+	{
+		const ImDrawList *cmd_list = draw_data.CmdLists[n];
+
+		hash_combine(seed, cmd_list->VtxBuffer.Size);
+		hash_combine(seed, cmd_list->IdxBuffer.Size);
+
+		hash_bytes(cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
+		hash_bytes(cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+	}
+
+	return seed;
+}
+
+/**
+ * @return The scissor of the draw command, in window coordinates
+ */
+VkRect2D get_clip_rect(const ImDrawCmd &cmd)
+{
+	VkRect2D clip_rect;
+	clip_rect.offset.x      = std::max(static_cast<int32_t>(cmd.ClipRect.x), 0);
+	clip_rect.offset.y      = std::max(static_cast<int32_t>(cmd.ClipRect.y), 0);
+	clip_rect.extent.width  = static_cast<uint32_t>(cmd.ClipRect.z - cmd.ClipRect.x);
+	clip_rect.extent.height = static_cast<uint32_t>(cmd.ClipRect.w - cmd.ClipRect.y);
+
+	return clip_rect;
+}
+
+/**
+ * @return The smallest rectangle containing both, an empty rectangle being ignored
+ */
+VkRect2D union_rect(const VkRect2D &a, const VkRect2D &b)
+{
+	if (a.extent.width == 0 || a.extent.height == 0)
+	{
+		return b;
+	}
+
+	if (b.extent.width == 0 || b.extent.height == 0)
+	{
+		return a;
+	}
+
+	int32_t right  = std::max(a.offset.x + static_cast<int32_t>(a.extent.width), b.offset.x + static_cast<int32_t>(b.extent.width));
+	int32_t bottom = std::max(a.offset.y + static_cast<int32_t>(a.extent.height), b.offset.y + static_cast<int32_t>(b.extent.height));
+
+	VkRect2D result;
+	result.offset.x      = std::min(a.offset.x, b.offset.x);
+	result.offset.y      = std::min(a.offset.y, b.offset.y);
+	result.extent.width  = static_cast<uint32_t>(right - result.offset.x);
+	result.extent.height = static_cast<uint32_t>(bottom - result.offset.y);
+
+	return result;
+}
+
+/**
+ * @return The union of the scissors of the draw data, in window coordinates
+ */
+VkRect2D get_draw_area(const ImDrawData &draw_data)
+{
+	VkRect2D area{};
+
+	for (int32_t i = 0; i < draw_data.CmdListsCount; i++)
+	{
+		const ImDrawList *cmd_list = draw_data.CmdLists[i];
+
+		for (int32_t j = 0; j < cmd_list->CmdBuffer.Size; j++)
+		{
+			area = union_rect(area, get_clip_rect(cmd_list->CmdBuffer[j]));
+		}
+	}
+
+	return area;
+}
+
+/**
+ * @brief Replaces the buffer if it is smaller than the size, leaving room to grow
+ * @return Whether the buffer was replaced
+ */
+bool reserve_buffer(Device &device, std::unique_ptr<core::Buffer> &buffer, VkBufferUsageFlags usage, VkDeviceSize size)
+{
+	if (buffer && buffer->get_size() >= size)
+	{
+		return false;
+	}
+
+	VkDeviceSize capacity = buffer ? std::max(size, 2 * buffer->get_size()) : size;
+
+	buffer = std::make_unique<core::Buffer>(device, capacity, usage, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	buffer->set_debug_name("GUI");
+
+	return true;
+}
+
+/**
+ * @brief Blends the gui into the first color output of the current subpass, leaving its other outputs untouched
+ */
+ColorBlendState get_gui_blend_state(const CommandBuffer &command_buffer, const ColorBlendAttachmentState &color_attachment)
+{
+	ColorBlendAttachmentState masked_attachment{};
+	masked_attachment.color_write_mask = 0;
+
+	ColorBlendState blend_state{};
+	blend_state.attachments = {color_attachment};
+
+	if (auto render_pass = command_buffer.get_current_render_pass().render_pass)
+	{
+		blend_state.attachments.resize(std::max(1u, render_pass->get_color_output_count(command_buffer.get_current_subpass_index())), masked_attachment);
+	}
+
+	return blend_state;
+}
 }        // namespace
 
 const double Gui::press_time_ms = 200.0f;
@@ -80,6 +230,33 @@ const ImGuiWindowFlags Gui::options_flags = Gui::common_flags;
 
 const ImGuiWindowFlags Gui::info_flags = Gui::common_flags | ImGuiWindowFlags_NoInputs;
 
+/**
+ * @brief Draws the overlay to the layer, with the shaders of the gui
+ */
+class Gui::LayerSubpass : public Subpass
+{
+  public:
+	LayerSubpass(RenderContext &render_context, Gui &gui) :
+	    Subpass{render_context, ShaderSource{"imgui.vert"}, ShaderSource{"imgui.frag"}},
+	    gui{gui}
+	{
+	}
+
+	void prepare() override
+	{
+	}
+
+	void draw(CommandBuffer &command_buffer) override
+	{
+		gui.drawing_layer = true;
+		gui.draw_overlay(command_buffer);
+		gui.drawing_layer = false;
+	}
+
+  private:
+	Gui &gui;
+};
+
 Gui::Gui(VulkanSample &sample_, const float dpi_factor) :
     sample{sample_},
     dpi_factor{dpi_factor}
@@ -128,7 +305,7 @@ Gui::Gui(VulkanSample &sample_, const float dpi_factor) :
 	font_image      = std::make_unique<core::Image>(device, font_extent, VK_FORMAT_R8G8B8A8_UNORM,
                                                VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
                                                VMA_MEMORY_USAGE_GPU_ONLY);
-	font_image_view = std::make_unique<core::ImageView>(*font_image, VK_IMAGE_VIEW_TYPE_2D);
+	font_image_view = &font_image->request_view(VK_IMAGE_VIEW_TYPE_2D);
 
 	// Upload font data into the vulkan image memory
 	{
@@ -209,14 +386,176 @@ Gui::Gui(VulkanSample &sample_, const float dpi_factor) :
 
 	pipeline_layout = &device.get_resource_cache().request_pipeline_layout(shader_modules, false);
 
-	sampler = std::make_unique<core::Sampler>(device, sampler_info);
+	sampler = &device.get_resource_cache().request_sampler(sampler_info);
+}
+
+void Gui::set_layer_rate(float updates_per_second)
+{
+	if (layer_rate > 0.0f && updates_per_second <= 0.0f)
+	{
+		layer_ready = false;
+	}
+
+	layer_rate = updates_per_second;
+}
+
+void Gui::update_layer(CommandBuffer &command_buffer, const VkExtent2D &extent)
+{
+	VKB_ALLOCATION_SCOPE(Gui);
+
+	auto &render_context = sample.get_render_context();
+	auto &device         = render_context.get_device();
+
+	// Frames which sampled a retired layer have completed once as many updates as frames went by
+	for (auto &retired : retired_layer_targets)
+	{
+		--retired.second;
+	}
+
+	retired_layer_targets.erase(std::remove_if(retired_layer_targets.begin(), retired_layer_targets.end(),
+	                                           [](const std::pair<std::unique_ptr<RenderTarget>, size_t> &retired) { return retired.second == 0; }),
+	                            retired_layer_targets.end());
+
+	layer_ready = false;
+
+	if (layer_rate <= 0.0f || !visible)
+	{
+		return;
+	}
+
+	bool resized = !layer_target || layer_target->get_extent().width != extent.width || layer_target->get_extent().height != extent.height;
+
+	if (resized)
+	{
+		if (layer_target)
+		{
+			retired_layer_targets.emplace_back(std::move(layer_target), render_context.get_render_frames().size());
+		}
+
+		std::vector<core::Image> images;
+		images.emplace_back(device, VkExtent3D{extent.width, extent.height, 1},
+		                    VK_FORMAT_R8G8B8A8_UNORM,
+		                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		                    VMA_MEMORY_USAGE_GPU_ONLY);
+		images.back().set_debug_name("GUI layer");
+
+		layer_target = std::make_unique<RenderTarget>(std::move(images));
+	}
+
+	if (!layer_pipeline)
+	{
+		VkClearValue transparent{};
+
+		layer_pipeline = std::make_unique<RenderPipeline>();
+		layer_pipeline->add_subpass(std::make_unique<LayerSubpass>(render_context, *this));
+		layer_pipeline->set_load_store({{VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE}});
+		layer_pipeline->set_clear_value({transparent});
+
+		vkb::ShaderSource vert_shader("gui_layer.vert");
+		vkb::ShaderSource frag_shader("gui_layer.frag");
+
+		std::vector<vkb::ShaderModule *> shader_modules;
+		shader_modules.push_back(&device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, vert_shader, {}));
+		shader_modules.push_back(&device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, frag_shader, {}));
+
+		layer_pipeline_layout = &device.get_resource_cache().request_pipeline_layout(shader_modules, false);
+	}
+
+	if (resized || layer_age >= 1.0f / layer_rate)
+	{
+		layer_age = 0.0f;
+
+		auto &view = layer_target->get_views().at(0);
+
+		{
+			// The previous contents are cleared, once the frames sampling them are done
+			ImageMemoryBarrier memory_barrier{};
+			memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+			memory_barrier.new_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			memory_barrier.src_access_mask = 0;
+			memory_barrier.dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+			command_buffer.image_memory_barrier(view, memory_barrier);
+		}
+
+		VkViewport viewport{};
+		viewport.width    = static_cast<float>(extent.width);
+		viewport.height   = static_cast<float>(extent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		command_buffer.set_viewport(0, {viewport});
+
+		VkRect2D scissor{};
+		scissor.extent = extent;
+		command_buffer.set_scissor(0, {scissor});
+
+		layer_pipeline->draw(command_buffer, *layer_target);
+
+		command_buffer.end_render_pass();
+
+		{
+			ImageMemoryBarrier memory_barrier{};
+			memory_barrier.old_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			memory_barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			memory_barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			memory_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+			memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+			command_buffer.image_memory_barrier(view, memory_barrier);
+		}
+	}
+
+	layer_ready = true;
+}
+
+void Gui::composite_layer(CommandBuffer &command_buffer)
+{
+	if (overlay_area.extent.width == 0 || overlay_area.extent.height == 0)
+	{
+		return;
+	}
+
+	command_buffer.set_vertex_input_state({});
+
+	// Premultiplied colors
+	vkb::ColorBlendAttachmentState color_attachment{};
+	color_attachment.blend_enable           = VK_TRUE;
+	color_attachment.color_write_mask       = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT;
+	color_attachment.src_color_blend_factor = VK_BLEND_FACTOR_ONE;
+	color_attachment.dst_color_blend_factor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+
+	command_buffer.set_color_blend_state(get_gui_blend_state(command_buffer, color_attachment));
+
+	vkb::RasterizationState rasterization_state{};
+	rasterization_state.cull_mode = VK_CULL_MODE_NONE;
+	command_buffer.set_rasterization_state(rasterization_state);
+
+	vkb::DepthStencilState depth_state{};
+	depth_state.depth_test_enable  = VK_FALSE;
+	depth_state.depth_write_enable = VK_FALSE;
+	command_buffer.set_depth_stencil_state(depth_state);
+
+	command_buffer.bind_pipeline_layout(*layer_pipeline_layout);
+
+	command_buffer.bind_image(layer_target->get_views().at(0), *sampler, 0, 0, 0);
+
+	// Only the area the overlay covered when the layer was last rendered is blended
+	command_buffer.set_scissor(0, {overlay_area});
+
+	command_buffer.draw(3, 1, 0, 0);
 }
 
 void Gui::update(const float delta_time)
 {
+	VKB_ALLOCATION_SCOPE(Gui);
+
 	if (!visible)
 	{
 		ImGui::EndFrame();
+		track_changes(nullptr);
 		return;
 	}
 
@@ -224,8 +563,36 @@ void Gui::update(const float delta_time)
 	ImGuiIO &io  = ImGui::GetIO();
 	io.DeltaTime = delta_time;
 
+	layer_age += delta_time;
+
 	// Render to generate draw buffers
 	ImGui::Render();
+
+	track_changes(ImGui::GetDrawData());
+}
+
+void Gui::track_changes(const ImDrawData *draw_data)
+{
+	size_t   hash = draw_data ? hash_draw_data(*draw_data) : 0;
+	VkRect2D area = draw_data ? get_draw_area(*draw_data) : VkRect2D{};
+
+	changed = hash != draw_data_hash;
+
+	// The pixels the overlay covered are damaged as well as those it covers now
+	damage = changed ? union_rect(draw_area, area) : VkRect2D{};
+
+	draw_data_hash = hash;
+	draw_area      = area;
+}
+
+bool Gui::has_changed() const
+{
+	return changed;
+}
+
+const VkRect2D &Gui::get_damage() const
+{
+	return damage;
 }
 
 void Gui::update_buffers(CommandBuffer &command_buffer)
@@ -240,38 +607,48 @@ void Gui::update_buffers(CommandBuffer &command_buffer)
 		return;
 	}
 
-	std::vector<uint8_t> vertex_data(vertex_buffer_size);
-	std::vector<uint8_t> index_data(index_buffer_size);
+	auto &render_context = sample.get_render_context();
 
-	// Upload data
-	ImDrawVert *vtx_dst = (ImDrawVert *) vertex_data.data();
-	ImDrawIdx * idx_dst = (ImDrawIdx *) index_data.data();
+	// The buffers of a frame are not in use by the GPU once the frame is active again
+	auto frame_index = render_context.get_active_frame_index();
 
-	for (int n = 0; n < draw_data->CmdListsCount; n++)
+	if (frame_buffers.size() <= frame_index)
 	{
-		const ImDrawList *cmd_list = draw_data->CmdLists[n];
-		memcpy(vtx_dst, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
-		memcpy(idx_dst, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
-		vtx_dst += cmd_list->VtxBuffer.Size;
-		idx_dst += cmd_list->IdxBuffer.Size;
+		frame_buffers.resize(frame_index + 1);
 	}
 
-	auto vertex_allocation = sample.get_render_context().get_active_frame().allocate_buffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertex_buffer_size);
+	auto &buffers = frame_buffers[frame_index];
+
+	bool reallocated = reserve_buffer(render_context.get_device(), buffers.vertex_buffer, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertex_buffer_size);
+	reallocated |= reserve_buffer(render_context.get_device(), buffers.index_buffer, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, index_buffer_size);
 
-	vertex_allocation.update(vertex_data);
+	// The overlay rarely changes, in which case the geometry written when this frame was last drawn is still valid
+	if (reallocated || draw_data_hash != buffers.draw_data_hash)
+	{
+		// Written straight into the mapped memory, one draw list after the other
+		size_t vertex_offset = 0;
+		size_t index_offset  = 0;
+
+		for (int n = 0; n < draw_data->CmdListsCount; n++)
+		{
+			const ImDrawList *cmd_list = draw_data->CmdLists[n];
 
-	std::vector<std::reference_wrapper<const core::Buffer>> buffers;
-	buffers.emplace_back(std::ref(vertex_allocation.get_buffer()));
+			size_t vertex_size = cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+			size_t index_size  = cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
 
-	std::vector<VkDeviceSize> offsets{vertex_allocation.get_offset()};
+			buffers.vertex_buffer->update(reinterpret_cast<const uint8_t *>(cmd_list->VtxBuffer.Data), vertex_size, vertex_offset);
+			buffers.index_buffer->update(reinterpret_cast<const uint8_t *>(cmd_list->IdxBuffer.Data), index_size, index_offset);
 
-	command_buffer.bind_vertex_buffers(0, buffers, offsets);
+			vertex_offset += vertex_size;
+			index_offset += index_size;
+		}
 
-	auto index_allocation = sample.get_render_context().get_active_frame().allocate_buffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, index_buffer_size);
+		buffers.draw_data_hash = draw_data_hash;
+	}
 
-	index_allocation.update(index_data);
+	command_buffer.bind_vertex_buffer(0, *buffers.vertex_buffer, 0);
 
-	command_buffer.bind_index_buffer(index_allocation.get_buffer(), index_allocation.get_offset(), VK_INDEX_TYPE_UINT16);
+	command_buffer.bind_index_buffer(*buffers.index_buffer, 0, VK_INDEX_TYPE_UINT16);
 }
 
 void Gui::resize(const uint32_t width, const uint32_t height) const
@@ -283,11 +660,47 @@ void Gui::resize(const uint32_t width, const uint32_t height) const
 
 void Gui::draw(CommandBuffer &command_buffer)
 {
+	VKB_ALLOCATION_SCOPE(Gui);
+
 	if (!visible)
 	{
 		return;
 	}
 
+	command_buffer.begin_debug_label("GUI");
+
+	if (layer_ready)
+	{
+		composite_layer(command_buffer);
+	}
+	else
+	{
+		draw_overlay(command_buffer);
+	}
+
+	command_buffer.end_debug_label();
+}
+
+CommandBuffer &Gui::draw_secondary(CommandBuffer &primary_command_buffer, size_t thread_index, CommandBuffer::ResetMode reset_mode)
+{
+	auto &render_context = sample.get_render_context();
+
+	const auto &queue = render_context.get_device().get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+
+	auto &command_buffer = render_context.get_active_frame().request_command_buffer(queue, reset_mode, VK_COMMAND_BUFFER_LEVEL_SECONDARY, thread_index);
+
+	// The viewport and scissor are inherited from the primary command buffer
+	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &primary_command_buffer);
+
+	draw(command_buffer);
+
+	command_buffer.end();
+
+	return command_buffer;
+}
+
+void Gui::draw_overlay(CommandBuffer &command_buffer)
+{
 	// Vertex input state
 	VkVertexInputBindingDescription vertex_input_binding{};
 	vertex_input_binding.stride = to_u32(sizeof(ImDrawVert));
@@ -323,10 +736,15 @@ void Gui::draw(CommandBuffer &command_buffer)
 	color_attachment.dst_color_blend_factor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
 	color_attachment.src_alpha_blend_factor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
 
-	vkb::ColorBlendState blend_state{};
-	blend_state.attachments = {color_attachment};
+	// The layer accumulates the coverage, so that it holds premultiplied colors
+	if (drawing_layer)
+	{
+		color_attachment.color_write_mask |= VK_COLOR_COMPONENT_A_BIT;
+		color_attachment.src_alpha_blend_factor = VK_BLEND_FACTOR_ONE;
+		color_attachment.dst_alpha_blend_factor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	}
 
-	command_buffer.set_color_blend_state(blend_state);
+	command_buffer.set_color_blend_state(get_gui_blend_state(command_buffer, color_attachment));
 
 	vkb::RasterizationState rasterization_state{};
 	rasterization_state.cull_mode = VK_CULL_MODE_NONE;
@@ -379,6 +797,9 @@ void Gui::draw(CommandBuffer &command_buffer)
 	int32_t     vertex_offset = 0;
 	uint32_t    index_offset  = 0;
 
+	// Union of the scissors of the draws
+	VkRect2D area{};
+
 	if (draw_data->CmdListsCount > 0)
 	{
 		for (int32_t i = 0; i < draw_data->CmdListsCount; i++)
@@ -387,39 +808,11 @@ void Gui::draw(CommandBuffer &command_buffer)
 			for (int32_t j = 0; j < cmd_list->CmdBuffer.Size; j++)
 			{
 				const ImDrawCmd *cmd = &cmd_list->CmdBuffer[j];
-				VkRect2D         scissor_rect;
-				scissor_rect.offset.x      = std::max(static_cast<int32_t>(cmd->ClipRect.x), 0);
-				scissor_rect.offset.y      = std::max(static_cast<int32_t>(cmd->ClipRect.y), 0);
-				scissor_rect.extent.width  = static_cast<uint32_t>(cmd->ClipRect.z - cmd->ClipRect.x);
-				scissor_rect.extent.height = static_cast<uint32_t>(cmd->ClipRect.w - cmd->ClipRect.y);
 
 				// Adjust for pre-rotation if necessary
-				if (sample.get_render_context().has_swapchain())
-				{
-					auto transform = sample.get_render_context().get_swapchain().get_transform();
+				VkRect2D scissor_rect = sample.get_render_context().pre_rotate(get_clip_rect(*cmd));
 
-					if (transform & VK_SURFACE_TRANSFORM_ROTATE_90_BIT_KHR)
-					{
-						scissor_rect.offset.x      = static_cast<uint32_t>(io.DisplaySize.y - cmd->ClipRect.w);
-						scissor_rect.offset.y      = static_cast<uint32_t>(cmd->ClipRect.x);
-						scissor_rect.extent.width  = static_cast<uint32_t>(cmd->ClipRect.w - cmd->ClipRect.y);
-						scissor_rect.extent.height = static_cast<uint32_t>(cmd->ClipRect.z - cmd->ClipRect.x);
-					}
-					else if (transform & VK_SURFACE_TRANSFORM_ROTATE_180_BIT_KHR)
-					{
-						scissor_rect.offset.x      = static_cast<uint32_t>(io.DisplaySize.x - cmd->ClipRect.z);
-						scissor_rect.offset.y      = static_cast<uint32_t>(io.DisplaySize.y - cmd->ClipRect.w);
-						scissor_rect.extent.width  = static_cast<uint32_t>(cmd->ClipRect.z - cmd->ClipRect.x);
-						scissor_rect.extent.height = static_cast<uint32_t>(cmd->ClipRect.w - cmd->ClipRect.y);
-					}
-					else if (transform & VK_SURFACE_TRANSFORM_ROTATE_270_BIT_KHR)
-					{
-						scissor_rect.offset.x      = static_cast<uint32_t>(cmd->ClipRect.y);
-						scissor_rect.offset.y      = static_cast<uint32_t>(io.DisplaySize.x - cmd->ClipRect.z);
-						scissor_rect.extent.width  = static_cast<uint32_t>(cmd->ClipRect.w - cmd->ClipRect.y);
-						scissor_rect.extent.height = static_cast<uint32_t>(cmd->ClipRect.z - cmd->ClipRect.x);
-					}
-				}
+				area = union_rect(area, scissor_rect);
 
 				command_buffer.set_scissor(0, {scissor_rect});
 				command_buffer.draw_indexed(cmd->ElemCount, 1, index_offset, vertex_offset, 0);
@@ -428,6 +821,8 @@ void Gui::draw(CommandBuffer &command_buffer)
 			vertex_offset += cmd_list->VtxBuffer.Size;
 		}
 	}
+
+	overlay_area = area;
 }
 
 Gui::~Gui()
@@ -467,6 +862,11 @@ bool Gui::is_debug_view_active() const
 	return debug_view.active;
 }
 
+bool Gui::is_timeline_open() const
+{
+	return debug_view.timeline_open;
+}
+
 void Gui::StatsView::reset_max_value(const StatIndex index)
 {
 	auto pr = graph_map.find(index);
@@ -482,6 +882,8 @@ void Gui::StatsView::reset_max_values()
 	std::for_each(graph_map.begin(),
 	              graph_map.end(),
 	              [](auto &pr) { reset_graph_max_value(pr.second); });
+
+	named_max_values.clear();
 }
 
 void Gui::show_top_window(const std::string &app_name, const Stats *stats, DebugInfo *debug_info)
@@ -511,6 +913,9 @@ void Gui::show_top_window(const std::string &app_name, const Stats *stats, Debug
 		}
 	}
 
+	// Set again by the debug window if it shows the timeline
+	debug_view.timeline_open = false;
+
 	if (debug_info)
 	{
 		if (debug_view.active)
@@ -519,6 +924,9 @@ void Gui::show_top_window(const std::string &app_name, const Stats *stats, Debug
 		}
 	}
 
+	// The scopes are only kept while they are drawn
+	CpuProfiler::get().set_recent_events_enabled(debug_view.timeline_open);
+
 	ImGui::End();
 }
 
@@ -616,10 +1024,348 @@ void Gui::show_debug_window(DebugInfo &debug_info, const ImVec2 &position)
 		}
 	}
 
+	if (ImGui::CollapsingHeader("Resource cache"))
+	{
+		show_resource_cache_inspector();
+	}
+
+	if (ImGui::CollapsingHeader("Timeline"))
+	{
+		debug_view.timeline_open = true;
+
+		show_timeline();
+	}
+
 	ImGui::PopFont();
 	ImGui::End();
 }
 
+void Gui::show_resource_cache_inspector()
+{
+	auto &resource_cache = sample.get_render_context().get_device().get_resource_cache();
+	auto &io             = ImGui::GetIO();
+
+	const float column_width = io.DisplaySize.x / 7.0f;
+
+	ImGui::Columns(6, "Cache maps");
+	ImGui::SetColumnWidth(0, 2.0f * column_width);
+	ImGui::Text("Map");
+	ImGui::NextColumn();
+	ImGui::Text("Entries");
+	ImGui::NextColumn();
+	ImGui::Text("KB");
+	ImGui::NextColumn();
+	ImGui::Text("Hits/frame");
+	ImGui::NextColumn();
+	ImGui::Text("Misses/frame");
+	ImGui::NextColumn();
+	ImGui::Text("Evictions");
+	ImGui::NextColumn();
+	ImGui::Separator();
+
+	for (auto &map_info : resource_cache.get_map_infos())
+	{
+		// Counters of the previous frame, the first frame shown has none to compare to
+		auto counters_it = debug_view.cache_counters.find(map_info.name);
+
+		uint64_t frame_hits{0};
+		uint64_t frame_misses{0};
+
+		if (counters_it != debug_view.cache_counters.end())
+		{
+			frame_hits   = map_info.stats.hits - counters_it->second.first;
+			frame_misses = map_info.stats.misses - counters_it->second.second;
+		}
+
+		debug_view.cache_counters[map_info.name] = std::make_pair(map_info.stats.hits, map_info.stats.misses);
+
+		bool selected = debug_view.inspected_map == map_info.name;
+
+		if (ImGui::Selectable(map_info.name.c_str(), selected))
+		{
+			debug_view.inspected_map = selected ? "" : map_info.name;
+		}
+		ImGui::NextColumn();
+		ImGui::Text("%zu", map_info.stats.entries);
+		ImGui::NextColumn();
+		ImGui::Text("%.1f", map_info.stats.bytes / 1024.0f);
+		ImGui::NextColumn();
+		ImGui::Text("%llu", static_cast<unsigned long long>(frame_hits));
+		ImGui::NextColumn();
+		ImGui::Text("%llu", static_cast<unsigned long long>(frame_misses));
+		ImGui::NextColumn();
+		ImGui::Text("%llu", static_cast<unsigned long long>(map_info.stats.evictions));
+		ImGui::NextColumn();
+	}
+
+	ImGui::Columns(1);
+
+	if (debug_view.inspected_map.empty())
+	{
+		return;
+	}
+
+	auto entry_infos = resource_cache.get_entry_infos(debug_view.inspected_map);
+
+	ImGui::Separator();
+	ImGui::Text("Sort by");
+	ImGui::SameLine();
+	ImGui::RadioButton("Creation time", &debug_view.entry_order, 0);
+	ImGui::SameLine();
+	ImGui::RadioButton("Last used", &debug_view.entry_order, 1);
+	ImGui::SameLine();
+	ImGui::RadioButton("Created", &debug_view.entry_order, 2);
+
+	auto count = std::min(entry_infos.size(), static_cast<size_t>(debug_view.max_entries));
+
+	std::partial_sort(entry_infos.begin(), entry_infos.begin() + count, entry_infos.end(), [this](const ResourceCacheEntryInfo &a, const ResourceCacheEntryInfo &b) {
+		switch (debug_view.entry_order)
+		{
+			case 1:
+				return a.last_used > b.last_used;
+			case 2:
+				return a.created > b.created;
+			default:
+				return a.creation_time > b.creation_time;
+		}
+	});
+
+	ImGui::Columns(5, "Cache entries");
+	ImGui::SetColumnWidth(0, column_width);
+	ImGui::SetColumnWidth(4, 3.0f * column_width);
+	ImGui::Text("Hash");
+	ImGui::NextColumn();
+	ImGui::Text("Created (ms)");
+	ImGui::NextColumn();
+	ImGui::Text("Created (frame)");
+	ImGui::NextColumn();
+	ImGui::Text("Last used (frame)");
+	ImGui::NextColumn();
+	ImGui::Text("Summary");
+	ImGui::NextColumn();
+	ImGui::Separator();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto &entry_info = entry_infos[i];
+
+		ImGui::Text("%08zx", entry_info.hash & 0xFFFFFFFF);
+		ImGui::NextColumn();
+		ImGui::Text("%.2f", entry_info.creation_time);
+		ImGui::NextColumn();
+		ImGui::Text("%llu", static_cast<unsigned long long>(entry_info.created));
+		ImGui::NextColumn();
+		ImGui::Text("%llu", static_cast<unsigned long long>(entry_info.last_used));
+		ImGui::NextColumn();
+		ImGui::Text("%s", entry_info.summary.c_str());
+		ImGui::NextColumn();
+	}
+
+	ImGui::Columns(1);
+
+	if (entry_infos.size() > count)
+	{
+		ImGui::Text("%zu more entries", entry_infos.size() - count);
+	}
+}
+
+void Gui::show_timeline()
+{
+	auto &profiler = CpuProfiler::get();
+
+	uint64_t now = profiler.now();
+
+	// Buffers are allocated the first time the timeline is shown, and reused from then on
+	if (debug_view.frame_starts.empty())
+	{
+		debug_view.frame_starts.resize(debug_view.timeline_frames + 1, now);
+		debug_view.cpu_events.reserve(CpuProfiler::RECENT_EVENTS_CAPACITY);
+		debug_view.cpu_event_depths.reserve(CpuProfiler::RECENT_EVENTS_CAPACITY);
+		debug_view.open_scope_ends.reserve(debug_view.timeline_max_depth);
+		debug_view.gpu_scopes.resize(debug_view.timeline_frames * GpuProfiler::MAX_SCOPES);
+	}
+
+	auto &frame_starts = debug_view.frame_starts;
+
+	frame_starts[debug_view.frame_start_count++ % frame_starts.size()] = now;
+
+	uint64_t window_start = frame_starts[debug_view.frame_start_count % frame_starts.size()];
+	uint64_t window_end   = now;
+
+	// GPU scopes of a frame are added once its results were read back
+	auto &gpu_profiler = sample.get_render_context().get_last_rendered_frame().get_gpu_profiler();
+
+	uint64_t submit_time = gpu_profiler.get_submit_time();
+
+	if (submit_time != 0 && submit_time != debug_view.gpu_submit_time)
+	{
+		debug_view.gpu_submit_time = submit_time;
+
+		for (auto &scope_time : gpu_profiler.get_scope_times())
+		{
+			auto &scope = debug_view.gpu_scopes[debug_view.gpu_scope_count++ % debug_view.gpu_scopes.size()];
+
+			scope.name     = scope_time.name;
+			scope.depth    = scope_time.depth;
+			scope.start    = submit_time + static_cast<uint64_t>(scope_time.start * 1e9);
+			scope.duration = static_cast<uint64_t>(scope_time.time * 1e9);
+		}
+	}
+
+	auto &events = debug_view.cpu_events;
+
+	profiler.get_recent_events(window_start, events);
+
+	// Enclosing scopes first, so that the depths follow from the scopes still open
+	std::sort(events.begin(), events.end(), [](const CpuProfiler::ThreadEvent &a, const CpuProfiler::ThreadEvent &b) {
+		if (a.thread_id != b.thread_id)
+		{
+			return a.thread_id < b.thread_id;
+		}
+		if (a.event.start != b.event.start)
+		{
+			return a.event.start < b.event.start;
+		}
+		return a.event.duration > b.event.duration;
+	});
+
+	auto &depths    = debug_view.cpu_event_depths;
+	auto &open_ends = debug_view.open_scope_ends;
+
+	depths.clear();
+
+	for (size_t i = 0; i < events.size(); ++i)
+	{
+		if (i == 0 || events[i].thread_id != events[i - 1].thread_id)
+		{
+			open_ends.clear();
+		}
+
+		auto &event = events[i].event;
+
+		while (!open_ends.empty() && open_ends.back() <= event.start)
+		{
+			open_ends.pop_back();
+		}
+
+		depths.push_back(to_u32(open_ends.size()));
+
+		if (open_ends.size() < debug_view.timeline_max_depth)
+		{
+			open_ends.push_back(event.start + event.duration);
+		}
+	}
+
+	ImGui::Text("Last %u frames: %.2f ms", debug_view.timeline_frames, (window_end - window_start) / 1e6f);
+
+	if (!gpu_profiler.is_enabled())
+	{
+		ImGui::SameLine();
+		ImGui::Text("(GPU timestamps not supported)");
+	}
+
+	auto draw_list = ImGui::GetWindowDrawList();
+
+	const ImVec2 origin       = ImGui::GetCursorScreenPos();
+	const float  width        = ImGui::GetContentRegionAvail().x;
+	const float  label_width  = ImGui::CalcTextSize("Thread 00").x + ImGui::GetStyle().ItemSpacing.x;
+	const float  bar_height   = ImGui::GetTextLineHeight() + 2.0f;
+	const double window_scale = window_end > window_start ? (width - label_width) / static_cast<double>(window_end - window_start) : 0.0;
+
+	auto to_x = [&](uint64_t time) {
+		time = std::min(std::max(time, window_start), window_end);
+		return origin.x + label_width + static_cast<float>(static_cast<double>(time - window_start) * window_scale);
+	};
+
+	auto draw_scope = [&](const char *name, uint64_t start, uint64_t duration, float y) {
+		if (start + duration < window_start || start > window_end)
+		{
+			return;
+		}
+
+		ImVec2 min{to_x(start), y};
+		ImVec2 max{std::max(to_x(start + duration), min.x + 1.0f), y + bar_height - 1.0f};
+
+		draw_list->AddRectFilled(min, max, get_timeline_color(name));
+
+		// Names are only drawn on the scopes wide enough for them
+		if (max.x - min.x > ImGui::CalcTextSize(name).x)
+		{
+			draw_list->AddText(ImVec2{min.x + 1.0f, min.y + 1.0f}, IM_COL32_WHITE, name);
+		}
+
+		if (ImGui::IsMouseHoveringRect(min, max))
+		{
+			ImGui::SetTooltip("%s: %.3f ms", name, duration / 1e6f);
+		}
+	};
+
+	float y = origin.y;
+
+	// A track per thread, as deep as its scopes are nested
+	for (size_t begin = 0; begin < events.size();)
+	{
+		uint32_t thread_id = events[begin].thread_id;
+		uint32_t max_depth = 0;
+
+		size_t end = begin;
+		for (; end < events.size() && events[end].thread_id == thread_id; ++end)
+		{
+			max_depth = std::max(max_depth, depths[end]);
+		}
+
+		max_depth = std::min(max_depth, debug_view.timeline_max_depth - 1);
+
+		char label[16];
+		snprintf(label, sizeof(label), "Thread %u", thread_id);
+
+		draw_list->AddText(ImVec2{origin.x, y}, IM_COL32_WHITE, label);
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (depths[i] <= max_depth)
+			{
+				draw_scope(events[i].event.name, events[i].event.start, events[i].event.duration, y + depths[i] * bar_height);
+			}
+		}
+
+		y += (max_depth + 1) * bar_height + 2.0f;
+		begin = end;
+	}
+
+	// The GPU scopes of the frames on their own track, placed from the submission of their frame
+	uint32_t gpu_depth = 0;
+
+	uint64_t gpu_scope_first = debug_view.gpu_scope_count > debug_view.gpu_scopes.size() ? debug_view.gpu_scope_count - debug_view.gpu_scopes.size() : 0;
+
+	draw_list->AddText(ImVec2{origin.x, y}, IM_COL32_WHITE, "GPU");
+
+	for (uint64_t i = gpu_scope_first; i < debug_view.gpu_scope_count; ++i)
+	{
+		auto &scope = debug_view.gpu_scopes[i % debug_view.gpu_scopes.size()];
+
+		if (scope.depth < debug_view.timeline_max_depth)
+		{
+			draw_scope(scope.name.c_str(), scope.start, scope.duration, y + scope.depth * bar_height);
+
+			gpu_depth = std::max(gpu_depth, scope.depth);
+		}
+	}
+
+	y += (gpu_depth + 1) * bar_height;
+
+	// Frames are separated by the times the timeline was shown at
+	for (auto frame_start : frame_starts)
+	{
+		if (frame_start > window_start && frame_start < window_end)
+		{
+			draw_list->AddLine(ImVec2{to_x(frame_start), origin.y}, ImVec2{to_x(frame_start), y}, IM_COL32(255, 255, 255, 96));
+		}
+	}
+
+	ImGui::Dummy(ImVec2{width, y - origin.y});
+}
+
 Gui::StatsView::GraphData::GraphData(const std::string &name_,
                                      const std::string &graph_label_format_,
                                      float              scale_factor_,
@@ -674,7 +1420,42 @@ void Gui::show_stats(const Stats &stats)
 		}
 
 		ImGui::PushItemFlag(ImGuiItemFlags_Disabled, true);
-		ImGui::PlotLines("", &graph_elements[0], static_cast<int>(graph_elements.size()), 0, graph_label.str().c_str(), graph_min, graph_max, graph_size);
+		ImGui::PlotLines("", &graph_elements[0], static_cast<int>(graph_elements.size()), static_cast<int>(stats.get_data_offset(stat_index)), graph_label.str().c_str(), graph_min, graph_max, graph_size);
+		ImGui::PopItemFlag();
+
+		// The GPU time is broken down by scope
+		if (stat_index == StatIndex::gpu_time)
+		{
+			for (const auto &scope_time : stats.get_gpu_scope_times())
+			{
+				std::string indent(scope_time.depth * 2, ' ');
+				ImGui::Text("%s%s: %.2f ms", indent.c_str(), scope_time.name.c_str(), scope_time.time * 1000.0f);
+			}
+		}
+	}
+
+	// Counters of the driver without a StatIndex are shown with their own scale
+	for (const auto &name : stats.get_named_stats())
+	{
+		const auto &graph_elements = stats.get_named_data(name);
+		float &     graph_max      = stats_view.named_max_values[name];
+
+		auto new_max = *std::max_element(graph_elements.begin(), graph_elements.end()) * stats_view.top_padding;
+		if (new_max > graph_max)
+		{
+			graph_max = new_max;
+		}
+
+		const ImVec2 graph_size = ImVec2{
+		    ImGui::GetIO().DisplaySize.x,
+		    stats_view.graph_height /* dpi */ * dpi_factor};
+
+		float avg = std::accumulate(graph_elements.begin(), graph_elements.end(), 0.0f) / graph_elements.size();
+
+		auto graph_label = fmt::format("{}: {:.1f}", name, avg);
+
+		ImGui::PushItemFlag(ImGuiItemFlags_Disabled, true);
+		ImGui::PlotLines("", &graph_elements[0], static_cast<int>(graph_elements.size()), static_cast<int>(stats.get_named_data_offset(name)), graph_label.c_str(), 0.0f, graph_max, graph_size);
 		ImGui::PopItemFlag();
 	}
 }
@@ -27,8 +27,12 @@
 #include <imgui_internal.h>
 #include <thread>
 
+#include "core/buffer.h"
 #include "core/command_buffer.h"
 #include "core/sampler.h"
+#include "cpu_profiler.h"
+#include "rendering/render_pipeline.h"
+#include "rendering/render_target.h"
 #include "debug_info.h"
 #include "platform/filesystem.h"
 #include "platform/input_events.h"
@@ -197,7 +201,78 @@ class Gui
 		        {StatIndex::l2_ext_write_bytes,
 		         {/* name = */ "External Write Bytes",
 		          /* format = */ "{:4.1f} MiB/s",
-		          /* scale_factor = */ 1.0f / (1024.0f * 1024.0f)}}};
+		          /* scale_factor = */ 1.0f / (1024.0f * 1024.0f)}},
+		        {StatIndex::descriptor_set_allocations,
+		         {/* name = */ "Descriptor Set Allocations",
+		          /* format = */ "{:4.0f}/frame"}},
+		        {StatIndex::descriptor_pool_resets,
+		         {/* name = */ "Descriptor Pool Resets",
+		          /* format = */ "{:4.0f}/frame"}},
+		        {StatIndex::descriptor_set_reuses,
+		         {/* name = */ "Descriptor Set Reuses",
+		          /* format = */ "{:4.0f}/frame"}},
+		        {StatIndex::present_interval,
+		         {/* name = */ "Present Interval",
+		          /* format = */ "{:3.1f} ms",
+		          /* scale_factor = */ 1000.0f}},
+		        {StatIndex::present_delay,
+		         {/* name = */ "Present Delay",
+		          /* format = */ "{:3.1f} ms",
+		          /* scale_factor = */ 1000.0f}},
+		        {StatIndex::gpu_time,
+		         {/* name = */ "GPU Time",
+		          /* format = */ "{:3.1f} ms",
+		          /* scale_factor = */ 1000.0f}},
+		        {StatIndex::input_assembly_primitives,
+		         {/* name = */ "Input Assembly Primitives",
+		          /* format = */ "{:4.1f} k/frame",
+		          /* scale_factor = */ 1.0f / 1000.0f}},
+		        {StatIndex::vertex_shader_invocations,
+		         {/* name = */ "Vertex Shader Invocations",
+		          /* format = */ "{:4.1f} k/frame",
+		          /* scale_factor = */ 1.0f / 1000.0f}},
+		        {StatIndex::clipping_invocations,
+		         {/* name = */ "Clipping Invocations",
+		          /* format = */ "{:4.1f} k/frame",
+		          /* scale_factor = */ 1.0f / 1000.0f}},
+		        {StatIndex::clipping_primitives,
+		         {/* name = */ "Clipping Primitives",
+		          /* format = */ "{:4.1f} k/frame",
+		          /* scale_factor = */ 1.0f / 1000.0f}},
+		        {StatIndex::fragment_shader_invocations,
+		         {/* name = */ "Fragment Shader Invocations",
+		          /* format = */ "{:4.1f} M/frame",
+		          /* scale_factor = */ 1.0f / 1000000.0f}},
+		        {StatIndex::compute_shader_invocations,
+		         {/* name = */ "Compute Shader Invocations",
+		          /* format = */ "{:4.1f} k/frame",
+		          /* scale_factor = */ 1.0f / 1000.0f}},
+		        {StatIndex::command_buffer_allocations,
+		         {/* name = */ "Command Buffer Allocations",
+		          /* format = */ "{:4.0f}/frame"}},
+		        {StatIndex::command_buffer_reuses,
+		         {/* name = */ "Command Buffer Reuses",
+		          /* format = */ "{:4.0f}/frame"}},
+		        {StatIndex::command_buffer_resets,
+		         {/* name = */ "Command Buffer Resets",
+		          /* format = */ "{:4.0f}/frame"}},
+		        {StatIndex::command_pool_reset_time,
+		         {/* name = */ "Command Pool Reset Time",
+		          /* format = */ "{:3.2f} ms"}},
+		        {StatIndex::command_buffer_allocation_time,
+		         {/* name = */ "Command Buffer Allocation Time",
+		          /* format = */ "{:3.2f} ms"}},
+		        {StatIndex::device_memory_usage,
+		         {/* name = */ "Device Memory",
+		          /* format = */ "{:4.0f} MiB",
+		          /* scale_factor = */ 1.0f / (1024.0f * 1024.0f)}},
+		        {StatIndex::device_memory_budget_usage,
+		         {/* name = */ "Heap Budget Used",
+		          /* format = */ "{:3.0f} %",
+		          /* scale_factor = */ 100.0f}}};
+
+		/// Max values of the named stats, which have no fixed max
+		std::map<std::string, float> named_max_values;
 
 		float graph_height{50.0f};
 
@@ -217,6 +292,61 @@ class Gui
 		uint32_t max_fields{8};
 
 		float label_column_width{0};
+
+		/// Map of the resource cache whose entries are listed, none if empty
+		std::string inspected_map;
+
+		/// Order of the listed entries: 0 by creation time (the compile cost of pipelines), 1 by last use, 2 by creation
+		int entry_order{0};
+
+		uint32_t max_entries{12};
+
+		/// Hits and misses of each map of the resource cache at the previous frame
+		std::map<std::string, std::pair<uint64_t, uint64_t>> cache_counters;
+
+		/**
+		 * @brief A GPU scope kept for the timeline, with times in nanoseconds of the CPU profiler clock
+		 */
+		struct TimelineGpuScope
+		{
+			std::string name;
+
+			uint32_t depth;
+
+			uint64_t start;
+
+			uint64_t duration;
+		};
+
+		/// Whether the timeline was shown by the last update, which records the scopes it draws
+		bool timeline_open{false};
+
+		/// Frames shown on the timeline
+		uint32_t timeline_frames{4};
+
+		/// Scopes nested deeper on a track are not drawn
+		uint32_t timeline_max_depth{8};
+
+		/// Times the timeline was shown at, one per frame, in a ring of timeline_frames + 1 entries
+		std::vector<uint64_t> frame_starts;
+
+		uint64_t frame_start_count{0};
+
+		/// CPU scopes of the shown frames, and how deep each one is nested on its thread
+		std::vector<CpuProfiler::ThreadEvent> cpu_events;
+
+		std::vector<uint32_t> cpu_event_depths;
+
+		/// Ends of the scopes enclosing the current one while the depths are computed
+		std::vector<uint64_t> open_scope_ends;
+
+		/// GPU scopes of the recent frames, in a ring
+		std::vector<TimelineGpuScope> gpu_scopes;
+
+		uint64_t gpu_scope_count{0};
+
+		/// Submission of the frame whose GPU scopes were added last
+		uint64_t gpu_submit_time{0};
 	};
 
 	// The name of the default font file to use
@@ -254,11 +384,37 @@ class Gui
 	void update(const float delta_time);
 
 	/**
-	 * @brief Draws the Gui
+	 * @brief Draws the Gui, or composites its layer if update_layer rendered it for the current target
 	 * @param command_buffer Command buffer to register draw-commands
 	 */
 	void draw(CommandBuffer &command_buffer);
 
+	/**
+	 * @brief Draws the Gui into a secondary command buffer of the active frame, to be executed in the current subpass
+	 *        of a primary command buffer. It can be recorded on a worker thread while the primary one records the scene,
+	 *        as long as the Gui is not updated meanwhile
+	 * @param primary_command_buffer The primary command buffer used to inherit the secondary one
+	 * @param thread_index Selects the command pool of the thread recording the Gui
+	 * @param reset_mode Reset mode of the command pool of the thread
+	 * @return The recorded secondary command buffer
+	 */
+	CommandBuffer &draw_secondary(CommandBuffer &primary_command_buffer, size_t thread_index,
+	                              CommandBuffer::ResetMode reset_mode = CommandBuffer::ResetMode::ResetPool);
+
+	/**
+	 * @brief Sets how often the Gui is rendered to a layer of its own, composited by draw instead of
+	 *        drawing the Gui again. The scene passes then no longer pay for the overdraw of the Gui.
+	 * @param updates_per_second Rate of the layer updates, 0 to draw the Gui every frame (the default)
+	 */
+	void set_layer_rate(float updates_per_second);
+
+	/**
+	 * @brief Renders the Gui to its layer if the layer is enabled and due, outside of any render pass
+	 * @param command_buffer Command buffer to record the render pass of the layer to
+	 * @param extent Extent of the render target the layer is composited to
+	 */
+	void update_layer(CommandBuffer &command_buffer, const VkExtent2D &extent);
+
 	/**
 	 * @brief Shows an overlay top window with app info and maybe stats
 	 * @param app_name Application name
@@ -285,6 +441,18 @@ class Gui
 	 */
 	void show_debug_window(DebugInfo &debug_info, const ImVec2 &position);
 
+	/**
+	 * @brief Shows the maps of the resource cache with their size and hits and misses per frame,
+	 *        and the entries of the selected map with when they were created and last used
+	 */
+	void show_resource_cache_inspector();
+
+	/**
+	 * @brief Shows the CPU scopes of each thread and the GPU scopes of the last frames on a timeline,
+	 *        to find the stalls of a frame such as fence waits and pipeline compiles
+	 */
+	void show_timeline();
+
 	/**
 	 * @brief Shows a child with statistics
 	 * @param stats Statistics to show
@@ -311,13 +479,60 @@ class Gui
 
 	bool is_debug_view_active() const;
 
+	/**
+	 * @return Whether the timeline is shown, which needs the GPU profilers of the frames enabled
+	 */
+	bool is_timeline_open() const;
+
+	/**
+	 * @return Whether the draw data of the last update differs from the one of the previous update
+	 */
+	bool has_changed() const;
+
+	/**
+	 * @return The area of the window which the last update changed, covering the overlay before and after it,
+	 *         empty if the overlay did not change
+	 */
+	const VkRect2D &get_damage() const;
+
   private:
+	class LayerSubpass;
+
 	/**
-	 * @brief Updates Vulkan buffers
-	 * @param frame Frame to render into
+	 * @brief Geometry of the GUI in persistently mapped buffers, one set per render frame
+	 */
+	struct FrameBuffers
+	{
+		std::unique_ptr<core::Buffer> vertex_buffer;
+
+		std::unique_ptr<core::Buffer> index_buffer;
+
+		/// Hash of the draw data last written to the buffers
+		size_t draw_data_hash{0};
+	};
+
+	/**
+	 * @brief Writes the draw data to the buffers of the active frame, unless they already hold it, and binds them
+	 * @param command_buffer Command buffer to bind the buffers to
 	 */
 	void update_buffers(CommandBuffer &command_buffer);
 
+	/**
+	 * @brief Compares the draw data of an update with the previous one, to know which area of the window changed
+	 * @param draw_data The draw data rendered by the update, nullptr if the GUI is hidden
+	 */
+	void track_changes(const ImDrawData *draw_data);
+
+	/**
+	 * @brief Records the draws of the draw data, and keeps the area they cover in overlay_area
+	 */
+	void draw_overlay(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Blends the layer over the covered area of the render target
+	 */
+	void composite_layer(CommandBuffer &command_buffer);
+
 	static const double press_time_ms;
 
 	static const float overlay_alpha;
@@ -335,13 +550,54 @@ class Gui
 
 	std::vector<Font> fonts;
 
-	std::unique_ptr<core::Image>     font_image;
-	std::unique_ptr<core::ImageView> font_image_view;
+	std::unique_ptr<core::Image> font_image;
+
+	/// Owned by font_image
+	core::ImageView *font_image_view{nullptr};
 
-	std::unique_ptr<core::Sampler> sampler{nullptr};
+	/// Owned by the resource cache
+	core::Sampler *sampler{nullptr};
 
 	PipelineLayout *pipeline_layout{nullptr};
 
+	/// Indexed by the active frame index of the render context
+	std::vector<FrameBuffers> frame_buffers;
+
+	/// Layer updates per second, 0 if the layer is disabled
+	float layer_rate{0.0f};
+
+	/// Time since the last layer update
+	float layer_age{0.0f};
+
+	/// Whether update_layer left the layer ready to be composited this frame
+	bool layer_ready{false};
+
+	/// Whether the overlay is being drawn to the layer, which also stores its coverage in the alpha channel
+	bool drawing_layer{false};
+
+	std::unique_ptr<RenderTarget> layer_target;
+
+	/// Layers replaced on resize, with the number of layer updates until frames no longer sample them
+	std::vector<std::pair<std::unique_ptr<RenderTarget>, size_t>> retired_layer_targets;
+
+	std::unique_ptr<RenderPipeline> layer_pipeline;
+
+	PipelineLayout *layer_pipeline_layout{nullptr};
+
+	/// Area covered by the draws of the overlay, in render target coordinates
+	VkRect2D overlay_area{};
+
+	/// Hash of the draw data of the last update
+	size_t draw_data_hash{0};
+
+	/// Area covered by the draw data of the last update, in window coordinates
+	VkRect2D draw_area{};
+
+	bool changed{true};
+
+	/// Area of the window changed by the last update
+	VkRect2D damage{};
+
 	StatsView stats_view;
 
 	DebugView debug_view;
@@ -0,0 +1,524 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "job_system.h"
+
+#include <algorithm>
+
+#if defined(__ANDROID__) || defined(__linux__)
+#	include <pthread.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
+#include "common/error.h"
+#include "common/logging.h"
+
+namespace vkb
+{
+namespace
+{
+/// The job system the calling thread belongs to, and its index in it, so that the index is found without a search
+thread_local const JobSystem *current_job_system{nullptr};
+
+thread_local size_t current_thread_index{0};
+
+int32_t get_current_native_thread_id()
+{
+#if defined(__ANDROID__) || defined(__linux__)
+	return static_cast<int32_t>(syscall(SYS_gettid));
+#else
+	return 0;
+#endif
+}
+}        // namespace
+
+bool JobSystem::Counter::is_done() const
+{
+	return pending.load(std::memory_order_acquire) == 0;
+}
+
+JobSystem::JobSystem(size_t worker_count) :
+    owner_id{std::this_thread::get_id()},
+    native_thread_ids(worker_count + 1)
+{
+	native_thread_ids[0] = get_current_native_thread_id();
+
+	current_job_system   = this;
+	current_thread_index = 0;
+
+#if defined(__ANDROID__) || defined(__linux__)
+	owner_handle = pthread_self();
+#endif
+
+	for (size_t i = 0; i <= worker_count; i++)
+	{
+		queues.push_back(std::make_unique<Queue>());
+	}
+
+	first_background_worker = get_thread_count();
+
+	auto &topology = CpuTopology::get();
+
+	if (topology.is_affinity_enabled() && topology.is_heterogeneous())
+	{
+		// The calling thread records the frames on a big core, the other big cores run a critical worker each
+		size_t big_core_count = topology.get_cores(CoreClass::Big).size();
+		size_t big_workers    = std::min(worker_count, std::max<size_t>(big_core_count, 2) - 1);
+
+		first_background_worker = big_workers + 1;
+		core_affinity           = true;
+
+		topology.pin_current_thread(CoreClass::Big);
+	}
+
+	workers.reserve(worker_count);
+
+	for (size_t i = 1; i <= worker_count; i++)
+	{
+		workers.emplace_back(&JobSystem::work, this, i);
+	}
+
+	if (core_affinity)
+	{
+		LOGI("Job system running on {} threads, {} of them on little cores for background jobs",
+		     get_thread_count(), get_thread_count() - first_background_worker);
+	}
+	else
+	{
+		LOGI("Job system running on {} threads", get_thread_count());
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock{wake_mutex};
+		stopping = true;
+	}
+
+	wake_condition.notify_all();
+	background_condition.notify_all();
+
+	for (auto &worker : workers)
+	{
+		worker.join();
+	}
+
+	// Another job system may be created at the same address
+	if (current_job_system == this)
+	{
+		current_job_system = nullptr;
+	}
+}
+
+void JobSystem::run(Job &&job, Counter *counter, Counter *dependency, Priority priority)
+{
+	if (counter)
+	{
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (dependency)
+	{
+		// The last job of the dependency queues the dependent jobs under the same lock
+		std::lock_guard<std::mutex> lock{dependency_mutex};
+
+		if (!dependency->is_done())
+		{
+			dependency->dependent_jobs.push_back({std::move(job), counter, priority});
+			return;
+		}
+	}
+
+	push({std::move(job), counter, priority});
+}
+
+void JobSystem::wait(Counter &counter)
+{
+	auto thread_index = get_thread_index();
+
+	// Threads which are not part of the job system cannot use the resources of a thread index
+	bool runs_jobs = thread_index < get_thread_count();
+
+	while (!counter.is_done())
+	{
+		Entry entry;
+
+		if (runs_jobs && pop(thread_index, entry))
+		{
+			execute(entry, thread_index);
+			continue;
+		}
+
+		// Sleep until the counter is done, or until there are jobs to run in the meantime
+		std::unique_lock<std::mutex> lock{wake_mutex};
+
+		++waiting_threads;
+
+		done_condition.wait(lock, [this, &counter, runs_jobs, thread_index]() {
+			return counter.is_done() || (runs_jobs && has_work(thread_index));
+		});
+
+		--waiting_threads;
+	}
+
+	std::exception_ptr exception;
+
+	{
+		// Wait for the last job to release the counter
+		std::lock_guard<std::mutex> lock{dependency_mutex};
+		std::swap(exception, counter.exception);
+	}
+
+	if (exception)
+	{
+		std::rethrow_exception(exception);
+	}
+}
+
+void JobSystem::parallel_for(uint32_t count, uint32_t range_size, const std::function<void(uint32_t, uint32_t, size_t)> &func)
+{
+	assert(range_size > 0 && "Ranges cannot be empty");
+
+	uint32_t range_count = (count + range_size - 1) / range_size;
+
+	if (range_count < 2)
+	{
+		func(0, count, std::min(get_thread_index(), get_thread_count() - 1));
+		return;
+	}
+
+	Counter counter;
+
+	for (uint32_t range = 0; range < range_count; range++)
+	{
+		uint32_t begin = range * range_size;
+		uint32_t end   = std::min(begin + range_size, count);
+
+		run([&func, begin, end](size_t thread_index) { func(begin, end, thread_index); }, &counter);
+	}
+
+	wait(counter);
+}
+
+size_t JobSystem::get_thread_count() const
+{
+	return queues.size();
+}
+
+size_t JobSystem::get_thread_index() const
+{
+	if (current_job_system == this)
+	{
+		return current_thread_index;
+	}
+
+	// The owner may have created another job system since this one
+	if (std::this_thread::get_id() == owner_id)
+	{
+		return 0;
+	}
+
+	return get_thread_count();
+}
+
+std::vector<int32_t> JobSystem::get_native_thread_ids() const
+{
+	std::vector<int32_t> ids;
+
+	for (auto &id : native_thread_ids)
+	{
+		auto value = id.load(std::memory_order_relaxed);
+
+		if (value != 0)
+		{
+			ids.push_back(value);
+		}
+	}
+
+	return ids;
+}
+
+CoreClass JobSystem::get_thread_core_class(size_t thread_index) const
+{
+	if (!core_affinity)
+	{
+		return CoreClass::Any;
+	}
+
+	return thread_index < first_background_worker ? CoreClass::Big : CoreClass::Little;
+}
+
+std::vector<double> JobSystem::get_thread_cpu_times()
+{
+	std::vector<double> times;
+	times.reserve(get_thread_count());
+
+	times.push_back(CpuTopology::get_thread_cpu_time(owner_handle));
+
+	for (auto &worker : workers)
+	{
+		times.push_back(CpuTopology::get_thread_cpu_time(worker.native_handle()));
+	}
+
+	return times;
+}
+
+size_t JobSystem::get_default_worker_count()
+{
+	auto hardware_threads = std::thread::hardware_concurrency();
+
+	return hardware_threads > 1 ? hardware_threads - 1 : 1;
+}
+
+void JobSystem::push(Entry &&entry)
+{
+	if (entry.priority == Priority::Background)
+	{
+		{
+			std::lock_guard<std::mutex> lock{background_queue.mutex};
+			background_queue.entries.push_back(std::move(entry));
+		}
+
+		background_count.fetch_add(1, std::memory_order_release);
+
+		bool waiters;
+
+		{
+			std::lock_guard<std::mutex> lock{wake_mutex};
+			waiters = waiting_threads > 0;
+		}
+
+		if (first_background_worker < get_thread_count())
+		{
+			background_condition.notify_one();
+		}
+		else
+		{
+			wake_condition.notify_one();
+		}
+
+		if (waiters)
+		{
+			done_condition.notify_all();
+		}
+
+		return;
+	}
+
+	// Threads outside of the job system share the queue of the owner
+	auto thread_index = get_thread_index();
+	auto &queue       = *queues[thread_index < get_thread_count() ? thread_index : 0];
+
+	{
+		std::lock_guard<std::mutex> lock{queue.mutex};
+		queue.entries.push_back(std::move(entry));
+	}
+
+	queued_count.fetch_add(1, std::memory_order_release);
+
+	bool waiters;
+
+	{
+		// Taking the lock ensures that a worker or a waiting thread is either sleeping or will see the new entry
+		std::lock_guard<std::mutex> lock{wake_mutex};
+		waiters = waiting_threads > 0;
+	}
+
+	wake_condition.notify_one();
+
+	if (waiters)
+	{
+		done_condition.notify_all();
+	}
+}
+
+void JobSystem::notify_waiters()
+{
+	bool waiters;
+
+	{
+		// As with the workers, a waiting thread either sleeps already or will see the new state
+		std::lock_guard<std::mutex> lock{wake_mutex};
+		waiters = waiting_threads > 0;
+	}
+
+	if (waiters)
+	{
+		done_condition.notify_all();
+	}
+}
+
+bool JobSystem::pop(size_t thread_index, Entry &entry)
+{
+	{
+		auto &queue = *queues[thread_index];
+
+		std::lock_guard<std::mutex> lock{queue.mutex};
+
+		if (!queue.entries.empty())
+		{
+			entry = std::move(queue.entries.back());
+			queue.entries.pop_back();
+			queued_count.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	bool background_worker = thread_index >= first_background_worker;
+
+	// Steal the oldest job of another thread, which is likely the largest piece of work left
+	for (size_t i = 1; i < queues.size() && !background_worker; i++)
+	{
+		auto &queue = *queues[(thread_index + i) % queues.size()];
+
+		std::lock_guard<std::mutex> lock{queue.mutex};
+
+		if (!queue.entries.empty())
+		{
+			entry = std::move(queue.entries.front());
+			queue.entries.pop_front();
+			queued_count.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	// Background jobs are left to the background workers, if there are any
+	if (background_worker || first_background_worker == get_thread_count())
+	{
+		std::lock_guard<std::mutex> lock{background_queue.mutex};
+
+		if (!background_queue.entries.empty())
+		{
+			entry = std::move(background_queue.entries.front());
+			background_queue.entries.pop_front();
+			background_count.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool JobSystem::has_work(size_t thread_index) const
+{
+	bool background_jobs = background_count.load(std::memory_order_acquire) > 0;
+
+	if (thread_index >= first_background_worker)
+	{
+		return background_jobs;
+	}
+
+	return queued_count.load(std::memory_order_acquire) > 0 || (background_jobs && first_background_worker == get_thread_count());
+}
+
+void JobSystem::execute(Entry &entry, size_t thread_index)
+{
+	auto counter = entry.counter;
+
+	std::exception_ptr exception;
+
+	try
+	{
+		entry.job(thread_index);
+	}
+	catch (...)
+	{
+		exception = std::current_exception();
+	}
+
+	entry.job = nullptr;
+
+	if (!counter)
+	{
+		if (exception)
+		{
+			LOGE("Uncaught exception in a job without counter");
+		}
+		return;
+	}
+
+	std::vector<Counter::DependentJob> dependent_jobs;
+
+	bool counter_done{false};
+
+	{
+		// The counter can be destroyed by its waiter as soon as the lock is released
+		std::lock_guard<std::mutex> lock{dependency_mutex};
+
+		if (exception && !counter->exception)
+		{
+			counter->exception = exception;
+		}
+
+		if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::swap(dependent_jobs, counter->dependent_jobs);
+
+			counter_done = true;
+		}
+	}
+
+	if (counter_done)
+	{
+		notify_waiters();
+	}
+
+	for (auto &dependent_job : dependent_jobs)
+	{
+		push({std::move(dependent_job.job), dependent_job.counter, dependent_job.priority});
+	}
+}
+
+void JobSystem::work(size_t thread_index)
+{
+	native_thread_ids[thread_index] = get_current_native_thread_id();
+
+	current_job_system   = this;
+	current_thread_index = thread_index;
+
+	CpuTopology::get().pin_current_thread(get_thread_core_class(thread_index));
+
+	bool background_worker = thread_index >= first_background_worker;
+
+	auto &condition = background_worker ? background_condition : wake_condition;
+
+	while (true)
+	{
+		Entry entry;
+
+		if (pop(thread_index, entry))
+		{
+			execute(entry, thread_index);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock{wake_mutex};
+
+		condition.wait(lock, [this, thread_index]() { return stopping || has_work(thread_index); });
+
+		if (stopping && !has_work(thread_index))
+		{
+			return;
+		}
+	}
+}
+}        // namespace vkb
@@ -0,0 +1,272 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cpu_topology.h"
+
+namespace vkb
+{
+/**
+ * @brief Runs jobs on a fixed set of worker threads shared by the whole framework.
+ *
+ * Each thread owns a deque of jobs: it takes the jobs it queued from the back, and steals
+ * from the front of the other deques when its own is empty. The thread which created the job
+ * system is thread 0, it runs jobs while it waits for a counter. The workers are threads 1 to
+ * the worker count, so that a thread index can select per-thread resources such as the pools
+ * of a RenderFrame. Other threads can queue jobs and wait, but they never run jobs.
+ *
+ * Background jobs, such as streaming and decoding, share a queue taken from once the threads ran out
+ * of other jobs. When the affinity of the CpuTopology is enabled as the job system is created, on CPUs
+ * with big and little cores, the calling thread and a worker per other big core are pinned to the big
+ * cores and run the other jobs, while the remaining workers are pinned to the little cores and only
+ * run the background jobs.
+ */
+class JobSystem
+{
+  public:
+	using Job = std::function<void(size_t thread_index)>;
+
+	/**
+	 * @brief Whether a job is on the critical path of a frame, which decides the threads it runs on
+	 */
+	enum class Priority
+	{
+		Critical,
+
+		Background
+	};
+
+	/**
+	 * @brief Number of unfinished jobs of a group, jobs can wait for a counter before they are queued
+	 */
+	class Counter
+	{
+	  public:
+		Counter() = default;
+
+		Counter(const Counter &) = delete;
+
+		Counter &operator=(const Counter &) = delete;
+
+		bool is_done() const;
+
+	  private:
+		friend class JobSystem;
+
+		std::atomic<uint32_t> pending{0};
+
+		/// First exception thrown by a job of the group, rethrown by wait()
+		std::exception_ptr exception;
+
+		struct DependentJob
+		{
+			Job job;
+
+			Counter *counter;
+
+			Priority priority;
+		};
+
+		/// Jobs queued once the counter reaches zero, guarded by the dependency mutex of the job system
+		std::vector<DependentJob> dependent_jobs;
+	};
+
+	/**
+	 * @param worker_count Number of threads created besides the calling one
+	 */
+	explicit JobSystem(size_t worker_count = get_default_worker_count());
+
+	~JobSystem();
+
+	JobSystem(const JobSystem &) = delete;
+
+	JobSystem(JobSystem &&) = delete;
+
+	JobSystem &operator=(const JobSystem &) = delete;
+
+	JobSystem &operator=(JobSystem &&) = delete;
+
+	/**
+	 * @brief Queues a job on the deque of the calling thread
+	 * @param job Function called with the index of the thread running it
+	 * @param counter Optional counter incremented now and decremented once the job has run
+	 * @param dependency Optional counter which must reach zero before the job is queued
+	 * @param priority Background jobs are queued for the background workers, if there are any
+	 */
+	void run(Job &&job, Counter *counter = nullptr, Counter *dependency = nullptr, Priority priority = Priority::Critical);
+
+	/**
+	 * @brief Queues a function returning a value
+	 * @return Future of the value, it also carries the exception thrown by the function
+	 */
+	template <typename Func>
+	auto async(Func &&func, Priority priority = Priority::Critical) -> std::future<decltype(func(size_t{}))>
+	{
+		using Result = decltype(func(size_t{}));
+
+		auto task = std::make_shared<std::packaged_task<Result(size_t)>>(std::forward<Func>(func));
+
+		auto future = task->get_future();
+
+		run([task](size_t thread_index) { (*task)(thread_index); }, nullptr, nullptr, priority);
+
+		return future;
+	}
+
+	/**
+	 * @brief Runs queued jobs on the calling thread until the counter reaches zero, and sleeps
+	 *        while there are none. Rethrows the first exception thrown by a job of the counter
+	 */
+	void wait(Counter &counter);
+
+	/**
+	 * @brief Splits count items in ranges of range_size run as jobs, and waits for them
+	 * @param func The function called for each range [begin, end), it must be safe to call concurrently
+	 */
+	void parallel_for(uint32_t count, uint32_t range_size, const std::function<void(uint32_t begin, uint32_t end, size_t thread_index)> &func);
+
+	/**
+	 * @return Number of threads running jobs, including the one which created the job system
+	 */
+	size_t get_thread_count() const;
+
+	/**
+	 * @return Index of the calling thread, or the thread count if it does not belong to the job system
+	 */
+	size_t get_thread_index() const;
+
+	/**
+	 * @return Kernel ids of the threads running jobs on Linux and Android, for the scheduler hints of the platform.
+	 *         Empty on other systems, and ids of workers which have not started yet are left out
+	 */
+	std::vector<int32_t> get_native_thread_ids() const;
+
+	/**
+	 * @return The cores a thread is pinned to, CoreClass::Any if the affinity was not enabled or has no effect
+	 */
+	CoreClass get_thread_core_class(size_t thread_index) const;
+
+	/**
+	 * @return The CPU time each thread has run for in seconds, by thread index, zero on systems where it is not measured
+	 */
+	std::vector<double> get_thread_cpu_times();
+
+	/**
+	 * @return One worker per hardware thread besides the calling one
+	 */
+	static size_t get_default_worker_count();
+
+  private:
+	struct Entry
+	{
+		Job job;
+
+		Counter *counter{nullptr};
+
+		Priority priority{Priority::Critical};
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+
+		std::deque<Entry> entries;
+	};
+
+	/// Queues of the calling thread first, then of the workers
+	std::vector<std::unique_ptr<Queue>> queues;
+
+	std::vector<std::thread> workers;
+
+	std::thread::id owner_id;
+
+	/// Handle of the calling thread, to measure its CPU time
+	std::thread::native_handle_type owner_handle{};
+
+	/// Kernel id of each thread, set by the thread itself once it runs, 0 before then or if not available
+	std::vector<std::atomic<int32_t>> native_thread_ids;
+
+	/// Number of entries across the queues of the threads
+	std::atomic<size_t> queued_count{0};
+
+	/// Background jobs, in the order they were queued
+	Queue background_queue;
+
+	std::atomic<size_t> background_count{0};
+
+	/// Threads from this index on only run background jobs, the thread count if none do
+	size_t first_background_worker{0};
+
+	/// Whether the threads were pinned to classes of cores
+	bool core_affinity{false};
+
+	std::mutex wake_mutex;
+
+	/// Wakes the workers which run the critical jobs
+	std::condition_variable wake_condition;
+
+	/// Wakes the background workers
+	std::condition_variable background_condition;
+
+	/// Wakes the threads in wait() once a counter is done or jobs are queued
+	std::condition_variable done_condition;
+
+	/// Threads sleeping in wait(), guarded by the wake mutex
+	size_t waiting_threads{0};
+
+	bool stopping{false};
+
+	std::mutex dependency_mutex;
+
+	void push(Entry &&entry);
+
+	/**
+	 * @brief Wakes the threads sleeping in wait(), if any, once a counter is done
+	 */
+	void notify_waiters();
+
+	/**
+	 * @brief Takes a job from the queue of a thread, or steals one from another queue
+	 */
+	bool pop(size_t thread_index, Entry &entry);
+
+	/**
+	 * @return Whether there are jobs queued which a thread may run
+	 */
+	bool has_work(size_t thread_index) const;
+
+	void execute(Entry &entry, size_t thread_index);
+
+	void work(size_t thread_index);
+};
+}        // namespace vkb
@@ -0,0 +1,276 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "memory_defragmenter.h"
+
+#include <algorithm>
+
+#include "common/logging.h"
+#include "core/buffer.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "scene_graph/components/sub_mesh.h"
+#include "scene_graph/scene.h"
+
+namespace vkb
+{
+namespace
+{
+/**
+ * @return The buffers owned by the sub meshes of a scene which live in device memory only
+ */
+std::vector<core::Buffer *> get_movable_buffers(sg::Scene &scene)
+{
+	std::vector<core::Buffer *> buffers;
+
+	for (auto sub_mesh : scene.get_components<sg::SubMesh>())
+	{
+		for (auto &name_buffer : sub_mesh->vertex_buffers)
+		{
+			buffers.push_back(&name_buffer.second);
+		}
+
+		if (sub_mesh->index_buffer)
+		{
+			buffers.push_back(sub_mesh->index_buffer.get());
+		}
+	}
+
+	// Mapped buffers could be written by the host while they move
+	buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [](const core::Buffer *buffer) { return buffer->get_data() != nullptr; }),
+	              buffers.end());
+
+	return buffers;
+}
+}        // namespace
+
+MemoryDefragmenter::MemoryDefragmenter(Device &device, sg::Scene &scene, uint32_t frames_in_flight) :
+    device{device},
+    scene{scene},
+    frames_in_flight{frames_in_flight}
+{
+}
+
+MemoryDefragmenter::~MemoryDefragmenter()
+{
+	// The frames in flight may still copy the allocations or draw with the replaced handles
+	auto &deletion_queue = device.get_deletion_queue();
+
+	if (context != VK_NULL_HANDLE)
+	{
+		VmaAllocator              allocator = device.get_memory_allocator();
+		VmaDefragmentationContext pending   = context;
+
+		deletion_queue.defer([allocator, pending]() { vmaDefragmentationEnd(allocator, pending); });
+	}
+
+	for (auto &retired : retired_handles)
+	{
+		VkDevice device_handle = device.get_handle();
+		VkBuffer handle        = retired.handle;
+
+		deletion_queue.defer([device_handle, handle]() { vkDestroyBuffer(device_handle, handle, nullptr); });
+	}
+}
+
+void MemoryDefragmenter::update(CommandBuffer &command_buffer)
+{
+	update_index++;
+
+	// Like the views replaced by the texture streamer, a replaced handle may be cached in descriptor sets
+	// until every frame has been recorded without it, so it is kept for two rounds of frames
+	while (!retired_handles.empty() && retired_handles.front().update_index + 2 * frames_in_flight < update_index)
+	{
+		vkDestroyBuffer(device.get_handle(), retired_handles.front().handle, nullptr);
+
+		retired_handles.pop_front();
+	}
+
+	if (context != VK_NULL_HANDLE)
+	{
+		// Ending the pass frees the emptied memory blocks, which the copies read from
+		if (pass_update_index + frames_in_flight < update_index)
+		{
+			end_pass();
+		}
+
+		return;
+	}
+
+	if (update_index % CHECK_INTERVAL == 0)
+	{
+		begin_pass(command_buffer);
+	}
+}
+
+void MemoryDefragmenter::set_max_move_size(VkDeviceSize size)
+{
+	max_move_size = size;
+}
+
+void MemoryDefragmenter::set_max_move_count(uint32_t count)
+{
+	max_move_count = count;
+}
+
+VkDeviceSize MemoryDefragmenter::get_moved_size() const
+{
+	return moved_size;
+}
+
+VkDeviceSize MemoryDefragmenter::get_freed_size() const
+{
+	return freed_size;
+}
+
+bool MemoryDefragmenter::is_fragmented(const std::vector<core::Buffer *> &buffers) const
+{
+	auto allocator = device.get_memory_allocator();
+
+	uint32_t memory_type_bits{0};
+
+	for (auto buffer : buffers)
+	{
+		VmaAllocationInfo allocation_info{};
+		vmaGetAllocationInfo(allocator, buffer->get_memory(), &allocation_info);
+
+		memory_type_bits |= 1u << allocation_info.memoryType;
+	}
+
+	VmaStats stats{};
+	vmaCalculateStats(allocator, &stats);
+
+	for (uint32_t memory_type = 0; memory_type < VK_MAX_MEMORY_TYPES; ++memory_type)
+	{
+		if ((memory_type_bits & (1u << memory_type)) == 0)
+		{
+			continue;
+		}
+
+		auto &type_stats = stats.memoryType[memory_type];
+
+		// A single free range at the end of the blocks is not fragmentation
+		if (type_stats.unusedRangeCount > 1 &&
+		    type_stats.unusedBytes > MIN_UNUSED_RATIO * (type_stats.usedBytes + type_stats.unusedBytes))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void MemoryDefragmenter::begin_pass(CommandBuffer &command_buffer)
+{
+	auto buffers = get_movable_buffers(scene);
+
+	if (buffers.empty() || !is_fragmented(buffers))
+	{
+		return;
+	}
+
+	std::vector<VmaAllocation> allocations(buffers.size());
+	std::vector<VkBool32>      allocations_changed(buffers.size(), VK_FALSE);
+
+	for (size_t i = 0; i < buffers.size(); ++i)
+	{
+		allocations[i] = buffers[i]->get_memory();
+	}
+
+	command_buffer.flush_barriers();
+
+	// The copies overwrite memory which the previous frames may still read, and read memory they may have written
+	VkMemoryBarrier memory_barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+	memory_barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+	memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(command_buffer.get_handle(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                     0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+
+	VmaDefragmentationInfo2 defragmentation_info{};
+	defragmentation_info.allocationCount         = to_u32(allocations.size());
+	defragmentation_info.pAllocations            = allocations.data();
+	defragmentation_info.pAllocationsChanged     = allocations_changed.data();
+	defragmentation_info.maxGpuBytesToMove       = max_move_size;
+	defragmentation_info.maxGpuAllocationsToMove = max_move_count;
+	defragmentation_info.commandBuffer           = command_buffer.get_handle();
+
+	pass_stats = {};
+
+	auto result = vmaDefragmentationBegin(device.get_memory_allocator(), &defragmentation_info, &pass_stats, &context);
+
+	if (result != VK_SUCCESS && result != VK_NOT_READY)
+	{
+		LOGW("Cannot defragment the geometry buffers: {}", to_string(result));
+
+		context = VK_NULL_HANDLE;
+		return;
+	}
+
+	pass_update_index = update_index;
+
+	bool moved = false;
+
+	// The allocations already point to their new memory, which the draws of this frame use after the copies
+	for (size_t i = 0; i < buffers.size(); ++i)
+	{
+		if (allocations_changed[i])
+		{
+			retired_handles.push_back({update_index, buffers[i]->rebind_memory()});
+
+			moved = true;
+		}
+	}
+
+	if (moved)
+	{
+		memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(command_buffer.get_handle(), VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		                     0, 1, &memory_barrier, 0, nullptr, 0, nullptr);
+	}
+
+	if (context == VK_NULL_HANDLE)
+	{
+		end_pass();
+	}
+}
+
+void MemoryDefragmenter::end_pass()
+{
+	if (context != VK_NULL_HANDLE)
+	{
+		vmaDefragmentationEnd(device.get_memory_allocator(), context);
+
+		context = VK_NULL_HANDLE;
+	}
+
+	moved_size += pass_stats.bytesMoved;
+	freed_size += pass_stats.bytesFreed;
+
+	if (pass_stats.allocationsMoved > 0)
+	{
+		LOGD("Defragmentation moved {} buffers ({} KiB) and freed {} memory blocks",
+		     pass_stats.allocationsMoved, pass_stats.bytesMoved / 1024, pass_stats.deviceMemoryBlocksFreed);
+	}
+}
+}        // namespace vkb
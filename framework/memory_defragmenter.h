@@ -0,0 +1,149 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class Device;
+
+namespace core
+{
+class Buffer;
+}        // namespace core
+
+namespace sg
+{
+class Scene;
+}        // namespace sg
+
+/**
+ * @brief Defragments the device memory of the geometry buffers of a scene in the background.
+ *        When the memory types they use are fragmented, a pass moves a bounded number of bytes with
+ *        copies recorded at the start of a frame, and the moved buffers are recreated over their new
+ *        memory. Draws bind the buffers every time they are used, so they pick up the new handles.
+ *        Images are not moved, as VMA can only defragment images with linear tiling.
+ */
+class MemoryDefragmenter
+{
+  public:
+	/// Number of updates between two checks of the fragmentation
+	static const uint32_t CHECK_INTERVAL = 30;
+
+	/// Share of the memory blocks left unused from which a memory type is defragmented
+	static constexpr float MIN_UNUSED_RATIO = 0.25f;
+
+	/**
+	 * @param device The device the buffers are allocated from
+	 * @param scene Its sub meshes own the buffers which can be moved
+	 * @param frames_in_flight Number of frames which can be in flight, to know when the copies have completed
+	 */
+	MemoryDefragmenter(Device &device, sg::Scene &scene, uint32_t frames_in_flight);
+
+	MemoryDefragmenter(const MemoryDefragmenter &) = delete;
+
+	MemoryDefragmenter(MemoryDefragmenter &&) = delete;
+
+	/**
+	 * @brief Ends the pending pass and destroys the replaced buffer handles once the frames have completed
+	 */
+	~MemoryDefragmenter();
+
+	MemoryDefragmenter &operator=(const MemoryDefragmenter &) = delete;
+
+	MemoryDefragmenter &operator=(MemoryDefragmenter &&) = delete;
+
+	/**
+	 * @brief Ends the pass whose copies have completed, and starts a new one if the memory is fragmented
+	 * @param command_buffer Command buffer of the frame, outside of a render pass and before the draws
+	 */
+	void update(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Sets the maximum number of bytes copied by one pass, to bound the cost of a frame
+	 */
+	void set_max_move_size(VkDeviceSize size);
+
+	/**
+	 * @brief Sets the maximum number of allocations moved by one pass
+	 */
+	void set_max_move_count(uint32_t count);
+
+	/**
+	 * @return Bytes moved by the passes which have ended
+	 */
+	VkDeviceSize get_moved_size() const;
+
+	/**
+	 * @return Device memory freed by the passes which have ended, in bytes
+	 */
+	VkDeviceSize get_freed_size() const;
+
+  private:
+	struct RetiredHandle
+	{
+		uint64_t update_index{0};
+
+		VkBuffer handle{VK_NULL_HANDLE};
+	};
+
+	/**
+	 * @return Whether a memory type used by the buffers has too many unused bytes in its blocks
+	 */
+	bool is_fragmented(const std::vector<core::Buffer *> &buffers) const;
+
+	void begin_pass(CommandBuffer &command_buffer);
+
+	void end_pass();
+
+	Device &device;
+
+	sg::Scene &scene;
+
+	VkDeviceSize max_move_size{4 * 1024 * 1024};
+
+	uint32_t max_move_count{64};
+
+	uint32_t frames_in_flight{0};
+
+	uint64_t update_index{0};
+
+	/// Update which recorded the copies of the pending pass
+	uint64_t pass_update_index{0};
+
+	VmaDefragmentationContext context{VK_NULL_HANDLE};
+
+	/// Filled by VMA when the pending pass ends
+	VmaDefragmentationStats pass_stats{};
+
+	VkDeviceSize moved_size{0};
+
+	VkDeviceSize freed_size{0};
+
+	std::deque<RetiredHandle> retired_handles;
+};
+}        // namespace vkb
@@ -0,0 +1,193 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "memory_pools.h"
+
+#include "common/logging.h"
+
+namespace vkb
+{
+namespace
+{
+VmaPoolCreateFlags get_pool_flags(MemoryPoolClass pool_class)
+{
+	switch (pool_class)
+	{
+		case MemoryPoolClass::FrameRing:
+		case MemoryPoolClass::Staging:
+			return VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT;
+		case MemoryPoolClass::Texture:
+			return VMA_POOL_CREATE_BUDDY_ALGORITHM_BIT;
+		default:
+			return 0;
+	}
+}
+
+VkDeviceSize get_block_size(MemoryPoolClass pool_class)
+{
+	switch (pool_class)
+	{
+		case MemoryPoolClass::FrameRing:
+			return MemoryPools::FRAME_RING_BLOCK_SIZE;
+		case MemoryPoolClass::Staging:
+			return MemoryPools::STAGING_BLOCK_SIZE;
+		case MemoryPoolClass::Texture:
+			return MemoryPools::TEXTURE_BLOCK_SIZE;
+		default:
+			return 0;
+	}
+}
+}        // namespace
+
+const char *to_string(MemoryPoolClass pool_class)
+{
+	switch (pool_class)
+	{
+		case MemoryPoolClass::FrameRing:
+			return "frame_ring";
+		case MemoryPoolClass::Staging:
+			return "staging";
+		case MemoryPoolClass::Texture:
+			return "texture";
+		default:
+			return "";
+	}
+}
+
+MemoryPools::MemoryPools(VmaAllocator allocator) :
+    allocator{allocator}
+{
+}
+
+MemoryPools::~MemoryPools()
+{
+	for (auto &class_pools : pools)
+	{
+		for (auto pool : class_pools)
+		{
+			if (pool != VK_NULL_HANDLE)
+			{
+				vmaDestroyPool(allocator, pool);
+			}
+		}
+	}
+}
+
+void MemoryPools::select_pool(MemoryPoolClass pool_class, const VkBufferCreateInfo &buffer_info, VmaAllocationCreateInfo &memory_info)
+{
+	// Pool blocks cannot be dedicated allocations, and a resource larger than a block would never fit
+	if ((memory_info.flags & VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT) || buffer_info.size > get_block_size(pool_class))
+	{
+		return;
+	}
+
+	uint32_t memory_type_index{0};
+
+	if (vmaFindMemoryTypeIndexForBufferInfo(allocator, &buffer_info, &memory_info, &memory_type_index) == VK_SUCCESS)
+	{
+		memory_info.pool = request_pool(pool_class, memory_type_index);
+	}
+}
+
+void MemoryPools::select_pool(const VkImageCreateInfo &image_info, VmaAllocationCreateInfo &memory_info)
+{
+	const VkImageUsageFlags attachment_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+	if (image_info.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+	{
+		return;
+	}
+
+	if (image_info.usage & attachment_usage)
+	{
+		uint64_t texels = static_cast<uint64_t>(image_info.extent.width) * image_info.extent.height * image_info.extent.depth * image_info.arrayLayers;
+
+		if (texels >= DEDICATED_RENDER_TARGET_TEXELS)
+		{
+			memory_info.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+		}
+
+		return;
+	}
+
+	if ((image_info.usage & VK_IMAGE_USAGE_SAMPLED_BIT) == 0 || (memory_info.flags & VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT))
+	{
+		return;
+	}
+
+	uint32_t memory_type_index{0};
+
+	if (vmaFindMemoryTypeIndexForImageInfo(allocator, &image_info, &memory_info, &memory_type_index) == VK_SUCCESS)
+	{
+		memory_info.pool = request_pool(MemoryPoolClass::Texture, memory_type_index);
+	}
+}
+
+MemoryPoolStats MemoryPools::get_stats(MemoryPoolClass pool_class) const
+{
+	std::lock_guard<std::mutex> lock{mutex};
+
+	MemoryPoolStats stats;
+
+	for (auto pool : pools[static_cast<size_t>(pool_class)])
+	{
+		if (pool == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		VmaPoolStats pool_stats{};
+		vmaGetPoolStats(allocator, pool, &pool_stats);
+
+		stats.size += pool_stats.size;
+		stats.used += pool_stats.size - pool_stats.unusedSize;
+		stats.allocation_count += pool_stats.allocationCount;
+		stats.block_count += pool_stats.blockCount;
+	}
+
+	return stats;
+}
+
+VmaPool MemoryPools::request_pool(MemoryPoolClass pool_class, uint32_t memory_type_index)
+{
+	std::lock_guard<std::mutex> lock{mutex};
+
+	auto &pool = pools[static_cast<size_t>(pool_class)][memory_type_index];
+
+	if (pool == VK_NULL_HANDLE)
+	{
+		VmaPoolCreateInfo pool_info{};
+		pool_info.memoryTypeIndex = memory_type_index;
+		pool_info.flags           = get_pool_flags(pool_class);
+		pool_info.blockSize       = get_block_size(pool_class);
+
+		auto result = vmaCreatePool(allocator, &pool_info, &pool);
+
+		if (result != VK_SUCCESS)
+		{
+			LOGW("Cannot create the {} memory pool of memory type {}, using the default allocator", to_string(pool_class), memory_type_index);
+
+			pool = VK_NULL_HANDLE;
+		}
+	}
+
+	return pool;
+}
+}        // namespace vkb
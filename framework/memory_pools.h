@@ -0,0 +1,111 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <mutex>
+
+#include "common/vk_common.h"
+
+namespace vkb
+{
+/**
+ * @brief Classes of resources which are allocated from their own VMA pools, so that they do not fragment each other
+ */
+enum class MemoryPoolClass
+{
+	/// Buffer blocks of the frames, recycled as a whole: linear algorithm
+	FrameRing,
+	/// Buffers only used as the source of transfers, freed in allocation order: linear algorithm
+	Staging,
+	/// Sampled images: buddy algorithm
+	Texture,
+	Count
+};
+
+const char *to_string(MemoryPoolClass pool_class);
+
+/**
+ * @brief Usage of the pools of a class, over all the memory types
+ */
+struct MemoryPoolStats
+{
+	VkDeviceSize size{0};
+
+	VkDeviceSize used{0};
+
+	size_t allocation_count{0};
+
+	size_t block_count{0};
+};
+
+/**
+ * @brief Owns the VMA pools of the device, one per resource class and memory type, created on first use.
+ *        Resources outside the classes, and those which do not fit a pool block, use the default allocator.
+ *        Large render targets get a dedicated allocation instead. It can be used from any thread.
+ */
+class MemoryPools
+{
+  public:
+	static constexpr VkDeviceSize FRAME_RING_BLOCK_SIZE = 16 * 1024 * 1024;
+
+	static constexpr VkDeviceSize STAGING_BLOCK_SIZE = 32 * 1024 * 1024;
+
+	/// Power of two, as required by the buddy algorithm to use the whole block
+	static constexpr VkDeviceSize TEXTURE_BLOCK_SIZE = 64 * 1024 * 1024;
+
+	/// Width times height times layers from which a render target gets its own memory
+	static constexpr uint64_t DEDICATED_RENDER_TARGET_TEXELS = 1024 * 1024;
+
+	explicit MemoryPools(VmaAllocator allocator);
+
+	MemoryPools(const MemoryPools &) = delete;
+
+	MemoryPools &operator=(const MemoryPools &) = delete;
+
+	/**
+	 * @brief Destroys the pools, all their allocations must have been freed
+	 */
+	~MemoryPools();
+
+	/**
+	 * @brief Sets the pool of a buffer allocation of a class, unless the allocation asks for dedicated memory
+	 */
+	void select_pool(MemoryPoolClass pool_class, const VkBufferCreateInfo &buffer_info, VmaAllocationCreateInfo &memory_info);
+
+	/**
+	 * @brief Sets the pool of an image allocation from its usage: sampled images use the texture pools,
+	 *        large render targets get dedicated memory, and transient attachments are left to lazily allocated memory
+	 */
+	void select_pool(const VkImageCreateInfo &image_info, VmaAllocationCreateInfo &memory_info);
+
+	MemoryPoolStats get_stats(MemoryPoolClass pool_class) const;
+
+  private:
+	VmaPool request_pool(MemoryPoolClass pool_class, uint32_t memory_type_index);
+
+	VmaAllocator allocator{VK_NULL_HANDLE};
+
+	mutable std::mutex mutex;
+
+	std::array<std::array<VmaPool, VK_MAX_MEMORY_TYPES>, static_cast<size_t>(MemoryPoolClass::Count)> pools{};
+};
+}        // namespace vkb
@@ -0,0 +1,559 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+#include "common/helpers.h"
+#include "common/logging.h"
+#include "platform/filesystem.h"
+
+namespace vkb
+{
+namespace
+{
+const uint32_t UNUSED_VERTEX = ~0u;
+
+inline glm::vec3 get_position(const uint8_t *positions, uint32_t stride, uint32_t vertex)
+{
+	glm::vec3 position;
+	std::memcpy(&position, positions + static_cast<size_t>(vertex) * stride, sizeof(position));
+	return position;
+}
+
+/**
+ * @brief Tipsify, from "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Sander et al. 2007).
+ *        Fans around the vertex most likely to still be cached, and restarts from a recently used vertex
+ *        when none is left, which is where a new cluster starts.
+ * @param[out] clusters First triangle of each cluster
+ */
+std::vector<uint32_t> tipsify(const std::vector<uint32_t> &indices, uint32_t vertex_count, uint32_t cache_size, std::vector<uint32_t> &clusters)
+{
+	auto triangle_count = to_u32(indices.size() / 3);
+
+	// Triangles using each vertex, stored contiguously
+	std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+
+	for (auto index : indices)
+	{
+		adjacency_offsets[index + 1]++;
+	}
+
+	for (uint32_t vertex = 0; vertex < vertex_count; vertex++)
+	{
+		adjacency_offsets[vertex + 1] += adjacency_offsets[vertex];
+	}
+
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> fill_offsets(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		adjacency[fill_offsets[indices[i]]++] = to_u32(i / 3);
+	}
+
+	std::vector<uint32_t> live_triangles(vertex_count);
+
+	for (uint32_t vertex = 0; vertex < vertex_count; vertex++)
+	{
+		live_triangles[vertex] = adjacency_offsets[vertex + 1] - adjacency_offsets[vertex];
+	}
+
+	std::vector<uint32_t> cache_time(vertex_count, 0);
+	std::vector<bool>     emitted(triangle_count, false);
+	std::vector<uint32_t> dead_end;
+	std::vector<uint32_t> candidates;
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	uint32_t time_stamp = cache_size + 1;
+	uint32_t cursor     = 0;
+	int64_t  fanning    = 0;
+
+	clusters.push_back(0);
+
+	while (fanning >= 0)
+	{
+		candidates.clear();
+
+		auto vertex = static_cast<uint32_t>(fanning);
+
+		for (uint32_t i = adjacency_offsets[vertex]; i < adjacency_offsets[vertex + 1]; i++)
+		{
+			auto triangle = adjacency[i];
+
+			if (emitted[triangle])
+			{
+				continue;
+			}
+
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				auto index = indices[triangle * 3 + corner];
+
+				result.push_back(index);
+				dead_end.push_back(index);
+				candidates.push_back(index);
+
+				live_triangles[index]--;
+
+				if (time_stamp - cache_time[index] > cache_size)
+				{
+					cache_time[index] = time_stamp++;
+				}
+			}
+
+			emitted[triangle] = true;
+		}
+
+		// Continue from the candidate which stays in the cache the longest once fanned
+		int64_t next          = -1;
+		int64_t best_priority = -1;
+
+		for (auto candidate : candidates)
+		{
+			if (live_triangles[candidate] == 0)
+			{
+				continue;
+			}
+
+			int64_t priority = 0;
+
+			if (time_stamp - cache_time[candidate] + 2 * live_triangles[candidate] <= cache_size)
+			{
+				priority = time_stamp - cache_time[candidate];
+			}
+
+			if (priority > best_priority)
+			{
+				best_priority = priority;
+				next          = candidate;
+			}
+		}
+
+		if (next < 0)
+		{
+			// Dead end, restart from a recently used vertex or the next one in order
+			while (!dead_end.empty() && next < 0)
+			{
+				auto candidate = dead_end.back();
+				dead_end.pop_back();
+
+				if (live_triangles[candidate] > 0)
+				{
+					next = candidate;
+				}
+			}
+
+			while (cursor < vertex_count && next < 0)
+			{
+				if (live_triangles[cursor] > 0)
+				{
+					next = cursor;
+				}
+
+				cursor++;
+			}
+
+			auto emitted_triangles = to_u32(result.size() / 3);
+
+			if (next >= 0 && emitted_triangles != clusters.back())
+			{
+				clusters.push_back(emitted_triangles);
+			}
+		}
+
+		fanning = next;
+	}
+
+	return result;
+}
+
+/**
+ * @brief Sorts the clusters by how far their area weighted centroid lies in the direction of their
+ *        average normal, relative to the centroid of the mesh, so that the ones more likely to occlude
+ *        the others are drawn first from any view point
+ */
+void sort_clusters(std::vector<uint32_t> &indices, const std::vector<uint32_t> &clusters, const uint8_t *positions, uint32_t position_stride)
+{
+	if (clusters.size() < 2)
+	{
+		return;
+	}
+
+	auto triangle_count = to_u32(indices.size() / 3);
+
+	glm::vec3 mesh_centroid{0.0f};
+
+	for (auto index : indices)
+	{
+		mesh_centroid += get_position(positions, position_stride, index);
+	}
+
+	mesh_centroid /= static_cast<float>(indices.size());
+
+	std::vector<std::pair<float, uint32_t>> cluster_keys;
+
+	for (uint32_t cluster = 0; cluster < clusters.size(); cluster++)
+	{
+		uint32_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangle_count;
+
+		glm::vec3 centroid{0.0f};
+		glm::vec3 normal{0.0f};
+		float     area = 0.0f;
+
+		for (uint32_t triangle = clusters[cluster]; triangle < end; triangle++)
+		{
+			auto p0 = get_position(positions, position_stride, indices[triangle * 3]);
+			auto p1 = get_position(positions, position_stride, indices[triangle * 3 + 1]);
+			auto p2 = get_position(positions, position_stride, indices[triangle * 3 + 2]);
+
+			auto  triangle_normal = glm::cross(p1 - p0, p2 - p0);
+			float triangle_area   = glm::length(triangle_normal);
+
+			centroid += (p0 + p1 + p2) * (triangle_area / 3.0f);
+			normal += triangle_normal;
+			area += triangle_area;
+		}
+
+		float normal_length = glm::length(normal);
+		float key           = 0.0f;
+
+		if (area > 0.0f && normal_length > 0.0f)
+		{
+			key = glm::dot(centroid / area - mesh_centroid, normal / normal_length);
+		}
+
+		cluster_keys.emplace_back(key, cluster);
+	}
+
+	std::stable_sort(cluster_keys.begin(), cluster_keys.end(),
+	                 [](const std::pair<float, uint32_t> &a, const std::pair<float, uint32_t> &b) { return a.first > b.first; });
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(indices.size());
+
+	for (auto &cluster_key : cluster_keys)
+	{
+		auto     cluster = cluster_key.second;
+		uint32_t end     = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangle_count;
+
+		sorted.insert(sorted.end(), indices.begin() + clusters[cluster] * 3, indices.begin() + end * 3);
+	}
+
+	indices = std::move(sorted);
+}
+}        // namespace
+
+OptimizedMesh optimize_mesh(const std::vector<uint32_t> &indices, uint32_t vertex_count, const uint8_t *positions, uint32_t position_stride, uint32_t cache_size)
+{
+	OptimizedMesh mesh;
+
+	bool valid = indices.size() % 3 == 0 &&
+	             std::all_of(indices.begin(), indices.end(), [vertex_count](uint32_t index) { return index < vertex_count; });
+
+	if (valid)
+	{
+		std::vector<uint32_t> clusters;
+
+		mesh.indices = tipsify(indices, vertex_count, cache_size, clusters);
+
+		sort_clusters(mesh.indices, clusters, positions, position_stride);
+	}
+	else
+	{
+		LOGW("Mesh indices are not a valid triangle list, only remapping the vertices");
+
+		mesh.indices = indices;
+	}
+
+	// Vertices are stored in the order they are first used
+	mesh.vertex_remap.assign(vertex_count, UNUSED_VERTEX);
+
+	for (auto &index : mesh.indices)
+	{
+		if (index >= vertex_count)
+		{
+			continue;
+		}
+
+		if (mesh.vertex_remap[index] == UNUSED_VERTEX)
+		{
+			mesh.vertex_remap[index] = mesh.vertex_count++;
+		}
+
+		index = mesh.vertex_remap[index];
+	}
+
+	return mesh;
+}
+
+std::vector<uint32_t> simplify_mesh(const std::vector<uint32_t> &indices, uint32_t vertex_count, const uint8_t *positions, uint32_t position_stride, uint32_t grid_resolution)
+{
+	std::vector<uint32_t> result;
+
+	if (indices.size() % 3 != 0 || grid_resolution == 0 ||
+	    !std::all_of(indices.begin(), indices.end(), [vertex_count](uint32_t index) { return index < vertex_count; }))
+	{
+		return result;
+	}
+
+	glm::vec3 min{std::numeric_limits<float>::max()};
+	glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+	for (auto index : indices)
+	{
+		auto position = get_position(positions, position_stride, index);
+
+		min = glm::min(min, position);
+		max = glm::max(max, position);
+	}
+
+	auto  size      = max - min;
+	float cell_size = std::max(std::max(size.x, size.y), size.z) / grid_resolution;
+
+	if (!(cell_size > 0.0f))
+	{
+		return result;
+	}
+
+	// The first vertex found in a cell represents all the vertices of the cell
+	std::unordered_map<uint64_t, uint32_t> cell_vertices;
+
+	std::vector<uint32_t> vertex_remap(vertex_count, UNUSED_VERTEX);
+
+	for (auto index : indices)
+	{
+		if (vertex_remap[index] != UNUSED_VERTEX)
+		{
+			continue;
+		}
+
+		auto cell = glm::min(glm::uvec3((get_position(positions, position_stride, index) - min) / cell_size), glm::uvec3(grid_resolution - 1));
+
+		uint64_t key = (static_cast<uint64_t>(cell.z) * grid_resolution + cell.y) * grid_resolution + cell.x;
+
+		vertex_remap[index] = cell_vertices.emplace(key, index).first->second;
+	}
+
+	// Triangles which collapse to the same vertices are kept once, the first one found keeps its place
+	std::vector<std::pair<std::array<uint32_t, 3>, uint32_t>> triangles;
+	triangles.reserve(indices.size() / 3);
+
+	for (uint32_t triangle = 0; triangle < indices.size() / 3; triangle++)
+	{
+		std::array<uint32_t, 3> vertices{vertex_remap[indices[triangle * 3]], vertex_remap[indices[triangle * 3 + 1]], vertex_remap[indices[triangle * 3 + 2]]};
+
+		if (vertices[0] == vertices[1] || vertices[1] == vertices[2] || vertices[2] == vertices[0])
+		{
+			continue;
+		}
+
+		// Rotate the smallest index first, which keeps the winding
+		std::rotate(vertices.begin(), std::min_element(vertices.begin(), vertices.end()), vertices.end());
+
+		triangles.emplace_back(vertices, triangle);
+	}
+
+	std::sort(triangles.begin(), triangles.end());
+
+	triangles.erase(std::unique(triangles.begin(), triangles.end(),
+	                            [](const std::pair<std::array<uint32_t, 3>, uint32_t> &a, const std::pair<std::array<uint32_t, 3>, uint32_t> &b) { return a.first == b.first; }),
+	                triangles.end());
+
+	std::sort(triangles.begin(), triangles.end(),
+	          [](const std::pair<std::array<uint32_t, 3>, uint32_t> &a, const std::pair<std::array<uint32_t, 3>, uint32_t> &b) { return a.second < b.second; });
+
+	result.reserve(triangles.size() * 3);
+
+	for (auto &triangle : triangles)
+	{
+		result.insert(result.end(), triangle.first.begin(), triangle.first.end());
+	}
+
+	return result;
+}
+
+std::vector<uint8_t> remap_vertex_data(const std::vector<uint8_t> &data, uint32_t stride, const OptimizedMesh &mesh)
+{
+	std::vector<uint8_t> result(static_cast<size_t>(mesh.vertex_count) * stride);
+
+	for (size_t vertex = 0; vertex < mesh.vertex_remap.size(); vertex++)
+	{
+		auto new_vertex = mesh.vertex_remap[vertex];
+
+		if (new_vertex != UNUSED_VERTEX && (vertex + 1) * stride <= data.size())
+		{
+			std::memcpy(result.data() + static_cast<size_t>(new_vertex) * stride, data.data() + vertex * stride, stride);
+		}
+	}
+
+	return result;
+}
+
+MeshOptimizerCache::MeshOptimizerCache(const std::string &filename) :
+    filename{filename}
+{
+	std::vector<uint8_t> data;
+
+	try
+	{
+		data = fs::read_temp_blob(filename);
+	}
+	catch (const std::runtime_error &)
+	{
+		LOGI("No mesh optimizer cache found at {}", filename);
+		return;
+	}
+
+	size_t offset = 0;
+
+	auto read = [&data, &offset](void *dst, size_t size) {
+		if (offset + size > data.size())
+		{
+			return false;
+		}
+
+		std::memcpy(dst, data.data() + offset, size);
+		offset += size;
+
+		return true;
+	};
+
+	uint32_t header[3]{};
+
+	if (!read(header, sizeof(header)) || header[0] != MAGIC || header[1] != VERSION)
+	{
+		LOGW("Mesh optimizer cache {} has an unsupported version, ignoring it", filename);
+		return;
+	}
+
+	for (uint32_t entry = 0; entry < header[2]; entry++)
+	{
+		uint64_t key{0};
+		uint32_t sizes[3]{};
+
+		OptimizedMesh mesh;
+
+		if (!read(&key, sizeof(key)) || !read(sizes, sizeof(sizes)))
+		{
+			LOGW("Mesh optimizer cache {} is truncated", filename);
+			break;
+		}
+
+		mesh.indices.resize(sizes[0]);
+		mesh.vertex_remap.resize(sizes[1]);
+		mesh.vertex_count = sizes[2];
+
+		if (!read(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t)) ||
+		    !read(mesh.vertex_remap.data(), mesh.vertex_remap.size() * sizeof(uint32_t)))
+		{
+			LOGW("Mesh optimizer cache {} is truncated", filename);
+			break;
+		}
+
+		meshes.emplace(key, std::move(mesh));
+	}
+}
+
+uint64_t MeshOptimizerCache::get_key(const std::vector<uint32_t> &indices, uint32_t vertex_count, const uint8_t *positions, uint32_t position_stride)
+{
+	uint64_t key = hash_bytes(indices, vertex_count);
+
+	for (uint32_t vertex = 0; vertex < vertex_count; vertex++)
+	{
+		key = hash_bytes(positions + static_cast<size_t>(vertex) * position_stride, sizeof(glm::vec3), key);
+	}
+
+	return key;
+}
+
+bool MeshOptimizerCache::find(uint64_t key, OptimizedMesh &mesh)
+{
+	std::lock_guard<std::mutex> guard{mutex};
+
+	auto mesh_it = meshes.find(key);
+
+	if (mesh_it == meshes.end())
+	{
+		return false;
+	}
+
+	mesh = mesh_it->second;
+
+	return true;
+}
+
+void MeshOptimizerCache::insert(uint64_t key, const OptimizedMesh &mesh)
+{
+	std::lock_guard<std::mutex> guard{mutex};
+
+	meshes[key] = mesh;
+
+	modified = true;
+}
+
+void MeshOptimizerCache::save()
+{
+	std::lock_guard<std::mutex> guard{mutex};
+
+	if (!modified)
+	{
+		return;
+	}
+
+	std::vector<uint8_t> data;
+
+	auto write = [&data](const void *src, size_t size) {
+		auto bytes = reinterpret_cast<const uint8_t *>(src);
+		data.insert(data.end(), bytes, bytes + size);
+	};
+
+	uint32_t header[3]{MAGIC, VERSION, to_u32(meshes.size())};
+	write(header, sizeof(header));
+
+	for (auto &mesh : meshes)
+	{
+		uint32_t sizes[3]{to_u32(mesh.second.indices.size()), to_u32(mesh.second.vertex_remap.size()), mesh.second.vertex_count};
+
+		write(&mesh.first, sizeof(mesh.first));
+		write(sizes, sizeof(sizes));
+		write(mesh.second.indices.data(), mesh.second.indices.size() * sizeof(uint32_t));
+		write(mesh.second.vertex_remap.data(), mesh.second.vertex_remap.size() * sizeof(uint32_t));
+	}
+
+	fs::write_temp_blob(data, filename);
+
+	modified = false;
+
+	LOGI("Saved {} optimized meshes to {}", meshes.size(), filename);
+}
+}        // namespace vkb
@@ -0,0 +1,125 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vkb
+{
+/**
+ * @brief Triangle list reordered by optimize_mesh
+ */
+struct OptimizedMesh
+{
+	/// Reordered triangles, indexing the remapped vertices
+	std::vector<uint32_t> indices;
+
+	/// New index of every original vertex, ~0u for the vertices which are not referenced
+	std::vector<uint32_t> vertex_remap;
+
+	/// Number of vertices left after remapping
+	uint32_t vertex_count{0};
+};
+
+/**
+ * @brief Reorders the triangles of a mesh for the post-transform vertex cache (tipsify),
+ *        then sorts the clusters of triangles found on the way so that those facing outwards
+ *        are drawn first, to reduce overdraw, and finally remaps the vertices in the order
+ *        they are fetched
+ * @param indices Triangle list indices
+ * @param vertex_count Number of vertices referenced by the indices
+ * @param positions Float3 positions of the vertices
+ * @param position_stride Byte stride between two positions
+ * @param cache_size Number of vertices the post-transform cache is assumed to hold
+ * @return The optimized indices and vertex remap table
+ */
+OptimizedMesh optimize_mesh(const std::vector<uint32_t> &indices, uint32_t vertex_count, const uint8_t *positions, uint32_t position_stride, uint32_t cache_size = 16);
+
+/**
+ * @brief Simplifies a mesh by vertex clustering: the vertices are snapped to the first vertex found in
+ *        their cell of a uniform grid over the bounds, and the triangles which collapse are removed.
+ *        No vertex is added, so the result indexes the same vertex buffers
+ * @param indices Triangle list indices
+ * @param vertex_count Number of vertices referenced by the indices
+ * @param positions Float3 positions of the vertices
+ * @param position_stride Byte stride between two positions
+ * @param grid_resolution Number of cells along the largest side of the bounds
+ * @return The indices of the remaining triangles, in their original order
+ */
+std::vector<uint32_t> simplify_mesh(const std::vector<uint32_t> &indices, uint32_t vertex_count, const uint8_t *positions, uint32_t position_stride, uint32_t grid_resolution);
+
+/**
+ * @brief Copies the vertices of a buffer to their remapped location
+ * @param data Vertex data to remap
+ * @param stride Byte stride between two vertices
+ * @param mesh The result of optimize_mesh for the vertices
+ * @return The remapped vertex data
+ */
+std::vector<uint8_t> remap_vertex_data(const std::vector<uint8_t> &data, uint32_t stride, const OptimizedMesh &mesh);
+
+/**
+ * @brief Stores the results of optimize_mesh in a file in temporary storage,
+ *        so that the optimization of an asset only runs once. Access is thread safe.
+ */
+class MeshOptimizerCache
+{
+  public:
+	/**
+	 * @brief Reads the results stored in a file, if it exists and has the current version
+	 * @param filename The path to the file (relative to the temporary storage directory)
+	 */
+	MeshOptimizerCache(const std::string &filename);
+
+	/**
+	 * @brief Hashes the input of optimize_mesh
+	 */
+	static uint64_t get_key(const std::vector<uint32_t> &indices, uint32_t vertex_count, const uint8_t *positions, uint32_t position_stride);
+
+	/**
+	 * @return True if the result for a key is stored, in which case it is copied to mesh
+	 */
+	bool find(uint64_t key, OptimizedMesh &mesh);
+
+	void insert(uint64_t key, const OptimizedMesh &mesh);
+
+	/**
+	 * @brief Writes the file if results were inserted since it was read
+	 */
+	void save();
+
+  private:
+	static const uint32_t MAGIC = 0x5a4f4d56;
+
+	static const uint32_t VERSION = 1;
+
+	std::string filename;
+
+	std::unordered_map<uint64_t, OptimizedMesh> meshes;
+
+	std::mutex mutex;
+
+	bool modified{false};
+};
+}        // namespace vkb
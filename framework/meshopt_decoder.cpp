@@ -0,0 +1,554 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "meshopt_decoder.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace vkb
+{
+namespace
+{
+const uint8_t VERTEX_HEADER = 0xa0;
+
+const uint8_t TRIANGLE_HEADER = 0xe0;
+
+const uint8_t SEQUENCE_HEADER = 0xd0;
+
+/// Vertex bytes are encoded in groups of 16, with 0, 2, 4 or 8 bits per delta
+const size_t BYTE_GROUP_SIZE = 16;
+
+/// A group reads at most 24 bytes, valid streams are followed by a tail that large at least
+const size_t BYTE_GROUP_DECODE_LIMIT = 24;
+
+const size_t VERTEX_BLOCK_SIZE_BYTES = 8192;
+
+const size_t VERTEX_BLOCK_MAX_SIZE = 256;
+
+const size_t VERTEX_TAIL_MIN_SIZE = 32;
+
+[[noreturn]] void throw_malformed()
+{
+	throw std::runtime_error("Malformed EXT_meshopt_compression buffer view");
+}
+
+/**
+ * @brief Decodes a group of 16 deltas packed with 2 or 4 bits each, the largest value
+ *        meaning the delta follows the packed ones in a full byte
+ */
+const uint8_t *decode_bits_group(const uint8_t *data, uint8_t *output, uint32_t bits)
+{
+	const uint8_t *packed   = data;
+	const uint8_t *escaped  = data + BYTE_GROUP_SIZE * bits / 8;
+	uint32_t       sentinel = (1u << bits) - 1;
+
+	for (size_t i = 0; i < BYTE_GROUP_SIZE; i++)
+	{
+		// Values are packed from the most significant bits
+		uint32_t shift = 8 - bits - (i * bits) % 8;
+		uint32_t value = (packed[i * bits / 8] >> shift) & sentinel;
+
+		output[i] = value == sentinel ? *escaped++ : static_cast<uint8_t>(value);
+	}
+
+	return escaped;
+}
+
+/**
+ * @brief Decodes the deltas of a byte of the vertices of a block, count a multiple of the group size
+ */
+const uint8_t *decode_bytes(const uint8_t *data, const uint8_t *data_end, uint8_t *output, size_t count)
+{
+	// Two bits per group select their bit count
+	const uint8_t *header      = data;
+	size_t         header_size = (count / BYTE_GROUP_SIZE + 3) / 4;
+
+	if (static_cast<size_t>(data_end - data) < header_size)
+	{
+		throw_malformed();
+	}
+
+	data += header_size;
+
+	for (size_t group = 0; group < count / BYTE_GROUP_SIZE; group++)
+	{
+		if (static_cast<size_t>(data_end - data) < BYTE_GROUP_DECODE_LIMIT)
+		{
+			throw_malformed();
+		}
+
+		uint8_t *group_output = output + group * BYTE_GROUP_SIZE;
+
+		switch ((header[group / 4] >> ((group % 4) * 2)) & 3)
+		{
+			case 0:
+				std::fill_n(group_output, BYTE_GROUP_SIZE, uint8_t{0});
+				break;
+			case 1:
+				data = decode_bits_group(data, group_output, 2);
+				break;
+			case 2:
+				data = decode_bits_group(data, group_output, 4);
+				break;
+			default:
+				std::memcpy(group_output, data, BYTE_GROUP_SIZE);
+				data += BYTE_GROUP_SIZE;
+				break;
+		}
+	}
+
+	return data;
+}
+
+void decode_attributes(uint8_t *destination, size_t count, size_t stride, const uint8_t *source, size_t source_size)
+{
+	if (stride == 0 || stride > 256 || stride % 4 != 0)
+	{
+		throw_malformed();
+	}
+
+	const uint8_t *data     = source;
+	const uint8_t *data_end = source + source_size;
+
+	if (source_size < 1 + stride || (*data & 0xf0) != VERTEX_HEADER || (*data & 0x0f) > 0)
+	{
+		throw_malformed();
+	}
+
+	data++;
+
+	// Deltas are relative to the previous vertex, the first one to the vertex stored at the end of the data
+	std::array<uint8_t, 256> last_vertex;
+	std::memcpy(last_vertex.data(), data_end - stride, stride);
+
+	size_t block_size = std::min((VERTEX_BLOCK_SIZE_BYTES / stride) & ~(BYTE_GROUP_SIZE - 1), VERTEX_BLOCK_MAX_SIZE);
+
+	std::array<uint8_t, VERTEX_BLOCK_MAX_SIZE> deltas;
+
+	for (size_t first = 0; first < count; first += block_size)
+	{
+		size_t block_count         = std::min(block_size, count - first);
+		size_t block_count_aligned = (block_count + BYTE_GROUP_SIZE - 1) & ~(BYTE_GROUP_SIZE - 1);
+
+		uint8_t *block = destination + first * stride;
+
+		// Each byte of the vertices is encoded separately, the bytes of an attribute compress better together
+		for (size_t k = 0; k < stride; k++)
+		{
+			data = decode_bytes(data, data_end, deltas.data(), block_count_aligned);
+
+			uint8_t previous = last_vertex[k];
+
+			for (size_t i = 0; i < block_count; i++)
+			{
+				// Zigzag encoded
+				uint8_t delta = static_cast<uint8_t>((deltas[i] >> 1) ^ (0u - (deltas[i] & 1u)));
+
+				previous = static_cast<uint8_t>(previous + delta);
+
+				block[i * stride + k] = previous;
+			}
+
+			last_vertex[k] = previous;
+		}
+	}
+
+	if (static_cast<size_t>(data_end - data) != std::max(stride, VERTEX_TAIL_MIN_SIZE))
+	{
+		throw_malformed();
+	}
+}
+
+uint32_t decode_vbyte(const uint8_t *&data)
+{
+	uint8_t lead = *data++;
+
+	if (lead < 128)
+	{
+		return lead;
+	}
+
+	uint32_t result = lead & 127;
+	uint32_t shift  = 7;
+
+	for (int i = 0; i < 4; i++)
+	{
+		uint8_t group = *data++;
+		result |= static_cast<uint32_t>(group & 127) << shift;
+		shift += 7;
+
+		if (group < 128)
+		{
+			break;
+		}
+	}
+
+	return result;
+}
+
+uint32_t decode_index(const uint8_t *&data, uint32_t last)
+{
+	uint32_t value = decode_vbyte(data);
+
+	return last + ((value >> 1) ^ (0u - (value & 1u)));
+}
+
+void write_index(uint8_t *destination, size_t index, size_t stride, uint32_t value)
+{
+	if (stride == 2)
+	{
+		auto value_16 = static_cast<uint16_t>(value);
+		std::memcpy(destination + index * 2, &value_16, 2);
+	}
+	else
+	{
+		std::memcpy(destination + index * 4, &value, 4);
+	}
+}
+
+/**
+ * @brief Decodes triangles, each reusing an edge or vertices of the recent ones through FIFOs of 16 entries
+ */
+void decode_triangles(uint8_t *destination, size_t count, size_t stride, const uint8_t *source, size_t source_size)
+{
+	if (count % 3 != 0 || (stride != 2 && stride != 4))
+	{
+		throw_malformed();
+	}
+
+	// At least a header, a code per triangle and the table of the auxiliary codes
+	if (source_size < 1 + count / 3 + 16 || (source[0] & 0xf0) != TRIANGLE_HEADER || (source[0] & 0x0f) != 1)
+	{
+		throw_malformed();
+	}
+
+	std::array<std::array<uint32_t, 2>, 16> edge_fifo;
+	std::array<uint32_t, 16>                vertex_fifo;
+
+	for (auto &edge : edge_fifo)
+	{
+		edge = {~0u, ~0u};
+	}
+
+	vertex_fifo.fill(~0u);
+
+	size_t   edge_offset   = 0;
+	size_t   vertex_offset = 0;
+	uint32_t next          = 0;
+	uint32_t last          = 0;
+
+	auto push_edge = [&](uint32_t a, uint32_t b) {
+		edge_fifo[edge_offset] = {a, b};
+		edge_offset            = (edge_offset + 1) & 15;
+	};
+
+	auto push_vertex = [&](uint32_t v, bool push = true) {
+		vertex_fifo[vertex_offset] = v;
+		vertex_offset              = (vertex_offset + (push ? 1 : 0)) & 15;
+	};
+
+	const uint8_t *code      = source + 1;
+	const uint8_t *data      = code + count / 3;
+	const uint8_t *data_end  = source + source_size - 16;
+	const uint8_t *aux_table = data_end;
+
+	for (size_t i = 0; i < count; i += 3)
+	{
+		// A triangle reads 16 bytes at most, the size of the table after the data
+		if (data > data_end)
+		{
+			throw_malformed();
+		}
+
+		uint8_t code_triangle = *code++;
+
+		uint32_t a, b, c;
+
+		if (code_triangle < 0xf0)
+		{
+			// An edge of a recent triangle, and a new, recent or explicit third vertex
+			auto &edge = edge_fifo[(edge_offset - 1 - (code_triangle >> 4)) & 15];
+			a          = edge[0];
+			b          = edge[1];
+
+			uint32_t fec = code_triangle & 15;
+
+			if (fec < 13)
+			{
+				c = fec == 0 ? next++ : vertex_fifo[(vertex_offset - 1 - fec) & 15];
+
+				push_vertex(c, fec == 0);
+			}
+			else
+			{
+				// 13 and 14 are the last explicit index -1 and +1
+				last = c = fec != 15 ? last + (fec == 13 ? ~0u : 1u) : decode_index(data, last);
+
+				push_vertex(c);
+			}
+
+			push_edge(c, b);
+			push_edge(a, c);
+		}
+		else
+		{
+			uint32_t fea, feb, fec;
+
+			if (code_triangle < 0xfe)
+			{
+				// Common combinations of three new or recent vertices are in the table
+				uint8_t code_aux = aux_table[code_triangle & 15];
+				fea              = 0;
+				feb              = code_aux >> 4;
+				fec              = code_aux & 15;
+			}
+			else
+			{
+				uint8_t code_aux = *data++;
+				fea              = code_triangle == 0xfe ? 0 : 15;
+				feb              = code_aux >> 4;
+				fec              = code_aux & 15;
+
+				// Restarts the numbering of the new vertices
+				if (code_aux == 0)
+				{
+					next = 0;
+				}
+			}
+
+			// The new vertices are numbered before the explicit indices are read, as encoded
+			a = fea == 0 ? next++ : 0;
+			b = feb == 0 ? next++ : vertex_fifo[(vertex_offset - feb) & 15];
+			c = fec == 0 ? next++ : vertex_fifo[(vertex_offset - fec) & 15];
+
+			if (fea == 15)
+			{
+				last = a = decode_index(data, last);
+			}
+			if (feb == 15)
+			{
+				last = b = decode_index(data, last);
+			}
+			if (fec == 15)
+			{
+				last = c = decode_index(data, last);
+			}
+
+			push_vertex(a);
+			push_vertex(b, feb == 0 || feb == 15);
+			push_vertex(c, fec == 0 || fec == 15);
+
+			push_edge(b, a);
+			push_edge(c, b);
+			push_edge(a, c);
+		}
+
+		write_index(destination, i + 0, stride, a);
+		write_index(destination, i + 1, stride, b);
+		write_index(destination, i + 2, stride, c);
+	}
+
+	if (data != data_end)
+	{
+		throw_malformed();
+	}
+}
+
+/**
+ * @brief Decodes indices as deltas from one of two baselines, such as the two ends of a strip
+ */
+void decode_sequence(uint8_t *destination, size_t count, size_t stride, const uint8_t *source, size_t source_size)
+{
+	if (stride != 2 && stride != 4)
+	{
+		throw_malformed();
+	}
+
+	// At least a header, a byte per index and a tail of 4 bytes
+	if (source_size < 1 + count + 4 || (source[0] & 0xf0) != SEQUENCE_HEADER || (source[0] & 0x0f) > 1)
+	{
+		throw_malformed();
+	}
+
+	const uint8_t *data     = source + 1;
+	const uint8_t *data_end = source + source_size - 4;
+
+	std::array<uint32_t, 2> last{};
+
+	for (size_t i = 0; i < count; i++)
+	{
+		// An index reads 5 bytes at most, within the tail
+		if (data >= data_end)
+		{
+			throw_malformed();
+		}
+
+		uint32_t value    = decode_vbyte(data);
+		uint32_t baseline = value & 1;
+
+		value >>= 1;
+
+		last[baseline] += (value >> 1) ^ (0u - (value & 1u));
+
+		write_index(destination, i, stride, last[baseline]);
+	}
+
+	if (data != data_end)
+	{
+		throw_malformed();
+	}
+}
+
+inline int32_t round_to_int(float value)
+{
+	return static_cast<int32_t>(value + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+template <typename T>
+void decode_octahedral(uint8_t *data, size_t count)
+{
+	const float max = static_cast<float>((1 << (sizeof(T) * 8 - 1)) - 1);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		std::array<T, 4> v;
+		std::memcpy(v.data(), data + i * sizeof(v), sizeof(v));
+
+		// z encodes 1 with the bit count of x and y
+		float x = static_cast<float>(v[0]);
+		float y = static_cast<float>(v[1]);
+		float z = static_cast<float>(v[2]) - std::abs(x) - std::abs(y);
+
+		// Folds the lower hemisphere
+		float t = std::min(z, 0.0f);
+		x += x >= 0.0f ? t : -t;
+		y += y >= 0.0f ? t : -t;
+
+		float scale = max / std::sqrt(x * x + y * y + z * z);
+
+		v[0] = static_cast<T>(round_to_int(x * scale));
+		v[1] = static_cast<T>(round_to_int(y * scale));
+		v[2] = static_cast<T>(round_to_int(z * scale));
+
+		std::memcpy(data + i * sizeof(v), v.data(), sizeof(v));
+	}
+}
+
+void decode_quaternion(uint8_t *data, size_t count)
+{
+	const float scale = 1.0f / std::sqrt(2.0f);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		std::array<int16_t, 4> v;
+		std::memcpy(v.data(), data + i * sizeof(v), sizeof(v));
+
+		// The fourth component holds the scale of the others, and the index of the largest one in its two low bits
+		float s = scale / static_cast<float>(v[3] | 3);
+
+		float x = static_cast<float>(v[0]) * s;
+		float y = static_cast<float>(v[1]) * s;
+		float z = static_cast<float>(v[2]) * s;
+		float w = std::sqrt(std::max(1.0f - x * x - y * y - z * z, 0.0f));
+
+		int largest = v[3] & 3;
+
+		v[(largest + 1) & 3] = static_cast<int16_t>(round_to_int(x * 32767.0f));
+		v[(largest + 2) & 3] = static_cast<int16_t>(round_to_int(y * 32767.0f));
+		v[(largest + 3) & 3] = static_cast<int16_t>(round_to_int(z * 32767.0f));
+		v[largest]           = static_cast<int16_t>(round_to_int(w * 32767.0f));
+
+		std::memcpy(data + i * sizeof(v), v.data(), sizeof(v));
+	}
+}
+
+void decode_exponential(uint8_t *data, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t v;
+		std::memcpy(&v, data + i * 4, 4);
+
+		// Signed 24-bit mantissa and signed 8-bit exponent
+		auto mantissa = static_cast<int32_t>(v << 8) >> 8;
+		auto exponent = static_cast<int32_t>(v) >> 24;
+
+		float value = std::ldexp(static_cast<float>(mantissa), exponent);
+
+		std::memcpy(data + i * 4, &value, 4);
+	}
+}
+}        // namespace
+
+void decode_meshopt(uint8_t *destination, size_t count, size_t stride, const uint8_t *source, size_t source_size, MeshoptMode mode, MeshoptFilter filter)
+{
+	switch (mode)
+	{
+		case MeshoptMode::Attributes:
+			decode_attributes(destination, count, stride, source, source_size);
+			break;
+		case MeshoptMode::Triangles:
+			decode_triangles(destination, count, stride, source, source_size);
+			break;
+		case MeshoptMode::Indices:
+			decode_sequence(destination, count, stride, source, source_size);
+			break;
+	}
+
+	if (filter != MeshoptFilter::None && mode != MeshoptMode::Attributes)
+	{
+		throw_malformed();
+	}
+
+	switch (filter)
+	{
+		case MeshoptFilter::None:
+			break;
+		case MeshoptFilter::Octahedral:
+			if (stride == 4)
+			{
+				decode_octahedral<int8_t>(destination, count);
+			}
+			else if (stride == 8)
+			{
+				decode_octahedral<int16_t>(destination, count);
+			}
+			else
+			{
+				throw_malformed();
+			}
+			break;
+		case MeshoptFilter::Quaternion:
+			if (stride != 8)
+			{
+				throw_malformed();
+			}
+			decode_quaternion(destination, count);
+			break;
+		case MeshoptFilter::Exponential:
+			decode_exponential(destination, count * stride / 4);
+			break;
+	}
+}
+}        // namespace vkb
@@ -0,0 +1,73 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vkb
+{
+/**
+ * @brief Layout of the data of a buffer view compressed with EXT_meshopt_compression
+ */
+enum class MeshoptMode
+{
+	/// Vertex attributes, delta encoded per byte across the vertices
+	Attributes,
+
+	/// Triangle list indices, encoded through the edges and vertices shared with recent triangles
+	Triangles,
+
+	/// Any other indices, delta encoded from two baselines
+	Indices
+};
+
+/**
+ * @brief Transform of the decoded vertex attributes, which recovers values quantized further than their type
+ */
+enum class MeshoptFilter
+{
+	None,
+
+	/// Unit vectors from octahedral coordinates, 8 or 16-bit signed normalized
+	Octahedral,
+
+	/// Unit quaternions from their three smallest components, 16-bit signed normalized
+	Quaternion,
+
+	/// 32-bit floats from a 24-bit mantissa and an 8-bit exponent
+	Exponential
+};
+
+/**
+ * @brief Decodes a buffer view compressed with EXT_meshopt_compression, as specified by the extension.
+ *        Buffer views are independent, so several can be decoded concurrently to separate memory.
+ *        Throws a std::runtime_error if the data is malformed
+ * @param[out] destination The decoded data, count * stride bytes
+ * @param count Number of elements
+ * @param stride Size of an element in bytes, a multiple of 4 up to 256 for attributes, 2 or 4 for indices
+ * @param source The compressed data
+ * @param source_size Size of the compressed data in bytes
+ * @param mode Layout of the data
+ * @param filter Transform applied to the decoded attributes
+ */
+void decode_meshopt(uint8_t *destination, size_t count, size_t stride, const uint8_t *source, size_t source_size, MeshoptMode mode, MeshoptFilter filter = MeshoptFilter::None);
+}        // namespace vkb
@@ -0,0 +1,126 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "perf_lint.h"
+
+#include "common/logging.h"
+
+namespace vkb
+{
+namespace
+{
+const char *get_advice(PerfIssue issue)
+{
+	switch (issue)
+	{
+		case PerfIssue::ClearAtSubpassStart:
+			return "use VK_ATTACHMENT_LOAD_OP_CLEAR instead";
+		case PerfIssue::TransientAttachmentStored:
+			return "use VK_ATTACHMENT_LOAD_OP_DONT_CARE and VK_ATTACHMENT_STORE_OP_DONT_CARE for transient attachments";
+		case PerfIssue::BottomToTopBarrier:
+			return "wait for the stages which produce the data, in the stages which consume it";
+		case PerfIssue::DiscardedContentsPreserved:
+			return "transition from VK_IMAGE_LAYOUT_UNDEFINED when the contents are not loaded";
+		case PerfIssue::DescriptorSetAllocation:
+			return "keep the resources of the descriptor sets the same across frames, or use dynamic offsets";
+		case PerfIssue::IndividualCommandBufferReset:
+			return "reset the command pool of the frame instead";
+	}
+
+	return "";
+}
+}        // namespace
+
+const char *to_string(PerfIssue issue)
+{
+	switch (issue)
+	{
+		case PerfIssue::ClearAtSubpassStart:
+			return "Clear at subpass start";
+		case PerfIssue::TransientAttachmentStored:
+			return "Transient attachment stored";
+		case PerfIssue::BottomToTopBarrier:
+			return "Bottom to top barrier";
+		case PerfIssue::DiscardedContentsPreserved:
+			return "Discarded contents preserved";
+		case PerfIssue::DescriptorSetAllocation:
+			return "Descriptor set allocation";
+		case PerfIssue::IndividualCommandBufferReset:
+			return "Individual command buffer reset";
+	}
+
+	return "Unknown";
+}
+
+void PerfLint::set_enabled(bool enable)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	enabled = enable;
+
+	frame_issues.clear();
+	frame_offenders.clear();
+}
+
+void PerfLint::report(PerfIssue issue, const std::string &tag)
+{
+	if (!is_enabled())
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(mutex);
+
+	++frame_issues[Key{issue, tag}];
+}
+
+void PerfLint::end_frame()
+{
+	if (!is_enabled())
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(mutex);
+
+	frame_offenders.clear();
+
+	for (auto &frame_issue : frame_issues)
+	{
+		auto &key = frame_issue.first;
+
+		frame_offenders.push_back({key.first, key.second, frame_issue.second});
+
+		if (logged.insert(key).second)
+		{
+			LOGW("Perf lint: {} in \"{}\" ({} times this frame), {}", to_string(key.first), key.second, frame_issue.second, get_advice(key.first));
+		}
+	}
+
+	frame_issues.clear();
+}
+
+std::vector<PerfLint::Offender> PerfLint::get_frame_offenders() const
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	return frame_offenders;
+}
+}        // namespace vkb
@@ -0,0 +1,123 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vkb
+{
+/**
+ * @brief Patterns the samples teach to avoid, which almost always cost bandwidth or CPU time on tile-based GPUs
+ */
+enum class PerfIssue
+{
+	/// vkCmdClearAttachments before any draw of a subpass, instead of a clear load operation
+	ClearAtSubpassStart,
+	/// A transient attachment stored, or loaded, at the end or start of a render pass
+	TransientAttachmentStored,
+	/// A barrier from the bottom to the top of the pipe, which waits for all the previous work
+	BottomToTopBarrier,
+	/// An attachment transitioned from its last layout, preserving contents that the render pass clears or discards
+	DiscardedContentsPreserved,
+	/// Descriptor sets allocated again in frames where the scene did not change
+	DescriptorSetAllocation,
+	/// A command buffer reset on its own rather than with its pool
+	IndividualCommandBufferReset,
+};
+
+const char *to_string(PerfIssue issue);
+
+/**
+ * @brief Built-in linter for the command streams, the framework reporting the performance mistakes
+ *        of the application as a best practices validation layer would.
+ *        Disabled by default, the checks then cost a single branch. Once enabled, the command buffers
+ *        and the render context report the issues with a call-site tag, the debug label of the commands.
+ *        Each offender is logged the first frame it appears, the ones of the last frame are kept.
+ *        Issues can be reported from any thread.
+ */
+class PerfLint
+{
+  public:
+	/**
+	 * @brief An issue found in a frame, at a call site
+	 */
+	struct Offender
+	{
+		PerfIssue issue;
+
+		std::string tag;
+
+		/// Number of times the issue was found in the frame
+		uint32_t count{0};
+	};
+
+	PerfLint() = default;
+
+	PerfLint(const PerfLint &) = delete;
+
+	PerfLint &operator=(const PerfLint &) = delete;
+
+	void set_enabled(bool enable);
+
+	bool is_enabled() const
+	{
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Records an issue found, to be reported at the end of the frame
+	 * @param tag Where the issue was found, such as the debug label of the commands
+	 */
+	void report(PerfIssue issue, const std::string &tag);
+
+	/**
+	 * @brief Logs the offenders which are new, and keeps those of the frame ending
+	 */
+	void end_frame();
+
+	/**
+	 * @return The offenders found in the last frame which ended
+	 */
+	std::vector<Offender> get_frame_offenders() const;
+
+  private:
+	using Key = std::pair<PerfIssue, std::string>;
+
+	std::atomic<bool> enabled{false};
+
+	mutable std::mutex mutex;
+
+	/// Issues found in the current frame, with their count
+	std::map<Key, uint32_t> frame_issues;
+
+	std::vector<Offender> frame_offenders;
+
+	/// Offenders logged already, to log each once
+	std::set<Key> logged;
+};
+}        // namespace vkb
@@ -20,7 +20,13 @@
 
 #include "android_platform.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 #include <unordered_map>
 
@@ -77,6 +83,19 @@ namespace vkb
 {
 namespace
 {
+/// Time left for the scheduling jitter between the start of a frame and its deadline, in nanoseconds
+const int64_t FRAME_START_MARGIN = 2000000;
+
+/**
+ * @return The CLOCK_MONOTONIC time in nanoseconds, the clock of the choreographer
+ */
+inline int64_t get_monotonic_time()
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
 inline std::tm thread_safe_time(const std::time_t time)
 {
 	std::tm                     result;
@@ -327,7 +346,7 @@ int32_t on_input_event(android_app *app, AInputEvent *input_event)
 		int32_t key_code = AKeyEvent_getKeyCode(input_event);
 		int32_t action   = AKeyEvent_getAction(input_event);
 
-		platform->get_app().input_event(KeyInputEvent{
+		platform->input_event(KeyInputEvent{
 		    *platform,
 		    translate_key_code(key_code),
 		    translate_key_action(action)});
@@ -339,7 +358,7 @@ int32_t on_input_event(android_app *app, AInputEvent *input_event)
 		float x = AMotionEvent_getX(input_event, 0);
 		float y = AMotionEvent_getY(input_event, 0);
 
-		platform->get_app().input_event(MouseButtonInputEvent{
+		platform->input_event(MouseButtonInputEvent{
 		    *platform,
 		    translate_mouse_button(0),
 		    translate_mouse_action(action),
@@ -354,7 +373,7 @@ int32_t on_input_event(android_app *app, AInputEvent *input_event)
 		float x = AMotionEvent_getX(input_event, 0);
 		float y = AMotionEvent_getY(input_event, 0);
 
-		platform->get_app().input_event(TouchInputEvent{
+		platform->input_event(TouchInputEvent{
 		    *platform,
 		    pointer_id,
 		    pointer_count,
@@ -379,6 +398,43 @@ void create_directory(const std::string &path)
 		mkdir(path.c_str(), 0777);
 	}
 }
+
+const uint8_t *map_file(const std::string &path, size_t &size)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+
+	if (fd < 0)
+	{
+		return nullptr;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close(fd);
+		return nullptr;
+	}
+
+	size = static_cast<size_t>(info.st_size);
+
+	void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// The mapping stays valid after closing the descriptor
+	close(fd);
+
+	if (data == MAP_FAILED)
+	{
+		size = 0;
+		return nullptr;
+	}
+
+	return static_cast<const uint8_t *>(data);
+}
+
+void unmap_file(const uint8_t *data, size_t size)
+{
+	munmap(const_cast<uint8_t *>(data), size);
+}
 }        // namespace fs
 
 AndroidPlatform::AndroidPlatform(android_app *app) :
@@ -393,7 +449,37 @@ bool AndroidPlatform::initialize(std::unique_ptr<Application> &&application)
 	app->activity->callbacks->onContentRectChanged = on_content_rect_changed;
 	app->userData                                  = this;
 
-	return Platform::initialize(std::move(application));
+	if (!Platform::initialize(std::move(application)))
+	{
+		return false;
+	}
+
+	if (active_app->get_options().contains("--choreographer") && !load_choreographer())
+	{
+		LOGW("Choreographer not available, frames are not started from vsync callbacks");
+	}
+
+	// An archive stored uncompressed in the APK is mapped along with it, so its buffer is read in place
+	asset_archive = AAssetManager_open(app->activity->assetManager, fs::ASSET_ARCHIVE_NAME, AASSET_MODE_BUFFER);
+
+	if (asset_archive)
+	{
+		auto data = static_cast<const uint8_t *>(AAsset_getBuffer(asset_archive));
+
+		if (data && fs::mount_asset_archive(data, static_cast<size_t>(AAsset_getLength64(asset_archive))))
+		{
+			LOGI("Mounted the asset archive of the APK");
+		}
+		else
+		{
+			LOGW("Cannot map the asset archive of the APK, make sure it is stored uncompressed");
+
+			AAsset_close(asset_archive);
+			asset_archive = nullptr;
+		}
+	}
+
+	return true;
 }
 
 void AndroidPlatform::create_window()
@@ -411,9 +497,14 @@ void AndroidPlatform::main_loop()
 		int ident;
 		int events;
 
-		while ((ident = ALooper_pollAll(0, nullptr, &events,
+		// An idle application renders nothing until something changes, only the first poll blocks
+		int timeout = active_app && active_app->is_idle() ? static_cast<int>(IDLE_WAIT_TIMEOUT.count()) : 0;
+
+		while ((ident = ALooper_pollAll(timeout, nullptr, &events,
 		                                (void **) &source)) >= 0)
 		{
+			timeout = 0;
+
 			if (source)
 			{
 				source->process(app, source);
@@ -430,11 +521,357 @@ void AndroidPlatform::main_loop()
 			break;
 		}
 
-		if (!window->should_close())
+		if (window->should_close())
+		{
+			continue;
+		}
+
+		if (choreographer && !wait_for_frame_start())
+		{
+			continue;
+		}
+
+		auto work_start = get_monotonic_time();
+
+		run();
+
+		// The estimate follows slower frames at once, and faster ones gradually so that a single fast frame does not make the next one late
+		int64_t work_duration = get_monotonic_time() - work_start;
+
+		if (work_duration > frame_work_estimate)
+		{
+			frame_work_estimate = work_duration;
+		}
+		else
+		{
+			frame_work_estimate -= (frame_work_estimate - work_duration) / 16;
+		}
+	}
+}
+
+bool AndroidPlatform::load_choreographer()
+{
+	if (auto library = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL))
+	{
+		auto &api = choreographer_api;
+
+		api.get_instance                       = reinterpret_cast<void *(*) ()>(dlsym(library, "AChoreographer_getInstance"));
+		api.post_frame_callback                = reinterpret_cast<decltype(api.post_frame_callback)>(dlsym(library, "AChoreographer_postFrameCallback64"));
+		api.post_vsync_callback                = reinterpret_cast<decltype(api.post_vsync_callback)>(dlsym(library, "AChoreographer_postVsyncCallback"));
+		api.get_preferred_frame_timeline_index = reinterpret_cast<decltype(api.get_preferred_frame_timeline_index)>(dlsym(library, "AChoreographerFrameCallbackData_getPreferredFrameTimelineIndex"));
+		api.get_frame_timeline_deadline        = reinterpret_cast<decltype(api.get_frame_timeline_deadline)>(dlsym(library, "AChoreographerFrameCallbackData_getFrameTimelineDeadlineNanos"));
+
+		// The frame timelines are only used if all of their functions are available
+		if (!api.get_preferred_frame_timeline_index || !api.get_frame_timeline_deadline)
+		{
+			api.post_vsync_callback = nullptr;
+		}
+
+		if (api.get_instance && (api.post_frame_callback || api.post_vsync_callback))
+		{
+			// The choreographer of the thread, its callbacks run from the looper polled by main_loop
+			choreographer = api.get_instance();
+		}
+	}
+
+	if (choreographer)
+	{
+		LOGI("Frames start from choreographer {} callbacks", choreographer_api.post_vsync_callback ? "vsync" : "frame");
+	}
+
+	return choreographer != nullptr;
+}
+
+void AndroidPlatform::post_frame_callback()
+{
+	if (frame_callback_pending)
+	{
+		return;
+	}
+
+	frame_callback_pending = true;
+
+	if (choreographer_api.post_vsync_callback)
+	{
+		choreographer_api.post_vsync_callback(choreographer, on_vsync_callback, this);
+	}
+	else
+	{
+		choreographer_api.post_frame_callback(choreographer, on_frame_callback, this);
+	}
+}
+
+void AndroidPlatform::on_frame_callback(int64_t frame_time, void *data)
+{
+	auto platform = reinterpret_cast<AndroidPlatform *>(data);
+
+	platform->frame_callback_pending = false;
+
+	// Without frame timelines, the frame is due by the next vsync, the period is measured between callbacks
+	if (platform->last_vsync_time != 0)
+	{
+		int64_t period = frame_time - platform->last_vsync_time;
+
+		// Skipped vsyncs are not periods, callbacks are only posted for some of them
+		if (period > 0 && period < 2 * platform->vsync_period)
+		{
+			platform->vsync_period = period;
+		}
+	}
+
+	platform->last_vsync_time = frame_time;
+	platform->frame_deadline  = frame_time + platform->vsync_period;
+	platform->frame_due       = true;
+}
+
+void AndroidPlatform::on_vsync_callback(const void *callback_data, void *data)
+{
+	auto platform = reinterpret_cast<AndroidPlatform *>(data);
+
+	platform->frame_callback_pending = false;
+
+	// The preferred timeline is the one the compositor expects to present a frame started now on
+	auto &api      = platform->choreographer_api;
+	auto  timeline = api.get_preferred_frame_timeline_index(callback_data);
+
+	platform->frame_deadline = api.get_frame_timeline_deadline(callback_data, timeline);
+	platform->frame_due      = true;
+}
+
+bool AndroidPlatform::wait_for_frame_start()
+{
+	post_frame_callback();
+
+	while (!app->destroyRequested)
+	{
+		// Blocks until the callback runs, then until the latest start which leaves the work of a frame before the deadline
+		int timeout = -1;
+
+		if (frame_due)
+		{
+			int64_t start = frame_deadline - frame_work_estimate - FRAME_START_MARGIN;
+			int64_t now   = get_monotonic_time();
+
+			if (now >= start)
+			{
+				break;
+			}
+
+			timeout = static_cast<int>((start - now) / 1000000);
+		}
+
+		android_poll_source *source;
+
+		int events;
+
+		// Unlike ALooper_pollAll, it returns once the choreographer callback has run
+		int ident = ALooper_pollOnce(timeout, nullptr, &events, (void **) &source);
+
+		if (ident >= 0 && source)
+		{
+			source->process(app, source);
+		}
+	}
+
+	if (app->destroyRequested)
+	{
+		return false;
+	}
+
+	frame_due = false;
+
+	// The next callback runs at the next vsync, from the first poll after this frame
+	post_frame_callback();
+
+	return true;
+}
+
+void AndroidPlatform::load_thermal_api()
+{
+	thermal_api_loaded = true;
+
+	if (auto library = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL))
+	{
+		auto acquire_manager = reinterpret_cast<void *(*) ()>(dlsym(library, "AThermal_acquireManager"));
+
+		get_current_thermal_status    = reinterpret_cast<int (*)(void *)>(dlsym(library, "AThermal_getCurrentThermalStatus"));
+		get_thermal_headroom_forecast = reinterpret_cast<float (*)(void *, int)>(dlsym(library, "AThermal_getThermalHeadroom"));
+
+		if (acquire_manager && get_current_thermal_status)
 		{
-			run();
+			thermal_manager = acquire_manager();
 		}
 	}
+
+	if (!thermal_manager)
+	{
+		LOGI("Thermal status not available, frames are paced at the target frame rate");
+	}
+}
+
+ThermalStatus AndroidPlatform::get_thermal_status()
+{
+	if (!thermal_api_loaded)
+	{
+		load_thermal_api();
+	}
+
+	if (!thermal_manager)
+	{
+		return ThermalStatus::None;
+	}
+
+	// ATHERMAL_STATUS_NONE is 0, statuses above CRITICAL are treated as critical
+	int status = get_current_thermal_status(thermal_manager);
+
+	return static_cast<ThermalStatus>(std::min(std::max(status, 0), static_cast<int>(ThermalStatus::Critical)));
+}
+
+float AndroidPlatform::get_thermal_headroom(int forecast_seconds)
+{
+	if (!thermal_api_loaded)
+	{
+		load_thermal_api();
+	}
+
+	if (!thermal_manager || !get_thermal_headroom_forecast)
+	{
+		return -1.0f;
+	}
+
+	// NaN if the device does not support it, or if it is queried more than once per second
+	float headroom = get_thermal_headroom_forecast(thermal_manager, forecast_seconds);
+
+	return std::isnan(headroom) ? -1.0f : headroom;
+}
+
+bool AndroidPlatform::prepare()
+{
+	if (!Platform::prepare())
+	{
+		return false;
+	}
+
+	if (performance_hints)
+	{
+		create_performance_hint_session();
+	}
+
+	return true;
+}
+
+void AndroidPlatform::load_performance_hint_api()
+{
+	performance_hint_api_loaded = true;
+
+	if (auto library = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL))
+	{
+		auto &api = performance_hint_api;
+
+		api.get_manager                 = reinterpret_cast<void *(*) ()>(dlsym(library, "APerformanceHint_getManager"));
+		api.create_session              = reinterpret_cast<void *(*) (void *, const int32_t *, size_t, int64_t)>(dlsym(library, "APerformanceHint_createSession"));
+		api.update_target_work_duration = reinterpret_cast<int (*)(void *, int64_t)>(dlsym(library, "APerformanceHint_updateTargetWorkDuration"));
+		api.report_actual_work_duration = reinterpret_cast<int (*)(void *, int64_t)>(dlsym(library, "APerformanceHint_reportActualWorkDuration"));
+		api.close_session               = reinterpret_cast<void (*)(void *)>(dlsym(library, "APerformanceHint_closeSession"));
+
+		if (api.get_manager && api.create_session && api.update_target_work_duration && api.report_actual_work_duration && api.close_session)
+		{
+			performance_hint_manager = api.get_manager();
+		}
+	}
+
+	if (!performance_hint_manager)
+	{
+		LOGI("Performance hints not available, the scheduler is not told the frame deadline");
+	}
+}
+
+std::vector<int32_t> AndroidPlatform::get_performance_hint_thread_ids()
+{
+	std::vector<int32_t> thread_ids{gettid()};
+
+	auto worker_ids = active_app->get_worker_thread_ids();
+	thread_ids.insert(thread_ids.end(), worker_ids.begin(), worker_ids.end());
+
+	return thread_ids;
+}
+
+void AndroidPlatform::create_performance_hint_session()
+{
+	if (!performance_hint_api_loaded)
+	{
+		load_performance_hint_api();
+	}
+
+	if (!performance_hint_manager)
+	{
+		return;
+	}
+
+	close_performance_hint_session();
+
+	performance_hint_thread_ids = get_performance_hint_thread_ids();
+
+	performance_hint_target = get_target_work_duration();
+
+	performance_hint_session = performance_hint_api.create_session(performance_hint_manager,
+	                                                               performance_hint_thread_ids.data(),
+	                                                               performance_hint_thread_ids.size(),
+	                                                               performance_hint_target.count());
+
+	performance_hint_thread_query_time = std::chrono::steady_clock::now();
+
+	if (performance_hint_session)
+	{
+		LOGI("Performance hint session created for {} threads", performance_hint_thread_ids.size());
+	}
+	else
+	{
+		LOGW("Failed to create the performance hint session");
+	}
+}
+
+void AndroidPlatform::close_performance_hint_session()
+{
+	if (performance_hint_session)
+	{
+		performance_hint_api.close_session(performance_hint_session);
+		performance_hint_session = nullptr;
+	}
+}
+
+void AndroidPlatform::report_frame_work(std::chrono::nanoseconds target, std::chrono::nanoseconds actual)
+{
+	if (!performance_hint_manager)
+	{
+		return;
+	}
+
+	// Samples switched by a batch run have their own job system, so the session follows the threads of the app
+	auto now = std::chrono::steady_clock::now();
+
+	if (now - performance_hint_thread_query_time > std::chrono::seconds(1))
+	{
+		performance_hint_thread_query_time = now;
+
+		if (get_performance_hint_thread_ids() != performance_hint_thread_ids)
+		{
+			create_performance_hint_session();
+		}
+	}
+
+	if (!performance_hint_session)
+	{
+		return;
+	}
+
+	if (target != performance_hint_target)
+	{
+		performance_hint_target = target;
+		performance_hint_api.update_target_work_duration(performance_hint_session, target.count());
+	}
+
+	performance_hint_api.report_actual_work_duration(performance_hint_session, actual.count());
 }
 
 void AndroidPlatform::terminate(ExitCode code)
@@ -450,7 +887,17 @@ void AndroidPlatform::terminate(ExitCode code)
 			break;
 	}
 
+	close_performance_hint_session();
+
 	Platform::terminate(code);
+
+	if (asset_archive)
+	{
+		fs::unmount_asset_archive();
+
+		AAsset_close(asset_archive);
+		asset_archive = nullptr;
+	}
 }
 
 const char *AndroidPlatform::get_surface_extension()
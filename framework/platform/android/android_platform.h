@@ -22,6 +22,8 @@
 
 #include <android_native_app_glue.h>
 
+#include <chrono>
+
 #include "platform/platform.h"
 
 namespace vkb
@@ -35,6 +37,11 @@ class AndroidPlatform : public Platform
 
 	virtual bool initialize(std::unique_ptr<Application> &&app) override;
 
+	/**
+	 * @brief Prepares the app, then creates the performance hint session of its threads
+	 */
+	virtual bool prepare() override;
+
 	virtual void create_window() override;
 
 	virtual void main_loop() override;
@@ -43,6 +50,16 @@ class AndroidPlatform : public Platform
 
 	virtual const char *get_surface_extension() override;
 
+	/**
+	 * @brief Queries the thermal API of Android 11, loaded at runtime as it is not available on older versions
+	 */
+	virtual ThermalStatus get_thermal_status() override;
+
+	/**
+	 * @brief Queries the thermal headroom of Android 12, see get_thermal_status
+	 */
+	virtual float get_thermal_headroom(int forecast_seconds) override;
+
 	/**
 	 * @brief Sends a notification in the task bar
 	 * @param message The message to display
@@ -56,6 +73,132 @@ class AndroidPlatform : public Platform
   private:
 	android_app *app{nullptr};
 
+	/// Asset archive of the APK, open while it is mounted
+	AAsset *asset_archive{nullptr};
+
+	/// AThermalManager, created on the first query
+	void *thermal_manager{nullptr};
+
+	/// AThermal_getCurrentThermalStatus, nullptr if the thermal API is not available
+	int (*get_current_thermal_status)(void *){nullptr};
+
+	/// AThermal_getThermalHeadroom, nullptr if the thermal headroom is not available
+	float (*get_thermal_headroom_forecast)(void *, int){nullptr};
+
+	bool thermal_api_loaded{false};
+
+	void load_thermal_api();
+
+	/**
+	 * @brief Performance hint API of Android 13 (ADPF), loaded at runtime as it is not available on older versions
+	 */
+	struct PerformanceHintApi
+	{
+		void *(*get_manager)(){nullptr};
+
+		void *(*create_session)(void *manager, const int32_t *thread_ids, size_t size, int64_t target_duration){nullptr};
+
+		int (*update_target_work_duration)(void *session, int64_t target_duration){nullptr};
+
+		int (*report_actual_work_duration)(void *session, int64_t actual_duration){nullptr};
+
+		void (*close_session)(void *session){nullptr};
+	};
+
+	PerformanceHintApi performance_hint_api;
+
+	bool performance_hint_api_loaded{false};
+
+	/// APerformanceHintManager, nullptr if the performance hint API is not available
+	void *performance_hint_manager{nullptr};
+
+	/// APerformanceHintSession of the main thread and the worker threads of the app
+	void *performance_hint_session{nullptr};
+
+	/// Threads of the session, it is recreated when the app runs on other threads
+	std::vector<int32_t> performance_hint_thread_ids;
+
+	std::chrono::nanoseconds performance_hint_target{0};
+
+	/// Time the threads of the app were last compared with those of the session, once per second
+	std::chrono::steady_clock::time_point performance_hint_thread_query_time;
+
+	void load_performance_hint_api();
+
+	/**
+	 * @return The main thread, which runs the platform, then the worker threads of the app
+	 */
+	std::vector<int32_t> get_performance_hint_thread_ids();
+
+	/**
+	 * @brief Creates the session of the current threads of the app, replacing the previous session
+	 */
+	void create_performance_hint_session();
+
+	void close_performance_hint_session();
+
+	/**
+	 * @brief Choreographer API, loaded at runtime: frame callbacks are available from Android 10,
+	 *        and vsync callbacks with the frame timelines from Android 13
+	 */
+	struct ChoreographerApi
+	{
+		void *(*get_instance)(){nullptr};
+
+		void (*post_frame_callback)(void *choreographer, void (*callback)(int64_t frame_time, void *data), void *data){nullptr};
+
+		void (*post_vsync_callback)(void *choreographer, void (*callback)(const void *callback_data, void *data), void *data){nullptr};
+
+		size_t (*get_preferred_frame_timeline_index)(const void *callback_data){nullptr};
+
+		int64_t (*get_frame_timeline_deadline)(const void *callback_data, size_t index){nullptr};
+	};
+
+	ChoreographerApi choreographer_api;
+
+	/// AChoreographer of the main thread, nullptr unless the frames start from its callbacks
+	void *choreographer{nullptr};
+
+	/// Whether a callback is posted and has not run yet
+	bool frame_callback_pending{false};
+
+	/// Whether a callback has run and the frame it scheduled has not started yet
+	bool frame_due{false};
+
+	/// Monotonic time the work of the due frame must be done by
+	int64_t frame_deadline{0};
+
+	/// Monotonic time of the previous vsync, to estimate the vsync period without frame timelines
+	int64_t last_vsync_time{0};
+
+	int64_t vsync_period{16666667};
+
+	/// Duration of the recent frames, the frames start this long before their deadline
+	int64_t frame_work_estimate{0};
+
+	/**
+	 * @brief Starts the frames from the choreographer callbacks, as late before their deadline as their work allows
+	 * @return False if the choreographer is not available
+	 */
+	bool load_choreographer();
+
+	void post_frame_callback();
+
+	static void on_frame_callback(int64_t frame_time, void *data);
+
+	static void on_vsync_callback(const void *callback_data, void *data);
+
+	/**
+	 * @brief Processes the events until the due frame should start, so that the input is sampled as late as possible
+	 * @return False if the app was destroyed while waiting
+	 */
+	bool wait_for_frame_start();
+
+	/**
+	 * @brief Reports the work duration of the frame to the performance hint session
+	 */
+	virtual void report_frame_work(std::chrono::nanoseconds target, std::chrono::nanoseconds actual) override;
+
 	std::string log_output;
 
 	virtual std::vector<spdlog::sink_ptr> get_platform_sinks() override;
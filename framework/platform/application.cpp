@@ -46,9 +46,10 @@ void Application::step()
 {
 	auto delta_time = static_cast<float>(timer.tick<Timer::Seconds>());
 
-	if (benchmark_mode)
+	if (benchmark_mode || fixed_time_step || idle)
 	{
-		// Fix the framerate to 60 FPS for benchmark mode
+		// Fix the framerate to 60 FPS for benchmark mode and input recordings, and after
+		// an idle step so that the time blocked on the window events is not simulated
 		delta_time = 0.01667f;
 	}
 
@@ -137,6 +138,41 @@ void Application::set_benchmark_mode(bool benchmark_mode_)
 	benchmark_mode = benchmark_mode_;
 }
 
+void Application::begin_benchmark_capture()
+{
+	benchmark_capture = true;
+}
+
+void Application::end_benchmark_capture()
+{
+	benchmark_capture = false;
+}
+
+bool Application::is_benchmark_capturing() const
+{
+	return benchmark_capture;
+}
+
+bool Application::next_benchmark_configuration()
+{
+	return false;
+}
+
+std::vector<int32_t> Application::get_worker_thread_ids()
+{
+	return {};
+}
+
+void Application::set_fixed_time_step(bool fixed_time_step_)
+{
+	fixed_time_step = fixed_time_step_;
+}
+
+bool Application::is_fixed_time_step() const
+{
+	return fixed_time_step;
+}
+
 bool Application::is_headless() const
 {
 	return headless;
@@ -157,4 +193,14 @@ bool Application::is_focused() const
 	return focus;
 }
 
+bool Application::is_idle() const
+{
+	return idle;
+}
+
+void Application::set_idle(bool idle_)
+{
+	idle = idle_;
+}
+
 }        // namespace vkb
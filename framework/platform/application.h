@@ -20,7 +20,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "debug_info.h"
 #include "platform/configuration.h"
@@ -89,6 +91,41 @@ class Application
 
 	void set_benchmark_mode(bool benchmark_mode);
 
+	/**
+	 * @brief Starts capturing the frames of a benchmark run, the frames run before are its warmup
+	 */
+	virtual void begin_benchmark_capture();
+
+	/**
+	 * @brief Stops capturing the frames of the current benchmark run
+	 */
+	virtual void end_benchmark_capture();
+
+	/**
+	 * @return Whether the frames are captured by a benchmark run
+	 */
+	bool is_benchmark_capturing() const;
+
+	/**
+	 * @brief Moves a benchmark sweep to the next configuration of the application
+	 * @return False once all the configurations have been benchmarked
+	 */
+	virtual bool next_benchmark_configuration();
+
+	/**
+	 * @return Kernel ids of the threads the application runs its frames on besides the main one,
+	 *         which the platform includes in its scheduler hints
+	 */
+	virtual std::vector<int32_t> get_worker_thread_ids();
+
+	/**
+	 * @brief Steps the application by a fixed 60 Hz time step, as in benchmark mode, so that
+	 *        recorded input replays with the same frames
+	 */
+	void set_fixed_time_step(bool fixed_time_step);
+
+	bool is_fixed_time_step() const;
+
 	bool is_headless() const;
 
 	void set_headless(bool headless);
@@ -97,6 +134,12 @@ class Application
 
 	void set_focus(bool flag);
 
+	/**
+	 * @return Whether the last step rendered nothing and nothing will change until an input event arrives,
+	 *         so that the platform can block on the window events rather than stepping again
+	 */
+	bool is_idle() const;
+
 	DebugInfo &get_debug_info();
 
 	const Options &get_options();
@@ -114,6 +157,11 @@ class Application
 
 	static void set_usage(const std::string &usage);
 
+	/**
+	 * @brief Reports whether the current step left the application idle, see is_idle
+	 */
+	void set_idle(bool idle);
+
   private:
 	std::string name{};
 
@@ -125,6 +173,12 @@ class Application
 
 	bool benchmark_mode{false};
 
+	bool benchmark_capture{false};
+
+	bool fixed_time_step{false};
+
+	bool idle{false};
+
 	// The debug info of the app
 	DebugInfo debug_info{};
 };
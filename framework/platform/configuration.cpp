@@ -69,6 +69,11 @@ std::type_index EmptySetting::get_type()
 
 void Configuration::set()
 {
+	if (current_configuration == configs.end())
+	{
+		return;
+	}
+
 	for (auto pair : current_configuration->second)
 	{
 		for (auto setting : pair.second)
@@ -20,7 +20,13 @@
 
 #include "platform/filesystem.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+
 #include "common/error.h"
+#include "compression.h"
 
 VKBP_DISABLE_WARNINGS()
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -33,6 +39,213 @@ namespace vkb
 {
 namespace fs
 {
+namespace
+{
+const uint32_t ARCHIVE_MAGIC = 0x52414b56;
+
+const uint32_t ARCHIVE_VERSION = 1;
+
+/// Files start on page boundaries, the pages of one file are not shared with another
+const uint64_t ARCHIVE_ALIGNMENT = 4096;
+
+struct ArchiveHeader
+{
+	uint32_t magic;
+
+	uint32_t version;
+
+	/// Power of two, the index follows the header
+	uint64_t slot_count;
+
+	uint64_t names_offset;
+
+	uint64_t names_size;
+};
+
+/**
+ * @brief Slot of the index, which is an open addressing hash table of the paths
+ */
+struct ArchiveSlot
+{
+	uint64_t hash;
+
+	uint64_t offset;
+
+	uint64_t size;
+
+	uint32_t name_offset;
+
+	/// 0 for an empty slot
+	uint32_t name_size;
+};
+
+inline uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * @brief FNV-1a hash of a path, which is the same on every architecture, unlike std::hash
+ */
+uint64_t hash_path(const std::string &path)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (auto c : path)
+	{
+		hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Resolves the '.' and '..' components of a relative path, with '/' as separator
+ */
+std::string normalize_asset_path(const std::string &path)
+{
+	std::vector<std::string> components;
+
+	size_t start = 0;
+
+	while (start <= path.size())
+	{
+		auto end = path.find_first_of("/\\", start);
+
+		if (end == std::string::npos)
+		{
+			end = path.size();
+		}
+
+		auto component = path.substr(start, end - start);
+
+		if (component == ".." && !components.empty() && components.back() != "..")
+		{
+			components.pop_back();
+		}
+		else if (!component.empty() && component != ".")
+		{
+			components.push_back(component);
+		}
+
+		start = end + 1;
+	}
+
+	std::string result;
+
+	for (auto &component : components)
+	{
+		result += result.empty() ? component : "/" + component;
+	}
+
+	return result;
+}
+
+/**
+ * @brief Mapping of an archive written by write_asset_archive
+ */
+class AssetArchive
+{
+  public:
+	/**
+	 * @return The archive, or nullptr if the file is not a valid archive
+	 */
+	static std::unique_ptr<AssetArchive> create(MappedFile &&file)
+	{
+		auto data = file.get_data();
+		auto size = file.get_size();
+
+		ArchiveHeader header;
+
+		if (size < sizeof(header))
+		{
+			return nullptr;
+		}
+
+		std::memcpy(&header, data, sizeof(header));
+
+		if (header.magic != ARCHIVE_MAGIC || header.version != ARCHIVE_VERSION || header.slot_count == 0 ||
+		    (header.slot_count & (header.slot_count - 1)) != 0 || header.slot_count > size / sizeof(ArchiveSlot) ||
+		    header.names_offset < sizeof(header) + header.slot_count * sizeof(ArchiveSlot) ||
+		    header.names_offset > size || header.names_size > size - header.names_offset)
+		{
+			return nullptr;
+		}
+
+		auto slots = reinterpret_cast<const ArchiveSlot *>(data + sizeof(header));
+
+		for (uint64_t i = 0; i < header.slot_count; ++i)
+		{
+			auto &slot = slots[i];
+
+			if (slot.name_size != 0 &&
+			    (slot.offset > size || slot.size > size - slot.offset || slot.name_offset + uint64_t{slot.name_size} > header.names_size))
+			{
+				return nullptr;
+			}
+		}
+
+		std::unique_ptr<AssetArchive> archive{new AssetArchive};
+		archive->slots      = slots;
+		archive->slot_count = header.slot_count;
+		archive->names      = reinterpret_cast<const char *>(data + header.names_offset);
+		archive->file       = std::move(file);
+
+		return archive;
+	}
+
+	/**
+	 * @brief Finds a file in the index, in constant time
+	 * @param filename The path to the file (relative to the assets directory)
+	 * @return True if the archive holds the file
+	 */
+	bool find(const std::string &filename, const uint8_t *&data, size_t &size) const
+	{
+		auto name = normalize_asset_path(filename);
+		auto hash = hash_path(name);
+
+		auto slot = hash & (slot_count - 1);
+
+		for (uint64_t probe = 0; probe < slot_count; ++probe, slot = (slot + 1) & (slot_count - 1))
+		{
+			auto &entry = slots[slot];
+
+			if (entry.name_size == 0)
+			{
+				return false;
+			}
+
+			if (entry.hash == hash && name.compare(0, std::string::npos, names + entry.name_offset, entry.name_size) == 0)
+			{
+				data = file.get_data() + entry.offset;
+				size = static_cast<size_t>(entry.size);
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+  private:
+	AssetArchive() = default;
+
+	MappedFile file;
+
+	const ArchiveSlot *slots{nullptr};
+
+	uint64_t slot_count{0};
+
+	const char *names{nullptr};
+};
+
+/// Archive the assets are served from, mounted before they are read
+std::unique_ptr<AssetArchive> asset_archive;
+
+/// Whether write_temp_blob compresses, the caches are written from worker threads
+std::atomic<bool> temp_compression{false};
+}        // namespace
+
 namespace path
 {
 const std::unordered_map<Type, std::string> relative_paths = {{Type::Assets, "assets/"},
@@ -109,6 +322,85 @@ void create_path(const std::string &root, const std::string &path)
 	}
 }
 
+MappedFile::MappedFile(const std::string &path)
+{
+	data = map_file(path, size);
+
+	if (!data)
+	{
+		throw std::runtime_error("Failed to map file: " + path);
+	}
+}
+
+MappedFile::MappedFile(MappedFile &&other) :
+    data{other.data},
+    size{other.size},
+    owned{other.owned},
+    buffer{std::move(other.buffer)}
+{
+	other.data = nullptr;
+	other.size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+	if (data && owned)
+	{
+		unmap_file(data, size);
+	}
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other)
+{
+	if (this != &other)
+	{
+		if (data && owned)
+		{
+			unmap_file(data, size);
+		}
+
+		data       = other.data;
+		size       = other.size;
+		owned      = other.owned;
+		buffer     = std::move(other.buffer);
+		other.data = nullptr;
+		other.size = 0;
+	}
+
+	return *this;
+}
+
+MappedFile MappedFile::view(const uint8_t *data, size_t size)
+{
+	MappedFile file;
+	file.data  = data;
+	file.size  = size;
+	file.owned = false;
+
+	return file;
+}
+
+MappedFile MappedFile::from_buffer(std::vector<uint8_t> &&buffer)
+{
+	MappedFile file;
+	file.buffer = std::move(buffer);
+	file.data   = file.buffer.data();
+	file.size   = file.buffer.size();
+	file.owned  = false;
+
+	return file;
+}
+
+const uint8_t *MappedFile::get_data() const
+{
+	return data;
+}
+
+size_t MappedFile::get_size() const
+{
+	return size;
+}
+
 static std::vector<uint8_t> read_binary_file(const std::string &filename, const uint32_t count)
 {
 	std::vector<uint8_t> data;
@@ -160,9 +452,159 @@ static void write_binary_file(const std::vector<uint8_t> &data, const std::strin
 
 std::vector<uint8_t> read_asset(const std::string &filename, const uint32_t count)
 {
+	const uint8_t *data{nullptr};
+	size_t         size{0};
+
+	if (asset_archive && asset_archive->find(filename, data, size))
+	{
+		size_t read_count = count == 0 ? size : std::min<size_t>(count, size);
+
+		return {data, data + read_count};
+	}
+
 	return read_binary_file(path::get(path::Type::Assets) + filename, count);
 }
 
+MappedFile map_asset(const std::string &filename)
+{
+	const uint8_t *data{nullptr};
+	size_t         size{0};
+
+	if (asset_archive && asset_archive->find(filename, data, size))
+	{
+		return MappedFile::view(data, size);
+	}
+
+	return MappedFile{path::get(path::Type::Assets) + filename};
+}
+
+bool mount_asset_archive(const std::string &filename)
+{
+	MappedFile file;
+
+	try
+	{
+		file = MappedFile{path::get(path::Type::Assets) + filename};
+	}
+	catch (const std::runtime_error &)
+	{
+		return false;
+	}
+
+	auto archive = AssetArchive::create(std::move(file));
+
+	if (!archive)
+	{
+		return false;
+	}
+
+	asset_archive = std::move(archive);
+
+	return true;
+}
+
+bool mount_asset_archive(const uint8_t *data, size_t size)
+{
+	auto archive = AssetArchive::create(MappedFile::view(data, size));
+
+	if (!archive)
+	{
+		return false;
+	}
+
+	asset_archive = std::move(archive);
+
+	return true;
+}
+
+void unmount_asset_archive()
+{
+	asset_archive.reset();
+}
+
+bool asset_exists(const std::string &filename)
+{
+	const uint8_t *data{nullptr};
+	size_t         size{0};
+
+	if (asset_archive && asset_archive->find(filename, data, size))
+	{
+		return true;
+	}
+
+	struct stat info;
+	return stat((path::get(path::Type::Assets) + filename).c_str(), &info) == 0 && (info.st_mode & S_IFDIR) == 0;
+}
+
+void write_asset_archive(const std::vector<std::string> &filenames, const std::string &archive_filename)
+{
+	std::vector<std::string> names;
+
+	for (auto &filename : filenames)
+	{
+		auto name = normalize_asset_path(filename);
+
+		if (name != normalize_asset_path(archive_filename) && std::find(names.begin(), names.end(), name) == names.end())
+		{
+			names.push_back(name);
+		}
+	}
+
+	// At most half of the slots are used, so that lookups probe few of them
+	uint64_t slot_count = 1;
+	while (slot_count < 2 * names.size())
+	{
+		slot_count *= 2;
+	}
+
+	std::vector<ArchiveSlot> slots(static_cast<size_t>(slot_count));
+	std::string              name_data;
+
+	ArchiveHeader header{};
+	header.magic        = ARCHIVE_MAGIC;
+	header.version      = ARCHIVE_VERSION;
+	header.slot_count   = slot_count;
+	header.names_offset = sizeof(ArchiveHeader) + slot_count * sizeof(ArchiveSlot);
+
+	for (auto &name : names)
+	{
+		header.names_size += name.size();
+	}
+
+	// The header, the index and the names are written in front of the files once they are laid out
+	std::vector<uint8_t> data(static_cast<size_t>(align_up(header.names_offset + header.names_size, ARCHIVE_ALIGNMENT)), 0);
+
+	for (auto &name : names)
+	{
+		auto content = read_binary_file(path::get(path::Type::Assets) + name, 0);
+
+		auto hash = hash_path(name);
+		auto slot = hash & (slot_count - 1);
+
+		while (slots[slot].name_size != 0)
+		{
+			slot = (slot + 1) & (slot_count - 1);
+		}
+
+		slots[slot].hash        = hash;
+		slots[slot].offset      = data.size();
+		slots[slot].size        = content.size();
+		slots[slot].name_offset = static_cast<uint32_t>(name_data.size());
+		slots[slot].name_size   = static_cast<uint32_t>(name.size());
+
+		name_data += name;
+
+		data.insert(data.end(), content.begin(), content.end());
+		data.resize(static_cast<size_t>(align_up(data.size(), ARCHIVE_ALIGNMENT)), 0);
+	}
+
+	std::memcpy(data.data(), &header, sizeof(header));
+	std::memcpy(data.data() + sizeof(header), slots.data(), slots.size() * sizeof(ArchiveSlot));
+	std::memcpy(data.data() + header.names_offset, name_data.data(), name_data.size());
+
+	write_binary_file(data, path::get(path::Type::Assets) + archive_filename, 0);
+}
+
 std::vector<uint8_t> read_shader(const std::string &filename)
 {
 	return read_binary_file(path::get(path::Type::Shaders) + filename, 0);
@@ -173,11 +615,89 @@ std::vector<uint8_t> read_temp(const std::string &filename, const uint32_t count
 	return read_binary_file(path::get(path::Type::Temp) + filename, count);
 }
 
+MappedFile map_temp(const std::string &filename)
+{
+	return MappedFile{path::get(path::Type::Temp) + filename};
+}
+
 void write_temp(const std::vector<uint8_t> &data, const std::string &filename, const uint32_t count)
 {
 	write_binary_file(data, path::get(path::Type::Temp) + filename, count);
 }
 
+void set_temp_compression(bool enabled)
+{
+	temp_compression = enabled;
+}
+
+bool is_temp_compression_enabled()
+{
+	return temp_compression;
+}
+
+std::vector<uint8_t> read_temp_blob(const std::string &filename, JobSystem *job_system)
+{
+	auto data = read_temp(filename);
+
+	if (is_compressed_blob(data.data(), data.size()))
+	{
+		return decompress_blob(data.data(), data.size(), job_system);
+	}
+
+	return data;
+}
+
+MappedFile map_temp_blob(const std::string &filename, JobSystem *job_system)
+{
+	auto file = map_temp(filename);
+
+	if (is_compressed_blob(file.get_data(), file.get_size()))
+	{
+		return MappedFile::from_buffer(decompress_blob(file.get_data(), file.get_size(), job_system));
+	}
+
+	return file;
+}
+
+MappedFile map_temp_blob_if(const std::string &filename, const std::function<bool(const uint8_t *, size_t)> &accept, JobSystem *job_system)
+{
+	auto file = map_temp(filename);
+
+	if (!is_compressed_blob(file.get_data(), file.get_size()))
+	{
+		return accept(file.get_data(), file.get_size()) ? std::move(file) : MappedFile{};
+	}
+
+	std::vector<uint8_t> data;
+
+	bool accepted = decompress_blob(
+	    file.get_data(), file.get_size(), [&data, &accept](const uint8_t *chunk, size_t chunk_size) {
+		    data.insert(data.end(), chunk, chunk + chunk_size);
+
+		    return accept(data.data(), data.size());
+	    },
+	    job_system);
+
+	return accepted ? MappedFile::from_buffer(std::move(data)) : MappedFile{};
+}
+
+void write_temp_blob(const std::vector<uint8_t> &data, const std::string &filename, JobSystem *job_system)
+{
+	if (temp_compression)
+	{
+		write_temp(compress_blob(data.data(), data.size(), job_system), filename);
+	}
+	else
+	{
+		write_temp(data, filename);
+	}
+}
+
+void write_asset(const std::vector<uint8_t> &data, const std::string &filename)
+{
+	write_binary_file(data, path::get(path::Type::Assets) + filename, 0);
+}
+
 void write_image(const uint8_t *data, const std::string &filename, const uint32_t width, const uint32_t height, const uint32_t components, const uint32_t row_stride)
 {
 	stbi_write_png((path::get(path::Type::Screenshots) + filename + ".png").c_str(), width, height, components, data, row_stride);
@@ -23,6 +23,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
+#include <functional>
 #include <string>
 #include <sys/stat.h>
 #include <unordered_map>
@@ -32,6 +33,8 @@
 
 namespace vkb
 {
+class JobSystem;
+
 namespace fs
 {
 namespace path
@@ -78,6 +81,72 @@ bool is_directory(const std::string &path);
  */
 void create_directory(const std::string &path);
 
+/**
+ * @brief Platform specific implementation to map a whole file in memory for reading
+ * @param path A path to a file
+ * @param size Set to the size of the mapped file
+ * @return A pointer to the mapped data, nullptr if the file could not be mapped
+ */
+const uint8_t *map_file(const std::string &path, size_t &size);
+
+/**
+ * @brief Platform specific implementation to unmap a file mapped with map_file
+ * @param data The pointer returned by map_file
+ * @param size The size of the mapping
+ */
+void unmap_file(const uint8_t *data, size_t size);
+
+/**
+ * @brief Read-only view of a file mapped in memory, unmapped on destruction
+ */
+class MappedFile
+{
+  public:
+	MappedFile() = default;
+
+	/**
+	 * @brief Maps a file in memory
+	 * @param path A path to a file
+	 * @throws runtime_error if the file could not be mapped
+	 */
+	MappedFile(const std::string &path);
+
+	MappedFile(const MappedFile &) = delete;
+
+	MappedFile(MappedFile &&other);
+
+	~MappedFile();
+
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	MappedFile &operator=(MappedFile &&other);
+
+	/**
+	 * @brief Views memory which outlives the view, such as a file of the mounted asset archive, without unmapping it
+	 */
+	static MappedFile view(const uint8_t *data, size_t size);
+
+	/**
+	 * @brief Holds data in memory like a mapped file, such as a decompressed file
+	 */
+	static MappedFile from_buffer(std::vector<uint8_t> &&buffer);
+
+	const uint8_t *get_data() const;
+
+	size_t get_size() const;
+
+  private:
+	const uint8_t *data{nullptr};
+
+	size_t size{0};
+
+	/// Whether the data is unmapped on destruction
+	bool owned{true};
+
+	/// Data held in memory instead of mapped, see from_buffer
+	std::vector<uint8_t> buffer;
+};
+
 /**
  * @brief Recursively creates a directory
  * @param root The root directory that the path is relative to
@@ -95,6 +164,55 @@ void create_path(const std::string &root, const std::string &path);
  */
 std::vector<uint8_t> read_asset(const std::string &filename, const uint32_t count = 0);
 
+/**
+ * @brief Helper to map an asset file in memory, so that it is read without an intermediate copy.
+ *        Assets are extracted to the external storage on Android, so they are mapped like any file
+ *
+ * @param filename The path to the file (relative to the assets directory)
+ * @throws runtime_error if the file could not be mapped
+ * @return The mapped file
+ */
+MappedFile map_asset(const std::string &filename);
+
+/// Name of the asset archive, at the root of the assets directory or of the assets of the APK on Android
+constexpr const char *ASSET_ARCHIVE_NAME = "assets.vkbar";
+
+/**
+ * @brief Serves the assets from an archive, mapped once, instead of opening their files.
+ *        The assets the archive does not hold are read from the assets directory. It replaces
+ *        the archive mounted before, and must be done before the assets are read
+ * @param filename The path to the archive (relative to the assets directory)
+ * @return True if the archive was found and is valid
+ */
+bool mount_asset_archive(const std::string &filename);
+
+/**
+ * @brief Serves the assets from an archive in memory, see mount_asset_archive
+ * @param data Memory holding the archive until it is unmounted, such as the buffer of an uncompressed APK asset
+ * @param size The size of the archive
+ * @return True if the archive is valid
+ */
+bool mount_asset_archive(const uint8_t *data, size_t size);
+
+/**
+ * @brief Reads the assets from their files again, the views of the archive files must have been released
+ */
+void unmount_asset_archive();
+
+/**
+ * @param filename The path to the file (relative to the assets directory)
+ * @return Whether the asset archive or the assets directory holds the file
+ */
+bool asset_exists(const std::string &filename);
+
+/**
+ * @brief Writes an archive of assets, with a hashed index of their paths and their data aligned to pages
+ * @param filenames The paths to the files to store (relative to the assets directory)
+ * @param archive_filename The path to the archive (relative to the assets directory)
+ * @throws runtime_error if a file cannot be read or the archive cannot be written
+ */
+void write_asset_archive(const std::vector<std::string> &filenames, const std::string &archive_filename);
+
 /**
  * @brief Helper to read a shader file into a byte-array
  *
@@ -113,6 +231,15 @@ std::vector<uint8_t> read_shader(const std::string &filename);
  */
 std::vector<uint8_t> read_temp(const std::string &filename, const uint32_t count = 0);
 
+/**
+ * @brief Helper to map a temporary file in memory
+ *
+ * @param filename The path to the file (relative to the temporary storage directory)
+ * @throws runtime_error if the file could not be mapped
+ * @return The mapped file
+ */
+MappedFile map_temp(const std::string &filename);
+
 /**
  * @brief Helper to write to a file in temporary storage
  *
@@ -123,6 +250,69 @@ std::vector<uint8_t> read_temp(const std::string &filename, const uint32_t count
  */
 void write_temp(const std::vector<uint8_t> &data, const std::string &filename, const uint32_t count = 0);
 
+/**
+ * @brief Compresses the files written with write_temp_blob, such as the pipeline and scene caches.
+ *        Compressed and uncompressed files are both read back, so it can change between runs
+ * @param enabled Whether the files are compressed, false by default
+ */
+void set_temp_compression(bool enabled);
+
+/**
+ * @return Whether the files written with write_temp_blob are compressed
+ */
+bool is_temp_compression_enabled();
+
+/**
+ * @brief Helper to read a temporary file written with write_temp_blob into a byte-array
+ *
+ * @param filename The path to the file (relative to the temporary storage directory)
+ * @param job_system (optional) Job system to decompress the chunks of a compressed file on
+ * @throws runtime_error if the file could not be read or is corrupt
+ * @return A vector filled with the data of the file, decompressed
+ */
+std::vector<uint8_t> read_temp_blob(const std::string &filename, JobSystem *job_system = nullptr);
+
+/**
+ * @brief Helper to map a temporary file written with write_temp_blob in memory.
+ *        An uncompressed file is mapped, a compressed one is decompressed in memory
+ *
+ * @param filename The path to the file (relative to the temporary storage directory)
+ * @param job_system (optional) Job system to decompress the chunks of a compressed file on
+ * @throws runtime_error if the file could not be mapped or is corrupt
+ * @return The mapped file
+ */
+MappedFile map_temp_blob(const std::string &filename, JobSystem *job_system = nullptr);
+
+/**
+ * @brief Same as map_temp_blob, but a compressed file is decompressed chunk by chunk and checked as it goes,
+ *        so that a file which turns out to be stale, such as a cache with an old header, is not decompressed any further
+ *
+ * @param filename The path to the file (relative to the temporary storage directory)
+ * @param accept Called with the data read so far after each chunk, or once with all the data of an uncompressed file.
+ *        The file is discarded as soon as it returns false
+ * @param job_system (optional) Job system to decompress the next chunks on while accept checks the data
+ * @throws runtime_error if the file could not be mapped or is corrupt
+ * @return The mapped file, empty if accept discarded it
+ */
+MappedFile map_temp_blob_if(const std::string &filename, const std::function<bool(const uint8_t *data, size_t size)> &accept, JobSystem *job_system = nullptr);
+
+/**
+ * @brief Helper to write to a file in temporary storage, compressed if set_temp_compression enabled it
+ *
+ * @param data A vector filled with data to write
+ * @param filename The path to the file (relative to the temporary storage directory)
+ * @param job_system (optional) Job system to compress the chunks on
+ */
+void write_temp_blob(const std::vector<uint8_t> &data, const std::string &filename, JobSystem *job_system = nullptr);
+
+/**
+ * @brief Helper to write to a file in the assets directory, for tools preparing the assets offline
+ *
+ * @param data A vector filled with data to write
+ * @param filename The path to the file (relative to the assets directory)
+ */
+void write_asset(const std::vector<uint8_t> &data, const std::string &filename);
+
 /**
  * @brief Helper to write to a png image in permanent storage
  *
@@ -210,7 +210,7 @@ void key_callback(GLFWwindow *window, int key, int /*scancode*/, int action, int
 	if (auto glfw_window = reinterpret_cast<GlfwWindow *>(glfwGetWindowUserPointer(window)))
 	{
 		auto &platform = glfw_window->get_platform();
-		platform.get_app().input_event(KeyInputEvent{platform, key_code, key_action});
+		platform.input_event(KeyInputEvent{platform, key_code, key_action});
 	}
 }
 
@@ -243,7 +243,7 @@ void cursor_position_callback(GLFWwindow *window, double xpos, double ypos)
 	if (auto glfw_window = reinterpret_cast<GlfwWindow *>(glfwGetWindowUserPointer(window)))
 	{
 		auto &platform = glfw_window->get_platform();
-		platform.get_app().input_event(MouseButtonInputEvent{
+		platform.input_event(MouseButtonInputEvent{
 		    platform,
 		    MouseButton::Unknown,
 		    MouseAction::Move,
@@ -262,7 +262,7 @@ void mouse_button_callback(GLFWwindow *window, int button, int action, int /*mod
 		double xpos, ypos;
 		glfwGetCursorPos(window, &xpos, &ypos);
 
-		platform.get_app().input_event(MouseButtonInputEvent{
+		platform.input_event(MouseButtonInputEvent{
 		    platform,
 		    translate_mouse_button(button),
 		    mouse_action,
@@ -350,6 +350,11 @@ void GlfwWindow::process_events()
 	glfwPollEvents();
 }
 
+void GlfwWindow::wait_events(std::chrono::milliseconds timeout)
+{
+	glfwWaitEventsTimeout(std::chrono::duration<double>(timeout).count());
+}
+
 void GlfwWindow::close()
 {
 	glfwSetWindowShouldClose(handle, GLFW_TRUE);
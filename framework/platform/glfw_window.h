@@ -43,6 +43,8 @@ class GlfwWindow : public Window
 
 	virtual void process_events() override;
 
+	virtual void wait_events(std::chrono::milliseconds timeout) override;
+
 	virtual void close() override;
 
 	float get_dpi_factor() const override;
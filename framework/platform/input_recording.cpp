@@ -0,0 +1,174 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "input_recording.h"
+
+#include <fstream>
+#include <stdexcept>
+
+#include <json.hpp>
+
+#include "common/logging.h"
+#include "platform/application.h"
+#include "platform/filesystem.h"
+
+namespace vkb
+{
+void InputRecording::record(uint32_t frame, const InputEvent &input_event)
+{
+	RecordedEvent event;
+	event.frame  = frame;
+	event.source = input_event.get_source();
+
+	switch (input_event.get_source())
+	{
+		case EventSource::Keyboard:
+		{
+			const auto &key_event = static_cast<const KeyInputEvent &>(input_event);
+
+			event.code   = static_cast<int32_t>(key_event.get_code());
+			event.action = static_cast<int32_t>(key_event.get_action());
+			break;
+		}
+		case EventSource::Mouse:
+		{
+			const auto &mouse_event = static_cast<const MouseButtonInputEvent &>(input_event);
+
+			event.code   = static_cast<int32_t>(mouse_event.get_button());
+			event.action = static_cast<int32_t>(mouse_event.get_action());
+			event.pos_x  = mouse_event.get_pos_x();
+			event.pos_y  = mouse_event.get_pos_y();
+			break;
+		}
+		case EventSource::Touchscreen:
+		{
+			const auto &touch_event = static_cast<const TouchInputEvent &>(input_event);
+
+			event.code         = touch_event.get_pointer_id();
+			event.action       = static_cast<int32_t>(touch_event.get_action());
+			event.pos_x        = touch_event.get_pos_x();
+			event.pos_y        = touch_event.get_pos_y();
+			event.touch_points = touch_event.get_touch_points();
+			break;
+		}
+	}
+
+	events.push_back(event);
+}
+
+bool InputRecording::save(const std::string &filename) const
+{
+	nlohmann::json recording = nlohmann::json::array();
+
+	for (auto &event : events)
+	{
+		recording.push_back({{"frame", event.frame},
+		                     {"source", static_cast<int32_t>(event.source)},
+		                     {"code", event.code},
+		                     {"action", event.action},
+		                     {"x", event.pos_x},
+		                     {"y", event.pos_y},
+		                     {"touch_points", event.touch_points}});
+	}
+
+	std::ofstream out{fs::path::get(fs::path::Type::Storage) + filename, std::ios::out | std::ios::trunc};
+
+	if (!out.good())
+	{
+		LOGE("Could not write input recording {}", filename);
+		return false;
+	}
+
+	out << recording.dump();
+
+	return true;
+}
+
+void InputRecording::load(const std::string &filename)
+{
+	std::ifstream in{fs::path::get(fs::path::Type::Storage) + filename};
+
+	if (!in.good())
+	{
+		throw std::runtime_error("Could not read input recording " + filename);
+	}
+
+	nlohmann::json recording;
+
+	try
+	{
+		recording = nlohmann::json::parse(in);
+	}
+	catch (const std::exception &)
+	{
+		throw std::runtime_error("Invalid input recording " + filename);
+	}
+
+	if (!recording.is_array())
+	{
+		throw std::runtime_error("Invalid input recording " + filename);
+	}
+
+	events.clear();
+	replay_index = 0;
+
+	for (auto &entry : recording)
+	{
+		RecordedEvent event;
+		event.frame        = entry.at("frame").get<uint32_t>();
+		event.source       = static_cast<EventSource>(entry.at("source").get<int32_t>());
+		event.code         = entry.at("code").get<int32_t>();
+		event.action       = entry.at("action").get<int32_t>();
+		event.pos_x        = entry.at("x").get<float>();
+		event.pos_y        = entry.at("y").get<float>();
+		event.touch_points = entry.at("touch_points").get<size_t>();
+
+		events.push_back(event);
+	}
+
+	LOGI("Loaded {} input events from {}", events.size(), filename);
+}
+
+void InputRecording::replay(uint32_t frame, Platform &platform, Application &app)
+{
+	for (; replay_index < events.size() && events[replay_index].frame <= frame; ++replay_index)
+	{
+		const auto &event = events[replay_index];
+
+		switch (event.source)
+		{
+			case EventSource::Keyboard:
+				app.input_event(KeyInputEvent{platform, static_cast<KeyCode>(event.code), static_cast<KeyAction>(event.action)});
+				break;
+			case EventSource::Mouse:
+				app.input_event(MouseButtonInputEvent{platform, static_cast<MouseButton>(event.code), static_cast<MouseAction>(event.action), event.pos_x, event.pos_y});
+				break;
+			case EventSource::Touchscreen:
+				app.input_event(TouchInputEvent{platform, event.code, event.touch_points, static_cast<TouchAction>(event.action), event.pos_x, event.pos_y});
+				break;
+		}
+	}
+}
+
+bool InputRecording::is_replay_finished() const
+{
+	return replay_index == events.size();
+}
+}        // namespace vkb
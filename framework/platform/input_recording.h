@@ -0,0 +1,97 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "platform/input_events.h"
+
+namespace vkb
+{
+class Application;
+
+/**
+ * @brief Records the input events handled in each frame, and replays them in the same frames.
+ *        Both are meant to run with a fixed time step, so that a replay renders the frames of its recording.
+ */
+class InputRecording
+{
+  public:
+	/**
+	 * @brief Adds an event to the recording
+	 * @param frame The index of the frame the event is handled in
+	 * @param input_event The event
+	 */
+	void record(uint32_t frame, const InputEvent &input_event);
+
+	/**
+	 * @brief Writes the recording as json
+	 * @param filename The path to the file (relative to the storage directory)
+	 * @return True if the file was written
+	 */
+	bool save(const std::string &filename) const;
+
+	/**
+	 * @brief Reads a recording written by save, to be replayed from its first frame
+	 * @param filename The path to the file (relative to the storage directory)
+	 * @throws runtime_error if the file cannot be read
+	 */
+	void load(const std::string &filename);
+
+	/**
+	 * @brief Sends the recorded events of a frame to an application, in recording order
+	 * @param frame The index of the frame being replayed, frames must be replayed in order
+	 * @param platform The platform the events are created for
+	 * @param app The application receiving the events
+	 */
+	void replay(uint32_t frame, Platform &platform, Application &app);
+
+	/**
+	 * @return Whether all the recorded events have been replayed
+	 */
+	bool is_replay_finished() const;
+
+  private:
+	struct RecordedEvent
+	{
+		uint32_t frame{0};
+
+		EventSource source{EventSource::Keyboard};
+
+		/// Key code, mouse button or touch pointer id
+		int32_t code{0};
+
+		int32_t action{0};
+
+		float pos_x{0.0f};
+
+		float pos_y{0.0f};
+
+		size_t touch_points{0};
+	};
+
+	std::vector<RecordedEvent> events;
+
+	size_t replay_index{0};
+};
+}        // namespace vkb
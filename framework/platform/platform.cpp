@@ -20,8 +20,10 @@
 
 #include "platform.h"
 
+#include <algorithm>
 #include <ctime>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 #include <spdlog/async_logger.h>
@@ -40,6 +42,8 @@ std::string Platform::external_storage_directory = "";
 
 std::string Platform::temp_directory = "";
 
+constexpr std::chrono::milliseconds Platform::IDLE_WAIT_TIMEOUT;
+
 bool Platform::initialize(std::unique_ptr<Application> &&app)
 {
 	assert(app && "Application is not valid");
@@ -47,7 +51,11 @@ bool Platform::initialize(std::unique_ptr<Application> &&app)
 
 	auto sinks = get_platform_sinks();
 
-	auto logger = std::make_shared<spdlog::logger>("logger", sinks.begin(), sinks.end());
+	// Messages are formatted by the calling thread and written to the sinks by a background one,
+	// so worker threads logging at the same time only contend on the queue
+	spdlog::init_thread_pool(LOG_QUEUE_SIZE, 1);
+
+	auto logger = std::make_shared<spdlog::async_logger>("logger", sinks.begin(), sinks.end(), spdlog::thread_pool(), spdlog::async_overflow_policy::block);
 
 #ifdef VKB_DEBUG
 	logger->set_level(spdlog::level::debug);
@@ -56,19 +64,55 @@ bool Platform::initialize(std::unique_ptr<Application> &&app)
 #endif
 
 	logger->set_pattern(LOGGER_FORMAT);
+
+	// Errors are written out straight away in case the application terminates
+	logger->flush_on(spdlog::level::err);
+	spdlog::flush_every(std::chrono::seconds(1));
+
 	spdlog::set_default_logger(logger);
 
 	LOGI("Logger initialized");
 
+	// Assets are read from the archive if one was built, and from their files otherwise
+	if (fs::mount_asset_archive(fs::ASSET_ARCHIVE_NAME))
+	{
+		LOGI("Mounted the asset archive {}", fs::ASSET_ARCHIVE_NAME);
+	}
+
 	// Set the app to execute as a benchmark
 	if (active_app->get_options().contains("--benchmark"))
 	{
 		benchmark_mode             = true;
 		total_benchmark_frames     = active_app->get_options().get_int("--benchmark");
-		remaining_benchmark_frames = total_benchmark_frames;
+		warmup_benchmark_frames    = active_app->get_options().contains("--warmup") ? active_app->get_options().get_int("--warmup") : 0;
+		benchmark_sweep            = active_app->get_options().contains("--sweep");
+		remaining_benchmark_frames = total_benchmark_frames + warmup_benchmark_frames;
 		active_app->set_benchmark_mode(true);
 	}
 
+	// Input recordings and their replays step the app by a fixed time step, so that they render the same frames
+	if (active_app->get_options().contains("--record-input"))
+	{
+		input_recording_file = active_app->get_options().get_string("--record-input");
+		active_app->set_fixed_time_step(true);
+	}
+	else if (active_app->get_options().contains("--replay-input"))
+	{
+		input_recording.load(active_app->get_options().get_string("--replay-input"));
+		replaying_input = true;
+		active_app->set_fixed_time_step(true);
+	}
+
+	if (active_app->get_options().contains("--fps"))
+	{
+		set_target_frame_rate(static_cast<float>(active_app->get_options().get_int("--fps")));
+	}
+
+	if (active_app->get_options().contains("--no-performance-hints"))
+	{
+		set_performance_hints(false);
+	}
+
 	// Set the app as headless
 	active_app->set_headless(active_app->get_options().contains("--headless"));
 
@@ -99,7 +143,15 @@ void Platform::main_loop()
 	{
 		run();
 
-		window->process_events();
+		// An idle application renders nothing until something changes, such as an input event
+		if (active_app->is_idle())
+		{
+			window->wait_events(IDLE_WAIT_TIMEOUT);
+		}
+		else
+		{
+			window->process_events();
+		}
 	}
 }
 
@@ -107,26 +159,201 @@ void Platform::run()
 {
 	if (benchmark_mode)
 	{
-		timer.start();
-
 		if (remaining_benchmark_frames == 0)
 		{
+			active_app->end_benchmark_capture();
+
 			auto time_taken = timer.stop();
 			LOGI("Benchmark completed in {} seconds (ran {} frames, averaged {} fps)", time_taken, total_benchmark_frames, total_benchmark_frames / time_taken);
-			close();
-			return;
+			LOGI("{} frames took longer than the {:.2f} ms target, performance hints {}", late_benchmark_frames,
+			     std::chrono::duration<double, std::milli>(get_target_work_duration()).count(), performance_hints ? "on" : "off");
+
+			if (!benchmark_sweep || !active_app->next_benchmark_configuration())
+			{
+				close();
+				return;
+			}
+
+			// Each configuration of a sweep warms up again, its caches and clocks settle after the switch
+			remaining_benchmark_frames = total_benchmark_frames + warmup_benchmark_frames;
+		}
+
+		if (remaining_benchmark_frames == total_benchmark_frames)
+		{
+			timer.start();
+			late_benchmark_frames = 0;
+			active_app->begin_benchmark_capture();
 		}
 	}
 
 	if (active_app->is_focused() || active_app->is_benchmark_mode())
 	{
+		if (replaying_input)
+		{
+			input_recording.replay(frame_index, *this, *active_app);
+		}
+
+		auto work_start = std::chrono::steady_clock::now();
+
 		active_app->step();
+
+		// The pacing sleep is not work, the frame is reported before it
+		auto target = get_target_work_duration();
+		auto actual = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - work_start);
+
+		if (active_app->is_benchmark_capturing() && actual > target)
+		{
+			late_benchmark_frames++;
+		}
+
+		if (performance_hints)
+		{
+			report_frame_work(target, actual);
+		}
+
 		remaining_benchmark_frames--;
+		frame_index++;
+	}
+
+	if (target_frame_rate > 0.0f)
+	{
+		pace_frame();
+	}
+}
+
+void Platform::set_target_frame_rate(float frames_per_second)
+{
+	target_frame_rate = std::max(frames_per_second, 0.0f);
+	paced_frame_rate  = target_frame_rate;
+	next_frame_time   = std::chrono::steady_clock::now();
+}
+
+void Platform::set_thermal_pacing(bool enable)
+{
+	thermal_pacing   = enable;
+	paced_frame_rate = target_frame_rate;
+}
+
+ThermalStatus Platform::get_thermal_status()
+{
+	return ThermalStatus::None;
+}
+
+float Platform::get_thermal_headroom(int forecast_seconds)
+{
+	return -1.0f;
+}
+
+void Platform::set_performance_hints(bool enable)
+{
+	performance_hints = enable;
+}
+
+std::chrono::nanoseconds Platform::get_target_work_duration() const
+{
+	float frame_rate = target_frame_rate > 0.0f ? paced_frame_rate : DEFAULT_HINT_FRAME_RATE;
+
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1.0 / frame_rate));
+}
+
+void Platform::report_frame_work(std::chrono::nanoseconds target, std::chrono::nanoseconds actual)
+{
+}
+
+void Platform::pace_frame()
+{
+	using namespace std::chrono;
+
+	auto now = steady_clock::now();
+
+	if (thermal_pacing && now - thermal_query_time > seconds(1))
+	{
+		thermal_query_time = now;
+
+		// Backing off before the device throttles its clocks keeps the frame times stable over long runs
+		float scale = 1.0f;
+
+		switch (get_thermal_status())
+		{
+			case ThermalStatus::Moderate:
+				scale = 0.75f;
+				break;
+			case ThermalStatus::Severe:
+				scale = 0.5f;
+				break;
+			case ThermalStatus::Critical:
+				scale = 1.0f / 3.0f;
+				break;
+			default:
+				break;
+		}
+
+		// The forecast headroom backs off before the status changes, by the time it does the clocks are already lowered
+		float headroom = get_thermal_headroom(THERMAL_FORECAST_SECONDS);
+
+		if (headroom >= 1.0f)
+		{
+			scale = std::min(scale, 0.5f);
+		}
+		else if (headroom >= 0.9f)
+		{
+			scale = std::min(scale, 0.75f);
+		}
+
+		if (target_frame_rate * scale != paced_frame_rate)
+		{
+			paced_frame_rate = target_frame_rate * scale;
+			LOGI("Pacing frames at {:.1f} fps", paced_frame_rate);
+		}
+	}
+
+	auto frame_duration = duration_cast<steady_clock::duration>(duration<double>(1.0 / paced_frame_rate));
+
+	next_frame_time += frame_duration;
+
+	// A late frame moves the schedule instead of letting the next frames catch up in a burst
+	if (next_frame_time < now)
+	{
+		next_frame_time = now;
+		return;
+	}
+
+	// Sleeping overshoots by up to a scheduler quantum, the last stretch is spun
+	const auto spin_duration = milliseconds(2);
+
+	if (next_frame_time - now > spin_duration)
+	{
+		std::this_thread::sleep_for(next_frame_time - now - spin_duration);
+	}
+
+	while (steady_clock::now() < next_frame_time)
+	{
+		std::this_thread::yield();
 	}
 }
 
+void Platform::input_event(const InputEvent &input_event)
+{
+	if (replaying_input)
+	{
+		return;
+	}
+
+	if (!input_recording_file.empty())
+	{
+		input_recording.record(frame_index, input_event);
+	}
+
+	active_app->input_event(input_event);
+}
+
 void Platform::terminate(ExitCode code)
 {
+	if (!input_recording_file.empty() && input_recording.save(input_recording_file))
+	{
+		LOGI("Input recorded to {}{}", fs::path::get(fs::path::Type::Storage), input_recording_file);
+	}
+
 	if (active_app)
 	{
 		active_app->finish();
@@ -135,7 +362,9 @@ void Platform::terminate(ExitCode code)
 	active_app.reset();
 	window.reset();
 
+	// Writes out the queued messages and joins the logging threads
 	spdlog::drop_all();
+	spdlog::shutdown();
 }
 
 void Platform::close() const
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
@@ -28,6 +29,7 @@
 #include "common/vk_common.h"
 #include "platform/application.h"
 #include "platform/filesystem.h"
+#include "platform/input_recording.h"
 #include "platform/window.h"
 
 namespace vkb
@@ -39,9 +41,33 @@ enum class ExitCode
 	FatalError  = 2  /* App encountered an unexpected error */
 };
 
+/**
+ * @brief Thermal state of the device, as reported by the platform
+ */
+enum class ThermalStatus
+{
+	None,
+	Light,
+	Moderate,
+	Severe,
+	Critical
+};
+
 class Platform
 {
   public:
+	/// Number of log messages which can be queued before the logging threads block
+	static constexpr size_t LOG_QUEUE_SIZE = 8192;
+
+	/// Frame rate the work of a frame is hinted against when no frame rate is targeted
+	static constexpr float DEFAULT_HINT_FRAME_RATE = 60.0f;
+
+	/// How far ahead the thermal headroom is forecast when pacing frames
+	static constexpr int THERMAL_FORECAST_SECONDS = 10;
+
+	/// Longest wait on the window events while the application is idle, so that background work completing is noticed
+	static constexpr std::chrono::milliseconds IDLE_WAIT_TIMEOUT{100};
+
 	Platform() = default;
 
 	virtual ~Platform() = default;
@@ -64,10 +90,48 @@ class Platform
 	virtual void main_loop();
 
 	/**
-	 * @brief Runs the application for one frame
+	 * @brief Runs the application for one frame, then waits until the next frame is due if a frame rate is targeted
 	 */
 	void run();
 
+	/**
+	 * @brief Caps the rate the application is stepped at, trading peak frame rate for stable
+	 *        frame times and lower power. Each frame sleeps until shortly before it is due
+	 *        and spins the rest of the way, as sleeps can overshoot by a scheduler quantum.
+	 * @param frames_per_second The targeted frame rate, 0 to run as fast as possible
+	 */
+	void set_target_frame_rate(float frames_per_second);
+
+	/**
+	 * @brief Lowers the targeted frame rate while the device reports it is throttling, on by default
+	 */
+	void set_thermal_pacing(bool enable);
+
+	/**
+	 * @return The thermal status of the device, ThermalStatus::None if the platform cannot tell
+	 */
+	virtual ThermalStatus get_thermal_status();
+
+	/**
+	 * @brief Forecasts how close the device is to throttling, 1.0 being the point it throttles severely
+	 * @param forecast_seconds How far ahead to forecast
+	 * @return The headroom, negative if the platform cannot tell
+	 */
+	virtual float get_thermal_headroom(int forecast_seconds);
+
+	/**
+	 * @brief Reports the duration of the work of each frame to the scheduler of the platform, if it takes hints,
+	 *        so that it picks the cores and clocks which meet the frame deadline. On by default
+	 */
+	void set_performance_hints(bool enable);
+
+	/**
+	 * @brief Sends an input event of the window to the application, recording it if input is being recorded.
+	 *        Window events are dropped while a recording is replayed.
+	 * @param input_event The input event
+	 */
+	void input_event(const InputEvent &input_event);
+
 	/**
 	 * @brief Terminates the platform and the application
 	 * @param code Determines how the platform should exit
@@ -124,8 +188,60 @@ class Platform
 
 	uint32_t remaining_benchmark_frames{0};
 
+	/// Frames run before the captured frames of each benchmark run
+	uint32_t warmup_benchmark_frames{0};
+
+	/// Whether every configuration of the application is benchmarked in turn
+	bool benchmark_sweep{false};
+
 	Timer timer;
 
+	/// Index of the frame the application is stepped in, the frames of input recordings
+	uint32_t frame_index{0};
+
+	InputRecording input_recording;
+
+	/// File the input events are recorded to when terminating, if any
+	std::string input_recording_file;
+
+	bool replaying_input{false};
+
+	/// Frame rate targeted by set_target_frame_rate, 0 if the frames are not paced
+	float target_frame_rate{0.0f};
+
+	bool thermal_pacing{true};
+
+	/// Frame rate the frames are paced at, the target lowered according to the thermal status
+	float paced_frame_rate{0.0f};
+
+	/// Time the next frame is due at
+	std::chrono::steady_clock::time_point next_frame_time;
+
+	/// Time the thermal status was last queried at, it is only polled once per second
+	std::chrono::steady_clock::time_point thermal_query_time;
+
+	bool performance_hints{true};
+
+	/// Frames of the current benchmark run whose work took longer than the hinted target
+	uint32_t late_benchmark_frames{0};
+
+	/**
+	 * @brief Waits until the next frame is due
+	 */
+	void pace_frame();
+
+	/**
+	 * @return The duration the work of a frame should fit in, at the paced frame rate if frames are paced
+	 */
+	std::chrono::nanoseconds get_target_work_duration() const;
+
+	/**
+	 * @brief Called every frame with the duration of its work, before the frame is paced
+	 * @param target The duration the work should fit in
+	 * @param actual The duration of the work
+	 */
+	virtual void report_frame_work(std::chrono::nanoseconds target, std::chrono::nanoseconds actual);
+
 	virtual std::vector<spdlog::sink_ptr> get_platform_sinks();
 
 	/**
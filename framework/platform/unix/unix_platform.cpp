@@ -20,6 +20,10 @@
 
 #include "unix_platform.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include "common/error.h"
 
 VKBP_DISABLE_WARNINGS()
@@ -64,6 +68,43 @@ void create_directory(const std::string &path)
 		mkdir(path.c_str(), 0777);
 	}
 }
+
+const uint8_t *map_file(const std::string &path, size_t &size)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+
+	if (fd < 0)
+	{
+		return nullptr;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close(fd);
+		return nullptr;
+	}
+
+	size = static_cast<size_t>(info.st_size);
+
+	void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// The mapping stays valid after closing the descriptor
+	close(fd);
+
+	if (data == MAP_FAILED)
+	{
+		size = 0;
+		return nullptr;
+	}
+
+	return static_cast<const uint8_t *>(data);
+}
+
+void unmap_file(const uint8_t *data, size_t size)
+{
+	munmap(const_cast<uint8_t *>(data), size);
+}
 }        // namespace fs
 
 UnixPlatform::UnixPlatform(const UnixType &type, int argc, char **argv) :
@@ -20,6 +20,8 @@
 
 #include "window.h"
 
+#include <thread>
+
 #include "platform/platform.h"
 
 namespace vkb
@@ -35,6 +37,13 @@ void Window::process_events()
 {
 }
 
+void Window::wait_events(std::chrono::milliseconds timeout)
+{
+	process_events();
+
+	std::this_thread::sleep_for(timeout);
+}
+
 Platform &Window::get_platform()
 {
 	return platform;
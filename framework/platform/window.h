@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <chrono>
+
 #include "common/vk_common.h"
 
 namespace vkb
@@ -59,6 +61,13 @@ class Window
 	 */
 	virtual void process_events();
 
+	/**
+	 * @brief Blocks until a window event arrives or the timeout expires, then handles the events.
+	 *        Windows which cannot wait on their events handle them and sleep for the timeout
+	 * @param timeout The longest time to block for
+	 */
+	virtual void wait_events(std::chrono::milliseconds timeout);
+
 	/**
 	 * @brief Requests to close the window
 	 */
@@ -105,6 +105,48 @@ void create_directory(const std::string &path)
 		CreateDirectory(path.c_str(), NULL);
 	}
 }
+
+const uint8_t *map_file(const std::string &path, size_t &size)
+{
+	HANDLE file = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return nullptr;
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return nullptr;
+	}
+
+	size = static_cast<size_t>(file_size.QuadPart);
+
+	HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+	// The view keeps the mapping alive after closing the handles
+	if (mapping)
+	{
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+
+	if (!data)
+	{
+		size = 0;
+	}
+
+	return static_cast<const uint8_t *>(data);
+}
+
+void unmap_file(const uint8_t *data, size_t /*size*/)
+{
+	UnmapViewOfFile(data);
+}
 }        // namespace fs
 
 WindowsPlatform::WindowsPlatform(HINSTANCE hInstance, HINSTANCE hPrevInstance,
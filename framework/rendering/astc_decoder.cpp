@@ -0,0 +1,240 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/astc_decoder.h"
+
+#include "common/helpers.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "scene_graph/components/image.h"
+#include "scene_graph/components/image/astc.h"
+
+namespace vkb
+{
+namespace
+{
+/// Size in bytes of an ASTC block, whatever its dimensions
+const uint32_t BLOCK_SIZE = 16;
+
+struct DecodeConstants
+{
+	uint32_t block_offset;
+
+	uint32_t texel_offset;
+
+	uint32_t width;
+
+	uint32_t height;
+
+	uint32_t block_width;
+
+	uint32_t block_height;
+
+	uint32_t blocks_x;
+
+	uint32_t block_count;
+
+	uint32_t srgb;
+};
+}        // namespace
+
+const uint32_t AstcDecoder::WORKGROUP_SIZE = 64;
+
+VkFormat AstcDecoder::get_decoded_format(VkFormat astc_format)
+{
+	switch (astc_format)
+	{
+		case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_5x4_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_6x5_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_8x5_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_8x6_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_10x5_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_10x6_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_10x8_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_10x10_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_12x10_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_12x12_SRGB_BLOCK:
+			return VK_FORMAT_R8G8B8A8_SRGB;
+		default:
+			return VK_FORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+AstcDecoder::AstcDecoder(Device &device) :
+    device{device}
+{
+}
+
+void AstcDecoder::add(sg::Image &image)
+{
+	assert(sg::is_astc(image.get_format()) && "Image is not ASTC");
+
+	auto block_dim = sg::to_blockdim(image.get_format());
+
+	PendingImage pending{};
+	pending.image        = &image;
+	pending.block_width  = block_dim.x;
+	pending.block_height = block_dim.y;
+	pending.srgb         = get_decoded_format(image.get_format()) == VK_FORMAT_R8G8B8A8_SRGB;
+
+	uint32_t block_count = 0;
+	uint32_t texel_count = 0;
+
+	for (auto &mipmap : image.get_mipmaps())
+	{
+		Level level{};
+		level.extent       = mipmap.extent;
+		level.blocks_x     = (mipmap.extent.width + block_dim.x - 1) / block_dim.x;
+		level.block_count  = level.blocks_x * ((mipmap.extent.height + block_dim.y - 1) / block_dim.y);
+		level.block_offset = block_count;
+		level.texel_offset = texel_count;
+
+		block_count += level.block_count;
+		texel_count += mipmap.extent.width * mipmap.extent.height;
+
+		pending.levels.push_back(level);
+	}
+
+	pending.blocks = std::make_unique<core::Buffer>(device, block_count * BLOCK_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	auto &data = image.get_data();
+
+	for (size_t i = 0; i < pending.levels.size(); i++)
+	{
+		auto &level = pending.levels[i];
+
+		pending.blocks->update(data.data() + image.get_mipmaps()[i].offset, level.block_count * BLOCK_SIZE, level.block_offset * BLOCK_SIZE);
+	}
+
+	// RGBA8 texels
+	pending.texels = std::make_unique<core::Buffer>(device, texel_count * 4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+	images.push_back(std::move(pending));
+}
+
+void AstcDecoder::decode(CommandBuffer &command_buffer)
+{
+	if (images.empty())
+	{
+		return;
+	}
+
+	command_buffer.begin_debug_label("ASTC decode");
+
+	auto &resource_cache = device.get_resource_cache();
+
+	auto &shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_COMPUTE_BIT, ShaderSource{"astc/decode.comp"}, {});
+
+	std::vector<ShaderModule *> shader_modules{&shader_module};
+
+	command_buffer.bind_pipeline_layout(resource_cache.request_pipeline_layout(shader_modules, false));
+
+	// Levels are addressed with the push constants rather than buffer offsets, which have an alignment
+	for (auto &pending : images)
+	{
+		command_buffer.bind_buffer(*pending.blocks, 0, pending.blocks->get_size(), 0, 0, 0);
+		command_buffer.bind_buffer(*pending.texels, 0, pending.texels->get_size(), 0, 1, 0);
+
+		for (auto &level : pending.levels)
+		{
+			DecodeConstants constants{};
+			constants.block_offset = level.block_offset;
+			constants.texel_offset = level.texel_offset;
+			constants.width        = level.extent.width;
+			constants.height       = level.extent.height;
+			constants.block_width  = pending.block_width;
+			constants.block_height = pending.block_height;
+			constants.blocks_x     = level.blocks_x;
+			constants.block_count  = level.block_count;
+			constants.srgb         = pending.srgb ? 1 : 0;
+
+			command_buffer.push_constants(0, constants);
+
+			command_buffer.dispatch((level.block_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+		}
+	}
+
+	for (auto &pending : images)
+	{
+		BufferMemoryBarrier buffer_barrier{};
+		buffer_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		buffer_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		buffer_barrier.src_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+		buffer_barrier.dst_access_mask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		command_buffer.buffer_memory_barrier(*pending.texels, 0, pending.texels->get_size(), buffer_barrier);
+
+		auto &image      = *pending.image;
+		auto &image_view = image.get_vk_image_view();
+
+		ImageMemoryBarrier copy_barrier{};
+		copy_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+		copy_barrier.new_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		copy_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		copy_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		copy_barrier.dst_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		command_buffer.image_memory_barrier(image_view, copy_barrier);
+
+		std::vector<VkBufferImageCopy> regions;
+
+		for (uint32_t i = 0; i < to_u32(pending.levels.size()); i++)
+		{
+			auto &level = pending.levels[i];
+
+			VkBufferImageCopy region{};
+			region.bufferOffset                = level.texel_offset * 4;
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel   = i;
+			region.imageSubresource.layerCount = 1;
+			region.imageExtent                 = level.extent;
+
+			regions.push_back(region);
+		}
+
+		command_buffer.copy_buffer_to_image(*pending.texels, image.get_vk_image(), regions);
+
+		// Generated levels are blitted from TRANSFER_DST_OPTIMAL
+		if (image.get_gpu_mip_level_count() == 0)
+		{
+			ImageMemoryBarrier read_barrier{};
+			read_barrier.old_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			read_barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			read_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			read_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			read_barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			read_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+
+			command_buffer.image_memory_barrier(image_view, read_barrier);
+		}
+	}
+
+	command_buffer.end_debug_label();
+}
+
+bool AstcDecoder::empty() const
+{
+	return images.empty();
+}
+}        // namespace vkb
@@ -0,0 +1,117 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "common/vk_common.h"
+#include "core/buffer.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class Device;
+
+namespace sg
+{
+class Image;
+}
+
+/**
+ * @brief Decodes ASTC images with a compute shader, for devices which cannot sample them.
+ *        The blocks are uploaded as they are, then decoded into RGBA8 Vulkan images: this keeps
+ *        the decode off the CPU, which is otherwise the slowest part of loading ASTC scenes there.
+ *        Only the LDR profile of 2D blocks is supported, see astc/decode.comp
+ */
+class AstcDecoder
+{
+  public:
+	/// Blocks decoded by a workgroup
+	static const uint32_t WORKGROUP_SIZE;
+
+	/**
+	 * @return The format an ASTC format is decoded to, RGBA8 with the same color space
+	 */
+	static VkFormat get_decoded_format(VkFormat astc_format);
+
+	AstcDecoder(Device &device);
+
+	/**
+	 * @brief Uploads the blocks of the data levels of an image, whose data can then be cleared
+	 * @param image An ASTC image whose Vulkan image was created in the decoded format
+	 */
+	void add(sg::Image &image);
+
+	/**
+	 * @brief Records the decode of the images added into their Vulkan images, which must be recorded
+	 *        in a command buffer of a queue supporting compute, the decoder kept until it has completed.
+	 *        The images with levels to generate on the GPU are left in TRANSFER_DST_OPTIMAL layout for
+	 *        generate_gpu_mipmaps, the others in SHADER_READ_ONLY_OPTIMAL layout
+	 */
+	void decode(CommandBuffer &command_buffer);
+
+	/**
+	 * @return Whether no image was added
+	 */
+	bool empty() const;
+
+  private:
+	struct Level
+	{
+		VkExtent3D extent;
+
+		uint32_t blocks_x;
+
+		uint32_t block_count;
+
+		/// First block of the level in the block buffer
+		uint32_t block_offset;
+
+		/// First texel of the level in the texel buffer
+		uint32_t texel_offset;
+	};
+
+	struct PendingImage
+	{
+		sg::Image *image;
+
+		uint32_t block_width;
+
+		uint32_t block_height;
+
+		bool srgb;
+
+		std::vector<Level> levels;
+
+		/// Blocks of the levels, written by the host
+		std::unique_ptr<core::Buffer> blocks;
+
+		/// Decoded texels of the levels, copied to the image
+		std::unique_ptr<core::Buffer> texels;
+	};
+
+	Device &device;
+
+	/// Images added, with their buffers kept until the decode has completed
+	std::vector<PendingImage> images;
+};
+}        // namespace vkb
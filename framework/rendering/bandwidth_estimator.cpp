@@ -0,0 +1,123 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "bandwidth_estimator.h"
+
+#include "rendering/render_target.h"
+
+namespace vkb
+{
+RenderPassBandwidth &RenderPassBandwidth::operator+=(const RenderPassBandwidth &other)
+{
+	loaded_bytes += other.loaded_bytes;
+	stored_bytes += other.stored_bytes;
+	compressible_bytes += other.compressible_bytes;
+
+	return *this;
+}
+
+RenderPassBandwidth estimate_bandwidth(const RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store_infos, const std::string &name)
+{
+	RenderPassBandwidth bandwidth;
+	bandwidth.name = name;
+
+	auto &extent      = render_target.get_render_extent();
+	auto  pixel_count = static_cast<uint64_t>(extent.width) * extent.height;
+
+	auto &attachments = render_target.get_attachments();
+
+	for (size_t i = 0; i < attachments.size(); ++i)
+	{
+		auto &attachment = attachments[i];
+
+		// Lazily allocated, they never leave the tiles
+		if (attachment.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+		{
+			continue;
+		}
+
+		auto bits_per_pixel = get_bits_per_pixel(attachment.format);
+
+		if (bits_per_pixel <= 0)
+		{
+			continue;
+		}
+
+		auto size = pixel_count * static_cast<uint64_t>(attachment.samples) * static_cast<uint64_t>(bits_per_pixel) / 8;
+
+		// The attachments without operations are described with zeroed ones, which load and store
+		LoadStoreInfo load_store{VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE};
+
+		if (i < load_store_infos.size())
+		{
+			load_store = load_store_infos[i];
+		}
+
+		uint64_t traffic{0};
+
+		if (load_store.load_op == VK_ATTACHMENT_LOAD_OP_LOAD)
+		{
+			bandwidth.loaded_bytes += size;
+			traffic += size;
+		}
+
+		if (load_store.store_op == VK_ATTACHMENT_STORE_OP_STORE)
+		{
+			bandwidth.stored_bytes += size;
+			traffic += size;
+		}
+
+		if (is_afbc_eligible(attachment.usage))
+		{
+			bandwidth.compressible_bytes += traffic;
+		}
+	}
+
+	return bandwidth;
+}
+
+void BandwidthEstimator::add_render_pass(const RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store_infos, const std::string &name)
+{
+	render_passes.push_back(estimate_bandwidth(render_target, load_store_infos, name));
+}
+
+void BandwidthEstimator::reset()
+{
+	render_passes.clear();
+}
+
+const std::vector<RenderPassBandwidth> &BandwidthEstimator::get_render_passes() const
+{
+	return render_passes;
+}
+
+RenderPassBandwidth BandwidthEstimator::get_total() const
+{
+	RenderPassBandwidth total;
+	total.name = "Frame";
+
+	for (auto &render_pass : render_passes)
+	{
+		total += render_pass;
+	}
+
+	return total;
+}
+}        // namespace vkb
@@ -0,0 +1,94 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/vk_common.h"
+
+namespace vkb
+{
+class RenderTarget;
+
+/**
+ * @brief External memory traffic of a render pass on a tile-based GPU, estimated from its attachments
+ */
+struct RenderPassBandwidth
+{
+	/// Debug name of the first subpass
+	std::string name;
+
+	/// Bytes of the attachments read from memory into the tiles as the render pass begins
+	uint64_t loaded_bytes{0};
+
+	/// Bytes of the attachments written from the tiles to memory as the render pass ends
+	uint64_t stored_bytes{0};
+
+	/// Part of the loaded and stored bytes which framebuffer compression may reduce
+	uint64_t compressible_bytes{0};
+
+	RenderPassBandwidth &operator+=(const RenderPassBandwidth &other);
+};
+
+/**
+ * @brief Estimates the traffic of a render pass from the format, render extent and samples of its attachments,
+ *        their load and store operations and their usage. Transient attachments stay in tile memory,
+ *        and the other ones are assumed uncompressed, so that the estimate is an upper bound.
+ *        It does not account for the textures and buffers read by the draws
+ * @param render_target The render target of the render pass
+ * @param load_store_infos The load and store operations of the attachments, the missing ones load and store
+ * @param name Name of the render pass
+ */
+RenderPassBandwidth estimate_bandwidth(const RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store_infos, const std::string &name);
+
+/**
+ * @brief Sums the estimated traffic of the render passes recorded for a frame, to see the cost of the
+ *        load and store operations, transient attachments and formats chosen on any vendor,
+ *        compared with the external memory counters where they are available
+ */
+class BandwidthEstimator
+{
+  public:
+	/**
+	 * @brief Adds the estimate of a render pass of the frame
+	 */
+	void add_render_pass(const RenderTarget &render_target, const std::vector<LoadStoreInfo> &load_store_infos, const std::string &name);
+
+	/**
+	 * @brief Forgets the render passes of the previous recording
+	 */
+	void reset();
+
+	/**
+	 * @return The render passes recorded since the last reset, in order
+	 */
+	const std::vector<RenderPassBandwidth> &get_render_passes() const;
+
+	/**
+	 * @return The traffic of all the render passes recorded since the last reset
+	 */
+	RenderPassBandwidth get_total() const;
+
+  private:
+	std::vector<RenderPassBandwidth> render_passes;
+};
+}        // namespace vkb
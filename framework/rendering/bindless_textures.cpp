@@ -0,0 +1,94 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "bindless_textures.h"
+
+#include "common/logging.h"
+#include "core/descriptor_set_layout.h"
+#include "core/device.h"
+#include "scene_graph/components/image.h"
+#include "scene_graph/components/sampler.h"
+#include "scene_graph/components/texture.h"
+
+namespace vkb
+{
+const char *BindlessTextures::ARRAY_NAME = "textures";
+
+BindlessTextures::BindlessTextures(Device &device, const std::vector<sg::Texture *> &textures) :
+    device{device}
+{
+	auto &array_infos = image_infos[0];
+
+	for (auto texture : textures)
+	{
+		if (texture->get_image() == nullptr || texture->get_sampler() == nullptr)
+		{
+			LOGW("Texture `{}` has no image or sampler, not adding it to the bindless textures", texture->get_name());
+			continue;
+		}
+
+		uint32_t index = to_u32(indices.size());
+
+		VkDescriptorImageInfo image_info{};
+
+		image_info.sampler     = texture->get_sampler()->vk_sampler.get_handle();
+		image_info.imageView   = texture->get_image()->get_vk_image_view().get_handle();
+		image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		array_infos.emplace(index, image_info);
+
+		indices.emplace(texture, index);
+	}
+}
+
+uint32_t BindlessTextures::get_count() const
+{
+	return to_u32(indices.size());
+}
+
+uint32_t BindlessTextures::get_index(const sg::Texture &texture) const
+{
+	auto it = indices.find(&texture);
+
+	if (it == indices.end())
+	{
+		throw std::runtime_error("Texture is not registered in the bindless textures");
+	}
+
+	return it->second;
+}
+
+const DescriptorSet &BindlessTextures::request_descriptor_set(DescriptorSetLayout &descriptor_set_layout)
+{
+	std::lock_guard<std::mutex> guard(descriptor_set_mutex);
+
+	auto &layout_descriptor_set = descriptor_sets[descriptor_set_layout.get_handle()];
+
+	if (!layout_descriptor_set.descriptor_set)
+	{
+		// The set is written once and lives as long as the textures
+		layout_descriptor_set.descriptor_pool = std::make_unique<DescriptorPool>(device, descriptor_set_layout, 1);
+
+		layout_descriptor_set.descriptor_set = std::make_unique<DescriptorSet>(device, descriptor_set_layout, *layout_descriptor_set.descriptor_pool, BindingMap<VkDescriptorBufferInfo>{}, image_infos);
+	}
+
+	return *layout_descriptor_set.descriptor_set;
+}
+}        // namespace vkb
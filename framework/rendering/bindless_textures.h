@@ -0,0 +1,105 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+#include "core/descriptor_pool.h"
+#include "core/descriptor_set.h"
+
+namespace vkb
+{
+class Device;
+class DescriptorSetLayout;
+
+namespace sg
+{
+class Texture;
+}
+
+/**
+ * @brief Registers textures once into a single update-after-bind array of combined image samplers.
+ *        Materials then select their textures with an index, instead of binding a descriptor set each.
+ *        Requires VK_EXT_descriptor_indexing.
+ */
+class BindlessTextures
+{
+  public:
+	/// Name of the texture array in the shaders
+	static const char *ARRAY_NAME;
+
+	/// Descriptor set index of the texture array in the shaders
+	static const uint32_t SET_INDEX = 1;
+
+	BindlessTextures(Device &device, const std::vector<sg::Texture *> &textures);
+
+	BindlessTextures(const BindlessTextures &) = delete;
+
+	BindlessTextures(BindlessTextures &&) = delete;
+
+	~BindlessTextures() = default;
+
+	BindlessTextures &operator=(const BindlessTextures &) = delete;
+
+	BindlessTextures &operator=(BindlessTextures &&) = delete;
+
+	/**
+	 * @return The number of textures in the array, to be used as the runtime array size of the shaders
+	 */
+	uint32_t get_count() const;
+
+	/**
+	 * @return The index of a registered texture in the array
+	 */
+	uint32_t get_index(const sg::Texture &texture) const;
+
+	/**
+	 * @brief Thread safe function, allocates and writes the descriptor set holding all the textures
+	 *        the first time a layout requests it
+	 * @param descriptor_set_layout The layout of the texture array set
+	 * @return The descriptor set to bind at SET_INDEX
+	 */
+	const DescriptorSet &request_descriptor_set(DescriptorSetLayout &descriptor_set_layout);
+
+  private:
+	struct LayoutDescriptorSet
+	{
+		std::unique_ptr<DescriptorPool> descriptor_pool;
+
+		std::unique_ptr<DescriptorSet> descriptor_set;
+	};
+
+	Device &device;
+
+	std::unordered_map<const sg::Texture *, uint32_t> indices;
+
+	BindingMap<VkDescriptorImageInfo> image_infos;
+
+	std::mutex descriptor_set_mutex;
+
+	std::unordered_map<VkDescriptorSetLayout, LayoutDescriptorSet> descriptor_sets;
+};
+}        // namespace vkb
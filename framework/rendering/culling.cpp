@@ -0,0 +1,334 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/culling.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define VKB_CULLING_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#	include <arm_neon.h>
+#	define VKB_CULLING_NEON
+#endif
+
+#include "scene_graph/components/aabb.h"
+
+namespace vkb
+{
+Frustum::Frustum(const glm::mat4 &view_proj)
+{
+	// Rows of the matrix, which is stored in column major order
+	glm::vec4 row_x{view_proj[0][0], view_proj[1][0], view_proj[2][0], view_proj[3][0]};
+	glm::vec4 row_y{view_proj[0][1], view_proj[1][1], view_proj[2][1], view_proj[3][1]};
+	glm::vec4 row_z{view_proj[0][2], view_proj[1][2], view_proj[2][2], view_proj[3][2]};
+	glm::vec4 row_w{view_proj[0][3], view_proj[1][3], view_proj[2][3], view_proj[3][3]};
+
+	// Left, right, bottom, top, near and far, the near plane is at z = 0 in Vulkan
+	planes[0] = row_w + row_x;
+	planes[1] = row_w - row_x;
+	planes[2] = row_w + row_y;
+	planes[3] = row_w - row_y;
+	planes[4] = row_z;
+	planes[5] = row_w - row_z;
+
+	for (auto &plane : planes)
+	{
+		float length = glm::length(glm::vec3(plane));
+
+		// The far plane of an infinite projection has no normal, and culls nothing
+		plane = length > 0.0f ? plane / length : glm::vec4{0.0f, 0.0f, 0.0f, 1.0f};
+	}
+}
+
+bool Frustum::intersects(const sg::AABB &bounds) const
+{
+	glm::vec3 min = bounds.get_min();
+	glm::vec3 max = bounds.get_max();
+
+	for (auto &plane : planes)
+	{
+		// Corner of the box furthest along the plane normal
+		glm::vec3 corner{plane.x > 0.0f ? max.x : min.x,
+		                 plane.y > 0.0f ? max.y : min.y,
+		                 plane.z > 0.0f ? max.z : min.z};
+
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const std::array<glm::vec4, 6> &Frustum::get_planes() const
+{
+	return planes;
+}
+
+void BoundsBatch::clear()
+{
+	for (auto &values : local_centers)
+	{
+		values.clear();
+	}
+
+	for (auto &values : local_extents)
+	{
+		values.clear();
+	}
+
+	for (auto &values : world_matrices)
+	{
+		values.clear();
+	}
+}
+
+size_t BoundsBatch::add(const sg::AABB &local_bounds, const glm::mat4 &world_matrix)
+{
+	glm::vec3 center  = local_bounds.get_center();
+	glm::vec3 extents = 0.5f * (local_bounds.get_max() - local_bounds.get_min());
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		local_centers[axis].push_back(center[axis]);
+		local_extents[axis].push_back(extents[axis]);
+	}
+
+	for (int row = 0; row < 3; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			world_matrices[row * 4 + column].push_back(world_matrix[column][row]);
+		}
+	}
+
+	return local_centers[0].size() - 1;
+}
+
+size_t BoundsBatch::size() const
+{
+	return local_centers[0].size();
+}
+
+void BoundsBatch::transform()
+{
+	size_t count = size();
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		world_centers[axis].resize(count);
+		world_extents[axis].resize(count);
+	}
+
+	// World extents are the local ones multiplied by the absolute values of the linear part of the matrix (Arvo)
+	size_t i = 0;
+
+#if defined(VKB_CULLING_SSE2)
+	const __m128 sign_mask = _mm_set1_ps(-0.0f);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 center[3];
+		__m128 extents[3];
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			center[axis]  = _mm_loadu_ps(local_centers[axis].data() + i);
+			extents[axis] = _mm_loadu_ps(local_extents[axis].data() + i);
+		}
+
+		for (int row = 0; row < 3; row++)
+		{
+			__m128 m0 = _mm_loadu_ps(world_matrices[row * 4 + 0].data() + i);
+			__m128 m1 = _mm_loadu_ps(world_matrices[row * 4 + 1].data() + i);
+			__m128 m2 = _mm_loadu_ps(world_matrices[row * 4 + 2].data() + i);
+			__m128 m3 = _mm_loadu_ps(world_matrices[row * 4 + 3].data() + i);
+
+			__m128 world_center = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, center[0]), _mm_mul_ps(m1, center[1])),
+			                                 _mm_add_ps(_mm_mul_ps(m2, center[2]), m3));
+
+			__m128 world_extent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, m0), extents[0]),
+			                                            _mm_mul_ps(_mm_andnot_ps(sign_mask, m1), extents[1])),
+			                                 _mm_mul_ps(_mm_andnot_ps(sign_mask, m2), extents[2]));
+
+			_mm_storeu_ps(world_centers[row].data() + i, world_center);
+			_mm_storeu_ps(world_extents[row].data() + i, world_extent);
+		}
+	}
+#elif defined(VKB_CULLING_NEON)
+	for (; i + 4 <= count; i += 4)
+	{
+		float32x4_t center[3];
+		float32x4_t extents[3];
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			center[axis]  = vld1q_f32(local_centers[axis].data() + i);
+			extents[axis] = vld1q_f32(local_extents[axis].data() + i);
+		}
+
+		for (int row = 0; row < 3; row++)
+		{
+			float32x4_t m0 = vld1q_f32(world_matrices[row * 4 + 0].data() + i);
+			float32x4_t m1 = vld1q_f32(world_matrices[row * 4 + 1].data() + i);
+			float32x4_t m2 = vld1q_f32(world_matrices[row * 4 + 2].data() + i);
+			float32x4_t m3 = vld1q_f32(world_matrices[row * 4 + 3].data() + i);
+
+			float32x4_t world_center = vmlaq_f32(vmlaq_f32(vmlaq_f32(m3, m0, center[0]), m1, center[1]), m2, center[2]);
+
+			float32x4_t world_extent = vmlaq_f32(vmlaq_f32(vmulq_f32(vabsq_f32(m0), extents[0]), vabsq_f32(m1), extents[1]), vabsq_f32(m2), extents[2]);
+
+			vst1q_f32(world_centers[row].data() + i, world_center);
+			vst1q_f32(world_extents[row].data() + i, world_extent);
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		for (int row = 0; row < 3; row++)
+		{
+			const float m0 = world_matrices[row * 4 + 0][i];
+			const float m1 = world_matrices[row * 4 + 1][i];
+			const float m2 = world_matrices[row * 4 + 2][i];
+			const float m3 = world_matrices[row * 4 + 3][i];
+
+			world_centers[row][i] = m0 * local_centers[0][i] + m1 * local_centers[1][i] + m2 * local_centers[2][i] + m3;
+			world_extents[row][i] = std::abs(m0) * local_extents[0][i] + std::abs(m1) * local_extents[1][i] + std::abs(m2) * local_extents[2][i];
+		}
+	}
+}
+
+void BoundsBatch::intersect(const Frustum &frustum, std::vector<uint8_t> &visible) const
+{
+	size_t count = size();
+
+	visible.resize(count);
+
+	// A box is outside a plane if its center is further behind it than the projection of its extents on the normal
+	const auto &planes = frustum.get_planes();
+
+	std::array<glm::vec3, 6> abs_normals;
+
+	for (size_t p = 0; p < planes.size(); p++)
+	{
+		abs_normals[p] = glm::abs(glm::vec3(planes[p]));
+	}
+
+	size_t i = 0;
+
+#if defined(VKB_CULLING_SSE2)
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 center[3];
+		__m128 extents[3];
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			center[axis]  = _mm_loadu_ps(world_centers[axis].data() + i);
+			extents[axis] = _mm_loadu_ps(world_extents[axis].data() + i);
+		}
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for (size_t p = 0; p < planes.size(); p++)
+		{
+			const auto &plane = planes[p];
+
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), center[0]), _mm_mul_ps(_mm_set1_ps(plane.y), center[1])),
+			                             _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), center[2]), _mm_set1_ps(plane.w)));
+
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(abs_normals[p].x), extents[0]), _mm_mul_ps(_mm_set1_ps(abs_normals[p].y), extents[1])),
+			                           _mm_mul_ps(_mm_set1_ps(abs_normals[p].z), extents[2]));
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+
+		for (size_t lane = 0; lane < 4; lane++)
+		{
+			visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+		}
+	}
+#elif defined(VKB_CULLING_NEON)
+	for (; i + 4 <= count; i += 4)
+	{
+		float32x4_t center[3];
+		float32x4_t extents[3];
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			center[axis]  = vld1q_f32(world_centers[axis].data() + i);
+			extents[axis] = vld1q_f32(world_extents[axis].data() + i);
+		}
+
+		uint32x4_t inside = vdupq_n_u32(~0U);
+
+		for (size_t p = 0; p < planes.size(); p++)
+		{
+			const auto &plane = planes[p];
+
+			float32x4_t distance = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(plane.w), center[0], plane.x), center[1], plane.y), center[2], plane.z);
+
+			distance = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(distance, extents[0], abs_normals[p].x), extents[1], abs_normals[p].y), extents[2], abs_normals[p].z);
+
+			inside = vandq_u32(inside, vcgeq_f32(distance, vdupq_n_f32(0.0f)));
+		}
+
+		uint32_t lanes[4];
+		vst1q_u32(lanes, inside);
+
+		for (size_t lane = 0; lane < 4; lane++)
+		{
+			visible[i + lane] = static_cast<uint8_t>(lanes[lane] != 0);
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		bool inside = true;
+
+		for (size_t p = 0; p < planes.size() && inside; p++)
+		{
+			const auto &plane = planes[p];
+
+			float distance = plane.x * world_centers[0][i] + plane.y * world_centers[1][i] + plane.z * world_centers[2][i] + plane.w;
+			float radius   = abs_normals[p].x * world_extents[0][i] + abs_normals[p].y * world_extents[1][i] + abs_normals[p].z * world_extents[2][i];
+
+			inside = distance + radius >= 0.0f;
+		}
+
+		visible[i] = static_cast<uint8_t>(inside);
+	}
+}
+
+sg::AABB BoundsBatch::get_world_bounds(size_t index) const
+{
+	glm::vec3 center{world_centers[0][index], world_centers[1][index], world_centers[2][index]};
+	glm::vec3 extents{world_extents[0][index], world_extents[1][index], world_extents[2][index]};
+
+	return sg::AABB{center - extents, center + extents};
+}
+}        // namespace vkb
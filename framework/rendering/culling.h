@@ -0,0 +1,148 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+namespace vkb
+{
+namespace sg
+{
+class AABB;
+}        // namespace sg
+
+/**
+ * @brief Settings for the culling of draws on the CPU, a value of zero disables the test
+ */
+struct CullingOptions
+{
+	/// Cull objects which are entirely outside the view frustum
+	bool frustum{true};
+
+	/// Cull objects further away from the camera than this distance
+	float max_distance{0.0f};
+
+	/// Cull objects which cover less than this fraction of the viewport height
+	float min_screen_size{0.0f};
+};
+
+/**
+ * @brief Number of objects drawn and culled by each test in the last frame
+ */
+struct CullingStats
+{
+	uint32_t visible{0};
+
+	uint32_t frustum_culled{0};
+
+	uint32_t distance_culled{0};
+
+	uint32_t size_culled{0};
+
+	uint32_t occlusion_culled{0};
+
+	/// Visible sub meshes drawn with a simplified level of detail
+	uint32_t simplified{0};
+};
+
+/**
+ * @brief View frustum of a camera, as six planes pointing inwards
+ */
+class Frustum
+{
+  public:
+	/**
+	 * @brief Extracts the frustum planes from a view projection matrix
+	 * @param view_proj Vulkan style (depth from zero to one) view projection matrix
+	 */
+	Frustum(const glm::mat4 &view_proj);
+
+	/**
+	 * @return True if the bounding box is at least partially inside the frustum
+	 */
+	bool intersects(const sg::AABB &bounds) const;
+
+	/**
+	 * @return The left, right, bottom, top, near and far planes, normalized
+	 */
+	const std::array<glm::vec4, 6> &get_planes() const;
+
+  private:
+	std::array<glm::vec4, 6> planes;
+};
+
+/**
+ * @brief Bounding boxes of many objects as centers and half extents, stored as structure of arrays
+ *        next to the world matrices of the objects, so that they are transformed and tested against
+ *        a frustum four at a time with SSE2 or NEON
+ */
+class BoundsBatch
+{
+  public:
+	void clear();
+
+	/**
+	 * @brief Appends the box of an object
+	 * @param local_bounds Bounding box in the space of the object
+	 * @param world_matrix Affine transform of the object to world space
+	 * @return Index of the box in the batch
+	 */
+	size_t add(const sg::AABB &local_bounds, const glm::mat4 &world_matrix);
+
+	size_t size() const;
+
+	/**
+	 * @brief Transforms all the boxes to world space
+	 */
+	void transform();
+
+	/**
+	 * @brief Tests all the world space boxes against a frustum
+	 * @param frustum Frustum to test against
+	 * @param[out] visible One per box, non-zero if the box is at least partially inside the frustum
+	 */
+	void intersect(const Frustum &frustum, std::vector<uint8_t> &visible) const;
+
+	/**
+	 * @return The world space box at an index, once transformed
+	 */
+	sg::AABB get_world_bounds(size_t index) const;
+
+  private:
+	std::array<std::vector<float>, 3> local_centers;
+
+	std::array<std::vector<float>, 3> local_extents;
+
+	/// Upper three rows of the world matrices, element (row, column) at row * 4 + column
+	std::array<std::vector<float>, 12> world_matrices;
+
+	std::array<std::vector<float>, 3> world_centers;
+
+	std::array<std::vector<float>, 3> world_extents;
+};
+}        // namespace vkb
@@ -0,0 +1,178 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/draw_list.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+
+#include "scene_graph/components/material.h"
+#include "scene_graph/components/sub_mesh.h"
+
+namespace vkb
+{
+namespace
+{
+constexpr uint64_t TRANSPARENT_BIT = uint64_t{1} << 63;
+
+uint16_t fold_to_u16(size_t value)
+{
+	uint64_t wide = static_cast<uint64_t>(value);
+	return static_cast<uint16_t>(wide ^ (wide >> 16) ^ (wide >> 32) ^ (wide >> 48));
+}
+
+uint64_t make_key(const sg::SubMesh &sub_mesh, float distance, uint32_t lod, bool transparent_sorting)
+{
+	auto material = sub_mesh.get_material();
+
+	size_t pipeline_hash{0};
+	hash_combine(pipeline_hash, sub_mesh.get_shader_variant().get_id());
+	hash_combine(pipeline_hash, material->double_sided);
+
+	uint64_t pipeline_bits = fold_to_u16(pipeline_hash);
+	uint64_t material_bits = fold_to_u16(std::hash<const sg::Material *>{}(material));
+	size_t sub_mesh_hash{0};
+	hash_combine(sub_mesh_hash, &sub_mesh);
+	hash_combine(sub_mesh_hash, lod);
+
+	uint64_t sub_mesh_bits = fold_to_u16(sub_mesh_hash);
+
+	// The bits of a non-negative float have the same order as its value
+	uint32_t depth_bits{0};
+	float    depth = std::max(distance, 0.0f);
+	std::memcpy(&depth_bits, &depth, sizeof(depth_bits));
+
+	bool transparent = material->alpha_mode == sg::AlphaMode::Blend;
+
+	if (transparent && transparent_sorting)
+	{
+		// Back to front, state only breaks ties
+		return TRANSPARENT_BIT | (uint64_t{~depth_bits} << 31) | (pipeline_bits << 15) | (material_bits & 0x7FFF);
+	}
+
+	// Sign bit of the depth is always zero. The sub mesh comes before the depth
+	// so that repeated sub meshes are adjacent and can be drawn as instances
+	uint64_t key = ((pipeline_bits & 0x7FF) << 52) | ((material_bits & 0x7FF) << 41) | ((sub_mesh_bits & 0x3FF) << 31) | depth_bits;
+
+	return transparent ? TRANSPARENT_BIT | key : key;
+}
+}        // namespace
+
+void DrawList::clear()
+{
+	unsorted_items.clear();
+	items.clear();
+	entries.clear();
+	opaque_count = 0;
+	sorted       = true;
+}
+
+void DrawList::set_transparent_sorting(bool enable)
+{
+	transparent_sorting = enable;
+}
+
+void DrawList::add(sg::Node &node, sg::SubMesh &sub_mesh, float distance, uint32_t lod)
+{
+	entries.push_back({make_key(sub_mesh, distance, lod, transparent_sorting), to_u32(unsorted_items.size())});
+	unsorted_items.push_back({&node, &sub_mesh, lod});
+	sorted = false;
+}
+
+void DrawList::sort()
+{
+	if (sorted)
+	{
+		return;
+	}
+
+	scratch_entries.resize(entries.size());
+
+	// Least significant digit first radix sort, one byte per pass
+	for (uint32_t shift = 0; shift < 64; shift += 8)
+	{
+		std::array<size_t, 256> offsets{};
+
+		for (auto &entry : entries)
+		{
+			offsets[(entry.key >> shift) & 0xFF]++;
+		}
+
+		// Skip the pass if all keys share this byte, as it would not change the order
+		if (offsets[entries.front().key >> shift & 0xFF] == entries.size())
+		{
+			continue;
+		}
+
+		size_t offset = 0;
+		for (auto &count : offsets)
+		{
+			size_t bucket_size = count;
+			count              = offset;
+			offset += bucket_size;
+		}
+
+		for (auto &entry : entries)
+		{
+			scratch_entries[offsets[(entry.key >> shift) & 0xFF]++] = entry;
+		}
+
+		std::swap(entries, scratch_entries);
+	}
+
+	items.resize(entries.size());
+	opaque_count = 0;
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		items[i] = unsorted_items[entries[i].index];
+
+		if ((entries[i].key & TRANSPARENT_BIT) == 0)
+		{
+			opaque_count++;
+		}
+	}
+
+	sorted = true;
+}
+
+const std::vector<DrawItem> &DrawList::get_items() const
+{
+	assert(sorted && "Draw list must be sorted before accessing its items");
+	return items;
+}
+
+size_t DrawList::get_opaque_count() const
+{
+	return opaque_count;
+}
+
+size_t DrawList::size() const
+{
+	return unsorted_items.size();
+}
+
+bool DrawList::empty() const
+{
+	return unsorted_items.empty();
+}
+}        // namespace vkb
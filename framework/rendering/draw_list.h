@@ -0,0 +1,132 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "common/helpers.h"
+
+namespace vkb
+{
+namespace sg
+{
+class Node;
+class SubMesh;
+}        // namespace sg
+
+/**
+ * @brief A node and one of its sub meshes to draw
+ */
+struct DrawItem
+{
+	sg::Node *node{nullptr};
+
+	sg::SubMesh *sub_mesh{nullptr};
+
+	/// Level of detail of the sub mesh, zero for the full sub mesh
+	uint32_t lod{0};
+};
+
+/**
+ * @brief Per-frame list of draws ordered by a 64-bit sort key.
+ *
+ * Opaque draws are sorted by pipeline state, then material, then sub mesh, then front to back,
+ * so that pipeline and descriptor changes are minimised and repeated sub meshes are adjacent. Transparent draws are sorted back to front,
+ * or as the opaque draws if their blend does not depend on the order, and come after all opaque draws. Keys are sorted with a radix sort, and the storage is kept
+ * between frames so that a list of similar size does not allocate after the first frame.
+ */
+class DrawList
+{
+  public:
+	DrawList() = default;
+
+	DrawList(const DrawList &) = delete;
+
+	DrawList(DrawList &&) = default;
+
+	DrawList &operator=(const DrawList &) = delete;
+
+	DrawList &operator=(DrawList &&) = default;
+
+	/**
+	 * @brief Removes all draws, keeping the allocated storage
+	 */
+	void clear();
+
+	/**
+	 * @brief Sorts the transparent draws back to front, enabled by default. Otherwise they are grouped
+	 *        by state as the opaque draws, for blends which do not depend on the order such as
+	 *        weighted blended transparency. Applies to the draws added afterwards
+	 */
+	void set_transparent_sorting(bool enable);
+
+	/**
+	 * @brief Adds a draw to the list, the order is only updated by sort()
+	 * @param node Node providing the transform
+	 * @param sub_mesh Sub mesh to draw, its shader variant and material are part of the key
+	 * @param distance Distance from the camera
+	 * @param lod Level of detail of the sub mesh, draws of the same level are adjacent
+	 */
+	void add(sg::Node &node, sg::SubMesh &sub_mesh, float distance, uint32_t lod = 0);
+
+	/**
+	 * @brief Orders the draws by their keys
+	 */
+	void sort();
+
+	/**
+	 * @return The draws, opaque draws first, in the order given by the last sort()
+	 */
+	const std::vector<DrawItem> &get_items() const;
+
+	/**
+	 * @return Number of opaque draws at the front of the list
+	 */
+	size_t get_opaque_count() const;
+
+	size_t size() const;
+
+	bool empty() const;
+
+  private:
+	struct SortEntry
+	{
+		uint64_t key;
+
+		uint32_t index;
+	};
+
+	std::vector<DrawItem> unsorted_items;
+
+	std::vector<DrawItem> items;
+
+	std::vector<SortEntry> entries;
+
+	std::vector<SortEntry> scratch_entries;
+
+	size_t opaque_count{0};
+
+	bool sorted{true};
+
+	bool transparent_sorting{true};
+};
+}        // namespace vkb
@@ -0,0 +1,377 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/dynamic_resolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "gui.h"
+#include "rendering/render_context.h"
+#include "rendering/subpass.h"
+
+namespace vkb
+{
+namespace
+{
+/// Weight of the last GPU frame time in the average
+constexpr float FRAME_TIME_SMOOTHING = 0.1f;
+
+/// Relative distance to the target within which the scale does not change
+constexpr float FRAME_TIME_HYSTERESIS = 0.05f;
+
+/// Largest change of the scale at once
+constexpr float MAX_SCALE_STEP = 0.1f;
+
+/// Frames before the next change, so that the GPU times measure the last one
+constexpr uint32_t SCALE_UPDATE_INTERVAL = 8;
+
+/**
+ * @brief Creates a scene render target for temporal upscaling, of a color image, a depth image and the motion vectors
+ */
+RenderTarget create_temporal_render_target(core::Image &&color_image)
+{
+	auto &device = color_image.get_device();
+	auto  extent = color_image.get_extent();
+
+	core::Image depth_image{device, extent,
+	                        device.get_depth_format(),
+	                        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+	                        VMA_MEMORY_USAGE_GPU_ONLY};
+
+	core::Image motion_vectors_image{device, extent,
+	                                 TemporalUpscaler::MOTION_VECTOR_FORMAT,
+	                                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	                                 VMA_MEMORY_USAGE_GPU_ONLY};
+
+	std::vector<core::Image> images;
+	images.push_back(std::move(color_image));
+	images.push_back(std::move(depth_image));
+	images.push_back(std::move(motion_vectors_image));
+
+	return RenderTarget{std::move(images)};
+}
+}        // namespace
+
+/**
+ * @brief Draws the gui, which binds its own shaders
+ */
+class DynamicResolution::GuiSubpass : public Subpass
+{
+  public:
+	GuiSubpass(RenderContext &render_context) :
+	    Subpass{render_context, ShaderSource{"imgui.vert"}, ShaderSource{"imgui.frag"}}
+	{
+	}
+
+	void prepare() override
+	{
+	}
+
+	void draw(CommandBuffer &command_buffer) override
+	{
+		if (gui)
+		{
+			gui->draw(command_buffer);
+		}
+	}
+
+	Gui *gui{nullptr};
+};
+
+DynamicResolution::DynamicResolution(RenderTarget::CreateFunc create_render_target_func_, float target_frame_time, float lowest_scale, float highest_scale) :
+    create_render_target_func{std::move(create_render_target_func_)},
+    target_frame_time{target_frame_time}
+{
+	set_scale_bounds(lowest_scale, highest_scale);
+
+	scale = max_scale;
+}
+
+void DynamicResolution::set_target_frame_time(float frame_time)
+{
+	target_frame_time = frame_time;
+}
+
+float DynamicResolution::get_target_frame_time() const
+{
+	return target_frame_time;
+}
+
+void DynamicResolution::set_scale_bounds(float lowest, float highest)
+{
+	assert(lowest > 0.0f && lowest <= highest && highest <= 1.0f && "Scale bounds should be within (0, 1]");
+
+	min_scale = lowest;
+	max_scale = highest;
+	scale     = std::max(min_scale, std::min(scale, max_scale));
+}
+
+float DynamicResolution::get_scale() const
+{
+	return scale;
+}
+
+void DynamicResolution::set_temporal_upscaling(bool enable)
+{
+	temporal_upscaling = enable;
+}
+
+bool DynamicResolution::uses_temporal_upscaling() const
+{
+	return temporal_upscaling;
+}
+
+glm::vec2 DynamicResolution::get_jitter() const
+{
+	return temporal_upscaler ? temporal_upscaler->get_jitter() : glm::vec2{0.0f};
+}
+
+void DynamicResolution::update(RenderContext &render_context)
+{
+	for (auto &frame : render_context.get_render_frames())
+	{
+		frame.get_gpu_profiler().set_enabled(true);
+	}
+
+	update(render_context.get_last_rendered_frame().get_gpu_profiler().get_frame_time());
+
+	if (temporal_upscaling)
+	{
+		if (!temporal_upscaler)
+		{
+			temporal_upscaler = std::make_unique<TemporalUpscaler>(render_context.get_device());
+		}
+
+		// The jitter spans a pixel of the extent the frame renders at
+		auto extent = render_context.get_surface_extent();
+
+		temporal_upscaler->next_jitter({static_cast<uint32_t>(extent.width * scale),
+		                                static_cast<uint32_t>(extent.height * scale)});
+	}
+}
+
+void DynamicResolution::update(float gpu_frame_time)
+{
+	if (gpu_frame_time <= 0.0f)
+	{
+		return;
+	}
+
+	if (average_frame_time <= 0.0f)
+	{
+		average_frame_time = gpu_frame_time;
+	}
+	else
+	{
+		average_frame_time += (gpu_frame_time - average_frame_time) * FRAME_TIME_SMOOTHING;
+	}
+
+	if (frames_until_update > 0)
+	{
+		--frames_until_update;
+		return;
+	}
+
+	float ratio = target_frame_time / average_frame_time;
+
+	if (std::abs(ratio - 1.0f) < FRAME_TIME_HYSTERESIS)
+	{
+		return;
+	}
+
+	// The GPU time mostly follows the pixel count, which grows with the square of the scale
+	float new_scale = scale * std::sqrt(ratio);
+	new_scale       = std::max(scale - MAX_SCALE_STEP, std::min(new_scale, scale + MAX_SCALE_STEP));
+	new_scale       = std::max(min_scale, std::min(new_scale, max_scale));
+
+	if (new_scale != scale)
+	{
+		scale               = new_scale;
+		frames_until_update = SCALE_UPDATE_INTERVAL;
+	}
+}
+
+bool DynamicResolution::is_supported(RenderContext &render_context)
+{
+	if (!support_checked)
+	{
+		support_checked = true;
+
+		auto format = render_context.get_swapchain().get_format();
+
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(render_context.get_device().get_physical_device(), format, &properties);
+
+		const VkFormatFeatureFlags features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+		supported = (properties.optimalTilingFeatures & features) == features &&
+		            (render_context.get_swapchain().get_usage() & VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
+		if (!supported)
+		{
+			LOGW("Dynamic resolution disabled, the swapchain images cannot be blitted to");
+		}
+	}
+
+	return supported;
+}
+
+RenderTarget &DynamicResolution::get_render_target(RenderContext &render_context)
+{
+	auto &frames = render_context.get_render_frames();
+
+	render_targets.resize(frames.size());
+
+	auto &swapchain_target = render_context.get_active_frame().get_render_target();
+	auto &render_target    = render_targets[render_context.get_active_frame_index()];
+
+	auto &extent = swapchain_target.get_extent();
+	auto  format = swapchain_target.get_views().at(0).get_image().get_format();
+
+	if (!render_target || render_target->get_extent().width != extent.width || render_target->get_extent().height != extent.height ||
+	    render_target->get_views().at(0).get_image().get_format() != format)
+	{
+		// Sampled by the temporal upscaler, blitted otherwise
+		VkImageUsageFlags color_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+		if (temporal_upscaling)
+		{
+			color_usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+		}
+
+		core::Image color_image{render_context.get_device(), VkExtent3D{extent.width, extent.height, 1},
+		                        format,
+		                        color_usage,
+		                        VMA_MEMORY_USAGE_GPU_ONLY};
+
+		auto new_target = temporal_upscaling ? create_temporal_render_target(std::move(color_image)) :
+		                                       create_render_target_func(std::move(color_image));
+
+		if (render_target)
+		{
+			*render_target = std::move(new_target);
+		}
+		else
+		{
+			render_target = std::make_unique<RenderTarget>(std::move(new_target));
+		}
+	}
+
+	render_target->set_render_extent({static_cast<uint32_t>(extent.width * scale),
+	                                  static_cast<uint32_t>(extent.height * scale)});
+
+	if (!gui_pipeline)
+	{
+		auto subpass = std::make_unique<GuiSubpass>(render_context);
+		gui_subpass  = subpass.get();
+
+		gui_pipeline = std::make_unique<RenderPipeline>();
+		gui_pipeline->add_subpass(std::move(subpass));
+		gui_pipeline->set_load_store({{VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE}});
+	}
+
+	return *render_target;
+}
+
+void DynamicResolution::upscale(CommandBuffer &command_buffer, RenderTarget &scene_target, RenderTarget &swapchain_target, Gui *gui)
+{
+	auto &swapchain_view = swapchain_target.get_views().at(0);
+
+	auto &extent = swapchain_target.get_extent();
+
+	// The area blitted from, the history already has the extent of the swapchain images
+	const core::ImageView *source_view   = &scene_target.get_views().at(0);
+	VkExtent2D             source_extent = scene_target.get_render_extent();
+
+	if (temporal_upscaling && temporal_upscaler)
+	{
+		source_view   = &temporal_upscaler->resolve(command_buffer, scene_target, extent);
+		source_extent = extent;
+	}
+	else
+	{
+		ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		memory_barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_TRANSFER_READ_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+		command_buffer.image_memory_barrier(*source_view, memory_barrier);
+	}
+
+	{
+		// The acquired image is waited for at the color attachment output stage
+		ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		memory_barrier.src_access_mask = 0;
+		memory_barrier.dst_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+		command_buffer.image_memory_barrier(swapchain_view, memory_barrier);
+	}
+
+	VkImageBlit blit{};
+	blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+	blit.srcOffsets[1]  = {static_cast<int32_t>(source_extent.width), static_cast<int32_t>(source_extent.height), 1};
+	blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+	blit.dstOffsets[1]  = {static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1};
+
+	command_buffer.blit_image(source_view->get_image(), swapchain_view.get_image(), {blit}, VK_FILTER_LINEAR);
+
+	{
+		ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		memory_barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+		command_buffer.image_memory_barrier(swapchain_view, memory_barrier);
+	}
+
+	if (gui && gui_pipeline)
+	{
+		VkViewport viewport{};
+		viewport.width    = static_cast<float>(extent.width);
+		viewport.height   = static_cast<float>(extent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		command_buffer.set_viewport(0, {viewport});
+
+		VkRect2D scissor{};
+		scissor.extent = extent;
+		command_buffer.set_scissor(0, {scissor});
+
+		gui_subpass->gui = gui;
+
+		gui_pipeline->draw(command_buffer, swapchain_target);
+
+		command_buffer.end_render_pass();
+	}
+}
+}        // namespace vkb
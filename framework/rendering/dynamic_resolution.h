@@ -0,0 +1,153 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+#include "rendering/render_pipeline.h"
+#include "rendering/render_target.h"
+#include "rendering/temporal_upscaler.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class Gui;
+class RenderContext;
+
+/**
+ * @brief Scales the resolution the scene renders at to keep the GPU frame time on a target.
+ *
+ * The scene renders to offscreen render targets, one per render frame, built with the render
+ * target function of the sample from a full size color image, of which only the scaled area is
+ * rendered to. The result is blitted to the swapchain image, and the gui drawn at full resolution
+ * over it. The GPU time of the frames is measured by the GpuProfiler of the render frames.
+ *
+ * With temporal upscaling the render targets are built by DynamicResolution instead, with the motion vectors
+ * the TemporalUpscaler reprojects its history with, which is blitted to the swapchain image in place of the scene.
+ */
+class DynamicResolution
+{
+  public:
+	/**
+	 * @param create_render_target_func Function creating the render targets of the scene from their first image
+	 * @param target_frame_time GPU frame time to stay below, in seconds
+	 * @param min_scale Lowest scale of the render extent
+	 * @param max_scale Highest scale of the render extent, at most 1
+	 */
+	DynamicResolution(RenderTarget::CreateFunc create_render_target_func, float target_frame_time, float min_scale = 0.5f, float max_scale = 1.0f);
+
+	void set_target_frame_time(float frame_time);
+
+	float get_target_frame_time() const;
+
+	/**
+	 * @brief Sets the bounds of the scale, within (0, 1]
+	 */
+	void set_scale_bounds(float min_scale, float max_scale);
+
+	/**
+	 * @return The current scale of the render extent
+	 */
+	float get_scale() const;
+
+	/**
+	 * @brief Upscales with a TemporalUpscaler instead of a blit, the scene render targets then hold a color image (0),
+	 *        a depth image (1) and the motion vectors (TemporalUpscaler::MOTION_VECTOR_ATTACHMENT), written by a
+	 *        geometry subpass drawn with a jittered camera. Must be set before the first render target is requested
+	 */
+	void set_temporal_upscaling(bool enable);
+
+	bool uses_temporal_upscaling() const;
+
+	/**
+	 * @return The jitter of the camera for the next frame, zero without temporal upscaling
+	 */
+	glm::vec2 get_jitter() const;
+
+	/**
+	 * @brief Updates the scale from the GPU time of the last rendered frame, before the next frame
+	 *        is recorded, and keeps the GPU profilers of the frames enabled. With temporal upscaling,
+	 *        it also moves to the jitter of the next frame
+	 */
+	void update(RenderContext &render_context);
+
+	/**
+	 * @brief Updates the scale from a measured GPU frame time, ignored if not positive
+	 */
+	void update(float gpu_frame_time);
+
+	/**
+	 * @return Whether the swapchain format supports the blit, which is checked once
+	 */
+	bool is_supported(RenderContext &render_context);
+
+	/**
+	 * @brief Gets the scene render target of the active frame, created or recreated for the extent
+	 *        and the format of the frame render target, with its render extent at the current scale
+	 */
+	RenderTarget &get_render_target(RenderContext &render_context);
+
+	/**
+	 * @brief Blits the rendered area of the scene render target to the swapchain image of the frame
+	 *        render target, or the history accumulated from it with temporal upscaling, then draws the gui
+	 *        in a render pass over it. The first image of the scene render target must be a color attachment
+	 *        and the swapchain image is left as one.
+	 */
+	void upscale(CommandBuffer &command_buffer, RenderTarget &scene_target, RenderTarget &swapchain_target, Gui *gui);
+
+  private:
+	class GuiSubpass;
+
+	RenderTarget::CreateFunc create_render_target_func;
+
+	float target_frame_time;
+
+	float min_scale;
+
+	float max_scale;
+
+	float scale{1.0f};
+
+	/// Moving average of the GPU frame times
+	float average_frame_time{0.0f};
+
+	/// Frames to wait before the next change, as GPU times lag behind by the frames in flight
+	uint32_t frames_until_update{0};
+
+	bool support_checked{false};
+
+	bool supported{false};
+
+	bool temporal_upscaling{false};
+
+	std::unique_ptr<TemporalUpscaler> temporal_upscaler;
+
+	std::vector<std::unique_ptr<RenderTarget>> render_targets;
+
+	/// Render pass drawing the gui over the upscaled image
+	std::unique_ptr<RenderPipeline> gui_pipeline;
+
+	GuiSubpass *gui_subpass{nullptr};
+};
+}        // namespace vkb
@@ -0,0 +1,296 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/environment_lighting.h"
+
+#include <cmath>
+
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "scene_graph/components/image.h"
+
+namespace vkb
+{
+namespace
+{
+/// Workgroup size of the compute shaders, in each of the two dimensions of an image
+const uint32_t WORKGROUP_SIZE = 8;
+
+const VkFormat CUBEMAP_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+const uint32_t CUBE_FACE_COUNT = 6;
+
+struct alignas(16) EquirectangularConstants
+{
+	float lod;
+};
+
+struct alignas(16) IrradianceConstants
+{
+	float lod;
+};
+
+struct alignas(16) PrefilterConstants
+{
+	float roughness;
+
+	/// Size of the faces of the first level of the environment
+	float environment_size;
+};
+
+struct alignas(16) BrdfLutConstants
+{
+	float size;
+};
+
+uint32_t get_level_count(uint32_t size)
+{
+	return static_cast<uint32_t>(std::floor(std::log2(size))) + 1;
+}
+
+std::unique_ptr<core::Image> create_cubemap(Device &device, uint32_t size, uint32_t level_count)
+{
+	return std::make_unique<core::Image>(device,
+	                                     VkExtent3D{size, size, 1},
+	                                     CUBEMAP_FORMAT,
+	                                     VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	                                     VMA_MEMORY_USAGE_GPU_ONLY,
+	                                     VK_SAMPLE_COUNT_1_BIT,
+	                                     level_count,
+	                                     CUBE_FACE_COUNT,
+	                                     VK_IMAGE_TILING_OPTIMAL,
+	                                     VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT);
+}
+
+/**
+ * @brief Makes an image writable by the compute shaders, discarding its content
+ */
+void begin_storage(CommandBuffer &command_buffer, const core::ImageView &view)
+{
+	ImageMemoryBarrier barrier{};
+	barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.new_layout      = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.src_stage_mask  = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	barrier.dst_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+
+	command_buffer.image_memory_barrier(view, barrier);
+}
+
+/**
+ * @brief Makes an image written by the compute shaders readable by the compute and fragment shaders
+ */
+void end_storage(CommandBuffer &command_buffer, const core::ImageView &view)
+{
+	ImageMemoryBarrier barrier{};
+	barrier.old_layout      = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	barrier.src_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+
+	command_buffer.image_memory_barrier(view, barrier);
+}
+}        // namespace
+
+const uint32_t EnvironmentLighting::ENVIRONMENT_SIZE = 256;
+
+const uint32_t EnvironmentLighting::IRRADIANCE_SIZE = 32;
+
+const uint32_t EnvironmentLighting::PREFILTERED_SIZE = 128;
+
+const uint32_t EnvironmentLighting::PREFILTERED_LEVEL_COUNT = 5;
+
+const uint32_t EnvironmentLighting::BRDF_LUT_SIZE = 128;
+
+EnvironmentLighting::EnvironmentLighting(Device &device, const sg::Image &environment) :
+    device{device}
+{
+	environment_cubemap = create_cubemap(device, ENVIRONMENT_SIZE, get_level_count(ENVIRONMENT_SIZE));
+	irradiance          = create_cubemap(device, IRRADIANCE_SIZE, 1);
+	prefiltered         = create_cubemap(device, PREFILTERED_SIZE, PREFILTERED_LEVEL_COUNT);
+
+	environment_cubemap->set_debug_name("Environment");
+	irradiance->set_debug_name("Irradiance");
+	prefiltered->set_debug_name("Prefiltered environment");
+
+	// The two scale factors fit in two channels, else in the format all devices can write
+	brdf_lut_format = VK_FORMAT_R16G16_SFLOAT;
+
+	if (!(device.get_format_properties(brdf_lut_format).optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT))
+	{
+		brdf_lut_format = VK_FORMAT_R16G16B16A16_SFLOAT;
+	}
+
+	brdf_lut = std::make_unique<core::Image>(device,
+	                                         VkExtent3D{BRDF_LUT_SIZE, BRDF_LUT_SIZE, 1},
+	                                         brdf_lut_format,
+	                                         VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	                                         VMA_MEMORY_USAGE_GPU_ONLY);
+
+	brdf_lut->set_debug_name("BRDF lookup table");
+
+	// The prefiltered levels are interpolated, and the lookup table is indexed by cosines and roughnesses in [0, 1]
+	VkSamplerCreateInfo sampler_info{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+	sampler_info.magFilter    = VK_FILTER_LINEAR;
+	sampler_info.minFilter    = VK_FILTER_LINEAR;
+	sampler_info.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.maxLod       = VK_LOD_CLAMP_NONE;
+
+	sampler = &device.get_resource_cache().request_sampler(sampler_info);
+
+	sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+
+	equirectangular_sampler = &device.get_resource_cache().request_sampler(sampler_info);
+
+	irradiance_view  = &irradiance->request_view(VK_IMAGE_VIEW_TYPE_CUBE);
+	prefiltered_view = &prefiltered->request_view(VK_IMAGE_VIEW_TYPE_CUBE);
+	brdf_lut_view    = &brdf_lut->request_view(VK_IMAGE_VIEW_TYPE_2D);
+
+	auto &command_buffer = device.request_command_buffer();
+
+	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, 0);
+
+	generate(command_buffer, environment);
+
+	command_buffer.end();
+
+	auto &queue = device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT, 0);
+
+	queue.submit(command_buffer, device.request_fence());
+
+	// The maps are generated once, the frames only sample them
+	device.get_fence_pool().wait();
+	device.get_fence_pool().reset();
+	device.get_command_pool().reset_pool();
+}
+
+void EnvironmentLighting::generate(CommandBuffer &command_buffer, const sg::Image &environment)
+{
+	auto &environment_view = environment_cubemap->request_view(VK_IMAGE_VIEW_TYPE_CUBE);
+
+	command_buffer.begin_debug_label("Environment lighting");
+
+	// Each level of the cubemap samples the level of the equirectangular image with about the same texel size,
+	// the image covering four faces horizontally
+	begin_storage(command_buffer, environment_view);
+
+	float equirectangular_lod = std::log2(static_cast<float>(environment.get_extent().width) / (4 * ENVIRONMENT_SIZE));
+
+	for (uint32_t level = 0; level < environment_cubemap->get_subresource().mipLevel; ++level)
+	{
+		auto &level_view = environment_cubemap->request_view(VK_IMAGE_VIEW_TYPE_2D_ARRAY, VK_FORMAT_UNDEFINED, level, 0, 1, CUBE_FACE_COUNT);
+
+		EquirectangularConstants constants{};
+		constants.lod = std::max(equirectangular_lod + level, 0.0f);
+
+		dispatch(command_buffer, "ibl/equirectangular_to_cube.comp", {}, level_view, &environment.get_vk_image_view(), *equirectangular_sampler, constants);
+	}
+
+	end_storage(command_buffer, environment_view);
+
+	// The irradiance varies slowly, so it is integrated from the level of the environment with the same size
+	{
+		begin_storage(command_buffer, *irradiance_view);
+
+		IrradianceConstants constants{};
+		constants.lod = std::log2(static_cast<float>(ENVIRONMENT_SIZE) / IRRADIANCE_SIZE);
+
+		auto &output_view = irradiance->request_view(VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+
+		dispatch(command_buffer, "ibl/irradiance.comp", {}, output_view, &environment_view, *sampler, constants);
+
+		end_storage(command_buffer, *irradiance_view);
+	}
+
+	// Roughness goes linearly from 0 in the first level to 1 in the last one
+	begin_storage(command_buffer, *prefiltered_view);
+
+	for (uint32_t level = 0; level < PREFILTERED_LEVEL_COUNT; ++level)
+	{
+		auto &level_view = prefiltered->request_view(VK_IMAGE_VIEW_TYPE_2D_ARRAY, VK_FORMAT_UNDEFINED, level, 0, 1, CUBE_FACE_COUNT);
+
+		PrefilterConstants constants{};
+		constants.roughness        = static_cast<float>(level) / (PREFILTERED_LEVEL_COUNT - 1);
+		constants.environment_size = static_cast<float>(ENVIRONMENT_SIZE);
+
+		dispatch(command_buffer, "ibl/prefilter.comp", {}, level_view, &environment_view, *sampler, constants);
+	}
+
+	end_storage(command_buffer, *prefiltered_view);
+
+	{
+		begin_storage(command_buffer, *brdf_lut_view);
+
+		ShaderVariant variant;
+		variant.add_define(brdf_lut_format == VK_FORMAT_R16G16_SFLOAT ? "BRDF_LUT_FORMAT rg16f" : "BRDF_LUT_FORMAT rgba16f");
+
+		BrdfLutConstants constants{};
+		constants.size = static_cast<float>(BRDF_LUT_SIZE);
+
+		dispatch(command_buffer, "ibl/brdf_lut.comp", variant, *brdf_lut_view, nullptr, *sampler, constants);
+
+		end_storage(command_buffer, *brdf_lut_view);
+	}
+
+	command_buffer.end_debug_label();
+}
+
+template <class T>
+void EnvironmentLighting::dispatch(CommandBuffer &command_buffer, const std::string &shader, const ShaderVariant &variant, const core::ImageView &output,
+                                   const core::ImageView *input, const core::Sampler &input_sampler, const T &constants)
+{
+	auto &resource_cache = device.get_resource_cache();
+
+	auto &shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_COMPUTE_BIT, ShaderSource{shader}, variant);
+
+	std::vector<ShaderModule *> shader_modules{&shader_module};
+
+	command_buffer.bind_pipeline_layout(resource_cache.request_pipeline_layout(shader_modules, false));
+
+	// Storage images are bound without a sampler, like input attachments
+	command_buffer.bind_input(output, 0, 0, 0);
+
+	if (input)
+	{
+		command_buffer.bind_image(*input, input_sampler, 0, 1, 0);
+	}
+
+	command_buffer.push_constants(0, constants);
+
+	auto &extent = output.get_image().get_extent();
+
+	uint32_t width  = std::max(extent.width >> output.get_subresource_range().baseMipLevel, 1u);
+	uint32_t height = std::max(extent.height >> output.get_subresource_range().baseMipLevel, 1u);
+
+	command_buffer.dispatch((width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, output.get_subresource_range().layerCount);
+}
+
+void EnvironmentLighting::bind(CommandBuffer &command_buffer, uint32_t set, uint32_t first_binding) const
+{
+	command_buffer.bind_image(*irradiance_view, *sampler, set, first_binding, 0);
+	command_buffer.bind_image(*prefiltered_view, *sampler, set, first_binding + 1, 0);
+	command_buffer.bind_image(*brdf_lut_view, *sampler, set, first_binding + 2, 0);
+}
+}        // namespace vkb
@@ -0,0 +1,114 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "common/vk_common.h"
+#include "core/image.h"
+#include "core/sampler.h"
+#include "core/shader_module.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class Device;
+
+namespace sg
+{
+class Image;
+}
+
+/**
+ * @brief Image based lighting of an environment, precomputed once by compute shaders when it is created:
+ *        the diffuse irradiance, the specular radiance prefiltered for increasing roughnesses in the levels
+ *        of a cubemap, and the BRDF lookup table of the split-sum approximation.
+ *        The lighting shaders read three bindings, see the IBL path of pbr.frag
+ */
+class EnvironmentLighting
+{
+  public:
+	/// Size of the faces of the cubemap the environment is converted to
+	static const uint32_t ENVIRONMENT_SIZE;
+
+	static const uint32_t IRRADIANCE_SIZE;
+
+	/// Size of the first level of the prefiltered cubemap, which holds a roughness per level
+	static const uint32_t PREFILTERED_SIZE;
+
+	static const uint32_t PREFILTERED_LEVEL_COUNT;
+
+	static const uint32_t BRDF_LUT_SIZE;
+
+	/**
+	 * @brief Generates the maps, waiting until the GPU has finished
+	 * @param device The device to generate the maps with
+	 * @param environment Equirectangular image of the environment, its Vulkan image created and readable by shaders
+	 */
+	EnvironmentLighting(Device &device, const sg::Image &environment);
+
+	/**
+	 * @brief Binds the irradiance cubemap, the prefiltered cubemap and the BRDF lookup table
+	 * @param command_buffer Command buffer to bind to
+	 * @param set Descriptor set of the bindings
+	 * @param first_binding Binding of the irradiance cubemap, the others follow
+	 */
+	void bind(CommandBuffer &command_buffer, uint32_t set, uint32_t first_binding) const;
+
+  private:
+	Device &device;
+
+	/// Mipmapped cubemap of the environment, sampled by the convolutions
+	std::unique_ptr<core::Image> environment_cubemap;
+
+	std::unique_ptr<core::Image> irradiance;
+
+	std::unique_ptr<core::Image> prefiltered;
+
+	std::unique_ptr<core::Image> brdf_lut;
+
+	core::ImageView *irradiance_view{nullptr};
+
+	core::ImageView *prefiltered_view{nullptr};
+
+	core::ImageView *brdf_lut_view{nullptr};
+
+	VkFormat brdf_lut_format{VK_FORMAT_UNDEFINED};
+
+	const core::Sampler *sampler{nullptr};
+
+	/// Wraps around horizontally, for the equirectangular image
+	const core::Sampler *equirectangular_sampler{nullptr};
+
+	void generate(CommandBuffer &command_buffer, const sg::Image &environment);
+
+	/**
+	 * @brief Dispatches a compute shader over a storage image view, with one workgroup layer per array layer
+	 * @param output The storage image view written, bound to the first binding
+	 * @param input The view sampled, bound to the second binding, if any
+	 * @param input_sampler The sampler of the input
+	 * @param constants The push constants
+	 */
+	template <class T>
+	void dispatch(CommandBuffer &command_buffer, const std::string &shader, const ShaderVariant &variant, const core::ImageView &output,
+	              const core::ImageView *input, const core::Sampler &input_sampler, const T &constants);
+};
+}        // namespace vkb
@@ -0,0 +1,210 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "frame_pacer.h"
+
+#include <thread>
+
+#include "common/error.h"
+#include "core/device.h"
+#include "core/swapchain.h"
+
+namespace vkb
+{
+constexpr std::chrono::microseconds FramePacer::SPIN_MARGIN;
+
+FramePacer::FramePacer(Device &device) :
+    device{device}
+{
+}
+
+void FramePacer::set_target_interval(std::chrono::nanoseconds interval)
+{
+	target_interval = interval;
+}
+
+std::chrono::nanoseconds FramePacer::get_target_interval() const
+{
+	return target_interval;
+}
+
+std::chrono::nanoseconds FramePacer::get_paced_interval() const
+{
+	if (refresh_duration.count() == 0)
+	{
+		return target_interval;
+	}
+
+	auto refresh_count = (target_interval.count() + refresh_duration.count() - 1) / refresh_duration.count();
+
+	return refresh_duration * refresh_count;
+}
+
+void FramePacer::wait()
+{
+	auto interval = get_paced_interval();
+
+	if (interval.count() == 0)
+	{
+		return;
+	}
+
+	auto now = Timer::Clock::now();
+
+	if (now < next_frame_time)
+	{
+		// Sleeping is not precise enough, so the last part is spent spinning
+		if (next_frame_time - now > SPIN_MARGIN)
+		{
+			std::this_thread::sleep_until(next_frame_time - SPIN_MARGIN);
+		}
+
+		while (Timer::Clock::now() < next_frame_time)
+		{
+			std::this_thread::yield();
+		}
+
+		now = next_frame_time;
+	}
+
+	// A late frame restarts the schedule instead of rushing the following ones
+	next_frame_time = now + interval;
+}
+
+void FramePacer::begin_present(const Swapchain &swapchain, VkPresentInfoKHR &present_info)
+{
+	if (!uses_display_timing())
+	{
+		return;
+	}
+
+	update_refresh_duration(swapchain);
+
+	auto interval = get_paced_interval();
+
+	present_time.presentID          = ++present_id;
+	present_time.desiredPresentTime = 0;
+
+	// Desired times are extrapolated from the last actual present time reported
+	if (interval.count() > 0 && last_timing.actualPresentTime > 0)
+	{
+		present_time.desiredPresentTime = last_timing.actualPresentTime + interval.count() * (present_id - last_timing.presentID);
+	}
+
+	present_times_info.pNext          = present_info.pNext;
+	present_times_info.swapchainCount = 1;
+	present_times_info.pTimes         = &present_time;
+
+	present_info.pNext = &present_times_info;
+}
+
+void FramePacer::end_present(const Swapchain &swapchain)
+{
+	if (uses_display_timing())
+	{
+		read_past_timings(swapchain);
+		return;
+	}
+
+	auto now = Timer::Clock::now();
+
+	if (last_present_time != Timer::Clock::time_point{})
+	{
+		present_interval = std::chrono::duration<float>(now - last_present_time).count();
+
+		// Without display timing, a frame is desired one paced interval after the previous one
+		auto interval = std::chrono::duration<float>(get_paced_interval()).count();
+
+		present_delay = interval > 0.0f ? std::max(present_interval - interval, 0.0f) : 0.0f;
+	}
+
+	last_present_time = now;
+}
+
+float FramePacer::get_present_interval() const
+{
+	return present_interval;
+}
+
+float FramePacer::get_present_delay() const
+{
+	return present_delay;
+}
+
+bool FramePacer::uses_display_timing() const
+{
+	return device.is_enabled(VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME);
+}
+
+void FramePacer::update_refresh_duration(const Swapchain &swapchain)
+{
+	if (swapchain.get_handle() == refresh_swapchain)
+	{
+		return;
+	}
+
+	VkRefreshCycleDurationGOOGLE refresh_cycle_duration{};
+
+	VK_CHECK(vkGetRefreshCycleDurationGOOGLE(device.get_handle(), swapchain.get_handle(), &refresh_cycle_duration));
+
+	refresh_duration  = std::chrono::nanoseconds{refresh_cycle_duration.refreshDuration};
+	refresh_swapchain = swapchain.get_handle();
+}
+
+void FramePacer::read_past_timings(const Swapchain &swapchain)
+{
+	uint32_t timing_count{0};
+
+	VK_CHECK(vkGetPastPresentationTimingGOOGLE(device.get_handle(), swapchain.get_handle(), &timing_count, nullptr));
+
+	if (timing_count == 0)
+	{
+		return;
+	}
+
+	past_timings.resize(timing_count);
+
+	VkResult result = vkGetPastPresentationTimingGOOGLE(device.get_handle(), swapchain.get_handle(), &timing_count, past_timings.data());
+
+	if (result != VK_SUCCESS && result != VK_INCOMPLETE)
+	{
+		throw VulkanException{result, "Cannot get past presentation timing"};
+	}
+
+	past_timings.resize(timing_count);
+
+	for (auto &timing : past_timings)
+	{
+		if (last_timing.actualPresentTime > 0 && timing.presentID > last_timing.presentID)
+		{
+			auto elapsed = static_cast<double>(timing.actualPresentTime - last_timing.actualPresentTime);
+
+			present_interval = static_cast<float>(elapsed * 1e-9 / (timing.presentID - last_timing.presentID));
+		}
+
+		// Presents without a desired time are compared to the earliest time they could have been shown
+		uint64_t desired_time = timing.desiredPresentTime > 0 ? timing.desiredPresentTime : timing.earliestPresentTime;
+
+		present_delay = timing.actualPresentTime > desired_time ? static_cast<float>((timing.actualPresentTime - desired_time) * 1e-9) : 0.0f;
+
+		last_timing = timing;
+	}
+}
+}        // namespace vkb
@@ -0,0 +1,139 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <chrono>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+#include "timer.h"
+
+namespace vkb
+{
+class Device;
+class Swapchain;
+
+/**
+ * @brief Paces frames to a target interval and measures when they get presented.
+ *
+ * Before a frame begins the pacer sleeps, then spins for the last part, until the frame is due,
+ * so that it starts as late as possible and input latency is minimised. Frames rendered faster
+ * than the display can show them are not rendered at all, which saves power.
+ *
+ * If VK_GOOGLE_display_timing is enabled, desired present times are passed to the presentation
+ * engine, and the actual present times are read back a few frames later. Otherwise the actual
+ * present time is approximated with a CPU timestamp taken after queueing the present.
+ */
+class FramePacer
+{
+  public:
+	/// Time before a frame is due from which the pacer spins instead of sleeping
+	static constexpr std::chrono::microseconds SPIN_MARGIN{1000};
+
+	FramePacer(Device &device);
+
+	/**
+	 * @brief Sets the interval between frames to target, rounded up to a multiple of the refresh
+	 *        duration when display timing is enabled
+	 * @param interval The interval between frames, zero disables pacing
+	 */
+	void set_target_interval(std::chrono::nanoseconds interval);
+
+	std::chrono::nanoseconds get_target_interval() const;
+
+	/**
+	 * @brief Waits until the next frame is due, should be called before beginning a frame
+	 */
+	void wait();
+
+	/**
+	 * @brief Chains the desired present time to the present info if display timing is enabled,
+	 *        it must be followed by a call to end_present
+	 * @param swapchain The swapchain being presented
+	 * @param present_info The present info to chain to, valid until end_present is called
+	 */
+	void begin_present(const Swapchain &swapchain, VkPresentInfoKHR &present_info);
+
+	/**
+	 * @brief Records the present times, should be called after queueing the present
+	 * @param swapchain The swapchain presented
+	 */
+	void end_present(const Swapchain &swapchain);
+
+	/**
+	 * @return The interval between the last two frames presented, in seconds
+	 */
+	float get_present_interval() const;
+
+	/**
+	 * @return The delay of the last frame presented relative to its desired present time, in seconds
+	 */
+	float get_present_delay() const;
+
+	bool uses_display_timing() const;
+
+  private:
+	/**
+	 * @return The target interval rounded up to a multiple of the refresh duration, if known
+	 */
+	std::chrono::nanoseconds get_paced_interval() const;
+
+	/**
+	 * @brief Queries the refresh duration of the display of a new swapchain
+	 */
+	void update_refresh_duration(const Swapchain &swapchain);
+
+	/**
+	 * @brief Reads back the timings of the frames presented since the last call
+	 */
+	void read_past_timings(const Swapchain &swapchain);
+
+	Device &device;
+
+	std::chrono::nanoseconds target_interval{0};
+
+	/// Refresh duration of the display, zero if unknown
+	std::chrono::nanoseconds refresh_duration{0};
+
+	VkSwapchainKHR refresh_swapchain{VK_NULL_HANDLE};
+
+	Timer::Clock::time_point next_frame_time{};
+
+	/// Identifier of the last present with display timing
+	uint32_t present_id{0};
+
+	VkPresentTimeGOOGLE present_time{};
+
+	VkPresentTimesInfoGOOGLE present_times_info{VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE};
+
+	std::vector<VkPastPresentationTimingGOOGLE> past_timings;
+
+	/// Last present time reported by the presentation engine
+	VkPastPresentationTimingGOOGLE last_timing{};
+
+	/// Time the last present was queued, if display timing is not enabled
+	Timer::Clock::time_point last_present_time{};
+
+	float present_interval{0.0f};
+
+	float present_delay{0.0f};
+};
+}        // namespace vkb
@@ -0,0 +1,294 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "gpu_profiler.h"
+
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "cpu_profiler.h"
+
+namespace vkb
+{
+constexpr uint32_t                      GpuProfiler::MAX_SCOPES;
+constexpr VkQueryPipelineStatisticFlags GpuProfiler::PIPELINE_STATISTICS;
+
+GpuProfiler::GpuProfiler(Device &device) :
+    device{device}
+{
+	uint32_t valid_bits = device.get_suitable_graphics_queue().get_properties().timestampValidBits;
+
+	if (valid_bits > 0)
+	{
+		timestamp_period = device.get_properties().limits.timestampPeriod;
+		timestamp_mask   = valid_bits >= 64 ? ~0ULL : (1ULL << valid_bits) - 1;
+	}
+}
+
+void GpuProfiler::set_enabled(bool enable)
+{
+	enabled = enable;
+}
+
+bool GpuProfiler::is_enabled() const
+{
+	return enabled && timestamp_period > 0.0f;
+}
+
+void GpuProfiler::set_pipeline_statistics_enabled(bool enable)
+{
+	pipeline_statistics_enabled = enable;
+}
+
+bool GpuProfiler::is_pipeline_statistics_enabled() const
+{
+	return pipeline_statistics_enabled && device.get_features().pipelineStatisticsQuery;
+}
+
+void GpuProfiler::prepare_queries(CommandBuffer &command_buffer)
+{
+	if (queries_reset)
+	{
+		return;
+	}
+
+	if (is_enabled())
+	{
+		if (!query_pool)
+		{
+			VkQueryPoolCreateInfo create_info{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+			create_info.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+			create_info.queryCount = MAX_SCOPES * 2;
+
+			query_pool = std::make_unique<QueryPool>(device, create_info);
+		}
+
+		command_buffer.reset_query_pool(*query_pool, 0, MAX_SCOPES * 2);
+	}
+
+	if (is_pipeline_statistics_enabled())
+	{
+		if (!statistics_query_pool)
+		{
+			VkQueryPoolCreateInfo create_info{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+			create_info.queryType          = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+			create_info.queryCount         = MAX_SCOPES;
+			create_info.pipelineStatistics = PIPELINE_STATISTICS;
+
+			statistics_query_pool = std::make_unique<QueryPool>(device, create_info);
+		}
+
+		command_buffer.reset_query_pool(*statistics_query_pool, 0, MAX_SCOPES);
+	}
+
+	queries_reset = true;
+}
+
+void GpuProfiler::begin_scope(CommandBuffer &command_buffer, const std::string &name, bool pipeline_statistics)
+{
+	bool timed = is_enabled();
+
+	// Pipeline statistics queries cannot be nested
+	bool collect_statistics = pipeline_statistics && !statistics_open && is_pipeline_statistics_enabled();
+
+	if ((!timed && !collect_statistics) || scopes.size() >= MAX_SCOPES)
+	{
+		return;
+	}
+
+	prepare_queries(command_buffer);
+
+	open_scopes.push_back(scopes.size());
+	scopes.push_back({name, to_u32(open_scopes.size() - 1), timed, query_count, query_count, -1});
+
+	if (timed)
+	{
+		command_buffer.write_timestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, *query_pool, query_count++);
+	}
+
+	if (collect_statistics)
+	{
+		scopes.back().statistics_query = static_cast<int32_t>(statistics_query_count);
+
+		command_buffer.begin_query(*statistics_query_pool, statistics_query_count++, 0);
+
+		statistics_open = true;
+	}
+}
+
+void GpuProfiler::end_scope(CommandBuffer &command_buffer)
+{
+	if (open_scopes.empty())
+	{
+		return;
+	}
+
+	auto &scope = scopes[open_scopes.back()];
+	open_scopes.pop_back();
+
+	if (scope.statistics_query >= 0)
+	{
+		command_buffer.end_query(*statistics_query_pool, static_cast<uint32_t>(scope.statistics_query));
+
+		statistics_open = false;
+	}
+
+	if (scope.timed)
+	{
+		scope.end_query = query_count;
+
+		command_buffer.write_timestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, *query_pool, query_count++);
+	}
+}
+
+void GpuProfiler::mark_submitted()
+{
+	if (submit_time == 0 && query_count > 0)
+	{
+		submit_time = CpuProfiler::get().now();
+	}
+}
+
+void GpuProfiler::reset()
+{
+	read_timestamps();
+
+	scope_submit_time = submit_time;
+	submit_time       = 0;
+
+	read_pipeline_statistics();
+
+	scopes.clear();
+	open_scopes.clear();
+	query_count            = 0;
+	statistics_query_count = 0;
+	statistics_open        = false;
+	queries_reset          = false;
+}
+
+void GpuProfiler::read_timestamps()
+{
+	scope_times.clear();
+	frame_time = 0.0f;
+
+	if (query_count == 0)
+	{
+		return;
+	}
+
+	std::vector<uint64_t> timestamps(query_count);
+
+	// Not ready if the frame was reset without waiting for it
+	VkResult result = query_pool->get_results(0, query_count, timestamps.size() * sizeof(uint64_t), timestamps.data(),
+	                                          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+	if (result != VK_SUCCESS)
+	{
+		return;
+	}
+
+	// Scope starts are relative to the earliest one, the command buffers may not execute in recording order
+	uint64_t first_timestamp = ~0ULL;
+
+	for (auto &scope : scopes)
+	{
+		if (scope.timed && scope.end_query != scope.begin_query)
+		{
+			first_timestamp = std::min(first_timestamp, timestamps[scope.begin_query]);
+		}
+	}
+
+	for (auto &scope : scopes)
+	{
+		// Scopes which were never ended are skipped
+		if (!scope.timed || scope.end_query == scope.begin_query)
+		{
+			continue;
+		}
+
+		uint64_t ticks = (timestamps[scope.end_query] - timestamps[scope.begin_query]) & timestamp_mask;
+		float    time  = static_cast<float>(static_cast<double>(ticks) * timestamp_period * 1e-9);
+
+		uint64_t start_ticks = (timestamps[scope.begin_query] - first_timestamp) & timestamp_mask;
+		float    start       = static_cast<float>(static_cast<double>(start_ticks) * timestamp_period * 1e-9);
+
+		scope_times.push_back({scope.name, scope.depth, time, start});
+
+		if (scope.depth == 0)
+		{
+			frame_time += time;
+		}
+	}
+}
+
+void GpuProfiler::read_pipeline_statistics()
+{
+	pipeline_statistics = {};
+
+	if (statistics_query_count == 0)
+	{
+		return;
+	}
+
+	// One result per statistic, in the order of the bits of PIPELINE_STATISTICS
+	const uint32_t statistic_count = 6;
+
+	std::vector<uint64_t> results(statistics_query_count * statistic_count);
+
+	VkResult result = statistics_query_pool->get_results(0, statistics_query_count, results.size() * sizeof(uint64_t), results.data(),
+	                                                     statistic_count * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+	if (result != VK_SUCCESS)
+	{
+		return;
+	}
+
+	for (uint32_t i = 0; i < statistics_query_count; ++i)
+	{
+		const uint64_t *query_results = &results[i * statistic_count];
+
+		pipeline_statistics.input_assembly_primitives += query_results[0];
+		pipeline_statistics.vertex_shader_invocations += query_results[1];
+		pipeline_statistics.clipping_invocations += query_results[2];
+		pipeline_statistics.clipping_primitives += query_results[3];
+		pipeline_statistics.fragment_shader_invocations += query_results[4];
+		pipeline_statistics.compute_shader_invocations += query_results[5];
+	}
+}
+
+const std::vector<GpuScopeTime> &GpuProfiler::get_scope_times() const
+{
+	return scope_times;
+}
+
+uint64_t GpuProfiler::get_submit_time() const
+{
+	return scope_submit_time;
+}
+
+float GpuProfiler::get_frame_time() const
+{
+	return frame_time;
+}
+
+const PipelineStatistics &GpuProfiler::get_pipeline_statistics() const
+{
+	return pipeline_statistics;
+}
+}        // namespace vkb
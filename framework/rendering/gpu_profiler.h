@@ -0,0 +1,200 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+#include "core/query_pool.h"
+#include "stats.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class Device;
+
+/**
+ * @brief Measures the GPU time of nested scopes recorded for a frame, with timestamp queries,
+ *        and optionally the pipeline statistics of some of the scopes.
+ *
+ * The results are read back when the frame is reset, after its fences were waited, so they are
+ * available without stalling and lag behind by the number of frames in flight.
+ */
+class GpuProfiler
+{
+  public:
+	/// Maximum number of scopes profiled in a frame, the following ones are ignored
+	static constexpr uint32_t MAX_SCOPES = 64;
+
+	/// Pipeline statistics collected, in the order of their results
+	static constexpr VkQueryPipelineStatisticFlags PIPELINE_STATISTICS =
+	    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+	    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+	    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+	    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+	    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+	    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+	GpuProfiler(Device &device);
+
+	GpuProfiler(const GpuProfiler &) = delete;
+
+	GpuProfiler(GpuProfiler &&) = default;
+
+	GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+	GpuProfiler &operator=(GpuProfiler &&) = delete;
+
+	/**
+	 * @brief Enables the profiler, it should not be changed while a frame is being recorded
+	 */
+	void set_enabled(bool enable);
+
+	/**
+	 * @return Whether the profiler is enabled and the graphics queue supports timestamps
+	 */
+	bool is_enabled() const;
+
+	/**
+	 * @brief Enables the collection of pipeline statistics, it should not be changed while a frame is being recorded
+	 */
+	void set_pipeline_statistics_enabled(bool enable);
+
+	/**
+	 * @return Whether pipeline statistics are enabled and the device supports them
+	 */
+	bool is_pipeline_statistics_enabled() const;
+
+	/**
+	 * @brief Writes a timestamp for the beginning of a scope, nested in the currently open scope if any.
+	 *        The first scope of a frame must be recorded outside a render pass.
+	 * @param command_buffer The command buffer to record to
+	 * @param name The name of the scope
+	 * @param pipeline_statistics Whether to collect the pipeline statistics of the scope, which must
+	 *        not contain other scopes collecting them. Inside a render pass, the scope must not span subpasses.
+	 */
+	void begin_scope(CommandBuffer &command_buffer, const std::string &name, bool pipeline_statistics = false);
+
+	/**
+	 * @brief Writes a timestamp for the end of the last open scope
+	 */
+	void end_scope(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Notes the CPU time at which the recording is submitted, only the first submission is kept
+	 */
+	void mark_submitted();
+
+	/**
+	 * @brief Reads back the scope times of the previous recording, the GPU must have completed it
+	 */
+	void reset();
+
+	/**
+	 * @return The GPU time of each scope of the previous recording, in recording order
+	 */
+	const std::vector<GpuScopeTime> &get_scope_times() const;
+
+	/**
+	 * @return When the previous recording was first submitted, in nanoseconds of the CPU profiler clock,
+	 *         zero if it was not. The GPU did not begin its scopes earlier, which places them on a CPU timeline.
+	 */
+	uint64_t get_submit_time() const;
+
+	/**
+	 * @return The GPU time of the top-level scopes of the previous recording, in seconds
+	 */
+	float get_frame_time() const;
+
+	/**
+	 * @return The pipeline statistics of the previous recording, summed over the scopes collecting them
+	 */
+	const PipelineStatistics &get_pipeline_statistics() const;
+
+  private:
+	struct Scope
+	{
+		std::string name;
+
+		uint32_t depth;
+
+		/// Whether timestamps were written for the scope
+		bool timed;
+
+		uint32_t begin_query;
+
+		uint32_t end_query;
+
+		/// Index of the pipeline statistics query, if collected
+		int32_t statistics_query;
+	};
+
+	/**
+	 * @brief Creates the query pools if needed, and records their reset at the first scope of a recording
+	 */
+	void prepare_queries(CommandBuffer &command_buffer);
+
+	void read_timestamps();
+
+	void read_pipeline_statistics();
+
+	Device &device;
+
+	bool enabled{false};
+
+	bool pipeline_statistics_enabled{false};
+
+	/// Whether the query pools were reset for the current recording
+	bool queries_reset{false};
+
+	/// Nanoseconds per timestamp tick, zero if timestamps are not supported
+	float timestamp_period{0.0f};
+
+	uint64_t timestamp_mask{0};
+
+	std::unique_ptr<QueryPool> query_pool;
+
+	std::vector<Scope> scopes;
+
+	/// Indices of the scopes not ended yet
+	std::vector<size_t> open_scopes;
+
+	uint32_t query_count{0};
+
+	std::unique_ptr<QueryPool> statistics_query_pool;
+
+	uint32_t statistics_query_count{0};
+
+	/// Whether the open scopes include one collecting pipeline statistics
+	bool statistics_open{false};
+
+	std::vector<GpuScopeTime> scope_times;
+
+	/// First submission of the current recording
+	uint64_t submit_time{0};
+
+	/// First submission of the recording the scope times were read back for
+	uint64_t scope_submit_time{0};
+
+	float frame_time{0.0f};
+
+	PipelineStatistics pipeline_statistics;
+};
+}        // namespace vkb
@@ -0,0 +1,315 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/light_clusters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "common/helpers.h"
+#include "core/command_buffer.h"
+#include "rendering/render_frame.h"
+#include "scene_graph/components/camera.h"
+#include "scene_graph/components/light.h"
+#include "scene_graph/node.h"
+
+namespace vkb
+{
+namespace
+{
+const uint32_t CLUSTER_COUNT = LightClusters::CLUSTER_COUNT_X * LightClusters::CLUSTER_COUNT_Y * LightClusters::CLUSTER_COUNT_Z;
+
+/// Size of the count before the lights in the storage buffer, the lights are aligned to 16 bytes
+const uint32_t LIGHTS_HEADER_SIZE = 16;
+
+inline uint32_t get_cluster_index(uint32_t x, uint32_t y, uint32_t z)
+{
+	return (z * LightClusters::CLUSTER_COUNT_Y + y) * LightClusters::CLUSTER_COUNT_X + x;
+}
+
+inline uint32_t to_cluster(float value, uint32_t count)
+{
+	return static_cast<uint32_t>(glm::clamp(value, 0.0f, static_cast<float>(count - 1)));
+}
+}        // namespace
+
+LightClusters::LightClusters(float distance_scale) :
+    distance_scale{distance_scale}
+{
+}
+
+void LightClusters::update(const sg::ComponentRange<sg::Light> &scene_lights, sg::Camera &camera, const VkExtent2D &extent)
+{
+	auto view       = camera.get_view();
+	auto projection = vulkan_style_projection(camera.get_projection());
+
+	// Depth of the near and far planes, from the projection so that any camera works
+	auto inverse_projection = glm::inverse(projection);
+	auto near_point         = inverse_projection * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	auto far_point          = inverse_projection * glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	auto near_depth         = -near_point.z / near_point.w;
+	auto far_depth          = -far_point.z / far_point.w;
+
+	float near_plane = std::max(std::min(near_depth, far_depth), 1e-3f);
+	float far_plane  = std::max(std::max(near_depth, far_depth), near_plane * 2.0f);
+
+	if (!std::isfinite(far_plane))
+	{
+		far_plane = near_plane * 1e5f;
+	}
+
+	// Depth slices are spaced exponentially, slice = log(depth) * scale + bias
+	float slice_scale = CLUSTER_COUNT_Z / std::log(far_plane / near_plane);
+	float slice_bias  = -std::log(near_plane) * slice_scale;
+
+	uniform.view          = view;
+	uniform.cluster_scale = glm::vec4(static_cast<float>(CLUSTER_COUNT_X) / std::max(extent.width, 1u),
+	                                  static_cast<float>(CLUSTER_COUNT_Y) / std::max(extent.height, 1u),
+	                                  slice_scale, slice_bias);
+
+	size_t key = scene_lights.size();
+
+	for (auto light : scene_lights)
+	{
+		hash_combine(key, light);
+		hash_combine(key, light->get_version());
+		hash_combine(key, light->get_node()->get_transform().get_render_state().version);
+	}
+
+	if (lights_version == 0 || key != lights_key)
+	{
+		lights.clear();
+		lights.reserve(scene_lights.size());
+
+		for (auto light : scene_lights)
+		{
+			const auto &properties = light->get_properties();
+			auto &      transform  = light->get_node()->get_transform();
+
+			lights.push_back({{transform.get_render_state().translation, static_cast<float>(light->get_light_type())},
+			                  {properties.color, properties.intensity},
+			                  {transform.get_render_state().rotation * properties.direction, properties.range},
+			                  {properties.inner_cone_angle, properties.outer_cone_angle}});
+		}
+
+		lights_key = key;
+		lights_version++;
+	}
+
+	uniform.cluster_count = glm::uvec4(CLUSTER_COUNT_X, CLUSTER_COUNT_Y, CLUSTER_COUNT_Z, to_u32(lights.size()));
+
+	// Count the lights of each cluster, then fill the lists after the offsets are known
+	light_ranges.resize(lights.size());
+
+	cluster_data.assign(CLUSTER_COUNT * 2, 0);
+
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		auto &range = light_ranges[i];
+
+		range.visible = get_cluster_range(lights[i], view, projection, near_plane, far_plane, range);
+
+		if (!range.visible)
+		{
+			continue;
+		}
+
+		for (uint32_t z = range.first.z; z <= range.last.z; z++)
+		{
+			for (uint32_t y = range.first.y; y <= range.last.y; y++)
+			{
+				for (uint32_t x = range.first.x; x <= range.last.x; x++)
+				{
+					cluster_data[get_cluster_index(x, y, z) * 2 + 1]++;
+				}
+			}
+		}
+	}
+
+	uint32_t offset = CLUSTER_COUNT * 2;
+
+	for (uint32_t cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+	{
+		cluster_data[cluster * 2] = offset;
+		offset += cluster_data[cluster * 2 + 1];
+
+		// Counted again while the lists are filled
+		cluster_data[cluster * 2 + 1] = 0;
+	}
+
+	cluster_data.resize(offset);
+
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		auto &range = light_ranges[i];
+
+		if (!range.visible)
+		{
+			continue;
+		}
+
+		for (uint32_t z = range.first.z; z <= range.last.z; z++)
+		{
+			for (uint32_t y = range.first.y; y <= range.last.y; y++)
+			{
+				for (uint32_t x = range.first.x; x <= range.last.x; x++)
+				{
+					auto cluster = get_cluster_index(x, y, z);
+
+					cluster_data[cluster_data[cluster * 2] + cluster_data[cluster * 2 + 1]++] = to_u32(i);
+				}
+			}
+		}
+	}
+}
+
+void LightClusters::upload(RenderFrame &render_frame, size_t thread_index)
+{
+	auto lights_size = LIGHTS_HEADER_SIZE + lights.size() * sizeof(Light);
+
+	auto frame_it = std::find_if(frame_lights.begin(), frame_lights.end(),
+	                             [&render_frame](const FrameLights &entry) { return entry.render_frame == &render_frame; });
+
+	if (frame_it == frame_lights.end())
+	{
+		frame_lights.push_back({&render_frame, nullptr, 0});
+		frame_it = frame_lights.end() - 1;
+	}
+
+	// The previous contents of the buffer may still be read by the last submission of the frame,
+	// which has completed once the frame is active again
+	if (frame_it->version != lights_version)
+	{
+		if (!frame_it->buffer || frame_it->buffer->get_size() < lights_size)
+		{
+			frame_it->buffer = std::make_unique<core::Buffer>(render_frame.get_device(), lights_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+			frame_it->buffer->set_debug_name("Lights");
+		}
+
+		frame_it->buffer->update(to_u32(lights.size()));
+		if (!lights.empty())
+		{
+			frame_it->buffer->update(reinterpret_cast<const uint8_t *>(lights.data()), lights.size() * sizeof(Light), LIGHTS_HEADER_SIZE);
+		}
+
+		frame_it->version = lights_version;
+	}
+
+	lights_buffer = BufferAllocation{*frame_it->buffer, lights_size, 0};
+
+	uniform_buffer = render_frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(LightClusterUniform), thread_index);
+	uniform_buffer.update(uniform);
+
+	cluster_buffer = render_frame.allocate_buffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, cluster_data.size() * sizeof(uint32_t), thread_index);
+	cluster_buffer.update(reinterpret_cast<const uint8_t *>(cluster_data.data()), cluster_data.size() * sizeof(uint32_t));
+}
+
+void LightClusters::bind(CommandBuffer &command_buffer, uint32_t set, uint32_t first_binding) const
+{
+	command_buffer.bind_buffer(lights_buffer.get_buffer(), lights_buffer.get_offset(), lights_buffer.get_size(), set, first_binding, 0);
+	command_buffer.bind_buffer(uniform_buffer.get_buffer(), uniform_buffer.get_offset(), uniform_buffer.get_size(), set, first_binding + 1, 0);
+	command_buffer.bind_buffer(cluster_buffer.get_buffer(), cluster_buffer.get_offset(), cluster_buffer.get_size(), set, first_binding + 2, 0);
+}
+
+size_t LightClusters::get_binding_hash() const
+{
+	size_t result = 0;
+
+	for (auto *allocation : {&lights_buffer, &uniform_buffer, &cluster_buffer})
+	{
+		hash_combine(result, allocation->get_buffer().get_handle());
+		hash_combine(result, allocation->get_offset());
+		hash_combine(result, allocation->get_size());
+	}
+
+	return result;
+}
+
+float LightClusters::get_average_light_count() const
+{
+	return static_cast<float>(cluster_data.size() - CLUSTER_COUNT * 2) / CLUSTER_COUNT;
+}
+
+bool LightClusters::get_cluster_range(const Light &light, const glm::mat4 &view, const glm::mat4 &projection, float near_plane, float far_plane, ClusterRange &range) const
+{
+	range.first = glm::uvec3(0);
+	range.last = glm::uvec3(CLUSTER_COUNT_X - 1, CLUSTER_COUNT_Y - 1, CLUSTER_COUNT_Z - 1);
+
+	// Directional lights reach every cluster
+	if (light.position.w == static_cast<float>(sg::LightType::Directional))
+	{
+		return true;
+	}
+
+	// Distance at which the contribution of the light, with an inverse square attenuation, falls below the cutoff
+	float max_color = std::max(light.color.r, std::max(light.color.g, light.color.b));
+	float radius    = std::sqrt(std::max(light.color.w * max_color, 0.0f) / LIGHT_CUTOFF) / distance_scale;
+
+	auto  center = glm::vec3(view * glm::vec4(glm::vec3(light.position), 1.0f));
+	float depth  = -center.z;
+
+	if (depth + radius < near_plane || depth - radius > far_plane)
+	{
+		return false;
+	}
+
+	auto get_slice = [&](float slice_depth) {
+		float slice = std::log(glm::clamp(slice_depth, near_plane, far_plane)) * uniform.cluster_scale.z + uniform.cluster_scale.w;
+		return to_cluster(slice, CLUSTER_COUNT_Z);
+	};
+
+	range.first.z = get_slice(depth - radius);
+	range.last.z = get_slice(depth + radius);
+
+	// Lights around the camera cover the whole screen, otherwise the screen bounds of the corners
+	// of the box around the sphere contain the projection of the sphere
+	if (depth - radius <= near_plane)
+	{
+		return true;
+	}
+
+	glm::vec2 min_ndc{std::numeric_limits<float>::max()};
+	glm::vec2 max_ndc{std::numeric_limits<float>::lowest()};
+
+	for (uint32_t corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 offset{corner & 1 ? radius : -radius, corner & 2 ? radius : -radius, corner & 4 ? radius : -radius};
+
+		auto clip = projection * glm::vec4(center + offset, 1.0f);
+		auto ndc  = glm::vec2(clip) / clip.w;
+
+		min_ndc = glm::min(min_ndc, ndc);
+		max_ndc = glm::max(max_ndc, ndc);
+	}
+
+	if (max_ndc.x < -1.0f || max_ndc.y < -1.0f || min_ndc.x > 1.0f || min_ndc.y > 1.0f)
+	{
+		return false;
+	}
+
+	range.first.x = to_cluster((min_ndc.x * 0.5f + 0.5f) * CLUSTER_COUNT_X, CLUSTER_COUNT_X);
+	range.first.y = to_cluster((min_ndc.y * 0.5f + 0.5f) * CLUSTER_COUNT_Y, CLUSTER_COUNT_Y);
+	range.last.x = to_cluster((max_ndc.x * 0.5f + 0.5f) * CLUSTER_COUNT_X, CLUSTER_COUNT_X);
+	range.last.y = to_cluster((max_ndc.y * 0.5f + 0.5f) * CLUSTER_COUNT_Y, CLUSTER_COUNT_Y);
+
+	return true;
+}
+}        // namespace vkb
@@ -0,0 +1,173 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "common/error.h"
+#include "common/vk_common.h"
+#include "rendering/subpass.h"
+#include "scene_graph/component_range.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+namespace vkb
+{
+class CommandBuffer;
+class RenderFrame;
+
+namespace sg
+{
+class Camera;
+class Light;
+}        // namespace sg
+
+/**
+ * @brief Parameters of the cluster grid, read by the shaders to find the cluster of a fragment
+ */
+struct alignas(16) LightClusterUniform
+{
+	/// View matrix of the camera, used to compute the depth of a fragment
+	glm::mat4 view;
+
+	/// Clusters per pixel in x and y, then the scale and bias of the logarithm of the depth to the slice index
+	glm::vec4 cluster_scale;
+
+	/// Number of clusters in x, y and z, then the number of lights
+	glm::uvec4 cluster_count;
+};
+
+/**
+ * @brief Assigns the lights of a scene to the clusters of the camera frustum, screen tiles split
+ *        into depth slices, so that shaders only evaluate the lights which can reach a fragment.
+ *        The shaders read three bindings, see the CLUSTERED_LIGHTS paths of base.frag and deferred/lighting.frag:
+ *        the lights in a storage buffer, the LightClusterUniform, and the light index lists of the clusters
+ *        in a storage buffer which starts with the offset and the count of the list of each cluster
+ */
+class LightClusters
+{
+  public:
+	static constexpr uint32_t CLUSTER_COUNT_X = 16;
+
+	static constexpr uint32_t CLUSTER_COUNT_Y = 9;
+
+	static constexpr uint32_t CLUSTER_COUNT_Z = 24;
+
+	/// Point lights are culled where their contribution falls below this value
+	static constexpr float LIGHT_CUTOFF = 1.0f / 256.0f;
+
+	/**
+	 * @param distance_scale Scale applied to the distance to a point light before its attenuation in the shaders
+	 */
+	LightClusters(float distance_scale = 1.0f);
+
+	/**
+	 * @brief Assigns the lights to the clusters, on the CPU
+	 * @param lights The lights of the scene
+	 * @param camera The camera the clusters are built for
+	 * @param extent The extent of the render target
+	 */
+	void update(const sg::ComponentRange<sg::Light> &lights, sg::Camera &camera, const VkExtent2D &extent);
+
+	/**
+	 * @brief Copies the result of the last update to buffers of the frame. The lights are kept
+	 *        in a buffer of each frame, which is only written if the lights changed since its last upload
+	 * @param render_frame The frame to upload to
+	 * @param thread_index Selects the buffer pools of the frame of the thread recording the draws
+	 */
+	void upload(RenderFrame &render_frame, size_t thread_index = 0);
+
+	/**
+	 * @brief Binds the buffers of the last upload
+	 * @param command_buffer The command buffer to bind them to
+	 * @param set The descriptor set of the bindings
+	 * @param first_binding The binding of the lights, followed by the uniform and the cluster lists
+	 */
+	void bind(CommandBuffer &command_buffer, uint32_t set, uint32_t first_binding) const;
+
+	/**
+	 * @return Hash of the buffer ranges bound by bind(), which only changes if the last upload landed somewhere else
+	 */
+	size_t get_binding_hash() const;
+
+	/**
+	 * @return The average number of lights per cluster in the last update
+	 */
+	float get_average_light_count() const;
+
+  private:
+	/**
+	 * @brief Lights buffer of a render frame
+	 */
+	struct FrameLights
+	{
+		const RenderFrame *render_frame;
+
+		std::unique_ptr<core::Buffer> buffer;
+
+		/// Value of lights_version when the buffer was written
+		uint32_t version;
+	};
+
+	/**
+	 * @brief Range of clusters touched by a light, inclusive
+	 */
+	struct ClusterRange
+	{
+		glm::uvec3 first;
+
+		glm::uvec3 last;
+
+		bool visible;
+	};
+
+	bool get_cluster_range(const Light &light, const glm::mat4 &view, const glm::mat4 &projection, float near_plane, float far_plane, ClusterRange &range) const;
+
+	float distance_scale{1.0f};
+
+	std::vector<Light> lights;
+
+	/// Hash of the lights and of the versions of their state, the lights are only packed again if it changes
+	size_t lights_key{0};
+
+	/// Incremented each time the lights are packed again
+	uint32_t lights_version{0};
+
+	std::vector<FrameLights> frame_lights;
+
+	std::vector<ClusterRange> light_ranges;
+
+	/// Offset and count of the list of each cluster, followed by the lists
+	std::vector<uint32_t> cluster_data;
+
+	LightClusterUniform uniform{};
+
+	BufferAllocation lights_buffer;
+
+	BufferAllocation uniform_buffer;
+
+	BufferAllocation cluster_buffer;
+};
+}        // namespace vkb
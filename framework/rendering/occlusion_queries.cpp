@@ -0,0 +1,188 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/occlusion_queries.h"
+
+#include "core/command_buffer.h"
+#include "rendering/render_context.h"
+#include "scene_graph/components/aabb.h"
+
+namespace vkb
+{
+constexpr uint32_t OcclusionQueries::MAX_QUERY_COUNT;
+constexpr float    OcclusionQueries::PROXY_MARGIN;
+
+OcclusionQueries::OcclusionQueries(RenderContext &render_context) :
+    render_context{render_context},
+    vertex_shader{"occlusion_proxy.vert"},
+    fragment_shader{"depth_only.frag"}
+{
+	// Build the shaders upfront
+	auto &resource_cache = render_context.get_device().get_resource_cache();
+	resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, vertex_shader, variant);
+	resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, fragment_shader, variant);
+}
+
+OcclusionQueries::FrameQueries &OcclusionQueries::get_frame_queries()
+{
+	auto frame_index = render_context.get_active_frame_index();
+
+	if (frame_queries.size() <= frame_index)
+	{
+		frame_queries.resize(frame_index + 1);
+	}
+
+	auto &queries = frame_queries[frame_index];
+
+	if (!queries.query_pool)
+	{
+		VkQueryPoolCreateInfo create_info{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+		create_info.queryType  = VK_QUERY_TYPE_OCCLUSION;
+		create_info.queryCount = MAX_QUERY_COUNT;
+
+		queries.query_pool = std::make_unique<QueryPool>(render_context.get_device(), create_info);
+	}
+
+	return queries;
+}
+
+void OcclusionQueries::reset(CommandBuffer &command_buffer)
+{
+	auto &queries = get_frame_queries();
+
+	if (!queries.proxies.empty())
+	{
+		FrameVector<uint64_t> results(queries.proxies.size(), 0, &render_context.get_active_frame().get_arena());
+
+		// The fences of the frame were waited, unless the results are ready the objects stay visible
+		VkResult result = queries.query_pool->get_results(0, to_u32(results.size()), results.size() * sizeof(uint64_t), results.data(),
+		                                                  sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+		// The oldest results in flight replace the previous ones, objects which were not queried since are visible
+		occluded.clear();
+
+		if (result == VK_SUCCESS)
+		{
+			for (size_t i = 0; i < results.size(); ++i)
+			{
+				if (results[i] == 0)
+				{
+					occluded.insert(queries.proxies[i].key);
+				}
+			}
+		}
+	}
+
+	queries.proxies.clear();
+
+	command_buffer.reset_query_pool(*queries.query_pool, 0, MAX_QUERY_COUNT);
+}
+
+bool OcclusionQueries::is_visible(const sg::Node &node, const sg::Mesh &mesh) const
+{
+	return occluded.find({&node, &mesh}) == occluded.end();
+}
+
+bool OcclusionQueries::add_proxy(const sg::Node &node, const sg::Mesh &mesh, const sg::AABB &world_bounds, const glm::vec3 &eye)
+{
+	auto &queries = get_frame_queries();
+
+	if (queries.proxies.size() >= MAX_QUERY_COUNT)
+	{
+		return false;
+	}
+
+	auto margin = (world_bounds.get_max() - world_bounds.get_min()) * PROXY_MARGIN;
+	auto min    = world_bounds.get_min() - margin;
+	auto max    = world_bounds.get_max() + margin;
+
+	// From inside, the box would be hidden by the object itself
+	if (glm::all(glm::greaterThanEqual(eye, min)) && glm::all(glm::lessThanEqual(eye, max)))
+	{
+		return false;
+	}
+
+	queries.proxies.push_back({{&node, &mesh}, glm::vec4(min, 1.0f), glm::vec4(max, 1.0f)});
+
+	return true;
+}
+
+void OcclusionQueries::draw(CommandBuffer &command_buffer, const glm::mat4 &view_proj)
+{
+	auto &queries = get_frame_queries();
+
+	if (queries.proxies.empty())
+	{
+		return;
+	}
+
+	auto &resource_cache     = command_buffer.get_device().get_resource_cache();
+	auto &vert_shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, vertex_shader, variant);
+	auto &frag_shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, fragment_shader, variant);
+
+	std::vector<ShaderModule *> shader_modules{&vert_shader_module, &frag_shader_module};
+
+	command_buffer.bind_pipeline_layout(resource_cache.request_pipeline_layout(shader_modules, false));
+
+	// Boxes are tested against the depth of the occluders, but leave the attachments untouched
+	ColorBlendState color_blend_state{};
+	color_blend_state.attachments.resize(command_buffer.get_color_output_count());
+
+	for (auto &attachment : color_blend_state.attachments)
+	{
+		attachment.color_write_mask = 0;
+	}
+
+	command_buffer.set_color_blend_state(color_blend_state);
+
+	DepthStencilState depth_stencil_state{};
+	depth_stencil_state.depth_write_enable = VK_FALSE;
+	depth_stencil_state.depth_compare_op   = VK_COMPARE_OP_GREATER_OR_EQUAL;
+	command_buffer.set_depth_stencil_state(depth_stencil_state);
+
+	// Back faces still count if the near plane clips the front ones
+	RasterizationState rasterization_state{};
+	rasterization_state.cull_mode = VK_CULL_MODE_NONE;
+	command_buffer.set_rasterization_state(rasterization_state);
+
+	command_buffer.set_vertex_input_state({});
+
+	command_buffer.push_constants(0, view_proj);
+
+	for (uint32_t i = 0; i < queries.proxies.size(); ++i)
+	{
+		auto &proxy = queries.proxies[i];
+
+		command_buffer.push_constants(sizeof(glm::mat4), proxy.min);
+		command_buffer.push_constants(sizeof(glm::mat4) + sizeof(glm::vec4), proxy.max);
+
+		command_buffer.begin_query(*queries.query_pool, i, 0);
+		command_buffer.draw(36, 1, 0, 0);
+		command_buffer.end_query(*queries.query_pool, i);
+	}
+}
+
+uint32_t OcclusionQueries::get_proxy_count() const
+{
+	auto frame_index = render_context.get_active_frame_index();
+
+	return frame_index < frame_queries.size() ? to_u32(frame_queries[frame_index].proxies.size()) : 0;
+}
+}        // namespace vkb
@@ -0,0 +1,147 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "common/error.h"
+#include "common/helpers.h"
+#include "core/query_pool.h"
+#include "core/shader_module.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+namespace vkb
+{
+class CommandBuffer;
+class RenderContext;
+
+namespace sg
+{
+class AABB;
+class Mesh;
+class Node;
+}        // namespace sg
+
+/**
+ * @brief Occlusion culling with hardware queries: the bounding boxes of the objects are drawn with an
+ *        occlusion query each, after the occluders. The results are read once the fences of the frame
+ *        which recorded them were waited, one or more frames later, so reading them never stalls.
+ *        Objects are drawn unless their box was occluded in the last results, objects which were not
+ *        queried are drawn, so that they appear as soon as they enter the view
+ */
+class OcclusionQueries
+{
+  public:
+	/// Maximum number of boxes queried in a frame, the objects beyond are drawn without being queried
+	static constexpr uint32_t MAX_QUERY_COUNT = 8192;
+
+	/// Fraction of their size by which boxes are enlarged, objects then appear a little before they become visible
+	static constexpr float PROXY_MARGIN = 0.05f;
+
+	OcclusionQueries(RenderContext &render_context);
+
+	/**
+	 * @brief Reads the results of the queries recorded by the active frame the last time it was drawn,
+	 *        and resets its queries. Must be recorded outside of a render pass
+	 */
+	void reset(CommandBuffer &command_buffer);
+
+	/**
+	 * @return False if the box of the mesh under the node was occluded in the last results read
+	 */
+	bool is_visible(const sg::Node &node, const sg::Mesh &mesh) const;
+
+	/**
+	 * @brief Queues the box of a mesh under a node, to be queried in the active frame
+	 * @param node Node of the mesh
+	 * @param mesh Mesh the box bounds
+	 * @param world_bounds World space bounding box of the mesh under the node
+	 * @param eye Position of the camera, objects whose box contains it cannot be occluded
+	 * @return False if the box was not queued, the mesh must then be drawn
+	 */
+	bool add_proxy(const sg::Node &node, const sg::Mesh &mesh, const sg::AABB &world_bounds, const glm::vec3 &eye);
+
+	/**
+	 * @brief Draws the queued boxes with a query each, without writing depth or color,
+	 *        must be recorded in the subpass of the occluders, after them
+	 * @param command_buffer Command buffer to record
+	 * @param view_proj View projection of the camera
+	 */
+	void draw(CommandBuffer &command_buffer, const glm::mat4 &view_proj);
+
+	/**
+	 * @return Number of boxes queued in the active frame
+	 */
+	uint32_t get_proxy_count() const;
+
+  private:
+	using ProxyKey = std::pair<const sg::Node *, const sg::Mesh *>;
+
+	struct ProxyKeyHash
+	{
+		size_t operator()(const ProxyKey &key) const
+		{
+			size_t result = 0;
+			hash_combine(result, key.first);
+			hash_combine(result, key.second);
+			return result;
+		}
+	};
+
+	struct Proxy
+	{
+		ProxyKey key;
+
+		glm::vec4 min;
+
+		glm::vec4 max;
+	};
+
+	struct FrameQueries
+	{
+		std::unique_ptr<QueryPool> query_pool;
+
+		/// Boxes queried by the frame, in the order of the queries
+		std::vector<Proxy> proxies;
+	};
+
+	FrameQueries &get_frame_queries();
+
+	RenderContext &render_context;
+
+	ShaderSource vertex_shader;
+
+	ShaderSource fragment_shader;
+
+	ShaderVariant variant;
+
+	std::vector<FrameQueries> frame_queries;
+
+	/// Boxes occluded in the last results read
+	std::unordered_set<ProxyKey, ProxyKeyHash> occluded;
+};
+}        // namespace vkb
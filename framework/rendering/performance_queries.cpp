@@ -0,0 +1,351 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "performance_queries.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "common/logging.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
+
+namespace vkb
+{
+namespace
+{
+/**
+ * @brief Describes the counters of the drivers which stand in for a stat, as the names differ between vendors:
+ *        a counter matches if it has the unit of the stat and its name contains one of the phrases,
+ *        and one of the context words if any
+ */
+struct StatCounterMatch
+{
+	StatIndex stat;
+
+	VkPerformanceCounterUnitKHR unit;
+
+	std::vector<std::string> phrases;
+
+	std::vector<std::string> context;
+};
+
+/// In order of precedence, a counter stands in for a single stat
+const std::vector<StatCounterMatch> &get_stat_counter_matches()
+{
+	static const std::vector<std::string> memory_context = {"memory", "dram", "external", "system", "vram", "bus"};
+
+	static const std::vector<StatCounterMatch> matches = {
+	    {StatIndex::gpu_cycles, VK_PERFORMANCE_COUNTER_UNIT_CYCLES_KHR, {"gpu cycles", "gpu busy", "gpu active", "busy cycles", "active cycles"}, {}},
+	    {StatIndex::vertex_compute_cycles, VK_PERFORMANCE_COUNTER_UNIT_CYCLES_KHR, {"vertex", "geometry"}, {}},
+	    {StatIndex::fragment_cycles, VK_PERFORMANCE_COUNTER_UNIT_CYCLES_KHR, {"fragment", "pixel"}, {}},
+	    {StatIndex::tex_cycles, VK_PERFORMANCE_COUNTER_UNIT_CYCLES_KHR, {"texture", "texel"}, {}},
+	    {StatIndex::l2_ext_read_stalls, VK_PERFORMANCE_COUNTER_UNIT_CYCLES_KHR, {"read stall"}, {}},
+	    {StatIndex::l2_ext_write_stalls, VK_PERFORMANCE_COUNTER_UNIT_CYCLES_KHR, {"write stall"}, {}},
+	    {StatIndex::killed_tiles, VK_PERFORMANCE_COUNTER_UNIT_GENERIC_KHR, {"eliminated tiles", "killed tiles", "tiles killed", "transaction elimination"}, {}},
+	    {StatIndex::tiles, VK_PERFORMANCE_COUNTER_UNIT_GENERIC_KHR, {"tiles"}, {}},
+	    {StatIndex::l2_ext_read_bytes, VK_PERFORMANCE_COUNTER_UNIT_BYTES_KHR, {"read"}, memory_context},
+	    {StatIndex::l2_ext_write_bytes, VK_PERFORMANCE_COUNTER_UNIT_BYTES_KHR, {"write", "written"}, memory_context},
+	    {StatIndex::l2_ext_reads, VK_PERFORMANCE_COUNTER_UNIT_GENERIC_KHR, {"read"}, memory_context},
+	    {StatIndex::l2_ext_writes, VK_PERFORMANCE_COUNTER_UNIT_GENERIC_KHR, {"write"}, memory_context},
+	};
+
+	return matches;
+}
+
+/**
+ * @brief Lowers the case of a counter name and replaces its separators with spaces
+ */
+std::string normalize_counter_name(const std::string &name)
+{
+	std::string result = name;
+
+	std::transform(result.begin(), result.end(), result.begin(), [](char c) {
+		return (c == '_' || c == '-' || c == '.') ? ' ' : static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	});
+
+	return result;
+}
+
+bool contains_any(const std::string &name, const std::vector<std::string> &words)
+{
+	return std::any_of(words.begin(), words.end(), [&name](const std::string &word) { return name.find(word) != std::string::npos; });
+}
+
+/**
+ * @return The number of passes needed to query the counters, which must be one to query them within a frame
+ */
+uint32_t get_pass_count(Device &device, uint32_t queue_family_index, const std::vector<uint32_t> &counter_indices)
+{
+	VkQueryPoolPerformanceCreateInfoKHR performance_info{VK_STRUCTURE_TYPE_QUERY_POOL_PERFORMANCE_CREATE_INFO_KHR};
+	performance_info.queueFamilyIndex  = queue_family_index;
+	performance_info.counterIndexCount = to_u32(counter_indices.size());
+	performance_info.pCounterIndices   = counter_indices.data();
+
+	uint32_t pass_count = 0;
+
+	vkGetPhysicalDeviceQueueFamilyPerformanceQueryPassesKHR(device.get_physical_device(), &performance_info, &pass_count);
+
+	return pass_count;
+}
+
+double to_double(const VkPerformanceCounterResultKHR &result, VkPerformanceCounterStorageKHR storage)
+{
+	switch (storage)
+	{
+		case VK_PERFORMANCE_COUNTER_STORAGE_INT32_KHR:
+			return static_cast<double>(result.int32);
+		case VK_PERFORMANCE_COUNTER_STORAGE_INT64_KHR:
+			return static_cast<double>(result.int64);
+		case VK_PERFORMANCE_COUNTER_STORAGE_UINT32_KHR:
+			return static_cast<double>(result.uint32);
+		case VK_PERFORMANCE_COUNTER_STORAGE_UINT64_KHR:
+			return static_cast<double>(result.uint64);
+		case VK_PERFORMANCE_COUNTER_STORAGE_FLOAT32_KHR:
+			return static_cast<double>(result.float32);
+		case VK_PERFORMANCE_COUNTER_STORAGE_FLOAT64_KHR:
+			return result.float64;
+		default:
+			return 0.0;
+	}
+}
+}        // namespace
+
+constexpr uint32_t PerformanceQueries::MAX_RENDER_PASSES;
+
+std::vector<PerformanceCounter> select_performance_counters(Device &device, uint32_t queue_family_index,
+                                                            const std::set<StatIndex> &stats, const std::vector<std::string> &names)
+{
+	std::vector<PerformanceCounter> selected;
+
+	if (!device.is_enabled(VK_KHR_PERFORMANCE_QUERY_EXTENSION_NAME))
+	{
+		return selected;
+	}
+
+	uint32_t count = 0;
+	vkEnumeratePhysicalDeviceQueueFamilyPerformanceQueryCountersKHR(device.get_physical_device(), queue_family_index, &count, nullptr, nullptr);
+
+	std::vector<VkPerformanceCounterKHR>            counters(count, {VK_STRUCTURE_TYPE_PERFORMANCE_COUNTER_KHR});
+	std::vector<VkPerformanceCounterDescriptionKHR> descriptions(count, {VK_STRUCTURE_TYPE_PERFORMANCE_COUNTER_DESCRIPTION_KHR});
+
+	vkEnumeratePhysicalDeviceQueueFamilyPerformanceQueryCountersKHR(device.get_physical_device(), queue_family_index, &count, counters.data(), descriptions.data());
+
+	std::vector<bool>     used(count, false);
+	std::vector<uint32_t> counter_indices;
+
+	// Adds a counter if the counters picked so far can still be queried in a single pass
+	auto try_select = [&](uint32_t index, bool has_stat, StatIndex stat) {
+		// Counters scoped to command buffers must be queried around whole command buffers
+		if (used[index] || counters[index].scope == VK_PERFORMANCE_COUNTER_SCOPE_COMMAND_BUFFER_KHR)
+		{
+			return false;
+		}
+
+		counter_indices.push_back(index);
+
+		if (get_pass_count(device, queue_family_index, counter_indices) > 1)
+		{
+			LOGW("Performance counter `{}` needs another pass, it is not queried", descriptions[index].name);
+
+			counter_indices.pop_back();
+			return false;
+		}
+
+		used[index] = true;
+
+		selected.push_back({index, descriptions[index].name, descriptions[index].category, counters[index].unit, counters[index].storage, has_stat, stat});
+
+		return true;
+	};
+
+	for (auto &match : get_stat_counter_matches())
+	{
+		if (stats.count(match.stat) == 0)
+		{
+			continue;
+		}
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			auto name = normalize_counter_name(descriptions[i].name);
+
+			if (counters[i].unit == match.unit &&
+			    contains_any(name, match.phrases) &&
+			    (match.context.empty() || contains_any(name, match.context)) &&
+			    try_select(i, true, match.stat))
+			{
+				LOGI("Performance counter `{}` stands in for a GPU stat", descriptions[i].name);
+				break;
+			}
+		}
+	}
+
+	for (auto &requested_name : names)
+	{
+		auto requested = normalize_counter_name(requested_name);
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (requested == "all" || normalize_counter_name(descriptions[i].name) == requested)
+			{
+				try_select(i, false, StatIndex::gpu_cycles);
+			}
+		}
+	}
+
+	return selected;
+}
+
+PerformanceQueries::PerformanceQueries(Device &device) :
+    device{device}
+{
+}
+
+void PerformanceQueries::set_counters(const std::vector<PerformanceCounter> &new_counters, uint32_t new_queue_family_index)
+{
+	bool same_counters = new_counters.size() == counters.size() &&
+	                     std::equal(new_counters.begin(), new_counters.end(), counters.begin(),
+	                                [](const PerformanceCounter &a, const PerformanceCounter &b) { return a.index == b.index; });
+
+	if (same_counters && new_queue_family_index == queue_family_index)
+	{
+		return;
+	}
+
+	counters           = new_counters;
+	queue_family_index = new_queue_family_index;
+
+	values.assign(counters.size(), 0.0);
+
+	query_pool.reset();
+	query_count   = 0;
+	query_open    = false;
+	queries_reset = false;
+
+	if (counters.empty())
+	{
+		return;
+	}
+
+	std::vector<uint32_t> counter_indices;
+
+	for (auto &counter : counters)
+	{
+		counter_indices.push_back(counter.index);
+	}
+
+	VkQueryPoolPerformanceCreateInfoKHR performance_info{VK_STRUCTURE_TYPE_QUERY_POOL_PERFORMANCE_CREATE_INFO_KHR};
+	performance_info.queueFamilyIndex  = queue_family_index;
+	performance_info.counterIndexCount = to_u32(counter_indices.size());
+	performance_info.pCounterIndices   = counter_indices.data();
+
+	VkQueryPoolCreateInfo create_info{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+	create_info.pNext      = &performance_info;
+	create_info.queryType  = VK_QUERY_TYPE_PERFORMANCE_QUERY_KHR;
+	create_info.queryCount = MAX_RENDER_PASSES;
+
+	query_pool = std::make_unique<QueryPool>(device, create_info);
+
+	// Performance queries cannot be reset in the command buffers using them
+	query_pool->host_reset(0, MAX_RENDER_PASSES);
+	queries_reset = true;
+}
+
+bool PerformanceQueries::is_enabled() const
+{
+	return query_pool != nullptr;
+}
+
+void PerformanceQueries::begin_render_pass(CommandBuffer &command_buffer, uint32_t command_queue_family_index)
+{
+	if (!is_enabled() || !queries_reset || query_open || query_count >= MAX_RENDER_PASSES ||
+	    command_queue_family_index != queue_family_index)
+	{
+		return;
+	}
+
+	command_buffer.begin_query(*query_pool, query_count, 0);
+
+	query_open = true;
+}
+
+void PerformanceQueries::end_render_pass(CommandBuffer &command_buffer)
+{
+	if (!query_open)
+	{
+		return;
+	}
+
+	command_buffer.end_query(*query_pool, query_count++);
+
+	query_open = false;
+}
+
+void PerformanceQueries::reset()
+{
+	std::fill(values.begin(), values.end(), 0.0);
+
+	query_open = false;
+
+	if (query_count == 0)
+	{
+		return;
+	}
+
+	std::vector<VkPerformanceCounterResultKHR> results(query_count * counters.size());
+
+	VkResult result = query_pool->get_results(0, query_count, results.size() * sizeof(VkPerformanceCounterResultKHR), results.data(),
+	                                          counters.size() * sizeof(VkPerformanceCounterResultKHR), 0);
+
+	// Without waiting for the frame the queries may still be in use, they are read again at the next reset
+	if (result == VK_NOT_READY)
+	{
+		queries_reset = false;
+		return;
+	}
+
+	if (result == VK_SUCCESS)
+	{
+		for (uint32_t query = 0; query < query_count; ++query)
+		{
+			for (size_t i = 0; i < counters.size(); ++i)
+			{
+				values[i] += to_double(results[query * counters.size() + i], counters[i].storage);
+			}
+		}
+	}
+
+	query_pool->host_reset(0, query_count);
+
+	query_count   = 0;
+	queries_reset = true;
+}
+
+const std::vector<PerformanceCounter> &PerformanceQueries::get_counters() const
+{
+	return counters;
+}
+
+const std::vector<double> &PerformanceQueries::get_values() const
+{
+	return values;
+}
+}        // namespace vkb
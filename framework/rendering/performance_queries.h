@@ -0,0 +1,143 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+#include "core/query_pool.h"
+#include "stats.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class Device;
+
+/**
+ * @brief A counter of VK_KHR_performance_query, exposed by the driver of any vendor
+ */
+struct PerformanceCounter
+{
+	/// Index of the counter in the counters of the queue family
+	uint32_t index;
+
+	std::string name;
+
+	std::string category;
+
+	VkPerformanceCounterUnitKHR unit;
+
+	VkPerformanceCounterStorageKHR storage;
+
+	/// Whether the counter stands in for a hwcpipe stat
+	bool has_stat;
+
+	StatIndex stat;
+};
+
+/**
+ * @brief Picks the performance counters of a queue family which measure some stats, matching the names and units
+ *        the drivers give them to the stats of the same meaning, and the counters given by name.
+ *        Only counters which can be scoped to render passes are picked, as long as they fit in a single pass.
+ * @param device The device, VK_KHR_performance_query must be enabled
+ * @param queue_family_index The queue family the counters are queried on
+ * @param stats The stats to find a counter for
+ * @param names The names of additional counters, matched without case, "all" to pick every counter which fits
+ * @return The counters picked, the ones standing in for a stat first
+ */
+std::vector<PerformanceCounter> select_performance_counters(Device &device, uint32_t queue_family_index,
+                                                            const std::set<StatIndex> &stats, const std::vector<std::string> &names);
+
+/**
+ * @brief Measures performance counters over the render passes recorded for a frame, with VK_KHR_performance_query.
+ *
+ * Unlike hwcpipe, which samples the counters of Mali GPUs for the whole system, the counters are those of the
+ * driver, on any vendor, and only count the work of the render passes. The queries are reset from the host when
+ * the frame is reset, their results lag behind by the number of frames in flight as those of the GpuProfiler.
+ * The profiling lock of the device must be held while the frame is recorded and executed.
+ */
+class PerformanceQueries
+{
+  public:
+	/// Maximum number of render passes measured in a frame, the following ones are ignored
+	static constexpr uint32_t MAX_RENDER_PASSES = 32;
+
+	PerformanceQueries(Device &device);
+
+	PerformanceQueries(const PerformanceQueries &) = delete;
+
+	PerformanceQueries(PerformanceQueries &&) = default;
+
+	PerformanceQueries &operator=(const PerformanceQueries &) = delete;
+
+	PerformanceQueries &operator=(PerformanceQueries &&) = delete;
+
+	/**
+	 * @brief Sets the counters measured, none to disable the queries. It should not be changed while a frame is being recorded
+	 * @param queue_family_index The queue family the counters were picked for, render passes of other families are not measured
+	 */
+	void set_counters(const std::vector<PerformanceCounter> &counters, uint32_t queue_family_index);
+
+	bool is_enabled() const;
+
+	/**
+	 * @brief Begins the query of a render pass, recorded before the render pass begins
+	 * @param command_buffer The primary command buffer to record to
+	 * @param command_queue_family_index The queue family of the command pool of the command buffer
+	 */
+	void begin_render_pass(CommandBuffer &command_buffer, uint32_t command_queue_family_index);
+
+	/**
+	 * @brief Ends the query of the render pass, recorded after the render pass ends
+	 */
+	void end_render_pass(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Reads back the counters of the previous recording and resets the queries, the GPU must have completed it
+	 */
+	void reset();
+
+	const std::vector<PerformanceCounter> &get_counters() const;
+
+	/**
+	 * @return The value of each counter for the previous recording, summed over its render passes
+	 */
+	const std::vector<double> &get_values() const;
+
+  private:
+	Device &device;
+
+	std::vector<PerformanceCounter> counters;
+
+	uint32_t queue_family_index{0};
+
+	std::unique_ptr<QueryPool> query_pool;
+
+	uint32_t query_count{0};
+
+	/// Whether a query was begun and not ended yet
+	bool query_open{false};
+
+	/// Whether the queries were reset since they were last used
+	bool queries_reset{false};
+
+	std::vector<double> values;
+};
+}        // namespace vkb
@@ -20,6 +20,10 @@
 
 #include "pipeline_state.h"
 
+#include "common/helpers.h"
+#include "core/shader_module.h"
+#include "rendering/shader_program.h"
+
 bool operator==(const VkVertexInputAttributeDescription &lhs, const VkVertexInputAttributeDescription &rhs)
 {
 	return std::tie(lhs.binding, lhs.format, lhs.location, lhs.offset) == std::tie(rhs.binding, rhs.format, rhs.location, rhs.offset);
@@ -85,13 +89,76 @@ bool operator!=(const vkb::ColorBlendState &lhs, const vkb::ColorBlendState &rhs
 	                   });
 }
 
+bool operator!=(const vkb::FragmentShadingRateState &lhs, const vkb::FragmentShadingRateState &rhs)
+{
+	return std::tie(lhs.fragment_size.width, lhs.fragment_size.height, lhs.combiner_ops[0], lhs.combiner_ops[1]) !=
+	       std::tie(rhs.fragment_size.width, rhs.fragment_size.height, rhs.combiner_ops[0], rhs.combiner_ops[1]);
+}
+
 namespace vkb
 {
+namespace
+{
+// All the sub-state structs only hold 32-bit fields, so they have no padding and can be hashed as bytes
+
+inline size_t hash_pipeline_layout(const PipelineLayout &pipeline_layout)
+{
+	size_t result = 0;
+
+	hash_combine(result, pipeline_layout.get_handle());
+
+	for (auto stage : pipeline_layout.get_shader_program().get_shader_modules())
+	{
+		hash_combine(result, stage->get_id());
+	}
+
+	return result;
+}
+
+inline size_t hash_color_blend_state(const ColorBlendState &color_blend_state)
+{
+	size_t result = hash_bytes(&color_blend_state.logic_op_enable, sizeof(color_blend_state.logic_op_enable));
+
+	result = hash_bytes(&color_blend_state.logic_op, sizeof(color_blend_state.logic_op), result);
+
+	return hash_bytes(color_blend_state.attachments, result);
+}
+
+inline RasterizationState get_static_state(const RasterizationState &rasterization_state, bool extended_dynamic_state)
+{
+	RasterizationState static_state = rasterization_state;
+
+	if (extended_dynamic_state)
+	{
+		static_state.cull_mode  = RasterizationState{}.cull_mode;
+		static_state.front_face = RasterizationState{}.front_face;
+	}
+
+	return static_state;
+}
+
+inline DepthStencilState get_static_state(const DepthStencilState &depth_stencil_state, bool extended_dynamic_state)
+{
+	DepthStencilState static_state = depth_stencil_state;
+
+	if (extended_dynamic_state)
+	{
+		static_state.depth_test_enable  = DepthStencilState{}.depth_test_enable;
+		static_state.depth_write_enable = DepthStencilState{}.depth_write_enable;
+		static_state.depth_compare_op   = DepthStencilState{}.depth_compare_op;
+	}
+
+	return static_state;
+}
+}        // namespace
+
 void SpecializationConstantState::reset()
 {
 	if (dirty)
 	{
 		specialization_constant_state.clear();
+
+		update_hash();
 	}
 
 	dirty = false;
@@ -108,22 +175,32 @@ void SpecializationConstantState::clear_dirty()
 }
 
 void SpecializationConstantState::set_constant(uint32_t constant_id, const std::vector<uint8_t> &value)
+{
+	set_constant(constant_id, value.data(), value.size());
+}
+
+void SpecializationConstantState::set_constant(uint32_t constant_id, const uint8_t *value, size_t size)
 {
 	auto data = specialization_constant_state.find(constant_id);
 
-	if (data != specialization_constant_state.end() && data->second == value)
+	if (data != specialization_constant_state.end() && data->second.size() == size && std::equal(value, value + size, data->second.begin()))
 	{
 		return;
 	}
 
 	dirty = true;
 
-	specialization_constant_state[constant_id] = value;
+	// Reuses the storage of the previous value
+	specialization_constant_state[constant_id].assign(value, value + size);
+
+	update_hash();
 }
 
 void SpecializationConstantState::set_specialization_constant_state(const std::map<uint32_t, std::vector<uint8_t>> &state)
 {
 	specialization_constant_state = state;
+
+	update_hash();
 }
 
 const std::map<uint32_t, std::vector<uint8_t>> &SpecializationConstantState::get_specialization_constant_state() const
@@ -131,6 +208,27 @@ const std::map<uint32_t, std::vector<uint8_t>> &SpecializationConstantState::get
 	return specialization_constant_state;
 }
 
+size_t SpecializationConstantState::get_hash() const
+{
+	return hash;
+}
+
+void SpecializationConstantState::update_hash()
+{
+	hash = 0;
+
+	for (auto &constant : specialization_constant_state)
+	{
+		hash = hash_bytes(&constant.first, sizeof(constant.first), hash);
+		hash = hash_bytes(constant.second, hash);
+	}
+}
+
+PipelineState::PipelineState()
+{
+	update_hashes();
+}
+
 void PipelineState::reset()
 {
 	clear_dirty();
@@ -153,7 +251,11 @@ void PipelineState::reset()
 
 	color_blend_state = {};
 
+	fragment_shading_rate_state = {};
+
 	subpass_index = {0U};
+
+	update_hashes();
 }
 
 void PipelineState::set_pipeline_layout(PipelineLayout &new_pipeline_layout)
@@ -164,6 +266,8 @@ void PipelineState::set_pipeline_layout(PipelineLayout &new_pipeline_layout)
 		{
 			pipeline_layout = &new_pipeline_layout;
 
+			hashes.pipeline_layout = hash_pipeline_layout(*pipeline_layout);
+
 			dirty = true;
 		}
 	}
@@ -171,32 +275,31 @@ void PipelineState::set_pipeline_layout(PipelineLayout &new_pipeline_layout)
 	{
 		pipeline_layout = &new_pipeline_layout;
 
+		hashes.pipeline_layout = hash_pipeline_layout(*pipeline_layout);
+
 		dirty = true;
 	}
 }
 
 void PipelineState::set_render_pass(const RenderPass &new_render_pass)
 {
-	if (render_pass)
+	// The bound pipeline can be kept for any compatible render pass
+	if (!render_pass || render_pass->get_compatibility_hash() != new_render_pass.get_compatibility_hash())
 	{
-		if (render_pass->get_handle() != new_render_pass.get_handle())
-		{
-			render_pass = &new_render_pass;
-
-			dirty = true;
-		}
-	}
-	else
-	{
-		render_pass = &new_render_pass;
-
 		dirty = true;
 	}
+
+	render_pass = &new_render_pass;
 }
 
 void PipelineState::set_specialization_constant(uint32_t constant_id, const std::vector<uint8_t> &data)
 {
-	specialization_constant_state.set_constant(constant_id, data);
+	set_specialization_constant(constant_id, data.data(), data.size());
+}
+
+void PipelineState::set_specialization_constant(uint32_t constant_id, const uint8_t *data, size_t size)
+{
+	specialization_constant_state.set_constant(constant_id, data, size);
 
 	if (specialization_constant_state.is_dirty())
 	{
@@ -210,6 +313,8 @@ void PipelineState::set_vertex_input_state(const VertexInputState &new_vertex_in
 	{
 		vertex_input_sate = new_vertex_input_sate;
 
+		hashes.vertex_input = hash_bytes(vertex_input_sate.attributes, hash_bytes(vertex_input_sate.bindings));
+
 		dirty = true;
 	}
 }
@@ -220,6 +325,8 @@ void PipelineState::set_input_assembly_state(const InputAssemblyState &new_input
 	{
 		input_assembly_state = new_input_assembly_state;
 
+		hashes.input_assembly = hash_bytes(&input_assembly_state, sizeof(input_assembly_state));
+
 		dirty = true;
 	}
 }
@@ -228,9 +335,18 @@ void PipelineState::set_rasterization_state(const RasterizationState &new_raster
 {
 	if (rasterization_state != new_rasterization_state)
 	{
+		bool static_state_changed = get_static_state(rasterization_state, extended_dynamic_state) != get_static_state(new_rasterization_state, extended_dynamic_state);
+
 		rasterization_state = new_rasterization_state;
 
-		dirty = true;
+		if (static_state_changed)
+		{
+			auto static_state = get_static_rasterization_state();
+
+			hashes.rasterization = hash_bytes(&static_state, sizeof(static_state));
+
+			dirty = true;
+		}
 	}
 }
 
@@ -240,6 +356,8 @@ void PipelineState::set_viewport_state(const ViewportState &new_viewport_state)
 	{
 		viewport_state = new_viewport_state;
 
+		hashes.viewport = hash_bytes(&viewport_state, sizeof(viewport_state));
+
 		dirty = true;
 	}
 }
@@ -250,6 +368,8 @@ void PipelineState::set_multisample_state(const MultisampleState &new_multisampl
 	{
 		multisample_state = new_multisample_state;
 
+		hashes.multisample = hash_bytes(&multisample_state, sizeof(multisample_state));
+
 		dirty = true;
 	}
 }
@@ -258,9 +378,18 @@ void PipelineState::set_depth_stencil_state(const DepthStencilState &new_depth_s
 {
 	if (depth_stencil_state != new_depth_stencil_state)
 	{
+		bool static_state_changed = get_static_state(depth_stencil_state, extended_dynamic_state) != get_static_state(new_depth_stencil_state, extended_dynamic_state);
+
 		depth_stencil_state = new_depth_stencil_state;
 
-		dirty = true;
+		if (static_state_changed)
+		{
+			auto static_state = get_static_depth_stencil_state();
+
+			hashes.depth_stencil = hash_bytes(&static_state, sizeof(static_state));
+
+			dirty = true;
+		}
 	}
 }
 
@@ -270,6 +399,20 @@ void PipelineState::set_color_blend_state(const ColorBlendState &new_color_blend
 	{
 		color_blend_state = new_color_blend_state;
 
+		hashes.color_blend = hash_color_blend_state(color_blend_state);
+
+		dirty = true;
+	}
+}
+
+void PipelineState::set_fragment_shading_rate_state(const FragmentShadingRateState &new_fragment_shading_rate_state)
+{
+	if (fragment_shading_rate_state != new_fragment_shading_rate_state)
+	{
+		fragment_shading_rate_state = new_fragment_shading_rate_state;
+
+		hashes.fragment_shading_rate = hash_bytes(&fragment_shading_rate_state, sizeof(fragment_shading_rate_state));
+
 		dirty = true;
 	}
 }
@@ -284,6 +427,23 @@ void PipelineState::set_subpass_index(uint32_t new_subpass_index)
 	}
 }
 
+void PipelineState::set_extended_dynamic_state(bool enable)
+{
+	if (extended_dynamic_state != enable)
+	{
+		extended_dynamic_state = enable;
+
+		update_hashes();
+
+		dirty = true;
+	}
+}
+
+bool PipelineState::has_extended_dynamic_state() const
+{
+	return extended_dynamic_state;
+}
+
 const PipelineLayout &PipelineState::get_pipeline_layout() const
 {
 	assert(pipeline_layout && "Graphics state Pipeline layout is not set");
@@ -315,6 +475,11 @@ const RasterizationState &PipelineState::get_rasterization_state() const
 	return rasterization_state;
 }
 
+RasterizationState PipelineState::get_static_rasterization_state() const
+{
+	return get_static_state(rasterization_state, extended_dynamic_state);
+}
+
 const ViewportState &PipelineState::get_viewport_state() const
 {
 	return viewport_state;
@@ -330,16 +495,67 @@ const DepthStencilState &PipelineState::get_depth_stencil_state() const
 	return depth_stencil_state;
 }
 
+DepthStencilState PipelineState::get_static_depth_stencil_state() const
+{
+	return get_static_state(depth_stencil_state, extended_dynamic_state);
+}
+
 const ColorBlendState &PipelineState::get_color_blend_state() const
 {
 	return color_blend_state;
 }
 
+const FragmentShadingRateState &PipelineState::get_fragment_shading_rate_state() const
+{
+	return fragment_shading_rate_state;
+}
+
 uint32_t PipelineState::get_subpass_index() const
 {
 	return subpass_index;
 }
 
+size_t PipelineState::get_hash() const
+{
+	size_t result = hashes.pipeline_layout;
+
+	// For graphics only
+	if (render_pass)
+	{
+		hash_combine(result, render_pass->get_compatibility_hash());
+	}
+
+	hash_combine(result, subpass_index);
+	hash_combine(result, specialization_constant_state.get_hash());
+	hash_combine(result, hashes.vertex_input);
+	hash_combine(result, hashes.input_assembly);
+	hash_combine(result, hashes.rasterization);
+	hash_combine(result, hashes.viewport);
+	hash_combine(result, hashes.multisample);
+	hash_combine(result, hashes.depth_stencil);
+	hash_combine(result, hashes.color_blend);
+	hash_combine(result, hashes.fragment_shading_rate);
+	hash_combine(result, extended_dynamic_state);
+
+	return result;
+}
+
+void PipelineState::update_hashes()
+{
+	auto static_rasterization_state = get_static_rasterization_state();
+	auto static_depth_stencil_state = get_static_depth_stencil_state();
+
+	hashes.pipeline_layout       = pipeline_layout ? hash_pipeline_layout(*pipeline_layout) : 0;
+	hashes.vertex_input          = hash_bytes(vertex_input_sate.attributes, hash_bytes(vertex_input_sate.bindings));
+	hashes.input_assembly        = hash_bytes(&input_assembly_state, sizeof(input_assembly_state));
+	hashes.rasterization         = hash_bytes(&static_rasterization_state, sizeof(static_rasterization_state));
+	hashes.viewport              = hash_bytes(&viewport_state, sizeof(viewport_state));
+	hashes.multisample           = hash_bytes(&multisample_state, sizeof(multisample_state));
+	hashes.depth_stencil         = hash_bytes(&static_depth_stencil_state, sizeof(static_depth_stencil_state));
+	hashes.color_blend           = hash_color_blend_state(color_blend_state);
+	hashes.fragment_shading_rate = hash_bytes(&fragment_shading_rate_state, sizeof(fragment_shading_rate_state));
+}
+
 bool PipelineState::is_dirty() const
 {
 	return dirty || specialization_constant_state.is_dirty();
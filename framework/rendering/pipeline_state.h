@@ -136,6 +136,16 @@ struct ColorBlendState
 	std::vector<ColorBlendAttachmentState> attachments;
 };
 
+/// Shading rate of the draws with VK_KHR_fragment_shading_rate, the default shades every pixel and ignores the other rates
+struct FragmentShadingRateState
+{
+	/// Size in pixels of the fragments of the pipeline
+	VkExtent2D fragment_size{1, 1};
+
+	/// How the pipeline rate is combined with the rate of the primitive, then with the rate of the shading rate attachment
+	VkFragmentShadingRateCombinerOpKHR combiner_ops[2]{VK_FRAGMENT_SHADING_RATE_COMBINER_OP_KEEP_KHR, VK_FRAGMENT_SHADING_RATE_COMBINER_OP_KEEP_KHR};
+};
+
 /// Helper class to create specialization constants for a Vulkan pipeline. The state tracks a pipeline globally, and not per shader. Two shaders using the same constant_id will have the same data.
 class SpecializationConstantState
 {
@@ -151,14 +161,28 @@ class SpecializationConstantState
 
 	void set_constant(uint32_t constant_id, const std::vector<uint8_t> &data);
 
+	/**
+	 * @brief Sets a constant from raw bytes, without allocating if the constant is unchanged
+	 */
+	void set_constant(uint32_t constant_id, const uint8_t *data, size_t size);
+
 	void set_specialization_constant_state(const std::map<uint32_t, std::vector<uint8_t>> &state);
 
 	const std::map<uint32_t, std::vector<uint8_t>> &get_specialization_constant_state() const;
 
+	/**
+	 * @brief Hash of all the constants, updated when the constants change
+	 */
+	size_t get_hash() const;
+
   private:
 	bool dirty{false};
 	// Map tracking state of the Specialization Constants
 	std::map<uint32_t, std::vector<uint8_t>> specialization_constant_state;
+
+	size_t hash{0};
+
+	void update_hash();
 };
 
 template <class T>
@@ -166,9 +190,7 @@ inline void SpecializationConstantState::set_constant(std::uint32_t constant_id,
 {
 	std::uint32_t value = static_cast<std::uint32_t>(data);
 
-	set_constant(constant_id,
-	             {reinterpret_cast<const uint8_t *>(&value),
-	              reinterpret_cast<const uint8_t *>(&value) + sizeof(T)});
+	set_constant(constant_id, reinterpret_cast<const uint8_t *>(&value), sizeof(value));
 }
 
 template <>
@@ -176,14 +198,14 @@ inline void SpecializationConstantState::set_constant<bool>(std::uint32_t consta
 {
 	std::uint32_t value = static_cast<std::uint32_t>(data_);
 
-	set_constant(constant_id,
-	             {reinterpret_cast<const uint8_t *>(&value),
-	              reinterpret_cast<const uint8_t *>(&value) + sizeof(std::uint32_t)});
+	set_constant(constant_id, reinterpret_cast<const uint8_t *>(&value), sizeof(std::uint32_t));
 }
 
 class PipelineState
 {
   public:
+	PipelineState();
+
 	void reset();
 
 	void set_pipeline_layout(PipelineLayout &pipeline_layout);
@@ -192,6 +214,8 @@ class PipelineState
 
 	void set_specialization_constant(uint32_t constant_id, const std::vector<uint8_t> &data);
 
+	void set_specialization_constant(uint32_t constant_id, const uint8_t *data, size_t size);
+
 	void set_vertex_input_state(const VertexInputState &vertex_input_sate);
 
 	void set_input_assembly_state(const InputAssemblyState &input_assembly_state);
@@ -206,8 +230,22 @@ class PipelineState
 
 	void set_color_blend_state(const ColorBlendState &color_blend_state);
 
+	/**
+	 * @brief Sets the shading rate of the pipeline, ignored unless the device supports VK_KHR_fragment_shading_rate
+	 */
+	void set_fragment_shading_rate_state(const FragmentShadingRateState &fragment_shading_rate_state);
+
 	void set_subpass_index(uint32_t subpass_index);
 
+	/**
+	 * @brief Leaves the cull mode, front face and depth test, write and compare op out of the pipeline,
+	 *        as they are set by commands (VK_EXT_extended_dynamic_state). Changing them then neither
+	 *        dirties the state nor creates a pipeline. Kept by reset().
+	 */
+	void set_extended_dynamic_state(bool enable);
+
+	bool has_extended_dynamic_state() const;
+
 	const PipelineLayout &get_pipeline_layout() const;
 
 	const RenderPass *get_render_pass() const;
@@ -220,20 +258,38 @@ class PipelineState
 
 	const RasterizationState &get_rasterization_state() const;
 
+	/**
+	 * @return The rasterization state baked into the pipeline, without the dynamic fields
+	 */
+	RasterizationState get_static_rasterization_state() const;
+
 	const ViewportState &get_viewport_state() const;
 
 	const MultisampleState &get_multisample_state() const;
 
 	const DepthStencilState &get_depth_stencil_state() const;
 
+	/**
+	 * @return The depth stencil state baked into the pipeline, without the dynamic fields
+	 */
+	DepthStencilState get_static_depth_stencil_state() const;
+
 	const ColorBlendState &get_color_blend_state() const;
 
+	const FragmentShadingRateState &get_fragment_shading_rate_state() const;
+
 	uint32_t get_subpass_index() const;
 
 	bool is_dirty() const;
 
 	void clear_dirty();
 
+	/**
+	 * @brief Hash of the whole pipeline state. Each sub-state hash is cached and only
+	 *        recomputed by the setter that changes it, so this only combines a few values.
+	 */
+	size_t get_hash() const;
+
   private:
 	bool dirty{false};
 
@@ -257,6 +313,37 @@ class PipelineState
 
 	ColorBlendState color_blend_state{};
 
+	FragmentShadingRateState fragment_shading_rate_state{};
+
 	uint32_t subpass_index{0U};
+
+	bool extended_dynamic_state{false};
+
+	/// Cached hashes of the sub-states
+	struct
+	{
+		size_t pipeline_layout{0};
+
+		size_t vertex_input{0};
+
+		size_t input_assembly{0};
+
+		size_t rasterization{0};
+
+		size_t viewport{0};
+
+		size_t multisample{0};
+
+		size_t depth_stencil{0};
+
+		size_t color_blend{0};
+
+		size_t fragment_shading_rate{0};
+	} hashes;
+
+	/**
+	 * @brief Recomputes the cached hashes of all the sub-states
+	 */
+	void update_hashes();
 };
 }        // namespace vkb
@@ -0,0 +1,435 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/post_processing_pipeline.h"
+
+#include <utility>
+
+#include "core/command_buffer.h"
+#include "gui.h"
+#include "rendering/render_context.h"
+
+namespace vkb
+{
+namespace
+{
+/// Workgroup sizes the post-processing compute shaders are tuned with, the first one until they are tuned
+const std::vector<WorkgroupSize> WORKGROUP_SIZES{{8, 8}, {16, 8}, {16, 16}, {32, 4}, {64, 1}};
+
+/// Images of the compute backend render target
+const uint32_t DEPTH_IMAGE = 1;
+
+const uint32_t HDR_IMAGE = 2;
+
+ShaderVariant create_variant(const std::vector<std::string> &definitions)
+{
+	ShaderVariant variant;
+
+	for (auto &definition : definitions)
+	{
+		variant.add_define(definition);
+	}
+
+	return variant;
+}
+
+void set_viewport_and_scissor(CommandBuffer &command_buffer, const VkExtent2D &extent)
+{
+	VkViewport viewport{};
+	viewport.width    = static_cast<float>(extent.width);
+	viewport.height   = static_cast<float>(extent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	command_buffer.set_viewport(0, {viewport});
+
+	VkRect2D scissor{};
+	scissor.extent = extent;
+	command_buffer.set_scissor(0, {scissor});
+}
+}        // namespace
+
+const VkFormat PostProcessingPipeline::HDR_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+const VkFormat PostProcessingPipeline::LDR_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+PostProcessingPipeline::PostProcessingPipeline(RenderContext &render_context, PostProcessingBackend backend, const PostProcessingEffects &effects) :
+    render_context{render_context},
+    backend{backend},
+    effects{effects}
+{
+	// Filters read between texels, and clamping keeps the edges from bleeding across the screen
+	VkSamplerCreateInfo sampler_info{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+	sampler_info.magFilter    = VK_FILTER_LINEAR;
+	sampler_info.minFilter    = VK_FILTER_LINEAR;
+	sampler_info.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+	sampler = &render_context.get_device().get_resource_cache().request_sampler(sampler_info);
+}
+
+void PostProcessingPipeline::prepare(std::unique_ptr<Subpass> &&scene_subpass)
+{
+	assert(!render_graph && !scene_pipeline && "Post-processing pipeline is already prepared");
+
+	if (backend == PostProcessingBackend::Fragment)
+	{
+		prepare_fragment(std::move(scene_subpass));
+	}
+	else
+	{
+		prepare_compute(std::move(scene_subpass));
+	}
+}
+
+std::unique_ptr<PostProcessingSubpass> PostProcessingPipeline::create_subpass(const std::string &fragment_shader, const std::vector<std::string> &definitions)
+{
+	return std::make_unique<PostProcessingSubpass>(render_context, ShaderSource{fragment_shader}, create_variant(definitions), parameters, *sampler);
+}
+
+void PostProcessingPipeline::prepare_fragment(std::unique_ptr<Subpass> &&scene_subpass)
+{
+	render_graph = std::make_unique<RenderGraph>();
+
+	VkClearValue color_clear{};
+	color_clear.color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+
+	VkClearValue depth_clear{};
+	depth_clear.depthStencil = {0.0f, ~0U};
+
+	auto hdr   = render_graph->add_attachment("hdr", HDR_FORMAT, color_clear);
+	auto depth = render_graph->add_attachment("depth", render_context.get_device().get_depth_format(), depth_clear);
+
+	render_graph->add_pass(std::move(scene_subpass)).writes(hdr).writes(depth);
+
+	// Subpasses with the attachments they sample, whose images are known once the graph is compiled
+	std::vector<std::pair<PostProcessingSubpass *, std::vector<uint32_t>>> sampling;
+
+	uint32_t bloom = VK_ATTACHMENT_UNUSED;
+
+	if (effects.bloom)
+	{
+		// Blurring samples the neighbours of a pixel, so the scene color must be stored
+		auto bloom_horizontal = render_graph->add_attachment("bloom_horizontal", HDR_FORMAT);
+		bloom                 = render_graph->add_attachment("bloom", HDR_FORMAT);
+
+		auto threshold = create_subpass("post_processing/blur.frag", {"BLOOM_THRESHOLD"});
+		threshold->set_direction({1.0f, 0.0f});
+		sampling.emplace_back(threshold.get(), std::vector<uint32_t>{hdr});
+		render_graph->add_pass(std::move(threshold)).samples(hdr).writes(bloom_horizontal);
+
+		auto blur = create_subpass("post_processing/blur.frag");
+		blur->set_direction({0.0f, 1.0f});
+		sampling.emplace_back(blur.get(), std::vector<uint32_t>{bloom_horizontal});
+		render_graph->add_pass(std::move(blur)).samples(bloom_horizontal).writes(bloom);
+	}
+
+	// Without FXAA the tone mapped color goes straight to the swapchain image
+	uint32_t ldr = effects.fxaa ? render_graph->add_attachment("ldr", LDR_FORMAT) : RenderGraph::BACKBUFFER;
+
+	// Tone mapping reads the scene color of its own pixel, which stays on-tile without bloom
+	auto tonemap         = create_subpass("post_processing/tonemap.frag", effects.bloom ? std::vector<std::string>{"BLOOM"} : std::vector<std::string>{});
+	auto tonemap_subpass = tonemap.get();
+
+	auto &tonemap_pass = render_graph->add_pass(std::move(tonemap)).reads(hdr).writes(ldr);
+
+	if (effects.bloom)
+	{
+		sampling.emplace_back(tonemap_subpass, std::vector<uint32_t>{bloom});
+		tonemap_pass.samples(bloom);
+	}
+
+	if (effects.fxaa)
+	{
+		auto fxaa = create_subpass("post_processing/fxaa.frag");
+		sampling.emplace_back(fxaa.get(), std::vector<uint32_t>{ldr});
+		render_graph->add_pass(std::move(fxaa)).samples(ldr).writes(RenderGraph::BACKBUFFER);
+	}
+
+	render_graph->compile();
+
+	for (auto &entry : sampling)
+	{
+		std::vector<uint32_t> images;
+
+		for (auto attachment : entry.second)
+		{
+			images.push_back(render_graph->get_image_index(attachment));
+		}
+
+		entry.first->set_sampled_images(images);
+	}
+}
+
+void PostProcessingPipeline::prepare_compute(std::unique_ptr<Subpass> &&scene_subpass)
+{
+	// Storage images follow the scene color in the render target
+	auto add_storage_image = [this](VkFormat format) {
+		storage_formats.push_back(format);
+		return to_u32(HDR_IMAGE + storage_formats.size());
+	};
+
+	uint32_t bloom = VK_ATTACHMENT_UNUSED;
+
+	if (effects.bloom)
+	{
+		auto bloom_horizontal = add_storage_image(HDR_FORMAT);
+		bloom                 = add_storage_image(HDR_FORMAT);
+
+		compute_passes.push_back({ShaderSource{"post_processing/blur.comp"}, create_variant({"BLOOM_THRESHOLD"}), {HDR_IMAGE}, bloom_horizontal, {1.0f, 0.0f}});
+		compute_passes.push_back({ShaderSource{"post_processing/blur.comp"}, create_variant({}), {bloom_horizontal}, bloom, {0.0f, 1.0f}});
+	}
+
+	auto ldr = add_storage_image(LDR_FORMAT);
+
+	if (effects.bloom)
+	{
+		compute_passes.push_back({ShaderSource{"post_processing/tonemap.comp"}, create_variant({"BLOOM"}), {HDR_IMAGE, bloom}, ldr});
+	}
+	else
+	{
+		compute_passes.push_back({ShaderSource{"post_processing/tonemap.comp"}, create_variant({}), {HDR_IMAGE}, ldr});
+	}
+
+	uint32_t result = ldr;
+
+	if (effects.fxaa)
+	{
+		result = add_storage_image(LDR_FORMAT);
+
+		compute_passes.push_back({ShaderSource{"post_processing/fxaa.comp"}, create_variant({}), {ldr}, result});
+	}
+
+	// Build all shaders upfront
+	auto &resource_cache = render_context.get_device().get_resource_cache();
+
+	for (auto &pass : compute_passes)
+	{
+		resource_cache.request_shader_module(VK_SHADER_STAGE_COMPUTE_BIT, pass.shader, pass.variant);
+	}
+
+	const size_t image_count = HDR_IMAGE + 1 + storage_formats.size();
+
+	// The scene render pass stores the scene color only, the other images are untouched
+	{
+		scene_subpass->set_output_attachments({HDR_IMAGE});
+
+		scene_pipeline = std::make_unique<RenderPipeline>();
+		scene_pipeline->add_subpass(std::move(scene_subpass));
+
+		std::vector<LoadStoreInfo> load_store(image_count);
+
+		for (auto &ops : load_store)
+		{
+			ops.load_op          = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			ops.store_op         = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			ops.preserved_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		}
+
+		load_store[DEPTH_IMAGE] = {VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE};
+		load_store[HDR_IMAGE]   = {VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE};
+
+		std::vector<VkClearValue> clear_values(image_count);
+		clear_values[DEPTH_IMAGE].depthStencil = {0.0f, ~0U};
+		clear_values[HDR_IMAGE].color          = {{0.0f, 0.0f, 0.0f, 1.0f}};
+
+		scene_pipeline->set_load_store(load_store);
+		scene_pipeline->set_clear_value(clear_values);
+	}
+
+	// The last render pass copies the result to the swapchain image, the other images are sampled
+	{
+		auto blit = create_subpass("post_processing/blit.frag");
+		blit->set_sampled_images({result});
+
+		present_pipeline = std::make_unique<RenderPipeline>();
+		present_pipeline->add_subpass(std::move(blit));
+
+		std::vector<LoadStoreInfo> load_store(image_count);
+
+		for (auto &ops : load_store)
+		{
+			ops.load_op          = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			ops.store_op         = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			ops.preserved_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		}
+
+		load_store[0]           = {VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_STORE};
+		load_store[DEPTH_IMAGE] = {VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_DONT_CARE};
+
+		present_pipeline->set_load_store(load_store);
+		present_pipeline->set_clear_value(std::vector<VkClearValue>(image_count));
+	}
+}
+
+RenderTarget PostProcessingPipeline::create_render_target(core::Image &&swapchain_image) const
+{
+	if (render_graph)
+	{
+		return render_graph->create_render_target(std::move(swapchain_image));
+	}
+
+	assert(scene_pipeline && "Post-processing pipeline should be prepared before creating its render target");
+
+	auto &device = swapchain_image.get_device();
+	auto  extent = swapchain_image.get_extent();
+
+	std::vector<core::Image> images;
+	images.push_back(std::move(swapchain_image));
+
+	images.emplace_back(device, extent, device.get_depth_format(), VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+	images.emplace_back(device, extent, HDR_FORMAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+	// Every image of the render target is an attachment of the framebuffers
+	for (auto format : storage_formats)
+	{
+		images.emplace_back(device, extent, format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	}
+
+	return RenderTarget{std::move(images)};
+}
+
+void PostProcessingPipeline::draw(CommandBuffer &command_buffer, RenderTarget &render_target, Gui *gui)
+{
+	if (render_graph)
+	{
+		render_graph->draw(command_buffer, render_target, gui);
+	}
+	else
+	{
+		draw_compute(command_buffer, render_target, gui);
+	}
+}
+
+void PostProcessingPipeline::draw_compute(CommandBuffer &command_buffer, RenderTarget &render_target, Gui *gui)
+{
+	auto &views = render_target.get_views();
+
+	set_viewport_and_scissor(command_buffer, render_target.get_render_extent());
+
+	scene_pipeline->draw(command_buffer, render_target);
+	command_buffer.end_render_pass();
+
+	{
+		ImageMemoryBarrier barrier{};
+		barrier.old_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+
+		command_buffer.image_memory_barrier(views.at(HDR_IMAGE), barrier);
+	}
+
+	for (auto &pass : compute_passes)
+	{
+		// The previous content of the storage image is discarded
+		{
+			ImageMemoryBarrier barrier{};
+			barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.new_layout      = VK_IMAGE_LAYOUT_GENERAL;
+			barrier.src_stage_mask  = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			barrier.dst_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+
+			command_buffer.image_memory_barrier(views.at(pass.output), barrier);
+		}
+
+		dispatch(command_buffer, render_target, pass);
+
+		// Read by the next dispatches or by the blit
+		{
+			ImageMemoryBarrier barrier{};
+			barrier.old_layout      = VK_IMAGE_LAYOUT_GENERAL;
+			barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			barrier.src_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+
+			command_buffer.image_memory_barrier(views.at(pass.output), barrier);
+		}
+	}
+
+	present_pipeline->draw(command_buffer, render_target);
+
+	if (gui)
+	{
+		gui->draw(command_buffer);
+	}
+
+	command_buffer.end_render_pass();
+}
+
+void PostProcessingPipeline::dispatch(CommandBuffer &command_buffer, RenderTarget &render_target, const ComputePass &pass)
+{
+	auto &resource_cache = command_buffer.get_device().get_resource_cache();
+
+	auto &shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_COMPUTE_BIT, pass.shader, pass.variant);
+
+	std::vector<ShaderModule *> shader_modules{&shader_module};
+
+	command_buffer.bind_pipeline_layout(resource_cache.request_pipeline_layout(shader_modules, false));
+
+	auto &views = render_target.get_views();
+
+	// Storage images are bound without a sampler, like input attachments
+	command_buffer.bind_input(views.at(pass.output), 0, 0, 0);
+
+	for (uint32_t i = 0; i < pass.inputs.size(); ++i)
+	{
+		command_buffer.bind_image(views.at(pass.inputs[i]), *sampler, 0, i + 1, 0);
+	}
+
+	auto &extent = render_target.get_extent();
+
+	PostProcessingConstants constants{};
+	constants.texel_size      = {1.0f / extent.width, 1.0f / extent.height};
+	constants.direction       = pass.direction;
+	constants.exposure        = parameters.exposure;
+	constants.bloom_threshold = parameters.bloom_threshold;
+	constants.bloom_intensity = parameters.bloom_intensity;
+
+	command_buffer.push_constants(0, constants);
+
+	// Each pass is tuned on its own, as they read their inputs with different patterns
+	auto kernel = pass.shader.get_filename() + "#" + std::to_string(pass.variant.get_id());
+
+	command_buffer.get_device().get_workgroup_tuner().dispatch(command_buffer, kernel, WORKGROUP_SIZES, extent.width, extent.height);
+}
+
+PostProcessingParameters &PostProcessingPipeline::get_parameters()
+{
+	return parameters;
+}
+
+PostProcessingBackend PostProcessingPipeline::get_backend() const
+{
+	return backend;
+}
+
+const PostProcessingEffects &PostProcessingPipeline::get_effects() const
+{
+	return effects;
+}
+}        // namespace vkb
@@ -0,0 +1,169 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+#include "rendering/render_graph.h"
+#include "rendering/render_pipeline.h"
+#include "rendering/render_target.h"
+#include "rendering/subpasses/post_processing_subpass.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class Gui;
+class RenderContext;
+
+/**
+ * @brief How the post-processing effects are recorded
+ */
+enum class PostProcessingBackend
+{
+	/// Full screen triangles in render passes, tone mapping reads the scene color as an input attachment on-tile
+	Fragment,
+
+	/// Compute dispatches between the scene render pass and a final render pass, every effect goes through memory
+	Compute
+};
+
+/**
+ * @brief Effects applied between the scene and the swapchain image, tone mapping is always applied
+ */
+struct PostProcessingEffects
+{
+	bool bloom{true};
+
+	bool fxaa{true};
+};
+
+/**
+ * @brief Renders the scene to an HDR color attachment, then applies bloom, tone mapping and FXAA
+ *        before presenting. The fragment backend builds its render passes with a RenderGraph, so
+ *        that the scene color does not leave the tile memory when no effect samples it. The compute
+ *        backend writes each effect to a storage image, to compare the bandwidth of both.
+ *
+ *        Samples create the render targets with create_render_target and record the pipeline by
+ *        overriding VulkanSample::draw_renderpass.
+ */
+class PostProcessingPipeline
+{
+  public:
+	/// Format of the scene color and of the bloom
+	static const VkFormat HDR_FORMAT;
+
+	/// Format of the tone mapped color before FXAA
+	static const VkFormat LDR_FORMAT;
+
+	PostProcessingPipeline(RenderContext &render_context, PostProcessingBackend backend, const PostProcessingEffects &effects = {});
+
+	PostProcessingPipeline(const PostProcessingPipeline &) = delete;
+
+	PostProcessingPipeline(PostProcessingPipeline &&) = delete;
+
+	PostProcessingPipeline &operator=(const PostProcessingPipeline &) = delete;
+
+	PostProcessingPipeline &operator=(PostProcessingPipeline &&) = delete;
+
+	/**
+	 * @brief Builds the render passes
+	 * @param scene_subpass Subpass rendering the scene, its output attachments are set by the pipeline
+	 */
+	void prepare(std::unique_ptr<Subpass> &&scene_subpass);
+
+	/**
+	 * @brief Creates a render target with the images the pipeline needs, the pipeline must be prepared
+	 */
+	RenderTarget create_render_target(core::Image &&swapchain_image) const;
+
+	/**
+	 * @brief Records the scene and the effects, ending with the swapchain image as a color attachment
+	 * @param command_buffer Command buffer to record to
+	 * @param render_target A render target created by create_render_target
+	 * @param gui Optional gui drawn after the effects
+	 */
+	void draw(CommandBuffer &command_buffer, RenderTarget &render_target, Gui *gui = nullptr);
+
+	/**
+	 * @return The parameters of the effects, which can be changed between frames
+	 */
+	PostProcessingParameters &get_parameters();
+
+	PostProcessingBackend get_backend() const;
+
+	const PostProcessingEffects &get_effects() const;
+
+  private:
+	/**
+	 * @brief A compute effect writing one storage image of the render target
+	 */
+	struct ComputePass
+	{
+		ShaderSource shader;
+
+		ShaderVariant variant;
+
+		/// Images of the render target sampled by the shader, from binding 1
+		std::vector<uint32_t> inputs;
+
+		/// Storage image written by the shader at binding 0
+		uint32_t output;
+
+		glm::vec2 direction{0.0f, 0.0f};
+	};
+
+	void prepare_fragment(std::unique_ptr<Subpass> &&scene_subpass);
+
+	void prepare_compute(std::unique_ptr<Subpass> &&scene_subpass);
+
+	std::unique_ptr<PostProcessingSubpass> create_subpass(const std::string &fragment_shader, const std::vector<std::string> &definitions = {});
+
+	void draw_compute(CommandBuffer &command_buffer, RenderTarget &render_target, Gui *gui);
+
+	void dispatch(CommandBuffer &command_buffer, RenderTarget &render_target, const ComputePass &pass);
+
+	RenderContext &render_context;
+
+	PostProcessingBackend backend;
+
+	PostProcessingEffects effects;
+
+	PostProcessingParameters parameters;
+
+	const core::Sampler *sampler{nullptr};
+
+	/// Fragment backend
+	std::unique_ptr<RenderGraph> render_graph;
+
+	/// Compute backend, the scene before the dispatches and a blit to the swapchain image after them
+	std::unique_ptr<RenderPipeline> scene_pipeline;
+
+	std::unique_ptr<RenderPipeline> present_pipeline;
+
+	std::vector<ComputePass> compute_passes;
+
+	/// Formats of the images written by the compute passes, from image 3 of the render target
+	std::vector<VkFormat> storage_formats;
+};
+}        // namespace vkb
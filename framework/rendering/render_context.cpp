@@ -20,11 +20,37 @@
 
 #include "render_context.h"
 
+#include <algorithm>
+
+VKBP_DISABLE_WARNINGS()
+#include <glm/gtc/matrix_transform.hpp>
+VKBP_ENABLE_WARNINGS()
+
+#include "cpu_profiler.h"
+
 namespace vkb
 {
+namespace
+{
+inline bool is_rotated(VkSurfaceTransformFlagBitsKHR transform)
+{
+	return transform == VK_SURFACE_TRANSFORM_ROTATE_90_BIT_KHR || transform == VK_SURFACE_TRANSFORM_ROTATE_270_BIT_KHR;
+}
+
+/**
+ * @brief Pre-rotation always uses the native orientation, if rotated the width and height of the surface are swapped
+ */
+inline VkExtent2D get_native_extent(const VkExtent2D &extent, VkSurfaceTransformFlagBitsKHR transform)
+{
+	return is_rotated(transform) ? VkExtent2D{extent.height, extent.width} : extent;
+}
+}        // namespace
+
 RenderContext::RenderContext(Device &d, VkSurfaceKHR surface, uint32_t window_width, uint32_t window_height) :
     device{d},
-    queue{device.get_suitable_graphics_queue()}
+    queue{device.get_suitable_graphics_queue()},
+    compute_queue{device.get_async_compute_queue()},
+    frame_pacer{device}
 {
 	if (surface != VK_NULL_HANDLE)
 	{
@@ -41,10 +67,31 @@ void RenderContext::prepare(size_t thread_count, RenderTarget::CreateFunc create
 {
 	device.wait_idle();
 
-	// If swapchain exists, create our RenderFrames from the swapchain (one for each image)
+	this->thread_count              = thread_count;
+	this->create_render_target_func = create_render_target_func;
+
+	if (swapchain && pre_rotation)
+	{
+		VkSurfaceCapabilitiesKHR surface_properties;
+		VK_CHECK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device.get_physical_device(),
+		                                                   swapchain->get_surface(),
+		                                                   &surface_properties));
+
+		auto transform = select_pre_transform(surface_properties);
+
+		if (transform != swapchain->get_transform())
+		{
+			// Nothing was presented yet, the initial swapchain is replaced right away
+			swapchain = std::make_unique<Swapchain>(*swapchain, get_native_extent(surface_extent, transform), transform);
+		}
+
+		pre_transform = transform;
+	}
+
+	// If swapchain exists, create a render target for each image, handed to the RenderFrames as the images get acquired
 	if (swapchain)
 	{
-		VkExtent3D extent{surface_extent.width, surface_extent.height, 1};
+		VkExtent3D extent{swapchain->get_extent().width, swapchain->get_extent().height, 1};
 
 		for (auto &image_handle : swapchain->get_images())
 		{
@@ -54,26 +101,37 @@ void RenderContext::prepare(size_t thread_count, RenderTarget::CreateFunc create
 			    swapchain->get_format(),
 			    swapchain->get_usage()};
 			auto render_target = create_render_target_func(std::move(swapchain_image));
-			frames.emplace_back(RenderFrame{device, std::move(render_target), thread_count});
+			spare_render_targets.push_back(std::make_unique<RenderTarget>(std::move(render_target)));
 		}
+
+		image_frame_numbers.resize(spare_render_targets.size(), 0);
+
+		resize_frames(get_frame_count());
 	}
 	else
 	{
-		// Otherwise, create a single RenderFrame
-		swapchain = nullptr;
+		// Otherwise, each RenderFrame renders to an offscreen image of its own, so that frames overlap as with a swapchain
+		uint32_t frame_count = frames_in_flight == 0 ? DEFAULT_OFFSCREEN_FRAME_COUNT : frames_in_flight;
 
-		auto color_image = core::Image{device,
-		                               VkExtent3D{surface_extent.width, surface_extent.height, 1},
-		                               VK_FORMAT_R8G8B8A8_SRGB,        // We can use any format here that we like
-		                               VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-		                               VMA_MEMORY_USAGE_GPU_ONLY};
+		for (uint32_t i = 0; i < frame_count; ++i)
+		{
+			frames.emplace_back(RenderFrame{device, create_render_target_func(create_offscreen_image()), thread_count});
+		}
 
-		auto render_target = create_render_target_func(std::move(color_image));
-		frames.emplace_back(RenderFrame{device, std::move(render_target), thread_count});
+		render_frame_numbers.resize(frames.size(), 0);
 	}
 
-	this->prepared                  = true;
-	this->create_render_target_func = create_render_target_func;
+	this->prepared = true;
+}
+
+void RenderContext::set_thread_count(size_t thread_count)
+{
+	this->thread_count = thread_count;
+
+	for (auto &frame : frames)
+	{
+		frame.set_thread_count(thread_count);
+	}
 }
 
 void RenderContext::update_swapchain(const VkExtent2D &extent)
@@ -84,9 +142,7 @@ void RenderContext::update_swapchain(const VkExtent2D &extent)
 		return;
 	}
 
-	device.get_resource_cache().clear_framebuffers();
-
-	swapchain = std::make_unique<Swapchain>(*swapchain, extent);
+	retire_swapchain(std::make_unique<Swapchain>(*swapchain, extent));
 
 	recreate();
 }
@@ -99,9 +155,7 @@ void RenderContext::update_swapchain(const uint32_t image_count)
 		return;
 	}
 
-	device.get_resource_cache().clear_framebuffers();
-
-	swapchain = std::make_unique<Swapchain>(*swapchain, image_count);
+	retire_swapchain(std::make_unique<Swapchain>(*swapchain, image_count));
 
 	recreate();
 }
@@ -114,9 +168,7 @@ void RenderContext::update_swapchain(const std::set<VkImageUsageFlagBits> &image
 		return;
 	}
 
-	device.get_resource_cache().clear_framebuffers();
-
-	swapchain = std::make_unique<Swapchain>(*swapchain, image_usage_flags);
+	retire_swapchain(std::make_unique<Swapchain>(*swapchain, image_usage_flags));
 
 	recreate();
 }
@@ -129,44 +181,265 @@ void RenderContext::update_swapchain(const VkExtent2D &extent, const VkSurfaceTr
 		return;
 	}
 
-	device.get_resource_cache().clear_framebuffers();
+	retire_swapchain(std::make_unique<Swapchain>(*swapchain, get_native_extent(extent, transform), transform));
+
+	// Save the preTransform attribute for future rotations
+	pre_transform = transform;
+
+	recreate();
+}
+
+void RenderContext::set_pre_rotation(bool enable)
+{
+	pre_rotation = enable;
+}
+
+bool RenderContext::uses_pre_rotation() const
+{
+	return pre_rotation;
+}
 
-	auto width  = extent.width;
-	auto height = extent.height;
-	if (transform == VK_SURFACE_TRANSFORM_ROTATE_90_BIT_KHR || transform == VK_SURFACE_TRANSFORM_ROTATE_270_BIT_KHR)
+glm::mat4 RenderContext::get_pre_rotation() const
+{
+	glm::mat4 pre_rotate_mat = glm::mat4(1.0f);
+
+	if (!swapchain)
 	{
-		// Pre-rotation: always use native orientation i.e. if rotated, use width and height of identity transform
-		std::swap(width, height);
+		return pre_rotate_mat;
 	}
 
-	swapchain = std::make_unique<Swapchain>(*swapchain, VkExtent2D{width, height}, transform);
+	glm::vec3 rotation_axis = glm::vec3(0.0f, 0.0f, -1.0f);
+	auto      transform     = swapchain->get_transform();
 
-	// Save the preTransform attribute for future rotations
-	pre_transform = transform;
+	if (transform & VK_SURFACE_TRANSFORM_ROTATE_90_BIT_KHR)
+	{
+		pre_rotate_mat = glm::rotate(pre_rotate_mat, glm::radians(90.0f), rotation_axis);
+	}
+	else if (transform & VK_SURFACE_TRANSFORM_ROTATE_270_BIT_KHR)
+	{
+		pre_rotate_mat = glm::rotate(pre_rotate_mat, glm::radians(270.0f), rotation_axis);
+	}
+	else if (transform & VK_SURFACE_TRANSFORM_ROTATE_180_BIT_KHR)
+	{
+		pre_rotate_mat = glm::rotate(pre_rotate_mat, glm::radians(180.0f), rotation_axis);
+	}
 
-	recreate();
+	return pre_rotate_mat;
+}
+
+VkRect2D RenderContext::pre_rotate(const VkRect2D &rect) const
+{
+	if (!swapchain)
+	{
+		return rect;
+	}
+
+	// Extent of the window, the one of the swapchain images before their rotation
+	auto transform = swapchain->get_transform();
+	auto extent    = get_native_extent(swapchain->get_extent(), transform);
+
+	auto right  = std::max(static_cast<int32_t>(extent.width) - rect.offset.x - static_cast<int32_t>(rect.extent.width), 0);
+	auto bottom = std::max(static_cast<int32_t>(extent.height) - rect.offset.y - static_cast<int32_t>(rect.extent.height), 0);
+
+	VkRect2D rotated{rect};
+
+	if (transform & VK_SURFACE_TRANSFORM_ROTATE_90_BIT_KHR)
+	{
+		rotated.offset = {bottom, rect.offset.x};
+		rotated.extent = {rect.extent.height, rect.extent.width};
+	}
+	else if (transform & VK_SURFACE_TRANSFORM_ROTATE_180_BIT_KHR)
+	{
+		rotated.offset = {right, bottom};
+	}
+	else if (transform & VK_SURFACE_TRANSFORM_ROTATE_270_BIT_KHR)
+	{
+		rotated.offset = {rect.offset.y, right};
+		rotated.extent = {rect.extent.height, rect.extent.width};
+	}
+
+	return rotated;
+}
+
+VkViewport RenderContext::pre_rotate(const VkViewport &viewport) const
+{
+	if (!swapchain)
+	{
+		return viewport;
+	}
+
+	auto transform = swapchain->get_transform();
+	auto extent    = get_native_extent(swapchain->get_extent(), transform);
+
+	auto right  = static_cast<float>(extent.width) - viewport.x - viewport.width;
+	auto bottom = static_cast<float>(extent.height) - viewport.y - viewport.height;
+
+	VkViewport rotated{viewport};
+
+	if (transform & VK_SURFACE_TRANSFORM_ROTATE_90_BIT_KHR)
+	{
+		rotated.x      = bottom;
+		rotated.y      = viewport.x;
+		rotated.width  = viewport.height;
+		rotated.height = viewport.width;
+	}
+	else if (transform & VK_SURFACE_TRANSFORM_ROTATE_180_BIT_KHR)
+	{
+		rotated.x = right;
+		rotated.y = bottom;
+	}
+	else if (transform & VK_SURFACE_TRANSFORM_ROTATE_270_BIT_KHR)
+	{
+		rotated.x      = viewport.y;
+		rotated.y      = right;
+		rotated.width  = viewport.height;
+		rotated.height = viewport.width;
+	}
+
+	return rotated;
+}
+
+VkSurfaceTransformFlagBitsKHR RenderContext::select_pre_transform(const VkSurfaceCapabilitiesKHR &surface_properties) const
+{
+	switch (surface_properties.currentTransform)
+	{
+		case VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR:
+		case VK_SURFACE_TRANSFORM_ROTATE_90_BIT_KHR:
+		case VK_SURFACE_TRANSFORM_ROTATE_180_BIT_KHR:
+		case VK_SURFACE_TRANSFORM_ROTATE_270_BIT_KHR:
+			// Best practice: match the surface, so that the presentation engine does not rotate the images
+			return surface_properties.currentTransform;
+		default:
+			// Mirrored transforms are left to the presentation engine
+			return (surface_properties.supportedTransforms & VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR) ?
+			           VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR :
+			           surface_properties.currentTransform;
+	}
 }
 
 void RenderContext::recreate()
 {
+	if (!swapchain)
+	{
+		// Frames in flight may still render to the previous render targets
+		RetiredResources retired;
+		retired.frame_number = frame_number;
+
+		for (auto &frame : frames)
+		{
+			retired.render_targets.push_back(frame.exchange_render_target(std::make_unique<RenderTarget>(create_render_target_func(create_offscreen_image()))));
+		}
+
+		retired_resources.push_back(std::move(retired));
+
+		LOGI("Recreated offscreen render targets");
+		return;
+	}
+
 	LOGI("Recreated swapchain");
 
 	VkExtent2D swapchain_extent = swapchain->get_extent();
 	VkExtent3D extent{swapchain_extent.width, swapchain_extent.height, 1};
 
-	auto frame_it = frames.begin();
+	const auto &images = swapchain->get_images();
+
+	// There cannot be more frames than images
+	resize_frames(std::min(frames.size(), images.size()));
+
+	// Frames in flight may still render to the previous render targets
+	RetiredResources retired;
+	retired.frame_number = frame_number;
+
+	for (size_t image_index = images.size(); image_index < spare_render_targets.size(); ++image_index)
+	{
+		if (spare_render_targets[image_index])
+		{
+			retired.render_targets.push_back(std::move(spare_render_targets[image_index]));
+		}
+	}
+
+	spare_render_targets.resize(images.size());
+
+	// The attachments of the new render targets are not used by any frame yet
+	image_frame_numbers.assign(images.size(), 0);
+
+	// Frames holding the render target of an image which no longer exists take over a free image
+	for (auto &image_index : frame_image_indices)
+	{
+		if (image_index < images.size())
+		{
+			continue;
+		}
+
+		for (uint32_t free_index = 0; free_index < images.size(); ++free_index)
+		{
+			if (std::find(frame_image_indices.begin(), frame_image_indices.end(), free_index) == frame_image_indices.end())
+			{
+				// The render target of the frame is recreated for the free image below
+				if (spare_render_targets[free_index])
+				{
+					retired.render_targets.push_back(std::move(spare_render_targets[free_index]));
+				}
+				image_index = free_index;
+				break;
+			}
+		}
+	}
 
-	for (auto &image_handle : swapchain->get_images())
+	for (uint32_t image_index = 0; image_index < images.size(); ++image_index)
 	{
-		core::Image swapchain_image{device, image_handle,
+		core::Image swapchain_image{device, images[image_index],
 		                            extent,
 		                            swapchain->get_format(),
 		                            swapchain->get_usage()};
 
-		auto render_target = create_render_target_func(std::move(swapchain_image));
-		frame_it->update_render_target(std::move(render_target));
+		auto render_target = std::make_unique<RenderTarget>(create_render_target_func(std::move(swapchain_image)));
+
+		// Render targets are exchanged rather than move assigned, which would rewrite descriptor sets still in use
+		auto frame_it = std::find(frame_image_indices.begin(), frame_image_indices.end(), image_index);
+
+		if (frame_it != frame_image_indices.end())
+		{
+			render_target = frames[std::distance(frame_image_indices.begin(), frame_it)].exchange_render_target(std::move(render_target));
+		}
+		else
+		{
+			std::swap(spare_render_targets[image_index], render_target);
+		}
 
-		++frame_it;
+		if (render_target)
+		{
+			retired.render_targets.push_back(std::move(render_target));
+		}
+	}
+
+	retired_resources.push_back(std::move(retired));
+
+	resize_frames(get_frame_count());
+}
+
+void RenderContext::retire_swapchain(std::unique_ptr<Swapchain> &&new_swapchain)
+{
+	RetiredResources retired;
+	retired.frame_number = frame_number;
+
+	// The old swapchain was passed as oldSwapchain, its images may still be presented
+	retired.swapchain = std::move(swapchain);
+	swapchain         = std::move(new_swapchain);
+
+	retired_resources.push_back(std::move(retired));
+}
+
+void RenderContext::release_retired_resources()
+{
+	// Descriptor sets are dropped by a frame after two resets without being requested
+	while (!retired_resources.empty() &&
+	       retired_resources.front().frame_number <= completed_frame_number &&
+	       retired_resources.front().frame_number + 2 * frames.size() < frame_number)
+	{
+		device.get_resource_cache().evict_unused_since(retired_resources.front().frame_number);
+
+		retired_resources.pop_front();
 	}
 }
 
@@ -175,6 +448,12 @@ bool RenderContext::has_swapchain()
 	return swapchain != nullptr;
 }
 
+VkImageLayout RenderContext::get_present_layout() const
+{
+	// Without a swapchain the presentation engine is never involved, VK_KHR_swapchain may not even be enabled
+	return swapchain ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+}
+
 void RenderContext::handle_surface_changes()
 {
 	if (!swapchain)
@@ -188,13 +467,15 @@ void RenderContext::handle_surface_changes()
 	                                                   swapchain->get_surface(),
 	                                                   &surface_properties));
 
+	auto transform = pre_rotation ? select_pre_transform(surface_properties) : pre_transform;
+
+	// 180 degree rotations do not change the extent, only the transform of the surface
 	if (surface_properties.currentExtent.width != surface_extent.width ||
-	    surface_properties.currentExtent.height != surface_extent.height)
+	    surface_properties.currentExtent.height != surface_extent.height ||
+	    (pre_rotation && transform != swapchain->get_transform()))
 	{
-		// Recreate swapchain
-		device.wait_idle();
-
-		update_swapchain(surface_properties.currentExtent, pre_transform);
+		// The swapchain is recreated without waiting for the device, frames in flight keep the old resources alive
+		update_swapchain(surface_properties.currentExtent, transform);
 
 		surface_extent = surface_properties.currentExtent;
 	}
@@ -219,6 +500,11 @@ void RenderContext::submit(CommandBuffer &command_buffer)
 {
 	assert(frame_active && "RenderContext is inactive, cannot submit command buffer. Please call begin()");
 
+	if (swapchain && !image_acquired)
+	{
+		acquire_swapchain_image();
+	}
+
 	VkSemaphore render_semaphore = VK_NULL_HANDLE;
 
 	if (swapchain)
@@ -245,82 +531,587 @@ VkSemaphore RenderContext::begin_frame()
 
 	assert(!frame_active && "Frame is still active, please call end_frame");
 
-	auto &prev_frame = frames.at(active_frame_index);
+	// Start the frame as late as possible, to minimise latency
+	frame_pacer.wait();
 
-	auto aquired_semaphore = prev_frame.request_semaphore();
+	// Frames are used in turn, independently of the swapchain image they render to
+	active_frame_index = (active_frame_index + 1) % to_u32(frames.size());
 
-	if (swapchain)
-	{
-		auto fence = prev_frame.request_fence();
+	// Now the frame is active again
+	frame_active = true;
 
-		auto result = swapchain->acquire_next_image(active_frame_index, aquired_semaphore, fence);
+	wait_frame();
 
-		if (result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR)
-		{
-			handle_surface_changes();
+	auto &frame = get_active_frame();
 
-			result = swapchain->acquire_next_image(active_frame_index, aquired_semaphore, fence);
-		}
+	auto aquired_semaphore = frame.request_semaphore();
+
+	image_acquired = false;
 
-		if (result != VK_SUCCESS)
+	if (swapchain && !late_swapchain_acquire)
+	{
+		if (acquire_next_image(aquired_semaphore) != VK_SUCCESS)
 		{
-			prev_frame.reset();
+			frame.reset();
+
+			frame_active = false;
 
 			return VK_NULL_HANDLE;
 		}
 	}
 
-	// Now the frame is active again
-	frame_active = true;
+	// The previous work of this frame is done, and the queue completes work in order
+	render_frame_numbers.resize(frames.size(), 0);
+	completed_frame_number = std::max(completed_frame_number, render_frame_numbers[active_frame_index]);
 
-	wait_frame();
+	if (uses_timeline_semaphores())
+	{
+		// Timeline values tell exactly which of the other frames are done as well
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			if (render_frame_numbers[i] > completed_frame_number && frames[i].is_complete())
+			{
+				completed_frame_number = render_frame_numbers[i];
+			}
+		}
+	}
+
+	render_frame_numbers[active_frame_index] = ++frame_number;
+
+	release_retired_resources();
+
+	if (image_acquired)
+	{
+		bind_swapchain_image();
+	}
+	else
+	{
+		update_render_extent();
+	}
+
+	device.get_resource_cache().begin_frame(frame_number, completed_frame_number);
+
+	device.get_deletion_queue().begin_frame(frame_number, completed_frame_number);
+
+	device.update_memory_budget(frame_number);
+
+	// Waited by the submissions once the image is acquired, possibly later in the frame
+	acquired_semaphore = aquired_semaphore;
 
 	return aquired_semaphore;
 }
 
-VkSemaphore RenderContext::submit(const Queue &queue, const CommandBuffer &command_buffer, VkSemaphore wait_semaphore, VkPipelineStageFlags wait_pipeline_stage)
+void RenderContext::set_late_swapchain_acquire(bool enable)
 {
-	RenderFrame &frame = get_active_frame();
+	assert(!frame_active && "The swapchain acquisition should not be changed while a frame is active");
+
+	late_swapchain_acquire = enable;
+}
 
-	VkSemaphore signal_semaphore = frame.request_semaphore();
+bool RenderContext::uses_late_swapchain_acquire() const
+{
+	return late_swapchain_acquire;
+}
+
+bool RenderContext::is_swapchain_image_acquired() const
+{
+	return image_acquired;
+}
 
-	VkCommandBuffer cmd_buf = command_buffer.get_handle();
+void RenderContext::acquire_swapchain_image()
+{
+	assert(frame_active && "RenderContext is inactive, cannot acquire a swapchain image. Please call begin()");
 
-	VkSubmitInfo submit_info{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+	if (!swapchain || image_acquired)
+	{
+		return;
+	}
 
-	submit_info.commandBufferCount   = 1;
-	submit_info.pCommandBuffers      = &cmd_buf;
-	submit_info.waitSemaphoreCount   = 1;
-	submit_info.pWaitSemaphores      = &wait_semaphore;
-	submit_info.pWaitDstStageMask    = &wait_pipeline_stage;
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores    = &signal_semaphore;
+	// The offscreen work recorded so far starts while the presentation engine holds the images
+	flush_submissions();
 
-	VkFence fence = frame.request_fence();
+	if (acquire_next_image(acquired_semaphore) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Couldn't acquire the swapchain image");
+	}
 
-	queue.submit({submit_info}, fence);
+	bind_swapchain_image();
+}
+
+VkResult RenderContext::acquire_next_image(VkSemaphore semaphore)
+{
+	// The acquired semaphore is waited by the submission, which is tracked by the timeline
+	VkFence fence = uses_timeline_semaphores() ? VK_NULL_HANDLE : get_active_frame().request_fence();
+
+	auto result = swapchain->acquire_next_image(active_image_index, semaphore, fence);
+
+	if (result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		handle_surface_changes();
+
+		result = swapchain->acquire_next_image(active_image_index, semaphore, fence);
+	}
+
+	image_acquired = result == VK_SUCCESS;
+
+	return result;
+}
+
+void RenderContext::bind_swapchain_image()
+{
+	acquire_render_target(active_image_index);
+
+	image_frame_numbers[active_image_index] = frame_number;
+
+	update_render_extent();
+}
+
+void RenderContext::update_render_extent()
+{
+	auto &render_target = get_active_frame().get_render_target();
+	auto &extent        = render_target.get_extent();
+
+	render_target.set_render_extent({static_cast<uint32_t>(extent.width * render_scale),
+	                                 static_cast<uint32_t>(extent.height * render_scale)});
+}
+
+VkSemaphore RenderContext::submit(const Queue &queue, const CommandBuffer &command_buffer, VkSemaphore wait_semaphore, VkPipelineStageFlags wait_pipeline_stage)
+{
+	VkSemaphore signal_semaphore = get_active_frame().request_semaphore();
+
+	add_submission(queue, command_buffer.get_handle(), wait_semaphore, wait_pipeline_stage, signal_semaphore);
 
 	return signal_semaphore;
 }
 
 void RenderContext::submit(const Queue &queue, const CommandBuffer &command_buffer)
 {
-	RenderFrame &frame = get_active_frame();
+	add_submission(queue, command_buffer.get_handle(), VK_NULL_HANDLE, 0, VK_NULL_HANDLE);
+}
+
+void RenderContext::submit_compute(const CommandBuffer &command_buffer, VkPipelineStageFlags wait_pipeline_stage)
+{
+	if (!has_async_compute())
+	{
+		// The submission order of the queue already orders the barriers of the command buffers
+		submit(compute_queue, command_buffer);
+		return;
+	}
+
+	VkSemaphore signal_semaphore = get_active_frame().request_semaphore();
+
+	add_submission(compute_queue, command_buffer.get_handle(), VK_NULL_HANDLE, 0, signal_semaphore);
+
+	queue_waits.push_back({compute_queue.get_handle(), signal_semaphore, wait_pipeline_stage});
+}
+
+void RenderContext::record_async(CommandBuffer &command_buffer, JobSystem &job_system, std::function<void(CommandBuffer &, size_t)> &&record)
+{
+	assert(frame_active && "RenderContext is inactive, cannot record command buffer. Please call begin()");
+	assert((!async_job_system || async_job_system == &job_system) && "The parts of a frame are recorded by one job system");
+
+	auto &head = command_buffer.split();
+
+	// The commands recorded so far may transition the swapchain image, so they wait for it. The submission of the frame
+	// then joins them, as its command buffer follows without semaphores in between
+	if (swapchain && image_acquired && acquired_semaphore != VK_NULL_HANDLE)
+	{
+		add_submission(queue, head.get_handle(), acquired_semaphore, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_NULL_HANDLE);
+
+		acquired_semaphore = VK_NULL_HANDLE;
+	}
+	else
+	{
+		add_submission(queue, head.get_handle(), VK_NULL_HANDLE, 0, VK_NULL_HANDLE);
+	}
 
-	VkCommandBuffer cmd_buf = command_buffer.get_handle();
+	// The part takes its place among the submissions now, its command buffer is filled in once recorded
+	pending_submissions.back().command_buffers.push_back(VK_NULL_HANDLE);
 
-	VkSubmitInfo submit_info{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+	async_command_buffers.push_back(VK_NULL_HANDLE);
 
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers    = &cmd_buf;
+	auto &recorded_command_buffer = async_command_buffers.back();
 
-	VkFence fence = frame.request_fence();
+	auto record_part = [this, &recorded_command_buffer, record = std::move(record)](size_t thread_index) {
+		auto &part_command_buffer = get_active_frame().request_command_buffer(queue, CommandBuffer::ResetMode::ResetPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, thread_index);
 
-	queue.submit({submit_info}, fence);
+		part_command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+		// The profilers of the frame are only used by the thread driving it
+		part_command_buffer.set_profiled(false);
+
+		record(part_command_buffer, thread_index);
+
+		part_command_buffer.end();
+
+		recorded_command_buffer = part_command_buffer.get_handle();
+	};
+
+	// Jobs allocate from the frame resources of the thread running them
+	if (get_active_frame().get_thread_count() < job_system.get_thread_count())
+	{
+		record_part(0);
+		return;
+	}
+
+	async_job_system = &job_system;
+
+	job_system.run(std::move(record_part), async_counter.get());
+}
+
+void RenderContext::wait_async_recordings()
+{
+	if (async_command_buffers.empty())
+	{
+		return;
+	}
+
+	std::exception_ptr exception;
+
+	if (async_job_system)
+	{
+		try
+		{
+			async_job_system->wait(*async_counter);
+		}
+		catch (...)
+		{
+			exception = std::current_exception();
+		}
+
+		async_job_system = nullptr;
+	}
+
+	// The null handles of the pending submissions stand for the parts in order, the parts which failed are left out
+	auto async_command_buffer = async_command_buffers.begin();
+
+	for (auto &submission : pending_submissions)
+	{
+		for (auto &command_buffer : submission.command_buffers)
+		{
+			if (command_buffer == VK_NULL_HANDLE)
+			{
+				command_buffer = *async_command_buffer++;
+			}
+		}
+
+		submission.command_buffers.erase(std::remove(submission.command_buffers.begin(), submission.command_buffers.end(), VK_NULL_HANDLE),
+		                                  submission.command_buffers.end());
+	}
+
+	async_command_buffers.clear();
+
+	if (exception)
+	{
+		std::rethrow_exception(exception);
+	}
+}
+
+void RenderContext::add_submission(const Queue &queue, VkCommandBuffer command_buffer, VkSemaphore wait_semaphore, VkPipelineStageFlags wait_pipeline_stage, VkSemaphore signal_semaphore)
+{
+	assert(frame_active && "RenderContext is inactive, cannot submit command buffer. Please call begin()");
+
+	// Semaphores signaled by the batch of another queue may be waited by this submission
+	if (pending_queue && pending_queue->get_handle() != queue.get_handle())
+	{
+		flush_submissions();
+	}
+
+	pending_queue = &queue;
+
+	// Work submitted to other queues is waited by the first submission to this one
+	auto other_queue_wait = std::partition(queue_waits.begin(), queue_waits.end(), [&queue](const QueueWait &queue_wait) {
+		return queue_wait.signal_queue == queue.get_handle();
+	});
+
+	bool has_queue_waits = other_queue_wait != queue_waits.end();
+
+	// Command buffers of a submit info execute in order, so a submission without semaphores joins the previous one
+	bool merge = !pending_submissions.empty() && pending_submissions.back().signal_semaphores.empty() && wait_semaphore == VK_NULL_HANDLE && !has_queue_waits;
+
+	if (!merge)
+	{
+		pending_submissions.emplace_back();
+	}
+
+	auto &submission = pending_submissions.back();
+
+	if (command_buffer != VK_NULL_HANDLE)
+	{
+		submission.command_buffers.push_back(command_buffer);
+	}
+
+	if (wait_semaphore != VK_NULL_HANDLE)
+	{
+		submission.wait_semaphores.push_back(wait_semaphore);
+		submission.wait_stages.push_back(wait_pipeline_stage);
+	}
+
+	for (auto it = other_queue_wait; it != queue_waits.end(); ++it)
+	{
+		submission.wait_semaphores.push_back(it->semaphore);
+		submission.wait_stages.push_back(it->wait_stage);
+	}
+
+	queue_waits.erase(other_queue_wait, queue_waits.end());
+
+	if (signal_semaphore != VK_NULL_HANDLE)
+	{
+		submission.signal_semaphores.push_back(signal_semaphore);
+	}
+}
+
+void RenderContext::flush_submissions()
+{
+	wait_async_recordings();
+
+	if (pending_submissions.empty())
+	{
+		return;
+	}
+
+	std::vector<VkSubmitInfo> submit_infos;
+	submit_infos.reserve(pending_submissions.size());
+
+	for (auto &submission : pending_submissions)
+	{
+		VkSubmitInfo submit_info{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+
+		submit_info.commandBufferCount   = to_u32(submission.command_buffers.size());
+		submit_info.pCommandBuffers      = submission.command_buffers.data();
+		submit_info.waitSemaphoreCount   = to_u32(submission.wait_semaphores.size());
+		submit_info.pWaitSemaphores      = submission.wait_semaphores.data();
+		submit_info.pWaitDstStageMask    = submission.wait_stages.data();
+		submit_info.signalSemaphoreCount = to_u32(submission.signal_semaphores.size());
+		submit_info.pSignalSemaphores    = submission.signal_semaphores.data();
+
+		submit_infos.push_back(submit_info);
+	}
+
+	if (uses_timeline_semaphores())
+	{
+		// The last submission signals the timeline, binary semaphores are still needed by the presentation engine
+		auto &last_submission = pending_submissions.back();
+
+		std::vector<VkSemaphore> signal_semaphores{last_submission.signal_semaphores};
+		std::vector<uint64_t>    signal_values(signal_semaphores.size(), 0);
+
+		VkTimelineSemaphoreSubmitInfoKHR timeline_info{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR};
+
+		// A value is ignored for binary wait semaphores
+		std::vector<uint64_t> wait_values(last_submission.wait_semaphores.size(), 0);
+
+		timeline_info.waitSemaphoreValueCount = to_u32(wait_values.size());
+		timeline_info.pWaitSemaphoreValues    = wait_values.data();
+
+		signal_timeline(*pending_queue, submit_infos.back(), timeline_info, signal_semaphores, signal_values);
+
+		pending_queue->submit(submit_infos, VK_NULL_HANDLE);
+	}
+	else
+	{
+		VkFence fence = get_active_frame().request_fence();
+
+		pending_queue->submit(submit_infos, fence);
+	}
+
+	// The GPU scopes of the frame are placed on the CPU timeline from its first submission
+	get_active_frame().get_gpu_profiler().mark_submitted();
+
+	pending_submissions.clear();
+	pending_queue = nullptr;
+}
+
+void RenderContext::signal_timeline(const Queue &queue, VkSubmitInfo &submit_info, VkTimelineSemaphoreSubmitInfoKHR &timeline_info,
+                                    std::vector<VkSemaphore> &signal_semaphores, std::vector<uint64_t> &signal_values)
+{
+	auto &timeline = timelines[queue.get_handle()];
+
+	if (!timeline)
+	{
+		timeline = std::make_unique<TimelineSemaphore>(device);
+	}
+
+	uint64_t value = timeline->request_signal_value();
+
+	signal_semaphores.push_back(timeline->get_handle());
+	signal_values.push_back(value);
+
+	timeline_info.signalSemaphoreValueCount = to_u32(signal_values.size());
+	timeline_info.pSignalSemaphoreValues    = signal_values.data();
+
+	submit_info.pNext                = &timeline_info;
+	submit_info.signalSemaphoreCount = to_u32(signal_semaphores.size());
+	submit_info.pSignalSemaphores    = signal_semaphores.data();
+
+	get_active_frame().add_timeline_signal(*timeline, value);
+}
+
+void RenderContext::set_timeline_semaphores(bool enable)
+{
+	// Frames wait for both their fences and timeline values, so switching between frames is safe
+	assert(!frame_active && "Timeline semaphores should not be switched while a frame is active");
+
+	timeline_semaphores = enable;
+}
+
+bool RenderContext::uses_timeline_semaphores() const
+{
+	return timeline_semaphores && device.is_enabled(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+}
+
+uint64_t RenderContext::get_completed_frame_number() const
+{
+	return completed_frame_number;
+}
+
+uint64_t RenderContext::get_frame_number() const
+{
+	return frame_number;
+}
+
+void RenderContext::set_render_scale(float scale)
+{
+	assert(scale > 0.0f && scale <= 1.0f && "Render scale should be in (0, 1]");
+
+	render_scale = scale;
+}
+
+float RenderContext::get_render_scale() const
+{
+	return render_scale;
+}
+
+void RenderContext::set_render_target_create_func(RenderTarget::CreateFunc create_func)
+{
+	create_render_target_func = std::move(create_func);
+}
+
+const RenderTarget::CreateFunc &RenderContext::get_render_target_create_func() const
+{
+	return create_render_target_func;
+}
+
+FramePacer &RenderContext::get_frame_pacer()
+{
+	return frame_pacer;
+}
+
+void RenderContext::set_frames_in_flight(uint32_t count)
+{
+	assert(!frame_active && "The frames in flight should not be changed while a frame is active");
+
+	frames_in_flight = count;
+
+	if (prepared && swapchain)
+	{
+		resize_frames(get_frame_count());
+	}
+}
+
+uint32_t RenderContext::get_frames_in_flight() const
+{
+	return to_u32(frames.size());
+}
+
+size_t RenderContext::get_frame_count() const
+{
+	size_t image_count = swapchain->get_images().size();
+
+	return frames_in_flight == 0 ? image_count : std::min<size_t>(frames_in_flight, image_count);
+}
+
+void RenderContext::resize_frames(size_t frame_count)
+{
+	while (frames.size() > frame_count)
+	{
+		// The render target goes back to the spares before the frame is destroyed
+		spare_render_targets[frame_image_indices.back()] = frames.back().exchange_render_target(nullptr);
+
+		// Its command buffers and semaphores may still be in flight
+		device.get_deletion_queue().release(std::move(frames.back()));
+
+		frames.pop_back();
+		frame_image_indices.pop_back();
+	}
+
+	while (frames.size() < frame_count)
+	{
+		auto spare_it = std::find_if(spare_render_targets.begin(), spare_render_targets.end(),
+		                             [](const std::unique_ptr<RenderTarget> &render_target) { return render_target != nullptr; });
+
+		assert(spare_it != spare_render_targets.end() && "There cannot be more frames than swapchain images");
+
+		frames.emplace_back(RenderFrame{device, std::move(**spare_it), thread_count});
+		frame_image_indices.push_back(to_u32(std::distance(spare_render_targets.begin(), spare_it)));
+
+		spare_it->reset();
+	}
+
+	render_frame_numbers.resize(frames.size(), 0);
+
+	if (active_frame_index >= frames.size())
+	{
+		active_frame_index = 0;
+	}
+}
+
+core::Image RenderContext::create_offscreen_image()
+{
+	return core::Image{device,
+	                   VkExtent3D{surface_extent.width, surface_extent.height, 1},
+	                   VK_FORMAT_R8G8B8A8_SRGB,        // We can use any format here that we like
+	                   VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+	                   VMA_MEMORY_USAGE_GPU_ONLY};
+}
+
+void RenderContext::acquire_render_target(uint32_t image_index)
+{
+	auto &frame_image_index = frame_image_indices[active_frame_index];
+
+	if (frame_image_index == image_index)
+	{
+		return;
+	}
+
+	// Only the swapchain image is synchronized with the acquire semaphore, the other attachments
+	// may still be in use by the frame which last rendered to the image
+	if (image_frame_numbers[image_index] > completed_frame_number)
+	{
+		auto number_it = std::find(render_frame_numbers.begin(), render_frame_numbers.end(), image_frame_numbers[image_index]);
+
+		if (number_it != render_frame_numbers.end())
+		{
+			VK_CHECK(frames[std::distance(render_frame_numbers.begin(), number_it)].wait());
+		}
+	}
+
+	auto &frame     = frames[active_frame_index];
+	auto  holder_it = std::find(frame_image_indices.begin(), frame_image_indices.end(), image_index);
+
+	if (holder_it != frame_image_indices.end())
+	{
+		// Swap render targets with the frame holding the image
+		auto &holder        = frames[std::distance(frame_image_indices.begin(), holder_it)];
+		auto  render_target = holder.exchange_render_target(nullptr);
+
+		holder.exchange_render_target(frame.exchange_render_target(std::move(render_target)));
+
+		std::swap(*holder_it, frame_image_index);
+	}
+	else
+	{
+		spare_render_targets[frame_image_index] = frame.exchange_render_target(std::move(spare_render_targets[image_index]));
+
+		frame_image_index = image_index;
+	}
 }
 
 void RenderContext::wait_frame()
 {
+	// Covers the wait for the fences of the frame, usually the longest stall of the CPU
+	VKB_PROFILE_FUNCTION();
+
 	RenderFrame &frame = get_active_frame();
 	frame.reset();
 }
@@ -329,7 +1120,16 @@ void RenderContext::end_frame(VkSemaphore semaphore)
 {
 	assert(frame_active && "Frame is not active, please call begin_frame");
 
-	if (swapchain)
+	// Semaphores of the frame are reused once it completes, so every signaled one must be waited
+	if (!queue_waits.empty())
+	{
+		add_submission(queue, VK_NULL_HANDLE, VK_NULL_HANDLE, 0, VK_NULL_HANDLE);
+	}
+
+	// The semaphore presentation waits for must be signaled by work already submitted
+	flush_submissions();
+
+	if (swapchain && image_acquired)
 	{
 		VkSwapchainKHR vk_swapchain = swapchain->get_handle();
 
@@ -339,20 +1139,97 @@ void RenderContext::end_frame(VkSemaphore semaphore)
 		present_info.pWaitSemaphores    = &semaphore;
 		present_info.swapchainCount     = 1;
 		present_info.pSwapchains        = &vk_swapchain;
-		present_info.pImageIndices      = &active_frame_index;
+		present_info.pImageIndices      = &active_image_index;
+
+		VkPresentRegionKHR  present_region{};
+		VkPresentRegionsKHR present_regions_info{VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR};
+
+		if (supports_incremental_present() && !present_regions.empty())
+		{
+			present_region.rectangleCount = to_u32(present_regions.size());
+			present_region.pRectangles    = present_regions.data();
+
+			present_regions_info.pNext          = present_info.pNext;
+			present_regions_info.swapchainCount = 1;
+			present_regions_info.pRegions       = &present_region;
+
+			present_info.pNext = &present_regions_info;
+		}
+
+		frame_pacer.begin_present(*swapchain, present_info);
 
 		VkResult result = queue.present(present_info);
 
+		frame_pacer.end_present(*swapchain);
+
 		if (result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR)
 		{
 			handle_surface_changes();
 		}
 	}
 
+	present_regions.clear();
+
+	lint_frame();
+
 	// Frame is not active anymore
 	frame_active = false;
 }
 
+void RenderContext::lint_frame()
+{
+	auto &perf_lint = device.get_perf_lint();
+
+	if (!perf_lint.is_enabled())
+	{
+		return;
+	}
+
+	// Each frame finds its sets in its cache after its first use, unless their resources keep changing
+	if (get_active_frame().get_descriptor_counters().allocations > 0)
+	{
+		if (++descriptor_allocation_frames > 2 * frames.size())
+		{
+			perf_lint.report(PerfIssue::DescriptorSetAllocation, "RenderFrame");
+		}
+	}
+	else
+	{
+		descriptor_allocation_frames = 0;
+	}
+
+	perf_lint.end_frame();
+}
+
+bool RenderContext::supports_incremental_present() const
+{
+	return swapchain && device.is_enabled(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+}
+
+void RenderContext::add_present_region(const VkRect2D &rect)
+{
+	assert(frame_active && "Frame is not active, please call begin_frame");
+
+	if (!supports_incremental_present())
+	{
+		return;
+	}
+
+	// The rectangle must fit the window once transformed by the presentation engine
+	auto extent = get_native_extent(swapchain->get_extent(), swapchain->get_transform());
+
+	VkRectLayerKHR region{};
+	region.offset.x      = std::min(std::max(rect.offset.x, 0), static_cast<int32_t>(extent.width));
+	region.offset.y      = std::min(std::max(rect.offset.y, 0), static_cast<int32_t>(extent.height));
+	region.extent.width  = std::min(rect.extent.width, extent.width - static_cast<uint32_t>(region.offset.x));
+	region.extent.height = std::min(rect.extent.height, extent.height - static_cast<uint32_t>(region.offset.y));
+
+	if (region.extent.width > 0 && region.extent.height > 0)
+	{
+		present_regions.push_back(region);
+	}
+}
+
 RenderFrame &RenderContext::get_active_frame()
 {
 	assert(frame_active && "Frame is not active, please call begin_frame");
@@ -382,6 +1259,21 @@ Device &RenderContext::get_device()
 	return device;
 }
 
+const Queue &RenderContext::get_queue() const
+{
+	return queue;
+}
+
+const Queue &RenderContext::get_compute_queue() const
+{
+	return compute_queue;
+}
+
+bool RenderContext::has_async_compute() const
+{
+	return compute_queue.get_handle() != queue.get_handle();
+}
+
 Swapchain &RenderContext::get_swapchain()
 {
 	assert(swapchain && "Swapchain is not valid");
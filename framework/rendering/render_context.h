@@ -20,6 +20,9 @@
 
 #pragma once
 
+#include <deque>
+
+#include "common/error.h"
 #include "common/helpers.h"
 #include "common/vk_common.h"
 #include "core/command_buffer.h"
@@ -33,10 +36,17 @@
 #include "core/render_pass.h"
 #include "core/shader_module.h"
 #include "core/swapchain.h"
+#include "job_system.h"
+#include "rendering/frame_pacer.h"
 #include "rendering/pipeline_state.h"
 #include "rendering/render_frame.h"
 #include "rendering/render_target.h"
 #include "resource_cache.h"
+#include "timeline_semaphore.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
 
 namespace vkb
 {
@@ -50,14 +60,20 @@ namespace vkb
  * It requires a Device to be valid on creation, and will take control of a given Swapchain.
  *
  * For normal rendering (using a swapchain), the RenderContext can be created by passing in a
- * swapchain. A RenderFrame will then be created for each Swapchain image.
+ * swapchain. A RenderFrame will then be created for each Swapchain image, unless a lower number
+ * of frames in flight is set. Frames are used in turn, and take over the render target of
+ * whichever Swapchain image gets acquired.
  *
  * For headless rendering (no swapchain), the RenderContext can be given a valid Device, and
- * a width and height. A single RenderFrame will then be created.
+ * a width and height. RenderFrames then render to offscreen images of their own, and nothing
+ * is presented, so frames are only limited by the GPU.
  */
 class RenderContext
 {
   public:
+	/// Number of frames rendering offscreen without a swapchain, unless a number of frames in flight is set
+	static const uint32_t DEFAULT_OFFSCREEN_FRAME_COUNT = 3;
+
 	/**
 	 * @brief Constructor
 	 * @param device A valid device
@@ -83,6 +99,13 @@ class RenderContext
 	 */
 	void prepare(size_t thread_count = 1, RenderTarget::CreateFunc create_render_target_func = RenderTarget::DEFAULT_CREATE_FUNC);
 
+	/**
+	 * @brief Changes the number of threads which may record into the RenderFrames, without recreating their resources.
+	 *        It should be called between frames, while no thread is recording
+	 * @param thread_count The new number of threads
+	 */
+	void set_thread_count(size_t thread_count);
+
 	/**
 	 * @brief Updates the swapchains extent, if a swapchain exists
 	 * @param extent The width and height of the new swapchain images
@@ -109,7 +132,38 @@ class RenderContext
 	void update_swapchain(const VkExtent2D &extent, const VkSurfaceTransformFlagBitsKHR transform);
 
 	/**
-	 * @brief Recreates the RenderFrames, called after every update
+	 * @brief Enables the pre-rotation of the frames, on by default. The swapchain then follows the transform of the surface,
+	 *        so that the presentation engine does not have to rotate the images, and the application renders them rotated
+	 *        with get_pre_rotation. Otherwise the swapchain keeps the transform last given to update_swapchain
+	 * @param enable Whether the swapchain follows the surface transform
+	 */
+	void set_pre_rotation(bool enable);
+
+	bool uses_pre_rotation() const;
+
+	/**
+	 * @return The rotation to apply in view space to render in the orientation of the swapchain images,
+	 *         identity if they are not rotated
+	 */
+	glm::mat4 get_pre_rotation() const;
+
+	/**
+	 * @brief Rotates a scissor from the window coordinates to those of the swapchain images
+	 * @param rect A rectangle in the window, whose extent is the one of the swapchain before its rotation
+	 * @return The rectangle covering the same pixels in the swapchain images
+	 */
+	VkRect2D pre_rotate(const VkRect2D &rect) const;
+
+	/**
+	 * @brief Rotates a viewport from the window coordinates to those of the swapchain images
+	 * @param viewport A viewport in the window, whose extent is the one of the swapchain before its rotation
+	 * @return The viewport covering the same pixels in the swapchain images
+	 */
+	VkViewport pre_rotate(const VkViewport &viewport) const;
+
+	/**
+	 * @brief Recreates the render targets of the RenderFrames, called after every update. The previous
+	 *        render targets are retired until the frames which may still use them have completed
 	 */
 	void recreate();
 
@@ -118,6 +172,12 @@ class RenderContext
 	 */
 	bool has_swapchain();
 
+	/**
+	 * @return The layout the image rendered by a frame must be in at the end of the frame, for presentation,
+	 *         or for a copy by a readback when the frames render offscreen
+	 */
+	VkImageLayout get_present_layout() const;
+
 	/**
 	 * @brief Prepares the next available frame for rendering
 	 * @param reset_mode How to reset the command buffer
@@ -138,13 +198,49 @@ class RenderContext
 	 */
 	VkSemaphore begin_frame();
 
+	/**
+	 * @brief Adds a command buffer related to a frame to the submissions batched for a queue
+	 * @param queue The queue to submit to
+	 * @param command_buffer The command buffer to submit
+	 * @param wait_semaphore Semaphore waited before the command buffer executes
+	 * @param wait_pipeline_stage Stage which waits for the semaphore
+	 * @return A semaphore signaled once the command buffer completes, valid for the active frame
+	 */
 	VkSemaphore submit(const Queue &queue, const CommandBuffer &command_buffer, VkSemaphore wait_semaphore, VkPipelineStageFlags wait_pipeline_stage);
 
 	/**
-	 * @brief Submits a command buffer related to a frame to a queue
+	 * @brief Adds a command buffer related to a frame to the submissions batched for a queue
 	 */
 	void submit(const Queue &queue, const CommandBuffer &command_buffer);
 
+	/**
+	 * @brief Adds a command buffer related to a frame to the submissions batched for the compute queue.
+	 *        The next submission of the frame to another queue waits for it, so its work overlaps the
+	 *        graphics work submitted before it, such as the fragment work of the previous frame
+	 * @param command_buffer A command buffer requested for the compute queue
+	 * @param wait_pipeline_stage Stage of the next submission which waits for the compute work
+	 */
+	void submit_compute(const CommandBuffer &command_buffer, VkPipelineStageFlags wait_pipeline_stage);
+
+	/**
+	 * @brief Records a part of the active frame on a thread of a job system, into a primary command buffer of
+	 *        the frame resources of that thread, submitted between the commands recorded so far into a command
+	 *        buffer of the frame and the ones recorded next. The commands recorded so far are split off and
+	 *        submitted first, the parts recorded by consecutive calls follow in order, and the submissions of
+	 *        the frame are only flushed once all the parts are recorded. The first split off waits for the
+	 *        swapchain image in place of the submission of the frame
+	 * @param command_buffer A primary command buffer of the frame, recording outside of a render pass
+	 * @param job_system The job system recording the parts of the frame
+	 * @param record Records the part, given its command buffer, begun, and the index of the thread recording it
+	 */
+	void record_async(CommandBuffer &command_buffer, JobSystem &job_system, std::function<void(CommandBuffer &, size_t)> &&record);
+
+	/**
+	 * @brief Sends the submissions batched since the last flush with a single vkQueueSubmit. It is called by
+	 *        end_frame and before submitting to another queue, call it before waiting for the submitted work
+	 */
+	void flush_submissions();
+
 	/**
 	 * @brief Waits a frame to finish its rendering
 	 */
@@ -177,6 +273,21 @@ class RenderContext
 
 	Device &get_device();
 
+	/**
+	 * @return The queue the frames are submitted and presented on
+	 */
+	const Queue &get_queue() const;
+
+	/**
+	 * @return The queue of submit_compute, it is the graphics queue if the device has no other compute queue
+	 */
+	const Queue &get_compute_queue() const;
+
+	/**
+	 * @return Whether compute work can run on another queue than the graphics one
+	 */
+	bool has_async_compute() const;
+
 	Swapchain &get_swapchain();
 
 	VkExtent2D get_surface_extent() const;
@@ -185,6 +296,93 @@ class RenderContext
 
 	std::vector<RenderFrame> &get_render_frames();
 
+	/**
+	 * @brief Paces the beginning of frames and measures their present times
+	 */
+	FramePacer &get_frame_pacer();
+
+	/**
+	 * @brief Sets the number of frames which can be in flight, independently of the swapchain image count
+	 * @param count The number of frames, zero for one per swapchain image. It is clamped to the image count.
+	 */
+	void set_frames_in_flight(uint32_t count);
+
+	/**
+	 * @return The number of RenderFrames
+	 */
+	uint32_t get_frames_in_flight() const;
+
+	/**
+	 * @brief Selects whether frames are synchronized with one timeline semaphore per queue instead of
+	 *        per-frame fences, only effective if VK_KHR_timeline_semaphore is enabled
+	 */
+	void set_timeline_semaphores(bool enable);
+
+	bool uses_timeline_semaphores() const;
+
+	/**
+	 * @brief Selects whether begin() and begin_frame() leave the swapchain image to be acquired by
+	 *        acquire_swapchain_image(), so that the offscreen passes of a frame are recorded and submitted
+	 *        without waiting for the presentation engine. Until then the render target of the active frame
+	 *        is the one of a previous image, only its extent and formats may be used. Off by default.
+	 */
+	void set_late_swapchain_acquire(bool enable);
+
+	bool uses_late_swapchain_acquire() const;
+
+	/**
+	 * @brief Flushes the submissions of the active frame, then acquires the next swapchain image and
+	 *        hands its render target to the frame. Called by submit(CommandBuffer &) if not done before,
+	 *        the submissions waiting for the acquired semaphore must be made after it.
+	 */
+	void acquire_swapchain_image();
+
+	/**
+	 * @return Whether the active frame has acquired its swapchain image
+	 */
+	bool is_swapchain_image_acquired() const;
+
+	/**
+	 * @return Whether the present regions are given to the presentation engine, with VK_KHR_incremental_present
+	 */
+	bool supports_incremental_present() const;
+
+	/**
+	 * @brief Adds a region of the active frame which changed since the last presented one, so that the presentation
+	 *        engine only composes the damaged area. The frame must still render the whole image. Without regions,
+	 *        end_frame presents the whole image as changed.
+	 * @param rect A rectangle in window coordinates, the presentation engine applies the pre-transform of the swapchain
+	 */
+	void add_present_region(const VkRect2D &rect);
+
+	/**
+	 * @return The number of the last frame known to be completed by the GPU, exact when the
+	 *         frames are synchronized with timeline semaphores
+	 */
+	uint64_t get_completed_frame_number() const;
+
+	/**
+	 * @return The number of the active frame, compared to get_completed_frame_number() to know when it has completed
+	 */
+	uint64_t get_frame_number() const;
+
+	/**
+	 * @brief Scales the area rendered to in the render targets, which keep their images at full size
+	 *        so that changing the scale allocates nothing. Applied from the next frame.
+	 * @param scale Fraction of the render target extent, in (0, 1]
+	 */
+	void set_render_scale(float scale);
+
+	float get_render_scale() const;
+
+	/**
+	 * @brief Sets the function creating the render targets of the frames from the swapchain images,
+	 *        used from the next recreation
+	 */
+	void set_render_target_create_func(RenderTarget::CreateFunc create_func);
+
+	const RenderTarget::CreateFunc &get_render_target_create_func() const;
+
   protected:
 	VkExtent2D surface_extent;
 
@@ -199,23 +397,214 @@ class RenderContext
 	/// If swapchain exists, then this will be a present supported queue, else a graphics queue
 	const Queue &queue;
 
+	const Queue &compute_queue;
+
 	std::unique_ptr<Swapchain> swapchain;
 
+	FramePacer frame_pacer;
+
+	/// Timeline semaphores signaled by the submissions to each queue, they outlive the frames waiting on them
+	std::map<VkQueue, std::unique_ptr<TimelineSemaphore>> timelines;
+
+	bool timeline_semaphores{true};
+
 	std::vector<RenderFrame> frames;
 
 	VkSemaphore acquired_semaphore;
 
+	bool late_swapchain_acquire{false};
+
+	/// Whether the active frame holds the render target of the image it acquired
+	bool image_acquired{false};
+
+	/// Damaged regions of the active frame, given to the present with VK_KHR_incremental_present
+	std::vector<VkRectLayerKHR> present_regions;
+
+	/// Consecutive frames which allocated descriptor sets, reported to the perf lint once the cache should be warm
+	size_t descriptor_allocation_frames{0};
+
+	/**
+	 * @brief Reports the issues of the active frame to the perf lint of the device, and ends its frame
+	 */
+	void lint_frame();
+
+	/**
+	 * @brief Acquires the next swapchain image, handling a surface change once
+	 * @param semaphore The semaphore signaled once the image can be rendered to
+	 */
+	VkResult acquire_next_image(VkSemaphore semaphore);
+
+	/**
+	 * @brief Hands the render target of the acquired image to the active frame
+	 */
+	void bind_swapchain_image();
+
+	/**
+	 * @brief Scales the render extent of the render target of the active frame
+	 */
+	void update_render_extent();
+
 	bool prepared{false};
 
 	/// Current active frame index
 	uint32_t active_frame_index{0};
 
+	/// Index of the swapchain image acquired by the active frame
+	uint32_t active_image_index{0};
+
+	/// Number of frames in flight, zero for one per swapchain image
+	uint32_t frames_in_flight{0};
+
+	size_t thread_count{1};
+
+	/// Render targets of the swapchain images not held by a frame, by image index
+	std::vector<std::unique_ptr<RenderTarget>> spare_render_targets;
+
+	/// Index of the swapchain image whose render target each frame holds
+	std::vector<uint32_t> frame_image_indices;
+
+	/// Number of the frame which last rendered to each swapchain image
+	std::vector<uint64_t> image_frame_numbers;
+
 	/// Whether a frame is active or not
 	bool frame_active{false};
 
+	/// Number of the current frame, starting from 1
+	uint64_t frame_number{0};
+
+	/// Number of the last frame the GPU is known to have completed
+	uint64_t completed_frame_number{0};
+
+	/// Number of the frame last rendered with each render frame
+	std::vector<uint64_t> render_frame_numbers;
+
+	/**
+	 * @brief Swapchain and render targets replaced while frames using them may still be in flight
+	 */
+	struct RetiredResources
+	{
+		std::unique_ptr<Swapchain> swapchain;
+
+		std::vector<std::unique_ptr<RenderTarget>> render_targets;
+
+		/// Number of the last frame which may use the resources
+		uint64_t frame_number{0};
+	};
+
+	std::deque<RetiredResources> retired_resources;
+
+	/**
+	 * @brief Replaces the swapchain, the old one is kept alive as long as its images may be in use
+	 * @param new_swapchain The swapchain created from the current one
+	 */
+	void retire_swapchain(std::unique_ptr<Swapchain> &&new_swapchain);
+
+	/**
+	 * @brief Destroys the retired resources once the GPU has completed the frames using them, and every frame
+	 *        had the time to drop the descriptor sets referring to their image views
+	 */
+	void release_retired_resources();
+
+	/**
+	 * @return The transform the swapchain takes when pre-rotating, the current one of the surface if it is a rotation
+	 */
+	VkSurfaceTransformFlagBitsKHR select_pre_transform(const VkSurfaceCapabilitiesKHR &surface_properties) const;
+
 	RenderTarget::CreateFunc create_render_target_func = RenderTarget::DEFAULT_CREATE_FUNC;
 
 	VkSurfaceTransformFlagBitsKHR pre_transform{VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR};
+
+	bool pre_rotation{true};
+
+	float render_scale{1.0f};
+
+	/**
+	 * @brief A submission waiting to be sent by flush_submissions
+	 */
+	struct PendingSubmission
+	{
+		std::vector<VkCommandBuffer> command_buffers;
+
+		std::vector<VkSemaphore> wait_semaphores;
+
+		std::vector<VkPipelineStageFlags> wait_stages;
+
+		std::vector<VkSemaphore> signal_semaphores;
+	};
+
+	/// Queue the pending submissions are for, only consecutive submissions to a queue are batched
+	const Queue *pending_queue{nullptr};
+
+	std::vector<PendingSubmission> pending_submissions;
+
+	/**
+	 * @brief Semaphore signaled by a submission to a queue, waited by the next submission to another queue
+	 */
+	struct QueueWait
+	{
+		VkQueue signal_queue{VK_NULL_HANDLE};
+
+		VkSemaphore semaphore{VK_NULL_HANDLE};
+
+		VkPipelineStageFlags wait_stage{0};
+	};
+
+	std::vector<QueueWait> queue_waits;
+
+	/// Job system recording the parts of the active frame given to record_async, null if none are recording
+	JobSystem *async_job_system{nullptr};
+
+	std::unique_ptr<JobSystem::Counter> async_counter{std::make_unique<JobSystem::Counter>()};
+
+	/// Command buffers of the parts recorded by record_async, in order, for the null handles of the pending
+	/// submissions. Each is written by the job recording it, adding others does not move it
+	std::deque<VkCommandBuffer> async_command_buffers;
+
+	/**
+	 * @brief Waits for the parts given to record_async, and puts their command buffers in the pending submissions
+	 */
+	void wait_async_recordings();
+
+	/**
+	 * @brief Adds a submission to the batch, merged with the previous one if no semaphore separates them
+	 * @param queue The queue to submit to, the batch of another queue is flushed first
+	 * @param command_buffer The command buffer to submit, or VK_NULL_HANDLE to only wait for the queue waits
+	 * @param wait_semaphore Semaphore to wait for, or VK_NULL_HANDLE
+	 * @param wait_pipeline_stage Stage which waits for the semaphore
+	 * @param signal_semaphore Semaphore to signal, or VK_NULL_HANDLE
+	 */
+	void add_submission(const Queue &queue, VkCommandBuffer command_buffer, VkSemaphore wait_semaphore, VkPipelineStageFlags wait_pipeline_stage, VkSemaphore signal_semaphore);
+
+	/**
+	 * @return The number of frames to create for the current swapchain
+	 */
+	size_t get_frame_count() const;
+
+	/**
+	 * @brief Creates or destroys frames, handing them the spare render targets or getting them back
+	 */
+	void resize_frames(size_t frame_count);
+
+	/**
+	 * @return An image the frames render to instead of a swapchain image when there is no swapchain
+	 */
+	core::Image create_offscreen_image();
+
+	/**
+	 * @brief Hands the render target of an acquired image to the active frame
+	 */
+	void acquire_render_target(uint32_t image_index);
+
+	/**
+	 * @brief Adds a signal of the queue's timeline to a submission, and records the value in the active frame
+	 * @param queue The queue the submission is for
+	 * @param submit_info The submit info which will signal the timeline
+	 * @param timeline_info Chained to the submit info, it must live until the submission
+	 * @param signal_semaphores Semaphores signaled by the submission, the timeline is appended
+	 * @param signal_values Values for the signaled semaphores, it must live until the submission
+	 */
+	void signal_timeline(const Queue &queue, VkSubmitInfo &submit_info, VkTimelineSemaphoreSubmitInfoKHR &timeline_info,
+	                     std::vector<VkSemaphore> &signal_semaphores, std::vector<uint64_t> &signal_values);
 };
 
 }        // namespace vkb
@@ -25,34 +25,25 @@
 
 namespace vkb
 {
+namespace
+{
+/// Usages which have their own buffer pools and linear allocators
+const std::vector<VkBufferUsageFlags> supported_usages = {VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_BUFFER_USAGE_INDEX_BUFFER_BIT};
+}        // namespace
+
 RenderFrame::RenderFrame(Device &device, RenderTarget &&render_target, size_t thread_count) :
     device{device},
+    thread_resources(thread_count),
     fence_pool{device},
     semaphore_pool{device},
-    swapchain_render_target{std::move(render_target)},
+    gpu_profiler{device},
+    performance_queries{device},
+    swapchain_render_target{std::make_unique<RenderTarget>(std::move(render_target))},
     thread_count{thread_count}
 {
-	const std::vector<VkBufferUsageFlags> supported_usages = {VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_BUFFER_USAGE_INDEX_BUFFER_BIT};
-	for (auto &usage : supported_usages)
-	{
-		std::vector<std::pair<BufferPool, BufferBlock *>> usage_buffer_pools;
-		for (size_t i = 0; i < thread_count; i++)
-		{
-			usage_buffer_pools.push_back(std::make_pair(BufferPool{device, BUFFER_POOL_BLOCK_SIZE * 1024, usage}, nullptr));
-		}
-
-		auto res_ins_it = buffer_pools.emplace(usage, std::move(usage_buffer_pools));
-
-		if (!res_ins_it.second)
-		{
-			throw std::runtime_error("Failed to insert buffer pool");
-		}
-	}
-
-	for (size_t i = 0; i < thread_count; i++)
+	for (size_t i = 0; i < DESCRIPTOR_SHARD_COUNT; ++i)
 	{
-		descriptor_pools.push_back(std::make_unique<std::unordered_map<std::size_t, DescriptorPool>>());
-		descriptor_sets.push_back(std::make_unique<std::unordered_map<std::size_t, DescriptorSet>>());
+		descriptor_shards.emplace_back(std::make_unique<DescriptorShard>());
 	}
 }
 
@@ -63,73 +54,141 @@ Device &RenderFrame::get_device()
 
 void RenderFrame::update_render_target(RenderTarget &&render_target)
 {
-	swapchain_render_target = std::move(render_target);
+	*swapchain_render_target = std::move(render_target);
+}
+
+std::unique_ptr<RenderTarget> RenderFrame::exchange_render_target(std::unique_ptr<RenderTarget> &&render_target)
+{
+	std::swap(swapchain_render_target, render_target);
+
+	return std::move(render_target);
 }
 
 void RenderFrame::reset(bool wait_with_fence)
 {
 	if (wait_with_fence)
 	{
-		VK_CHECK(fence_pool.wait());
+		VK_CHECK(wait());
 
 		fence_pool.reset();
+
+		timeline_values.clear();
+	}
+
+	gpu_profiler.reset();
+
+	performance_queries.reset();
+
+	bandwidth_estimator.reset();
+
+	// The frame is idle, so the resources of threads removed since the last reset can be released
+	if (thread_resources.size() > thread_count)
+	{
+		thread_resources.resize(thread_count);
 	}
 
-	for (auto &command_pools_per_queue : command_pools)
+	for (auto &resources : thread_resources)
 	{
-		for (auto &command_pool : command_pools_per_queue.second)
+		if (!resources)
 		{
-			command_pool->reset_pool();
+			continue;
 		}
-	}
 
-	for (auto &buffer_pools_per_usage : buffer_pools)
-	{
-		for (auto &buffer_pool : buffer_pools_per_usage.second)
+		for (auto &command_pool : resources->command_pools)
 		{
-			buffer_pool.first.reset();
-			buffer_pool.second = nullptr;
+			command_pool.second->reset_pool();
 		}
+
+		for (auto &buffer_pool : resources->buffer_pools)
+		{
+			buffer_pool.second.first.reset();
+			buffer_pool.second.second = nullptr;
+		}
+
+		resources->arena.reset();
+	}
+
+	for (auto &linear_allocator : linear_allocators)
+	{
+		linear_allocator.second->reset();
 	}
 
 	semaphore_pool.reset();
+
+	recycle_descriptors();
 }
 
-std::vector<std::unique_ptr<CommandPool>> &RenderFrame::get_command_pools(const Queue &queue, CommandBuffer::ResetMode reset_mode)
+VkResult RenderFrame::wait() const
 {
-	auto command_pool_it = command_pools.find(queue.get_family_index());
+	VkResult result = fence_pool.wait();
 
-	if (command_pool_it != command_pools.end())
+	for (auto &timeline_value : timeline_values)
 	{
-		if (command_pool_it->second.at(0)->get_reset_mode() != reset_mode)
+		if (result != VK_SUCCESS)
 		{
-			device.wait_idle();
-
-			// Delete pools
-			command_pools.erase(command_pool_it);
+			break;
 		}
-		else
+
+		result = timeline_value.first->wait(timeline_value.second);
+	}
+
+	return result;
+}
+
+bool RenderFrame::is_complete() const
+{
+	// A zero timeout only queries the state of the fences
+	if (fence_pool.wait(0) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	for (auto &timeline_value : timeline_values)
+	{
+		if (timeline_value.first->get_completed_value() < timeline_value.second)
 		{
-			return command_pool_it->second;
+			return false;
 		}
 	}
 
-	std::vector<std::unique_ptr<CommandPool>> queue_command_pools;
-	for (size_t i = 0; i < thread_count; i++)
+	return true;
+}
+
+void RenderFrame::add_timeline_signal(const TimelineSemaphore &timeline, uint64_t value)
+{
+	auto &timeline_value = timeline_values[&timeline];
+
+	timeline_value = std::max(timeline_value, value);
+}
+
+RenderFrame::ThreadResources &RenderFrame::get_thread_resources(size_t thread_index)
+{
+	assert(thread_index < thread_count && "Thread index is out of bounds");
+
+	auto &resources = thread_resources.at(thread_index);
+
+	if (!resources)
 	{
-		queue_command_pools.push_back(std::make_unique<CommandPool>(device, queue.get_family_index(), this, i, reset_mode));
+		resources = std::make_unique<ThreadResources>();
 	}
 
-	auto res_ins_it = command_pools.emplace(queue.get_family_index(), std::move(queue_command_pools));
+	return *resources;
+}
+
+CommandPool &RenderFrame::get_command_pool(const Queue &queue, CommandBuffer::ResetMode reset_mode, size_t thread_index)
+{
+	auto &command_pools = get_thread_resources(thread_index).command_pools;
 
-	if (!res_ins_it.second)
+	auto key = std::make_pair(queue.get_family_index(), reset_mode);
+
+	auto command_pool_it = command_pools.find(key);
+
+	if (command_pool_it == command_pools.end())
 	{
-		throw std::runtime_error("Failed to insert command pool");
+		command_pool_it = command_pools.emplace(key, std::make_unique<CommandPool>(device, queue.get_family_index(), this, thread_index, reset_mode)).first;
 	}
 
-	command_pool_it = res_ins_it.first;
-
-	return command_pool_it->second;
+	return *command_pool_it->second;
 }
 
 const FencePool &RenderFrame::get_fence_pool() const
@@ -147,6 +206,21 @@ const SemaphorePool &RenderFrame::get_semaphore_pool() const
 	return semaphore_pool;
 }
 
+GpuProfiler &RenderFrame::get_gpu_profiler()
+{
+	return gpu_profiler;
+}
+
+PerformanceQueries &RenderFrame::get_performance_queries()
+{
+	return performance_queries;
+}
+
+BandwidthEstimator &RenderFrame::get_bandwidth_estimator()
+{
+	return bandwidth_estimator;
+}
+
 VkSemaphore RenderFrame::request_semaphore()
 {
 	return semaphore_pool.request_semaphore();
@@ -154,68 +228,323 @@ VkSemaphore RenderFrame::request_semaphore()
 
 RenderTarget &RenderFrame::get_render_target()
 {
-	return swapchain_render_target;
+	return *swapchain_render_target;
 }
 
 const RenderTarget &RenderFrame::get_render_target_const() const
 {
-	return swapchain_render_target;
+	return *swapchain_render_target;
 }
 
 CommandBuffer &RenderFrame::request_command_buffer(const Queue &queue, CommandBuffer::ResetMode reset_mode, VkCommandBufferLevel level, size_t thread_index)
 {
-	assert(thread_index < thread_count && "Thread index is out of bounds");
-
-	auto &command_pools = get_command_pools(queue, reset_mode);
+	return get_command_pool(queue, reset_mode, thread_index).request_command_buffer(level);
+}
 
-	auto command_pool_it = std::find_if(command_pools.begin(), command_pools.end(), [&thread_index](std::unique_ptr<CommandPool> &cmd_pool) { return cmd_pool->get_thread_index() == thread_index; });
+RenderFrame::DescriptorShard &RenderFrame::get_descriptor_shard(std::size_t hash)
+{
+	// Fibonacci hashing, so that the sets of a shard do not all share the low bits of their slots
+	auto index = static_cast<size_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL) >> 60);
 
-	return (*command_pool_it)->request_command_buffer(level);
+	return *descriptor_shards[index % DESCRIPTOR_SHARD_COUNT];
 }
 
-DescriptorSet &RenderFrame::request_descriptor_set(DescriptorSetLayout &descriptor_set_layout, const BindingMap<VkDescriptorBufferInfo> &buffer_infos, const BindingMap<VkDescriptorImageInfo> &image_infos, size_t thread_index)
+DescriptorSet &RenderFrame::request_descriptor_set(DescriptorSetLayout &descriptor_set_layout, const DescriptorSetInfos &infos, size_t thread_index)
 {
-	assert(thread_index < thread_count && "Thread index is out of bounds");
+	auto &descriptors = get_thread_resources(thread_index).descriptors;
+
+	// The pool is left out of the key, so that any thread finds the set
+	std::size_t hash{0U};
+	auto &      key = get_resource_key(hash, descriptor_set_layout, infos);
+
+	auto &shard = get_descriptor_shard(hash);
+
+	// The lock is held while a missing set is allocated, so that it is only written once
+	std::lock_guard<std::mutex> lock{shard.mutex};
+
+	if (auto shared_set = shard.descriptor_sets.find(hash, key))
+	{
+		shared_set->last_used = descriptor_generation;
+
+		++descriptors.counters.reuses;
+
+		if (shared_set->thread_index != thread_index)
+		{
+			++descriptors.counters.shared_reuses;
+		}
+
+		return *shared_set->descriptor_set;
+	}
+
+	// Keep a copy of the key, requesting the set reuses the thread's key
+	std::vector<uint8_t> shared_key{key};
+
+	// Allocated from the pools of this thread, which are only used by it
+	auto &descriptor_pool = request_resource(device, nullptr, descriptors.descriptor_pools, descriptor_set_layout);
+
+	std::size_t thread_hash{0U};
+	get_resource_key(thread_hash, descriptor_set_layout, descriptor_pool, infos);
+
+	auto &descriptor_set = request_resource(device, nullptr, descriptors.descriptor_sets, descriptor_set_layout, descriptor_pool, infos);
+
+	++descriptors.counters.allocations;
 
-	auto &descriptor_pool = request_resource(device, nullptr, *descriptor_pools.at(thread_index), descriptor_set_layout);
-	return request_resource(device, nullptr, *descriptor_sets.at(thread_index), descriptor_set_layout, descriptor_pool, buffer_infos, image_infos);
+	shard.descriptor_sets.emplace(hash, std::move(shared_key), SharedDescriptorSet{&descriptor_set, thread_index, thread_hash, descriptor_generation});
+
+	return descriptor_set;
 }
 
 void RenderFrame::clear_descriptors()
 {
-	for (auto &desc_sets_per_thread : descriptor_sets)
+	for (auto &shard : descriptor_shards)
+	{
+		shard->descriptor_sets.clear();
+	}
+
+	for (auto &resources : thread_resources)
+	{
+		if (resources)
+		{
+			reset_descriptors(resources->descriptors);
+		}
+	}
+}
+
+DescriptorCounters RenderFrame::get_descriptor_counters() const
+{
+	DescriptorCounters total_counters;
+
+	for (auto &resources : thread_resources)
+	{
+		if (!resources)
+		{
+			continue;
+		}
+
+		auto &counters = resources->descriptors.counters;
+
+		total_counters.allocations += counters.allocations;
+		total_counters.pool_resets += counters.pool_resets;
+		total_counters.reuses += counters.reuses;
+		total_counters.shared_reuses += counters.shared_reuses;
+	}
+
+	return total_counters;
+}
+
+CommandPoolCounters RenderFrame::get_command_pool_counters() const
+{
+	CommandPoolCounters total_counters;
+
+	for (auto &resources : thread_resources)
+	{
+		if (!resources)
+		{
+			continue;
+		}
+
+		for (auto &command_pool : resources->command_pools)
+		{
+			auto &counters = command_pool.second->get_counters();
+
+			total_counters.allocations += counters.allocations;
+			total_counters.reuses += counters.reuses;
+		total_counters.shared_reuses += counters.shared_reuses;
+			total_counters.resets += counters.resets;
+			total_counters.reset_time += counters.reset_time;
+			total_counters.allocation_time += counters.allocation_time;
+		}
+	}
+
+	return total_counters;
+}
+
+void RenderFrame::recycle_descriptors()
+{
+	// Shared sets requested since the last reset and the stale ones, by the thread which allocated them
+	std::vector<size_t> live_sets(thread_resources.size(), 0);
+	std::vector<size_t> stale_sets(thread_resources.size(), 0);
+
+	bool drop_sets{false};
+
+	for (auto &shard : descriptor_shards)
+	{
+		for (auto &entry : shard->descriptor_sets)
+		{
+			auto &shared_set = entry.second;
+
+			if (shared_set.thread_index >= thread_resources.size())
+			{
+				// The thread was removed along with its pools
+				drop_sets = true;
+			}
+			else if (shared_set.last_used == descriptor_generation)
+			{
+				++live_sets[shared_set.thread_index];
+			}
+			else
+			{
+				++stale_sets[shared_set.thread_index];
+			}
+		}
+	}
+
+	std::vector<bool> reset_threads(thread_resources.size(), false);
+
+	for (size_t i = 0; i < thread_resources.size(); ++i)
 	{
-		desc_sets_per_thread->clear();
+		if (!thread_resources[i])
+		{
+			continue;
+		}
+
+		auto &descriptors = thread_resources[i]->descriptors;
+
+		descriptors.counters = {};
+
+		if (stale_sets[i] == 0)
+		{
+			// Steady state, every set is reused as is
+			continue;
+		}
+
+		drop_sets = true;
+
+		if (descriptors.dropped_sets + stale_sets[i] > live_sets[i])
+		{
+			// Most of the pool space is wasted, start again from empty pools
+			reset_descriptors(descriptors);
+
+			reset_threads[i] = true;
+		}
+		else
+		{
+			// Their space is reclaimed by the next pool reset
+			descriptors.dropped_sets += stale_sets[i];
+		}
 	}
 
-	for (auto &desc_pools_per_thread : descriptor_pools)
+	if (drop_sets)
 	{
-		for (auto &desc_pool : *desc_pools_per_thread)
+		// Stop sharing the stale sets, and those whose pools were reset or removed
+		std::vector<std::pair<std::size_t, std::vector<uint8_t>>> dropped_keys;
+
+		for (auto &shard : descriptor_shards)
 		{
-			desc_pool.second.reset();
+			for (auto &entry : shard->descriptor_sets)
+			{
+				auto &shared_set = entry.second;
+
+				bool removed = shared_set.thread_index >= thread_resources.size() || reset_threads[shared_set.thread_index];
+
+				if (!removed && shared_set.last_used == descriptor_generation)
+				{
+					continue;
+				}
+
+				if (!removed)
+				{
+					thread_resources[shared_set.thread_index]->descriptors.descriptor_sets.erase(shared_set.thread_hash, [](DescriptorSet &) {});
+				}
+
+				dropped_keys.emplace_back(entry.first, entry.key);
+			}
+
+			for (auto &dropped_key : dropped_keys)
+			{
+				shard->descriptor_sets.erase(dropped_key.first, dropped_key.second);
+			}
+
+			dropped_keys.clear();
 		}
 	}
+
+	++descriptor_generation;
+}
+
+void RenderFrame::reset_descriptors(ThreadDescriptors &descriptors)
+{
+	descriptors.descriptor_sets.clear();
+	descriptors.dropped_sets = 0;
+
+	for (auto &descriptor_pool : descriptors.descriptor_pools)
+	{
+		descriptor_pool.second.reset();
+	}
+
+	++descriptors.counters.pool_resets;
 }
 
 void RenderFrame::set_buffer_allocation_strategy(BufferAllocationStrategy new_strategy)
 {
 	buffer_allocation_strategy = new_strategy;
+
+	if (new_strategy == BufferAllocationStrategy::LinearAllocation && linear_allocators.empty())
+	{
+		// Same usages as the buffer pools
+		for (auto usage : supported_usages)
+		{
+			linear_allocators.emplace(usage, std::make_unique<LinearBufferAllocator>(device, LINEAR_ALLOCATOR_SIZE * 1024, usage));
+		}
+	}
+}
+
+FrameArena &RenderFrame::get_arena(size_t thread_index)
+{
+	return get_thread_resources(thread_index).arena;
+}
+
+size_t RenderFrame::get_thread_count() const
+{
+	return thread_count;
+}
+
+void RenderFrame::set_thread_count(size_t count)
+{
+	thread_count = count;
+
+	// Removed threads keep their slots until the frame is reset, as their command buffers may still be executing
+	if (thread_resources.size() < thread_count)
+	{
+		thread_resources.resize(thread_count);
+	}
 }
 
 BufferAllocation RenderFrame::allocate_buffer(const VkBufferUsageFlags usage, const VkDeviceSize size, size_t thread_index)
 {
-	assert(thread_index < thread_count && "Thread index is out of bounds");
+	if (buffer_allocation_strategy == BufferAllocationStrategy::LinearAllocation)
+	{
+		auto linear_allocator_it = linear_allocators.find(usage);
 
-	// Find a pool for this usage
-	auto buffer_pool_it = buffer_pools.find(usage);
-	if (buffer_pool_it == buffer_pools.end())
+		if (linear_allocator_it != linear_allocators.end())
+		{
+			auto data = linear_allocator_it->second->allocate(size);
+
+			if (!data.empty())
+			{
+				return data;
+			}
+		}
+
+		// Once the linear allocator is full, fall back to the buffer pools
+	}
+
+	if (std::find(supported_usages.begin(), supported_usages.end(), usage) == supported_usages.end())
 	{
 		LOGE("No buffer pool for buffer usage {}", usage);
 		return BufferAllocation{};
 	}
 
-	auto &buffer_pool  = buffer_pool_it->second.at(thread_index).first;
-	auto &buffer_block = buffer_pool_it->second.at(thread_index).second;
+	// Find the pool of this thread for this usage, it is created by the first allocation
+	auto &buffer_pools   = get_thread_resources(thread_index).buffer_pools;
+	auto  buffer_pool_it = buffer_pools.find(usage);
+	if (buffer_pool_it == buffer_pools.end())
+	{
+		buffer_pool_it = buffer_pools.emplace(usage, std::make_pair(BufferPool{device, BUFFER_POOL_BLOCK_SIZE * 1024, usage}, nullptr)).first;
+	}
+
+	auto &buffer_pool  = buffer_pool_it->second.first;
+	auto &buffer_block = buffer_pool_it->second.second;
 
 	if (buffer_allocation_strategy == BufferAllocationStrategy::OneAllocationPerBuffer || !buffer_block)
 	{
@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <mutex>
+
 #include "buffer_pool.h"
 #include "common/helpers.h"
 #include "common/resource_caching.h"
@@ -31,15 +33,41 @@
 #include "core/image.h"
 #include "core/queue.h"
 #include "fence_pool.h"
+#include "frame_arena.h"
+#include "rendering/bandwidth_estimator.h"
+#include "rendering/gpu_profiler.h"
+#include "rendering/performance_queries.h"
 #include "rendering/render_target.h"
 #include "semaphore_pool.h"
+#include "timeline_semaphore.h"
 
 namespace vkb
 {
 enum BufferAllocationStrategy
 {
 	OneAllocationPerBuffer,
-	MultipleAllocationsPerBuffer
+	MultipleAllocationsPerBuffer,
+
+	/// Lock-free linear allocation from a single buffer per usage, shared by all threads
+	LinearAllocation
+};
+
+/**
+ * @brief Descriptor set management counters of the last recording of a frame
+ */
+struct DescriptorCounters
+{
+	/// Descriptor sets allocated and written
+	uint32_t allocations{0};
+
+	/// Descriptor pools reset, releasing all of their sets
+	uint32_t pool_resets{0};
+
+	/// Descriptor sets reused from the previous recording of the frame, or from another thread
+	uint32_t reuses{0};
+
+	/// Reused descriptor sets which were allocated by another thread
+	uint32_t shared_reuses{0};
 };
 
 /**
@@ -63,6 +91,11 @@ class RenderFrame
 	 */
 	static constexpr uint32_t BUFFER_POOL_BLOCK_SIZE = 256;
 
+	/**
+	 * @brief Size of a linear allocator buffer in kilobytes
+	 */
+	static constexpr uint32_t LINEAR_ALLOCATOR_SIZE = 4096;
+
 	RenderFrame(Device &device, RenderTarget &&render_target, size_t thread_count = 1);
 
 	RenderFrame(const RenderFrame &) = delete;
@@ -73,8 +106,23 @@ class RenderFrame
 
 	RenderFrame &operator=(RenderFrame &&) = delete;
 
+	/**
+	 * @brief Resets the frame resources for a new recording
+	 * @param wait_with_fence Whether to first wait for the fences and timeline values signaled by the
+	 *        previous submissions of the frame
+	 */
 	void reset(bool wait_with_fence = true);
 
+	/**
+	 * @brief Waits for the fences and timeline values signaled by the submissions of the frame, without resetting it
+	 */
+	VkResult wait() const;
+
+	/**
+	 * @return Whether the GPU has completed all the previous submissions of the frame, without waiting
+	 */
+	bool is_complete() const;
+
 	Device &get_device();
 
 	const FencePool &get_fence_pool() const;
@@ -85,12 +133,26 @@ class RenderFrame
 
 	VkSemaphore request_semaphore();
 
+	/**
+	 * @brief Records a timeline value signaled by a submission of the frame, the next reset waits for it
+	 * @param timeline The timeline semaphore signaled, it must outlive the frame
+	 * @param value The value signaled by the submission
+	 */
+	void add_timeline_signal(const TimelineSemaphore &timeline, uint64_t value);
+
 	/**
 	 * @brief Called when the swapchain changes
 	 * @param render_target A new render target with updated images
 	 */
 	void update_render_target(RenderTarget &&render_target);
 
+	/**
+	 * @brief Hands over the render target of the frame, used when the frame renders to a different swapchain image
+	 * @param render_target The render target the frame takes over
+	 * @return The render target previously held by the frame
+	 */
+	std::unique_ptr<RenderTarget> exchange_render_target(std::unique_ptr<RenderTarget> &&render_target);
+
 	RenderTarget &get_render_target();
 
 	const RenderTarget &get_render_target_const() const;
@@ -110,15 +172,49 @@ class RenderFrame
 	                                      VkCommandBufferLevel     level        = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
 	                                      size_t                   thread_index = 0);
 
-	DescriptorSet &request_descriptor_set(DescriptorSetLayout &                     descriptor_set_layout,
-	                                      const BindingMap<VkDescriptorBufferInfo> &buffer_infos,
-	                                      const BindingMap<VkDescriptorImageInfo> & image_infos,
-	                                      size_t                                    thread_index = 0);
+	/**
+	 * @brief Descriptor sets are cached by the frame while they keep being requested. A set is shared by all
+	 *        the threads of the frame, allocated from the pools of the first thread which requested it.
+	 *        Sets which were not requested during the previous recording of the frame are dropped when the
+	 *        frame is reset, and the pools of a thread are reset once its dropped sets outnumber its cached ones.
+	 */
+	DescriptorSet &request_descriptor_set(DescriptorSetLayout &     descriptor_set_layout,
+	                                      const DescriptorSetInfos &infos,
+	                                      size_t                    thread_index = 0);
 
+	/**
+	 * @brief Drops all the cached descriptor sets and resets the descriptor pools
+	 */
 	void clear_descriptors();
 
 	/**
-	 * @brief Sets a new buffer allocation strategy
+	 * @return The descriptor counters of all threads, since the frame was last reset
+	 */
+	DescriptorCounters get_descriptor_counters() const;
+
+	/**
+	 * @return The counters of all the command pools of the frame, since the frame was last reset
+	 */
+	CommandPoolCounters get_command_pool_counters() const;
+
+	/**
+	 * @return The profiler measuring the GPU time of the frame's scopes, its results are read back when the frame is reset
+	 */
+	GpuProfiler &get_gpu_profiler();
+
+	/**
+	 * @return The performance counters measured over the render passes of the frame, disabled by default
+	 */
+	PerformanceQueries &get_performance_queries();
+
+	/**
+	 * @return The external memory traffic estimated for the render passes recorded since the frame was reset
+	 */
+	BandwidthEstimator &get_bandwidth_estimator();
+
+	/**
+	 * @brief Sets a new buffer allocation strategy, it should not be changed while
+	 *        other threads are allocating
 	 * @param new_strategy The new buffer allocation strategy
 	 */
 	void set_buffer_allocation_strategy(BufferAllocationStrategy new_strategy);
@@ -131,37 +227,141 @@ class RenderFrame
 	 */
 	BufferAllocation allocate_buffer(VkBufferUsageFlags usage, VkDeviceSize size, size_t thread_index = 0);
 
+	/**
+	 * @return Number of threads which have their own command pools, buffer pools and descriptor pools
+	 */
+	size_t get_thread_count() const;
+
+	/**
+	 * @return The arena of a thread for the transient CPU data of the frame, rewound when the frame is reset
+	 */
+	FrameArena &get_arena(size_t thread_index = 0);
+
+	/**
+	 * @brief Changes the number of threads which may record into the frame. The resources of a thread
+	 *        are created by its first request, and those of removed threads are released when the frame is next reset.
+	 *        It should not be called while other threads are recording
+	 * @param count The new number of threads
+	 */
+	void set_thread_count(size_t count);
+
   private:
 	Device &device;
 
+	/// Shards of the descriptor sets shared by the threads, each locked on its own
+	static constexpr size_t DESCRIPTOR_SHARD_COUNT = 16;
+
 	/**
-	 * @brief Retrieve the frame's command pool(s)
-	 * @param queue The queue command buffers will be submitted on
-	 * @param reset_mode Indicate how the command buffers will be reset after execution,
-	 *        may trigger a pool re-creation to set necessary flags
-	 * @return The frame's command pool(s)
+	 * @brief Descriptor pools of the frame used by one thread, and the sets it allocated from them
+	 */
+	struct ThreadDescriptors
+	{
+		ResourceMap<DescriptorPool> descriptor_pools;
+
+		ResourceMap<DescriptorSet> descriptor_sets;
+
+		/// Sets dropped from the cache which still use pool space until the next pool reset
+		size_t dropped_sets{0};
+
+		DescriptorCounters counters;
+	};
+
+	/**
+	 * @brief Command pools, buffer pools and descriptors of the frame used by one thread
+	 */
+	struct ThreadResources
+	{
+		/// Command pools by queue family index and reset mode, so that modes can be mixed without recreating pools
+		std::map<std::pair<uint32_t, CommandBuffer::ResetMode>, std::unique_ptr<CommandPool>> command_pools;
+
+		/// Buffer pools and the block currently allocated from, by usage
+		std::map<VkBufferUsageFlags, std::pair<BufferPool, BufferBlock *>> buffer_pools;
+
+		ThreadDescriptors descriptors;
+
+		FrameArena arena;
+	};
+
+	/// Resources of each thread, a slot is only filled and used by the thread with its index
+	std::vector<std::unique_ptr<ThreadResources>> thread_resources;
+
+	/**
+	 * @brief Retrieves the resources of a thread, creating them on its first request
+	 * @param thread_index Index of the requesting thread
 	 */
-	std::vector<std::unique_ptr<CommandPool>> &get_command_pools(const Queue &queue, CommandBuffer::ResetMode reset_mode);
+	ThreadResources &get_thread_resources(size_t thread_index);
 
-	/// Commands pools associated to the frame
-	std::map<uint32_t, std::vector<std::unique_ptr<CommandPool>>> command_pools;
+	/**
+	 * @brief Retrieves the command pool of a thread for a queue family and reset mode, creating it if needed
+	 */
+	CommandPool &get_command_pool(const Queue &queue, CommandBuffer::ResetMode reset_mode, size_t thread_index);
+
+	/**
+	 * @brief A descriptor set shared by the threads, owned by the thread which allocated it
+	 */
+	struct SharedDescriptorSet
+	{
+		DescriptorSet *descriptor_set;
+
+		size_t thread_index;
 
-	/// Descriptor pools for the frame
-	std::vector<std::unique_ptr<std::unordered_map<std::size_t, DescriptorPool>>> descriptor_pools;
+		/// Hash of the set in the descriptor sets of its thread
+		std::size_t thread_hash;
 
-	/// Descriptor sets for the frame
-	std::vector<std::unique_ptr<std::unordered_map<std::size_t, DescriptorSet>>> descriptor_sets;
+		/// Generation of the last request of the set
+		uint32_t last_used;
+	};
+
+	/**
+	 * @brief Shared descriptor sets found by their layout and resources, whichever pool they were allocated from
+	 */
+	struct DescriptorShard
+	{
+		std::mutex mutex;
+
+		ResourceMap<SharedDescriptorSet> descriptor_sets;
+	};
+
+	/// Kept behind pointers as their mutexes cannot be moved with the frame
+	std::vector<std::unique_ptr<DescriptorShard>> descriptor_shards;
+
+	/**
+	 * @brief Selects the shard of a descriptor set from the high bits of its hash, the low bits select its slot
+	 */
+	DescriptorShard &get_descriptor_shard(std::size_t hash);
+
+	/// Incremented each time the frame is reset
+	uint32_t descriptor_generation{0};
+
+	/**
+	 * @brief Drops the descriptor sets not requested since the last reset, or resets all of the pools
+	 *        of a thread if too much of their space is used by dropped sets. It must not be called while
+	 *        threads are recording, the shared sets are not locked
+	 */
+	void recycle_descriptors();
+
+	void reset_descriptors(ThreadDescriptors &descriptors);
 
 	FencePool fence_pool;
 
 	SemaphorePool semaphore_pool;
 
+	/// Last value signaled by the frame's submissions on each timeline
+	std::map<const TimelineSemaphore *, uint64_t> timeline_values;
+
 	size_t thread_count;
 
-	RenderTarget swapchain_render_target;
+	GpuProfiler gpu_profiler;
+
+	PerformanceQueries performance_queries;
+
+	BandwidthEstimator bandwidth_estimator;
+
+	std::unique_ptr<RenderTarget> swapchain_render_target;
 
 	BufferAllocationStrategy buffer_allocation_strategy{BufferAllocationStrategy::MultipleAllocationsPerBuffer};
 
-	std::map<VkBufferUsageFlags, std::vector<std::pair<BufferPool, BufferBlock *>>> buffer_pools;
+	/// Created when the linear allocation strategy is first set
+	std::map<VkBufferUsageFlags, std::unique_ptr<LinearBufferAllocator>> linear_allocators;
 };
 }        // namespace vkb
@@ -0,0 +1,641 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/render_graph.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "core/command_buffer.h"
+#include "gui.h"
+
+namespace vkb
+{
+namespace
+{
+/**
+ * @brief Stages and accesses of an image since its last barrier
+ */
+struct ImageState
+{
+	VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+
+	VkPipelineStageFlags stage_mask{VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT};
+
+	VkAccessFlags access_mask{0};
+};
+
+bool contains(const std::vector<uint32_t> &values, uint32_t value)
+{
+	return std::find(values.begin(), values.end(), value) != values.end();
+}
+
+bool is_read_only_layout(VkImageLayout layout)
+{
+	return layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL || layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+}
+
+void set_dst_masks(ImageMemoryBarrier &barrier)
+{
+	switch (barrier.new_layout)
+	{
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+			barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			barrier.dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			break;
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+			barrier.dst_stage_mask  = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			barrier.dst_access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			break;
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+			barrier.dst_stage_mask  = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			barrier.dst_access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+			break;
+		default:
+			barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			barrier.dst_access_mask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+			break;
+	}
+}
+}        // namespace
+
+RenderGraph::Pass::Pass(std::unique_ptr<Subpass> &&subpass_) :
+    subpass{std::move(subpass_)}
+{
+}
+
+RenderGraph::Pass &RenderGraph::Pass::writes(uint32_t attachment)
+{
+	written.push_back(attachment);
+	return *this;
+}
+
+RenderGraph::Pass &RenderGraph::Pass::reads(uint32_t attachment)
+{
+	read.push_back(attachment);
+	return *this;
+}
+
+RenderGraph::Pass &RenderGraph::Pass::samples(uint32_t attachment)
+{
+	sampled.push_back(attachment);
+	return *this;
+}
+
+RenderGraph::RenderGraph()
+{
+	// The swapchain image, its format comes with the image
+	add_attachment("backbuffer", VK_FORMAT_UNDEFINED, {{0.0f, 0.0f, 0.0f, 1.0f}});
+	export_attachment(BACKBUFFER);
+}
+
+uint32_t RenderGraph::add_attachment(const std::string &name, VkFormat format, const VkClearValue &clear_value, VkImageUsageFlags usage)
+{
+	assert(!compiled && "Attachments cannot be added to a compiled render graph");
+
+	GraphAttachment attachment{};
+	attachment.name        = name;
+	attachment.format      = format;
+	attachment.clear_value = clear_value;
+	attachment.usage       = usage;
+
+	if (is_depth_stencil_format(format))
+	{
+		if (depth_attachment != VK_ATTACHMENT_UNUSED)
+		{
+			throw std::runtime_error("Render graph supports a single depth attachment, cannot add " + name);
+		}
+
+		depth_attachment = to_u32(attachments.size());
+	}
+
+	attachments.push_back(std::move(attachment));
+
+	return to_u32(attachments.size() - 1);
+}
+
+void RenderGraph::export_attachment(uint32_t attachment)
+{
+	attachments.at(attachment).exported = true;
+}
+
+RenderGraph::Pass &RenderGraph::add_pass(std::unique_ptr<Subpass> &&subpass)
+{
+	assert(!compiled && "Passes cannot be added to a compiled render graph");
+
+	passes.push_back(std::make_unique<Pass>(std::move(subpass)));
+
+	return *passes.back();
+}
+
+void RenderGraph::compile()
+{
+	if (compiled)
+	{
+		throw std::runtime_error("Render graph is already compiled");
+	}
+
+	if (passes.empty())
+	{
+		throw std::runtime_error("Render graph has no passes");
+	}
+
+	// Merge passes into render passes, a pass starts a new one if it cannot
+	// run as a subpass of the current one: sampling an attachment needs the
+	// render pass which writes it to be complete, and an attachment sampled
+	// in the render pass cannot be rendered to in it
+	std::vector<bool> written(attachments.size(), false);
+	std::vector<bool> sampled(attachments.size(), false);
+
+	render_pass_offsets.clear();
+
+	for (size_t i = 0; i < passes.size(); ++i)
+	{
+		auto &pass = *passes[i];
+
+		bool split = render_pass_offsets.empty();
+
+		for (auto attachment : pass.sampled)
+		{
+			if (attachment >= attachments.size() || attachment == depth_attachment)
+			{
+				throw std::runtime_error("Render graph cannot sample attachment " + std::to_string(attachment));
+			}
+
+			if (contains(pass.written, attachment))
+			{
+				throw std::runtime_error("Render graph pass cannot sample attachment " + attachments[attachment].name + " it renders to");
+			}
+
+			split |= written[attachment];
+		}
+
+		for (auto attachment : pass.written)
+		{
+			split |= sampled.at(attachment);
+		}
+
+		if (split)
+		{
+			render_pass_offsets.push_back(i);
+			std::fill(written.begin(), written.end(), false);
+			std::fill(sampled.begin(), sampled.end(), false);
+		}
+
+		pass.render_pass = render_pass_offsets.size() - 1;
+
+		for (auto attachment : pass.written)
+		{
+			written[attachment] = true;
+		}
+
+		for (auto attachment : pass.sampled)
+		{
+			sampled[attachment] = true;
+		}
+	}
+
+	render_pass_offsets.push_back(passes.size());
+
+	const size_t render_pass_count = render_pass_offsets.size() - 1;
+
+	// Lifetimes and usages of the attachments
+	for (auto &pass : passes)
+	{
+		auto render_pass = pass->render_pass;
+
+		auto use = [&](uint32_t index, VkImageUsageFlags usage) -> GraphAttachment & {
+			auto &attachment             = attachments.at(index);
+			attachment.first_render_pass = std::min(attachment.first_render_pass, render_pass);
+			attachment.last_render_pass  = std::max(attachment.last_render_pass, render_pass);
+			attachment.usage |= usage;
+			return attachment;
+		};
+
+		for (auto index : pass->written)
+		{
+			auto &attachment                   = use(index, 0);
+			attachment.first_write_render_pass = std::min(attachment.first_write_render_pass, render_pass);
+		}
+
+		for (auto index : pass->read)
+		{
+			use(index, VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT);
+		}
+
+		for (auto index : pass->sampled)
+		{
+			use(index, VK_IMAGE_USAGE_SAMPLED_BIT).sampled = true;
+		}
+	}
+
+	for (auto &attachment : attachments)
+	{
+		if (attachment.first_render_pass > attachment.last_render_pass)
+		{
+			throw std::runtime_error("Render graph attachment " + attachment.name + " is never used");
+		}
+
+		if (is_depth_stencil_format(attachment.format))
+		{
+			attachment.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		}
+		else
+		{
+			attachment.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		}
+
+		if (attachment.exported)
+		{
+			attachment.last_render_pass = render_pass_count - 1;
+		}
+	}
+
+	assign_images();
+
+	build_render_pipelines();
+
+	compiled = true;
+}
+
+void RenderGraph::assign_images()
+{
+	images.clear();
+
+	auto add_image = [this](uint32_t index) {
+		auto &attachment       = attachments[index];
+		attachment.image_index = to_u32(images.size());
+
+		GraphImage image{};
+		image.format = attachment.format;
+		image.usage  = attachment.usage;
+		image.attachments.push_back(index);
+		images.push_back(std::move(image));
+	};
+
+	// The swapchain image and the depth image come first, as in VulkanSample
+	add_image(BACKBUFFER);
+
+	if (depth_attachment != VK_ATTACHMENT_UNUSED)
+	{
+		add_image(depth_attachment);
+	}
+
+	std::vector<uint32_t> order(attachments.size());
+	std::iota(order.begin(), order.end(), 0U);
+	std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+		return attachments[a].first_render_pass < attachments[b].first_render_pass;
+	});
+
+	for (auto index : order)
+	{
+		if (index == BACKBUFFER || index == depth_attachment)
+		{
+			continue;
+		}
+
+		auto &attachment = attachments[index];
+
+		// Share the first image whose attachments are all dead before this one starts
+		auto shared = std::find_if(images.begin(), images.end(), [&](const GraphImage &image) {
+			if (image.format != attachment.format || image.usage != attachment.usage)
+			{
+				return false;
+			}
+
+			return std::all_of(image.attachments.begin(), image.attachments.end(), [&](uint32_t other) {
+				return other != BACKBUFFER && other != depth_attachment && !attachments[other].exported &&
+				       attachments[other].last_render_pass < attachment.first_render_pass;
+			});
+		});
+
+		if (attachment.exported || shared == images.end())
+		{
+			add_image(index);
+		}
+		else
+		{
+			attachment.image_index = to_u32(shared - images.begin());
+			shared->attachments.push_back(index);
+		}
+	}
+
+	// Images whose content never leaves a render pass need no memory on tile-based GPUs
+	const VkImageUsageFlags attachment_usages = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+	for (size_t i = 1; i < images.size(); ++i)
+	{
+		auto &image = images[i];
+
+		bool transient = (image.usage & ~attachment_usages) == 0;
+
+		for (auto index : image.attachments)
+		{
+			auto &attachment = attachments[index];
+			transient &= !attachment.exported && attachment.first_render_pass == attachment.last_render_pass;
+		}
+
+		if (transient)
+		{
+			image.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+	}
+}
+
+void RenderGraph::build_render_pipelines()
+{
+	const size_t render_pass_count = render_pass_offsets.size() - 1;
+
+	const uint32_t depth_image = depth_attachment != VK_ATTACHMENT_UNUSED ? attachments[depth_attachment].image_index : VK_ATTACHMENT_UNUSED;
+
+	std::vector<ImageState> states(images.size());
+
+	// VulkanSample::draw transitions the swapchain image before the graph
+	states[0].layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	states[0].stage_mask = 0;
+
+	render_pipelines.clear();
+	barriers.assign(render_pass_count + 1, {});
+
+	for (size_t render_pass = 0; render_pass < render_pass_count; ++render_pass)
+	{
+		auto first_pass = passes.begin() + render_pass_offsets[render_pass];
+		auto last_pass  = passes.begin() + render_pass_offsets[render_pass + 1];
+
+		auto pipeline = std::make_unique<RenderPipeline>();
+
+		std::vector<LoadStoreInfo> load_store(images.size());
+		std::vector<VkClearValue>  clear_values(images.size());
+
+		for (uint32_t i = 0; i < images.size(); ++i)
+		{
+			auto &image = images[i];
+			auto &state = states[i];
+
+			auto live = std::find_if(image.attachments.begin(), image.attachments.end(), [&](uint32_t index) {
+				return attachments[index].first_render_pass <= render_pass && render_pass <= attachments[index].last_render_pass;
+			});
+
+			const GraphAttachment *attachment = live != image.attachments.end() ? &attachments[*live] : nullptr;
+
+			uint32_t index = attachment ? *live : VK_ATTACHMENT_UNUSED;
+
+			bool is_written = false;
+			bool is_read    = false;
+			bool is_sampled = false;
+
+			for (auto pass = first_pass; pass != last_pass; ++pass)
+			{
+				is_written |= contains((*pass)->written, index);
+				is_read |= contains((*pass)->read, index);
+				is_sampled |= contains((*pass)->sampled, index);
+			}
+
+			if (attachment)
+			{
+				clear_values[i] = attachment->clear_value;
+			}
+
+			auto &ops = load_store[i];
+
+			bool has_content = attachment && attachment->first_write_render_pass < render_pass;
+
+			VkImageLayout start_layout;
+
+			if (i == depth_image || is_written || is_read)
+			{
+				// The first and the last layout of the image in the render pass, see RenderPass
+				VkImageLayout end_layout;
+
+				if (i == depth_image)
+				{
+					start_layout = contains((*first_pass)->read, index) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+					end_layout   = contains((*(last_pass - 1))->read, index) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+				}
+				else
+				{
+					auto first_use = std::find_if(first_pass, last_pass, [&](const std::unique_ptr<Pass> &pass) {
+						return contains(pass->written, index) || contains(pass->read, index);
+					});
+
+					start_layout = contains((*first_use)->written, index) ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+					end_layout   = contains((*(last_pass - 1))->read, index) ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				}
+
+				if (has_content)
+				{
+					ops.load_op = VK_ATTACHMENT_LOAD_OP_LOAD;
+				}
+				else if (is_written || !attachment)
+				{
+					ops.load_op = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				}
+				else
+				{
+					ops.load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				}
+
+				bool keep = attachment && (attachment->exported || attachment->last_render_pass > render_pass);
+
+				ops.store_op = keep ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+				if (!attachment)
+				{
+					clear_values[i] = attachments[depth_attachment].clear_value;
+				}
+
+				ImageState next{end_layout, 0, 0};
+
+				if (i == depth_image)
+				{
+					next.stage_mask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+					next.access_mask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+				}
+				else if (is_written)
+				{
+					next.stage_mask |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+					next.access_mask |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+				}
+
+				if (is_read)
+				{
+					next.stage_mask |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+				}
+
+				ImageMemoryBarrier barrier{};
+				barrier.old_layout = (has_content || i == 0) ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+				barrier.new_layout = start_layout;
+
+				bool needed = barrier.old_layout != barrier.new_layout || state.access_mask != 0 ||
+				              (state.stage_mask != 0 && !is_read_only_layout(start_layout));
+
+				if (needed)
+				{
+					barrier.src_stage_mask  = state.stage_mask ? state.stage_mask : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+					barrier.src_access_mask = state.access_mask;
+					set_dst_masks(barrier);
+					barriers[render_pass].push_back({i, barrier});
+				}
+
+				state = next;
+			}
+			else if (is_sampled)
+			{
+				// Sampled in the render pass without being one of its attachments
+				ops.load_op          = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				ops.store_op         = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				ops.preserved_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+				ImageMemoryBarrier barrier{};
+				barrier.old_layout = has_content ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+				barrier.new_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+				if (barrier.old_layout != barrier.new_layout || state.access_mask != 0)
+				{
+					barrier.src_stage_mask  = state.stage_mask ? state.stage_mask : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+					barrier.src_access_mask = state.access_mask;
+					set_dst_masks(barrier);
+					barriers[render_pass].push_back({i, barrier});
+				}
+
+				state = {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0};
+			}
+			else
+			{
+				// Not used by the render pass, the image keeps its layout and content
+				ops.load_op          = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				ops.store_op         = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				ops.preserved_layout = state.layout;
+
+				if (state.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+				{
+					state.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				}
+			}
+		}
+
+		// Subpasses use the images of their attachments
+		auto to_images = [this](const std::vector<uint32_t> &indices) {
+			std::vector<uint32_t> result;
+			for (auto index : indices)
+			{
+				result.push_back(attachments.at(index).image_index);
+			}
+			return result;
+		};
+
+		for (auto pass = first_pass; pass != last_pass; ++pass)
+		{
+			auto &subpass = (*pass)->subpass;
+			subpass->set_output_attachments(to_images((*pass)->written));
+			subpass->set_input_attachments(to_images((*pass)->read));
+			pipeline->add_subpass(std::move(subpass));
+		}
+
+		pipeline->set_load_store(load_store);
+		pipeline->set_clear_value(clear_values);
+
+		render_pipelines.push_back(std::move(pipeline));
+	}
+
+	// VulkanSample::draw expects the swapchain image to be a color attachment
+	if (states[0].layout != VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+	{
+		ImageMemoryBarrier barrier{};
+		barrier.old_layout      = states[0].layout;
+		barrier.new_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barrier.src_stage_mask  = states[0].stage_mask;
+		barrier.src_access_mask = states[0].access_mask;
+		set_dst_masks(barrier);
+		barriers.back().push_back({0, barrier});
+	}
+}
+
+RenderTarget RenderGraph::create_render_target(core::Image &&swapchain_image) const
+{
+	assert(compiled && "Render graph should be compiled before creating its render target");
+
+	auto &device = swapchain_image.get_device();
+	auto  extent = swapchain_image.get_extent();
+
+	std::vector<core::Image> target_images;
+	target_images.push_back(std::move(swapchain_image));
+
+	for (size_t i = 1; i < images.size(); ++i)
+	{
+		target_images.emplace_back(device, extent, images[i].format, images[i].usage, VMA_MEMORY_USAGE_GPU_ONLY);
+	}
+
+	return RenderTarget{std::move(target_images)};
+}
+
+void RenderGraph::draw(CommandBuffer &command_buffer, RenderTarget &render_target, Gui *gui)
+{
+	assert(compiled && "Render graph should be compiled before drawing");
+
+	auto &views  = render_target.get_views();
+	auto &extent = render_target.get_render_extent();
+
+	VkViewport viewport{};
+	viewport.width    = static_cast<float>(extent.width);
+	viewport.height   = static_cast<float>(extent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	command_buffer.set_viewport(0, {viewport});
+
+	VkRect2D scissor{};
+	scissor.extent = extent;
+	command_buffer.set_scissor(0, {scissor});
+
+	for (size_t i = 0; i < render_pipelines.size(); ++i)
+	{
+		for (auto &graph_barrier : barriers[i])
+		{
+			command_buffer.image_memory_barrier(views.at(graph_barrier.image_index), graph_barrier.barrier);
+		}
+
+		render_pipelines[i]->draw(command_buffer, render_target);
+
+		if (gui && i == render_pipelines.size() - 1)
+		{
+			gui->draw(command_buffer);
+		}
+
+		command_buffer.end_render_pass();
+	}
+
+	for (auto &graph_barrier : barriers.back())
+	{
+		command_buffer.image_memory_barrier(views.at(graph_barrier.image_index), graph_barrier.barrier);
+	}
+}
+
+std::vector<std::unique_ptr<RenderPipeline>> &RenderGraph::get_render_pipelines()
+{
+	return render_pipelines;
+}
+
+uint32_t RenderGraph::get_image_index(uint32_t attachment) const
+{
+	assert(compiled && "Render graph should be compiled before querying its images");
+
+	return attachments.at(attachment).image_index;
+}
+}        // namespace vkb
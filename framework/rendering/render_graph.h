@@ -0,0 +1,215 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+#include "rendering/render_pipeline.h"
+#include "rendering/render_target.h"
+#include "rendering/subpass.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class Gui;
+
+/**
+ * @brief Builds render pipelines from passes which declare the attachments they read and write.
+ *        Consecutive passes are merged as subpasses of one render pass unless a pass samples an
+ *        attachment written in the current render pass. From the declarations the graph sets the
+ *        input and output attachments of the subpasses, the load and store operations, transient
+ *        usage for attachments which live within a render pass, and shares one image between
+ *        attachments whose lifetimes do not overlap. Between render passes it records the image
+ *        barriers the next render pass needs, and only those.
+ *
+ *        The graph renders into a single RenderTarget built by create_render_target, whose first
+ *        image is the swapchain image (BACKBUFFER) and whose second image is the depth attachment,
+ *        if any, matching the layout transitions of VulkanSample::draw. Samples record the graph
+ *        by overriding VulkanSample::draw_renderpass. At most one depth attachment is supported,
+ *        as render passes use the depth attachment of the render target in every subpass.
+ */
+class RenderGraph
+{
+  public:
+	/// Index of the swapchain image, exported
+	static const uint32_t BACKBUFFER = 0;
+
+	/**
+	 * @brief A subpass with the attachments it uses, see RenderGraph::add_pass
+	 */
+	class Pass
+	{
+	  public:
+		Pass(std::unique_ptr<Subpass> &&subpass_);
+
+		/**
+		 * @brief Declares an attachment the pass renders to
+		 */
+		Pass &writes(uint32_t attachment);
+
+		/**
+		 * @brief Declares an attachment the pass reads as an input attachment, at the same pixel
+		 */
+		Pass &reads(uint32_t attachment);
+
+		/**
+		 * @brief Declares an attachment the pass samples in its shaders, which must be complete
+		 *        before the render pass of the pass begins
+		 */
+		Pass &samples(uint32_t attachment);
+
+	  private:
+		friend class RenderGraph;
+
+		std::unique_ptr<Subpass> subpass;
+
+		std::vector<uint32_t> written;
+
+		std::vector<uint32_t> read;
+
+		std::vector<uint32_t> sampled;
+
+		/// Index of the render pass of the pass
+		size_t render_pass{0};
+	};
+
+	RenderGraph();
+
+	/**
+	 * @brief Declares an attachment created by the graph
+	 * @param name Name of the attachment, used in error messages
+	 * @param format Format of the image
+	 * @param clear_value Value the attachment is cleared to before its first write
+	 * @param usage Usage flags needed beyond the ones the declarations imply
+	 * @return The index of the attachment
+	 */
+	uint32_t add_attachment(const std::string &name, VkFormat format, const VkClearValue &clear_value = {}, VkImageUsageFlags usage = 0);
+
+	/**
+	 * @brief Keeps the content of an attachment after the last render pass, so it is stored and never shares its image
+	 */
+	void export_attachment(uint32_t attachment);
+
+	/**
+	 * @brief Appends a pass, passes execute in the order they are added
+	 * @return The pass, to declare its attachments
+	 */
+	Pass &add_pass(std::unique_ptr<Subpass> &&subpass);
+
+	/**
+	 * @brief Builds the render pipelines from the passes, which are moved into them
+	 *        Throws a std::runtime_error if the declarations cannot be rendered in a single render target
+	 */
+	void compile();
+
+	/**
+	 * @brief Creates the render target of the graph for the render context, the graph must be compiled
+	 */
+	RenderTarget create_render_target(core::Image &&swapchain_image) const;
+
+	/**
+	 * @brief Records the render passes and the barriers between them
+	 * @param command_buffer Command buffer to record to
+	 * @param render_target A render target created by create_render_target
+	 * @param gui Optional gui drawn at the end of the last render pass
+	 */
+	void draw(CommandBuffer &command_buffer, RenderTarget &render_target, Gui *gui = nullptr);
+
+	std::vector<std::unique_ptr<RenderPipeline>> &get_render_pipelines();
+
+	/**
+	 * @return Index of the image of an attachment in the render target, the graph must be compiled
+	 *         Subpasses use it to find the views of the attachments they sample
+	 */
+	uint32_t get_image_index(uint32_t attachment) const;
+
+  private:
+	struct GraphAttachment
+	{
+		std::string name;
+
+		VkFormat format{VK_FORMAT_UNDEFINED};
+
+		VkClearValue clear_value{};
+
+		VkImageUsageFlags usage{0};
+
+		bool exported{false};
+
+		bool sampled{false};
+
+		/// Render passes of the first use, the first write and the last use
+		size_t first_render_pass{~size_t(0)};
+
+		size_t first_write_render_pass{~size_t(0)};
+
+		size_t last_render_pass{0};
+
+		/// Index of the image of the render target
+		uint32_t image_index{0};
+	};
+
+	/**
+	 * @brief An image of the render target, shared by attachments whose lifetimes do not overlap
+	 */
+	struct GraphImage
+	{
+		VkFormat format{VK_FORMAT_UNDEFINED};
+
+		VkImageUsageFlags usage{0};
+
+		std::vector<uint32_t> attachments;
+	};
+
+	struct GraphBarrier
+	{
+		uint32_t image_index;
+
+		ImageMemoryBarrier barrier;
+	};
+
+	void assign_images();
+
+	void build_render_pipelines();
+
+	std::vector<GraphAttachment> attachments;
+
+	std::vector<std::unique_ptr<Pass>> passes;
+
+	std::vector<GraphImage> images;
+
+	/// Index of the first pass of each render pass, followed by the pass count
+	std::vector<size_t> render_pass_offsets;
+
+	/// Barriers recorded before each render pass, the last entry after the last render pass
+	std::vector<std::vector<GraphBarrier>> barriers;
+
+	std::vector<std::unique_ptr<RenderPipeline>> render_pipelines;
+
+	uint32_t depth_attachment{VK_ATTACHMENT_UNUSED};
+
+	bool compiled{false};
+};
+}        // namespace vkb
@@ -20,6 +20,11 @@
 
 #include "render_pipeline.h"
 
+#include "core/device.h"
+#include "cpu_profiler.h"
+#include "job_system.h"
+#include "timer.h"
+
 #include "scene_graph/components/camera.h"
 #include "scene_graph/components/image.h"
 #include "scene_graph/components/material.h"
@@ -78,8 +83,57 @@ void RenderPipeline::set_clear_value(const std::vector<VkClearValue> &cv)
 	clear_value = cv;
 }
 
+size_t RenderPipeline::prewarm(RenderTarget &render_target)
+{
+	assert(!subpasses.empty() && "Render pipeline should contain at least one sub-pass");
+
+	Timer timer;
+	timer.start();
+
+	// Same render pass as the one draw() begins
+	std::vector<SubpassInfo> subpass_infos(subpasses.size());
+
+	for (size_t i = 0; i < subpasses.size(); ++i)
+	{
+		subpass_infos[i].input_attachments          = subpasses[i]->get_input_attachments();
+		subpass_infos[i].output_attachments         = subpasses[i]->get_output_attachments();
+		subpass_infos[i].color_resolve_attachments  = subpasses[i]->get_color_resolve_attachments();
+		subpass_infos[i].rasterization_order_access = subpasses[i]->uses_rasterization_order_access();
+		subpass_infos[i].shading_rate_attachment    = subpasses[i]->get_shading_rate_attachment();
+		subpass_infos[i].shading_rate_texel_size    = subpasses[i]->get_shading_rate_texel_size();
+		subpass_infos[i].view_mask                  = subpasses[i]->get_view_mask();
+	}
+
+	auto &resource_cache = subpasses[0]->get_render_context().get_device().get_resource_cache();
+
+	auto &render_pass = resource_cache.request_render_pass(render_target.get_attachments(), load_store, subpass_infos);
+
+	std::vector<PipelineState> pipeline_states;
+
+	for (size_t i = 0; i < subpasses.size(); ++i)
+	{
+		auto first_state = pipeline_states.size();
+
+		subpasses[i]->prewarm(render_pass, to_u32(i), pipeline_states);
+
+		// The subpass draws with its shading rate, set by draw()
+		for (auto j = first_state; j < pipeline_states.size(); ++j)
+		{
+			pipeline_states[j].set_fragment_shading_rate_state(subpasses[i]->get_fragment_shading_rate_state());
+		}
+	}
+
+	resource_cache.request_graphics_pipelines(pipeline_states);
+
+	LOGI("Prewarmed {} graphics pipelines in {:.1f} ms", pipeline_states.size(), timer.stop<Timer::Milliseconds>());
+
+	return pipeline_states.size();
+}
+
 void RenderPipeline::draw(CommandBuffer &command_buffer, RenderTarget &render_target, VkSubpassContents contents)
 {
+	VKB_PROFILE_FUNCTION();
+
 	assert(!subpasses.empty() && "Render pipeline should contain at least one sub-pass");
 
 	// Pad clear values if they're less than render target attachments
@@ -88,6 +142,21 @@ void RenderPipeline::draw(CommandBuffer &command_buffer, RenderTarget &render_ta
 		clear_value.push_back({0.0f, 0.0f, 0.0f, 1.0f});
 	}
 
+	for (auto &subpass : subpasses)
+	{
+		subpass->pre_draw(command_buffer);
+	}
+
+	auto &render_frame = subpasses[0]->get_render_context().get_active_frame();
+
+	// The jobs allocate from the frame resources of the thread running them
+	bool parallel = job_system && subpasses.size() > 1 && contents == VK_SUBPASS_CONTENTS_INLINE &&
+	                render_frame.get_thread_count() >= job_system->get_thread_count();
+
+	FrameVector<CommandBuffer *> secondary_command_buffers(parallel ? subpasses.size() : 0, nullptr, &render_frame.get_arena());
+
+	JobSystem::Counter counter;
+
 	for (size_t i = 0; i < subpasses.size(); ++i)
 	{
 		active_subpass_index = i;
@@ -96,21 +165,124 @@ void RenderPipeline::draw(CommandBuffer &command_buffer, RenderTarget &render_ta
 
 		subpass->update_render_target_attachments();
 
+		auto subpass_contents = parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS :
+		                                   contents == VK_SUBPASS_CONTENTS_INLINE ? subpass->get_contents() : contents;
+
 		if (i == 0)
 		{
-			command_buffer.begin_render_pass(render_target, load_store, clear_value, subpasses, contents);
+			command_buffer.begin_render_pass(render_target, load_store, clear_value, subpasses, subpass_contents);
+
+			// Secondary command buffers can only inherit the render pass once it has begun, the jobs only read
+			// its binding and render area, which the primary keeps until the render pass ends
+			for (size_t j = 0; parallel && j < subpasses.size(); ++j)
+			{
+				// Secondary command buffers cannot be nested
+				if (subpasses[j]->get_contents() != VK_SUBPASS_CONTENTS_INLINE)
+				{
+					continue;
+				}
+
+				job_system->run(
+				    [this, &command_buffer, &secondary_command_buffers, j](size_t thread_index) {
+					    secondary_command_buffers[j] = &record_subpass(command_buffer, j, thread_index);
+				    },
+				    &counter);
+			}
+		}
+		else
+		{
+			command_buffer.next_subpass(subpass_contents);
+		}
+
+		// Timestamps cannot be written in the primary command buffer if the subpass uses secondary ones
+		if (subpass_contents == VK_SUBPASS_CONTENTS_INLINE)
+		{
+			command_buffer.begin_gpu_scope(subpass->get_debug_name(), true);
+
+			command_buffer.begin_debug_label(subpass->get_debug_name());
+		}
+
+		if (last_subpass_callback && i == subpasses.size() - 1)
+		{
+			last_subpass_callback(command_buffer, subpass_contents);
+		}
+
+		if (parallel && subpass->get_contents() == VK_SUBPASS_CONTENTS_INLINE)
+		{
+			// Helps recording the subpasses left, the following ones are then recorded as well
+			job_system->wait(counter);
+
+			command_buffer.execute_commands(*secondary_command_buffers[i]);
 		}
 		else
 		{
-			command_buffer.next_subpass();
+			VKB_PROFILE_SCOPE(subpass->get_debug_name());
+
+			command_buffer.set_fragment_shading_rate_state(subpass->get_fragment_shading_rate_state());
+
+			subpass->draw(command_buffer);
+
+			// Draws recorded after the subpass, such as the gui, shade every pixel
+			command_buffer.set_fragment_shading_rate_state({});
 		}
 
-		subpass->draw(command_buffer);
+		if (subpass_contents == VK_SUBPASS_CONTENTS_INLINE)
+		{
+			command_buffer.end_debug_label();
+
+			command_buffer.end_gpu_scope();
+		}
 	}
 
 	active_subpass_index = 0;
 }
 
+CommandBuffer &RenderPipeline::record_subpass(CommandBuffer &primary_command_buffer, size_t subpass_index, size_t thread_index)
+{
+	auto &subpass = subpasses[subpass_index];
+
+	VKB_PROFILE_SCOPE(subpass->get_debug_name());
+
+	auto &render_context = subpass->get_render_context();
+
+	const auto &queue = render_context.get_device().get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+
+	auto &command_buffer = render_context.get_active_frame().request_command_buffer(queue, CommandBuffer::ResetMode::ResetPool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, thread_index);
+
+	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, primary_command_buffer, to_u32(subpass_index));
+
+	command_buffer.begin_debug_label(subpass->get_debug_name());
+
+	command_buffer.set_fragment_shading_rate_state(subpass->get_fragment_shading_rate_state());
+
+	auto pipeline_thread_index = subpass->get_thread_index();
+
+	subpass->set_thread_index(thread_index);
+
+	subpass->draw(command_buffer);
+
+	subpass->set_thread_index(pipeline_thread_index);
+
+	command_buffer.end_debug_label();
+
+	command_buffer.end();
+
+	return command_buffer;
+}
+
+void RenderPipeline::set_job_system(JobSystem *jobs)
+{
+	job_system = jobs;
+}
+
+void RenderPipeline::set_thread_index(size_t thread_index)
+{
+	for (auto &subpass : subpasses)
+	{
+		subpass->set_thread_index(thread_index);
+	}
+}
+
 void RenderPipeline::set_use_dynamic_resources(bool dynamic)
 {
 	for (auto &subpass : subpasses)
@@ -119,6 +291,11 @@ void RenderPipeline::set_use_dynamic_resources(bool dynamic)
 	}
 }
 
+void RenderPipeline::set_last_subpass_callback(std::function<void(CommandBuffer &, VkSubpassContents)> &&callback)
+{
+	last_subpass_callback = std::move(callback);
+}
+
 std::unique_ptr<Subpass> &RenderPipeline::get_active_subpass()
 {
 	return subpasses[active_subpass_index];
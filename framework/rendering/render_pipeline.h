@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include "common/helpers.h"
 #include "common/utils.h"
 #include "core/buffer.h"
@@ -28,6 +30,8 @@
 
 namespace vkb
 {
+class JobSystem;
+
 /**
  * @brief A RenderPipeline is a sequence of Subpass objects.
  * Subpass holds shaders and can draw the core::sg::Scene.
@@ -84,9 +88,18 @@ class RenderPipeline
 
 	/**
 	 * @brief Record draw commands for each Subpass
+	 * @param contents Contents of all the subpasses, if inline each subpass provides its own
 	 */
 	void draw(CommandBuffer &command_buffer, RenderTarget &render_target, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 
+	/**
+	 * @brief Builds the render pass and the graphics pipelines the subpasses report they will draw with,
+	 *        so that the first frames do not stall on them
+	 * @param render_target A render target like the ones the pipeline will draw to
+	 * @return The number of pipeline states reported by the subpasses
+	 */
+	size_t prewarm(RenderTarget &render_target);
+
 	/**
 	 * @return Subpass currently being recorded, or the first one
 	 *         if drawing has not started
@@ -95,7 +108,34 @@ class RenderPipeline
 
 	void set_use_dynamic_resources(bool dynamic);
 
+	/**
+	 * @brief Sets a function called by draw once the last subpass has begun, before the subpass draws.
+	 *        It may start recording secondary command buffers to be executed in that subpass once it has drawn
+	 * @param callback Function taking the command buffer and the contents of the last subpass, or null
+	 */
+	void set_last_subpass_callback(std::function<void(CommandBuffer &, VkSubpassContents)> &&callback);
+
+	/**
+	 * @brief Records the subpasses drawing inline in secondary command buffers on the threads of a job system,
+	 *        executed in order by the primary once recorded. Subpasses recording their own secondary command
+	 *        buffers draw on the calling thread. Only used if the pipeline has more than one subpass and the
+	 *        render context is prepared with the thread count of the job system. Set null to record inline
+	 */
+	void set_job_system(JobSystem *jobs);
+
+	/**
+	 * @brief Sets the index of the thread recording the pipeline, whose frame resources the subpasses allocate from,
+	 *        for a pipeline recorded on a thread of a job system such as with RenderContext::record_async
+	 */
+	void set_thread_index(size_t thread_index);
+
   private:
+	/**
+	 * @brief Records a subpass in a secondary command buffer continuing the render pass of the primary
+	 * @param thread_index Index of the thread recording, whose frame resources the subpass allocates from
+	 */
+	CommandBuffer &record_subpass(CommandBuffer &primary_command_buffer, size_t subpass_index, size_t thread_index);
+
 	std::vector<std::unique_ptr<Subpass>> subpasses;
 
 	/// Default to two load store
@@ -105,5 +145,9 @@ class RenderPipeline
 	std::vector<VkClearValue> clear_value = std::vector<VkClearValue>(2);
 
 	size_t active_subpass_index{0};
+
+	std::function<void(CommandBuffer &, VkSubpassContents)> last_subpass_callback;
+
+	JobSystem *job_system{nullptr};
 };
 }        // namespace vkb
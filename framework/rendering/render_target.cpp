@@ -43,7 +43,7 @@ Attachment::Attachment(VkFormat format, VkSampleCountFlagBits samples, VkImageUs
 }
 const RenderTarget::CreateFunc RenderTarget::DEFAULT_CREATE_FUNC = [](core::Image &&swapchain_image) -> RenderTarget {
 	core::Image depth_image{swapchain_image.get_device(), swapchain_image.get_extent(),
-	                        VK_FORMAT_D32_SFLOAT,
+	                        swapchain_image.get_device().get_depth_format(),
 	                        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
 	                        VMA_MEMORY_USAGE_GPU_ONLY};
 
@@ -54,6 +54,61 @@ const RenderTarget::CreateFunc RenderTarget::DEFAULT_CREATE_FUNC = [](core::Imag
 	return RenderTarget{std::move(images)};
 };
 
+RenderTarget::CreateFunc RenderTarget::create_multisampled_func(VkSampleCountFlagBits samples, bool transient)
+{
+	return [samples, transient](core::Image &&swapchain_image) -> RenderTarget {
+		auto &device = swapchain_image.get_device();
+		auto  extent = swapchain_image.get_extent();
+
+		// Depth is never resolved, so its samples are discarded at the end of the render pass
+		core::Image depth_image{device, extent,
+		                        device.get_depth_format(),
+		                        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+		                        VMA_MEMORY_USAGE_GPU_ONLY,
+		                        samples};
+
+		VkImageUsageFlags color_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		color_usage |= transient ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+		core::Image color_image{device, extent, swapchain_image.get_format(), color_usage, VMA_MEMORY_USAGE_GPU_ONLY, samples};
+
+		std::vector<core::Image> images;
+		images.push_back(std::move(swapchain_image));
+		images.push_back(std::move(depth_image));
+		images.push_back(std::move(color_image));
+
+		return RenderTarget{std::move(images)};
+	};
+}
+
+RenderTarget::CreateFunc RenderTarget::create_weighted_blended_func()
+{
+	return [](core::Image &&swapchain_image) -> RenderTarget {
+		auto &device = swapchain_image.get_device();
+		auto  extent = swapchain_image.get_extent();
+
+		core::Image depth_image{device, extent,
+		                        device.get_depth_format(),
+		                        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+		                        VMA_MEMORY_USAGE_GPU_ONLY};
+
+		// Written and read back as input attachments within the render pass
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+		core::Image accumulation_image{device, extent, VK_FORMAT_R16G16B16A16_SFLOAT, usage, VMA_MEMORY_USAGE_GPU_ONLY};
+
+		core::Image revealage_image{device, extent, VK_FORMAT_R8_UNORM, usage, VMA_MEMORY_USAGE_GPU_ONLY};
+
+		std::vector<core::Image> images;
+		images.push_back(std::move(swapchain_image));
+		images.push_back(std::move(depth_image));
+		images.push_back(std::move(accumulation_image));
+		images.push_back(std::move(revealage_image));
+
+		return RenderTarget{std::move(images)};
+	};
+}
+
 RenderTarget &RenderTarget::operator=(RenderTarget &&other) noexcept
 {
 	if (this != &other)
@@ -67,14 +122,31 @@ RenderTarget &RenderTarget::operator=(RenderTarget &&other) noexcept
 		}
 
 		std::swap(extent, other.extent);
+		std::swap(render_extent, other.render_extent);
+		std::swap(layers, other.layers);
 		std::swap(images, other.images);
+		std::swap(image_extents, other.image_extents);
 		std::swap(views, other.views);
 		std::swap(attachments, other.attachments);
 		std::swap(output_attachments, other.output_attachments);
+
+		// The old views are released with their framebuffers when other is destroyed
+		std::swap(view_handles, other.view_handles);
+		std::swap(views_hash, other.views_hash);
+		std::swap(framebuffer_attachments, other.framebuffer_attachments);
 	}
 	return *this;
 }
 
+RenderTarget::~RenderTarget()
+{
+	// Empty once moved from
+	if (!view_handles.empty())
+	{
+		device.get_resource_cache().release_framebuffers(view_handles);
+	}
+}
+
 vkb::RenderTarget::RenderTarget(std::vector<core::Image> &&images) :
     device{images.back().get_device()},
     images{std::move(images)}
@@ -86,8 +158,16 @@ vkb::RenderTarget::RenderTarget(std::vector<core::Image> &&images) :
 	// Returns the image extent as a VkExtent2D structure from a VkExtent3D
 	auto get_image_extent = [](const core::Image &image) { return VkExtent2D{image.get_extent().width, image.get_extent().height}; };
 
-	// Constructs a set of unique image extens given a vector of images
-	std::transform(this->images.begin(), this->images.end(), std::inserter(unique_extent, unique_extent.end()), get_image_extent);
+	// Constructs a set of unique image extens given a vector of images, shading rate attachments are smaller
+	for (auto &image : this->images)
+	{
+		image_extents.push_back(get_image_extent(image));
+
+		if (!(image.get_usage() & VK_IMAGE_USAGE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR))
+		{
+			unique_extent.insert(image_extents.back());
+		}
+	}
 
 	// Allow only one extent size for a render target
 	if (unique_extent.size() != 1)
@@ -95,7 +175,9 @@ vkb::RenderTarget::RenderTarget(std::vector<core::Image> &&images) :
 		throw VulkanException{VK_ERROR_INITIALIZATION_FAILED, "Extent size is not unique"};
 	}
 
-	extent = *unique_extent.begin();
+	extent        = *unique_extent.begin();
+	render_extent = extent;
+	layers        = this->images.front().get_subresource().arrayLayer;
 
 	for (auto &image : this->images)
 	{
@@ -104,10 +186,50 @@ vkb::RenderTarget::RenderTarget(std::vector<core::Image> &&images) :
 			throw VulkanException{VK_ERROR_INITIALIZATION_FAILED, "Image type is not 2D"};
 		}
 
-		views.emplace_back(image, VK_IMAGE_VIEW_TYPE_2D);
+		if (image.get_subresource().arrayLayer != layers)
+		{
+			throw VulkanException{VK_ERROR_INITIALIZATION_FAILED, "Array layer count is not unique"};
+		}
+
+		// Multiview subpasses render to all the layers of the views
+		views.emplace_back(image, layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D);
 
 		attachments.emplace_back(Attachment{image.get_format(), image.get_sample_count(), image.get_usage()});
 	}
+
+	update_framebuffer_keys();
+}
+
+void RenderTarget::update_framebuffer_keys()
+{
+	view_handles.clear();
+	views_hash = 0;
+
+	for (auto &view : views)
+	{
+		view_handles.push_back(view.get_handle());
+
+		hash_combine(views_hash, view.get_handle());
+	}
+
+	framebuffer_attachments.extent      = extent;
+	framebuffer_attachments.attachments = attachments;
+	framebuffer_attachments.extents     = image_extents;
+	framebuffer_attachments.layers      = layers;
+	framebuffer_attachments.hash        = 0;
+
+	hash_combine(framebuffer_attachments.hash, extent.width);
+	hash_combine(framebuffer_attachments.hash, extent.height);
+	hash_combine(framebuffer_attachments.hash, layers);
+
+	for (size_t i = 0; i < attachments.size(); ++i)
+	{
+		hash_combine(framebuffer_attachments.hash, static_cast<uint32_t>(attachments[i].format));
+		hash_combine(framebuffer_attachments.hash, static_cast<uint32_t>(attachments[i].samples));
+		hash_combine(framebuffer_attachments.hash, attachments[i].usage);
+		hash_combine(framebuffer_attachments.hash, image_extents[i].width);
+		hash_combine(framebuffer_attachments.hash, image_extents[i].height);
+	}
 }
 
 const VkExtent2D &RenderTarget::get_extent() const
@@ -115,6 +237,22 @@ const VkExtent2D &RenderTarget::get_extent() const
 	return extent;
 }
 
+uint32_t RenderTarget::get_layers() const
+{
+	return layers;
+}
+
+void RenderTarget::set_render_extent(const VkExtent2D &new_render_extent)
+{
+	render_extent.width  = std::max(1U, std::min(new_render_extent.width, extent.width));
+	render_extent.height = std::max(1U, std::min(new_render_extent.height, extent.height));
+}
+
+const VkExtent2D &RenderTarget::get_render_extent() const
+{
+	return render_extent;
+}
+
 const std::vector<core::ImageView> &RenderTarget::get_views() const
 {
 	return views;
@@ -125,6 +263,21 @@ const std::vector<Attachment> &RenderTarget::get_attachments() const
 	return attachments;
 }
 
+const std::vector<VkImageView> &RenderTarget::get_view_handles() const
+{
+	return view_handles;
+}
+
+std::size_t RenderTarget::get_views_hash() const
+{
+	return views_hash;
+}
+
+const FramebufferAttachments &RenderTarget::get_framebuffer_attachments() const
+{
+	return framebuffer_attachments;
+}
+
 void RenderTarget::set_input_attachments(std::vector<uint32_t> &input)
 {
 	input_attachments = input;
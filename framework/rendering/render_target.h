@@ -46,6 +46,26 @@ struct Attachment
 	Attachment(VkFormat format, VkSampleCountFlagBits samples, VkImageUsageFlags usage);
 };
 
+/**
+ * @brief What an imageless framebuffer is created for: the extent and the formats and usages of the attachments,
+ *        so that it is shared by the render targets of all the swapchain images
+ */
+struct FramebufferAttachments
+{
+	VkExtent2D extent{};
+
+	std::vector<Attachment> attachments;
+
+	/// Extent of each attachment, smaller than the framebuffer for shading rate attachments
+	std::vector<VkExtent2D> extents;
+
+	/// Array layers of the attachments, the views of multiview subpasses
+	uint32_t layers{1};
+
+	/// Hash of the extents and attachments, computed when they change
+	std::size_t hash{0};
+};
+
 /**
  * @brief RenderTarget contains three vectors for: core::Image, core::ImageView and Attachment.
  * The first two are Vulkan images and corresponding image views respectively.
@@ -62,22 +82,88 @@ class RenderTarget
 
 	static const CreateFunc DEFAULT_CREATE_FUNC;
 
+	/// Image of the multisampled color in the render targets of create_multisampled_func
+	static const uint32_t MULTISAMPLED_COLOR = 2;
+
+	/**
+	 * @brief Returns a function creating render targets of the swapchain image (0), a multisampled depth image (1)
+	 *        and a multisampled color image (MULTISAMPLED_COLOR), which subpasses render to and resolve to image 0
+	 * @param samples Sample count of the depth and color images
+	 * @param transient If true the color image lives in tile memory only and must be resolved by a resolve attachment,
+	 *        otherwise it can be stored and resolved with CommandBuffer::resolve_image
+	 */
+	static CreateFunc create_multisampled_func(VkSampleCountFlagBits samples, bool transient = true);
+
+	/// Images of the accumulation and revealage in the render targets of create_weighted_blended_func
+	static const uint32_t WEIGHTED_BLENDED_ACCUMULATION = 2;
+
+	static const uint32_t WEIGHTED_BLENDED_REVEALAGE = 3;
+
+	/**
+	 * @brief Returns a function creating render targets of the swapchain image (0), a depth image (1), and the accumulation
+	 *        (WEIGHTED_BLENDED_ACCUMULATION) and revealage (WEIGHTED_BLENDED_REVEALAGE) images of weighted blended
+	 *        transparency, see WeightedBlendedSubpass. The images besides the swapchain one live in tile memory only
+	 */
+	static CreateFunc create_weighted_blended_func();
+
+	/**
+	 * @brief Creates a render target of images with the same extent, except for shading rate attachments
+	 *        (VK_IMAGE_USAGE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR) which have one texel per shading rate texel.
+	 *        The images may have several array layers, all the same number, viewed as arrays for multiview subpasses
+	 */
 	RenderTarget(std::vector<core::Image> &&images);
 
 	RenderTarget(const RenderTarget &) = delete;
 
 	RenderTarget(RenderTarget &&) = default;
 
+	/**
+	 * @brief Releases the framebuffers created with the views of the render target, before the views are destroyed
+	 */
+	~RenderTarget();
+
 	RenderTarget &operator=(const RenderTarget &other) noexcept = delete;
 
 	RenderTarget &operator=(RenderTarget &&other) noexcept;
 
 	const VkExtent2D &get_extent() const;
 
+	/**
+	 * @brief Sets the area which render passes render to, from the origin of the images,
+	 *        so that the render resolution changes without recreating images and framebuffers
+	 * @param render_extent The extent rendered to, clamped to the extent of the images
+	 */
+	void set_render_extent(const VkExtent2D &render_extent);
+
+	/**
+	 * @return The extent rendered to, which is the extent of the images unless scaled down
+	 */
+	const VkExtent2D &get_render_extent() const;
+
+	/**
+	 * @return The array layers of the images, the views a multiview subpass can render to
+	 */
+	uint32_t get_layers() const;
+
 	const std::vector<core::ImageView> &get_views() const;
 
 	const std::vector<Attachment> &get_attachments() const;
 
+	/**
+	 * @return The handles of the views, in attachment order
+	 */
+	const std::vector<VkImageView> &get_view_handles() const;
+
+	/**
+	 * @return The hash of the view handles, computed when the views change
+	 */
+	std::size_t get_views_hash() const;
+
+	/**
+	 * @return The description of the attachments which imageless framebuffers are created for
+	 */
+	const FramebufferAttachments &get_framebuffer_attachments() const;
+
 	/**
 	 * @brief Sets the current input attachments overwriting the current ones
 	 *        Should be set before beginning the render pass and before starting a new subpass
@@ -101,12 +187,28 @@ class RenderTarget
 
 	VkExtent2D extent{};
 
+	VkExtent2D render_extent{};
+
+	uint32_t layers{1};
+
 	std::vector<core::Image> images;
 
+	/// Extent of each image
+	std::vector<VkExtent2D> image_extents;
+
 	std::vector<core::ImageView> views;
 
 	std::vector<Attachment> attachments;
 
+	/// Framebuffer lookup keys, updated whenever the views change
+	std::vector<VkImageView> view_handles;
+
+	std::size_t views_hash{0};
+
+	FramebufferAttachments framebuffer_attachments;
+
+	void update_framebuffer_keys();
+
 	/// By default there are no input attachments
 	std::vector<uint32_t> input_attachments = {};
 
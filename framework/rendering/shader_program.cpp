@@ -45,6 +45,14 @@ ShaderProgram::ShaderProgram(const std::vector<ShaderModule *> &shader_modules)
 			{
 				// Append stage flags if resource already exists
 				it->second.stages |= shader_resource.stages;
+
+				it->second.push_descriptor   = it->second.push_descriptor || shader_resource.push_descriptor;
+				it->second.update_after_bind = it->second.update_after_bind || shader_resource.update_after_bind;
+
+				if (it->second.immutable_sampler == VK_NULL_HANDLE)
+				{
+					it->second.immutable_sampler = shader_resource.immutable_sampler;
+				}
 			}
 			else
 			{
@@ -54,12 +62,17 @@ ShaderProgram::ShaderProgram(const std::vector<ShaderModule *> &shader_modules)
 		}
 	}
 
+	resources_by_type.resize(static_cast<size_t>(ShaderResourceType::All) + 1);
+
 	// Sift through the map of name indexed shader resources
 	// Seperate them into their respective sets
 	for (auto &it : resources)
 	{
 		auto &shader_resource = it.second;
 
+		resources_by_type[static_cast<size_t>(shader_resource.type)].push_back(shader_resource);
+		resources_by_type[static_cast<size_t>(ShaderResourceType::All)].push_back(shader_resource);
+
 		// Find binding by set index in the map.
 		auto it2 = sets.find(shader_resource.set);
 
@@ -83,24 +96,31 @@ const std::vector<ShaderModule *> &ShaderProgram::get_shader_modules() const
 
 const std::vector<ShaderResource> ShaderProgram::get_resources(const ShaderResourceType &type, VkShaderStageFlagBits stage) const
 {
-	std::vector<ShaderResource> found_resources;
+	auto &type_resources = get_resources_by_type(type);
 
-	for (auto &it : resources)
+	if (stage == VK_SHADER_STAGE_ALL)
 	{
-		auto &shader_resource = it.second;
+		return type_resources;
+	}
 
-		if (shader_resource.type == type || type == ShaderResourceType::All)
+	std::vector<ShaderResource> found_resources;
+
+	for (auto &shader_resource : type_resources)
+	{
+		if (shader_resource.stages == stage)
 		{
-			if (shader_resource.stages == stage || stage == VK_SHADER_STAGE_ALL)
-			{
-				found_resources.push_back(shader_resource);
-			}
+			found_resources.push_back(shader_resource);
 		}
 	}
 
 	return found_resources;
 }
 
+const std::vector<ShaderResource> &ShaderProgram::get_resources_by_type(ShaderResourceType type) const
+{
+	return resources_by_type[static_cast<size_t>(type)];
+}
+
 const std::unordered_map<uint32_t, std::vector<ShaderResource>> &ShaderProgram::get_shader_sets() const
 {
 	return sets;
@@ -53,6 +53,12 @@ class ShaderProgram
 
 	const std::vector<ShaderResource> get_resources(const ShaderResourceType &type = ShaderResourceType::All, VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL) const;
 
+	/**
+	 * @return The resources of a type, of all stages, from the tables built with the program.
+	 *         Unlike get_resources it does not copy them, for lookups while recording draws
+	 */
+	const std::vector<ShaderResource> &get_resources_by_type(ShaderResourceType type) const;
+
 	const std::unordered_map<uint32_t, std::vector<ShaderResource>> &get_shader_sets() const;
 
   private:
@@ -64,5 +70,8 @@ class ShaderProgram
 
 	// A map of each set and the resources it owns used by the shader program
 	std::unordered_map<uint32_t, std::vector<ShaderResource>> sets;
+
+	/// Resources indexed by type, ShaderResourceType::All holding all of them
+	std::vector<std::vector<ShaderResource>> resources_by_type;
 };
 }        // namespace vkb
@@ -0,0 +1,132 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/shadow_map.h"
+
+#include "core/command_buffer.h"
+#include "rendering/render_context.h"
+
+namespace vkb
+{
+const VkFormat ShadowMap::DEPTH_FORMAT = VK_FORMAT_D16_UNORM;
+
+ShadowMap::ShadowMap(RenderContext &render_context, sg::Scene &scene, sg::Camera &camera, sg::Light &light, const ShadowOptions &options) :
+    render_context{render_context}
+{
+	auto shadow_subpass = std::make_unique<ShadowSubpass>(render_context, scene, camera, light, options);
+	subpass             = shadow_subpass.get();
+
+	auto &device = render_context.get_device();
+
+	auto atlas_extent = subpass->get_atlas_extent();
+
+	std::vector<core::Image> images;
+	images.emplace_back(device,
+	                    VkExtent3D{atlas_extent.width, atlas_extent.height, 1},
+	                    DEPTH_FORMAT,
+	                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	                    VMA_MEMORY_USAGE_GPU_ONLY);
+
+	render_target = std::make_unique<RenderTarget>(std::move(images));
+
+	render_pipeline = std::make_unique<RenderPipeline>();
+	render_pipeline->add_subpass(std::move(shadow_subpass));
+
+	// Cached cascades are loaded, the rendered ones are cleared by the subpass
+	render_pipeline->set_load_store({{VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE}});
+
+	VkClearValue depth_clear{};
+	depth_clear.depthStencil = {0.0f, ~0U};
+	render_pipeline->set_clear_value({depth_clear});
+
+	// Reference depths closer to the light than the atlas are lit, and the filtering averages the comparison of four texels
+	VkSamplerCreateInfo sampler_info{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+	sampler_info.magFilter     = VK_FILTER_LINEAR;
+	sampler_info.minFilter     = VK_FILTER_LINEAR;
+	sampler_info.mipmapMode    = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_info.addressModeU  = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeV  = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeW  = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.compareEnable = VK_TRUE;
+	sampler_info.compareOp     = VK_COMPARE_OP_GREATER_OR_EQUAL;
+
+	sampler = &device.get_resource_cache().request_sampler(sampler_info);
+}
+
+void ShadowMap::draw(CommandBuffer &command_buffer)
+{
+	subpass->update_cascades();
+
+	// The atlas stays readable while every cascade is cached
+	if (!subpass->has_rendered_cascades())
+	{
+		return;
+	}
+
+	auto &atlas_view = render_target->get_views().at(0);
+
+	{
+		// Reads of the previous frame complete before the atlas is written
+		ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = initialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		memory_barrier.src_access_mask = 0;
+		memory_barrier.dst_access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+		command_buffer.image_memory_barrier(atlas_view, memory_barrier);
+	}
+
+	render_pipeline->draw(command_buffer, *render_target);
+
+	command_buffer.end_render_pass();
+
+	{
+		ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		memory_barrier.src_access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+		command_buffer.image_memory_barrier(atlas_view, memory_barrier);
+	}
+
+	initialized = true;
+}
+
+void ShadowMap::bind(CommandBuffer &command_buffer, uint32_t set, uint32_t first_binding, size_t thread_index)
+{
+	assert(initialized && "Shadow map must be drawn before it is bound");
+
+	auto allocation = render_context.get_active_frame().allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(ShadowUniform), thread_index);
+	allocation.update(subpass->get_uniform());
+
+	command_buffer.bind_image(render_target->get_views().at(0), *sampler, set, first_binding, 0);
+	command_buffer.bind_buffer(allocation.get_buffer(), allocation.get_offset(), allocation.get_size(), set, first_binding + 1, 0);
+}
+
+ShadowSubpass &ShadowMap::get_subpass()
+{
+	return *subpass;
+}
+}        // namespace vkb
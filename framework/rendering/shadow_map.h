@@ -0,0 +1,80 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "common/vk_common.h"
+#include "core/sampler.h"
+#include "rendering/render_pipeline.h"
+#include "rendering/render_target.h"
+#include "rendering/subpasses/shadow_subpass.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class RenderContext;
+
+/**
+ * @brief Cascaded shadow map of a directional light, rendered to a depth atlas kept across frames
+ *        so that cached cascades are not rendered again. The lighting shaders read two bindings,
+ *        see the SHADOWS path of deferred/lighting.frag: the atlas with a comparison sampler, and the ShadowUniform
+ */
+class ShadowMap
+{
+  public:
+	/// Format of the atlas, the light projection is orthographic so the depth is linear
+	static const VkFormat DEPTH_FORMAT;
+
+	ShadowMap(RenderContext &render_context, sg::Scene &scene, sg::Camera &camera, sg::Light &light, const ShadowOptions &options = {});
+
+	/**
+	 * @brief Renders the cascades which are not cached, and makes the atlas readable by fragment shaders.
+	 *        Must be recorded outside of a render pass, before the passes reading the shadows
+	 */
+	void draw(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Uploads the cascades to the active frame, and binds them after the atlas
+	 * @param command_buffer Command buffer to bind to
+	 * @param set Descriptor set of the bindings
+	 * @param first_binding Binding of the atlas, the uniform follows
+	 * @param thread_index Selects the buffer pools of the frame of the thread recording the command buffer
+	 */
+	void bind(CommandBuffer &command_buffer, uint32_t set, uint32_t first_binding, size_t thread_index = 0);
+
+	ShadowSubpass &get_subpass();
+
+  private:
+	RenderContext &render_context;
+
+	std::unique_ptr<RenderTarget> render_target;
+
+	std::unique_ptr<RenderPipeline> render_pipeline;
+
+	ShadowSubpass *subpass{nullptr};
+
+	const core::Sampler *sampler{nullptr};
+
+	/// Whether the atlas was rendered once, its content is undefined before
+	bool initialized{false};
+};
+}        // namespace vkb
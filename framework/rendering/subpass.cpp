@@ -29,6 +29,16 @@ const std::vector<std::string> light_type_definitions = {
     "POINT_LIGHT " + std::to_string(static_cast<float>(sg::LightType::Point)),
     "SPOT_LIGHT " + std::to_string(static_cast<float>(sg::LightType::Spot))};
 
+std::vector<std::string> get_precision_definitions(ShaderPrecision precision)
+{
+	if (precision == ShaderPrecision::Medium)
+	{
+		return {"MEDIUMP_LIGHTING"};
+	}
+
+	return {};
+}
+
 glm::mat4 vulkan_style_projection(const glm::mat4 &proj)
 {
 	// Flip Y in clipspace. X = -1, Y = -1 is topLeft in Vulkan.
@@ -45,6 +55,19 @@ Subpass::Subpass(RenderContext &render_context, ShaderSource &&vertex_source, Sh
 {
 }
 
+void Subpass::pre_draw(CommandBuffer &command_buffer)
+{
+}
+
+VkSubpassContents Subpass::get_contents() const
+{
+	return VK_SUBPASS_CONTENTS_INLINE;
+}
+
+void Subpass::prewarm(const RenderPass &render_pass, uint32_t subpass_index, std::vector<PipelineState> &pipeline_states)
+{
+}
+
 void Subpass::update_render_target_attachments()
 {
 	auto &render_target = render_context.get_active_frame().get_render_target();
@@ -93,11 +116,82 @@ void Subpass::set_output_attachments(std::vector<uint32_t> output)
 	output_attachments = output;
 }
 
+const std::vector<uint32_t> &Subpass::get_color_resolve_attachments() const
+{
+	return color_resolve_attachments;
+}
+
+void Subpass::set_color_resolve_attachments(std::vector<uint32_t> resolve)
+{
+	color_resolve_attachments = resolve;
+}
+
+bool Subpass::uses_rasterization_order_access() const
+{
+	return rasterization_order_access;
+}
+
+void Subpass::set_rasterization_order_access(bool enable)
+{
+	rasterization_order_access = enable;
+}
+
+uint32_t Subpass::get_shading_rate_attachment() const
+{
+	return shading_rate_attachment;
+}
+
+const VkExtent2D &Subpass::get_shading_rate_texel_size() const
+{
+	return shading_rate_texel_size;
+}
+
+void Subpass::set_shading_rate_attachment(uint32_t attachment, const VkExtent2D &texel_size)
+{
+	shading_rate_attachment = attachment;
+	shading_rate_texel_size = texel_size;
+}
+
+FragmentShadingRateState &Subpass::get_fragment_shading_rate_state()
+{
+	return fragment_shading_rate_state;
+}
+
+uint32_t Subpass::get_view_mask() const
+{
+	return view_mask;
+}
+
+void Subpass::set_view_mask(uint32_t mask)
+{
+	view_mask = mask;
+}
+
 void Subpass::set_use_dynamic_resources(bool b)
 {
 	use_dynamic_resources = b;
 }
 
+const std::string &Subpass::get_debug_name() const
+{
+	return debug_name;
+}
+
+void Subpass::set_debug_name(const std::string &name)
+{
+	debug_name = name;
+}
+
+void Subpass::set_thread_index(size_t index)
+{
+	thread_index = index;
+}
+
+size_t Subpass::get_thread_index() const
+{
+	return thread_index;
+}
+
 void Subpass::add_definitions(ShaderVariant &variant, const std::vector<std::string> &definitions)
 {
 	for (auto &definition : definitions)
@@ -26,6 +26,7 @@
 #include "rendering/pipeline_state.h"
 #include "rendering/render_context.h"
 #include "rendering/render_frame.h"
+#include "scene_graph/component_range.h"
 #include "scene_graph/components/light.h"
 #include "scene_graph/node.h"
 
@@ -54,6 +55,23 @@ glm::mat4 vulkan_style_projection(const glm::mat4 &proj);
 
 extern const std::vector<std::string> light_type_definitions;
 
+/**
+ * @brief Precision of the color and lighting math of pbr.frag and deferred/lighting.frag
+ */
+enum class ShaderPrecision
+{
+	/// 32-bit floats
+	High,
+
+	/// mediump, which drivers can compute with 16-bit floats
+	Medium
+};
+
+/**
+ * @return The definitions selecting a shader precision, to add to the shader variants
+ */
+std::vector<std::string> get_precision_definitions(ShaderPrecision precision);
+
 /**
  * @brief This class defines an interface for subpasses
  *        where they need to implement the draw function.
@@ -89,6 +107,27 @@ class Subpass
 	 */
 	virtual void draw(CommandBuffer &command_buffer) = 0;
 
+	/**
+	 * @brief Records commands which must happen outside of the render pass, such as
+	 *        compute dispatches, before the render pass of this subpass begins
+	 */
+	virtual void pre_draw(CommandBuffer &command_buffer);
+
+	/**
+	 * @return How the commands of this subpass are provided, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+	 *         if draw() only executes secondary command buffers
+	 */
+	virtual VkSubpassContents get_contents() const;
+
+	/**
+	 * @brief Adds the states of the graphics pipelines the subpass will draw with, so that they
+	 *        can be built before the first frame
+	 * @param render_pass The render pass the subpass is part of
+	 * @param subpass_index The index of the subpass in the render pass
+	 * @param[out] pipeline_states The states to append to
+	 */
+	virtual void prewarm(const RenderPass &render_pass, uint32_t subpass_index, std::vector<PipelineState> &pipeline_states);
+
 	RenderContext &get_render_context();
 
 	const ShaderSource &get_vertex_shader() const;
@@ -105,8 +144,69 @@ class Subpass
 
 	void set_output_attachments(std::vector<uint32_t> output);
 
+	const std::vector<uint32_t> &get_color_resolve_attachments() const;
+
+	/**
+	 * @brief Sets the attachments the color outputs are resolved to at the end of the subpass,
+	 *        one per color output. Multisampled outputs resolved this way never leave the tile memory
+	 *        on tile-based GPUs, unlike a vkCmdResolveImage after the render pass
+	 */
+	void set_color_resolve_attachments(std::vector<uint32_t> resolve);
+
+	bool uses_rasterization_order_access() const;
+
+	/**
+	 * @brief Reads the input attachments which are also output attachments in rasterization order, so that a draw
+	 *        reads what the previous draws wrote to the same pixel without a subpass boundary. Only allowed if the device
+	 *        enabled VK_EXT_rasterization_order_attachment_access
+	 */
+	void set_rasterization_order_access(bool enable);
+
+	uint32_t get_shading_rate_attachment() const;
+
+	const VkExtent2D &get_shading_rate_texel_size() const;
+
+	/**
+	 * @brief Reads the shading rates of the subpass from an attachment, one per texel covering texel_size pixels.
+	 *        The rates are only used by pipelines combining them, see get_fragment_shading_rate_state()
+	 * @param attachment The shading rate attachment, VK_ATTACHMENT_UNUSED for none
+	 * @param texel_size The pixels covered by a texel, within the attachment texel sizes of the device
+	 */
+	void set_shading_rate_attachment(uint32_t attachment, const VkExtent2D &texel_size);
+
+	/**
+	 * @return The shading rate the subpass draws with, set on the command buffer before draw()
+	 */
+	FragmentShadingRateState &get_fragment_shading_rate_state();
+
+	uint32_t get_view_mask() const;
+
+	/**
+	 * @brief Broadcasts the draws of the subpass to several views with VK_KHR_multiview, shaders read the view
+	 *        with gl_ViewIndex. Only allowed if the device supports multiview, see Device::supports_multiview().
+	 *        Whether the mask is 0 must be set before prepare(), the views can change between render passes
+	 * @param mask One bit per array layer of the attachments rendered to, 0 to render to the first layer only
+	 */
+	void set_view_mask(uint32_t mask);
+
 	void set_use_dynamic_resources(bool dynamic);
 
+	/**
+	 * @return The name of the subpass, used by the GPU profiler
+	 */
+	const std::string &get_debug_name() const;
+
+	void set_debug_name(const std::string &name);
+
+	/**
+	 * @brief Selects the per-thread resources of the render frame the subpass allocates from while it draws,
+	 *        set by the render pipeline to those of the thread recording the subpass
+	 * @param index Index of the thread, 0 for the thread recording the frame
+	 */
+	void set_thread_index(size_t index);
+
+	size_t get_thread_index() const;
+
 	/**
 	 * @brief Add definitions to shader variant within a subpass
 	 * 
@@ -124,7 +224,7 @@ class Subpass
 	 * @return BufferAllocation A buffer allocation created for use in shaders
 	 */
 	template <typename T>
-	BufferAllocation allocate_lights(const std::vector<sg::Light *> &scene_lights, size_t max_lights)
+	BufferAllocation allocate_lights(const sg::ComponentRange<sg::Light> &scene_lights, size_t max_lights)
 	{
 		assert(scene_lights.size() <= max_lights && "Exceeding Max Light Capacity");
 
@@ -135,14 +235,14 @@ class Subpass
 			const auto &properties = light->get_properties();
 			auto &      transform  = light->get_node()->get_transform();
 
-			return {{transform.get_translation(), static_cast<float>(light->get_light_type())},
+			return {{transform.get_render_state().translation, static_cast<float>(light->get_light_type())},
 			        {properties.color, properties.intensity},
-			        {transform.get_rotation() * properties.direction, properties.range},
+			        {transform.get_render_state().rotation * properties.direction, properties.range},
 			        {properties.inner_cone_angle, properties.outer_cone_angle}};
 		});
 
 		auto &           render_frame = get_render_context().get_active_frame();
-		BufferAllocation light_buffer = render_frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(T));
+		BufferAllocation light_buffer = render_frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(T), thread_index);
 		light_buffer.update(light_info);
 
 		return light_buffer;
@@ -158,7 +258,7 @@ class Subpass
 	 * @return BufferAllocation A buffer allocation created for use in shaders
 	 */
 	template <typename T>
-	BufferAllocation allocate_set_num_lights(const std::vector<sg::Light *> &scene_lights, size_t num_lights)
+	BufferAllocation allocate_set_num_lights(const sg::ComponentRange<sg::Light> &scene_lights, size_t num_lights)
 	{
 		T light_info;
 		light_info.count = to_u32(num_lights);
@@ -170,16 +270,16 @@ class Subpass
 			const auto &properties = light->get_properties();
 			auto &      transform  = light->get_node()->get_transform();
 
-			lights_vector.push_back(Light({{transform.get_translation(), static_cast<float>(light->get_light_type())},
+			lights_vector.push_back(Light({{transform.get_render_state().translation, static_cast<float>(light->get_light_type())},
 			                               {properties.color, properties.intensity},
-			                               {transform.get_rotation() * properties.direction, properties.range},
+			                               {transform.get_render_state().rotation * properties.direction, properties.range},
 			                               {properties.inner_cone_angle, properties.outer_cone_angle}}));
 		}
 
 		std::copy(lights_vector.begin(), lights_vector.end(), light_info.lights);
 
 		auto &           render_frame = get_render_context().get_active_frame();
-		BufferAllocation light_buffer = render_frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(T));
+		BufferAllocation light_buffer = render_frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(T), thread_index);
 		light_buffer.update(light_info);
 
 		return light_buffer;
@@ -191,6 +291,10 @@ class Subpass
 	bool use_dynamic_resources{false};
 
   private:
+	std::string debug_name{"Subpass"};
+
+	size_t thread_index{0};
+
 	ShaderSource vertex_shader;
 
 	ShaderSource fragment_shader;
@@ -202,6 +306,19 @@ class Subpass
 
 	/// Default to swapchain output attachment
 	std::vector<uint32_t> output_attachments = {0};
+
+	/// Default to no resolve attachments
+	std::vector<uint32_t> color_resolve_attachments = {};
+
+	bool rasterization_order_access{false};
+
+	uint32_t shading_rate_attachment{VK_ATTACHMENT_UNUSED};
+
+	VkExtent2D shading_rate_texel_size{};
+
+	FragmentShadingRateState fragment_shading_rate_state{};
+
+	uint32_t view_mask{0};
 };
 
 }        // namespace vkb
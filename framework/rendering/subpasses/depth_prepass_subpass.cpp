@@ -0,0 +1,101 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/subpasses/depth_prepass_subpass.h"
+
+#include "rendering/render_context.h"
+#include "scene_graph/components/mesh.h"
+#include "scene_graph/components/sub_mesh.h"
+
+namespace vkb
+{
+DepthPrepassSubpass::DepthPrepassSubpass(RenderContext &render_context, sg::Scene &scene_, sg::Camera &camera) :
+    GeometrySubpass{render_context, ShaderSource{"depth_only.vert"}, ShaderSource{"depth_only.frag"}, scene_, camera}
+{
+	set_debug_name("Depth pre-pass");
+
+	// Only the depth attachment is written
+	set_output_attachments({});
+}
+
+void DepthPrepassSubpass::prepare()
+{
+	// By default use dynamic resources
+	use_dynamic_resources = true;
+
+	// The material definitions of the sub meshes do not apply, they all share a single variant
+	ShaderVariant variant;
+
+	if (use_instancing)
+	{
+		variant.add_define("INSTANCING");
+	}
+
+	// Skinned sub meshes must be written at the same depth as the main pass deforms them to
+	ShaderVariant skinned_variant = variant;
+	skinned_variant.add_define("SKINNING");
+
+	bool has_skinned = false;
+
+	shader_variants.clear();
+
+	for (auto &mesh : meshes)
+	{
+		for (auto &sub_mesh : mesh->get_submeshes())
+		{
+			std::string value;
+			bool        skinned = sub_mesh->get_shader_variant().find_define("SKINNING", value);
+
+			shader_variants.emplace(sub_mesh, skinned ? skinned_variant : variant);
+
+			has_skinned |= skinned;
+		}
+	}
+
+	auto &resource_cache = render_context.get_device().get_resource_cache();
+
+	for (auto *prepass_variant : {&variant, &skinned_variant})
+	{
+		if (prepass_variant == &skinned_variant && !has_skinned)
+		{
+			continue;
+		}
+
+		auto &vert_module = resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), *prepass_variant);
+		resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), *prepass_variant);
+
+		vert_module.set_resource_dynamic("GlobalUniform");
+		vert_module.set_resource_push_descriptor("GlobalUniform");
+
+		vert_module.set_resource_dynamic("ModelUniform");
+		vert_module.set_resource_push_descriptor("ModelUniform");
+	}
+}
+
+void DepthPrepassSubpass::draw(CommandBuffer &command_buffer)
+{
+	get_sorted_nodes(draw_list);
+
+	bind_draw_resources(command_buffer);
+
+	// Transparent objects are blended over the opaque ones, they are left out of the depth
+	draw_items(command_buffer, draw_list.get_items(), 0, draw_list.get_opaque_count());
+}
+}        // namespace vkb
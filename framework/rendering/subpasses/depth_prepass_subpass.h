@@ -0,0 +1,52 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "rendering/subpasses/geometry_subpass.h"
+
+namespace vkb
+{
+/**
+ * @brief Writes the depth of the opaque objects of a Scene, without any color output.
+ *        A GeometrySubpass with the depth pre-pass enabled drawn after it in the same
+ *        render pass shades only the closest fragment of each pixel
+ */
+class DepthPrepassSubpass : public GeometrySubpass
+{
+  public:
+	/**
+	 * @brief Constructs a depth pre-pass, drawing the scene with position-only vertex inputs
+	 * @param render_context Render context
+	 * @param scene Scene to render on this subpass
+	 * @param camera Camera used to look at the scene
+	 */
+	DepthPrepassSubpass(RenderContext &render_context, sg::Scene &scene, sg::Camera &camera);
+
+	virtual ~DepthPrepassSubpass() = default;
+
+	virtual void prepare() override;
+
+	/**
+	 * @brief Record the draws of the opaque objects
+	 */
+	virtual void draw(CommandBuffer &command_buffer) override;
+};
+}        // namespace vkb
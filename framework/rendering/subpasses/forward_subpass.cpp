@@ -38,35 +38,95 @@ namespace vkb
 ForwardSubpass::ForwardSubpass(RenderContext &render_context, ShaderSource &&vertex_source, ShaderSource &&fragment_source, sg::Scene &scene_, sg::Camera &camera) :
     GeometrySubpass{render_context, std::move(vertex_source), std::move(fragment_source), scene_, camera}
 {
+	set_debug_name("Forward");
 }
 
 void ForwardSubpass::prepare()
 {
-	// By default use dynamic resources
-	use_dynamic_resources = true;
+	// By default use dynamic resources, the descriptor set of each draw differs by the offset of its model otherwise
+	use_dynamic_resources = model_upload != ModelUpload::DescriptorSet;
+
+	prepare_bindless_textures();
+
+	shader_variants.clear();
+
+	// Definitions of this subpass only, the sub mesh variants are shared with other subpasses
+	auto subpass_definitions = shader_definitions;
+
+	for (auto &definition : get_multiview_definitions())
+	{
+		subpass_definitions.push_back(definition);
+	}
+
+	for (auto &definition : get_model_upload_definitions())
+	{
+		subpass_definitions.push_back(definition);
+	}
 
 	auto &device = render_context.get_device();
 	for (auto &mesh : meshes)
 	{
 		for (auto &sub_mesh : mesh->get_submeshes())
 		{
-			auto &variant = sub_mesh->get_mut_shader_variant();
+			auto &sub_mesh_variant = sub_mesh->get_mut_shader_variant();
 
 			// Same as Geometry except adds lighting definitions to sub mesh variants.
-			add_definitions(variant, {"MAX_FORWARD_LIGHT_COUNT " + std::to_string(MAX_FORWARD_LIGHT_COUNT)});
-			add_definitions(variant, light_type_definitions);
+			add_definitions(sub_mesh_variant, {"MAX_FORWARD_LIGHT_COUNT " + std::to_string(MAX_FORWARD_LIGHT_COUNT), "CLUSTERED_LIGHTS"});
+			add_definitions(sub_mesh_variant, light_type_definitions);
+
+			if (environment_lighting)
+			{
+				sub_mesh_variant.add_define("IBL");
+			}
+
+			// Variants with the definitions of the subpass are only drawn by this subpass
+			if (!subpass_definitions.empty())
+			{
+				ShaderVariant subpass_variant = sub_mesh_variant;
+				add_definitions(subpass_variant, subpass_definitions);
+				shader_variants[sub_mesh] = std::move(subpass_variant);
+			}
+
+			auto &variant = get_shader_variant(*sub_mesh);
 
 			auto &vert_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), variant);
 			auto &frag_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), variant);
+
+			if (bindless_textures)
+			{
+				frag_module.set_resource_update_after_bind(BindlessTextures::ARRAY_NAME);
+			}
 		}
 	}
 }
 
 void ForwardSubpass::draw(CommandBuffer &command_buffer)
 {
-	auto lights_buffer = allocate_lights<ForwardLights>(scene.get_components<sg::Light>(), MAX_FORWARD_LIGHT_COUNT);
-	command_buffer.bind_buffer(lights_buffer.get_buffer(), lights_buffer.get_offset(), lights_buffer.get_size(), 0, 4, 0);
+	update_light_clusters();
 
 	GeometrySubpass::draw(command_buffer);
 }
+
+void ForwardSubpass::bind_draw_resources(CommandBuffer &command_buffer)
+{
+	light_clusters.bind(command_buffer, 0, 4);
+
+	if (environment_lighting)
+	{
+		environment_lighting->bind(command_buffer, 0, 7);
+	}
+}
+
+void ForwardSubpass::set_environment_lighting(const EnvironmentLighting *environment_lighting_)
+{
+	environment_lighting = environment_lighting_;
+}
+
+void ForwardSubpass::update_light_clusters()
+{
+	auto &render_frame = render_context.get_active_frame();
+
+	light_clusters.update(scene.get_components<sg::Light>(), camera, render_frame.get_render_target().get_render_extent());
+	light_clusters.upload(render_frame, get_thread_index());
+}
 }        // namespace vkb
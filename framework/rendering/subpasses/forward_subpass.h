@@ -23,6 +23,8 @@
 #include "common/error.h"
 
 #include "buffer_pool.h"
+#include "rendering/environment_lighting.h"
+#include "rendering/light_clusters.h"
 #include "rendering/subpasses/geometry_subpass.h"
 
 #define MAX_FORWARD_LIGHT_COUNT 16
@@ -46,6 +48,8 @@ struct alignas(16) ForwardLights
 
 /**
  * @brief This subpass is responsible for rendering a Scene
+ *        Lights are assigned to clusters of the view frustum, so that fragments only evaluate
+ *        the lights that reach them and the light count is only bounded by memory
  */
 class ForwardSubpass : public GeometrySubpass
 {
@@ -68,6 +72,28 @@ class ForwardSubpass : public GeometrySubpass
 	 * @brief Record draw commands
 	 */
 	virtual void draw(CommandBuffer &command_buffer) override;
+
+	/**
+	 * @brief Lights the scene with an environment as well, through the IBL path of the fragment shader.
+	 *        Must be set before the subpass is prepared
+	 * @param environment_lighting Maps bound after the light clusters, nullptr to disable
+	 */
+	void set_environment_lighting(const EnvironmentLighting *environment_lighting);
+
+  protected:
+	/**
+	 * @brief Assigns the scene lights to the clusters of the camera and uploads them to the active frame
+	 */
+	void update_light_clusters();
+
+	/**
+	 * @brief Binds the light clusters
+	 */
+	void bind_draw_resources(CommandBuffer &command_buffer) override;
+
+	LightClusters light_clusters;
+
+	const EnvironmentLighting *environment_lighting{nullptr};
 };
 
 }        // namespace vkb
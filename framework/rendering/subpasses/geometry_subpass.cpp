@@ -19,160 +19,1361 @@
  */
 
 #include "rendering/subpasses/geometry_subpass.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "common/helpers.h"
 #include "common/utils.h"
 #include "common/vk_common.h"
+#include "core/render_pass.h"
+#include "job_system.h"
 #include "rendering/render_context.h"
 #include "scene_graph/components/camera.h"
 #include "scene_graph/components/image.h"
 #include "scene_graph/components/material.h"
 #include "scene_graph/components/mesh.h"
 #include "scene_graph/components/pbr_material.h"
+#include "scene_graph/components/perspective_camera.h"
+#include "scene_graph/components/skin.h"
 #include "scene_graph/components/texture.h"
 #include "scene_graph/node.h"
 #include "scene_graph/scene.h"
+#include "texture_streamer.h"
+
+namespace vkb
+{
+namespace
+{
+// Estimated recording costs, binding a new pipeline and material costs more than a draw with the bound state
+const uint32_t DRAW_RECORD_COST = 1;
+
+const uint32_t STATE_CHANGE_RECORD_COST = 8;
+
+// Below this cost a range is not worth a secondary command buffer of its own
+const uint32_t MIN_RANGE_RECORD_COST = 64;
+
+// Fraction of the screen size of a level of detail the projected size must move past to switch level
+const float LOD_HYSTERESIS = 0.1f;
+
+// Attributes fetched by the vertex pulling shaders, in the order of their layouts and buffer bindings
+const char *PULLED_ATTRIBUTE_NAMES[] = {"position", "normal", "texcoord_0"};
+
+// Defines which only describe the vertex input, removed from the variants of pulled sub meshes so that they share modules
+const std::vector<std::string> VERTEX_INPUT_DEFINES = {"HAS_POSITION", "HAS_NORMAL", "HAS_TEXCOORD_0", "HAS_TEXCOORD_1",
+                                                       "HAS_TANGENT", "HAS_COLOR_0", "OCTAHEDRAL_NORMAL"};
+
+/**
+ * @brief Offset, stride (both in 4-byte words) and format of each pulled attribute, as read by the shaders
+ */
+struct VertexPullingLayout
+{
+	glm::uvec4 attributes[3];
+};
+
+/**
+ * @return The code the vertex pulling shaders decode a format with, zero if they cannot read it
+ */
+uint32_t get_pulling_format(VkFormat format)
+{
+	switch (format)
+	{
+		case VK_FORMAT_R32G32B32_SFLOAT:
+			return 1;
+		case VK_FORMAT_R16G16B16A16_SFLOAT:
+			return 2;
+		case VK_FORMAT_R32G32_SFLOAT:
+			return 3;
+		case VK_FORMAT_R16G16_SNORM:
+			return 4;
+		case VK_FORMAT_R16G16_UNORM:
+			return 5;
+		case VK_FORMAT_R16G16_SFLOAT:
+			return 6;
+		default:
+			return 0;
+	}
+}
+}        // namespace
+
+const char *GeometrySubpass::INSTANCE_MODEL_NAME = "instance_model";
+
+GeometrySubpass::GeometrySubpass(RenderContext &render_context, ShaderSource &&vertex_source, ShaderSource &&fragment_source, sg::Scene &scene_, sg::Camera &camera) :
+    Subpass{render_context, std::move(vertex_source), std::move(fragment_source)},
+    meshes{scene_.get_components<sg::Mesh>().to_vector()},
+    camera{camera},
+    scene{scene_},
+    scene_version{scene_.get_version()},
+    skins{scene_.get_components<sg::Skin>().to_vector()}
+{
+	set_debug_name("Geometry");
+}
+
+void GeometrySubpass::prepare()
+{
+	// By default use dynamic resources, the descriptor set of each draw differs by the offset of its model otherwise
+	use_dynamic_resources = model_upload != ModelUpload::DescriptorSet;
+
+	prepare_bindless_textures();
+
+	prepare_vertex_pulling();
+
+	prepare_texture_arrays();
+
+	shader_variants.clear();
+
+	auto definitions = shader_definitions;
+
+	for (auto &definition : get_multiview_definitions())
+	{
+		definitions.push_back(definition);
+	}
+
+	for (auto &definition : get_model_upload_definitions())
+	{
+		definitions.push_back(definition);
+	}
+
+	if (motion_vectors)
+	{
+		definitions.push_back("MOTION_VECTORS");
+	}
+
+	for (auto &mesh : meshes)
+	{
+		for (auto &sub_mesh : mesh->get_submeshes())
+		{
+			if (use_instancing)
+			{
+				sub_mesh->get_mut_shader_variant().add_define("INSTANCING");
+			}
+
+			bool pulled  = vertex_pulling_offsets.count(sub_mesh) > 0;
+			bool layered = get_base_color_layer(*sub_mesh) != nullptr;
+			bool paged   = !layered && get_virtual_image(*sub_mesh) != nullptr;
+
+			if (!definitions.empty() || pulled || layered || paged)
+			{
+				ShaderVariant variant = sub_mesh->get_shader_variant();
+
+				if (pulled)
+				{
+					variant = variant.remove_defines(VERTEX_INPUT_DEFINES);
+					variant.add_define("VERTEX_PULLING");
+				}
+
+				if (layered)
+				{
+					variant.add_define("BASE_COLOR_TEXTURE_ARRAY");
+				}
+
+				if (paged)
+				{
+					variant.add_define("VIRTUAL_BASE_COLOR_TEXTURE");
+
+					if (virtual_textures->is_sparse())
+					{
+						variant.add_define("VIRTUAL_TEXTURE_SPARSE");
+					}
+				}
+
+				add_definitions(variant, definitions);
+				shader_variants.emplace(sub_mesh, std::move(variant));
+			}
+		}
+	}
+
+	// Build all shader variance upfront, in parallel, the vertex and fragment modules of a sub mesh being consecutive
+	std::vector<ShaderModuleRequest> requests;
+
+	for (auto &mesh : meshes)
+	{
+		for (auto &sub_mesh : mesh->get_submeshes())
+		{
+			auto &variant = get_shader_variant(*sub_mesh);
+
+			requests.push_back({VK_SHADER_STAGE_VERTEX_BIT, &get_vertex_shader(), &variant});
+			requests.push_back({VK_SHADER_STAGE_FRAGMENT_BIT, &get_fragment_shader(), &variant});
+		}
+	}
+
+	auto shader_modules = render_context.get_device().get_resource_cache().request_shader_modules(requests);
+
+	for (size_t i = 0; i < shader_modules.size(); i += 2)
+	{
+		auto &vert_module = *shader_modules[i];
+		auto &frag_module = *shader_modules[i + 1];
+
+		vert_module.set_resource_dynamic("GlobalUniform");
+		frag_module.set_resource_dynamic("GlobalUniform");
+
+		// Pushing the set would hide the cost of a descriptor set per draw
+		if (model_upload != ModelUpload::DescriptorSet)
+		{
+			vert_module.set_resource_push_descriptor("GlobalUniform");
+			frag_module.set_resource_push_descriptor("GlobalUniform");
+		}
+
+		if (model_upload == ModelUpload::DynamicOffset || model_upload == ModelUpload::UpdateBuffer)
+		{
+			vert_module.set_resource_dynamic("ModelUniform");
+			vert_module.set_resource_push_descriptor("ModelUniform");
+		}
+
+		if (bindless_textures)
+		{
+			frag_module.set_resource_update_after_bind(BindlessTextures::ARRAY_NAME);
+		}
+	}
+}
+
+void GeometrySubpass::set_bindless_textures(bool enable)
+{
+	use_bindless_textures = enable;
+}
+
+void GeometrySubpass::set_texture_arrays(uint32_t max_extent)
+{
+	texture_array_max_extent = max_extent;
+}
+
+void GeometrySubpass::set_instancing(bool enable)
+{
+	use_instancing = enable;
+}
+
+bool GeometrySubpass::uses_instancing() const
+{
+	return use_instancing;
+}
+
+void GeometrySubpass::set_depth_prepass(bool enable)
+{
+	depth_prepass = enable;
+}
+
+bool GeometrySubpass::uses_depth_prepass() const
+{
+	return depth_prepass;
+}
+
+void GeometrySubpass::set_model_upload(ModelUpload upload)
+{
+	model_upload = upload;
+}
+
+ModelUpload GeometrySubpass::get_model_upload() const
+{
+	return model_upload;
+}
+
+void GeometrySubpass::set_occlusion_culling(bool enable)
+{
+	if (!enable)
+	{
+		occlusion_queries.reset();
+	}
+	else if (!occlusion_queries)
+	{
+		occlusion_queries = std::make_unique<OcclusionQueries>(render_context);
+	}
+}
+
+bool GeometrySubpass::uses_occlusion_culling() const
+{
+	return occlusion_queries != nullptr;
+}
+
+void GeometrySubpass::set_lod_selection(bool enable)
+{
+	lod_selection = enable;
+}
+
+bool GeometrySubpass::uses_lod_selection() const
+{
+	return lod_selection;
+}
+
+void GeometrySubpass::set_vertex_pulling(bool enable)
+{
+	vertex_pulling = enable;
+}
+
+bool GeometrySubpass::uses_vertex_pulling() const
+{
+	return vertex_pulling;
+}
+
+void GeometrySubpass::set_motion_vectors(bool enable)
+{
+	motion_vectors = enable;
+}
+
+bool GeometrySubpass::uses_motion_vectors() const
+{
+	return motion_vectors;
+}
+
+void GeometrySubpass::set_transparent_draws(TransparentDraws draws)
+{
+	transparent_draws = draws;
+}
+
+TransparentDraws GeometrySubpass::get_transparent_draws() const
+{
+	return transparent_draws;
+}
+
+void GeometrySubpass::prepare_vertex_pulling()
+{
+	vertex_pulling_offsets.clear();
+	vertex_pulling_layouts.reset();
+
+	if (!vertex_pulling)
+	{
+		return;
+	}
+
+	std::vector<std::pair<const sg::SubMesh *, VertexPullingLayout>> layouts;
+
+	for (auto &mesh : meshes)
+	{
+		for (auto &sub_mesh : mesh->get_submeshes())
+		{
+			VertexPullingLayout layout{};
+
+			bool pullable = sub_mesh->get_vertex_buffer("position") != nullptr;
+
+			for (size_t i = 0; i < 3 && pullable; ++i)
+			{
+				sg::VertexAttribute attribute;
+
+				// Absent attributes keep a zero format, which the shaders replace with a default value
+				if (!sub_mesh->get_attribute(PULLED_ATTRIBUTE_NAMES[i], attribute) || !sub_mesh->get_vertex_buffer(PULLED_ATTRIBUTE_NAMES[i]))
+				{
+					pullable = i != 0;
+					continue;
+				}
+
+				uint32_t format = get_pulling_format(attribute.format);
+
+				pullable = format != 0 && attribute.offset % 4 == 0 && attribute.stride % 4 == 0;
+
+				layout.attributes[i] = glm::uvec4{attribute.offset / 4, attribute.stride / 4, format, 0};
+			}
+
+			if (pullable)
+			{
+				layouts.emplace_back(sub_mesh, layout);
+			}
+		}
+	}
+
+	if (layouts.empty())
+	{
+		return;
+	}
+
+	auto &device = render_context.get_device();
+
+	VkDeviceSize alignment   = device.get_properties().limits.minUniformBufferOffsetAlignment;
+	VkDeviceSize layout_size = (sizeof(VertexPullingLayout) + alignment - 1) / alignment * alignment;
+
+	std::vector<uint8_t> data(layouts.size() * layout_size);
+
+	for (size_t i = 0; i < layouts.size(); ++i)
+	{
+		std::memcpy(data.data() + i * layout_size, &layouts[i].second, sizeof(VertexPullingLayout));
+
+		vertex_pulling_offsets.emplace(layouts[i].first, i * layout_size);
+	}
+
+	vertex_pulling_layouts = std::make_unique<core::Buffer>(device, data.size(), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	vertex_pulling_layouts->update(data);
+	vertex_pulling_layouts->set_debug_name("Vertex pulling layouts");
+}
+
+void GeometrySubpass::set_shader_definitions(const std::vector<std::string> &definitions)
+{
+	shader_definitions = definitions;
+}
+
+std::vector<std::string> GeometrySubpass::get_multiview_definitions() const
+{
+	if (get_view_mask() == 0U)
+	{
+		return {};
+	}
+
+	return {"MULTIVIEW", "MAX_MULTIVIEW_VIEW_COUNT " + std::to_string(MAX_MULTIVIEW_VIEW_COUNT)};
+}
+
+std::vector<std::string> GeometrySubpass::get_model_upload_definitions() const
+{
+	switch (model_upload)
+	{
+		case ModelUpload::PushConstant:
+			return {"MODEL_PUSH_CONSTANT"};
+		case ModelUpload::StorageBuffer:
+			return {"MODEL_STORAGE_BUFFER"};
+		case ModelUpload::DescriptorSet:
+			// Same shaders as the dynamic offsets, the modules are kept apart as their resources are not pushed
+			return {"MODEL_DESCRIPTOR_SET"};
+		default:
+			return {};
+	}
+}
+
+void GeometrySubpass::set_view_projections(const std::vector<glm::mat4> &projections)
+{
+	assert(projections.size() <= MAX_MULTIVIEW_VIEW_COUNT && "Too many views");
+
+	view_projections = projections;
+}
+
+const ShaderVariant &GeometrySubpass::get_shader_variant(const sg::SubMesh &sub_mesh) const
+{
+	auto it = shader_variants.find(&sub_mesh);
+	if (it != shader_variants.end())
+	{
+		return it->second;
+	}
+
+	return sub_mesh.get_shader_variant();
+}
+
+void GeometrySubpass::set_culling_options(const CullingOptions &options)
+{
+	culling_options = options;
+}
+
+const CullingOptions &GeometrySubpass::get_culling_options() const
+{
+	return culling_options;
+}
+
+sg::Camera &GeometrySubpass::get_camera()
+{
+	return camera;
+}
+
+sg::Scene &GeometrySubpass::get_scene()
+{
+	return scene;
+}
+
+const CullingStats &GeometrySubpass::get_culling_stats() const
+{
+	return culling_stats;
+}
+
+void GeometrySubpass::set_texture_streamer(TextureStreamer *streamer)
+{
+	texture_streamer = streamer;
+}
+
+void GeometrySubpass::set_virtual_textures(VirtualTextures *textures)
+{
+	virtual_textures = textures;
+}
+
+void GeometrySubpass::prepare_bindless_textures()
+{
+	auto &device = render_context.get_device();
+
+	if (!use_bindless_textures || !device.is_enabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+	{
+		bindless_textures.reset();
+		return;
+	}
+
+	bindless_textures = std::make_unique<BindlessTextures>(device, scene.get_components<sg::Texture>().to_vector());
+
+	for (auto &mesh : meshes)
+	{
+		for (auto &sub_mesh : mesh->get_submeshes())
+		{
+			auto &variant = sub_mesh->get_mut_shader_variant();
+
+			variant.add_define("BINDLESS_TEXTURES");
+			variant.add_runtime_array_size(BindlessTextures::ARRAY_NAME, bindless_textures->get_count());
+		}
+	}
+}
+
+void GeometrySubpass::prepare_texture_arrays()
+{
+	texture_arrays.reset();
+
+	if (texture_array_max_extent == 0 || bindless_textures)
+	{
+		return;
+	}
+
+	std::vector<sg::Texture *> base_color_textures;
+
+	for (auto &mesh : meshes)
+	{
+		for (auto &sub_mesh : mesh->get_submeshes())
+		{
+			auto &textures = sub_mesh->get_material()->textures;
+
+			auto texture_it = textures.find(TextureArrays::TEXTURE_NAME);
+
+			if (texture_it != textures.end())
+			{
+				base_color_textures.push_back(texture_it->second);
+			}
+		}
+	}
+
+	texture_arrays = std::make_unique<TextureArrays>(render_context.get_device(), base_color_textures, texture_array_max_extent);
+}
+
+const TextureArrays::Layer *GeometrySubpass::get_base_color_layer(const sg::SubMesh &sub_mesh) const
+{
+	if (!texture_arrays)
+	{
+		return nullptr;
+	}
+
+	auto &textures = sub_mesh.get_material()->textures;
+
+	auto texture_it = textures.find(TextureArrays::TEXTURE_NAME);
+
+	return texture_it != textures.end() ? texture_arrays->find(*texture_it->second) : nullptr;
+}
+
+const VirtualTextures::PagedImage *GeometrySubpass::get_virtual_image(const sg::SubMesh &sub_mesh) const
+{
+	if (!virtual_textures || bindless_textures)
+	{
+		return nullptr;
+	}
+
+	auto &textures = sub_mesh.get_material()->textures;
+
+	auto texture_it = textures.find(VirtualTextures::TEXTURE_NAME);
+
+	return texture_it != textures.end() ? virtual_textures->find(*texture_it->second->get_image()) : nullptr;
+}
+
+void GeometrySubpass::get_sorted_nodes(DrawList &draw_list)
+{
+	if (scene.get_version() != scene_version)
+	{
+		refresh_meshes();
+	}
+
+	draw_list.clear();
+
+	draw_list.set_transparent_sorting(transparent_draws == TransparentDraws::Sorted);
+
+	auto camera_transform = camera.get_node()->get_transform().get_render_state().world_matrix;
+
+	auto projection = camera.get_projection();
+
+	Frustum frustum{get_view_projection()};
+
+	culling_stats = {};
+
+	float viewport_height = static_cast<float>(render_context.get_surface_extent().height);
+
+	// Tests the node of a mesh in the frustum against the other culling options, and adds its sub meshes if it passes them
+	auto add_node = [&](sg::Node &node, sg::Mesh &mesh, const sg::AABB &world_bounds) {
+		float distance = glm::length(glm::vec3(camera_transform[3]) - world_bounds.get_center());
+
+		auto submesh_count = to_u32(mesh.get_submeshes().size());
+
+		// Approximate the projected height of the bounding sphere as a fraction of the viewport
+		float radius      = 0.5f * glm::length(world_bounds.get_max() - world_bounds.get_min());
+		float screen_size = distance > radius ? std::min(radius * std::abs(projection[1][1]) / distance, 1.0f) : 1.0f;
+
+		if (culling_options.max_distance > 0.0f && distance > culling_options.max_distance)
+		{
+			culling_stats.distance_culled += submesh_count;
+			return;
+		}
+
+		if (culling_options.min_screen_size > 0.0f && screen_size < culling_options.min_screen_size)
+		{
+			culling_stats.size_culled += submesh_count;
+			return;
+		}
+
+		// Query the objects in the frustum whether they are drawn or not
+		if (occlusion_queries && !job_system &&
+		    occlusion_queries->add_proxy(node, mesh, world_bounds, glm::vec3(camera_transform[3])) &&
+		    !occlusion_queries->is_visible(node, mesh))
+		{
+			culling_stats.occlusion_culled += submesh_count;
+			return;
+		}
+
+		culling_stats.visible += submesh_count;
+
+		for (auto &sub_mesh : mesh.get_submeshes())
+		{
+			if (!draws_submesh(*sub_mesh))
+			{
+				continue;
+			}
+
+			auto lod = select_lod(node, *sub_mesh, screen_size);
+
+			if (lod > 0)
+			{
+				culling_stats.simplified++;
+			}
+
+			draw_list.add(node, *sub_mesh, distance, lod);
+
+			if (texture_streamer)
+			{
+				for (auto &texture : sub_mesh->get_material()->textures)
+				{
+					texture_streamer->request(*texture.second->get_image(), screen_size * viewport_height);
+				}
+			}
+		}
+	};
+
+	if (culling_options.frustum && scene.has_component<sg::SpatialIndex>())
+	{
+		// Only the nodes found in the frustum are visited
+		auto &spatial_index = *scene.get_components<sg::SpatialIndex>().at(0);
+
+		spatial_index.query(frustum, frustum_items);
+
+		uint32_t submesh_count = 0;
+
+		for (auto &mesh : meshes)
+		{
+			submesh_count += to_u32(mesh->get_nodes().size() * mesh->get_submeshes().size());
+		}
+
+		for (auto item : frustum_items)
+		{
+			auto item_submesh_count = to_u32(item->mesh->get_submeshes().size());
+
+			submesh_count = submesh_count > item_submesh_count ? submesh_count - item_submesh_count : 0;
+
+			add_node(*item->node, *item->mesh, sg::AABB{item->min, item->max});
+		}
+
+		culling_stats.frustum_culled = submesh_count;
+	}
+	else
+	{
+		// Transform and test the bounds of all the nodes at once, in the order they are visited below
+		node_bounds.clear();
+
+		for (auto &mesh : meshes)
+		{
+			for (auto &node : mesh->get_nodes())
+			{
+				node_bounds.add(mesh->get_bounds(), node->get_transform().get_render_state().world_matrix);
+			}
+		}
+
+		node_bounds.transform();
+
+		if (culling_options.frustum)
+		{
+			node_bounds.intersect(frustum, frustum_visible);
+		}
+
+		size_t bounds_index = 0;
+
+		for (auto &mesh : meshes)
+		{
+			for (auto &node : mesh->get_nodes())
+			{
+				auto index = bounds_index++;
+
+				if (culling_options.frustum && !frustum_visible[index])
+				{
+					culling_stats.frustum_culled += to_u32(mesh->get_submeshes().size());
+					continue;
+				}
+
+				add_node(*node, *mesh, node_bounds.get_world_bounds(index));
+			}
+		}
+	}
+
+	draw_list.sort();
+
+	upload_global_uniform();
+
+	upload_model_uniforms(draw_list);
+
+	// Every subpass drawing the skinned nodes sorts them first, the joints are read from the published state
+	upload_joint_palettes();
+}
+
+void GeometrySubpass::refresh_meshes()
+{
+	scene_version = scene.get_version();
+
+	meshes = scene.get_components<sg::Mesh>().to_vector();
+	skins  = scene.get_components<sg::Skin>().to_vector();
+
+	// The detached nodes may be reused by the allocator for the attached ones
+	selected_lods.clear();
+
+	// The frames in flight may still read the resources built for the previous meshes
+	auto &deletion_queue = render_context.get_device().get_deletion_queue();
+	deletion_queue.release(std::move(bindless_textures));
+	deletion_queue.release(std::move(texture_arrays));
+	deletion_queue.release(std::move(vertex_pulling_layouts));
+
+	prepare();
+}
+
+uint32_t GeometrySubpass::select_lod(const sg::Node &node, const sg::SubMesh &sub_mesh, float screen_size)
+{
+	if (!lod_selection || sub_mesh.lods.empty())
+	{
+		return 0;
+	}
+
+	auto &lod = selected_lods[{&node, &sub_mesh}];
+
+	// A level changes only once the screen size is clearly past its threshold, so that it does not flicker around it
+	while (lod < sub_mesh.lods.size() && screen_size < sub_mesh.lods[lod].screen_size * (1.0f - LOD_HYSTERESIS))
+	{
+		lod++;
+	}
+
+	while (lod > 0 && screen_size > sub_mesh.lods[lod - 1].screen_size * (1.0f + LOD_HYSTERESIS))
+	{
+		lod--;
+	}
+
+	return lod;
+}
+
+void GeometrySubpass::draw(CommandBuffer &command_buffer)
+{
+	// Transfer commands cannot be recorded in a render pass, the nodes were sorted before it
+	if (model_upload != ModelUpload::UpdateBuffer)
+	{
+		get_sorted_nodes(draw_list);
+	}
+
+	if (job_system)
+	{
+		draw_secondary(command_buffer);
+		return;
+	}
+
+	auto &items = draw_list.get_items();
+
+	bind_draw_resources(command_buffer);
+
+	command_buffer.set_depth_stencil_state(get_opaque_depth_stencil_state());
+
+	// Draw opaque objects grouped by state, front-to-back within a group
+	draw_items(command_buffer, items, 0, draw_list.get_opaque_count(), get_thread_index());
+
+	// Test the boxes against the depth of the opaque objects
+	if (occlusion_queries)
+	{
+		occlusion_queries->draw(command_buffer, get_view_projection());
+	}
+
+	set_transparent_state(command_buffer);
+
+	// Draw transparent objects in back-to-front order, or grouped by state if they are accumulated
+	draw_items(command_buffer, items, draw_list.get_opaque_count(), items.size(), get_thread_index());
+}
+
+void GeometrySubpass::pre_draw(CommandBuffer &command_buffer)
+{
+	if (occlusion_queries)
+	{
+		occlusion_queries->reset(command_buffer);
+	}
+
+	if (model_upload == ModelUpload::UpdateBuffer)
+	{
+		get_sorted_nodes(draw_list);
+
+		update_model_uniforms(command_buffer);
+	}
+}
+
+VkSubpassContents GeometrySubpass::get_contents() const
+{
+	return job_system ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+}
+
+void GeometrySubpass::prewarm(const RenderPass &render_pass, uint32_t subpass_index, std::vector<PipelineState> &pipeline_states)
+{
+	auto &resource_cache = render_context.get_device().get_resource_cache();
+
+	// Opaque draws keep the blend state the command buffer starts the subpass with
+	ColorBlendState opaque_blend_state{};
+	opaque_blend_state.attachments.resize(render_pass.get_color_output_count(subpass_index));
+
+	for (auto &mesh : meshes)
+	{
+		// Nodes with a negative scale are drawn with the opposite winding
+		bool windings[2]{false, false};
+
+		for (auto &node : mesh->get_nodes())
+		{
+			const auto &scale = node->get_transform().get_scale();
+
+			windings[scale.x * scale.y * scale.z < 0 ? 1 : 0] = true;
+		}
+
+		for (auto &sub_mesh : mesh->get_submeshes())
+		{
+			if (!draws_submesh(*sub_mesh))
+			{
+				continue;
+			}
+
+			auto &variant     = get_shader_variant(*sub_mesh);
+			auto &vert_module = resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), variant);
+			auto &frag_module = resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), variant);
+
+			auto &pipeline_layout = resource_cache.request_pipeline_layout({&vert_module, &frag_module}, use_dynamic_resources);
+
+			bool transparent = sub_mesh->get_material()->alpha_mode == sg::AlphaMode::Blend;
+
+			// With a dynamic front face both windings draw with the same pipeline
+			bool dynamic_front_face = render_context.get_device().uses_extended_dynamic_state();
+
+			for (uint32_t flipped = 0; flipped < 2; flipped++)
+			{
+				if (!windings[flipped] || (flipped && windings[0] && dynamic_front_face))
+				{
+					continue;
+				}
+
+				PipelineState pipeline_state;
+				pipeline_state.set_extended_dynamic_state(dynamic_front_face);
+				pipeline_state.set_pipeline_layout(pipeline_layout);
+				pipeline_state.set_render_pass(render_pass);
+				pipeline_state.set_subpass_index(subpass_index);
+
+				MultisampleState multisample_state{};
+				multisample_state.rasterization_samples = render_pass.get_sample_count(subpass_index);
+				pipeline_state.set_multisample_state(multisample_state);
+				pipeline_state.set_rasterization_state(get_rasterization_state(*sub_mesh, flipped ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE));
+				pipeline_state.set_vertex_input_state(get_vertex_input_state(pipeline_layout, *sub_mesh));
+
+				for (auto *shader_module : {&vert_module, &frag_module})
+				{
+					for (auto &constant : shader_module->get_define_constants(variant))
+					{
+						pipeline_state.set_specialization_constant(constant.first, constant.second);
+					}
+				}
+
+				if (transparent)
+				{
+					pipeline_state.set_color_blend_state(get_transparent_blend_state());
+					pipeline_state.set_depth_stencil_state(get_depth_stencil_state());
+				}
+				else
+				{
+					pipeline_state.set_color_blend_state(opaque_blend_state);
+					pipeline_state.set_depth_stencil_state(get_opaque_depth_stencil_state());
+				}
+
+				pipeline_states.push_back(std::move(pipeline_state));
+			}
+		}
+	}
+}
+
+void GeometrySubpass::set_job_system(JobSystem *jobs)
+{
+	job_system = jobs;
+}
+
+void GeometrySubpass::bind_draw_resources(CommandBuffer &command_buffer)
+{
+}
+
+void GeometrySubpass::draw_secondary(CommandBuffer &primary_command_buffer)
+{
+	auto &items        = draw_list.get_items();
+	auto  opaque_count = draw_list.get_opaque_count();
+
+	// Jobs use the per-thread resources of the thread running them
+	auto thread_count = job_system->get_thread_count();
+	bool use_jobs     = get_render_context().get_active_frame().get_thread_count() >= thread_count;
+
+	// Accumulated transparent draws are in any order, so they are split as the opaque ones are
+	bool accumulated = transparent_draws == TransparentDraws::Accumulated;
+	auto ranges      = split_by_cost(items, 0, accumulated ? items.size() : opaque_count, use_jobs ? thread_count : 1);
+
+	bool has_transparent = !accumulated && opaque_count < items.size();
+
+	// Sized upfront as the jobs write to it
+	FrameVector<CommandBuffer *> secondary_command_buffers(ranges.size() + (has_transparent ? 1 : 0), nullptr, &get_render_context().get_active_frame().get_arena());
+
+	JobSystem::Counter counter;
+
+	for (size_t i = 1; i < ranges.size(); ++i)
+	{
+		auto range = ranges[i];
+
+		job_system->run(
+		    [this, &primary_command_buffer, &items, &secondary_command_buffers, range, i, accumulated](size_t thread_index) {
+			    secondary_command_buffers[i] = record_secondary(primary_command_buffer, items, range.first, range.second, thread_index, accumulated);
+		    },
+		    &counter);
+	}
+
+	if (!ranges.empty())
+	{
+		secondary_command_buffers[0] = record_secondary(primary_command_buffer, items, ranges[0].first, ranges[0].second, 0, accumulated);
+	}
+
+	if (has_transparent)
+	{
+		secondary_command_buffers.back() = record_secondary(primary_command_buffer, items, opaque_count, items.size(), 0, true);
+	}
+
+	job_system->wait(counter);
+
+	if (!secondary_command_buffers.empty())
+	{
+		primary_command_buffer.execute_commands(secondary_command_buffers.data(), secondary_command_buffers.size());
+	}
+}
+
+CommandBuffer *GeometrySubpass::record_secondary(CommandBuffer &primary_command_buffer, const std::vector<DrawItem> &items, size_t begin, size_t end, size_t thread_index, bool transparent)
+{
+	auto &render_frame = get_render_context().get_active_frame();
+
+	const auto &queue = render_context.get_device().get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+
+	auto &command_buffer = render_frame.request_command_buffer(queue, CommandBuffer::ResetMode::ResetPool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, thread_index);
+
+	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &primary_command_buffer);
+
+	bind_draw_resources(command_buffer);
+
+	if (transparent)
+	{
+		set_transparent_state(command_buffer);
+	}
+	else
+	{
+		command_buffer.set_depth_stencil_state(get_opaque_depth_stencil_state());
+	}
+
+	draw_items(command_buffer, items, begin, end, thread_index);
+
+	command_buffer.end();
+
+	return &command_buffer;
+}
+
+FrameVector<std::pair<size_t, size_t>> GeometrySubpass::split_by_cost(const std::vector<DrawItem> &items, size_t begin, size_t end, size_t range_count) const
+{
+	FrameVector<std::pair<size_t, size_t>> ranges{&render_context.get_active_frame().get_arena()};
+
+	if (begin == end)
+	{
+		return ranges;
+	}
+
+	auto item_cost = [&items, begin](size_t i) {
+		bool state_change = i == begin ||
+		                    items[i].sub_mesh->get_material() != items[i - 1].sub_mesh->get_material() ||
+		                    items[i].sub_mesh->get_shader_variant().get_id() != items[i - 1].sub_mesh->get_shader_variant().get_id();
+
+		return DRAW_RECORD_COST + (state_change ? STATE_CHANGE_RECORD_COST : 0);
+	};
+
+	uint64_t total_cost = 0;
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		total_cost += item_cost(i);
+	}
+
+	range_count = std::max<size_t>(1, std::min<size_t>(range_count, to_u32(total_cost / MIN_RANGE_RECORD_COST)));
+
+	uint64_t cost        = 0;
+	size_t   range_begin = begin;
+
+	for (size_t i = begin; i + 1 < end && ranges.size() + 1 < range_count; ++i)
+	{
+		cost += item_cost(i);
+
+		// Cut once the range reaches its share of the total, without splitting instances
+		if (cost * range_count >= total_cost * (ranges.size() + 1) &&
+		    !(use_instancing && items[i + 1].sub_mesh == items[i].sub_mesh && items[i + 1].lod == items[i].lod))
+		{
+			ranges.emplace_back(range_begin, i + 1);
+			range_begin = i + 1;
+		}
+	}
+
+	ranges.emplace_back(range_begin, end);
+
+	return ranges;
+}
+
+bool GeometrySubpass::draws_submesh(const sg::SubMesh &sub_mesh) const
+{
+	bool transparent = sub_mesh.get_material()->alpha_mode == sg::AlphaMode::Blend;
+
+	switch (transparent_draws)
+	{
+		case TransparentDraws::Skipped:
+			return !transparent;
+		case TransparentDraws::Accumulated:
+			return transparent;
+		default:
+			return true;
+	}
+}
+
+void GeometrySubpass::set_transparent_state(CommandBuffer &command_buffer)
+{
+	command_buffer.set_color_blend_state(get_transparent_blend_state());
+
+	command_buffer.set_depth_stencil_state(get_depth_stencil_state());
+}
+
+DepthStencilState GeometrySubpass::get_opaque_depth_stencil_state() const
+{
+	DepthStencilState depth_stencil_state{};
+
+	// The pre-pass wrote the closest depth of each pixel, only the fragments at that depth pass
+	if (depth_prepass)
+	{
+		depth_stencil_state.depth_compare_op   = VK_COMPARE_OP_EQUAL;
+		depth_stencil_state.depth_write_enable = VK_FALSE;
+	}
 
-namespace vkb
-{
-GeometrySubpass::GeometrySubpass(RenderContext &render_context, ShaderSource &&vertex_source, ShaderSource &&fragment_source, sg::Scene &scene_, sg::Camera &camera) :
-    Subpass{render_context, std::move(vertex_source), std::move(fragment_source)},
-    meshes{scene_.get_components<sg::Mesh>()},
-    camera{camera},
-    scene{scene_}
+	return depth_stencil_state;
+}
+
+ColorBlendState GeometrySubpass::get_transparent_blend_state() const
 {
+	// Enable alpha blending
+	ColorBlendAttachmentState color_blend_attachment{};
+	color_blend_attachment.blend_enable           = VK_TRUE;
+	color_blend_attachment.src_color_blend_factor = VK_BLEND_FACTOR_SRC_ALPHA;
+	color_blend_attachment.dst_color_blend_factor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+
+	ColorBlendState color_blend_state{};
+	color_blend_state.attachments.resize(get_output_attachments().size());
+	color_blend_state.attachments[0] = color_blend_attachment;
+
+	return color_blend_state;
 }
 
-void GeometrySubpass::prepare()
+void GeometrySubpass::draw_items(CommandBuffer &command_buffer, const std::vector<DrawItem> &items, size_t begin, size_t end, size_t thread_index)
 {
-	// By default use dynamic resources
-	use_dynamic_resources = true;
+	auto is_flipped = [](const sg::Node &node) {
+		const auto &scale = node.get_transform().get_render_state().scale;
+		return scale.x * scale.y * scale.z < 0;
+	};
 
-	// Build all shader variance upfront
-	auto &device = render_context.get_device();
-	for (auto &mesh : meshes)
+	bind_global_uniform(command_buffer);
+
+	size_t first = begin;
+
+	while (first < end)
 	{
-		for (auto &sub_mesh : mesh->get_submeshes())
+		auto &first_item = items[first];
+		bool  flipped    = is_flipped(*first_item.node);
+
+		// Find the consecutive items which can be drawn as instances of the first one
+		size_t last = first + 1;
+
+		if (use_instancing)
+		{
+			// Skinned nodes are drawn with the joint matrices of their own skin
+			while (!first_item.node->has_component<sg::Skin>() && last < end && last - first < MAX_INSTANCE_COUNT &&
+			       items[last].sub_mesh == first_item.sub_mesh && items[last].lod == first_item.lod && is_flipped(*items[last].node) == flipped)
+			{
+				last++;
+			}
+		}
+
+		update_uniform(command_buffer, items, first);
+
+		// Invert the front face if the mesh was flipped
+		VkFrontFace front_face = flipped ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+		auto instance_count = to_u32(last - first);
+
+		if (use_instancing)
+		{
+			auto &render_frame = get_render_context().get_active_frame();
+
+			auto instance_models = render_frame.allocate_buffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, instance_count * sizeof(glm::mat4), thread_index);
+
+			for (uint32_t i = 0; i < instance_count; i++)
+			{
+				*instance_models.map<glm::mat4>(to_u32(i * sizeof(glm::mat4))) = items[first + i].node->get_transform().get_render_state().world_matrix;
+			}
+
+			instance_models.flush();
+
+			draw_submesh(command_buffer, *first_item.sub_mesh, front_face, &instance_models, instance_count, first_item.lod);
+		}
+		else
 		{
-			auto &variant     = sub_mesh->get_shader_variant();
-			auto &vert_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), variant);
-			auto &frag_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), variant);
+			bind_submesh(command_buffer, *first_item.sub_mesh, front_face, nullptr);
+
+			// Pushed once the pipeline layout of the draw is bound, skinned draws read the joints instead
+			if (model_upload == ModelUpload::PushConstant && !first_item.node->has_component<sg::Skin>())
+			{
+				command_buffer.push_constants(MODEL_PUSH_CONSTANT_OFFSET, first_item.node->get_transform().get_render_state().world_matrix);
+			}
 
-			vert_module.set_resource_dynamic("GlobalUniform");
-			frag_module.set_resource_dynamic("GlobalUniform");
+			// The storage buffer is indexed by gl_InstanceIndex, which starts at the first instance
+			uint32_t first_instance = model_upload == ModelUpload::StorageBuffer ? to_u32(first) : 0;
+
+			draw_submesh_command(command_buffer, *first_item.sub_mesh, 1, first_item.lod, first_instance);
 		}
+
+		first = last;
 	}
 }
 
-void GeometrySubpass::get_sorted_nodes(std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &opaque_nodes, std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &transparent_nodes)
+void GeometrySubpass::bind_global_uniform(CommandBuffer &command_buffer)
 {
-	auto camera_transform = camera.get_node()->get_transform().get_world_matrix();
+	command_buffer.bind_buffer(global_uniform.get_buffer(), global_uniform.get_offset(), global_uniform.get_size(), 0, 1, 0);
+}
 
-	for (auto &mesh : meshes)
+void GeometrySubpass::update_uniform(CommandBuffer &command_buffer, const std::vector<DrawItem> &items, size_t item_index)
+{
+	auto &node = *items[item_index].node;
+
+	if (model_upload == ModelUpload::StorageBuffer)
 	{
-		for (auto &node : mesh->get_nodes())
-		{
-			auto node_transform = node->get_transform().get_world_matrix();
+		// The same binding for all the draws, which index it
+		command_buffer.bind_buffer(model_uniforms.get_buffer(), model_uniforms.get_offset(), model_uniforms.get_size(), 0, MODEL_BINDING, 0);
+	}
+	else if (model_upload != ModelUpload::PushConstant)
+	{
+		// Only the dynamic offset changes from one draw to the next, unless the set is not dynamic
+		auto allocation = get_model_uniform(item_index);
 
-			const sg::AABB &mesh_bounds = mesh->get_bounds();
+		command_buffer.bind_buffer(allocation.get_buffer(), allocation.get_offset(), allocation.get_size(), 0, MODEL_BINDING, 0);
+	}
 
-			sg::AABB world_bounds{mesh_bounds.get_min(), mesh_bounds.get_max()};
-			world_bounds.transform(node_transform);
+	if (node.has_component<sg::Skin>())
+	{
+		auto palette_it = joint_palettes.find(&node.get_component<sg::Skin>());
 
-			float distance = glm::length(glm::vec3(camera_transform[3]) - world_bounds.get_center());
+		if (palette_it != joint_palettes.end())
+		{
+			auto &palette = palette_it->second;
 
-			for (auto &sub_mesh : mesh->get_submeshes())
-			{
-				if (sub_mesh->get_material()->alpha_mode == sg::AlphaMode::Blend)
-				{
-					transparent_nodes.emplace(distance, std::make_pair(node, sub_mesh));
-				}
-				else
-				{
-					opaque_nodes.emplace(distance, std::make_pair(node, sub_mesh));
-				}
-			}
+			command_buffer.bind_buffer(palette.get_buffer(), palette.get_offset(), palette.get_size(), 0, JOINT_MATRICES_BINDING, 0);
 		}
 	}
 }
 
-void GeometrySubpass::draw(CommandBuffer &command_buffer)
+void GeometrySubpass::upload_joint_palettes()
 {
-	std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> opaque_nodes;
-	std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> transparent_nodes;
+	joint_palettes.clear();
 
-	get_sorted_nodes(opaque_nodes, transparent_nodes);
+	auto &render_frame = get_render_context().get_active_frame();
 
-	// Draw opaque objects in front-to-back order
-	for (auto node_it = opaque_nodes.begin(); node_it != opaque_nodes.end(); node_it++)
+	for (auto skin : skins)
 	{
-		update_uniform(command_buffer, *node_it->second.first);
+		if (skin->get_joints().empty())
+		{
+			continue;
+		}
 
-		// Invert the front face if the mesh was flipped
-		const auto &scale      = node_it->second.first->get_transform().get_scale();
-		bool        flipped    = scale.x * scale.y * scale.z < 0;
-		VkFrontFace front_face = flipped ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		auto allocation = render_frame.allocate_buffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, skin->get_joints().size() * sizeof(glm::mat4), get_thread_index());
+
+		skin->write_joint_matrices(allocation.map<glm::mat4>());
 
-		draw_submesh(command_buffer, *node_it->second.second, front_face);
+		allocation.flush();
+
+		joint_palettes.emplace(skin, std::move(allocation));
 	}
+}
 
-	// Enable alpha blending
-	ColorBlendAttachmentState color_blend_attachment{};
-	color_blend_attachment.blend_enable           = VK_TRUE;
-	color_blend_attachment.src_color_blend_factor = VK_BLEND_FACTOR_SRC_ALPHA;
-	color_blend_attachment.dst_color_blend_factor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+BufferAllocation GeometrySubpass::get_model_uniform(size_t item_index)
+{
+	return {model_uniforms.get_buffer(), sizeof(ModelUniform), model_uniforms.get_offset() + item_index * model_uniform_stride};
+}
 
-	ColorBlendState color_blend_state{};
-	color_blend_state.attachments.resize(get_output_attachments().size());
-	color_blend_state.attachments[0] = color_blend_attachment;
-	command_buffer.set_color_blend_state(color_blend_state);
+void GeometrySubpass::upload_global_uniform()
+{
+	auto &render_frame = get_render_context().get_active_frame();
 
-	command_buffer.set_depth_stencil_state(get_depth_stencil_state());
+	global_uniform = render_frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(GlobalUniform), get_thread_index());
+
+	GlobalUniform uniform{};
+
+	auto view_projection = get_view_projection();
+
+	uniform.camera_view_proj = view_projection;
+
+	std::copy(view_projections.begin(), view_projections.end(), uniform.view_projs);
+
+	glm::vec2 jitter{0.0f};
+
+	if (auto perspective_camera = dynamic_cast<sg::PerspectiveCamera *>(&camera))
+	{
+		jitter = perspective_camera->get_jitter();
+	}
+
+	// The first frame has no motion
+	if (!has_previous_view)
+	{
+		previous_view_projection = view_projection;
+		previous_jitter          = jitter;
+		has_previous_view        = true;
+	}
 
-	// Draw transparent objects in back-to-front order
-	for (auto node_it = transparent_nodes.rbegin(); node_it != transparent_nodes.rend(); node_it++)
+	uniform.previous_view_proj = previous_view_projection;
+	uniform.jitter             = glm::vec4{jitter, previous_jitter};
+
+	previous_view_projection = view_projection;
+	previous_jitter          = jitter;
+
+	// The camera position is the translation of its world matrix, the inverse of its view
+	uniform.camera_position = glm::vec3(camera.get_node()->get_transform().get_render_state().world_matrix[3]);
+
+	// Written in place when the buffer is mapped, so only write to it
+	if (auto mapped_uniform = global_uniform.map<GlobalUniform>())
 	{
-		update_uniform(command_buffer, *node_it->second.first);
+		*mapped_uniform = uniform;
 
-		draw_submesh(command_buffer, *node_it->second.second);
+		global_uniform.flush();
+	}
+	else
+	{
+		global_uniform.update(uniform);
 	}
 }
 
-void GeometrySubpass::update_uniform(CommandBuffer &command_buffer, sg::Node &node, size_t thread_index)
+void GeometrySubpass::upload_model_uniforms(const DrawList &draw_list)
 {
-	GlobalUniform global_uniform;
+	auto &items = draw_list.get_items();
 
-	global_uniform.camera_view_proj = vkb::vulkan_style_projection(camera.get_projection()) * camera.get_view();
+	// Pushed for each draw, or written by update_model_uniforms
+	if (items.empty() || model_upload == ModelUpload::PushConstant || model_upload == ModelUpload::UpdateBuffer)
+	{
+		model_uniforms = {};
+		return;
+	}
 
 	auto &render_frame = get_render_context().get_active_frame();
 
-	auto &transform = node.get_transform();
-
-	auto allocation = render_frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(GlobalUniform), thread_index);
+	if (model_upload == ModelUpload::StorageBuffer)
+	{
+		// A tightly packed array, bound once
+		model_uniform_stride = sizeof(ModelUniform);
 
-	global_uniform.model = transform.get_world_matrix();
+		model_uniforms = render_frame.allocate_buffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, items.size() * model_uniform_stride, get_thread_index());
+	}
+	else
+	{
+		VkDeviceSize alignment = render_context.get_device().get_properties().limits.minUniformBufferOffsetAlignment;
+		model_uniform_stride   = (sizeof(ModelUniform) + alignment - 1) / alignment * alignment;
 
-	global_uniform.camera_position = glm::vec3(glm::inverse(camera.get_view())[3]);
+		model_uniforms = render_frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, items.size() * model_uniform_stride, get_thread_index());
+	}
 
-	allocation.update(global_uniform);
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		model_uniforms.map<ModelUniform>(to_u32(i * model_uniform_stride))->model = items[i].node->get_transform().get_render_state().world_matrix;
+	}
 
-	command_buffer.bind_buffer(allocation.get_buffer(), allocation.get_offset(), allocation.get_size(), 0, 1, 0);
+	model_uniforms.flush();
 }
 
-void GeometrySubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, VkFrontFace front_face)
+void GeometrySubpass::update_model_uniforms(CommandBuffer &command_buffer)
 {
-	auto &device = command_buffer.get_device();
+	auto &items = draw_list.get_items();
 
-	RasterizationState rasterization_state{};
-	rasterization_state.front_face = front_face;
+	if (items.empty())
+	{
+		model_uniforms = {};
+		return;
+	}
 
-	if (sub_mesh.get_material()->double_sided)
+	VkDeviceSize alignment = render_context.get_device().get_properties().limits.minUniformBufferOffsetAlignment;
+	model_uniform_stride   = (sizeof(ModelUniform) + alignment - 1) / alignment * alignment;
+
+	VkDeviceSize size = items.size() * model_uniform_stride;
+
+	// The buffer of the active frame was last read by a frame which has completed
+	auto frame_index = render_context.get_active_frame_index();
+
+	if (model_uniform_buffers.size() <= frame_index)
 	{
-		rasterization_state.cull_mode = VK_CULL_MODE_NONE;
+		model_uniform_buffers.resize(frame_index + 1);
+	}
+
+	auto &buffer = model_uniform_buffers[frame_index];
+
+	if (!buffer || buffer->get_size() < size)
+	{
+		buffer = std::make_unique<core::Buffer>(render_context.get_device(), size,
+		                                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                        VMA_MEMORY_USAGE_GPU_ONLY);
+	}
+
+	std::vector<uint8_t> data(static_cast<size_t>(size));
+
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		reinterpret_cast<ModelUniform *>(data.data() + i * model_uniform_stride)->model = items[i].node->get_transform().get_render_state().world_matrix;
+	}
+
+	// vkCmdUpdateBuffer writes at most 64KB at a time
+	const size_t max_update_size = 65536;
+
+	std::vector<uint8_t> chunk;
+
+	for (size_t offset = 0; offset < data.size(); offset += max_update_size)
+	{
+		chunk.assign(data.begin() + offset, data.begin() + std::min(data.size(), offset + max_update_size));
+
+		command_buffer.update_buffer(*buffer, offset, chunk);
 	}
 
-	command_buffer.set_rasterization_state(rasterization_state);
+	BufferMemoryBarrier barrier{};
+	barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	barrier.dst_stage_mask  = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+	barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dst_access_mask = VK_ACCESS_UNIFORM_READ_BIT;
+
+	command_buffer.buffer_memory_barrier(*buffer, 0, size, barrier);
+
+	model_uniforms = BufferAllocation{*buffer, size, 0};
+}
+
+void GeometrySubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, VkFrontFace front_face, BufferAllocation *instance_models, uint32_t instance_count, uint32_t lod)
+{
+	bind_submesh(command_buffer, sub_mesh, front_face, instance_models);
+
+	draw_submesh_command(command_buffer, sub_mesh, instance_count, lod);
+}
+
+void GeometrySubpass::bind_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, VkFrontFace front_face, BufferAllocation *instance_models)
+{
+	auto &device = command_buffer.get_device();
 
-	auto &vert_shader_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), sub_mesh.get_shader_variant());
-	auto &frag_shader_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), sub_mesh.get_shader_variant());
+	command_buffer.set_rasterization_state(get_rasterization_state(sub_mesh, front_face));
+
+	auto &variant            = get_shader_variant(sub_mesh);
+	auto &vert_shader_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), variant);
+	auto &frag_shader_module = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), variant);
 
 	std::vector<ShaderModule *> shader_modules{&vert_shader_module, &frag_shader_module};
 
@@ -180,6 +1381,75 @@ void GeometrySubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &s
 
 	command_buffer.bind_pipeline_layout(pipeline_layout);
 
+	// Modules can be shared by variants, which then differ by the constants of their defines
+	for (auto *shader_module : shader_modules)
+	{
+		for (auto &constant : shader_module->get_define_constants(variant))
+		{
+			command_buffer.set_specialization_constant(constant.first, constant.second);
+		}
+	}
+
+	// Depth-only shaders read no material
+	if (!pipeline_layout.get_push_constant_ranges().empty())
+	{
+		bind_material(command_buffer, sub_mesh, pipeline_layout);
+	}
+
+	command_buffer.set_vertex_input_state(get_vertex_input_state(pipeline_layout, sub_mesh));
+
+	auto pulling_offset_it = vertex_pulling_offsets.find(&sub_mesh);
+
+	if (pulling_offset_it != vertex_pulling_offsets.end())
+	{
+		command_buffer.bind_buffer(*vertex_pulling_layouts, pulling_offset_it->second, sizeof(VertexPullingLayout), 0, VERTEX_PULLING_BINDING, 0);
+
+		auto position_buffer = sub_mesh.get_vertex_buffer("position");
+
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			// The buffers of absent attributes are never read, the position buffer only keeps the binding valid
+			auto vertex_buffer = sub_mesh.get_vertex_buffer(PULLED_ATTRIBUTE_NAMES[i]);
+
+			if (!vertex_buffer)
+			{
+				vertex_buffer = position_buffer;
+			}
+
+			command_buffer.bind_buffer(*vertex_buffer, 0, vertex_buffer->get_size(), 0, VERTEX_PULLING_BINDING + 1 + i, 0);
+		}
+	}
+
+	auto &input_resources = pipeline_layout.get_shader_program().get_resources_by_type(ShaderResourceType::Input);
+
+	// Find submesh vertex buffers matching the shader input attribute names
+	for (auto &input_resource : input_resources)
+	{
+		if (input_resource.stages != VK_SHADER_STAGE_VERTEX_BIT)
+		{
+			continue;
+		}
+
+		if (input_resource.name == INSTANCE_MODEL_NAME)
+		{
+			assert(instance_models && "Instanced shaders require the instance model matrices");
+
+			command_buffer.bind_vertex_buffer(input_resource.location, instance_models->get_buffer(), instance_models->get_offset());
+
+			continue;
+		}
+
+		if (auto vertex_buffer = sub_mesh.get_vertex_buffer(input_resource.name))
+		{
+			// Bind vertex buffers only for the attribute locations defined, shared buffers
+			// stay bound between sub meshes which are offset through the draw instead
+			command_buffer.bind_vertex_buffer(input_resource.location, *vertex_buffer, 0);
+		}
+	}
+}
+
+void GeometrySubpass::bind_material(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, PipelineLayout &pipeline_layout)
+{
 	auto pbr_material = dynamic_cast<const sg::PBRMaterial *>(sub_mesh.get_material());
 
 	PBRMaterialUniform pbr_material_uniform{};
@@ -187,26 +1457,127 @@ void GeometrySubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &s
 	pbr_material_uniform.metallic_factor   = pbr_material->metallic_factor;
 	pbr_material_uniform.roughness_factor  = pbr_material->roughness_factor;
 
-	command_buffer.push_constants_accumulated(pbr_material_uniform);
+	if (bindless_textures && pipeline_layout.has_descriptor_set_layout(BindlessTextures::SET_INDEX))
+	{
+		// Material textures are indices into the texture array, bound regardless of the material
+		BindlessPBRMaterialUniform bindless_material_uniform{};
+		bindless_material_uniform.material = pbr_material_uniform;
+
+		auto &textures = sub_mesh.get_material()->textures;
+
+		auto base_color_texture_it = textures.find("base_color_texture");
+
+		if (base_color_texture_it != textures.end())
+		{
+			bindless_material_uniform.base_color_texture_index = bindless_textures->get_index(*base_color_texture_it->second);
+		}
+
+		command_buffer.push_constants_accumulated(bindless_material_uniform);
 
-	auto &descriptor_set_layout = pipeline_layout.get_descriptor_set_layout(0);
+		auto &descriptor_set = bindless_textures->request_descriptor_set(pipeline_layout.get_descriptor_set_layout(BindlessTextures::SET_INDEX));
 
-	for (auto &texture : sub_mesh.get_material()->textures)
+		command_buffer.bind_descriptor_set(descriptor_set, BindlessTextures::SET_INDEX);
+	}
+	else
 	{
-		if (auto layout_binding = descriptor_set_layout.get_layout_binding(texture.first))
+		// Materials whose base color texture is in an array bind the array, and push the layer of their texture
+		auto base_color_layer = get_base_color_layer(sub_mesh);
+
+		// Paged base color textures bind the pages along with their tail, bound below as the texture itself
+		auto virtual_image = base_color_layer ? nullptr : get_virtual_image(sub_mesh);
+
+		if (base_color_layer)
+		{
+			LayeredPBRMaterialUniform layered_material_uniform{};
+			layered_material_uniform.material                 = pbr_material_uniform;
+			layered_material_uniform.base_color_texture_layer = base_color_layer->layer;
+
+			command_buffer.push_constants_accumulated(layered_material_uniform);
+		}
+		else if (virtual_image)
+		{
+			VirtualPBRMaterialUniform virtual_material_uniform{};
+			virtual_material_uniform.material    = pbr_material_uniform;
+			virtual_material_uniform.page_offset = virtual_image->page_offset;
+			virtual_material_uniform.extent      = virtual_image->extent.width | (virtual_image->extent.height << 16);
+			virtual_material_uniform.level_count = virtual_image->level_count;
+
+			command_buffer.push_constants_accumulated(virtual_material_uniform);
+
+			virtual_textures->bind(command_buffer, *virtual_image);
+		}
+		else
+		{
+			command_buffer.push_constants_accumulated(pbr_material_uniform);
+		}
+
+		// Textures the shaders do not sample are skipped by the lookup
+		for (auto &texture : sub_mesh.get_material()->textures)
 		{
-			command_buffer.bind_image(texture.second->get_image()->get_vk_image_view(),
+			bool layered = base_color_layer && texture.first == TextureArrays::TEXTURE_NAME;
+
+			command_buffer.bind_image(layered ? *base_color_layer->image_view : texture.second->get_image()->get_vk_image_view(),
 			                          texture.second->get_sampler()->vk_sampler,
-			                          0, layout_binding->binding, 0);
+			                          texture.first);
 		}
 	}
+}
+
+glm::mat4 GeometrySubpass::get_view_projection()
+{
+	return vkb::vulkan_style_projection(camera.get_projection()) * camera.get_view();
+}
+
+RasterizationState GeometrySubpass::get_rasterization_state(const sg::SubMesh &sub_mesh, VkFrontFace front_face) const
+{
+	RasterizationState rasterization_state{};
+	rasterization_state.front_face = front_face;
+
+	if (sub_mesh.get_material()->double_sided)
+	{
+		rasterization_state.cull_mode = VK_CULL_MODE_NONE;
+	}
+
+	return rasterization_state;
+}
 
-	auto vertex_input_resources = pipeline_layout.get_shader_program().get_resources(ShaderResourceType::Input, VK_SHADER_STAGE_VERTEX_BIT);
+VertexInputState GeometrySubpass::get_vertex_input_state(const PipelineLayout &pipeline_layout, const sg::SubMesh &sub_mesh) const
+{
+	auto &input_resources = pipeline_layout.get_shader_program().get_resources_by_type(ShaderResourceType::Input);
 
 	VertexInputState vertex_input_state;
 
-	for (auto &input_resource : vertex_input_resources)
+	for (auto &input_resource : input_resources)
 	{
+		if (input_resource.stages != VK_SHADER_STAGE_VERTEX_BIT)
+		{
+			continue;
+		}
+
+		if (input_resource.name == INSTANCE_MODEL_NAME)
+		{
+			// One attribute per column of the matrix, advanced per instance
+			for (uint32_t column = 0; column < input_resource.columns; column++)
+			{
+				VkVertexInputAttributeDescription vertex_attribute{};
+				vertex_attribute.binding  = input_resource.location;
+				vertex_attribute.format   = VK_FORMAT_R32G32B32A32_SFLOAT;
+				vertex_attribute.location = input_resource.location + column;
+				vertex_attribute.offset   = to_u32(column * sizeof(glm::vec4));
+
+				vertex_input_state.attributes.push_back(vertex_attribute);
+			}
+
+			VkVertexInputBindingDescription vertex_binding{};
+			vertex_binding.binding   = input_resource.location;
+			vertex_binding.stride    = sizeof(glm::mat4);
+			vertex_binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+			vertex_input_state.bindings.push_back(vertex_binding);
+
+			continue;
+		}
+
 		sg::VertexAttribute attribute;
 
 		if (!sub_mesh.get_attribute(input_resource.name, attribute))
@@ -229,41 +1600,34 @@ void GeometrySubpass::draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &s
 		vertex_input_state.bindings.push_back(vertex_binding);
 	}
 
-	command_buffer.set_vertex_input_state(vertex_input_state);
-
-	// Find submesh vertex buffers matching the shader input attribute names
-	for (auto &input_resource : vertex_input_resources)
-	{
-		const auto &buffer_iter = sub_mesh.vertex_buffers.find(input_resource.name);
-
-		if (buffer_iter != sub_mesh.vertex_buffers.end())
-		{
-			std::vector<std::reference_wrapper<const core::Buffer>> buffers;
-			buffers.emplace_back(std::ref(buffer_iter->second));
-
-			// Bind vertex buffers only for the attribute locations defined
-			command_buffer.bind_vertex_buffers(input_resource.location, std::move(buffers), {0});
-		}
-	}
-
-	draw_submesh_command(command_buffer, sub_mesh);
+	return vertex_input_state;
 }
 
-void GeometrySubpass::draw_submesh_command(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh)
+void GeometrySubpass::draw_submesh_command(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, uint32_t instance_count, uint32_t lod, uint32_t first_instance)
 {
 	// Draw submesh indexed if indices exists
 	if (sub_mesh.vertex_indices != 0)
 	{
 		// Bind index buffer of submesh
-		command_buffer.bind_index_buffer(*sub_mesh.index_buffer, sub_mesh.index_offset, sub_mesh.index_type);
+		command_buffer.bind_index_buffer(*sub_mesh.get_index_buffer(), sub_mesh.index_offset, sub_mesh.index_type);
+
+		uint32_t index_count = sub_mesh.vertex_indices;
+		uint32_t first_index = sub_mesh.first_index;
+
+		// Simplified levels are ranges of the same index buffer
+		if (lod > 0 && lod <= sub_mesh.lods.size())
+		{
+			index_count = sub_mesh.lods[lod - 1].index_count;
+			first_index += sub_mesh.lods[lod - 1].first_index;
+		}
 
 		// Draw submesh using indexed data
-		command_buffer.draw_indexed(sub_mesh.vertex_indices, 1, 0, 0, 0);
+		command_buffer.draw_indexed(index_count, instance_count, first_index, sub_mesh.vertex_offset, first_instance);
 	}
 	else
 	{
 		// Draw submesh using vertices only
-		command_buffer.draw(sub_mesh.vertices_count, 1, 0, 0);
+		command_buffer.draw(sub_mesh.vertices_count, instance_count, to_u32(sub_mesh.vertex_offset), first_instance);
 	}
 }
 }        // namespace vkb
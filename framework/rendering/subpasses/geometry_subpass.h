@@ -26,29 +26,93 @@ VKBP_DISABLE_WARNINGS()
 #include "common/glm_common.h"
 VKBP_ENABLE_WARNINGS()
 
+#include "rendering/bindless_textures.h"
+#include "rendering/culling.h"
+#include "rendering/draw_list.h"
+#include "rendering/occlusion_queries.h"
 #include "rendering/subpass.h"
+#include "rendering/texture_arrays.h"
+#include "scene_graph/components/spatial_index.h"
+#include "virtual_textures.h"
+
+#define MAX_MULTIVIEW_VIEW_COUNT 4
 
 namespace vkb
 {
+class JobSystem;
+class TextureStreamer;
+
 namespace sg
 {
 class Scene;
 class Node;
 class Mesh;
+class Skin;
 class SubMesh;
 class Camera;
 }        // namespace sg
 
 /**
- * @brief Global uniform structure for base shader
+ * @brief Global uniform structure for base shader, written once for each view
  */
 struct alignas(16) GlobalUniform
 {
-	glm::mat4 model;
-
 	glm::mat4 camera_view_proj;
 
 	glm::vec3 camera_position;
+
+	/// View projection of each view of a multiview subpass, indexed by gl_ViewIndex
+	alignas(16) glm::mat4 view_projs[MAX_MULTIVIEW_VIEW_COUNT];
+
+	/// View projection of the previous frame, which the motion vectors are computed from
+	glm::mat4 previous_view_proj;
+
+	/// Jitter of the projection of this frame (xy) and of the previous one (zw), removed from the motion vectors
+	glm::vec4 jitter;
+};
+
+/**
+ * @brief Model uniform structure for base shader, written for each draw
+ */
+struct ModelUniform
+{
+	glm::mat4 model;
+};
+
+/**
+ * @brief How the model matrices of the draws which are neither skinned nor instanced reach the vertex shader
+ */
+enum class ModelUpload
+{
+	/// Slices of a single uniform allocation of the frame, bound at a dynamic offset
+	DynamicOffset,
+
+	/// Pushed for each draw at GeometrySubpass::MODEL_PUSH_CONSTANT_OFFSET
+	PushConstant,
+
+	/// A storage buffer of the frame holding all the matrices, indexed by the first instance of each draw
+	StorageBuffer,
+
+	/// The slices of DynamicOffset bound without dynamic offsets, so each draw binds a descriptor set of its own
+	DescriptorSet,
+
+	/// A device local uniform buffer written with vkCmdUpdateBuffer before the render pass, bound at a dynamic offset
+	UpdateBuffer
+};
+
+/**
+ * @brief Which objects a geometry subpass draws, and in which order the transparent ones are blended
+ */
+enum class TransparentDraws
+{
+	/// The transparent objects after the opaque ones, alpha blended back to front
+	Sorted,
+
+	/// The opaque objects only, a WeightedBlendedSubpass later in the render pass draws the transparent ones
+	Skipped,
+
+	/// The transparent objects only, grouped by state as the opaque ones, with a blend which does not depend on their order
+	Accumulated
 };
 
 /**
@@ -63,12 +127,69 @@ struct PBRMaterialUniform
 	float roughness_factor;
 };
 
+/**
+ * @brief PBR material uniform for base shader with bindless textures,
+ *        the textures are indices into the BindlessTextures array
+ */
+struct BindlessPBRMaterialUniform
+{
+	PBRMaterialUniform material;
+
+	uint32_t base_color_texture_index;
+};
+
+/**
+ * @brief PBR material uniform for base shader with a base color texture
+ *        sampled from a layer of a TextureArrays array
+ */
+struct LayeredPBRMaterialUniform
+{
+	PBRMaterialUniform material;
+
+	uint32_t base_color_texture_layer;
+};
+
+/**
+ * @brief PBR material uniform for base shader with a base color texture
+ *        sampled through the page table of VirtualTextures
+ */
+struct VirtualPBRMaterialUniform
+{
+	PBRMaterialUniform material;
+
+	uint32_t page_offset;
+
+	/// Width in the low 16 bits, height in the high 16 bits
+	uint32_t extent;
+
+	uint32_t level_count;
+};
+
 /**
  * @brief This subpass is responsible for rendering a Scene
  */
 class GeometrySubpass : public Subpass
 {
   public:
+	/// Name of the per-instance model matrix input of the vertex shaders
+	static const char *INSTANCE_MODEL_NAME;
+
+	/// Maximum number of instances in a single instanced draw
+	static const uint32_t MAX_INSTANCE_COUNT = 1024;
+
+	/// Binding in set 0 of the joint matrices read by the skinning vertex shaders
+	static const uint32_t JOINT_MATRICES_BINDING = 10;
+
+	/// Binding in set 0 of the vertex layout read by the vertex pulling shaders, followed by
+	/// the bindings of the position, normal and texture coordinate buffers
+	static const uint32_t VERTEX_PULLING_BINDING = 11;
+
+	/// Binding in set 0 of the model matrix of the draws which are neither skinned nor instanced
+	static const uint32_t MODEL_BINDING = 15;
+
+	/// Offset of the model matrix pushed with ModelUpload::PushConstant, after the material push constants
+	static const uint32_t MODEL_PUSH_CONSTANT_OFFSET = 64;
+
 	/**
 	 * @brief Constructs a subpass for the geometry pass of Deferred rendering
 	 * @param render_context Render context
@@ -83,22 +204,325 @@ class GeometrySubpass : public Subpass
 
 	virtual void prepare() override;
 
+	/**
+	 * @brief Reads the occlusion query results of the active frame and resets its queries, if occlusion culling is enabled
+	 */
+	virtual void pre_draw(CommandBuffer &command_buffer) override;
+
 	/**
 	 * @brief Record draw commands
 	 */
 	virtual void draw(CommandBuffer &command_buffer) override;
 
-	void update_uniform(CommandBuffer &command_buffer, sg::Node &node, size_t thread_index = 0);
+	/**
+	 * @return VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS if the draws are recorded on a job system
+	 */
+	VkSubpassContents get_contents() const override;
+
+	/**
+	 * @brief Adds the pipeline states of the opaque and transparent sub meshes, for each winding their nodes are drawn with
+	 */
+	void prewarm(const RenderPass &render_pass, uint32_t subpass_index, std::vector<PipelineState> &pipeline_states) override;
+
+	/**
+	 * @brief Binds the global uniform written for the last sorted view at set 0, binding 1
+	 */
+	void bind_global_uniform(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Binds the model uniform of an item of the last sorted draw list, and the joint matrices of its skin if it has one
+	 * @param command_buffer Command buffer to record
+	 * @param items Items of the draw list
+	 * @param item_index Index of the item in the draw list
+	 */
+	void update_uniform(CommandBuffer &command_buffer, const std::vector<DrawItem> &items, size_t item_index);
 
-	void draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, VkFrontFace front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE);
+	/**
+	 * @return The model uniform of an item of the last sorted draw list, a slice of the
+	 *         allocation shared by all the items, which update_uniform binds at set 0, binding MODEL_BINDING
+	 */
+	BufferAllocation get_model_uniform(size_t item_index);
+
+	/**
+	 * @brief Records the draw of a sub mesh
+	 * @param command_buffer Command buffer to record
+	 * @param sub_mesh Sub mesh to draw
+	 * @param front_face Winding of the front faces
+	 * @param instance_models Model matrices of the instances, required if instancing is enabled
+	 * @param instance_count Number of instances in instance_models
+	 * @param lod Level of detail of the sub mesh, zero for the full sub mesh
+	 */
+	void draw_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, VkFrontFace front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+	                  BufferAllocation *instance_models = nullptr, uint32_t instance_count = 1, uint32_t lod = 0);
+
+	/**
+	 * @brief Records the draws of a range of sorted items. If instancing is enabled, consecutive
+	 *        items sharing a sub mesh are drawn with a single instanced draw
+	 * @param command_buffer Command buffer to record
+	 * @param items Sorted draw items
+	 * @param begin Index of the first item to draw
+	 * @param end Index of the item where recording stops (not included)
+	 * @param thread_index Identifies the resources allocated for this thread
+	 */
+	void draw_items(CommandBuffer &command_buffer, const std::vector<DrawItem> &items, size_t begin, size_t end, size_t thread_index = 0);
+
+	/**
+	 * @brief Samples the scene textures from a single update-after-bind array indexed through push constants,
+	 *        instead of binding the textures of each material. Must be set before prepare(),
+	 *        only effective if VK_EXT_descriptor_indexing is enabled
+	 */
+	void set_bindless_textures(bool enable);
+
+	/**
+	 * @brief Packs the base color textures of the scene no larger than a size into texture arrays, so that
+	 *        materials share their descriptors and select their texture with a push constant layer index.
+	 *        Must be set before prepare(), zero disables it. Not used along with bindless textures
+	 * @param max_extent The largest width and height of the textures to pack
+	 */
+	void set_texture_arrays(uint32_t max_extent);
+
+	/**
+	 * @brief Draws sub meshes repeated under several nodes as instances, reading the model
+	 *        matrices from a per-instance vertex buffer. Must be set before prepare()
+	 */
+	void set_instancing(bool enable);
+
+	bool uses_instancing() const;
+
+	/**
+	 * @brief Draws the opaque objects against the depth written by a DepthPrepassSubpass earlier in the
+	 *        render pass, with an equal depth compare and no depth writes, so each pixel is shaded once
+	 */
+	void set_depth_prepass(bool enable);
+
+	bool uses_depth_prepass() const;
+
+	/**
+	 * @brief Sets which objects are skipped when sorting the nodes to draw
+	 */
+	void set_culling_options(const CullingOptions &options);
+
+	const CullingOptions &get_culling_options() const;
+
+	/**
+	 * @brief Skips the objects whose bounding box was hidden by the opaque objects in a previous frame.
+	 *        The boxes of the objects in the frustum are drawn with an occlusion query each after the
+	 *        opaque objects, and their results are read frames later without waiting. Objects drawn
+	 *        on a job system are never queried
+	 */
+	void set_occlusion_culling(bool enable);
+
+	bool uses_occlusion_culling() const;
+
+	/**
+	 * @brief Draws the simplified levels of detail of the sub meshes which have some, picked by their
+	 *        screen size with hysteresis. Enabled by default, the full sub meshes are drawn otherwise
+	 */
+	void set_lod_selection(bool enable);
+
+	bool uses_lod_selection() const;
+
+	/**
+	 * @brief Fetches the positions, normals and texture coordinates in the vertex shaders from storage buffers
+	 *        indexed by the vertex index, decoding the format given by a uniform, instead of using fixed-function
+	 *        vertex input. Sub meshes then share a pipeline whichever vertex format they were loaded with.
+	 *        Must be set before prepare(), sub meshes with attributes not aligned to four bytes keep the vertex input
+	 */
+	void set_vertex_pulling(bool enable);
+
+	bool uses_vertex_pulling() const;
+
+	/**
+	 * @brief Writes the screen space motion of the surfaces since the previous frame to the second output
+	 *        attachment of the subpass, in a two channel float format, without the jitter of the camera.
+	 *        The motion follows the camera only, the previous transforms of the nodes are not kept.
+	 *        Must be set before prepare()
+	 */
+	void set_motion_vectors(bool enable);
+
+	bool uses_motion_vectors() const;
+
+	/**
+	 * @brief Sets which objects are drawn and how the transparent ones are ordered, see TransparentDraws.
+	 *        Sorted by default
+	 */
+	void set_transparent_draws(TransparentDraws draws);
+
+	TransparentDraws get_transparent_draws() const;
+
+	sg::Camera &get_camera();
+
+	sg::Scene &get_scene();
+
+	/**
+	 * @return Number of sub meshes drawn and culled the last time the nodes were sorted
+	 */
+	const CullingStats &get_culling_stats() const;
+
+	/**
+	 * @brief Requests the mip levels of the textures of the visible objects from a streamer,
+	 *        according to their size on screen
+	 */
+	void set_texture_streamer(TextureStreamer *streamer);
+
+	/**
+	 * @brief Samples the base color textures paged by VirtualTextures through their page table, the tail
+	 *        of their levels standing in for the pages not resident. Must be set before prepare(),
+	 *        not used along with bindless textures, nor for the textures packed into texture arrays
+	 */
+	void set_virtual_textures(VirtualTextures *textures);
+
+	/**
+	 * @brief Sets definitions added to the shader variants of the sub meshes for this subpass only,
+	 *        such as the G-buffer packing. Must be set before prepare()
+	 */
+	void set_shader_definitions(const std::vector<std::string> &definitions);
+
+	/**
+	 * @brief Sets the view projection of each view of a multiview subpass, see Subpass::set_view_mask(), which the
+	 *        shaders index with gl_ViewIndex, such as the eyes of a stereo pair. The draws are still culled and sorted
+	 *        with the camera of the subpass, whose frustum should contain the frustums of the views.
+	 *        The view mask must be set before prepare(), the view projections can change every frame
+	 * @param view_projections At most MAX_MULTIVIEW_VIEW_COUNT matrices, one for each bit up to the last of the view mask
+	 */
+	void set_view_projections(const std::vector<glm::mat4> &view_projections);
+
+	/**
+	 * @brief Records the draws in secondary command buffers on the threads of a job system, the calling
+	 *        thread records its share as well. The opaque draws are split by estimated recording cost, the
+	 *        transparent draws are recorded last in a single command buffer unless accumulated. The render context must be
+	 *        prepared with the thread count of the job system, the draws are recorded on the calling thread
+	 *        only otherwise. The subpass must be drawn from the thread which created the job system, and
+	 *        no other commands can be recorded in the subpass. Set null to record inline
+	 */
+	void set_job_system(JobSystem *jobs);
+
+	/**
+	 * @brief Sets how the model matrices are uploaded, see ModelUpload. Must be set before prepare()
+	 */
+	void set_model_upload(ModelUpload upload);
+
+	ModelUpload get_model_upload() const;
 
   protected:
 	/**
-	 * @brief Sorts objects based on distance from camera and classifies them
-	 *        into opaque and transparent in the arrays provided
+	 * @brief Writes the model matrices of the sorted draw list to the device local buffer of the frame
+	 *        with transfer commands, recorded before the render pass for ModelUpload::UpdateBuffer
+	 */
+	void update_model_uniforms(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Gathers the meshes and skins of the scene again and prepares their shader variants,
+	 *        once subtrees were attached to or detached from the scene, see sg::Scene::attach
+	 */
+	void refresh_meshes();
+
+	/**
+	 * @brief Registers the scene textures into the bindless array and adds the
+	 *        bindless definitions to the sub mesh variants, if bindless textures are enabled
+	 */
+	void prepare_bindless_textures();
+
+	/**
+	 * @brief Writes the vertex layouts of the sub meshes which can be pulled, if vertex pulling is enabled
+	 */
+	void prepare_vertex_pulling();
+
+	/**
+	 * @brief Packs the small base color textures into arrays, if texture arrays are enabled
+	 */
+	void prepare_texture_arrays();
+
+	/**
+	 * @return The layer holding the base color texture of a sub mesh, nullptr if it is not in a texture array
+	 */
+	const TextureArrays::Layer *get_base_color_layer(const sg::SubMesh &sub_mesh) const;
+
+	/**
+	 * @return The paged image of the base color texture of a sub mesh, nullptr if it is not sampled through virtual textures
+	 */
+	const VirtualTextures::PagedImage *get_virtual_image(const sg::SubMesh &sub_mesh) const;
+
+	/**
+	 * @brief Fills the draw list with the visible objects and sorts it, opaque objects come
+	 *        first grouped by state, then transparent objects in back-to-front order unless they are accumulated.
+	 *        Objects rejected by the culling options or by the transparent draws are left out
+	 */
+	void get_sorted_nodes(DrawList &draw_list);
+
+	/**
+	 * @return The definitions added to the shader variants of a multiview subpass, none if it is not multiview
 	 */
-	void get_sorted_nodes(std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &opaque_nodes,
-	                      std::multimap<float, std::pair<sg::Node *, sg::SubMesh *>> &transparent_nodes);
+	std::vector<std::string> get_multiview_definitions() const;
+
+	/**
+	 * @return The definitions selecting the model matrix input of the vertex shaders, none for uniforms
+	 */
+	std::vector<std::string> get_model_upload_definitions() const;
+
+	/**
+	 * @brief Writes the camera of the view returned by get_view_projection() once to the active frame
+	 */
+	void upload_global_uniform();
+
+	/**
+	 * @brief Writes the model matrices of all the items of a sorted draw list to a single allocation of the active frame,
+	 *        from which each draw binds its own at a dynamic offset, so that the descriptor set is shared by the draws
+	 */
+	void upload_model_uniforms(const DrawList &draw_list);
+
+	/**
+	 * @brief Writes the joint matrices of each skin of the scene once to the active frame,
+	 *        from which the draws of the skinned nodes bind them
+	 */
+	void upload_joint_palettes();
+
+	/**
+	 * @brief Binds the resources shared by all the draws of the subpass, called for each
+	 *        command buffer the draws are recorded in
+	 */
+	virtual void bind_draw_resources(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Sets the pipeline state, material and vertex buffers of a sub mesh,
+	 *        without recording the draw itself
+	 */
+	void bind_submesh(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, VkFrontFace front_face, BufferAllocation *instance_models);
+
+	/**
+	 * @brief Pushes the material factors of a sub mesh and binds its textures
+	 */
+	void bind_material(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, PipelineLayout &pipeline_layout);
+
+	/**
+	 * @return The view projection the objects are culled and drawn with, the one of the camera by default
+	 */
+	virtual glm::mat4 get_view_projection();
+
+	/**
+	 * @return The rasterization state a sub mesh is drawn with
+	 */
+	virtual RasterizationState get_rasterization_state(const sg::SubMesh &sub_mesh, VkFrontFace front_face) const;
+
+	/**
+	 * @return The vertex input matching the attributes of a sub mesh to the inputs of its shaders
+	 */
+	VertexInputState get_vertex_input_state(const PipelineLayout &pipeline_layout, const sg::SubMesh &sub_mesh) const;
+
+	/**
+	 * @return The depth state of the opaque draws
+	 */
+	DepthStencilState get_opaque_depth_stencil_state() const;
+
+	/**
+	 * @return The blend state of the transparent draws
+	 */
+	virtual ColorBlendState get_transparent_blend_state() const;
+
+	/**
+	 * @return Variant of the sub mesh including the shader definitions of this subpass
+	 */
+	const ShaderVariant &get_shader_variant(const sg::SubMesh &sub_mesh) const;
 
 	sg::Camera &camera;
 
@@ -106,8 +530,144 @@ class GeometrySubpass : public Subpass
 
 	sg::Scene &scene;
 
+	/// Version of the scene the meshes were gathered from
+	uint64_t scene_version{0};
+
+	bool use_bindless_textures{false};
+
+	std::unique_ptr<BindlessTextures> bindless_textures;
+
+	uint32_t texture_array_max_extent{0};
+
+	std::unique_ptr<TextureArrays> texture_arrays;
+
+	bool use_instancing{false};
+
+	bool depth_prepass{false};
+
+	bool lod_selection{true};
+
+	bool vertex_pulling{false};
+
+	bool motion_vectors{false};
+
+	TransparentDraws transparent_draws{TransparentDraws::Sorted};
+
+	/// View projection and jitter of the camera the last time the global uniform was written
+	glm::mat4 previous_view_projection{1.0f};
+
+	glm::vec2 previous_jitter{0.0f};
+
+	bool has_previous_view{false};
+
+	/// Vertex layouts of the pulled sub meshes, one per uniform buffer offset alignment
+	std::unique_ptr<core::Buffer> vertex_pulling_layouts;
+
+	/// Offset of the layout of each pulled sub mesh
+	std::unordered_map<const sg::SubMesh *, VkDeviceSize> vertex_pulling_offsets;
+
+	CullingOptions culling_options;
+
+	CullingStats culling_stats;
+
+	/// Bounds of the nodes of the meshes, reused every frame
+	BoundsBatch node_bounds;
+
+	std::vector<uint8_t> frustum_visible;
+
+	/// Nodes found in the frustum by the spatial index of the scene, if it has one, reused every frame
+	std::vector<const sg::SpatialIndex::Item *> frustum_items;
+
+	std::unique_ptr<OcclusionQueries> occlusion_queries;
+
+	/// Reused every frame to avoid reallocating the draws
+	DrawList draw_list;
+
+	TextureStreamer *texture_streamer{nullptr};
+
+	VirtualTextures *virtual_textures{nullptr};
+
+	JobSystem *job_system{nullptr};
+
+	std::vector<std::string> shader_definitions;
+
+	/// View projections of the views of a multiview subpass
+	std::vector<glm::mat4> view_projections;
+
+	/// Sub mesh variants combined with the shader definitions, the sub meshes are shared with other subpasses
+	std::unordered_map<const sg::SubMesh *, ShaderVariant> shader_variants;
+
+	std::vector<sg::Skin *> skins;
+
+	/// Camera of the last sorted view
+	BufferAllocation global_uniform;
+
+	/// Model matrices of the items of the last sorted draw list, one every model_uniform_stride bytes
+	BufferAllocation model_uniforms;
+
+	VkDeviceSize model_uniform_stride{0};
+
+	ModelUpload model_upload{ModelUpload::DynamicOffset};
+
+	/// Device local model uniforms written by update_model_uniforms, one per frame in flight
+	std::vector<std::unique_ptr<core::Buffer>> model_uniform_buffers;
+
+	/// Joint matrices of the skins, uploaded when the nodes are sorted
+	std::unordered_map<const sg::Skin *, BufferAllocation> joint_palettes;
+
   private:
-	void draw_submesh_command(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh);
+	using LodKey = std::pair<const sg::Node *, const sg::SubMesh *>;
+
+	struct LodKeyHash
+	{
+		size_t operator()(const LodKey &key) const
+		{
+			size_t result = 0;
+			hash_combine(result, key.first);
+			hash_combine(result, key.second);
+			return result;
+		}
+	};
+
+	void draw_submesh_command(CommandBuffer &command_buffer, sg::SubMesh &sub_mesh, uint32_t instance_count, uint32_t lod, uint32_t first_instance = 0);
+
+	/**
+	 * @brief Picks the level of detail of a sub mesh under a node from its screen size, starting from the level drawn last
+	 * @param node Node of the sub mesh
+	 * @param sub_mesh Sub mesh to draw
+	 * @param screen_size Projected height of the bounding sphere as a fraction of the viewport
+	 * @return The level to draw, zero for the full sub mesh
+	 */
+	uint32_t select_lod(const sg::Node &node, const sg::SubMesh &sub_mesh, float screen_size);
+
+	/**
+	 * @return Whether the sub mesh is drawn by this subpass, according to the transparent draws
+	 */
+	bool draws_submesh(const sg::SubMesh &sub_mesh) const;
+
+	/**
+	 * @brief Sets the blend and depth states of the transparent draws
+	 */
+	void set_transparent_state(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Draws the sorted items in secondary command buffers recorded on the job system
+	 */
+	void draw_secondary(CommandBuffer &primary_command_buffer);
+
+	/**
+	 * @return A secondary command buffer with the draws of a range of items
+	 */
+	CommandBuffer *record_secondary(CommandBuffer &primary_command_buffer, const std::vector<DrawItem> &items, size_t begin, size_t end, size_t thread_index, bool transparent);
+
+	/**
+	 * @return Consecutive ranges of items with a similar recording cost, at most range_count.
+	 *         Items which could be drawn as instances of each other are kept in the same range
+	 */
+	FrameVector<std::pair<size_t, size_t>> split_by_cost(const std::vector<DrawItem> &items, size_t begin, size_t end, size_t range_count) const;
+
+	/// Level of detail drawn last for each sub mesh under a node
+	std::unordered_map<LodKey, uint32_t, LodKeyHash> selected_lods;
 };
 
 }        // namespace vkb
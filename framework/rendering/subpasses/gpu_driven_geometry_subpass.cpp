@@ -0,0 +1,418 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/subpasses/gpu_driven_geometry_subpass.h"
+
+#include <cstring>
+
+#include "common/utils.h"
+#include "rendering/render_context.h"
+#include "scene_graph/components/camera.h"
+#include "scene_graph/components/material.h"
+#include "scene_graph/components/mesh.h"
+#include "scene_graph/components/sub_mesh.h"
+#include "scene_graph/node.h"
+
+namespace vkb
+{
+namespace
+{
+/// Numbers of objects culled by each invocation group of the compute shader, tuned per device
+const std::vector<WorkgroupSize> WORKGROUP_SIZES{{64, 1}, {32, 1}, {128, 1}, {256, 1}};
+
+bool is_flipped(sg::Node &node)
+{
+	const auto &scale = node.get_transform().get_scale();
+	return scale.x * scale.y * scale.z < 0;
+}
+
+sg::AABB get_world_bounds(const sg::Mesh &mesh, const glm::mat4 &node_transform)
+{
+	const sg::AABB &mesh_bounds = mesh.get_bounds();
+
+	sg::AABB world_bounds{mesh_bounds.get_min(), mesh_bounds.get_max()};
+	world_bounds.transform(node_transform);
+
+	return world_bounds;
+}
+}        // namespace
+
+GpuDrivenGeometrySubpass::GpuDrivenGeometrySubpass(RenderContext &render_context, ShaderSource &&vertex_source, ShaderSource &&fragment_source, sg::Scene &scene_, sg::Camera &camera) :
+    GeometrySubpass{render_context, std::move(vertex_source), std::move(fragment_source), scene_, camera},
+    culling_shader{"gpu_driven/culling.comp"}
+{
+	set_debug_name("GPU driven geometry");
+
+	// The model matrices of the batches are read from the instance buffer
+	set_instancing(true);
+}
+
+void GpuDrivenGeometrySubpass::prepare()
+{
+	GeometrySubpass::prepare();
+
+	auto &device = render_context.get_device();
+
+	use_draw_indirect_count = device.is_enabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+	device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_COMPUTE_BIT, culling_shader);
+
+	prepare_objects();
+}
+
+void GpuDrivenGeometrySubpass::set_async_compute(bool enable)
+{
+	async_compute = enable;
+}
+
+bool GpuDrivenGeometrySubpass::uses_async_compute() const
+{
+	return async_compute;
+}
+
+void GpuDrivenGeometrySubpass::prepare_objects()
+{
+	batches.clear();
+	cpu_items.clear();
+	frame_buffers.clear();
+	object_buffer.reset();
+	reset_buffer.reset();
+
+	std::vector<Object> objects;
+
+	std::map<std::pair<const sg::SubMesh *, VkFrontFace>, uint32_t> batch_indices;
+
+	for (auto &mesh : meshes)
+	{
+		for (auto &node : mesh->get_nodes())
+		{
+			// Objects are uploaded between frames, from the simulated state
+			auto &node_transform = node->get_transform().get_world_matrix();
+
+			auto world_bounds = get_world_bounds(*mesh, node_transform);
+
+			VkFrontFace front_face = is_flipped(*node) ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+			for (auto &sub_mesh : mesh->get_submeshes())
+			{
+				// Blending needs sorted draws, and indirect commands need indices
+				if (sub_mesh->get_material()->alpha_mode == sg::AlphaMode::Blend || sub_mesh->vertex_indices == 0)
+				{
+					cpu_items.push_back({mesh, {node, sub_mesh}});
+					continue;
+				}
+
+				auto batch_it = batch_indices.emplace(std::make_pair(sub_mesh, front_face), to_u32(batches.size())).first;
+
+				if (batch_it->second == batches.size())
+				{
+					Batch batch{};
+					batch.sub_mesh   = sub_mesh;
+					batch.front_face = front_face;
+					batches.push_back(batch);
+				}
+
+				batches[batch_it->second].instance_count++;
+
+				Object object{};
+				object.model       = node_transform;
+				object.bounds_min  = glm::vec4(world_bounds.get_min(), 1.0f);
+				object.bounds_max  = glm::vec4(world_bounds.get_max(), 1.0f);
+				object.batch_index = batch_it->second;
+
+				objects.push_back(object);
+			}
+		}
+	}
+
+	object_count = to_u32(objects.size());
+
+	instance_count = 0;
+
+	if (objects.empty())
+	{
+		return;
+	}
+
+	// Each batch owns a contiguous range of the instance buffer
+	for (auto &batch : batches)
+	{
+		batch.instance_base = instance_count;
+		instance_count += batch.instance_count;
+	}
+
+	for (auto &object : objects)
+	{
+		object.instance_base = batches[object.batch_index].instance_base;
+	}
+
+	auto &device = render_context.get_device();
+
+	object_buffer = std::make_unique<core::Buffer>(device, objects.size() * sizeof(Object), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	object_buffer->update(reinterpret_cast<const uint8_t *>(objects.data()), objects.size() * sizeof(Object));
+
+	std::vector<VkDrawIndexedIndirectCommand> commands(batches.size());
+	for (size_t i = 0; i < batches.size(); i++)
+	{
+		commands[i].indexCount   = batches[i].sub_mesh->vertex_indices;
+		commands[i].firstIndex   = batches[i].sub_mesh->first_index;
+		commands[i].vertexOffset = batches[i].sub_mesh->vertex_offset;
+	}
+
+	// The counts are bound as a separate storage buffer, so align them to the largest valid offset alignment
+	auto commands_size = commands.size() * sizeof(VkDrawIndexedIndirectCommand);
+	counts_offset      = (commands_size + 255) & ~VkDeviceSize{255};
+
+	std::vector<uint8_t> reset_data(to_u32(counts_offset + batches.size() * sizeof(uint32_t)), 0);
+	std::memcpy(reset_data.data(), commands.data(), commands_size);
+
+	reset_buffer = std::make_unique<core::Buffer>(device, reset_data.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	reset_buffer->update(reset_data);
+}
+
+GpuDrivenGeometrySubpass::FrameBuffers &GpuDrivenGeometrySubpass::get_frame_buffers()
+{
+	auto frame_index = render_context.get_active_frame_index();
+
+	if (frame_buffers.size() <= frame_index)
+	{
+		frame_buffers.resize(frame_index + 1);
+	}
+
+	auto &buffers = frame_buffers[frame_index];
+
+	if (!buffers.indirect_buffer)
+	{
+		auto &device = render_context.get_device();
+
+		// The culling may run on the compute queue, the draws read its results on the graphics queue
+		std::vector<uint32_t> queue_families{render_context.get_queue().get_family_index(), render_context.get_compute_queue().get_family_index()};
+
+		buffers.indirect_buffer = std::make_unique<core::Buffer>(device, reset_buffer->get_size(),
+		                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                                         VMA_MEMORY_USAGE_GPU_ONLY, 0, queue_families);
+
+		buffers.instance_buffer = std::make_unique<core::Buffer>(device, instance_count * sizeof(glm::mat4),
+		                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		                                                         VMA_MEMORY_USAGE_GPU_ONLY, 0, queue_families);
+	}
+
+	return buffers;
+}
+
+void GpuDrivenGeometrySubpass::pre_draw(CommandBuffer &command_buffer)
+{
+	if (!reset_buffer)
+	{
+		return;
+	}
+
+	// The buffers of the frame were last read by a frame which has completed
+	auto &buffers = get_frame_buffers();
+
+	if (async_compute)
+	{
+		auto &compute_queue = render_context.get_compute_queue();
+
+		auto &compute_command_buffer = render_context.get_active_frame().request_command_buffer(compute_queue);
+
+		compute_command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+		record_culling(compute_command_buffer, buffers);
+
+		compute_command_buffer.end();
+
+		// Only the draws wait, the work of the frame before them overlaps the culling
+		render_context.submit_compute(compute_command_buffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+	}
+	else
+	{
+		record_culling(command_buffer, buffers);
+	}
+
+	// With async compute the semaphore orders the queues, and the barrier orders a shared queue
+	{
+		BufferMemoryBarrier barrier{};
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+		barrier.src_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dst_access_mask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+		command_buffer.buffer_memory_barrier(*buffers.indirect_buffer, 0, VK_WHOLE_SIZE, barrier);
+
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+		barrier.dst_access_mask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+		command_buffer.buffer_memory_barrier(*buffers.instance_buffer, 0, VK_WHOLE_SIZE, barrier);
+	}
+}
+
+void GpuDrivenGeometrySubpass::record_culling(CommandBuffer &command_buffer, FrameBuffers &buffers)
+{
+	auto &indirect_buffer = *buffers.indirect_buffer;
+	auto &instance_buffer = *buffers.instance_buffer;
+
+	command_buffer.copy_buffer(*reset_buffer, indirect_buffer, reset_buffer->get_size());
+
+	{
+		BufferMemoryBarrier barrier{};
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		command_buffer.buffer_memory_barrier(indirect_buffer, 0, VK_WHOLE_SIZE, barrier);
+	}
+
+	auto &resource_cache = command_buffer.get_device().get_resource_cache();
+
+	auto &shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_COMPUTE_BIT, culling_shader);
+
+	std::vector<ShaderModule *> shader_modules{&shader_module};
+
+	command_buffer.bind_pipeline_layout(resource_cache.request_pipeline_layout(shader_modules, false));
+
+	auto batches_size = batches.size() * sizeof(uint32_t);
+
+	command_buffer.bind_buffer(*object_buffer, 0, object_buffer->get_size(), 0, 0, 0);
+	command_buffer.bind_buffer(indirect_buffer, 0, batches.size() * sizeof(VkDrawIndexedIndirectCommand), 0, 1, 0);
+	command_buffer.bind_buffer(indirect_buffer, counts_offset, batches_size, 0, 2, 0);
+	command_buffer.bind_buffer(instance_buffer, 0, instance_buffer.get_size(), 0, 3, 0);
+
+	Frustum frustum{vkb::vulkan_style_projection(camera.get_projection()) * camera.get_view()};
+
+	CullingUniform culling_uniform{};
+
+	for (size_t i = 0; i < frustum.get_planes().size(); i++)
+	{
+		// A plane which passes every point disables frustum culling
+		culling_uniform.planes[i] = culling_options.frustum ? frustum.get_planes()[i] : glm::vec4{0.0f, 0.0f, 0.0f, 1.0f};
+	}
+
+	culling_uniform.camera_position = glm::vec4(glm::vec3(camera.get_node()->get_transform().get_render_state().world_matrix[3]), culling_options.max_distance);
+	culling_uniform.object_count    = object_count;
+
+	command_buffer.push_constants(0, culling_uniform);
+
+	command_buffer.get_device().get_workgroup_tuner().dispatch(command_buffer, culling_shader.get_filename(), WORKGROUP_SIZES, object_count);
+}
+
+void GpuDrivenGeometrySubpass::draw(CommandBuffer &command_buffer)
+{
+	upload_global_uniform();
+
+	if (reset_buffer)
+	{
+		auto &buffers = get_frame_buffers();
+
+		auto &indirect_buffer = *buffers.indirect_buffer;
+		// The model matrices come from the instance buffer
+		bind_global_uniform(command_buffer);
+
+		const uint32_t command_stride = sizeof(VkDrawIndexedIndirectCommand);
+
+		for (size_t i = 0; i < batches.size(); i++)
+		{
+			auto &batch = batches[i];
+
+			BufferAllocation instance_models{*buffers.instance_buffer, batch.instance_count * sizeof(glm::mat4), batch.instance_base * sizeof(glm::mat4)};
+
+			bind_submesh(command_buffer, *batch.sub_mesh, batch.front_face, &instance_models);
+
+			command_buffer.bind_index_buffer(*batch.sub_mesh->get_index_buffer(), batch.sub_mesh->index_offset, batch.sub_mesh->index_type);
+
+			if (use_draw_indirect_count)
+			{
+				command_buffer.draw_indexed_indirect_count(indirect_buffer, i * command_stride,
+				                                           indirect_buffer, counts_offset + i * sizeof(uint32_t), 1, command_stride);
+			}
+			else
+			{
+				// Batches without visible instances are drawn with an instance count of zero
+				command_buffer.draw_indexed_indirect(indirect_buffer, i * command_stride, 1, command_stride);
+			}
+		}
+	}
+
+	draw_cpu_items(command_buffer);
+}
+
+void GpuDrivenGeometrySubpass::draw_cpu_items(CommandBuffer &command_buffer)
+{
+	culling_stats = {};
+
+	if (cpu_items.empty())
+	{
+		return;
+	}
+
+	Frustum frustum{vkb::vulkan_style_projection(camera.get_projection()) * camera.get_view()};
+
+	glm::vec3 camera_position{camera.get_node()->get_transform().get_render_state().world_matrix[3]};
+
+	draw_list.clear();
+
+	for (auto &cpu_item : cpu_items)
+	{
+		auto &item = cpu_item.item;
+
+		auto world_bounds = get_world_bounds(*cpu_item.mesh, item.node->get_transform().get_render_state().world_matrix);
+
+		if (culling_options.frustum && !frustum.intersects(world_bounds))
+		{
+			culling_stats.frustum_culled++;
+			continue;
+		}
+
+		culling_stats.visible++;
+
+		draw_list.add(*item.node, *item.sub_mesh, glm::length(camera_position - world_bounds.get_center()));
+	}
+
+	draw_list.sort();
+
+	upload_model_uniforms(draw_list);
+
+	auto &items = draw_list.get_items();
+
+	draw_items(command_buffer, items, 0, draw_list.get_opaque_count());
+
+	if (draw_list.get_opaque_count() == items.size())
+	{
+		return;
+	}
+
+	// Enable alpha blending
+	ColorBlendAttachmentState color_blend_attachment{};
+	color_blend_attachment.blend_enable           = VK_TRUE;
+	color_blend_attachment.src_color_blend_factor = VK_BLEND_FACTOR_SRC_ALPHA;
+	color_blend_attachment.dst_color_blend_factor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+
+	ColorBlendState color_blend_state{};
+	color_blend_state.attachments.resize(get_output_attachments().size());
+	color_blend_state.attachments[0] = color_blend_attachment;
+	command_buffer.set_color_blend_state(color_blend_state);
+
+	command_buffer.set_depth_stencil_state(get_depth_stencil_state());
+
+	// Draw transparent objects in back-to-front order
+	draw_items(command_buffer, items, draw_list.get_opaque_count(), items.size());
+}
+}        // namespace vkb
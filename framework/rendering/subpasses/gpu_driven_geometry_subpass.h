@@ -0,0 +1,172 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "rendering/subpasses/geometry_subpass.h"
+
+namespace vkb
+{
+/**
+ * @brief Geometry subpass which culls and submits the opaque indexed sub meshes on the GPU.
+ *
+ * The world bounds and transforms of all the nodes are uploaded once in prepare(), so the
+ * scene is expected to be static. Before the render pass a compute dispatch culls them
+ * against the camera frustum. The visible instances of each sub mesh are written into an
+ * instance buffer, and their count into one VkDrawIndexedIndirectCommand per sub mesh.
+ * Sub meshes are then drawn with vkCmdDrawIndexedIndirectCountKHR where available, so that
+ * batches without visible instances are skipped, falling back to vkCmdDrawIndexedIndirect.
+ *
+ * Transparent and non-indexed sub meshes are still sorted and drawn on the CPU.
+ *
+ * With async compute the culling is submitted to the compute queue, so that it overlaps the
+ * graphics work of the previous frame, and the indirect draws wait for it.
+ */
+class GpuDrivenGeometrySubpass : public GeometrySubpass
+{
+  public:
+	GpuDrivenGeometrySubpass(RenderContext &render_context, ShaderSource &&vertex_shader, ShaderSource &&fragment_shader, sg::Scene &scene, sg::Camera &camera);
+
+	virtual ~GpuDrivenGeometrySubpass() = default;
+
+	virtual void prepare() override;
+
+	/**
+	 * @brief Resets the indirect commands and dispatches the culling shader
+	 */
+	virtual void pre_draw(CommandBuffer &command_buffer) override;
+
+	virtual void draw(CommandBuffer &command_buffer) override;
+
+	/**
+	 * @brief Selects whether the culling is submitted to the compute queue of the render context
+	 *        instead of being recorded in the command buffer of the frame
+	 */
+	void set_async_compute(bool enable);
+
+	bool uses_async_compute() const;
+
+  private:
+	/**
+	 * @brief Node and bounds of a sub mesh instance, as read by the culling shader
+	 */
+	struct Object
+	{
+		glm::mat4 model;
+
+		glm::vec4 bounds_min;
+
+		glm::vec4 bounds_max;
+
+		uint32_t batch_index;
+
+		uint32_t instance_base;
+
+		uint32_t padding[2];
+	};
+
+	/**
+	 * @brief Push constants of the culling shader
+	 */
+	struct CullingUniform
+	{
+		glm::vec4 planes[6];
+
+		/// The w component is the maximum distance, zero to disable it
+		glm::vec4 camera_position;
+
+		uint32_t object_count;
+	};
+
+	/**
+	 * @brief Instances of a sub mesh drawn with a single indirect command
+	 */
+	struct Batch
+	{
+		sg::SubMesh *sub_mesh{nullptr};
+
+		VkFrontFace front_face{VK_FRONT_FACE_COUNTER_CLOCKWISE};
+
+		uint32_t instance_base{0};
+
+		uint32_t instance_count{0};
+	};
+
+	/**
+	 * @brief Draw which is sorted and culled on the CPU
+	 */
+	struct CpuItem
+	{
+		sg::Mesh *mesh{nullptr};
+
+		DrawItem item;
+	};
+
+	ShaderSource culling_shader;
+
+	std::vector<Batch> batches;
+
+	/// Draws which are not handled by the GPU
+	std::vector<CpuItem> cpu_items;
+
+	uint32_t object_count{0};
+
+	/// Number of instances of all the batches, the size of the instance buffers
+	uint32_t instance_count{0};
+
+	/// Offset of the draw counts after the commands in the indirect buffer
+	VkDeviceSize counts_offset{0};
+
+	std::unique_ptr<core::Buffer> object_buffer;
+
+	/// Commands with no instances, copied over the indirect buffer every frame
+	std::unique_ptr<core::Buffer> reset_buffer;
+
+	/**
+	 * @brief Buffers written by the culling, one set per frame so that a frame culls while the previous one draws
+	 */
+	struct FrameBuffers
+	{
+		std::unique_ptr<core::Buffer> indirect_buffer;
+
+		std::unique_ptr<core::Buffer> instance_buffer;
+	};
+
+	std::vector<FrameBuffers> frame_buffers;
+
+	bool use_draw_indirect_count{false};
+
+	bool async_compute{false};
+
+	void prepare_objects();
+
+	/**
+	 * @brief Returns the buffers of the active frame, created the first time the frame uses them
+	 */
+	FrameBuffers &get_frame_buffers();
+
+	/**
+	 * @brief Resets the indirect commands of the frame and dispatches the culling shader
+	 */
+	void record_culling(CommandBuffer &command_buffer, FrameBuffers &buffers);
+
+	void draw_cpu_items(CommandBuffer &command_buffer);
+};
+}        // namespace vkb
@@ -22,6 +22,7 @@
 
 #include "buffer_pool.h"
 #include "rendering/render_context.h"
+#include "rendering/shadow_map.h"
 #include "scene_graph/components/camera.h"
 #include "scene_graph/scene.h"
 
@@ -32,22 +33,43 @@ LightingSubpass::LightingSubpass(RenderContext &render_context, ShaderSource &&v
     camera{cam},
     scene{scene_}
 {
+	set_debug_name("Lighting");
 }
 
 void LightingSubpass::prepare()
 {
-	add_definitions(lighting_variant, {"MAX_DEFERRED_LIGHT_COUNT " + std::to_string(MAX_DEFERRED_LIGHT_COUNT)});
+	add_definitions(lighting_variant, {"MAX_DEFERRED_LIGHT_COUNT " + std::to_string(MAX_DEFERRED_LIGHT_COUNT), "CLUSTERED_LIGHTS"});
 	add_definitions(lighting_variant, light_type_definitions);
+	add_definitions(lighting_variant, shader_definitions);
+
+	if (shadow_map)
+	{
+		add_definitions(lighting_variant, {"SHADOWS", "MAX_SHADOW_CASCADE_COUNT " + std::to_string(MAX_SHADOW_CASCADE_COUNT)});
+	}
+
 	// Build all shaders upfront
 	auto &resource_cache = render_context.get_device().get_resource_cache();
 	resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), lighting_variant);
 	resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), lighting_variant);
 }
 
+void LightingSubpass::set_shader_definitions(const std::vector<std::string> &definitions)
+{
+	shader_definitions = definitions;
+}
+
+void LightingSubpass::set_shadow_map(ShadowMap *shadow_map_)
+{
+	shadow_map = shadow_map_;
+}
+
 void LightingSubpass::draw(CommandBuffer &command_buffer)
 {
-	auto light_buffer = allocate_lights<DeferredLights>(scene.get_components<sg::Light>(), MAX_DEFERRED_LIGHT_COUNT);
-	command_buffer.bind_buffer(light_buffer.get_buffer(), light_buffer.get_offset(), light_buffer.get_size(), 0, 4, 0);
+	auto &render_frame = get_render_context().get_active_frame();
+
+	light_clusters.update(scene.get_components<sg::Light>(), camera, render_frame.get_render_target().get_render_extent());
+	light_clusters.upload(render_frame, get_thread_index());
+	light_clusters.bind(command_buffer, 0, 4);
 
 	// Get shaders from cache
 	auto &resource_cache     = command_buffer.get_device().get_resource_cache();
@@ -83,18 +105,22 @@ void LightingSubpass::draw(CommandBuffer &command_buffer)
 	LightUniform light_uniform;
 
 	// Inverse resolution
-	light_uniform.inv_resolution.x = 1.0f / render_target.get_extent().width;
-	light_uniform.inv_resolution.y = 1.0f / render_target.get_extent().height;
+	light_uniform.inv_resolution.x = 1.0f / render_target.get_render_extent().width;
+	light_uniform.inv_resolution.y = 1.0f / render_target.get_render_extent().height;
 
 	// Inverse view projection
 	light_uniform.inv_view_proj = glm::inverse(vulkan_style_projection(camera.get_projection()) * camera.get_view());
 
 	// Allocate a buffer using the buffer pool from the active frame to store uniform values and bind it
-	auto &render_frame = get_render_context().get_active_frame();
-	auto  allocation   = render_frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(LightUniform));
+	auto allocation = render_frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(LightUniform), get_thread_index());
 	allocation.update(light_uniform);
 	command_buffer.bind_buffer(allocation.get_buffer(), allocation.get_offset(), allocation.get_size(), 0, 3, 0);
 
+	if (shadow_map)
+	{
+		shadow_map->bind(command_buffer, 0, 7, get_thread_index());
+	}
+
 	// Draw full screen triangle triangle
 	command_buffer.draw(3, 1, 0, 0);
 }
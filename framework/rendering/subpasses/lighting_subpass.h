@@ -21,6 +21,7 @@
 #pragma once
 
 #include "buffer_pool.h"
+#include "rendering/light_clusters.h"
 #include "rendering/subpass.h"
 
 VKBP_DISABLE_WARNINGS()
@@ -29,8 +30,13 @@ VKBP_ENABLE_WARNINGS()
 
 #define MAX_DEFERRED_LIGHT_COUNT 100
 
+/// Scale of the distance to point lights before their attenuation in deferred/lighting.frag
+#define DEFERRED_LIGHT_DISTANCE_SCALE 0.005f
+
 namespace vkb
 {
+class ShadowMap;
+
 namespace sg
 {
 class Camera;
@@ -57,6 +63,7 @@ struct alignas(16) DeferredLights
 
 /**
  * @brief Lighting pass of Deferred Rendering
+ *        Lights are assigned to clusters of the view frustum, see LightClusters
  */
 class LightingSubpass : public Subpass
 {
@@ -67,12 +74,30 @@ class LightingSubpass : public Subpass
 
 	void draw(CommandBuffer &command_buffer) override;
 
+	/**
+	 * @brief Sets definitions added to the lighting shader variant, they must match
+	 *        the packing of the G-buffer written by the geometry subpass. Must be set before prepare()
+	 */
+	void set_shader_definitions(const std::vector<std::string> &definitions);
+
+	/**
+	 * @brief Shadows the directional lights with a shadow map, which must be drawn before this subpass.
+	 *        Must be set before prepare()
+	 */
+	void set_shadow_map(ShadowMap *shadow_map);
+
   private:
 	sg::Camera &camera;
 
 	sg::Scene &scene;
 
 	ShaderVariant lighting_variant;
+
+	std::vector<std::string> shader_definitions;
+
+	ShadowMap *shadow_map{nullptr};
+
+	LightClusters light_clusters{DEFERRED_LIGHT_DISTANCE_SCALE};
 };
 
 }        // namespace vkb
@@ -0,0 +1,105 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/subpasses/post_processing_subpass.h"
+
+#include "core/command_buffer.h"
+#include "rendering/render_context.h"
+
+namespace vkb
+{
+PostProcessingSubpass::PostProcessingSubpass(RenderContext &render_context, ShaderSource &&fragment_shader, const ShaderVariant &variant_,
+                                             const PostProcessingParameters &parameters_, const core::Sampler &sampler_) :
+    Subpass{render_context, ShaderSource{"post_processing/fullscreen.vert"}, std::move(fragment_shader)},
+    variant{variant_},
+    parameters{parameters_},
+    sampler{sampler_}
+{
+	set_debug_name("Post-processing");
+
+	// The full screen triangle covers every pixel, the depth attachment is not used
+	auto &depth_stencil_state              = get_depth_stencil_state();
+	depth_stencil_state.depth_test_enable  = VK_FALSE;
+	depth_stencil_state.depth_write_enable = VK_FALSE;
+}
+
+void PostProcessingSubpass::prepare()
+{
+	auto &resource_cache = render_context.get_device().get_resource_cache();
+	resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), variant);
+	resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), variant);
+}
+
+void PostProcessingSubpass::set_sampled_images(const std::vector<uint32_t> &images)
+{
+	sampled_images = images;
+}
+
+void PostProcessingSubpass::set_direction(const glm::vec2 &direction_)
+{
+	direction = direction_;
+}
+
+void PostProcessingSubpass::draw(CommandBuffer &command_buffer)
+{
+	auto &resource_cache     = command_buffer.get_device().get_resource_cache();
+	auto &vert_shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), variant);
+	auto &frag_shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), variant);
+
+	std::vector<ShaderModule *> shader_modules{&vert_shader_module, &frag_shader_module};
+
+	command_buffer.bind_pipeline_layout(resource_cache.request_pipeline_layout(shader_modules, use_dynamic_resources));
+
+	auto &render_target = render_context.get_active_frame().get_render_target();
+	auto &views         = render_target.get_views();
+
+	uint32_t binding = 0;
+
+	for (auto input : get_input_attachments())
+	{
+		command_buffer.bind_input(views.at(input), 0, binding++, 0);
+	}
+
+	for (auto image : sampled_images)
+	{
+		command_buffer.bind_image(views.at(image), sampler, 0, binding++, 0);
+	}
+
+	// The full screen triangle is clockwise
+	RasterizationState rasterization_state;
+	rasterization_state.cull_mode = VK_CULL_MODE_NONE;
+	command_buffer.set_rasterization_state(rasterization_state);
+
+	command_buffer.set_depth_stencil_state(get_depth_stencil_state());
+
+	auto &extent = render_target.get_render_extent();
+
+	PostProcessingConstants constants{};
+	constants.texel_size      = {1.0f / extent.width, 1.0f / extent.height};
+	constants.direction       = direction;
+	constants.exposure        = parameters.exposure;
+	constants.bloom_threshold = parameters.bloom_threshold;
+	constants.bloom_intensity = parameters.bloom_intensity;
+
+	command_buffer.push_constants(0, constants);
+
+	command_buffer.draw(3, 1, 0, 0);
+}
+}        // namespace vkb
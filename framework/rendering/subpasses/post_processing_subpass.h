@@ -0,0 +1,96 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "core/sampler.h"
+#include "rendering/subpass.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+namespace vkb
+{
+/**
+ * @brief Parameters of the post-processing effects, shared by all their passes
+ */
+struct PostProcessingParameters
+{
+	/// Scale of the scene color before tone mapping
+	float exposure{1.0f};
+
+	/// Luminance above which pixels bloom
+	float bloom_threshold{1.0f};
+
+	/// Scale of the bloom added to the scene color
+	float bloom_intensity{0.5f};
+};
+
+/**
+ * @brief Push constants of the post-processing shaders, see shaders/post_processing
+ */
+struct PostProcessingConstants
+{
+	glm::vec2 texel_size;
+	glm::vec2 direction;
+	float     exposure;
+	float     bloom_threshold;
+	float     bloom_intensity;
+};
+
+/**
+ * @brief Draws a full screen triangle with a post-processing fragment shader
+ *        Input attachments are bound from binding 0, followed by the sampled images
+ */
+class PostProcessingSubpass : public Subpass
+{
+  public:
+	PostProcessingSubpass(RenderContext &render_context, ShaderSource &&fragment_shader, const ShaderVariant &variant,
+	                      const PostProcessingParameters &parameters, const core::Sampler &sampler);
+
+	virtual ~PostProcessingSubpass() = default;
+
+	virtual void prepare() override;
+
+	void draw(CommandBuffer &command_buffer) override;
+
+	/**
+	 * @brief Sets the images of the render target sampled by the fragment shader
+	 */
+	void set_sampled_images(const std::vector<uint32_t> &images);
+
+	/**
+	 * @brief Sets the direction of a separable filter, in texels
+	 */
+	void set_direction(const glm::vec2 &direction);
+
+  private:
+	ShaderVariant variant;
+
+	const PostProcessingParameters &parameters;
+
+	const core::Sampler &sampler;
+
+	std::vector<uint32_t> sampled_images;
+
+	glm::vec2 direction{0.0f, 0.0f};
+};
+}        // namespace vkb
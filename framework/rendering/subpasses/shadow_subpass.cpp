@@ -0,0 +1,344 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/subpasses/shadow_subpass.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+VKBP_DISABLE_WARNINGS()
+#include <glm/gtc/matrix_transform.hpp>
+VKBP_ENABLE_WARNINGS()
+
+#include "common/utils.h"
+#include "rendering/render_context.h"
+#include "scene_graph/components/aabb.h"
+#include "scene_graph/components/camera.h"
+#include "scene_graph/components/light.h"
+#include "scene_graph/components/mesh.h"
+#include "scene_graph/components/sub_mesh.h"
+#include "scene_graph/components/transform.h"
+#include "scene_graph/node.h"
+
+namespace vkb
+{
+ShadowSubpass::ShadowSubpass(RenderContext &render_context, sg::Scene &scene_, sg::Camera &camera, sg::Light &light, const ShadowOptions &options_) :
+    DepthPrepassSubpass{render_context, scene_, camera},
+    light{light},
+    options{options_}
+{
+	set_debug_name("Shadows");
+
+	assert(options.cascade_count > 0 && "Shadows require at least one cascade");
+
+	options.cascade_count = std::min(options.cascade_count, to_u32(MAX_SHADOW_CASCADE_COUNT));
+
+	cascades.resize(options.cascade_count);
+
+	for (uint32_t i = options.first_cached_cascade; i < options.cascade_count; ++i)
+	{
+		cascades[i].cached = true;
+	}
+
+	// Cascades are laid out in tiles of two columns
+	atlas_columns = options.cascade_count > 1 ? 2 : 1;
+}
+
+void ShadowSubpass::update_cascades()
+{
+	auto view       = camera.get_view();
+	auto projection = vulkan_style_projection(camera.get_projection());
+
+	auto inv_view       = glm::inverse(view);
+	auto inv_projection = glm::inverse(projection);
+
+	// Corners of the near plane in view space, the depth is reversed
+	std::array<glm::vec3, 4> near_corners;
+
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		glm::vec4 corner = inv_projection * glm::vec4(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, 1.0f, 1.0f);
+		near_corners[i] = glm::vec3(corner) / corner.w;
+	}
+
+	float near_depth = -near_corners[0].z;
+
+	// The camera far plane bounds the cascades if closer than the shadow distance, unless it is at infinity
+	float far_depth = options.distance;
+
+	glm::vec4 far_point = inv_projection * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	if (far_point.w != 0.0f && -far_point.z / far_point.w > near_depth)
+	{
+		far_depth = std::min(far_depth, -far_point.z / far_point.w);
+	}
+
+	auto light_direction = glm::normalize(light.get_node()->get_transform().get_render_state().rotation * light.get_properties().direction);
+
+	// Casters outside of the view frustum still cast shadows into it
+	sg::AABB scene_bounds;
+
+	for (auto &mesh : meshes)
+	{
+		for (auto &node : mesh->get_nodes())
+		{
+			auto node_transform = node->get_transform().get_render_state().world_matrix;
+
+			sg::AABB world_bounds{mesh->get_bounds().get_min(), mesh->get_bounds().get_max()};
+			world_bounds.transform(node_transform);
+
+			scene_bounds.update(world_bounds.get_min());
+			scene_bounds.update(world_bounds.get_max());
+		}
+	}
+
+	float slice_near = near_depth;
+
+	for (uint32_t i = 0; i < options.cascade_count; ++i)
+	{
+		auto &cascade = cascades[i];
+
+		// Practical split scheme, blending logarithmic and uniform splits
+		float fraction      = static_cast<float>(i + 1) / options.cascade_count;
+		float log_split     = near_depth * std::pow(far_depth / near_depth, fraction);
+		float uniform_split = near_depth + (far_depth - near_depth) * fraction;
+		float slice_far     = options.split_lambda * log_split + (1.0f - options.split_lambda) * uniform_split;
+
+		// The rays through the near corners reach both ends of the slice
+		std::array<glm::vec3, 8> corners;
+
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			corners[c]     = glm::vec3(inv_view * glm::vec4(near_corners[c] * (slice_near / near_depth), 1.0f));
+			corners[c + 4] = glm::vec3(inv_view * glm::vec4(near_corners[c] * (slice_far / near_depth), 1.0f));
+		}
+
+		glm::vec3 center{0.0f};
+
+		for (auto &corner : corners)
+		{
+			center += corner / 8.0f;
+		}
+
+		// The radius only depends on the slice, so the size of the cascade does not change as the view rotates
+		float radius = 0.0f;
+
+		for (auto &corner : corners)
+		{
+			radius = std::max(radius, glm::length(corner - center));
+		}
+
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		cascade.split_depth = slice_far;
+		cascade.rendered    = true;
+
+		if (cascade.cached)
+		{
+			bool light_moved = glm::dot(light_direction, cascade.light_direction) < 0.9999f;
+
+			bool slice_covered = glm::length(center - cascade.center) + radius <= cascade.radius;
+
+			if (cascade.valid && !light_moved && slice_covered)
+			{
+				cascade.rendered = false;
+			}
+			else
+			{
+				fit_cascade(cascade, center, radius * (1.0f + options.cache_margin), light_direction, scene_bounds);
+			}
+		}
+		else
+		{
+			fit_cascade(cascade, center, radius, light_direction, scene_bounds);
+		}
+
+		slice_near = slice_far;
+	}
+}
+
+void ShadowSubpass::fit_cascade(ShadowCascade &cascade, const glm::vec3 &center, float radius, const glm::vec3 &light_direction, const sg::AABB &scene_bounds)
+{
+	// Rotation only, so that the texel grid of the light space does not depend on the position of the view
+	glm::vec3 up         = std::abs(light_direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::mat4 light_view = glm::lookAt(glm::vec3(0.0f), light_direction, up);
+
+	// Snap the center to whole texels, the shadow edges stay still as the view moves
+	float texel_size = 2.0f * radius / options.resolution;
+
+	glm::vec3 light_center = glm::vec3(light_view * glm::vec4(center, 1.0f));
+	light_center.x         = std::floor(light_center.x / texel_size) * texel_size;
+	light_center.y         = std::floor(light_center.y / texel_size) * texel_size;
+
+	// Depth range of the scene along the light direction
+	float min_depth = std::numeric_limits<float>::max();
+	float max_depth = std::numeric_limits<float>::lowest();
+
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		glm::vec3 corner{i & 1 ? scene_bounds.get_max().x : scene_bounds.get_min().x,
+		                 i & 2 ? scene_bounds.get_max().y : scene_bounds.get_min().y,
+		                 i & 4 ? scene_bounds.get_max().z : scene_bounds.get_min().z};
+
+		float depth = -(light_view * glm::vec4(corner, 1.0f)).z;
+		min_depth   = std::min(min_depth, depth);
+		max_depth   = std::max(max_depth, depth);
+	}
+
+	// Note: Using reversed depth, so Znear and Zfar are flipped
+	auto light_projection = glm::ortho(light_center.x - radius, light_center.x + radius, light_center.y - radius, light_center.y + radius, max_depth, min_depth);
+
+	cascade.view_proj       = vulkan_style_projection(light_projection) * light_view;
+	cascade.center          = center;
+	cascade.radius          = radius;
+	cascade.light_direction = light_direction;
+	cascade.valid           = true;
+}
+
+void ShadowSubpass::draw(CommandBuffer &command_buffer)
+{
+	for (uint32_t i = 0; i < options.cascade_count; ++i)
+	{
+		auto &cascade = cascades[i];
+
+		if (!cascade.rendered)
+		{
+			continue;
+		}
+
+		command_buffer.begin_gpu_scope("Cascade " + std::to_string(i));
+
+		auto rect = get_cascade_rect(i);
+
+		VkViewport viewport{};
+		viewport.x        = static_cast<float>(rect.offset.x);
+		viewport.y        = static_cast<float>(rect.offset.y);
+		viewport.width    = static_cast<float>(rect.extent.width);
+		viewport.height   = static_cast<float>(rect.extent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		command_buffer.set_viewport(0, {viewport});
+		command_buffer.set_scissor(0, {rect});
+
+		// The other cascades of the atlas are loaded untouched
+		VkClearAttachment clear_attachment{};
+		clear_attachment.aspectMask              = VK_IMAGE_ASPECT_DEPTH_BIT;
+		clear_attachment.clearValue.depthStencil = {0.0f, ~0U};
+
+		VkClearRect clear_rect{};
+		clear_rect.rect       = rect;
+		clear_rect.layerCount = 1;
+
+		command_buffer.clear(clear_attachment, clear_rect);
+
+		command_buffer.set_depth_bias(options.depth_bias_constant, 0.0f, options.depth_bias_slope);
+
+		active_cascade = i;
+
+		get_sorted_nodes(draw_list);
+
+		bind_draw_resources(command_buffer);
+
+		draw_items(command_buffer, draw_list.get_items(), 0, draw_list.get_opaque_count());
+
+		cascade.caster_count = to_u32(draw_list.get_opaque_count());
+
+		command_buffer.end_gpu_scope();
+	}
+}
+
+void ShadowSubpass::invalidate_cached_cascades()
+{
+	for (auto &cascade : cascades)
+	{
+		cascade.valid = false;
+	}
+}
+
+bool ShadowSubpass::has_rendered_cascades() const
+{
+	return std::any_of(cascades.begin(), cascades.end(), [](const ShadowCascade &cascade) { return cascade.rendered; });
+}
+
+const ShadowOptions &ShadowSubpass::get_options() const
+{
+	return options;
+}
+
+const std::vector<ShadowCascade> &ShadowSubpass::get_cascades() const
+{
+	return cascades;
+}
+
+VkExtent2D ShadowSubpass::get_atlas_extent() const
+{
+	uint32_t rows = (options.cascade_count + atlas_columns - 1) / atlas_columns;
+
+	return {atlas_columns * options.resolution, rows * options.resolution};
+}
+
+VkRect2D ShadowSubpass::get_cascade_rect(uint32_t cascade) const
+{
+	VkRect2D rect{};
+	rect.offset.x = static_cast<int32_t>((cascade % atlas_columns) * options.resolution);
+	rect.offset.y = static_cast<int32_t>((cascade / atlas_columns) * options.resolution);
+	rect.extent   = {options.resolution, options.resolution};
+
+	return rect;
+}
+
+ShadowUniform ShadowSubpass::get_uniform()
+{
+	ShadowUniform uniform{};
+	uniform.view  = camera.get_view();
+	uniform.count = options.cascade_count;
+
+	auto atlas_extent = get_atlas_extent();
+
+	for (uint32_t i = 0; i < options.cascade_count; ++i)
+	{
+		auto rect = get_cascade_rect(i);
+
+		uniform.view_proj[i]   = cascades[i].view_proj;
+		uniform.split_depth[i] = cascades[i].split_depth;
+		uniform.atlas_rect[i]  = {static_cast<float>(rect.offset.x) / atlas_extent.width,
+                                  static_cast<float>(rect.offset.y) / atlas_extent.height,
+                                  static_cast<float>(rect.extent.width) / atlas_extent.width,
+                                  static_cast<float>(rect.extent.height) / atlas_extent.height};
+	}
+
+	return uniform;
+}
+
+glm::mat4 ShadowSubpass::get_view_projection()
+{
+	return cascades[active_cascade].view_proj;
+}
+
+RasterizationState ShadowSubpass::get_rasterization_state(const sg::SubMesh &sub_mesh, VkFrontFace front_face) const
+{
+	auto rasterization_state = GeometrySubpass::get_rasterization_state(sub_mesh, front_face);
+
+	rasterization_state.depth_bias_enable = VK_TRUE;
+
+	return rasterization_state;
+}
+}        // namespace vkb
@@ -0,0 +1,205 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+#include "rendering/subpasses/depth_prepass_subpass.h"
+
+#define MAX_SHADOW_CASCADE_COUNT 4
+
+namespace vkb
+{
+namespace sg
+{
+class AABB;
+class Light;
+}        // namespace sg
+
+/**
+ * @brief Settings of cascaded shadow maps
+ */
+struct ShadowOptions
+{
+	/// Width and height of the shadow map of each cascade, in texels
+	uint32_t resolution{1024};
+
+	/// Number of cascades splitting the view frustum, at most MAX_SHADOW_CASCADE_COUNT
+	uint32_t cascade_count{4};
+
+	/// Distance from the camera covered by the cascades
+	float distance{2000.0f};
+
+	/// Blend between uniform (0) and logarithmic (1) split distances
+	float split_lambda{0.75f};
+
+	/// Cascades from this one onwards are cached: they are rendered again only when the light moves,
+	/// when the view leaves the area they cover or when they are invalidated. The cascade count disables caching
+	uint32_t first_cached_cascade{2};
+
+	/// Fraction by which the area of cached cascades is enlarged, so that the view can move before they are rendered again
+	float cache_margin{0.25f};
+
+	/// Depth bias pushing the casters away from the light, negative as the depth is reversed
+	float depth_bias_constant{-1.25f};
+
+	float depth_bias_slope{-1.75f};
+};
+
+/**
+ * @brief A cascade, covering a slice of the view frustum
+ */
+struct ShadowCascade
+{
+	/// Light view projection the cascade was last rendered with
+	glm::mat4 view_proj{1.0f};
+
+	/// View space distance where the slice of the cascade ends
+	float split_depth{0.0f};
+
+	/// Bounding sphere of the area covered by the cascade
+	glm::vec3 center{0.0f};
+
+	float radius{0.0f};
+
+	/// Light direction the cascade was last rendered with
+	glm::vec3 light_direction{0.0f};
+
+	/// Whether the content of the shadow map can be sampled
+	bool valid{false};
+
+	/// Whether the cascade is cached instead of rendered every frame
+	bool cached{false};
+
+	/// Whether the cascade is rendered in the current frame
+	bool rendered{false};
+
+	/// Number of casters drawn the last time the cascade was rendered
+	uint32_t caster_count{0};
+};
+
+/**
+ * @brief Cascades as read by the shadow sampling of the lighting shaders
+ */
+struct alignas(16) ShadowUniform
+{
+	glm::mat4 view;
+
+	glm::mat4 view_proj[MAX_SHADOW_CASCADE_COUNT];
+
+	/// Offset (xy) and scale (zw) of the cascades in the atlas
+	glm::vec4 atlas_rect[MAX_SHADOW_CASCADE_COUNT];
+
+	glm::vec4 split_depth;
+
+	uint32_t count;
+};
+
+/**
+ * @brief Renders the shadow casters of a directional light into the cascades of a shadow atlas,
+ *        each cascade being a tile of the depth attachment. The cascades fit bounding spheres
+ *        of slices of the view frustum, snapped to texels so that their edges do not shimmer
+ */
+class ShadowSubpass : public DepthPrepassSubpass
+{
+  public:
+	/**
+	 * @brief Constructs a subpass rendering the shadows of a light
+	 * @param render_context Render context
+	 * @param scene Scene to render on this subpass
+	 * @param camera Camera whose view frustum the cascades cover
+	 * @param light Directional light casting the shadows
+	 * @param options Resolution and cascade settings
+	 */
+	ShadowSubpass(RenderContext &render_context, sg::Scene &scene, sg::Camera &camera, sg::Light &light, const ShadowOptions &options);
+
+	virtual ~ShadowSubpass() = default;
+
+	/**
+	 * @brief Fits the cascades to the view, and selects the ones rendered in the current frame
+	 */
+	void update_cascades();
+
+	/**
+	 * @brief Record the draws of the cascades rendered in the current frame
+	 */
+	virtual void draw(CommandBuffer &command_buffer) override;
+
+	/**
+	 * @brief Renders the cached cascades again in the next frame, to be called when the shadow casters change
+	 */
+	void invalidate_cached_cascades();
+
+	/**
+	 * @return True if at least one cascade is rendered in the current frame
+	 */
+	bool has_rendered_cascades() const;
+
+	const ShadowOptions &get_options() const;
+
+	const std::vector<ShadowCascade> &get_cascades() const;
+
+	/**
+	 * @return Extent of the atlas the cascades are rendered to
+	 */
+	VkExtent2D get_atlas_extent() const;
+
+	/**
+	 * @return Area of a cascade in the atlas
+	 */
+	VkRect2D get_cascade_rect(uint32_t cascade) const;
+
+	ShadowUniform get_uniform();
+
+  protected:
+	/**
+	 * @return The view projection of the cascade being drawn
+	 */
+	glm::mat4 get_view_projection() override;
+
+	/**
+	 * @return The rasterization state of a sub mesh, with depth bias
+	 */
+	RasterizationState get_rasterization_state(const sg::SubMesh &sub_mesh, VkFrontFace front_face) const override;
+
+  private:
+	/**
+	 * @brief Sets the view projection of a cascade covering a bounding sphere, along the light direction
+	 *        from the first caster to the last one of the scene bounds
+	 */
+	void fit_cascade(ShadowCascade &cascade, const glm::vec3 &center, float radius, const glm::vec3 &light_direction, const sg::AABB &scene_bounds);
+
+	sg::Light &light;
+
+	ShadowOptions options;
+
+	std::vector<ShadowCascade> cascades;
+
+	uint32_t active_cascade{0};
+
+	/// Number of columns of cascades in the atlas
+	uint32_t atlas_columns{1};
+};
+}        // namespace vkb
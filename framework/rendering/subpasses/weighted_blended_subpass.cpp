@@ -0,0 +1,121 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/subpasses/weighted_blended_subpass.h"
+
+#include "rendering/render_context.h"
+
+namespace vkb
+{
+WeightedBlendedSubpass::WeightedBlendedSubpass(RenderContext &render_context, sg::Scene &scene, sg::Camera &camera) :
+    ForwardSubpass{render_context, ShaderSource{"base.vert"}, ShaderSource{"base.frag"}, scene, camera}
+{
+	set_debug_name("Weighted blended");
+
+	set_transparent_draws(TransparentDraws::Accumulated);
+
+	// Only this subpass draws the instancing variants, the subpass of the opaque objects shares the sub meshes
+	set_instancing(true);
+	set_shader_definitions({"WEIGHTED_BLENDED_TRANSPARENCY", "INSTANCING"});
+
+	// Tested against the opaque objects, the transparent ones do not hide each other
+	get_depth_stencil_state().depth_write_enable = VK_FALSE;
+}
+
+ColorBlendState WeightedBlendedSubpass::get_transparent_blend_state() const
+{
+	ColorBlendAttachmentState accumulation{};
+	accumulation.blend_enable           = VK_TRUE;
+	accumulation.src_color_blend_factor = VK_BLEND_FACTOR_ONE;
+	accumulation.dst_color_blend_factor = VK_BLEND_FACTOR_ONE;
+	accumulation.src_alpha_blend_factor = VK_BLEND_FACTOR_ONE;
+	accumulation.dst_alpha_blend_factor = VK_BLEND_FACTOR_ONE;
+
+	// The revealage is multiplied by one minus the coverage of each fragment
+	ColorBlendAttachmentState revealage{};
+	revealage.blend_enable           = VK_TRUE;
+	revealage.src_color_blend_factor = VK_BLEND_FACTOR_ZERO;
+	revealage.dst_color_blend_factor = VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
+	revealage.src_alpha_blend_factor = VK_BLEND_FACTOR_ZERO;
+	revealage.dst_alpha_blend_factor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+
+	ColorBlendState color_blend_state{};
+	color_blend_state.attachments = {accumulation, revealage};
+
+	return color_blend_state;
+}
+
+WeightedBlendedResolveSubpass::WeightedBlendedResolveSubpass(RenderContext &render_context) :
+    Subpass{render_context, ShaderSource{"post_processing/fullscreen.vert"}, ShaderSource{"weighted_blended_resolve.frag"}}
+{
+	set_debug_name("Weighted blended resolve");
+
+	// Covers the whole screen whatever was drawn before
+	get_depth_stencil_state().depth_test_enable  = VK_FALSE;
+	get_depth_stencil_state().depth_write_enable = VK_FALSE;
+}
+
+void WeightedBlendedResolveSubpass::prepare()
+{
+	auto &resource_cache = render_context.get_device().get_resource_cache();
+	resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), resolve_variant);
+	resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), resolve_variant);
+}
+
+void WeightedBlendedResolveSubpass::draw(CommandBuffer &command_buffer)
+{
+	auto &resource_cache     = command_buffer.get_device().get_resource_cache();
+	auto &vert_shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader(), resolve_variant);
+	auto &frag_shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader(), resolve_variant);
+
+	auto &pipeline_layout = resource_cache.request_pipeline_layout({&vert_shader_module, &frag_shader_module}, use_dynamic_resources);
+	command_buffer.bind_pipeline_layout(pipeline_layout);
+
+	auto &target_views = get_render_context().get_active_frame().get_render_target().get_views();
+	auto &inputs       = get_input_attachments();
+
+	assert(inputs.size() == 2 && "The input attachments must be the accumulation and the revealage");
+
+	command_buffer.bind_input(target_views.at(inputs[0]), 0, 0, 0);
+	command_buffer.bind_input(target_views.at(inputs[1]), 0, 1, 0);
+
+	// Blends the average color of the transparent objects over the opaque ones by their total coverage
+	ColorBlendAttachmentState color_blend_attachment{};
+	color_blend_attachment.blend_enable           = VK_TRUE;
+	color_blend_attachment.src_color_blend_factor = VK_BLEND_FACTOR_SRC_ALPHA;
+	color_blend_attachment.dst_color_blend_factor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	color_blend_attachment.src_alpha_blend_factor = VK_BLEND_FACTOR_ZERO;
+	color_blend_attachment.dst_alpha_blend_factor = VK_BLEND_FACTOR_ONE;
+
+	ColorBlendState color_blend_state{};
+	color_blend_state.attachments.resize(get_output_attachments().size());
+	color_blend_state.attachments[0] = color_blend_attachment;
+	command_buffer.set_color_blend_state(color_blend_state);
+
+	command_buffer.set_depth_stencil_state(get_depth_stencil_state());
+
+	// The full screen triangle is drawn whichever its winding
+	RasterizationState rasterization_state;
+	rasterization_state.cull_mode = VK_CULL_MODE_NONE;
+	command_buffer.set_rasterization_state(rasterization_state);
+
+	command_buffer.draw(3, 1, 0, 0);
+}
+}        // namespace vkb
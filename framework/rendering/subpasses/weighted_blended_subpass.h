@@ -0,0 +1,81 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "rendering/subpasses/forward_subpass.h"
+
+namespace vkb
+{
+/**
+ * @brief Draws the transparent objects of a Scene with weighted blended order-independent transparency
+ *        (McGuire and Bavoil 2013). Each fragment adds its premultiplied color, weighted by its coverage
+ *        and distance, to an accumulation output and multiplies a revealage output by its transmittance.
+ *        As blending does not depend on the order, the objects are grouped by state and drawn as instances
+ *        without being sorted back to front. The two outputs are transient attachments, see
+ *        RenderTarget::create_weighted_blended_func, cleared to 0 and 1 respectively, which a
+ *        WeightedBlendedResolveSubpass blends over the opaque color in the next subpass.
+ *        The opaque objects are drawn by a subpass before it skipping the transparent draws, see TransparentDraws
+ */
+class WeightedBlendedSubpass : public ForwardSubpass
+{
+  public:
+	/**
+	 * @brief Constructs a subpass writing to the accumulation and revealage attachments,
+	 *        the output attachments must be set to them in this order
+	 * @param render_context Render context
+	 * @param scene Scene to render on this subpass
+	 * @param camera Camera used to look at the scene
+	 */
+	WeightedBlendedSubpass(RenderContext &render_context, sg::Scene &scene, sg::Camera &camera);
+
+	virtual ~WeightedBlendedSubpass() = default;
+
+  protected:
+	/**
+	 * @return Additive blending to the accumulation, and the transmittance multiplied into the revealage
+	 */
+	ColorBlendState get_transparent_blend_state() const override;
+};
+
+/**
+ * @brief Blends the transparent objects accumulated by a WeightedBlendedSubpass over the color attachment,
+ *        with a full screen triangle reading the accumulation and revealage as input attachments
+ */
+class WeightedBlendedResolveSubpass : public Subpass
+{
+  public:
+	/**
+	 * @brief Constructs a subpass writing to the color attachment, the input attachments
+	 *        must be set to the accumulation and revealage attachments in this order
+	 * @param render_context Render context
+	 */
+	WeightedBlendedResolveSubpass(RenderContext &render_context);
+
+	virtual ~WeightedBlendedResolveSubpass() = default;
+
+	virtual void prepare() override;
+
+	void draw(CommandBuffer &command_buffer) override;
+
+  private:
+	ShaderVariant resolve_variant;
+};
+}        // namespace vkb
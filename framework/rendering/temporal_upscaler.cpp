@@ -0,0 +1,231 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/temporal_upscaler.h"
+
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "rendering/render_target.h"
+
+namespace vkb
+{
+namespace
+{
+/// Workgroup size of the resolve, in each of the two dimensions of the output
+const uint32_t WORKGROUP_SIZE = 8;
+
+struct alignas(16) ResolveConstants
+{
+	/// Area of the scene render target rendered to, in pixels
+	glm::vec2 render_extent;
+
+	glm::vec2 output_extent;
+
+	/// Jitter of the frame, in rendered pixels
+	glm::vec2 jitter;
+
+	float blend_factor;
+
+	uint32_t history_valid;
+};
+
+/**
+ * @return The element of the Halton sequence of a base, in [0, 1)
+ */
+float halton(uint32_t index, uint32_t base)
+{
+	float result   = 0.0f;
+	float fraction = 1.0f;
+
+	while (index > 0)
+	{
+		fraction /= base;
+		result += fraction * (index % base);
+		index /= base;
+	}
+
+	return result;
+}
+}        // namespace
+
+TemporalUpscaler::TemporalUpscaler(Device &device) :
+    device{device}
+{
+	// The history is reprojected between pixels, and the new samples are fetched without filtering
+	VkSamplerCreateInfo sampler_info{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+	sampler_info.magFilter    = VK_FILTER_LINEAR;
+	sampler_info.minFilter    = VK_FILTER_LINEAR;
+	sampler_info.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+	sampler = &device.get_resource_cache().request_sampler(sampler_info);
+}
+
+glm::vec2 TemporalUpscaler::next_jitter(const VkExtent2D &render_extent)
+{
+	// The first elements of the Halton sequence cover the pixel evenly, index 0 is skipped as it is the corner
+	jitter_phase = (jitter_phase + 1) % JITTER_PHASE_COUNT;
+
+	glm::vec2 offset{halton(jitter_phase + 1, 2) - 0.5f, halton(jitter_phase + 1, 3) - 0.5f};
+
+	// Two units of normalized device coordinates span the render extent
+	jitter = 2.0f * offset / glm::vec2{static_cast<float>(render_extent.width), static_cast<float>(render_extent.height)};
+
+	return jitter;
+}
+
+const glm::vec2 &TemporalUpscaler::get_jitter() const
+{
+	return jitter;
+}
+
+void TemporalUpscaler::set_blend_factor(float factor)
+{
+	blend_factor = factor;
+}
+
+float TemporalUpscaler::get_blend_factor() const
+{
+	return blend_factor;
+}
+
+void TemporalUpscaler::reset()
+{
+	history_valid = false;
+}
+
+const core::ImageView &TemporalUpscaler::resolve(CommandBuffer &command_buffer, RenderTarget &scene_target, const VkExtent2D &output_extent)
+{
+	if (!history[0] || history[0]->get_extent().width != output_extent.width || history[0]->get_extent().height != output_extent.height)
+	{
+		for (auto &image : history)
+		{
+			// The previous frames may still read it
+			device.get_deletion_queue().release(std::move(image));
+
+			image = std::make_unique<core::Image>(device, VkExtent3D{output_extent.width, output_extent.height, 1},
+			                                      HISTORY_FORMAT,
+			                                      VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			                                      VMA_MEMORY_USAGE_GPU_ONLY);
+
+			image->set_debug_name("Temporal upscaling history");
+		}
+
+		history_valid = false;
+	}
+
+	auto &color_view          = scene_target.get_views().at(0);
+	auto &motion_vectors_view = scene_target.get_views().at(MOTION_VECTOR_ATTACHMENT);
+
+	auto &previous_view = history[history_index]->request_view(VK_IMAGE_VIEW_TYPE_2D);
+
+	history_index = (history_index + 1) % 2;
+
+	auto &output_view = history[history_index]->request_view(VK_IMAGE_VIEW_TYPE_2D);
+
+	command_buffer.begin_debug_label("Temporal upscaling");
+
+	for (auto *view : {&color_view, &motion_vectors_view})
+	{
+		ImageMemoryBarrier barrier{};
+		barrier.old_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+		command_buffer.image_memory_barrier(*view, barrier);
+	}
+
+	{
+		// Blitted by the previous frame, or never written
+		ImageMemoryBarrier barrier{};
+		barrier.old_layout      = history_valid ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.src_access_mask = 0;
+		barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+		command_buffer.image_memory_barrier(previous_view, barrier);
+	}
+
+	{
+		// Every pixel is written, the content of two frames ago is discarded
+		ImageMemoryBarrier barrier{};
+		barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.new_layout      = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.src_access_mask = 0;
+		barrier.dst_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+		command_buffer.image_memory_barrier(output_view, barrier);
+	}
+
+	auto &resource_cache = device.get_resource_cache();
+
+	auto &shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_COMPUTE_BIT, ShaderSource{"temporal_upscaling/resolve.comp"});
+
+	std::vector<ShaderModule *> shader_modules{&shader_module};
+
+	command_buffer.bind_pipeline_layout(resource_cache.request_pipeline_layout(shader_modules, false));
+
+	// Storage images are bound without a sampler, like input attachments
+	command_buffer.bind_input(output_view, 0, 0, 0);
+	command_buffer.bind_image(color_view, *sampler, 0, 1, 0);
+	command_buffer.bind_image(motion_vectors_view, *sampler, 0, 2, 0);
+	command_buffer.bind_image(previous_view, *sampler, 0, 3, 0);
+
+	auto &render_extent = scene_target.get_render_extent();
+
+	ResolveConstants constants{};
+	constants.render_extent = glm::vec2{static_cast<float>(render_extent.width), static_cast<float>(render_extent.height)};
+	constants.output_extent = glm::vec2{static_cast<float>(output_extent.width), static_cast<float>(output_extent.height)};
+	constants.jitter        = 0.5f * jitter * constants.render_extent;
+	constants.blend_factor  = blend_factor;
+	constants.history_valid = history_valid ? 1 : 0;
+
+	command_buffer.push_constants(0, constants);
+
+	command_buffer.dispatch((output_extent.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (output_extent.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+
+	{
+		ImageMemoryBarrier barrier{};
+		barrier.old_layout      = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.new_layout      = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.src_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dst_access_mask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+		command_buffer.image_memory_barrier(output_view, barrier);
+	}
+
+	command_buffer.end_debug_label();
+
+	history_valid = true;
+
+	return output_view;
+}
+}        // namespace vkb
@@ -0,0 +1,124 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+#include "common/vk_common.h"
+#include "core/image.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class Device;
+class RenderTarget;
+
+namespace core
+{
+class ImageView;
+class Sampler;
+}        // namespace core
+
+/**
+ * @brief Upscales a scene rendered at a lower resolution by accumulating the frames over time.
+ *
+ * The camera is offset by a different fraction of a pixel each frame (see sg::PerspectiveCamera::set_jitter),
+ * so that successive frames sample different positions within the pixels. A compute pass reprojects the
+ * history, the accumulated frames at the output resolution, with the motion vectors of the geometry subpass
+ * (see GeometrySubpass::set_motion_vectors), clamps it to the neighbourhood of the new samples to reject
+ * stale colors, and blends the new samples into it. The history is kept in two images written in turns.
+ */
+class TemporalUpscaler
+{
+  public:
+	/// Attachment of the motion vectors in the scene render targets, after the color (0) and the depth (1)
+	static const uint32_t MOTION_VECTOR_ATTACHMENT = 2;
+
+	static const VkFormat MOTION_VECTOR_FORMAT = VK_FORMAT_R16G16_SFLOAT;
+
+	static const VkFormat HISTORY_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+	/// Frames after which the jitter sequence repeats
+	static const uint32_t JITTER_PHASE_COUNT = 8;
+
+	TemporalUpscaler(Device &device);
+
+	/**
+	 * @brief Moves to the jitter of the next frame
+	 * @param render_extent Extent the next frame renders at
+	 * @return The jitter of the next frame, in normalized device coordinates
+	 */
+	glm::vec2 next_jitter(const VkExtent2D &render_extent);
+
+	/**
+	 * @return The jitter of the frame, in normalized device coordinates
+	 */
+	const glm::vec2 &get_jitter() const;
+
+	/**
+	 * @brief Sets the weight of the new samples in the history, lower values accumulate more
+	 *        frames for a smoother image but follow changes more slowly
+	 */
+	void set_blend_factor(float factor);
+
+	float get_blend_factor() const;
+
+	/**
+	 * @brief Discards the history, such as after a camera cut
+	 */
+	void reset();
+
+	/**
+	 * @brief Records the accumulation of the rendered area of a scene render target into the history
+	 * @param command_buffer Command buffer of the frame, on a queue supporting compute and outside a render pass
+	 * @param scene_target Render target with the color (0) and the motion vectors (MOTION_VECTOR_ATTACHMENT)
+	 *        as color attachments, which are left in SHADER_READ_ONLY_OPTIMAL layout
+	 * @param output_extent Extent of the upscaled image
+	 * @return The view of the history of the frame, in TRANSFER_SRC_OPTIMAL layout
+	 */
+	const core::ImageView &resolve(CommandBuffer &command_buffer, RenderTarget &scene_target, const VkExtent2D &output_extent);
+
+  private:
+	Device &device;
+
+	/// History images, the one written by a frame is read by the next one
+	std::unique_ptr<core::Image> history[2];
+
+	uint32_t history_index{0};
+
+	/// Whether the history was written by the previous frame
+	bool history_valid{false};
+
+	float blend_factor{0.1f};
+
+	uint32_t jitter_phase{0};
+
+	glm::vec2 jitter{0.0f};
+
+	core::Sampler *sampler{nullptr};
+};
+}        // namespace vkb
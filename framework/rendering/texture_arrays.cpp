@@ -0,0 +1,191 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "rendering/texture_arrays.h"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+#include "common/logging.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "scene_graph/components/image.h"
+#include "scene_graph/components/texture.h"
+
+namespace vkb
+{
+namespace
+{
+/**
+ * @brief Transitions all the levels and layers of an image
+ */
+void transition(CommandBuffer &command_buffer, const core::ImageView &view, VkImageLayout old_layout, VkImageLayout new_layout,
+                VkAccessFlags src_access_mask, VkAccessFlags dst_access_mask, VkPipelineStageFlags src_stage_mask, VkPipelineStageFlags dst_stage_mask)
+{
+	ImageMemoryBarrier barrier{};
+	barrier.old_layout      = old_layout;
+	barrier.new_layout      = new_layout;
+	barrier.src_access_mask = src_access_mask;
+	barrier.dst_access_mask = dst_access_mask;
+	barrier.src_stage_mask  = src_stage_mask;
+	barrier.dst_stage_mask  = dst_stage_mask;
+
+	command_buffer.image_memory_barrier(view, barrier);
+}
+}        // namespace
+
+const char *TextureArrays::TEXTURE_NAME = "base_color_texture";
+
+TextureArrays::TextureArrays(Device &device, const std::vector<sg::Texture *> &textures, uint32_t max_extent)
+{
+	// Images which can share an array, by format, width, height and level count
+	std::map<std::tuple<VkFormat, uint32_t, uint32_t, uint32_t>, std::vector<const sg::Image *>> groups;
+
+	for (auto texture : textures)
+	{
+		auto image = texture->get_image();
+
+		if (image == nullptr || image->get_vk_base_level() != 0)
+		{
+			continue;
+		}
+
+		auto &vk_image = image->get_vk_image();
+		auto &extent   = vk_image.get_extent();
+
+		if (extent.width > max_extent || extent.height > max_extent || !(vk_image.get_usage() & VK_IMAGE_USAGE_TRANSFER_SRC_BIT))
+		{
+			continue;
+		}
+
+		auto &group = groups[std::make_tuple(vk_image.get_format(), extent.width, extent.height, vk_image.get_subresource().mipLevel)];
+
+		if (std::find(group.begin(), group.end(), image) == group.end())
+		{
+			group.push_back(image);
+		}
+	}
+
+	auto &command_buffer = device.request_command_buffer();
+
+	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, 0);
+
+	command_buffer.begin_debug_label("Texture arrays");
+
+	uint32_t max_layer_count = device.get_properties().limits.maxImageArrayLayers;
+
+	for (auto &group : groups)
+	{
+		auto &images = group.second;
+
+		for (size_t first = 0; first + 1 < images.size(); first += max_layer_count)
+		{
+			auto layer_count = to_u32(std::min<size_t>(images.size() - first, max_layer_count));
+
+			if (layer_count < 2)
+			{
+				break;
+			}
+
+			auto &source      = images[first]->get_vk_image();
+			auto  level_count = source.get_subresource().mipLevel;
+
+			auto array = std::make_unique<core::Image>(device,
+			                                           source.get_extent(),
+			                                           source.get_format(),
+			                                           VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+			                                           VMA_MEMORY_USAGE_GPU_ONLY,
+			                                           VK_SAMPLE_COUNT_1_BIT,
+			                                           level_count,
+			                                           layer_count);
+
+			array->set_debug_name("Texture array " + std::to_string(arrays.size()));
+
+			auto &array_view = array->request_view(VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+
+			transition(command_buffer, array_view, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			           0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+			for (uint32_t layer = 0; layer < layer_count; ++layer)
+			{
+				auto &image = *images[first + layer];
+
+				transition(command_buffer, image.get_vk_image_view(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				           VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+				std::vector<VkImageCopy> regions(level_count);
+
+				for (uint32_t level = 0; level < level_count; ++level)
+				{
+					auto &region = regions[level];
+
+					region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+					region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, layer, 1};
+					region.extent         = {std::max(1u, source.get_extent().width >> level), std::max(1u, source.get_extent().height >> level), 1};
+				}
+
+				command_buffer.copy_image(image.get_vk_image(), *array, regions);
+
+				transition(command_buffer, image.get_vk_image_view(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				           VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+				layers.emplace(&image, Layer{&array_view, layer});
+			}
+
+			transition(command_buffer, array_view, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			           VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+			arrays.push_back(std::move(array));
+		}
+	}
+
+	command_buffer.end_debug_label();
+
+	command_buffer.end();
+
+	auto &queue = device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+
+	queue.submit(command_buffer, device.request_fence());
+
+	device.get_fence_pool().wait();
+	device.get_fence_pool().reset();
+	device.get_command_pool().reset_pool();
+
+	LOGI("Packed {} textures in {} texture arrays", layers.size(), arrays.size());
+}
+
+const TextureArrays::Layer *TextureArrays::find(sg::Texture &texture) const
+{
+	auto it = layers.find(texture.get_image());
+
+	return it != layers.end() ? &it->second : nullptr;
+}
+
+size_t TextureArrays::get_array_count() const
+{
+	return arrays.size();
+}
+
+size_t TextureArrays::get_layer_count() const
+{
+	return layers.size();
+}
+}        // namespace vkb
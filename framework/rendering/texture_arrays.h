@@ -0,0 +1,102 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+#include "core/image.h"
+#include "core/image_view.h"
+
+namespace vkb
+{
+class Device;
+
+namespace sg
+{
+class Image;
+class Texture;
+}        // namespace sg
+
+/**
+ * @brief Copies small images of the same format, size and level count into the layers of 2D array images,
+ *        so that the materials using them bind the same image and select their texture with a layer index.
+ *        An alternative to BindlessTextures for the devices without VK_EXT_descriptor_indexing.
+ *        The copies are made once, images streamed by a TextureStreamer are left out.
+ */
+class TextureArrays
+{
+  public:
+	/**
+	 * @brief Layer of the array holding the image of a texture
+	 */
+	struct Layer
+	{
+		const core::ImageView *image_view{nullptr};
+
+		uint32_t layer{0};
+	};
+
+	/// Name of the texture sampled from an array in the shaders
+	static const char *TEXTURE_NAME;
+
+	/**
+	 * @param device The device to create the arrays with
+	 * @param textures The textures to pack, only their fully resident images no larger than max_extent are
+	 *                 packed, and only if at least one other image can share their array
+	 * @param max_extent The largest width and height of the images to pack
+	 */
+	TextureArrays(Device &device, const std::vector<sg::Texture *> &textures, uint32_t max_extent);
+
+	TextureArrays(const TextureArrays &) = delete;
+
+	TextureArrays(TextureArrays &&) = delete;
+
+	~TextureArrays() = default;
+
+	TextureArrays &operator=(const TextureArrays &) = delete;
+
+	TextureArrays &operator=(TextureArrays &&) = delete;
+
+	/**
+	 * @return The layer holding the image of a texture, nullptr if it was not packed
+	 */
+	const Layer *find(sg::Texture &texture) const;
+
+	/**
+	 * @return The number of array images created
+	 */
+	size_t get_array_count() const;
+
+	/**
+	 * @return The number of images packed in the arrays
+	 */
+	size_t get_layer_count() const;
+
+  private:
+	std::vector<std::unique_ptr<core::Image>> arrays;
+
+	std::unordered_map<const sg::Image *, Layer> layers;
+};
+}        // namespace vkb
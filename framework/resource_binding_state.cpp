@@ -20,13 +20,21 @@
 
 #include "resource_binding_state.h"
 
+#include "common/helpers.h"
+
 namespace vkb
 {
 void ResourceBindingState::reset()
 {
 	clear_dirty();
 
-	resource_sets.clear();
+	for (uint32_t set_mask = bound_sets; set_mask != 0; set_mask &= set_mask - 1)
+	{
+		resource_sets[count_trailing_zeros(set_mask)].reset();
+	}
+
+	bound_sets = 0;
+	dirty_sets = 0;
 }
 
 bool ResourceBindingState::is_dirty()
@@ -41,87 +49,140 @@ void ResourceBindingState::clear_dirty()
 
 void ResourceBindingState::clear_dirty(uint32_t set)
 {
+	assert(set < MAX_SETS && "Descriptor set index out of range");
+
 	resource_sets[set].clear_dirty();
+
+	dirty_sets &= ~(1u << set);
 }
 
 void ResourceBindingState::bind_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t set, uint32_t binding, uint32_t array_element)
 {
-	resource_sets[set].bind_buffer(buffer, offset, range, binding, array_element);
-
-	dirty = true;
+	bind(set).bind_buffer(buffer, offset, range, binding, array_element);
 }
 
 void ResourceBindingState::bind_image(const core::ImageView &image_view, const core::Sampler &sampler, uint32_t set, uint32_t binding, uint32_t array_element)
 {
-	resource_sets[set].bind_image(image_view, sampler, binding, array_element);
-
-	dirty = true;
+	bind(set).bind_image(image_view, sampler, binding, array_element);
 }
 
 void ResourceBindingState::bind_input(const core::ImageView &image_view, uint32_t set, uint32_t binding, uint32_t array_element)
 {
-	resource_sets[set].bind_input(image_view, binding, array_element);
+	bind(set).bind_input(image_view, binding, array_element);
+}
 
-	dirty = true;
+uint32_t ResourceBindingState::get_bound_sets() const
+{
+	return bound_sets;
 }
 
-const std::unordered_map<uint32_t, ResourceSet> &ResourceBindingState::get_resource_sets()
+uint32_t ResourceBindingState::get_dirty_sets() const
 {
-	return resource_sets;
+	return dirty_sets;
+}
+
+const ResourceSet &ResourceBindingState::get_resource_set(uint32_t set) const
+{
+	assert(set < MAX_SETS && "Descriptor set index out of range");
+
+	return resource_sets[set];
+}
+
+ResourceSet &ResourceBindingState::bind(uint32_t set)
+{
+	// Checked in all builds, binding past the array would overwrite the state of the command buffer
+	if (set >= MAX_SETS)
+	{
+		throw std::out_of_range(fmt::format("Descriptor set {} is out of range, at most {} sets can be bound", set, uint32_t{MAX_SETS}));
+	}
+
+	bound_sets |= 1u << set;
+	dirty_sets |= 1u << set;
+
+	dirty = true;
+
+	return resource_sets[set];
 }
 
 void ResourceSet::reset()
 {
-	clear_dirty();
+	for (uint64_t resource_mask = bound_mask; resource_mask != 0; resource_mask &= resource_mask - 1)
+	{
+		resource_infos[count_trailing_zeros(resource_mask)] = {};
+	}
 
-	resource_bindings.clear();
+	bound_mask = 0;
+	dirty_mask = 0;
 }
 
 bool ResourceSet::is_dirty() const
 {
-	return dirty;
+	return dirty_mask != 0;
 }
 
 void ResourceSet::clear_dirty()
 {
-	dirty = false;
+	dirty_mask = 0;
 }
 
 void ResourceSet::clear_dirty(uint32_t binding, uint32_t array_element)
 {
-	resource_bindings[binding][array_element].dirty = false;
+	dirty_mask &= ~(uint64_t{1} << get_resource_index(binding, array_element));
 }
 
 void ResourceSet::bind_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t binding, uint32_t array_element)
 {
-	resource_bindings[binding][array_element].dirty  = true;
-	resource_bindings[binding][array_element].buffer = &buffer;
-	resource_bindings[binding][array_element].offset = offset;
-	resource_bindings[binding][array_element].range  = range;
+	auto &resource_info = bind(binding, array_element);
 
-	dirty = true;
+	resource_info.buffer = &buffer;
+	resource_info.offset = offset;
+	resource_info.range  = range;
 }
 
 void ResourceSet::bind_image(const core::ImageView &image_view, const core::Sampler &sampler, uint32_t binding, uint32_t array_element)
 {
-	resource_bindings[binding][array_element].dirty      = true;
-	resource_bindings[binding][array_element].image_view = &image_view;
-	resource_bindings[binding][array_element].sampler    = &sampler;
+	auto &resource_info = bind(binding, array_element);
 
-	dirty = true;
+	resource_info.image_view = &image_view;
+	resource_info.sampler    = &sampler;
 }
 
 void ResourceSet::bind_input(const core::ImageView &image_view, const uint32_t binding, const uint32_t array_element)
 {
-	resource_bindings[binding][array_element].dirty      = true;
-	resource_bindings[binding][array_element].image_view = &image_view;
+	auto &resource_info = bind(binding, array_element);
 
-	dirty = true;
+	resource_info.image_view = &image_view;
 }
 
-const BindingMap<ResourceInfo> &ResourceSet::get_resource_bindings() const
+uint64_t ResourceSet::get_bound_mask() const
 {
-	return resource_bindings;
+	return bound_mask;
 }
 
+const ResourceInfo &ResourceSet::get_resource_info(uint32_t binding, uint32_t array_element) const
+{
+	return resource_infos[get_resource_index(binding, array_element)];
+}
+
+uint32_t ResourceSet::get_resource_index(uint32_t binding, uint32_t array_element)
+{
+	// Checked in all builds, an index past the array would overwrite the resources of other bindings
+	if (binding >= MAX_BINDINGS || array_element >= MAX_ARRAY_ELEMENTS)
+	{
+		throw std::out_of_range(fmt::format("Binding {} array element {} is out of range, at most {} bindings of {} array elements can be bound",
+		                                    binding, array_element, uint32_t{MAX_BINDINGS}, uint32_t{MAX_ARRAY_ELEMENTS}));
+	}
+
+	return binding * MAX_ARRAY_ELEMENTS + array_element;
+}
+
+ResourceInfo &ResourceSet::bind(uint32_t binding, uint32_t array_element)
+{
+	uint32_t resource_index = get_resource_index(binding, array_element);
+
+	bound_mask |= uint64_t{1} << resource_index;
+	dirty_mask |= uint64_t{1} << resource_index;
+
+	return resource_infos[resource_index];
+}
 }        // namespace vkb
@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <array>
+
 #include "common/vk_common.h"
 #include "core/buffer.h"
 #include "core/image_view.h"
@@ -34,8 +36,6 @@ namespace vkb
  */
 struct ResourceInfo
 {
-	bool dirty{false};
-
 	const core::Buffer *buffer{nullptr};
 
 	VkDeviceSize offset{0};
@@ -51,11 +51,17 @@ struct ResourceInfo
  * @brief A resource set is a set of bindings containing resources that were bound 
  *        by a command buffer.
  *
- * The ResourceSet has a one to one mapping with a DescriptorSet.
+ * The ResourceSet has a one to one mapping with a DescriptorSet. Resources are stored in a
+ * fixed-size array indexed by binding and array element, with one bit per resource in the masks.
+ * Resources past MAX_BINDINGS or MAX_ARRAY_ELEMENTS cannot be bound, binding them throws.
  */
 class ResourceSet
 {
   public:
+	static const uint32_t MAX_BINDINGS = 16;
+
+	static const uint32_t MAX_ARRAY_ELEMENTS = 4;
+
 	void reset();
 
 	bool is_dirty() const;
@@ -70,12 +76,28 @@ class ResourceSet
 
 	void bind_input(const core::ImageView &image_view, uint32_t binding, uint32_t array_element);
 
-	const BindingMap<ResourceInfo> &get_resource_bindings() const;
+	/**
+	 * @return A mask with the bit binding * MAX_ARRAY_ELEMENTS + array_element set for each bound resource,
+	 *         in increasing binding then array element order
+	 */
+	uint64_t get_bound_mask() const;
+
+	const ResourceInfo &get_resource_info(uint32_t binding, uint32_t array_element) const;
 
   private:
-	bool dirty{false};
+	/// Mask of the resources bound since the last reset
+	uint64_t bound_mask{0};
+
+	/// Mask of the resources bound since the last clear_dirty
+	uint64_t dirty_mask{0};
+
+	std::array<ResourceInfo, MAX_BINDINGS * MAX_ARRAY_ELEMENTS> resource_infos;
 
-	BindingMap<ResourceInfo> resource_bindings;
+	static_assert(MAX_BINDINGS * MAX_ARRAY_ELEMENTS == sizeof(bound_mask) * 8, "Resource set masks have one bit per resource");
+
+	static uint32_t get_resource_index(uint32_t binding, uint32_t array_element);
+
+	ResourceInfo &bind(uint32_t binding, uint32_t array_element);
 };
 
 /**
@@ -87,6 +109,9 @@ class ResourceSet
 class ResourceBindingState
 {
   public:
+	/// Minimum number of bound descriptor sets supported by all implementations, binding to the sets past it throws
+	static const uint32_t MAX_SETS = 4;
+
 	void reset();
 
 	bool is_dirty();
@@ -101,11 +126,29 @@ class ResourceBindingState
 
 	void bind_input(const core::ImageView &image_view, uint32_t set, uint32_t binding, uint32_t array_element);
 
-	const std::unordered_map<uint32_t, ResourceSet> &get_resource_sets();
+	/**
+	 * @return A mask with a bit set for each set which had resources bound since the last reset
+	 */
+	uint32_t get_bound_sets() const;
+
+	/**
+	 * @return A mask with a bit set for each set which had resources bound since it was last cleared
+	 */
+	uint32_t get_dirty_sets() const;
+
+	const ResourceSet &get_resource_set(uint32_t set) const;
 
   private:
 	bool dirty{false};
 
-	std::unordered_map<uint32_t, ResourceSet> resource_sets;
+	uint32_t bound_sets{0};
+
+	uint32_t dirty_sets{0};
+
+	std::array<ResourceSet, MAX_SETS> resource_sets;
+
+	static_assert(MAX_SETS <= sizeof(bound_sets) * 8, "Resource binding state masks have one bit per set");
+
+	ResourceSet &bind(uint32_t set);
 };
 }        // namespace vkb
@@ -20,22 +20,280 @@
 
 #include "resource_cache.h"
 
+#include <algorithm>
+#include <type_traits>
+
+#include <ctpl_stl.h>
+
+#include "common/error.h"
 #include "common/resource_caching.h"
 #include "core/device.h"
+#include "cpu_profiler.h"
+#include "job_system.h"
+#include "timer.h"
 
 namespace vkb
 {
 namespace
 {
+/**
+ * @brief Tags a cached resource as used in a frame, called within the lookup which found it
+ *        so that an eviction running meanwhile sees the request
+ */
+inline void touch_resource(CachedResourceUsage *usage, ResourceUsageEntry &entry, uint64_t frame_number)
+{
+	if (usage)
+	{
+		// Only the first hit of a frame writes, so that the hits of the other threads keep the line shared
+		if (entry.last_used.load(std::memory_order_relaxed) != frame_number)
+		{
+			entry.last_used.store(frame_number, std::memory_order_relaxed);
+		}
+
+		usage->get_shard().hits.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+/**
+ * @brief Checks that a module declares a specialization constant for each define of a variant which it stands in for
+ */
+bool declares_define_constants(const ShaderModule &shader_module, const std::vector<std::string> &define_constant_names, const ShaderVariant &shader_variant)
+{
+	auto &resources = shader_module.get_resources();
+
+	for (auto &name : define_constant_names)
+	{
+		std::string value;
+
+		if (!shader_variant.find_define(name, value))
+		{
+			continue;
+		}
+
+		auto it = std::find_if(resources.begin(), resources.end(), [&name](const ShaderResource &resource) {
+			return resource.type == ShaderResourceType::SpecializationConstant && resource.name == name;
+		});
+
+		if (it == resources.end())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Hash of the state shared by a base pipeline and its derivatives
+ */
+std::size_t get_pipeline_family(const PipelineState &pipeline_state)
+{
+	std::size_t family{0U};
+
+	hash_combine(family, pipeline_state.get_pipeline_layout().get_handle());
+	hash_combine(family, pipeline_state.get_render_pass()->get_compatibility_hash());
+	hash_combine(family, pipeline_state.get_subpass_index());
+
+	return family;
+}
+
+/**
+ * @brief Tracks a resource requested by a miss, the lock of its map must be held
+ * @param created Whether the resource was created by the request, rather than by another thread first
+ * @param creation_time CPU time spent creating the resource, in milliseconds
+ */
+inline void track_resource(CachedResourceUsage *usage, ResourceUsageEntry &entry, bool created, uint64_t frame_number, float creation_time)
+{
+	if (usage)
+	{
+		if (created)
+		{
+			entry.created       = frame_number;
+			entry.creation_time = creation_time;
+		}
+
+		entry.last_used.store(frame_number, std::memory_order_relaxed);
+
+		usage->get_shard().misses.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
 template <class T, class... A>
-T &request_resource(Device &device, ResourceRecord &recorder, std::mutex &resource_mutex, std::unordered_map<std::size_t, T> &resources, A &... args)
+T &request_resource(Device &device, ResourceRecord &recorder, std::mutex &resource_mutex, CachedResourceUsage *usage, uint64_t frame_number, CachedResourceMap<T> &resources, A &... args)
 {
+	VKB_PROFILE_SCOPE("ResourceCache::request_resource");
+
+	std::size_t hash{0U};
+	auto &      key = get_resource_key(hash, args...);
+
+	// Cache hits do not lock, so recording threads do not serialize on them
+	auto resource = resources.find(hash, key, [usage, frame_number](typename CachedResourceMap<T>::Entry &entry) {
+		touch_resource(usage, entry.metadata, frame_number);
+	});
+
+	if (resource)
+	{
+		return *resource;
+	}
+
+	// Keep a copy of the key, creating the resource may request other resources
+	std::vector<uint8_t> resource_key{key};
+
+	// Misses are serialized, another thread may have built the resource in the meantime
 	std::lock_guard<std::mutex> guard(resource_mutex);
 
+	auto resource_count = resources.size();
+
+	Timer timer;
+	timer.start();
+
 	auto &res = request_resource(device, &recorder, resources, args...);
 
+	auto creation_time = static_cast<float>(timer.stop<Timer::Milliseconds>());
+
+	resources.find(hash, resource_key, [usage, frame_number, creation_time, &resources, resource_count](typename CachedResourceMap<T>::Entry &entry) {
+		track_resource(usage, entry.metadata, resources.size() != resource_count, frame_number, creation_time);
+	});
+
 	return res;
 }
+
+/**
+ * @brief Same as request_resource, but a missing resource is built outside of the lock so that
+ *        several threads can create resources of the same type at once. Only meant for
+ *        resources whose construction does not touch state shared with other resources.
+ */
+template <class T, class... A>
+T &request_resource_concurrent(Device &device, ResourceRecord &recorder, std::mutex &resource_mutex, CachedResourceUsage *usage, uint64_t frame_number, CachedResourceMap<T> &resources, A &... args)
+{
+	std::size_t hash{0U};
+	auto &      key = get_resource_key(hash, args...);
+
+	auto resource = resources.find(hash, key, [usage, frame_number](typename CachedResourceMap<T>::Entry &entry) {
+		touch_resource(usage, entry.metadata, frame_number);
+	});
+
+	if (resource)
+	{
+		return *resource;
+	}
+
+	// Keep a copy of the key, creating the resource may request other resources
+	std::vector<uint8_t> resource_key{key};
+
+	LOGD("Building cache object ({})", typeid(T).name());
+
+	Timer timer;
+	timer.start();
+
+	T new_resource(device, args...);
+
+	auto creation_time = static_cast<float>(timer.stop<Timer::Milliseconds>());
+
+	std::lock_guard<std::mutex> guard(resource_mutex);
+
+	typename CachedResourceMap<T>::Entry *entry{nullptr};
+
+	// If another thread built the same resource first, ours is discarded
+	auto res_ins_it = resources.emplace(hash, std::move(resource_key), std::move(new_resource), [&entry](typename CachedResourceMap<T>::Entry &emplaced) {
+		entry = &emplaced;
+	});
+
+	if (res_ins_it.second)
+	{
+		RecordHelper<T, A...> record_helper;
+
+		size_t index = record_helper.record(recorder, args...);
+		record_helper.index(recorder, index, *res_ins_it.first);
+	}
+
+	track_resource(usage, entry->metadata, res_ins_it.second, frame_number, creation_time);
+
+	return *res_ins_it.first;
+}
+
+/**
+ * @brief Evicts the least recently used resources until the budget is met,
+ *        skipping the ones used by frames the GPU may still be processing
+ * @param on_evict Called on each resource before it is destroyed
+ */
+template <class T, class F>
+void evict_resources(std::mutex &resource_mutex, CachedResourceUsage &usage, CachedResourceMap<T> &resources, uint64_t completed_frame_number, F on_evict)
+{
+	auto over_budget = [&usage](size_t count) {
+		return (usage.budget.max_entries > 0 && count > usage.budget.max_entries) ||
+		       (usage.budget.max_bytes > 0 && count * sizeof(T) > usage.budget.max_bytes);
+	};
+
+	std::lock_guard<std::mutex> guard(resource_mutex);
+
+	if (!over_budget(resources.size()))
+	{
+		return;
+	}
+
+	using Entry = typename CachedResourceMap<T>::Entry;
+
+	std::vector<std::pair<uint64_t, Entry *>> candidates;
+
+	for (auto &entry : resources)
+	{
+		auto last_used = entry.metadata.last_used.load(std::memory_order_relaxed);
+
+		if (last_used <= completed_frame_number)
+		{
+			candidates.emplace_back(last_used, &entry);
+		}
+	}
+
+	// Oldest first
+	std::sort(candidates.begin(), candidates.end(), [](const std::pair<uint64_t, Entry *> &a, const std::pair<uint64_t, Entry *> &b) {
+		return a.first < b.first;
+	});
+
+	std::vector<Entry *> evicted;
+
+	for (auto &candidate : candidates)
+	{
+		if (!over_budget(resources.size() - evicted.size()))
+		{
+			break;
+		}
+
+		evicted.push_back(candidate.second);
+	}
+
+	// A hit racing with the eviction keeps its resource
+	usage.evictions += resources.erase_if(
+	    evicted, [completed_frame_number](Entry &entry) { return entry.metadata.last_used.load(std::memory_order_relaxed) > completed_frame_number; }, on_evict);
+}
+
+/**
+ * @brief Evicts every resource last used in or before a frame, regardless of the budget
+ */
+template <class T, class F>
+void evict_unused_resources(std::mutex &resource_mutex, CachedResourceUsage &usage, CachedResourceMap<T> &resources, uint64_t frame_number, F on_evict)
+{
+	using Entry = typename CachedResourceMap<T>::Entry;
+
+	auto is_used = [frame_number](Entry &entry) {
+		return entry.metadata.last_used.load(std::memory_order_relaxed) > frame_number;
+	};
+
+	std::lock_guard<std::mutex> guard(resource_mutex);
+
+	std::vector<Entry *> evicted;
+
+	for (auto &entry : resources)
+	{
+		if (!is_used(entry))
+		{
+			evicted.push_back(&entry);
+		}
+	}
+
+	usage.evictions += resources.erase_if(evicted, is_used, on_evict);
+}
 }        // namespace
 
 ResourceCache::ResourceCache(Device &device) :
@@ -43,6 +301,17 @@ ResourceCache::ResourceCache(Device &device) :
 {
 }
 
+ResourceCache::~ResourceCache()
+{
+	// Compile threads write into the cache, let them finish before it goes away
+	if (compile_thread_pool)
+	{
+		compile_thread_pool->stop(true);
+	}
+
+	destroy_thread_pipeline_caches();
+}
+
 void ResourceCache::warmup(const std::vector<uint8_t> &data)
 {
 	recorder.set_data(data);
@@ -50,69 +319,762 @@ void ResourceCache::warmup(const std::vector<uint8_t> &data)
 	replayer.play(*this, recorder);
 }
 
+void ResourceCache::warmup(const ResourceCacheFile &cache_file)
+{
+	if (!cache_file.is_valid())
+	{
+		return;
+	}
+
+	// The replayed resources are recorded again as they are created
+	replayer.play(*this, cache_file);
+}
+
 std::vector<uint8_t> ResourceCache::serialize()
 {
 	return recorder.get_data();
 }
 
+void ResourceCache::serialize(const std::string &filename)
+{
+	merge_pipeline_caches();
+
+	ResourceCacheFile::write(device, filename, recorder, pipeline_cache);
+}
+
 void ResourceCache::set_pipeline_cache(VkPipelineCache new_pipeline_cache)
 {
+	if (new_pipeline_cache == pipeline_cache)
+	{
+		return;
+	}
+
+	merge_pipeline_caches();
+
 	pipeline_cache = new_pipeline_cache;
+
+	create_thread_pipeline_caches();
+}
+
+void ResourceCache::set_per_thread_pipeline_caches(bool enable)
+{
+	if (enable == per_thread_pipeline_caches)
+	{
+		return;
+	}
+
+	merge_pipeline_caches();
+
+	per_thread_pipeline_caches = enable;
+
+	create_thread_pipeline_caches();
+}
+
+bool ResourceCache::is_using_per_thread_pipeline_caches() const
+{
+	return per_thread_pipeline_caches;
+}
+
+void ResourceCache::merge_pipeline_caches()
+{
+	wait_pending_pipelines();
+
+	merge_thread_pipeline_caches();
+}
+
+void ResourceCache::create_thread_pipeline_caches()
+{
+	destroy_thread_pipeline_caches();
+
+	if (!per_thread_pipeline_caches || pipeline_cache == VK_NULL_HANDLE || !compile_thread_pool)
+	{
+		return;
+	}
+
+	// Seeded with the pipeline cache so that threads find the pipelines it already holds
+	size_t data_size{0};
+	VK_CHECK(vkGetPipelineCacheData(device.get_handle(), pipeline_cache, &data_size, nullptr));
+
+	std::vector<uint8_t> data(data_size);
+	VK_CHECK(vkGetPipelineCacheData(device.get_handle(), pipeline_cache, &data_size, data.data()));
+
+	VkPipelineCacheCreateInfo create_info{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+	create_info.initialDataSize = data_size;
+	create_info.pInitialData    = data.data();
+
+	thread_pipeline_caches.resize(compile_thread_pool->size(), VK_NULL_HANDLE);
+
+	for (auto &thread_pipeline_cache : thread_pipeline_caches)
+	{
+		VK_CHECK(vkCreatePipelineCache(device.get_handle(), &create_info, nullptr, &thread_pipeline_cache));
+	}
+}
+
+void ResourceCache::destroy_thread_pipeline_caches()
+{
+	for (auto thread_pipeline_cache : thread_pipeline_caches)
+	{
+		vkDestroyPipelineCache(device.get_handle(), thread_pipeline_cache, nullptr);
+	}
+
+	thread_pipeline_caches.clear();
+
+	thread_pipeline_caches_dirty = false;
+}
+
+void ResourceCache::merge_thread_pipeline_caches()
+{
+	if (!thread_pipeline_caches_dirty || thread_pipeline_caches.empty())
+	{
+		return;
+	}
+
+	VK_CHECK(vkMergePipelineCaches(device.get_handle(), pipeline_cache, to_u32(thread_pipeline_caches.size()), thread_pipeline_caches.data()));
+
+	thread_pipeline_caches_dirty = false;
 }
 
 ShaderModule &ResourceCache::request_shader_module(VkShaderStageFlagBits stage, const ShaderSource &glsl_source, const ShaderVariant &shader_variant)
 {
 	std::string entry_point{"main"};
-	return request_resource(device, recorder, shader_module_mutex, state.shader_modules, stage, glsl_source, entry_point, shader_variant);
+
+	auto &define_constant_names = glsl_source.get_define_constant_names();
+
+	if (!define_constant_names.empty())
+	{
+		auto base_variant = shader_variant.remove_defines(define_constant_names);
+
+		if (base_variant.get_id() != shader_variant.get_id())
+		{
+			auto &shader_module = request_resource_concurrent(device, recorder, shader_module_mutex, &shader_module_usage, frame_number, state.shader_modules, stage, glsl_source, entry_point, base_variant);
+
+			if (declares_define_constants(shader_module, define_constant_names, shader_variant))
+			{
+				return shader_module;
+			}
+
+			// A declaration can depend on other defines, in which case the variant is compiled as is
+		}
+	}
+
+	return request_resource_concurrent(device, recorder, shader_module_mutex, &shader_module_usage, frame_number, state.shader_modules, stage, glsl_source, entry_point, shader_variant);
+}
+
+std::vector<ShaderModule *> ResourceCache::request_shader_modules(const std::vector<ShaderModuleRequest> &requests)
+{
+	std::vector<ShaderModule *> shader_modules(requests.size(), nullptr);
+
+	auto request_range = [this, &requests, &shader_modules](uint32_t begin, uint32_t end, size_t) {
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			shader_modules[i] = &request_shader_module(requests[i].stage, *requests[i].source, *requests[i].variant);
+		}
+	};
+
+	// Modules are built outside of the cache lock, so each request can compile on its own thread
+	if (job_system)
+	{
+		job_system->parallel_for(to_u32(requests.size()), 1, request_range);
+	}
+	else
+	{
+		request_range(0, to_u32(requests.size()), 0);
+	}
+
+	return shader_modules;
+}
+
+void ResourceCache::request_graphics_pipelines(std::vector<PipelineState> &pipeline_states)
+{
+	auto request_range = [this, &pipeline_states](uint32_t begin, uint32_t end, size_t) {
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			request_graphics_pipeline(pipeline_states[i]);
+		}
+	};
+
+	if (job_system)
+	{
+		job_system->parallel_for(to_u32(pipeline_states.size()), 1, request_range);
+	}
+	else
+	{
+		request_range(0, to_u32(pipeline_states.size()), 0);
+	}
+}
+
+void ResourceCache::set_job_system(JobSystem *jobs)
+{
+	job_system = jobs;
 }
 
 PipelineLayout &ResourceCache::request_pipeline_layout(const std::vector<ShaderModule *> &shader_modules, bool use_dynamic_resources)
 {
-	return request_resource(device, recorder, pipeline_layout_mutex, state.pipeline_layouts, shader_modules, use_dynamic_resources);
+	return request_resource_concurrent(device, recorder, pipeline_layout_mutex, &pipeline_layout_usage, frame_number, state.pipeline_layouts, shader_modules, use_dynamic_resources);
 }
 
 DescriptorSetLayout &ResourceCache::request_descriptor_set_layout(const std::vector<ShaderResource> &set_resources, bool use_dynamic_resources)
 {
-	return request_resource(device, recorder, descriptor_set_layout_mutex, state.descriptor_set_layouts, set_resources, use_dynamic_resources);
+	return request_resource(device, recorder, descriptor_set_layout_mutex, &descriptor_set_layout_usage, frame_number, state.descriptor_set_layouts, set_resources, use_dynamic_resources);
 }
 
 GraphicsPipeline &ResourceCache::request_graphics_pipeline(PipelineState &pipeline_state)
 {
-	return request_resource(device, recorder, graphics_pipeline_mutex, state.graphics_pipelines, pipeline_cache, pipeline_state);
+	return request_graphics_pipeline(pipeline_cache, pipeline_state);
+}
+
+GraphicsPipeline &ResourceCache::request_graphics_pipeline(VkPipelineCache cache, PipelineState &pipeline_state)
+{
+	std::size_t hash{0U};
+	auto &      key = get_resource_key(hash, cache, pipeline_state);
+
+	// A hit neither locks nor registers the base pipeline again, which was done as the pipeline was created
+	auto cached = state.graphics_pipelines.find(hash, key, [this](CachedResourceMap<GraphicsPipeline>::Entry &entry) {
+		touch_resource(&graphics_pipeline_usage, entry.metadata, frame_number);
+	});
+
+	if (cached)
+	{
+		return *cached;
+	}
+
+	auto &pipeline = request_resource_concurrent(device, recorder, graphics_pipeline_mutex, &graphics_pipeline_usage, frame_number, state.graphics_pipelines, cache, pipeline_state);
+
+	if (pipeline.is_derivative_base())
+	{
+		set_base_pipeline(pipeline_state, pipeline.get_handle());
+	}
+
+	return pipeline;
+}
+
+GraphicsPipeline *ResourceCache::request_graphics_pipeline_async(PipelineState &pipeline_state)
+{
+	if (pipeline_compilation == PipelineCompilation::Synchronous)
+	{
+		return &request_graphics_pipeline(pipeline_state);
+	}
+
+	std::size_t hash{0U};
+	auto &      key = get_resource_key(hash, pipeline_cache, pipeline_state);
+
+	// The hot path of recording, which does not lock
+	auto pipeline = state.graphics_pipelines.find(hash, key, [this](CachedResourceMap<GraphicsPipeline>::Entry &entry) {
+		touch_resource(&graphics_pipeline_usage, entry.metadata, frame_number);
+	});
+
+	if (pipeline)
+	{
+		return pipeline;
+	}
+
+	std::shared_future<void> pending;
+
+	{
+		std::lock_guard<std::mutex> pending_guard(pending_pipeline_mutex);
+
+		auto pending_it = pending_graphics_pipelines.find(hash);
+
+		if (pending_it == pending_graphics_pipelines.end())
+		{
+			// The pipeline may have been finished and collected by another thread
+			if (auto built_pipeline = find_resource(state.graphics_pipelines, pipeline_cache, pipeline_state))
+			{
+				return built_pipeline;
+			}
+
+			LOGD("Queuing graphics pipeline #{} for background compilation", hash);
+
+			VkPipelineCache cache = pipeline_cache;
+
+			auto future = compile_thread_pool->push([this, cache, pipeline_state](size_t thread_index) mutable {
+				if (thread_index < thread_pipeline_caches.size())
+				{
+					thread_pipeline_caches_dirty = true;
+
+					request_graphics_pipeline(thread_pipeline_caches[thread_index], pipeline_state);
+				}
+				else
+				{
+					request_graphics_pipeline(cache, pipeline_state);
+				}
+			});
+
+			pending_it = pending_graphics_pipelines.emplace(hash, future.share()).first;
+		}
+
+		pending = pending_it->second;
+	}
+
+	if (pipeline_compilation == PipelineCompilation::AsyncWait ||
+	    pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		bool failed = false;
+
+		try
+		{
+			// Rethrows any error raised while building the pipeline
+			pending.get();
+		}
+		catch (const std::exception &e)
+		{
+			LOGE("Background compilation of graphics pipeline #{} failed: {}", hash, e.what());
+
+			failed = true;
+		}
+
+		{
+			// A failed pipeline is queued again by the next request rather than failing every draw
+			std::lock_guard<std::mutex> pending_guard(pending_pipeline_mutex);
+			pending_graphics_pipelines.erase(hash);
+		}
+
+		if (failed)
+		{
+			return pipeline_compilation == PipelineCompilation::AsyncFallback ? fallback_graphics_pipeline : nullptr;
+		}
+
+		return find_resource(state.graphics_pipelines, pipeline_cache, pipeline_state);
+	}
+
+	if (pipeline_compilation == PipelineCompilation::AsyncFallback)
+	{
+		return fallback_graphics_pipeline;
+	}
+
+	return nullptr;
+}
+
+PipelineCompilation ResourceCache::get_pipeline_compilation() const
+{
+	return pipeline_compilation;
+}
+
+bool ResourceCache::is_graphics_pipeline_ready(PipelineState &pipeline_state)
+{
+	return find_resource(state.graphics_pipelines, pipeline_cache, pipeline_state) != nullptr;
+}
+
+void ResourceCache::set_pipeline_compilation(PipelineCompilation compilation, uint32_t thread_count)
+{
+	pipeline_compilation = compilation;
+
+	if (compilation == PipelineCompilation::Synchronous)
+	{
+		return;
+	}
+
+	thread_count = thread_count == 0 ? 1 : thread_count;
+
+	if (!compile_thread_pool)
+	{
+		compile_thread_pool = std::make_unique<ctpl::thread_pool>(static_cast<int>(thread_count));
+
+		create_thread_pipeline_caches();
+	}
+	else if (compile_thread_pool->size() != static_cast<int>(thread_count))
+	{
+		merge_pipeline_caches();
+
+		compile_thread_pool->resize(static_cast<int>(thread_count));
+
+		create_thread_pipeline_caches();
+	}
+}
+
+void ResourceCache::set_fallback_graphics_pipeline(GraphicsPipeline *pipeline)
+{
+	fallback_graphics_pipeline = pipeline;
+}
+
+void ResourceCache::set_pipeline_derivatives(bool enable)
+{
+	pipeline_derivatives = enable;
+}
+
+bool ResourceCache::is_using_pipeline_derivatives() const
+{
+	return pipeline_derivatives;
+}
+
+VkPipeline ResourceCache::get_base_pipeline(const PipelineState &pipeline_state)
+{
+	std::lock_guard<std::mutex> guard(base_pipeline_mutex);
+
+	auto it = base_pipelines.find(get_pipeline_family(pipeline_state));
+
+	return it != base_pipelines.end() ? it->second : VK_NULL_HANDLE;
+}
+
+void ResourceCache::set_base_pipeline(const PipelineState &pipeline_state, VkPipeline pipeline)
+{
+	std::lock_guard<std::mutex> guard(base_pipeline_mutex);
+
+	base_pipelines.emplace(get_pipeline_family(pipeline_state), pipeline);
+}
+
+void ResourceCache::remove_base_pipeline(VkPipeline pipeline)
+{
+	std::lock_guard<std::mutex> guard(base_pipeline_mutex);
+
+	// Derivatives outlive their base fine, but new ones need a base which still exists
+	for (auto it = base_pipelines.begin(); it != base_pipelines.end();)
+	{
+		if (it->second == pipeline)
+		{
+			it = base_pipelines.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void ResourceCache::wait_pending_pipelines()
+{
+	std::lock_guard<std::mutex> pending_guard(pending_pipeline_mutex);
+
+	for (auto &pending_it : pending_graphics_pipelines)
+	{
+		try
+		{
+			pending_it.second.get();
+		}
+		catch (const std::exception &e)
+		{
+			LOGE("Background compilation of graphics pipeline #{} failed: {}", pending_it.first, e.what());
+		}
+	}
+
+	pending_graphics_pipelines.clear();
 }
 
 ComputePipeline &ResourceCache::request_compute_pipeline(PipelineState &pipeline_state)
 {
-	return request_resource(device, recorder, compute_pipeline_mutex, state.compute_pipelines, pipeline_cache, pipeline_state);
+	return request_resource_concurrent(device, recorder, compute_pipeline_mutex, &compute_pipeline_usage, frame_number, state.compute_pipelines, pipeline_cache, pipeline_state);
 }
 
 DescriptorSet &ResourceCache::request_descriptor_set(DescriptorSetLayout &descriptor_set_layout, const BindingMap<VkDescriptorBufferInfo> &buffer_infos, const BindingMap<VkDescriptorImageInfo> &image_infos)
 {
-	auto &descriptor_pool = request_resource(device, recorder, descriptor_set_mutex, state.descriptor_pools, descriptor_set_layout);
-	return request_resource(device, recorder, descriptor_set_mutex, state.descriptor_sets, descriptor_set_layout, descriptor_pool, buffer_infos, image_infos);
+	// The sets of the cache are evicted one by one
+	uint32_t pool_size            = DescriptorPool::MAX_SETS_PER_POOL;
+	bool     free_descriptor_sets = true;
+
+	auto &descriptor_pool = request_resource(device, recorder, descriptor_set_mutex, &descriptor_pool_usage, frame_number, state.descriptor_pools, descriptor_set_layout, pool_size, free_descriptor_sets);
+	return request_resource(device, recorder, descriptor_set_mutex, &descriptor_set_usage, frame_number, state.descriptor_sets, descriptor_set_layout, descriptor_pool, buffer_infos, image_infos);
 }
 
 RenderPass &ResourceCache::request_render_pass(const std::vector<Attachment> &attachments, const std::vector<LoadStoreInfo> &load_store_infos, const std::vector<SubpassInfo> &subpasses)
 {
-	return request_resource(device, recorder, render_pass_mutex, state.render_passes, attachments, load_store_infos, subpasses);
+	return request_resource_concurrent(device, recorder, render_pass_mutex, &render_pass_usage, frame_number, state.render_passes, attachments, load_store_infos, subpasses);
 }
 
 Framebuffer &ResourceCache::request_framebuffer(const RenderTarget &render_target, const RenderPass &render_pass)
 {
-	return request_resource(device, recorder, framebuffer_mutex, state.framebuffers, render_target, render_pass);
+	// Imageless framebuffers only depend on the attachment descriptions, so they survive render target recreation
+	if (device.uses_imageless_framebuffers())
+	{
+		return request_resource(device, recorder, framebuffer_mutex, &framebuffer_usage, frame_number, state.framebuffers, render_target.get_framebuffer_attachments(), render_pass);
+	}
+
+	return request_resource(device, recorder, framebuffer_mutex, &framebuffer_usage, frame_number, state.framebuffers, render_target, render_pass);
+}
+
+core::Sampler &ResourceCache::request_sampler(const VkSamplerCreateInfo &info)
+{
+	return request_resource_concurrent(device, recorder, sampler_mutex, &sampler_usage, frame_number, state.samplers, info);
+}
+
+void ResourceCache::begin_frame(uint64_t new_frame_number, uint64_t completed_frame_number)
+{
+	frame_number = new_frame_number;
+
+	// Hits and misses are counted in the shards of the requesting threads, and added up once per frame
+	for_each_map([](const char *, std::mutex &resource_mutex, CachedResourceUsage &usage, auto &, auto &) {
+		std::lock_guard<std::mutex> guard(resource_mutex);
+
+		usage.collect_counts();
+	});
+
+	evict_resources(descriptor_set_mutex, descriptor_set_usage, state.descriptor_sets, completed_frame_number,
+	                [](DescriptorSet &descriptor_set) { descriptor_set.get_pool().free(descriptor_set.get_handle()); });
+
+	evict_resources(framebuffer_mutex, framebuffer_usage, state.framebuffers, completed_frame_number, [](Framebuffer &) {});
+
+	evict_resources(graphics_pipeline_mutex, graphics_pipeline_usage, state.graphics_pipelines, completed_frame_number,
+	                [this](GraphicsPipeline &pipeline) {
+		                remove_base_pipeline(pipeline.get_handle());
+
+		                // A pipeline created later at the same address must not inherit its record index
+		                recorder.remove_graphics_pipeline(pipeline);
+	                });
+
+	evict_resources(compute_pipeline_mutex, compute_pipeline_usage, state.compute_pipelines, completed_frame_number, [](ComputePipeline &) {});
+
+	// Frame boundaries with all the background pipelines built are the idle points the thread caches are merged at
+	if (thread_pipeline_caches_dirty)
+	{
+		std::lock_guard<std::mutex> pending_guard(pending_pipeline_mutex);
+
+		bool idle = std::all_of(pending_graphics_pipelines.begin(), pending_graphics_pipelines.end(), [](const std::pair<const std::size_t, std::shared_future<void>> &pending) {
+			return pending.second.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		});
+
+		if (idle)
+		{
+			merge_thread_pipeline_caches();
+		}
+	}
+}
+
+void ResourceCache::set_budget(EvictableResource type, const ResourceCacheBudget &budget)
+{
+	switch (type)
+	{
+		case EvictableResource::DescriptorSet:
+			descriptor_set_usage.budget = budget;
+			break;
+		case EvictableResource::Framebuffer:
+			framebuffer_usage.budget = budget;
+			break;
+		case EvictableResource::GraphicsPipeline:
+			graphics_pipeline_usage.budget = budget;
+			break;
+		case EvictableResource::ComputePipeline:
+			compute_pipeline_usage.budget = budget;
+			break;
+	}
+}
+
+ResourceCacheStats ResourceCache::get_stats(EvictableResource type)
+{
+	auto fill_stats = [](std::mutex &resource_mutex, CachedResourceUsage &usage, auto &resources) {
+		std::lock_guard<std::mutex> guard(resource_mutex);
+
+		ResourceCacheStats stats;
+		stats.entries   = resources.size();
+		stats.bytes     = resources.size() * sizeof(typename std::decay<decltype(resources)>::type::mapped_type);
+		stats.hits      = usage.hits;
+		stats.misses    = usage.misses;
+		stats.evictions = usage.evictions;
+
+		return stats;
+	};
+
+	switch (type)
+	{
+		case EvictableResource::DescriptorSet:
+			return fill_stats(descriptor_set_mutex, descriptor_set_usage, state.descriptor_sets);
+		case EvictableResource::Framebuffer:
+			return fill_stats(framebuffer_mutex, framebuffer_usage, state.framebuffers);
+		case EvictableResource::GraphicsPipeline:
+			return fill_stats(graphics_pipeline_mutex, graphics_pipeline_usage, state.graphics_pipelines);
+		case EvictableResource::ComputePipeline:
+			return fill_stats(compute_pipeline_mutex, compute_pipeline_usage, state.compute_pipelines);
+		default:
+			return {};
+	}
+}
+
+void ResourceCache::record_pipeline_creation(const Pipeline &pipeline, bool is_compute)
+{
+	auto &feedback = pipeline.get_creation_feedback();
+
+	std::lock_guard<std::mutex> guard(pipeline_creation_mutex);
+
+	auto &stats = is_compute ? compute_pipeline_creation : graphics_pipeline_creation;
+
+	++stats.created;
+
+	if (!feedback.valid)
+	{
+		return;
+	}
+
+	++stats.reported;
+	stats.total_duration += feedback.duration;
+	stats.max_duration = std::max(stats.max_duration, feedback.duration);
+
+	if (feedback.cache_hit)
+	{
+		++stats.cache_hits;
+	}
+
+	pipeline_creations.push_back({pipeline.get_summary(), feedback, is_compute});
+}
+
+PipelineCreationStats ResourceCache::get_pipeline_creation_stats(EvictableResource type)
+{
+	std::lock_guard<std::mutex> guard(pipeline_creation_mutex);
+
+	switch (type)
+	{
+		case EvictableResource::GraphicsPipeline:
+			return graphics_pipeline_creation;
+		case EvictableResource::ComputePipeline:
+			return compute_pipeline_creation;
+		default:
+			return {};
+	}
+}
+
+std::vector<PipelineCreationRecord> ResourceCache::get_slowest_pipelines(size_t count)
+{
+	std::vector<PipelineCreationRecord> slowest;
+
+	{
+		std::lock_guard<std::mutex> guard(pipeline_creation_mutex);
+		slowest = pipeline_creations;
+	}
+
+	count = std::min(count, slowest.size());
+
+	std::partial_sort(slowest.begin(), slowest.begin() + count, slowest.end(), [](const PipelineCreationRecord &a, const PipelineCreationRecord &b) {
+		return a.feedback.duration > b.feedback.duration;
+	});
+
+	slowest.resize(count);
+
+	return slowest;
+}
+
+void ResourceCache::log_pipeline_creation_report(size_t count)
+{
+	auto log_stats = [](const char *type, const PipelineCreationStats &stats) {
+		if (stats.created == 0)
+		{
+			return;
+		}
+
+		LOGI("{} {} pipelines created, {} reported in {:.1f} ms (max {:.1f} ms), {} pipeline cache hits",
+		     stats.created, type, stats.reported, stats.total_duration / 1e6, stats.max_duration / 1e6, stats.cache_hits);
+	};
+
+	log_stats("graphics", get_pipeline_creation_stats(EvictableResource::GraphicsPipeline));
+	log_stats("compute", get_pipeline_creation_stats(EvictableResource::ComputePipeline));
+
+	auto slowest = get_slowest_pipelines(count);
+
+	if (slowest.empty())
+	{
+		return;
+	}
+
+	LOGI("Slowest pipelines to create:");
+
+	for (auto &record : slowest)
+	{
+		LOGI("  {:.2f} ms{}: {}", record.feedback.duration / 1e6, record.feedback.cache_hit ? " (cache hit)" : "", record.summary);
+	}
+}
+
+template <class F>
+void ResourceCache::for_each_map(F visit)
+{
+	auto no_summary = [](const auto &) { return std::string{}; };
+
+	auto pipeline_summary = [](const Pipeline &pipeline) { return pipeline.get_summary(); };
+
+	visit("Shader modules", shader_module_mutex, shader_module_usage, state.shader_modules, no_summary);
+	visit("Pipeline layouts", pipeline_layout_mutex, pipeline_layout_usage, state.pipeline_layouts, no_summary);
+	visit("Descriptor set layouts", descriptor_set_layout_mutex, descriptor_set_layout_usage, state.descriptor_set_layouts, no_summary);
+	visit("Descriptor pools", descriptor_set_mutex, descriptor_pool_usage, state.descriptor_pools, no_summary);
+	visit("Descriptor sets", descriptor_set_mutex, descriptor_set_usage, state.descriptor_sets, no_summary);
+	visit("Render passes", render_pass_mutex, render_pass_usage, state.render_passes, no_summary);
+	visit("Framebuffers", framebuffer_mutex, framebuffer_usage, state.framebuffers, no_summary);
+	visit("Graphics pipelines", graphics_pipeline_mutex, graphics_pipeline_usage, state.graphics_pipelines, pipeline_summary);
+	visit("Compute pipelines", compute_pipeline_mutex, compute_pipeline_usage, state.compute_pipelines, pipeline_summary);
+	visit("Samplers", sampler_mutex, sampler_usage, state.samplers, no_summary);
+}
+
+std::vector<ResourceCacheMapInfo> ResourceCache::get_map_infos()
+{
+	std::vector<ResourceCacheMapInfo> map_infos;
+
+	for_each_map([&map_infos](const char *name, std::mutex &resource_mutex, CachedResourceUsage &usage, auto &resources, auto &) {
+		std::lock_guard<std::mutex> guard(resource_mutex);
+
+		ResourceCacheMapInfo map_info;
+		map_info.name            = name;
+		map_info.stats.entries   = resources.size();
+		map_info.stats.hits      = usage.hits;
+		map_info.stats.misses    = usage.misses;
+		map_info.stats.evictions = usage.evictions;
+
+		for (auto &entry : resources)
+		{
+			map_info.stats.bytes += sizeof(entry.second) + entry.key.size();
+		}
+
+		map_infos.push_back(std::move(map_info));
+	});
+
+	return map_infos;
+}
+
+std::vector<ResourceCacheEntryInfo> ResourceCache::get_entry_infos(const std::string &map_name)
+{
+	std::vector<ResourceCacheEntryInfo> entry_infos;
+
+	for_each_map([&map_name, &entry_infos](const char *name, std::mutex &resource_mutex, CachedResourceUsage &, auto &resources, auto &summarize) {
+		if (map_name != name)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> guard(resource_mutex);
+
+		entry_infos.reserve(resources.size());
+
+		for (auto &entry : resources)
+		{
+			ResourceCacheEntryInfo entry_info;
+			entry_info.hash          = entry.first;
+			entry_info.summary       = summarize(entry.second);
+			entry_info.created       = entry.metadata.created;
+			entry_info.last_used     = entry.metadata.last_used.load(std::memory_order_relaxed);
+			entry_info.creation_time = entry.metadata.creation_time;
+
+			entry_infos.push_back(std::move(entry_info));
+		}
+	});
+
+	return entry_infos;
 }
 
 void ResourceCache::clear_pipelines()
 {
-	state.graphics_pipelines.clear();
-	state.compute_pipelines.clear();
+	wait_pending_pipelines();
+
+	// Frames in flight may still be drawing with the pipelines
+	auto &deletion_queue = device.get_deletion_queue();
+
+	{
+		std::lock_guard<std::mutex> guard(graphics_pipeline_mutex);
+		deletion_queue.release(state.graphics_pipelines.take_entries());
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(compute_pipeline_mutex);
+		deletion_queue.release(state.compute_pipelines.take_entries());
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(base_pipeline_mutex);
+		base_pipelines.clear();
+	}
+
+	recorder.clear_graphics_pipelines();
 }
 
 void ResourceCache::update_descriptor_sets(const std::vector<core::ImageView> &old_views, const std::vector<core::ImageView> &new_views)
 {
+	std::lock_guard<std::mutex> guard(descriptor_set_mutex);
+
 	// Find descriptor sets referring to the old image view
 	std::vector<VkWriteDescriptorSet> set_updates;
-	std::set<size_t>                  matches;
+	std::set<std::pair<size_t, std::vector<uint8_t>>> matches;
 
 	for (size_t i = 0; i < old_views.size(); ++i)
 	{
@@ -121,7 +1083,7 @@ void ResourceCache::update_descriptor_sets(const std::vector<core::ImageView> &o
 
 		for (auto &kd_pair : state.descriptor_sets)
 		{
-			auto &key            = kd_pair.first;
+			auto &hash           = kd_pair.first;
 			auto &descriptor_set = kd_pair.second;
 
 			auto &image_infos = descriptor_set.get_image_infos();
@@ -139,7 +1101,7 @@ void ResourceCache::update_descriptor_sets(const std::vector<core::ImageView> &o
 					if (image_info.imageView == old_view.get_handle())
 					{
 						// Save key to remove old descriptor set
-						matches.insert(key);
+						matches.emplace(hash, kd_pair.key);
 
 						// Update image info with new view
 						image_info.imageView = new_view.get_handle();
@@ -179,34 +1141,84 @@ void ResourceCache::update_descriptor_sets(const std::vector<core::ImageView> &o
 	// Delete old entries (moved out descriptor sets)
 	for (auto &match : matches)
 	{
-		// Move out of the map
-		auto it             = state.descriptor_sets.find(match);
-		auto descriptor_set = std::move(it->second);
-		state.descriptor_sets.erase(match);
+		uint64_t last_used{0};
+		uint64_t created{0};
+		float    creation_time{0.0f};
+
+		// Move out of the map, keeping its usage
+		auto descriptor_set = std::move(*state.descriptor_sets.find(match.first, match.second, [&](CachedResourceMap<DescriptorSet>::Entry &entry) {
+			last_used     = entry.metadata.last_used.load(std::memory_order_relaxed);
+			created       = entry.metadata.created;
+			creation_time = entry.metadata.creation_time;
+		}));
+		state.descriptor_sets.erase(match.first, match.second);
 
 		// Generate new key
-		size_t new_key = 0U;
-		hash_param(new_key, descriptor_set.get_layout(), descriptor_set.get_buffer_infos(), descriptor_set.get_image_infos());
+		size_t new_hash = 0U;
+		auto   new_key  = get_resource_key(new_hash, descriptor_set.get_layout(), descriptor_set.get_pool(), descriptor_set.get_buffer_infos(), descriptor_set.get_image_infos());
 
-		// Add (key, resource) to the cache
-		state.descriptor_sets.emplace(new_key, std::move(descriptor_set));
+		// Add (key, resource) to the cache, tracking its usage under the new key
+		state.descriptor_sets.emplace(new_hash, std::move(new_key), std::move(descriptor_set), [&](CachedResourceMap<DescriptorSet>::Entry &entry) {
+			entry.metadata.last_used.store(last_used, std::memory_order_relaxed);
+			entry.metadata.created       = created;
+			entry.metadata.creation_time = creation_time;
+		});
 	}
 }
 
 void ResourceCache::clear_framebuffers()
 {
+	std::lock_guard<std::mutex> guard(framebuffer_mutex);
+
 	state.framebuffers.clear();
 }
 
+void ResourceCache::release_framebuffers(const std::vector<VkImageView> &views)
+{
+	std::lock_guard<std::mutex> guard(framebuffer_mutex);
+
+	std::vector<CachedResourceMap<Framebuffer>::Entry *> released;
+
+	for (auto &entry : state.framebuffers)
+	{
+		auto &framebuffer_views = entry.second.get_views();
+
+		auto refers_to_views = std::any_of(framebuffer_views.begin(), framebuffer_views.end(), [&views](VkImageView view) {
+			return std::find(views.begin(), views.end(), view) != views.end();
+		});
+
+		if (refers_to_views)
+		{
+			released.push_back(&entry);
+		}
+	}
+
+	framebuffer_usage.evictions += state.framebuffers.erase(released, [](Framebuffer &) {});
+}
+
+void ResourceCache::evict_unused_since(uint64_t frame_number)
+{
+	evict_unused_resources(descriptor_set_mutex, descriptor_set_usage, state.descriptor_sets, frame_number,
+	                       [](DescriptorSet &descriptor_set) { descriptor_set.get_pool().free(descriptor_set.get_handle()); });
+
+	evict_unused_resources(framebuffer_mutex, framebuffer_usage, state.framebuffers, frame_number, [](Framebuffer &) {});
+}
+
 void ResourceCache::clear()
 {
-	state.shader_modules.clear();
-	state.pipeline_layouts.clear();
-	state.descriptor_sets.clear();
-	state.descriptor_set_layouts.clear();
-	state.render_passes.clear();
+	auto clear_map = [](std::mutex &resource_mutex, auto &resources) {
+		std::lock_guard<std::mutex> guard(resource_mutex);
+		resources.clear();
+	};
+
+	clear_map(shader_module_mutex, state.shader_modules);
+	clear_map(pipeline_layout_mutex, state.pipeline_layouts);
+	clear_map(descriptor_set_mutex, state.descriptor_sets);
+	clear_map(descriptor_set_layout_mutex, state.descriptor_set_layouts);
+	clear_map(render_pass_mutex, state.render_passes);
 	clear_pipelines();
 	clear_framebuffers();
+	clear_map(sampler_mutex, state.samplers);
 }
 
 const ResourceCacheState &ResourceCache::get_internal_state() const
@@ -20,57 +20,275 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "common/concurrent_resource_map.h"
 #include "common/helpers.h"
 #include "core/descriptor_pool.h"
 #include "core/descriptor_set.h"
 #include "core/descriptor_set_layout.h"
 #include "core/framebuffer.h"
 #include "core/pipeline.h"
+#include "core/sampler.h"
+#include "resource_cache_file.h"
 #include "resource_record.h"
 #include "resource_replay.h"
 
+namespace ctpl
+{
+class thread_pool;
+}
+
 namespace vkb
 {
 class Device;
+class JobSystem;
 
 namespace core
 {
 class ImageView;
 }
 
+/**
+ * @brief How graphics pipelines missing from the cache are built
+ */
+enum class PipelineCompilation
+{
+	/// Pipelines are created in the draw call that needs them
+	Synchronous,
+
+	/// Pipelines are created on a worker thread, the draw call waits for them
+	AsyncWait,
+
+	/// Pipelines are created on a worker thread, draws are skipped until they are ready
+	AsyncSkip,
+
+	/// Pipelines are created on a worker thread, draws use the fallback pipeline until they are ready
+	AsyncFallback
+};
+
+/**
+ * @brief Cached resources which can be evicted once they are not used anymore
+ */
+enum class EvictableResource
+{
+	DescriptorSet,
+	Framebuffer,
+	GraphicsPipeline,
+	ComputePipeline
+};
+
+/**
+ * @brief Limits on the cached resources of one type, 0 means unlimited.
+ *        Bytes account for the host memory of the cache entries.
+ */
+struct ResourceCacheBudget
+{
+	size_t max_entries{0};
+
+	size_t max_bytes{0};
+};
+
+/**
+ * @brief Usage counters of the cached resources of one type
+ */
+struct ResourceCacheStats
+{
+	size_t entries{0};
+
+	size_t bytes{0};
+
+	uint64_t hits{0};
+
+	uint64_t misses{0};
+
+	uint64_t evictions{0};
+};
+
+/**
+ * @brief Creation times of the pipelines of one type, as reported by VK_EXT_pipeline_creation_feedback
+ */
+struct PipelineCreationStats
+{
+	uint32_t created{0};
+
+	/// Pipelines whose creation the driver reported feedback for
+	uint32_t reported{0};
+
+	/// Reported pipelines found in the pipeline cache
+	uint32_t cache_hits{0};
+
+	/// Sum of the creation times of the reported pipelines, in nanoseconds
+	uint64_t total_duration{0};
+
+	/// Longest creation time of a reported pipeline, in nanoseconds
+	uint64_t max_duration{0};
+};
+
+/**
+ * @brief The creation of one pipeline, kept for the report of the slowest ones
+ */
+struct PipelineCreationRecord
+{
+	std::string summary;
+
+	PipelineCreationFeedback feedback;
+
+	bool is_compute{false};
+};
+
+/**
+ * @brief When a cached resource was created and last requested, kept along the resource in its map
+ */
+struct ResourceUsageEntry
+{
+	/// Frame number of the last request
+	std::atomic<uint64_t> last_used{0};
+
+	/// Frame number of the creation
+	uint64_t created{0};
+
+	/// CPU time spent creating the resource, in milliseconds
+	float creation_time{0.0f};
+};
+
+/**
+ * @brief Map of the cached resources of one type, whose hits do not take any lock
+ */
+template <class T>
+using CachedResourceMap = ConcurrentResourceMap<T, ResourceUsageEntry>;
+
+/**
+ * @brief Hits and misses counted by the threads of one shard, padded to a cache line of its own
+ */
+struct ResourceRequestCounts
+{
+	std::atomic<uint64_t> hits{0};
+
+	std::atomic<uint64_t> misses{0};
+
+	uint8_t padding[CACHE_LINE_SIZE - 2 * sizeof(std::atomic<uint64_t>)];
+};
+
+/**
+ * @brief Usage counters and budget of the cached resources of one type
+ */
+struct CachedResourceUsage
+{
+	static const std::size_t SHARD_COUNT = 16;
+
+	ResourceCacheBudget budget;
+
+	/// Counted by the requesting threads in the shard of their thread, so that hits do not share a counter
+	std::array<ResourceRequestCounts, SHARD_COUNT> shards;
+
+	/// Totals of the shards as of the start of the frame, guarded by the mutex of the map
+	uint64_t hits{0};
+
+	uint64_t misses{0};
+
+	uint64_t evictions{0};
+
+	ResourceRequestCounts &get_shard()
+	{
+		return shards[get_thread_shard() % SHARD_COUNT];
+	}
+
+	/**
+	 * @brief Adds the counts of the shards to the totals, the mutex of the map must be held
+	 */
+	void collect_counts()
+	{
+		for (auto &shard : shards)
+		{
+			hits += shard.hits.exchange(0, std::memory_order_relaxed);
+			misses += shard.misses.exchange(0, std::memory_order_relaxed);
+		}
+	}
+};
+
+/**
+ * @brief A map of the cache as listed by the resource cache inspector. Its bytes account for the host memory
+ *        of the entries and their keys, as the cached objects do not own any device memory
+ */
+struct ResourceCacheMapInfo
+{
+	std::string name;
+
+	ResourceCacheStats stats;
+};
+
+/**
+ * @brief A cached resource as listed by the resource cache inspector
+ */
+struct ResourceCacheEntryInfo
+{
+	std::size_t hash{0};
+
+	/// Frame numbers of the creation and of the last request
+	uint64_t created{0};
+
+	uint64_t last_used{0};
+
+	/// CPU time spent creating the resource in milliseconds, the compile cost of pipelines
+	float creation_time{0.0f};
+
+	/// Summary of the state of a pipeline, empty for other resources
+	std::string summary;
+};
+
+/**
+ * @brief A shader module requested in a batch, the source and variant must outlive the request
+ */
+struct ShaderModuleRequest
+{
+	VkShaderStageFlagBits stage;
+
+	const ShaderSource *source;
+
+	const ShaderVariant *variant;
+};
+
 /**
  * @brief Struct to hold the internal state of the Resource Cache
  *
  */
 struct ResourceCacheState
 {
-	std::unordered_map<std::size_t, ShaderModule> shader_modules;
+	CachedResourceMap<ShaderModule> shader_modules;
 
-	std::unordered_map<std::size_t, PipelineLayout> pipeline_layouts;
+	CachedResourceMap<PipelineLayout> pipeline_layouts;
 
-	std::unordered_map<std::size_t, DescriptorSetLayout> descriptor_set_layouts;
+	CachedResourceMap<DescriptorSetLayout> descriptor_set_layouts;
 
-	std::unordered_map<std::size_t, DescriptorPool> descriptor_pools;
+	CachedResourceMap<DescriptorPool> descriptor_pools;
 
-	std::unordered_map<std::size_t, RenderPass> render_passes;
+	CachedResourceMap<RenderPass> render_passes;
 
-	std::unordered_map<std::size_t, GraphicsPipeline> graphics_pipelines;
+	CachedResourceMap<GraphicsPipeline> graphics_pipelines;
 
-	std::unordered_map<std::size_t, ComputePipeline> compute_pipelines;
+	CachedResourceMap<ComputePipeline> compute_pipelines;
 
-	std::unordered_map<std::size_t, DescriptorSet> descriptor_sets;
+	CachedResourceMap<DescriptorSet> descriptor_sets;
 
-	std::unordered_map<std::size_t, Framebuffer> framebuffers;
+	CachedResourceMap<Framebuffer> framebuffers;
+
+	CachedResourceMap<core::Sampler> samplers;
 };
 
 /**
  * @brief Cache all sorts of Vulkan objects specific to a Vulkan device.
  * Supports serialization and deserialization of cached resources.
- * There is only one cache for all these objects, with several unordered_map of hash indices
- * and objects. For every object requested, there is a templated version on request_resource.
+ * There is only one cache for all these objects, with several maps of hash indices
+ * and objects. Entries also store the serialized parameters they were created with, so that
+ * colliding hashes are told apart. Requests finding their resource in a map do not take any
+ * lock, the misses of each map are serialized by a mutex. For every object requested, there is a templated version on request_resource.
  * Some objects may need building if they are not found in the cache.
  *
  * The resource cache is also linked with ResourceRecord and ResourceReplay. Replay can warm-up
@@ -91,20 +309,132 @@ class ResourceCache
 
 	ResourceCache &operator=(ResourceCache &&) = delete;
 
+	~ResourceCache();
+
 	void warmup(const std::vector<uint8_t> &data);
 
+	/**
+	 * @brief Creates all the resources stored in a resource cache file
+	 * @param cache_file A valid resource cache file
+	 */
+	void warmup(const ResourceCacheFile &cache_file);
+
 	std::vector<uint8_t> serialize();
 
+	/**
+	 * @brief Writes the recorded resources, and the pipeline cache data if a
+	 *        pipeline cache is set, to a resource cache file in temporary storage
+	 * @param filename The path to the file (relative to the temporary storage directory)
+	 */
+	void serialize(const std::string &filename);
+
+	/**
+	 * @brief Sets the pipeline cache new pipelines are created with, the caches of the compile
+	 *        threads are merged into the previous one first
+	 */
 	void set_pipeline_cache(VkPipelineCache pipeline_cache);
 
+	/**
+	 * @brief Selects whether each compile thread creates its pipelines with a pipeline cache of its own,
+	 *        seeded with the data of the pipeline cache, instead of sharing the pipeline cache. Threads then
+	 *        do not contend on the lock of the driver, and their caches are merged into the pipeline cache
+	 *        once no pipeline is being built and before serialization. Off by default.
+	 */
+	void set_per_thread_pipeline_caches(bool enable);
+
+	bool is_using_per_thread_pipeline_caches() const;
+
+	/**
+	 * @brief Merges the caches of the compile threads into the pipeline cache,
+	 *        waiting for the pipelines being built in the background first
+	 */
+	void merge_pipeline_caches();
+
+	/**
+	 * @brief Requests a shader module. The defines of the variant which stand in for a specialization
+	 *        constant of the source are left out of the compilation, so their variants share one module;
+	 *        the values of the constants are given by ShaderModule::get_define_constants
+	 */
 	ShaderModule &request_shader_module(VkShaderStageFlagBits stage, const ShaderSource &glsl_source, const ShaderVariant &shader_variant = {});
 
+	/**
+	 * @brief Requests a batch of shader modules, the missing ones are compiled in parallel on the job system if one is set
+	 * @param requests The modules to request
+	 * @return The modules, in the order of the requests
+	 */
+	std::vector<ShaderModule *> request_shader_modules(const std::vector<ShaderModuleRequest> &requests);
+
+	/**
+	 * @brief Sets the job system batches of shader modules are compiled on, nullptr to compile them on the calling thread
+	 */
+	void set_job_system(JobSystem *job_system);
+
 	PipelineLayout &request_pipeline_layout(const std::vector<ShaderModule *> &shader_modules, bool use_dynamic_resources);
 
 	DescriptorSetLayout &request_descriptor_set_layout(const std::vector<ShaderResource> &set_resources, bool use_dynamic_resources);
 
 	GraphicsPipeline &request_graphics_pipeline(PipelineState &pipeline_state);
 
+	/**
+	 * @brief Requests a batch of graphics pipelines, the missing ones are built in parallel on the job system if one is set
+	 * @param pipeline_states The states of the pipelines
+	 */
+	void request_graphics_pipelines(std::vector<PipelineState> &pipeline_states);
+
+	/**
+	 * @brief Requests a graphics pipeline following the current compilation policy
+	 * @param pipeline_state The state of the pipeline
+	 * @returns The requested pipeline, the fallback pipeline or nullptr if the draw should be skipped.
+	 *          A pipeline which failed to build is logged and requested again by the next call
+	 */
+	GraphicsPipeline *request_graphics_pipeline_async(PipelineState &pipeline_state);
+
+	/**
+	 * @brief Checks whether a graphics pipeline is already built
+	 * @param pipeline_state The state of the pipeline
+	 */
+	bool is_graphics_pipeline_ready(PipelineState &pipeline_state);
+
+	/**
+	 * @brief Sets how missing graphics pipelines are built
+	 * @param compilation The compilation policy
+	 * @param thread_count The number of worker threads used by the asynchronous policies
+	 */
+	void set_pipeline_compilation(PipelineCompilation compilation, uint32_t thread_count = 1);
+
+	PipelineCompilation get_pipeline_compilation() const;
+
+	/**
+	 * @brief Sets the pipeline drawn with by PipelineCompilation::AsyncFallback
+	 *        while the requested one is being built. It must be compatible with
+	 *        the render passes it is used in.
+	 */
+	void set_fallback_graphics_pipeline(GraphicsPipeline *pipeline);
+
+	/**
+	 * @brief Creates the graphics pipelines sharing a layout (hence shaders) and a subpass as
+	 *        derivatives of the first one of them, which drivers can build upon to create the others
+	 *        faster. Off by default, as allowing derivatives can cost some performance on the base pipelines.
+	 *        VK_EXT_graphics_pipeline_library is not used instead, as its libraries would need the pipeline state
+	 *        split into vertex input, pre-rasterization, fragment shader and output parts, each keyed and cached
+	 *        on its own, where the cache builds whole pipelines from one PipelineState.
+	 */
+	void set_pipeline_derivatives(bool enable);
+
+	bool is_using_pipeline_derivatives() const;
+
+	/**
+	 * @brief Finds the pipeline the pipelines of a state should derive from
+	 * @return The base pipeline, or VK_NULL_HANDLE if none has been created for such states
+	 */
+	VkPipeline get_base_pipeline(const PipelineState &pipeline_state);
+
+
+	/**
+	 * @brief Blocks until all the pipelines being built in the background are ready
+	 */
+	void wait_pending_pipelines();
+
 	ComputePipeline &request_compute_pipeline(PipelineState &pipeline_state);
 
 	DescriptorSet &request_descriptor_set(DescriptorSetLayout &                     descriptor_set_layout,
@@ -118,6 +448,63 @@ class ResourceCache
 	Framebuffer &request_framebuffer(const RenderTarget &render_target,
 	                                 const RenderPass &  render_pass);
 
+	/**
+	 * @brief Requests a sampler, identical create infos share one sampler so that
+	 *        the descriptor sets binding them can be shared as well
+	 * @param info The creation details of the sampler, without any chained structure
+	 */
+	core::Sampler &request_sampler(const VkSamplerCreateInfo &info);
+
+	/**
+	 * @brief Marks the start of a new frame and evicts the least recently used resources
+	 *        of the types over budget. Only resources last used in a frame the GPU has
+	 *        completed are evicted.
+	 * @param frame_number The number of the frame starting, used to tag requested resources
+	 * @param completed_frame_number The number of the last frame known to be completed by the GPU
+	 */
+	void begin_frame(uint64_t frame_number, uint64_t completed_frame_number);
+
+	void set_budget(EvictableResource type, const ResourceCacheBudget &budget);
+
+	ResourceCacheStats get_stats(EvictableResource type);
+
+	/**
+	 * @brief Called by the pipelines once created, records the creation feedback they were given
+	 */
+	void record_pipeline_creation(const Pipeline &pipeline, bool is_compute);
+
+	/**
+	 * @param type EvictableResource::GraphicsPipeline or EvictableResource::ComputePipeline
+	 */
+	PipelineCreationStats get_pipeline_creation_stats(EvictableResource type);
+
+	/**
+	 * @brief Lists every map of the cache with its counters, for the resource cache inspector
+	 */
+	std::vector<ResourceCacheMapInfo> get_map_infos();
+
+	/**
+	 * @brief Lists the resources of one map of the cache
+	 * @param name Name of the map, as given by get_map_infos
+	 */
+	std::vector<ResourceCacheEntryInfo> get_entry_infos(const std::string &name);
+
+	/**
+	 * @brief Lists the pipelines which took the longest to create, only those the driver reported feedback for
+	 * @param count The maximum number of pipelines returned
+	 */
+	std::vector<PipelineCreationRecord> get_slowest_pipelines(size_t count);
+
+	/**
+	 * @brief Logs the pipeline creation totals and the slowest pipelines with a summary of their state
+	 * @param count The maximum number of pipelines listed
+	 */
+	void log_pipeline_creation_report(size_t count = 10);
+
+	/**
+	 * @brief Removes all the pipelines from the cache, they are destroyed
+	 *        by the deletion queue of the device once the frames in flight have completed
+	 */
 	void clear_pipelines();
 
 	/// @brief Update those descriptor sets referring to old views
@@ -127,6 +514,19 @@ class ResourceCache
 
 	void clear_framebuffers();
 
+	/**
+	 * @brief Destroys the framebuffers referring to any of the image views, which are about to be destroyed
+	 * @param views The image views of a render target being destroyed
+	 */
+	void release_framebuffers(const std::vector<VkImageView> &views);
+
+	/**
+	 * @brief Evicts the framebuffers and descriptor sets last used in or before a frame the GPU has completed,
+	 *        so that none of them refers to image views destroyed afterwards
+	 * @param frame_number The number of the last frame which may have used the destroyed image views
+	 */
+	void evict_unused_since(uint64_t frame_number);
+
 	void clear();
 
 	const ResourceCacheState &get_internal_state() const;
@@ -142,6 +542,7 @@ class ResourceCache
 
 	ResourceCacheState state;
 
+	/// Serialize the misses, evictions and listings of each map, hits do not lock
 	std::mutex descriptor_set_mutex;
 
 	std::mutex pipeline_layout_mutex;
@@ -157,5 +558,93 @@ class ResourceCache
 	std::mutex compute_pipeline_mutex;
 
 	std::mutex framebuffer_mutex;
+
+	std::mutex sampler_mutex;
+
+	std::atomic<uint64_t> frame_number{0};
+
+	CachedResourceUsage shader_module_usage;
+
+	CachedResourceUsage pipeline_layout_usage;
+
+	CachedResourceUsage descriptor_set_layout_usage;
+
+	CachedResourceUsage descriptor_pool_usage;
+
+	CachedResourceUsage render_pass_usage;
+
+	CachedResourceUsage sampler_usage;
+
+	CachedResourceUsage descriptor_set_usage;
+
+	CachedResourceUsage framebuffer_usage;
+
+	CachedResourceUsage graphics_pipeline_usage;
+
+	CachedResourceUsage compute_pipeline_usage;
+
+	PipelineCreationStats graphics_pipeline_creation;
+
+	PipelineCreationStats compute_pipeline_creation;
+
+	std::vector<PipelineCreationRecord> pipeline_creations;
+
+	std::mutex pipeline_creation_mutex;
+
+	PipelineCompilation pipeline_compilation{PipelineCompilation::Synchronous};
+
+	GraphicsPipeline *fallback_graphics_pipeline{nullptr};
+
+	bool pipeline_derivatives{false};
+
+	/// Base pipelines, mapped by the hash of the layout, render pass and subpass of their derivatives
+	std::unordered_map<std::size_t, VkPipeline> base_pipelines;
+
+	std::mutex base_pipeline_mutex;
+
+	/**
+	 * @brief Requests a graphics pipeline, registering it as the base of its family if it was created to be one.
+	 *        Only a pipeline kept by the cache is registered, which may not be the one a thread built.
+	 */
+	GraphicsPipeline &request_graphics_pipeline(VkPipelineCache cache, PipelineState &pipeline_state);
+
+	void set_base_pipeline(const PipelineState &pipeline_state, VkPipeline pipeline);
+
+	void remove_base_pipeline(VkPipeline pipeline);
+
+	/// Graphics pipelines being built by the compile threads, mapped by hash
+	std::unordered_map<std::size_t, std::shared_future<void>> pending_graphics_pipelines;
+
+	std::mutex pending_pipeline_mutex;
+
+	std::unique_ptr<ctpl::thread_pool> compile_thread_pool;
+
+	bool per_thread_pipeline_caches{false};
+
+	/// Pipeline caches of the compile threads, by thread index
+	std::vector<VkPipelineCache> thread_pipeline_caches;
+
+	/// Whether the thread pipeline caches hold pipelines not merged into the pipeline cache yet
+	std::atomic<bool> thread_pipeline_caches_dirty{false};
+
+	/**
+	 * @brief Recreates the thread pipeline caches from the pipeline cache, the previous ones must be merged
+	 */
+	void create_thread_pipeline_caches();
+
+	void destroy_thread_pipeline_caches();
+
+	/**
+	 * @brief Merges the thread pipeline caches, no pipeline may be built meanwhile
+	 */
+	void merge_thread_pipeline_caches();
+
+	JobSystem *job_system{nullptr};
+
+	/**
+	 * @brief Calls a function with the name, lock, usage and resources of each map, and a function summarizing its resources
+	 */
+	template <class F>
+	void for_each_map(F visit);
 };
 }        // namespace vkb
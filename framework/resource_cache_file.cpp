@@ -0,0 +1,209 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "resource_cache_file.h"
+
+#include <cstring>
+
+#include "common/logging.h"
+#include "core/device.h"
+#include "resource_record.h"
+
+namespace vkb
+{
+namespace
+{
+inline void fill_device_info(const Device &device, ResourceCacheFileHeader &header)
+{
+	auto &properties = device.get_properties();
+
+	header.vendor_id      = properties.vendorID;
+	header.device_id      = properties.deviceID;
+	header.driver_version = properties.driverVersion;
+
+	std::memcpy(header.pipeline_cache_uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+}
+}        // namespace
+
+ResourceCacheFile::ResourceCacheFile(const Device &device, const std::string &filename)
+{
+	ResourceCacheFileHeader device_header{};
+	fill_device_info(device, device_header);
+
+	bool discarded = false;
+
+	// Only the header is checked, a cache from another driver is discarded once its first chunk is decompressed
+	auto accept = [&](const uint8_t *data, size_t size) {
+		if (size < sizeof(ResourceCacheFileHeader))
+		{
+			return true;
+		}
+
+		auto file_header = reinterpret_cast<const ResourceCacheFileHeader *>(data);
+
+		if (file_header->magic != MAGIC || file_header->version != VERSION)
+		{
+			LOGW("Resource cache file {} has an unsupported version, ignoring it", filename);
+			discarded = true;
+		}
+		else if (file_header->vendor_id != device_header.vendor_id ||
+		         file_header->device_id != device_header.device_id ||
+		         file_header->driver_version != device_header.driver_version ||
+		         std::memcmp(file_header->pipeline_cache_uuid, device_header.pipeline_cache_uuid, VK_UUID_SIZE) != 0)
+		{
+			LOGW("Resource cache file {} was built for another device or driver, ignoring it", filename);
+			discarded = true;
+		}
+
+		return !discarded;
+	};
+
+	try
+	{
+		file = fs::map_temp_blob_if(filename, accept);
+	}
+	catch (const std::runtime_error &ex)
+	{
+		LOGW("No resource cache file found. {}", ex.what());
+		return;
+	}
+
+	if (discarded)
+	{
+		return;
+	}
+
+	if (file.get_size() < sizeof(ResourceCacheFileHeader))
+	{
+		LOGW("Resource cache file {} is too small, ignoring it", filename);
+		return;
+	}
+
+	auto file_header = reinterpret_cast<const ResourceCacheFileHeader *>(file.get_data());
+
+	uint64_t entries_end = sizeof(ResourceCacheFileHeader) + file_header->entry_count * sizeof(uint64_t);
+
+	if (entries_end > file_header->record_offset ||
+	    file_header->record_offset + file_header->record_size > file.get_size() ||
+	    file_header->pipeline_cache_offset + file_header->pipeline_cache_size > file.get_size())
+	{
+		LOGW("Resource cache file {} is truncated, ignoring it", filename);
+		return;
+	}
+
+	auto file_entry_offsets = reinterpret_cast<const uint64_t *>(file.get_data() + sizeof(ResourceCacheFileHeader));
+
+	// The entries are read in place, their offsets must be sorted and inside the record
+	for (uint32_t i = 0; i < file_header->entry_count; ++i)
+	{
+		if (file_entry_offsets[i] >= file_header->record_size || (i > 0 && file_entry_offsets[i] < file_entry_offsets[i - 1]))
+		{
+			LOGW("Resource cache file {} has invalid entry offsets, ignoring it", filename);
+			return;
+		}
+	}
+
+	header        = file_header;
+	entry_offsets = file_entry_offsets;
+}
+
+void ResourceCacheFile::write(const Device &device, const std::string &filename, ResourceRecord &recorder, VkPipelineCache pipeline_cache)
+{
+	auto record_data = recorder.get_data();
+	auto offsets     = recorder.get_entry_offsets();
+
+	size_t pipeline_cache_size{0};
+	if (pipeline_cache != VK_NULL_HANDLE)
+	{
+		VK_CHECK(vkGetPipelineCacheData(device.get_handle(), pipeline_cache, &pipeline_cache_size, nullptr));
+	}
+
+	ResourceCacheFileHeader header{};
+	header.magic   = MAGIC;
+	header.version = VERSION;
+	fill_device_info(device, header);
+
+	header.entry_count           = to_u32(offsets.size());
+	header.record_offset         = sizeof(ResourceCacheFileHeader) + offsets.size() * sizeof(uint64_t);
+	header.record_size           = record_data.size();
+	header.pipeline_cache_offset = header.record_offset + header.record_size;
+	header.pipeline_cache_size   = pipeline_cache_size;
+
+	std::vector<uint8_t> data(static_cast<size_t>(header.pipeline_cache_offset + header.pipeline_cache_size));
+
+	std::memcpy(data.data(), &header, sizeof(header));
+
+	auto entries = reinterpret_cast<uint64_t *>(data.data() + sizeof(ResourceCacheFileHeader));
+	for (size_t i = 0; i < offsets.size(); ++i)
+	{
+		entries[i] = offsets[i];
+	}
+
+	std::copy(record_data.begin(), record_data.end(), data.begin() + header.record_offset);
+
+	if (pipeline_cache_size > 0)
+	{
+		VK_CHECK(vkGetPipelineCacheData(device.get_handle(), pipeline_cache, &pipeline_cache_size, data.data() + header.pipeline_cache_offset));
+	}
+
+	fs::write_temp_blob(data, filename);
+}
+
+bool ResourceCacheFile::is_valid() const
+{
+	return header != nullptr;
+}
+
+uint32_t ResourceCacheFile::get_entry_count() const
+{
+	return header ? header->entry_count : 0;
+}
+
+const uint8_t *ResourceCacheFile::get_entry(uint32_t index, size_t &size) const
+{
+	assert(index < get_entry_count() && "Resource cache entry index out of range");
+
+	uint64_t end = index + 1 < header->entry_count ? entry_offsets[index + 1] : header->record_size;
+
+	size = static_cast<size_t>(end - entry_offsets[index]);
+
+	return get_record_data() + entry_offsets[index];
+}
+
+const uint8_t *ResourceCacheFile::get_record_data() const
+{
+	return header ? file.get_data() + header->record_offset : nullptr;
+}
+
+size_t ResourceCacheFile::get_record_size() const
+{
+	return header ? static_cast<size_t>(header->record_size) : 0;
+}
+
+const uint8_t *ResourceCacheFile::get_pipeline_cache_data() const
+{
+	return header ? file.get_data() + header->pipeline_cache_offset : nullptr;
+}
+
+size_t ResourceCacheFile::get_pipeline_cache_size() const
+{
+	return header ? static_cast<size_t>(header->pipeline_cache_size) : 0;
+}
+}        // namespace vkb
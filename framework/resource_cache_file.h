@@ -0,0 +1,136 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/vk_common.h"
+#include "platform/filesystem.h"
+
+namespace vkb
+{
+class Device;
+class ResourceRecord;
+
+/**
+ * @brief Header of a resource cache file
+ *
+ * The file is laid out as follows:
+ *   - The header
+ *   - entry_count 64-bit offsets of each resource record entry, relative to record_offset
+ *   - The resource record data
+ *   - The VkPipelineCache data
+ */
+struct ResourceCacheFileHeader
+{
+	uint32_t magic;
+
+	uint32_t version;
+
+	uint32_t vendor_id;
+
+	uint32_t device_id;
+
+	uint32_t driver_version;
+
+	uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+
+	uint32_t entry_count;
+
+	uint64_t record_offset;
+
+	uint64_t record_size;
+
+	uint64_t pipeline_cache_offset;
+
+	uint64_t pipeline_cache_size;
+};
+
+/**
+ * @brief Single file holding all the data needed for a warm start: the resource
+ *        record replayed by ResourceCache::warmup and the VkPipelineCache data.
+ *        The file is memory mapped, and is only considered valid if it was written
+ *        by the same version of the framework for the same device and driver.
+ */
+class ResourceCacheFile
+{
+  public:
+	static const uint32_t MAGIC = 0x43424B56;        // "VKBC"
+
+	static const uint32_t VERSION = 2;
+
+	/**
+	 * @brief Maps a resource cache file from temporary storage and validates its header.
+	 *        A missing or mismatching file results in an invalid, empty cache file.
+	 * @param device The device the cache will be used with
+	 * @param filename The path to the file (relative to the temporary storage directory)
+	 */
+	ResourceCacheFile(const Device &device, const std::string &filename);
+
+	ResourceCacheFile(const ResourceCacheFile &) = delete;
+
+	ResourceCacheFile(ResourceCacheFile &&) = default;
+
+	ResourceCacheFile &operator=(const ResourceCacheFile &) = delete;
+
+	ResourceCacheFile &operator=(ResourceCacheFile &&) = delete;
+
+	/**
+	 * @brief Writes a resource cache file in temporary storage
+	 * @param device The device the cache was built with
+	 * @param filename The path to the file (relative to the temporary storage directory)
+	 * @param recorder The resource record to store
+	 * @param pipeline_cache The pipeline cache to store, can be VK_NULL_HANDLE
+	 */
+	static void write(const Device &device, const std::string &filename, ResourceRecord &recorder, VkPipelineCache pipeline_cache);
+
+	bool is_valid() const;
+
+	uint32_t get_entry_count() const;
+
+	/**
+	 * @brief Gets a single entry of the resource record without parsing the ones before it
+	 * @param index The index of the entry
+	 * @param size Set to the size of the entry
+	 * @return Pointer to the serialized entry
+	 */
+	const uint8_t *get_entry(uint32_t index, size_t &size) const;
+
+	const uint8_t *get_record_data() const;
+
+	size_t get_record_size() const;
+
+	/**
+	 * @brief Pipeline cache data, to be passed to VkPipelineCacheCreateInfo as is
+	 */
+	const uint8_t *get_pipeline_cache_data() const;
+
+	size_t get_pipeline_cache_size() const;
+
+  private:
+	fs::MappedFile file;
+
+	const ResourceCacheFileHeader *header{nullptr};
+
+	const uint64_t *entry_offsets{nullptr};
+};
+}        // namespace vkb
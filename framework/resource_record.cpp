@@ -37,6 +37,11 @@ inline void write_subpass_info(std::ostringstream &os, const std::vector<Subpass
 	{
 		write(os, item.input_attachments);
 		write(os, item.output_attachments);
+		write(os, item.color_resolve_attachments);
+		write(os, item.rasterization_order_access);
+		write(os, item.shading_rate_attachment);
+		write(os, item.shading_rate_texel_size);
+		write(os, item.view_mask);
 	}
 }
 
@@ -52,11 +57,18 @@ inline void write_processes(std::ostringstream &os, const std::vector<std::strin
 
 void ResourceRecord::set_data(const std::vector<uint8_t> &data)
 {
+	std::lock_guard<std::mutex> guard(mutex);
+
 	stream.str(std::string{data.begin(), data.end()});
+
+	// Entries are registered again while the data is replayed
+	entry_offsets.clear();
 }
 
 std::vector<uint8_t> ResourceRecord::get_data()
 {
+	std::lock_guard<std::mutex> guard(mutex);
+
 	std::string str = stream.str();
 
 	return std::vector<uint8_t>{str.begin(), str.end()};
@@ -67,8 +79,19 @@ const std::ostringstream &ResourceRecord::get_stream()
 	return stream;
 }
 
+std::vector<size_t> ResourceRecord::get_entry_offsets()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	return entry_offsets;
+}
+
 size_t ResourceRecord::register_shader_module(VkShaderStageFlagBits stage, const ShaderSource &glsl_source, const std::string &entry_point, const ShaderVariant &shader_variant)
 {
+	std::lock_guard<std::mutex> guard(mutex);
+
+	entry_offsets.push_back(static_cast<size_t>(stream.tellp()));
+
 	shader_module_indices.push_back(shader_module_indices.size());
 
 	write(stream, ResourceType::ShaderModule, stage, glsl_source.get_data(), entry_point, shader_variant.get_preamble());
@@ -80,6 +103,10 @@ size_t ResourceRecord::register_shader_module(VkShaderStageFlagBits stage, const
 
 size_t ResourceRecord::register_pipeline_layout(const std::vector<ShaderModule *> &shader_modules, bool use_dynamic_resources)
 {
+	std::lock_guard<std::mutex> guard(mutex);
+
+	entry_offsets.push_back(static_cast<size_t>(stream.tellp()));
+
 	pipeline_layout_indices.push_back(pipeline_layout_indices.size());
 
 	std::vector<size_t> shader_indices(shader_modules.size());
@@ -95,6 +122,10 @@ size_t ResourceRecord::register_pipeline_layout(const std::vector<ShaderModule *
 
 size_t ResourceRecord::register_render_pass(const std::vector<Attachment> &attachments, const std::vector<LoadStoreInfo> &load_store_infos, const std::vector<SubpassInfo> &subpasses)
 {
+	std::lock_guard<std::mutex> guard(mutex);
+
+	entry_offsets.push_back(static_cast<size_t>(stream.tellp()));
+
 	render_pass_indices.push_back(render_pass_indices.size());
 
 	write(stream,
@@ -109,6 +140,10 @@ size_t ResourceRecord::register_render_pass(const std::vector<Attachment> &attac
 
 size_t ResourceRecord::register_graphics_pipeline(VkPipelineCache /*pipeline_cache*/, PipelineState &pipeline_state)
 {
+	std::lock_guard<std::mutex> guard(mutex);
+
+	entry_offsets.push_back(static_cast<size_t>(stream.tellp()));
+
 	graphics_pipeline_indices.push_back(graphics_pipeline_indices.size());
 
 	auto &pipeline_layout = pipeline_state.get_pipeline_layout();
@@ -145,27 +180,55 @@ size_t ResourceRecord::register_graphics_pipeline(VkPipelineCache /*pipeline_cac
 	      color_blend_state.logic_op_enable,
 	      color_blend_state.attachments);
 
+	write(stream,
+	      pipeline_state.get_fragment_shading_rate_state());
+
+	write(stream,
+	      pipeline_state.has_extended_dynamic_state());
+
 	return graphics_pipeline_indices.back();
 }
 
 void ResourceRecord::set_shader_module(size_t index, const ShaderModule &shader_module)
 {
+	std::lock_guard<std::mutex> guard(mutex);
+
 	shader_module_to_index[&shader_module] = index;
 }
 
 void ResourceRecord::set_pipeline_layout(size_t index, const PipelineLayout &pipeline_layout)
 {
+	std::lock_guard<std::mutex> guard(mutex);
+
 	pipeline_layout_to_index[&pipeline_layout] = index;
 }
 
 void ResourceRecord::set_render_pass(size_t index, const RenderPass &render_pass)
 {
+	std::lock_guard<std::mutex> guard(mutex);
+
 	render_pass_to_index[&render_pass] = index;
 }
 
 void ResourceRecord::set_graphics_pipeline(size_t index, const GraphicsPipeline &graphics_pipeline)
 {
+	std::lock_guard<std::mutex> guard(mutex);
+
 	graphics_pipeline_to_index[&graphics_pipeline] = index;
 }
 
+void ResourceRecord::remove_graphics_pipeline(const GraphicsPipeline &graphics_pipeline)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	graphics_pipeline_to_index.erase(&graphics_pipeline);
+}
+
+void ResourceRecord::clear_graphics_pipelines()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	graphics_pipeline_to_index.clear();
+}
+
 }        // namespace vkb
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <mutex>
 #include <vector>
 
 #include "rendering/pipeline_state.h"
@@ -41,6 +42,7 @@ enum class ResourceType
 
 /**
  * @brief Writes Vulkan objects in a memory stream.
+ *        Resources can be registered from multiple threads at once.
  */
 class ResourceRecord
 {
@@ -51,6 +53,11 @@ class ResourceRecord
 
 	const std::ostringstream &get_stream();
 
+	/**
+	 * @brief Offsets in the stream of each recorded entry, in recording order
+	 */
+	std::vector<size_t> get_entry_offsets();
+
 	size_t register_shader_module(VkShaderStageFlagBits stage, const ShaderSource &glsl_source, const std::string &entry_point, const ShaderVariant &shader_variant);
 
 	size_t register_pipeline_layout(const std::vector<ShaderModule *> &shader_modules,
@@ -71,9 +78,23 @@ class ResourceRecord
 
 	void set_graphics_pipeline(size_t index, const GraphicsPipeline &graphics_pipeline);
 
+	/**
+	 * @brief Forgets a graphics pipeline evicted from the cache, its entry is kept for the next warm start
+	 */
+	void remove_graphics_pipeline(const GraphicsPipeline &graphics_pipeline);
+
+	/**
+	 * @brief Forgets all the graphics pipelines, their entries are kept for the next warm start
+	 */
+	void clear_graphics_pipelines();
+
   private:
+	std::mutex mutex;
+
 	std::ostringstream stream;
 
+	std::vector<size_t> entry_offsets;
+
 	std::vector<size_t> shader_module_indices;
 
 	std::vector<size_t> pipeline_layout_indices;
@@ -20,16 +20,19 @@
 
 #include "resource_replay.h"
 
+#include <ctpl_stl.h>
+
 #include "common/logging.h"
 #include "common/vk_common.h"
 #include "rendering/pipeline_state.h"
 #include "resource_cache.h"
+#include "resource_cache_file.h"
 
 namespace vkb
 {
 namespace
 {
-inline void read_subpass_info(std::istringstream &is, std::vector<SubpassInfo> &value)
+inline void read_subpass_info(std::istream &is, std::vector<SubpassInfo> &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -38,10 +41,15 @@ inline void read_subpass_info(std::istringstream &is, std::vector<SubpassInfo> &
 	{
 		read(is, subpass.input_attachments);
 		read(is, subpass.output_attachments);
+		read(is, subpass.color_resolve_attachments);
+		read(is, subpass.rasterization_order_access);
+		read(is, subpass.shading_rate_attachment);
+		read(is, subpass.shading_rate_texel_size);
+		read(is, subpass.view_mask);
 	}
 }
 
-inline void read_processes(std::istringstream &is, std::vector<std::string> &value)
+inline void read_processes(std::istream &is, std::vector<std::string> &value)
 {
 	std::size_t size;
 	read(is, size);
@@ -51,6 +59,39 @@ inline void read_processes(std::istringstream &is, std::vector<std::string> &val
 		read(is, item);
 	}
 }
+
+/**
+ * @brief Resources only depend on resources of a lower level
+ */
+inline uint32_t get_dependency_level(ResourceType resource_type)
+{
+	switch (resource_type)
+	{
+		case ResourceType::ShaderModule:
+		case ResourceType::RenderPass:
+			return 0;
+		case ResourceType::PipelineLayout:
+			return 1;
+		case ResourceType::GraphicsPipeline:
+			return 2;
+		default:
+			return 0;
+	}
+}
+
+/**
+ * @brief Reads serialized data in place, such as an entry of a memory mapped file
+ */
+class MemoryStreamBuffer : public std::streambuf
+{
+  public:
+	MemoryStreamBuffer(const uint8_t *data, size_t size)
+	{
+		// The buffer is only read from
+		auto begin = reinterpret_cast<char *>(const_cast<uint8_t *>(data));
+		setg(begin, begin, begin + size);
+	}
+};
 }        // namespace
 
 ResourceReplay::ResourceReplay()
@@ -61,38 +102,111 @@ ResourceReplay::ResourceReplay()
 	stream_resources[ResourceType::GraphicsPipeline] = std::bind(&ResourceReplay::create_graphics_pipeline, this, std::placeholders::_1, std::placeholders::_2);
 }
 
+ResourceReplay::~ResourceReplay() = default;
+
 void ResourceReplay::play(ResourceCache &resource_cache, ResourceRecord &recorder)
 {
 	std::istringstream stream{recorder.get_stream().str()};
 
-	while (true)
+	begin_replay();
+
+	while (play_resource(resource_cache, stream))
 	{
-		// Read command id
-		ResourceType resource_type;
-		read(stream, resource_type);
+	}
 
-		if (stream.eof())
-		{
-			break;
-		}
+	end_replay();
+}
 
-		// Find command function for the given command id
-		auto cmd_it = stream_resources.find(resource_type);
+void ResourceReplay::play(ResourceCache &resource_cache, const ResourceCacheFile &cache_file)
+{
+	begin_replay();
 
-		// Check if command replayer supports the given command
-		if (cmd_it != stream_resources.end())
-		{
-			// Run command function
-			cmd_it->second(resource_cache, stream);
-		}
-		else
+	for (uint32_t i = 0; i < cache_file.get_entry_count(); ++i)
+	{
+		size_t size{0};
+		auto   data = cache_file.get_entry(i, size);
+
+		MemoryStreamBuffer buffer{data, size};
+		std::istream       stream{&buffer};
+
+		play_resource(resource_cache, stream);
+	}
+
+	end_replay();
+}
+
+void ResourceReplay::begin_replay()
+{
+	auto thread_count = std::thread::hardware_concurrency();
+	thread_count      = thread_count == 0 ? 1 : thread_count;
+	thread_pool       = std::make_unique<ctpl::thread_pool>(thread_count);
+
+	current_level = 0;
+
+	// The indices of the entries are relative to the record being played
+	shader_modules.clear();
+	pipeline_layouts.clear();
+	render_passes.clear();
+	graphics_pipelines.clear();
+}
+
+bool ResourceReplay::play_resource(ResourceCache &resource_cache, std::istream &stream)
+{
+	// Read command id
+	ResourceType resource_type;
+	read(stream, resource_type);
+
+	if (stream.eof())
+	{
+		return false;
+	}
+
+	// Find command function for the given command id
+	auto cmd_it = stream_resources.find(resource_type);
+
+	// Check if command replayer supports the given command
+	if (cmd_it != stream_resources.end())
+	{
+		// Moving up a level, the resources it depends on must be ready
+		auto level = get_dependency_level(resource_type);
+
+		if (level > current_level)
 		{
-			LOGE("Replay command not supported.");
+			wait_pending_resources();
 		}
+
+		current_level = level;
+
+		// Run command function
+		cmd_it->second(resource_cache, stream);
+	}
+	else
+	{
+		LOGE("Replay command not supported.");
 	}
+
+	return true;
 }
 
-void ResourceReplay::create_shader_module(ResourceCache &resource_cache, std::istringstream &stream)
+void ResourceReplay::end_replay()
+{
+	wait_pending_resources();
+
+	thread_pool.reset();
+}
+
+void ResourceReplay::wait_pending_resources()
+{
+	for (auto &pending : pending_resources)
+	{
+		// Rethrows any error raised while building the resource
+		pending.get();
+	}
+
+	pending_resources.clear();
+}
+
+void ResourceReplay::create_shader_module(ResourceCache &resource_cache, std::istream &stream)
 {
 	VkShaderStageFlagBits    stage{};
 	std::vector<uint8_t>     glsl_code;
@@ -111,12 +225,15 @@ void ResourceReplay::create_shader_module(ResourceCache &resource_cache, std::is
 	ShaderSource  shader_source(std::move(glsl_code));
 	ShaderVariant shader_variant(std::move(preamble), std::move(processes));
 
-	auto &shader_module = resource_cache.request_shader_module(stage, shader_source, shader_variant);
+	shader_modules.push_back(nullptr);
+	auto slot = &shader_modules.back();
 
-	shader_modules.push_back(&shader_module);
+	pending_resources.push_back(thread_pool->push([&resource_cache, stage, shader_source, shader_variant, slot](size_t) {
+		*slot = &resource_cache.request_shader_module(stage, shader_source, shader_variant);
+	}));
 }
 
-void ResourceReplay::create_pipeline_layout(ResourceCache &resource_cache, std::istringstream &stream)
+void ResourceReplay::create_pipeline_layout(ResourceCache &resource_cache, std::istream &stream)
 {
 	std::vector<size_t> shader_indices;
 	bool                use_dynamic_resources;
@@ -128,12 +245,16 @@ void ResourceReplay::create_pipeline_layout(ResourceCache &resource_cache, std::
 	std::vector<ShaderModule *> shader_stages(shader_indices.size());
 	std::transform(shader_indices.begin(), shader_indices.end(), shader_stages.begin(),
 	               [&](size_t shader_index) { return shader_modules.at(shader_index); });
-	auto &pipeline_layout = resource_cache.request_pipeline_layout(shader_stages, use_dynamic_resources);
 
-	pipeline_layouts.push_back(&pipeline_layout);
+	pipeline_layouts.push_back(nullptr);
+	auto slot = &pipeline_layouts.back();
+
+	pending_resources.push_back(thread_pool->push([&resource_cache, shader_stages, use_dynamic_resources, slot](size_t) {
+		*slot = &resource_cache.request_pipeline_layout(shader_stages, use_dynamic_resources);
+	}));
 }
 
-void ResourceReplay::create_render_pass(ResourceCache &resource_cache, std::istringstream &stream)
+void ResourceReplay::create_render_pass(ResourceCache &resource_cache, std::istream &stream)
 {
 	std::vector<Attachment>    attachments;
 	std::vector<LoadStoreInfo> load_store_infos;
@@ -145,12 +266,15 @@ void ResourceReplay::create_render_pass(ResourceCache &resource_cache, std::istr
 
 	read_subpass_info(stream, subpasses);
 
-	auto &render_pass = resource_cache.request_render_pass(attachments, load_store_infos, subpasses);
+	render_passes.push_back(nullptr);
+	auto slot = &render_passes.back();
 
-	render_passes.push_back(&render_pass);
+	pending_resources.push_back(thread_pool->push([&resource_cache, attachments, load_store_infos, subpasses, slot](size_t) {
+		*slot = &resource_cache.request_render_pass(attachments, load_store_infos, subpasses);
+	}));
 }
 
-void ResourceReplay::create_graphics_pipeline(ResourceCache &resource_cache, std::istringstream &stream)
+void ResourceReplay::create_graphics_pipeline(ResourceCache &resource_cache, std::istream &stream)
 {
 	size_t   pipeline_layout_index{};
 	size_t   render_pass_index{};
@@ -191,7 +315,18 @@ void ResourceReplay::create_graphics_pipeline(ResourceCache &resource_cache, std
 	     color_blend_state.logic_op_enable,
 	     color_blend_state.attachments);
 
+	FragmentShadingRateState fragment_shading_rate_state{};
+
+	read(stream,
+	     fragment_shading_rate_state);
+
+	bool extended_dynamic_state{false};
+
+	read(stream,
+	     extended_dynamic_state);
+
 	PipelineState pipeline_state{};
+	pipeline_state.set_extended_dynamic_state(extended_dynamic_state);
 	pipeline_state.set_pipeline_layout(*pipeline_layouts.at(pipeline_layout_index));
 	pipeline_state.set_render_pass(*render_passes.at(render_pass_index));
 
@@ -208,9 +343,13 @@ void ResourceReplay::create_graphics_pipeline(ResourceCache &resource_cache, std
 	pipeline_state.set_multisample_state(multisample_state);
 	pipeline_state.set_depth_stencil_state(depth_stencil_state);
 	pipeline_state.set_color_blend_state(color_blend_state);
+	pipeline_state.set_fragment_shading_rate_state(fragment_shading_rate_state);
 
-	auto &graphics_pipeline = resource_cache.request_graphics_pipeline(pipeline_state);
+	graphics_pipelines.push_back(nullptr);
+	auto slot = &graphics_pipelines.back();
 
-	graphics_pipelines.push_back(&graphics_pipeline);
+	pending_resources.push_back(thread_pool->push([&resource_cache, pipeline_state, slot](size_t) mutable {
+		*slot = &resource_cache.request_graphics_pipeline(pipeline_state);
+	}));
 }
 }        // namespace vkb
@@ -20,42 +20,84 @@
 
 #pragma once
 
+#include <deque>
+#include <future>
+
 #include "resource_record.h"
 
+namespace ctpl
+{
+class thread_pool;
+}
+
 namespace vkb
 {
 class ResourceCache;
+class ResourceCacheFile;
 
 /**
  * @brief Reads Vulkan objects from a memory stream and creates them in the resource cache.
+ *        Resources are built on a thread pool, one dependency level at a time: shader modules
+ *        and render passes first, then pipeline layouts, then graphics pipelines.
  */
 class ResourceReplay
 {
   public:
 	ResourceReplay();
 
+	~ResourceReplay();
+
 	void play(ResourceCache &resource_cache, ResourceRecord &recorder);
 
+	/**
+	 * @brief Replays the entries of a resource cache file one by one, reading them in place
+	 *        from the mapped file through its offset table
+	 */
+	void play(ResourceCache &resource_cache, const ResourceCacheFile &cache_file);
+
   protected:
-	void create_shader_module(ResourceCache &resource_cache, std::istringstream &stream);
+	void create_shader_module(ResourceCache &resource_cache, std::istream &stream);
 
-	void create_pipeline_layout(ResourceCache &resource_cache, std::istringstream &stream);
+	void create_pipeline_layout(ResourceCache &resource_cache, std::istream &stream);
 
-	void create_render_pass(ResourceCache &resource_cache, std::istringstream &stream);
+	void create_render_pass(ResourceCache &resource_cache, std::istream &stream);
 
-	void create_graphics_pipeline(ResourceCache &resource_cache, std::istringstream &stream);
+	void create_graphics_pipeline(ResourceCache &resource_cache, std::istream &stream);
 
   private:
-	using ResourceFunc = std::function<void(ResourceCache &, std::istringstream &)>;
+	using ResourceFunc = std::function<void(ResourceCache &, std::istream &)>;
+
+	void begin_replay();
+
+	/**
+	 * @brief Reads a single resource from the stream and queues it on the thread pool
+	 * @return Whether a resource was read, false at the end of the stream
+	 */
+	bool play_resource(ResourceCache &resource_cache, std::istream &stream);
+
+	void end_replay();
+
+	/**
+	 * @brief Waits for all the resources queued on the thread pool to be built
+	 */
+	void wait_pending_resources();
 
 	std::unordered_map<ResourceType, ResourceFunc> stream_resources;
 
-	std::vector<ShaderModule *> shader_modules;
+	std::unique_ptr<ctpl::thread_pool> thread_pool;
+
+	std::vector<std::future<void>> pending_resources;
+
+	uint32_t current_level{0};
+
+	// Deques so that the slots filled by the thread pool are not moved by later insertions
+
+	std::deque<ShaderModule *> shader_modules;
 
-	std::vector<PipelineLayout *> pipeline_layouts;
+	std::deque<PipelineLayout *> pipeline_layouts;
 
-	std::vector<const RenderPass *> render_passes;
+	std::deque<const RenderPass *> render_passes;
 
-	std::vector<const GraphicsPipeline *> graphics_pipelines;
+	std::deque<const GraphicsPipeline *> graphics_pipelines;
 };
 }        // namespace vkb
@@ -0,0 +1,783 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "scene_cache.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "common/helpers.h"
+#include "common/logging.h"
+#include "core/device.h"
+#include "platform/filesystem.h"
+
+namespace vkb
+{
+namespace
+{
+const uint32_t MAGIC = 0x45435353;
+
+const uint32_t VERSION = 1;
+
+/// Keeps the keys of the packages apart from those of the scene caches
+const uint64_t PACKAGE_SEED = 0x4b50534b56;
+
+/**
+ * @brief Appends plain data, strings and arrays of plain data to a byte array
+ */
+class Writer
+{
+  public:
+	template <class T>
+	void write(const T &value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be written directly");
+		write_bytes(&value, sizeof(T));
+	}
+
+	template <class T>
+	void write_array(const std::vector<T> &values)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only arrays of plain data can be written directly");
+		write<uint64_t>(values.size());
+		write_bytes(values.data(), values.size() * sizeof(T));
+	}
+
+	void write_string(const std::string &value)
+	{
+		write<uint64_t>(value.size());
+		write_bytes(value.data(), value.size());
+	}
+
+	void write_strings(const std::vector<std::string> &values)
+	{
+		write<uint64_t>(values.size());
+		for (auto &value : values)
+		{
+			write_string(value);
+		}
+	}
+
+	std::vector<uint8_t> &get_data()
+	{
+		return data;
+	}
+
+  private:
+	void write_bytes(const void *src, size_t size)
+	{
+		auto bytes = reinterpret_cast<const uint8_t *>(src);
+		data.insert(data.end(), bytes, bytes + size);
+	}
+
+	std::vector<uint8_t> data;
+};
+
+/**
+ * @brief Reads what Writer wrote, throws if the data is truncated
+ */
+class Reader
+{
+  public:
+	Reader(const uint8_t *data, size_t size) :
+	    data{data},
+	    size{size}
+	{
+	}
+
+	template <class T>
+	T read()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be read directly");
+		T value;
+		read_bytes(&value, sizeof(T));
+		return value;
+	}
+
+	template <class T>
+	std::vector<T> read_array()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only arrays of plain data can be read directly");
+		auto           count = read_count(sizeof(T));
+		std::vector<T> values(count);
+		read_bytes(values.data(), count * sizeof(T));
+		return values;
+	}
+
+	std::string read_string()
+	{
+		auto        count = read_count(1);
+		std::string value(count, '\0');
+		read_bytes(&value[0], count);
+		return value;
+	}
+
+	std::vector<std::string> read_strings()
+	{
+		auto                     count = read_count(1);
+		std::vector<std::string> values(count);
+		for (auto &value : values)
+		{
+			value = read_string();
+		}
+		return values;
+	}
+
+	/**
+	 * @brief Reads a number of elements, checking that they can fit in the remaining data
+	 */
+	size_t read_count(size_t element_size)
+	{
+		auto count = read<uint64_t>();
+
+		if (element_size > 0 && count > (size - offset) / element_size)
+		{
+			throw std::runtime_error{"Scene cache is truncated"};
+		}
+
+		return static_cast<size_t>(count);
+	}
+
+  private:
+	void read_bytes(void *dst, size_t count)
+	{
+		if (count > size - offset)
+		{
+			throw std::runtime_error{"Scene cache is truncated"};
+		}
+
+		if (count > 0)
+		{
+			std::memcpy(dst, data + offset, count);
+		}
+
+		offset += count;
+	}
+
+	const uint8_t *data{nullptr};
+
+	size_t size{0};
+
+	size_t offset{0};
+};
+
+enum class ValueType : uint8_t
+{
+	Null,
+	Bool,
+	Int,
+	Real,
+	String,
+	Binary,
+	Array,
+	Object
+};
+
+void write_value(Writer &writer, const tinygltf::Value &value)
+{
+	if (value.IsBool())
+	{
+		writer.write(ValueType::Bool);
+		writer.write(value.Get<bool>());
+	}
+	else if (value.IsInt())
+	{
+		writer.write(ValueType::Int);
+		writer.write(value.Get<int>());
+	}
+	else if (value.IsNumber())
+	{
+		writer.write(ValueType::Real);
+		writer.write(value.Get<double>());
+	}
+	else if (value.IsString())
+	{
+		writer.write(ValueType::String);
+		writer.write_string(value.Get<std::string>());
+	}
+	else if (value.IsBinary())
+	{
+		writer.write(ValueType::Binary);
+		writer.write_array(value.Get<std::vector<unsigned char>>());
+	}
+	else if (value.IsArray())
+	{
+		writer.write(ValueType::Array);
+		writer.write<uint64_t>(value.ArrayLen());
+		for (size_t i = 0; i < value.ArrayLen(); i++)
+		{
+			write_value(writer, value.Get(static_cast<int>(i)));
+		}
+	}
+	else if (value.IsObject())
+	{
+		auto keys = value.Keys();
+
+		writer.write(ValueType::Object);
+		writer.write<uint64_t>(keys.size());
+		for (auto &key : keys)
+		{
+			writer.write_string(key);
+			write_value(writer, value.Get(key));
+		}
+	}
+	else
+	{
+		writer.write(ValueType::Null);
+	}
+}
+
+tinygltf::Value read_value(Reader &reader)
+{
+	switch (reader.read<ValueType>())
+	{
+		case ValueType::Null:
+			return tinygltf::Value{};
+		case ValueType::Bool:
+			return tinygltf::Value{reader.read<bool>()};
+		case ValueType::Int:
+			return tinygltf::Value{reader.read<int>()};
+		case ValueType::Real:
+			return tinygltf::Value{reader.read<double>()};
+		case ValueType::String:
+			return tinygltf::Value{reader.read_string()};
+		case ValueType::Binary:
+		{
+			auto binary = reader.read_array<unsigned char>();
+			return tinygltf::Value{binary.data(), binary.size()};
+		}
+		case ValueType::Array:
+		{
+			tinygltf::Value::Array array(reader.read_count(1));
+			for (auto &element : array)
+			{
+				element = read_value(reader);
+			}
+			return tinygltf::Value{array};
+		}
+		case ValueType::Object:
+		{
+			tinygltf::Value::Object object;
+			auto                    count = reader.read_count(1);
+			for (size_t i = 0; i < count; i++)
+			{
+				auto key    = reader.read_string();
+				object[key] = read_value(reader);
+			}
+			return tinygltf::Value{object};
+		}
+		default:
+			throw std::runtime_error{"Scene cache has an invalid value"};
+	}
+}
+
+void write_extensions(Writer &writer, const tinygltf::ExtensionMap &extensions)
+{
+	writer.write<uint64_t>(extensions.size());
+	for (auto &extension : extensions)
+	{
+		writer.write_string(extension.first);
+		write_value(writer, extension.second);
+	}
+}
+
+tinygltf::ExtensionMap read_extensions(Reader &reader)
+{
+	tinygltf::ExtensionMap extensions;
+
+	auto count = reader.read_count(1);
+	for (size_t i = 0; i < count; i++)
+	{
+		auto name        = reader.read_string();
+		extensions[name] = read_value(reader);
+	}
+
+	return extensions;
+}
+
+void write_parameters(Writer &writer, const tinygltf::ParameterMap &parameters)
+{
+	writer.write<uint64_t>(parameters.size());
+	for (auto &parameter : parameters)
+	{
+		writer.write_string(parameter.first);
+		writer.write(parameter.second.bool_value);
+		writer.write(parameter.second.has_number_value);
+		writer.write_string(parameter.second.string_value);
+		writer.write_array(parameter.second.number_array);
+		writer.write(parameter.second.number_value);
+
+		writer.write<uint64_t>(parameter.second.json_double_value.size());
+		for (auto &json_value : parameter.second.json_double_value)
+		{
+			writer.write_string(json_value.first);
+			writer.write(json_value.second);
+		}
+	}
+}
+
+tinygltf::ParameterMap read_parameters(Reader &reader)
+{
+	tinygltf::ParameterMap parameters;
+
+	auto count = reader.read_count(1);
+	for (size_t i = 0; i < count; i++)
+	{
+		auto &parameter = parameters[reader.read_string()];
+
+		parameter.bool_value       = reader.read<bool>();
+		parameter.has_number_value = reader.read<bool>();
+		parameter.string_value     = reader.read_string();
+		parameter.number_array     = reader.read_array<double>();
+		parameter.number_value     = reader.read<double>();
+
+		auto json_value_count = reader.read_count(1);
+		for (size_t j = 0; j < json_value_count; j++)
+		{
+			auto name                          = reader.read_string();
+			parameter.json_double_value[name] = reader.read<double>();
+		}
+	}
+
+	return parameters;
+}
+
+void write_model(Writer &writer, const tinygltf::Model &model)
+{
+	writer.write_strings(model.extensionsUsed);
+	writer.write_strings(model.extensionsRequired);
+	write_extensions(writer, model.extensions);
+	writer.write(model.defaultScene);
+
+	writer.write<uint64_t>(model.accessors.size());
+	for (auto &accessor : model.accessors)
+	{
+		writer.write(accessor.bufferView);
+		writer.write<uint64_t>(accessor.byteOffset);
+		writer.write(accessor.normalized);
+		writer.write(accessor.componentType);
+		writer.write<uint64_t>(accessor.count);
+		writer.write(accessor.type);
+	}
+
+	writer.write<uint64_t>(model.bufferViews.size());
+	for (auto &buffer_view : model.bufferViews)
+	{
+		writer.write(buffer_view.buffer);
+		writer.write<uint64_t>(buffer_view.byteOffset);
+		writer.write<uint64_t>(buffer_view.byteLength);
+		writer.write<uint64_t>(buffer_view.byteStride);
+		writer.write(buffer_view.target);
+	}
+
+	writer.write<uint64_t>(model.buffers.size());
+	for (auto &buffer : model.buffers)
+	{
+		writer.write_array(buffer.data);
+	}
+
+	writer.write<uint64_t>(model.images.size());
+	for (auto &image : model.images)
+	{
+		writer.write_string(image.name);
+		writer.write_string(image.uri);
+		writer.write(image.width);
+		writer.write(image.height);
+	}
+
+	writer.write<uint64_t>(model.samplers.size());
+	for (auto &sampler : model.samplers)
+	{
+		writer.write_string(sampler.name);
+		writer.write(sampler.minFilter);
+		writer.write(sampler.magFilter);
+		writer.write(sampler.wrapS);
+		writer.write(sampler.wrapT);
+		writer.write(sampler.wrapR);
+	}
+
+	writer.write<uint64_t>(model.textures.size());
+	for (auto &texture : model.textures)
+	{
+		writer.write_string(texture.name);
+		writer.write(texture.sampler);
+		writer.write(texture.source);
+	}
+
+	writer.write<uint64_t>(model.materials.size());
+	for (auto &material : model.materials)
+	{
+		writer.write_string(material.name);
+		write_parameters(writer, material.values);
+		write_parameters(writer, material.additionalValues);
+	}
+
+	writer.write<uint64_t>(model.meshes.size());
+	for (auto &mesh : model.meshes)
+	{
+		writer.write_string(mesh.name);
+
+		writer.write<uint64_t>(mesh.primitives.size());
+		for (auto &primitive : mesh.primitives)
+		{
+			writer.write<uint64_t>(primitive.attributes.size());
+			for (auto &attribute : primitive.attributes)
+			{
+				writer.write_string(attribute.first);
+				writer.write(attribute.second);
+			}
+
+			writer.write(primitive.material);
+			writer.write(primitive.indices);
+			writer.write(primitive.mode);
+		}
+	}
+
+	writer.write<uint64_t>(model.nodes.size());
+	for (auto &node : model.nodes)
+	{
+		writer.write_string(node.name);
+		writer.write(node.camera);
+		writer.write(node.mesh);
+		writer.write_array(node.children);
+		writer.write_array(node.translation);
+		writer.write_array(node.rotation);
+		writer.write_array(node.scale);
+		writer.write_array(node.matrix);
+		write_extensions(writer, node.extensions);
+	}
+
+	writer.write<uint64_t>(model.cameras.size());
+	for (auto &camera : model.cameras)
+	{
+		writer.write_string(camera.name);
+		writer.write_string(camera.type);
+		writer.write(camera.perspective.aspectRatio);
+		writer.write(camera.perspective.yfov);
+		writer.write(camera.perspective.znear);
+		writer.write(camera.perspective.zfar);
+	}
+
+	writer.write<uint64_t>(model.scenes.size());
+	for (auto &scene : model.scenes)
+	{
+		writer.write_string(scene.name);
+		writer.write_array(scene.nodes);
+	}
+}
+
+void read_model(Reader &reader, tinygltf::Model &model)
+{
+	model.extensionsUsed     = reader.read_strings();
+	model.extensionsRequired = reader.read_strings();
+	model.extensions         = read_extensions(reader);
+	model.defaultScene       = reader.read<int>();
+
+	model.accessors.resize(reader.read_count(1));
+	for (auto &accessor : model.accessors)
+	{
+		accessor.bufferView    = reader.read<int>();
+		accessor.byteOffset    = static_cast<size_t>(reader.read<uint64_t>());
+		accessor.normalized    = reader.read<bool>();
+		accessor.componentType = reader.read<int>();
+		accessor.count         = static_cast<size_t>(reader.read<uint64_t>());
+		accessor.type          = reader.read<int>();
+	}
+
+	model.bufferViews.resize(reader.read_count(1));
+	for (auto &buffer_view : model.bufferViews)
+	{
+		buffer_view.buffer     = reader.read<int>();
+		buffer_view.byteOffset = static_cast<size_t>(reader.read<uint64_t>());
+		buffer_view.byteLength = static_cast<size_t>(reader.read<uint64_t>());
+		buffer_view.byteStride = static_cast<size_t>(reader.read<uint64_t>());
+		buffer_view.target     = reader.read<int>();
+	}
+
+	model.buffers.resize(reader.read_count(1));
+	for (auto &buffer : model.buffers)
+	{
+		buffer.data = reader.read_array<unsigned char>();
+	}
+
+	model.images.resize(reader.read_count(1));
+	for (auto &image : model.images)
+	{
+		image.name   = reader.read_string();
+		image.uri    = reader.read_string();
+		image.width  = reader.read<int>();
+		image.height = reader.read<int>();
+	}
+
+	model.samplers.resize(reader.read_count(1));
+	for (auto &sampler : model.samplers)
+	{
+		sampler.name      = reader.read_string();
+		sampler.minFilter = reader.read<int>();
+		sampler.magFilter = reader.read<int>();
+		sampler.wrapS     = reader.read<int>();
+		sampler.wrapT     = reader.read<int>();
+		sampler.wrapR     = reader.read<int>();
+	}
+
+	model.textures.resize(reader.read_count(1));
+	for (auto &texture : model.textures)
+	{
+		texture.name    = reader.read_string();
+		texture.sampler = reader.read<int>();
+		texture.source  = reader.read<int>();
+	}
+
+	model.materials.resize(reader.read_count(1));
+	for (auto &material : model.materials)
+	{
+		material.name             = reader.read_string();
+		material.values           = read_parameters(reader);
+		material.additionalValues = read_parameters(reader);
+	}
+
+	model.meshes.resize(reader.read_count(1));
+	for (auto &mesh : model.meshes)
+	{
+		mesh.name = reader.read_string();
+
+		mesh.primitives.resize(reader.read_count(1));
+		for (auto &primitive : mesh.primitives)
+		{
+			auto attribute_count = reader.read_count(1);
+			for (size_t i = 0; i < attribute_count; i++)
+			{
+				auto name                  = reader.read_string();
+				primitive.attributes[name] = reader.read<int>();
+			}
+
+			primitive.material = reader.read<int>();
+			primitive.indices  = reader.read<int>();
+			primitive.mode     = reader.read<int>();
+		}
+	}
+
+	model.nodes.resize(reader.read_count(1));
+	for (auto &node : model.nodes)
+	{
+		node.name        = reader.read_string();
+		node.camera      = reader.read<int>();
+		node.mesh        = reader.read<int>();
+		node.children    = reader.read_array<int>();
+		node.translation = reader.read_array<double>();
+		node.rotation    = reader.read_array<double>();
+		node.scale       = reader.read_array<double>();
+		node.matrix      = reader.read_array<double>();
+		node.extensions  = read_extensions(reader);
+	}
+
+	model.cameras.resize(reader.read_count(1));
+	for (auto &camera : model.cameras)
+	{
+		camera.name                    = reader.read_string();
+		camera.type                    = reader.read_string();
+		camera.perspective.aspectRatio = reader.read<double>();
+		camera.perspective.yfov        = reader.read<double>();
+		camera.perspective.znear       = reader.read<double>();
+		camera.perspective.zfar        = reader.read<double>();
+	}
+
+	model.scenes.resize(reader.read_count(1));
+	for (auto &scene : model.scenes)
+	{
+		scene.name  = reader.read_string();
+		scene.nodes = reader.read_array<int>();
+	}
+}
+
+/**
+ * @brief Reads a scene cache or package from its mapping
+ * @param filename The name of the file, for the messages
+ */
+bool read_scene(const fs::MappedFile &file, const std::string &filename, uint64_t key, tinygltf::Model &model, std::vector<CachedImage> &images)
+{
+	Reader reader{file.get_data(), file.get_size()};
+
+	try
+	{
+		if (reader.read<uint32_t>() != MAGIC || reader.read<uint32_t>() != VERSION || reader.read<uint64_t>() != key)
+		{
+			LOGI("Scene data {} is out of date, ignoring it", filename);
+			return false;
+		}
+
+		tinygltf::Model cached_model;
+		read_model(reader, cached_model);
+
+		std::vector<CachedImage> cached_images(reader.read_count(1));
+		for (auto &image : cached_images)
+		{
+			image.name       = reader.read_string();
+			image.format     = reader.read<VkFormat>();
+			image.mip_levels = reader.read<uint32_t>();
+			image.mipmaps    = reader.read_array<sg::Mipmap>();
+			image.data       = reader.read_array<uint8_t>();
+		}
+
+		if (cached_images.size() != cached_model.images.size())
+		{
+			throw std::runtime_error{"Scene data has an invalid image count"};
+		}
+
+		model  = std::move(cached_model);
+		images = std::move(cached_images);
+	}
+	catch (const std::runtime_error &e)
+	{
+		LOGW("Scene data {} is not valid, ignoring it: {}", filename, e.what());
+		return false;
+	}
+
+	return true;
+}
+
+std::vector<uint8_t> write_scene(uint64_t key, const tinygltf::Model &model, const std::vector<CachedImage> &images)
+{
+	Writer writer;
+
+	writer.write(MAGIC);
+	writer.write(VERSION);
+	writer.write(key);
+
+	write_model(writer, model);
+
+	writer.write<uint64_t>(images.size());
+	for (auto &image : images)
+	{
+		writer.write_string(image.name);
+		writer.write(image.format);
+		writer.write(image.mip_levels);
+		writer.write_array(image.mipmaps);
+		writer.write_array(image.data);
+	}
+
+	return std::move(writer.get_data());
+}
+}        // namespace
+
+uint64_t get_scene_cache_key(const uint8_t *gltf_data, size_t gltf_size, const Device &device)
+{
+	auto &properties = device.get_properties();
+
+	uint32_t device_data[3] = {properties.vendorID, properties.deviceID, properties.driverVersion};
+
+	return hash_bytes(gltf_data, gltf_size, hash_bytes(device_data, sizeof(device_data)));
+}
+
+bool read_scene_cache(const std::string &filename, uint64_t key, tinygltf::Model &model, std::vector<CachedImage> &images, JobSystem *job_system)
+{
+	fs::MappedFile file;
+
+	bool out_of_date = false;
+
+	// A cache of another version of the scene is discarded once its header is decompressed, rather than once all its images are
+	auto accept = [key, &out_of_date](const uint8_t *data, size_t size) {
+		const size_t header_size = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+
+		if (size < header_size)
+		{
+			return true;
+		}
+
+		uint32_t magic;
+		uint32_t version;
+		uint64_t cache_key;
+		std::memcpy(&magic, data, sizeof(magic));
+		std::memcpy(&version, data + sizeof(magic), sizeof(version));
+		std::memcpy(&cache_key, data + sizeof(magic) + sizeof(version), sizeof(cache_key));
+
+		out_of_date = magic != MAGIC || version != VERSION || cache_key != key;
+
+		return !out_of_date;
+	};
+
+	try
+	{
+		file = fs::map_temp_blob_if(filename, accept, job_system);
+	}
+	catch (const std::runtime_error &)
+	{
+		LOGI("No scene cache found at {}", filename);
+		return false;
+	}
+
+	if (out_of_date)
+	{
+		LOGI("Scene data {} is out of date, ignoring it", filename);
+		return false;
+	}
+
+	return read_scene(file, filename, key, model, images);
+}
+
+void write_scene_cache(const std::string &filename, uint64_t key, const tinygltf::Model &model, const std::vector<CachedImage> &images, JobSystem *job_system)
+{
+	try
+	{
+		fs::write_temp_blob(write_scene(key, model, images), filename, job_system);
+	}
+	catch (const std::runtime_error &e)
+	{
+		LOGW("Failed to write scene cache {}: {}", filename, e.what());
+		return;
+	}
+
+	LOGI("Saved scene cache to {}", filename);
+}
+
+std::string get_scene_package_filename(const std::string &gltf_filename)
+{
+	return gltf_filename + ".vkbpkg";
+}
+
+uint64_t get_scene_package_key(const uint8_t *gltf_data, size_t gltf_size)
+{
+	return hash_bytes(gltf_data, gltf_size, PACKAGE_SEED);
+}
+
+bool read_scene_package(const std::string &filename, uint64_t key, tinygltf::Model &model, std::vector<CachedImage> &images)
+{
+	fs::MappedFile file;
+
+	try
+	{
+		file = fs::map_asset(filename);
+	}
+	catch (const std::runtime_error &)
+	{
+		return false;
+	}
+
+	return read_scene(file, filename, key, model, images);
+}
+
+void write_scene_package(const std::string &filename, uint64_t key, const tinygltf::Model &model, const std::vector<CachedImage> &images)
+{
+	fs::write_asset(write_scene(key, model, images), filename);
+
+	LOGI("Saved scene package to {}", filename);
+}
+}        // namespace vkb
@@ -0,0 +1,113 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#include <tiny_gltf.h>
+
+#include "common/vk_common.h"
+#include "scene_graph/components/image.h"
+
+namespace vkb
+{
+class Device;
+class JobSystem;
+
+/**
+ * @brief An image as it is uploaded, after decoding, transcoding and CPU mipmap generation
+ */
+struct CachedImage
+{
+	std::string name;
+
+	VkFormat format{VK_FORMAT_UNDEFINED};
+
+	/// Levels of the Vulkan image, more than the data levels if the mip chain is generated on the GPU
+	uint32_t mip_levels{0};
+
+	std::vector<sg::Mipmap> mipmaps;
+
+	std::vector<uint8_t> data;
+};
+
+/**
+ * @brief Computes the key of the scene cache of a glTF file. Images are processed according to
+ *        the formats the device supports, so the device is part of the key
+ * @param gltf_data The content of the glTF file
+ * @param gltf_size The size of the glTF file
+ * @param device The device the scene is loaded for
+ */
+uint64_t get_scene_cache_key(const uint8_t *gltf_data, size_t gltf_size, const Device &device);
+
+/**
+ * @brief Reads a scene cache, which holds the parsed glTF model with its buffers and the processed images
+ * @param filename The path to the file (relative to the temporary storage directory)
+ * @param key The key the cache must have been written with
+ * @param model Receives the glTF model
+ * @param images Receives the images, in the order of the model images
+ * @param job_system (optional) Job system to decompress a compressed cache on
+ * @return True if the cache was found and is valid for the key
+ */
+bool read_scene_cache(const std::string &filename, uint64_t key, tinygltf::Model &model, std::vector<CachedImage> &images, JobSystem *job_system = nullptr);
+
+/**
+ * @brief Writes a scene cache, only the parts of the model which GLTFLoader uses are stored
+ * @param filename The path to the file (relative to the temporary storage directory)
+ * @param key The key of the cache, see get_scene_cache_key
+ * @param model The glTF model
+ * @param images The processed images, in the order of the model images
+ * @param job_system (optional) Job system to compress the cache on, see fs::set_temp_compression
+ */
+void write_scene_cache(const std::string &filename, uint64_t key, const tinygltf::Model &model, const std::vector<CachedImage> &images, JobSystem *job_system = nullptr);
+
+/**
+ * @return The path of the package cooked offline for a glTF file, next to it in the assets directory
+ */
+std::string get_scene_package_filename(const std::string &gltf_filename);
+
+/**
+ * @brief Computes the key of the package of a glTF file. Packages keep the images in the formats
+ *        of their files, so unlike the scene cache the key does not depend on the device
+ */
+uint64_t get_scene_package_key(const uint8_t *gltf_data, size_t gltf_size);
+
+/**
+ * @brief Reads a package written by vkb_asset_cooker, which has the layout of the scene cache
+ * @param filename The path to the package (relative to the assets directory)
+ * @param key The key the package must have been written with
+ * @param model Receives the glTF model
+ * @param images Receives the images, in the order of the model images
+ * @return True if the package was found and is valid for the key, a missing package is not reported
+ */
+bool read_scene_package(const std::string &filename, uint64_t key, tinygltf::Model &model, std::vector<CachedImage> &images);
+
+/**
+ * @brief Writes a package, see read_scene_package
+ * @param filename The path to the package (relative to the assets directory)
+ * @throws runtime_error if the file cannot be written
+ */
+void write_scene_package(const std::string &filename, uint64_t key, const tinygltf::Model &model, const std::vector<CachedImage> &images);
+}        // namespace vkb
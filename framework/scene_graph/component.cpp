@@ -21,6 +21,8 @@
 #include "component.h"
 
 #include <algorithm>
+#include <mutex>
+#include <unordered_map>
 
 #include "node.h"
 
@@ -36,5 +38,15 @@ const std::string &Component::get_name() const
 {
 	return name;
 }
+
+uint32_t get_component_type_id(const std::type_index &type)
+{
+	static std::mutex                                   mutex;
+	static std::unordered_map<std::type_index, uint32_t> ids;
+
+	std::lock_guard<std::mutex> lock{mutex};
+
+	return ids.emplace(type, static_cast<uint32_t>(ids.size())).first->second;
+}
 }        // namespace sg
 }        // namespace vkb
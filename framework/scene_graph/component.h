@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <typeindex>
@@ -50,5 +51,21 @@ class Component
   private:
 	std::string name;
 };
+
+/**
+ * @brief Returns a dense index for a component type, so that nodes can store their
+ *        components in an array instead of a hash map
+ */
+uint32_t get_component_type_id(const std::type_index &type);
+
+/**
+ * @brief Returns the dense index of a component type, looked up once per type
+ */
+template <class T>
+uint32_t get_component_type_id()
+{
+	static const uint32_t id = get_component_type_id(typeid(T));
+	return id;
+}
 }        // namespace sg
 }        // namespace vkb
@@ -0,0 +1,223 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace vkb
+{
+namespace sg
+{
+class Component;
+
+/**
+ * @brief A view of the components of one type stored in a scene, which casts them to the type
+ *        without copying them. It is valid until components of the type are added or set again
+ */
+template <class T>
+class ComponentRange
+{
+  public:
+	class Iterator
+	{
+	  public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type        = T *;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = T *const *;
+		using reference         = T *;
+
+		Iterator() = default;
+
+		explicit Iterator(const std::unique_ptr<Component> *component) :
+		    component{component}
+		{
+		}
+
+		T *operator*() const
+		{
+			return static_cast<T *>(component->get());
+		}
+
+		T *operator[](difference_type offset) const
+		{
+			return static_cast<T *>(component[offset].get());
+		}
+
+		Iterator &operator++()
+		{
+			++component;
+			return *this;
+		}
+
+		Iterator operator++(int)
+		{
+			Iterator result{*this};
+			++component;
+			return result;
+		}
+
+		Iterator &operator--()
+		{
+			--component;
+			return *this;
+		}
+
+		Iterator operator--(int)
+		{
+			Iterator result{*this};
+			--component;
+			return result;
+		}
+
+		Iterator &operator+=(difference_type offset)
+		{
+			component += offset;
+			return *this;
+		}
+
+		Iterator &operator-=(difference_type offset)
+		{
+			component -= offset;
+			return *this;
+		}
+
+		Iterator operator+(difference_type offset) const
+		{
+			return Iterator{component + offset};
+		}
+
+		Iterator operator-(difference_type offset) const
+		{
+			return Iterator{component - offset};
+		}
+
+		difference_type operator-(const Iterator &other) const
+		{
+			return component - other.component;
+		}
+
+		bool operator==(const Iterator &other) const
+		{
+			return component == other.component;
+		}
+
+		bool operator!=(const Iterator &other) const
+		{
+			return component != other.component;
+		}
+
+		bool operator<(const Iterator &other) const
+		{
+			return component < other.component;
+		}
+
+		bool operator>(const Iterator &other) const
+		{
+			return component > other.component;
+		}
+
+		bool operator<=(const Iterator &other) const
+		{
+			return component <= other.component;
+		}
+
+		bool operator>=(const Iterator &other) const
+		{
+			return component >= other.component;
+		}
+
+	  private:
+		const std::unique_ptr<Component> *component{nullptr};
+	};
+
+	ComponentRange() = default;
+
+	explicit ComponentRange(const std::vector<std::unique_ptr<Component>> &components) :
+	    first{components.data()},
+	    count{components.size()}
+	{
+	}
+
+	Iterator begin() const
+	{
+		return Iterator{first};
+	}
+
+	Iterator end() const
+	{
+		return Iterator{first + count};
+	}
+
+	size_t size() const
+	{
+		return count;
+	}
+
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	T *operator[](size_t index) const
+	{
+		return static_cast<T *>(first[index].get());
+	}
+
+	T *at(size_t index) const
+	{
+		if (index >= count)
+		{
+			throw std::out_of_range("Component index out of range");
+		}
+
+		return (*this)[index];
+	}
+
+	T *front() const
+	{
+		return at(0);
+	}
+
+	T *back() const
+	{
+		return at(count - 1);
+	}
+
+	/**
+	 * @brief Copies the pointers, for code which keeps them beyond the lifetime of the view
+	 */
+	std::vector<T *> to_vector() const
+	{
+		return std::vector<T *>(begin(), end());
+	}
+
+  private:
+	const std::unique_ptr<Component> *first{nullptr};
+
+	size_t count{0};
+};
+}        // namespace sg
+}        // namespace vkb
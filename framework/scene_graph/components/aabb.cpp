@@ -20,6 +20,13 @@
 
 #include "aabb.h"
 
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include <glm/gtc/packing.hpp>
+VKBP_ENABLE_WARNINGS()
+
+#include "common/helpers.h"
 #include "common/logging.h"
 
 namespace vkb
@@ -51,27 +58,49 @@ void AABB::update(const glm::vec3 &point)
 void AABB::update(SubMesh &submesh)
 {
 	// Find vertex position attribute of submesh
-	auto position_buffer = submesh.vertex_buffers.find("position");
+	auto position_buffer = submesh.get_vertex_buffer("position");
+
+	VertexAttribute position_attribute;
 
-	if (position_buffer == submesh.vertex_buffers.end())
+	if (!position_buffer || !submesh.get_attribute("position", position_attribute))
 	{
 		LOGW("Submesh {} has no vertex position attributes.", submesh.get_name());
 
 		return;
 	}
 
-	// Get buffer data of the vertex position
-	const glm::vec3 *vertices = reinterpret_cast<const glm::vec3 *>(position_buffer->second.map());
+	// Get buffer data of the vertex position, the buffer may be shared with other sub meshes
+	uint32_t stride = position_attribute.stride ? position_attribute.stride : to_u32(sizeof(glm::vec3));
+
+	const uint8_t *vertices = const_cast<core::Buffer *>(position_buffer)->map() + position_attribute.offset + submesh.vertex_offset * stride;
+
+	bool half_positions = position_attribute.format == VK_FORMAT_R16G16B16A16_SFLOAT;
+
+	auto get_vertex = [vertices, stride, half_positions](uint32_t index) {
+		if (half_positions)
+		{
+			return glm::vec3(glm::unpackHalf4x16(*reinterpret_cast<const uint64_t *>(vertices + index * stride)));
+		}
+
+		return *reinterpret_cast<const glm::vec3 *>(vertices + index * stride);
+	};
 
 	// Check if submesh is indexed
 	if (submesh.vertex_indices > 0)
 	{
-		const uint16_t *indices = reinterpret_cast<const uint16_t *>(submesh.index_buffer->map());
+		const uint8_t *index_data = const_cast<core::Buffer *>(submesh.get_index_buffer())->map() + submesh.index_offset;
 
 		// Update bounding box for each indexed vertex
-		for (uint32_t vertex_id = 0; vertex_id < submesh.vertex_indices; vertex_id++)
+		for (uint32_t index_id = submesh.first_index; index_id < submesh.first_index + submesh.vertex_indices; index_id++)
 		{
-			update(vertices[indices[vertex_id]]);
+			if (submesh.index_type == VK_INDEX_TYPE_UINT32)
+			{
+				update(get_vertex(reinterpret_cast<const uint32_t *>(index_data)[index_id]));
+			}
+			else
+			{
+				update(get_vertex(reinterpret_cast<const uint16_t *>(index_data)[index_id]));
+			}
 		}
 	}
 	else
@@ -79,23 +108,25 @@ void AABB::update(SubMesh &submesh)
 		// Update bounding box for each vertex
 		for (uint32_t vertex_id = 0; vertex_id < submesh.vertices_count; vertex_id++)
 		{
-			update(vertices[vertex_id]);
+			update(get_vertex(vertex_id));
 		}
 	}
 }
 
 void AABB::transform(glm::mat4 &transform)
 {
-	min = max = glm::vec4(min, 1.0f) * transform;
-
-	// Update bounding box for the remaining 7 corners of the box
-	update(glm::vec4(min.x, min.y, max.z, 1.0f) * transform);
-	update(glm::vec4(min.x, max.y, min.z, 1.0f) * transform);
-	update(glm::vec4(min.x, max.y, max.z, 1.0f) * transform);
-	update(glm::vec4(max.x, min.y, min.z, 1.0f) * transform);
-	update(glm::vec4(max.x, min.y, max.z, 1.0f) * transform);
-	update(glm::vec4(max.x, max.y, min.z, 1.0f) * transform);
-	update(glm::vec4(max, 1.0f) * transform);
+	glm::vec3 local_center  = get_center();
+	glm::vec3 local_extents = 0.5f * (max - min);
+
+	// Transform the center, and project the half extents on the world axes (Arvo), which is
+	// the same box as the one around the 8 transformed corners
+	glm::vec3 center  = glm::vec3(transform * glm::vec4(local_center, 1.0f));
+	glm::vec3 extents = glm::abs(glm::vec3(transform[0])) * local_extents.x +
+	                    glm::abs(glm::vec3(transform[1])) * local_extents.y +
+	                    glm::abs(glm::vec3(transform[2])) * local_extents.z;
+
+	min = center - extents;
+	max = center + extents;
 }
 
 glm::vec3 AABB::get_scale() const
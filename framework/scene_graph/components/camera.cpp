@@ -44,7 +44,7 @@ glm::mat4 Camera::get_view()
 	}
 
 	auto &transform = node->get_component<Transform>();
-	return pre_rotation * glm::inverse(transform.get_world_matrix());
+	return pre_rotation * glm::inverse(transform.get_render_state().world_matrix);
 }
 
 void Camera::set_node(Node &n)
@@ -0,0 +1,57 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+
+#include "core/buffer.h"
+#include "scene_graph/component.h"
+
+namespace vkb
+{
+namespace sg
+{
+/**
+ * @brief Vertex and index buffers that the geometry of several sub meshes is suballocated from.
+ *        Sub meshes refer to them through SubMesh::shared_vertex_buffers and SubMesh::shared_index_buffer
+ */
+class GeometryBuffers : public Component
+{
+  public:
+	GeometryBuffers(const std::string &name);
+
+	GeometryBuffers(GeometryBuffers &&other) = default;
+
+	virtual ~GeometryBuffers() = default;
+
+	virtual std::type_index get_type() override;
+
+	/// One buffer per vertex attribute, the data of every sub mesh starts at its vertex offset
+	std::unordered_map<std::string, core::Buffer> vertex_buffers;
+
+	/// One buffer per index type
+	std::map<VkIndexType, core::Buffer> index_buffers;
+};
+}        // namespace sg
+}        // namespace vkb
@@ -20,20 +20,29 @@
 
 #include "image.h"
 
+#include <algorithm>
+#include <cmath>
 #include <mutex>
 
 #include "common/error.h"
 
-VKBP_DISABLE_WARNINGS()
-#define STB_IMAGE_RESIZE_IMPLEMENTATION
-#include <stb_image_resize.h>
-VKBP_ENABLE_WARNINGS()
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define VKB_MIPMAP_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#	include <arm_neon.h>
+#	define VKB_MIPMAP_NEON
+#endif
 
+#include "common/helpers.h"
 #include "common/utils.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
 #include "platform/filesystem.h"
 #include "scene_graph/components/image/astc.h"
 #include "scene_graph/components/image/ktx.h"
 #include "scene_graph/components/image/stb.h"
+#include "scene_graph/components/image/transcoder.h"
 
 namespace vkb
 {
@@ -71,6 +80,435 @@ bool is_astc(const VkFormat format)
 	        format == VK_FORMAT_ASTC_12x12_SRGB_BLOCK);
 }
 
+namespace
+{
+/// Size in bytes of the range of rows of a mip level processed by one task
+const uint32_t MIPMAP_CHUNK_SIZE = 256 * 1024;
+
+/// Linear values are stored with 14 bits, so that the sum of a 2x2 block fits in 16 bits
+const uint32_t LINEAR_BITS = 14;
+
+const uint32_t LINEAR_MAX = (1u << LINEAR_BITS) - 1;
+
+uint32_t get_channel_count(VkFormat format)
+{
+	switch (format)
+	{
+		case VK_FORMAT_R8_UNORM:
+		case VK_FORMAT_R8_SRGB:
+			return 1;
+		case VK_FORMAT_R8G8_UNORM:
+		case VK_FORMAT_R8G8_SRGB:
+			return 2;
+		case VK_FORMAT_R8G8B8_UNORM:
+		case VK_FORMAT_R8G8B8_SRGB:
+		case VK_FORMAT_B8G8R8_UNORM:
+		case VK_FORMAT_B8G8R8_SRGB:
+			return 3;
+		default:
+			return 4;
+	}
+}
+
+bool is_srgb(VkFormat format)
+{
+	switch (format)
+	{
+		case VK_FORMAT_R8_SRGB:
+		case VK_FORMAT_R8G8_SRGB:
+		case VK_FORMAT_R8G8B8_SRGB:
+		case VK_FORMAT_B8G8R8_SRGB:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * @brief Conversion tables between 8 bit sRGB values and 14 bit linear values
+ */
+struct SrgbTables
+{
+	SrgbTables()
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			float value = i / 255.0f;
+			value       = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+
+			to_linear[i] = static_cast<uint16_t>(value * LINEAR_MAX + 0.5f);
+		}
+
+		for (uint32_t i = 0; i <= LINEAR_MAX; i++)
+		{
+			float value = static_cast<float>(i) / LINEAR_MAX;
+			value       = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+
+			to_srgb[i] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+		}
+	}
+
+	uint16_t to_linear[256];
+
+	uint8_t to_srgb[LINEAR_MAX + 1];
+};
+
+const SrgbTables &get_srgb_tables()
+{
+	static SrgbTables tables;
+	return tables;
+}
+
+/**
+ * @brief Widens a row of 8 bit values to 16 bits
+ */
+void widen_row(const uint8_t *src, uint16_t *dst, size_t count)
+{
+	size_t i = 0;
+
+#if defined(VKB_MIPMAP_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi8(value, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8), _mm_unpackhi_epi8(value, zero));
+	}
+#elif defined(VKB_MIPMAP_NEON)
+	for (; i + 8 <= count; i += 8)
+	{
+		vst1q_u16(dst + i, vmovl_u8(vld1_u8(src + i)));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		dst[i] = src[i];
+	}
+}
+
+/**
+ * @brief Converts a row of 8 bit sRGB values to linear values, alpha is kept as it is
+ */
+void linearize_row(const uint8_t *src, uint16_t *dst, size_t count, uint32_t channels)
+{
+	auto &tables = get_srgb_tables();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (channels == 4 && i % 4 == 3)
+		{
+			dst[i] = static_cast<uint16_t>(src[i] << (LINEAR_BITS - 8));
+		}
+		else
+		{
+			dst[i] = tables.to_linear[src[i]];
+		}
+	}
+}
+
+/**
+ * @brief Adds two rows of 16 bit values
+ */
+void add_rows(const uint16_t *a, const uint16_t *b, uint16_t *dst, size_t count)
+{
+	size_t i = 0;
+
+#if defined(VKB_MIPMAP_SSE2)
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i value_a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+		__m128i value_b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_add_epi16(value_a, value_b));
+	}
+#elif defined(VKB_MIPMAP_NEON)
+	for (; i + 8 <= count; i += 8)
+	{
+		vst1q_u16(dst + i, vaddq_u16(vld1q_u16(a + i), vld1q_u16(b + i)));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		dst[i] = static_cast<uint16_t>(a[i] + b[i]);
+	}
+}
+
+/**
+ * @brief Adds horizontal pairs of pixels of a row, the last pixel is repeated for odd widths
+ */
+void add_pixel_pairs(const uint16_t *src, uint32_t src_width, uint16_t *dst, uint32_t dst_width, uint32_t channels)
+{
+	uint32_t x = 0;
+
+	// Pairs which are fully inside the source row
+	uint32_t pair_count = std::min(dst_width, src_width / 2);
+
+#if defined(VKB_MIPMAP_SSE2)
+	if (channels == 4)
+	{
+		for (; x + 2 <= pair_count; x += 2)
+		{
+			__m128i first  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 8));
+			__m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 8 + 8));
+			__m128i sum    = _mm_add_epi16(_mm_unpacklo_epi64(first, second), _mm_unpackhi_epi64(first, second));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), sum);
+		}
+	}
+#elif defined(VKB_MIPMAP_NEON)
+	if (channels == 4)
+	{
+		for (; x < pair_count; x++)
+		{
+			uint16x8_t pair = vld1q_u16(src + x * 8);
+			vst1_u16(dst + x * 4, vadd_u16(vget_low_u16(pair), vget_high_u16(pair)));
+		}
+	}
+#endif
+
+	for (; x < dst_width; x++)
+	{
+		uint32_t x0 = 2 * x;
+		uint32_t x1 = std::min(2 * x + 1, src_width - 1);
+
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			dst[x * channels + c] = static_cast<uint16_t>(src[x0 * channels + c] + src[x1 * channels + c]);
+		}
+	}
+}
+
+/**
+ * @brief Averages a row of 2x2 block sums back to 8 bit values
+ */
+void resolve_row(const uint16_t *src, uint8_t *dst, size_t count)
+{
+	size_t i = 0;
+
+#if defined(VKB_MIPMAP_SSE2)
+	const __m128i two = _mm_set1_epi16(2);
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i low  = _mm_srli_epi16(_mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), two), 2);
+		__m128i high = _mm_srli_epi16(_mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8)), two), 2);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(low, high));
+	}
+#elif defined(VKB_MIPMAP_NEON)
+	for (; i + 8 <= count; i += 8)
+	{
+		vst1_u8(dst + i, vrshrn_n_u16(vld1q_u16(src + i), 2));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		dst[i] = static_cast<uint8_t>((src[i] + 2) >> 2);
+	}
+}
+
+/**
+ * @brief Converts a row of 2x2 block sums of linear values back to 8 bit sRGB values
+ */
+void resolve_srgb_row(const uint16_t *src, uint8_t *dst, size_t count, uint32_t channels)
+{
+	auto &tables = get_srgb_tables();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t value = (src[i] + 2u) >> 2;
+
+		if (channels == 4 && i % 4 == 3)
+		{
+			dst[i] = static_cast<uint8_t>((value + (1u << (LINEAR_BITS - 9))) >> (LINEAR_BITS - 8));
+		}
+		else
+		{
+			dst[i] = tables.to_srgb[value];
+		}
+	}
+}
+
+/**
+ * @brief Downsamples the rows [row_begin, row_end) of the next mip level with a 2x2 box filter
+ *        The last row and column are repeated when the source size is odd
+ */
+void downsample_rows(const uint8_t *src, uint32_t src_width, uint32_t src_height, uint8_t *dst, uint32_t dst_width,
+                     uint32_t row_begin, uint32_t row_end, uint32_t channels, bool srgb)
+{
+	size_t src_row_size = static_cast<size_t>(src_width) * channels;
+	size_t dst_row_size = static_cast<size_t>(dst_width) * channels;
+
+	std::vector<uint16_t> top(src_row_size);
+	std::vector<uint16_t> bottom(src_row_size);
+	std::vector<uint16_t> column_sums(src_row_size);
+	std::vector<uint16_t> block_sums(dst_row_size);
+
+	for (uint32_t y = row_begin; y < row_end; y++)
+	{
+		const uint8_t *src_top    = src + 2 * y * src_row_size;
+		const uint8_t *src_bottom = src + std::min(2 * y + 1, src_height - 1) * src_row_size;
+
+		if (srgb)
+		{
+			linearize_row(src_top, top.data(), src_row_size, channels);
+			linearize_row(src_bottom, bottom.data(), src_row_size, channels);
+		}
+		else
+		{
+			widen_row(src_top, top.data(), src_row_size);
+			widen_row(src_bottom, bottom.data(), src_row_size);
+		}
+
+		add_rows(top.data(), bottom.data(), column_sums.data(), src_row_size);
+
+		add_pixel_pairs(column_sums.data(), src_width, block_sums.data(), dst_width, channels);
+
+		uint8_t *dst_row = dst + y * dst_row_size;
+
+		if (srgb)
+		{
+			resolve_srgb_row(block_sums.data(), dst_row, dst_row_size, channels);
+		}
+		else
+		{
+			resolve_row(block_sums.data(), dst_row, dst_row_size);
+		}
+	}
+}
+
+#define TRANSCODE_CACHE_MAGIC 0x44435254
+#define TRANSCODE_CACHE_VERSION 1
+
+struct TranscoderRegistry
+{
+	std::mutex mutex;
+
+	std::vector<std::unique_ptr<ImageTranscoder>> transcoders;
+};
+
+TranscoderRegistry &get_transcoder_registry()
+{
+	static TranscoderRegistry registry;
+
+	static std::once_flag default_transcoders;
+	std::call_once(default_transcoders, []() {
+		registry.transcoders.emplace_back(std::make_unique<AstcToBcTranscoder>());
+		registry.transcoders.emplace_back(std::make_unique<RgbaTranscoder>());
+	});
+
+	return registry;
+}
+
+/**
+ * @brief Reads a transcoded image, the cache file holds a header, the mipmaps and the data
+ */
+std::unique_ptr<Image> read_transcode_cache(const std::string &name, const std::string &filename)
+{
+	std::vector<uint8_t> cache;
+
+	try
+	{
+		cache = fs::read_temp_blob(filename);
+	}
+	catch (const std::runtime_error &)
+	{
+		return nullptr;
+	}
+
+	uint32_t header[4]{};
+
+	if (cache.size() < sizeof(header))
+	{
+		return nullptr;
+	}
+
+	std::memcpy(header, cache.data(), sizeof(header));
+
+	size_t mipmaps_size = header[3] * sizeof(Mipmap);
+
+	if (header[0] != TRANSCODE_CACHE_MAGIC || header[1] != TRANSCODE_CACHE_VERSION || header[3] == 0 ||
+	    cache.size() < sizeof(header) + mipmaps_size)
+	{
+		LOGW("Transcode cache {} is not valid, ignoring it", filename);
+		return nullptr;
+	}
+
+	std::vector<Mipmap> mipmaps(header[3]);
+	std::memcpy(mipmaps.data(), cache.data() + sizeof(header), mipmaps_size);
+
+	std::vector<uint8_t> data(cache.begin() + sizeof(header) + mipmaps_size, cache.end());
+
+	return std::make_unique<TranscodedImage>(name, std::move(data), std::move(mipmaps), static_cast<VkFormat>(header[2]));
+}
+
+void write_transcode_cache(const Image &image, const std::string &filename)
+{
+	auto &mipmaps = image.get_mipmaps();
+	auto &data    = image.get_data();
+
+	uint32_t header[4]{TRANSCODE_CACHE_MAGIC, TRANSCODE_CACHE_VERSION, static_cast<uint32_t>(image.get_format()), to_u32(mipmaps.size())};
+
+	std::vector<uint8_t> cache(sizeof(header) + mipmaps.size() * sizeof(Mipmap));
+	std::memcpy(cache.data(), header, sizeof(header));
+	std::memcpy(cache.data() + sizeof(header), mipmaps.data(), mipmaps.size() * sizeof(Mipmap));
+	cache.insert(cache.end(), data.begin(), data.end());
+
+	try
+	{
+		fs::write_temp_blob(cache, filename);
+	}
+	catch (const std::runtime_error &e)
+	{
+		LOGW("Failed to write transcode cache {}: {}", filename, e.what());
+	}
+}
+
+/**
+ * @brief Lists the registered transcoders, which are never removed so they can be used after the lock is released
+ */
+std::vector<const ImageTranscoder *> get_transcoders()
+{
+	auto &registry = get_transcoder_registry();
+
+	std::lock_guard<std::mutex> lock{registry.mutex};
+
+	std::vector<const ImageTranscoder *> transcoders;
+	for (auto &transcoder : registry.transcoders)
+	{
+		transcoders.push_back(transcoder.get());
+	}
+
+	return transcoders;
+}
+
+/**
+ * @brief Transcodes an image, or reads the result of a previous run from the temporary storage
+ */
+std::unique_ptr<Image> transcode_cached(const ImageTranscoder &transcoder, const Image &image, VkFormat target_format, JobSystem *job_system)
+{
+	auto &extent = image.get_extent();
+
+	uint32_t key_data[5] = {static_cast<uint32_t>(image.get_format()), static_cast<uint32_t>(target_format), extent.width, extent.height, extent.depth};
+
+	auto key = hash_bytes(image.get_data(), hash_bytes(key_data, sizeof(key_data)));
+
+	auto cache_filename = "transcode_" + std::to_string(key) + ".bin";
+
+	auto transcoded = read_transcode_cache(image.get_name(), cache_filename);
+
+	if (!transcoded)
+	{
+		transcoded = transcoder.transcode(image, target_format, job_system);
+
+		write_transcode_cache(*transcoded, cache_filename);
+	}
+
+	return transcoded;
+}
+}        // namespace
+
 Image::Image(const std::string &name, std::vector<uint8_t> &&d, std::vector<Mipmap> &&m) :
     Component{name},
     data{std::move(d)},
@@ -110,18 +548,59 @@ const std::vector<Mipmap> &Image::get_mipmaps() const
 	return mipmaps;
 }
 
-void Image::create_vk_image(Device &device)
+void Image::create_vk_image(Device &device, uint32_t mip_levels, VkFormat vk_format)
 {
 	assert(!vk_image && !vk_image_view && "Vulkan image already constructed");
 
+	mip_levels = std::max(mip_levels, to_u32(mipmaps.size()));
+
+	// Generated levels are blitted from the previous ones, and images can be copied into texture arrays
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
 	vk_image = std::make_unique<core::Image>(device,
 	                                         get_extent(),
+	                                         vk_format == VK_FORMAT_UNDEFINED ? format : vk_format,
+	                                         usage,
+	                                         VMA_MEMORY_USAGE_GPU_ONLY, VK_SAMPLE_COUNT_1_BIT,
+	                                         mip_levels);
+
+	vk_image->set_debug_name(get_name());
+
+	vk_image_view = &vk_image->request_view(VK_IMAGE_VIEW_TYPE_2D);
+}
+
+void Image::create_streamed_vk_image(Device &device, uint32_t base_level, std::unique_ptr<core::Image> &retired_image)
+{
+	assert(base_level < mipmaps.size() && "Base level is not in the data");
+
+	retired_image = std::move(vk_image);
+
+	vk_image = std::make_unique<core::Image>(device,
+	                                         mipmaps[base_level].extent,
 	                                         format,
 	                                         VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
 	                                         VMA_MEMORY_USAGE_GPU_ONLY, VK_SAMPLE_COUNT_1_BIT,
-	                                         to_u32(mipmaps.size()));
+	                                         to_u32(mipmaps.size()) - base_level);
+
+	vk_image->set_debug_name(get_name());
 
-	vk_image_view = std::make_unique<core::ImageView>(*vk_image, VK_IMAGE_VIEW_TYPE_2D);
+	vk_image_view = &vk_image->request_view(VK_IMAGE_VIEW_TYPE_2D);
+
+	vk_base_level = base_level;
+}
+
+uint32_t Image::get_vk_base_level() const
+{
+	return vk_base_level;
+}
+
+size_t Image::get_mipmap_size(uint32_t level) const
+{
+	assert(level < mipmaps.size() && "Level is not in the data");
+
+	size_t end = level + 1 < mipmaps.size() ? mipmaps[level + 1].offset : data.size();
+
+	return end - mipmaps[level].offset;
 }
 
 const core::Image &Image::get_vk_image() const
@@ -136,12 +615,106 @@ const core::ImageView &Image::get_vk_image_view() const
 	return *vk_image_view;
 }
 
+bool Image::supports_gpu_mipmaps(const Device &device, VkFormat format)
+{
+	VkFormatFeatureFlags required_features = VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+	                                         VK_FORMAT_FEATURE_BLIT_DST_BIT |
+	                                         VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+	return (device.get_format_properties(format).optimalTilingFeatures & required_features) == required_features;
+}
+
+uint32_t Image::get_gpu_mip_level_count() const
+{
+	if (!vk_image)
+	{
+		return 0;
+	}
+
+	return vk_image->get_subresource().mipLevel - to_u32(mipmaps.size());
+}
+
+void Image::generate_gpu_mipmaps(CommandBuffer &command_buffer) const
+{
+	auto &image      = get_vk_image();
+	auto &image_view = get_vk_image_view();
+
+	uint32_t level_count = image.get_subresource().mipLevel;
+	uint32_t first_level = to_u32(mipmaps.size());
+
+	if (first_level >= level_count)
+	{
+		return;
+	}
+
+	auto range       = image_view.get_subresource_range();
+	range.levelCount = 1;
+
+	for (uint32_t level = first_level; level < level_count; level++)
+	{
+		// The previous level becomes the source of the blit
+		range.baseMipLevel = level - 1;
+
+		ImageMemoryBarrier src_barrier{};
+		src_barrier.old_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		src_barrier.new_layout      = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		src_barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		src_barrier.dst_access_mask = VK_ACCESS_TRANSFER_READ_BIT;
+		src_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		src_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+		command_buffer.image_memory_barrier(image_view, range, src_barrier);
+
+		auto src_width  = std::max(1u, image.get_extent().width >> (level - 1));
+		auto src_height = std::max(1u, image.get_extent().height >> (level - 1));
+
+		VkImageBlit blit{};
+		blit.srcSubresource          = image_view.get_subresource_layers();
+		blit.srcSubresource.mipLevel = level - 1;
+		blit.srcOffsets[1]           = {static_cast<int32_t>(src_width), static_cast<int32_t>(src_height), 1};
+		blit.dstSubresource          = image_view.get_subresource_layers();
+		blit.dstSubresource.mipLevel = level;
+		blit.dstOffsets[1]           = {static_cast<int32_t>(std::max(1u, src_width / 2)), static_cast<int32_t>(std::max(1u, src_height / 2)), 1};
+
+		command_buffer.blit_image(image, image, {blit}, VK_FILTER_LINEAR);
+	}
+
+	ImageMemoryBarrier read_barrier{};
+	read_barrier.src_access_mask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	read_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+	read_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	read_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	read_barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	// Levels from the one before the first generated to the one before the last have been blit sources
+	range.baseMipLevel      = first_level - 1;
+	range.levelCount        = level_count - first_level;
+	read_barrier.old_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+	command_buffer.image_memory_barrier(image_view, range, read_barrier);
+
+	read_barrier.old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+	range.baseMipLevel = level_count - 1;
+	range.levelCount   = 1;
+
+	command_buffer.image_memory_barrier(image_view, range, read_barrier);
+
+	if (first_level > 1)
+	{
+		range.baseMipLevel = 0;
+		range.levelCount   = first_level - 1;
+
+		command_buffer.image_memory_barrier(image_view, range, read_barrier);
+	}
+}
+
 Mipmap &Image::get_mipmap(const size_t index)
 {
 	return mipmaps.at(index);
 }
 
-void Image::generate_mipmaps()
+void Image::generate_mipmaps(JobSystem *job_system)
 {
 	assert(mipmaps.size() == 1 && "Mipmaps already generated");
 
@@ -150,17 +723,19 @@ void Image::generate_mipmaps()
 		return;        // Do not generate again
 	}
 
-	auto extent      = get_extent();
-	auto next_width  = std::max<uint32_t>(1u, extent.width / 2);
-	auto next_height = std::max<uint32_t>(1u, extent.height / 2);
-	auto channels    = 4;
-	auto next_size   = next_width * next_height * channels;
+	auto channels = get_channel_count(format);
+	bool srgb     = is_srgb(format);
+
+	auto extent = get_extent();
 
-	while (true)
+	while (extent.width > 1 || extent.height > 1)
 	{
+		auto next_width  = std::max<uint32_t>(1u, extent.width / 2);
+		auto next_height = std::max<uint32_t>(1u, extent.height / 2);
+
 		// Make space for next mipmap
 		auto old_size = to_u32(data.size());
-		data.resize(old_size + next_size);
+		data.resize(old_size + next_width * next_height * channels);
 
 		auto &prev_mipmap = mipmaps.back();
 		// Update mipmaps
@@ -169,21 +744,21 @@ void Image::generate_mipmaps()
 		next_mipmap.offset = old_size;
 		next_mipmap.extent = {next_width, next_height, 1u};
 
-		// Fill next mipmap memory
-		stbir_resize_uint8(data.data() + prev_mipmap.offset, prev_mipmap.extent.width, prev_mipmap.extent.height, 0,
-		                   data.data() + next_mipmap.offset, next_mipmap.extent.width, next_mipmap.extent.height, 0, channels);
+		// Fill next mipmap memory, large levels are split in ranges of rows
+		const uint8_t *src = data.data() + prev_mipmap.offset;
+		uint8_t *      dst = data.data() + next_mipmap.offset;
 
-		mipmaps.emplace_back(std::move(next_mipmap));
+		auto downsample = [&](uint32_t begin, uint32_t end) {
+			downsample_rows(src, extent.width, extent.height, dst, next_width, begin, end, channels, srgb);
+		};
 
-		// Next mipmap values
-		next_width  = std::max<uint32_t>(1u, next_width / 2);
-		next_height = std::max<uint32_t>(1u, next_height / 2);
-		next_size   = next_width * next_height * channels;
+		uint32_t chunk_rows = std::max<uint32_t>(1u, MIPMAP_CHUNK_SIZE / (next_width * channels));
 
-		if (next_width == 1 && next_height == 1)
-		{
-			break;
-		}
+		parallel_for_ranges(job_system, next_height, chunk_rows, downsample);
+
+		mipmaps.emplace_back(std::move(next_mipmap));
+
+		extent = mipmaps.back().extent;
 	}
 }
 
@@ -223,26 +798,81 @@ void Image::set_depth(const uint32_t depth)
 	mipmaps.at(0).extent.depth = depth;
 }
 
+void Image::add_transcoder(std::unique_ptr<ImageTranscoder> &&transcoder)
+{
+	auto &registry = get_transcoder_registry();
+
+	std::lock_guard<std::mutex> lock{registry.mutex};
+	registry.transcoders.emplace_back(std::move(transcoder));
+}
+
+std::unique_ptr<Image> Image::transcode(const Device &device, const Image &image, JobSystem *job_system)
+{
+	for (auto transcoder : get_transcoders())
+	{
+		if (!transcoder->can_transcode(image.get_format()))
+		{
+			continue;
+		}
+
+		for (auto target_format : transcoder->get_target_formats(image))
+		{
+			if (device.is_image_format_supported(target_format))
+			{
+				return transcode_cached(*transcoder, image, target_format, job_system);
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+std::unique_ptr<Image> Image::transcode(const Device &device, const Image &image, VkFormat target_format, JobSystem *job_system)
+{
+	if (!device.is_image_format_supported(target_format))
+	{
+		return nullptr;
+	}
+
+	for (auto transcoder : get_transcoders())
+	{
+		if (!transcoder->can_transcode(image.get_format()))
+		{
+			continue;
+		}
+
+		auto target_formats = transcoder->get_target_formats(image);
+
+		if (std::find(target_formats.begin(), target_formats.end(), target_format) != target_formats.end())
+		{
+			return transcode_cached(*transcoder, image, target_format, job_system);
+		}
+	}
+
+	return nullptr;
+}
+
 std::unique_ptr<Image> Image::load(const std::string &name, const std::string &uri)
 {
 	std::unique_ptr<Image> image{nullptr};
 
-	auto data = fs::read_asset(uri);
+	// Decoders read the file through a mapping instead of a copy
+	auto file = fs::map_asset(uri);
 
 	// Get extension
 	auto extension = get_extension(uri);
 
 	if (extension == "png" || extension == "jpg")
 	{
-		image = std::make_unique<Stb>(name, data);
+		image = std::make_unique<Stb>(name, file.get_data(), file.get_size());
 	}
 	else if (extension == "astc")
 	{
-		image = std::make_unique<Astc>(name, data);
+		image = std::make_unique<Astc>(name, file.get_data(), file.get_size());
 	}
 	else if (extension == "ktx")
 	{
-		image = std::make_unique<Ktx>(name, data);
+		image = std::make_unique<Ktx>(name, file.get_data(), file.get_size());
 	}
 
 	return image;
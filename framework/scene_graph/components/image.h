@@ -33,8 +33,13 @@
 
 namespace vkb
 {
+class JobSystem;
+class CommandBuffer;
+
 namespace sg
 {
+class ImageTranscoder;
+
 /**
  * @param format Vulkan format
  * @return Whether the vulkan format is ASTC
@@ -63,6 +68,35 @@ class Image : public Component
 
 	static std::unique_ptr<Image> load(const std::string &name, const std::string &uri);
 
+	/**
+	 * @brief Registers a transcoder for transcode, transcoders which were added first are tried first
+	 *        An ASTC to BC transcoder and an RGBA8 compressor are registered by default
+	 */
+	static void add_transcoder(std::unique_ptr<ImageTranscoder> &&transcoder);
+
+	/**
+	 * @brief Transcodes an image to the preferred format of the first transcoder which
+	 *        handles it and supports a format of the device.
+	 *        The result is cached in the temporary storage, keyed by the hash of the image data
+	 * @param device The device which will sample the image
+	 * @param image The image to transcode
+	 * @param job_system Optional job system used to split the work
+	 * @return The transcoded image with its full mip chain, or nullptr if no transcoder could convert it
+	 */
+	static std::unique_ptr<Image> transcode(const Device &device, const Image &image, JobSystem *job_system = nullptr);
+
+	/**
+	 * @brief Transcodes an image to a given format, with the first transcoder which handles the image and offers the format.
+	 *        The result is cached in the temporary storage as for the preferred format
+	 * @param device The device which will sample the image
+	 * @param image The image to transcode
+	 * @param target_format The format of the transcoded image, which opaque images may store in a smaller variant
+	 * @param job_system Optional job system used to split the work
+	 * @return The transcoded image with its full mip chain, or nullptr if the device does not support the format
+	 *         or no transcoder could convert the image to it
+	 */
+	static std::unique_ptr<Image> transcode(const Device &device, const Image &image, VkFormat target_format, JobSystem *job_system = nullptr);
+
 	virtual ~Image() = default;
 
 	virtual std::type_index get_type() override;
@@ -77,9 +111,59 @@ class Image : public Component
 
 	const std::vector<Mipmap> &get_mipmaps() const;
 
-	void generate_mipmaps();
-
-	void create_vk_image(Device &device);
+	/**
+	 * @brief Generates the full mip chain on the CPU with a 2x2 box filter
+	 *        Supports 8 bit formats with 1 to 4 channels, sRGB formats are averaged in linear space
+	 * @param job_system Optional job system used to split large levels in ranges of rows
+	 */
+	void generate_mipmaps(JobSystem *job_system = nullptr);
+
+	/**
+	 * @return Whether a format can be blitted with linear filtering, which generate_gpu_mipmaps needs
+	 */
+	static bool supports_gpu_mipmaps(const Device &device, VkFormat format);
+
+	/**
+	 * @brief Creates the Vulkan image and its view
+	 * @param device The device to create the image with
+	 * @param mip_levels Number of levels of the image, levels missing from the data are left
+	 *                   for generate_gpu_mipmaps. If 0, only the levels in the data are created
+	 * @param vk_format Format of the Vulkan image, when the data is decoded on the GPU into another format.
+	 *                  If undefined, the format of the data
+	 */
+	void create_vk_image(Device &device, uint32_t mip_levels = 0, VkFormat vk_format = VK_FORMAT_UNDEFINED);
+
+	/**
+	 * @brief Creates the Vulkan image with the data levels from base_level onwards, so that mipmaps can be streamed.
+	 *        The current image, along with its views, is moved to retired_image, so that the caller
+	 *        destroys it once the GPU no longer uses it
+	 * @param device The device to create the image with
+	 * @param base_level The data level stored in the first level of the Vulkan image
+	 * @param retired_image Receives the previous Vulkan image, if any
+	 */
+	void create_streamed_vk_image(Device &device, uint32_t base_level, std::unique_ptr<core::Image> &retired_image);
+
+	/**
+	 * @return The data level stored in the first level of the Vulkan image
+	 */
+	uint32_t get_vk_base_level() const;
+
+	/**
+	 * @return Size in bytes of a level of the data
+	 */
+	size_t get_mipmap_size(uint32_t level) const;
+
+	/**
+	 * @return Number of mip levels which have to be generated on the GPU
+	 */
+	uint32_t get_gpu_mip_level_count() const;
+
+	/**
+	 * @brief Generates the levels missing from the data by successive linear blits from the previous level.
+	 *        Every level must be in TRANSFER_DST_OPTIMAL layout, and the first ones written.
+	 *        All levels are left in SHADER_READ_ONLY_OPTIMAL layout.
+	 */
+	void generate_gpu_mipmaps(CommandBuffer &command_buffer) const;
 
 	const core::Image &get_vk_image() const;
 
@@ -111,7 +195,10 @@ class Image : public Component
 
 	std::unique_ptr<core::Image> vk_image;
 
-	std::unique_ptr<core::ImageView> vk_image_view;
+	/// Owned by vk_image
+	core::ImageView *vk_image_view{nullptr};
+
+	uint32_t vk_base_level{0};
 };
 
 }        // namespace sg
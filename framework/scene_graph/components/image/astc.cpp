@@ -20,9 +20,14 @@
 
 #include "scene_graph/components/image/astc.h"
 
+#include <cstring>
 #include <mutex>
 
 #include "common/error.h"
+#include "common/helpers.h"
+#include "common/logging.h"
+#include "common/utils.h"
+#include "platform/filesystem.h"
 
 VKBP_DISABLE_WARNINGS()
 #if defined(_WIN32) || defined(_WIN64)
@@ -34,6 +39,12 @@ VKBP_ENABLE_WARNINGS()
 
 #define MAGIC_FILE_CONSTANT 0x5CA1AB13
 
+#define DECODE_CACHE_MAGIC 0x43445341
+#define DECODE_CACHE_VERSION 1
+
+/// Number of blocks decoded by one task
+#define DECODE_RANGE_BLOCKS 1024
+
 namespace vkb
 {
 namespace sg
@@ -115,7 +126,7 @@ void Astc::init()
 	}
 }
 
-void Astc::decode(BlockDim blockdim, VkExtent3D extent, const uint8_t *data_)
+void Astc::decode(BlockDim blockdim, VkExtent3D extent, const uint8_t *data_, JobSystem *job_system)
 {
 	// Actual decoding
 	astc_decode_mode decode_mode = DECODE_LDR_SRGB;
@@ -146,17 +157,34 @@ void Astc::decode(BlockDim blockdim, VkExtent3D extent, const uint8_t *data_)
 	int yblocks = (ysize + ydim - 1) / ydim;
 	int zblocks = (zsize + zdim - 1) / zdim;
 
+	// Decoded images are cached in the temporary storage, keyed by the hash of the compressed data
+	size_t data_size = static_cast<size_t>(xblocks) * yblocks * zblocks * 16;
+
+	uint32_t key_data[6] = {blockdim.x, blockdim.y, blockdim.z, extent.width, extent.height, extent.depth};
+
+	auto key = hash_bytes(data_, data_size, hash_bytes(key_data, sizeof(key_data)));
+
+	auto cache_filename = "astc_" + std::to_string(key) + ".bin";
+
+	if (read_decode_cache(cache_filename, extent))
+	{
+		return;
+	}
+
 	auto astc_image = allocate_image(bitness, xsize, ysize, zsize, 0);
 	initialize_image(astc_image);
 
-	imageblock pb;
-	for (int z = 0; z < zblocks; z++)
-	{
-		for (int y = 0; y < yblocks; y++)
+	// Blocks are independent, so ranges of block rows are decoded in parallel
+	auto decode_rows = [&](uint32_t row_begin, uint32_t row_end) {
+		imageblock pb;
+		for (int row = row_begin; row < static_cast<int>(row_end); row++)
 		{
+			int z = row / yblocks;
+			int y = row % yblocks;
+
 			for (int x = 0; x < xblocks; x++)
 			{
-				int            offset = (((z * yblocks + y) * xblocks) + x) * 16;
+				int            offset = ((row * xblocks) + x) * 16;
 				const uint8_t *bp     = data_ + offset;
 
 				physical_compressed_block pcb = *reinterpret_cast<const physical_compressed_block *>(bp);
@@ -167,7 +195,11 @@ void Astc::decode(BlockDim blockdim, VkExtent3D extent, const uint8_t *data_)
 				write_imageblock(astc_image, &pb, xdim, ydim, zdim, x * xdim, y * ydim, z * zdim, swz_decode);
 			}
 		}
-	}
+	};
+
+	uint32_t range_rows = std::max(1, DECODE_RANGE_BLOCKS / xblocks);
+
+	parallel_for_ranges(job_system, zblocks * yblocks, range_rows, decode_rows);
 
 	set_data(astc_image->imagedata8[0][0], astc_image->xsize * astc_image->ysize * astc_image->zsize * 4);
 	set_format(VK_FORMAT_R8G8B8A8_SRGB);
@@ -176,27 +208,92 @@ void Astc::decode(BlockDim blockdim, VkExtent3D extent, const uint8_t *data_)
 	set_depth(static_cast<uint32_t>(astc_image->zsize));
 
 	destroy_image(astc_image);
+
+	write_decode_cache(cache_filename);
+}
+
+bool Astc::read_decode_cache(const std::string &filename, VkExtent3D extent)
+{
+	std::vector<uint8_t> cache;
+
+	try
+	{
+		cache = fs::read_temp_blob(filename);
+	}
+	catch (const std::runtime_error &)
+	{
+		return false;
+	}
+
+	uint32_t header[5]{};
+
+	size_t data_size = static_cast<size_t>(extent.width) * extent.height * extent.depth * 4;
+
+	if (cache.size() != sizeof(header) + data_size)
+	{
+		LOGW("ASTC decode cache {} has an invalid size, ignoring it", filename);
+		return false;
+	}
+
+	std::memcpy(header, cache.data(), sizeof(header));
+
+	if (header[0] != DECODE_CACHE_MAGIC || header[1] != DECODE_CACHE_VERSION ||
+	    header[2] != extent.width || header[3] != extent.height || header[4] != extent.depth)
+	{
+		LOGW("ASTC decode cache {} is not valid, ignoring it", filename);
+		return false;
+	}
+
+	set_data(cache.data() + sizeof(header), data_size);
+	set_format(VK_FORMAT_R8G8B8A8_SRGB);
+	set_width(extent.width);
+	set_height(extent.height);
+	set_depth(extent.depth);
+
+	return true;
+}
+
+void Astc::write_decode_cache(const std::string &filename)
+{
+	auto &extent = get_extent();
+
+	uint32_t header[5]{DECODE_CACHE_MAGIC, DECODE_CACHE_VERSION, extent.width, extent.height, extent.depth};
+
+	std::vector<uint8_t> cache(sizeof(header));
+	std::memcpy(cache.data(), header, sizeof(header));
+
+	auto &data = get_data();
+	cache.insert(cache.end(), data.begin(), data.end());
+
+	try
+	{
+		fs::write_temp_blob(cache, filename);
+	}
+	catch (const std::runtime_error &e)
+	{
+		LOGW("Failed to write ASTC decode cache {}: {}", filename, e.what());
+	}
 }
 
-Astc::Astc(const Image &image) :
+Astc::Astc(const Image &image, JobSystem *job_system) :
     Image{image.get_name()}
 {
 	init();
-	decode(to_blockdim(image.get_format()), image.get_extent(), image.get_data().data());
+	decode(to_blockdim(image.get_format()), image.get_extent(), image.get_data().data(), job_system);
 }
 
-Astc::Astc(const std::string &name, const std::vector<uint8_t> &data) :
+Astc::Astc(const std::string &name, const uint8_t *data, size_t size, JobSystem *job_system) :
     Image{name}
 {
 	init();
 
 	// Read header
-	if (data.size() < sizeof(AstcHeader))
+	if (size < sizeof(AstcHeader))
 	{
 		throw std::runtime_error{"Error reading astc: invalid memory"};
 	}
 	AstcHeader header{};
-	std::memcpy(&header, data.data(), sizeof(AstcHeader));
+	std::memcpy(&header, data, sizeof(AstcHeader));
 	uint32_t magicval = header.magic[0] + 256 * static_cast<uint32_t>(header.magic[1]) + 65536 * static_cast<uint32_t>(header.magic[2]) + 16777216 * static_cast<uint32_t>(header.magic[3]);
 	if (magicval != MAGIC_FILE_CONSTANT)
 	{
@@ -213,7 +310,7 @@ Astc::Astc(const std::string &name, const std::vector<uint8_t> &data) :
 	    /* height = */ static_cast<uint32_t>(header.ysize[0] + 256 * header.ysize[1] + 65536 * header.ysize[2]),
 	    /* depth  = */ static_cast<uint32_t>(header.zsize[0] + 256 * header.zsize[1] + 65536 * header.zsize[2])};
 
-	decode(blockdim, extent, data.data() + sizeof(AstcHeader));
+	decode(blockdim, extent, data + sizeof(AstcHeader), job_system);
 }
 
 }        // namespace sg
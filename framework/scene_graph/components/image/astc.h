@@ -34,32 +34,55 @@ struct BlockDim
 	uint8_t z;
 };
 
+/**
+ * @return The block dimensions of an ASTC format
+ */
+BlockDim to_blockdim(VkFormat format);
+
 class Astc : public Image
 {
   public:
 	/**
 	 * @brief Decodes an ASTC image
 	 * @param image Image to decode
+	 * @param job_system Optional job system used to decode ranges of block rows in parallel
 	 */
-	Astc(const Image &image);
+	Astc(const Image &image, JobSystem *job_system = nullptr);
 
 	/**
 	 * @brief Decodes ASTC data with an ASTC header
 	 * @param name Name of the component
 	 * @param data ASTC data with header
+	 * @param size Size of the data in bytes
+	 * @param job_system Optional job system used to decode ranges of block rows in parallel
 	 */
-	Astc(const std::string &name, const std::vector<uint8_t> &data);
+	Astc(const std::string &name, const uint8_t *data, size_t size, JobSystem *job_system = nullptr);
 
 	virtual ~Astc() = default;
 
   private:
 	/**
-	 * @brief Decodes ASTC data
+	 * @brief Decodes ASTC data, or reads the result of a previous decode from the temporary storage
 	 * @param blockdim Dimensions of the block
 	 * @param extent Extent of the image
 	 * @param data Pointer to ASTC image data
+	 * @param job_system Optional job system used to decode ranges of block rows in parallel
+	 */
+	void decode(BlockDim blockdim, VkExtent3D extent, const uint8_t *data, JobSystem *job_system);
+
+	/**
+	 * @brief Reads a decoded image from the temporary storage
+	 * @param filename The name of the cache file
+	 * @param extent Expected extent of the image
+	 * @return True if the cache file was found and valid
+	 */
+	bool read_decode_cache(const std::string &filename, VkExtent3D extent);
+
+	/**
+	 * @brief Writes the decoded image to the temporary storage
+	 * @param filename The name of the cache file
 	 */
-	void decode(BlockDim blockdim, VkExtent3D extent, const uint8_t *data);
+	void write_decode_cache(const std::string &filename);
 
 	/**
 	 * @brief Initializes ASTC library
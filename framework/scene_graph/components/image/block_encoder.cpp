@@ -0,0 +1,634 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "scene_graph/components/image/block_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace vkb
+{
+namespace sg
+{
+namespace
+{
+/// Largest ASTC footprint supported by the encoder
+const uint32_t MAX_ASTC_TEXELS = 12 * 12;
+
+/// Size of the weight grid of the ASTC blocks
+const uint32_t ASTC_GRID_SIZE = 4;
+
+/// ASTC block mode of a 4x4 grid of weights from 0 to 3 in a single plane
+const uint32_t ASTC_BLOCK_MODE = 0x42;
+
+/// ASTC color endpoint mode of LDR RGBA endpoints
+const uint32_t ASTC_CEM_LDR_RGBA_DIRECT = 12;
+
+/// Interpolation weights of the BC7 4-bit indices
+const int bc7_weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+/// ETC1 modifiers of the pixel indices 0 and 1, the indices 2 and 3 negate them
+const int etc_modifiers[8][2] = {{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+
+const int eac_modifiers[16][8] = {
+    {-3, -6, -9, -15, 2, 5, 8, 14},
+    {-3, -7, -10, -13, 2, 6, 9, 12},
+    {-2, -5, -8, -13, 1, 4, 7, 12},
+    {-2, -4, -6, -13, 1, 3, 5, 12},
+    {-3, -6, -8, -12, 2, 5, 7, 11},
+    {-3, -7, -9, -11, 2, 6, 8, 10},
+    {-4, -7, -8, -11, 3, 6, 7, 10},
+    {-3, -5, -8, -11, 2, 4, 7, 10},
+    {-2, -6, -8, -10, 1, 5, 7, 9},
+    {-2, -5, -8, -10, 1, 4, 7, 9},
+    {-2, -4, -8, -10, 1, 3, 7, 9},
+    {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9},
+    {-1, -2, -3, -10, 0, 1, 2, 9},
+    {-4, -6, -8, -9, 3, 5, 7, 8},
+    {-3, -5, -7, -9, 2, 4, 6, 8}};
+
+inline int clamp_byte(int value)
+{
+	return std::min(255, std::max(0, value));
+}
+
+/**
+ * @brief Writes bits to a block from its least significant bit, the block must be cleared first
+ */
+void write_bits(uint8_t *output, uint32_t &position, uint32_t value, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; ++i, ++position)
+	{
+		if ((value >> i) & 1)
+		{
+			output[position / 8] |= static_cast<uint8_t>(1 << (position % 8));
+		}
+	}
+}
+
+/**
+ * @brief Finds the endpoints of a line fitting the texels: their principal axis through their mean,
+ *        spanning the projections of the texels on it
+ */
+void find_endpoints(const uint8_t *rgba, uint32_t texel_count, float endpoint0[4], float endpoint1[4])
+{
+	float mean[4]{};
+
+	for (uint32_t i = 0; i < texel_count; ++i)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			mean[c] += rgba[i * 4 + c];
+		}
+	}
+
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		mean[c] /= texel_count;
+	}
+
+	float covariance[4][4]{};
+
+	for (uint32_t i = 0; i < texel_count; ++i)
+	{
+		for (uint32_t a = 0; a < 4; ++a)
+		{
+			for (uint32_t b = 0; b < 4; ++b)
+			{
+				covariance[a][b] += (rgba[i * 4 + a] - mean[a]) * (rgba[i * 4 + b] - mean[b]);
+			}
+		}
+	}
+
+	// Power iteration, starting from the luminance axis
+	float axis[4]{0.5f, 0.5f, 0.5f, 0.5f};
+
+	for (uint32_t iteration = 0; iteration < 8; ++iteration)
+	{
+		float next[4]{};
+
+		for (uint32_t a = 0; a < 4; ++a)
+		{
+			for (uint32_t b = 0; b < 4; ++b)
+			{
+				next[a] += covariance[a][b] * axis[b];
+			}
+		}
+
+		float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+
+		if (length < 1e-6f)
+		{
+			// The texels are all the same
+			break;
+		}
+
+		for (uint32_t a = 0; a < 4; ++a)
+		{
+			axis[a] = next[a] / length;
+		}
+	}
+
+	float min_t = std::numeric_limits<float>::max();
+	float max_t = std::numeric_limits<float>::lowest();
+
+	for (uint32_t i = 0; i < texel_count; ++i)
+	{
+		float t = 0.0f;
+
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			t += (rgba[i * 4 + c] - mean[c]) * axis[c];
+		}
+
+		min_t = std::min(min_t, t);
+		max_t = std::max(max_t, t);
+	}
+
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		endpoint0[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * min_t));
+		endpoint1[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * max_t));
+	}
+}
+
+/**
+ * @brief Quantizes a BC7 mode 6 endpoint to 7 bits per channel and the p-bit closest to it
+ */
+void quantize_bc7_endpoint(const float endpoint[4], uint8_t quantized[4], uint8_t &p_bit)
+{
+	float best_error = std::numeric_limits<float>::max();
+
+	for (uint8_t p = 0; p < 2; ++p)
+	{
+		uint8_t candidate[4];
+		float   error = 0.0f;
+
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			int value    = std::min(127, std::max(0, static_cast<int>(std::lround((endpoint[c] - p) / 2.0f))));
+			candidate[c] = static_cast<uint8_t>(value);
+
+			float difference = (value * 2 + p) - endpoint[c];
+			error += difference * difference;
+		}
+
+		if (error < best_error)
+		{
+			best_error = error;
+			std::memcpy(quantized, candidate, 4);
+			p_bit = p;
+		}
+	}
+}
+
+/**
+ * @brief Finds the ETC1 table and pixel indices of a sub-block with a 4-bit base color
+ * @param texels Indices of the texels of the sub-block, in the column order of the pixel indices
+ * @return The error of the sub-block
+ */
+int encode_etc_sub_block(const uint8_t *rgba, const uint32_t texels[8], uint8_t color[3], uint8_t &table, uint8_t selectors[8])
+{
+	int sum[3]{};
+
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			sum[c] += rgba[texels[i] * 4 + c];
+		}
+	}
+
+	int base[3];
+
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		// Average quantized to 4 bits, which the decoder replicates to 8 bits
+		color[c] = static_cast<uint8_t>((sum[c] * 15 + 8 * 255 / 2) / (8 * 255));
+		base[c]  = color[c] * 17;
+	}
+
+	int best_error = std::numeric_limits<int>::max();
+
+	for (uint8_t candidate_table = 0; candidate_table < 8; ++candidate_table)
+	{
+		const int modifiers[4] = {etc_modifiers[candidate_table][0], etc_modifiers[candidate_table][1],
+		                          -etc_modifiers[candidate_table][0], -etc_modifiers[candidate_table][1]};
+
+		int     error = 0;
+		uint8_t candidate_selectors[8];
+
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			auto texel = rgba + texels[i] * 4;
+
+			int best_texel_error = std::numeric_limits<int>::max();
+
+			for (uint8_t selector = 0; selector < 4; ++selector)
+			{
+				int texel_error = 0;
+
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					int difference = clamp_byte(base[c] + modifiers[selector]) - texel[c];
+					texel_error += difference * difference;
+				}
+
+				if (texel_error < best_texel_error)
+				{
+					best_texel_error       = texel_error;
+					candidate_selectors[i] = selector;
+				}
+			}
+
+			error += best_texel_error;
+		}
+
+		if (error < best_error)
+		{
+			best_error = error;
+			table      = candidate_table;
+			std::memcpy(selectors, candidate_selectors, 8);
+		}
+	}
+
+	return best_error;
+}
+}        // namespace
+
+void encode_bc7_block(const uint8_t *rgba, uint8_t *output)
+{
+	float endpoints[2][4];
+	find_endpoints(rgba, 16, endpoints[0], endpoints[1]);
+
+	uint8_t quantized[2][4];
+	uint8_t p_bits[2];
+	quantize_bc7_endpoint(endpoints[0], quantized[0], p_bits[0]);
+	quantize_bc7_endpoint(endpoints[1], quantized[1], p_bits[1]);
+
+	// Palette of the block as the decoder interpolates it
+	int palette[16][4];
+
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			int color0 = quantized[0][c] * 2 + p_bits[0];
+			int color1 = quantized[1][c] * 2 + p_bits[1];
+
+			palette[i][c] = ((64 - bc7_weights[i]) * color0 + bc7_weights[i] * color1 + 32) >> 6;
+		}
+	}
+
+	uint8_t indices[16];
+
+	for (uint32_t texel = 0; texel < 16; ++texel)
+	{
+		int best_error = std::numeric_limits<int>::max();
+
+		for (uint8_t i = 0; i < 16; ++i)
+		{
+			int error = 0;
+
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				int difference = palette[i][c] - rgba[texel * 4 + c];
+				error += difference * difference;
+			}
+
+			if (error < best_error)
+			{
+				best_error     = error;
+				indices[texel] = i;
+			}
+		}
+	}
+
+	// The index of the first texel has an implicit zero top bit, the endpoints are swapped to clear it
+	if (indices[0] & 8)
+	{
+		std::swap(quantized[0], quantized[1]);
+		std::swap(p_bits[0], p_bits[1]);
+
+		for (auto &index : indices)
+		{
+			index = 15 - index;
+		}
+	}
+
+	std::memset(output, 0, 16);
+
+	uint32_t position = 0;
+
+	// Mode 6 is set by its bit
+	write_bits(output, position, 1 << 6, 7);
+
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		write_bits(output, position, quantized[0][c], 7);
+		write_bits(output, position, quantized[1][c], 7);
+	}
+
+	write_bits(output, position, p_bits[0], 1);
+	write_bits(output, position, p_bits[1], 1);
+
+	write_bits(output, position, indices[0], 3);
+
+	for (uint32_t texel = 1; texel < 16; ++texel)
+	{
+		write_bits(output, position, indices[texel], 4);
+	}
+}
+
+void encode_etc2_rgb_block(const uint8_t *rgba, uint8_t *output)
+{
+	int     best_error = std::numeric_limits<int>::max();
+	uint8_t best_flip{0};
+	uint8_t best_colors[2][3]{};
+	uint8_t best_tables[2]{};
+	uint8_t best_selectors[2][8]{};
+
+	// Sub-blocks are side by side (2x4 texels) without flip, one above the other (4x2 texels) with it
+	for (uint8_t flip = 0; flip < 2; ++flip)
+	{
+		int     error = 0;
+		uint8_t colors[2][3];
+		uint8_t tables[2];
+		uint8_t selectors[2][8];
+
+		for (uint32_t sub_block = 0; sub_block < 2; ++sub_block)
+		{
+			uint32_t texels[8];
+			uint32_t count = 0;
+
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				for (uint32_t y = 0; y < 4; ++y)
+				{
+					if ((flip ? y / 2 : x / 2) == sub_block)
+					{
+						texels[count++] = y * 4 + x;
+					}
+				}
+			}
+
+			error += encode_etc_sub_block(rgba, texels, colors[sub_block], tables[sub_block], selectors[sub_block]);
+		}
+
+		if (error < best_error)
+		{
+			best_error = error;
+			best_flip  = flip;
+			std::memcpy(best_colors, colors, sizeof(colors));
+			std::memcpy(best_tables, tables, sizeof(tables));
+			std::memcpy(best_selectors, selectors, sizeof(selectors));
+		}
+	}
+
+	// Individual mode, with the differential bit cleared
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		output[c] = static_cast<uint8_t>(best_colors[0][c] << 4 | best_colors[1][c]);
+	}
+
+	output[3] = static_cast<uint8_t>(best_tables[0] << 5 | best_tables[1] << 2 | best_flip);
+
+	// Pixel indices are stored in column order, the top bits of all the pixels first
+	uint32_t pixel_indices = 0;
+	uint32_t counts[2]{};
+
+	for (uint32_t x = 0; x < 4; ++x)
+	{
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			uint32_t sub_block = best_flip ? y / 2 : x / 2;
+			uint8_t  selector  = best_selectors[sub_block][counts[sub_block]++];
+			uint32_t pixel     = x * 4 + y;
+
+			pixel_indices |= static_cast<uint32_t>(selector >> 1) << (pixel + 16);
+			pixel_indices |= static_cast<uint32_t>(selector & 1) << pixel;
+		}
+	}
+
+	output[4] = static_cast<uint8_t>(pixel_indices >> 24);
+	output[5] = static_cast<uint8_t>(pixel_indices >> 16);
+	output[6] = static_cast<uint8_t>(pixel_indices >> 8);
+	output[7] = static_cast<uint8_t>(pixel_indices);
+}
+
+void encode_eac_alpha_block(const uint8_t *rgba, uint8_t *output)
+{
+	int min_alpha = 255;
+	int max_alpha = 0;
+
+	for (uint32_t texel = 0; texel < 16; ++texel)
+	{
+		min_alpha = std::min(min_alpha, static_cast<int>(rgba[texel * 4 + 3]));
+		max_alpha = std::max(max_alpha, static_cast<int>(rgba[texel * 4 + 3]));
+	}
+
+	int base = (min_alpha + max_alpha + 1) / 2;
+
+	int     best_error = std::numeric_limits<int>::max();
+	uint8_t best_table{0};
+	uint8_t best_multiplier{1};
+	uint8_t best_selectors[16]{};
+
+	for (uint8_t table = 0; table < 16 && best_error > 0; ++table)
+	{
+		for (uint8_t multiplier = 1; multiplier < 16; ++multiplier)
+		{
+			int     error = 0;
+			uint8_t selectors[16];
+
+			for (uint32_t texel = 0; texel < 16 && error < best_error; ++texel)
+			{
+				int alpha = rgba[texel * 4 + 3];
+
+				int best_texel_error = std::numeric_limits<int>::max();
+
+				for (uint8_t selector = 0; selector < 8; ++selector)
+				{
+					int difference = clamp_byte(base + eac_modifiers[table][selector] * multiplier) - alpha;
+
+					if (difference * difference < best_texel_error)
+					{
+						best_texel_error  = difference * difference;
+						selectors[texel] = selector;
+					}
+				}
+
+				error += best_texel_error;
+			}
+
+			if (error < best_error)
+			{
+				best_error      = error;
+				best_table      = table;
+				best_multiplier = multiplier;
+				std::memcpy(best_selectors, selectors, sizeof(selectors));
+			}
+		}
+	}
+
+	uint64_t bits = static_cast<uint64_t>(base) << 56 | static_cast<uint64_t>(best_multiplier) << 52 | static_cast<uint64_t>(best_table) << 48;
+
+	// Pixel indices are stored in column order, from the top bits
+	for (uint32_t x = 0; x < 4; ++x)
+	{
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			uint32_t pixel = x * 4 + y;
+
+			bits |= static_cast<uint64_t>(best_selectors[y * 4 + x]) << (45 - 3 * pixel);
+		}
+	}
+
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		output[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+	}
+}
+
+void encode_astc_block(const uint8_t *rgba, uint32_t block_width, uint32_t block_height, uint8_t *output)
+{
+	uint32_t texel_count = block_width * block_height;
+
+	float endpoints[2][4];
+	find_endpoints(rgba, texel_count, endpoints[0], endpoints[1]);
+
+	uint8_t quantized[2][4];
+
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			quantized[i][c] = static_cast<uint8_t>(clamp_byte(static_cast<int>(std::lround(endpoints[i][c]))));
+		}
+	}
+
+	// The decoder swaps the endpoints when the first one is brighter, and blue contracts them
+	if (quantized[1][0] + quantized[1][1] + quantized[1][2] < quantized[0][0] + quantized[0][1] + quantized[0][2])
+	{
+		std::swap(quantized[0], quantized[1]);
+	}
+
+	// Ideal weight of each texel along the endpoints, from 0 to 64
+	float direction[4];
+	float length_squared = 0.0f;
+
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		direction[c] = static_cast<float>(quantized[1][c] - quantized[0][c]);
+		length_squared += direction[c] * direction[c];
+	}
+
+	float ideal_weights[MAX_ASTC_TEXELS]{};
+
+	if (length_squared > 0.0f)
+	{
+		for (uint32_t texel = 0; texel < texel_count; ++texel)
+		{
+			float t = 0.0f;
+
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				t += (rgba[texel * 4 + c] - quantized[0][c]) * direction[c];
+			}
+
+			ideal_weights[texel] = std::min(1.0f, std::max(0.0f, t / length_squared)) * 64.0f;
+		}
+	}
+
+	// Each grid weight averages the texels it contributes to, through the bilinear infill of the decoder
+	float weight_sums[ASTC_GRID_SIZE * ASTC_GRID_SIZE]{};
+	float contributions[ASTC_GRID_SIZE * ASTC_GRID_SIZE]{};
+
+	uint32_t scale_s = (1024 + block_width / 2) / (block_width - 1);
+	uint32_t scale_t = (1024 + block_height / 2) / (block_height - 1);
+
+	for (uint32_t t = 0; t < block_height; ++t)
+	{
+		for (uint32_t s = 0; s < block_width; ++s)
+		{
+			uint32_t grid_s = (scale_s * s * (ASTC_GRID_SIZE - 1) + 32) >> 6;
+			uint32_t grid_t = (scale_t * t * (ASTC_GRID_SIZE - 1) + 32) >> 6;
+
+			uint32_t fraction_s = grid_s & 0xF;
+			uint32_t fraction_t = grid_t & 0xF;
+			uint32_t first      = (grid_s >> 4) + (grid_t >> 4) * ASTC_GRID_SIZE;
+
+			uint32_t w11 = (fraction_s * fraction_t + 8) >> 4;
+
+			const uint32_t grid_indices[4] = {first, first + 1, first + ASTC_GRID_SIZE, first + ASTC_GRID_SIZE + 1};
+			const uint32_t grid_weights[4] = {16 - fraction_s - fraction_t + w11, fraction_s - w11, fraction_t - w11, w11};
+
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				// Zero weights may point past the edge of the grid
+				if (grid_weights[i] > 0)
+				{
+					weight_sums[grid_indices[i]] += ideal_weights[t * block_width + s] * grid_weights[i];
+					contributions[grid_indices[i]] += static_cast<float>(grid_weights[i]);
+				}
+			}
+		}
+	}
+
+	std::memset(output, 0, 16);
+
+	uint32_t position = 0;
+
+	write_bits(output, position, ASTC_BLOCK_MODE, 11);
+
+	// A single partition
+	write_bits(output, position, 0, 2);
+	write_bits(output, position, ASTC_CEM_LDR_RGBA_DIRECT, 4);
+
+	// The remaining bits fit 8-bit endpoints, in the order r0 r1 g0 g1 b0 b1 a0 a1
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		write_bits(output, position, quantized[0][c], 8);
+		write_bits(output, position, quantized[1][c], 8);
+	}
+
+	// Weights are stored from the top bit of the block downwards, quantized to 0, 21, 43 and 64
+	for (uint32_t i = 0; i < ASTC_GRID_SIZE * ASTC_GRID_SIZE; ++i)
+	{
+		float weight = contributions[i] > 0.0f ? weight_sums[i] / contributions[i] : 0.0f;
+
+		uint32_t quantized_weight = std::min(3u, static_cast<uint32_t>(std::lround(weight * 3.0f / 64.0f)));
+
+		for (uint32_t bit = 0; bit < 2; ++bit)
+		{
+			if ((quantized_weight >> bit) & 1)
+			{
+				uint32_t bit_position = 127 - (i * 2 + bit);
+
+				output[bit_position / 8] |= static_cast<uint8_t>(1 << (bit_position % 8));
+			}
+		}
+	}
+}
+}        // namespace sg
+}        // namespace vkb
@@ -0,0 +1,66 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace vkb
+{
+namespace sg
+{
+/*
+ * Encoders of one block of RGBA8 texels given in rows, used to compress images at runtime.
+ * They are fast as they only search a few of the modes of each format, so offline
+ * encoders reach a much higher quality. Blocks hold 4x4 texels unless stated otherwise.
+ */
+
+/**
+ * @brief Encodes a BC7 block in mode 6, a single subset of RGBA endpoints with 4-bit indices
+ * @param rgba The 16 texels of the block
+ * @param output The 16 bytes of the block
+ */
+void encode_bc7_block(const uint8_t *rgba, uint8_t *output);
+
+/**
+ * @brief Encodes an ETC2 RGB block in the individual mode it shares with ETC1, alpha is ignored
+ * @param rgba The 16 texels of the block
+ * @param output The 8 bytes of the block
+ */
+void encode_etc2_rgb_block(const uint8_t *rgba, uint8_t *output);
+
+/**
+ * @brief Encodes the alpha of the texels as an EAC block, which precedes the RGB block in ETC2 RGBA blocks
+ * @param rgba The 16 texels of the block
+ * @param output The 8 bytes of the block
+ */
+void encode_eac_alpha_block(const uint8_t *rgba, uint8_t *output);
+
+/**
+ * @brief Encodes an ASTC block with a single partition of LDR RGBA endpoints and a 4x4 grid of 2-bit weights,
+ *        which the decoder interpolates over larger footprints
+ * @param rgba The block_width * block_height texels of the block
+ * @param block_width Width of the footprint, from 4 to 12
+ * @param block_height Height of the footprint, from 4 to 12
+ * @param output The 16 bytes of the block
+ */
+void encode_astc_block(const uint8_t *rgba, uint32_t block_width, uint32_t block_height, uint8_t *output);
+}        // namespace sg
+}        // namespace vkb
@@ -63,11 +63,11 @@ static KTX_error_code KTXAPIENTRY optimal_tiling_callback(int mip_level,
 	return KTX_SUCCESS;
 }
 
-Ktx::Ktx(const std::string &name, const std::vector<uint8_t> &data) :
+Ktx::Ktx(const std::string &name, const uint8_t *data, size_t size) :
     Image{name}
 {
-	auto data_buffer = reinterpret_cast<const ktx_uint8_t *>(data.data());
-	auto data_size   = static_cast<ktx_size_t>(data.size());
+	auto data_buffer = reinterpret_cast<const ktx_uint8_t *>(data);
+	auto data_size   = static_cast<ktx_size_t>(size);
 
 	ktxTexture *texture;
 	auto        load_ktx_result = ktxTexture_CreateFromMemory(data_buffer,
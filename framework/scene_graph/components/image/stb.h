@@ -29,7 +29,7 @@ namespace sg
 class Stb : public Image
 {
   public:
-	Stb(const std::string &name, const std::vector<uint8_t> &data);
+	Stb(const std::string &name, const uint8_t *data, size_t size);
 
 	virtual ~Stb() = default;
 };
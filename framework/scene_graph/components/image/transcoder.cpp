@@ -0,0 +1,274 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "scene_graph/components/image/transcoder.h"
+
+#include <cstring>
+#include <mutex>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+VKBP_ENABLE_WARNINGS()
+
+#include "common/utils.h"
+#include "scene_graph/components/image/astc.h"
+#include "scene_graph/components/image/block_encoder.h"
+
+namespace vkb
+{
+namespace sg
+{
+namespace
+{
+/// Number of blocks compressed by one task
+const uint32_t COMPRESS_RANGE_BLOCKS = 1024;
+
+bool is_astc_srgb(VkFormat format)
+{
+	switch (format)
+	{
+		case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_5x4_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_6x5_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_8x5_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_8x6_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_10x5_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_10x6_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_10x8_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_10x10_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_12x10_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_12x12_SRGB_BLOCK:
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool is_opaque(const std::vector<uint8_t> &rgba)
+{
+	for (size_t i = 3; i < rgba.size(); i += 4)
+	{
+		if (rgba[i] != 255)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Compresses one level of RGBA8 data block by block, edge texels are repeated to fill partial blocks
+ * @param block_size Size of a compressed block in bytes
+ * @param encode_block Encodes the texels of a block, given in rows, to its output
+ */
+template <class F>
+void compress_level(const uint8_t *src, VkExtent3D extent, uint32_t block_width, uint32_t block_height, uint32_t block_size,
+                    uint8_t *dst, JobSystem *job_system, F encode_block)
+{
+	uint32_t blocks_x = (extent.width + block_width - 1) / block_width;
+	uint32_t blocks_y = (extent.height + block_height - 1) / block_height;
+
+	auto compress_rows = [&](uint32_t row_begin, uint32_t row_end) {
+		uint8_t block[12 * 12 * 4];
+
+		for (uint32_t block_y = row_begin; block_y < row_end; block_y++)
+		{
+			for (uint32_t block_x = 0; block_x < blocks_x; block_x++)
+			{
+				for (uint32_t y = 0; y < block_height; y++)
+				{
+					uint32_t src_y = std::min(block_y * block_height + y, extent.height - 1);
+
+					for (uint32_t x = 0; x < block_width; x++)
+					{
+						uint32_t src_x = std::min(block_x * block_width + x, extent.width - 1);
+
+						std::memcpy(block + (y * block_width + x) * 4, src + (static_cast<size_t>(src_y) * extent.width + src_x) * 4, 4);
+					}
+				}
+
+				encode_block(block, dst + (static_cast<size_t>(block_y) * blocks_x + block_x) * block_size);
+			}
+		}
+	};
+
+	parallel_for_ranges(job_system, blocks_y, std::max(1u, COMPRESS_RANGE_BLOCKS / blocks_x), compress_rows);
+}
+
+/**
+ * @brief Compresses the levels of an RGBA8 image into a transcoded image
+ */
+template <class F>
+std::unique_ptr<Image> compress_image(const Image &source, VkFormat format, uint32_t block_width, uint32_t block_height, uint32_t block_size,
+                                      JobSystem *job_system, F encode_block)
+{
+	std::vector<Mipmap> mipmaps;
+
+	size_t data_size = 0;
+	for (auto &source_mipmap : source.get_mipmaps())
+	{
+		Mipmap mipmap{source_mipmap};
+		mipmap.offset = to_u32(data_size);
+		mipmaps.push_back(mipmap);
+
+		data_size += static_cast<size_t>((mipmap.extent.width + block_width - 1) / block_width) *
+		             ((mipmap.extent.height + block_height - 1) / block_height) * block_size;
+	}
+
+	std::vector<uint8_t> data(data_size);
+
+	for (size_t level = 0; level < mipmaps.size(); level++)
+	{
+		auto &source_mipmap = source.get_mipmaps()[level];
+
+		compress_level(source.get_data().data() + source_mipmap.offset, source_mipmap.extent, block_width, block_height, block_size,
+		               data.data() + mipmaps[level].offset, job_system, encode_block);
+	}
+
+	return std::make_unique<TranscodedImage>(source.get_name(), std::move(data), std::move(mipmaps), format);
+}
+}        // namespace
+
+TranscodedImage::TranscodedImage(const std::string &name, std::vector<uint8_t> &&data, std::vector<Mipmap> &&mipmaps, VkFormat format) :
+    Image{name, std::move(data), std::move(mipmaps)}
+{
+	set_format(format);
+}
+
+bool AstcToBcTranscoder::can_transcode(VkFormat format) const
+{
+	return is_astc(format);
+}
+
+std::vector<VkFormat> AstcToBcTranscoder::get_target_formats(const Image &image) const
+{
+	return {is_astc_srgb(image.get_format()) ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK};
+}
+
+std::unique_ptr<Image> AstcToBcTranscoder::transcode(const Image &image, VkFormat target_format, JobSystem *job_system) const
+{
+	// Older versions of stb_dxt build their tables on first use, which is not thread safe
+	static std::once_flag stb_dxt_initialized;
+	std::call_once(stb_dxt_initialized, []() {
+		uint8_t block[16 * 4]{};
+		uint8_t output[16];
+		stb_compress_dxt_block(output, block, 1, STB_DXT_HIGHQUAL);
+	});
+
+	Astc decoded{image, job_system};
+	decoded.generate_mipmaps(job_system);
+
+	bool alpha = !is_opaque(decoded.get_data());
+
+	VkFormat format = target_format;
+	if (!alpha)
+	{
+		format = target_format == VK_FORMAT_BC3_SRGB_BLOCK ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	}
+
+	return compress_image(decoded, format, 4, 4, alpha ? 16 : 8, job_system, [alpha](const uint8_t *block, uint8_t *output) {
+		stb_compress_dxt_block(output, block, alpha ? 1 : 0, STB_DXT_HIGHQUAL);
+	});
+}
+
+bool RgbaTranscoder::can_transcode(VkFormat format) const
+{
+	return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+std::vector<VkFormat> RgbaTranscoder::get_target_formats(const Image &image) const
+{
+	if (image.get_format() == VK_FORMAT_R8G8B8A8_SRGB)
+	{
+		return {VK_FORMAT_ASTC_4x4_SRGB_BLOCK, VK_FORMAT_ASTC_6x6_SRGB_BLOCK, VK_FORMAT_ASTC_8x8_SRGB_BLOCK,
+		        VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK};
+	}
+
+	return {VK_FORMAT_ASTC_4x4_UNORM_BLOCK, VK_FORMAT_ASTC_6x6_UNORM_BLOCK, VK_FORMAT_ASTC_8x8_UNORM_BLOCK,
+	        VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, VK_FORMAT_BC7_UNORM_BLOCK};
+}
+
+std::unique_ptr<Image> RgbaTranscoder::transcode(const Image &image, VkFormat target_format, JobSystem *job_system) const
+{
+	// Block compressed levels cannot be generated on the GPU, so the mip chain is generated first
+	TranscodedImage source{image.get_name(), std::vector<uint8_t>{image.get_data()}, std::vector<Mipmap>{image.get_mipmaps()}, image.get_format()};
+
+	if (source.get_mipmaps().size() == 1)
+	{
+		source.generate_mipmaps(job_system);
+	}
+
+	switch (target_format)
+	{
+		case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+		{
+			uint32_t block_width = 4;
+
+			if (target_format == VK_FORMAT_ASTC_6x6_UNORM_BLOCK || target_format == VK_FORMAT_ASTC_6x6_SRGB_BLOCK)
+			{
+				block_width = 6;
+			}
+			else if (target_format == VK_FORMAT_ASTC_8x8_UNORM_BLOCK || target_format == VK_FORMAT_ASTC_8x8_SRGB_BLOCK)
+			{
+				block_width = 8;
+			}
+
+			uint32_t block_height = block_width;
+
+			return compress_image(source, target_format, block_width, block_height, 16, job_system, [block_width, block_height](const uint8_t *block, uint8_t *output) {
+				encode_astc_block(block, block_width, block_height, output);
+			});
+		}
+		case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+		{
+			if (is_opaque(source.get_data()))
+			{
+				auto format = target_format == VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK ? VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK : VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
+
+				return compress_image(source, format, 4, 4, 8, job_system, encode_etc2_rgb_block);
+			}
+
+			return compress_image(source, target_format, 4, 4, 16, job_system, [](const uint8_t *block, uint8_t *output) {
+				encode_eac_alpha_block(block, output);
+				encode_etc2_rgb_block(block, output + 8);
+			});
+		}
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			return compress_image(source, target_format, 4, 4, 16, job_system, encode_bc7_block);
+		default:
+			throw std::runtime_error{"Unsupported target format " + convert_format_to_string(target_format)};
+	}
+}
+}        // namespace sg
+}        // namespace vkb
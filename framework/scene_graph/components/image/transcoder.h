@@ -0,0 +1,98 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "common/vk_common.h"
+#include "scene_graph/components/image.h"
+
+namespace vkb
+{
+namespace sg
+{
+/**
+ * @brief Image built from already processed data, used for the output of transcoders
+ */
+class TranscodedImage : public Image
+{
+  public:
+	TranscodedImage(const std::string &name, std::vector<uint8_t> &&data, std::vector<Mipmap> &&mipmaps, VkFormat format);
+
+	virtual ~TranscodedImage() = default;
+};
+
+/**
+ * @brief Converts images to a GPU format supported by the device, see Image::add_transcoder
+ */
+class ImageTranscoder
+{
+  public:
+	virtual ~ImageTranscoder() = default;
+
+	/**
+	 * @return Whether the transcoder can convert images of this format
+	 */
+	virtual bool can_transcode(VkFormat format) const = 0;
+
+	/**
+	 * @return The formats the image can be transcoded to, in order of preference
+	 */
+	virtual std::vector<VkFormat> get_target_formats(const Image &image) const = 0;
+
+	/**
+	 * @brief Transcodes an image, including its full mip chain
+	 * @param image The image to transcode
+	 * @param target_format One of the formats returned by get_target_formats
+	 * @param job_system Optional job system used to split the work
+	 * @return The transcoded image
+	 */
+	virtual std::unique_ptr<Image> transcode(const Image &image, VkFormat target_format, JobSystem *job_system) const = 0;
+};
+
+/**
+ * @brief Transcodes ASTC images to BC3, or BC1 for opaque images
+ *        Both formats are covered by the textureCompressionBC feature of desktop GPUs
+ */
+class AstcToBcTranscoder : public ImageTranscoder
+{
+  public:
+	bool can_transcode(VkFormat format) const override;
+
+	std::vector<VkFormat> get_target_formats(const Image &image) const override;
+
+	std::unique_ptr<Image> transcode(const Image &image, VkFormat target_format, JobSystem *job_system) const override;
+};
+
+/**
+ * @brief Compresses RGBA8 images to ASTC (4x4, 6x6 or 8x8), ETC2 or BC7 after generating their mip chain,
+ *        so that formats can be compared at runtime. The encoders favour speed over quality, see block_encoder.h.
+ *        Images without alpha are stored as ETC2 RGB rather than ETC2 RGBA
+ */
+class RgbaTranscoder : public ImageTranscoder
+{
+  public:
+	bool can_transcode(VkFormat format) const override;
+
+	std::vector<VkFormat> get_target_formats(const Image &image) const override;
+
+	std::unique_ptr<Image> transcode(const Image &image, VkFormat target_format, JobSystem *job_system) const override;
+};
+}        // namespace sg
+}        // namespace vkb
@@ -36,6 +36,7 @@ std::type_index Light::get_type()
 void Light::set_node(Node &n)
 {
 	node = &n;
+	version++;
 }
 
 Node *Light::get_node()
@@ -46,6 +47,7 @@ Node *Light::get_node()
 void Light::set_light_type(const LightType &type)
 {
 	this->light_type = type;
+	version++;
 }
 
 const LightType &Light::get_light_type()
@@ -56,6 +58,7 @@ const LightType &Light::get_light_type()
 void Light::set_properties(const LightProperties &properties)
 {
 	this->properties = properties;
+	version++;
 }
 
 const LightProperties &Light::get_properties()
@@ -63,5 +66,10 @@ const LightProperties &Light::get_properties()
 	return properties;
 }
 
+uint32_t Light::get_version() const
+{
+	return version;
+}
+
 }        // namespace sg
 }        // namespace vkb
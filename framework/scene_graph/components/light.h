@@ -83,12 +83,19 @@ class Light : public Component
 
 	const LightProperties &get_properties();
 
+	/**
+	 * @return Incremented each time the node, type or properties of the light are set
+	 */
+	uint32_t get_version() const;
+
   private:
 	Node *node{nullptr};
 
 	LightType light_type;
 
 	LightProperties properties;
+
+	uint32_t version{0};
 };
 
 }        // namespace sg
@@ -20,6 +20,8 @@
 
 #include "perspective_camera.h"
 
+#include <cmath>
+
 VKBP_DISABLE_WARNINGS()
 #include <glm/gtc/matrix_transform.hpp>
 VKBP_ENABLE_WARNINGS()
@@ -47,6 +49,26 @@ void PerspectiveCamera::set_near_plane(float znear)
 	near_plane = znear;
 }
 
+void PerspectiveCamera::set_infinite_far_plane(bool infinite)
+{
+	infinite_far_plane = infinite;
+}
+
+bool PerspectiveCamera::has_infinite_far_plane() const
+{
+	return infinite_far_plane;
+}
+
+void PerspectiveCamera::set_jitter(const glm::vec2 &new_jitter)
+{
+	jitter = new_jitter;
+}
+
+const glm::vec2 &PerspectiveCamera::get_jitter() const
+{
+	return jitter;
+}
+
 void PerspectiveCamera::set_aspect_ratio(float new_aspect_ratio)
 {
 	aspect_ratio = new_aspect_ratio;
@@ -67,8 +89,31 @@ float PerspectiveCamera::get_aspect_ratio()
 
 glm::mat4 PerspectiveCamera::get_projection()
 {
-	// Note: Using Revsered depth-buffer for increased precision, so Znear and Zfar are flipped
-	return glm::perspective(get_field_of_view(), aspect_ratio, far_plane, near_plane);
+	glm::mat4 projection;
+
+	if (infinite_far_plane)
+	{
+		// Limit of the reversed projection below as Zfar goes to infinity: the depth is Znear / -z,
+		// which is 1 on the near plane and tends to 0 far away
+		float focal_length = 1.0f / std::tan(get_field_of_view() / 2.0f);
+
+		projection       = glm::mat4{0.0f};
+		projection[0][0] = focal_length / aspect_ratio;
+		projection[1][1] = focal_length;
+		projection[2][3] = -1.0f;
+		projection[3][2] = near_plane;
+	}
+	else
+	{
+		// Note: Using Revsered depth-buffer for increased precision, so Znear and Zfar are flipped
+		projection = glm::perspective(get_field_of_view(), aspect_ratio, far_plane, near_plane);
+	}
+
+	// Scaled by the view depth, which is -w, the offset is constant after the perspective divide
+	projection[2][0] -= jitter.x;
+	projection[2][1] -= jitter.y;
+
+	return projection;
 }
 }        // namespace sg
 }        // namespace vkb
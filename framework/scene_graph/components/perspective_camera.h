@@ -53,6 +53,23 @@ class PerspectiveCamera : public Camera
 
 	void set_near_plane(float znear);
 
+	/**
+	 * @brief Moves the far plane to infinity, keeping the reversed depth so that the
+	 *        depth buffer precision is spent close to the camera and nothing is clipped far away
+	 */
+	void set_infinite_far_plane(bool infinite);
+
+	bool has_infinite_far_plane() const;
+
+	/**
+	 * @brief Offsets the projection by a fraction of a pixel, so that the frames sample different
+	 *        positions within the pixels for a temporal upscaler to accumulate
+	 * @param jitter Offset in normalized device coordinates, zero to disable
+	 */
+	void set_jitter(const glm::vec2 &jitter);
+
+	const glm::vec2 &get_jitter() const;
+
 	float get_aspect_ratio();
 
 	float get_field_of_view();
@@ -73,6 +90,10 @@ class PerspectiveCamera : public Camera
 	float far_plane{100.0};
 
 	float near_plane{0.1f};
+
+	bool infinite_far_plane{false};
+
+	glm::vec2 jitter{0.0f};
 };
 }        // namespace sg
 }        // namespace vkb
@@ -35,7 +35,11 @@ namespace sg
 class Sampler : public Component
 {
   public:
-	Sampler(const std::string &name, core::Sampler &&vk_sampler);
+	/**
+	 * @param name The name of the sampler
+	 * @param vk_sampler The Vulkan sampler, owned by the resource cache and shared with identical samplers
+	 */
+	Sampler(const std::string &name, const core::Sampler &vk_sampler);
 
 	Sampler(Sampler &&other) = default;
 
@@ -43,7 +47,7 @@ class Sampler : public Component
 
 	virtual std::type_index get_type() override;
 
-	core::Sampler vk_sampler;
+	const core::Sampler &vk_sampler;
 };
 }        // namespace sg
 }        // namespace vkb
@@ -0,0 +1,62 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "skin.h"
+
+#include "scene_graph/node.h"
+
+namespace vkb
+{
+namespace sg
+{
+Skin::Skin(const std::string &name) :
+    Component{name}
+{}
+
+std::type_index Skin::get_type()
+{
+	return typeid(Skin);
+}
+
+void Skin::add_joint(Node &joint, const glm::mat4 &inverse_bind_matrix)
+{
+	joints.push_back(&joint);
+	inverse_bind_matrices.push_back(inverse_bind_matrix);
+}
+
+const std::vector<Node *> &Skin::get_joints() const
+{
+	return joints;
+}
+
+const std::vector<glm::mat4> &Skin::get_inverse_bind_matrices() const
+{
+	return inverse_bind_matrices;
+}
+
+void Skin::write_joint_matrices(glm::mat4 *palette) const
+{
+	for (size_t i = 0; i < joints.size(); ++i)
+	{
+		palette[i] = joints[i]->get_transform().get_render_state().world_matrix * inverse_bind_matrices[i];
+	}
+}
+}        // namespace sg
+}        // namespace vkb
@@ -0,0 +1,80 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+#include "scene_graph/component.h"
+
+namespace vkb
+{
+namespace sg
+{
+class Node;
+
+/**
+ * @brief Joints deforming the vertices of the meshes of the nodes it is attached to. Skinned
+ *        vertices are moved to world space by their joints, the transform of the node is not applied
+ */
+class Skin : public Component
+{
+  public:
+	Skin(const std::string &name);
+
+	Skin(Skin &&other) = default;
+
+	virtual ~Skin() = default;
+
+	virtual std::type_index get_type() override;
+
+	/**
+	 * @brief Adds a joint, which vertices reference by the order joints are added in
+	 * @param joint Node of the joint
+	 * @param inverse_bind_matrix Transforms the vertices from model space to the space of the joint
+	 */
+	void add_joint(Node &joint, const glm::mat4 &inverse_bind_matrix);
+
+	const std::vector<Node *> &get_joints() const;
+
+	const std::vector<glm::mat4> &get_inverse_bind_matrices() const;
+
+	/**
+	 * @brief Writes the matrix of each joint, from the render state of its node, to the palette read by the skinning shaders
+	 * @param palette Destination of get_joints().size() matrices
+	 */
+	void write_joint_matrices(glm::mat4 *palette) const;
+
+  private:
+	std::vector<Node *> joints;
+
+	std::vector<glm::mat4> inverse_bind_matrices;
+};
+}        // namespace sg
+}        // namespace vkb
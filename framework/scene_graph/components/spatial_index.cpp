@@ -0,0 +1,440 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include "common/helpers.h"
+#include "rendering/culling.h"
+#include "scene_graph/components/aabb.h"
+#include "scene_graph/components/mesh.h"
+#include "scene_graph/components/transform.h"
+#include "scene_graph/node.h"
+
+namespace vkb
+{
+namespace sg
+{
+namespace
+{
+const uint32_t NO_PARENT = ~0u;
+
+/// Depth of the traversals, the median splits keep the hierarchy balanced
+const size_t MAX_DEPTH = 64;
+
+void get_world_bounds(const Mesh &mesh, const glm::mat4 &world_matrix, glm::vec3 &min, glm::vec3 &max)
+{
+	auto &bounds = mesh.get_bounds();
+
+	glm::vec3 center  = glm::vec3(world_matrix * glm::vec4(bounds.get_center(), 1.0f));
+	glm::vec3 extents = 0.5f * (bounds.get_max() - bounds.get_min());
+
+	glm::vec3 world_extents = glm::abs(glm::vec3(world_matrix[0])) * extents.x +
+	                          glm::abs(glm::vec3(world_matrix[1])) * extents.y +
+	                          glm::abs(glm::vec3(world_matrix[2])) * extents.z;
+
+	min = center - world_extents;
+	max = center + world_extents;
+}
+
+enum class Containment
+{
+	Outside,
+	Intersects,
+	Inside
+};
+
+Containment classify(const Frustum &frustum, const glm::vec3 &min, const glm::vec3 &max)
+{
+	glm::vec3 center  = 0.5f * (min + max);
+	glm::vec3 extents = 0.5f * (max - min);
+
+	auto result = Containment::Inside;
+
+	for (auto &plane : frustum.get_planes())
+	{
+		glm::vec3 normal{plane};
+
+		float distance = glm::dot(normal, center) + plane.w;
+		float radius   = glm::dot(glm::abs(normal), extents);
+
+		if (distance + radius < 0.0f)
+		{
+			return Containment::Outside;
+		}
+
+		if (distance - radius < 0.0f)
+		{
+			result = Containment::Intersects;
+		}
+	}
+
+	return result;
+}
+
+bool intersects_sphere(const glm::vec3 &min, const glm::vec3 &max, const glm::vec3 &center, float radius)
+{
+	glm::vec3 offset = center - glm::clamp(center, min, max);
+
+	return glm::dot(offset, offset) <= radius * radius;
+}
+
+/**
+ * @return The distance at which the ray enters the box, a negative value if it misses it
+ */
+float intersect_ray(const glm::vec3 &min, const glm::vec3 &max, const glm::vec3 &origin, const glm::vec3 &inverse_direction, float max_distance)
+{
+	glm::vec3 t0 = (min - origin) * inverse_direction;
+	glm::vec3 t1 = (max - origin) * inverse_direction;
+
+	glm::vec3 near_t = glm::min(t0, t1);
+	glm::vec3 far_t  = glm::max(t0, t1);
+
+	float enter = std::max(std::max(near_t.x, near_t.y), std::max(near_t.z, 0.0f));
+	float exit  = std::min(std::min(far_t.x, far_t.y), std::min(far_t.z, max_distance));
+
+	return enter <= exit ? enter : -1.0f;
+}
+}        // namespace
+
+SpatialIndex::SpatialIndex(const std::string &name) :
+    Component{name}
+{
+}
+
+std::type_index SpatialIndex::get_type()
+{
+	return typeid(SpatialIndex);
+}
+
+void SpatialIndex::build(const std::vector<Mesh *> &meshes)
+{
+	items.clear();
+	nodes.clear();
+
+	for (auto mesh : meshes)
+	{
+		for (auto node : mesh->get_nodes())
+		{
+			auto &render_state = node->get_transform().get_render_state();
+
+			Item item{node, mesh, {}, {}, render_state.version};
+
+			get_world_bounds(*mesh, render_state.world_matrix, item.min, item.max);
+
+			items.push_back(item);
+		}
+	}
+
+	item_leaves.resize(items.size());
+
+	if (items.empty())
+	{
+		return;
+	}
+
+	nodes.reserve(2 * (items.size() / MAX_LEAF_SIZE + 1));
+
+	nodes.push_back({});
+	nodes[0].parent = NO_PARENT;
+
+	build_node(0, 0, to_u32(items.size()));
+}
+
+void SpatialIndex::build_node(uint32_t node_index, uint32_t begin, uint32_t end)
+{
+	nodes[node_index].begin       = begin;
+	nodes[node_index].end         = end;
+	nodes[node_index].first_child = 0;
+
+	if (end - begin <= MAX_LEAF_SIZE)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			item_leaves[i] = node_index;
+		}
+
+		update_bounds(nodes[node_index]);
+		return;
+	}
+
+	// Split at the median of the centers along the axis they spread the most
+	glm::vec3 center_min{std::numeric_limits<float>::max()};
+	glm::vec3 center_max{std::numeric_limits<float>::lowest()};
+
+	for (uint32_t i = begin; i < end; i++)
+	{
+		glm::vec3 center = items[i].min + items[i].max;
+
+		center_min = glm::min(center_min, center);
+		center_max = glm::max(center_max, center);
+	}
+
+	glm::vec3 spread = center_max - center_min;
+
+	int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+
+	uint32_t middle = begin + (end - begin) / 2;
+
+	std::nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end, [axis](const Item &a, const Item &b) {
+		return a.min[axis] + a.max[axis] < b.min[axis] + b.max[axis];
+	});
+
+	auto first_child = to_u32(nodes.size());
+
+	nodes.resize(nodes.size() + 2);
+
+	nodes[node_index].first_child = first_child;
+	nodes[first_child].parent     = node_index;
+	nodes[first_child + 1].parent = node_index;
+
+	build_node(first_child, begin, middle);
+	build_node(first_child + 1, middle, end);
+
+	update_bounds(nodes[node_index]);
+}
+
+void SpatialIndex::update_bounds(BvhNode &node) const
+{
+	if (node.first_child != 0)
+	{
+		auto &left  = nodes[node.first_child];
+		auto &right = nodes[node.first_child + 1];
+
+		node.min = glm::min(left.min, right.min);
+		node.max = glm::max(left.max, right.max);
+		return;
+	}
+
+	node.min = glm::vec3{std::numeric_limits<float>::max()};
+	node.max = glm::vec3{std::numeric_limits<float>::lowest()};
+
+	for (uint32_t i = node.begin; i < node.end; i++)
+	{
+		node.min = glm::min(node.min, items[i].min);
+		node.max = glm::max(node.max, items[i].max);
+	}
+}
+
+size_t SpatialIndex::refit()
+{
+	dirty_nodes.assign(nodes.size(), 0);
+
+	size_t changed = 0;
+
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		auto &item         = items[i];
+		auto &render_state = item.node->get_transform().get_render_state();
+
+		if (render_state.version == item.transform_version)
+		{
+			continue;
+		}
+
+		get_world_bounds(*item.mesh, render_state.world_matrix, item.min, item.max);
+
+		item.transform_version = render_state.version;
+
+		dirty_nodes[item_leaves[i]] = 1;
+
+		changed++;
+	}
+
+	if (changed == 0)
+	{
+		return 0;
+	}
+
+	// Children come after their parent, so they are updated first
+	for (size_t i = nodes.size(); i-- > 0;)
+	{
+		if (!dirty_nodes[i])
+		{
+			continue;
+		}
+
+		update_bounds(nodes[i]);
+
+		if (nodes[i].parent != NO_PARENT)
+		{
+			dirty_nodes[nodes[i].parent] = 1;
+		}
+	}
+
+	return changed;
+}
+
+void SpatialIndex::query(const Frustum &frustum, std::vector<const Item *> &result) const
+{
+	result.clear();
+
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	std::array<uint32_t, MAX_DEPTH> stack;
+	size_t                          stack_size = 0;
+
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0)
+	{
+		auto &node = nodes[stack[--stack_size]];
+
+		auto containment = classify(frustum, node.min, node.max);
+
+		if (containment == Containment::Outside)
+		{
+			continue;
+		}
+
+		// Everything below a node inside the frustum is visible, without testing it
+		if (containment == Containment::Inside)
+		{
+			for (uint32_t i = node.begin; i < node.end; i++)
+			{
+				result.push_back(&items[i]);
+			}
+		}
+		else if (node.first_child != 0)
+		{
+			stack[stack_size++] = node.first_child;
+			stack[stack_size++] = node.first_child + 1;
+		}
+		else
+		{
+			for (uint32_t i = node.begin; i < node.end; i++)
+			{
+				if (classify(frustum, items[i].min, items[i].max) != Containment::Outside)
+				{
+					result.push_back(&items[i]);
+				}
+			}
+		}
+	}
+}
+
+void SpatialIndex::query(const glm::vec3 &center, float radius, std::vector<const Item *> &result) const
+{
+	result.clear();
+
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	std::array<uint32_t, MAX_DEPTH> stack;
+	size_t                          stack_size = 0;
+
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0)
+	{
+		auto &node = nodes[stack[--stack_size]];
+
+		if (!intersects_sphere(node.min, node.max, center, radius))
+		{
+			continue;
+		}
+
+		if (node.first_child != 0)
+		{
+			stack[stack_size++] = node.first_child;
+			stack[stack_size++] = node.first_child + 1;
+			continue;
+		}
+
+		for (uint32_t i = node.begin; i < node.end; i++)
+		{
+			if (intersects_sphere(items[i].min, items[i].max, center, radius))
+			{
+				result.push_back(&items[i]);
+			}
+		}
+	}
+}
+
+void SpatialIndex::query_ray(const glm::vec3 &origin, const glm::vec3 &direction, float max_distance, std::vector<const Item *> &result) const
+{
+	result.clear();
+
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	// Axes the ray is parallel to get infinite slabs, which still compare correctly
+	glm::vec3 inverse_direction = 1.0f / direction;
+
+	std::vector<std::pair<float, const Item *>> hits;
+
+	std::array<uint32_t, MAX_DEPTH> stack;
+	size_t                          stack_size = 0;
+
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0)
+	{
+		auto &node = nodes[stack[--stack_size]];
+
+		if (intersect_ray(node.min, node.max, origin, inverse_direction, max_distance) < 0.0f)
+		{
+			continue;
+		}
+
+		if (node.first_child != 0)
+		{
+			stack[stack_size++] = node.first_child;
+			stack[stack_size++] = node.first_child + 1;
+			continue;
+		}
+
+		for (uint32_t i = node.begin; i < node.end; i++)
+		{
+			float distance = intersect_ray(items[i].min, items[i].max, origin, inverse_direction, max_distance);
+
+			if (distance >= 0.0f)
+			{
+				hits.emplace_back(distance, &items[i]);
+			}
+		}
+	}
+
+	std::sort(hits.begin(), hits.end(), [](const std::pair<float, const Item *> &a, const std::pair<float, const Item *> &b) {
+		return a.first < b.first;
+	});
+
+	for (auto &hit : hits)
+	{
+		result.push_back(hit.second);
+	}
+}
+
+const std::vector<SpatialIndex::Item> &SpatialIndex::get_items() const
+{
+	return items;
+}
+}        // namespace sg
+}        // namespace vkb
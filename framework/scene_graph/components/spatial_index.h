@@ -0,0 +1,151 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+#include "scene_graph/component.h"
+
+namespace vkb
+{
+class Frustum;
+
+namespace sg
+{
+class Mesh;
+class Node;
+
+/**
+ * @brief Bounding volume hierarchy over the world space bounds of the nodes of the meshes of a scene.
+ *
+ * The hierarchy is built once, then refitted from the transforms whose published state changed,
+ * so that queries return the objects in a volume at a cost which scales with the objects found
+ * rather than with the size of the scene. A refit keeps the topology of the hierarchy, build()
+ * creates it again once objects moved far from where they were.
+ */
+class SpatialIndex : public Component
+{
+  public:
+	/**
+	 * @brief A node of a mesh, each of the sub meshes of the mesh is drawn with the transform of the node
+	 */
+	struct Item
+	{
+		Node *node;
+
+		Mesh *mesh;
+
+		/// World space bounds, from the published state of the transform of the node
+		glm::vec3 min;
+
+		glm::vec3 max;
+
+		/// Version of the published transform state the bounds were computed from
+		uint32_t transform_version;
+	};
+
+	/// Maximum number of items in a leaf of the hierarchy
+	static const uint32_t MAX_LEAF_SIZE = 4;
+
+	SpatialIndex(const std::string &name = "SpatialIndex");
+
+	virtual ~SpatialIndex() = default;
+
+	virtual std::type_index get_type() override;
+
+	/**
+	 * @brief Builds the hierarchy over the nodes of meshes, replacing the previous one
+	 */
+	void build(const std::vector<Mesh *> &meshes);
+
+	/**
+	 * @brief Updates the bounds of the items whose transform published a new state, and of their ancestors
+	 * @return Number of items whose bounds changed
+	 */
+	size_t refit();
+
+	/**
+	 * @param[out] items The items at least partially inside the frustum, without a particular order
+	 */
+	void query(const Frustum &frustum, std::vector<const Item *> &items) const;
+
+	/**
+	 * @param[out] items The items whose bounds intersect the sphere, without a particular order
+	 */
+	void query(const glm::vec3 &center, float radius, std::vector<const Item *> &items) const;
+
+	/**
+	 * @brief Finds the items whose bounds a ray crosses
+	 * @param origin Origin of the ray
+	 * @param direction Direction of the ray, which need not be normalized
+	 * @param max_distance Distance along the ray, in multiples of direction, past which items are ignored
+	 * @param[out] items The items crossed by the ray, ordered by the distance at which the ray enters their bounds
+	 */
+	void query_ray(const glm::vec3 &origin, const glm::vec3 &direction, float max_distance, std::vector<const Item *> &items) const;
+
+	const std::vector<Item> &get_items() const;
+
+  private:
+	/**
+	 * @brief A node of the hierarchy, the children of an inner node are adjacent
+	 */
+	struct BvhNode
+	{
+		glm::vec3 min;
+
+		glm::vec3 max;
+
+		/// The items below a node are contiguous, from the first to the last one excluded
+		uint32_t begin;
+
+		uint32_t end;
+
+		/// Index of the first of the two children, zero for a leaf
+		uint32_t first_child;
+
+		uint32_t parent;
+	};
+
+	void build_node(uint32_t node_index, uint32_t begin, uint32_t end);
+
+	void update_bounds(BvhNode &node) const;
+
+	std::vector<Item> items;
+
+	std::vector<BvhNode> nodes;
+
+	/// Leaf holding each item
+	std::vector<uint32_t> item_leaves;
+
+	/// Reused by refit to flag the nodes to update
+	std::vector<uint8_t> dirty_nodes;
+};
+}        // namespace sg
+}        // namespace vkb
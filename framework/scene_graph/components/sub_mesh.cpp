@@ -53,6 +53,30 @@ bool SubMesh::get_attribute(const std::string &attribute_name, VertexAttribute &
 	return true;
 }
 
+const core::Buffer *SubMesh::get_vertex_buffer(const std::string &name) const
+{
+	auto shared_it = shared_vertex_buffers.find(name);
+
+	if (shared_it != shared_vertex_buffers.end())
+	{
+		return shared_it->second;
+	}
+
+	auto buffer_it = vertex_buffers.find(name);
+
+	if (buffer_it != vertex_buffers.end())
+	{
+		return &buffer_it->second;
+	}
+
+	return nullptr;
+}
+
+const core::Buffer *SubMesh::get_index_buffer() const
+{
+	return shared_index_buffer ? shared_index_buffer : index_buffer.get();
+}
+
 void SubMesh::set_material(const Material &new_material)
 {
 	material = &new_material;
@@ -91,6 +115,14 @@ void SubMesh::compute_shader_variant()
 		std::transform(attrib_name.begin(), attrib_name.end(), attrib_name.begin(), ::toupper);
 		shader_variant.add_define("HAS_" + attrib_name);
 	}
+
+	// Two-component normals are octahedral encoded and unfolded in the vertex shader
+	auto normal_it = vertex_attributes.find("normal");
+
+	if (normal_it != vertex_attributes.end() && normal_it->second.format == VK_FORMAT_R16G16_SNORM)
+	{
+		shader_variant.add_define("OCTAHEDRAL_NORMAL");
+	}
 }
 
 ShaderVariant &SubMesh::get_mut_shader_variant()
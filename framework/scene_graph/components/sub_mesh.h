@@ -46,6 +46,20 @@ struct VertexAttribute
 	std::uint32_t offset = 0;
 };
 
+/**
+ * @brief Simplified version of a sub mesh, drawn with a range of its index buffer
+ */
+struct SubMeshLod
+{
+	/// Index of the first index of the level, relative to the first index of the sub mesh
+	std::uint32_t first_index = 0;
+
+	std::uint32_t index_count = 0;
+
+	/// Screen size below which the level can be drawn, as a fraction of the viewport height
+	float screen_size = 0.0f;
+};
+
 class SubMesh : public Component
 {
   public:
@@ -65,6 +79,30 @@ class SubMesh : public Component
 
 	std::unique_ptr<core::Buffer> index_buffer;
 
+	/// Buffers shared with other sub meshes, used instead of the ones owned by this sub mesh if set
+	std::unordered_map<std::string, const core::Buffer *> shared_vertex_buffers;
+
+	const core::Buffer *shared_index_buffer{nullptr};
+
+	/// Index of the first vertex of this sub mesh in its vertex buffers
+	std::int32_t vertex_offset = 0;
+
+	/// Index of the first index of this sub mesh in its index buffer
+	std::uint32_t first_index = 0;
+
+	/// Simplified levels of detail from the finest to the coarsest, the full sub mesh is level zero
+	std::vector<SubMeshLod> lods;
+
+	/**
+	 * @return The shared or owned vertex buffer of an attribute, nullptr if there is none
+	 */
+	const core::Buffer *get_vertex_buffer(const std::string &name) const;
+
+	/**
+	 * @return The shared or owned index buffer, nullptr if the sub mesh is not indexed
+	 */
+	const core::Buffer *get_index_buffer() const;
+
 	void set_attribute(const std::string &name, const VertexAttribute &attribute);
 
 	bool get_attribute(const std::string &name, VertexAttribute &attribute) const;
@@ -98,7 +98,7 @@ glm::mat4 Transform::get_matrix() const
 	       glm::scale(glm::mat4(1.0), scale);
 }
 
-glm::mat4 Transform::get_world_matrix()
+const glm::mat4 &Transform::get_world_matrix()
 {
 	update_world_transform();
 
@@ -110,6 +110,29 @@ void Transform::invalidate_world_matrix()
 	update_world_matrix = true;
 }
 
+const Transform::RenderState &Transform::get_render_state() const
+{
+	return render_state;
+}
+
+void Transform::publish_render_state()
+{
+	auto &world = get_world_matrix();
+
+	if (render_state.world_matrix == world && render_state.translation == translation &&
+	    render_state.rotation == rotation && render_state.scale == scale)
+	{
+		return;
+	}
+
+	render_state.translation  = translation;
+	render_state.rotation     = rotation;
+	render_state.scale        = scale;
+	render_state.world_matrix = world;
+
+	render_state.version++;
+}
+
 void Transform::update_world_transform()
 {
 	if (!update_world_matrix)
@@ -39,6 +39,7 @@ namespace vkb
 namespace sg
 {
 class Node;
+class Scene;
 
 class Transform : public Component
 {
@@ -67,7 +68,11 @@ class Transform : public Component
 
 	glm::mat4 get_matrix() const;
 
-	glm::mat4 get_world_matrix();
+	/**
+	 * @brief Returns the world matrix computed by Scene::update_transforms,
+	 *        or computes it from the parents if it is invalid
+	 */
+	const glm::mat4 &get_world_matrix();
 
 	/**
 	 * @brief Marks the world transform invalid if any of
@@ -76,7 +81,40 @@ class Transform : public Component
 	 */
 	void invalidate_world_matrix();
 
+	/**
+	 * @brief State of the transform read by the renderer, a copy of the simulated
+	 *        one made by Scene::publish_render_state
+	 */
+	struct RenderState
+	{
+		glm::vec3 translation = glm::vec3(0.0, 0.0, 0.0);
+
+		glm::quat rotation = glm::quat(1.0, 0.0, 0.0, 0.0);
+
+		glm::vec3 scale = glm::vec3(1.0, 1.0, 1.0);
+
+		glm::mat4 world_matrix = glm::mat4(1.0);
+
+		/// Incremented each time a different state is published, so that the renderer can keep data derived from it
+		uint32_t version{0};
+	};
+
+	/**
+	 * @brief Returns the state published for rendering, which the next frame may
+	 *        already be updating concurrently with a pipelined update
+	 */
+	const RenderState &get_render_state() const;
+
+	/**
+	 * @brief Copies the current state, updating the world matrix if needed, to the render state.
+	 *        Its version is incremented if the state changed
+	 */
+	void publish_render_state();
+
   private:
+	/// The scene updates the world matrices of its transforms in a single pass
+	friend class Scene;
+
 	Node &node;
 
 	glm::vec3 translation = glm::vec3(0.0, 0.0, 0.0);
@@ -89,6 +127,8 @@ class Transform : public Component
 
 	bool update_world_matrix = false;
 
+	RenderState render_state;
+
 	void update_world_transform();
 };
 
@@ -20,6 +20,9 @@
 
 #include "node.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 #include "component.h"
 #include "components/transform.h"
 
@@ -56,6 +59,11 @@ void Node::add_child(Node &child)
 	children.push_back(&child);
 }
 
+void Node::remove_child(Node &child)
+{
+	children.erase(std::remove(children.begin(), children.end(), &child), children.end());
+}
+
 const std::vector<Node *> &Node::get_children() const
 {
 	return children;
@@ -63,26 +71,39 @@ const std::vector<Node *> &Node::get_children() const
 
 void Node::set_component(Component &component)
 {
-	auto it = components.find(component.get_type());
+	auto type_id = get_component_type_id(component.get_type());
 
-	if (it != components.end())
+	if (type_id >= components.size())
 	{
-		it->second = &component;
-	}
-	else
-	{
-		components.insert(std::make_pair(component.get_type(), &component));
+		components.resize(type_id + 1, nullptr);
 	}
+
+	components[type_id] = &component;
 }
 
 Component &Node::get_component(const std::type_index index)
 {
-	return *components.at(index);
+	return get_component(get_component_type_id(index));
 }
 
 bool Node::has_component(const std::type_index index)
 {
-	return components.count(index) > 0;
+	return has_component(get_component_type_id(index));
+}
+
+Component &Node::get_component(uint32_t type_id)
+{
+	if (!has_component(type_id))
+	{
+		throw std::out_of_range("Node has no component of this type");
+	}
+
+	return *components[type_id];
+}
+
+bool Node::has_component(uint32_t type_id) const
+{
+	return type_id < components.size() && components[type_id] != nullptr;
 }
 
 }        // namespace sg
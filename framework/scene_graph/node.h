@@ -26,6 +26,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "scene_graph/component.h"
 #include "scene_graph/components/transform.h"
 
 namespace vkb
@@ -55,6 +56,11 @@ class Node
 
 	void add_child(Node &child);
 
+	/**
+	 * @brief Unlinks a child from this node, the child keeps its own children
+	 */
+	void remove_child(Node &child);
+
 	const std::vector<Node *> &get_children() const;
 
 	void set_component(Component &component);
@@ -62,7 +68,8 @@ class Node
 	template <class T>
 	inline T &get_component()
 	{
-		return dynamic_cast<T &>(get_component(typeid(T)));
+		// Components are stored under their own type, so the cast is always valid
+		return static_cast<T &>(get_component(get_component_type_id<T>()));
 	}
 
 	Component &get_component(const std::type_index index);
@@ -70,12 +77,16 @@ class Node
 	template <class T>
 	bool has_component()
 	{
-		return has_component(typeid(T));
+		return has_component(get_component_type_id<T>());
 	}
 
 	bool has_component(const std::type_index index);
 
   private:
+	Component &get_component(uint32_t type_id);
+
+	bool has_component(uint32_t type_id) const;
+
 	std::string name;
 
 	Transform transform;
@@ -84,7 +95,8 @@ class Node
 
 	std::vector<Node *> children;
 
-	std::unordered_map<std::type_index, Component *> components;
+	/// Components indexed by the id of their type, see get_component_type_id
+	std::vector<Component *> components;
 };
 }        // namespace sg
 }        // namespace vkb
@@ -20,16 +20,37 @@
 
 #include "scene.h"
 
+#include <algorithm>
+#include <iterator>
 #include <queue>
+#include <stdexcept>
+#include <unordered_set>
 
 #include "common/error.h"
+#include "common/helpers.h"
+#include "common/utils.h"
 #include "component.h"
+#include "components/transform.h"
 #include "node.h"
+#include "script.h"
 
 namespace vkb
 {
 namespace sg
 {
+namespace
+{
+/// Depth levels with fewer transforms are updated on the calling thread
+const uint32_t PARALLEL_TRANSFORM_COUNT = 4096;
+
+const uint32_t TRANSFORM_RANGE_SIZE = 1024;
+
+/// Fewer independent scripts are updated on the calling thread
+const uint32_t PARALLEL_SCRIPT_COUNT = 64;
+
+const uint32_t SCRIPT_RANGE_SIZE = 32;
+}        // namespace
+
 Scene::Scene(const std::string &name) :
     name{name}
 {}
@@ -48,16 +69,22 @@ void Scene::set_nodes(std::vector<std::unique_ptr<Node>> &&n)
 {
 	assert(nodes.empty() && "Scene nodes were already set");
 	nodes = std::move(n);
+
+	invalidate_transform_order();
 }
 
 void Scene::add_node(std::unique_ptr<Node> &&n)
 {
 	nodes.emplace_back(std::move(n));
+
+	invalidate_transform_order();
 }
 
 void Scene::add_child(Node &child)
 {
 	root->add_child(child);
+
+	invalidate_transform_order();
 }
 
 void Scene::add_component(std::unique_ptr<Component> &&component, Node &node)
@@ -124,11 +151,342 @@ Node *Scene::find_node(const std::string &node_name)
 void Scene::set_root_node(Node &node)
 {
 	root = &node;
+
+	invalidate_transform_order();
 }
 
 Node &Scene::get_root_node()
 {
 	return *root;
 }
+
+void Scene::update_scripts(float delta_time, JobSystem *job_system)
+{
+	independent_scripts.clear();
+	dependent_scripts.clear();
+
+	for (auto script : get_components<Script>())
+	{
+		(script->is_independent() ? independent_scripts : dependent_scripts).push_back(script);
+	}
+
+	auto update_range = [this, delta_time](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++)
+		{
+			independent_scripts[i]->update(delta_time);
+		}
+	};
+
+	auto count = to_u32(independent_scripts.size());
+
+	if (job_system && count >= PARALLEL_SCRIPT_COUNT)
+	{
+		parallel_for_ranges(job_system, count, SCRIPT_RANGE_SIZE, update_range);
+	}
+	else
+	{
+		update_range(0, count);
+	}
+
+	for (auto script : dependent_scripts)
+	{
+		script->update(delta_time);
+	}
+}
+
+void Scene::update_transforms(JobSystem *job_system)
+{
+	// Nodes may have been added or moved in the hierarchy
+	bool order_rebuilt = transform_order_invalid;
+
+	if (transform_order_invalid)
+	{
+		build_transform_order();
+	}
+
+	auto update_range = [this](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++)
+		{
+			auto transform = transforms[i];
+			auto parent    = transform_parents[i];
+
+			bool changed = transform->update_world_matrix || (parent >= 0 && world_matrix_changed[parent]);
+
+			world_matrix_changed[i] = changed;
+
+			if (changed)
+			{
+				glm::mat4 world_matrix = transform->get_matrix();
+
+				if (parent >= 0)
+				{
+					world_matrix = world_matrix * world_matrices[parent];
+				}
+
+				world_matrices[i]              = world_matrix;
+				transform->world_matrix        = world_matrix;
+				transform->update_world_matrix = false;
+			}
+		}
+	};
+
+	// Transforms of a depth level only read the previous levels, so a level can be split across threads
+	for (size_t level = 0; level + 1 < depth_offsets.size(); level++)
+	{
+		auto begin = depth_offsets[level];
+		auto count = depth_offsets[level + 1] - begin;
+
+		if (job_system && count >= PARALLEL_TRANSFORM_COUNT)
+		{
+			parallel_for_ranges(job_system, count, TRANSFORM_RANGE_SIZE, [begin, &update_range](uint32_t range_begin, uint32_t range_end) {
+				update_range(begin + range_begin, begin + range_end);
+			});
+		}
+		else
+		{
+			update_range(begin, begin + count);
+		}
+	}
+
+	transforms_changed = order_rebuilt || std::any_of(world_matrix_changed.begin(), world_matrix_changed.end(), [](uint8_t changed) { return changed != 0; });
+}
+
+bool Scene::have_transforms_changed() const
+{
+	return transforms_changed;
+}
+
+void Scene::publish_render_state()
+{
+	if (transform_order_invalid)
+	{
+		build_transform_order();
+	}
+
+	// Parents are published first, so the lazy world matrices of new nodes read updated parents
+	for (auto transform : transforms)
+	{
+		transform->publish_render_state();
+	}
+}
+
+void Scene::invalidate_transform_order()
+{
+	transform_order_invalid = true;
+}
+
+Node &Scene::attach(Scene &&subtree)
+{
+	assert(root && subtree.root && "Both scenes need a root node");
+
+	auto &subtree_root = *subtree.root;
+
+	auto &owned_components = attached_components[&subtree_root];
+
+	for (auto &type_components : subtree.components)
+	{
+		auto &target = components[type_components.first];
+		target.reserve(target.size() + type_components.second.size());
+
+		for (auto &component : type_components.second)
+		{
+			owned_components.push_back(component.get());
+			target.push_back(std::move(component));
+		}
+	}
+
+	nodes.reserve(nodes.size() + subtree.nodes.size());
+
+	for (auto &node : subtree.nodes)
+	{
+		nodes.push_back(std::move(node));
+	}
+
+	subtree.components.clear();
+	subtree.nodes.clear();
+	subtree.root = nullptr;
+
+	subtree_root.set_parent(*root);
+	root->add_child(subtree_root);
+
+	invalidate_transform_order();
+	version++;
+
+	return subtree_root;
+}
+
+std::unique_ptr<Scene> Scene::detach(Node &subtree_root)
+{
+	auto owned_it = attached_components.find(&subtree_root);
+
+	if (owned_it == attached_components.end())
+	{
+		throw std::invalid_argument("Node " + subtree_root.get_name() + " was not attached to the scene");
+	}
+
+	auto subtree = std::make_unique<Scene>(subtree_root.get_name());
+
+	std::unordered_set<const Node *> subtree_nodes;
+
+	std::queue<Node *> traverse_nodes;
+	traverse_nodes.push(&subtree_root);
+
+	while (!traverse_nodes.empty())
+	{
+		auto node = traverse_nodes.front();
+		traverse_nodes.pop();
+
+		subtree_nodes.insert(node);
+
+		for (auto child : node->get_children())
+		{
+			traverse_nodes.push(child);
+		}
+	}
+
+	// The nodes and components which stay keep their order, the others are moved to the end
+	auto node_it = std::stable_partition(nodes.begin(), nodes.end(),
+	                                     [&subtree_nodes](const std::unique_ptr<Node> &node) { return subtree_nodes.count(node.get()) == 0; });
+
+	std::move(node_it, nodes.end(), std::back_inserter(subtree->nodes));
+	nodes.erase(node_it, nodes.end());
+
+	std::unordered_set<const Component *> owned_components{owned_it->second.begin(), owned_it->second.end()};
+
+	for (auto &type_components : components)
+	{
+		auto &list = type_components.second;
+
+		auto component_it = std::stable_partition(list.begin(), list.end(),
+		                                          [&owned_components](const std::unique_ptr<Component> &component) { return owned_components.count(component.get()) == 0; });
+
+		if (component_it != list.end())
+		{
+			auto &target = subtree->components[type_components.first];
+			std::move(component_it, list.end(), std::back_inserter(target));
+			list.erase(component_it, list.end());
+		}
+	}
+
+	attached_components.erase(owned_it);
+
+	if (auto parent = subtree_root.get_parent())
+	{
+		parent->remove_child(subtree_root);
+	}
+
+	subtree->root = &subtree_root;
+
+	invalidate_transform_order();
+	version++;
+
+	return subtree;
+}
+
+uint64_t Scene::get_version() const
+{
+	return version;
+}
+
+void Scene::build_transform_order()
+{
+	const int32_t unvisited = -2;
+	const int32_t excluded  = -1;
+
+	// Nodes whose ancestors are not all nodes of the scene are excluded, their transforms stay lazily updated
+	std::unordered_map<const Node *, int32_t> depths;
+	for (auto &node : nodes)
+	{
+		depths[node.get()] = unvisited;
+	}
+
+	std::vector<const Node *> chain;
+
+	for (auto &node : nodes)
+	{
+		const Node *current = node.get();
+
+		int32_t parent_depth = -1;
+		bool    valid        = true;
+
+		chain.clear();
+
+		while (current)
+		{
+			auto it = depths.find(current);
+
+			if (it == depths.end() || it->second == excluded)
+			{
+				valid = false;
+				break;
+			}
+
+			if (it->second != unvisited)
+			{
+				parent_depth = it->second;
+				break;
+			}
+
+			// Excluded until its depth is known, so that a cycle ends the walk
+			it->second = excluded;
+			chain.push_back(current);
+			current = current->get_parent();
+		}
+
+		for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+		{
+			depths[*it] = valid ? ++parent_depth : excluded;
+		}
+	}
+
+	std::vector<std::pair<int32_t, Node *>> sorted_nodes;
+	sorted_nodes.reserve(nodes.size());
+
+	for (auto &node : nodes)
+	{
+		auto depth = depths.at(node.get());
+
+		if (depth != excluded)
+		{
+			sorted_nodes.emplace_back(depth, node.get());
+		}
+	}
+
+	std::stable_sort(sorted_nodes.begin(), sorted_nodes.end(),
+	                 [](const std::pair<int32_t, Node *> &a, const std::pair<int32_t, Node *> &b) { return a.first < b.first; });
+
+	transforms.clear();
+	transform_parents.clear();
+	depth_offsets.clear();
+
+	std::unordered_map<const Node *, int32_t> indices;
+
+	for (auto &sorted_node : sorted_nodes)
+	{
+		auto node = sorted_node.second;
+
+		while (depth_offsets.size() <= static_cast<size_t>(sorted_node.first))
+		{
+			depth_offsets.push_back(to_u32(transforms.size()));
+		}
+
+		auto parent = node->get_parent();
+
+		indices[node] = static_cast<int32_t>(transforms.size());
+		transform_parents.push_back(parent ? indices.at(parent) : -1);
+
+		// Every world matrix is recomputed after the order changes
+		auto &transform               = node->get_transform();
+		transform.update_world_matrix = true;
+		transforms.push_back(&transform);
+	}
+
+	depth_offsets.push_back(to_u32(transforms.size()));
+
+	world_matrices.assign(transforms.size(), glm::mat4(1.0f));
+	world_matrix_changed.assign(transforms.size(), 0);
+
+	transform_order_invalid = false;
+}
 }        // namespace sg
 }        // namespace vkb
@@ -27,15 +27,26 @@
 #include <unordered_map>
 #include <vector>
 
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+#include "scene_graph/component_range.h"
 #include "scene_graph/components/light.h"
 #include "scene_graph/components/texture.h"
 
 namespace vkb
 {
+class JobSystem;
+
 namespace sg
 {
 class Node;
 class Component;
+class Script;
+class Transform;
 
 /// @brief A collection of nodes organized in a tree structure.
 ///		   It can contain more than one root node.
@@ -91,24 +102,19 @@ class Scene
 	}
 
 	/**
-	 * @return List of pointers to components casted to the given template type
+	 * @return View of the components of the given template type, casted without allocating
 	 */
 	template <class T>
-	std::vector<T *> get_components() const
+	ComponentRange<T> get_components() const
 	{
-		std::vector<T *> result;
-		if (has_component(typeid(T)))
-		{
-			auto &scene_components = get_components(typeid(T));
+		auto it = components.find(typeid(T));
 
-			result.resize(scene_components.size());
-			std::transform(scene_components.begin(), scene_components.end(), result.begin(),
-			               [](const std::unique_ptr<Component> &component) -> T * {
-				               return dynamic_cast<T *>(component.get());
-			               });
+		if (it == components.end())
+		{
+			return {};
 		}
 
-		return result;
+		return ComponentRange<T>{it->second};
 	}
 
 	/**
@@ -130,7 +136,62 @@ class Scene
 
 	Node &get_root_node();
 
+	/**
+	 * @brief Updates the scripts of the scene. The independent ones run first, split across the job
+	 *        system if there are many of them, then the others run one after the other in scene order
+	 * @param delta_time Time since the last update
+	 * @param job_system Optional job system running the independent scripts
+	 */
+	void update_scripts(float delta_time, JobSystem *job_system = nullptr);
+
+	/**
+	 * @brief Recomputes the world matrices of the transforms which changed, and of their descendants,
+	 *        in one linear pass over the transforms sorted by depth. Nodes then read the cached matrices
+	 * @param job_system Optional job system used to split the depth levels with many transforms
+	 */
+	void update_transforms(JobSystem *job_system = nullptr);
+
+	/**
+	 * @return Whether the last update_transforms changed the world matrix of any transform
+	 */
+	bool have_transforms_changed() const;
+
+	/**
+	 * @brief Rebuilds the order of the transforms on the next update, called when nodes are added
+	 *        to the scene. Code changing the parent of a node afterwards must call it as well
+	 */
+	void invalidate_transform_order();
+
+	/**
+	 * @brief Copies the state of the transforms to their render state, read by the subpasses.
+	 *        The scene can then be updated for the next frame while the current one is recorded
+	 */
+	void publish_render_state();
+
+	/**
+	 * @brief Moves the nodes and components of another scene into this one, its root node becoming a child
+	 *        of the root of this scene. The subtree can be detached again with the components it brought
+	 * @param subtree The scene to attach, left empty
+	 * @return The root node of the attached scene
+	 */
+	Node &attach(Scene &&subtree);
+
+	/**
+	 * @brief Moves a subtree added by attach() out of the scene, with the components it brought
+	 * @param subtree_root The node returned by attach()
+	 * @return A scene owning the nodes and components of the subtree, to be released once no frame uses them
+	 */
+	std::unique_ptr<Scene> detach(Node &subtree_root);
+
+	/**
+	 * @return The number of times subtrees were attached or detached, users keeping lists of
+	 *         components compare it to know when to gather them again
+	 */
+	uint64_t get_version() const;
+
   private:
+	void build_transform_order();
+
 	std::string name;
 
 	/// List of all the nodes
@@ -139,6 +200,35 @@ class Scene
 	Node *root{nullptr};
 
 	std::unordered_map<std::type_index, std::vector<std::unique_ptr<Component>>> components;
+
+	/// Transforms of the nodes sorted by depth, parents are always before their children
+	std::vector<Transform *> transforms;
+
+	/// Index of the parent of each transform, -1 for the root nodes
+	std::vector<int32_t> transform_parents;
+
+	/// World matrix of each transform
+	std::vector<glm::mat4> world_matrices;
+
+	/// Whether the world matrix of each transform changed during the last update
+	std::vector<uint8_t> world_matrix_changed;
+
+	/// Offsets of the depth levels in the transforms, the last one is the transform count
+	std::vector<uint32_t> depth_offsets;
+
+	/// Scripts of the last update_scripts, reused every frame
+	std::vector<Script *> independent_scripts;
+
+	std::vector<Script *> dependent_scripts;
+
+	bool transform_order_invalid{true};
+
+	bool transforms_changed{true};
+
+	/// Components brought by each attached subtree, moved out with it
+	std::unordered_map<const Node *, std::vector<const Component *>> attached_components;
+
+	uint64_t version{0};
 };
 }        // namespace sg
 }        // namespace vkb
@@ -34,6 +34,11 @@ std::type_index Script::get_type()
 	return typeid(Script);
 }
 
+bool Script::is_independent() const
+{
+	return false;
+}
+
 void Script::input_event(const InputEvent & /*input_event*/)
 {
 }
@@ -50,6 +50,12 @@ class Script : public Component
 	 */
 	virtual void update(float delta_time) = 0;
 
+	/**
+	 * @brief Independent scripts only write the transform of their own node, and read nothing any other script
+	 *        writes, so that Scene::update_scripts can update them concurrently. False by default
+	 */
+	virtual bool is_independent() const;
+
 	virtual void input_event(const InputEvent &input_event);
 
 	virtual void resize(uint32_t width, uint32_t height);
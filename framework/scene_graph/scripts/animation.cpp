@@ -0,0 +1,172 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "animation.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "common/helpers.h"
+#include "scene_graph/components/transform.h"
+#include "scene_graph/node.h"
+
+namespace vkb
+{
+namespace sg
+{
+namespace
+{
+glm::quat to_quat(const glm::vec4 &value)
+{
+	return glm::normalize(glm::quat{value.w, value.x, value.y, value.z});
+}
+}        // namespace
+
+glm::vec4 AnimationSampler::sample(float time, bool rotation) const
+{
+	bool cubic = interpolation == AnimationInterpolation::CubicSpline;
+
+	// Value of a keyframe, skipping the tangents of cubic splines
+	auto value = [this, cubic](size_t keyframe) {
+		return cubic ? values[keyframe * 3 + 1] : values[keyframe];
+	};
+
+	if (times.empty())
+	{
+		return glm::vec4{0.0f};
+	}
+
+	// First keyframe after the time
+	size_t next = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+
+	if (next == 0)
+	{
+		return value(0);
+	}
+
+	if (next == times.size())
+	{
+		return value(times.size() - 1);
+	}
+
+	size_t prev = next - 1;
+
+	float delta = times[next] - times[prev];
+	float t     = (time - times[prev]) / delta;
+
+	switch (interpolation)
+	{
+		case AnimationInterpolation::Step:
+			return value(prev);
+
+		case AnimationInterpolation::Linear:
+		{
+			if (rotation)
+			{
+				glm::quat q = glm::slerp(to_quat(value(prev)), to_quat(value(next)), t);
+				return glm::vec4{q.x, q.y, q.z, q.w};
+			}
+
+			return glm::mix(value(prev), value(next), t);
+		}
+
+		case AnimationInterpolation::CubicSpline:
+		{
+			// Hermite spline between the values, with the tangents scaled by the keyframe interval
+			float t2 = t * t;
+			float t3 = t2 * t;
+
+			glm::vec4 result = (2.0f * t3 - 3.0f * t2 + 1.0f) * values[prev * 3 + 1] +
+			                   (t3 - 2.0f * t2 + t) * delta * values[prev * 3 + 2] +
+			                   (-2.0f * t3 + 3.0f * t2) * values[next * 3 + 1] +
+			                   (t3 - t2) * delta * values[next * 3];
+
+			return rotation ? glm::normalize(result) : result;
+		}
+	}
+
+	return value(prev);
+}
+
+Animation::Animation(Node &node, const std::string &name) :
+    Script{node, name}
+{
+}
+
+void Animation::update(float delta_time)
+{
+	if (duration > 0.0f)
+	{
+		time = std::fmod(time + delta_time, duration);
+	}
+
+	for (auto &channel : channels)
+	{
+		auto &sampler   = samplers[channel.sampler];
+		auto &transform = channel.node->get_transform();
+
+		switch (channel.path)
+		{
+			case AnimationPath::Translation:
+				transform.set_translation(glm::vec3{sampler.sample(time, false)});
+				break;
+			case AnimationPath::Rotation:
+				transform.set_rotation(to_quat(sampler.sample(time, true)));
+				break;
+			case AnimationPath::Scale:
+				transform.set_scale(glm::vec3{sampler.sample(time, false)});
+				break;
+		}
+	}
+}
+
+uint32_t Animation::add_sampler(AnimationSampler &&sampler)
+{
+	if (!sampler.times.empty())
+	{
+		duration = std::max(duration, sampler.times.back());
+	}
+
+	samplers.push_back(std::move(sampler));
+
+	return to_u32(samplers.size() - 1);
+}
+
+void Animation::add_channel(const AnimationChannel &channel)
+{
+	channels.push_back(channel);
+}
+
+float Animation::get_duration() const
+{
+	return duration;
+}
+
+void Animation::set_time(float t)
+{
+	time = t;
+}
+
+float Animation::get_time() const
+{
+	return time;
+}
+}        // namespace sg
+}        // namespace vkb
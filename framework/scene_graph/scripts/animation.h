@@ -0,0 +1,129 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+#include <glm/gtx/quaternion.hpp>
+VKBP_ENABLE_WARNINGS()
+
+#include "scene_graph/script.h"
+
+namespace vkb
+{
+namespace sg
+{
+enum class AnimationInterpolation
+{
+	Step,
+	Linear,
+	CubicSpline
+};
+
+enum class AnimationPath
+{
+	Translation,
+	Rotation,
+	Scale
+};
+
+/**
+ * @brief Keyframes of an animated property, the times and values are stored in separate arrays
+ *        so that finding the keyframes around a time only reads the times
+ */
+struct AnimationSampler
+{
+	AnimationInterpolation interpolation{AnimationInterpolation::Linear};
+
+	/// Increasing times of the keyframes in seconds
+	std::vector<float> times;
+
+	/// Values of the keyframes, quaternions as (x, y, z, w). Cubic splines store an
+	/// in-tangent, a value and an out-tangent per keyframe
+	std::vector<glm::vec4> values;
+
+	/**
+	 * @return The interpolated value at a time, clamped to the first and last keyframes
+	 */
+	glm::vec4 sample(float time, bool rotation) const;
+};
+
+/**
+ * @brief Animates a property of a node with a sampler of its animation
+ */
+struct AnimationChannel
+{
+	Node *node{nullptr};
+
+	AnimationPath path{AnimationPath::Translation};
+
+	uint32_t sampler{0};
+};
+
+/**
+ * @brief Plays the keyframes of an animation on the transforms of the nodes of its channels, in a loop
+ */
+class Animation : public Script
+{
+  public:
+	/**
+	 * @param node The node the script belongs to, the animated nodes are given by the channels
+	 * @param name Name of the animation
+	 */
+	Animation(Node &node, const std::string &name = "");
+
+	virtual ~Animation() = default;
+
+	virtual void update(float delta_time) override;
+
+	/**
+	 * @return Index of the sampler, referenced by the channels
+	 */
+	uint32_t add_sampler(AnimationSampler &&sampler);
+
+	void add_channel(const AnimationChannel &channel);
+
+	/**
+	 * @return Time of the last keyframe of the samplers in seconds
+	 */
+	float get_duration() const;
+
+	void set_time(float time);
+
+	float get_time() const;
+
+  private:
+	std::vector<AnimationSampler> samplers;
+
+	std::vector<AnimationChannel> channels;
+
+	float duration{0.0f};
+
+	float time{0.0f};
+};
+}        // namespace sg
+}        // namespace vkb
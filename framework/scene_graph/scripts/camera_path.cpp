@@ -0,0 +1,129 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "camera_path.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+#include <json.hpp>
+
+#include "platform/filesystem.h"
+#include "scene_graph/components/transform.h"
+#include "scene_graph/node.h"
+
+namespace vkb
+{
+namespace sg
+{
+namespace
+{
+/**
+ * @brief Uniform Catmull-Rom interpolation between p1 and p2, p0 and p3 set the tangents
+ */
+glm::vec3 catmull_rom(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2, const glm::vec3 &p3, float t)
+{
+	float t2 = t * t;
+	float t3 = t2 * t;
+
+	return 0.5f * ((2.0f * p1) +
+	               (p2 - p0) * t +
+	               (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+	               (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+}        // namespace
+
+CameraPath::CameraPath(Node &node, const std::vector<ControlPoint> &points, float duration) :
+    Script{node, "CameraPath"},
+    points{points},
+    duration{duration}
+{
+	if (points.size() < 2 || duration <= 0.0f)
+	{
+		throw std::runtime_error("A camera path needs at least two points and a positive duration");
+	}
+}
+
+std::unique_ptr<CameraPath> CameraPath::load(Node &node, const std::string &filename)
+{
+	std::ifstream in{fs::path::get(fs::path::Type::Storage) + filename};
+
+	if (!in.good())
+	{
+		throw std::runtime_error("Could not read camera path " + filename);
+	}
+
+	std::vector<ControlPoint> points;
+	float                     duration = 0.0f;
+
+	try
+	{
+		auto path = nlohmann::json::parse(in);
+
+		duration = path.at("duration").get<float>();
+
+		for (auto &entry : path.at("points"))
+		{
+			auto position = entry.at("position").get<std::vector<float>>();
+			auto rotation = entry.at("rotation").get<std::vector<float>>();
+
+			if (position.size() != 3 || rotation.size() != 4)
+			{
+				throw std::runtime_error("Invalid control point");
+			}
+
+			ControlPoint point;
+			point.position = glm::vec3{position[0], position[1], position[2]};
+			point.rotation = glm::normalize(glm::quat{rotation[3], rotation[0], rotation[1], rotation[2]});
+
+			points.push_back(point);
+		}
+	}
+	catch (const std::exception &)
+	{
+		throw std::runtime_error("Invalid camera path " + filename);
+	}
+
+	return std::make_unique<CameraPath>(node, points, duration);
+}
+
+void CameraPath::update(float delta_time)
+{
+	time = std::fmod(time + delta_time, duration);
+
+	auto count    = points.size();
+	auto position = time / duration * count;
+	auto index    = std::min(static_cast<size_t>(position), count - 1);
+	auto t        = position - index;
+
+	auto &p0 = points[(index + count - 1) % count];
+	auto &p1 = points[index];
+	auto &p2 = points[(index + 1) % count];
+	auto &p3 = points[(index + 2) % count];
+
+	auto &transform = get_node().get_component<Transform>();
+
+	transform.set_translation(catmull_rom(p0.position, p1.position, p2.position, p3.position, t));
+	transform.set_rotation(glm::slerp(p1.rotation, p2.rotation, t));
+}
+}        // namespace sg
+}        // namespace vkb
@@ -0,0 +1,82 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+#include <glm/gtx/quaternion.hpp>
+VKBP_ENABLE_WARNINGS()
+
+#include "scene_graph/script.h"
+
+namespace vkb
+{
+namespace sg
+{
+/**
+ * @brief Moves a node along a closed Catmull-Rom spline through control points, reached at regular intervals.
+ *        Driven by the delta time only, so with a fixed time step every run renders the same frames.
+ */
+class CameraPath : public Script
+{
+  public:
+	struct ControlPoint
+	{
+		glm::vec3 position{0.0f};
+
+		glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+	};
+
+	/**
+	 * @param node The node to move
+	 * @param points The control points of the path, at least two
+	 * @param duration The time in seconds to go around the path once
+	 */
+	CameraPath(Node &node, const std::vector<ControlPoint> &points, float duration);
+
+	/**
+	 * @brief Reads a path from a json file such as
+	 *        {"duration": 20.0, "points": [{"position": [x, y, z], "rotation": [x, y, z, w]}, ...]}
+	 * @param node The node to move
+	 * @param filename The path to the file (relative to the storage directory)
+	 * @throws runtime_error if the file cannot be read
+	 */
+	static std::unique_ptr<CameraPath> load(Node &node, const std::string &filename);
+
+	virtual ~CameraPath() = default;
+
+	virtual void update(float delta_time) override;
+
+  private:
+	std::vector<ControlPoint> points;
+
+	float duration;
+
+	float time{0.0f};
+};
+}        // namespace sg
+}        // namespace vkb
@@ -48,6 +48,11 @@ class NodeAnimation : public Script
 
 	virtual void update(float delta_time) override;
 
+	/**
+	 * @return True, the animation function is given the transform of the node alone and must only write to it
+	 */
+	virtual bool is_independent() const override;
+
 	void set_animation(TransformAnimFn handle);
 
 	void clear_animation();
@@ -0,0 +1,271 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "scene_streamer.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "common/helpers.h"
+#include "common/logging.h"
+#include "core/buffer.h"
+#include "core/device.h"
+#include "core/image.h"
+#include "cpu_topology.h"
+#include "gltf_loader.h"
+#include "scene_graph/components/geometry_buffers.h"
+#include "scene_graph/components/image.h"
+#include "scene_graph/components/sub_mesh.h"
+#include "scene_graph/node.h"
+#include "scene_graph/scene.h"
+
+namespace vkb
+{
+namespace
+{
+/**
+ * @return Distance from a position to a box, zero inside it
+ */
+float get_distance(const glm::vec3 &position, const glm::vec3 &min, const glm::vec3 &max)
+{
+	return glm::length(glm::max(glm::max(min - position, position - max), glm::vec3(0.0f)));
+}
+}        // namespace
+
+SceneStreamer::SceneStreamer(Device &device, sg::Scene &scene, float load_distance, float unload_distance, JobSystem *job_system) :
+    device{device},
+    scene{scene},
+    job_system{job_system},
+    load_distance{load_distance},
+    unload_distance{std::max(load_distance, unload_distance)}
+{
+}
+
+SceneStreamer::~SceneStreamer()
+{
+	for (auto &cell : cells)
+	{
+		if (cell.future.valid())
+		{
+			cell.future.wait();
+		}
+	}
+}
+
+void SceneStreamer::add_cell(const std::string &path, const glm::vec3 &min, const glm::vec3 &max, int scene_index)
+{
+	Cell cell;
+	cell.path        = path;
+	cell.scene_index = scene_index;
+	cell.min         = min;
+	cell.max         = max;
+
+	cells.push_back(std::move(cell));
+}
+
+bool SceneStreamer::update(const glm::vec3 &position)
+{
+	auto &deletion_queue = device.get_deletion_queue();
+
+	// The closest cells are loaded and attached first, as the position reaches them first
+	sorted_cells.clear();
+
+	for (size_t i = 0; i < cells.size(); ++i)
+	{
+		sorted_cells.emplace_back(get_distance(position, cells[i].min, cells[i].max), i);
+	}
+
+	std::sort(sorted_cells.begin(), sorted_cells.end());
+
+	auto loading_count = get_loading_count();
+
+	VkDeviceSize attached_size = 0;
+
+	bool changed = false;
+
+	for (auto &sorted_cell : sorted_cells)
+	{
+		auto  distance = sorted_cell.first;
+		auto &cell     = cells[sorted_cell.second];
+
+		if (cell.state == CellState::Unloaded && distance < load_distance && loading_count < max_concurrent_loads)
+		{
+			load(cell);
+			loading_count++;
+			continue;
+		}
+
+		if (cell.state == CellState::Loading && cell.future.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			loading_count--;
+
+			try
+			{
+				cell.scene = cell.future.get();
+			}
+			catch (const std::exception &e)
+			{
+				LOGE("Failed to load cell {}: {}", cell.path, e.what());
+			}
+
+			if (!cell.scene)
+			{
+				// Not loaded again, the file would fail the same way
+				cell.state = CellState::Failed;
+				continue;
+			}
+
+			cell.size  = get_size(*cell.scene);
+			cell.state = CellState::Loaded;
+		}
+
+		if (cell.state == CellState::Loaded)
+		{
+			// The position moved away while the cell was loading, no frame used it
+			if (distance > unload_distance)
+			{
+				cell.scene.reset();
+				cell.state = CellState::Unloaded;
+				continue;
+			}
+
+			if (attached_size > 0 && attached_size + cell.size > max_attach_size)
+			{
+				continue;
+			}
+
+			cell.root  = &scene.attach(std::move(*cell.scene));
+			cell.state = CellState::Resident;
+			cell.scene.reset();
+
+			attached_size += cell.size;
+			changed = true;
+		}
+		else if (cell.state == CellState::Resident && distance > unload_distance)
+		{
+			// The frames in flight may still draw the cell
+			deletion_queue.release(scene.detach(*cell.root));
+
+			cell.root  = nullptr;
+			cell.state = CellState::Unloaded;
+			changed    = true;
+		}
+	}
+
+	return changed;
+}
+
+void SceneStreamer::set_max_attach_size(VkDeviceSize size)
+{
+	max_attach_size = size;
+}
+
+void SceneStreamer::set_max_concurrent_loads(uint32_t count)
+{
+	max_concurrent_loads = std::max(count, 1u);
+}
+
+uint32_t SceneStreamer::get_resident_count() const
+{
+	return to_u32(std::count_if(cells.begin(), cells.end(), [](const Cell &cell) { return cell.state == CellState::Resident; }));
+}
+
+uint32_t SceneStreamer::get_loading_count() const
+{
+	return to_u32(std::count_if(cells.begin(), cells.end(), [](const Cell &cell) { return cell.state == CellState::Loading; }));
+}
+
+VkDeviceSize SceneStreamer::get_resident_size() const
+{
+	VkDeviceSize size = 0;
+
+	for (auto &cell : cells)
+	{
+		if (cell.state == CellState::Resident)
+		{
+			size += cell.size;
+		}
+	}
+
+	return size;
+}
+
+VkDeviceSize SceneStreamer::get_size(sg::Scene &cell_scene) const
+{
+	VkDeviceSize size = 0;
+
+	// Merged geometry is suballocated from the shared buffers, the other sub meshes own theirs
+	for (auto geometry_buffers : cell_scene.get_components<sg::GeometryBuffers>())
+	{
+		for (auto &name_buffer : geometry_buffers->vertex_buffers)
+		{
+			size += name_buffer.second.get_size();
+		}
+
+		for (auto &type_buffer : geometry_buffers->index_buffers)
+		{
+			size += type_buffer.second.get_size();
+		}
+	}
+
+	for (auto sub_mesh : cell_scene.get_components<sg::SubMesh>())
+	{
+		for (auto &name_buffer : sub_mesh->vertex_buffers)
+		{
+			size += name_buffer.second.get_size();
+		}
+
+		if (sub_mesh->index_buffer)
+		{
+			size += sub_mesh->index_buffer->get_size();
+		}
+	}
+
+	for (auto image : cell_scene.get_components<sg::Image>())
+	{
+		VmaAllocationInfo allocation_info{};
+		vmaGetAllocationInfo(device.get_memory_allocator(), image->get_vk_image().get_memory(), &allocation_info);
+
+		size += allocation_info.size;
+	}
+
+	return size;
+}
+
+void SceneStreamer::load(Cell &cell)
+{
+	auto path        = cell.path;
+	auto scene_index = cell.scene_index;
+
+	cell.state  = CellState::Loading;
+	cell.future = std::async(std::launch::async, [this, path, scene_index]() {
+		// Loading is off the critical path of the frames
+		CpuTopology::get().pin_current_thread(CoreClass::Little);
+
+		GLTFLoader loader{device, job_system};
+
+		// The scene has its own camera and lights
+		loader.set_default_components(false);
+		loader.set_scene_cache(true);
+
+		return loader.read_scene_from_file(path, scene_index);
+	});
+}
+}        // namespace vkb
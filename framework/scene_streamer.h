@@ -0,0 +1,176 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/error.h"
+#include "common/vk_common.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+namespace vkb
+{
+class Device;
+class JobSystem;
+
+namespace sg
+{
+class Node;
+class Scene;
+}        // namespace sg
+
+/**
+ * @brief Streams the cells of a world partition in and out of a scene by their distance to a position, usually the camera.
+ *
+ * A cell is a glTF scene covering a box of the world. Cells split into their own files at cook time only hold
+ * their own meshes and textures, while the sub-scenes of a single file share the resources of the file.
+ * Cells closer than the load distance are loaded on background threads, then attached to the scene at the
+ * start of a frame within a budget of device memory per update. Cells further than the unload distance
+ * are detached, and destroyed through the deletion queue once the frames in flight have completed. The gap
+ * between both distances keeps the cells on the boundary from being loaded and unloaded back and forth.
+ */
+class SceneStreamer
+{
+  public:
+	/**
+	 * @param device The device the cells are loaded with
+	 * @param scene The scene the cells are attached to, see sg::Scene::attach
+	 * @param load_distance Distance from the position under which cells are loaded
+	 * @param unload_distance Distance from the position over which cells are unloaded, at least the load distance
+	 * @param job_system Optional job system shared by the loaders of the cells
+	 */
+	SceneStreamer(Device &device, sg::Scene &scene, float load_distance, float unload_distance, JobSystem *job_system = nullptr);
+
+	SceneStreamer(const SceneStreamer &) = delete;
+
+	SceneStreamer(SceneStreamer &&) = delete;
+
+	/**
+	 * @brief Waits for the cells being loaded, the attached ones stay in the scene
+	 */
+	~SceneStreamer();
+
+	SceneStreamer &operator=(const SceneStreamer &) = delete;
+
+	SceneStreamer &operator=(SceneStreamer &&) = delete;
+
+	/**
+	 * @brief Adds a cell of the world, loaded once the position gets close to its bounds
+	 * @param path Path of the glTF file of the cell, relative to the assets directory
+	 * @param min Minimum corner of the world space bounds of the cell
+	 * @param max Maximum corner of the world space bounds of the cell
+	 * @param scene_index Scene of the file holding the cell, the default one if negative
+	 */
+	void add_cell(const std::string &path, const glm::vec3 &min, const glm::vec3 &max, int scene_index = -1);
+
+	/**
+	 * @brief Starts loading the cells close to the position, attaches the loaded ones and detaches the far ones.
+	 *        Called at the start of a frame, before the scene is updated
+	 * @return Whether cells were attached or detached
+	 */
+	bool update(const glm::vec3 &position);
+
+	/**
+	 * @brief Sets the device memory of the cells attached by one update, to bound the work of a frame.
+	 *        A cell larger than the budget is attached alone
+	 */
+	void set_max_attach_size(VkDeviceSize size);
+
+	/**
+	 * @brief Sets the number of cells loaded at the same time
+	 */
+	void set_max_concurrent_loads(uint32_t count);
+
+	uint32_t get_resident_count() const;
+
+	uint32_t get_loading_count() const;
+
+	/**
+	 * @return Device memory used by the attached cells, in bytes
+	 */
+	VkDeviceSize get_resident_size() const;
+
+  private:
+	enum class CellState
+	{
+		Unloaded,
+		Loading,
+		Loaded,
+		Resident,
+		Failed
+	};
+
+	struct Cell
+	{
+		std::string path;
+
+		int scene_index{-1};
+
+		glm::vec3 min;
+
+		glm::vec3 max;
+
+		CellState state{CellState::Unloaded};
+
+		std::future<std::unique_ptr<sg::Scene>> future;
+
+		/// Scene loaded but not attached yet
+		std::unique_ptr<sg::Scene> scene;
+
+		/// Root of the cell in the scene while it is resident
+		sg::Node *root{nullptr};
+
+		VkDeviceSize size{0};
+	};
+
+	/**
+	 * @return Device memory of the buffers and images of a loaded cell, in bytes
+	 */
+	VkDeviceSize get_size(sg::Scene &cell_scene) const;
+
+	void load(Cell &cell);
+
+	Device &device;
+
+	sg::Scene &scene;
+
+	JobSystem *job_system{nullptr};
+
+	float load_distance{0.0f};
+
+	float unload_distance{0.0f};
+
+	VkDeviceSize max_attach_size{64 * 1024 * 1024};
+
+	uint32_t max_concurrent_loads{2};
+
+	std::vector<Cell> cells;
+
+	/// Cell indices sorted by distance, reused every update
+	std::vector<std::pair<float, size_t>> sorted_cells;
+};
+}        // namespace vkb
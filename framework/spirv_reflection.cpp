@@ -114,6 +114,12 @@ inline void read_resource_array_size(const spirv_cross::Compiler &compiler,
 	const auto &spirv_type = compiler.get_type_from_variable(resource.id);
 
 	shader_resource.array_size = spirv_type.array.size() ? spirv_type.array[0] : 1;
+
+	// Runtime arrays of descriptors get their descriptor count from the variant
+	if (shader_resource.array_size == 0 && variant.get_runtime_array_sizes().count(resource.name) != 0)
+	{
+		shader_resource.array_size = to_u32(variant.get_runtime_array_sizes().at(resource.name));
+	}
 }
 
 inline void read_resource_size(const spirv_cross::Compiler &compiler,
@@ -357,7 +363,7 @@ inline void read_shader_resource<ShaderResourceType::BufferStorage>(const spirv_
 
 	for (auto &resource : storage_resources)
 	{
-		ShaderResource shader_resource;
+		ShaderResource shader_resource{};
 		shader_resource.type   = ShaderResourceType::BufferStorage;
 		shader_resource.stages = stage;
 		shader_resource.name   = resource.name;
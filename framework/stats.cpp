@@ -20,23 +20,234 @@
 
 #include "stats.h"
 
+#include <array>
+#include <cmath>
+#include <numeric>
+
 #include "common/error.h"
+#include "common/logging.h"
+#include "platform/filesystem.h"
 
 namespace vkb
 {
+namespace
+{
+/// Maximum number of samples captured by the worker thread for a frame
+constexpr size_t MAX_CONTINUOUS_SAMPLES = 100;
+
+void add_smoothed_value(std::vector<float> &values, size_t &offset, float value, float alpha)
+{
+	assert(values.size() >= 2 && "Buffers size should be greater than 2");
+
+	// The newest value is just before the oldest one
+	float previous = values[(offset + values.size() - 1) % values.size()];
+
+	// Use an exponential moving average to smooth values, overwriting the oldest value
+	values[offset] = value * alpha + previous * (1.0f - alpha);
+
+	offset = (offset + 1) % values.size();
+}
+
+const char *to_string(StatIndex index)
+{
+	switch (index)
+	{
+		case StatIndex::frame_times:
+			return "frame_times";
+		case StatIndex::cpu_cycles:
+			return "cpu_cycles";
+		case StatIndex::cpu_instructions:
+			return "cpu_instructions";
+		case StatIndex::cache_miss_ratio:
+			return "cache_miss_ratio";
+		case StatIndex::branch_miss_ratio:
+			return "branch_miss_ratio";
+		case StatIndex::gpu_cycles:
+			return "gpu_cycles";
+		case StatIndex::vertex_compute_cycles:
+			return "vertex_compute_cycles";
+		case StatIndex::tiles:
+			return "tiles";
+		case StatIndex::killed_tiles:
+			return "killed_tiles";
+		case StatIndex::fragment_jobs:
+			return "fragment_jobs";
+		case StatIndex::fragment_cycles:
+			return "fragment_cycles";
+		case StatIndex::l2_reads_lookups:
+			return "l2_reads_lookups";
+		case StatIndex::l2_ext_reads:
+			return "l2_ext_reads";
+		case StatIndex::l2_writes_lookups:
+			return "l2_writes_lookups";
+		case StatIndex::l2_ext_writes:
+			return "l2_ext_writes";
+		case StatIndex::l2_ext_read_stalls:
+			return "l2_ext_read_stalls";
+		case StatIndex::l2_ext_write_stalls:
+			return "l2_ext_write_stalls";
+		case StatIndex::l2_ext_read_bytes:
+			return "l2_ext_read_bytes";
+		case StatIndex::l2_ext_write_bytes:
+			return "l2_ext_write_bytes";
+		case StatIndex::tex_cycles:
+			return "tex_cycles";
+		case StatIndex::descriptor_set_allocations:
+			return "descriptor_set_allocations";
+		case StatIndex::descriptor_pool_resets:
+			return "descriptor_pool_resets";
+		case StatIndex::descriptor_set_reuses:
+			return "descriptor_set_reuses";
+		case StatIndex::present_interval:
+			return "present_interval";
+		case StatIndex::present_delay:
+			return "present_delay";
+		case StatIndex::gpu_time:
+			return "gpu_time";
+		case StatIndex::input_assembly_primitives:
+			return "input_assembly_primitives";
+		case StatIndex::vertex_shader_invocations:
+			return "vertex_shader_invocations";
+		case StatIndex::clipping_invocations:
+			return "clipping_invocations";
+		case StatIndex::clipping_primitives:
+			return "clipping_primitives";
+		case StatIndex::fragment_shader_invocations:
+			return "fragment_shader_invocations";
+		case StatIndex::compute_shader_invocations:
+			return "compute_shader_invocations";
+		case StatIndex::command_buffer_allocations:
+			return "command_buffer_allocations";
+		case StatIndex::command_buffer_reuses:
+			return "command_buffer_reuses";
+		case StatIndex::command_buffer_resets:
+			return "command_buffer_resets";
+		case StatIndex::command_pool_reset_time:
+			return "command_pool_reset_time";
+		case StatIndex::command_buffer_allocation_time:
+			return "command_buffer_allocation_time";
+		case StatIndex::device_memory_usage:
+			return "device_memory_usage";
+		case StatIndex::device_memory_budget_usage:
+			return "device_memory_budget_usage";
+	}
+
+	return "unknown";
+}
+
+/**
+ * @brief Nearest-rank percentile of sorted values
+ */
+float percentile(const std::vector<float> &sorted_values, float fraction)
+{
+	auto rank = static_cast<size_t>(std::ceil(fraction * sorted_values.size()));
+
+	return sorted_values[std::min(std::max<size_t>(rank, 1), sorted_values.size()) - 1];
+}
+
+nlohmann::json summarize(const std::vector<float> &values)
+{
+	nlohmann::json summary;
+
+	auto distribution = summarize_values(values);
+
+	summary["count"] = distribution.count;
+
+	if (!values.empty())
+	{
+		summary["min"]    = distribution.min;
+		summary["max"]    = distribution.max;
+		summary["mean"]   = distribution.mean;
+		summary["median"] = distribution.median;
+		summary["p95"]    = distribution.p95;
+		summary["p99"]    = distribution.p99;
+	}
+
+	summary["values"] = values;
+
+	return summary;
+}
+}        // namespace
+
+StatSummary summarize_values(const std::vector<float> &values)
+{
+	StatSummary summary;
+
+	summary.count = values.size();
+
+	if (!values.empty())
+	{
+		std::vector<float> sorted_values{values};
+		std::sort(sorted_values.begin(), sorted_values.end());
+
+		summary.min    = sorted_values.front();
+		summary.max    = sorted_values.back();
+		summary.mean   = static_cast<float>(std::accumulate(values.begin(), values.end(), 0.0) / values.size());
+		summary.median = percentile(sorted_values, 0.5f);
+		summary.p95    = percentile(sorted_values, 0.95f);
+		summary.p99    = percentile(sorted_values, 0.99f);
+	}
+
+	return summary;
+}
+
+Stats::SampleQueue::SampleQueue(size_t capacity) :
+    slots(capacity + 1)
+{
+}
+
+bool Stats::SampleQueue::push(const MeasurementSample &sample)
+{
+	auto write = write_index.load(std::memory_order_relaxed);
+	auto next  = (write + 1) % slots.size();
+
+	if (next == read_index.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+
+	slots[write] = sample;
+
+	// Publishes the slot to the consumer
+	write_index.store(next, std::memory_order_release);
+
+	return true;
+}
+
+bool Stats::SampleQueue::pop(MeasurementSample &sample)
+{
+	auto read = read_index.load(std::memory_order_relaxed);
+
+	if (read == write_index.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+
+	sample = std::move(slots[read]);
+
+	// Hands the slot back to the producer
+	read_index.store((read + 1) % slots.size(), std::memory_order_release);
+
+	return true;
+}
+
 Stats::Stats(const std::set<StatIndex> &enabled_stats, CounterSamplingConfig sampling_config,
              const size_t buffer_size) :
     enabled_stats(enabled_stats),
     sampling_config(sampling_config),
-    stop_worker(std::make_unique<std::promise<void>>())
+    buffer_size(buffer_size),
+    stop_worker(std::make_unique<std::promise<void>>()),
+    continuous_samples(MAX_CONTINUOUS_SAMPLES)
 {
 	assert(buffer_size >= 2 && "Buffers size should be greater than 2");
 
 	for (const auto &stat : enabled_stats)
 	{
-		counters[stat] = std::vector<float>(buffer_size, 0);
+		counters[stat].values = std::vector<float>(buffer_size, 0);
 	}
 
+	pending_samples.reserve(MAX_CONTINUOUS_SAMPLES);
+
 	stat_data = {
 	    {StatIndex::frame_times, {StatScaling::None}},
 	    {StatIndex::cpu_cycles, {hwcpipe::CpuCounter::Cycles}},
@@ -58,6 +269,25 @@ Stats::Stats(const std::set<StatIndex> &enabled_stats, CounterSamplingConfig sam
 	    {StatIndex::l2_ext_read_bytes, {hwcpipe::GpuCounter::ExternalMemoryReadBytes}},
 	    {StatIndex::l2_ext_write_bytes, {hwcpipe::GpuCounter::ExternalMemoryWriteBytes}},
 	    {StatIndex::tex_cycles, {hwcpipe::GpuCounter::ShaderTextureCycles}},
+	    {StatIndex::descriptor_set_allocations, {StatScaling::None}},
+	    {StatIndex::descriptor_pool_resets, {StatScaling::None}},
+	    {StatIndex::descriptor_set_reuses, {StatScaling::None}},
+	    {StatIndex::present_interval, {StatScaling::None}},
+	    {StatIndex::present_delay, {StatScaling::None}},
+	    {StatIndex::gpu_time, {StatScaling::None}},
+	    {StatIndex::input_assembly_primitives, {StatScaling::None}},
+	    {StatIndex::vertex_shader_invocations, {StatScaling::None}},
+	    {StatIndex::clipping_invocations, {StatScaling::None}},
+	    {StatIndex::clipping_primitives, {StatScaling::None}},
+	    {StatIndex::fragment_shader_invocations, {StatScaling::None}},
+	    {StatIndex::compute_shader_invocations, {StatScaling::None}},
+	    {StatIndex::command_buffer_allocations, {StatScaling::None}},
+	    {StatIndex::command_buffer_reuses, {StatScaling::None}},
+	    {StatIndex::command_buffer_resets, {StatScaling::None}},
+	    {StatIndex::command_pool_reset_time, {StatScaling::None}},
+	    {StatIndex::command_buffer_allocation_time, {StatScaling::None}},
+	    {StatIndex::device_memory_usage, {StatScaling::None}},
+	    {StatIndex::device_memory_budget_usage, {StatScaling::None}},
 	};
 
 	hwcpipe::CpuCounterSet enabled_cpu_counters{};
@@ -68,6 +298,11 @@ Stats::Stats(const std::set<StatIndex> &enabled_stats, CounterSamplingConfig sam
 		auto res = stat_data.find(stat);
 		if (res != stat_data.end())
 		{
+			if (res->second.type == StatType::Cpu || res->second.type == StatType::Gpu)
+			{
+				sampled_stats.push_back(stat);
+			}
+
 			switch (res->second.type)
 			{
 				case StatType::Cpu:
@@ -123,17 +358,37 @@ void Stats::resize(const size_t width)
 {
 	// The circular buffer size will be 1/16th of the width of the screen
 	// which means every sixteen pixels represent one graph value
-	size_t buffers_size = width >> 4;
+	buffer_size = width >> 4;
+
+	auto resize_values = [this](StatValues &stat_values) {
+		auto &values = stat_values.values;
+
+		// Put the oldest value first before resizing
+		std::rotate(values.begin(), values.begin() + stat_values.offset, values.end());
+		stat_values.offset = 0;
+
+		values.resize(buffer_size);
+		values.shrink_to_fit();
+	};
 
 	for (auto &counter : counters)
 	{
-		counter.second.resize(buffers_size);
-		counter.second.shrink_to_fit();
+		resize_values(counter.second);
+	}
+
+	for (auto &named_counter : named_counters)
+	{
+		resize_values(named_counter.second);
 	}
 }
 
 bool Stats::is_available(const StatIndex index) const
 {
+	if (queried_stats.count(index) > 0)
+	{
+		return true;
+	}
+
 	const auto &data = stat_data.find(index);
 	if (data == stat_data.end())
 	{
@@ -169,18 +424,52 @@ bool Stats::is_available(const StatIndex index) const
 	return false;
 }
 
-void add_smoothed_value(std::vector<float> &values, float value, float alpha)
+void Stats::set_framework_value(StatIndex index, float value)
 {
-	assert(values.size() >= 2 && "Buffers size should be greater than 2");
+	if (counters.find(index) != counters.end())
+	{
+		framework_values[index] = value;
+	}
+}
+
+void Stats::set_gpu_scope_times(const std::vector<GpuScopeTime> &scope_times)
+{
+	if (counters.find(StatIndex::gpu_time) != counters.end())
+	{
+		gpu_scope_times = scope_times;
+	}
+}
 
-	if (values.size() == values.capacity())
+const std::vector<GpuScopeTime> &Stats::get_gpu_scope_times() const
+{
+	return gpu_scope_times;
+}
+
+void Stats::set_queried_stats(const std::set<StatIndex> &stats)
+{
+	queried_stats = stats;
+}
+
+void Stats::add_named_stat(const std::string &name)
+{
+	if (named_counters.find(name) == named_counters.end())
+	{
+		named_stats.push_back(name);
+		named_counters[name].values = std::vector<float>(std::max<size_t>(buffer_size, 2), 0);
+	}
+}
+
+void Stats::set_named_value(const std::string &name, float value)
+{
+	if (named_counters.find(name) != named_counters.end())
 	{
-		// Shift values to the left to make space at the end and update counters
-		std::rotate(values.begin(), values.begin() + 1, values.end());
+		named_values[name] = value;
 	}
+}
 
-	// Use an exponential moving average to smooth values
-	values.back() = value * alpha + *(values.end() - 2) * (1.0f - alpha);
+const std::vector<std::string> &Stats::get_named_stats() const
+{
+	return named_stats;
 }
 
 void Stats::update()
@@ -199,30 +488,45 @@ void Stats::update()
 		}
 		case CounterSamplingMode::Continuous:
 		{
+			if (recording)
+			{
+				// Every sample is kept to attribute it to its frame, those of a frame are shown once the previous ones are
+				should_add_to_continuous_samples.store(true, std::memory_order_relaxed);
+
+				bool show = pending_samples.empty();
+
+				MeasurementSample sample;
+				while (continuous_samples.pop(sample))
+				{
+					record_sample(sample);
+
+					if (show)
+					{
+						pending_samples.push_back(std::move(sample));
+					}
+				}
+			}
 			// Check that we have no pending samples to be shown
-			if (pending_samples.size() == 0)
+			else if (pending_samples.size() == 0)
 			{
-				std::unique_lock<std::mutex> lock(continuous_sampling_mutex);
-				if (!should_add_to_continuous_samples)
+				if (!should_add_to_continuous_samples.load(std::memory_order_relaxed))
 				{
 					// If we have no pending samples, we let the worker thread
 					// capture samples for the next frame
-					should_add_to_continuous_samples = true;
+					should_add_to_continuous_samples.store(true, std::memory_order_relaxed);
 				}
 				else
 				{
 					// The worker thread has captured a frame, so we stop it
-					// and read the samples
-					should_add_to_continuous_samples = false;
-					pending_samples                  = continuous_samples;
-					continuous_samples.clear();
-				}
-			}
+					// and read the samples, the queue caps their number
+					should_add_to_continuous_samples.store(false, std::memory_order_relaxed);
 
-			// Ensure the number of pending samples is capped at a reasonable value
-			if (pending_samples.size() > 100)
-			{
-				pending_samples.resize(100);
+					MeasurementSample sample;
+					while (continuous_samples.pop(sample))
+					{
+						pending_samples.push_back(std::move(sample));
+					}
+				}
 			}
 			break;
 		}
@@ -232,7 +536,37 @@ void Stats::update()
 	auto delta_time_counter = counters.find(StatIndex::frame_times);
 	if (delta_time_counter != counters.end())
 	{
-		add_smoothed_value(delta_time_counter->second, delta_time, alpha_smoothing);
+		add_smoothed_value(delta_time_counter->second.values, delta_time_counter->second.offset, delta_time, alpha_smoothing);
+		record_value(StatIndex::frame_times, delta_time);
+	}
+
+	// Handle framework counters
+	for (auto &framework_value : framework_values)
+	{
+		auto &counter = counters.at(framework_value.first);
+
+		add_smoothed_value(counter.values, counter.offset, framework_value.second, alpha_smoothing);
+		record_value(framework_value.first, framework_value.second);
+	}
+
+	for (auto &named_value : named_values)
+	{
+		auto &counter = named_counters.at(named_value.first);
+
+		add_smoothed_value(counter.values, counter.offset, named_value.second, alpha_smoothing);
+
+		if (recording)
+		{
+			recorded_named_values[named_value.first].push_back(named_value.second);
+		}
+	}
+
+	if (recording)
+	{
+		for (auto &scope_time : gpu_scope_times)
+		{
+			recorded_scope_times[scope_time.name].push_back(scope_time.time);
+		}
 	}
 
 	if (pending_samples.size() == 0)
@@ -273,12 +607,14 @@ void Stats::continuous_sampling_worker(std::future<void> should_terminate)
 		// Sample counters
 		const auto measurements = hwcpipe->sample();
 
-		// Add the new sample to the vector of continuous samples
+		// Add the new sample to the queue of continuous samples, it is dropped if the main thread is behind
+		if (should_add_to_continuous_samples.load(std::memory_order_relaxed))
 		{
-			std::unique_lock<std::mutex> lock(continuous_sampling_mutex);
-			continuous_samples.push_back({measurements.cpu ? *measurements.cpu : hwcpipe::CpuMeasurements{},
-			                              measurements.gpu ? *measurements.gpu : hwcpipe::GpuMeasurements{},
-			                              delta_time});
+			continuous_samples.push({measurements.cpu ? *measurements.cpu : hwcpipe::CpuMeasurements{},
+			                         measurements.gpu ? *measurements.gpu : hwcpipe::GpuMeasurements{},
+			                         delta_time,
+			                         frame_phase.load(std::memory_order_relaxed),
+			                         get_time()});
 		}
 	}
 }
@@ -287,7 +623,13 @@ void Stats::push_sample(const MeasurementSample &sample)
 {
 	for (auto &c : counters)
 	{
-		auto &values = c.second;
+		auto &counter = c.second;
+
+		// Stats measured with performance queries are set as framework values
+		if (queried_stats.count(c.first) > 0)
+		{
+			continue;
+		}
 
 		const auto data = stat_data.find(c.first);
 		if (data == stat_data.end())
@@ -296,66 +638,367 @@ void Stats::push_sample(const MeasurementSample &sample)
 		}
 
 		float measurement = 0;
-		switch (data->second.type)
+		float divisor     = 1;
+		if (!read_counter(c.first, sample, measurement, divisor))
+		{
+			// Skip to next counter
+			continue;
+		}
+
+		if (data->second.scaling == StatScaling::ByCounter)
+		{
+			measurement = divisor != 0 ? measurement / divisor : 0;
+		}
+
+		if (data->second.scaling == StatScaling::ByDeltaTime)
+		{
+			measurement /= sample.delta_time;
+		}
+
+		add_smoothed_value(counter.values, counter.offset, measurement, alpha_smoothing);
+		record_value(c.first, measurement);
+	}
+}
+
+bool Stats::read_counter(StatIndex index, const MeasurementSample &sample, float &value, float &divisor) const
+{
+	const auto data = stat_data.find(index);
+	if (data == stat_data.end())
+	{
+		return false;
+	}
+
+	value   = 0;
+	divisor = 1;
+
+	switch (data->second.type)
+	{
+		case StatType::Cpu:
 		{
-			case StatType::Cpu:
+			const auto &cpu_res = sample.cpu.find(data->second.cpu_counter);
+			if (cpu_res != sample.cpu.end())
 			{
-				const auto &cpu_res = sample.cpu.find(data->second.cpu_counter);
-				if (cpu_res != sample.cpu.end())
-				{
-					measurement = cpu_res->second.get<float>();
-				}
+				value = cpu_res->second.get<float>();
+			}
 
-				if (data->second.scaling == StatScaling::ByCounter)
-				{
-					const auto &divisor_cpu_res = sample.cpu.find(data->second.divisor_cpu_counter);
-					if (divisor_cpu_res != sample.cpu.end())
-					{
-						measurement /= divisor_cpu_res->second.get<float>();
-					}
-					else
-					{
-						measurement = 0;
-					}
-				}
-				break;
+			if (data->second.scaling == StatScaling::ByCounter)
+			{
+				const auto &divisor_cpu_res = sample.cpu.find(data->second.divisor_cpu_counter);
+				divisor                     = divisor_cpu_res != sample.cpu.end() ? divisor_cpu_res->second.get<float>() : 0;
+			}
+			return true;
+		}
+		case StatType::Gpu:
+		{
+			const auto &gpu_res = sample.gpu.find(data->second.gpu_counter);
+			if (gpu_res != sample.gpu.end())
+			{
+				value = gpu_res->second.get<float>();
 			}
-			case StatType::Gpu:
+
+			if (data->second.scaling == StatScaling::ByCounter)
 			{
-				const auto &gpu_res = sample.gpu.find(data->second.gpu_counter);
-				if (gpu_res != sample.gpu.end())
-				{
-					measurement = gpu_res->second.get<float>();
-				}
+				const auto &divisor_gpu_res = sample.gpu.find(data->second.divisor_gpu_counter);
+				divisor                     = divisor_gpu_res != sample.gpu.end() ? divisor_gpu_res->second.get<float>() : 0;
+			}
+			return true;
+		}
+		default:
+			return false;
+	}
+}
 
-				if (data->second.scaling == StatScaling::ByCounter)
-				{
-					const auto &divisor_gpu_res = sample.gpu.find(data->second.divisor_gpu_counter);
-					if (divisor_gpu_res != sample.gpu.end())
-					{
-						measurement /= divisor_gpu_res->second.get<float>();
-					}
-					else
-					{
-						measurement = 0;
-					}
-				}
-				break;
+void Stats::record_sample(const MeasurementSample &sample)
+{
+	RecordedSample recorded{};
+
+	recorded.frame_index = sample.frame_phase >> 1;
+	recorded.phase       = static_cast<FramePhase>(sample.frame_phase & 1);
+	recorded.time        = sample.time - sample.delta_time * 0.5;
+
+	recorded.values.resize(sampled_stats.size());
+	recorded.divisors.resize(sampled_stats.size());
+
+	for (size_t i = 0; i < sampled_stats.size(); ++i)
+	{
+		read_counter(sampled_stats[i], sample, recorded.values[i], recorded.divisors[i]);
+	}
+
+	recorded_samples.push_back(std::move(recorded));
+}
+
+double Stats::get_time() const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+uint64_t Stats::pack_frame_phase(uint64_t frame_index, FramePhase phase)
+{
+	return (frame_index << 1) | static_cast<uint64_t>(phase);
+}
+
+void Stats::begin_frame_phase(uint64_t frame_index, FramePhase phase)
+{
+	frame_phase.store(pack_frame_phase(frame_index, phase), std::memory_order_relaxed);
+
+	if (recording && phase == FramePhase::Submit && sampling_config.mode == CounterSamplingMode::Continuous)
+	{
+		submit_times[frame_index] = get_time();
+	}
+}
+
+void Stats::set_frame_gpu_time(uint64_t frame_index, float gpu_time)
+{
+	auto submit_time = submit_times.find(frame_index);
+	if (submit_time == submit_times.end())
+	{
+		return;
+	}
+
+	// The GPU starts a frame once it is submitted and the previous frame is done
+	GpuWindow window;
+	window.start   = std::max(submit_time->second, gpu_window_end);
+	window.end     = window.start + gpu_time;
+	gpu_window_end = window.end;
+
+	gpu_windows[frame_index] = window;
+
+	// Frames submitted before have no GPU time anymore, such as those whose queries were disabled
+	submit_times.erase(submit_times.begin(), std::next(submit_time));
+}
+
+void Stats::record_value(StatIndex index, float value)
+{
+	if (recording)
+	{
+		recorded_values[index].push_back(value);
+	}
+}
+
+void Stats::set_recording(bool enable)
+{
+	recording = enable;
+}
+
+bool Stats::is_recording() const
+{
+	return recording;
+}
+
+bool Stats::write_report(const std::string &name) const
+{
+	nlohmann::json report;
+
+	report["stats"]      = nlohmann::json::object();
+	report["gpu_scopes"] = nlohmann::json::object();
+
+	for (auto &values : recorded_values)
+	{
+		report["stats"][to_string(values.first)] = summarize(values.second);
+	}
+
+	for (auto &values : recorded_named_values)
+	{
+		report["stats"][values.first] = summarize(values.second);
+	}
+
+	for (auto &scope_times : recorded_scope_times)
+	{
+		report["gpu_scopes"][scope_times.first] = summarize(scope_times.second);
+	}
+
+	if (!fs::write_json(report, name + ".json"))
+	{
+		return false;
+	}
+
+	// One column per stat and one row per recorded value, hardware counters may have several samples per frame
+	std::ofstream csv{fs::path::get(fs::path::Type::Graphs) + name + ".csv", std::ios::out | std::ios::trunc};
+
+	if (!csv.good())
+	{
+		LOGE("Could not write benchmark report {}.csv", name);
+		return false;
+	}
+
+	std::vector<const std::vector<float> *> columns;
+	size_t                                  row_count = 0;
+
+	csv << "index";
+
+	for (auto &values : recorded_values)
+	{
+		csv << "," << to_string(values.first);
+		columns.push_back(&values.second);
+		row_count = std::max(row_count, values.second.size());
+	}
+
+	for (auto &values : recorded_named_values)
+	{
+		csv << "," << values.first;
+		columns.push_back(&values.second);
+		row_count = std::max(row_count, values.second.size());
+	}
+
+	for (auto &scope_times : recorded_scope_times)
+	{
+		csv << ",gpu_scope:" << scope_times.first;
+		columns.push_back(&scope_times.second);
+		row_count = std::max(row_count, scope_times.second.size());
+	}
+
+	csv << "\n";
+
+	for (size_t row = 0; row < row_count; ++row)
+	{
+		csv << row;
+
+		for (auto *column : columns)
+		{
+			csv << ",";
+
+			if (row < column->size())
+			{
+				csv << (*column)[row];
 			}
-			default:
+		}
+
+		csv << "\n";
+	}
+
+	if (!recorded_samples.empty())
+	{
+		return write_frame_report(name);
+	}
+
+	return true;
+}
+
+bool Stats::write_frame_report(const std::string &name) const
+{
+	// Counter totals of a frame, in the record phase, the submit phase and the GPU-busy window
+	struct FrameCounters
+	{
+		size_t sample_count{0};
+
+		std::array<std::vector<double>, 3> values;
+
+		std::array<std::vector<double>, 3> divisors;
+	};
+
+	const size_t gpu_slot = 2;
+
+	std::map<uint64_t, FrameCounters> frames;
+
+	auto add_sample = [&](uint64_t frame_index, size_t slot, const RecordedSample &sample) {
+		auto &frame = frames[frame_index];
+
+		if (frame.values[slot].empty())
+		{
+			frame.values[slot].resize(sampled_stats.size(), 0.0);
+			frame.divisors[slot].resize(sampled_stats.size(), 0.0);
+		}
+
+		for (size_t i = 0; i < sampled_stats.size(); ++i)
+		{
+			frame.values[slot][i] += sample.values[i];
+			frame.divisors[slot][i] += sample.divisors[i];
+		}
+	};
+
+	// Samples and GPU windows are both in time order
+	auto window = gpu_windows.begin();
+
+	for (auto &sample : recorded_samples)
+	{
+		add_sample(sample.frame_index, static_cast<size_t>(sample.phase), sample);
+		frames[sample.frame_index].sample_count++;
+
+		while (window != gpu_windows.end() && window->second.end <= sample.time)
+		{
+			++window;
+		}
+
+		if (window != gpu_windows.end() && sample.time >= window->second.start)
+		{
+			add_sample(window->first, gpu_slot, sample);
+		}
+	}
+
+	std::ofstream csv{fs::path::get(fs::path::Type::Graphs) + name + "_frames.csv", std::ios::out | std::ios::trunc};
+
+	if (!csv.good())
+	{
+		LOGE("Could not write benchmark report {}_frames.csv", name);
+		return false;
+	}
+
+	const char *slot_names[] = {"record", "submit", "gpu"};
+
+	csv << "frame,samples,gpu_start,gpu_end";
+
+	for (auto index : sampled_stats)
+	{
+		if (queried_stats.count(index) == 0)
+		{
+			for (auto slot_name : slot_names)
 			{
-				// Skip to next counter
-				continue;
+				csv << "," << to_string(index) << ":" << slot_name;
 			}
 		}
+	}
 
-		if (data->second.scaling == StatScaling::ByDeltaTime)
+	csv << "\n";
+
+	for (auto &frame : frames)
+	{
+		csv << frame.first << "," << frame.second.sample_count << ",";
+
+		auto frame_window = gpu_windows.find(frame.first);
+		if (frame_window != gpu_windows.end())
 		{
-			measurement /= sample.delta_time;
+			csv << frame_window->second.start << "," << frame_window->second.end;
+		}
+		else
+		{
+			csv << ",";
 		}
 
-		add_smoothed_value(values, measurement, alpha_smoothing);
+		for (size_t i = 0; i < sampled_stats.size(); ++i)
+		{
+			if (queried_stats.count(sampled_stats[i]) > 0)
+			{
+				continue;
+			}
+
+			bool by_counter = stat_data.at(sampled_stats[i]).scaling == StatScaling::ByCounter;
+
+			for (size_t slot = 0; slot < frame.second.values.size(); ++slot)
+			{
+				csv << ",";
+
+				if (frame.second.values[slot].empty())
+				{
+					continue;
+				}
+
+				// Counts are summed over the frame, ratios are those of the sums
+				double value = frame.second.values[slot][i];
+
+				if (by_counter)
+				{
+					double divisor = frame.second.divisors[slot][i];
+					value          = divisor != 0.0 ? value / divisor : 0.0;
+				}
+
+				csv << value;
+			}
+		}
+
+		csv << "\n";
 	}
+
+	return true;
 }
 
 }        // namespace vkb
@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <ctime>
 #include <future>
@@ -61,7 +63,26 @@ enum class StatIndex
 	l2_ext_write_stalls,
 	l2_ext_read_bytes,
 	l2_ext_write_bytes,
-	tex_cycles
+	tex_cycles,
+	descriptor_set_allocations,
+	descriptor_pool_resets,
+	descriptor_set_reuses,
+	present_interval,
+	present_delay,
+	gpu_time,
+	input_assembly_primitives,
+	vertex_shader_invocations,
+	clipping_invocations,
+	clipping_primitives,
+	fragment_shader_invocations,
+	compute_shader_invocations,
+	command_buffer_allocations,
+	command_buffer_reuses,
+	command_buffer_resets,
+	command_pool_reset_time,
+	command_buffer_allocation_time,
+	device_memory_usage,
+	device_memory_budget_usage
 };
 
 struct StatIndexHash
@@ -141,6 +162,66 @@ struct StatData
 
 using StatDataMap = std::unordered_map<StatIndex, StatData, StatIndexHash>;
 
+/**
+ * @brief Distribution of a series of values
+ */
+struct StatSummary
+{
+	size_t count{0};
+
+	float min{0.0f};
+
+	float max{0.0f};
+
+	float mean{0.0f};
+
+	float median{0.0f};
+
+	float p95{0.0f};
+
+	float p99{0.0f};
+};
+
+/**
+ * @brief Computes the distribution of a series of values, with nearest-rank percentiles
+ */
+StatSummary summarize_values(const std::vector<float> &values);
+
+/**
+ * @brief GPU time measured for a scope of a frame
+ */
+struct GpuScopeTime
+{
+	std::string name;
+
+	/// Number of scopes the scope is nested in
+	uint32_t depth;
+
+	/// Time in seconds
+	float time;
+
+	/// Time from the beginning of the first scope of the recording, in seconds
+	float start;
+};
+
+/**
+ * @brief Counts of pipeline statistics queries
+ */
+struct PipelineStatistics
+{
+	uint64_t input_assembly_primitives{0};
+
+	uint64_t vertex_shader_invocations{0};
+
+	uint64_t clipping_invocations{0};
+
+	uint64_t clipping_primitives{0};
+
+	uint64_t fragment_shader_invocations{0};
+
+	uint64_t compute_shader_invocations{0};
+};
+
 enum class CounterSamplingMode
 {
 	/// Sample counters only when calling update()
@@ -149,6 +230,17 @@ enum class CounterSamplingMode
 	Continuous
 };
 
+/**
+ * @brief Phases of a frame on the CPU, the samples of continuous sampling are tagged with the phase they were taken in
+ */
+enum class FramePhase : uint8_t
+{
+	/// From the start of the frame to its submission, the scene is updated and the command buffers recorded
+	Record,
+	/// From the submission of the frame to the start of the next one, which includes the present
+	Submit
+};
+
 struct CounterSamplingConfig
 {
 	/// Sampling mode (polling or continuous)
@@ -202,9 +294,18 @@ class Stats
 	 */
 	const std::vector<float> &get_data(StatIndex index) const
 	{
-		return counters.at(index);
+		return counters.at(index).values;
 	};
 
+	/**
+	 * @param index The stat index of the data requested
+	 * @return The position of the oldest value in the circular buffer of the stat
+	 */
+	size_t get_data_offset(StatIndex index) const
+	{
+		return counters.at(index).offset;
+	}
+
 	/**
 	 * @return The enabled stats
 	 */
@@ -213,17 +314,167 @@ class Stats
 		return enabled_stats;
 	}
 
+	/**
+	 * @brief Sets the value of a stat measured by the framework rather than by a hardware counter,
+	 *        it is added to the stat data on the next update
+	 * @param index The stat index
+	 * @param value The value measured for the last frame
+	 */
+	void set_framework_value(StatIndex index, float value);
+
+	/**
+	 * @brief Sets the GPU stats measured with performance queries instead of hwcpipe, which are available
+	 *        on any vendor. Their values are set with @ref set_framework_value
+	 */
+	void set_queried_stats(const std::set<StatIndex> &stats);
+
+	/**
+	 * @brief Adds a stat without a StatIndex, such as a performance counter of the driver, shown after the enabled stats
+	 * @param name The name of the stat
+	 */
+	void add_named_stat(const std::string &name);
+
+	/**
+	 * @brief Sets the value of a named stat for the last frame, it is added to the stat data on the next update
+	 */
+	void set_named_value(const std::string &name, float value);
+
+	/**
+	 * @return The named stats, in the order they were added
+	 */
+	const std::vector<std::string> &get_named_stats() const;
+
+	const std::vector<float> &get_named_data(const std::string &name) const
+	{
+		return named_counters.at(name).values;
+	}
+
+	size_t get_named_data_offset(const std::string &name) const
+	{
+		return named_counters.at(name).offset;
+	}
+
+	/**
+	 * @brief Sets the GPU time of the scopes of the last frame, shown along with the gpu_time stat
+	 */
+	void set_gpu_scope_times(const std::vector<GpuScopeTime> &scope_times);
+
+	const std::vector<GpuScopeTime> &get_gpu_scope_times() const;
+
 	/**
 	 * @brief Update statistics, must be called after every frame
 	 */
 	void update();
 
+	/**
+	 * @brief Tags the samples taken from now on with a frame and a phase, so that the counters
+	 *        of each recorded frame can be reconstructed from the samples of continuous sampling
+	 * @param frame_index The index of the frame, increasing by one every frame
+	 * @param phase The phase the frame enters
+	 */
+	void begin_frame_phase(uint64_t frame_index, FramePhase phase);
+
+	/**
+	 * @brief Sets the GPU time of a submitted frame, measured with timestamps. Its GPU-busy window is assumed to start
+	 *        when both the frame was submitted and the window of the previous frame ended
+	 * @param frame_index The index the frame had when it was submitted
+	 * @param gpu_time The GPU time of the frame, in seconds
+	 */
+	void set_frame_gpu_time(uint64_t frame_index, float gpu_time);
+
+	/**
+	 * @brief Enables recording the unsmoothed values of the enabled stats and of the GPU scopes, for @ref write_report
+	 */
+	void set_recording(bool enable);
+
+	bool is_recording() const;
+
+	/**
+	 * @brief Writes the recorded values with their min, median, 95th and 99th percentiles,
+	 *        as <name>.json and <name>.csv in the graphs directory. With continuous sampling, the counters
+	 *        of each frame are also written, split by phase and GPU-busy window, as <name>_frames.csv
+	 * @param name The name of the report files, without extension
+	 * @return True if the report was written
+	 */
+	bool write_report(const std::string &name) const;
+
   private:
 	struct MeasurementSample
 	{
 		hwcpipe::CpuMeasurements cpu{};
 		hwcpipe::GpuMeasurements gpu{};
 		float                    delta_time{0.0f};
+
+		/// Frame and phase tag of the main thread when the sample was taken, see pack_frame_phase
+		uint64_t frame_phase{0};
+
+		/// Time of the sample, in seconds since the stats were created
+		double time{0.0};
+	};
+
+	/**
+	 * @brief Raw counter values of a sample kept while recording, to attribute them to frames
+	 */
+	struct RecordedSample
+	{
+		uint64_t frame_index;
+
+		FramePhase phase;
+
+		/// Middle of the interval the sample covers, in seconds since the stats were created
+		double time;
+
+		/// Values of the counters of the sampled stats, and of their divisor counters
+		std::vector<float> values;
+
+		std::vector<float> divisors;
+	};
+
+	/**
+	 * @brief Interval in which the GPU was busy with a frame, estimated from its GPU time
+	 */
+	struct GpuWindow
+	{
+		double start;
+
+		double end;
+	};
+
+	/**
+	 * @brief Lock-free queue of samples between a single producer, the worker thread, and a single
+	 *        consumer, the main thread. Its slots are allocated once, samples are dropped while it is full
+	 */
+	class SampleQueue
+	{
+	  public:
+		explicit SampleQueue(size_t capacity);
+
+		/// Called by the producer, returns false if the queue is full
+		bool push(const MeasurementSample &sample);
+
+		/// Called by the consumer, returns false if the queue is empty
+		bool pop(MeasurementSample &sample);
+
+	  private:
+		/// One slot is kept empty to tell a full queue from an empty one
+		std::vector<MeasurementSample> slots;
+
+		/// Next slot to read, only written by the consumer
+		std::atomic<size_t> read_index{0};
+
+		/// Next slot to write, only written by the producer
+		std::atomic<size_t> write_index{0};
+	};
+
+	/**
+	 * @brief Circular buffer of the values of a stat
+	 */
+	struct StatValues
+	{
+		std::vector<float> values;
+
+		/// Position of the oldest value, which the next value overwrites
+		size_t offset{0};
 	};
 
 	/// Stats to be enabled
@@ -245,7 +496,77 @@ class Stats
 	float alpha_smoothing{0.2f};
 
 	/// Circular buffers for counter data
-	std::map<StatIndex, std::vector<float>> counters{};
+	std::map<StatIndex, StatValues> counters{};
+
+	/// Values of the framework stats for the last frame
+	std::map<StatIndex, float> framework_values{};
+
+	/// GPU stats measured with performance queries
+	std::set<StatIndex> queried_stats;
+
+	std::vector<std::string> named_stats;
+
+	/// Circular buffers of the named stats
+	std::map<std::string, StatValues> named_counters;
+
+	/// Values of the named stats for the last frame
+	std::map<std::string, float> named_values;
+
+	/// Size of the circular buffers
+	size_t buffer_size;
+
+	std::vector<GpuScopeTime> gpu_scope_times;
+
+	bool recording{false};
+
+	/// Unsmoothed values of each stat, recorded since recording was enabled
+	std::map<StatIndex, std::vector<float>> recorded_values;
+
+	/// GPU time of each scope, in seconds, for each recorded frame
+	std::map<std::string, std::vector<float>> recorded_scope_times;
+
+	/// Unsmoothed values of each named stat, recorded since recording was enabled
+	std::map<std::string, std::vector<float>> recorded_named_values;
+
+	/// Start of the time of the samples, shared by the main and the worker threads
+	std::chrono::steady_clock::time_point start_time{std::chrono::steady_clock::now()};
+
+	/// Frame index and phase of the main thread, packed for the worker thread to read them together
+	std::atomic<uint64_t> frame_phase{0};
+
+	/// Hardware counter stats whose values are kept in the recorded samples, in order
+	std::vector<StatIndex> sampled_stats;
+
+	/// Samples of continuous sampling taken while recording
+	std::vector<RecordedSample> recorded_samples;
+
+	/// Submission time of the recorded frames, whose GPU time is not known yet
+	std::map<uint64_t, double> submit_times;
+
+	/// GPU-busy window of each recorded frame
+	std::map<uint64_t, GpuWindow> gpu_windows;
+
+	/// End of the last GPU-busy window
+	double gpu_window_end{0.0};
+
+	double get_time() const;
+
+	static uint64_t pack_frame_phase(uint64_t frame_index, FramePhase phase);
+
+	/**
+	 * @brief Reads the counter of a hardware counter stat from a sample
+	 * @param divisor Set to the value of the divisor counter for stats scaled by a counter, 1 otherwise, 0 if it was not sampled
+	 * @return False if the stat is not measured with a hardware counter
+	 */
+	bool read_counter(StatIndex index, const MeasurementSample &sample, float &value, float &divisor) const;
+
+	/// Keeps the raw counter values of a sample of continuous sampling, tagged with its frame
+	void record_sample(const MeasurementSample &sample);
+
+	/// Writes the counters of each recorded frame as <name>_frames.csv
+	bool write_frame_report(const std::string &name) const;
+
+	void record_value(StatIndex index, float value);
 
 	/// Profiler to gather CPU and GPU performance data
 	std::unique_ptr<hwcpipe::HWCPipe> hwcpipe{};
@@ -256,14 +577,11 @@ class Stats
 	/// Promise to stop the worker thread
 	std::unique_ptr<std::promise<void>> stop_worker;
 
-	/// A mutex for accessing measurements during continuous sampling
-	std::mutex continuous_sampling_mutex;
-
 	/// The samples read during continuous sampling
-	std::vector<MeasurementSample> continuous_samples;
+	SampleQueue continuous_samples;
 
 	/// A flag specifying if the worker thread should add entries to continuous_samples
-	bool should_add_to_continuous_samples{false};
+	std::atomic<bool> should_add_to_continuous_samples{false};
 
 	/// The samples waiting to be displayed
 	std::vector<MeasurementSample> pending_samples;
@@ -0,0 +1,318 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "common/logging.h"
+#include "core/buffer.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "core/image.h"
+#include "core/image_view.h"
+#include "scene_graph/components/image.h"
+#include "scene_graph/scene.h"
+
+namespace vkb
+{
+TextureStreamer::TextureStreamer(Device &device, sg::Scene &scene, VkDeviceSize memory_budget, uint32_t frames_in_flight) :
+    device{device},
+    memory_budget{memory_budget},
+    frames_in_flight{frames_in_flight}
+{
+	for (auto image : scene.get_components<sg::Image>())
+	{
+		// The levels uploaded by the loader are the tail, whichever size it picked
+		auto tail_level = image->get_vk_base_level();
+
+		// Only images which kept their data can have their levels uploaded again
+		if (tail_level == 0 || image->get_data().empty())
+		{
+			continue;
+		}
+
+		StreamedImage streamed_image{};
+		streamed_image.image          = image;
+		streamed_image.tail_level     = tail_level;
+		streamed_image.resident_level = tail_level;
+
+		image_indices[image] = images.size();
+		images.push_back(streamed_image);
+	}
+
+	LOGI("Streaming {} images within {} MB", images.size(), memory_budget / (1024 * 1024));
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	// Retired images may still be used by frames in flight
+	auto &deletion_queue = device.get_deletion_queue();
+
+	for (auto &retired : retired_resources)
+	{
+		deletion_queue.release(std::move(retired.image));
+		deletion_queue.release(std::move(retired.staging_buffer));
+	}
+}
+
+uint32_t TextureStreamer::get_tail_level(const sg::Image &image, uint32_t tail_size)
+{
+	auto &mipmaps = image.get_mipmaps();
+
+	for (uint32_t level = 0; level < mipmaps.size(); level++)
+	{
+		auto &extent = mipmaps[level].extent;
+
+		if (std::max(extent.width, extent.height) <= tail_size)
+		{
+			return level;
+		}
+	}
+
+	return to_u32(mipmaps.size()) - 1;
+}
+
+void TextureStreamer::request(const sg::Image &image, float screen_size)
+{
+	auto index_it = image_indices.find(&image);
+
+	if (index_it == image_indices.end())
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock{request_mutex};
+
+	auto &streamed_image          = images[index_it->second];
+	streamed_image.requested_size = std::max(streamed_image.requested_size, screen_size);
+}
+
+void TextureStreamer::update(CommandBuffer &command_buffer)
+{
+	update_index++;
+
+	// A replaced view may be cached in descriptor sets until every frame has been recorded without
+	// it and reset again, so it is kept for two rounds of frames to avoid a reuse of its handle
+	while (!retired_resources.empty() && retired_resources.front().update_index + 2 * frames_in_flight < update_index)
+	{
+		retired_resources.pop_front();
+	}
+
+	std::lock_guard<std::mutex> lock{request_mutex};
+
+	// Levels wanted by the requests, images which were not requested keep their levels for a while
+	std::vector<uint32_t> target_levels(images.size());
+
+	VkDeviceSize total_size = 0;
+
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		auto &streamed_image = images[i];
+
+		uint32_t level = streamed_image.resident_level;
+
+		if (streamed_image.requested_size > 0.0f)
+		{
+			auto &extent = streamed_image.image->get_extent();
+
+			float texels_per_pixel = std::max(extent.width, extent.height) / streamed_image.requested_size;
+
+			level = texels_per_pixel <= 1.0f ? 0 : static_cast<uint32_t>(std::log2(texels_per_pixel));
+			level = std::min(level, streamed_image.tail_level);
+
+			streamed_image.requested_update = update_index;
+		}
+		else if (idle_update_count > 0 && streamed_image.requested_update + idle_update_count < update_index)
+		{
+			level = streamed_image.tail_level;
+		}
+
+		target_levels[i] = level;
+
+		total_size += get_size(streamed_image, level);
+	}
+
+	// Images from the smallest to the largest on screen
+	std::vector<size_t> order(images.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		order[i] = i;
+	}
+
+	std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+		return images[a].requested_size < images[b].requested_size;
+	});
+
+	// Evict the top levels of the smallest images until the budget is met
+	for (auto index : order)
+	{
+		auto &streamed_image = images[index];
+
+		while (total_size > memory_budget && target_levels[index] < streamed_image.tail_level)
+		{
+			total_size -= get_size(streamed_image, target_levels[index]) - get_size(streamed_image, target_levels[index] + 1);
+
+			target_levels[index]++;
+		}
+
+		if (total_size <= memory_budget)
+		{
+			break;
+		}
+	}
+
+	// Apply the changes from the largest images on screen, within the upload limit
+	VkDeviceSize uploaded_size = 0;
+
+	streaming = false;
+
+	for (auto order_it = order.rbegin(); order_it != order.rend(); ++order_it)
+	{
+		auto &streamed_image = images[*order_it];
+
+		auto target_level = target_levels[*order_it];
+
+		if (target_level == streamed_image.resident_level)
+		{
+			continue;
+		}
+
+		auto upload_size = get_size(streamed_image, target_level);
+
+		if (uploaded_size > 0 && uploaded_size + upload_size > max_upload_size)
+		{
+			continue;
+		}
+
+		stream(command_buffer, streamed_image, target_level);
+
+		uploaded_size += upload_size;
+
+		streaming = true;
+	}
+
+	for (auto &streamed_image : images)
+	{
+		streamed_image.requested_size = 0.0f;
+	}
+}
+
+VkDeviceSize TextureStreamer::get_resident_size() const
+{
+	VkDeviceSize size = 0;
+
+	for (auto &streamed_image : images)
+	{
+		size += get_size(streamed_image, streamed_image.resident_level);
+	}
+
+	return size;
+}
+
+bool TextureStreamer::is_streaming() const
+{
+	return streaming;
+}
+
+void TextureStreamer::set_max_upload_size(VkDeviceSize size)
+{
+	max_upload_size = size;
+}
+
+void TextureStreamer::set_idle_update_count(uint32_t count)
+{
+	idle_update_count = count;
+}
+
+VkDeviceSize TextureStreamer::get_size(const StreamedImage &streamed_image, uint32_t base_level)
+{
+	VkDeviceSize size = 0;
+
+	for (uint32_t level = base_level; level < streamed_image.image->get_mipmaps().size(); level++)
+	{
+		size += streamed_image.image->get_mipmap_size(level);
+	}
+
+	return size;
+}
+
+void TextureStreamer::stream(CommandBuffer &command_buffer, StreamedImage &streamed_image, uint32_t base_level)
+{
+	auto &image   = *streamed_image.image;
+	auto &mipmaps = image.get_mipmaps();
+
+	RetiredResources retired{};
+	retired.update_index = update_index;
+
+	image.create_streamed_vk_image(device, base_level, retired.image);
+
+	// The staging buffer is only released with the previous image, once the frame has completed
+	auto base_offset = mipmaps[base_level].offset;
+	auto size        = get_size(streamed_image, base_level);
+
+	retired.staging_buffer = std::make_unique<core::Buffer>(device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	retired.staging_buffer->update(image.get_data().data() + base_offset, static_cast<size_t>(size));
+
+	{
+		ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		memory_barrier.src_access_mask = 0;
+		memory_barrier.dst_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_HOST_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+		command_buffer.image_memory_barrier(image.get_vk_image_view(), memory_barrier);
+	}
+
+	std::vector<VkBufferImageCopy> buffer_copy_regions;
+
+	for (uint32_t level = base_level; level < mipmaps.size(); level++)
+	{
+		VkBufferImageCopy copy_region{};
+		copy_region.bufferOffset              = mipmaps[level].offset - base_offset;
+		copy_region.imageSubresource          = image.get_vk_image_view().get_subresource_layers();
+		copy_region.imageSubresource.mipLevel = level - base_level;
+		copy_region.imageExtent               = mipmaps[level].extent;
+
+		buffer_copy_regions.push_back(copy_region);
+	}
+
+	command_buffer.copy_buffer_to_image(*retired.staging_buffer, image.get_vk_image(), buffer_copy_regions);
+
+	{
+		ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		memory_barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+		command_buffer.image_memory_barrier(image.get_vk_image_view(), memory_barrier);
+	}
+
+	retired_resources.push_back(std::move(retired));
+
+	streamed_image.resident_level = base_level;
+}
+}        // namespace vkb
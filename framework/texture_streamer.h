@@ -0,0 +1,183 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class Device;
+
+namespace core
+{
+class Buffer;
+class Image;
+class ImageView;
+}        // namespace core
+
+namespace sg
+{
+class Image;
+class Scene;
+}        // namespace sg
+
+/**
+ * @brief Streams the mip levels of scene images according to their size on screen.
+ *        Images are loaded with their smallest levels only (see GLTFLoader::set_texture_streaming),
+ *        which stand in for them until the larger levels are uploaded on request. The top levels
+ *        of the smallest images on screen are evicted to keep the resident levels within a memory
+ *        budget, and those of the images no longer drawn are evicted after a number of updates.
+ *        Changing the resident levels recreates the Vulkan image, so the images must be bound
+ *        by view every time they are used, which rules out bindless textures.
+ */
+class TextureStreamer
+{
+  public:
+	/// Largest extent of the levels which are resident from the start
+	static const uint32_t TAIL_SIZE = 128;
+
+	/**
+	 * @param device The device the images are created with
+	 * @param scene Its images which kept their data and have levels above the tail are streamed
+	 * @param memory_budget Device memory the streamed images can use, in bytes
+	 * @param frames_in_flight Number of frames which can be in flight, to know when replaced images are unused
+	 */
+	TextureStreamer(Device &device, sg::Scene &scene, VkDeviceSize memory_budget, uint32_t frames_in_flight);
+
+	TextureStreamer(const TextureStreamer &) = delete;
+
+	TextureStreamer(TextureStreamer &&) = delete;
+
+	~TextureStreamer();
+
+	TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+	TextureStreamer &operator=(TextureStreamer &&) = delete;
+
+	/**
+	 * @param tail_size Largest extent of the levels resident from the start
+	 * @return The first data level to keep resident for an image in a scene loaded with streaming
+	 */
+	static uint32_t get_tail_level(const sg::Image &image, uint32_t tail_size = TAIL_SIZE);
+
+	/**
+	 * @brief Requests the levels of an image needed until the next update, can be called from any thread
+	 * @param image The image sampled by a draw
+	 * @param screen_size Approximate size in pixels of the object sampling the image
+	 */
+	void request(const sg::Image &image, float screen_size);
+
+	/**
+	 * @brief Changes the resident levels of the images according to the requests since the
+	 *        previous update and the memory budget, and records the uploads
+	 * @param command_buffer Command buffer of the frame, outside of a render pass
+	 */
+	void update(CommandBuffer &command_buffer);
+
+	/**
+	 * @return Device memory used by the resident levels, in bytes
+	 */
+	VkDeviceSize get_resident_size() const;
+
+	/**
+	 * @return Whether the last update changed the resident levels of an image, the frames sampling them
+	 *         then request the levels they need next
+	 */
+	bool is_streaming() const;
+
+	/**
+	 * @brief Sets the maximum number of bytes uploaded by one update, to bound the cost of a frame
+	 */
+	void set_max_upload_size(VkDeviceSize size);
+
+	/**
+	 * @brief Sets the number of updates after which an image not requested drops back to its tail levels,
+	 *        0 keeps the levels until the memory budget is exceeded
+	 */
+	void set_idle_update_count(uint32_t count);
+
+  private:
+	struct StreamedImage
+	{
+		sg::Image *image{nullptr};
+
+		uint32_t tail_level{0};
+
+		uint32_t resident_level{0};
+
+		float requested_size{0.0f};
+
+		/// Update of the last request
+		uint64_t requested_update{0};
+	};
+
+	struct RetiredResources
+	{
+		uint64_t update_index{0};
+
+		/// Destroyed along with its views
+		std::unique_ptr<core::Image> image;
+
+		std::unique_ptr<core::Buffer> staging_buffer;
+	};
+
+	/**
+	 * @return Size of the levels of an image from a base level
+	 */
+	static VkDeviceSize get_size(const StreamedImage &streamed_image, uint32_t base_level);
+
+	/**
+	 * @brief Recreates an image with the levels from base_level onwards and records their upload
+	 */
+	void stream(CommandBuffer &command_buffer, StreamedImage &streamed_image, uint32_t base_level);
+
+	Device &device;
+
+	VkDeviceSize memory_budget{0};
+
+	VkDeviceSize max_upload_size{32 * 1024 * 1024};
+
+	uint32_t idle_update_count{256};
+
+	uint32_t frames_in_flight{0};
+
+	uint64_t update_index{0};
+
+	/// Whether the last update streamed an image
+	bool streaming{false};
+
+	std::vector<StreamedImage> images;
+
+	std::unordered_map<const sg::Image *, size_t> image_indices;
+
+	std::mutex request_mutex;
+
+	std::deque<RetiredResources> retired_resources;
+};
+}        // namespace vkb
@@ -0,0 +1,97 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "timeline_semaphore.h"
+
+#include "common/error.h"
+#include "core/device.h"
+
+namespace vkb
+{
+TimelineSemaphore::TimelineSemaphore(Device &device) :
+    device{device}
+{
+	VkSemaphoreTypeCreateInfoKHR type_info{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR};
+	type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+	type_info.initialValue  = 0;
+
+	VkSemaphoreCreateInfo create_info{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+	create_info.pNext = &type_info;
+
+	VkResult result = vkCreateSemaphore(device.get_handle(), &create_info, nullptr, &handle);
+
+	if (result != VK_SUCCESS)
+	{
+		throw VulkanException{result, "Cannot create timeline semaphore"};
+	}
+}
+
+TimelineSemaphore::TimelineSemaphore(TimelineSemaphore &&other) :
+    device{other.device},
+    handle{other.handle},
+    signaled_value{other.signaled_value}
+{
+	other.handle = VK_NULL_HANDLE;
+}
+
+TimelineSemaphore::~TimelineSemaphore()
+{
+	if (handle != VK_NULL_HANDLE)
+	{
+		wait(signaled_value);
+
+		vkDestroySemaphore(device.get_handle(), handle, nullptr);
+	}
+}
+
+VkSemaphore TimelineSemaphore::get_handle() const
+{
+	return handle;
+}
+
+uint64_t TimelineSemaphore::request_signal_value()
+{
+	return ++signaled_value;
+}
+
+uint64_t TimelineSemaphore::get_signaled_value() const
+{
+	return signaled_value;
+}
+
+uint64_t TimelineSemaphore::get_completed_value() const
+{
+	uint64_t value{0};
+
+	VK_CHECK(vkGetSemaphoreCounterValueKHR(device.get_handle(), handle, &value));
+
+	return value;
+}
+
+VkResult TimelineSemaphore::wait(uint64_t value, uint64_t timeout) const
+{
+	VkSemaphoreWaitInfoKHR wait_info{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR};
+	wait_info.semaphoreCount = 1;
+	wait_info.pSemaphores    = &handle;
+	wait_info.pValues        = &value;
+
+	return vkWaitSemaphoresKHR(device.get_handle(), &wait_info, timeout);
+}
+}        // namespace vkb
@@ -0,0 +1,75 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+
+namespace vkb
+{
+class Device;
+
+/**
+ * @brief A VK_KHR_timeline_semaphore semaphore, whose counter is incremented by each
+ *        submission signaling it. Waiting on a value replaces waiting on a set of fences.
+ */
+class TimelineSemaphore
+{
+  public:
+	TimelineSemaphore(Device &device);
+
+	TimelineSemaphore(const TimelineSemaphore &) = delete;
+
+	TimelineSemaphore(TimelineSemaphore &&other);
+
+	~TimelineSemaphore();
+
+	TimelineSemaphore &operator=(const TimelineSemaphore &) = delete;
+
+	TimelineSemaphore &operator=(TimelineSemaphore &&) = delete;
+
+	VkSemaphore get_handle() const;
+
+	/**
+	 * @return The value to be signaled by the next submission, which must be submitted
+	 */
+	uint64_t request_signal_value();
+
+	/**
+	 * @return The last value requested for a submission
+	 */
+	uint64_t get_signaled_value() const;
+
+	/**
+	 * @return The value of the counter the GPU has reached
+	 */
+	uint64_t get_completed_value() const;
+
+	VkResult wait(uint64_t value, uint64_t timeout = std::numeric_limits<uint64_t>::max()) const;
+
+  private:
+	Device &device;
+
+	VkSemaphore handle{VK_NULL_HANDLE};
+
+	uint64_t signaled_value{0};
+};
+}        // namespace vkb
@@ -0,0 +1,316 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "transfer_manager.h"
+
+#include "common/error.h"
+#include "common/logging.h"
+#include "core/buffer.h"
+#include "core/command_buffer.h"
+#include "core/command_pool.h"
+#include "core/device.h"
+#include "core/image_view.h"
+#include "core/queue.h"
+#include "timeline_semaphore.h"
+
+namespace vkb
+{
+TransferManager::TransferManager(Device &device) :
+    device{device}
+{
+	auto &graphics_queue  = device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+	graphics_family_index = graphics_queue.get_family_index();
+
+	uint32_t family_count{0};
+	vkGetPhysicalDeviceQueueFamilyProperties(device.get_physical_device(), &family_count, nullptr);
+
+	std::vector<VkQueueFamilyProperties> family_properties(family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(device.get_physical_device(), &family_count, family_properties.data());
+
+	queue = &graphics_queue;
+
+	// A transfer-only family usually maps to DMA engines which run alongside the graphics queue
+	for (uint32_t family_index = 0; family_index < family_count; family_index++)
+	{
+		auto flags = family_properties[family_index].queueFlags;
+
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			queue = &device.get_queue(family_index, 0);
+
+			LOGI("Transfers use the dedicated queue family {}", family_index);
+
+			break;
+		}
+	}
+
+	command_pool = std::make_unique<CommandPool>(device, queue->get_family_index());
+
+	if (device.is_enabled(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+	{
+		timeline = std::make_unique<TimelineSemaphore>(device);
+	}
+}
+
+TransferManager::~TransferManager()
+{
+	wait(submitted_value);
+
+	for (auto fence : free_fences)
+	{
+		vkDestroyFence(device.get_handle(), fence, nullptr);
+	}
+}
+
+const Queue &TransferManager::get_queue() const
+{
+	return *queue;
+}
+
+bool TransferManager::has_dedicated_queue() const
+{
+	return queue->get_family_index() != graphics_family_index;
+}
+
+CommandBuffer &TransferManager::get_command_buffer()
+{
+	if (!command_buffer)
+	{
+		command_buffer = &command_pool->request_command_buffer();
+		command_buffer->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	}
+
+	return *command_buffer;
+}
+
+void TransferManager::release_image(const core::ImageView &image_view, const ImageMemoryBarrier &barrier)
+{
+	if (!has_dedicated_queue())
+	{
+		get_command_buffer().image_memory_barrier(image_view, barrier);
+		return;
+	}
+
+	// The destination masks are ignored by a release, they belong to the acquire
+	ImageMemoryBarrier release{barrier};
+	release.dst_stage_mask   = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	release.dst_access_mask  = 0;
+	release.old_queue_family = queue->get_family_index();
+	release.new_queue_family = graphics_family_index;
+
+	get_command_buffer().image_memory_barrier(image_view, release);
+
+	recorded_images.push_back({&image_view, release});
+	recorded_images.back().barrier.dst_stage_mask  = barrier.dst_stage_mask;
+	recorded_images.back().barrier.dst_access_mask = barrier.dst_access_mask;
+}
+
+void TransferManager::release_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize size, const BufferMemoryBarrier &barrier)
+{
+	if (!has_dedicated_queue())
+	{
+		get_command_buffer().buffer_memory_barrier(buffer, offset, size, barrier);
+		return;
+	}
+
+	BufferMemoryBarrier release{barrier};
+	release.dst_stage_mask   = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	release.dst_access_mask  = 0;
+	release.old_queue_family = queue->get_family_index();
+	release.new_queue_family = graphics_family_index;
+
+	get_command_buffer().buffer_memory_barrier(buffer, offset, size, release);
+
+	recorded_buffers.push_back({&buffer, offset, size, release});
+	recorded_buffers.back().barrier.dst_stage_mask  = barrier.dst_stage_mask;
+	recorded_buffers.back().barrier.dst_access_mask = barrier.dst_access_mask;
+}
+
+uint64_t TransferManager::submit()
+{
+	if (!command_buffer)
+	{
+		return 0;
+	}
+
+	command_buffer->end();
+
+	Submission submission{++submitted_value, VK_NULL_HANDLE, std::move(recorded_images), std::move(recorded_buffers)};
+
+	recorded_images.clear();
+	recorded_buffers.clear();
+
+	VkCommandBuffer handle = command_buffer->get_handle();
+
+	VkSubmitInfo submit_info{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers    = &handle;
+
+	VkTimelineSemaphoreSubmitInfoKHR timeline_info{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR};
+
+	VkSemaphore timeline_handle{VK_NULL_HANDLE};
+
+	if (timeline)
+	{
+		timeline_handle = timeline->get_handle();
+
+		// Values of the transfer manager and of its timeline advance together
+		uint64_t signal_value = timeline->request_signal_value();
+		assert(signal_value == submission.value && "Transfer timeline out of sync");
+
+		timeline_info.signalSemaphoreValueCount = 1;
+		timeline_info.pSignalSemaphoreValues    = &submission.value;
+
+		submit_info.pNext                = &timeline_info;
+		submit_info.signalSemaphoreCount = 1;
+		submit_info.pSignalSemaphores    = &timeline_handle;
+	}
+	else
+	{
+		if (free_fences.empty())
+		{
+			VkFenceCreateInfo fence_info{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+
+			VkFence fence{VK_NULL_HANDLE};
+			VK_CHECK(vkCreateFence(device.get_handle(), &fence_info, nullptr, &fence));
+
+			free_fences.push_back(fence);
+		}
+
+		submission.fence = free_fences.back();
+		free_fences.pop_back();
+	}
+
+	VK_CHECK(queue->submit({submit_info}, submission.fence));
+
+	submissions.push_back(std::move(submission));
+
+	command_buffer = nullptr;
+
+	return submitted_value;
+}
+
+bool TransferManager::is_complete(uint64_t value)
+{
+	update_completed();
+
+	return completed_value >= value;
+}
+
+void TransferManager::wait(uint64_t value)
+{
+	if (value == 0 || is_complete(value))
+	{
+		return;
+	}
+
+	if (timeline)
+	{
+		VK_CHECK(timeline->wait(value));
+	}
+	else
+	{
+		for (auto &submission : submissions)
+		{
+			if (submission.value == value)
+			{
+				VK_CHECK(vkWaitForFences(device.get_handle(), 1, &submission.fence, VK_TRUE, std::numeric_limits<uint64_t>::max()));
+				break;
+			}
+		}
+	}
+
+	update_completed();
+}
+
+bool TransferManager::acquire(CommandBuffer &command_buffer)
+{
+	update_completed();
+
+	for (auto &release : completed_images)
+	{
+		ImageMemoryBarrier acquire{release.barrier};
+		acquire.src_stage_mask  = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		acquire.src_access_mask = 0;
+
+		command_buffer.image_memory_barrier(*release.image_view, acquire);
+	}
+
+	for (auto &release : completed_buffers)
+	{
+		BufferMemoryBarrier acquire{release.barrier};
+		acquire.src_stage_mask  = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		acquire.src_access_mask = 0;
+
+		command_buffer.buffer_memory_barrier(*release.buffer, release.offset, release.size, acquire);
+	}
+
+	completed_images.clear();
+	completed_buffers.clear();
+
+	return submissions.empty() && recorded_images.empty() && recorded_buffers.empty();
+}
+
+void TransferManager::update_completed()
+{
+	if (timeline)
+	{
+		completed_value = timeline->get_completed_value();
+	}
+	else
+	{
+		for (auto &submission : submissions)
+		{
+			if (vkGetFenceStatus(device.get_handle(), submission.fence) != VK_SUCCESS)
+			{
+				break;
+			}
+
+			completed_value = submission.value;
+		}
+	}
+
+	bool retired = false;
+
+	while (!submissions.empty() && submissions.front().value <= completed_value)
+	{
+		auto &submission = submissions.front();
+
+		completed_images.insert(completed_images.end(), submission.images.begin(), submission.images.end());
+		completed_buffers.insert(completed_buffers.end(), submission.buffers.begin(), submission.buffers.end());
+
+		if (submission.fence != VK_NULL_HANDLE)
+		{
+			VK_CHECK(vkResetFences(device.get_handle(), 1, &submission.fence));
+			free_fences.push_back(submission.fence);
+		}
+
+		submissions.pop_front();
+
+		retired = true;
+	}
+
+	// Command buffers are recycled together once none is in flight
+	if (retired && submissions.empty() && !command_buffer)
+	{
+		command_pool->reset_pool();
+	}
+}
+}        // namespace vkb
@@ -0,0 +1,172 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class CommandPool;
+class Device;
+class Queue;
+class TimelineSemaphore;
+
+namespace core
+{
+class Buffer;
+class ImageView;
+}        // namespace core
+
+/**
+ * @brief Records uploads and submits them without blocking to a transfer-only queue when the device has one,
+ *        to the graphics queue otherwise. Resources written by a dedicated queue are released to the
+ *        graphics queue family, and acquired by it once their transfer has completed.
+ *        Completion is tracked with a timeline semaphore if the device enables them, with fences otherwise.
+ */
+class TransferManager
+{
+  public:
+	TransferManager(Device &device);
+
+	TransferManager(const TransferManager &) = delete;
+
+	TransferManager(TransferManager &&) = delete;
+
+	~TransferManager();
+
+	TransferManager &operator=(const TransferManager &) = delete;
+
+	TransferManager &operator=(TransferManager &&) = delete;
+
+	const Queue &get_queue() const;
+
+	/**
+	 * @return Whether transfers run on another queue family than graphics, so resources change ownership
+	 */
+	bool has_dedicated_queue() const;
+
+	/**
+	 * @return The command buffer recording the transfers until the next submit
+	 */
+	CommandBuffer &get_command_buffer();
+
+	/**
+	 * @brief Records the barrier making an image written by the transfers available to the graphics queue.
+	 *        With a dedicated queue it releases the image, and the acquire is recorded by acquire()
+	 * @param image_view The image written by the transfers
+	 * @param barrier The barrier from the transfer writes to the use on the graphics queue
+	 */
+	void release_image(const core::ImageView &image_view, const ImageMemoryBarrier &barrier);
+
+	/**
+	 * @brief Buffer variant of release_image
+	 */
+	void release_buffer(const core::Buffer &buffer, VkDeviceSize offset, VkDeviceSize size, const BufferMemoryBarrier &barrier);
+
+	/**
+	 * @brief Submits the transfers recorded so far without waiting for them
+	 * @return The value to pass to is_complete() or wait(), 0 if nothing was recorded
+	 */
+	uint64_t submit();
+
+	bool is_complete(uint64_t value);
+
+	void wait(uint64_t value);
+
+	/**
+	 * @brief Records the acquire barriers of the resources whose transfers have completed
+	 *        in a command buffer of the graphics queue
+	 * @return True if every released resource has been acquired
+	 */
+	bool acquire(CommandBuffer &command_buffer);
+
+  private:
+	struct ImageRelease
+	{
+		const core::ImageView *image_view;
+
+		ImageMemoryBarrier barrier;
+	};
+
+	struct BufferRelease
+	{
+		const core::Buffer *buffer;
+
+		VkDeviceSize offset;
+
+		VkDeviceSize size;
+
+		BufferMemoryBarrier barrier;
+	};
+
+	struct Submission
+	{
+		uint64_t value;
+
+		VkFence fence;
+
+		std::vector<ImageRelease> images;
+
+		std::vector<BufferRelease> buffers;
+	};
+
+	/**
+	 * @brief Retires the completed submissions, their resources can then be acquired
+	 */
+	void update_completed();
+
+	Device &device;
+
+	const Queue *queue{nullptr};
+
+	uint32_t graphics_family_index{0};
+
+	std::unique_ptr<CommandPool> command_pool;
+
+	std::unique_ptr<TimelineSemaphore> timeline;
+
+	CommandBuffer *command_buffer{nullptr};
+
+	std::deque<Submission> submissions;
+
+	/// Releases recorded in the current command buffer
+	std::vector<ImageRelease> recorded_images;
+
+	std::vector<BufferRelease> recorded_buffers;
+
+	/// Releases whose transfers completed, waiting to be acquired
+	std::vector<ImageRelease> completed_images;
+
+	std::vector<BufferRelease> completed_buffers;
+
+	std::vector<VkFence> free_fences;
+
+	uint64_t submitted_value{0};
+
+	uint64_t completed_value{0};
+};
+}        // namespace vkb
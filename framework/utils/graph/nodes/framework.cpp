@@ -320,6 +320,8 @@ FrameworkNode::FrameworkNode(size_t id, const ShaderResource &shader_resource)
                                         {"size", shader_resource.size},
                                         {"constant_id", shader_resource.constant_id},
                                         {"dynamic", shader_resource.dynamic},
+                                        {"push_descriptor", shader_resource.push_descriptor},
+                                        {"update_after_bind", shader_resource.update_after_bind},
                                         {"name", shader_resource.name}};
 	attributes["group"] = "Rendering";
 }
@@ -0,0 +1,1104 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "virtual_textures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+#include "common/logging.h"
+#include "core/buffer.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "core/image.h"
+#include "core/image_view.h"
+#include "core/queue.h"
+#include "core/sampler.h"
+#include "job_system.h"
+#include "scene_graph/components/image.h"
+#include "scene_graph/components/pbr_material.h"
+#include "scene_graph/components/texture.h"
+#include "scene_graph/scene.h"
+#include "timer.h"
+
+namespace vkb
+{
+namespace
+{
+const uint32_t PAGE_FILE_MAGIC = 0x54564B56;        // "VKVT"
+
+const uint32_t PAGE_FILE_VERSION = 1;
+
+/// Magic, version, extent of the pages and number of pages
+const size_t PAGE_FILE_HEADER_SIZE = 4 * sizeof(uint32_t);
+
+const uint32_t TEXEL_SIZE = 4;
+
+static_assert(VirtualTextures::SET < ResourceBindingState::MAX_SETS, "Virtual textures are bound to a supported set");
+
+static_assert(VirtualTextures::TEXTURE_BINDING < ResourceSet::MAX_BINDINGS && VirtualTextures::PAGE_TABLE_BINDING < ResourceSet::MAX_BINDINGS &&
+                  VirtualTextures::FEEDBACK_BINDING < ResourceSet::MAX_BINDINGS,
+              "Virtual textures are bound below the bindings limit of resource sets");
+
+/**
+ * @return Whether the levels of an image above its tail can be paged
+ */
+bool can_page(const sg::Image &image)
+{
+	auto format = image.get_format();
+
+	if (image.get_vk_base_level() == 0 || image.get_data().empty() ||
+	    (format != VK_FORMAT_R8G8B8A8_UNORM && format != VK_FORMAT_R8G8B8A8_SRGB))
+	{
+		return false;
+	}
+
+	// The shaders derive the extent of the levels from the first one
+	auto &mipmaps = image.get_mipmaps();
+	auto &extent  = mipmaps[0].extent;
+
+	for (uint32_t level = 0; level < image.get_vk_base_level(); level++)
+	{
+		if (mipmaps[level].extent.width != std::max(extent.width >> level, 1u) ||
+		    mipmaps[level].extent.height != std::max(extent.height >> level, 1u))
+		{
+			return false;
+		}
+	}
+
+	return extent.depth == 1 && extent.width <= 0xFFFF && extent.height <= 0xFFFF;
+}
+
+uint32_t get_page_count(uint32_t extent)
+{
+	return (extent + VirtualTextures::PAGE_SIZE - 1) / VirtualTextures::PAGE_SIZE;
+}
+
+uint32_t wrap(int64_t coordinate, uint32_t extent)
+{
+	return static_cast<uint32_t>(((coordinate % extent) + extent) % extent);
+}
+
+/**
+ * @brief Transitions all the levels of an image
+ */
+void transition(CommandBuffer &command_buffer, const core::ImageView &view, VkImageLayout old_layout, VkImageLayout new_layout,
+                VkAccessFlags src_access_mask, VkAccessFlags dst_access_mask, VkPipelineStageFlags src_stage_mask, VkPipelineStageFlags dst_stage_mask)
+{
+	ImageMemoryBarrier barrier{};
+	barrier.old_layout      = old_layout;
+	barrier.new_layout      = new_layout;
+	barrier.src_access_mask = src_access_mask;
+	barrier.dst_access_mask = dst_access_mask;
+	barrier.src_stage_mask  = src_stage_mask;
+	barrier.dst_stage_mask  = dst_stage_mask;
+
+	command_buffer.image_memory_barrier(view, barrier);
+}
+}        // namespace
+
+const char *VirtualTextures::TEXTURE_NAME = "base_color_texture";
+
+VirtualTextures::VirtualTextures(Device &device, sg::Scene &scene, VkDeviceSize memory_budget, uint32_t frames_in_flight, JobSystem *job_system) :
+    device{device},
+    job_system{job_system},
+    frames_in_flight{frames_in_flight}
+{
+	if (!device.get_features().fragmentStoresAndAtomics)
+	{
+		LOGW("Virtual textures need fragmentStoresAndAtomics, no image is paged");
+		return;
+	}
+
+	// The paged images are the base color images of the materials, all in the format of the first one
+	std::vector<sg::Image *> images;
+
+	for (auto material : scene.get_components<sg::PBRMaterial>())
+	{
+		auto texture_it = material->textures.find(TEXTURE_NAME);
+
+		if (texture_it == material->textures.end())
+		{
+			continue;
+		}
+
+		auto image = texture_it->second->get_image();
+
+		if (image == nullptr || image_indices.count(image) > 0 || !can_page(*image) ||
+		    (format != VK_FORMAT_UNDEFINED && image->get_format() != format))
+		{
+			continue;
+		}
+
+		format = image->get_format();
+
+		auto &extent = image->get_extent();
+
+		auto paged_image         = std::make_unique<PagedImage>();
+		paged_image->image       = image;
+		paged_image->page_offset = to_u32(pages.size());
+		paged_image->extent      = {extent.width, extent.height};
+		paged_image->level_count = image->get_vk_base_level();
+
+		uint32_t page_count = 0;
+
+		for (uint32_t level = 0; level < paged_image->level_count; level++)
+		{
+			auto level_extent = get_level_extent(*paged_image, level);
+
+			paged_image->level_offsets.push_back(page_count);
+
+			page_count += get_page_count(level_extent.width) * get_page_count(level_extent.height);
+		}
+
+		pages.resize(pages.size() + page_count);
+
+		image_indices[image] = paged_images.size();
+		paged_images.push_back(std::move(paged_image));
+		images.push_back(image);
+	}
+
+	if (paged_images.empty())
+	{
+		return;
+	}
+
+	if (!create_sparse_images(memory_budget))
+	{
+		create_page_cache(memory_budget);
+	}
+
+	load_page_file(images);
+
+	// The pages are read from the page file from now on
+	for (auto image : images)
+	{
+		image->clear_data();
+	}
+
+	for (uint32_t slot = slot_count; slot-- > 0;)
+	{
+		free_slots.push_back(slot);
+	}
+
+	page_table_entries.resize(pages.size(), NO_PAGE);
+
+	page_table = std::make_unique<core::Buffer>(device, std::max<VkDeviceSize>(pages.size() * sizeof(uint32_t), sizeof(uint32_t)),
+	                                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	page_table->set_debug_name("Page table");
+
+	VkDeviceSize feedback_size = std::max<VkDeviceSize>((pages.size() + 31) / 32 * sizeof(uint32_t), sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < frames_in_flight + 1; i++)
+	{
+		auto feedback_buffer = std::make_unique<core::Buffer>(device, feedback_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+
+		std::memset(feedback_buffer->map(), 0, static_cast<size_t>(feedback_size));
+		feedback_buffer->flush();
+
+		feedback_buffers.push_back(std::move(feedback_buffer));
+	}
+
+	VkSamplerCreateInfo sampler_info{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+	sampler_info.magFilter    = VK_FILTER_LINEAR;
+	sampler_info.minFilter    = VK_FILTER_LINEAR;
+	sampler_info.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.maxLod       = VK_LOD_CLAMP_NONE;
+
+	sampler = &device.get_resource_cache().request_sampler(sampler_info);
+
+	LOGI("Paging {} images in {} pages, {} resident at most in {}", paged_images.size(), pages.size(), slot_count,
+	     is_sparse() ? "sparse images" : "a page cache");
+}
+
+VirtualTextures::~VirtualTextures()
+{
+	// The worker may still be reading pages into the staging buffer, and the device binding them
+	if (load_batch && load_batch->copy.valid())
+	{
+		load_batch->copy.wait();
+	}
+
+	if (bind_fence != VK_NULL_HANDLE)
+	{
+		if (load_batch && load_batch->bound)
+		{
+			vkWaitForFences(device.get_handle(), 1, &bind_fence, VK_TRUE, UINT64_MAX);
+		}
+
+		vkDestroyFence(device.get_handle(), bind_fence, nullptr);
+	}
+
+	// The images and buffers may still be used by frames in flight
+	auto &deletion_queue = device.get_deletion_queue();
+
+	if (load_batch)
+	{
+		deletion_queue.release(std::move(load_batch->staging_buffer));
+	}
+
+	for (auto &paged_image : paged_images)
+	{
+		deletion_queue.release(std::move(paged_image->sparse_image));
+	}
+
+	deletion_queue.release(std::move(page_cache));
+	deletion_queue.release(std::move(page_table));
+
+	for (auto &feedback_buffer : feedback_buffers)
+	{
+		deletion_queue.release(std::move(feedback_buffer));
+	}
+
+	// Freed after the sparse images bound to it, which were released first
+	if (sparse_memory != VK_NULL_HANDLE)
+	{
+		auto allocator = device.get_memory_allocator();
+		auto memory    = sparse_memory;
+
+		deletion_queue.defer([allocator, memory]() { vmaFreeMemory(allocator, memory); });
+	}
+}
+
+const VirtualTextures::PagedImage *VirtualTextures::find(const sg::Image &image) const
+{
+	auto index_it = image_indices.find(&image);
+
+	return index_it != image_indices.end() ? paged_images[index_it->second].get() : nullptr;
+}
+
+bool VirtualTextures::is_sparse() const
+{
+	return sparse_memory != VK_NULL_HANDLE;
+}
+
+void VirtualTextures::update(CommandBuffer &command_buffer)
+{
+	update_index++;
+
+	if (paged_images.empty())
+	{
+		return;
+	}
+
+	if (!initialized)
+	{
+		auto initialize = [&command_buffer](const core::ImageView &view) {
+			transition(command_buffer, view, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			           0, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+		};
+
+		if (page_cache_view)
+		{
+			initialize(*page_cache_view);
+		}
+
+		for (auto &paged_image : paged_images)
+		{
+			if (paged_image->sparse_view)
+			{
+				initialize(*paged_image->sparse_view);
+			}
+		}
+
+		initialized = true;
+	}
+
+	// The feedback written by the previous frame is made visible to the host once this frame completes
+	{
+		BufferMemoryBarrier barrier{};
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_HOST_BIT;
+		barrier.src_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dst_access_mask = VK_ACCESS_HOST_READ_BIT;
+
+		auto &previous_buffer = *feedback_buffers[(update_index - 1) % feedback_buffers.size()];
+
+		command_buffer.buffer_memory_barrier(previous_buffer, 0, previous_buffer.get_size(), barrier);
+	}
+
+	// The frame which wrote this buffer, and the frame after it which made its writes visible, have completed
+	feedback_index = update_index % feedback_buffers.size();
+
+	read_feedback(to_u32(feedback_index));
+
+	// Evicted slots are reused once no frame in flight samples them through the page table
+	while (!retired_slots.empty() && retired_slots.front().update_index + feedback_buffers.size() <= update_index)
+	{
+		free_slots.push_back(retired_slots.front().slot);
+
+		if (is_sparse())
+		{
+			unbound_pages.push_back(retired_slots.front().page);
+		}
+
+		retired_slots.pop_front();
+	}
+
+	if (load_batch && load_batch->copy.valid() && load_batch->copy.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		// Rethrows the errors of the worker
+		load_batch->copy.get();
+	}
+
+	if (load_batch && !load_batch->copy.valid())
+	{
+		if (!is_sparse())
+		{
+			upload_pages(command_buffer);
+		}
+		else if (!load_batch->bound)
+		{
+			bind_sparse_pages();
+		}
+		else if (vkGetFenceStatus(device.get_handle(), bind_fence) == VK_SUCCESS)
+		{
+			upload_pages(command_buffer);
+		}
+	}
+
+	if (!load_batch)
+	{
+		start_loading();
+	}
+
+	upload_page_table(command_buffer);
+}
+
+void VirtualTextures::bind(CommandBuffer &command_buffer, const PagedImage &paged_image) const
+{
+	auto &view = paged_image.sparse_view ? *paged_image.sparse_view : *page_cache_view;
+
+	command_buffer.bind_image(view, *sampler, SET, TEXTURE_BINDING, 0);
+
+	command_buffer.bind_buffer(*page_table, 0, page_table->get_size(), SET, PAGE_TABLE_BINDING, 0);
+
+	auto &feedback_buffer = *feedback_buffers[feedback_index];
+
+	command_buffer.bind_buffer(feedback_buffer, 0, feedback_buffer.get_size(), SET, FEEDBACK_BINDING, 0);
+}
+
+size_t VirtualTextures::get_page_count() const
+{
+	return pages.size();
+}
+
+uint32_t VirtualTextures::get_slot_count() const
+{
+	return slot_count;
+}
+
+uint32_t VirtualTextures::get_resident_page_count() const
+{
+	return resident_page_count;
+}
+
+void VirtualTextures::set_max_page_loads(uint32_t count)
+{
+	max_page_loads = std::max(count, 1u);
+}
+
+void VirtualTextures::load_page_file(const std::vector<sg::Image *> &images)
+{
+	size_t record_size = page_record_extent * page_record_extent * TEXEL_SIZE;
+
+	uint32_t header[4] = {PAGE_FILE_MAGIC, PAGE_FILE_VERSION, page_record_extent, to_u32(pages.size())};
+
+	// Keyed by the images and the layout of the pages, which differs between sparse images and the page cache
+	uint32_t key_data[3] = {static_cast<uint32_t>(format), page_record_extent, PAGE_SIZE};
+
+	auto key = hash_bytes(key_data, sizeof(key_data));
+
+	for (auto image : images)
+	{
+		key = hash_bytes(image->get_data(), key);
+	}
+
+	auto filename = "virtual_textures_" + std::to_string(key) + ".bin";
+
+	try
+	{
+		page_file = fs::map_temp(filename);
+	}
+	catch (const std::runtime_error &)
+	{
+	}
+
+	if (page_file.get_size() == PAGE_FILE_HEADER_SIZE + pages.size() * record_size &&
+	    std::memcmp(page_file.get_data(), header, sizeof(header)) == 0)
+	{
+		return;
+	}
+
+	Timer timer;
+	timer.start();
+
+	std::vector<uint8_t> data(PAGE_FILE_HEADER_SIZE + pages.size() * record_size);
+
+	std::memcpy(data.data(), header, sizeof(header));
+
+	auto border = static_cast<int64_t>(page_record_extent - PAGE_SIZE) / 2;
+
+	// The texels of each page and its border in a row, wrapping around the level as the repeat address mode does
+	auto cook = [&](uint32_t begin, uint32_t end, size_t) {
+		for (uint32_t image_index = begin; image_index < end; image_index++)
+		{
+			auto &paged_image = *paged_images[image_index];
+			auto &image       = *images[image_index];
+
+			for (uint32_t level = 0; level < paged_image.level_count; level++)
+			{
+				auto level_extent = get_level_extent(paged_image, level);
+				auto level_data   = image.get_data().data() + image.get_mipmaps()[level].offset;
+
+				for (uint32_t y = 0; y < get_page_count(level_extent.height); y++)
+				{
+					for (uint32_t x = 0; x < get_page_count(level_extent.width); x++)
+					{
+						auto record = data.data() + PAGE_FILE_HEADER_SIZE + get_page(image_index, level, x, y) * record_size;
+
+						for (uint32_t j = 0; j < page_record_extent; j++)
+						{
+							auto row = level_data + wrap(int64_t{y} * PAGE_SIZE + j - border, level_extent.height) * level_extent.width * TEXEL_SIZE;
+
+							for (uint32_t i = 0; i < page_record_extent; i++)
+							{
+								auto column = wrap(int64_t{x} * PAGE_SIZE + i - border, level_extent.width);
+
+								std::memcpy(record + (j * page_record_extent + i) * TEXEL_SIZE, row + column * TEXEL_SIZE, TEXEL_SIZE);
+							}
+						}
+					}
+				}
+			}
+		}
+	};
+
+	if (job_system)
+	{
+		job_system->parallel_for(to_u32(paged_images.size()), 1, cook);
+	}
+	else
+	{
+		cook(0, to_u32(paged_images.size()), 0);
+	}
+
+	fs::write_temp(data, filename);
+
+	// Mapped rather than kept, so that the pages not resident stay on disk
+	data.clear();
+	data.shrink_to_fit();
+
+	page_file = fs::map_temp(filename);
+
+	auto elapsed_time = timer.stop();
+
+	LOGI("Time spent cooking virtual texture pages: {} seconds, {} pages.", vkb::to_string(elapsed_time), pages.size());
+}
+
+bool VirtualTextures::create_sparse_images(VkDeviceSize memory_budget)
+{
+	auto &features = device.get_features();
+
+	if (!features.sparseBinding || !features.sparseResidencyImage2D || !device.get_properties().sparseProperties.residencyStandard2DBlockShape)
+	{
+		return false;
+	}
+
+	// The graphics queue if it binds sparse memory, as the binds are then submitted where the images are used
+	for (auto queue_flags : {VkQueueFlags{VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_SPARSE_BINDING_BIT}, VkQueueFlags{VK_QUEUE_SPARSE_BINDING_BIT}})
+	{
+		try
+		{
+			sparse_queue = &device.get_queue_by_flags(queue_flags, 0);
+			break;
+		}
+		catch (const std::runtime_error &)
+		{
+		}
+	}
+
+	if (!sparse_queue)
+	{
+		return false;
+	}
+
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+	uint32_t property_count = 0;
+	vkGetPhysicalDeviceSparseImageFormatProperties(device.get_physical_device(), format, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT,
+	                                               usage, VK_IMAGE_TILING_OPTIMAL, &property_count, nullptr);
+
+	std::vector<VkSparseImageFormatProperties> format_properties(property_count);
+	vkGetPhysicalDeviceSparseImageFormatProperties(device.get_physical_device(), format, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT,
+	                                               usage, VK_IMAGE_TILING_OPTIMAL, &property_count, format_properties.data());
+
+	if (property_count != 1 || format_properties[0].aspectMask != VK_IMAGE_ASPECT_COLOR_BIT ||
+	    format_properties[0].imageGranularity.width != PAGE_SIZE || format_properties[0].imageGranularity.height != PAGE_SIZE)
+	{
+		return false;
+	}
+
+	VkDeviceSize block_size = PAGE_SIZE * PAGE_SIZE * TEXEL_SIZE;
+
+	VkMemoryRequirements pool_requirements{};
+	pool_requirements.alignment      = block_size;
+	pool_requirements.memoryTypeBits = ~0u;
+
+	std::vector<std::unique_ptr<core::Image>> sparse_images;
+
+	for (auto &paged_image : paged_images)
+	{
+		auto sparse_image = std::make_unique<core::Image>(device, VkExtent3D{paged_image->extent.width, paged_image->extent.height, 1}, format, usage,
+		                                                  VMA_MEMORY_USAGE_GPU_ONLY, VK_SAMPLE_COUNT_1_BIT, paged_image->level_count, 1,
+		                                                  VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT);
+
+		VkMemoryRequirements memory_requirements{};
+		vkGetImageMemoryRequirements(device.get_handle(), sparse_image->get_handle(), &memory_requirements);
+
+		uint32_t requirement_count = 0;
+		vkGetImageSparseMemoryRequirements(device.get_handle(), sparse_image->get_handle(), &requirement_count, nullptr);
+
+		std::vector<VkSparseImageMemoryRequirements> sparse_requirements(requirement_count);
+		vkGetImageSparseMemoryRequirements(device.get_handle(), sparse_image->get_handle(), &requirement_count, sparse_requirements.data());
+
+		// Every paged level must be made of whole blocks, the levels of the mip tail are in the tail of the loader
+		if (memory_requirements.alignment != block_size || requirement_count != 1 ||
+		    sparse_requirements[0].imageMipTailFirstLod < paged_image->level_count)
+		{
+			return false;
+		}
+
+		pool_requirements.memoryTypeBits &= memory_requirements.memoryTypeBits;
+
+		sparse_images.push_back(std::move(sparse_image));
+	}
+
+	if (pool_requirements.memoryTypeBits == 0)
+	{
+		return false;
+	}
+
+	slot_count             = to_u32(std::max<VkDeviceSize>(memory_budget / block_size, 1));
+	pool_requirements.size = slot_count * block_size;
+
+	VmaAllocationCreateInfo allocation_info{};
+	allocation_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+	if (vmaAllocateMemory(device.get_memory_allocator(), &pool_requirements, &allocation_info, &sparse_memory, nullptr) != VK_SUCCESS)
+	{
+		sparse_memory = VK_NULL_HANDLE;
+		slot_count    = 0;
+		return false;
+	}
+
+	VkFenceCreateInfo fence_info{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+	VK_CHECK(vkCreateFence(device.get_handle(), &fence_info, nullptr, &bind_fence));
+
+	for (size_t i = 0; i < paged_images.size(); i++)
+	{
+		auto &paged_image = *paged_images[i];
+
+		paged_image.sparse_image = std::move(sparse_images[i]);
+		paged_image.sparse_view  = &paged_image.sparse_image->request_view(VK_IMAGE_VIEW_TYPE_2D);
+	}
+
+	page_record_extent = PAGE_SIZE;
+
+	return true;
+}
+
+void VirtualTextures::create_page_cache(VkDeviceSize memory_budget)
+{
+	uint32_t slot_extent = PAGE_SIZE + 2 * PAGE_BORDER;
+
+	// As square as the largest image the device supports allows, the slots are addressed with 12 bits per axis
+	uint32_t max_slots_per_row = std::min(device.get_properties().limits.maxImageDimension2D / slot_extent, 0xFFFu);
+
+	slot_count = to_u32(std::max<VkDeviceSize>(memory_budget / (slot_extent * slot_extent * TEXEL_SIZE), 1));
+
+	slots_per_row = std::min(max_slots_per_row, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(slot_count)))));
+
+	uint32_t row_count = std::min(max_slots_per_row, (slot_count + slots_per_row - 1) / slots_per_row);
+
+	if (slots_per_row * row_count < slot_count)
+	{
+		LOGW("The page cache holds {} of the {} pages of the memory budget", slots_per_row * row_count, slot_count);
+	}
+
+	slot_count = std::min(slot_count, slots_per_row * row_count);
+
+	page_cache = std::make_unique<core::Image>(device, VkExtent3D{slots_per_row * slot_extent, row_count * slot_extent, 1}, format,
+	                                           VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	page_cache->set_debug_name("Page cache");
+
+	page_cache_view = &page_cache->request_view(VK_IMAGE_VIEW_TYPE_2D);
+
+	page_record_extent = slot_extent;
+}
+
+VirtualTextures::PageLocation VirtualTextures::get_location(uint32_t page) const
+{
+	auto image_it = std::upper_bound(paged_images.begin(), paged_images.end(), page,
+	                                 [](uint32_t page, const std::unique_ptr<PagedImage> &paged_image) { return page < paged_image->page_offset; });
+
+	PageLocation location{};
+	location.image = to_u32(std::distance(paged_images.begin(), image_it)) - 1;
+
+	auto &paged_image = *paged_images[location.image];
+
+	auto local_page = page - paged_image.page_offset;
+
+	auto level_it  = std::upper_bound(paged_image.level_offsets.begin(), paged_image.level_offsets.end(), local_page);
+	location.level = to_u32(std::distance(paged_image.level_offsets.begin(), level_it)) - 1;
+
+	local_page -= paged_image.level_offsets[location.level];
+
+	auto page_count_x = get_page_count(get_level_extent(paged_image, location.level).width);
+
+	location.x = local_page % page_count_x;
+	location.y = local_page / page_count_x;
+
+	return location;
+}
+
+uint32_t VirtualTextures::get_page(uint32_t image, uint32_t level, uint32_t x, uint32_t y) const
+{
+	auto &paged_image = *paged_images[image];
+
+	auto page_count_x = get_page_count(get_level_extent(paged_image, level).width);
+
+	return paged_image.page_offset + paged_image.level_offsets[level] + y * page_count_x + x;
+}
+
+uint32_t VirtualTextures::get_parent(uint32_t page) const
+{
+	auto location = get_location(page);
+
+	auto &paged_image = *paged_images[location.image];
+
+	if (location.level + 1 >= paged_image.level_count)
+	{
+		return to_u32(pages.size());
+	}
+
+	// Odd extents round down, so the last page of a level may cover texels past the last page of the next one
+	auto parent_extent = get_level_extent(paged_image, location.level + 1);
+
+	return get_page(location.image, location.level + 1,
+	                std::min(location.x / 2, get_page_count(parent_extent.width) - 1),
+	                std::min(location.y / 2, get_page_count(parent_extent.height) - 1));
+}
+
+VkExtent2D VirtualTextures::get_level_extent(const PagedImage &paged_image, uint32_t level) const
+{
+	return {std::max(paged_image.extent.width >> level, 1u), std::max(paged_image.extent.height >> level, 1u)};
+}
+
+void VirtualTextures::read_feedback(uint32_t index)
+{
+	requested_pages.clear();
+
+	auto &feedback_buffer = *feedback_buffers[index];
+
+	feedback_buffer.invalidate();
+
+	auto words = reinterpret_cast<uint32_t *>(feedback_buffer.map());
+
+	size_t word_count = (pages.size() + 31) / 32;
+
+	for (size_t word = 0; word < word_count; word++)
+	{
+		if (words[word] == 0)
+		{
+			continue;
+		}
+
+		for (uint32_t bit = 0; bit < 32; bit++)
+		{
+			if ((words[word] & (1u << bit)) == 0)
+			{
+				continue;
+			}
+
+			// The coarser pages are used as well, as they stand in for the page until it is loaded
+			for (auto page = to_u32(word * 32 + bit); page < pages.size() && pages[page].used_update != update_index; page = get_parent(page))
+			{
+				pages[page].used_update = update_index;
+
+				if (pages[page].state == PageState::Missing)
+				{
+					requested_pages.push_back(page);
+				}
+			}
+		}
+
+		words[word] = 0;
+	}
+
+	feedback_buffer.flush();
+}
+
+void VirtualTextures::evict_pages(size_t count)
+{
+	std::vector<std::pair<uint32_t, uint32_t>> candidates;
+
+	for (uint32_t page = 0; page < pages.size(); page++)
+	{
+		if (pages[page].state == PageState::Resident && pages[page].used_update != update_index)
+		{
+			candidates.emplace_back(page, get_location(page).level);
+		}
+	}
+
+	count = std::min(count, candidates.size());
+
+	// Least recently used first, and of pages used last in the same update the finer ones, which their coarser pages stand in for
+	std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+	                  [this](const std::pair<uint32_t, uint32_t> &a, const std::pair<uint32_t, uint32_t> &b) {
+		                  return std::make_pair(pages[a.first].used_update, a.second) < std::make_pair(pages[b.first].used_update, b.second);
+	                  });
+
+	for (size_t i = 0; i < count; i++)
+	{
+		auto page = candidates[i].first;
+
+		pages[page].state = PageState::Missing;
+
+		paged_images[get_location(page).image]->dirty = true;
+
+		RetiredSlot retired_slot{};
+		retired_slot.update_index = update_index;
+		retired_slot.slot         = pages[page].slot;
+		retired_slot.page         = page;
+
+		retired_slots.push_back(retired_slot);
+
+		resident_page_count--;
+	}
+}
+
+void VirtualTextures::start_loading()
+{
+	if (requested_pages.empty())
+	{
+		return;
+	}
+
+	// Coarse pages first, so that every surface sampled gets a level above the tail soon
+	std::vector<std::pair<uint32_t, uint32_t>> requests;
+
+	for (auto page : requested_pages)
+	{
+		requests.emplace_back(get_location(page).level, page);
+	}
+
+	std::sort(requests.begin(), requests.end(), std::greater<std::pair<uint32_t, uint32_t>>());
+
+	size_t count = std::min<size_t>(requests.size(), max_page_loads);
+
+	// The slots retired are free in a few updates, more are only evicted if they are not enough
+	if (free_slots.size() + retired_slots.size() < count)
+	{
+		evict_pages(count - free_slots.size() - retired_slots.size());
+	}
+
+	count = std::min(count, free_slots.size());
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	load_batch = std::make_unique<LoadBatch>();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		auto &page = pages[requests[i].second];
+
+		page.slot  = free_slots.back();
+		page.state = PageState::Loading;
+
+		free_slots.pop_back();
+
+		load_batch->pages.push_back(requests[i].second);
+	}
+
+	// A page loaded again must not be unbound from its sparse image by the next binds
+	unbound_pages.erase(std::remove_if(unbound_pages.begin(), unbound_pages.end(),
+	                                   [this](uint32_t page) { return pages[page].state != PageState::Missing; }),
+	                    unbound_pages.end());
+
+	size_t record_size = page_record_extent * page_record_extent * TEXEL_SIZE;
+
+	load_batch->staging_buffer = std::make_unique<core::Buffer>(device, count * record_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	auto destination = load_batch->staging_buffer->map();
+	auto source      = page_file.get_data() + PAGE_FILE_HEADER_SIZE;
+
+	// Reading from the mapping faults the pages of the file in, off the thread recording the frames
+	auto read = [destination, source, record_size, batch_pages = load_batch->pages](size_t) {
+		for (size_t i = 0; i < batch_pages.size(); i++)
+		{
+			std::memcpy(destination + i * record_size, source + batch_pages[i] * record_size, record_size);
+		}
+	};
+
+	if (job_system)
+	{
+		load_batch->copy = job_system->async(std::move(read), JobSystem::Priority::Background);
+	}
+	else
+	{
+		load_batch->copy = std::async(std::launch::async, std::move(read), size_t{0});
+	}
+}
+
+void VirtualTextures::bind_sparse_pages()
+{
+	VmaAllocationInfo memory_info{};
+	vmaGetAllocationInfo(device.get_memory_allocator(), sparse_memory, &memory_info);
+
+	VkDeviceSize block_size = PAGE_SIZE * PAGE_SIZE * TEXEL_SIZE;
+
+	std::vector<std::vector<VkSparseImageMemoryBind>> image_binds(paged_images.size());
+
+	auto add_bind = [&](uint32_t page, VkDeviceMemory memory, VkDeviceSize memory_offset) {
+		auto location     = get_location(page);
+		auto level_extent = get_level_extent(*paged_images[location.image], location.level);
+
+		// The blocks at the edges of a level are bound with the extent left
+		VkSparseImageMemoryBind bind{};
+		bind.subresource   = {VK_IMAGE_ASPECT_COLOR_BIT, location.level, 0};
+		bind.offset        = {static_cast<int32_t>(location.x * PAGE_SIZE), static_cast<int32_t>(location.y * PAGE_SIZE), 0};
+		bind.extent.width  = std::min(uint32_t{PAGE_SIZE}, level_extent.width - location.x * PAGE_SIZE);
+		bind.extent.height = std::min(uint32_t{PAGE_SIZE}, level_extent.height - location.y * PAGE_SIZE);
+		bind.extent.depth  = 1;
+		bind.memory        = memory;
+		bind.memoryOffset  = memory_offset;
+
+		image_binds[location.image].push_back(bind);
+	};
+
+	for (auto page : unbound_pages)
+	{
+		add_bind(page, VK_NULL_HANDLE, 0);
+	}
+
+	unbound_pages.clear();
+
+	for (auto page : load_batch->pages)
+	{
+		add_bind(page, memory_info.deviceMemory, memory_info.offset + pages[page].slot * block_size);
+	}
+
+	std::vector<VkSparseImageMemoryBindInfo> bind_infos;
+
+	for (size_t i = 0; i < image_binds.size(); i++)
+	{
+		if (!image_binds[i].empty())
+		{
+			bind_infos.push_back({paged_images[i]->sparse_image->get_handle(), to_u32(image_binds[i].size()), image_binds[i].data()});
+		}
+	}
+
+	VkBindSparseInfo bind_sparse_info{VK_STRUCTURE_TYPE_BIND_SPARSE_INFO};
+	bind_sparse_info.imageBindCount = to_u32(bind_infos.size());
+	bind_sparse_info.pImageBinds    = bind_infos.data();
+
+	// The binds are not ordered with the command buffers, the copies are recorded once the fence has signaled
+	VK_CHECK(vkResetFences(device.get_handle(), 1, &bind_fence));
+	VK_CHECK(vkQueueBindSparse(sparse_queue->get_handle(), 1, &bind_sparse_info, bind_fence));
+
+	load_batch->bound = true;
+}
+
+void VirtualTextures::upload_pages(CommandBuffer &command_buffer)
+{
+	auto &staging_buffer = *load_batch->staging_buffer;
+
+	staging_buffer.flush();
+
+	VkDeviceSize record_size = page_record_extent * page_record_extent * TEXEL_SIZE;
+
+	// Regions of the page cache, or of each sparse image
+	std::vector<std::vector<VkBufferImageCopy>> copy_regions(page_cache ? 1 : paged_images.size());
+
+	for (size_t i = 0; i < load_batch->pages.size(); i++)
+	{
+		auto page     = load_batch->pages[i];
+		auto location = get_location(page);
+
+		VkBufferImageCopy copy_region{};
+		copy_region.bufferOffset = i * record_size;
+
+		if (page_cache)
+		{
+			auto slot = pages[page].slot;
+
+			copy_region.imageSubresource = page_cache_view->get_subresource_layers();
+			copy_region.imageOffset      = {static_cast<int32_t>(slot % slots_per_row * page_record_extent), static_cast<int32_t>(slot / slots_per_row * page_record_extent), 0};
+			copy_region.imageExtent      = {page_record_extent, page_record_extent, 1};
+
+			copy_regions[0].push_back(copy_region);
+		}
+		else
+		{
+			auto &paged_image  = *paged_images[location.image];
+			auto  level_extent = get_level_extent(paged_image, location.level);
+
+			copy_region.bufferRowLength           = PAGE_SIZE;
+			copy_region.bufferImageHeight         = PAGE_SIZE;
+			copy_region.imageSubresource          = paged_image.sparse_view->get_subresource_layers();
+			copy_region.imageSubresource.mipLevel = location.level;
+			copy_region.imageOffset               = {static_cast<int32_t>(location.x * PAGE_SIZE), static_cast<int32_t>(location.y * PAGE_SIZE), 0};
+			copy_region.imageExtent.width         = std::min(uint32_t{PAGE_SIZE}, level_extent.width - location.x * PAGE_SIZE);
+			copy_region.imageExtent.height        = std::min(uint32_t{PAGE_SIZE}, level_extent.height - location.y * PAGE_SIZE);
+			copy_region.imageExtent.depth         = 1;
+
+			copy_regions[location.image].push_back(copy_region);
+		}
+
+		pages[page].state       = PageState::Resident;
+		pages[page].used_update = update_index;
+
+		paged_images[location.image]->dirty = true;
+
+		resident_page_count++;
+	}
+
+	for (size_t i = 0; i < copy_regions.size(); i++)
+	{
+		if (copy_regions[i].empty())
+		{
+			continue;
+		}
+
+		auto &view = page_cache ? *page_cache_view : *paged_images[i]->sparse_view;
+
+		// Frames sampling the other pages of the image before this one are done with them first
+		transition(command_buffer, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		           VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+		command_buffer.copy_buffer_to_image(staging_buffer, view.get_image(), copy_regions[i]);
+
+		transition(command_buffer, view, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		           VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	}
+
+	// Released once this frame has completed
+	device.get_deletion_queue().release(std::move(load_batch->staging_buffer));
+
+	load_batch.reset();
+}
+
+void VirtualTextures::upload_page_table(CommandBuffer &command_buffer)
+{
+	bool written = false;
+
+	for (uint32_t image_index = 0; image_index < paged_images.size(); image_index++)
+	{
+		auto &paged_image = *paged_images[image_index];
+
+		if (!paged_image.dirty)
+		{
+			continue;
+		}
+
+		// The finest resident level of each page, from the coarsest level down as each page falls back to its parent
+		for (uint32_t level = paged_image.level_count; level-- > 0;)
+		{
+			auto level_extent = get_level_extent(paged_image, level);
+
+			for (uint32_t y = 0; y < get_page_count(level_extent.height); y++)
+			{
+				for (uint32_t x = 0; x < get_page_count(level_extent.width); x++)
+				{
+					auto  page_index = get_page(image_index, level, x, y);
+					auto &page       = pages[page_index];
+
+					uint32_t entry = NO_PAGE;
+
+					if (page.state == PageState::Resident)
+					{
+						entry = level;
+
+						if (page_cache)
+						{
+							entry |= (page.slot % slots_per_row) << 8 | (page.slot / slots_per_row) << 20;
+						}
+					}
+					else if (level + 1 < paged_image.level_count)
+					{
+						entry = page_table_entries[get_parent(page_index)];
+					}
+
+					page_table_entries[page_index] = entry;
+				}
+			}
+		}
+
+		if (!written)
+		{
+			BufferMemoryBarrier barrier{};
+			barrier.src_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			barrier.src_access_mask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.dst_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+			command_buffer.buffer_memory_barrier(*page_table, 0, page_table->get_size(), barrier);
+
+			written = true;
+		}
+
+		// Updates are limited to 64 KB each
+		auto begin = paged_image.page_offset;
+		auto end   = image_index + 1 < paged_images.size() ? paged_images[image_index + 1]->page_offset : to_u32(pages.size());
+
+		for (auto chunk_begin = begin; chunk_begin < end; chunk_begin += 16384)
+		{
+			auto chunk_end = std::min(end, chunk_begin + 16384);
+
+			auto data = reinterpret_cast<const uint8_t *>(page_table_entries.data() + chunk_begin);
+
+			command_buffer.update_buffer(*page_table, chunk_begin * sizeof(uint32_t),
+			                             std::vector<uint8_t>(data, data + (chunk_end - chunk_begin) * sizeof(uint32_t)));
+		}
+
+		paged_image.dirty = false;
+	}
+
+	if (written)
+	{
+		BufferMemoryBarrier barrier{};
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+
+		command_buffer.buffer_memory_barrier(*page_table, 0, page_table->get_size(), barrier);
+	}
+}
+}        // namespace vkb
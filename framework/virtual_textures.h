@@ -0,0 +1,365 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <deque>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "common/helpers.h"
+#include "common/vk_common.h"
+#include "platform/filesystem.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class Device;
+class JobSystem;
+class Queue;
+
+namespace core
+{
+class Buffer;
+class Image;
+class ImageView;
+class Sampler;
+}        // namespace core
+
+namespace sg
+{
+class Image;
+class Scene;
+}        // namespace sg
+
+/**
+ * @brief Keeps the levels of the base color images above their tail in pages of a fixed memory budget, whatever the size
+ *        of the scene textures. The fragment shaders set a bit for each page they sample in a feedback buffer, which is
+ *        read back frames later to load the pages missing and evict the least recently used ones. A page table gives
+ *        the finest resident level around each page, sampled until the finer pages are loaded, and the tail levels
+ *        uploaded by the loader (see GLTFLoader::set_texture_streaming) stand in for the pages never loaded.
+ *
+ *        Where the device supports sparse residency with the standard 128x128 block shape, each image is a sparse image
+ *        whose pages are bound to blocks of a memory pool. Elsewhere the pages are copied, with a border, into the slots
+ *        of a page cache image which the shaders sample at the offset given by the page table.
+ *
+ *        The pages are cooked once into a file in temporary storage, and read from its mapping on the job system while
+ *        the frames go on. Only RGBA8 images are paged, the data of the others is left to a TextureStreamer.
+ */
+class VirtualTextures
+{
+  public:
+	/// Width and height of the pages, the sparse block shape of 32-bit formats
+	static const uint32_t PAGE_SIZE = 128;
+
+	/// Texels copied around the pages of the page cache, for filtering across their edges
+	static const uint32_t PAGE_BORDER = 4;
+
+	/// Level of the page table entries without a resident page, sampled from the tail
+	static const uint32_t NO_PAGE = 0xFF;
+
+	/// Set of the page cache or sparse image, page table and feedback buffer in the shaders, free as the bindings
+	/// of set 0 are all taken and virtual textures are not used along with the bindless textures of set 1
+	static const uint32_t SET = 1;
+
+	static const uint32_t TEXTURE_BINDING = 0;
+
+	static const uint32_t PAGE_TABLE_BINDING = 1;
+
+	static const uint32_t FEEDBACK_BINDING = 2;
+
+	/// Name of the texture paged in the materials
+	static const char *TEXTURE_NAME;
+
+	/**
+	 * @brief Image sampled through the page table
+	 */
+	struct PagedImage
+	{
+		const sg::Image *image{nullptr};
+
+		/// Index of its first page in the page table
+		uint32_t page_offset{0};
+
+		/// Extent of the first level
+		VkExtent2D extent{};
+
+		/// Number of paged levels, the following ones are the tail
+		uint32_t level_count{0};
+
+		/// Index of the first page of each level, from page_offset
+		std::vector<uint32_t> level_offsets;
+
+		/// Sparse image of the paged levels, null for the page cache
+		std::unique_ptr<core::Image> sparse_image;
+
+		const core::ImageView *sparse_view{nullptr};
+
+		/// Whether the page table entries changed since they were uploaded
+		bool dirty{true};
+	};
+
+	/**
+	 * @param device The device the images are created with, fragmentStoresAndAtomics must be enabled
+	 * @param scene Its base color images which kept their data, in RGBA8 with levels above the tail, are paged
+	 * @param memory_budget Device memory for the resident pages, in bytes
+	 * @param frames_in_flight Number of frames which can be in flight, to know when the feedback of a frame can be read
+	 * @param job_system Optional job system on which the page file is cooked and the pages are read
+	 */
+	VirtualTextures(Device &device, sg::Scene &scene, VkDeviceSize memory_budget, uint32_t frames_in_flight, JobSystem *job_system = nullptr);
+
+	VirtualTextures(const VirtualTextures &) = delete;
+
+	VirtualTextures(VirtualTextures &&) = delete;
+
+	~VirtualTextures();
+
+	VirtualTextures &operator=(const VirtualTextures &) = delete;
+
+	VirtualTextures &operator=(VirtualTextures &&) = delete;
+
+	/**
+	 * @return The paged image, nullptr if the image is not paged
+	 */
+	const PagedImage *find(const sg::Image &image) const;
+
+	/**
+	 * @return Whether the images are sparse, otherwise the pages are sampled from the page cache
+	 */
+	bool is_sparse() const;
+
+	/**
+	 * @brief Reads the feedback of a previous frame, records the uploads of the pages loaded since
+	 *        the previous update and the changes to the page table, and starts loading the pages missing
+	 * @param command_buffer Command buffer of the frame, outside of a render pass
+	 */
+	void update(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Binds the page cache or the sparse image of a paged image, the page table and the feedback buffer of the frame
+	 */
+	void bind(CommandBuffer &command_buffer, const PagedImage &paged_image) const;
+
+	/**
+	 * @return The number of pages of all the paged images
+	 */
+	size_t get_page_count() const;
+
+	/**
+	 * @return The number of pages the memory budget holds
+	 */
+	uint32_t get_slot_count() const;
+
+	/**
+	 * @return The number of pages resident
+	 */
+	uint32_t get_resident_page_count() const;
+
+	/**
+	 * @brief Sets the maximum number of pages loaded at once, to bound the cost of an update
+	 */
+	void set_max_page_loads(uint32_t count);
+
+  private:
+	enum class PageState : uint8_t
+	{
+		Missing,
+		Loading,
+		Resident
+	};
+
+	struct Page
+	{
+		/// Slot of the page cache or block of the memory pool
+		uint32_t slot{0};
+
+		/// Last update the page or a finer one under it was sampled in
+		uint32_t used_update{0};
+
+		PageState state{PageState::Missing};
+	};
+
+	/**
+	 * @brief Location of a page in its image
+	 */
+	struct PageLocation
+	{
+		uint32_t image{0};
+
+		uint32_t level{0};
+
+		uint32_t x{0};
+
+		uint32_t y{0};
+	};
+
+	/**
+	 * @brief Pages read from the page file into a staging buffer on a worker thread
+	 */
+	struct LoadBatch
+	{
+		std::vector<uint32_t> pages;
+
+		std::unique_ptr<core::Buffer> staging_buffer;
+
+		std::future<void> copy;
+
+		/// Whether the sparse binds of the pages were submitted
+		bool bound{false};
+	};
+
+	struct RetiredSlot
+	{
+		uint32_t update_index{0};
+
+		uint32_t slot{0};
+
+		/// Page which was evicted from the slot, unbound from its sparse image once no frame samples it
+		uint32_t page{0};
+	};
+
+	/**
+	 * @brief Reads the pages of the images from the page file, cooking it first if it is not in temporary storage
+	 */
+	void load_page_file(const std::vector<sg::Image *> &images);
+
+	/**
+	 * @brief Creates the sparse images and their memory pool, if the device and all the images support it
+	 * @return Whether the images are sparse
+	 */
+	bool create_sparse_images(VkDeviceSize memory_budget);
+
+	/**
+	 * @brief Creates the page cache image with as many slots as the budget holds
+	 */
+	void create_page_cache(VkDeviceSize memory_budget);
+
+	PageLocation get_location(uint32_t page) const;
+
+	uint32_t get_page(uint32_t image, uint32_t level, uint32_t x, uint32_t y) const;
+
+	/**
+	 * @return The page one level coarser covering a page, or the number of pages if it is in the last paged level
+	 */
+	uint32_t get_parent(uint32_t page) const;
+
+	VkExtent2D get_level_extent(const PagedImage &paged_image, uint32_t level) const;
+
+	/**
+	 * @brief Sets the use of the pages sampled by the frame whose feedback buffer is at index, and clears it
+	 */
+	void read_feedback(uint32_t index);
+
+	/**
+	 * @brief Takes the slots of the least recently used pages, until count are free or no page can be evicted
+	 */
+	void evict_pages(size_t count);
+
+	/**
+	 * @brief Picks the pages missing to load first, assigns them slots and starts reading them
+	 */
+	void start_loading();
+
+	/**
+	 * @brief Submits the binds of the pages of the batch loading, and the unbinds of the evicted ones
+	 */
+	void bind_sparse_pages();
+
+	/**
+	 * @brief Records the copies of the pages of the batch loading from their staging buffer, and makes them resident
+	 */
+	void upload_pages(CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Records the writes of the page table entries of the images whose pages changed
+	 */
+	void upload_page_table(CommandBuffer &command_buffer);
+
+	Device &device;
+
+	JobSystem *job_system{nullptr};
+
+	uint32_t frames_in_flight{0};
+
+	uint32_t update_index{0};
+
+	uint32_t max_page_loads{64};
+
+	std::vector<std::unique_ptr<PagedImage>> paged_images;
+
+	std::unordered_map<const sg::Image *, size_t> image_indices;
+
+	std::vector<Page> pages;
+
+	/// Pages missing which the frame whose feedback was last read sampled, or stood in for the ones it sampled
+	std::vector<uint32_t> requested_pages;
+
+	/// Entries of the page table as uploaded: the resident level, and the slot of the page cache
+	std::vector<uint32_t> page_table_entries;
+
+	fs::MappedFile page_file;
+
+	/// Size of a page in the page file, with the border if the pages are copied to the page cache
+	uint32_t page_record_extent{PAGE_SIZE};
+
+	VkFormat format{VK_FORMAT_UNDEFINED};
+
+	std::vector<uint32_t> free_slots;
+
+	std::deque<RetiredSlot> retired_slots;
+
+	/// Pages whose sparse blocks are unbound by the next binds
+	std::vector<uint32_t> unbound_pages;
+
+	uint32_t slot_count{0};
+
+	uint32_t resident_page_count{0};
+
+	/// Page cache of the slots in rows, if the images are not sparse
+	std::unique_ptr<core::Image> page_cache;
+
+	const core::ImageView *page_cache_view{nullptr};
+
+	uint32_t slots_per_row{1};
+
+	/// Memory pool of the sparse blocks, if the images are sparse
+	VmaAllocation sparse_memory{VK_NULL_HANDLE};
+
+	const Queue *sparse_queue{nullptr};
+
+	VkFence bind_fence{VK_NULL_HANDLE};
+
+	const core::Sampler *sampler{nullptr};
+
+	std::unique_ptr<core::Buffer> page_table;
+
+	/// One more than the frames in flight, so that the frame which wrote a buffer has completed when it is read
+	std::vector<std::unique_ptr<core::Buffer>> feedback_buffers;
+
+	/// Feedback buffer bound by the frames recorded until the next update
+	size_t feedback_index{0};
+
+	std::unique_ptr<LoadBatch> load_batch;
+
+	bool initialized{false};
+};
+}        // namespace vkb
@@ -20,6 +20,8 @@
 
 #include "vulkan_sample.h"
 
+#include <thread>
+
 #include "common/error.h"
 
 VKBP_DISABLE_WARNINGS()
@@ -30,10 +32,20 @@ VKBP_ENABLE_WARNINGS()
 #include "common/helpers.h"
 #include "common/logging.h"
 #include "common/vk_common.h"
+#include "cpu_profiler.h"
 #include "gltf_loader.h"
+#include "platform/filesystem.h"
 #include "platform/platform.h"
 #include "platform/window.h"
+#include "rendering/performance_queries.h"
+#include "rendering/subpasses/geometry_subpass.h"
+#include "rendering/subpasses/weighted_blended_subpass.h"
 #include "scene_graph/components/camera.h"
+#include "scene_graph/components/mesh.h"
+#include "scene_graph/components/perspective_camera.h"
+#include "scene_graph/components/spatial_index.h"
+#include "scene_graph/scripts/camera_path.h"
+#include "scene_graph/scripts/free_camera.h"
 #include "utils/graphs.h"
 #include "utils/strings.h"
 
@@ -43,20 +55,43 @@ VKBP_ENABLE_WARNINGS()
 
 namespace vkb
 {
+constexpr uint32_t                  VulkanSample::REDRAW_FRAME_COUNT;
+constexpr std::chrono::milliseconds VulkanSample::SKIPPED_FRAME_DURATION;
+
 VulkanSample::VulkanSample()
 {
 }
 
 VulkanSample::~VulkanSample()
 {
+	wait_for_simulation();
+
+	if (scene_future.valid())
+	{
+		scene_future.wait();
+	}
+
+	scene_streamer.reset();
+
 	device->wait_idle();
 
+	frame_capture.reset();
+	texture_streamer.reset();
+	virtual_textures.reset();
+	memory_defragmenter.reset();
+
+	// The device is idle, the defragmentation ends before the buffers it moves are destroyed
+	device->get_deletion_queue().flush();
+
 	scene.reset();
 
 	stats.reset();
 	gui.reset();
+	dynamic_resolution.reset();
+	render_pipeline.reset();
 	render_context.reset();
 	device.reset();
+	job_system.reset();
 
 	if (surface != VK_NULL_HANDLE)
 	{
@@ -75,47 +110,103 @@ bool VulkanSample::prepare(Platform &platform)
 
 	LOGI("Initializing Vulkan sample");
 
+	job_system = std::make_unique<JobSystem>();
+
 	// Creating the vulkan instance
+	// Headless samples render offscreen, so they run on devices without a display
 	std::vector<const char *> instance_extensions = get_instance_extensions();
-	instance_extensions.push_back(platform.get_surface_extension());
+	if (!is_headless())
+	{
+		instance_extensions.push_back(platform.get_surface_extension());
+	}
 	instance = std::make_unique<Instance>(get_name(), instance_extensions, get_validation_layers(), is_headless());
 
-	// Getting a valid vulkan surface from the platform
+	// Getting a valid vulkan surface from the platform, none if headless
 	surface = platform.get_window().create_surface(instance->get_handle());
 
 	// Creating vulkan device, specifying the swapchain
 	std::vector<const char *> device_extensions = get_device_extensions();
-	if (!is_headless() || instance->is_enabled(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME))
+	if (!is_headless())
 	{
 		device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 	}
 	device = std::make_unique<vkb::Device>(instance->get_gpu(), surface, device_extensions);
 
+	device->set_debug_utils(instance->is_enabled(VK_EXT_DEBUG_UTILS_EXTENSION_NAME));
+
+	device->set_format_policy(format_policy);
+
+	device->get_resource_cache().set_job_system(job_system.get());
+
 	// Preparing render context for rendering
 	render_context = std::make_unique<vkb::RenderContext>(*device, surface, platform.get_window().get_width(), platform.get_window().get_height());
 	prepare_render_context();
 
+	frame_capture = std::make_unique<FrameCapture>(*device, *job_system);
+
 	return true;
 }
 
 void VulkanSample::prepare_render_context()
 {
-	render_context->prepare();
+	render_context->prepare(job_system->get_thread_count());
 }
 
 void VulkanSample::update_scene(float delta_time)
 {
+	VKB_ALLOCATION_SCOPE(SceneGraph);
+
 	if (scene)
 	{
-		//Update scripts
-		if (scene->has_component<sg::Script>())
+		// Independent scripts, such as node animations, are updated in parallel
+		scene->update_scripts(delta_time, job_system.get());
+
+		// World matrices of the nodes moved by the scripts are updated once before rendering
+		scene->update_transforms(job_system.get());
+
+		// A pipelined update publishes the state at the start of the next frame instead
+		if (!pipelined_update)
 		{
-			auto scripts = scene->get_components<sg::Script>();
+			scene->publish_render_state();
+		}
+	}
+}
 
-			for (auto script : scripts)
-			{
-				script->update(delta_time);
-			}
+void VulkanSample::update_cameras()
+{
+	if (!scene)
+	{
+		return;
+	}
+
+	for (auto camera : scene->get_components<sg::Camera>())
+	{
+		if (auto perspective_camera = dynamic_cast<sg::PerspectiveCamera *>(camera))
+		{
+			perspective_camera->set_infinite_far_plane(infinite_far_plane);
+		}
+	}
+
+	if (!render_context->has_swapchain())
+	{
+		return;
+	}
+
+	auto pre_rotation = render_context->get_pre_rotation();
+
+	auto &swapchain = render_context->get_swapchain();
+	auto  rotated   = swapchain.get_transform() & (VK_SURFACE_TRANSFORM_ROTATE_90_BIT_KHR | VK_SURFACE_TRANSFORM_ROTATE_270_BIT_KHR);
+	auto  extent    = swapchain.get_extent();
+
+	for (auto camera : scene->get_components<sg::Camera>())
+	{
+		camera->set_pre_rotation(pre_rotation);
+
+		// The scripts resize the cameras to the window, whose width and height are those of the images swapped
+		auto perspective_camera = dynamic_cast<sg::PerspectiveCamera *>(camera);
+		if (rotated && perspective_camera)
+		{
+			perspective_camera->set_aspect_ratio(static_cast<float>(extent.width) / extent.height);
 		}
 	}
 }
@@ -124,6 +215,142 @@ void VulkanSample::update_stats(float delta_time)
 {
 	if (stats)
 	{
+		if (render_context)
+		{
+			auto descriptor_counters = render_context->get_last_rendered_frame().get_descriptor_counters();
+
+			stats->set_framework_value(StatIndex::descriptor_set_allocations, static_cast<float>(descriptor_counters.allocations));
+			stats->set_framework_value(StatIndex::descriptor_pool_resets, static_cast<float>(descriptor_counters.pool_resets));
+			stats->set_framework_value(StatIndex::descriptor_set_reuses, static_cast<float>(descriptor_counters.reuses));
+
+			auto command_pool_counters = render_context->get_last_rendered_frame().get_command_pool_counters();
+
+			stats->set_framework_value(StatIndex::command_buffer_allocations, static_cast<float>(command_pool_counters.allocations));
+			stats->set_framework_value(StatIndex::command_buffer_reuses, static_cast<float>(command_pool_counters.reuses));
+			stats->set_framework_value(StatIndex::command_buffer_resets, static_cast<float>(command_pool_counters.resets));
+			stats->set_framework_value(StatIndex::command_pool_reset_time, static_cast<float>(command_pool_counters.reset_time));
+			stats->set_framework_value(StatIndex::command_buffer_allocation_time, static_cast<float>(command_pool_counters.allocation_time));
+
+			// Total usage, and the fraction of its budget the fullest heap uses
+			float memory_usage{0.0f};
+			float budget_usage{0.0f};
+
+			for (auto &heap_budget : device->get_heap_budgets())
+			{
+				memory_usage += static_cast<float>(heap_budget.usage);
+
+				if (heap_budget.budget > 0)
+				{
+					budget_usage = std::max(budget_usage, static_cast<float>(heap_budget.usage) / static_cast<float>(heap_budget.budget));
+				}
+			}
+
+			stats->set_framework_value(StatIndex::device_memory_usage, memory_usage);
+			stats->set_framework_value(StatIndex::device_memory_budget_usage, budget_usage);
+
+			auto &frame_pacer = render_context->get_frame_pacer();
+
+			stats->set_framework_value(StatIndex::present_interval, frame_pacer.get_present_interval());
+			stats->set_framework_value(StatIndex::present_delay, frame_pacer.get_present_delay());
+
+			// Queries are only recorded if their stats or the timeline are shown
+			const auto &enabled_stats = stats->get_enabled_stats();
+
+			bool gpu_profiling       = enabled_stats.count(StatIndex::gpu_time) > 0 || is_benchmark_capturing() || (gui && gui->is_timeline_open());
+			bool pipeline_statistics = std::any_of(enabled_stats.begin(), enabled_stats.end(), [](StatIndex index) {
+				return index >= StatIndex::input_assembly_primitives && index <= StatIndex::compute_shader_invocations;
+			});
+
+			for (auto &frame : render_context->get_render_frames())
+			{
+				frame.get_gpu_profiler().set_enabled(gpu_profiling);
+				frame.get_gpu_profiler().set_pipeline_statistics_enabled(pipeline_statistics);
+			}
+
+			auto &gpu_profiler = render_context->get_last_rendered_frame().get_gpu_profiler();
+
+			stats->set_framework_value(StatIndex::gpu_time, gpu_profiler.get_frame_time());
+			stats->set_gpu_scope_times(gpu_profiler.get_scope_times());
+
+			// Places the GPU-busy window of the frame the time was measured for, to attribute the counter samples to it
+			const RenderContext &context         = *render_context;
+			auto                last_frame_index = context.get_active_frame_index();
+			if (gpu_profiler.is_enabled() && last_frame_index < profiled_frame_indices.size())
+			{
+				stats->set_frame_gpu_time(profiled_frame_indices[last_frame_index], gpu_profiler.get_frame_time());
+			}
+
+			const auto &statistics = gpu_profiler.get_pipeline_statistics();
+
+			stats->set_framework_value(StatIndex::input_assembly_primitives, static_cast<float>(statistics.input_assembly_primitives));
+			stats->set_framework_value(StatIndex::vertex_shader_invocations, static_cast<float>(statistics.vertex_shader_invocations));
+			stats->set_framework_value(StatIndex::clipping_invocations, static_cast<float>(statistics.clipping_invocations));
+			stats->set_framework_value(StatIndex::clipping_primitives, static_cast<float>(statistics.clipping_primitives));
+			stats->set_framework_value(StatIndex::fragment_shader_invocations, static_cast<float>(statistics.fragment_shader_invocations));
+			stats->set_framework_value(StatIndex::compute_shader_invocations, static_cast<float>(statistics.compute_shader_invocations));
+
+			update_performance_counters(delta_time);
+
+			// The counters are per second, from hwcpipe or the performance queries
+			auto frame_bytes = [this, delta_time](StatIndex index) {
+				if (!stats->is_available(index) || stats->get_enabled_stats().count(index) == 0)
+				{
+					return -1.0;
+				}
+
+				auto &values = stats->get_data(index);
+
+				if (values.empty())
+				{
+					return -1.0;
+				}
+
+				// The newest value is the one before the oldest
+				auto offset = stats->get_data_offset(index);
+				return static_cast<double>(values[(offset + values.size() - 1) % values.size()]) * delta_time;
+			};
+
+			measured_read_bytes  = frame_bytes(StatIndex::l2_ext_read_bytes);
+			measured_write_bytes = frame_bytes(StatIndex::l2_ext_write_bytes);
+		}
+
+		if (thread_cpu_times && job_system)
+		{
+			auto cpu_times = job_system->get_thread_cpu_times();
+
+			for (size_t i = 0; i < cpu_times.size(); ++i)
+			{
+				const char *cores = "";
+
+				switch (job_system->get_thread_core_class(i))
+				{
+					case CoreClass::Big:
+						cores = "_big";
+						break;
+					case CoreClass::Little:
+						cores = "_little";
+						break;
+					default:
+						break;
+				}
+
+				auto name = "thread_" + std::to_string(i) + cores + "_cpu_time_ms";
+
+				// Added the first time, the first frame has no previous time to compare to
+				stats->add_named_stat(name);
+
+				if (i < previous_thread_cpu_times.size())
+				{
+					stats->set_named_value(name, static_cast<float>((cpu_times[i] - previous_thread_cpu_times[i]) * 1000.0));
+				}
+			}
+
+			previous_thread_cpu_times = std::move(cpu_times);
+		}
+
+		// Benchmark runs keep every value for the report written when the sample finishes, warmup frames excluded
+		stats->set_recording(is_benchmark_capturing());
+
 		stats->update();
 
 		static float stats_view_count = 0.0f;
@@ -138,8 +365,108 @@ void VulkanSample::update_stats(float delta_time)
 	}
 }
 
+void VulkanSample::update_performance_counters(float delta_time)
+{
+	auto queue_family_index = render_context->get_queue().get_family_index();
+
+	if (!performance_counters_selected)
+	{
+		performance_counters_selected = true;
+
+		// Only the stats hwcpipe cannot measure are queried
+		std::set<StatIndex> missing_stats;
+		for (auto index : stats->get_enabled_stats())
+		{
+			if (!stats->is_available(index))
+			{
+				missing_stats.insert(index);
+			}
+		}
+
+		if (missing_stats.empty() && performance_counter_names.empty())
+		{
+			return;
+		}
+
+		performance_counters = select_performance_counters(*device, queue_family_index, missing_stats, performance_counter_names);
+
+		if (!performance_counters.empty() && !device->acquire_profiling_lock())
+		{
+			LOGW("Could not acquire the profiling lock, performance counters disabled");
+			performance_counters.clear();
+		}
+
+		std::set<StatIndex> queried_stats;
+		for (auto &counter : performance_counters)
+		{
+			if (counter.has_stat)
+			{
+				queried_stats.insert(counter.stat);
+			}
+			else
+			{
+				stats->add_named_stat(counter.name);
+			}
+		}
+
+		stats->set_queried_stats(queried_stats);
+	}
+
+	if (performance_counters.empty())
+	{
+		return;
+	}
+
+	for (auto &frame : render_context->get_render_frames())
+	{
+		frame.get_performance_queries().set_counters(performance_counters, queue_family_index);
+	}
+
+	auto &performance_queries = render_context->get_last_rendered_frame().get_performance_queries();
+
+	const auto &counters = performance_queries.get_counters();
+	const auto &values   = performance_queries.get_values();
+
+	for (size_t i = 0; i < counters.size() && i < values.size(); ++i)
+	{
+		if (counters[i].has_stat)
+		{
+			// hwcpipe measures its counters per second
+			stats->set_framework_value(counters[i].stat, delta_time > 0.0f ? static_cast<float>(values[i] / delta_time) : 0.0f);
+		}
+		else
+		{
+			stats->set_named_value(counters[i].name, static_cast<float>(values[i]));
+		}
+	}
+}
+
+void VulkanSample::submit_frame(CommandBuffer &command_buffer)
+{
+	if (stats)
+	{
+		stats->begin_frame_phase(frame_index, FramePhase::Submit);
+	}
+
+	auto active_frame_index = render_context->get_active_frame_index();
+
+	if (active_frame_index >= submitted_frame_indices.size())
+	{
+		submitted_frame_indices.resize(active_frame_index + 1, 0);
+		profiled_frame_indices.resize(active_frame_index + 1, 0);
+	}
+
+	// The queries of a render frame are read when it is reused, so it reports the frame submitted with it before
+	profiled_frame_indices[active_frame_index]  = submitted_frame_indices[active_frame_index];
+	submitted_frame_indices[active_frame_index] = frame_index;
+
+	render_context->submit(command_buffer);
+}
+
 void VulkanSample::update_gui(float delta_time)
 {
+	VKB_ALLOCATION_SCOPE(Gui);
+
 	if (gui)
 	{
 		if (gui->is_debug_view_active())
@@ -147,6 +474,8 @@ void VulkanSample::update_gui(float delta_time)
 			update_debug_window();
 		}
 
+		gui->set_layer_rate(gui_layer_rate);
+
 		gui->new_frame();
 
 		gui->show_top_window(get_name(), stats.get(), &get_debug_info());
@@ -160,26 +489,217 @@ void VulkanSample::update_gui(float delta_time)
 
 void VulkanSample::update(float delta_time)
 {
-	update_scene(delta_time);
+	VKB_PROFILE_FUNCTION();
+
+	Timer cpu_timer;
+	cpu_timer.start();
+
+	auto allocations_start = AllocationTracker::get_counters();
+
+	++frame_index;
+
+	if (stats)
+	{
+		stats->begin_frame_phase(frame_index, FramePhase::Record);
+	}
+
+	wait_for_simulation();
+
+	swap_loaded_scene();
+
+	update_scene_streamer();
+
+	update_cameras();
+
+	// Whether the state rendered by this frame differs from the one of the previous frame
+	bool scene_changed = false;
+
+	if (pipelined_update && scene)
+	{
+		scene_changed = scene->have_transforms_changed();
+
+		// The frame renders the state updated during the previous one, while the next one is updated
+		scene->publish_render_state();
+
+		job_system->run([this, delta_time](size_t) { update_scene(delta_time); }, &simulation_counter);
+	}
+	else
+	{
+		update_scene(delta_time);
+
+		scene_changed = scene && scene->have_transforms_changed();
+	}
+
+	// The index follows the state rendered by this frame, the update of a pipelined frame only writes the simulated one
+	update_spatial_index();
 
 	update_stats(delta_time);
 
 	update_gui(delta_time);
 
-	auto &command_buffer = render_context->begin();
+	if (dynamic_resolution)
+	{
+		dynamic_resolution->update(*render_context);
+
+		// Each frame samples other positions within the pixels, which the temporal upscaler accumulates
+		if (scene && dynamic_resolution->uses_temporal_upscaling())
+		{
+			for (auto camera : scene->get_components<sg::Camera>())
+			{
+				if (auto perspective_camera = dynamic_cast<sg::PerspectiveCamera *>(camera))
+				{
+					perspective_camera->set_jitter(dynamic_resolution->get_jitter());
+				}
+			}
+		}
+	}
 
-	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	// Frames in which only the GUI changed present its damage alone
+	bool full_redraw = scene_changed || redraw_count > 0 || (texture_streamer && texture_streamer->is_streaming());
+	bool gui_changed = gui && gui->has_changed();
 
-	draw(command_buffer, render_context->get_active_frame().get_render_target());
+	redraw_count = redraw_count > 0 ? redraw_count - 1 : 0;
 
-	command_buffer.end();
+	set_idle(false);
 
-	render_context->submit(command_buffer);
+	if (redraw_skipping && !full_redraw && !gui_changed)
+	{
+		// Nothing to present, the frames are throttled as a present would
+		auto &frame_pacer = render_context->get_frame_pacer();
+
+		if (render_on_demand && !pipelined_update && !has_pending_work())
+		{
+			// The platform waits for the window events until the next step
+			set_idle(true);
+		}
+		else if (frame_pacer.get_target_interval().count() > 0)
+		{
+			frame_pacer.wait();
+		}
+		else
+		{
+			std::this_thread::sleep_for(SKIPPED_FRAME_DURATION);
+		}
+	}
+	else
+	{
+		VKB_ALLOCATION_SCOPE(Rendering);
+
+		auto &command_buffer = render_context->begin();
+
+		command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+		if (dynamic_resolution && render_context->uses_late_swapchain_acquire())
+		{
+			// The scene renders offscreen before the swapchain image is acquired, only the composition waits for it
+			auto &scene_target = draw_scene(command_buffer, render_context->get_active_frame().get_render_target());
+
+			command_buffer.end();
+
+			frame_bind_stats = command_buffer.get_bind_stats();
+
+			render_context->submit(render_context->get_queue(), command_buffer);
+
+			render_context->acquire_swapchain_image();
+
+			auto &compose_command_buffer = render_context->get_active_frame().request_command_buffer(render_context->get_queue());
+
+			compose_command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+			compose(compose_command_buffer, scene_target, render_context->get_active_frame().get_render_target());
+
+			record_frame_capture(compose_command_buffer);
+
+			compose_command_buffer.end();
+
+			frame_bind_stats += compose_command_buffer.get_bind_stats();
+
+			if (!full_redraw && gui_changed)
+			{
+				render_context->add_present_region(gui->get_damage());
+			}
+
+			submit_frame(compose_command_buffer);
+		}
+		else
+		{
+			draw(command_buffer, render_context->get_active_frame().get_render_target());
+
+			record_frame_capture(command_buffer);
+
+			command_buffer.end();
+
+			frame_bind_stats = command_buffer.get_bind_stats();
+
+			if (!full_redraw && gui_changed)
+			{
+				render_context->add_present_region(gui->get_damage());
+			}
+
+			submit_frame(command_buffer);
+		}
+	}
+
+	auto allocations_end = AllocationTracker::get_counters();
+
+	for (size_t i = 0; i < frame_allocations.size(); i++)
+	{
+		frame_allocations[i] = allocations_end[i] - allocations_start[i];
+	}
+
+	if (is_benchmark_capturing() && !benchmark_runs.empty())
+	{
+		auto &run = benchmark_runs.back();
+
+		run.cpu_times.push_back(static_cast<float>(cpu_timer.stop<Timer::Milliseconds>()));
+
+		// The GPU time is the one of the last frame the fences report as complete
+		auto &gpu_profiler = render_context->get_last_rendered_frame().get_gpu_profiler();
+
+		if (gpu_profiler.is_enabled())
+		{
+			run.gpu_times.push_back(gpu_profiler.get_frame_time() * 1000.0f);
+		}
+	}
 }
 
 void VulkanSample::draw(CommandBuffer &command_buffer, RenderTarget &render_target)
 {
-	auto &views = render_target.get_views();
+	auto &scene_target = draw_scene(command_buffer, render_target);
+
+	compose(command_buffer, scene_target, render_target);
+}
+
+RenderTarget &VulkanSample::draw_scene(CommandBuffer &command_buffer, RenderTarget &render_target)
+{
+	// With dynamic resolution the scene renders to a scaled offscreen target, upscaled to the swapchain image
+	auto &scene_target = dynamic_resolution ? dynamic_resolution->get_render_target(*render_context) : render_target;
+
+	auto &views = scene_target.get_views();
+
+	// Mip levels requested by the previous frames are uploaded before the render pass
+	if (texture_streamer)
+	{
+		texture_streamer->update(command_buffer);
+	}
+
+	// Pages sampled by the previous frames are loaded, and the page table updated, before the render pass
+	if (virtual_textures)
+	{
+		virtual_textures->update(command_buffer);
+	}
+
+	// Buffers moved by a defragmentation pass are rebound before the draws record them
+	if (memory_defragmenter)
+	{
+		memory_defragmenter->update(command_buffer);
+	}
+
+	// The gui layer is composited to the swapchain image, after upscaling with dynamic resolution
+	if (gui)
+	{
+		gui->update_layer(command_buffer, render_target.get_extent());
+	}
 
 	{
 		// Image 0 is the swapchain
@@ -193,10 +713,14 @@ void VulkanSample::draw(CommandBuffer &command_buffer, RenderTarget &render_targ
 
 		command_buffer.image_memory_barrier(views.at(0), memory_barrier);
 
-		// Skip 1 as it is handled later as a depth-stencil attachment
+		// Skip 1 as it is handled later as a depth-stencil attachment, and shading rate attachments
+		// as the passes generating them transition them
 		for (size_t i = 2; i < views.size(); ++i)
 		{
-			command_buffer.image_memory_barrier(views.at(i), memory_barrier);
+			if (!(views.at(i).get_image().get_usage() & VK_IMAGE_USAGE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR))
+			{
+				command_buffer.image_memory_barrier(views.at(i), memory_barrier);
+			}
 		}
 	}
 
@@ -212,23 +736,41 @@ void VulkanSample::draw(CommandBuffer &command_buffer, RenderTarget &render_targ
 		command_buffer.image_memory_barrier(views.at(1), memory_barrier);
 	}
 
-	draw_renderpass(command_buffer, render_target);
+	draw_renderpass(command_buffer, scene_target);
+
+	return scene_target;
+}
+
+void VulkanSample::compose(CommandBuffer &command_buffer, RenderTarget &scene_target, RenderTarget &render_target)
+{
+	if (dynamic_resolution)
+	{
+		dynamic_resolution->upscale(command_buffer, scene_target, render_target, gui.get());
+	}
 
 	{
 		ImageMemoryBarrier memory_barrier{};
 		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		memory_barrier.new_layout      = render_context->get_present_layout();
 		memory_barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 
-		command_buffer.image_memory_barrier(views.at(0), memory_barrier);
+		command_buffer.image_memory_barrier(render_target.get_views().at(0), memory_barrier);
 	}
 }
 
+void VulkanSample::record_frame_capture(CommandBuffer &command_buffer)
+{
+	frame_capture->update(render_context->get_completed_frame_number());
+
+	frame_capture->record(command_buffer, render_context->get_active_frame().get_render_target().get_views().at(0),
+	                      render_context->get_present_layout(), render_context->get_frame_number());
+}
+
 void VulkanSample::draw_renderpass(CommandBuffer &command_buffer, RenderTarget &render_target)
 {
-	auto &extent = render_target.get_extent();
+	auto &extent = render_target.get_render_extent();
 
 	VkViewport viewport{};
 	viewport.width    = static_cast<float>(extent.width);
@@ -241,21 +783,83 @@ void VulkanSample::draw_renderpass(CommandBuffer &command_buffer, RenderTarget &
 	scissor.extent = extent;
 	command_buffer.set_scissor(0, {scissor});
 
-	render(command_buffer);
+	// With dynamic resolution the gui is drawn at full resolution after upscaling
+	bool gui_in_pass = gui && !dynamic_resolution;
 
-	if (gui)
+	// If the last subpass executes secondary command buffers, the gui is recorded into one on a worker while the scene records
+	VkSubpassContents  gui_contents       = VK_SUBPASS_CONTENTS_INLINE;
+	CommandBuffer     *gui_command_buffer = nullptr;
+	JobSystem::Counter gui_counter;
+
+	if (gui_in_pass && render_pipeline)
 	{
-		gui->draw(command_buffer);
+		render_pipeline->set_last_subpass_callback([this, &gui_contents, &gui_command_buffer, &gui_counter](CommandBuffer &primary_command_buffer, VkSubpassContents contents) {
+			gui_contents = contents;
+
+			// Jobs use the per-thread resources of the thread running them
+			if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS &&
+			    render_context->get_active_frame().get_thread_count() >= job_system->get_thread_count())
+			{
+				job_system->run(
+				    [this, &primary_command_buffer, &gui_command_buffer](size_t thread_index) {
+					    gui_command_buffer = &gui->draw_secondary(primary_command_buffer, thread_index);
+				    },
+				    &gui_counter);
+			}
+		});
+	}
+
+	render(command_buffer);
+
+	if (render_pipeline)
+	{
+		render_pipeline->set_last_subpass_callback(nullptr);
+	}
+
+	if (gui_in_pass)
+	{
+		job_system->wait(gui_counter);
+
+		// Draws cannot be recorded inline in a subpass executing secondary command buffers
+		if (!gui_command_buffer && gui_contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+		{
+			gui_command_buffer = &gui->draw_secondary(command_buffer, 0);
+		}
+
+		if (gui_command_buffer)
+		{
+			command_buffer.execute_commands(*gui_command_buffer);
+		}
+		else
+		{
+			gui->draw(command_buffer);
+		}
 	}
 
 	command_buffer.end_render_pass();
 }
 
+void VulkanSample::record_pass(CommandBuffer &command_buffer, std::function<void(CommandBuffer &, size_t)> &&record)
+{
+	if (parallel_subpasses)
+	{
+		render_context->record_async(command_buffer, *job_system, std::move(record));
+	}
+	else
+	{
+		record(command_buffer, 0);
+	}
+}
+
 void VulkanSample::render(CommandBuffer &command_buffer)
 {
 	if (render_pipeline)
 	{
-		render_pipeline->draw(command_buffer, render_context->get_active_frame().get_render_target());
+		// With dynamic resolution the scene renders to its offscreen target
+		auto &render_target = dynamic_resolution ? dynamic_resolution->get_render_target(*render_context) :
+		                                           render_context->get_active_frame().get_render_target();
+
+		render_pipeline->draw(command_buffer, render_target);
 	}
 }
 
@@ -268,7 +872,7 @@ void VulkanSample::resize(uint32_t width, uint32_t height)
 		gui->resize(width, height);
 	}
 
-	if (scene->has_component<sg::Script>())
+	if (scene && scene->has_component<sg::Script>())
 	{
 		auto scripts = scene->get_components<sg::Script>();
 
@@ -282,6 +886,8 @@ void VulkanSample::resize(uint32_t width, uint32_t height)
 	{
 		stats->resize(width);
 	}
+
+	request_redraw();
 }
 
 void VulkanSample::input_event(const InputEvent &input_event)
@@ -297,15 +903,26 @@ void VulkanSample::input_event(const InputEvent &input_event)
 
 	if (!gui_captures_event)
 	{
-		if (scene->has_component<sg::Script>())
+		if (!simulation_counter.is_done())
 		{
-			auto scripts = scene->get_components<sg::Script>();
-
-			for (auto script : scripts)
+			// The scripts are being updated, they receive the event once the update completes
+			switch (input_event.get_source())
 			{
-				script->input_event(input_event);
+				case EventSource::Keyboard:
+					pending_script_events.push_back(std::make_unique<KeyInputEvent>(static_cast<const KeyInputEvent &>(input_event)));
+					break;
+				case EventSource::Mouse:
+					pending_script_events.push_back(std::make_unique<MouseButtonInputEvent>(static_cast<const MouseButtonInputEvent &>(input_event)));
+					break;
+				case EventSource::Touchscreen:
+					pending_script_events.push_back(std::make_unique<TouchInputEvent>(static_cast<const TouchInputEvent &>(input_event)));
+					break;
 			}
 		}
+		else
+		{
+			send_script_event(input_event);
+		}
 	}
 
 	if (input_event.get_source() == EventSource::Keyboard)
@@ -313,7 +930,7 @@ void VulkanSample::input_event(const InputEvent &input_event)
 		const auto &key_event = static_cast<const KeyInputEvent &>(input_event);
 		if (key_event.get_action() == KeyAction::Down && key_event.get_code() == KeyCode::PrintScreen)
 		{
-			screenshot(*render_context, "screenshot-" + get_name());
+			frame_capture->request("screenshot-" + get_name());
 		}
 
 		if (key_event.get_code() == KeyCode::F6 && key_event.get_action() == KeyAction::Down)
@@ -323,10 +940,270 @@ void VulkanSample::input_event(const InputEvent &input_event)
 	}
 }
 
+void VulkanSample::send_script_event(const InputEvent &input_event)
+{
+	if (scene && scene->has_component<sg::Script>())
+	{
+		auto scripts = scene->get_components<sg::Script>();
+
+		for (auto script : scripts)
+		{
+			script->input_event(input_event);
+		}
+	}
+}
+
+void VulkanSample::wait_for_simulation()
+{
+	if (job_system)
+	{
+		job_system->wait(simulation_counter);
+	}
+
+	for (auto &input_event : pending_script_events)
+	{
+		send_script_event(*input_event);
+	}
+
+	pending_script_events.clear();
+}
+
 void VulkanSample::finish()
 {
+	wait_for_simulation();
+
 	Application::finish();
 	device->wait_idle();
+
+	log_benchmark_runs();
+
+	device->get_resource_cache().log_pipeline_creation_report();
+
+	if (stats && is_benchmark_mode())
+	{
+		if (stats->write_report(get_name() + "_benchmark"))
+		{
+			LOGI("Benchmark report written to {}{}_benchmark.json", fs::path::get(fs::path::Type::Graphs), get_name());
+		}
+	}
+}
+
+void VulkanSample::begin_benchmark_capture()
+{
+	Application::begin_benchmark_capture();
+
+	benchmark_runs.emplace_back();
+
+	// GPU times are measured whichever stats are shown
+	if (render_context)
+	{
+		for (auto &frame : render_context->get_render_frames())
+		{
+			frame.get_gpu_profiler().set_enabled(true);
+		}
+	}
+}
+
+bool VulkanSample::next_benchmark_configuration()
+{
+	if (!configuration.next())
+	{
+		return false;
+	}
+
+	configuration.set();
+
+	return true;
+}
+
+std::vector<int32_t> VulkanSample::get_worker_thread_ids()
+{
+	if (!job_system)
+	{
+		return {};
+	}
+
+	// The main thread is thread 0 of the job system
+	auto ids = job_system->get_native_thread_ids();
+
+	if (!ids.empty())
+	{
+		ids.erase(ids.begin());
+	}
+
+	return ids;
+}
+
+void VulkanSample::log_benchmark_runs() const
+{
+	if (benchmark_runs.empty())
+	{
+		return;
+	}
+
+	LOGI("Benchmark frame times in ms, per configuration:");
+	LOGI("{:>6} {:>7} | {:>8} {:>8} {:>8} {:>8} | {:>8} {:>8} {:>8} {:>8}",
+	     "config", "frames", "cpu mean", "cpu p50", "cpu p95", "cpu p99", "gpu mean", "gpu p50", "gpu p95", "gpu p99");
+
+	for (size_t i = 0; i < benchmark_runs.size(); ++i)
+	{
+		auto cpu = summarize_values(benchmark_runs[i].cpu_times);
+		auto gpu = summarize_values(benchmark_runs[i].gpu_times);
+
+		LOGI("{:>6} {:>7} | {:>8.2f} {:>8.2f} {:>8.2f} {:>8.2f} | {:>8.2f} {:>8.2f} {:>8.2f} {:>8.2f}",
+		     i, cpu.count, cpu.mean, cpu.median, cpu.p95, cpu.p99, gpu.mean, gpu.median, gpu.p95, gpu.p99);
+	}
+}
+
+void VulkanSample::set_camera_path(const std::string &filename)
+{
+	camera_path_file = filename;
+
+	if (scene)
+	{
+		add_camera_path();
+	}
+}
+
+void VulkanSample::set_pipelined_update(bool enabled)
+{
+	wait_for_simulation();
+
+	pipelined_update = enabled;
+}
+
+void VulkanSample::set_format_policy(FormatPolicy policy)
+{
+	format_policy = policy;
+}
+
+void VulkanSample::set_infinite_far_plane(bool infinite)
+{
+	infinite_far_plane = infinite;
+
+	request_redraw();
+}
+
+void VulkanSample::set_spatial_index(bool enabled)
+{
+	use_spatial_index = enabled;
+
+	if (!enabled && scene && scene->has_component<sg::SpatialIndex>())
+	{
+		scene->clear_components<sg::SpatialIndex>();
+	}
+}
+
+void VulkanSample::set_performance_counters(const std::vector<std::string> &names)
+{
+	performance_counter_names     = names;
+	performance_counters_selected = false;
+}
+
+void VulkanSample::set_memory_defragmentation(bool enabled)
+{
+	memory_defragmentation = enabled;
+
+	create_memory_defragmenter();
+}
+
+void VulkanSample::update_spatial_index()
+{
+	if (!use_spatial_index || !scene)
+	{
+		return;
+	}
+
+	// Streamed cells change the meshes of the scene, the hierarchy is built again over them
+	if (!scene->has_component<sg::SpatialIndex>() || spatial_index_version != scene->get_version())
+	{
+		auto spatial_index = std::make_unique<sg::SpatialIndex>();
+
+		spatial_index->build(scene->get_components<sg::Mesh>().to_vector());
+
+		LOGI("Built the spatial index of {} nodes", spatial_index->get_items().size());
+
+		scene->clear_components<sg::SpatialIndex>();
+		scene->add_component(std::move(spatial_index));
+
+		spatial_index_version = scene->get_version();
+		return;
+	}
+
+	scene->get_components<sg::SpatialIndex>().at(0)->refit();
+}
+
+void VulkanSample::update_scene_streamer()
+{
+	if (!scene_streamer || !scene || !scene->has_component<sg::Camera>())
+	{
+		return;
+	}
+
+	auto camera_node = scene->get_components<sg::Camera>().at(0)->get_node();
+
+	if (!camera_node)
+	{
+		return;
+	}
+
+	auto position = glm::vec3(camera_node->get_transform().get_render_state().world_matrix[3]);
+
+	if (scene_streamer->update(position))
+	{
+		request_redraw();
+	}
+}
+
+void VulkanSample::set_thread_cpu_times(bool enabled)
+{
+	thread_cpu_times = enabled;
+
+	previous_thread_cpu_times.clear();
+}
+
+void VulkanSample::set_redraw_skipping(bool enabled)
+{
+	redraw_skipping = enabled;
+
+	request_redraw();
+}
+
+void VulkanSample::set_render_on_demand(bool enabled)
+{
+	render_on_demand = enabled;
+
+	set_redraw_skipping(enabled);
+}
+
+bool VulkanSample::has_pending_work() const
+{
+	return scene_future.valid() ||
+	       (scene_streamer && scene_streamer->get_loading_count() > 0) ||
+	       (texture_streamer && texture_streamer->is_streaming());
+}
+
+void VulkanSample::request_redraw()
+{
+	redraw_count = REDRAW_FRAME_COUNT;
+}
+
+void VulkanSample::add_camera_path()
+{
+	if (scene->has_component<sg::Script>())
+	{
+		for (auto script : scene->get_components<sg::Script>())
+		{
+			if (dynamic_cast<sg::FreeCamera *>(script))
+			{
+				// Scripts update in order, the path overrides what the free camera does with the input
+				scene->add_component(sg::CameraPath::load(script->get_node(), camera_path_file), script->get_node());
+				return;
+			}
+		}
+	}
+
+	LOGW("No free camera to move along {}", camera_path_file);
 }
 
 Device &VulkanSample::get_device()
@@ -334,6 +1211,11 @@ Device &VulkanSample::get_device()
 	return *device;
 }
 
+const ScopedAllocationCounters &VulkanSample::get_frame_allocations() const
+{
+	return frame_allocations;
+}
+
 Configuration &VulkanSample::get_configuration()
 {
 	return configuration;
@@ -354,17 +1236,153 @@ void VulkanSample::update_debug_window()
 
 	get_debug_info().insert<field::Static, std::string>("surface_format",
 	                                                    utils::to_string(render_context->get_swapchain().get_format()) + " (" +
-	                                                        to_string(get_bits_per_pixel(render_context->get_swapchain().get_format())) + "bbp)");
+	                                                        to_string(get_bits_per_pixel(render_context->get_swapchain().get_format())) + "bbp" +
+	                                                        (is_afbc_eligible(render_context->get_swapchain().get_usage()) ? ", AFBC eligible)" : ")"));
+
+	get_debug_info().insert<field::Static, std::string>("depth_format",
+	                                                    fmt::format("{} ({}bbp, {} policy)", utils::to_string(device->get_depth_format()), get_bits_per_pixel(device->get_depth_format()),
+	                                                                device->get_format_policy() == FormatPolicy::Bandwidth ? "bandwidth" : "precision"));
+
+	// Transient attachments stay in tile memory, the others are written to memory unless compressed
+	uint32_t stored_bits{0};
+	uint32_t stored_count{0};
+	uint32_t compressible_count{0};
+
+	for (auto &attachment : render_context->get_render_frames().at(0).get_render_target().get_attachments())
+	{
+		if (attachment.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+		{
+			continue;
+		}
+
+		stored_bits += static_cast<uint32_t>(std::max(get_bits_per_pixel(attachment.format), 0)) * attachment.samples;
+		stored_count++;
+
+		if (is_afbc_eligible(attachment.usage))
+		{
+			compressible_count++;
+		}
+	}
+
+	get_debug_info().insert<field::Static, std::string>("bytes_per_pixel",
+	                                                    fmt::format("{} ({} of {} stored attachments AFBC eligible)", stored_bits / 8, compressible_count, stored_count));
+
+	// Traffic of the load and store operations of the render passes of the last frame, an upper bound as compression is left out
+	auto to_mib = [](double bytes) { return bytes / (1024.0 * 1024.0); };
+
+	auto &bandwidth_estimator = render_context->get_last_rendered_frame().get_bandwidth_estimator();
+	auto  estimated_bandwidth = bandwidth_estimator.get_total();
+
+	get_debug_info().insert<field::Static, std::string>("estimated_bandwidth",
+	                                                    fmt::format("{:.2f} MiB loaded, {:.2f} MiB stored ({:.2f} MiB compressible)",
+	                                                                to_mib(estimated_bandwidth.loaded_bytes), to_mib(estimated_bandwidth.stored_bytes),
+	                                                                to_mib(estimated_bandwidth.compressible_bytes)));
+
+	auto &render_passes = bandwidth_estimator.get_render_passes();
+
+	for (size_t i = 0; i < render_passes.size(); ++i)
+	{
+		get_debug_info().insert<field::Static, std::string>("render_pass_" + to_string(i) + "_bandwidth",
+		                                                    fmt::format("{}: {:.2f} MiB loaded, {:.2f} MiB stored", render_passes[i].name,
+		                                                                to_mib(render_passes[i].loaded_bytes), to_mib(render_passes[i].stored_bytes)));
+	}
+
+	// The counters also measure the textures and buffers read by the draws, and the transfers and dispatches
+	if (measured_read_bytes >= 0.0 && measured_write_bytes >= 0.0)
+	{
+		get_debug_info().insert<field::Static, std::string>("measured_bandwidth",
+		                                                    fmt::format("{:.2f} MiB read, {:.2f} MiB written", to_mib(measured_read_bytes), to_mib(measured_write_bytes)));
+	}
+
+	if (scene)
+	{
+		get_debug_info().insert<field::Static, uint32_t>("mesh_count", to_u32(scene->get_components<sg::SubMesh>().size()));
+
+		get_debug_info().insert<field::Static, uint32_t>("texture_count", to_u32(scene->get_components<sg::Texture>().size()));
+	}
+
+	auto &heap_budgets = device->get_heap_budgets();
 
-	get_debug_info().insert<field::Static, uint32_t>("mesh_count", to_u32(scene->get_components<sg::SubMesh>().size()));
+	for (size_t i = 0; i < heap_budgets.size(); ++i)
+	{
+		get_debug_info().insert<field::Static, std::string>("heap_" + to_string(i),
+		                                                    fmt::format("{} / {} MiB", heap_budgets[i].usage / (1024 * 1024), heap_budgets[i].budget / (1024 * 1024)));
+	}
+
+	get_debug_info().insert<field::Static, uint32_t>("buffer_allocations", device->get_allocation_count(AllocationCategory::Buffer));
+	get_debug_info().insert<field::Static, uint32_t>("image_allocations", device->get_allocation_count(AllocationCategory::Image));
+	get_debug_info().insert<field::Static, uint32_t>("staging_allocations", device->get_allocation_count(AllocationCategory::Staging));
+	get_debug_info().insert<field::Static, uint32_t>("pool_block_allocations", device->get_allocation_count(AllocationCategory::PoolBlock));
+
+	for (size_t i = 0; i < static_cast<size_t>(MemoryPoolClass::Count); ++i)
+	{
+		auto pool_class = static_cast<MemoryPoolClass>(i);
+		auto pool_stats = device->get_memory_pools().get_stats(pool_class);
+
+		get_debug_info().insert<field::Static, std::string>(std::string{to_string(pool_class)} + "_pool",
+		                                                    fmt::format("{:.1f} / {:.1f} MiB ({} allocations, {} blocks)",
+		                                                                pool_stats.used / (1024.0 * 1024.0), pool_stats.size / (1024.0 * 1024.0),
+		                                                                pool_stats.allocation_count, pool_stats.block_count));
+	}
+
+	auto format_pipeline_creation = [](const PipelineCreationStats &stats) {
+		return fmt::format("{} ({} cache hits, {:.1f} ms)", stats.created, stats.cache_hits, stats.total_duration / 1e6);
+	};
+
+	auto &resource_cache = device->get_resource_cache();
+
+	get_debug_info().insert<field::Static, std::string>("graphics_pipelines", format_pipeline_creation(resource_cache.get_pipeline_creation_stats(EvictableResource::GraphicsPipeline)));
+	get_debug_info().insert<field::Static, std::string>("compute_pipelines", format_pipeline_creation(resource_cache.get_pipeline_creation_stats(EvictableResource::ComputePipeline)));
+
+	auto format_binds = [](uint32_t binds, uint32_t skipped) { return fmt::format("{} ({} skipped)", binds, skipped); };
+
+	get_debug_info().insert<field::Static, std::string>("pipeline_binds", format_binds(frame_bind_stats.pipeline_binds, frame_bind_stats.pipeline_binds_skipped));
+	get_debug_info().insert<field::Static, std::string>("descriptor_set_binds", format_binds(frame_bind_stats.descriptor_set_binds, frame_bind_stats.descriptor_set_binds_skipped));
+	get_debug_info().insert<field::Static, std::string>("vertex_buffer_binds", format_binds(frame_bind_stats.vertex_buffer_binds, frame_bind_stats.vertex_buffer_binds_skipped));
+	get_debug_info().insert<field::Static, std::string>("index_buffer_binds", format_binds(frame_bind_stats.index_buffer_binds, frame_bind_stats.index_buffer_binds_skipped));
+
+	if (AllocationTracker::is_enabled())
+	{
+		auto format_allocations = [](const AllocationCounters &counters) { return fmt::format("{} ({} bytes)", counters.count, counters.bytes); };
 
-	get_debug_info().insert<field::Static, uint32_t>("texture_count", to_u32(scene->get_components<sg::Texture>().size()));
+		get_debug_info().insert<field::Static, std::string>("frame_allocations", format_allocations(AllocationTracker::get_total(frame_allocations)));
+
+		for (size_t i = 0; i < frame_allocations.size(); i++)
+		{
+			auto scope_name = AllocationTracker::get_scope_name(static_cast<AllocationScope>(i));
+
+			get_debug_info().insert<field::Static, std::string>(std::string{"allocations_"} + scope_name, format_allocations(frame_allocations[i]));
+		}
+	}
+
+	if (render_pipeline)
+	{
+		for (auto &subpass : render_pipeline->get_subpasses())
+		{
+			if (auto geometry_subpass = dynamic_cast<GeometrySubpass *>(subpass.get()))
+			{
+				auto &culling_stats = geometry_subpass->get_culling_stats();
+
+				get_debug_info().insert<field::Static, uint32_t>("visible_draws", culling_stats.visible);
+				get_debug_info().insert<field::Static, uint32_t>("frustum_culled", culling_stats.frustum_culled);
+				get_debug_info().insert<field::Static, uint32_t>("distance_culled", culling_stats.distance_culled);
+				get_debug_info().insert<field::Static, uint32_t>("size_culled", culling_stats.size_culled);
+				break;
+			}
+		}
+	}
+
+	// Samples drawing without a scene have no camera
+	if (!scene || !scene->has_component<vkb::sg::Camera>())
+	{
+		return;
+	}
 
 	if (auto camera = scene->get_components<vkb::sg::Camera>().at(0))
 	{
 		if (auto camera_node = camera->get_node())
 		{
-			const glm::vec3 &pos = camera_node->get_transform().get_translation();
+			const glm::vec3 &pos = camera_node->get_transform().get_render_state().translation;
 			get_debug_info().insert<field::Vector, float>("camera_pos", pos.x, pos.y, pos.z);
 		}
 	}
@@ -372,7 +1390,22 @@ void VulkanSample::update_debug_window()
 
 void VulkanSample::load_scene(const std::string &path)
 {
-	GLTFLoader loader{*device};
+	GLTFLoader loader{*device, job_system.get()};
+
+	// Virtual textures page the levels above a tail of a single page, uploaded by the loader
+	if (virtual_texture_budget > 0)
+	{
+		loader.set_texture_streaming(true, VirtualTextures::PAGE_SIZE);
+	}
+	else
+	{
+		loader.set_texture_streaming(texture_streaming_budget > 0, texture_placeholder_size);
+	}
+	loader.set_generate_lods(generate_scene_lods);
+	loader.set_static_batching(static_batching, static_batch_cell_size);
+	loader.set_texture_compression(texture_compression);
+	loader.set_gpu_astc_decode(gpu_astc_decode);
+	loader.set_scene_cache(true);
 
 	scene = loader.read_scene_from_file(path);
 
@@ -381,6 +1414,351 @@ void VulkanSample::load_scene(const std::string &path)
 		LOGE("Cannot load scene: {}", path.c_str());
 		throw std::runtime_error("Cannot load scene: " + path);
 	}
+
+	create_virtual_textures();
+
+	create_texture_streamer();
+
+	create_memory_defragmenter();
+}
+
+void VulkanSample::load_scene_async(const std::string &path)
+{
+	if (scene_future.valid())
+	{
+		LOGW("A scene is already loading, ignoring {}", path);
+		return;
+	}
+
+	bool stream_textures  = texture_streaming_budget > 0 || virtual_texture_budget > 0;
+	auto placeholder_size = virtual_texture_budget > 0 ? uint32_t{VirtualTextures::PAGE_SIZE} : texture_placeholder_size;
+	bool generate_lods    = generate_scene_lods;
+	bool batch_static     = static_batching;
+	auto batch_cell_size  = static_batch_cell_size;
+	auto compression      = texture_compression;
+	bool decode_astc      = gpu_astc_decode;
+
+	scene_future = std::async(std::launch::async, [this, path, stream_textures, placeholder_size, generate_lods, batch_static, batch_cell_size, compression, decode_astc]() {
+		GLTFLoader loader{*device, job_system.get()};
+
+		loader.set_texture_streaming(stream_textures, placeholder_size);
+		loader.set_generate_lods(generate_lods);
+		loader.set_static_batching(batch_static, batch_cell_size);
+		loader.set_texture_compression(compression);
+		loader.set_gpu_astc_decode(decode_astc);
+		loader.set_scene_cache(true);
+
+		return loader.read_scene_from_file(path);
+	});
+}
+
+bool VulkanSample::is_loading_scene() const
+{
+	return scene_future.valid();
+}
+
+void VulkanSample::enable_dynamic_resolution(float target_frame_time, float min_scale, float max_scale, bool temporal_upscaling)
+{
+	if (!render_context->has_swapchain())
+	{
+		LOGW("Dynamic resolution needs a swapchain, skipping");
+		return;
+	}
+
+	auto create_func = render_context->get_render_target_create_func();
+
+	// The scene render targets are built as the frame ones were, which now only hold the swapchain image
+	dynamic_resolution = std::make_unique<DynamicResolution>(create_func, target_frame_time, min_scale, max_scale);
+
+	render_context->set_render_target_create_func([](core::Image &&swapchain_image) {
+		std::vector<core::Image> images;
+		images.push_back(std::move(swapchain_image));
+		return RenderTarget{std::move(images)};
+	});
+
+	// The swapchain images are blitted to
+	std::set<VkImageUsageFlagBits> image_usage_flags{VK_IMAGE_USAGE_TRANSFER_DST_BIT};
+
+	auto usage = render_context->get_swapchain().get_usage();
+
+	for (VkImageUsageFlags bit = 1; bit != 0 && bit <= usage; bit <<= 1)
+	{
+		if (usage & bit)
+		{
+			image_usage_flags.insert(static_cast<VkImageUsageFlagBits>(bit));
+		}
+	}
+
+	// The previous swapchain and render targets are retired until the frames using them have completed
+	render_context->update_swapchain(image_usage_flags);
+
+	if (!dynamic_resolution->is_supported(*render_context))
+	{
+		dynamic_resolution.reset();
+
+		render_context->set_render_target_create_func(create_func);
+
+		render_context->recreate();
+
+		return;
+	}
+
+	if (temporal_upscaling)
+	{
+		// The history is resolved by a compute shader, recorded with the frame
+		if (render_context->get_queue().get_properties().queueFlags & VK_QUEUE_COMPUTE_BIT)
+		{
+			dynamic_resolution->set_temporal_upscaling(true);
+
+			set_subpass_motion_vectors();
+		}
+		else
+		{
+			LOGW("Temporal upscaling needs compute on the graphics queue, blitting instead");
+		}
+	}
+}
+
+void VulkanSample::set_gui_layer_rate(float updates_per_second)
+{
+	gui_layer_rate = updates_per_second;
+}
+
+void VulkanSample::on_scene_loaded()
+{
+	LOGW("Scene replaced without a new render pipeline, override on_scene_loaded to render it");
+
+	device->get_deletion_queue().release(std::move(render_pipeline));
+}
+
+void VulkanSample::create_texture_streamer()
+{
+	texture_streamer.reset();
+
+	// The images virtual textures cannot page are streamed within their budget, unless streaming has its own
+	auto budget = texture_streaming_budget > 0 ? texture_streaming_budget : virtual_texture_budget;
+
+	if (budget > 0)
+	{
+		auto frames_in_flight = to_u32(render_context->get_render_frames().size());
+
+		texture_streamer = std::make_unique<TextureStreamer>(*device, *scene, budget, frames_in_flight);
+	}
+}
+
+void VulkanSample::create_virtual_textures()
+{
+	if (virtual_textures)
+	{
+		device->get_deletion_queue().release(std::move(virtual_textures));
+	}
+
+	if (virtual_texture_budget > 0)
+	{
+		auto frames_in_flight = to_u32(render_context->get_render_frames().size());
+
+		// Clears the data of the images it pages, so that the texture streamer leaves them
+		virtual_textures = std::make_unique<VirtualTextures>(*device, *scene, virtual_texture_budget, frames_in_flight, job_system.get());
+	}
+}
+
+void VulkanSample::set_virtual_textures(VkDeviceSize memory_budget)
+{
+	virtual_texture_budget = memory_budget;
+}
+
+void VulkanSample::set_subpass_virtual_textures()
+{
+	if (!virtual_textures || !render_pipeline)
+	{
+		return;
+	}
+
+	for (auto &subpass : render_pipeline->get_subpasses())
+	{
+		if (auto geometry_subpass = dynamic_cast<GeometrySubpass *>(subpass.get()))
+		{
+			geometry_subpass->set_virtual_textures(virtual_textures.get());
+			geometry_subpass->set_texture_streamer(texture_streamer.get());
+
+			// The shader variants of the paged sub meshes sample through the page table
+			geometry_subpass->prepare();
+		}
+	}
+}
+
+void VulkanSample::set_subpass_motion_vectors()
+{
+	if (!dynamic_resolution || !dynamic_resolution->uses_temporal_upscaling() || !render_pipeline)
+	{
+		return;
+	}
+
+	for (auto &subpass : render_pipeline->get_subpasses())
+	{
+		auto geometry_subpass = dynamic_cast<GeometrySubpass *>(subpass.get());
+
+		// Subpasses writing other attachments, such as a G-buffer, are left as they are
+		if (geometry_subpass && !geometry_subpass->uses_motion_vectors() &&
+		    geometry_subpass->get_output_attachments() == std::vector<uint32_t>{0})
+		{
+			geometry_subpass->set_motion_vectors(true);
+			geometry_subpass->set_output_attachments({0, TemporalUpscaler::MOTION_VECTOR_ATTACHMENT});
+
+			geometry_subpass->prepare();
+		}
+	}
+
+	// Cleared to no motion where nothing is drawn
+	auto load_store = render_pipeline->get_load_store();
+
+	if (load_store.size() <= TemporalUpscaler::MOTION_VECTOR_ATTACHMENT)
+	{
+		load_store.resize(TemporalUpscaler::MOTION_VECTOR_ATTACHMENT + 1);
+
+		render_pipeline->set_load_store(load_store);
+	}
+}
+
+void VulkanSample::set_weighted_blended_transparency(bool enabled)
+{
+	weighted_blended_transparency = enabled;
+}
+
+void VulkanSample::set_parallel_subpasses(bool enabled)
+{
+	parallel_subpasses = enabled;
+}
+
+void VulkanSample::set_subpass_weighted_blended_transparency()
+{
+	if (!weighted_blended_transparency || !render_pipeline || !render_context)
+	{
+		return;
+	}
+
+	auto &subpasses = render_pipeline->get_subpasses();
+
+	auto forward_subpass = subpasses.size() == 1 ? dynamic_cast<ForwardSubpass *>(subpasses[0].get()) : nullptr;
+
+	if (!forward_subpass || forward_subpass->get_output_attachments() != std::vector<uint32_t>{0} ||
+	    forward_subpass->get_view_mask() != 0 || dynamic_resolution)
+	{
+		LOGW("Weighted blended transparency needs a single forward subpass without dynamic resolution, sorting instead");
+		return;
+	}
+
+	if (!weighted_blended_targets)
+	{
+		// Other render targets may be laid out differently
+		if (render_context->get_render_frames().at(0).get_render_target().get_attachments().size() != 2)
+		{
+			LOGW("Weighted blended transparency needs the default render targets, sorting instead");
+			return;
+		}
+
+		render_context->set_render_target_create_func(RenderTarget::create_weighted_blended_func());
+
+		render_context->recreate();
+
+		weighted_blended_targets = true;
+	}
+
+	forward_subpass->set_transparent_draws(TransparentDraws::Skipped);
+	forward_subpass->prepare();
+
+	auto weighted_blended_subpass = std::make_unique<WeightedBlendedSubpass>(*render_context, forward_subpass->get_scene(), forward_subpass->get_camera());
+	weighted_blended_subpass->set_output_attachments({RenderTarget::WEIGHTED_BLENDED_ACCUMULATION, RenderTarget::WEIGHTED_BLENDED_REVEALAGE});
+	weighted_blended_subpass->set_culling_options(forward_subpass->get_culling_options());
+	weighted_blended_subpass->set_model_upload(forward_subpass->get_model_upload());
+	render_pipeline->add_subpass(std::move(weighted_blended_subpass));
+
+	auto resolve_subpass = std::make_unique<WeightedBlendedResolveSubpass>(*render_context);
+	resolve_subpass->set_input_attachments({RenderTarget::WEIGHTED_BLENDED_ACCUMULATION, RenderTarget::WEIGHTED_BLENDED_REVEALAGE});
+	render_pipeline->add_subpass(std::move(resolve_subpass));
+
+	// Cleared to nothing accumulated and everything revealed, never leaving the tile memory
+	auto load_store = render_pipeline->get_load_store();
+	load_store.resize(RenderTarget::WEIGHTED_BLENDED_REVEALAGE + 1);
+	load_store[RenderTarget::WEIGHTED_BLENDED_ACCUMULATION] = {VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE};
+	load_store[RenderTarget::WEIGHTED_BLENDED_REVEALAGE]    = {VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE};
+	render_pipeline->set_load_store(load_store);
+
+	auto clear_value = render_pipeline->get_clear_value();
+	clear_value.resize(RenderTarget::WEIGHTED_BLENDED_REVEALAGE + 1);
+	clear_value[RenderTarget::WEIGHTED_BLENDED_ACCUMULATION].color = {0.0f, 0.0f, 0.0f, 0.0f};
+	clear_value[RenderTarget::WEIGHTED_BLENDED_REVEALAGE].color    = {1.0f, 0.0f, 0.0f, 0.0f};
+	render_pipeline->set_clear_value(clear_value);
+}
+
+void VulkanSample::create_memory_defragmenter()
+{
+	memory_defragmenter.reset();
+
+	if (memory_defragmentation && scene_streamer)
+	{
+		LOGW("Memory defragmentation is not used while streaming the scene");
+		return;
+	}
+
+	if (memory_defragmentation && scene && render_context)
+	{
+		auto frames_in_flight = to_u32(render_context->get_render_frames().size());
+
+		memory_defragmenter = std::make_unique<MemoryDefragmenter>(*device, *scene, frames_in_flight);
+	}
+}
+
+void VulkanSample::swap_loaded_scene()
+{
+	if (!scene_future.valid() || scene_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return;
+	}
+
+	std::unique_ptr<sg::Scene> loaded_scene;
+
+	try
+	{
+		loaded_scene = scene_future.get();
+	}
+	catch (const std::exception &e)
+	{
+		LOGE("Failed to load scene asynchronously: {}", e.what());
+	}
+
+	if (!loaded_scene)
+	{
+		LOGE("Cannot load scene asynchronously, keeping the current one");
+		return;
+	}
+
+	texture_streamer.reset();
+	memory_defragmenter.reset();
+
+	// The cells were attached to the previous scene
+	scene_streamer.reset();
+
+	std::swap(scene, loaded_scene);
+
+	create_virtual_textures();
+
+	create_texture_streamer();
+
+	create_memory_defragmenter();
+
+	on_scene_loaded();
+
+	request_redraw();
+
+	// The frames in flight may still use the resources of the previous scene, released
+	// after the render pipeline which refers to it
+	device->get_deletion_queue().release(std::move(loaded_scene));
+
+	if (!camera_path_file.empty())
+	{
+		add_camera_path();
+	}
 }
 
 VkSurfaceKHR VulkanSample::get_surface()
@@ -396,8 +1774,29 @@ RenderContext &VulkanSample::get_render_context()
 
 void VulkanSample::set_render_pipeline(RenderPipeline &&rp)
 {
-	render_pipeline.reset();
+	// The buffers and images of the subpasses may still be used by frames in flight
+	if (device)
+	{
+		device->get_deletion_queue().release(std::move(render_pipeline));
+	}
+
 	render_pipeline = std::make_unique<RenderPipeline>(std::move(rp));
+
+	set_subpass_virtual_textures();
+
+	set_subpass_motion_vectors();
+
+	set_subpass_weighted_blended_transparency();
+
+	render_pipeline->set_job_system(parallel_subpasses ? job_system.get() : nullptr);
+
+	request_redraw();
+
+	// Build the pipelines of the scene now rather than in the first frames which draw it
+	if (render_context && !render_context->get_render_frames().empty())
+	{
+		render_pipeline->prewarm(render_context->get_render_frames()[0].get_render_target());
+	}
 }
 
 RenderPipeline &VulkanSample::get_render_pipeline()
@@ -426,4 +1825,16 @@ sg::Scene &VulkanSample::get_scene()
 	assert(scene && "Scene not loaded");
 	return *scene;
 }
+
+JobSystem &VulkanSample::get_job_system()
+{
+	assert(job_system && "Job system not created, the sample is not prepared");
+	return *job_system;
+}
+
+FrameCapture &VulkanSample::get_frame_capture()
+{
+	assert(frame_capture && "Frame capture not created, the sample is not prepared");
+	return *frame_capture;
+}
 }        // namespace vkb
@@ -20,17 +20,28 @@
 
 #pragma once
 
+#include <chrono>
+#include <future>
+
+#include "allocation_tracker.h"
 #include "common/error.h"
 #include "common/utils.h"
 #include "common/vk_common.h"
+#include "frame_capture.h"
 #include "gui.h"
+#include "job_system.h"
+#include "memory_defragmenter.h"
 #include "platform/application.h"
+#include "rendering/dynamic_resolution.h"
 #include "rendering/render_context.h"
 #include "rendering/render_pipeline.h"
 #include "scene_graph/node.h"
 #include "scene_graph/scene.h"
 #include "scene_graph/scripts/node_animation.h"
 #include "stats.h"
+#include "scene_streamer.h"
+#include "texture_streamer.h"
+#include "virtual_textures.h"
 
 namespace vkb
 {
@@ -125,6 +136,21 @@ class VulkanSample : public Application
 
 	virtual void finish() override;
 
+	/**
+	 * @brief Starts a benchmark run, the CPU and GPU time of its frames are logged when the sample finishes
+	 */
+	virtual void begin_benchmark_capture() override;
+
+	/**
+	 * @brief Sets the next configuration of the sample
+	 */
+	virtual bool next_benchmark_configuration() override;
+
+	/**
+	 * @brief Returns the threads of the job system, the main thread excluded
+	 */
+	virtual std::vector<int32_t> get_worker_thread_ids() override;
+
 	/**
 	 * @brief Loads the scene
 	 *
@@ -132,21 +158,176 @@ class VulkanSample : public Application
 	 */
 	void load_scene(const std::string &path);
 
+	/**
+	 * @brief Loads a scene on a worker thread. The current scene keeps rendering while it loads,
+	 *        then the new scene replaces it at the start of a frame and on_scene_loaded is called
+	 *
+	 * @param path The path of the glTF file
+	 */
+	void load_scene_async(const std::string &path);
+
+	/**
+	 * @return Whether a scene is being loaded by load_scene_async
+	 */
+	bool is_loading_scene() const;
+
+	/**
+	 * @brief Renders the scene at a resolution scaled to keep the GPU frame time below a target, upscaled
+	 *        to the swapchain image before the gui is drawn. It should be called once the render context
+	 *        is prepared, the render targets of the frames are then built by DynamicResolution.
+	 * @param target_frame_time GPU frame time to stay below, in seconds
+	 * @param min_scale Lowest scale of the render resolution
+	 * @param max_scale Highest scale of the render resolution
+	 * @param temporal_upscaling If true the frames are accumulated by a TemporalUpscaler rather than blitted, which keeps
+	 *        the quality at low scales. The cameras of the scene are jittered, and the geometry subpasses drawing to
+	 *        the color alone also write the motion vectors. The render target function of the sample is not used
+	 */
+	void enable_dynamic_resolution(float target_frame_time, float min_scale = 0.5f, float max_scale = 1.0f, bool temporal_upscaling = false);
+
+	/**
+	 * @brief Renders the gui to a layer of its own at a reduced rate, composited over the frames in between.
+	 *        See Gui::set_layer_rate.
+	 * @param updates_per_second Rate of the layer updates, 0 to draw the gui every frame
+	 */
+	void set_gui_layer_rate(float updates_per_second);
+
 	VkSurfaceKHR get_surface();
 
 	Device &get_device();
 
 	RenderContext &get_render_context();
 
+	/**
+	 * @brief Sets the render pipeline, and builds the graphics pipelines its subpasses report they will draw with
+	 */
 	void set_render_pipeline(RenderPipeline &&render_pipeline);
 
 	RenderPipeline &get_render_pipeline();
 
 	Configuration &get_configuration();
 
+	/**
+	 * @return The heap allocations of each subsystem during the last update, all zero unless built with VKB_ALLOCATION_TRACKING
+	 */
+	const ScopedAllocationCounters &get_frame_allocations() const;
+
+	/**
+	 * @brief Moves the camera of the sample, the one driven by a free camera script, along a path.
+	 *        The path is added again to the scenes loaded asynchronously afterwards.
+	 * @param filename The path to the camera path file (relative to the storage directory), see sg::CameraPath::load
+	 */
+	void set_camera_path(const std::string &filename);
+
+	/**
+	 * @brief Updates the scene of the next frame on the job system while the current one is recorded.
+	 *        Frames then render the scene updated during the previous frame, from the render state of its transforms
+	 * @param enabled Whether the update and the recording of the frames are pipelined
+	 */
+	void set_pipelined_update(bool enabled);
+
+	/**
+	 * @brief Skips the frames in which nothing changed, the last presented one staying on screen. Changes are
+	 *        those of the scene transforms, the GUI and the streamed textures, samples changing what they
+	 *        render otherwise must call request_redraw. Frames in which only the GUI changed present its area
+	 *        alone, with VK_KHR_incremental_present
+	 * @param enabled Whether frames are only rendered when something changed, off by default
+	 */
+	void set_redraw_skipping(bool enabled);
+
+	/**
+	 * @brief Renders frames only when something changed, as redraw skipping does, and lets the platform block on the
+	 *        window events while nothing is pending instead of stepping every frame. Pending are the scenes loading
+	 *        and the streamed textures and cells, which are polled every Platform::IDLE_WAIT_TIMEOUT at most.
+	 *        Pipelined updates are not waited for, the skipped frames are paced as with redraw skipping then
+	 * @param enabled Whether the frames are rendered on demand, off by default
+	 */
+	void set_render_on_demand(bool enabled);
+
+	/**
+	 * @brief Selects the trade-off made when choosing the depth format of the render targets,
+	 *        to be called before prepare. Precision by default.
+	 */
+	void set_format_policy(FormatPolicy policy);
+
+	/**
+	 * @brief Moves the far plane of the perspective cameras of the scene to infinity
+	 */
+	void set_infinite_far_plane(bool infinite);
+
+	/**
+	 * @brief Builds a spatial index over the nodes of the scene, refitted every frame from the published transforms.
+	 *        Geometry subpasses then only visit the nodes the index finds in their frustum
+	 * @param enabled Whether the scene has a spatial index, off by default
+	 */
+	void set_spatial_index(bool enabled);
+
+	/**
+	 * @brief Defragments the device memory of the geometry buffers of the scene in the background,
+	 *        moving a few megabytes at the start of a frame when the memory is fragmented
+	 * @param enabled Whether the scenes are defragmented, off by default
+	 */
+	void set_memory_defragmentation(bool enabled);
+
+	/**
+	 * @brief Adds a stat per thread of the job system with the CPU time it ran for in the last frame, named after
+	 *        the index of the thread and the cores it is pinned to (see CpuTopology), to compare the load of the threads
+	 * @param enabled Whether the CPU times of the threads are shown, off by default
+	 */
+	void set_thread_cpu_times(bool enabled);
+
+	/**
+	 * @brief Pages the base color textures of the scenes loaded afterwards, keeping their levels above the tail
+	 *        in a fixed memory budget whatever the size of the textures. The sample forwards the virtual textures
+	 *        to the geometry subpasses of its render pipeline. Must be set before the scene is loaded
+	 * @param memory_budget Device memory for the resident pages, in bytes, zero disables it
+	 */
+	void set_virtual_textures(VkDeviceSize memory_budget);
+
+	/**
+	 * @brief Draws the transparent objects with weighted blended order-independent transparency, in a WeightedBlendedSubpass
+	 *        after the opaque ones, rather than sorting them back to front. Applies to the render pipelines of a single
+	 *        forward subpass rendering to the default render targets, whose targets gain the accumulation and revealage
+	 *        images. Must be set before the render pipeline, without dynamic resolution
+	 * @param enabled Whether the transparency is weighted blended, off by default
+	 */
+	void set_weighted_blended_transparency(bool enabled);
+
+	/**
+	 * @brief Records the subpasses of the render pipeline in parallel on the job system, each in a secondary
+	 *        command buffer, for the render pipelines of several subpasses. Applies from the next render pipeline set.
+	 *        The render passes given to record_pass are recorded in parallel as well, each in a primary command buffer
+	 * @param enabled Whether the subpasses are recorded in parallel, off by default
+	 */
+	void set_parallel_subpasses(bool enabled);
+
+	/**
+	 * @brief Measures the GPU stats which hwcpipe cannot, and the counters named, with VK_KHR_performance_query.
+	 *        The counters are picked once the stats are enabled, they only count the work of the render passes
+	 * @param names The names of the driver counters shown besides the stats, "all" for every one the queue can measure
+	 */
+	void set_performance_counters(const std::vector<std::string> &names);
+
+	/**
+	 * @brief Renders the next frames entirely, even if redraw skipping finds nothing changed
+	 */
+	void request_redraw();
+
 	sg::Scene &get_scene();
 
+	JobSystem &get_job_system();
+
+	/**
+	 * @brief Captures frames to files without stalling, such as those of the screenshot key
+	 */
+	FrameCapture &get_frame_capture();
+
   protected:
+	/**
+	 * @brief Runs the jobs of the framework, such as scene loading, transform updates and draw recording.
+	 *        The thread indices of the jobs select the per-thread resources of the render frames
+	 */
+	std::unique_ptr<JobSystem> job_system{nullptr};
+
 	/**
 	 * @brief The Vulkan device
 	 */
@@ -162,17 +343,82 @@ class VulkanSample : public Application
 	 */
 	std::unique_ptr<sg::Scene> scene{nullptr};
 
+	/**
+	 * @brief Streams the mip levels of the scene images, created by load_scene if texture_streaming_budget is set
+	 */
+	std::unique_ptr<TextureStreamer> texture_streamer{nullptr};
+
+	/**
+	 * @brief Pages the base color images of the scene, created by load_scene if virtual_texture_budget is set
+	 */
+	std::unique_ptr<VirtualTextures> virtual_textures{nullptr};
+
+	/**
+	 * @brief Moves the geometry buffers of the scene to compact their memory, see set_memory_defragmentation
+	 */
+	std::unique_ptr<MemoryDefragmenter> memory_defragmenter{nullptr};
+
+	/**
+	 * @brief Streams the cells of a large world into the scene around the camera, created by the samples which
+	 *        partition their world. Memory defragmentation is not used with it, as the cells free their buffers
+	 */
+	std::unique_ptr<SceneStreamer> scene_streamer{nullptr};
+
+	/**
+	 * @brief Device memory for the mip levels of the scene images, in bytes. If not zero, load_scene
+	 *        streams the images, and the sample forwards the streamer to its geometry subpasses
+	 */
+	VkDeviceSize texture_streaming_budget{0};
+
+	/**
+	 * @brief Largest extent of the image levels load_scene uploads when streaming textures. The rest
+	 *        is uploaded once the images are drawn, so small sizes get to the first frame sooner
+	 */
+	uint32_t texture_placeholder_size{TextureStreamer::TAIL_SIZE};
+
+	/**
+	 * @brief If set, load_scene generates simplified levels of detail for the sub meshes,
+	 *        which geometry subpasses pick by screen size
+	 */
+	bool generate_scene_lods{false};
+
+	/// If set, load_scene merges the sub meshes of static nodes into batches, see GLTFLoader::set_static_batching
+	bool static_batching{false};
+
+	/// Size of the cells splitting the static batches, 0 for one batch per material
+	float static_batch_cell_size{0.0f};
+
+	/// Block format the RGBA8 images of the scene are compressed to as it loads, see GLTFLoader::set_texture_compression
+	VkFormat texture_compression{VK_FORMAT_UNDEFINED};
+
+	/// If set, the ASTC images of the scene are decoded by a compute shader on devices without ASTC, see GLTFLoader::set_gpu_astc_decode
+	bool gpu_astc_decode{false};
+
 	std::unique_ptr<Gui> gui{nullptr};
 
+	std::unique_ptr<FrameCapture> frame_capture{nullptr};
+
 	std::unique_ptr<Stats> stats{nullptr};
 
+	/**
+	 * @brief Scales the render resolution of the scene, created by enable_dynamic_resolution
+	 */
+	std::unique_ptr<DynamicResolution> dynamic_resolution{nullptr};
+
 	/**
 	 * @brief Context used for rendering, it is responsible for managing the frames and their underlying images
 	 */
 	std::unique_ptr<RenderContext> render_context{nullptr};
 
 	/**
-	 * @brief Update scene
+	 * @brief Called at a frame boundary, with the device idle, once a scene loaded by load_scene_async
+	 *        replaced the previous one. Samples recreate their camera and render pipeline here.
+	 *        The default implementation drops the render pipeline, as it refers to the previous scene
+	 */
+	virtual void on_scene_loaded();
+
+	/**
+	 * @brief Update scene, then publishes its render state unless the update is pipelined
 	 * @param delta_time
 	 */
 	void update_scene(float delta_time);
@@ -183,6 +429,17 @@ class VulkanSample : public Application
 	 */
 	void update_stats(float delta_time);
 
+	/**
+	 * @brief Picks the performance counters on first use, then sets the values measured for the last frame
+	 * @param delta_time
+	 */
+	void update_performance_counters(float delta_time);
+
+	/**
+	 * @brief Submits the last command buffer of the frame, tagging the counter samples taken from now on with the submit phase
+	 */
+	void submit_frame(CommandBuffer &command_buffer);
+
 	/**
 	 * @brief Update GUI
 	 * @param delta_time
@@ -196,6 +453,24 @@ class VulkanSample : public Application
 	 */
 	virtual void draw(CommandBuffer &command_buffer, RenderTarget &render_target);
 
+	/**
+	 * @brief The part of draw rendering the scene, to an offscreen render target with dynamic resolution
+	 * @param command_buffer The command buffer to record the commands to
+	 * @param render_target The render target of the frame, only its extent is used with dynamic resolution
+	 * @return The render target the scene was drawn to
+	 */
+	RenderTarget &draw_scene(CommandBuffer &command_buffer, RenderTarget &render_target);
+
+	/**
+	 * @brief The part of draw writing the swapchain image: upscales the scene with dynamic resolution
+	 *        and transitions the image to the present layout. With dynamic resolution and a late swapchain
+	 *        acquire, update records it in a command buffer of its own once the image is acquired.
+	 * @param command_buffer The command buffer to record the commands to
+	 * @param scene_target The render target returned by draw_scene
+	 * @param render_target The render target of the frame, holding the swapchain image
+	 */
+	void compose(CommandBuffer &command_buffer, RenderTarget &scene_target, RenderTarget &render_target);
+
 	/**
 	 * @brief Starts the render pass, executes the render pipeline, and then ends the render pass
 	 * @param command_buffer The command buffer to record the commands to
@@ -203,6 +478,23 @@ class VulkanSample : public Application
 	 */
 	virtual void draw_renderpass(CommandBuffer &command_buffer, RenderTarget &render_target);
 
+	/**
+	 * @brief Records a render pass, and the barriers following it, independently of the commands recorded next. With
+	 *        parallel subpasses it is recorded on the job system into a primary command buffer of its own, submitted
+	 *        between the commands recorded so far and the ones recorded next, see RenderContext::record_async
+	 * @param command_buffer The command buffer of the frame, outside of a render pass
+	 * @param record Records the render pass, given the command buffer to record to and the index of the thread
+	 *        recording it, whose frame resources the subpasses must allocate from
+	 */
+	void record_pass(CommandBuffer &command_buffer, std::function<void(CommandBuffer &, size_t)> &&record);
+
+	/**
+	 * @brief Writes the completed frame captures and records the copy of the frame if it is captured.
+	 *        Called by update after draw, samples recording their own frames call it the same way.
+	 * @param command_buffer The command buffer of the frame, with the swapchain image in the present layout
+	 */
+	void record_frame_capture(CommandBuffer &command_buffer);
+
 	/**
 	 * @brief Triggers the render pipeline, it can be overriden by samples to specialize their rendering logic
 	 * @param command_buffer The command buffer to record the commands to
@@ -232,6 +524,7 @@ class VulkanSample : public Application
 
 	/**
 	 * @brief Virtual function, prepares the render_context, can be overriden to customise the render context creation
+	 *        The default one allocates per-thread resources for each thread of the job system
 	 */
 	virtual void prepare_render_context();
 
@@ -255,6 +548,12 @@ class VulkanSample : public Application
   private:
 	static constexpr float STATS_VIEW_RESET_TIME{10.0f};        // 10 seconds
 
+	/// Frames rendered after a redraw request, the second one renders the state of a pipelined update
+	static constexpr uint32_t REDRAW_FRAME_COUNT{2};
+
+	/// Time waited in a skipped frame when the frames are not paced, as no present throttles them
+	static constexpr std::chrono::milliseconds SKIPPED_FRAME_DURATION{16};
+
 	/**
 	 * @brief The Vulkan instance
 	 */
@@ -269,5 +568,242 @@ class VulkanSample : public Application
 	 * @brief The configuration of the sample
 	 */
 	Configuration configuration{};
+
+	/**
+	 * @brief Frame times of a benchmark run, in milliseconds
+	 */
+	struct BenchmarkRun
+	{
+		std::vector<float> cpu_times;
+
+		std::vector<float> gpu_times;
+	};
+
+	/**
+	 * @brief The benchmark runs of the sample, one per configuration in a sweep
+	 */
+	std::vector<BenchmarkRun> benchmark_runs;
+
+	/**
+	 * @brief The camera path file set by set_camera_path, if any
+	 */
+	std::string camera_path_file;
+
+	/**
+	 * @brief Adds the camera path to the node of the free camera of the scene
+	 */
+	void add_camera_path();
+
+	/**
+	 * @brief Logs the distributions of the CPU and GPU frame times of the benchmark runs side by side
+	 */
+	void log_benchmark_runs() const;
+
+	/**
+	 * @brief Scene being loaded by load_scene_async
+	 */
+	std::future<std::unique_ptr<sg::Scene>> scene_future;
+
+	/**
+	 * @brief Updates per second of the gui layer, applied to the gui of the sample
+	 */
+	float gui_layer_rate{0.0f};
+
+	/**
+	 * @brief Binds recorded and skipped in the last frame, shown in the debug window
+	 */
+	CommandBuffer::BindStats frame_bind_stats;
+
+	/**
+	 * @brief Heap allocations of each subsystem in the last frame, only counted in builds with VKB_ALLOCATION_TRACKING
+	 */
+	ScopedAllocationCounters frame_allocations;
+
+	/**
+	 * @brief Index of the frame being updated, the counter samples are attributed to it
+	 */
+	uint64_t frame_index{0};
+
+	/**
+	 * @brief Index of the frame last submitted with each render frame
+	 */
+	std::vector<uint64_t> submitted_frame_indices;
+
+	/**
+	 * @brief Index of the frame submitted with each render frame before the last one, whose GPU time the render frame reports
+	 */
+	std::vector<uint64_t> profiled_frame_indices;
+
+	/**
+	 * @brief Whether the scene is updated while the previous frame is recorded, see set_pipelined_update
+	 */
+	bool pipelined_update{false};
+
+	/**
+	 * @brief Whether the frames in which nothing changed are skipped, see set_redraw_skipping
+	 */
+	bool redraw_skipping{false};
+
+	/**
+	 * @brief Whether the platform blocks on the window events while nothing changes, see set_render_on_demand
+	 */
+	bool render_on_demand{false};
+
+	/**
+	 * @brief Trade-off made by the device when choosing the depth format, see set_format_policy
+	 */
+	FormatPolicy format_policy{FormatPolicy::Precision};
+
+	/**
+	 * @brief Whether the perspective cameras use an infinite far plane, see set_infinite_far_plane
+	 */
+	bool infinite_far_plane{false};
+
+	/**
+	 * @brief Whether the scene has a spatial index, see set_spatial_index
+	 */
+	bool use_spatial_index{false};
+
+	/// Version of the scene the spatial index was built from, see sg::Scene::get_version
+	uint64_t spatial_index_version{0};
+
+	/**
+	 * @brief Whether the scenes are defragmented, see set_memory_defragmentation
+	 */
+	bool memory_defragmentation{false};
+
+	/**
+	 * @brief Whether the CPU times of the threads are shown, see set_thread_cpu_times
+	 */
+	bool thread_cpu_times{false};
+
+	/// CPU time of each thread of the job system at the previous frame, in seconds
+	std::vector<double> previous_thread_cpu_times;
+
+	/**
+	 * @brief Device memory for the pages of the virtual textures, see set_virtual_textures
+	 */
+	VkDeviceSize virtual_texture_budget{0};
+
+	/**
+	 * @brief Whether the transparent objects are weighted blended, see set_weighted_blended_transparency
+	 */
+	bool weighted_blended_transparency{false};
+
+	/**
+	 * @brief Whether the frame render targets were replaced by the weighted blended ones
+	 */
+	bool weighted_blended_targets{false};
+
+	/**
+	 * @brief Whether the subpasses are recorded in parallel, see set_parallel_subpasses
+	 */
+	bool parallel_subpasses{false};
+
+	/**
+	 * @brief Names of the driver counters queried, see set_performance_counters
+	 */
+	std::vector<std::string> performance_counter_names;
+
+	/**
+	 * @brief Counters measured by the performance queries of the render frames
+	 */
+	std::vector<PerformanceCounter> performance_counters;
+
+	/**
+	 * @brief Whether the performance counters were picked, which is done once
+	 */
+	bool performance_counters_selected{false};
+
+	/**
+	 * @brief External memory bytes read and written by the last frame according to the GPU counters,
+	 *        negative if they are not measured. Compared with the traffic estimated for the render passes
+	 */
+	double measured_read_bytes{-1.0};
+
+	double measured_write_bytes{-1.0};
+
+	/**
+	 * @brief Number of frames to render entirely, whatever changed
+	 */
+	uint32_t redraw_count{REDRAW_FRAME_COUNT};
+
+	/**
+	 * @brief Counter of the scene update running on the job system when pipelined
+	 */
+	JobSystem::Counter simulation_counter;
+
+	/**
+	 * @brief Input events for the scripts received while the scene update was running, delivered after it
+	 */
+	std::vector<std::unique_ptr<InputEvent>> pending_script_events;
+
+	/**
+	 * @return Whether work in the background may change what the next frames render, such as a scene being loaded
+	 */
+	bool has_pending_work() const;
+
+	/**
+	 * @brief Waits for the pipelined scene update, if any, and delivers the input events received meanwhile
+	 */
+	void wait_for_simulation();
+
+	/**
+	 * @brief Sends an input event to the scripts of the scene
+	 */
+	void send_script_event(const InputEvent &input_event);
+
+	/**
+	 * @brief Creates the texture streamer of the current scene if streaming is enabled
+	 */
+	void create_texture_streamer();
+
+	/**
+	 * @brief Creates the virtual textures of the current scene if they are enabled
+	 */
+	void create_virtual_textures();
+
+	/**
+	 * @brief Forwards the virtual textures to the geometry subpasses of the render pipeline, and prepares them again
+	 */
+	void set_subpass_virtual_textures();
+
+	/**
+	 * @brief Makes the geometry subpasses of the render pipeline write the motion vectors for temporal upscaling,
+	 *        if enabled, and prepares them again
+	 */
+	void set_subpass_motion_vectors();
+
+	/**
+	 * @brief Moves the transparent objects of the forward subpass of the render pipeline to a weighted blended
+	 *        subpass and its resolve, if enabled, recreating the render targets with their attachments
+	 */
+	void set_subpass_weighted_blended_transparency();
+
+	/**
+	 * @brief Creates the memory defragmenter of the current scene if defragmentation is enabled
+	 */
+	void create_memory_defragmenter();
+
+	/**
+	 * @brief Replaces the scene once an asynchronous load has completed
+	 */
+	void swap_loaded_scene();
+
+	/**
+	 * @brief Gives the far plane setting and the pre-rotation of the render context to the cameras of the scene. While the
+	 *        swapchain is rotated by 90 or 270 degrees, perspective cameras take the aspect ratio of its images rather than the window one
+	 */
+	void update_cameras();
+
+	/**
+	 * @brief Builds the spatial index of a scene which has none yet, otherwise refits it to the published transforms
+	 */
+	void update_spatial_index();
+
+	/**
+	 * @brief Attaches and detaches the cells of the scene streamer around the camera
+	 */
+	void update_scene_streamer();
 };
 }        // namespace vkb
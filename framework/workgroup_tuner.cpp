@@ -0,0 +1,407 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "workgroup_tuner.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "common/logging.h"
+#include "core/command_buffer.h"
+#include "core/device.h"
+#include "platform/filesystem.h"
+
+namespace vkb
+{
+namespace
+{
+/**
+ * @brief Header of the file of the tuned sizes, followed by entry_count entries of a 32-bit name size,
+ *        the name, and the 32-bit x and y of the size
+ */
+struct WorkgroupTunerFileHeader
+{
+	uint32_t magic;
+
+	uint32_t version;
+
+	uint32_t vendor_id;
+
+	uint32_t device_id;
+
+	uint32_t driver_version;
+
+	uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+
+	uint32_t entry_count;
+};
+
+inline void fill_device_info(const Device &device, WorkgroupTunerFileHeader &header)
+{
+	auto &properties = device.get_properties();
+
+	header.vendor_id      = properties.vendorID;
+	header.device_id      = properties.deviceID;
+	header.driver_version = properties.driverVersion;
+
+	std::memcpy(header.pipeline_cache_uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+inline void write_u32(std::vector<uint8_t> &data, uint32_t value)
+{
+	auto bytes = reinterpret_cast<const uint8_t *>(&value);
+	data.insert(data.end(), bytes, bytes + sizeof(value));
+}
+
+inline bool read_u32(const std::vector<uint8_t> &data, size_t &offset, uint32_t &value)
+{
+	if (offset + sizeof(value) > data.size())
+	{
+		return false;
+	}
+
+	std::memcpy(&value, data.data() + offset, sizeof(value));
+	offset += sizeof(value);
+
+	return true;
+}
+
+float median(std::vector<float> times)
+{
+	auto middle = times.begin() + times.size() / 2;
+
+	std::nth_element(times.begin(), middle, times.end());
+
+	return *middle;
+}
+}        // namespace
+
+bool operator==(const WorkgroupSize &lhs, const WorkgroupSize &rhs)
+{
+	return lhs.x == rhs.x && lhs.y == rhs.y;
+}
+
+WorkgroupTuner::WorkgroupTuner(Device &device, const std::string &filename) :
+    device{device},
+    filename{filename}
+{
+	// The kernels may be dispatched on the async compute queue, every family running them must support timestamps
+	uint32_t queue_family_count{0};
+	vkGetPhysicalDeviceQueueFamilyProperties(device.get_physical_device(), &queue_family_count, nullptr);
+
+	std::vector<VkQueueFamilyProperties> queue_family_properties(queue_family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(device.get_physical_device(), &queue_family_count, queue_family_properties.data());
+
+	uint32_t valid_bits{64};
+
+	for (auto &properties : queue_family_properties)
+	{
+		if (properties.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+		{
+			valid_bits = std::min(valid_bits, properties.timestampValidBits);
+		}
+	}
+
+	if (valid_bits > 0)
+	{
+		timestamp_period = device.get_properties().limits.timestampPeriod;
+		timestamp_mask   = valid_bits >= 64 ? ~0ULL : (1ULL << valid_bits) - 1;
+	}
+}
+
+WorkgroupSize WorkgroupTuner::dispatch(CommandBuffer &command_buffer, const std::string &name, const std::vector<WorkgroupSize> &candidates,
+                                       uint32_t width, uint32_t height, uint32_t depth)
+{
+	std::lock_guard<std::mutex> lock{mutex};
+
+	// Read when the first kernel is dispatched, the temporary storage may not be set up with the device
+	if (!loaded)
+	{
+		load();
+		loaded = true;
+	}
+
+	auto it = kernels.find(name);
+
+	if (it == kernels.end())
+	{
+		auto &limits = device.get_properties().limits;
+
+		Kernel kernel;
+
+		for (auto &candidate : candidates)
+		{
+			if (candidate.x <= limits.maxComputeWorkGroupSize[0] && candidate.y <= limits.maxComputeWorkGroupSize[1] &&
+			    candidate.x * candidate.y <= limits.maxComputeWorkGroupInvocations)
+			{
+				kernel.candidates.push_back(candidate);
+			}
+		}
+
+		assert(!kernel.candidates.empty() && "No workgroup size within the limits of the device");
+
+		kernel.times.resize(kernel.candidates.size());
+		kernel.dispatch_counts.resize(kernel.candidates.size(), 0);
+		kernel.size  = kernel.candidates.front();
+		kernel.tuned = kernel.candidates.size() == 1;
+
+		// A size tuned by a previous run is only used if it is still a candidate
+		auto tuned_it = tuned_sizes.find(name);
+
+		if (tuned_it != tuned_sizes.end() &&
+		    std::find(kernel.candidates.begin(), kernel.candidates.end(), tuned_it->second) != kernel.candidates.end())
+		{
+			kernel.size  = tuned_it->second;
+			kernel.tuned = true;
+		}
+
+		it = kernels.emplace(name, std::move(kernel)).first;
+	}
+
+	auto &kernel = it->second;
+
+	WorkgroupSize size = kernel.size;
+
+	bool     timed{false};
+	uint32_t first_query{0};
+
+	if (!kernel.tuned && timestamp_period > 0.0f)
+	{
+		if (!query_pool)
+		{
+			VkQueryPoolCreateInfo create_info{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+			create_info.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+			create_info.queryCount = MAX_PENDING_DISPATCHES * 2;
+
+			query_pool = std::make_unique<QueryPool>(device, create_info);
+
+			for (uint32_t i = 0; i < MAX_PENDING_DISPATCHES; ++i)
+			{
+				free_queries.push_back(i * 2);
+			}
+		}
+
+		// The candidate timed the least so far, so that the candidates are interleaved over the frames
+		auto candidate = static_cast<uint32_t>(std::min_element(kernel.dispatch_counts.begin(), kernel.dispatch_counts.end()) - kernel.dispatch_counts.begin());
+
+		if (kernel.dispatch_counts[candidate] < SAMPLE_COUNT && !free_queries.empty())
+		{
+			size        = kernel.candidates[candidate];
+			timed       = true;
+			first_query = free_queries.back();
+			free_queries.pop_back();
+
+			++kernel.dispatch_counts[candidate];
+
+			// The timestamps are available once the frame has completed
+			device.get_deletion_queue().defer([this, name, candidate, first_query]() {
+				read_timestamps(name, candidate, first_query);
+			});
+		}
+	}
+
+	command_buffer.set_specialization_constant(SIZE_X_CONSTANT_ID, size.x);
+	command_buffer.set_specialization_constant(SIZE_Y_CONSTANT_ID, size.y);
+
+	if (timed)
+	{
+		command_buffer.reset_query_pool(*query_pool, first_query, 2);
+		command_buffer.write_timestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, *query_pool, first_query);
+	}
+
+	command_buffer.dispatch((width + size.x - 1) / size.x, (height + size.y - 1) / size.y, depth);
+
+	if (timed)
+	{
+		command_buffer.write_timestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, *query_pool, first_query + 1);
+	}
+
+	return size;
+}
+
+void WorkgroupTuner::reset()
+{
+	std::lock_guard<std::mutex> lock{mutex};
+
+	kernels.clear();
+	tuned_sizes.clear();
+
+	// Also forgets the sizes of a previous run not loaded yet
+	loaded = true;
+
+	save();
+}
+
+bool WorkgroupTuner::is_tuned(const std::string &name) const
+{
+	std::lock_guard<std::mutex> lock{mutex};
+
+	auto it = kernels.find(name);
+
+	return it != kernels.end() ? it->second.tuned : tuned_sizes.count(name) > 0;
+}
+
+void WorkgroupTuner::read_timestamps(const std::string &name, uint32_t candidate, uint32_t first_query)
+{
+	std::lock_guard<std::mutex> lock{mutex};
+
+	std::array<uint64_t, 2> timestamps{};
+
+	// Not ready if the command buffer was never submitted, when the device is destroyed
+	VkResult result = query_pool->get_results(first_query, 2, sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+	free_queries.push_back(first_query);
+
+	auto it = kernels.find(name);
+
+	// The kernel may have been tuned by the other dispatches, or reset
+	if (it == kernels.end() || it->second.tuned)
+	{
+		return;
+	}
+
+	auto &kernel = it->second;
+
+	// The candidate is timed again by a later dispatch
+	if (result != VK_SUCCESS)
+	{
+		--kernel.dispatch_counts[candidate];
+		return;
+	}
+
+	kernel.times[candidate].push_back(((timestamps[1] - timestamps[0]) & timestamp_mask) * timestamp_period);
+
+	bool all_timed = std::all_of(kernel.times.begin(), kernel.times.end(), [](const std::vector<float> &times) { return times.size() >= SAMPLE_COUNT; });
+
+	if (all_timed)
+	{
+		choose_size(name, kernel);
+	}
+}
+
+void WorkgroupTuner::choose_size(const std::string &name, Kernel &kernel)
+{
+	// The median ignores the dispatches slowed down by other work of the GPU
+	std::vector<float> medians;
+
+	for (auto &times : kernel.times)
+	{
+		medians.push_back(median(times));
+	}
+
+	auto fastest = std::min_element(medians.begin(), medians.end()) - medians.begin();
+
+	kernel.size  = kernel.candidates[fastest];
+	kernel.tuned = true;
+
+	tuned_sizes[name] = kernel.size;
+
+	LOGI("Workgroup size of {} tuned to {}x{}, {:.1f} us against {:.1f} us for {}x{}",
+	     name, kernel.size.x, kernel.size.y, medians[fastest] / 1000.0f, medians.front() / 1000.0f, kernel.candidates.front().x, kernel.candidates.front().y);
+
+	// Written once per kernel, the file is small
+	save();
+}
+
+void WorkgroupTuner::load()
+{
+	std::vector<uint8_t> data;
+
+	try
+	{
+		data = fs::read_temp_blob(filename);
+	}
+	catch (const std::runtime_error &)
+	{
+		// The kernels are tuned for the first time
+		return;
+	}
+
+	if (data.size() < sizeof(WorkgroupTunerFileHeader))
+	{
+		LOGW("Workgroup sizes file {} is too small, ignoring it", filename);
+		return;
+	}
+
+	WorkgroupTunerFileHeader file_header;
+	std::memcpy(&file_header, data.data(), sizeof(file_header));
+
+	WorkgroupTunerFileHeader device_header{};
+	fill_device_info(device, device_header);
+
+	if (file_header.magic != MAGIC || file_header.version != VERSION ||
+	    file_header.vendor_id != device_header.vendor_id ||
+	    file_header.device_id != device_header.device_id ||
+	    file_header.driver_version != device_header.driver_version ||
+	    std::memcmp(file_header.pipeline_cache_uuid, device_header.pipeline_cache_uuid, VK_UUID_SIZE) != 0)
+	{
+		LOGW("Workgroup sizes file {} was tuned for another device or driver, ignoring it", filename);
+		return;
+	}
+
+	size_t offset = sizeof(WorkgroupTunerFileHeader);
+
+	for (uint32_t i = 0; i < file_header.entry_count; ++i)
+	{
+		uint32_t      name_size{0};
+		WorkgroupSize size;
+
+		if (!read_u32(data, offset, name_size) || offset + name_size > data.size())
+		{
+			LOGW("Workgroup sizes file {} is truncated, ignoring the last sizes", filename);
+			return;
+		}
+
+		std::string name{reinterpret_cast<const char *>(data.data() + offset), name_size};
+		offset += name_size;
+
+		if (!read_u32(data, offset, size.x) || !read_u32(data, offset, size.y))
+		{
+			LOGW("Workgroup sizes file {} is truncated, ignoring the last sizes", filename);
+			return;
+		}
+
+		tuned_sizes[name] = size;
+	}
+}
+
+void WorkgroupTuner::save() const
+{
+	WorkgroupTunerFileHeader header{};
+	header.magic       = MAGIC;
+	header.version     = VERSION;
+	header.entry_count = to_u32(tuned_sizes.size());
+	fill_device_info(device, header);
+
+	std::vector<uint8_t> data(sizeof(header));
+	std::memcpy(data.data(), &header, sizeof(header));
+
+	for (auto &tuned_size : tuned_sizes)
+	{
+		write_u32(data, to_u32(tuned_size.first.size()));
+		data.insert(data.end(), tuned_size.first.begin(), tuned_size.first.end());
+		write_u32(data, tuned_size.second.x);
+		write_u32(data, tuned_size.second.y);
+	}
+
+	fs::write_temp_blob(data, filename);
+}
+}        // namespace vkb
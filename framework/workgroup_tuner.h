@@ -0,0 +1,178 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/vk_common.h"
+#include "core/query_pool.h"
+
+namespace vkb
+{
+class CommandBuffer;
+class Device;
+
+/**
+ * @brief Local size of a compute kernel, one dimension for buffers and two for images
+ */
+struct WorkgroupSize
+{
+	uint32_t x{1};
+
+	uint32_t y{1};
+};
+
+bool operator==(const WorkgroupSize &lhs, const WorkgroupSize &rhs);
+
+/**
+ * @brief Picks the fastest workgroup size of the compute kernels on the device, as it differs between GPUs.
+ *
+ * The kernels declare their local size as specialization constants, with the default size used until tuned:
+ *
+ *     layout(local_size_x_id = 0, local_size_y_id = 1) in;
+ *     layout(local_size_x = 8, local_size_y = 8) in;
+ *
+ * The first time a kernel is dispatched, the tuner cycles through its candidate sizes over the following
+ * dispatches, timing each with timestamp queries. They are read back through the deletion queue of the
+ * device once their frame has completed, without stalling. Once every candidate was timed SAMPLE_COUNT
+ * times the one with the lowest median is kept, and written to a file in temporary storage next to the
+ * pipeline cache. The file is only read back by the same device and driver, whose
+ * later runs dispatch the tuned sizes from their first frame.
+ */
+class WorkgroupTuner
+{
+  public:
+	static const uint32_t MAGIC = 0x47574B56;        // "VKWG"
+
+	static const uint32_t VERSION = 1;
+
+	/// Specialization constants of the local size, the kernels must not use them for anything else
+	static const uint32_t SIZE_X_CONSTANT_ID = 0;
+
+	static const uint32_t SIZE_Y_CONSTANT_ID = 1;
+
+	/// Timed dispatches of each candidate before a size is chosen
+	static const uint32_t SAMPLE_COUNT = 8;
+
+	/// Timed dispatches whose frames have not completed yet, the dispatches past it are not timed
+	static const uint32_t MAX_PENDING_DISPATCHES = 32;
+
+	/**
+	 * @param device The device the kernels are dispatched on, its queues created
+	 * @param filename The path to the file of the tuned sizes (relative to the temporary storage directory)
+	 */
+	WorkgroupTuner(Device &device, const std::string &filename = "workgroup_sizes.data");
+
+	WorkgroupTuner(const WorkgroupTuner &) = delete;
+
+	WorkgroupTuner(WorkgroupTuner &&) = delete;
+
+	WorkgroupTuner &operator=(const WorkgroupTuner &) = delete;
+
+	WorkgroupTuner &operator=(WorkgroupTuner &&) = delete;
+
+	/**
+	 * @brief Records a dispatch covering a number of invocations, with the workgroup size tuned for the kernel.
+	 *        Must be recorded outside a render pass in a command buffer of the current frame,
+	 *        with the pipeline layout of the kernel bound
+	 * @param command_buffer The command buffer to record to
+	 * @param name Name of the kernel, unique per shader and variant
+	 * @param candidates Sizes to choose from, the first one is dispatched until the kernel is tuned
+	 *        and if the device cannot time it. Sizes above the limits of the device are ignored
+	 * @param width Invocations along x, rounded up to a number of workgroups
+	 * @param height Invocations along y
+	 * @param depth Workgroups along z
+	 * @return The workgroup size dispatched
+	 */
+	WorkgroupSize dispatch(CommandBuffer &command_buffer, const std::string &name, const std::vector<WorkgroupSize> &candidates,
+	                       uint32_t width, uint32_t height = 1, uint32_t depth = 1);
+
+	/**
+	 * @brief Forgets the tuned sizes, the kernels are tuned again from their next dispatch
+	 */
+	void reset();
+
+	/**
+	 * @return Whether a size was chosen for the kernel, in this run or a previous one
+	 */
+	bool is_tuned(const std::string &name) const;
+
+  private:
+	struct Kernel
+	{
+		std::vector<WorkgroupSize> candidates;
+
+		/// GPU times of the dispatches of each candidate, in nanoseconds
+		std::vector<std::vector<float>> times;
+
+		/// Timed dispatches of each candidate, including the pending ones
+		std::vector<uint32_t> dispatch_counts;
+
+		bool tuned{false};
+
+		WorkgroupSize size;
+	};
+
+	/**
+	 * @brief Loads the sizes of a previous run, if it was on the same device and driver
+	 */
+	void load();
+
+	void save() const;
+
+	/**
+	 * @brief Reads back the timestamps of a dispatch once its frame has completed, and frees its queries
+	 */
+	void read_timestamps(const std::string &name, uint32_t candidate, uint32_t first_query);
+
+	/**
+	 * @brief Chooses the size of a kernel once all its candidates are timed
+	 */
+	void choose_size(const std::string &name, Kernel &kernel);
+
+	Device &device;
+
+	std::string filename;
+
+	bool loaded{false};
+
+	/// Nanoseconds per timestamp tick, zero if timestamps are not supported
+	float timestamp_period{0.0f};
+
+	uint64_t timestamp_mask{0};
+
+	std::unique_ptr<QueryPool> query_pool;
+
+	/// First query of the pairs not used by pending dispatches
+	std::vector<uint32_t> free_queries;
+
+	std::unordered_map<std::string, Kernel> kernels;
+
+	/// Sizes loaded from the file, applied to the kernels whose candidates include them
+	std::unordered_map<std::string, WorkgroupSize> tuned_sizes;
+
+	mutable std::mutex mutex;
+};
+}        // namespace vkb
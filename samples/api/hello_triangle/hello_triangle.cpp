@@ -20,11 +20,17 @@
 
 #include "hello_triangle.h"
 
+#include <cmath>
+#include <cstring>
+
 #include "common/logging.h"
 #include "common/vk_common.h"
+#include "core/instance.h"
 #include "glsl_compiler.h"
 #include "platform/filesystem.h"
 #include "platform/platform.h"
+#include "rendering/render_pipeline.h"
+#include "timer.h"
 
 #if defined(VKB_DEBUG) || defined(VKB_VALIDATION_LAYERS)
 /// @brief A debug callback called from Vulkan validation layers.
@@ -52,6 +58,29 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debug_callback(VkDebugReportFlagsEXT flags
 }
 #endif
 
+/**
+ * @brief Finds a memory type of the device with the required properties.
+ * @param gpu The physical device.
+ * @param type_bits The memory types allowed by the resource.
+ * @param properties The required memory properties.
+ * @returns The index of the memory type. Throws if none is found.
+ */
+static uint32_t find_memory_type(VkPhysicalDevice gpu, uint32_t type_bits, VkMemoryPropertyFlags properties)
+{
+	VkPhysicalDeviceMemoryProperties memory_properties;
+	vkGetPhysicalDeviceMemoryProperties(gpu, &memory_properties);
+
+	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+	{
+		if ((type_bits & (1u << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	throw std::runtime_error("No suitable memory type found.");
+}
+
 /**
  * @brief Validates a list of required extensions, comparing it with the available ones.
  *
@@ -350,6 +379,51 @@ void HelloTriangle::init_per_frame(Context &context, PerFrame &per_frame)
 	cmd_buf_info.commandBufferCount = 1;
 	VK_CHECK(vkAllocateCommandBuffers(context.device, &cmd_buf_info, &per_frame.primary_command_buffer));
 
+	if (context.stress_set_layout != VK_NULL_HANDLE)
+	{
+		// Each frame writes the uniforms of its draws to its own buffer, mapped once
+		VkBufferCreateInfo buffer_info{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+		buffer_info.size  = context.stress_stride * stress_draw_count;
+		buffer_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+		VK_CHECK(vkCreateBuffer(context.device, &buffer_info, nullptr, &per_frame.stress_buffer));
+
+		VkMemoryRequirements memory_requirements;
+		vkGetBufferMemoryRequirements(context.device, per_frame.stress_buffer, &memory_requirements);
+
+		VkMemoryAllocateInfo memory_info{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+		memory_info.allocationSize  = memory_requirements.size;
+		memory_info.memoryTypeIndex = find_memory_type(context.gpu, memory_requirements.memoryTypeBits,
+		                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		VK_CHECK(vkAllocateMemory(context.device, &memory_info, nullptr, &per_frame.stress_memory));
+		VK_CHECK(vkBindBufferMemory(context.device, per_frame.stress_buffer, per_frame.stress_memory, 0));
+		VK_CHECK(vkMapMemory(context.device, per_frame.stress_memory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void **>(&per_frame.stress_data)));
+
+		VkDescriptorPoolSize pool_size{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1};
+
+		VkDescriptorPoolCreateInfo pool_info{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+		pool_info.maxSets       = 1;
+		pool_info.poolSizeCount = 1;
+		pool_info.pPoolSizes    = &pool_size;
+		VK_CHECK(vkCreateDescriptorPool(context.device, &pool_info, nullptr, &per_frame.stress_descriptor_pool));
+
+		VkDescriptorSetAllocateInfo set_info{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+		set_info.descriptorPool     = per_frame.stress_descriptor_pool;
+		set_info.descriptorSetCount = 1;
+		set_info.pSetLayouts        = &context.stress_set_layout;
+		VK_CHECK(vkAllocateDescriptorSets(context.device, &set_info, &per_frame.stress_descriptor_set));
+
+		// The set is written once, the draws select their uniforms with a dynamic offset
+		VkDescriptorBufferInfo descriptor_buffer_info{per_frame.stress_buffer, 0, sizeof(StressUniform)};
+
+		VkWriteDescriptorSet write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+		write.dstSet          = per_frame.stress_descriptor_set;
+		write.dstBinding      = 0;
+		write.descriptorCount = 1;
+		write.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		write.pBufferInfo     = &descriptor_buffer_info;
+		vkUpdateDescriptorSets(context.device, 1, &write, 0, nullptr);
+	}
+
 	per_frame.device      = context.device;
 	per_frame.queue_index = context.graphics_queue_index;
 }
@@ -396,6 +470,29 @@ void HelloTriangle::teardown_per_frame(Context &context, PerFrame &per_frame)
 		per_frame.swapchain_release_semaphore = VK_NULL_HANDLE;
 	}
 
+	if (per_frame.stress_descriptor_pool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(context.device, per_frame.stress_descriptor_pool, nullptr);
+
+		per_frame.stress_descriptor_pool = VK_NULL_HANDLE;
+		per_frame.stress_descriptor_set  = VK_NULL_HANDLE;
+	}
+
+	if (per_frame.stress_buffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(context.device, per_frame.stress_buffer, nullptr);
+
+		per_frame.stress_buffer = VK_NULL_HANDLE;
+	}
+
+	if (per_frame.stress_memory != VK_NULL_HANDLE)
+	{
+		vkFreeMemory(context.device, per_frame.stress_memory, nullptr);
+
+		per_frame.stress_memory = VK_NULL_HANDLE;
+		per_frame.stress_data   = nullptr;
+	}
+
 	per_frame.device      = VK_NULL_HANDLE;
 	per_frame.queue_index = -1;
 }
@@ -684,8 +781,13 @@ VkShaderModule HelloTriangle::load_shader_module(Context &context, const char *p
 void HelloTriangle::init_pipeline(Context &context)
 {
 	// Create a blank pipeline layout.
-	// We are not binding any resources to the pipeline in this first sample.
+	// We are not binding any resources to the pipeline in this first sample, except for the uniforms of the stress mode.
 	VkPipelineLayoutCreateInfo layout_info{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+	if (context.stress_set_layout != VK_NULL_HANDLE)
+	{
+		layout_info.setLayoutCount = 1;
+		layout_info.pSetLayouts    = &context.stress_set_layout;
+	}
 	VK_CHECK(vkCreatePipelineLayout(context.device, &layout_info, nullptr, &context.pipeline_layout));
 
 	VkPipelineVertexInputStateCreateInfo vertex_input{VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
@@ -733,7 +835,7 @@ void HelloTriangle::init_pipeline(Context &context)
 	// Vertex stage of the pipeline
 	shader_stages[0].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shader_stages[0].stage  = VK_SHADER_STAGE_VERTEX_BIT;
-	shader_stages[0].module = load_shader_module(context, "triangle.vert");
+	shader_stages[0].module = load_shader_module(context, context.stress_set_layout != VK_NULL_HANDLE ? "hello_triangle/stress.vert" : "triangle.vert");
 	shader_stages[0].pName  = "main";
 
 	// Fragment stage of the pipeline
@@ -876,8 +978,32 @@ void HelloTriangle::render_triangle(Context &context, uint32_t swapchain_index)
 	// Set scissor dynamically
 	vkCmdSetScissor(cmd, 0, 1, &scissor);
 
-	// Draw three vertices with one instance.
-	vkCmdDraw(cmd, 3, 1, 0, 0);
+	if (stress_draw_count > 0)
+	{
+		auto &per_frame = context.per_frame[swapchain_index];
+
+		vkb::Timer timer;
+		timer.start();
+
+		for (uint32_t i = 0; i < stress_draw_count; i++)
+		{
+			uint32_t offset = vkb::to_u32(context.stress_stride * i);
+
+			auto uniform = get_stress_uniform(i);
+			memcpy(per_frame.stress_data + offset, &uniform, sizeof(uniform));
+
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, context.pipeline_layout, 0, 1, &per_frame.stress_descriptor_set, 1, &offset);
+
+			vkCmdDraw(cmd, 3, 1, 0, 0);
+		}
+
+		stress_stats.frame_record_time = timer.stop<vkb::Timer::Nanoseconds>();
+	}
+	else
+	{
+		// Draw three vertices with one instance.
+		vkCmdDraw(cmd, 3, 1, 0, 0);
+	}
 
 	// Complete render pass.
 	vkCmdEndRenderPass(cmd);
@@ -1002,6 +1128,11 @@ void HelloTriangle::teardown(Context &context)
 		vkDestroyPipelineLayout(context.device, context.pipeline_layout, nullptr);
 	}
 
+	if (context.stress_set_layout != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorSetLayout(context.device, context.stress_set_layout, nullptr);
+	}
+
 	if (context.render_pass != VK_NULL_HANDLE)
 	{
 		vkDestroyRenderPass(context.device, context.render_pass, nullptr);
@@ -1049,17 +1180,42 @@ HelloTriangle::HelloTriangle()
 
 HelloTriangle::~HelloTriangle()
 {
-	teardown(context);
+	if (framework.device)
+	{
+		teardown_framework();
+	}
+	else
+	{
+		teardown(context);
+	}
+}
+
+void HelloTriangle::set_stress_mode(uint32_t draw_count, bool use_framework)
+{
+	stress_draw_count = draw_count;
+	stress_framework  = use_framework && draw_count > 0;
 }
 
 bool HelloTriangle::prepare(vkb::Platform &platform)
 {
+	if (stress_framework)
+	{
+		prepare_framework(platform);
+
+		return true;
+	}
+
 	init_instance(context, {VK_KHR_SURFACE_EXTENSION_NAME}, {});
 
 	context.surface = platform.get_window().create_surface(context.instance);
 
 	init_device(context, {"VK_KHR_swapchain"});
 
+	if (stress_draw_count > 0)
+	{
+		init_stress(context);
+	}
+
 	init_swapchain(context);
 
 	// Create the necessary objects for rendering.
@@ -1072,6 +1228,15 @@ bool HelloTriangle::prepare(vkb::Platform &platform)
 
 void HelloTriangle::update(float delta_time)
 {
+	if (stress_framework)
+	{
+		render_framework();
+
+		update_stress_stats(delta_time);
+
+		return;
+	}
+
 	uint32_t index;
 
 	auto res = acquire_next_image(context, &index);
@@ -1105,6 +1270,11 @@ void HelloTriangle::update(float delta_time)
 	{
 		LOGE("Failed to present swapchain image.");
 	}
+
+	if (stress_draw_count > 0)
+	{
+		update_stress_stats(delta_time);
+	}
 }
 
 void HelloTriangle::resize(const uint32_t width, const uint32_t height)
@@ -1119,6 +1289,231 @@ void HelloTriangle::resize(const uint32_t width, const uint32_t height)
 	}
 }
 
+/**
+ * @brief Initializes the descriptor set layout of the stress uniforms, before the per-frame buffers are created.
+ * @param context A Vulkan context with a device already set up.
+ */
+void HelloTriangle::init_stress(Context &context)
+{
+	LOGI("Drawing {} triangles per frame with raw Vulkan.", stress_draw_count);
+
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding         = 0;
+	binding.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	binding.descriptorCount = 1;
+	binding.stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layout_info{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+	layout_info.bindingCount = 1;
+	layout_info.pBindings    = &binding;
+	VK_CHECK(vkCreateDescriptorSetLayout(context.device, &layout_info, nullptr, &context.stress_set_layout));
+
+	// The dynamic offsets of the draws must be multiples of the alignment of the device
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(context.gpu, &properties);
+
+	auto alignment = properties.limits.minUniformBufferOffsetAlignment;
+
+	context.stress_stride = (sizeof(StressUniform) + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * @brief Initializes the framework objects drawing the stress mode, as a VulkanSample would.
+ * @param platform The platform providing the window.
+ */
+void HelloTriangle::prepare_framework(vkb::Platform &platform)
+{
+	LOGI("Drawing {} triangles per frame through the framework.", stress_draw_count);
+
+	framework.instance = std::make_unique<vkb::Instance>(get_name(), std::vector<const char *>{platform.get_surface_extension()});
+
+	framework.surface = platform.get_window().create_surface(framework.instance->get_handle());
+
+	framework.device = std::make_unique<vkb::Device>(framework.instance->get_gpu(), framework.surface, std::vector<const char *>{VK_KHR_SWAPCHAIN_EXTENSION_NAME});
+
+	framework.render_context = std::make_unique<vkb::RenderContext>(*framework.device, framework.surface, platform.get_window().get_width(), platform.get_window().get_height());
+	framework.render_context->prepare();
+
+	std::vector<std::unique_ptr<vkb::Subpass>> subpasses;
+	subpasses.push_back(std::make_unique<StressSubpass>(*framework.render_context, *this));
+
+	framework.render_pipeline = std::make_unique<vkb::RenderPipeline>(std::move(subpasses));
+}
+
+/**
+ * @brief Renders the stress draws of a frame through the framework.
+ */
+void HelloTriangle::render_framework()
+{
+	auto &render_context = *framework.render_context;
+
+	auto &command_buffer = render_context.begin();
+
+	command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	auto &render_target = render_context.get_active_frame().get_render_target();
+	auto &views         = render_target.get_views();
+
+	{
+		// Image 0 is the swapchain
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		memory_barrier.src_access_mask = 0;
+		memory_barrier.dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+		command_buffer.image_memory_barrier(views.at(0), memory_barrier);
+	}
+
+	{
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		memory_barrier.src_access_mask = 0;
+		memory_barrier.dst_access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+		command_buffer.image_memory_barrier(views.at(1), memory_barrier);
+	}
+
+	auto &extent = render_target.get_extent();
+
+	VkViewport viewport{};
+	viewport.width    = static_cast<float>(extent.width);
+	viewport.height   = static_cast<float>(extent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	command_buffer.set_viewport(0, {viewport});
+
+	VkRect2D scissor{};
+	scissor.extent = extent;
+	command_buffer.set_scissor(0, {scissor});
+
+	framework.render_pipeline->draw(command_buffer, render_target);
+
+	command_buffer.end_render_pass();
+
+	{
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		memory_barrier.new_layout      = render_context.get_present_layout();
+		memory_barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+		command_buffer.image_memory_barrier(views.at(0), memory_barrier);
+	}
+
+	command_buffer.end();
+
+	render_context.submit(command_buffer);
+}
+
+/**
+ * @brief Tears down the framework objects, in the order a VulkanSample does.
+ */
+void HelloTriangle::teardown_framework()
+{
+	framework.device->wait_idle();
+
+	framework.render_pipeline.reset();
+	framework.render_context.reset();
+	framework.device.reset();
+
+	if (framework.surface != VK_NULL_HANDLE)
+	{
+		vkDestroySurfaceKHR(framework.instance->get_handle(), framework.surface, nullptr);
+		framework.surface = VK_NULL_HANDLE;
+	}
+
+	framework.instance.reset();
+}
+
+HelloTriangle::StressUniform HelloTriangle::get_stress_uniform(uint32_t draw_index) const
+{
+	// The draws tile the screen in a grid, each triangle scaled to its cell
+	auto columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(stress_draw_count))));
+	auto cell    = 2.0f / static_cast<float>(columns);
+
+	StressUniform uniform{};
+	uniform.offset_scale[0] = -1.0f + cell * (static_cast<float>(draw_index % columns) + 0.5f);
+	uniform.offset_scale[1] = -1.0f + cell * (static_cast<float>(draw_index / columns) + 0.5f);
+	uniform.offset_scale[2] = cell;
+
+	return uniform;
+}
+
+void HelloTriangle::update_stress_stats(float delta_time)
+{
+	stress_stats.record_time += stress_stats.frame_record_time;
+	stress_stats.draw_count += stress_draw_count;
+	stress_stats.elapsed_time += delta_time;
+
+	if (stress_stats.elapsed_time >= 1.0f)
+	{
+		LOGI("{} draws per frame: {:.1f} ns per draw ({})", stress_draw_count, stress_stats.record_time / static_cast<double>(stress_stats.draw_count),
+		     stress_framework ? "framework" : "raw Vulkan");
+
+		stress_stats = {};
+	}
+}
+
+HelloTriangle::StressSubpass::StressSubpass(vkb::RenderContext &render_context, HelloTriangle &sample) :
+    vkb::Subpass{render_context, vkb::ShaderSource{"hello_triangle/stress.vert"}, vkb::ShaderSource{"triangle.frag"}},
+    sample{sample}
+{
+	// The triangles are not depth tested, as in the raw Vulkan pipeline
+	auto &depth_stencil_state              = get_depth_stencil_state();
+	depth_stencil_state.depth_test_enable  = VK_FALSE;
+	depth_stencil_state.depth_write_enable = VK_FALSE;
+
+	// The uniforms are bound with dynamic offsets into the buffer of the pool, as in the raw Vulkan draws
+	set_use_dynamic_resources(true);
+}
+
+void HelloTriangle::StressSubpass::prepare()
+{
+	auto &resource_cache = render_context.get_device().get_resource_cache();
+	resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader());
+	resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader());
+}
+
+void HelloTriangle::StressSubpass::draw(vkb::CommandBuffer &command_buffer)
+{
+	auto &resource_cache     = command_buffer.get_device().get_resource_cache();
+	auto &vert_shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader());
+	auto &frag_shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader());
+
+	std::vector<vkb::ShaderModule *> shader_modules{&vert_shader_module, &frag_shader_module};
+
+	command_buffer.bind_pipeline_layout(resource_cache.request_pipeline_layout(shader_modules, use_dynamic_resources));
+
+	vkb::RasterizationState rasterization_state;
+	rasterization_state.cull_mode  = VK_CULL_MODE_BACK_BIT;
+	rasterization_state.front_face = VK_FRONT_FACE_CLOCKWISE;
+	command_buffer.set_rasterization_state(rasterization_state);
+
+	auto &render_frame = render_context.get_active_frame();
+
+	vkb::Timer timer;
+	timer.start();
+
+	for (uint32_t i = 0; i < sample.stress_draw_count; i++)
+	{
+		auto allocation = render_frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(StressUniform));
+		allocation.update(sample.get_stress_uniform(i));
+
+		command_buffer.bind_buffer(allocation.get_buffer(), allocation.get_offset(), allocation.get_size(), 0, 0, 0);
+
+		command_buffer.draw(3, 1, 0, 0);
+	}
+
+	sample.stress_stats.frame_record_time = timer.stop<vkb::Timer::Nanoseconds>();
+}
+
 std::unique_ptr<vkb::Application> create_hello_triangle()
 {
 	return std::make_unique<HelloTriangle>();
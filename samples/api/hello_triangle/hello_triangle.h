@@ -22,6 +22,13 @@
 
 #include "common/vk_common.h"
 #include "platform/application.h"
+#include "rendering/subpass.h"
+
+namespace vkb
+{
+class Instance;
+class RenderPipeline;
+}        // namespace vkb
 
 /**
  * @brief A self-contained (minimal use of framework) sample that illustrates
@@ -61,6 +68,19 @@ class HelloTriangle : public vkb::Application
 
 		VkSemaphore swapchain_release_semaphore = VK_NULL_HANDLE;
 
+		/// The uniform buffer of the stress draws, one aligned element per draw.
+		VkBuffer stress_buffer = VK_NULL_HANDLE;
+
+		VkDeviceMemory stress_memory = VK_NULL_HANDLE;
+
+		/// The persistently mapped stress uniforms.
+		uint8_t *stress_data = nullptr;
+
+		VkDescriptorPool stress_descriptor_pool = VK_NULL_HANDLE;
+
+		/// Binds the stress uniform buffer, offset per draw.
+		VkDescriptorSet stress_descriptor_set = VK_NULL_HANDLE;
+
 		int32_t queue_index;
 	};
 
@@ -111,6 +131,12 @@ class HelloTriangle : public vkb::Application
 		 */
 		VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
 
+		/// The layout of the dynamic uniform buffer of the stress draws.
+		VkDescriptorSetLayout stress_set_layout = VK_NULL_HANDLE;
+
+		/// The size of the uniforms of a stress draw, aligned to the dynamic offset alignment.
+		VkDeviceSize stress_stride = 0;
+
 		/// The debug report callback.
 		VkDebugReportCallbackEXT debug_callback = VK_NULL_HANDLE;
 
@@ -121,7 +147,65 @@ class HelloTriangle : public vkb::Application
 		std::vector<PerFrame> per_frame;
 	};
 
+	/**
+	 * @brief The uniforms of a stress draw
+	 */
+	struct StressUniform
+	{
+		/// Offset of the triangle in clip space in xy, its scale in z.
+		float offset_scale[4];
+	};
+
+	/**
+	 * @brief CPU time spent recording the stress draws, logged once per second
+	 */
+	struct StressStats
+	{
+		/// Nanoseconds spent recording the draws of the current frame.
+		double frame_record_time = 0.0;
+
+		/// Nanoseconds spent recording the draws since the last log.
+		double record_time = 0.0;
+
+		uint64_t draw_count = 0;
+
+		float elapsed_time = 0.0f;
+	};
+
+	/**
+	 * @brief Framework objects drawing the stress mode through the framework, used instead of the context
+	 */
+	struct FrameworkContext
+	{
+		std::unique_ptr<vkb::Instance> instance;
+
+		VkSurfaceKHR surface = VK_NULL_HANDLE;
+
+		std::unique_ptr<vkb::Device> device;
+
+		std::unique_ptr<vkb::RenderContext> render_context;
+
+		std::unique_ptr<vkb::RenderPipeline> render_pipeline;
+	};
+
   public:
+	/**
+	 * @brief Records the stress draws through the framework, each with its uniforms allocated
+	 *        from the buffer pool of the frame and bound by the command buffer
+	 */
+	class StressSubpass : public vkb::Subpass
+	{
+	  public:
+		StressSubpass(vkb::RenderContext &render_context, HelloTriangle &sample);
+
+		virtual void prepare() override;
+
+		virtual void draw(vkb::CommandBuffer &command_buffer) override;
+
+	  private:
+		HelloTriangle &sample;
+	};
+
 	HelloTriangle();
 
 	virtual ~HelloTriangle();
@@ -171,8 +255,42 @@ class HelloTriangle : public vkb::Application
 
 	void teardown(Context &context);
 
+	/**
+	 * @brief Draws N triangles per frame instead of one, from 1k to 100k, logging the CPU time per draw
+	 *        to measure the overhead of recording a draw. Must be set before prepare()
+	 * @param draw_count The draws per frame, zero to draw a single triangle
+	 * @param use_framework Whether to record the draws through the framework rather than raw Vulkan
+	 */
+	void set_stress_mode(uint32_t draw_count, bool use_framework);
+
   private:
+	void init_stress(Context &context);
+
+	void prepare_framework(vkb::Platform &platform);
+
+	void render_framework();
+
+	void teardown_framework();
+
+	/**
+	 * @return The uniforms of a stress draw, the draws tiling the screen
+	 */
+	StressUniform get_stress_uniform(uint32_t draw_index) const;
+
+	/**
+	 * @brief Adds the CPU time of the stress draws of the frame, logged once per second
+	 */
+	void update_stress_stats(float delta_time);
+
 	Context context;
+
+	FrameworkContext framework;
+
+	uint32_t stress_draw_count = 0;
+
+	bool stress_framework = false;
+
+	StressStats stress_stats;
 };
 
 std::unique_ptr<vkb::Application> create_hello_triangle();
@@ -0,0 +1,208 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cascaded_shadows.h"
+
+#include "common/vk_common.h"
+#include "gltf_loader.h"
+#include "gui.h"
+#include "platform/filesystem.h"
+#include "platform/platform.h"
+#include "rendering/subpasses/geometry_subpass.h"
+#include "rendering/subpasses/lighting_subpass.h"
+#include "scene_graph/components/light.h"
+#include "stats.h"
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+#	include "platform/android/android_platform.h"
+#endif
+
+namespace
+{
+const uint32_t resolutions[] = {512, 1024, 2048};
+}        // namespace
+
+CascadedShadows::CascadedShadows()
+{
+	auto &config = get_configuration();
+
+	config.insert<vkb::BoolSetting>(0, cache_cascades, true);
+	config.insert<vkb::BoolSetting>(1, cache_cascades, false);
+}
+
+vkb::RenderTarget CascadedShadows::create_render_target(vkb::core::Image &&swapchain_image)
+{
+	auto &device = swapchain_image.get_device();
+	auto &extent = swapchain_image.get_extent();
+
+	// The G-buffer is only needed in tile memory, between the geometry and lighting subpasses, transient images are lazily allocated
+	vkb::core::Image depth_image{device,
+	                             extent,
+	                             device.get_depth_format(),
+	                             VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+	                             VMA_MEMORY_USAGE_GPU_ONLY};
+
+	vkb::core::Image albedo_image{device,
+	                              extent,
+	                              VK_FORMAT_R8G8B8A8_UNORM,
+	                              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+	                              VMA_MEMORY_USAGE_GPU_ONLY};
+
+	vkb::core::Image normal_image{device,
+	                              extent,
+	                              VK_FORMAT_A2B10G10R10_UNORM_PACK32,
+	                              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+	                              VMA_MEMORY_USAGE_GPU_ONLY};
+
+	std::vector<vkb::core::Image> images;
+	images.push_back(std::move(swapchain_image));
+	images.push_back(std::move(depth_image));
+	images.push_back(std::move(albedo_image));
+	images.push_back(std::move(normal_image));
+
+	return vkb::RenderTarget{std::move(images)};
+}
+
+void CascadedShadows::prepare_render_context()
+{
+	get_render_context().prepare(1, std::bind(&CascadedShadows::create_render_target, this, std::placeholders::_1));
+}
+
+bool CascadedShadows::prepare(vkb::Platform &platform)
+{
+	if (!VulkanSample::prepare(platform))
+	{
+		return false;
+	}
+
+	load_scene("scenes/sponza/Sponza01.gltf");
+
+	// A single sun casting the shadows
+	scene->clear_components<vkb::sg::Light>();
+
+	vkb::sg::LightProperties props;
+	props.intensity = 2.0f;
+
+	light = &vkb::add_directional_light(*scene, glm::quat({glm::radians(-60.0f), 0.0f, glm::radians(20.0f)}), props);
+
+	auto &camera_node = vkb::add_free_camera(*scene, "main_camera", get_render_context().get_surface_extent());
+	camera            = &camera_node.get_component<vkb::sg::Camera>();
+
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times,
+	                                                              vkb::StatIndex::gpu_time,
+	                                                              vkb::StatIndex::vertex_compute_cycles});
+	gui   = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
+
+	update_pipeline();
+
+	return true;
+}
+
+void CascadedShadows::update_pipeline()
+{
+	last_resolution     = resolution;
+	last_cascade_count  = cascade_count;
+	last_cache_cascades = cache_cascades;
+
+	// The shadow map of the frames in flight is replaced
+	get_device().wait_idle();
+
+	vkb::ShadowOptions options;
+	options.resolution           = resolutions[resolution];
+	options.cascade_count        = static_cast<uint32_t>(cascade_count);
+	options.first_cached_cascade = cache_cascades ? options.cascade_count / 2 : options.cascade_count;
+
+	shadow_map = std::make_unique<vkb::ShadowMap>(get_render_context(), *scene, *camera, *light, options);
+
+	auto geometry_vs   = vkb::ShaderSource{"deferred/geometry.vert"};
+	auto geometry_fs   = vkb::ShaderSource{"deferred/geometry.frag"};
+	auto scene_subpass = std::make_unique<vkb::GeometrySubpass>(get_render_context(), std::move(geometry_vs), std::move(geometry_fs), *scene, *camera);
+	scene_subpass->set_output_attachments({1, 2, 3});
+
+	auto lighting_vs      = vkb::ShaderSource{"deferred/lighting.vert"};
+	auto lighting_fs      = vkb::ShaderSource{"deferred/lighting.frag"};
+	auto lighting_subpass = std::make_unique<vkb::LightingSubpass>(get_render_context(), std::move(lighting_vs), std::move(lighting_fs), *camera, *scene);
+	lighting_subpass->set_input_attachments({1, 2, 3});
+	lighting_subpass->set_shadow_map(shadow_map.get());
+
+	auto render_pipeline = vkb::RenderPipeline();
+	render_pipeline.add_subpass(std::move(scene_subpass));
+	render_pipeline.add_subpass(std::move(lighting_subpass));
+
+	render_pipeline.set_load_store(vkb::gbuffer::get_clear_all_store_swapchain());
+	render_pipeline.set_clear_value(vkb::gbuffer::get_clear_value());
+
+	set_render_pipeline(std::move(render_pipeline));
+}
+
+void CascadedShadows::update(float delta_time)
+{
+	if (resolution != last_resolution || cascade_count != last_cascade_count || cache_cascades != last_cache_cascades)
+	{
+		LOGI("Recreating shadow map");
+		update_pipeline();
+	}
+
+	VulkanSample::update(delta_time);
+}
+
+void CascadedShadows::draw_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target)
+{
+	// The cascades are rendered in their own render pass, before the lighting samples them
+	shadow_map->draw(command_buffer);
+
+	VulkanSample::draw_renderpass(command_buffer, render_target);
+}
+
+void CascadedShadows::draw_gui()
+{
+	auto &cascades = shadow_map->get_subpass().get_cascades();
+
+	gui->show_options_window(
+	    /* body = */ [this, &cascades]() {
+		    ImGui::Text("Resolution: ");
+		    ImGui::SameLine();
+		    ImGui::RadioButton("512", &resolution, 0);
+		    ImGui::SameLine();
+		    ImGui::RadioButton("1024", &resolution, 1);
+		    ImGui::SameLine();
+		    ImGui::RadioButton("2048", &resolution, 2);
+
+		    ImGui::SliderInt("Cascades", &cascade_count, 1, MAX_SHADOW_CASCADE_COUNT);
+		    ImGui::SameLine();
+		    ImGui::Checkbox("Cache distant cascades", &cache_cascades);
+
+		    for (size_t i = 0; i < cascades.size(); ++i)
+		    {
+			    ImGui::Text("Cascade %zu: %s, %u casters", i, cascades[i].rendered ? "rendered" : "cached", cascades[i].caster_count);
+
+			    if (i % 2 == 0 && i + 1 < cascades.size())
+			    {
+				    ImGui::SameLine();
+			    }
+		    }
+	    },
+	    /* lines = */ vkb::to_u32(2 + (cascades.size() + 1) / 2));
+}
+
+std::unique_ptr<vkb::VulkanSample> create_cascaded_shadows()
+{
+	return std::make_unique<CascadedShadows>();
+}
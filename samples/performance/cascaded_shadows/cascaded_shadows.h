@@ -0,0 +1,77 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "rendering/render_pipeline.h"
+#include "rendering/shadow_map.h"
+#include "scene_graph/components/camera.h"
+#include "vulkan_sample.h"
+
+/**
+ * @brief Deferred rendering of a scene lit by a directional light with cascaded shadow maps,
+ *        the distant cascades being optionally cached across frames
+ */
+class CascadedShadows : public vkb::VulkanSample
+{
+  public:
+	CascadedShadows();
+
+	virtual ~CascadedShadows() = default;
+
+	virtual bool prepare(vkb::Platform &platform) override;
+
+	virtual void update(float delta_time) override;
+
+  private:
+	virtual void prepare_render_context() override;
+
+	vkb::RenderTarget create_render_target(vkb::core::Image &&swapchain_image);
+
+	/**
+	 * @brief Recreates the shadow map and the render pipeline from the selected options
+	 */
+	void update_pipeline();
+
+	virtual void draw_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target) override;
+
+	virtual void draw_gui() override;
+
+	vkb::sg::Camera *camera{nullptr};
+
+	vkb::sg::Light *light{nullptr};
+
+	std::unique_ptr<vkb::ShadowMap> shadow_map;
+
+	/// Selected resolution of the cascades, 0 for 512, 1 for 1024 and 2 for 2048
+	int resolution{1};
+
+	int cascade_count{4};
+
+	bool cache_cascades{true};
+
+	int last_resolution{-1};
+
+	int last_cascade_count{-1};
+
+	bool last_cache_cascades{true};
+};
+
+std::unique_ptr<vkb::VulkanSample> create_cascaded_shadows();
@@ -24,8 +24,11 @@
 #include <numeric>
 
 #include "core/device.h"
+#include "core/framebuffer.h"
 #include "core/pipeline_layout.h"
+#include "core/render_pass.h"
 #include "core/shader_module.h"
+#include "cpu_topology.h"
 #include "gltf_loader.h"
 #include "gui.h"
 #include "platform/filesystem.h"
@@ -39,18 +42,27 @@ CommandBufferUsage::CommandBufferUsage()
 	config.insert<vkb::IntSetting>(0, gui_secondary_cmd_buf_count, 0);
 	config.insert<vkb::BoolSetting>(0, gui_multi_threading, false);
 	config.insert<vkb::IntSetting>(0, gui_command_buffer_reset_mode, 0);
+	config.insert<vkb::BoolSetting>(0, gui_reuse_command_buffers, false);
 
 	config.insert<vkb::IntSetting>(1, gui_secondary_cmd_buf_count, 2);
 	config.insert<vkb::BoolSetting>(1, gui_multi_threading, true);
 	config.insert<vkb::IntSetting>(1, gui_command_buffer_reset_mode, 0);
+	config.insert<vkb::BoolSetting>(1, gui_reuse_command_buffers, false);
 
 	config.insert<vkb::IntSetting>(2, gui_secondary_cmd_buf_count, 2);
 	config.insert<vkb::BoolSetting>(2, gui_multi_threading, true);
 	config.insert<vkb::IntSetting>(2, gui_command_buffer_reset_mode, 1);
+	config.insert<vkb::BoolSetting>(2, gui_reuse_command_buffers, false);
 
 	config.insert<vkb::IntSetting>(3, gui_secondary_cmd_buf_count, 2);
 	config.insert<vkb::BoolSetting>(3, gui_multi_threading, true);
 	config.insert<vkb::IntSetting>(3, gui_command_buffer_reset_mode, 2);
+	config.insert<vkb::BoolSetting>(3, gui_reuse_command_buffers, false);
+
+	config.insert<vkb::IntSetting>(4, gui_secondary_cmd_buf_count, 2);
+	config.insert<vkb::BoolSetting>(4, gui_multi_threading, true);
+	config.insert<vkb::IntSetting>(4, gui_command_buffer_reset_mode, 0);
+	config.insert<vkb::BoolSetting>(4, gui_reuse_command_buffers, true);
 }
 
 bool CommandBufferUsage::prepare(vkb::Platform &platform)
@@ -74,9 +86,12 @@ bool CommandBufferUsage::prepare(vkb::Platform &platform)
 
 	set_render_pipeline(std::move(render_pipeline));
 
-	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times, vkb::StatIndex::cpu_cycles});
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times, vkb::StatIndex::cpu_cycles,
+	                                                               vkb::StatIndex::command_pool_reset_time, vkb::StatIndex::command_buffer_allocation_time});
 	gui   = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
 
+	static_cast<ForwardSubpassSecondary *>(render_pipeline->get_active_subpass().get())->set_gui(gui.get());
+
 	// Adjust the maximum number of secondary command buffers
 	// In this sample, only the recording of opaque meshes will be multi-threaded
 	auto is_opaque = [](vkb::sg::SubMesh *sub_mesh) {
@@ -118,6 +133,8 @@ void CommandBufferUsage::update(float delta_time)
 
 	subpass_state.multi_threading = gui_multi_threading;
 
+	subpass_state.reuse_command_buffers = gui_reuse_command_buffers;
+
 	update_scene(delta_time);
 
 	update_stats(delta_time);
@@ -132,6 +149,8 @@ void CommandBufferUsage::update(float delta_time)
 
 	draw(primary_command_buffer, render_context.get_active_frame().get_render_target());
 
+	record_frame_capture(primary_command_buffer);
+
 	primary_command_buffer.end();
 
 	render_context.submit(primary_command_buffer);
@@ -140,7 +159,7 @@ void CommandBufferUsage::update(float delta_time)
 void CommandBufferUsage::draw_gui()
 {
 	const bool landscape = camera->get_aspect_ratio() > 1.0f;
-	uint32_t   lines     = landscape ? 3 : 5;
+	uint32_t   lines     = landscape ? 4 : 7;
 
 	const auto &subpass = static_cast<ForwardSubpassSecondary *>(render_pipeline->get_active_subpass().get());
 
@@ -169,6 +188,16 @@ void CommandBufferUsage::draw_gui()
 			    ImGui::SameLine();
 		    }
 		    ImGui::RadioButton("Reset pool", &gui_command_buffer_reset_mode, static_cast<int>(vkb::CommandBuffer::ResetMode::ResetPool));
+		    if (landscape)
+		    {
+			    ImGui::SameLine();
+		    }
+		    ImGui::RadioButton("Adaptive", &gui_command_buffer_reset_mode, static_cast<int>(vkb::CommandBuffer::ResetMode::Adaptive));
+
+		    // Reuse of the opaque draws (no effect if 0 secondary command buffers)
+		    ImGui::Checkbox("Reuse buffers", &gui_reuse_command_buffers);
+		    ImGui::SameLine();
+		    ImGui::Text("(%s)", subpass->is_reusing_command_buffers() ? "reused" : "recorded");
 	    },
 	    /* lines = */ lines);
 }
@@ -193,7 +222,7 @@ void CommandBufferUsage::render(vkb::CommandBuffer &primary_command_buffer)
 void CommandBufferUsage::draw_renderpass(vkb::CommandBuffer &primary_command_buffer, vkb::RenderTarget &render_target)
 {
 	const auto &subpass = static_cast<ForwardSubpassSecondary *>(render_pipeline->get_active_subpass().get());
-	auto &      extent  = render_target.get_extent();
+	auto &      extent  = render_target.get_render_extent();
 
 	VkViewport viewport{};
 	viewport.width    = static_cast<float>(extent.width);
@@ -210,31 +239,10 @@ void CommandBufferUsage::draw_renderpass(vkb::CommandBuffer &primary_command_buf
 
 	render(primary_command_buffer);
 
-	// Draw gui
-	if (gui)
+	// With secondary command buffers the subpass draws the gui after the meshes
+	if (gui && !use_secondary_command_buffers)
 	{
-		if (use_secondary_command_buffers)
-		{
-			const auto &queue = device->get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
-
-			auto &secondary_command_buffer = get_render_context().get_active_frame().request_command_buffer(queue, subpass->get_state().command_buffer_reset_mode, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
-
-			secondary_command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &primary_command_buffer);
-
-			secondary_command_buffer.set_viewport(0, {viewport});
-
-			secondary_command_buffer.set_scissor(0, {scissor});
-
-			gui->draw(secondary_command_buffer);
-
-			secondary_command_buffer.end();
-
-			primary_command_buffer.execute_commands(secondary_command_buffer);
-		}
-		else
-		{
-			gui->draw(primary_command_buffer);
-		}
+		gui->draw(primary_command_buffer);
 	}
 
 	primary_command_buffer.end_render_pass();
@@ -246,26 +254,21 @@ CommandBufferUsage::ForwardSubpassSecondary::ForwardSubpassSecondary(vkb::Render
 {
 }
 
-void CommandBufferUsage::ForwardSubpassSecondary::record_draw(vkb::CommandBuffer &                                               command_buffer,
-                                                              const std::vector<std::pair<vkb::sg::Node *, vkb::sg::SubMesh *>> &nodes,
+void CommandBufferUsage::ForwardSubpassSecondary::record_draw(vkb::CommandBuffer &              command_buffer,
+                                                              const std::vector<vkb::DrawItem> &items,
                                                               uint32_t mesh_start, uint32_t mesh_end, size_t thread_index)
 {
 	command_buffer.set_color_blend_state(color_blend_state);
 
 	command_buffer.set_depth_stencil_state(get_depth_stencil_state());
 
-	command_buffer.bind_buffer(light_buffer.get_buffer(), light_buffer.get_offset(), light_buffer.get_size(), 0, 4, 0);
+	light_clusters.bind(command_buffer, 0, 4);
 
-	for (uint32_t i = mesh_start; i < mesh_end; i++)
-	{
-		update_uniform(command_buffer, *nodes.at(i).first, thread_index);
-
-		draw_submesh(command_buffer, *nodes.at(i).second);
-	}
+	draw_items(command_buffer, items, mesh_start, mesh_end, thread_index);
 }
 
-vkb::CommandBuffer *CommandBufferUsage::ForwardSubpassSecondary::record_draw_secondary(vkb::CommandBuffer &                                               primary_command_buffer,
-                                                                                       const std::vector<std::pair<vkb::sg::Node *, vkb::sg::SubMesh *>> &nodes,
+vkb::CommandBuffer *CommandBufferUsage::ForwardSubpassSecondary::record_draw_secondary(vkb::CommandBuffer &              primary_command_buffer,
+                                                                                       const std::vector<vkb::DrawItem> &items,
                                                                                        uint32_t mesh_start, uint32_t mesh_end, size_t thread_index)
 {
 	const auto &queue = render_context.get_device().get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
@@ -278,37 +281,219 @@ vkb::CommandBuffer *CommandBufferUsage::ForwardSubpassSecondary::record_draw_sec
 
 	secondary_command_buffer.set_scissor(0, {scissor});
 
-	record_draw(secondary_command_buffer, nodes, mesh_start, mesh_end, thread_index);
+	record_draw(secondary_command_buffer, items, mesh_start, mesh_end, thread_index);
 
 	secondary_command_buffer.end();
 
 	return &secondary_command_buffer;
 }
-void CommandBufferUsage::ForwardSubpassSecondary::draw(vkb::CommandBuffer &primary_command_buffer)
+
+vkb::CommandBuffer *CommandBufferUsage::ForwardSubpassSecondary::record_cached_draw(vkb::CommandBuffer &              primary_command_buffer,
+                                                                                    vkb::CommandPool &                command_pool,
+                                                                                    const std::vector<vkb::DrawItem> &items,
+                                                                                    uint32_t mesh_start, uint32_t mesh_end)
+{
+	auto &secondary_command_buffer = command_pool.request_command_buffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+	// Executed again in later frames, so without the one time submit flag
+	secondary_command_buffer.begin(VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &primary_command_buffer);
+
+	secondary_command_buffer.set_viewport(0, {viewport});
+
+	secondary_command_buffer.set_scissor(0, {scissor});
+
+	secondary_command_buffer.set_color_blend_state(color_blend_state);
+
+	secondary_command_buffer.set_depth_stencil_state(get_depth_stencil_state());
+
+	light_clusters.bind(secondary_command_buffer, 0, 4);
+
+	bind_global_uniform(secondary_command_buffer);
+
+	// One draw per mesh, as the instance data would not be written again
+	for (uint32_t i = mesh_start; i < mesh_end; i++)
+	{
+		update_uniform(secondary_command_buffer, items, i);
+
+		const auto &scale      = items[i].node->get_transform().get_render_state().scale;
+		VkFrontFace front_face = (scale.x * scale.y * scale.z < 0) ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+		draw_submesh(secondary_command_buffer, *items[i].sub_mesh, front_face, nullptr, 1, items[i].lod);
+	}
+
+	secondary_command_buffer.end();
+
+	return &secondary_command_buffer;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> CommandBufferUsage::ForwardSubpassSecondary::split_draws(uint32_t draw_count) const
 {
-	std::multimap<float, std::pair<vkb::sg::Node *, vkb::sg::SubMesh *>> opaque_nodes;
+	std::vector<std::pair<uint32_t, uint32_t>> ranges;
 
-	std::multimap<float, std::pair<vkb::sg::Node *, vkb::sg::SubMesh *>> transparent_nodes;
+	// Save the number of draws left over, these will be distributed among the first buffers
+	uint32_t draws_per_buffer = draw_count / state.secondary_cmd_buf_count;
+	uint32_t remainder_draws  = draw_count % state.secondary_cmd_buf_count;
+	uint32_t mesh_start       = 0;
 
-	get_sorted_nodes(opaque_nodes, transparent_nodes);
+	for (uint32_t cb_count = 0; cb_count < state.secondary_cmd_buf_count; cb_count++)
+	{
+		// Latter command buffers may contain fewer draws
+		uint32_t mesh_end = std::min(draw_count, mesh_start + draws_per_buffer);
+		if (remainder_draws > 0)
+		{
+			mesh_end++;
+			remainder_draws--;
+		}
 
-	// Sort opaque objects in front-to-back order
-	std::vector<std::pair<vkb::sg::Node *, vkb::sg::SubMesh *>> sorted_opaque_nodes;
-	for (auto node_it = opaque_nodes.begin(); node_it != opaque_nodes.end(); node_it++)
+		ranges.emplace_back(mesh_start, mesh_end);
+
+		mesh_start = mesh_end;
+	}
+
+	return ranges;
+}
+
+const std::vector<vkb::CommandBuffer *> &CommandBufferUsage::ForwardSubpassSecondary::get_cached_draws(vkb::CommandBuffer &              primary_command_buffer,
+                                                                                                      const std::vector<vkb::DrawItem> &items,
+                                                                                                      uint32_t                          opaque_count)
+{
+	auto &render_frame = render_context.get_active_frame();
+	auto  frame_index  = render_context.get_active_frame_index();
+
+	if (frame_index >= command_buffer_caches.size())
+	{
+		command_buffer_caches.resize(frame_index + 1);
+	}
+
+	auto &cache = command_buffer_caches[frame_index];
+
+	// The per-frame data is still written every frame. In a steady state it lands at the
+	// same place as the last time, so the recorded commands read the new values
+	const auto &render_pass = primary_command_buffer.get_current_render_pass();
+
+	size_t key = light_clusters.get_binding_hash();
+	vkb::hash_combine(key, render_pass.render_pass->get_compatibility_hash());
+	if (render_pass.framebuffer)
 	{
-		sorted_opaque_nodes.push_back(node_it->second);
+		vkb::hash_combine(key, render_pass.framebuffer->get_handle());
 	}
-	const auto opaque_submeshes = vkb::to_u32(sorted_opaque_nodes.size());
+	else
+	{
+		// Dynamic render passes have no framebuffer, the commands inherit the views of the render target
+		vkb::hash_combine(key, render_frame.get_render_target().get_views_hash());
+	}
+	vkb::hash_combine(key, viewport.width);
+	vkb::hash_combine(key, viewport.height);
+	vkb::hash_combine(key, state.secondary_cmd_buf_count);
 
-	// Sort transparent objects in back-to-front order
-	std::vector<std::pair<vkb::sg::Node *, vkb::sg::SubMesh *>> sorted_transparent_nodes;
-	for (auto node_it = transparent_nodes.rbegin(); node_it != transparent_nodes.rend(); node_it++)
+	// The model matrices of all the items share one allocation
+	if (opaque_count > 0)
 	{
-		sorted_transparent_nodes.push_back(node_it->second);
+		auto uniform = get_model_uniform(0);
+
+		vkb::hash_combine(key, uniform.get_buffer().get_handle());
+		vkb::hash_combine(key, uniform.get_offset());
 	}
-	const auto transparent_submeshes = vkb::to_u32(sorted_transparent_nodes.size());
 
-	light_buffer = allocate_lights<vkb::ForwardLights>(scene.get_components<vkb::sg::Light>(), MAX_FORWARD_LIGHT_COUNT);
+	vkb::hash_combine(key, global_uniform.get_buffer().get_handle());
+	vkb::hash_combine(key, global_uniform.get_offset());
+
+	for (uint32_t i = 0; i < opaque_count; i++)
+	{
+		auto &item = items[i];
+
+		const auto &scale = item.node->get_transform().get_render_state().scale;
+
+		vkb::hash_combine(key, item.node);
+		vkb::hash_combine(key, item.sub_mesh);
+		vkb::hash_combine(key, scale.x * scale.y * scale.z < 0);
+	}
+
+	reusing_command_buffers = cache.valid && cache.key == key && cache.render_frame == &render_frame;
+
+	if (reusing_command_buffers)
+	{
+		return cache.command_buffers;
+	}
+
+	// The pools refer to the frame, which moves if the render context adds frames
+	if (cache.render_frame != &render_frame)
+	{
+		cache.command_pools.clear();
+		cache.render_frame = &render_frame;
+	}
+
+	const auto &queue = render_context.get_device().get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0);
+
+	uint32_t thread_count = state.multi_threading ? std::max(state.thread_count, 1u) : 1u;
+
+	while (cache.command_pools.size() < thread_count)
+	{
+		cache.command_pools.push_back(std::make_unique<vkb::CommandPool>(render_context.get_device(), queue.get_family_index(), &render_frame,
+		                                                                 cache.command_pools.size(), vkb::CommandBuffer::ResetMode::ResetPool));
+	}
+
+	// The frame fence was waited for, so the buffers recorded for it are no longer in use
+	for (auto &command_pool : cache.command_pools)
+	{
+		command_pool->reset_pool();
+	}
+
+	cache.command_buffers.clear();
+
+	auto ranges = split_draws(opaque_count);
+
+	if (state.multi_threading)
+	{
+		std::vector<std::future<vkb::CommandBuffer *>> secondary_cmd_buf_futures;
+
+		for (auto &range : ranges)
+		{
+			auto fut = thread_pool.push(
+			    [this, &primary_command_buffer, &cache, &items, range](size_t thread_id) {
+				    vkb::CpuTopology::get().pin_current_thread(vkb::CoreClass::Big);
+
+				    return record_cached_draw(primary_command_buffer, *cache.command_pools[thread_id], items, range.first, range.second);
+			    });
+
+			secondary_cmd_buf_futures.push_back(std::move(fut));
+		}
+
+		for (auto &fut : secondary_cmd_buf_futures)
+		{
+			cache.command_buffers.push_back(fut.get());
+		}
+	}
+	else
+	{
+		for (auto &range : ranges)
+		{
+			cache.command_buffers.push_back(record_cached_draw(primary_command_buffer, *cache.command_pools[0], items, range.first, range.second));
+		}
+	}
+
+	cache.key = key;
+
+	// Descriptor sets requested from the frame are recycled when they stop being requested,
+	// only push descriptors are recorded in the command buffers themselves
+	cache.valid = std::none_of(cache.command_buffers.begin(), cache.command_buffers.end(), [](const vkb::CommandBuffer *command_buffer) {
+		return command_buffer->get_frame_descriptor_set_count() > 0;
+	});
+
+	return cache.command_buffers;
+}
+
+void CommandBufferUsage::ForwardSubpassSecondary::draw(vkb::CommandBuffer &primary_command_buffer)
+{
+	// Opaque objects come first, followed by transparent objects in back-to-front order
+	get_sorted_nodes(draw_list);
+
+	auto &items = draw_list.get_items();
+
+	const auto opaque_submeshes      = vkb::to_u32(draw_list.get_opaque_count());
+	const auto transparent_submeshes = vkb::to_u32(items.size()) - opaque_submeshes;
+
+	update_light_clusters();
 
 	color_blend_attachment.blend_enable = VK_FALSE;
 	color_blend_state.attachments.resize(get_output_attachments().size());
@@ -325,40 +510,44 @@ void CommandBufferUsage::ForwardSubpassSecondary::draw(vkb::CommandBuffer &prima
 		thread_pool.resize(state.thread_count);
 	}
 
-	if (use_secondary_command_buffers)
+	reusing_command_buffers = false;
+
+	// The gui is recorded on one of the threads while the opaque objects are
+	std::future<vkb::CommandBuffer *> gui_future;
+
+	if (gui && use_secondary_command_buffers && state.multi_threading)
 	{
-		std::vector<std::future<vkb::CommandBuffer *>> secondary_cmd_buf_futures;
+		gui_future = thread_pool.push([this, &primary_command_buffer](size_t thread_id) {
+			return &gui->draw_secondary(primary_command_buffer, thread_id, state.command_buffer_reset_mode);
+		});
+	}
 
-		// Save the number of draws left over, these will be distributed among the first buffers
-		uint32_t draws_per_buffer = vkb::to_u32(std::floor(avg_draws_per_buffer));
-		uint32_t remainder_draws  = opaque_submeshes % state.secondary_cmd_buf_count;
-		uint32_t mesh_start       = 0;
+	if (use_secondary_command_buffers && state.reuse_command_buffers)
+	{
+		secondary_command_buffers = get_cached_draws(primary_command_buffer, items, opaque_submeshes);
+	}
+	else if (use_secondary_command_buffers)
+	{
+		std::vector<std::future<vkb::CommandBuffer *>> secondary_cmd_buf_futures;
 
-		for (uint32_t cb_count = 0; cb_count < state.secondary_cmd_buf_count; cb_count++)
+		for (auto &range : split_draws(opaque_submeshes))
 		{
-			// Latter command buffers may contain fewer draws
-			uint32_t mesh_end = std::min(opaque_submeshes, mesh_start + draws_per_buffer);
-			if (remainder_draws > 0)
-			{
-				mesh_end++;
-				remainder_draws--;
-			}
-
 			if (state.multi_threading)
 			{
 				auto fut = thread_pool.push(
-				    [this, cb_count, &primary_command_buffer, &sorted_opaque_nodes, mesh_start, mesh_end](size_t thread_id) {
-					    return record_draw_secondary(primary_command_buffer, sorted_opaque_nodes, mesh_start, mesh_end, thread_id);
+				    [this, &primary_command_buffer, &items, range](size_t thread_id) {
+					    // The recording threads are on the critical path of the frame
+					    vkb::CpuTopology::get().pin_current_thread(vkb::CoreClass::Big);
+
+					    return record_draw_secondary(primary_command_buffer, items, range.first, range.second, thread_id);
 				    });
 
 				secondary_cmd_buf_futures.push_back(std::move(fut));
 			}
 			else
 			{
-				secondary_command_buffers.push_back(record_draw_secondary(primary_command_buffer, sorted_opaque_nodes, mesh_start, mesh_end));
+				secondary_command_buffers.push_back(record_draw_secondary(primary_command_buffer, items, range.first, range.second));
 			}
-
-			mesh_start = mesh_end;
 		}
 
 		if (state.multi_threading)
@@ -371,9 +560,12 @@ void CommandBufferUsage::ForwardSubpassSecondary::draw(vkb::CommandBuffer &prima
 	}
 	else
 	{
-		record_draw(primary_command_buffer, sorted_opaque_nodes, 0, opaque_submeshes);
+		record_draw(primary_command_buffer, items, 0, opaque_submeshes);
 	}
 
+	// The main thread records the rest with the resources of the first thread, which may have recorded the gui
+	vkb::CommandBuffer *gui_command_buffer = gui_future.valid() ? gui_future.get() : nullptr;
+
 	// Enable alpha blending
 	color_blend_attachment.blend_enable           = VK_TRUE;
 	color_blend_attachment.src_color_blend_factor = VK_BLEND_FACTOR_SRC_ALPHA;
@@ -387,16 +579,27 @@ void CommandBufferUsage::ForwardSubpassSecondary::draw(vkb::CommandBuffer &prima
 	{
 		if (use_secondary_command_buffers)
 		{
-			secondary_command_buffers.push_back(record_draw_secondary(primary_command_buffer, sorted_transparent_nodes, 0, transparent_submeshes));
+			secondary_command_buffers.push_back(record_draw_secondary(primary_command_buffer, items, opaque_submeshes, opaque_submeshes + transparent_submeshes));
 		}
 		else
 		{
-			record_draw(primary_command_buffer, sorted_transparent_nodes, 0, transparent_submeshes);
+			record_draw(primary_command_buffer, items, opaque_submeshes, opaque_submeshes + transparent_submeshes);
 		}
 	}
 
 	if (use_secondary_command_buffers)
 	{
+		if (gui && !gui_command_buffer)
+		{
+			gui_command_buffer = &gui->draw_secondary(primary_command_buffer, 0, state.command_buffer_reset_mode);
+		}
+
+		// Drawn over the meshes
+		if (gui_command_buffer)
+		{
+			secondary_command_buffers.push_back(gui_command_buffer);
+		}
+
 		primary_command_buffer.execute_commands(secondary_command_buffers);
 	}
 }
@@ -411,6 +614,11 @@ void CommandBufferUsage::ForwardSubpassSecondary::set_scissor(VkRect2D &scissor)
 	this->scissor = scissor;
 }
 
+void CommandBufferUsage::ForwardSubpassSecondary::set_gui(vkb::Gui *gui)
+{
+	this->gui = gui;
+}
+
 float CommandBufferUsage::ForwardSubpassSecondary::get_avg_draws_per_buffer() const
 {
 	return avg_draws_per_buffer;
@@ -421,6 +629,11 @@ CommandBufferUsage::ForwardSubpassSecondaryState &CommandBufferUsage::ForwardSub
 	return state;
 }
 
+bool CommandBufferUsage::ForwardSubpassSecondary::is_reusing_command_buffers() const
+{
+	return reusing_command_buffers;
+}
+
 std::unique_ptr<vkb::VulkanSample> create_command_buffer_usage()
 {
 	return std::make_unique<CommandBufferUsage>();
@@ -24,6 +24,7 @@
 
 #include "buffer_pool.h"
 #include "common/utils.h"
+#include "core/command_pool.h"
 #include "rendering/render_pipeline.h"
 #include "rendering/subpasses/forward_subpass.h"
 #include "scene_graph/components/material.h"
@@ -59,6 +60,8 @@ class CommandBufferUsage : public vkb::VulkanSample
 		bool multi_threading = false;
 
 		uint32_t thread_count = 0;
+
+		bool reuse_command_buffers = false;
 	};
 
 	/**
@@ -83,16 +86,75 @@ class CommandBufferUsage : public vkb::VulkanSample
 
 		ForwardSubpassSecondaryState &get_state();
 
+		/**
+		 * @brief Sets the Gui drawn after the meshes when they are recorded in secondary command buffers.
+		 *        With multi-threading it is recorded on one of the threads while the opaque meshes are
+		 */
+		void set_gui(vkb::Gui *gui);
+
+		/**
+		 * @return Whether the secondary command buffers of the opaque meshes recorded for an earlier frame were executed again
+		 */
+		bool is_reusing_command_buffers() const;
+
 	  private:
+		/**
+		 * @brief Secondary command buffers drawing the opaque meshes, recorded for a render frame
+		 *        without the one time submit flag and executed again while what they read stays in place
+		 */
+		struct CommandBufferCache
+		{
+			/// The frame the pools request descriptor sets from
+			vkb::RenderFrame *render_frame{nullptr};
+
+			/// One pool per thread, which the frame does not reset
+			std::vector<std::unique_ptr<vkb::CommandPool>> command_pools;
+
+			std::vector<vkb::CommandBuffer *> command_buffers;
+
+			/// Hash of the draws and of the location of the data they read
+			size_t key{0};
+
+			bool valid{false};
+		};
+
+		/**
+		 * @brief Splits the draws evenly among the secondary command buffers
+		 * @return The first and end index of the meshes of each secondary command buffer
+		 */
+		std::vector<std::pair<uint32_t, uint32_t>> split_draws(uint32_t draw_count) const;
+
+		/**
+		 * @brief Gets the secondary command buffers drawing the opaque meshes from the cache of the active frame,
+		 *        recording them again if the draws, the render pass or the data they read changed
+		 * @param primary_command_buffer The primary command buffer used to inherit the secondaries
+		 * @param items The meshes to draw, the opaque ones first
+		 * @param opaque_count Number of opaque meshes
+		 * @return The secondary command buffers to execute
+		 */
+		const std::vector<vkb::CommandBuffer *> &get_cached_draws(vkb::CommandBuffer &primary_command_buffer, const std::vector<vkb::DrawItem> &items, uint32_t opaque_count);
+
+		/**
+		 * @brief Records a reusable secondary command buffer drawing a range of meshes with the uniforms allocated for them
+		 * @param primary_command_buffer The primary command buffer used to inherit a secondary
+		 * @param command_pool The cache pool of the thread
+		 * @param items The meshes to draw
+		 * @param mesh_start Index to the first mesh to draw
+		 * @param mesh_end Index to the mesh where recording will stop (not included)
+		 * @return a pointer to the recorded secondary command buffer
+		 */
+		vkb::CommandBuffer *record_cached_draw(vkb::CommandBuffer &primary_command_buffer, vkb::CommandPool &command_pool, const std::vector<vkb::DrawItem> &items,
+		                                       uint32_t mesh_start, uint32_t mesh_end);
+
 		/**
 		 * @brief Records the necessary commands to draw the specified range of scene meshes
 		 * @param command_buffer The primary command buffer to record
-		 * @param nodes The meshes to draw
+		 * @param items The meshes to draw
 		 * @param mesh_start Index to the first mesh to draw
 		 * @param mesh_end Index to the mesh where recording will stop (not included)
 		 * @param thread_index Identifies the resources allocated for this thread
 		 */
-		void record_draw(vkb::CommandBuffer &command_buffer, const std::vector<std::pair<vkb::sg::Node *, vkb::sg::SubMesh *>> &nodes,
+		void record_draw(vkb::CommandBuffer &command_buffer, const std::vector<vkb::DrawItem> &items,
 		                 uint32_t mesh_start, uint32_t mesh_end, size_t thread_index = 0);
 
 		/**
@@ -100,13 +162,13 @@ class CommandBufferUsage : public vkb::VulkanSample
 		 *        The primary command buffer provided is used to initialize, record, end and return a
 		 *        pointer to a new secondary command buffer.
 		 * @param primary_command_buffer The primary command buffer used to inherit a secondary
-		 * @param nodes The meshes to draw
+		 * @param items The meshes to draw
 		 * @param mesh_start Index to the first mesh to draw
 		 * @param mesh_end Index to the mesh where recording will stop (not included)
 		 * @param thread_index Identifies the resources allocated for this thread
 		 * @return a pointer to the recorded secondary command buffer
 		 */
-		vkb::CommandBuffer *record_draw_secondary(vkb::CommandBuffer &primary_command_buffer, const std::vector<std::pair<vkb::sg::Node *, vkb::sg::SubMesh *>> &nodes,
+		vkb::CommandBuffer *record_draw_secondary(vkb::CommandBuffer &primary_command_buffer, const std::vector<vkb::DrawItem> &items,
 		                                          uint32_t mesh_start, uint32_t mesh_end, size_t thread_index = 0);
 
 		VkViewport viewport{};
@@ -123,7 +185,12 @@ class CommandBufferUsage : public vkb::VulkanSample
 
 		ctpl::thread_pool thread_pool;
 
-		vkb::BufferAllocation light_buffer;
+		vkb::Gui *gui{nullptr};
+
+		/// Indexed by render frame
+		std::vector<CommandBufferCache> command_buffer_caches;
+
+		bool reusing_command_buffers{false};
 	};
 
   private:
@@ -147,6 +214,8 @@ class CommandBufferUsage : public vkb::VulkanSample
 
 	bool gui_multi_threading{false};
 
+	bool gui_reuse_command_buffers{false};
+
 	const uint32_t MIN_THREAD_COUNT{4};
 
 	uint32_t max_thread_count{0};
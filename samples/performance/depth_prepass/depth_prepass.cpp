@@ -0,0 +1,116 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "depth_prepass.h"
+
+#include "common/vk_common.h"
+#include "gltf_loader.h"
+#include "gui.h"
+#include "platform/filesystem.h"
+#include "platform/platform.h"
+#include "rendering/subpasses/depth_prepass_subpass.h"
+#include "rendering/subpasses/forward_subpass.h"
+#include "stats.h"
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+#	include "platform/android/android_platform.h"
+#endif
+
+DepthPrepass::DepthPrepass()
+{
+	auto &config = get_configuration();
+
+	config.insert<vkb::BoolSetting>(0, depth_prepass, true);
+	config.insert<vkb::BoolSetting>(1, depth_prepass, false);
+}
+
+bool DepthPrepass::prepare(vkb::Platform &platform)
+{
+	if (!VulkanSample::prepare(platform))
+	{
+		return false;
+	}
+
+	load_scene("scenes/sponza/Sponza01.gltf");
+
+	auto &camera_node = vkb::add_free_camera(*scene, "main_camera", get_render_context().get_surface_extent());
+	camera            = &camera_node.get_component<vkb::sg::Camera>();
+
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times,
+	                                                              vkb::StatIndex::fragment_cycles,
+	                                                              vkb::StatIndex::tiles});
+	gui   = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
+
+	update_pipeline();
+
+	return true;
+}
+
+void DepthPrepass::update_pipeline()
+{
+	last_depth_prepass = depth_prepass;
+
+	auto &render_context = get_render_context();
+
+	// The pipeline of the frames in flight is replaced
+	get_device().wait_idle();
+
+	auto render_pipeline = vkb::RenderPipeline();
+
+	if (depth_prepass)
+	{
+		render_pipeline.add_subpass(std::make_unique<vkb::DepthPrepassSubpass>(render_context, *scene, *camera));
+	}
+
+	vkb::ShaderSource vert_shader("base.vert");
+	vkb::ShaderSource frag_shader("base.frag");
+	auto              scene_subpass = std::make_unique<vkb::ForwardSubpass>(render_context, std::move(vert_shader), std::move(frag_shader), *scene, *camera);
+
+	scene_subpass->set_depth_prepass(depth_prepass);
+
+	render_pipeline.add_subpass(std::move(scene_subpass));
+
+	set_render_pipeline(std::move(render_pipeline));
+}
+
+void DepthPrepass::update(float delta_time)
+{
+	if (depth_prepass != last_depth_prepass)
+	{
+		LOGI("Recreating render pipeline");
+		update_pipeline();
+	}
+
+	VulkanSample::update(delta_time);
+}
+
+void DepthPrepass::draw_gui()
+{
+	gui->show_options_window(
+	    /* body = */ [this]() {
+		    ImGui::Checkbox("Depth pre-pass", &depth_prepass);
+	    },
+	    /* lines = */ 1);
+}
+
+std::unique_ptr<vkb::VulkanSample> create_depth_prepass()
+{
+	return std::make_unique<DepthPrepass>();
+}
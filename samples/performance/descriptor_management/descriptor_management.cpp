@@ -61,7 +61,9 @@ bool DescriptorManagement::prepare(vkb::Platform &platform)
 	set_render_pipeline(std::move(render_pipeline));
 
 	// Add a GUI with the stats you want to monitor
-	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times});
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times,
+	                                                                 vkb::StatIndex::descriptor_set_allocations,
+	                                                                 vkb::StatIndex::descriptor_set_reuses});
 	gui   = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
 
 	return true;
@@ -80,12 +82,21 @@ void DescriptorManagement::update(float delta_time)
 	auto &command_buffer = render_context.begin();
 
 	// Process GUI input
-	auto buffer_alloc_strategy = (buffer_allocation.value == 0) ?
-	                                 vkb::BufferAllocationStrategy::OneAllocationPerBuffer :
-	                                 vkb::BufferAllocationStrategy::MultipleAllocationsPerBuffer;
+	auto buffer_alloc_strategy = vkb::BufferAllocationStrategy::OneAllocationPerBuffer;
+
+	if (buffer_allocation.value == 1)
+	{
+		buffer_alloc_strategy = vkb::BufferAllocationStrategy::MultipleAllocationsPerBuffer;
+	}
+	else if (buffer_allocation.value == 2)
+	{
+		buffer_alloc_strategy = vkb::BufferAllocationStrategy::LinearAllocation;
+	}
 
 	render_context.get_active_frame().set_buffer_allocation_strategy(buffer_alloc_strategy);
 
+	get_device().set_descriptor_update_templates(update_templates.value == 1);
+
 	if (descriptor_caching.value == 0)
 	{
 		// Clear descriptor pools for the current frame
@@ -96,6 +107,8 @@ void DescriptorManagement::update(float delta_time)
 
 	draw(command_buffer, render_context.get_active_frame().get_render_target());
 
+	record_frame_capture(command_buffer);
+
 	command_buffer.end();
 
 	render_context.submit(command_buffer);
@@ -54,10 +54,15 @@ class DescriptorManagement : public vkb::VulkanSample
 
 	RadioButtonGroup buffer_allocation{
 	    "Single large VkBuffer",
+	    {"Disabled", "Enabled", "Linear"},
+	    0};
+
+	RadioButtonGroup update_templates{
+	    "Descriptor update templates",
 	    {"Disabled", "Enabled"},
 	    0};
 
-	std::vector<RadioButtonGroup *> radio_buttons = {&descriptor_caching, &buffer_allocation};
+	std::vector<RadioButtonGroup *> radio_buttons = {&descriptor_caching, &buffer_allocation, &update_templates};
 
 	vkb::sg::PerspectiveCamera *camera{nullptr};
 
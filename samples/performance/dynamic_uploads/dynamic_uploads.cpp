@@ -0,0 +1,140 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "dynamic_uploads.h"
+
+#include "common/vk_common.h"
+#include "gltf_loader.h"
+#include "gui.h"
+#include "platform/filesystem.h"
+#include "platform/platform.h"
+#include "rendering/subpasses/forward_subpass.h"
+#include "stats.h"
+#include "timer.h"
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+#	include "platform/android/android_platform.h"
+#endif
+
+namespace
+{
+const char *RECORD_STAT = "record_cpu_time_ms";
+
+/// Names of the uploads, in the order of vkb::ModelUpload
+const char *UPLOAD_NAMES[] = {"Dynamic offsets", "Push constants", "Storage buffer", "Descriptor sets", "Update buffer"};
+
+const int UPLOAD_COUNT = static_cast<int>(sizeof(UPLOAD_NAMES) / sizeof(UPLOAD_NAMES[0]));
+}        // namespace
+
+DynamicUploads::DynamicUploads()
+{
+	auto &config = get_configuration();
+
+	for (int i = 0; i < UPLOAD_COUNT; ++i)
+	{
+		config.insert<vkb::IntSetting>(i, upload_index, i);
+	}
+}
+
+bool DynamicUploads::prepare(vkb::Platform &platform)
+{
+	if (!VulkanSample::prepare(platform))
+	{
+		return false;
+	}
+
+	load_scene("scenes/sponza/Sponza01.gltf");
+
+	auto &camera_node = vkb::add_free_camera(*scene, "main_camera", get_render_context().get_surface_extent());
+	camera            = &camera_node.get_component<vkb::sg::Camera>();
+
+	create_render_pipeline();
+
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times,
+	                                                              vkb::StatIndex::gpu_time,
+	                                                              vkb::StatIndex::descriptor_set_allocations,
+	                                                              vkb::StatIndex::descriptor_set_reuses});
+
+	// Measured by the sample, for every upload
+	stats->add_named_stat(RECORD_STAT);
+
+	gui = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
+
+	return true;
+}
+
+void DynamicUploads::update(float delta_time)
+{
+	// The uploads read the model matrices from different shader variants
+	if (upload_index != pipeline_upload_index)
+	{
+		create_render_pipeline();
+	}
+
+	VulkanSample::update(delta_time);
+}
+
+void DynamicUploads::render(vkb::CommandBuffer &command_buffer)
+{
+	vkb::Timer timer;
+	timer.start();
+
+	VulkanSample::render(command_buffer);
+
+	stats->set_named_value(RECORD_STAT, static_cast<float>(timer.stop<vkb::Timer::Milliseconds>()));
+}
+
+void DynamicUploads::create_render_pipeline()
+{
+	vkb::ShaderSource vert_shader("base.vert");
+	vkb::ShaderSource frag_shader("base.frag");
+	auto              subpass = std::make_unique<vkb::ForwardSubpass>(get_render_context(), std::move(vert_shader), std::move(frag_shader), *scene, *camera);
+
+	subpass->set_model_upload(static_cast<vkb::ModelUpload>(upload_index));
+
+	auto render_pipeline = vkb::RenderPipeline();
+	render_pipeline.add_subpass(std::move(subpass));
+
+	set_render_pipeline(std::move(render_pipeline));
+
+	pipeline_upload_index = upload_index;
+}
+
+void DynamicUploads::draw_gui()
+{
+	gui->show_options_window(
+	    /* body = */ [this]() {
+		    for (int i = 0; i < UPLOAD_COUNT; ++i)
+		    {
+			    if (i > 0)
+			    {
+				    ImGui::SameLine();
+			    }
+
+			    ImGui::RadioButton(UPLOAD_NAMES[i], &upload_index, i);
+		    }
+	    },
+	    /* lines = */ 1);
+}
+
+std::unique_ptr<vkb::VulkanSample> create_dynamic_uploads()
+{
+	return std::make_unique<DynamicUploads>();
+}
@@ -0,0 +1,65 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "rendering/render_pipeline.h"
+#include "rendering/subpasses/geometry_subpass.h"
+#include "scene_graph/components/camera.h"
+#include "vulkan_sample.h"
+
+/**
+ * @brief Draws the scene uploading the model matrices of the draws in one of the ways
+ *        supported by the geometry subpasses, see vkb::ModelUpload
+ */
+class DynamicUploads : public vkb::VulkanSample
+{
+  public:
+	DynamicUploads();
+
+	virtual ~DynamicUploads() = default;
+
+	virtual bool prepare(vkb::Platform &platform) override;
+
+	virtual void update(float delta_time) override;
+
+  private:
+	virtual void draw_gui() override;
+
+	/**
+	 * @brief Measures the CPU time of recording the render pipeline
+	 */
+	virtual void render(vkb::CommandBuffer &command_buffer) override;
+
+	/**
+	 * @brief Creates the render pipeline drawing with the selected upload
+	 */
+	void create_render_pipeline();
+
+	vkb::sg::Camera *camera{nullptr};
+
+	/// Upload selected in the GUI or configuration, an index of vkb::ModelUpload
+	int upload_index{0};
+
+	/// Upload of the current render pipeline
+	int pipeline_upload_index{0};
+};
+
+std::unique_ptr<vkb::VulkanSample> create_dynamic_uploads();
@@ -0,0 +1,543 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "external_images.h"
+
+#include <chrono>
+#include <cmath>
+
+#include "common/vk_common.h"
+#include "core/command_buffer.h"
+#include "gui.h"
+#include "platform/platform.h"
+#include "rendering/render_context.h"
+#include "stats.h"
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+#	include <dlfcn.h>
+#endif
+
+namespace
+{
+constexpr uint32_t EXTERNAL_FRAME_WIDTH = 1280;
+
+constexpr uint32_t EXTERNAL_FRAME_HEIGHT = 720;
+
+/// Rate of the producer, the rate of a camera or of a video
+constexpr std::chrono::milliseconds EXTERNAL_FRAME_PERIOD{33};
+
+/**
+ * @brief Writes a scrolling gradient with a moving bar, the content of a frame does not matter
+ *        as long as every pixel is written
+ */
+void write_pattern(uint8_t *pixels, uint32_t stride, float time)
+{
+	auto bar    = static_cast<uint32_t>((0.5f + 0.5f * std::sin(time)) * (EXTERNAL_FRAME_WIDTH - 64));
+	auto offset = static_cast<uint32_t>(time * 60.0f);
+
+	for (uint32_t y = 0; y < EXTERNAL_FRAME_HEIGHT; ++y)
+	{
+		auto row = pixels + y * stride * 4;
+
+		for (uint32_t x = 0; x < EXTERNAL_FRAME_WIDTH; ++x)
+		{
+			bool in_bar = x >= bar && x < bar + 64;
+
+			row[x * 4 + 0] = in_bar ? 255 : static_cast<uint8_t>(x + offset);
+			row[x * 4 + 1] = in_bar ? 255 : static_cast<uint8_t>(y + offset);
+			row[x * 4 + 2] = in_bar ? 255 : static_cast<uint8_t>(128 + (x ^ y));
+			row[x * 4 + 3] = 255;
+		}
+	}
+}
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+/**
+ * @brief Hardware buffer functions, introduced in Android 8.0 and loaded at runtime
+ *        since the samples support older versions
+ */
+struct HardwareBufferApi
+{
+	int (*allocate)(const AHardwareBuffer_Desc *, AHardwareBuffer **){nullptr};
+
+	void (*release)(AHardwareBuffer *){nullptr};
+
+	void (*describe)(const AHardwareBuffer *, AHardwareBuffer_Desc *){nullptr};
+
+	int (*lock)(AHardwareBuffer *, uint64_t, int32_t, const ARect *, void **){nullptr};
+
+	int (*unlock)(AHardwareBuffer *, int32_t *){nullptr};
+};
+
+const HardwareBufferApi &get_hardware_buffer_api()
+{
+	static HardwareBufferApi api = []() {
+		HardwareBufferApi result;
+
+		if (auto library = dlopen("libnativewindow.so", RTLD_NOW | RTLD_LOCAL))
+		{
+			result.allocate = reinterpret_cast<decltype(result.allocate)>(dlsym(library, "AHardwareBuffer_allocate"));
+			result.release  = reinterpret_cast<decltype(result.release)>(dlsym(library, "AHardwareBuffer_release"));
+			result.describe = reinterpret_cast<decltype(result.describe)>(dlsym(library, "AHardwareBuffer_describe"));
+			result.lock     = reinterpret_cast<decltype(result.lock)>(dlsym(library, "AHardwareBuffer_lock"));
+			result.unlock   = reinterpret_cast<decltype(result.unlock)>(dlsym(library, "AHardwareBuffer_unlock"));
+		}
+
+		if (!result.allocate || !result.release || !result.describe || !result.lock || !result.unlock)
+		{
+			result = HardwareBufferApi{};
+		}
+
+		return result;
+	}();
+
+	return api;
+}
+#endif
+}        // namespace
+
+ExternalImages::ExternalImages()
+{
+	auto &config = get_configuration();
+
+	config.insert<vkb::IntSetting>(0, zero_copy, 0);
+	config.insert<vkb::IntSetting>(1, zero_copy, 1);
+}
+
+ExternalImages::~ExternalImages()
+{
+	producer_running = false;
+
+	if (producer.joinable())
+	{
+		producer.join();
+	}
+
+	if (device)
+	{
+		device->wait_idle();
+	}
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+	// The imported images are destroyed before the hardware buffers they refer to
+	for (auto &frame : external_frames)
+	{
+		frame.image.reset();
+
+		if (frame.hardware_buffer)
+		{
+			get_hardware_buffer_api().release(frame.hardware_buffer);
+		}
+	}
+#endif
+}
+
+bool ExternalImages::prepare(vkb::Platform &platform)
+{
+	if (!VulkanSample::prepare(platform))
+	{
+		return false;
+	}
+
+	auto &device = get_device();
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+	zero_copy_supported = device.is_enabled(VK_ANDROID_EXTERNAL_MEMORY_ANDROID_HARDWARE_BUFFER_EXTENSION_NAME) && get_hardware_buffer_api().allocate;
+#endif
+
+	if (!zero_copy_supported)
+	{
+		LOGW("Hardware buffers cannot be imported, the frames are copied through a staging buffer");
+	}
+
+	// A frame may be sampled by every frame in flight, while the producer writes the next one
+	create_external_frames(to_u32(get_render_context().get_render_frames().size()) + 2);
+
+	staged_image = std::make_unique<vkb::core::Image>(device,
+	                                                  VkExtent3D{EXTERNAL_FRAME_WIDTH, EXTERNAL_FRAME_HEIGHT, 1},
+	                                                  VK_FORMAT_R8G8B8A8_UNORM,
+	                                                  VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+	                                                  VMA_MEMORY_USAGE_GPU_ONLY);
+
+	VkSamplerCreateInfo sampler_info{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+
+	sampler_info.magFilter    = VK_FILTER_LINEAR;
+	sampler_info.minFilter    = VK_FILTER_LINEAR;
+	sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+	sampler = std::make_unique<vkb::core::Sampler>(device, sampler_info);
+
+	auto render_pipeline = vkb::RenderPipeline();
+	render_pipeline.add_subpass(std::make_unique<ExternalImageSubpass>(get_render_context(), *this));
+
+	set_render_pipeline(std::move(render_pipeline));
+
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times,
+	                                                              vkb::StatIndex::l2_ext_read_bytes,
+	                                                              vkb::StatIndex::l2_ext_write_bytes});
+	gui   = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
+
+	producer_running = true;
+	producer         = std::thread{[this]() { produce(); }};
+
+	return true;
+}
+
+void ExternalImages::create_external_frames(uint32_t count)
+{
+	external_frames.resize(count);
+
+	for (auto &frame : external_frames)
+	{
+		frame.pixels.resize(EXTERNAL_FRAME_WIDTH * EXTERNAL_FRAME_HEIGHT * 4);
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+		if (!zero_copy_supported)
+		{
+			continue;
+		}
+
+		// Written by the CPU and only sampled by the GPU, as camera and video frames
+		AHardwareBuffer_Desc desc{};
+		desc.width  = EXTERNAL_FRAME_WIDTH;
+		desc.height = EXTERNAL_FRAME_HEIGHT;
+		desc.layers = 1;
+		desc.format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM;
+		desc.usage  = AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN;
+
+		if (get_hardware_buffer_api().allocate(&desc, &frame.hardware_buffer) != 0)
+		{
+			LOGW("Cannot allocate a hardware buffer, the frames are copied through a staging buffer");
+
+			frame.hardware_buffer = nullptr;
+			zero_copy_supported   = false;
+		}
+#endif
+	}
+}
+
+void ExternalImages::produce()
+{
+	auto start = std::chrono::steady_clock::now();
+	auto next  = start;
+
+	while (producer_running)
+	{
+		ExternalFrame *frame = nullptr;
+
+		{
+			std::lock_guard<std::mutex> lock{external_frames_mutex};
+
+			// Frames still sampled by the GPU and the latest frame, which the next render frame may pick, are skipped
+			for (size_t i = 0; i < external_frames.size(); ++i)
+			{
+				auto &candidate = external_frames[i];
+
+				if (candidate.render_frame_mask == 0 && static_cast<int>(i) != latest_frame)
+				{
+					frame = &candidate;
+					break;
+				}
+			}
+		}
+
+		if (frame)
+		{
+			auto time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+			frame->in_hardware_buffer = false;
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+			if (zero_copy_active && frame->hardware_buffer)
+			{
+				auto &api = get_hardware_buffer_api();
+
+				AHardwareBuffer_Desc desc{};
+				api.describe(frame->hardware_buffer, &desc);
+
+				void *pixels = nullptr;
+
+				if (api.lock(frame->hardware_buffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr, &pixels) == 0)
+				{
+					write_pattern(static_cast<uint8_t *>(pixels), desc.stride, time);
+
+					api.unlock(frame->hardware_buffer, nullptr);
+
+					frame->in_hardware_buffer = true;
+				}
+			}
+#endif
+
+			if (!frame->in_hardware_buffer)
+			{
+				write_pattern(frame->pixels.data(), EXTERNAL_FRAME_WIDTH, time);
+			}
+
+			std::lock_guard<std::mutex> lock{external_frames_mutex};
+
+			latest_frame = static_cast<int>(frame - external_frames.data());
+		}
+
+		next += EXTERNAL_FRAME_PERIOD;
+		std::this_thread::sleep_until(next);
+	}
+}
+
+ExternalImages::ExternalFrame *ExternalImages::acquire_latest_frame()
+{
+	auto frame_bit = 1u << get_render_context().get_active_frame_index();
+
+	std::lock_guard<std::mutex> lock{external_frames_mutex};
+
+	// The fence of the active render frame was waited for, its previous commands do not use any frame anymore
+	for (auto &frame : external_frames)
+	{
+		frame.render_frame_mask &= ~frame_bit;
+	}
+
+	if (latest_frame < 0)
+	{
+		return nullptr;
+	}
+
+	auto &frame = external_frames[latest_frame];
+	frame.render_frame_mask |= frame_bit;
+
+	return &frame;
+}
+
+void ExternalImages::upload_frame(vkb::CommandBuffer &command_buffer, ExternalFrame &frame)
+{
+	auto frame_index = get_render_context().get_active_frame_index();
+
+	if (staging_buffers.size() <= frame_index)
+	{
+		staging_buffers.resize(frame_index + 1);
+	}
+
+	auto &staging_buffer = staging_buffers[frame_index];
+
+	if (!staging_buffer)
+	{
+		staging_buffer = std::make_unique<vkb::core::Buffer>(get_device(), frame.pixels.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+	}
+
+	// The copy the zero-copy path avoids, once by the CPU and once by the GPU
+	staging_buffer->update(frame.pixels);
+
+	auto &view = staged_image->request_view(VK_IMAGE_VIEW_TYPE_2D);
+
+	{
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = staged_image_initialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		memory_barrier.src_access_mask = 0;
+		memory_barrier.dst_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+		command_buffer.image_memory_barrier(view, memory_barrier);
+	}
+
+	VkBufferImageCopy copy_region{};
+	copy_region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copy_region.imageSubresource.layerCount = 1;
+	copy_region.imageExtent                 = staged_image->get_extent();
+
+	command_buffer.copy_buffer_to_image(*staging_buffer, *staged_image, {copy_region});
+
+	{
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		memory_barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+		command_buffer.image_memory_barrier(view, memory_barrier);
+	}
+
+	staged_image_initialized = true;
+
+	current_image = staged_image.get();
+}
+
+const vkb::core::Sampler &ExternalImages::get_ycbcr_sampler(VkSamplerYcbcrConversion conversion)
+{
+	auto &ycbcr_sampler = ycbcr_samplers[conversion];
+
+	if (!ycbcr_sampler)
+	{
+		VkSamplerYcbcrConversionInfoKHR conversion_info{VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_INFO_KHR};
+		conversion_info.conversion = conversion;
+
+		// Samplers with a conversion clamp to the edge and cannot be anisotropic
+		VkSamplerCreateInfo sampler_info{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+
+		sampler_info.pNext        = &conversion_info;
+		sampler_info.magFilter    = VK_FILTER_LINEAR;
+		sampler_info.minFilter    = VK_FILTER_LINEAR;
+		sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+		ycbcr_sampler = std::make_unique<vkb::core::Sampler>(get_device(), sampler_info);
+	}
+
+	return *ycbcr_sampler;
+}
+
+void ExternalImages::draw(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target)
+{
+	zero_copy_active = zero_copy_supported && zero_copy == 1;
+
+	current_image = nullptr;
+
+	auto frame = acquire_latest_frame();
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+	if (frame && frame->in_hardware_buffer)
+	{
+		if (!frame->image)
+		{
+			frame->image = std::make_unique<vkb::core::Image>(get_device(), frame->hardware_buffer, VkExtent2D{EXTERNAL_FRAME_WIDTH, EXTERNAL_FRAME_HEIGHT});
+		}
+
+		// The producer wrote the hardware buffer outside of Vulkan, it is acquired from the foreign queue family
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout       = VK_IMAGE_LAYOUT_GENERAL;
+		memory_barrier.new_layout       = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		memory_barrier.src_access_mask  = 0;
+		memory_barrier.dst_access_mask  = VK_ACCESS_SHADER_READ_BIT;
+		memory_barrier.src_stage_mask   = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		memory_barrier.dst_stage_mask   = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		memory_barrier.old_queue_family = VK_QUEUE_FAMILY_FOREIGN_EXT;
+		memory_barrier.new_queue_family = get_render_context().get_queue().get_family_index();
+
+		command_buffer.image_memory_barrier(frame->image->request_view(VK_IMAGE_VIEW_TYPE_2D), memory_barrier);
+
+		current_image = frame->image.get();
+	}
+#endif
+
+	if (frame && !current_image)
+	{
+		upload_frame(command_buffer, *frame);
+	}
+
+	VulkanSample::draw(command_buffer, render_target);
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+	if (frame && frame->in_hardware_buffer)
+	{
+		// Released back to the producer, which writes it again once the render frame completed
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout       = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		memory_barrier.new_layout       = VK_IMAGE_LAYOUT_GENERAL;
+		memory_barrier.src_access_mask  = 0;
+		memory_barrier.dst_access_mask  = 0;
+		memory_barrier.src_stage_mask   = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		memory_barrier.dst_stage_mask   = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		memory_barrier.old_queue_family = get_render_context().get_queue().get_family_index();
+		memory_barrier.new_queue_family = VK_QUEUE_FAMILY_FOREIGN_EXT;
+
+		command_buffer.image_memory_barrier(frame->image->request_view(VK_IMAGE_VIEW_TYPE_2D), memory_barrier);
+	}
+#endif
+}
+
+void ExternalImages::draw_gui()
+{
+	gui->show_options_window(
+	    /* body = */ [this]() {
+		    ImGui::Text("Frames: ");
+		    ImGui::SameLine();
+		    ImGui::RadioButton("Staging copy", &zero_copy, 0);
+		    ImGui::SameLine();
+		    ImGui::RadioButton("Zero-copy import", &zero_copy, 1);
+
+		    if (!zero_copy_supported)
+		    {
+			    ImGui::Text("Hardware buffers cannot be imported on this device");
+		    }
+	    },
+	    /* lines = */ zero_copy_supported ? 1 : 2);
+}
+
+ExternalImages::ExternalImageSubpass::ExternalImageSubpass(vkb::RenderContext &render_context, ExternalImages &sample) :
+    vkb::Subpass{render_context, vkb::ShaderSource{"post_processing/fullscreen.vert"}, vkb::ShaderSource{"post_processing/blit.frag"}},
+    sample{sample}
+{
+	set_debug_name("External image");
+
+	// The full screen triangle covers every pixel, the depth attachment is not used
+	auto &depth_stencil_state              = get_depth_stencil_state();
+	depth_stencil_state.depth_test_enable  = VK_FALSE;
+	depth_stencil_state.depth_write_enable = VK_FALSE;
+}
+
+void ExternalImages::ExternalImageSubpass::prepare()
+{
+	auto &resource_cache = render_context.get_device().get_resource_cache();
+	resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader());
+	resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader());
+}
+
+void ExternalImages::ExternalImageSubpass::draw(vkb::CommandBuffer &command_buffer)
+{
+	// Nothing to draw until the producer wrote its first frame
+	if (!sample.current_image)
+	{
+		return;
+	}
+
+	auto &resource_cache     = command_buffer.get_device().get_resource_cache();
+	auto &vert_shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader());
+	auto &frag_shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader());
+
+	// Images with a conversion, such as the YUV frames of a camera, are sampled with an immutable sampler
+	auto  conversion = sample.current_image->get_ycbcr_conversion();
+	auto &sampler    = conversion != VK_NULL_HANDLE ? sample.get_ycbcr_sampler(conversion) : *sample.sampler;
+
+	frag_shader_module.set_resource_immutable_sampler("source", conversion != VK_NULL_HANDLE ? sampler.get_handle() : VK_NULL_HANDLE);
+
+	std::vector<vkb::ShaderModule *> shader_modules{&vert_shader_module, &frag_shader_module};
+
+	command_buffer.bind_pipeline_layout(resource_cache.request_pipeline_layout(shader_modules, use_dynamic_resources));
+
+	command_buffer.bind_image(sample.current_image->request_view(VK_IMAGE_VIEW_TYPE_2D), sampler, 0, 0, 0);
+
+	// The full screen triangle is clockwise
+	vkb::RasterizationState rasterization_state;
+	rasterization_state.cull_mode = VK_CULL_MODE_NONE;
+	command_buffer.set_rasterization_state(rasterization_state);
+
+	command_buffer.set_depth_stencil_state(get_depth_stencil_state());
+
+	command_buffer.draw(3, 1, 0, 0);
+}
+
+std::unique_ptr<vkb::VulkanSample> create_external_images()
+{
+	return std::make_unique<ExternalImages>();
+}
@@ -0,0 +1,156 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "core/buffer.h"
+#include "core/image.h"
+#include "core/sampler.h"
+#include "rendering/subpass.h"
+#include "vulkan_sample.h"
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+#	include <android/hardware_buffer.h>
+#endif
+
+/**
+ * @brief Frames written by another producer, standing in for a camera or a video decoder, sampled in place
+ *        by importing the Android hardware buffers they are written to, or copied through a staging buffer
+ */
+class ExternalImages : public vkb::VulkanSample
+{
+  public:
+	ExternalImages();
+
+	virtual ~ExternalImages();
+
+	virtual bool prepare(vkb::Platform &platform) override;
+
+	/**
+	 * @brief Draws the latest frame of the producer on a full screen triangle
+	 */
+	class ExternalImageSubpass : public vkb::Subpass
+	{
+	  public:
+		ExternalImageSubpass(vkb::RenderContext &render_context, ExternalImages &sample);
+
+		virtual void prepare() override;
+
+		virtual void draw(vkb::CommandBuffer &command_buffer) override;
+
+	  private:
+		ExternalImages &sample;
+	};
+
+  private:
+	/**
+	 * @brief A frame of the producer, in a hardware buffer or in host memory
+	 */
+	struct ExternalFrame
+	{
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+		AHardwareBuffer *hardware_buffer{nullptr};
+
+		/// Hardware buffer imported once, when first sampled
+		std::unique_ptr<vkb::core::Image> image;
+#endif
+
+		std::vector<uint8_t> pixels;
+
+		/// True if the last write went to the hardware buffer
+		bool in_hardware_buffer{false};
+
+		/// Render frames sampling or copying the frame, one bit per frame in flight
+		uint32_t render_frame_mask{0};
+	};
+
+	/**
+	 * @brief Allocates the frames of the producer, with hardware buffers if they can be imported
+	 */
+	void create_external_frames(uint32_t count);
+
+	/**
+	 * @brief Body of the producer thread, which writes an animated pattern in the free frames
+	 */
+	void produce();
+
+	/**
+	 * @brief Picks the latest frame written by the producer for the active render frame,
+	 *        and releases the frames sampled by the previous use of the render frame
+	 * @return The frame, nullptr if none was written yet
+	 */
+	ExternalFrame *acquire_latest_frame();
+
+	/**
+	 * @brief Copies the pixels of a frame to the sampled image through the staging buffer of the render frame
+	 */
+	void upload_frame(vkb::CommandBuffer &command_buffer, ExternalFrame &frame);
+
+	/**
+	 * @return The sampler for images sampled through a YCbCr conversion
+	 */
+	const vkb::core::Sampler &get_ycbcr_sampler(VkSamplerYcbcrConversion conversion);
+
+	virtual void draw(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target) override;
+
+	virtual void draw_gui() override;
+
+	std::vector<ExternalFrame> external_frames;
+
+	/// Guards the state of the external frames and the latest frame index
+	std::mutex external_frames_mutex;
+
+	/// Index of the latest frame written, -1 until the first one
+	int latest_frame{-1};
+
+	std::thread producer;
+
+	std::atomic<bool> producer_running{false};
+
+	/// Read by the producer, which writes the next frames to hardware buffers if set
+	std::atomic<bool> zero_copy_active{false};
+
+	/// Selected mode, 0 to copy the frames through a staging buffer and 1 to import them
+	int zero_copy{0};
+
+	bool zero_copy_supported{false};
+
+	/// Staging buffers of the render frames
+	std::vector<std::unique_ptr<vkb::core::Buffer>> staging_buffers;
+
+	/// Image the frames are copied to in staging mode
+	std::unique_ptr<vkb::core::Image> staged_image;
+
+	bool staged_image_initialized{false};
+
+	/// Image sampled by the subpass this frame
+	vkb::core::Image *current_image{nullptr};
+
+	std::unique_ptr<vkb::core::Sampler> sampler;
+
+	std::map<VkSamplerYcbcrConversion, std::unique_ptr<vkb::core::Sampler>> ycbcr_samplers;
+};
+
+std::unique_ptr<vkb::VulkanSample> create_external_images();
@@ -0,0 +1,593 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "gpu_particles.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "common/utils.h"
+#include "common/vk_common.h"
+#include "core/command_buffer.h"
+#include "gui.h"
+#include "platform/platform.h"
+#include "rendering/render_context.h"
+#include "rendering/subpasses/forward_subpass.h"
+#include "scene_graph/components/camera.h"
+#include "stats.h"
+#include "timer.h"
+
+namespace
+{
+/// Invocations of the simulation, as in its local size. Its dispatches are indirect, so its workgroup size is not tuned
+constexpr uint32_t SIMULATE_WORKGROUP_SIZE = 64;
+
+/// Particles emitted by each invocation group of the emission, tuned per device
+const std::vector<vkb::WorkgroupSize> EMIT_WORKGROUP_SIZES{{64, 1}, {128, 1}, {256, 1}};
+
+/// The fountain in the middle of the scene, in scene units
+const glm::vec3 EMITTER_POSITION{0.0f, 50.0f, 0.0f};
+
+constexpr float EMIT_SPEED = 600.0f;
+
+/// Tangent of the half angle of the cone the particles are emitted in
+constexpr float EMIT_SPREAD = 0.35f;
+
+constexpr float GRAVITY = 981.0f;
+
+/// Vertical speed kept by the particles bouncing on the floor
+constexpr float BOUNCE = 0.5f;
+
+const char *UPLOAD_STAT = "particle_upload_bytes";
+
+const char *SIMULATION_STAT = "particle_cpu_time_ms";
+
+struct SimulateConstants
+{
+	float delta_time;
+
+	float gravity;
+
+	float bounce;
+};
+
+struct EmitConstants
+{
+	/// The w component is the speed of the particles
+	glm::vec4 emitter;
+
+	uint32_t emit_count;
+
+	uint32_t max_count;
+
+	uint32_t seed;
+
+	float life;
+
+	float spread;
+};
+
+struct FinalizeConstants
+{
+	uint32_t max_count;
+
+	uint32_t workgroup_size;
+};
+
+struct ParticleUniform
+{
+	glm::mat4 view_proj;
+
+	/// The w component is the size of the particles
+	glm::vec4 camera_right;
+
+	glm::vec4 camera_up;
+};
+
+/**
+ * @brief Hash generating the random numbers of the emission, the same as in the emission shader
+ */
+uint32_t pcg_hash(uint32_t value)
+{
+	uint32_t state = value * 747796405u + 2891336453u;
+	uint32_t word  = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+float random(uint32_t &seed)
+{
+	seed = pcg_hash(seed);
+	return static_cast<float>(seed) / 4294967295.0f;
+}
+
+GpuParticles::Particle emit_particle(uint32_t index, uint32_t frame_seed, float life)
+{
+	uint32_t seed = pcg_hash(index ^ pcg_hash(frame_seed));
+
+	float angle  = 6.2831853f * random(seed);
+	float radius = EMIT_SPREAD * std::sqrt(random(seed));
+	float speed  = EMIT_SPEED * (0.8f + 0.4f * random(seed));
+
+	glm::vec3 direction = glm::normalize(glm::vec3{std::cos(angle) * radius, 1.0f, std::sin(angle) * radius});
+
+	float particle_life = life * (0.5f + 0.5f * random(seed));
+
+	return {glm::vec4{EMITTER_POSITION, particle_life}, glm::vec4{direction * speed, particle_life}};
+}
+}        // namespace
+
+GpuParticles::GpuParticles()
+{
+	auto &config = get_configuration();
+
+	config.insert<vkb::IntSetting>(0, gpu_simulation, 1);
+	config.insert<vkb::IntSetting>(1, gpu_simulation, 0);
+}
+
+bool GpuParticles::prepare(vkb::Platform &platform)
+{
+	if (!VulkanSample::prepare(platform))
+	{
+		return false;
+	}
+
+	load_scene("scenes/sponza/Sponza01.gltf");
+
+	auto &camera_node = vkb::add_free_camera(*scene, "main_camera", get_render_context().get_surface_extent());
+	camera            = dynamic_cast<vkb::sg::PerspectiveCamera *>(&camera_node.get_component<vkb::sg::Camera>());
+
+	auto &device = get_device();
+
+	// Corners 0 and 3 are opposite, the vertex shader places them from the vertex index
+	std::vector<uint16_t> indices{0, 1, 2, 2, 1, 3};
+
+	index_buffer = std::make_unique<vkb::core::Buffer>(device, indices.size() * sizeof(uint16_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	index_buffer->update(reinterpret_cast<const uint8_t *>(indices.data()), indices.size() * sizeof(uint16_t));
+	index_buffer->set_debug_name("Particle indices");
+
+	auto scene_subpass = std::make_unique<vkb::ForwardSubpass>(get_render_context(), vkb::ShaderSource{"base.vert"}, vkb::ShaderSource{"base.frag"}, *scene, *camera);
+
+	vkb::RenderPipeline render_pipeline;
+	render_pipeline.add_subpass(std::move(scene_subpass));
+	render_pipeline.add_subpass(std::make_unique<ParticleSubpass>(get_render_context(), *this));
+
+	set_render_pipeline(std::move(render_pipeline));
+
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times,
+	                                                              vkb::StatIndex::gpu_time,
+	                                                              vkb::StatIndex::vertex_compute_cycles,
+	                                                              vkb::StatIndex::l2_ext_read_bytes,
+	                                                              vkb::StatIndex::l2_ext_write_bytes});
+
+	// Measured by the sample, for both simulations
+	stats->add_named_stat(SIMULATION_STAT);
+	stats->add_named_stat(UPLOAD_STAT);
+
+	gui = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
+
+	return true;
+}
+
+void GpuParticles::update(float delta_time)
+{
+	// The particles move every frame, even when the camera does not
+	frame_delta_time = std::min(delta_time, 0.1f);
+
+	request_redraw();
+
+	VulkanSample::update(delta_time);
+}
+
+uint32_t GpuParticles::get_emit_count(float delta_time)
+{
+	// At a steady state the particles emitted during their average life reach the maximum count
+	float emit_rate = static_cast<float>(1u << particle_count_log2) / (0.75f * particle_life);
+
+	float emitted = emit_rate * delta_time + emit_remainder;
+
+	auto emit_count = static_cast<uint32_t>(emitted);
+
+	emit_remainder = emitted - static_cast<float>(emit_count);
+
+	return std::min(emit_count, 1u << particle_count_log2);
+}
+
+void GpuParticles::simulate_cpu(float delta_time)
+{
+	vkb::Timer timer;
+	timer.start();
+
+	auto max_count = 1u << particle_count_log2;
+
+	// Live particles are compacted in place
+	size_t live_count = 0;
+
+	for (auto &particle : cpu_particles)
+	{
+		particle.position.w -= delta_time;
+
+		if (particle.position.w <= 0.0f)
+		{
+			continue;
+		}
+
+		particle.velocity.y -= GRAVITY * delta_time;
+		particle.position += glm::vec4{glm::vec3{particle.velocity} * delta_time, 0.0f};
+
+		if (particle.position.y < 0.0f)
+		{
+			particle.position.y = -particle.position.y;
+			particle.velocity.y = -particle.velocity.y * BOUNCE;
+		}
+
+		cpu_particles[live_count++] = particle;
+	}
+
+	cpu_particles.resize(std::min<size_t>(live_count, max_count));
+
+	auto emit_count = std::min<size_t>(get_emit_count(delta_time), max_count - cpu_particles.size());
+
+	for (uint32_t i = 0; i < emit_count; ++i)
+	{
+		cpu_particles.push_back(emit_particle(i, emit_seed, particle_life));
+	}
+
+	auto upload_size = cpu_particles.size() * sizeof(Particle);
+
+	if (upload_size > 0)
+	{
+		cpu_particle_allocation = get_render_context().get_active_frame().allocate_buffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, upload_size);
+		cpu_particle_allocation.update(reinterpret_cast<const uint8_t *>(cpu_particles.data()), upload_size);
+	}
+	else
+	{
+		cpu_particle_allocation = {};
+	}
+
+	stats->set_named_value(SIMULATION_STAT, static_cast<float>(timer.stop<vkb::Timer::Milliseconds>()));
+	stats->set_named_value(UPLOAD_STAT, static_cast<float>(upload_size));
+}
+
+void GpuParticles::create_gpu_buffers()
+{
+	auto &device = get_device();
+
+	// The previous frames may still draw from the previous buffers
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		if (particle_buffers[i])
+		{
+			device.get_deletion_queue().release(std::move(particle_buffers[i]));
+			device.get_deletion_queue().release(std::move(counter_buffers[i]));
+		}
+	}
+
+	buffer_particle_count = 1u << particle_count_log2;
+
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		particle_buffers[i] = std::make_unique<vkb::core::Buffer>(device, buffer_particle_count * sizeof(Particle),
+		                                                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		                                                          VMA_MEMORY_USAGE_GPU_ONLY);
+		particle_buffers[i]->set_debug_name("Particles " + std::to_string(i));
+
+		counter_buffers[i] = std::make_unique<vkb::core::Buffer>(device, sizeof(Counters),
+		                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                                         VMA_MEMORY_USAGE_GPU_ONLY);
+		counter_buffers[i]->set_debug_name("Particle counters " + std::to_string(i));
+	}
+
+	reset_counters = true;
+}
+
+void GpuParticles::simulate_gpu(vkb::CommandBuffer &command_buffer)
+{
+	if (buffer_particle_count != 1u << particle_count_log2)
+	{
+		create_gpu_buffers();
+	}
+
+	uint32_t input  = current_buffer;
+	uint32_t output = 1 - current_buffer;
+
+	auto &input_particles  = *particle_buffers[input];
+	auto &input_counters   = *counter_buffers[input];
+	auto &output_particles = *particle_buffers[output];
+	auto &output_counters  = *counter_buffers[output];
+
+	// The output was last drawn two frames ago, and the input by the previous frame
+	{
+		vkb::BufferMemoryBarrier barrier{};
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		barrier.src_access_mask = 0;
+		barrier.dst_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		command_buffer.buffer_memory_barrier(output_particles, 0, VK_WHOLE_SIZE, barrier);
+		command_buffer.buffer_memory_barrier(output_counters, 0, VK_WHOLE_SIZE, barrier);
+	}
+
+	// The output starts without particles, the input has none either after the buffers are created
+	Counters counters{};
+	counters.dispatch.y      = 1;
+	counters.dispatch.z      = 1;
+	counters.draw.indexCount = 6;
+
+	std::vector<uint8_t> counters_data(reinterpret_cast<const uint8_t *>(&counters), reinterpret_cast<const uint8_t *>(&counters) + sizeof(Counters));
+
+	command_buffer.update_buffer(output_counters, 0, counters_data);
+
+	size_t upload_size = counters_data.size();
+
+	if (reset_counters)
+	{
+		command_buffer.update_buffer(input_counters, 0, counters_data);
+
+		upload_size += counters_data.size();
+
+		reset_counters = false;
+	}
+
+	{
+		vkb::BufferMemoryBarrier barrier{};
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dst_access_mask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		command_buffer.buffer_memory_barrier(output_counters, 0, VK_WHOLE_SIZE, barrier);
+		command_buffer.buffer_memory_barrier(input_counters, 0, VK_WHOLE_SIZE, barrier);
+	}
+
+	command_buffer.begin_gpu_scope("Particle simulation");
+
+	auto &resource_cache = get_device().get_resource_cache();
+
+	auto bind_shader = [&](vkb::ShaderSource &shader) {
+		std::vector<vkb::ShaderModule *> shader_modules{&resource_cache.request_shader_module(VK_SHADER_STAGE_COMPUTE_BIT, shader)};
+
+		command_buffer.bind_pipeline_layout(resource_cache.request_pipeline_layout(shader_modules, false));
+	};
+
+	// Between the kernels, which append to the same particles
+	auto compute_barrier = [&]() {
+		vkb::BufferMemoryBarrier barrier{};
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		barrier.src_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		command_buffer.buffer_memory_barrier(output_particles, 0, VK_WHOLE_SIZE, barrier);
+		command_buffer.buffer_memory_barrier(output_counters, 0, VK_WHOLE_SIZE, barrier);
+	};
+
+	// The live particles of the previous frame, as many invocations as the previous finalize wrote
+	bind_shader(simulate_shader);
+
+	command_buffer.bind_buffer(input_particles, 0, input_particles.get_size(), 0, 0, 0);
+	command_buffer.bind_buffer(input_counters, 0, input_counters.get_size(), 0, 1, 0);
+	command_buffer.bind_buffer(output_particles, 0, output_particles.get_size(), 0, 2, 0);
+	command_buffer.bind_buffer(output_counters, 0, output_counters.get_size(), 0, 3, 0);
+
+	SimulateConstants simulate_constants{};
+	simulate_constants.delta_time = frame_delta_time;
+	simulate_constants.gravity    = GRAVITY;
+	simulate_constants.bounce     = BOUNCE;
+
+	command_buffer.push_constants(0, simulate_constants);
+
+	command_buffer.dispatch_indirect(input_counters, offsetof(Counters, dispatch));
+
+	compute_barrier();
+
+	// The new particles are appended after the live ones, up to the maximum count
+	auto emit_count = get_emit_count(frame_delta_time);
+
+	if (emit_count > 0)
+	{
+		bind_shader(emit_shader);
+
+		command_buffer.bind_buffer(output_particles, 0, output_particles.get_size(), 0, 0, 0);
+		command_buffer.bind_buffer(output_counters, 0, output_counters.get_size(), 0, 1, 0);
+
+		EmitConstants emit_constants{};
+		emit_constants.emitter    = glm::vec4{EMITTER_POSITION, EMIT_SPEED};
+		emit_constants.emit_count = emit_count;
+		emit_constants.max_count  = buffer_particle_count;
+		emit_constants.seed       = emit_seed;
+		emit_constants.life       = particle_life;
+		emit_constants.spread     = EMIT_SPREAD;
+
+		command_buffer.push_constants(0, emit_constants);
+
+		get_device().get_workgroup_tuner().dispatch(command_buffer, emit_shader.get_filename(), EMIT_WORKGROUP_SIZES, emit_count);
+
+		compute_barrier();
+	}
+
+	// Clamps the count and writes the dispatch of the next simulation
+	bind_shader(finalize_shader);
+
+	command_buffer.bind_buffer(output_counters, 0, output_counters.get_size(), 0, 0, 0);
+
+	FinalizeConstants finalize_constants{};
+	finalize_constants.max_count      = buffer_particle_count;
+	finalize_constants.workgroup_size = SIMULATE_WORKGROUP_SIZE;
+
+	command_buffer.push_constants(0, finalize_constants);
+
+	command_buffer.dispatch(1, 1, 1);
+
+	command_buffer.end_gpu_scope();
+
+	// The draw reads the count and the particles, the next simulation its dispatch
+	{
+		vkb::BufferMemoryBarrier barrier{};
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		barrier.src_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dst_access_mask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+		command_buffer.buffer_memory_barrier(output_counters, 0, VK_WHOLE_SIZE, barrier);
+
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+
+		command_buffer.buffer_memory_barrier(output_particles, 0, VK_WHOLE_SIZE, barrier);
+	}
+
+	current_buffer = output;
+
+	// Only the counters are written by the CPU
+	stats->set_named_value(SIMULATION_STAT, 0.0f);
+	stats->set_named_value(UPLOAD_STAT, static_cast<float>(upload_size));
+}
+
+void GpuParticles::draw_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target)
+{
+	emit_seed++;
+
+	if (gpu_simulation)
+	{
+		// Switching back starts from no particles, as the CPU does
+		cpu_particles.clear();
+		cpu_particle_allocation = {};
+
+		simulate_gpu(command_buffer);
+	}
+	else
+	{
+		if (buffer_particle_count > 0)
+		{
+			reset_counters = true;
+		}
+
+		simulate_cpu(frame_delta_time);
+	}
+
+	VulkanSample::draw_renderpass(command_buffer, render_target);
+}
+
+void GpuParticles::draw_gui()
+{
+	gui->show_options_window(
+	    /* body = */ [this]() {
+		    ImGui::RadioButton("GPU simulation", &gpu_simulation, 1);
+		    ImGui::SameLine();
+		    ImGui::RadioButton("CPU simulation", &gpu_simulation, 0);
+
+		    ImGui::Text("Particles: %uK", (1u << particle_count_log2) / 1024);
+		    ImGui::SameLine();
+		    ImGui::SliderInt("##count", &particle_count_log2, 16, 22, "");
+	    },
+	    /* lines = */ 2);
+}
+
+GpuParticles::ParticleSubpass::ParticleSubpass(vkb::RenderContext &render_context, GpuParticles &sample) :
+    vkb::Subpass{render_context, vkb::ShaderSource{"gpu_particles/particle.vert"}, vkb::ShaderSource{"gpu_particles/particle.frag"}},
+    sample{sample}
+{
+	set_debug_name("Particles");
+
+	// Additive particles need no sorting, they are hidden by the scene but do not hide each other
+	get_depth_stencil_state().depth_write_enable = VK_FALSE;
+}
+
+void GpuParticles::ParticleSubpass::prepare()
+{
+	auto &resource_cache = render_context.get_device().get_resource_cache();
+	resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader());
+	resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader());
+}
+
+void GpuParticles::ParticleSubpass::draw(vkb::CommandBuffer &command_buffer)
+{
+	bool gpu_particles = sample.gpu_simulation && sample.particle_buffers[sample.current_buffer];
+
+	if (!gpu_particles && sample.cpu_particle_allocation.empty())
+	{
+		return;
+	}
+
+	auto &resource_cache     = command_buffer.get_device().get_resource_cache();
+	auto &vert_shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader());
+	auto &frag_shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader());
+
+	std::vector<vkb::ShaderModule *> shader_modules{&vert_shader_module, &frag_shader_module};
+
+	command_buffer.bind_pipeline_layout(resource_cache.request_pipeline_layout(shader_modules, use_dynamic_resources));
+
+	vkb::RasterizationState rasterization_state;
+	rasterization_state.cull_mode = VK_CULL_MODE_NONE;
+	command_buffer.set_rasterization_state(rasterization_state);
+
+	command_buffer.set_depth_stencil_state(get_depth_stencil_state());
+
+	vkb::ColorBlendAttachmentState color_blend_attachment{};
+	color_blend_attachment.blend_enable           = VK_TRUE;
+	color_blend_attachment.src_color_blend_factor = VK_BLEND_FACTOR_ONE;
+	color_blend_attachment.dst_color_blend_factor = VK_BLEND_FACTOR_ONE;
+	color_blend_attachment.src_alpha_blend_factor = VK_BLEND_FACTOR_ONE;
+	color_blend_attachment.dst_alpha_blend_factor = VK_BLEND_FACTOR_ONE;
+
+	vkb::ColorBlendState color_blend_state{};
+	color_blend_state.attachments.resize(get_output_attachments().size());
+	color_blend_state.attachments[0] = color_blend_attachment;
+	command_buffer.set_color_blend_state(color_blend_state);
+
+	auto &camera    = *sample.camera;
+	auto  view      = camera.get_view();
+	auto  view_proj = vkb::vulkan_style_projection(camera.get_projection()) * view;
+
+	// The rows of the view rotation are the camera axes in world space
+	ParticleUniform particle_uniform{};
+	particle_uniform.view_proj    = view_proj;
+	particle_uniform.camera_right = glm::vec4{view[0][0], view[1][0], view[2][0], sample.particle_size};
+	particle_uniform.camera_up    = glm::vec4{view[0][1], view[1][1], view[2][1], 0.0f};
+
+	command_buffer.push_constants(0, particle_uniform);
+
+	command_buffer.bind_index_buffer(*sample.index_buffer, 0, VK_INDEX_TYPE_UINT16);
+
+	if (gpu_particles)
+	{
+		auto &particles = *sample.particle_buffers[sample.current_buffer];
+		auto &counters  = *sample.counter_buffers[sample.current_buffer];
+
+		command_buffer.bind_buffer(particles, 0, particles.get_size(), 0, 0, 0);
+
+		// The instance count is the number of live particles, which the CPU does not know
+		command_buffer.draw_indexed_indirect(counters, offsetof(Counters, draw), 1, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else
+	{
+		auto &allocation = sample.cpu_particle_allocation;
+
+		command_buffer.bind_buffer(allocation.get_buffer(), allocation.get_offset(), allocation.get_size(), 0, 0, 0);
+
+		command_buffer.draw_indexed(6, vkb::to_u32(sample.cpu_particles.size()), 0, 0, 0);
+	}
+}
+
+std::unique_ptr<vkb::VulkanSample> create_gpu_particles()
+{
+	return std::make_unique<GpuParticles>();
+}
@@ -0,0 +1,171 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include "common/glm_common.h"
+VKBP_ENABLE_WARNINGS()
+
+#include "core/buffer.h"
+#include "rendering/render_pipeline.h"
+#include "rendering/subpass.h"
+#include "scene_graph/components/perspective_camera.h"
+#include "vulkan_sample.h"
+
+/**
+ * @brief Simulates a fountain of particles in compute shaders, appending the live particles of each frame to a buffer
+ *        which an indirect draw reads along with the count written by the GPU, so that the CPU never sees them.
+ *        It is compared with simulating them on the CPU, uploading all the particles every frame through the buffer
+ *        pool of the frame. The CPU time and the bytes uploaded are shown as stats, and the GPU time of the simulation
+ *        along with the gpu_time stat
+ */
+class GpuParticles : public vkb::VulkanSample
+{
+  public:
+	GpuParticles();
+
+	virtual ~GpuParticles() = default;
+
+	virtual bool prepare(vkb::Platform &platform) override;
+
+	virtual void update(float delta_time) override;
+
+	/**
+	 * @brief Draws the live particles as camera facing quads, with additive blending over the scene
+	 */
+	class ParticleSubpass : public vkb::Subpass
+	{
+	  public:
+		ParticleSubpass(vkb::RenderContext &render_context, GpuParticles &sample);
+
+		virtual void prepare() override;
+
+		virtual void draw(vkb::CommandBuffer &command_buffer) override;
+
+	  private:
+		GpuParticles &sample;
+	};
+
+	/**
+	 * @brief Particle as read by the shaders
+	 */
+	struct Particle
+	{
+		/// The w component is the remaining life, in seconds
+		glm::vec4 position;
+
+		/// The w component is the life the particle was emitted with
+		glm::vec4 velocity;
+	};
+
+	/**
+	 * @brief Dispatch of the next simulation and draw of the live particles, written by the compute shaders
+	 */
+	struct Counters
+	{
+		VkDispatchIndirectCommand dispatch;
+
+		/// The instance count is the number of live particles
+		VkDrawIndexedIndirectCommand draw;
+	};
+
+  private:
+	/**
+	 * @brief Emits and simulates the particles on the CPU, and uploads them to the buffer pool of the frame
+	 */
+	void simulate_cpu(float delta_time);
+
+	/**
+	 * @brief Records the simulation of the particles of the previous frame and the emission of the new ones
+	 */
+	void simulate_gpu(vkb::CommandBuffer &command_buffer);
+
+	/**
+	 * @brief Creates the particle and counter buffers of the GPU simulation for the maximum particle count
+	 */
+	void create_gpu_buffers();
+
+	/**
+	 * @return The number of particles to emit this frame, so that the particle count stays around its maximum
+	 */
+	uint32_t get_emit_count(float delta_time);
+
+	virtual void draw_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target) override;
+
+	virtual void draw_gui() override;
+
+	vkb::sg::PerspectiveCamera *camera{nullptr};
+
+	vkb::ShaderSource simulate_shader{"gpu_particles/simulate.comp"};
+
+	vkb::ShaderSource emit_shader{"gpu_particles/emit.comp"};
+
+	vkb::ShaderSource finalize_shader{"gpu_particles/finalize.comp"};
+
+	/// Indices of the two triangles of a particle quad
+	std::unique_ptr<vkb::core::Buffer> index_buffer;
+
+	/// Particles of the GPU simulation, read by a frame and written by the next one in turn
+	std::unique_ptr<vkb::core::Buffer> particle_buffers[2];
+
+	/// Counters of the particles of each particle buffer
+	std::unique_ptr<vkb::core::Buffer> counter_buffers[2];
+
+	/// Particle buffer written by the last simulation
+	uint32_t current_buffer{0};
+
+	/// Whether the counters must be cleared before the next GPU simulation, as when the buffers were created
+	bool reset_counters{true};
+
+	/// Particles of the CPU simulation, and their upload to the current frame
+	std::vector<Particle> cpu_particles;
+
+	vkb::BufferAllocation cpu_particle_allocation;
+
+	/// Fraction of a particle left to emit from the previous frames
+	float emit_remainder{0.0f};
+
+	float frame_delta_time{0.0f};
+
+	/// Seeds the random emission of each frame
+	uint32_t emit_seed{0};
+
+	/// Whether the particles are simulated in compute shaders, or on the CPU
+	int gpu_simulation{1};
+
+	/// Maximum number of particles as a power of two, from 64K to 4M
+	int particle_count_log2{20};
+
+	/// Particle count the GPU buffers were created for
+	uint32_t buffer_particle_count{0};
+
+	float particle_size{3.0f};
+
+	float particle_life{4.0f};
+};
+
+std::unique_ptr<vkb::VulkanSample> create_gpu_particles();
@@ -88,7 +88,7 @@ vkb::RenderTarget LayoutTransitions::create_render_target(vkb::core::Image &&swa
 
 	vkb::core::Image depth_image{device,
 	                             extent,
-	                             VK_FORMAT_D32_SFLOAT,
+	                             device.get_depth_format(),
 	                             VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
 	                             VMA_MEMORY_USAGE_GPU_ONLY};
 
@@ -144,7 +144,7 @@ void LayoutTransitions::draw(vkb::CommandBuffer &command_buffer, vkb::RenderTarg
 	{
 		// Image 0 is the swapchain
 		vkb::ImageMemoryBarrier memory_barrier{};
-		memory_barrier.old_layout      = pick_old_layout(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+		memory_barrier.old_layout      = pick_old_layout(get_render_context().get_present_layout());
 		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 		memory_barrier.src_access_mask = 0;
 		memory_barrier.dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
@@ -173,7 +173,7 @@ void LayoutTransitions::draw(vkb::CommandBuffer &command_buffer, vkb::RenderTarg
 		command_buffer.image_memory_barrier(views.at(1), memory_barrier);
 	}
 
-	auto &extent = render_target.get_extent();
+	auto &extent = render_target.get_render_extent();
 
 	VkViewport viewport{};
 	viewport.width    = static_cast<float>(extent.width);
@@ -232,7 +232,7 @@ void LayoutTransitions::draw(vkb::CommandBuffer &command_buffer, vkb::RenderTarg
 	{
 		vkb::ImageMemoryBarrier memory_barrier{};
 		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		memory_barrier.new_layout      = get_render_context().get_present_layout();
 		memory_barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
@@ -0,0 +1,99 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "level_of_detail.h"
+
+#include "common/vk_common.h"
+#include "gltf_loader.h"
+#include "gui.h"
+#include "platform/filesystem.h"
+#include "platform/platform.h"
+#include "stats.h"
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+#	include "platform/android/android_platform.h"
+#endif
+
+LevelOfDetail::LevelOfDetail()
+{
+	auto &config = get_configuration();
+
+	config.insert<vkb::BoolSetting>(0, lod_selection, true);
+	config.insert<vkb::BoolSetting>(1, lod_selection, false);
+}
+
+bool LevelOfDetail::prepare(vkb::Platform &platform)
+{
+	if (!VulkanSample::prepare(platform))
+	{
+		return false;
+	}
+
+	generate_scene_lods = true;
+
+	load_scene("scenes/sponza/Sponza01.gltf");
+
+	auto &camera_node = vkb::add_free_camera(*scene, "main_camera", get_render_context().get_surface_extent());
+	camera            = &camera_node.get_component<vkb::sg::Camera>();
+
+	vkb::ShaderSource vert_shader("base.vert");
+	vkb::ShaderSource frag_shader("base.frag");
+	auto              subpass = std::make_unique<vkb::ForwardSubpass>(get_render_context(), std::move(vert_shader), std::move(frag_shader), *scene, *camera);
+
+	scene_subpass = subpass.get();
+
+	auto render_pipeline = vkb::RenderPipeline();
+	render_pipeline.add_subpass(std::move(subpass));
+
+	set_render_pipeline(std::move(render_pipeline));
+
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times,
+	                                                              vkb::StatIndex::vertex_compute_cycles,
+	                                                              vkb::StatIndex::tiles});
+	gui   = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
+
+	return true;
+}
+
+void LevelOfDetail::update(float delta_time)
+{
+	// Only the draws change, the pipelines stay the same
+	scene_subpass->set_lod_selection(lod_selection);
+
+	VulkanSample::update(delta_time);
+}
+
+void LevelOfDetail::draw_gui()
+{
+	auto &culling_stats = scene_subpass->get_culling_stats();
+
+	gui->show_options_window(
+	    /* body = */ [this, &culling_stats]() {
+		    ImGui::Checkbox("Levels of detail", &lod_selection);
+
+		    ImGui::Text("Visible: %u, simplified: %u", culling_stats.visible, culling_stats.simplified);
+	    },
+	    /* lines = */ 2);
+}
+
+std::unique_ptr<vkb::VulkanSample> create_level_of_detail()
+{
+	return std::make_unique<LevelOfDetail>();
+}
@@ -0,0 +1,246 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "msaa.h"
+
+#include "common/vk_common.h"
+#include "gltf_loader.h"
+#include "gui.h"
+#include "platform/filesystem.h"
+#include "platform/platform.h"
+#include "rendering/subpasses/forward_subpass.h"
+#include "stats.h"
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+#	include "platform/android/android_platform.h"
+#endif
+
+namespace
+{
+const VkSampleCountFlagBits sample_counts[] = {VK_SAMPLE_COUNT_1_BIT, VK_SAMPLE_COUNT_2_BIT, VK_SAMPLE_COUNT_4_BIT};
+}        // namespace
+
+MSAA::MSAA()
+{
+	auto &config = get_configuration();
+
+	// 4x resolved on-tile, 4x resolved in memory and no multisampling
+	config.insert<vkb::IntSetting>(0, sample_count, 2);
+	config.insert<vkb::IntSetting>(0, resolve, 0);
+
+	config.insert<vkb::IntSetting>(1, sample_count, 2);
+	config.insert<vkb::IntSetting>(1, resolve, 1);
+
+	config.insert<vkb::IntSetting>(2, sample_count, 0);
+	config.insert<vkb::IntSetting>(2, resolve, 0);
+}
+
+bool MSAA::prepare(vkb::Platform &platform)
+{
+	if (!VulkanSample::prepare(platform))
+	{
+		return false;
+	}
+
+	// The swapchain image is the destination of vkCmdResolveImage
+	get_render_context().update_swapchain(std::set<VkImageUsageFlagBits>{VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_USAGE_TRANSFER_DST_BIT});
+
+	auto &limits            = get_device().get_properties().limits;
+	supported_sample_counts = limits.framebufferColorSampleCounts & limits.framebufferDepthSampleCounts;
+
+	load_scene("scenes/sponza/Sponza01.gltf");
+
+	auto &camera_node = vkb::add_free_camera(*scene, "main_camera", get_render_context().get_surface_extent());
+	camera            = &camera_node.get_component<vkb::sg::Camera>();
+
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times,
+	                                                              vkb::StatIndex::l2_ext_read_bytes,
+	                                                              vkb::StatIndex::l2_ext_write_bytes});
+	gui   = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
+
+	update_pipeline();
+
+	return true;
+}
+
+void MSAA::update_pipeline()
+{
+	auto samples = sample_counts[sample_count];
+
+	if (!(supported_sample_counts & samples))
+	{
+		LOGW("{}x multisampling is not supported, disabling it", static_cast<uint32_t>(samples));
+		sample_count = 0;
+		samples      = VK_SAMPLE_COUNT_1_BIT;
+	}
+
+	last_sample_count = sample_count;
+	last_resolve      = resolve;
+
+	auto &render_context = get_render_context();
+
+	// The render targets of the frames in flight are replaced
+	get_device().wait_idle();
+
+	bool multisampled = samples != VK_SAMPLE_COUNT_1_BIT;
+
+	if (multisampled)
+	{
+		render_context.set_render_target_create_func(vkb::RenderTarget::create_multisampled_func(samples, resolve == 0));
+	}
+	else
+	{
+		render_context.set_render_target_create_func(vkb::RenderTarget::DEFAULT_CREATE_FUNC);
+	}
+
+	render_context.recreate();
+
+	vkb::ShaderSource vert_shader("base.vert");
+	vkb::ShaderSource frag_shader("base.frag");
+	auto              scene_subpass = std::make_unique<vkb::ForwardSubpass>(render_context, std::move(vert_shader), std::move(frag_shader), *scene, *camera);
+
+	auto render_pipeline = vkb::RenderPipeline();
+
+	if (multisampled)
+	{
+		scene_subpass->set_output_attachments({vkb::RenderTarget::MULTISAMPLED_COLOR});
+
+		// Neither the samples of the depth nor the ones of the color need to be stored when resolving on-tile
+		std::vector<vkb::LoadStoreInfo> load_store(3);
+		load_store[0] = {VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+		load_store[1] = {VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE};
+
+		if (resolve == 0)
+		{
+			scene_subpass->set_color_resolve_attachments({0});
+			load_store[2] = {VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE};
+		}
+		else
+		{
+			load_store[0].store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			load_store[2]          = {VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE};
+		}
+
+		std::vector<VkClearValue> clear_values(3);
+		clear_values[1].depthStencil = {0.0f, ~0U};
+		clear_values[2].color        = {{0.0f, 0.0f, 0.0f, 1.0f}};
+
+		render_pipeline.set_load_store(load_store);
+		render_pipeline.set_clear_value(clear_values);
+	}
+
+	render_pipeline.add_subpass(std::move(scene_subpass));
+
+	set_render_pipeline(std::move(render_pipeline));
+}
+
+void MSAA::update(float delta_time)
+{
+	if (sample_count != last_sample_count || resolve != last_resolve)
+	{
+		LOGI("Recreating render targets");
+		update_pipeline();
+	}
+
+	VulkanSample::update(delta_time);
+}
+
+void MSAA::draw_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target)
+{
+	VulkanSample::draw_renderpass(command_buffer, render_target);
+
+	auto &views = render_target.get_views();
+
+	if (views.size() <= vkb::RenderTarget::MULTISAMPLED_COLOR || resolve == 0)
+	{
+		return;
+	}
+
+	// The samples were stored by the render pass, and are read back to be resolved
+	auto &color_view = views.at(vkb::RenderTarget::MULTISAMPLED_COLOR);
+	auto &swapchain  = views.at(0);
+
+	{
+		vkb::ImageMemoryBarrier barrier{};
+		barrier.old_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barrier.new_layout      = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barrier.dst_access_mask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		command_buffer.image_memory_barrier(color_view, barrier);
+
+		barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.new_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.src_access_mask = 0;
+		barrier.dst_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		command_buffer.image_memory_barrier(swapchain, barrier);
+	}
+
+	auto &extent = render_target.get_extent();
+
+	VkImageResolve region{};
+	region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+	region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+	region.extent         = {extent.width, extent.height, 1};
+
+	command_buffer.resolve_image(color_view.get_image(), swapchain.get_image(), {region});
+
+	// VulkanSample::draw presents the swapchain image from a color attachment
+	{
+		vkb::ImageMemoryBarrier barrier{};
+		barrier.old_layout      = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.new_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barrier.src_stage_mask  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		barrier.src_access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+		command_buffer.image_memory_barrier(swapchain, barrier);
+	}
+}
+
+void MSAA::draw_gui()
+{
+	gui->show_options_window(
+	    /* body = */ [this]() {
+		    ImGui::Text("Samples: ");
+		    ImGui::SameLine();
+		    ImGui::RadioButton("1x", &sample_count, 0);
+		    ImGui::SameLine();
+		    ImGui::RadioButton("2x", &sample_count, 1);
+		    ImGui::SameLine();
+		    ImGui::RadioButton("4x", &sample_count, 2);
+
+		    ImGui::Text("Resolve: ");
+		    ImGui::SameLine();
+		    ImGui::RadioButton("Resolve attachment", &resolve, 0);
+		    ImGui::SameLine();
+		    ImGui::RadioButton("vkCmdResolveImage", &resolve, 1);
+	    },
+	    /* lines = */ 2);
+}
+
+std::unique_ptr<vkb::VulkanSample> create_msaa()
+{
+	return std::make_unique<MSAA>();
+}
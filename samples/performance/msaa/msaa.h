@@ -0,0 +1,67 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "rendering/render_pipeline.h"
+#include "scene_graph/components/camera.h"
+#include "vulkan_sample.h"
+
+/**
+ * @brief Multisampled rendering resolved either by resolve attachments at the end of the subpass,
+ *        which keeps the samples in tile memory, or by vkCmdResolveImage after the render pass
+ */
+class MSAA : public vkb::VulkanSample
+{
+  public:
+	MSAA();
+
+	virtual ~MSAA() = default;
+
+	virtual bool prepare(vkb::Platform &platform) override;
+
+	virtual void update(float delta_time) override;
+
+  private:
+	/**
+	 * @brief Recreates the render targets and the render pipeline from the selected options
+	 */
+	void update_pipeline();
+
+	virtual void draw_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target) override;
+
+	virtual void draw_gui() override;
+
+	vkb::sg::Camera *camera{nullptr};
+
+	/// Selected sample count, 0 for 1x, 1 for 2x and 2 for 4x
+	int sample_count{2};
+
+	/// Selected resolve, 0 for resolve attachments and 1 for vkCmdResolveImage
+	int resolve{0};
+
+	int last_sample_count{-1};
+
+	int last_resolve{-1};
+
+	VkSampleCountFlags supported_sample_counts{VK_SAMPLE_COUNT_1_BIT};
+};
+
+std::unique_ptr<vkb::VulkanSample> create_msaa();
@@ -0,0 +1,309 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "multiview.h"
+
+#include "common/error.h"
+
+VKBP_DISABLE_WARNINGS()
+#include <glm/gtc/matrix_transform.hpp>
+VKBP_ENABLE_WARNINGS()
+
+#include "common/utils.h"
+#include "common/vk_common.h"
+#include "core/command_buffer.h"
+#include "gui.h"
+#include "platform/platform.h"
+#include "rendering/render_context.h"
+#include "scene_graph/components/camera.h"
+#include "stats.h"
+
+Multiview::Multiview()
+{
+	auto &config = get_configuration();
+
+	config.insert<vkb::IntSetting>(0, multiview, 1);
+	config.insert<vkb::IntSetting>(1, multiview, 0);
+}
+
+bool Multiview::prepare(vkb::Platform &platform)
+{
+	if (!VulkanSample::prepare(platform))
+	{
+		return false;
+	}
+
+	auto &device = get_device();
+
+	// Even one render pass per eye needs multiview to render to the second layer
+	if (!device.supports_multiview() || device.get_max_multiview_view_count() < EYE_COUNT)
+	{
+		LOGE("Multiview is not supported, it is needed to render to the layers of the stereo render target");
+		return false;
+	}
+
+	load_scene("scenes/sponza/Sponza01.gltf");
+
+	auto &camera_node = vkb::add_free_camera(*scene, "main_camera", get_render_context().get_surface_extent());
+	camera            = dynamic_cast<vkb::sg::PerspectiveCamera *>(&camera_node.get_component<vkb::sg::Camera>());
+
+	create_stereo_render_target(get_render_context().get_surface_extent());
+
+	auto subpass = std::make_unique<vkb::ForwardSubpass>(get_render_context(), vkb::ShaderSource{"base.vert"}, vkb::ShaderSource{"base.frag"}, *scene, *camera);
+
+	// Chosen before prepare so that the shaders read the matrix of their view, the eyes drawn are chosen every frame
+	subpass->set_view_mask((1U << EYE_COUNT) - 1U);
+	scene_subpass = subpass.get();
+
+	stereo_render_pipeline = std::make_unique<vkb::RenderPipeline>();
+	stereo_render_pipeline->add_subpass(std::move(subpass));
+
+	// Both eyes are sampled side by side on the swapchain
+	VkSamplerCreateInfo sampler_info{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+	sampler_info.magFilter    = VK_FILTER_LINEAR;
+	sampler_info.minFilter    = VK_FILTER_LINEAR;
+	sampler_info.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+	stereo_sampler = &device.get_resource_cache().request_sampler(sampler_info);
+
+	auto render_pipeline = vkb::RenderPipeline();
+	render_pipeline.add_subpass(std::make_unique<StereoSubpass>(get_render_context(), *this));
+
+	set_render_pipeline(std::move(render_pipeline));
+
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times,
+	                                                              vkb::StatIndex::cpu_cycles,
+	                                                              vkb::StatIndex::gpu_time,
+	                                                              vkb::StatIndex::vertex_compute_cycles,
+	                                                              vkb::StatIndex::l2_ext_read_bytes});
+	gui   = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
+
+	return true;
+}
+
+void Multiview::resize(const uint32_t width, const uint32_t height)
+{
+	// The scripts give the camera the aspect ratio of the window
+	VulkanSample::resize(width, height);
+
+	if (!stereo_render_target)
+	{
+		return;
+	}
+
+	VkExtent2D surface_extent{width, height};
+
+	if (stereo_render_target->get_extent().width != std::max(surface_extent.width / EYE_COUNT, 1U) ||
+	    stereo_render_target->get_extent().height != surface_extent.height)
+	{
+		get_device().wait_idle();
+
+		create_stereo_render_target(surface_extent);
+	}
+}
+
+void Multiview::create_stereo_render_target(const VkExtent2D &surface_extent)
+{
+	auto &device = get_device();
+
+	VkExtent3D extent{std::max(surface_extent.width / EYE_COUNT, 1U), surface_extent.height, 1};
+
+	vkb::core::Image color_image{device,
+	                             extent,
+	                             get_render_context().get_swapchain().get_format(),
+	                             VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	                             VMA_MEMORY_USAGE_GPU_ONLY,
+	                             VK_SAMPLE_COUNT_1_BIT,
+	                             1,
+	                             EYE_COUNT};
+
+	vkb::core::Image depth_image{device,
+	                             extent,
+	                             device.get_depth_format(),
+	                             VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+	                             VMA_MEMORY_USAGE_GPU_ONLY,
+	                             VK_SAMPLE_COUNT_1_BIT,
+	                             1,
+	                             EYE_COUNT};
+
+	std::vector<vkb::core::Image> images;
+	images.push_back(std::move(color_image));
+	images.push_back(std::move(depth_image));
+
+	stereo_render_target = std::make_unique<vkb::RenderTarget>(std::move(images));
+
+	// Each eye covers half of the surface
+	camera->set_aspect_ratio(static_cast<float>(extent.width) / extent.height);
+}
+
+void Multiview::draw_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target)
+{
+	auto &views  = stereo_render_target->get_views();
+	auto &extent = stereo_render_target->get_extent();
+
+	// Each eye is offset from the camera along its right axis, the culling uses the frustum of the camera
+	auto view       = camera->get_view();
+	auto projection = vkb::vulkan_style_projection(camera->get_projection());
+
+	std::vector<glm::mat4> view_projections;
+
+	for (uint32_t eye = 0; eye < EYE_COUNT; ++eye)
+	{
+		float offset = (eye == 0 ? 0.5f : -0.5f) * eye_separation;
+
+		view_projections.push_back(projection * glm::translate(glm::mat4(1.0f), glm::vec3(offset, 0.0f, 0.0f)) * view);
+	}
+
+	scene_subpass->set_view_projections(view_projections);
+
+	{
+		// The previous frame may still sample the eyes
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		memory_barrier.src_access_mask = 0;
+		memory_barrier.dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+		command_buffer.image_memory_barrier(views.at(0), memory_barrier);
+	}
+
+	{
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		memory_barrier.src_access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+		command_buffer.image_memory_barrier(views.at(1), memory_barrier);
+	}
+
+	VkViewport viewport{};
+	viewport.width    = static_cast<float>(extent.width);
+	viewport.height   = static_cast<float>(extent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	command_buffer.set_viewport(0, {viewport});
+
+	VkRect2D scissor{};
+	scissor.extent = extent;
+	command_buffer.set_scissor(0, {scissor});
+
+	if (multiview)
+	{
+		// The draws are recorded once and broadcast to both layers
+		scene_subpass->set_view_mask((1U << EYE_COUNT) - 1U);
+
+		stereo_render_pipeline->draw(command_buffer, *stereo_render_target);
+
+		command_buffer.end_render_pass();
+	}
+	else
+	{
+		// The draws are culled and recorded again for each eye
+		for (uint32_t eye = 0; eye < EYE_COUNT; ++eye)
+		{
+			scene_subpass->set_view_mask(1U << eye);
+
+			stereo_render_pipeline->draw(command_buffer, *stereo_render_target);
+
+			command_buffer.end_render_pass();
+		}
+	}
+
+	{
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		memory_barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		memory_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+		command_buffer.image_memory_barrier(views.at(0), memory_barrier);
+	}
+
+	VulkanSample::draw_renderpass(command_buffer, render_target);
+}
+
+void Multiview::draw_gui()
+{
+	gui->show_options_window(
+	    /* body = */ [this]() {
+		    ImGui::RadioButton("Multiview", &multiview, 1);
+		    ImGui::SameLine();
+		    ImGui::RadioButton("Render pass per eye", &multiview, 0);
+
+		    ImGui::SliderFloat("Eye separation", &eye_separation, 0.0f, 20.0f);
+	    },
+	    /* lines = */ 2);
+}
+
+Multiview::StereoSubpass::StereoSubpass(vkb::RenderContext &render_context, Multiview &sample) :
+    vkb::Subpass{render_context, vkb::ShaderSource{"post_processing/fullscreen.vert"}, vkb::ShaderSource{"multiview/stereo.frag"}},
+    sample{sample}
+{
+	set_debug_name("Stereo");
+
+	// The full screen triangle covers every pixel, the depth attachment is not used
+	auto &depth_stencil_state              = get_depth_stencil_state();
+	depth_stencil_state.depth_test_enable  = VK_FALSE;
+	depth_stencil_state.depth_write_enable = VK_FALSE;
+}
+
+void Multiview::StereoSubpass::prepare()
+{
+	auto &resource_cache = render_context.get_device().get_resource_cache();
+	resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader());
+	resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader());
+}
+
+void Multiview::StereoSubpass::draw(vkb::CommandBuffer &command_buffer)
+{
+	auto &resource_cache     = command_buffer.get_device().get_resource_cache();
+	auto &vert_shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, get_vertex_shader());
+	auto &frag_shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, get_fragment_shader());
+
+	std::vector<vkb::ShaderModule *> shader_modules{&vert_shader_module, &frag_shader_module};
+
+	command_buffer.bind_pipeline_layout(resource_cache.request_pipeline_layout(shader_modules, use_dynamic_resources));
+
+	command_buffer.bind_image(sample.stereo_render_target->get_views().at(0), *sample.stereo_sampler, 0, 0, 0);
+
+	// The full screen triangle is clockwise
+	vkb::RasterizationState rasterization_state;
+	rasterization_state.cull_mode = VK_CULL_MODE_NONE;
+	command_buffer.set_rasterization_state(rasterization_state);
+
+	command_buffer.set_depth_stencil_state(get_depth_stencil_state());
+
+	command_buffer.draw(3, 1, 0, 0);
+}
+
+std::unique_ptr<vkb::VulkanSample> create_multiview()
+{
+	return std::make_unique<Multiview>();
+}
@@ -0,0 +1,96 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "core/sampler.h"
+#include "rendering/render_pipeline.h"
+#include "rendering/render_target.h"
+#include "rendering/subpass.h"
+#include "rendering/subpasses/forward_subpass.h"
+#include "scene_graph/components/perspective_camera.h"
+#include "vulkan_sample.h"
+
+/**
+ * @brief Renders the scene for both eyes of a stereo pair, to the two layers of an array render target,
+ *        in a single multiview render pass (VK_KHR_multiview) or in one render pass per eye.
+ *        Both eyes are then shown side by side
+ */
+class Multiview : public vkb::VulkanSample
+{
+  public:
+	Multiview();
+
+	virtual ~Multiview() = default;
+
+	virtual bool prepare(vkb::Platform &platform) override;
+
+	virtual void resize(const uint32_t width, const uint32_t height) override;
+
+	/**
+	 * @brief Draws the two layers of the stereo render target side by side on a full screen triangle
+	 */
+	class StereoSubpass : public vkb::Subpass
+	{
+	  public:
+		StereoSubpass(vkb::RenderContext &render_context, Multiview &sample);
+
+		virtual void prepare() override;
+
+		virtual void draw(vkb::CommandBuffer &command_buffer) override;
+
+	  private:
+		Multiview &sample;
+	};
+
+  private:
+	/// Views of the stereo render target, one per eye
+	static constexpr uint32_t EYE_COUNT = 2;
+
+	/**
+	 * @brief Creates the color and depth arrays the eyes are rendered to, each eye covering half of the surface
+	 */
+	void create_stereo_render_target(const VkExtent2D &surface_extent);
+
+	virtual void draw_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target) override;
+
+	virtual void draw_gui() override;
+
+	vkb::sg::PerspectiveCamera *camera{nullptr};
+
+	std::unique_ptr<vkb::RenderTarget> stereo_render_target;
+
+	std::unique_ptr<vkb::RenderPipeline> stereo_render_pipeline;
+
+	/// Owned by the stereo render pipeline
+	vkb::ForwardSubpass *scene_subpass{nullptr};
+
+	const vkb::core::Sampler *stereo_sampler{nullptr};
+
+	/// Whether the eyes are rendered in a single multiview render pass, or one render pass each
+	int multiview{1};
+
+	/// Distance between the eyes, in scene units
+	float eye_separation{6.4f};
+};
+
+std::unique_ptr<vkb::VulkanSample> create_multiview();
@@ -0,0 +1,115 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "occlusion_culling.h"
+
+#include "common/vk_common.h"
+#include "gltf_loader.h"
+#include "gui.h"
+#include "platform/filesystem.h"
+#include "platform/platform.h"
+#include "stats.h"
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+#	include "platform/android/android_platform.h"
+#endif
+
+OcclusionCulling::OcclusionCulling()
+{
+	auto &config = get_configuration();
+
+	config.insert<vkb::BoolSetting>(0, occlusion_culling, true);
+	config.insert<vkb::BoolSetting>(1, occlusion_culling, false);
+}
+
+bool OcclusionCulling::prepare(vkb::Platform &platform)
+{
+	if (!VulkanSample::prepare(platform))
+	{
+		return false;
+	}
+
+	load_scene("scenes/sponza/Sponza01.gltf");
+
+	auto &camera_node = vkb::add_free_camera(*scene, "main_camera", get_render_context().get_surface_extent());
+	camera            = &camera_node.get_component<vkb::sg::Camera>();
+
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times,
+	                                                              vkb::StatIndex::gpu_time,
+	                                                              vkb::StatIndex::vertex_compute_cycles,
+	                                                              vkb::StatIndex::fragment_cycles});
+	gui   = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
+
+	update_pipeline();
+
+	return true;
+}
+
+void OcclusionCulling::update_pipeline()
+{
+	last_occlusion_culling = occlusion_culling;
+
+	auto &render_context = get_render_context();
+
+	// The pipeline of the frames in flight is replaced
+	get_device().wait_idle();
+
+	vkb::ShaderSource vert_shader("base.vert");
+	vkb::ShaderSource frag_shader("base.frag");
+	auto              subpass = std::make_unique<vkb::ForwardSubpass>(render_context, std::move(vert_shader), std::move(frag_shader), *scene, *camera);
+
+	subpass->set_occlusion_culling(occlusion_culling);
+
+	scene_subpass = subpass.get();
+
+	auto render_pipeline = vkb::RenderPipeline();
+	render_pipeline.add_subpass(std::move(subpass));
+
+	set_render_pipeline(std::move(render_pipeline));
+}
+
+void OcclusionCulling::update(float delta_time)
+{
+	if (occlusion_culling != last_occlusion_culling)
+	{
+		LOGI("Recreating render pipeline");
+		update_pipeline();
+	}
+
+	VulkanSample::update(delta_time);
+}
+
+void OcclusionCulling::draw_gui()
+{
+	auto &culling_stats = scene_subpass->get_culling_stats();
+
+	gui->show_options_window(
+	    /* body = */ [this, &culling_stats]() {
+		    ImGui::Checkbox("Occlusion culling", &occlusion_culling);
+
+		    ImGui::Text("Visible: %u, occluded: %u, outside frustum: %u", culling_stats.visible, culling_stats.occlusion_culled, culling_stats.frustum_culled);
+	    },
+	    /* lines = */ 2);
+}
+
+std::unique_ptr<vkb::VulkanSample> create_occlusion_culling()
+{
+	return std::make_unique<OcclusionCulling>();
+}
@@ -0,0 +1,60 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "rendering/render_pipeline.h"
+#include "rendering/subpasses/forward_subpass.h"
+#include "scene_graph/components/camera.h"
+#include "vulkan_sample.h"
+
+/**
+ * @brief Renders the scene with or without occlusion culling, which skips the objects whose
+ *        bounding box was hidden by the opaque objects according to queries from a previous frame
+ */
+class OcclusionCulling : public vkb::VulkanSample
+{
+  public:
+	OcclusionCulling();
+
+	virtual ~OcclusionCulling() = default;
+
+	virtual bool prepare(vkb::Platform &platform) override;
+
+	virtual void update(float delta_time) override;
+
+  private:
+	/**
+	 * @brief Recreates the render pipeline, with occlusion culling if it is enabled
+	 */
+	void update_pipeline();
+
+	virtual void draw_gui() override;
+
+	vkb::sg::Camera *camera{nullptr};
+
+	vkb::ForwardSubpass *scene_subpass{nullptr};
+
+	bool occlusion_culling{true};
+
+	bool last_occlusion_culling{true};
+};
+
+std::unique_ptr<vkb::VulkanSample> create_occlusion_culling();
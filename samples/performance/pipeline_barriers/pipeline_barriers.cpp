@@ -105,7 +105,8 @@ bool PipelineBarriers::prepare(vkb::Platform &platform)
 
 	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times,
 	                                                              vkb::StatIndex::vertex_compute_cycles,
-	                                                              vkb::StatIndex::fragment_cycles},
+	                                                              vkb::StatIndex::fragment_cycles,
+	                                                              vkb::StatIndex::gpu_time},
 	                                     vkb::CounterSamplingConfig{vkb::CounterSamplingMode::Continuous});
 	gui   = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
 
@@ -124,7 +125,7 @@ vkb::RenderTarget PipelineBarriers::create_render_target(vkb::core::Image &&swap
 
 	vkb::core::Image depth_image{device,
 	                             extent,
-	                             VK_FORMAT_D32_SFLOAT,
+	                             device.get_depth_format(),
 	                             VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
 	                             VMA_MEMORY_USAGE_GPU_ONLY};
 
@@ -235,7 +236,7 @@ void PipelineBarriers::draw(vkb::CommandBuffer &command_buffer, vkb::RenderTarge
 		command_buffer.image_memory_barrier(views.at(1), memory_barrier);
 	}
 
-	auto &extent = render_target.get_extent();
+	auto &extent = render_target.get_render_extent();
 
 	VkViewport viewport{};
 	viewport.width    = static_cast<float>(extent.width);
@@ -319,7 +320,7 @@ void PipelineBarriers::draw(vkb::CommandBuffer &command_buffer, vkb::RenderTarge
 	{
 		vkb::ImageMemoryBarrier memory_barrier{};
 		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		memory_barrier.new_layout      = get_render_context().get_present_layout();
 		memory_barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
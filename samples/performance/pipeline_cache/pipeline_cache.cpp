@@ -30,6 +30,7 @@
 #include "rendering/subpasses/forward_subpass.h"
 #include "scene_graph/node.h"
 #include "stats.h"
+#include "timer.h"
 
 PipelineCache::PipelineCache()
 {
@@ -41,24 +42,16 @@ PipelineCache::PipelineCache()
 
 PipelineCache::~PipelineCache()
 {
+	/* Write the pipeline cache data, if any, and the recorded resources to a single file */
+	vkb::ResourceCache &resource_cache = device->get_resource_cache();
+	resource_cache.set_pipeline_cache(pipeline_cache);
+	resource_cache.serialize("cache.data");
+
 	if (pipeline_cache != VK_NULL_HANDLE)
 	{
-		/* Get size of pipeline cache */
-		size_t size{};
-		VK_CHECK(vkGetPipelineCacheData(device->get_handle(), pipeline_cache, &size, nullptr));
-
-		/* Get data of pipeline cache */
-		std::vector<uint8_t> data(size);
-		VK_CHECK(vkGetPipelineCacheData(device->get_handle(), pipeline_cache, &size, data.data()));
-
-		/* Write pipeline cache data to a file in binary format */
-		vkb::fs::write_temp(data, "pipeline_cache.data");
-
 		/* Destroy Vulkan pipeline cache */
 		vkDestroyPipelineCache(device->get_handle(), pipeline_cache, nullptr);
 	}
-
-	vkb::fs::write_temp(device->get_resource_cache().serialize(), "cache.data");
 }
 
 bool PipelineCache::prepare(vkb::Platform &platform)
@@ -68,22 +61,13 @@ bool PipelineCache::prepare(vkb::Platform &platform)
 		return false;
 	}
 
-	/* Try to read pipeline cache file if exists */
-	std::vector<uint8_t> pipeline_data;
-
-	try
-	{
-		pipeline_data = vkb::fs::read_temp("pipeline_cache.data");
-	}
-	catch (std::runtime_error &ex)
-	{
-		LOGW("No pipeline cache found. {}", ex.what());
-	}
+	/* Map the cache file if it exists and was written for this device */
+	vkb::ResourceCacheFile cache_file{*device, "cache.data"};
 
 	/* Add initial pipeline cache data from the cached file */
 	VkPipelineCacheCreateInfo create_info{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
-	create_info.initialDataSize = pipeline_data.size();
-	create_info.pInitialData    = pipeline_data.data();
+	create_info.initialDataSize = cache_file.get_pipeline_cache_size();
+	create_info.pInitialData    = cache_file.get_pipeline_cache_data();
 
 	/* Create Vulkan pipeline cache */
 	VK_CHECK(vkCreatePipelineCache(device->get_handle(), &create_info, nullptr, &pipeline_cache));
@@ -93,19 +77,8 @@ bool PipelineCache::prepare(vkb::Platform &platform)
 	// Use pipeline cache to store pipelines
 	resource_cache.set_pipeline_cache(pipeline_cache);
 
-	std::vector<uint8_t> data_cache;
-
-	try
-	{
-		data_cache = vkb::fs::read_temp("cache.data");
-	}
-	catch (std::runtime_error &ex)
-	{
-		LOGW("No data cache found. {}", ex.what());
-	}
-
 	// Build all pipelines from a previous run
-	resource_cache.warmup(data_cache);
+	resource_cache.warmup(cache_file);
 
 	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times});
 
@@ -155,9 +128,25 @@ void PipelineCache::draw_gui()
 
 		    ImGui::SameLine();
 
+		    if (ImGui::Checkbox("Async compilation", &enable_async_compilation))
+		    {
+			    // Skip draws whose pipelines are still being built instead of stalling the frame
+			    device->get_resource_cache().set_pipeline_compilation(enable_async_compilation ? vkb::PipelineCompilation::AsyncSkip : vkb::PipelineCompilation::Synchronous,
+			                                                          std::thread::hardware_concurrency());
+		    }
+
+		    ImGui::SameLine();
+
+		    if (ImGui::Checkbox("Per-thread caches", &enable_per_thread_caches))
+		    {
+			    // Compile threads stop contending on the lock of the shared cache
+			    device->get_resource_cache().set_per_thread_pipeline_caches(enable_per_thread_caches);
+		    }
+
+		    ImGui::SameLine();
+
 		    if (ImGui::Button("Destroy Pipelines", button_size))
 		    {
-			    device->wait_idle();
 			    device->get_resource_cache().clear_pipelines();
 			    record_frame_time_next_frame = true;
 		    }
@@ -170,8 +159,96 @@ void PipelineCache::draw_gui()
 		    {
 			    ImGui::Text("Pipeline rebuild frame time: N/A");
 		    }
+
+		    ImGui::SameLine();
+
+		    if (ImGui::Button("Benchmark compile", button_size))
+		    {
+			    run_compile_benchmark();
+		    }
+
+		    for (auto &result : compile_benchmark_results)
+		    {
+			    ImGui::Text("%u threads: shared cache %.1f ms, per-thread caches %.1f ms", result.thread_count, result.shared_cache_ms, result.per_thread_caches_ms);
+		    }
 	    },
-	    /* lines = */ 2);
+	    /* lines = */ 2 + vkb::to_u32(compile_benchmark_results.size()));
+}
+
+void PipelineCache::run_compile_benchmark()
+{
+	vkb::ResourceCache &resource_cache = device->get_resource_cache();
+
+	// The pipelines of the scene, built by the previous frames
+	std::vector<vkb::PipelineState> pipeline_states;
+
+	for (auto &entry : resource_cache.get_internal_state().graphics_pipelines)
+	{
+		pipeline_states.push_back(entry.second.get_state());
+	}
+
+	if (pipeline_states.empty())
+	{
+		return;
+	}
+
+	compile_benchmark_results.clear();
+
+	uint32_t max_thread_count = std::max(1U, std::thread::hardware_concurrency());
+
+	for (uint32_t thread_count = 1; thread_count <= max_thread_count; thread_count *= 2)
+	{
+		CompileBenchmarkResult result;
+		result.thread_count = thread_count;
+
+		for (bool per_thread_caches : {false, true})
+		{
+			// An empty pipeline cache for each run, so that every pipeline is compiled
+			VkPipelineCacheCreateInfo create_info{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+
+			VkPipelineCache benchmark_cache{VK_NULL_HANDLE};
+			VK_CHECK(vkCreatePipelineCache(device->get_handle(), &create_info, nullptr, &benchmark_cache));
+
+			resource_cache.clear_pipelines();
+			resource_cache.set_pipeline_cache(benchmark_cache);
+			resource_cache.set_pipeline_compilation(vkb::PipelineCompilation::AsyncSkip, thread_count);
+			resource_cache.set_per_thread_pipeline_caches(per_thread_caches);
+
+			vkb::Timer timer;
+			timer.start();
+
+			for (auto &pipeline_state : pipeline_states)
+			{
+				resource_cache.request_graphics_pipeline_async(pipeline_state);
+			}
+
+			resource_cache.wait_pending_pipelines();
+
+			// Merging is part of the cost of per-thread caches
+			resource_cache.merge_pipeline_caches();
+
+			auto elapsed = timer.stop<vkb::Timer::Milliseconds>();
+
+			(per_thread_caches ? result.per_thread_caches_ms : result.shared_cache_ms) = static_cast<float>(elapsed);
+
+			resource_cache.set_per_thread_pipeline_caches(false);
+			resource_cache.set_pipeline_cache(VK_NULL_HANDLE);
+
+			vkDestroyPipelineCache(device->get_handle(), benchmark_cache, nullptr);
+		}
+
+		LOGI("Compiled {} pipelines on {} threads: {:.1f} ms with a shared cache, {:.1f} ms with per-thread caches",
+		     pipeline_states.size(), thread_count, result.shared_cache_ms, result.per_thread_caches_ms);
+
+		compile_benchmark_results.push_back(result);
+	}
+
+	// Back to the settings of the GUI, the pipelines are rebuilt by the next frame
+	resource_cache.clear_pipelines();
+	resource_cache.set_pipeline_cache(enable_pipeline_cache ? pipeline_cache : VK_NULL_HANDLE);
+	resource_cache.set_pipeline_compilation(enable_async_compilation ? vkb::PipelineCompilation::AsyncSkip : vkb::PipelineCompilation::Synchronous,
+	                                        std::thread::hardware_concurrency());
+	resource_cache.set_per_thread_pipeline_caches(enable_per_thread_caches);
 }
 
 void PipelineCache::update(float delta_time)
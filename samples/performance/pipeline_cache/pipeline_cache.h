@@ -49,11 +49,37 @@ class PipelineCache : public vkb::VulkanSample
 
 	bool enable_pipeline_cache{true};
 
+	bool enable_async_compilation{false};
+
+	bool enable_per_thread_caches{false};
+
+	/**
+	 * @brief Time taken to build all the pipelines of the scene on the compile threads
+	 */
+	struct CompileBenchmarkResult
+	{
+		uint32_t thread_count{1};
+
+		/// With the threads sharing one pipeline cache
+		float shared_cache_ms{0.0f};
+
+		/// With a pipeline cache per thread, merged once done
+		float per_thread_caches_ms{0.0f};
+	};
+
+	std::vector<CompileBenchmarkResult> compile_benchmark_results;
+
 	bool record_frame_time_next_frame{false};
 
 	float rebuild_pipelines_frame_time_ms{0.0f};
 
 	virtual void draw_gui() override;
+
+	/**
+	 * @brief Rebuilds the pipelines of the scene from empty pipeline caches for an increasing
+	 *        number of compile threads, sharing one pipeline cache and with one cache per thread
+	 */
+	void run_compile_benchmark();
 };
 
 std::unique_ptr<vkb::VulkanSample> create_pipeline_cache();
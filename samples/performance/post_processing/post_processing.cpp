@@ -0,0 +1,156 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "post_processing.h"
+
+#include "common/vk_common.h"
+#include "gltf_loader.h"
+#include "gui.h"
+#include "platform/filesystem.h"
+#include "platform/platform.h"
+#include "rendering/subpasses/forward_subpass.h"
+#include "stats.h"
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+#	include "platform/android/android_platform.h"
+#endif
+
+PostProcessing::PostProcessing()
+{
+	auto &config = get_configuration();
+
+	// All effects, with fragment shaders and with compute shaders
+	config.insert<vkb::IntSetting>(0, backend, 0);
+	config.insert<vkb::BoolSetting>(0, bloom, true);
+	config.insert<vkb::BoolSetting>(0, fxaa, true);
+
+	config.insert<vkb::IntSetting>(1, backend, 1);
+	config.insert<vkb::BoolSetting>(1, bloom, true);
+	config.insert<vkb::BoolSetting>(1, fxaa, true);
+
+	// Tone mapping only, which keeps the scene color on-tile with fragment shaders
+	config.insert<vkb::IntSetting>(2, backend, 0);
+	config.insert<vkb::BoolSetting>(2, bloom, false);
+	config.insert<vkb::BoolSetting>(2, fxaa, false);
+
+	config.insert<vkb::IntSetting>(3, backend, 1);
+	config.insert<vkb::BoolSetting>(3, bloom, false);
+	config.insert<vkb::BoolSetting>(3, fxaa, false);
+}
+
+bool PostProcessing::prepare(vkb::Platform &platform)
+{
+	if (!VulkanSample::prepare(platform))
+	{
+		return false;
+	}
+
+	load_scene("scenes/sponza/Sponza01.gltf");
+
+	auto &camera_node = vkb::add_free_camera(*scene, "main_camera", get_render_context().get_surface_extent());
+	camera            = &camera_node.get_component<vkb::sg::Camera>();
+
+	create_post_processing();
+
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times,
+	                                                              vkb::StatIndex::l2_ext_read_bytes,
+	                                                              vkb::StatIndex::l2_ext_write_bytes});
+	gui   = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
+
+	return true;
+}
+
+void PostProcessing::create_post_processing()
+{
+	auto &render_context = get_render_context();
+
+	// The render targets of the frames in flight are replaced
+	render_context.get_device().wait_idle();
+
+	vkb::PostProcessingEffects effects;
+	effects.bloom = bloom;
+	effects.fxaa  = fxaa;
+
+	auto pipeline = std::make_unique<vkb::PostProcessingPipeline>(render_context, backend == 0 ? vkb::PostProcessingBackend::Fragment : vkb::PostProcessingBackend::Compute, effects);
+
+	if (post_processing)
+	{
+		pipeline->get_parameters() = post_processing->get_parameters();
+	}
+
+	vkb::ShaderSource vert_shader("base.vert");
+	vkb::ShaderSource frag_shader("base.frag");
+	pipeline->prepare(std::make_unique<vkb::ForwardSubpass>(render_context, std::move(vert_shader), std::move(frag_shader), *scene, *camera));
+
+	post_processing = std::move(pipeline);
+
+	render_context.set_render_target_create_func([this](vkb::core::Image &&swapchain_image) {
+		return post_processing->create_render_target(std::move(swapchain_image));
+	});
+
+	render_context.recreate();
+}
+
+void PostProcessing::update(float delta_time)
+{
+	auto &effects = post_processing->get_effects();
+
+	auto selected_backend = backend == 0 ? vkb::PostProcessingBackend::Fragment : vkb::PostProcessingBackend::Compute;
+
+	if (selected_backend != post_processing->get_backend() || bloom != effects.bloom || fxaa != effects.fxaa)
+	{
+		LOGI("Recreating post-processing pipeline");
+		create_post_processing();
+	}
+
+	VulkanSample::update(delta_time);
+}
+
+void PostProcessing::draw_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target)
+{
+	post_processing->draw(command_buffer, render_target, gui.get());
+}
+
+void PostProcessing::draw_gui()
+{
+	auto &parameters = post_processing->get_parameters();
+
+	gui->show_options_window(
+	    /* body = */ [this, &parameters]() {
+		    ImGui::Text("Backend: ");
+		    ImGui::SameLine();
+		    ImGui::RadioButton("Fragment", &backend, 0);
+		    ImGui::SameLine();
+		    ImGui::RadioButton("Compute", &backend, 1);
+
+		    ImGui::Checkbox("Bloom", &bloom);
+		    ImGui::SameLine();
+		    ImGui::Checkbox("FXAA", &fxaa);
+
+		    ImGui::SliderFloat("Exposure", &parameters.exposure, 0.1f, 4.0f);
+		    ImGui::SliderFloat("Bloom intensity", &parameters.bloom_intensity, 0.0f, 2.0f);
+	    },
+	    /* lines = */ 4);
+}
+
+std::unique_ptr<vkb::VulkanSample> create_post_processing()
+{
+	return std::make_unique<PostProcessing>();
+}
@@ -0,0 +1,64 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "rendering/post_processing_pipeline.h"
+#include "scene_graph/components/camera.h"
+#include "vulkan_sample.h"
+
+/**
+ * @brief Bloom, tone mapping and FXAA applied with fragment shaders, where tone mapping reads
+ *        the scene color on-tile, or with compute shaders, where every effect goes through memory
+ */
+class PostProcessing : public vkb::VulkanSample
+{
+  public:
+	PostProcessing();
+
+	virtual ~PostProcessing() = default;
+
+	virtual bool prepare(vkb::Platform &platform) override;
+
+	virtual void update(float delta_time) override;
+
+  private:
+	/**
+	 * @brief Rebuilds the post-processing pipeline and the render targets from the selected options
+	 */
+	void create_post_processing();
+
+	virtual void draw_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target) override;
+
+	virtual void draw_gui() override;
+
+	vkb::sg::Camera *camera{nullptr};
+
+	std::unique_ptr<vkb::PostProcessingPipeline> post_processing;
+
+	/// Selected backend, 0 for fragment shaders and 1 for compute shaders
+	int backend{0};
+
+	bool bloom{true};
+
+	bool fxaa{true};
+};
+
+std::unique_ptr<vkb::VulkanSample> create_post_processing();
@@ -152,7 +152,7 @@ void RenderPassesSample::draw_renderpass(vkb::CommandBuffer &command_buffer, vkb
 
 	get_render_pipeline().set_load_store(load_store);
 
-	auto &extent = render_target.get_extent();
+	auto &extent = render_target.get_render_extent();
 
 	VkViewport viewport{};
 	viewport.width    = static_cast<float>(extent.width);
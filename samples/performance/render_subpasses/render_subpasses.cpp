@@ -25,8 +25,6 @@
 #include "rendering/pipeline_state.h"
 #include "rendering/render_context.h"
 #include "rendering/render_pipeline.h"
-#include "rendering/subpasses/geometry_subpass.h"
-#include "rendering/subpasses/lighting_subpass.h"
 #include "scene_graph/node.h"
 
 RenderSubpasses::RenderSubpasses()
@@ -37,21 +35,88 @@ RenderSubpasses::RenderSubpasses()
 	config.insert<vkb::IntSetting>(0, configs[Config::RenderTechnique].value, 0);
 	config.insert<vkb::IntSetting>(0, configs[Config::TransientAttachments].value, 0);
 	config.insert<vkb::IntSetting>(0, configs[Config::GBufferSize].value, 0);
+	config.insert<vkb::IntSetting>(0, configs[Config::LightingPrecision].value, 0);
 
 	// Use two render passes
 	config.insert<vkb::IntSetting>(1, configs[Config::RenderTechnique].value, 1);
 	config.insert<vkb::IntSetting>(1, configs[Config::TransientAttachments].value, 0);
 	config.insert<vkb::IntSetting>(1, configs[Config::GBufferSize].value, 0);
+	config.insert<vkb::IntSetting>(1, configs[Config::LightingPrecision].value, 0);
 
 	// Disable transient attachments
 	config.insert<vkb::IntSetting>(2, configs[Config::RenderTechnique].value, 0);
 	config.insert<vkb::IntSetting>(2, configs[Config::TransientAttachments].value, 1);
 	config.insert<vkb::IntSetting>(2, configs[Config::GBufferSize].value, 0);
+	config.insert<vkb::IntSetting>(2, configs[Config::LightingPrecision].value, 0);
 
 	// Increase G-buffer size
 	config.insert<vkb::IntSetting>(3, configs[Config::RenderTechnique].value, 0);
 	config.insert<vkb::IntSetting>(3, configs[Config::TransientAttachments].value, 0);
 	config.insert<vkb::IntSetting>(3, configs[Config::GBufferSize].value, 1);
+	config.insert<vkb::IntSetting>(3, configs[Config::LightingPrecision].value, 0);
+
+	// Pack the G-buffer
+	config.insert<vkb::IntSetting>(4, configs[Config::RenderTechnique].value, 0);
+	config.insert<vkb::IntSetting>(4, configs[Config::TransientAttachments].value, 0);
+	config.insert<vkb::IntSetting>(4, configs[Config::GBufferSize].value, 2);
+	config.insert<vkb::IntSetting>(4, configs[Config::LightingPrecision].value, 0);
+
+	// Compute the lighting in mediump
+	config.insert<vkb::IntSetting>(5, configs[Config::RenderTechnique].value, 0);
+	config.insert<vkb::IntSetting>(5, configs[Config::TransientAttachments].value, 0);
+	config.insert<vkb::IntSetting>(5, configs[Config::GBufferSize].value, 0);
+	config.insert<vkb::IntSetting>(5, configs[Config::LightingPrecision].value, 1);
+
+	// Read the G-buffer in rasterization order within a single subpass
+	config.insert<vkb::IntSetting>(6, configs[Config::RenderTechnique].value, 2);
+	config.insert<vkb::IntSetting>(6, configs[Config::TransientAttachments].value, 0);
+	config.insert<vkb::IntSetting>(6, configs[Config::GBufferSize].value, 0);
+	config.insert<vkb::IntSetting>(6, configs[Config::LightingPrecision].value, 0);
+}
+
+RenderSubpasses::RasterizationOrderSubpass::RasterizationOrderSubpass(vkb::RenderContext &render_context, std::unique_ptr<vkb::GeometrySubpass> &&geometry_subpass,
+                                                                      std::unique_ptr<vkb::LightingSubpass> &&lighting_subpass) :
+    vkb::Subpass{render_context, vkb::ShaderSource{"deferred/lighting.vert"}, vkb::ShaderSource{"deferred/lighting.frag"}},
+    geometry_subpass{std::move(geometry_subpass)},
+    lighting_subpass{std::move(lighting_subpass)}
+{
+	// The light is the first color attachment, so that the gui draws to it, followed by albedo and normal
+	set_output_attachments({0, 2, 3});
+	set_input_attachments({1, 2, 3});
+	set_rasterization_order_access(true);
+	set_debug_name("Rasterization order deferred");
+}
+
+void RenderSubpasses::RasterizationOrderSubpass::prepare()
+{
+	geometry_subpass->prepare();
+	lighting_subpass->prepare();
+}
+
+void RenderSubpasses::RasterizationOrderSubpass::draw(vkb::CommandBuffer &command_buffer)
+{
+	// The geometry writes the G-buffer only
+	vkb::ColorBlendState geometry_blend_state{};
+	geometry_blend_state.attachments.resize(3);
+	geometry_blend_state.attachments[0].color_write_mask = 0;
+	command_buffer.set_color_blend_state(geometry_blend_state);
+
+	geometry_subpass->draw(command_buffer);
+
+	// The lighting writes the light only, reading the G-buffer of its pixel without any barrier
+	vkb::ColorBlendState lighting_blend_state{};
+	lighting_blend_state.attachments.resize(3);
+	lighting_blend_state.attachments[1].color_write_mask = 0;
+	lighting_blend_state.attachments[2].color_write_mask = 0;
+	command_buffer.set_color_blend_state(lighting_blend_state);
+
+	// The depth is read as an input attachment while it stays bound
+	vkb::DepthStencilState lighting_depth_state{};
+	lighting_depth_state.depth_test_enable  = VK_FALSE;
+	lighting_depth_state.depth_write_enable = VK_FALSE;
+	command_buffer.set_depth_stencil_state(lighting_depth_state);
+
+	lighting_subpass->draw(command_buffer);
 }
 
 vkb::RenderTarget RenderSubpasses::create_render_target(vkb::core::Image &&swapchain_image)
@@ -64,10 +129,12 @@ vkb::RenderTarget RenderSubpasses::create_render_target(vkb::core::Image &&swapc
 	// Light (swapchain_image) RGBA8_UNORM   (32-bit)
 	// Albedo                  RGBA8_UNORM   (32-bit)
 	// Normal                  RGB10A2_UNORM (32-bit)
+	// The packed variant stores octahedral normals in RG16_SFLOAT (32-bit)
+	// and roughness and metallic in the alpha of the albedo
 
 	vkb::core::Image depth_image{device,
 	                             extent,
-	                             VK_FORMAT_D32_SFLOAT,
+	                             device.get_depth_format(),
 	                             VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | rt_usage_flags,
 	                             VMA_MEMORY_USAGE_GPU_ONLY};
 
@@ -157,11 +224,14 @@ bool RenderSubpasses::prepare(vkb::Platform &platform)
 	geometry_render_pipeline = create_geometry_renderpass();
 	lighting_render_pipeline = create_lighting_renderpass();
 
+	rasterization_order_render_pipeline = create_rasterization_order_renderpass();
+
 	// Enable gui
 	gui = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
 
 	// Enable stats
 	auto enabled_stats = {vkb::StatIndex::fragment_jobs,
+	                      vkb::StatIndex::fragment_cycles,
 	                      vkb::StatIndex::tiles,
 	                      vkb::StatIndex::l2_ext_read_bytes,
 	                      vkb::StatIndex::l2_ext_write_bytes};
@@ -172,6 +242,13 @@ bool RenderSubpasses::prepare(vkb::Platform &platform)
 
 void RenderSubpasses::update(float delta_time)
 {
+	// Fall back to the subpasses if the device cannot read attachments in rasterization order
+	if (configs[Config::RenderTechnique].value == 2 && !rasterization_order_render_pipeline)
+	{
+		LOGW("VK_EXT_rasterization_order_attachment_access is not supported, using subpasses");
+		configs[Config::RenderTechnique].value = 0;
+	}
+
 	// Check whether the user changed the render technique
 	if (configs[Config::RenderTechnique].value != last_render_technique)
 	{
@@ -185,9 +262,10 @@ void RenderSubpasses::update(float delta_time)
 		}
 	}
 
-	// Check whether the user switched the attachment or the G-buffer option
+	// Check whether the user switched the attachment, the G-buffer or the precision option
 	if (configs[Config::TransientAttachments].value != last_transient_attachment ||
-	    configs[Config::GBufferSize].value != last_g_buffer_size)
+	    configs[Config::GBufferSize].value != last_g_buffer_size ||
+	    configs[Config::LightingPrecision].value != last_lighting_precision)
 	{
 		// If attachment option has changed
 		if (configs[Config::TransientAttachments].value != last_transient_attachment)
@@ -209,28 +287,54 @@ void RenderSubpasses::update(float delta_time)
 		// It G-buffer option has changed
 		if (configs[Config::GBufferSize].value != last_g_buffer_size)
 		{
+			g_buffer_definitions.clear();
+
 			if (configs[Config::GBufferSize].value == 0)
 			{
 				// Use less bits
 				albedo_format = VK_FORMAT_R8G8B8A8_UNORM;                  // 32-bit
 				normal_format = VK_FORMAT_A2R10G10B10_UNORM_PACK32;        // 32-bit
 			}
-			else
+			else if (configs[Config::GBufferSize].value == 1)
 			{
 				// Use more bits
 				albedo_format = VK_FORMAT_R16G16B16A16_UNORM;        // 64-bit
 				normal_format = VK_FORMAT_R16G16B16A16_UNORM;        // 64-bit
 			}
+			else
+			{
+				// Store more data in the same bits
+				albedo_format        = VK_FORMAT_R8G8B8A8_UNORM;        // 32-bit
+				normal_format        = VK_FORMAT_R16G16_SFLOAT;         // 32-bit
+				g_buffer_definitions = {"GBUFFER_OCTAHEDRAL_NORMAL", "GBUFFER_PACKED_MATERIAL"};
+			}
 
 			last_g_buffer_size = configs[Config::GBufferSize].value;
 		}
 
+		last_lighting_precision = configs[Config::LightingPrecision].value;
+
+		auto precision = last_lighting_precision == 0 ? vkb::ShaderPrecision::High : vkb::ShaderPrecision::Medium;
+
+		lighting_definitions = g_buffer_definitions;
+
+		for (auto &definition : vkb::get_precision_definitions(precision))
+		{
+			lighting_definitions.push_back(definition);
+		}
+
 		// Reset frames, their synchronization objects and their command buffers
 		for (auto &frame : get_render_context().get_render_frames())
 		{
 			frame.reset();
 		}
 
+		// Shaders must match the packing of the G-buffer
+		render_pipeline                     = create_one_renderpass_two_subpasses();
+		geometry_render_pipeline            = create_geometry_renderpass();
+		lighting_render_pipeline            = create_lighting_renderpass();
+		rasterization_order_render_pipeline = create_rasterization_order_renderpass();
+
 		LOGI("Recreating render target");
 		get_render_context().recreate();
 	}
@@ -238,13 +342,29 @@ void RenderSubpasses::update(float delta_time)
 	VulkanSample::update(delta_time);
 }
 
+uint32_t RenderSubpasses::get_color_bits_per_pixel()
+{
+	uint32_t bits = 0;
+
+	for (auto &view : get_render_context().get_render_frames().at(0).get_render_target().get_views())
+	{
+		if (!vkb::is_depth_stencil_format(view.get_format()))
+		{
+			bits += vkb::to_u32(vkb::get_bits_per_pixel(view.get_format()));
+		}
+	}
+
+	return bits;
+}
+
 void RenderSubpasses::draw_gui()
 {
-	auto lines = configs.size();
+	// One more line for the tile memory used by the G-buffer
+	auto lines = configs.size() + 1;
 	if (camera->get_aspect_ratio() < 1.0f)
 	{
 		// In portrait, show buttons below heading
-		lines = lines * 2;
+		lines = configs.size() * 2 + 1;
 	}
 
 	gui->show_options_window(
@@ -279,6 +399,8 @@ void RenderSubpasses::draw_gui()
 
 			    ImGui::PopID();
 		    }
+
+		    ImGui::Text("Color attachments: %u bits per pixel (budget: 128)", get_color_bits_per_pixel());
 	    },
 	    /* lines = */ vkb::to_u32(lines));
 }
@@ -292,6 +414,7 @@ std::unique_ptr<vkb::RenderPipeline> RenderSubpasses::create_one_renderpass_two_
 
 	// Outputs are depth, albedo, and normal
 	scene_subpass->set_output_attachments({1, 2, 3});
+	scene_subpass->set_shader_definitions(g_buffer_definitions);
 
 	// Lighting subpass
 	auto lighting_vs      = vkb::ShaderSource{"deferred/lighting.vert"};
@@ -300,6 +423,7 @@ std::unique_ptr<vkb::RenderPipeline> RenderSubpasses::create_one_renderpass_two_
 
 	// Inputs are depth, albedo, and normal from the geometry subpass
 	lighting_subpass->set_input_attachments({1, 2, 3});
+	lighting_subpass->set_shader_definitions(lighting_definitions);
 
 	// Create subpasses pipeline
 	std::vector<std::unique_ptr<vkb::Subpass>> subpasses{};
@@ -324,6 +448,7 @@ std::unique_ptr<vkb::RenderPipeline> RenderSubpasses::create_geometry_renderpass
 
 	// Outputs are depth, albedo, and normal
 	scene_subpass->set_output_attachments({1, 2, 3});
+	scene_subpass->set_shader_definitions(g_buffer_definitions);
 
 	// Create geomtry pipeline
 	std::vector<std::unique_ptr<vkb::Subpass>> scene_subpasses{};
@@ -347,6 +472,7 @@ std::unique_ptr<vkb::RenderPipeline> RenderSubpasses::create_lighting_renderpass
 
 	// Inputs are depth, albedo, and normal from the geometry subpass
 	lighting_subpass->set_input_attachments({1, 2, 3});
+	lighting_subpass->set_shader_definitions(lighting_definitions);
 	// Create lighting pipeline
 	std::vector<std::unique_ptr<vkb::Subpass>> lighting_subpasses{};
 	lighting_subpasses.push_back(std::move(lighting_subpass));
@@ -360,9 +486,52 @@ std::unique_ptr<vkb::RenderPipeline> RenderSubpasses::create_lighting_renderpass
 	return lighting_render_pipeline;
 }
 
+std::unique_ptr<vkb::RenderPipeline> RenderSubpasses::create_rasterization_order_renderpass()
+{
+	bool supported = false;
+
+#if defined(VK_EXT_rasterization_order_attachment_access)
+	supported = get_device().is_enabled(VK_EXT_RASTERIZATION_ORDER_ATTACHMENT_ACCESS_EXTENSION_NAME);
+#endif
+
+	if (!supported)
+	{
+		return nullptr;
+	}
+
+	// Geometry draws, writing albedo and normal after the light
+	auto geometry_vs   = vkb::ShaderSource{"deferred/geometry.vert"};
+	auto geometry_fs   = vkb::ShaderSource{"deferred/geometry.frag"};
+	auto scene_subpass = std::make_unique<vkb::GeometrySubpass>(get_render_context(), std::move(geometry_vs), std::move(geometry_fs), *scene, *camera);
+
+	auto geometry_definitions = g_buffer_definitions;
+	geometry_definitions.push_back("RASTERIZATION_ORDER_GBUFFER");
+	scene_subpass->set_output_attachments({0, 2, 3});
+	scene_subpass->set_shader_definitions(geometry_definitions);
+
+	// Lighting draw, reading depth, albedo, and normal
+	auto lighting_vs      = vkb::ShaderSource{"deferred/lighting.vert"};
+	auto lighting_fs      = vkb::ShaderSource{"deferred/lighting.frag"};
+	auto lighting_subpass = std::make_unique<vkb::LightingSubpass>(get_render_context(), std::move(lighting_vs), std::move(lighting_fs), *camera, *scene);
+
+	lighting_subpass->set_input_attachments({1, 2, 3});
+	lighting_subpass->set_shader_definitions(lighting_definitions);
+
+	std::vector<std::unique_ptr<vkb::Subpass>> subpasses{};
+	subpasses.push_back(std::make_unique<RasterizationOrderSubpass>(get_render_context(), std::move(scene_subpass), std::move(lighting_subpass)));
+
+	auto rasterization_order_render_pipeline = std::make_unique<vkb::RenderPipeline>(std::move(subpasses));
+
+	rasterization_order_render_pipeline->set_load_store(vkb::gbuffer::get_clear_all_store_swapchain());
+
+	rasterization_order_render_pipeline->set_clear_value(vkb::gbuffer::get_clear_value());
+
+	return rasterization_order_render_pipeline;
+}
+
 void draw_pipeline(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target, vkb::RenderPipeline &render_pipeline, vkb::Gui *gui = nullptr)
 {
-	auto &extent = render_target.get_extent();
+	auto &extent = render_target.get_render_extent();
 
 	VkViewport viewport{};
 	viewport.width    = static_cast<float>(extent.width);
@@ -392,38 +561,42 @@ void RenderSubpasses::draw_render_subpasses(vkb::CommandBuffer &command_buffer,
 
 void RenderSubpasses::draw_renderpasses(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target)
 {
-	// First render pass (no gui)
-	draw_pipeline(command_buffer, render_target, *geometry_render_pipeline);
+	// First render pass (no gui), recorded while the second one is with parallel subpasses
+	record_pass(command_buffer, [this, &render_target](vkb::CommandBuffer &pass_command_buffer, size_t thread_index) {
+		geometry_render_pipeline->set_thread_index(thread_index);
 
-	// Memory barriers needed
-	for (size_t i = 1; i < render_target.get_views().size(); ++i)
-	{
-		auto &view = render_target.get_views().at(i);
+		draw_pipeline(pass_command_buffer, render_target, *geometry_render_pipeline);
 
-		vkb::ImageMemoryBarrier barrier;
-
-		if (i == 1)
+		// Memory barriers needed
+		for (size_t i = 1; i < render_target.get_views().size(); ++i)
 		{
-			barrier.old_layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-			barrier.new_layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+			auto &view = render_target.get_views().at(i);
 
-			barrier.src_stage_mask  = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-			barrier.src_access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-		}
-		else
-		{
-			barrier.old_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-			barrier.new_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			vkb::ImageMemoryBarrier barrier;
 
-			barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		}
+			if (i == 1)
+			{
+				barrier.old_layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+				barrier.new_layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+				barrier.src_stage_mask  = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+				barrier.src_access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			}
+			else
+			{
+				barrier.old_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				barrier.new_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-		barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		barrier.dst_access_mask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+				barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+				barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			}
 
-		command_buffer.image_memory_barrier(view, barrier);
-	}
+			barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			barrier.dst_access_mask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+
+			pass_command_buffer.image_memory_barrier(view, barrier);
+		}
+	});
 
 	// Second render pass
 	draw_pipeline(command_buffer, render_target, *lighting_render_pipeline, gui.get());
@@ -436,6 +609,11 @@ void RenderSubpasses::draw_renderpass(vkb::CommandBuffer &command_buffer, vkb::R
 		// Efficient way
 		draw_render_subpasses(command_buffer, render_target);
 	}
+	else if (configs[Config::RenderTechnique].value == 2)
+	{
+		// Without a subpass boundary
+		draw_pipeline(command_buffer, render_target, *rasterization_order_render_pipeline, gui.get());
+	}
 	else
 	{
 		// Inefficient way
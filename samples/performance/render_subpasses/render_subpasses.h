@@ -21,6 +21,8 @@
 #pragma once
 
 #include "rendering/render_pipeline.h"
+#include "rendering/subpasses/geometry_subpass.h"
+#include "rendering/subpasses/lighting_subpass.h"
 #include "scene_graph/components/perspective_camera.h"
 #include "vulkan_sample.h"
 
@@ -44,6 +46,27 @@ class RenderSubpasses : public vkb::VulkanSample
 
 	void draw_gui() override;
 
+	/**
+	 * @brief Deferred rendering in a single subpass: the lighting reads the G-buffer written by the geometry
+	 *        draws to the same pixels in rasterization order, with VK_EXT_rasterization_order_attachment_access,
+	 *        so that there is no subpass boundary between them
+	 */
+	class RasterizationOrderSubpass : public vkb::Subpass
+	{
+	  public:
+		RasterizationOrderSubpass(vkb::RenderContext &render_context, std::unique_ptr<vkb::GeometrySubpass> &&geometry_subpass,
+		                          std::unique_ptr<vkb::LightingSubpass> &&lighting_subpass);
+
+		virtual void prepare() override;
+
+		virtual void draw(vkb::CommandBuffer &command_buffer) override;
+
+	  private:
+		std::unique_ptr<vkb::GeometrySubpass> geometry_subpass;
+
+		std::unique_ptr<vkb::LightingSubpass> lighting_subpass;
+	};
+
   private:
 	virtual void prepare_render_context() override;
 
@@ -62,6 +85,11 @@ class RenderSubpasses : public vkb::VulkanSample
 	 */
 	std::unique_ptr<vkb::RenderPipeline> create_lighting_renderpass();
 
+	/**
+	 * @return A pipeline with a single subpass drawing the geometry and the lighting, if the device can read attachments in rasterization order
+	 */
+	std::unique_ptr<vkb::RenderPipeline> create_rasterization_order_renderpass();
+
 	/**
 	 * @brief Draws using the good pipeline: one render pass with two sub-passes
 	 */
@@ -76,6 +104,11 @@ class RenderSubpasses : public vkb::VulkanSample
 
 	vkb::RenderTarget create_render_target(vkb::core::Image &&swapchain_image);
 
+	/**
+	 * @return Tile memory used by the color attachments of a pixel, in bits
+	 */
+	uint32_t get_color_bits_per_pixel();
+
 	/// Good pipeline with two subpasses within one render pass
 	std::unique_ptr<vkb::RenderPipeline> render_pipeline{};
 
@@ -85,6 +118,9 @@ class RenderSubpasses : public vkb::VulkanSample
 	/// 2. Bad pipeline with a lighting subpass in the second render pass
 	std::unique_ptr<vkb::RenderPipeline> lighting_render_pipeline{};
 
+	/// Pipeline with a single subpass, null if the device cannot read attachments in rasterization order
+	std::unique_ptr<vkb::RenderPipeline> rasterization_order_render_pipeline{};
+
 	vkb::sg::PerspectiveCamera *camera{};
 
 	/**
@@ -100,7 +136,8 @@ class RenderSubpasses : public vkb::VulkanSample
 		{
 			RenderTechnique,
 			TransientAttachments,
-			GBufferSize
+			GBufferSize,
+			LightingPrecision
 		} type;
 
 		/// Used as label by the GUI
@@ -116,15 +153,23 @@ class RenderSubpasses : public vkb::VulkanSample
 	uint16_t last_render_technique{0};
 	uint16_t last_transient_attachment{0};
 	uint16_t last_g_buffer_size{0};
+	uint16_t last_lighting_precision{0};
 
 	VkFormat          albedo_format{VK_FORMAT_R8G8B8A8_UNORM};
 	VkFormat          normal_format{VK_FORMAT_A2R10G10B10_UNORM_PACK32};
+
+	/// Shader definitions selecting the G-buffer packing, shared by the geometry and lighting subpasses
+	std::vector<std::string> g_buffer_definitions{};
+
+	/// Shader definitions of the lighting subpass, the G-buffer ones and the precision of the lighting
+	std::vector<std::string> lighting_definitions{};
+
 	VkImageUsageFlags rt_usage_flags{VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT};
 
 	std::vector<Config> configs = {
 	    {/* config      = */ Config::RenderTechnique,
 	     /* description = */ "Render technique",
-	     /* options     = */ {"Subpasses", "Renderpasses"},
+	     /* options     = */ {"Subpasses", "Renderpasses", "Rasterization order"},
 	     /* value       = */ 0},
 	    {/* config      = */ Config::TransientAttachments,
 	     /* description = */ "Transient attachments",
@@ -132,7 +177,11 @@ class RenderSubpasses : public vkb::VulkanSample
 	     /* value       = */ 0},
 	    {/* config      = */ Config::GBufferSize,
 	     /* description = */ "G-Buffer size",
-	     /* options     = */ {"128-bit", "More"},
+	     /* options     = */ {"128-bit", "More", "Packed"},
+	     /* value       = */ 0},
+	    {/* config      = */ Config::LightingPrecision,
+	     /* description = */ "Lighting precision",
+	     /* options     = */ {"highp", "mediump"},
 	     /* value       = */ 0}};
 };
 
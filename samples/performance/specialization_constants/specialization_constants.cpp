@@ -80,6 +80,8 @@ void SpecializationConstants::ForwardSubpassCustomLights::prepare()
 
 			vert_module.set_resource_dynamic("GlobalUniform");
 			frag_module.set_resource_dynamic("GlobalUniform");
+
+			vert_module.set_resource_dynamic("ModelUniform");
 		}
 	}
 }
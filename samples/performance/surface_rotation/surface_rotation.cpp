@@ -24,7 +24,6 @@
 
 VKBP_DISABLE_WARNINGS()
 #include "common/glm_common.h"
-#include <glm/gtc/matrix_transform.hpp>
 VKBP_ENABLE_WARNINGS()
 
 #include "core/device.h"
@@ -59,7 +58,7 @@ bool SurfaceRotation::prepare(vkb::Platform &platform)
 		throw std::runtime_error("Requires a surface to run sample");
 	}
 
-	auto enabled_stats = {vkb::StatIndex::l2_ext_read_stalls, vkb::StatIndex::l2_ext_write_stalls};
+	auto enabled_stats = {vkb::StatIndex::frame_times, vkb::StatIndex::l2_ext_read_stalls, vkb::StatIndex::l2_ext_write_stalls};
 
 	stats = std::make_unique<vkb::Stats>(enabled_stats);
 
@@ -79,51 +78,33 @@ bool SurfaceRotation::prepare(vkb::Platform &platform)
 
 	gui = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
 
+	// The render context pre-rotates by default, the sample starts in the mode of its configuration
+	get_render_context().set_pre_rotation(pre_rotate);
+	recreate_swapchain();
+
+	last_pre_rotate = pre_rotate;
+
 	return true;
 }
 
 void SurfaceRotation::update(float delta_time)
 {
 	// Process GUI input, recreating the swapchain if pre-rotate mode was
-	// enabled/disabled by the user. Otherwise it might still be recreated if
-	// a 180 degree change in orientation is detected
+	// enabled/disabled by the user. While it is enabled, the render context
+	// recreates the swapchain when the surface transform changes, including
+	// 180 degree rotations which do not trigger a resize
 	if (pre_rotate != last_pre_rotate)
 	{
+		get_render_context().set_pre_rotation(pre_rotate);
+
 		recreate_swapchain();
 
 		last_pre_rotate = pre_rotate;
 	}
-	else
-	{
-		handle_no_resize_rotations();
-	}
-
-	// In pre-rotate mode, the application has to handle the rotation.
-	// The swapchain preTransform attribute will now be something other than
-	// identity only if pre-rotate mode is enabled
-	glm::mat4   pre_rotate_mat = glm::mat4(1.0f);
-	glm::vec3   rotation_axis  = glm::vec3(0.0f, 0.0f, -1.0f);
-	const auto &swapchain      = get_render_context().get_swapchain();
-
-	if (swapchain.get_transform() & VK_SURFACE_TRANSFORM_ROTATE_90_BIT_KHR)
-	{
-		pre_rotate_mat = glm::rotate(pre_rotate_mat, glm::radians(90.0f), rotation_axis);
-	}
-	else if (swapchain.get_transform() & VK_SURFACE_TRANSFORM_ROTATE_270_BIT_KHR)
-	{
-		pre_rotate_mat = glm::rotate(pre_rotate_mat, glm::radians(270.0f), rotation_axis);
-	}
-	else if (swapchain.get_transform() & VK_SURFACE_TRANSFORM_ROTATE_180_BIT_KHR)
-	{
-		pre_rotate_mat = glm::rotate(pre_rotate_mat, glm::radians(180.0f), rotation_axis);
-	}
-
-	// Ensure that the camera uses the swapchain dimensions, which never change if
-	// pre-rotate mode is enabled, and not the window dimensions set by the framework
-	VkExtent2D extent = swapchain.get_extent();
-	camera->set_aspect_ratio(static_cast<float>(extent.width) / extent.height);
-	camera->set_pre_rotation(pre_rotate_mat);
 
+	// In pre-rotate mode, the application has to handle the rotation. The framework
+	// gives the cameras the rotation of the swapchain, which is something other
+	// than identity only if pre-rotate mode is enabled
 	VulkanSample::update(delta_time);
 }
 
@@ -192,29 +173,12 @@ VkSurfaceTransformFlagBitsKHR SurfaceRotation::select_pre_transform()
 	return pre_transform;
 }
 
-void SurfaceRotation::handle_no_resize_rotations()
-{
-	// The render context recreates the swapchain if it detects a change of dimensions or an
-	// out-of-date swapchain. However 180 degree rotations do not currently trigger a resize.
-	// If pre-rotate mode is enabled, the sample will detect a 180 degree change in orientation
-	// and re-create the swapchain
-	VkSurfaceCapabilitiesKHR surface_properties;
-	VK_CHECK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(get_device().get_physical_device(),
-	                                                   get_surface(),
-	                                                   &surface_properties));
-
-	if (surface_properties.currentExtent.width == get_render_context().get_surface_extent().width &&
-	    surface_properties.currentExtent.height == get_render_context().get_surface_extent().height &&
-	    (pre_rotate && surface_properties.currentTransform != get_render_context().get_swapchain().get_transform()))
-	{
-		recreate_swapchain();
-	}
-}
-
 void SurfaceRotation::recreate_swapchain()
 {
-	get_device().wait_idle();
-
+	// POI
+	//
+	// The device is not waited for: frames in flight keep the old swapchain and render targets
+	// alive until they complete, so a rotation does not stall the pipeline
 	auto surface_extent = get_render_context().get_surface_extent();
 
 	get_render_context().update_swapchain(surface_extent, select_pre_transform());
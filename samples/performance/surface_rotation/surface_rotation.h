@@ -61,13 +61,6 @@ class SurfaceRotation : public vkb::VulkanSample
 	*        application is implementing pre-rotation
 	*/
 	VkSurfaceTransformFlagBitsKHR select_pre_transform();
-
-	/* @brief 180 degree rotations do not trigger a resize, but
-	 *        if pre_rotation is enabled a new swapchain
-	 *        needs to be created with the corresponding
-	 *        preTransform value
-	 */
-	void handle_no_resize_rotations();
 };
 
 std::unique_ptr<vkb::VulkanSample> create_surface_rotation();
@@ -65,7 +65,7 @@ bool SwapchainImages::prepare(vkb::Platform &platform)
 
 	set_render_pipeline(std::move(render_pipeline));
 
-	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times});
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times, vkb::StatIndex::present_interval, vkb::StatIndex::present_delay});
 	gui   = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
 
 	return true;
@@ -84,6 +84,23 @@ void SwapchainImages::update(float delta_time)
 		last_swapchain_image_count = swapchain_image_count;
 	}
 
+	if (frames_in_flight != last_frames_in_flight)
+	{
+		// Frames are created or destroyed independently of the swapchain
+		get_render_context().set_frames_in_flight(frames_in_flight);
+
+		last_frames_in_flight = frames_in_flight;
+	}
+
+	if (target_fps != last_target_fps)
+	{
+		auto interval = target_fps > 0 ? std::chrono::nanoseconds{std::chrono::seconds{1}} / target_fps : std::chrono::nanoseconds{0};
+
+		get_render_context().get_frame_pacer().set_target_interval(interval);
+
+		last_target_fps = target_fps;
+	}
+
 	VulkanSample::update(delta_time);
 }
 
@@ -95,8 +112,20 @@ void SwapchainImages::draw_gui()
 		    ImGui::SameLine();
 		    ImGui::RadioButton("Triple buffering", &swapchain_image_count, 3);
 		    ImGui::SameLine();
+
+		    ImGui::Text("| Frames in flight:");
+		    ImGui::SameLine();
+		    ImGui::RadioButton("One per image", &frames_in_flight, 0);
+		    ImGui::SameLine();
+		    ImGui::RadioButton("2", &frames_in_flight, 2);
+
+		    ImGui::Text("Frame pacing:");
+		    ImGui::SameLine();
+		    ImGui::RadioButton("Off", &target_fps, 0);
+		    ImGui::SameLine();
+		    ImGui::RadioButton("30 FPS", &target_fps, 30);
 	    },
-	    /* lines = */ 1);
+	    /* lines = */ 2);
 }
 
 std::unique_ptr<vkb::VulkanSample> create_swapchain_images()
@@ -47,6 +47,16 @@ class SwapchainImages : public vkb::VulkanSample
 	int swapchain_image_count{3};
 
 	int last_swapchain_image_count{3};
+
+	/// Zero for one frame in flight per swapchain image
+	int frames_in_flight{0};
+
+	int last_frames_in_flight{0};
+
+	/// Target frame rate of the frame pacer, zero if disabled
+	int target_fps{0};
+
+	int last_target_fps{0};
 };
 
 std::unique_ptr<vkb::VulkanSample> create_swapchain_images();
@@ -0,0 +1,186 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "texture_compression.h"
+
+#include "common/vk_common.h"
+#include "gltf_loader.h"
+#include "gui.h"
+#include "platform/filesystem.h"
+#include "platform/platform.h"
+#include "rendering/subpasses/forward_subpass.h"
+#include "scene_graph/components/image.h"
+#include "stats.h"
+
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+#	include "platform/android/android_platform.h"
+#endif
+
+namespace
+{
+const char *scene_path = "scenes/sponza/Sponza01.gltf";
+}        // namespace
+
+TextureCompression::TextureCompression() :
+    formats{{"RGBA8", VK_FORMAT_UNDEFINED, true},
+            {"ETC2", VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, false},
+            {"ASTC 4x4", VK_FORMAT_ASTC_4x4_UNORM_BLOCK, false},
+            {"ASTC 6x6", VK_FORMAT_ASTC_6x6_UNORM_BLOCK, false},
+            {"ASTC 8x8", VK_FORMAT_ASTC_8x8_UNORM_BLOCK, false},
+            {"BC7", VK_FORMAT_BC7_UNORM_BLOCK, false}}
+{
+	auto &config = get_configuration();
+
+	// Formats the device does not support keep the uncompressed textures
+	for (int i = 0; i < static_cast<int>(formats.size()); ++i)
+	{
+		config.insert<vkb::IntSetting>(i, format_index, i);
+	}
+}
+
+bool TextureCompression::prepare(vkb::Platform &platform)
+{
+	if (!VulkanSample::prepare(platform))
+	{
+		return false;
+	}
+
+	for (auto &format : formats)
+	{
+		if (format.format != VK_FORMAT_UNDEFINED)
+		{
+			format.supported = device->is_image_format_supported(format.format);
+		}
+	}
+
+	load_scene(scene_path);
+
+	create_render_pipeline();
+
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times,
+	                                                              vkb::StatIndex::tex_cycles,
+	                                                              vkb::StatIndex::l2_ext_read_bytes,
+	                                                              vkb::StatIndex::device_memory_usage});
+	gui   = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
+
+	return true;
+}
+
+void TextureCompression::update(float delta_time)
+{
+	if (format_index != loaded_format_index && !is_loading_scene())
+	{
+		if (formats[format_index].supported)
+		{
+			// Images are compressed on a worker thread, the current scene renders meanwhile
+			texture_compression = formats[format_index].format;
+
+			load_scene_async(scene_path);
+		}
+		else
+		{
+			LOGW("{} is not supported by the device, keeping {}", formats[format_index].name, formats[loaded_format_index].name);
+
+			format_index = loaded_format_index;
+		}
+
+		loaded_format_index = format_index;
+	}
+
+	VulkanSample::update(delta_time);
+}
+
+void TextureCompression::on_scene_loaded()
+{
+	create_render_pipeline();
+}
+
+void TextureCompression::create_render_pipeline()
+{
+	auto &camera_node = vkb::add_free_camera(*scene, "main_camera", get_render_context().get_surface_extent());
+	camera            = &camera_node.get_component<vkb::sg::Camera>();
+
+	vkb::ShaderSource vert_shader("base.vert");
+	vkb::ShaderSource frag_shader("base.frag");
+	auto              subpass = std::make_unique<vkb::ForwardSubpass>(get_render_context(), std::move(vert_shader), std::move(frag_shader), *scene, *camera);
+
+	auto render_pipeline = vkb::RenderPipeline();
+	render_pipeline.add_subpass(std::move(subpass));
+
+	set_render_pipeline(std::move(render_pipeline));
+
+	texture_memory = get_texture_memory();
+}
+
+VkDeviceSize TextureCompression::get_texture_memory() const
+{
+	VkDeviceSize size = 0;
+
+	for (auto image : scene->get_components<vkb::sg::Image>())
+	{
+		VmaAllocationInfo allocation_info{};
+		vmaGetAllocationInfo(device->get_memory_allocator(), image->get_vk_image().get_memory(), &allocation_info);
+
+		size += allocation_info.size;
+	}
+
+	return size;
+}
+
+void TextureCompression::draw_gui()
+{
+	bool loading = is_loading_scene();
+
+	gui->show_options_window(
+	    /* body = */ [this, loading]() {
+		    for (int i = 0; i < static_cast<int>(formats.size()); ++i)
+		    {
+			    if (i > 0)
+			    {
+				    ImGui::SameLine();
+			    }
+
+			    // Formats cannot change while the scene reloads
+			    if (formats[i].supported && !loading)
+			    {
+				    ImGui::RadioButton(formats[i].name, &format_index, i);
+			    }
+			    else
+			    {
+				    ImGui::TextDisabled("%s", formats[i].name);
+			    }
+		    }
+
+		    if (loading)
+		    {
+			    ImGui::Text("Compressing to %s...", formats[format_index].name);
+		    }
+		    else
+		    {
+			    ImGui::Text("%s textures: %.1f MB", formats[loaded_format_index].name, static_cast<float>(texture_memory) / (1024.0f * 1024.0f));
+		    }
+	    },
+	    /* lines = */ 2);
+}
+
+std::unique_ptr<vkb::VulkanSample> create_texture_compression()
+{
+	return std::make_unique<TextureCompression>();
+}
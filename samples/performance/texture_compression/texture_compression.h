@@ -0,0 +1,80 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "rendering/render_pipeline.h"
+#include "scene_graph/components/camera.h"
+#include "vulkan_sample.h"
+
+/**
+ * @brief Renders the scene with its textures uncompressed or compressed to one of the block formats
+ *        the device supports, compressed as the scene loads and switched live
+ */
+class TextureCompression : public vkb::VulkanSample
+{
+  public:
+	TextureCompression();
+
+	virtual ~TextureCompression() = default;
+
+	virtual bool prepare(vkb::Platform &platform) override;
+
+	virtual void update(float delta_time) override;
+
+  private:
+	struct TextureFormat
+	{
+		const char *name;
+
+		/// VK_FORMAT_UNDEFINED for the uncompressed images
+		VkFormat format;
+
+		bool supported;
+	};
+
+	virtual void draw_gui() override;
+
+	virtual void on_scene_loaded() override;
+
+	/**
+	 * @brief Creates the camera and the render pipeline of the current scene
+	 */
+	void create_render_pipeline();
+
+	/**
+	 * @return The device memory of the scene images, in bytes
+	 */
+	VkDeviceSize get_texture_memory() const;
+
+	vkb::sg::Camera *camera{nullptr};
+
+	std::vector<TextureFormat> formats;
+
+	/// Index of the format selected in the GUI or configuration
+	int format_index{0};
+
+	/// Index of the format of the current scene
+	int loaded_format_index{0};
+
+	VkDeviceSize texture_memory{0};
+};
+
+std::unique_ptr<vkb::VulkanSample> create_texture_compression();
@@ -0,0 +1,407 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "variable_rate_shading.h"
+
+#include <algorithm>
+
+#include "common/vk_common.h"
+#include "core/command_buffer.h"
+#include "gui.h"
+#include "platform/platform.h"
+#include "rendering/render_context.h"
+#include "rendering/subpasses/geometry_subpass.h"
+#include "scene_graph/components/light.h"
+#include "scene_graph/node.h"
+#include "stats.h"
+
+namespace
+{
+/// Invocations per dimension of the compute generating the shading rates, as in its local size
+constexpr uint32_t SHADING_RATE_WORKGROUP_SIZE = 8;
+
+struct ShadingRateConstants
+{
+	glm::uvec2 texel_size;
+
+	float threshold;
+};
+}        // namespace
+
+VariableRateShading::VariableRateShading()
+{
+	auto &config = get_configuration();
+
+	config.insert<vkb::IntSetting>(0, shading_rate, 0);
+	config.insert<vkb::IntSetting>(1, shading_rate, 1);
+}
+
+void VariableRateShading::prepare_render_context()
+{
+	auto &device = get_device();
+
+	// The compute writes the shading rates as a storage image, which not every device allows
+	auto required_features = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR;
+
+	shading_rate_supported = device.supports_shading_rate_attachment() &&
+	                         (device.get_format_properties(VK_FORMAT_R8_UINT).optimalTilingFeatures & required_features) == required_features;
+
+	if (shading_rate_supported)
+	{
+		auto &properties = device.get_fragment_shading_rate_properties();
+
+		shading_rate_texel_size.width  = std::max(properties.minFragmentShadingRateAttachmentTexelSize.width,
+		                                          std::min(properties.maxFragmentShadingRateAttachmentTexelSize.width, shading_rate_texel_size.width));
+		shading_rate_texel_size.height = std::max(properties.minFragmentShadingRateAttachmentTexelSize.height,
+		                                          std::min(properties.maxFragmentShadingRateAttachmentTexelSize.height, shading_rate_texel_size.height));
+	}
+	else
+	{
+		LOGW("Shading rate attachments are not supported, the lighting shades every pixel");
+
+		shading_rate = 0;
+	}
+
+	get_render_context().prepare(1, std::bind(&VariableRateShading::create_render_target, this, std::placeholders::_1));
+}
+
+vkb::RenderTarget VariableRateShading::create_render_target(vkb::core::Image &&swapchain_image)
+{
+	auto &device = swapchain_image.get_device();
+	auto &extent = swapchain_image.get_extent();
+
+	// The G-buffer is only read within the render pass, so it can stay in tile memory
+	VkImageUsageFlags gbuffer_usage = VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+	vkb::core::Image depth_image{device,
+	                             extent,
+	                             device.get_depth_format(),
+	                             VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | gbuffer_usage,
+	                             VMA_MEMORY_USAGE_GPU_ONLY};
+
+	vkb::core::Image albedo_image{device,
+	                              extent,
+	                              VK_FORMAT_R8G8B8A8_UNORM,
+	                              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | gbuffer_usage,
+	                              VMA_MEMORY_USAGE_GPU_ONLY};
+
+	vkb::core::Image normal_image{device,
+	                              extent,
+	                              VK_FORMAT_A2R10G10B10_UNORM_PACK32,
+	                              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | gbuffer_usage,
+	                              VMA_MEMORY_USAGE_GPU_ONLY};
+
+	std::vector<vkb::core::Image> images;
+
+	images.push_back(std::move(swapchain_image));
+	images.push_back(std::move(depth_image));
+	images.push_back(std::move(albedo_image));
+	images.push_back(std::move(normal_image));
+
+	if (shading_rate_supported)
+	{
+		// Stored, as the next frame samples it to generate its shading rates
+		vkb::core::Image luminance_image{device,
+		                                 extent,
+		                                 VK_FORMAT_R8_UNORM,
+		                                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		                                 VMA_MEMORY_USAGE_GPU_ONLY};
+
+		// One texel per tile of pixels, rounding up to cover the edges
+		VkExtent3D shading_rate_extent{(extent.width + shading_rate_texel_size.width - 1) / shading_rate_texel_size.width,
+		                               (extent.height + shading_rate_texel_size.height - 1) / shading_rate_texel_size.height,
+		                               1};
+
+		vkb::core::Image shading_rate_image{device,
+		                                    shading_rate_extent,
+		                                    VK_FORMAT_R8_UINT,
+		                                    VK_IMAGE_USAGE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR | VK_IMAGE_USAGE_STORAGE_BIT,
+		                                    VMA_MEMORY_USAGE_GPU_ONLY};
+
+		images.push_back(std::move(luminance_image));
+		images.push_back(std::move(shading_rate_image));
+	}
+
+	return vkb::RenderTarget{std::move(images)};
+}
+
+bool VariableRateShading::prepare(vkb::Platform &platform)
+{
+	if (!VulkanSample::prepare(platform))
+	{
+		return false;
+	}
+
+	load_scene("scenes/sponza/Sponza01.gltf");
+
+	scene->clear_components<vkb::sg::Light>();
+
+	auto light_pos   = glm::vec3(0.0f, 128.0f, -225.0f);
+	auto light_color = glm::vec3(1.0, 1.0, 1.0);
+
+	// Magic numbers used to offset lights in the Sponza scene
+	for (int i = -4; i < 4; ++i)
+	{
+		for (int j = 0; j < 2; ++j)
+		{
+			glm::vec3 pos = light_pos;
+			pos.x += i * 400;
+			pos.z += j * (225 + 140);
+			pos.y = 8;
+
+			for (int k = 0; k < 3; ++k)
+			{
+				pos.y = pos.y + (k * 100);
+
+				light_color.x = static_cast<float>(rand()) / (RAND_MAX);
+				light_color.y = static_cast<float>(rand()) / (RAND_MAX);
+				light_color.z = static_cast<float>(rand()) / (RAND_MAX);
+
+				vkb::sg::LightProperties props;
+				props.color     = light_color;
+				props.intensity = 0.2f;
+
+				vkb::add_point_light(*scene, pos, props);
+			}
+		}
+	}
+
+	auto &camera_node = vkb::add_free_camera(*scene, "main_camera", get_render_context().get_surface_extent());
+	camera            = dynamic_cast<vkb::sg::PerspectiveCamera *>(&camera_node.get_component<vkb::sg::Camera>());
+
+	auto geometry_subpass = std::make_unique<vkb::GeometrySubpass>(get_render_context(), vkb::ShaderSource{"deferred/geometry.vert"}, vkb::ShaderSource{"deferred/geometry.frag"}, *scene, *camera);
+	geometry_subpass->set_output_attachments({Depth, Albedo, Normal});
+
+	auto lighting = std::make_unique<vkb::LightingSubpass>(get_render_context(), vkb::ShaderSource{"deferred/lighting.vert"}, vkb::ShaderSource{"deferred/lighting.frag"}, *camera, *scene);
+	lighting->set_input_attachments({Depth, Albedo, Normal});
+
+	auto load_store = vkb::gbuffer::get_clear_all_store_swapchain();
+
+	if (shading_rate_supported)
+	{
+		// The swapchain comes first, so that the gui draws to it
+		lighting->set_output_attachments({Swapchain, Luminance});
+		lighting->set_shader_definitions({"LUMINANCE_OUTPUT"});
+		lighting->set_shading_rate_attachment(ShadingRate, shading_rate_texel_size);
+
+		// The luminance is written for every pixel, the shading rates before the render pass
+		vkb::LoadStoreInfo luminance_load_store{};
+		luminance_load_store.load_op  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		luminance_load_store.store_op = VK_ATTACHMENT_STORE_OP_STORE;
+		load_store.push_back(luminance_load_store);
+
+		vkb::LoadStoreInfo shading_rate_load_store{};
+		shading_rate_load_store.load_op  = VK_ATTACHMENT_LOAD_OP_LOAD;
+		shading_rate_load_store.store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		load_store.push_back(shading_rate_load_store);
+	}
+
+	lighting_subpass = lighting.get();
+
+	vkb::RenderPipeline render_pipeline;
+	render_pipeline.add_subpass(std::move(geometry_subpass));
+	render_pipeline.add_subpass(std::move(lighting));
+	render_pipeline.set_load_store(load_store);
+	render_pipeline.set_clear_value(vkb::gbuffer::get_clear_value());
+
+	set_render_pipeline(std::move(render_pipeline));
+
+	// The compute reads the luminance pixel by pixel
+	VkSamplerCreateInfo sampler_info{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+	sampler_info.magFilter    = VK_FILTER_NEAREST;
+	sampler_info.minFilter    = VK_FILTER_NEAREST;
+	sampler_info.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+	luminance_sampler = &get_device().get_resource_cache().request_sampler(sampler_info);
+
+	stats = std::make_unique<vkb::Stats>(std::set<vkb::StatIndex>{vkb::StatIndex::frame_times,
+	                                                              vkb::StatIndex::gpu_time,
+	                                                              vkb::StatIndex::fragment_cycles,
+	                                                              vkb::StatIndex::l2_ext_read_bytes,
+	                                                              vkb::StatIndex::l2_ext_write_bytes});
+	gui   = std::make_unique<vkb::Gui>(*this, platform.get_window().get_dpi_factor());
+
+	return true;
+}
+
+void VariableRateShading::update(float delta_time)
+{
+	// The options stay visible on devices without shading rate attachments, which shade every pixel
+	if (!shading_rate_supported)
+	{
+		shading_rate = 0;
+	}
+
+	VulkanSample::update(delta_time);
+}
+
+void VariableRateShading::update_shading_rate(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target)
+{
+	auto &views = render_target.get_views();
+
+	auto &luminance_view    = views.at(Luminance);
+	auto &shading_rate_view = views.at(ShadingRate);
+
+	// The luminance of the previous frame is only valid if it was written to the views it still has
+	bool generate = shading_rate == 1 &&
+	                previous_target && previous_target != &render_target &&
+	                previous_target->get_views().at(Luminance).get_handle() == previous_luminance;
+
+	vkb::FragmentShadingRateState fragment_shading_rate_state{};
+
+	if (generate)
+	{
+		auto &previous_view = previous_target->get_views().at(Luminance);
+
+		{
+			vkb::ImageMemoryBarrier memory_barrier{};
+			memory_barrier.old_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			memory_barrier.new_layout      = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			memory_barrier.src_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			memory_barrier.dst_access_mask = VK_ACCESS_SHADER_READ_BIT;
+			memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+			command_buffer.image_memory_barrier(previous_view, memory_barrier);
+		}
+
+		{
+			vkb::ImageMemoryBarrier memory_barrier{};
+			memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+			memory_barrier.new_layout      = VK_IMAGE_LAYOUT_GENERAL;
+			memory_barrier.src_access_mask = 0;
+			memory_barrier.dst_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+			memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR;
+			memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+			command_buffer.image_memory_barrier(shading_rate_view, memory_barrier);
+		}
+
+		command_buffer.begin_gpu_scope("Shading rate");
+
+		auto &resource_cache = command_buffer.get_device().get_resource_cache();
+
+		auto &shader_module = resource_cache.request_shader_module(VK_SHADER_STAGE_COMPUTE_BIT, shading_rate_shader);
+
+		std::vector<vkb::ShaderModule *> shader_modules{&shader_module};
+
+		command_buffer.bind_pipeline_layout(resource_cache.request_pipeline_layout(shader_modules, false));
+
+		command_buffer.bind_image(previous_view, *luminance_sampler, 0, 0, 0);
+
+		// Storage images are bound without a sampler, like input attachments
+		command_buffer.bind_input(shading_rate_view, 0, 1, 0);
+
+		ShadingRateConstants constants{};
+		constants.texel_size = {shading_rate_texel_size.width, shading_rate_texel_size.height};
+		constants.threshold  = contrast_threshold;
+
+		command_buffer.push_constants(0, constants);
+
+		auto &extent = shading_rate_view.get_image().get_extent();
+
+		command_buffer.dispatch((extent.width + SHADING_RATE_WORKGROUP_SIZE - 1) / SHADING_RATE_WORKGROUP_SIZE,
+		                        (extent.height + SHADING_RATE_WORKGROUP_SIZE - 1) / SHADING_RATE_WORKGROUP_SIZE,
+		                        1);
+
+		command_buffer.end_gpu_scope();
+
+		{
+			vkb::ImageMemoryBarrier memory_barrier{};
+			memory_barrier.old_layout      = VK_IMAGE_LAYOUT_GENERAL;
+			memory_barrier.new_layout      = VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR;
+			memory_barrier.src_access_mask = VK_ACCESS_SHADER_WRITE_BIT;
+			memory_barrier.dst_access_mask = VK_ACCESS_FRAGMENT_SHADING_RATE_ATTACHMENT_READ_BIT_KHR;
+			memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR;
+
+			command_buffer.image_memory_barrier(shading_rate_view, memory_barrier);
+		}
+
+		// Pipelines shade 1x1 and the attachment replaces it
+		fragment_shading_rate_state.combiner_ops[1] = VK_FRAGMENT_SHADING_RATE_COMBINER_OP_REPLACE_KHR;
+	}
+	else
+	{
+		// The render pass still expects the attachment in its layout, even if the lighting keeps 1x1
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR;
+		memory_barrier.src_access_mask = 0;
+		memory_barrier.dst_access_mask = VK_ACCESS_FRAGMENT_SHADING_RATE_ATTACHMENT_READ_BIT_KHR;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR;
+
+		command_buffer.image_memory_barrier(shading_rate_view, memory_barrier);
+	}
+
+	{
+		// A later frame samples this luminance, the compute of an earlier one may still read it
+		vkb::ImageMemoryBarrier memory_barrier{};
+		memory_barrier.old_layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+		memory_barrier.new_layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		memory_barrier.src_access_mask = 0;
+		memory_barrier.dst_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		memory_barrier.src_stage_mask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		memory_barrier.dst_stage_mask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+		command_buffer.image_memory_barrier(luminance_view, memory_barrier);
+	}
+
+	lighting_subpass->get_fragment_shading_rate_state() = fragment_shading_rate_state;
+}
+
+void VariableRateShading::draw_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target)
+{
+	if (shading_rate_supported)
+	{
+		update_shading_rate(command_buffer, render_target);
+	}
+
+	VulkanSample::draw_renderpass(command_buffer, render_target);
+
+	if (shading_rate_supported)
+	{
+		previous_target    = &render_target;
+		previous_luminance = render_target.get_views().at(Luminance).get_handle();
+	}
+}
+
+void VariableRateShading::draw_gui()
+{
+	gui->show_options_window(
+	    /* body = */ [this]() {
+		    ImGui::Text("Lighting shading rate:");
+		    ImGui::RadioButton("1x1", &shading_rate, 0);
+		    ImGui::SameLine();
+		    ImGui::RadioButton("From luminance", &shading_rate, 1);
+
+		    ImGui::SliderFloat("Contrast threshold", &contrast_threshold, 0.0f, 0.5f);
+	    },
+	    /* lines = */ 2);
+}
+
+std::unique_ptr<vkb::VulkanSample> create_variable_rate_shading()
+{
+	return std::make_unique<VariableRateShading>();
+}
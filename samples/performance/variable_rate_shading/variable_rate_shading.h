@@ -0,0 +1,98 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "rendering/render_pipeline.h"
+#include "rendering/subpasses/lighting_subpass.h"
+#include "scene_graph/components/perspective_camera.h"
+#include "vulkan_sample.h"
+
+/**
+ * @brief Shades the deferred lighting at 2x2 pixels per fragment where the previous frame has little contrast,
+ *        with a shading rate attachment (VK_KHR_fragment_shading_rate). A compute pass generates the attachment
+ *        from the luminance the lighting writes, and the GPU times of both are shown with the gpu_time stat
+ */
+class VariableRateShading : public vkb::VulkanSample
+{
+  public:
+	VariableRateShading();
+
+	virtual ~VariableRateShading() = default;
+
+	virtual bool prepare(vkb::Platform &platform) override;
+
+	virtual void update(float delta_time) override;
+
+  private:
+	/// Attachments of the render targets, the last two only if shading rate attachments are supported
+	enum Attachment : uint32_t
+	{
+		Swapchain,
+		Depth,
+		Albedo,
+		Normal,
+		Luminance,
+		ShadingRate
+	};
+
+	virtual void prepare_render_context() override;
+
+	vkb::RenderTarget create_render_target(vkb::core::Image &&swapchain_image);
+
+	/**
+	 * @brief Generates the shading rate attachment of the render target from the luminance of the previous frame,
+	 *        or leaves it unused by the lighting if there is none
+	 */
+	void update_shading_rate(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target);
+
+	virtual void draw_renderpass(vkb::CommandBuffer &command_buffer, vkb::RenderTarget &render_target) override;
+
+	virtual void draw_gui() override;
+
+	vkb::sg::PerspectiveCamera *camera{nullptr};
+
+	/// Owned by the render pipeline
+	vkb::LightingSubpass *lighting_subpass{nullptr};
+
+	/// Whether the device supports shading rate attachments, and the storage images the compute writes them with
+	bool shading_rate_supported{false};
+
+	/// Pixels covered by a texel of the shading rate attachment
+	VkExtent2D shading_rate_texel_size{16, 16};
+
+	vkb::ShaderSource shading_rate_shader{"variable_rate_shading/shading_rate.comp"};
+
+	vkb::core::Sampler *luminance_sampler{nullptr};
+
+	/// The render target whose luminance the last frame wrote, and the view it wrote to. The views change when
+	/// the render targets are recreated, and the new ones hold no luminance yet
+	vkb::RenderTarget *previous_target{nullptr};
+
+	VkImageView previous_luminance{VK_NULL_HANDLE};
+
+	/// Whether the lighting reads the shading rate attachment, or shades every pixel
+	int shading_rate{1};
+
+	/// Contrast under which pixels are shaded at 2x2
+	float contrast_threshold{0.1f};
+};
+
+std::unique_ptr<vkb::VulkanSample> create_variable_rate_shading();
@@ -19,9 +19,22 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#ifdef BINDLESS_TEXTURES
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
 precision highp float;
 
-#ifdef HAS_BASE_COLOR_TEXTURE
+#ifdef BINDLESS_TEXTURES
+// All the scene textures, indexed by the material push constants
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+// Set from the define of the same name, so that materials with and without a texture share one module
+layout(constant_id = 0) const bool HAS_BASE_COLOR_TEXTURE = false;
+#elif defined(BASE_COLOR_TEXTURE_ARRAY)
+// Shared with other materials, which sample the layers given by their push constants
+layout(set = 0, binding = 0) uniform sampler2DArray base_color_texture;
+#elif defined(HAS_BASE_COLOR_TEXTURE)
 layout(set = 0, binding = 0) uniform sampler2D base_color_texture;
 #endif
 
@@ -31,11 +44,27 @@ layout(location = 2) in vec3 in_normal;
 
 layout(location = 0) out vec4 o_color;
 
+#ifdef MOTION_VECTORS
+layout(location = 3) in vec4 in_current_clip;
+layout(location = 4) in vec4 in_previous_clip;
+
+layout(location = 1) out vec2 o_motion;
+#endif
+
+#ifdef WEIGHTED_BLENDED_TRANSPARENCY
+// The color output accumulates the weighted premultiplied colors, the revealage multiplies the transmittances
+layout(location = 1) out float o_revealage;
+#endif
+
 layout(set = 0, binding = 1) uniform GlobalUniform
 {
-	mat4 model;
 	mat4 view_proj;
 	vec3 camera_position;
+#ifdef MOTION_VECTORS
+	// After the space of the views of a multiview subpass
+	layout(offset = 336) mat4 previous_view_proj;
+	layout(offset = 400) vec4 jitter;
+#endif
 }
 global_uniform;
 
@@ -47,12 +76,47 @@ struct Light
 	vec2 info;             // (only used for spot lights) info.x represents light inner cone angle, info.y represents light outer cone angle
 };
 
+#ifdef CLUSTERED_LIGHTS
+// All the lights, evaluated through the light lists of the clusters
+layout(set = 0, binding = 4) readonly buffer LightsInfo
+{
+	uint  count;
+	Light light[];
+}
+lights;
+
+layout(set = 0, binding = 5) uniform ClusterInfo
+{
+	mat4  view;
+	vec4  scale;        // xy: clusters per pixel, z and w: scale and bias from the log of the depth to the slice
+	uvec4 count;        // xyz: number of clusters, w: number of lights
+}
+clusters;
+
+// Offset and count of the light list of each cluster, followed by the lists
+layout(set = 0, binding = 6) readonly buffer ClusterLights
+{
+	uint data[];
+}
+cluster_lights;
+
+// Returns the offset and the count of the light list of the cluster containing a fragment
+uvec2 get_light_cluster(vec3 pos)
+{
+	float depth   = -(clusters.view * vec4(pos, 1.0)).z;
+	vec3  coord   = vec3(gl_FragCoord.xy * clusters.scale.xy, log(max(depth, 1e-4)) * clusters.scale.z + clusters.scale.w);
+	uvec3 cluster = uvec3(clamp(coord, vec3(0.0), vec3(clusters.count.xyz) - 1.0));
+	uint  index   = (cluster.z * clusters.count.y + cluster.y) * clusters.count.x + cluster.x;
+	return uvec2(cluster_lights.data[2U * index], cluster_lights.data[2U * index + 1U]);
+}
+#else
 layout(set = 0, binding = 4) uniform LightsInfo
 {
 	uint  count;
 	Light light[MAX_FORWARD_LIGHT_COUNT];
 }
 lights;
+#endif
 
 // Push constants come with a limitation in the size of data.
 // The standard requires at least 128 bytes
@@ -61,9 +125,107 @@ layout(push_constant, std430) uniform PBRMaterialUniform
 	vec4  base_color_factor;
 	float metallic_factor;
 	float roughness_factor;
+#if defined(BINDLESS_TEXTURES)
+	uint base_color_texture_index;
+#elif defined(BASE_COLOR_TEXTURE_ARRAY)
+	uint base_color_texture_layer;
+#elif defined(VIRTUAL_BASE_COLOR_TEXTURE)
+	uint virtual_page_offset;
+	uint virtual_extent;        // Width in the low 16 bits, height in the high ones
+	uint virtual_level_count;
+#endif
 }
 pbr_material_uniform;
 
+#ifdef VIRTUAL_BASE_COLOR_TEXTURE
+// The levels of the base color texture above its tail, in pages loaded on demand by VirtualTextures
+#ifdef VIRTUAL_TEXTURE_SPARSE
+layout(set = 1, binding = 0) uniform sampler2D virtual_texture;
+#else
+layout(set = 1, binding = 0) uniform sampler2D page_cache;
+#endif
+
+// Finest resident level around each page, with the slot of the page cache in the higher bits
+layout(set = 1, binding = 1) readonly buffer PageTable
+{
+	uint entries[];
+}
+page_table;
+
+// A bit set for each page sampled, read back by VirtualTextures to load the pages missing
+layout(set = 1, binding = 2) buffer PageFeedback
+{
+	uint bits[];
+}
+page_feedback;
+
+const uint  PAGE_SIZE   = 128U;
+const float PAGE_BORDER = 4.0;
+const uint  NO_PAGE     = 255U;
+
+vec4 sample_virtual_texture(vec2 uv)
+{
+	uvec2 extent = uvec2(pbr_material_uniform.virtual_extent & 0xFFFFU, pbr_material_uniform.virtual_extent >> 16U);
+
+	// Gradients taken before any branch, the tail is sampled with them
+	vec2 uv_dx = dFdx(uv);
+	vec2 uv_dy = dFdy(uv);
+
+	vec2  texel_dx = uv_dx * vec2(extent);
+	vec2  texel_dy = uv_dy * vec2(extent);
+	float lod      = 0.5 * log2(max(max(dot(texel_dx, texel_dx), dot(texel_dy, texel_dy)), 1e-8));
+	uint  level    = uint(clamp(floor(lod), 0.0, float(pbr_material_uniform.virtual_level_count)));
+
+	if (level >= pbr_material_uniform.virtual_level_count)
+	{
+		return textureGrad(base_color_texture, uv, uv_dx, uv_dy);
+	}
+
+	// The pages of a level follow those of the finer levels
+	uint  page_index   = pbr_material_uniform.virtual_page_offset;
+	uvec2 level_extent = extent;
+
+	for (uint l = 0U; l < level; l++)
+	{
+		uvec2 level_pages = (level_extent + PAGE_SIZE - 1U) / PAGE_SIZE;
+		page_index += level_pages.x * level_pages.y;
+		level_extent = max(level_extent >> 1U, uvec2(1U));
+	}
+
+	// Paged textures repeat
+	vec2  wrapped_uv  = fract(uv);
+	uvec2 level_pages = (level_extent + PAGE_SIZE - 1U) / PAGE_SIZE;
+	uvec2 page        = min(uvec2(wrapped_uv * vec2(level_extent)) / PAGE_SIZE, level_pages - 1U);
+	page_index += page.y * level_pages.x + page.x;
+
+	atomicOr(page_feedback.bits[page_index >> 5U], 1U << (page_index & 31U));
+
+	uint entry          = page_table.entries[page_index];
+	uint resident_level = entry & 0xFFU;
+
+	if (resident_level == NO_PAGE)
+	{
+		return textureGrad(base_color_texture, uv, uv_dx, uv_dy);
+	}
+
+	vec2 resident_extent = vec2(max(extent >> resident_level, uvec2(1U)));
+	vec2 texel           = wrapped_uv * resident_extent;
+	vec2 page_origin     = floor(texel / float(PAGE_SIZE)) * float(PAGE_SIZE);
+
+#ifdef VIRTUAL_TEXTURE_SPARSE
+	// Filtering stays within the page, the pages around it may not be resident
+	vec2 page_end = min(page_origin + float(PAGE_SIZE), resident_extent);
+	texel         = clamp(texel, page_origin + 0.5, page_end - 0.5);
+	return textureLod(virtual_texture, texel / resident_extent, float(resident_level));
+#else
+	// The border of the slot holds the texels around the page
+	vec2 slot        = vec2((entry >> 8U) & 0xFFFU, entry >> 20U);
+	vec2 cache_texel = slot * (float(PAGE_SIZE) + 2.0 * PAGE_BORDER) + PAGE_BORDER + texel - page_origin;
+	return textureLod(page_cache, cache_texel / vec2(textureSize(page_cache, 0)), 0.0);
+#endif
+}
+#endif
+
 vec3 apply_directional_light(uint index, vec3 normal)
 {
 	vec3 world_to_light = -lights.light[index].direction.xyz;
@@ -96,8 +258,16 @@ void main(void)
 
 	vec3 light_contribution = vec3(0.0);
 
+#ifdef CLUSTERED_LIGHTS
+	uvec2 cluster = get_light_cluster(in_pos.xyz);
+
+	for (uint c = 0U; c < cluster.y; c++)
+	{
+		uint i = cluster_lights.data[cluster.x + c];
+#else
 	for (uint i = 0U; i < lights.count; i++)
 	{
+#endif
 		if (lights.light[i].position.w == DIRECTIONAL_LIGHT)
 		{
 			light_contribution += apply_directional_light(i, normal);
@@ -110,7 +280,20 @@ void main(void)
 
 	vec4 base_color = vec4(1.0, 0.0, 0.0, 1.0);
 
-#ifdef HAS_BASE_COLOR_TEXTURE
+#if defined(BINDLESS_TEXTURES)
+	if (HAS_BASE_COLOR_TEXTURE)
+	{
+		base_color = texture(textures[pbr_material_uniform.base_color_texture_index], in_uv);
+	}
+	else
+	{
+		base_color = pbr_material_uniform.base_color_factor;
+	}
+#elif defined(BASE_COLOR_TEXTURE_ARRAY)
+	base_color = texture(base_color_texture, vec3(in_uv, float(pbr_material_uniform.base_color_texture_layer)));
+#elif defined(VIRTUAL_BASE_COLOR_TEXTURE)
+	base_color = sample_virtual_texture(in_uv);
+#elif defined(HAS_BASE_COLOR_TEXTURE)
 	base_color = texture(base_color_texture, in_uv);
 #else
 	base_color = pbr_material_uniform.base_color_factor;
@@ -119,4 +302,21 @@ void main(void)
 	vec3 ambient_color = vec3(0.2) * base_color.xyz;
 
 	o_color = vec4(ambient_color + light_contribution * base_color.xyz, base_color.w);
+
+#ifdef MOTION_VECTORS
+	// Motion in texture coordinates since the previous frame, without the jitter of either frame
+	vec2 current_position  = in_current_clip.xy / in_current_clip.w - global_uniform.jitter.xy;
+	vec2 previous_position = in_previous_clip.xy / in_previous_clip.w - global_uniform.jitter.zw;
+
+	o_motion = 0.5 * (current_position - previous_position);
+#endif
+
+#ifdef WEIGHTED_BLENDED_TRANSPARENCY
+	// Closer surfaces weigh more, from the distance to the camera (McGuire and Bavoil 2013, equation 9)
+	float distance = length(in_pos.xyz - global_uniform.camera_position);
+	float weight   = clamp(10.0 / (1e-5 + pow(distance / 5.0, 2.0) + pow(distance / 200.0, 6.0)), 1e-2, 3e3);
+
+	o_revealage = o_color.a;
+	o_color     = vec4(o_color.rgb * o_color.a, o_color.a) * (o_color.a * weight);
+#endif
 }
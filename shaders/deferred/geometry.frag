@@ -21,7 +21,10 @@
 
 precision highp float;
 
-#ifdef HAS_BASE_COLOR_TEXTURE
+#if defined(BASE_COLOR_TEXTURE_ARRAY)
+// Shared with other materials, which sample the layers given by their push constants
+layout (set=0, binding=0) uniform sampler2DArray base_color_texture;
+#elif defined(HAS_BASE_COLOR_TEXTURE)
 layout (set=0, binding=0) uniform sampler2D base_color_texture;
 #endif
 
@@ -29,11 +32,16 @@ layout (location = 0) in vec4 in_pos;
 layout (location = 1) in vec2 in_uv;
 layout (location = 2) in vec3 in_normal;
 
+#ifdef RASTERIZATION_ORDER_GBUFFER
+// The G-buffer follows the light in the color attachments of a single subpass, where the lighting reads it in rasterization order
+layout (location = 1) out vec4 o_albedo;
+layout (location = 2) out vec4 o_normal;
+#else
 layout (location = 0) out vec4 o_albedo;
 layout (location = 1) out vec4 o_normal;
+#endif
 
 layout(set = 0, binding = 1) uniform GlobalUniform {
-    mat4 model;
     mat4 view_proj;
     vec3 camera_position;
 } global_uniform;
@@ -42,21 +50,144 @@ layout(push_constant, std430) uniform PBRMaterialUniform {
     vec4 base_color_factor;
     float metallic_factor;
     float roughness_factor;
+#if defined(BASE_COLOR_TEXTURE_ARRAY)
+    uint base_color_texture_layer;
+#elif defined(VIRTUAL_BASE_COLOR_TEXTURE)
+    uint virtual_page_offset;
+    uint virtual_extent;        // Width in the low 16 bits, height in the high ones
+    uint virtual_level_count;
+#endif
 } pbr_material_uniform;
 
+#ifdef VIRTUAL_BASE_COLOR_TEXTURE
+// The levels of the base color texture above its tail, in pages loaded on demand by VirtualTextures
+#ifdef VIRTUAL_TEXTURE_SPARSE
+layout(set = 1, binding = 0) uniform sampler2D virtual_texture;
+#else
+layout(set = 1, binding = 0) uniform sampler2D page_cache;
+#endif
+
+// Finest resident level around each page, with the slot of the page cache in the higher bits
+layout(set = 1, binding = 1) readonly buffer PageTable
+{
+    uint entries[];
+}
+page_table;
+
+// A bit set for each page sampled, read back by VirtualTextures to load the pages missing
+layout(set = 1, binding = 2) buffer PageFeedback
+{
+    uint bits[];
+}
+page_feedback;
+
+const uint  PAGE_SIZE   = 128U;
+const float PAGE_BORDER = 4.0;
+const uint  NO_PAGE     = 255U;
+
+vec4 sample_virtual_texture(vec2 uv)
+{
+    uvec2 extent = uvec2(pbr_material_uniform.virtual_extent & 0xFFFFU, pbr_material_uniform.virtual_extent >> 16U);
+
+    // Gradients taken before any branch, the tail is sampled with them
+    vec2 uv_dx = dFdx(uv);
+    vec2 uv_dy = dFdy(uv);
+
+    vec2  texel_dx = uv_dx * vec2(extent);
+    vec2  texel_dy = uv_dy * vec2(extent);
+    float lod      = 0.5 * log2(max(max(dot(texel_dx, texel_dx), dot(texel_dy, texel_dy)), 1e-8));
+    uint  level    = uint(clamp(floor(lod), 0.0, float(pbr_material_uniform.virtual_level_count)));
+
+    if (level >= pbr_material_uniform.virtual_level_count)
+    {
+        return textureGrad(base_color_texture, uv, uv_dx, uv_dy);
+    }
+
+    // The pages of a level follow those of the finer levels
+    uint  page_index   = pbr_material_uniform.virtual_page_offset;
+    uvec2 level_extent = extent;
+
+    for (uint l = 0U; l < level; l++)
+    {
+        uvec2 level_pages = (level_extent + PAGE_SIZE - 1U) / PAGE_SIZE;
+        page_index += level_pages.x * level_pages.y;
+        level_extent = max(level_extent >> 1U, uvec2(1U));
+    }
+
+    // Paged textures repeat
+    vec2  wrapped_uv  = fract(uv);
+    uvec2 level_pages = (level_extent + PAGE_SIZE - 1U) / PAGE_SIZE;
+    uvec2 page        = min(uvec2(wrapped_uv * vec2(level_extent)) / PAGE_SIZE, level_pages - 1U);
+    page_index += page.y * level_pages.x + page.x;
+
+    atomicOr(page_feedback.bits[page_index >> 5U], 1U << (page_index & 31U));
+
+    uint entry          = page_table.entries[page_index];
+    uint resident_level = entry & 0xFFU;
+
+    if (resident_level == NO_PAGE)
+    {
+        return textureGrad(base_color_texture, uv, uv_dx, uv_dy);
+    }
+
+    vec2 resident_extent = vec2(max(extent >> resident_level, uvec2(1U)));
+    vec2 texel           = wrapped_uv * resident_extent;
+    vec2 page_origin     = floor(texel / float(PAGE_SIZE)) * float(PAGE_SIZE);
+
+#ifdef VIRTUAL_TEXTURE_SPARSE
+    // Filtering stays within the page, the pages around it may not be resident
+    vec2 page_end = min(page_origin + float(PAGE_SIZE), resident_extent);
+    texel         = clamp(texel, page_origin + 0.5, page_end - 0.5);
+    return textureLod(virtual_texture, texel / resident_extent, float(resident_level));
+#else
+    // The border of the slot holds the texels around the page
+    vec2 slot        = vec2((entry >> 8U) & 0xFFFU, entry >> 20U);
+    vec2 cache_texel = slot * (float(PAGE_SIZE) + 2.0 * PAGE_BORDER) + PAGE_BORDER + texel - page_origin;
+    return textureLod(page_cache, cache_texel / vec2(textureSize(page_cache, 0)), 0.0);
+#endif
+}
+#endif
+
+#ifdef GBUFFER_OCTAHEDRAL_NORMAL
+// Projects a unit vector on the octahedron and unfolds it to the [-1, 1] square,
+// so that a normal fits in two channels
+vec2 encode_octahedral(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signs;
+}
+#endif
+
 void main(void)
 {
     vec3 normal = normalize(in_normal);
+#ifdef GBUFFER_OCTAHEDRAL_NORMAL
+    o_normal = vec4(encode_octahedral(normal), 0.0, 0.0);
+#else
     // Transform normals from [-1, 1] to [0, 1]
     o_normal = vec4(0.5 * normal + 0.5, 1.0);
+#endif
 
     vec4 base_color = vec4(1.0, 0.0, 0.0, 1.0);
 
-#ifdef HAS_BASE_COLOR_TEXTURE
+#if defined(BASE_COLOR_TEXTURE_ARRAY)
+    base_color = texture(base_color_texture, vec3(in_uv, float(pbr_material_uniform.base_color_texture_layer)));
+#elif defined(VIRTUAL_BASE_COLOR_TEXTURE)
+    base_color = sample_virtual_texture(in_uv);
+#elif defined(HAS_BASE_COLOR_TEXTURE)
     base_color = texture(base_color_texture, in_uv);
 #else
     base_color = pbr_material_uniform.base_color_factor;
 #endif
 
+#ifdef GBUFFER_PACKED_MATERIAL
+    // The alpha channel is not needed by the lighting pass, it stores roughness
+    // in the high 4 bits and metallic in the low 4 bits
+    float roughness = floor(clamp(pbr_material_uniform.roughness_factor, 0.0, 1.0) * 15.0 + 0.5);
+    float metallic  = floor(clamp(pbr_material_uniform.metallic_factor, 0.0, 1.0) * 15.0 + 0.5);
+    o_albedo        = vec4(base_color.rgb, (roughness * 16.0 + metallic) / 255.0);
+#else
     o_albedo = base_color;
+#endif
 }
@@ -21,6 +21,13 @@
 
 precision highp float;
 
+#ifdef MEDIUMP_LIGHTING
+// Colors and lighting in mediump, which drivers can compute with 16-bit floats, positions staying in highp
+#define LIGHTING_PRECISION mediump
+#else
+#define LIGHTING_PRECISION highp
+#endif
+
 layout(input_attachment_index = 0, binding = 0) uniform subpassInput i_depth;
 layout(input_attachment_index = 1, binding = 1) uniform subpassInput i_albedo;
 layout(input_attachment_index = 2, binding = 2) uniform subpassInput i_normal;
@@ -29,6 +36,11 @@ layout(location = 0) in vec2 in_uv;
 
 layout(location = 0) out vec4 o_color;
 
+#ifdef LUMINANCE_OUTPUT
+// Read by the next frame to choose where the lighting can be shaded at a coarser rate
+layout(location = 1) out float o_luminance;
+#endif
+
 layout(set = 0, binding = 3) uniform GlobalUniform
 {
 	mat4 inv_view_proj;
@@ -44,25 +56,91 @@ struct Light
 	vec2 info;             // (only used for spot lights) info.x represents light inner cone angle, info.y represents light outer cone angle
 };
 
+#ifdef CLUSTERED_LIGHTS
+// All the lights, evaluated through the light lists of the clusters
+layout(set = 0, binding = 4) readonly buffer LightsInfo
+{
+	uint  count;
+	Light lights[];
+}
+lights;
+
+layout(set = 0, binding = 5) uniform ClusterInfo
+{
+	mat4  view;
+	vec4  scale;        // xy: clusters per pixel, z and w: scale and bias from the log of the depth to the slice
+	uvec4 count;        // xyz: number of clusters, w: number of lights
+}
+clusters;
+
+// Offset and count of the light list of each cluster, followed by the lists
+layout(set = 0, binding = 6) readonly buffer ClusterLights
+{
+	uint data[];
+}
+cluster_lights;
+
+// Returns the offset and the count of the light list of the cluster containing a fragment
+uvec2 get_light_cluster(vec3 pos)
+{
+	float depth   = -(clusters.view * vec4(pos, 1.0)).z;
+	vec3  coord   = vec3(gl_FragCoord.xy * clusters.scale.xy, log(max(depth, 1e-4)) * clusters.scale.z + clusters.scale.w);
+	uvec3 cluster = uvec3(clamp(coord, vec3(0.0), vec3(clusters.count.xyz) - 1.0));
+	uint  index   = (cluster.z * clusters.count.y + cluster.y) * clusters.count.x + cluster.x;
+	return uvec2(cluster_lights.data[2U * index], cluster_lights.data[2U * index + 1U]);
+}
+#else
 layout(set = 0, binding = 4) uniform LightsInfo
 {
 	uint  count;
 	Light lights[MAX_DEFERRED_LIGHT_COUNT];
 }
 lights;
+#endif
+
+#ifdef SHADOWS
+layout(set = 0, binding = 7) uniform highp sampler2DShadow shadow_map;
 
-vec3 apply_directional_light(uint index, vec3 normal)
+layout(set = 0, binding = 8) uniform ShadowInfo
 {
-	vec3 world_to_light = -lights.lights[index].direction.xyz;
+	mat4 view;
+	mat4 view_proj[MAX_SHADOW_CASCADE_COUNT];
+	vec4 atlas_rect[MAX_SHADOW_CASCADE_COUNT];        // xy: offset, zw: scale of the cascade in the atlas
+	vec4 split_depth;                                 // view space distance where each cascade ends
+	uint count;
+}
+shadow;
 
-	world_to_light = normalize(world_to_light);
+// Returns the fraction of a directional light reaching a fragment, from the first cascade containing it
+float get_shadow(vec3 pos)
+{
+	float depth = -(shadow.view * vec4(pos, 1.0)).z;
 
-	float ndotl = clamp(dot(normal, world_to_light), 0.0, 1.0);
+	for (uint c = 0U; c < shadow.count; c++)
+	{
+		if (depth < shadow.split_depth[c])
+		{
+			vec4 clip = shadow.view_proj[c] * vec4(pos, 1.0);
+			vec2 uv   = clamp(clip.xy * 0.5 + 0.5, 0.0, 1.0);
+			return texture(shadow_map, vec3(shadow.atlas_rect[c].xy + uv * shadow.atlas_rect[c].zw, clip.z));
+		}
+	}
+
+	// Beyond the shadow distance
+	return 1.0;
+}
+#endif
+
+LIGHTING_PRECISION vec3 apply_directional_light(uint index, LIGHTING_PRECISION vec3 normal)
+{
+	LIGHTING_PRECISION vec3 world_to_light = normalize(-lights.lights[index].direction.xyz);
+
+	LIGHTING_PRECISION float ndotl = clamp(dot(normal, world_to_light), 0.0, 1.0);
 
 	return ndotl * lights.lights[index].color.w * lights.lights[index].color.rgb;
 }
 
-vec3 apply_point_light(uint index, vec3 pos, vec3 normal)
+LIGHTING_PRECISION vec3 apply_point_light(uint index, vec3 pos, LIGHTING_PRECISION vec3 normal)
 {
 	vec3 world_to_light = lights.lights[index].position.xyz - pos;
 
@@ -70,33 +148,89 @@ vec3 apply_point_light(uint index, vec3 pos, vec3 normal)
 
 	float atten = 1.0 / (dist * dist);
 
-	world_to_light = normalize(world_to_light);
+	LIGHTING_PRECISION vec3 light_direction = normalize(world_to_light);
 
-	float ndotl = clamp(dot(normal, world_to_light), 0.0, 1.0);
+	LIGHTING_PRECISION float ndotl = clamp(dot(normal, light_direction), 0.0, 1.0);
 
 	return ndotl * lights.lights[index].color.w * atten * lights.lights[index].color.rgb;
 }
 
+void write_color(LIGHTING_PRECISION vec3 color)
+{
+	o_color = vec4(color, 1.0);
+
+#ifdef LUMINANCE_OUTPUT
+	o_luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+#endif
+}
+
+#ifdef GBUFFER_OCTAHEDRAL_NORMAL
+// Folds back a normal unfolded from the octahedron by the geometry pass
+LIGHTING_PRECISION vec3 decode_octahedral(LIGHTING_PRECISION vec2 e)
+{
+	LIGHTING_PRECISION vec3  n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	LIGHTING_PRECISION float t = clamp(-n.z, 0.0, 1.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+#endif
+
 void main()
 {
 	// Retrieve position from depth
-	vec4  clip         = vec4(gl_FragCoord.xy * global_uniform.inv_resolution * 2.0 - 1.0, subpassLoad(i_depth).x, 1.0);
+	float depth = subpassLoad(i_depth).x;
+
+	// The cleared depth is at infinity with an infinite far plane, where there is nothing to light
+	if (depth == 0.0)
+	{
+		write_color(vec3(0.2) * subpassLoad(i_albedo).xyz);
+		return;
+	}
+
+	vec4  clip         = vec4(gl_FragCoord.xy * global_uniform.inv_resolution * 2.0 - 1.0, depth, 1.0);
 	highp vec4 world_w = global_uniform.inv_view_proj * clip;
 	highp vec3 pos     = world_w.xyz / world_w.w;
 
-	vec4 albedo = subpassLoad(i_albedo);
+	LIGHTING_PRECISION vec4 albedo = subpassLoad(i_albedo);
+
+#ifdef GBUFFER_PACKED_MATERIAL
+	// Roughness is in the high 4 bits, metallic in the low 4 bits. Metals have no diffuse reflection
+	uint                     material = uint(albedo.a * 255.0 + 0.5);
+	LIGHTING_PRECISION float metallic = float(material & 15U) / 15.0;
+	albedo.rgb *= 1.0 - metallic;
+#endif
+
+#ifdef GBUFFER_OCTAHEDRAL_NORMAL
+	LIGHTING_PRECISION vec3 normal = decode_octahedral(subpassLoad(i_normal).xy);
+#else
 	// Transform from [0,1] to [-1,1]
-	vec3 normal = subpassLoad(i_normal).xyz;
-	normal      = normalize(2.0 * normal - 1.0);
+	LIGHTING_PRECISION vec3 normal = subpassLoad(i_normal).xyz;
+	normal                         = normalize(2.0 * normal - 1.0);
+#endif
 
 	// Calculate lighting
-	vec3 L = vec3(0.0);
+	LIGHTING_PRECISION vec3 L = vec3(0.0);
+
+#ifdef SHADOWS
+	LIGHTING_PRECISION float shadow_factor = get_shadow(pos);
+#else
+	LIGHTING_PRECISION float shadow_factor = 1.0;
+#endif
 
+#ifdef CLUSTERED_LIGHTS
+	uvec2 cluster = get_light_cluster(pos);
+
+	for (uint c = 0U; c < cluster.y; c++)
+	{
+		uint i = cluster_lights.data[cluster.x + c];
+#else
 	for (uint i = 0U; i < lights.count; i++)
 	{
+#endif
 		if (lights.lights[i].position.w == DIRECTIONAL_LIGHT)
 		{
-			L += apply_directional_light(i, normal);
+			L += shadow_factor * apply_directional_light(i, normal);
 		}
 		if (lights.lights[i].position.w == POINT_LIGHT)
 		{
@@ -104,7 +238,7 @@ void main()
 		}
 	}
 
-	vec3 ambient_color = vec3(0.2) * albedo.xyz;
+	LIGHTING_PRECISION vec3 ambient_color = vec3(0.2) * albedo.xyz;
 
-	o_color = vec4(ambient_color + L * albedo.xyz, 1.0);
+	write_color(ambient_color + L * albedo.xyz);
 }
@@ -0,0 +1,68 @@
+#version 320 es
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+layout(location = 0) in vec3 position;
+
+#ifdef INSTANCING
+layout(location = 3) in mat4 instance_model;
+#endif
+
+#ifdef SKINNING
+layout(location = 7) in uvec4 joints_0;
+layout(location = 8) in vec4 weights_0;
+
+// Joint matrices in world space, the transform of the skinned node is not applied
+layout(set = 0, binding = 10) readonly buffer JointMatrices
+{
+    mat4 joint_matrices[];
+};
+#endif
+
+layout(set = 0, binding = 1) uniform GlobalUniform {
+    mat4 view_proj;
+    vec3 camera_position;
+} global_uniform;
+
+#if !defined(SKINNING) && !defined(INSTANCING)
+// Written for each draw, bound at a dynamic offset into a single allocation
+layout(set = 0, binding = 15) uniform ModelUniform {
+    mat4 model;
+} model_uniform;
+#endif
+
+// Computed the same way as in the vertex shaders of the main pass, as they are compared with an equal test
+invariant gl_Position;
+
+void main(void)
+{
+#if defined(SKINNING)
+    mat4 model = weights_0.x * joint_matrices[joints_0.x] +
+                 weights_0.y * joint_matrices[joints_0.y] +
+                 weights_0.z * joint_matrices[joints_0.z] +
+                 weights_0.w * joint_matrices[joints_0.w];
+#elif defined(INSTANCING)
+    mat4 model = instance_model;
+#else
+    mat4 model = model_uniform.model;
+#endif
+
+    gl_Position = global_uniform.view_proj * (model * vec4(position, 1.0));
+}
@@ -0,0 +1,59 @@
+#version 450
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+
+struct Particle
+{
+	vec4 position;        // w is the remaining life
+	vec4 velocity;        // w is the life it was emitted with
+};
+
+// The live particles, one instance each
+layout(set = 0, binding = 0) readonly buffer Particles
+{
+	Particle particles[];
+};
+
+layout(push_constant) uniform ParticleUniform
+{
+	mat4 view_proj;
+	vec4 camera_right;        // w is the size of the particles
+	vec4 camera_up;
+}
+particle_uniform;
+
+layout(location = 0) out vec2 o_corner;
+layout(location = 1) out vec4 o_color;
+
+void main(void)
+{
+	Particle particle = particles[gl_InstanceIndex];
+
+	// Quad facing the camera, vertices 0 and 3 on opposite corners
+	vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1) * 2.0 - 1.0;
+
+	vec3 offset = (corner.x * particle_uniform.camera_right.xyz + corner.y * particle_uniform.camera_up.xyz) * particle_uniform.camera_right.w;
+
+	gl_Position = particle_uniform.view_proj * vec4(particle.position.xyz + offset, 1.0);
+
+	// Particles cool down and fade out as they age
+	float age = 1.0 - clamp(particle.position.w / particle.velocity.w, 0.0, 1.0);
+
+	o_corner = corner;
+	o_color  = vec4(mix(vec3(1.0, 0.8, 0.3), vec3(0.9, 0.2, 0.05), age), 1.0 - age);
+}
@@ -0,0 +1,44 @@
+#version 320 es
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+layout(push_constant, std430) uniform Proxy
+{
+    mat4 view_proj;
+    vec4 min;
+    vec4 max;
+} proxy;
+
+// Corners of the box as bits of an index, and the triangles of its faces
+const uint indices[36] = uint[](0U, 1U, 3U, 0U, 3U, 2U,
+                                4U, 6U, 7U, 4U, 7U, 5U,
+                                0U, 4U, 5U, 0U, 5U, 1U,
+                                2U, 3U, 7U, 2U, 7U, 6U,
+                                0U, 2U, 6U, 0U, 6U, 4U,
+                                1U, 5U, 7U, 1U, 7U, 3U);
+
+void main(void)
+{
+    uint corner = indices[gl_VertexIndex];
+
+    vec3 position = mix(proxy.min.xyz, proxy.max.xyz, vec3(uvec3(corner, corner >> 1U, corner >> 2U) & 1U));
+
+    gl_Position = proxy.view_proj * vec4(position, 1.0);
+}
@@ -32,7 +32,17 @@
 
 precision highp float;
 
-#ifdef HAS_BASE_COLOR_TEXTURE
+#ifdef MEDIUMP_LIGHTING
+// Colors and lighting in mediump, which drivers can compute with 16-bit floats, positions staying in highp
+#define LIGHTING_PRECISION mediump
+#else
+#define LIGHTING_PRECISION highp
+#endif
+
+#if defined(BASE_COLOR_TEXTURE_ARRAY)
+// Shared with other materials, which sample the layers given by their push constants
+layout(set = 0, binding = 0) uniform sampler2DArray base_color_texture;
+#elif defined(HAS_BASE_COLOR_TEXTURE)
 layout(set = 0, binding = 0) uniform sampler2D base_color_texture;
 #endif
 
@@ -52,7 +62,6 @@ layout(location = 0) out vec4 o_color;
 
 layout(set = 0, binding = 1) uniform GlobalUniform
 {
-	mat4 model;
 	mat4 view_proj;
 	vec3 camera_position;
 }
@@ -66,58 +75,197 @@ struct Light
 	vec2 info;             // (only used for spot lights) info.x represents light inner cone angle, info.y represents light outer cone angle
 };
 
+#ifdef CLUSTERED_LIGHTS
+// All the lights, evaluated through the light lists of the clusters
+layout(set = 0, binding = 4) readonly buffer LightsInfo
+{
+	uint  count;
+	Light lights[];
+}
+lights;
+
+layout(set = 0, binding = 5) uniform ClusterInfo
+{
+	mat4  view;
+	vec4  scale;        // xy: clusters per pixel, z and w: scale and bias from the log of the depth to the slice
+	uvec4 count;        // xyz: number of clusters, w: number of lights
+}
+clusters;
+
+// Offset and count of the light list of each cluster, followed by the lists
+layout(set = 0, binding = 6) readonly buffer ClusterLights
+{
+	uint data[];
+}
+cluster_lights;
+
+// Returns the offset and the count of the light list of the cluster containing a fragment
+uvec2 get_light_cluster(vec3 pos)
+{
+	float depth   = -(clusters.view * vec4(pos, 1.0)).z;
+	vec3  coord   = vec3(gl_FragCoord.xy * clusters.scale.xy, log(max(depth, 1e-4)) * clusters.scale.z + clusters.scale.w);
+	uvec3 cluster = uvec3(clamp(coord, vec3(0.0), vec3(clusters.count.xyz) - 1.0));
+	uint  index   = (cluster.z * clusters.count.y + cluster.y) * clusters.count.x + cluster.x;
+	return uvec2(cluster_lights.data[2U * index], cluster_lights.data[2U * index + 1U]);
+}
+#else
 layout(set = 0, binding = 4) uniform LightsInfo
 {
 	uint  count;
 	Light lights[MAX_FORWARD_LIGHT_COUNT];
 }
 lights;
+#endif
+
+#ifdef IBL
+// Precomputed by EnvironmentLighting: the irradiance, the radiance prefiltered by roughness in its levels,
+// and the scale and bias of the Fresnel reflectance
+layout(set = 0, binding = 7) uniform samplerCube irradiance_map;
+layout(set = 0, binding = 8) uniform samplerCube prefiltered_map;
+layout(set = 0, binding = 9) uniform sampler2D brdf_lut;
+#endif
 
 layout(push_constant, std430) uniform PBRMaterialUniform
 {
 	vec4  base_color_factor;
 	float metallic_factor;
 	float roughness_factor;
+#if defined(BASE_COLOR_TEXTURE_ARRAY)
+	uint base_color_texture_layer;
+#elif defined(VIRTUAL_BASE_COLOR_TEXTURE)
+	uint virtual_page_offset;
+	uint virtual_extent;        // Width in the low 16 bits, height in the high ones
+	uint virtual_level_count;
+#endif
 }
 pbr_material_uniform;
 
+#ifdef VIRTUAL_BASE_COLOR_TEXTURE
+// The levels of the base color texture above its tail, in pages loaded on demand by VirtualTextures
+#ifdef VIRTUAL_TEXTURE_SPARSE
+layout(set = 1, binding = 0) uniform sampler2D virtual_texture;
+#else
+layout(set = 1, binding = 0) uniform sampler2D page_cache;
+#endif
+
+// Finest resident level around each page, with the slot of the page cache in the higher bits
+layout(set = 1, binding = 1) readonly buffer PageTable
+{
+	uint entries[];
+}
+page_table;
+
+// A bit set for each page sampled, read back by VirtualTextures to load the pages missing
+layout(set = 1, binding = 2) buffer PageFeedback
+{
+	uint bits[];
+}
+page_feedback;
+
+const uint  PAGE_SIZE   = 128U;
+const float PAGE_BORDER = 4.0;
+const uint  NO_PAGE     = 255U;
+
+vec4 sample_virtual_texture(vec2 uv)
+{
+	uvec2 extent = uvec2(pbr_material_uniform.virtual_extent & 0xFFFFU, pbr_material_uniform.virtual_extent >> 16U);
+
+	// Gradients taken before any branch, the tail is sampled with them
+	vec2 uv_dx = dFdx(uv);
+	vec2 uv_dy = dFdy(uv);
+
+	vec2  texel_dx = uv_dx * vec2(extent);
+	vec2  texel_dy = uv_dy * vec2(extent);
+	float lod      = 0.5 * log2(max(max(dot(texel_dx, texel_dx), dot(texel_dy, texel_dy)), 1e-8));
+	uint  level    = uint(clamp(floor(lod), 0.0, float(pbr_material_uniform.virtual_level_count)));
+
+	if (level >= pbr_material_uniform.virtual_level_count)
+	{
+		return textureGrad(base_color_texture, uv, uv_dx, uv_dy);
+	}
+
+	// The pages of a level follow those of the finer levels
+	uint  page_index   = pbr_material_uniform.virtual_page_offset;
+	uvec2 level_extent = extent;
+
+	for (uint l = 0U; l < level; l++)
+	{
+		uvec2 level_pages = (level_extent + PAGE_SIZE - 1U) / PAGE_SIZE;
+		page_index += level_pages.x * level_pages.y;
+		level_extent = max(level_extent >> 1U, uvec2(1U));
+	}
+
+	// Paged textures repeat
+	vec2  wrapped_uv  = fract(uv);
+	uvec2 level_pages = (level_extent + PAGE_SIZE - 1U) / PAGE_SIZE;
+	uvec2 page        = min(uvec2(wrapped_uv * vec2(level_extent)) / PAGE_SIZE, level_pages - 1U);
+	page_index += page.y * level_pages.x + page.x;
+
+	atomicOr(page_feedback.bits[page_index >> 5U], 1U << (page_index & 31U));
+
+	uint entry          = page_table.entries[page_index];
+	uint resident_level = entry & 0xFFU;
+
+	if (resident_level == NO_PAGE)
+	{
+		return textureGrad(base_color_texture, uv, uv_dx, uv_dy);
+	}
+
+	vec2 resident_extent = vec2(max(extent >> resident_level, uvec2(1U)));
+	vec2 texel           = wrapped_uv * resident_extent;
+	vec2 page_origin     = floor(texel / float(PAGE_SIZE)) * float(PAGE_SIZE);
+
+#ifdef VIRTUAL_TEXTURE_SPARSE
+	// Filtering stays within the page, the pages around it may not be resident
+	vec2 page_end = min(page_origin + float(PAGE_SIZE), resident_extent);
+	texel         = clamp(texel, page_origin + 0.5, page_end - 0.5);
+	return textureLod(virtual_texture, texel / resident_extent, float(resident_level));
+#else
+	// The border of the slot holds the texels around the page
+	vec2 slot        = vec2((entry >> 8U) & 0xFFFU, entry >> 20U);
+	vec2 cache_texel = slot * (float(PAGE_SIZE) + 2.0 * PAGE_BORDER) + PAGE_BORDER + texel - page_origin;
+	return textureLod(page_cache, cache_texel / vec2(textureSize(page_cache, 0)), 0.0);
+#endif
+}
+#endif
+
 const float PI = 3.14159265359;
 
-vec3 F0 = vec3(0.04);
+LIGHTING_PRECISION vec3 F0 = vec3(0.04);
 
 // [0] Frensel Schlick
-vec3 F_Schlick(vec3 f0, float f90, float u)
+LIGHTING_PRECISION vec3 F_Schlick(LIGHTING_PRECISION vec3 f0, LIGHTING_PRECISION float f90, LIGHTING_PRECISION float u)
 {
 	return f0 + (f90 - f0) * pow(1.0 - u, 5.0);
 }
 
 // [1] IBL Defuse Irradiance
-vec3 F_Schlick_Roughness(vec3 F0, float cos_theta, float roughness)
+LIGHTING_PRECISION vec3 F_Schlick_Roughness(LIGHTING_PRECISION vec3 F0, LIGHTING_PRECISION float cos_theta, LIGHTING_PRECISION float roughness)
 {
 	return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(1.0 - cos_theta, 5.0);
 }
 
 // [0] Diffuse Term
-float Fr_DisneyDiffuse(float NdotV, float NdotL, float LdotH, float roughness)
+LIGHTING_PRECISION float Fr_DisneyDiffuse(LIGHTING_PRECISION float NdotV, LIGHTING_PRECISION float NdotL, LIGHTING_PRECISION float LdotH, LIGHTING_PRECISION float roughness)
 {
-	float E_bias        = 0.0 * (1.0 - roughness) + 0.5 * roughness;
-	float E_factor      = 1.0 * (1.0 - roughness) + (1.0 / 1.51) * roughness;
-	float fd90          = E_bias + 2.0 * LdotH * LdotH * roughness;
-	vec3  f0            = vec3(1.0);
-	float light_scatter = F_Schlick(f0, fd90, NdotL).r;
-	float view_scatter  = F_Schlick(f0, fd90, NdotV).r;
+	LIGHTING_PRECISION float E_bias        = 0.0 * (1.0 - roughness) + 0.5 * roughness;
+	LIGHTING_PRECISION float E_factor      = 1.0 * (1.0 - roughness) + (1.0 / 1.51) * roughness;
+	LIGHTING_PRECISION float fd90          = E_bias + 2.0 * LdotH * LdotH * roughness;
+	LIGHTING_PRECISION vec3  f0            = vec3(1.0);
+	LIGHTING_PRECISION float light_scatter = F_Schlick(f0, fd90, NdotL).r;
+	LIGHTING_PRECISION float view_scatter  = F_Schlick(f0, fd90, NdotV).r;
 	return light_scatter * view_scatter * E_factor;
 }
 
 // [0] Specular Microfacet Model
-float V_SmithGGXCorrelated(float NdotV, float NdotL, float roughness)
+LIGHTING_PRECISION float V_SmithGGXCorrelated(LIGHTING_PRECISION float NdotV, LIGHTING_PRECISION float NdotL, LIGHTING_PRECISION float roughness)
 {
-	float alphaRoughnessSq = roughness * roughness;
+	LIGHTING_PRECISION float alphaRoughnessSq = roughness * roughness;
 
-	float GGXV = NdotL * sqrt(NdotV * NdotV * (1.0 - alphaRoughnessSq) + alphaRoughnessSq);
-	float GGXL = NdotV * sqrt(NdotL * NdotL * (1.0 - alphaRoughnessSq) + alphaRoughnessSq);
+	LIGHTING_PRECISION float GGXV = NdotL * sqrt(NdotV * NdotV * (1.0 - alphaRoughnessSq) + alphaRoughnessSq);
+	LIGHTING_PRECISION float GGXL = NdotV * sqrt(NdotL * NdotL * (1.0 - alphaRoughnessSq) + alphaRoughnessSq);
 
-	float GGX = GGXV + GGXL;
+	LIGHTING_PRECISION float GGX = GGXV + GGXL;
 	if (GGX > 0.0)
 	{
 		return 0.5 / GGX;
@@ -126,14 +274,14 @@ float V_SmithGGXCorrelated(float NdotV, float NdotL, float roughness)
 }
 
 // [0] GGX Normal Distribution Function
-float D_GGX(float NdotH, float roughness)
+LIGHTING_PRECISION float D_GGX(LIGHTING_PRECISION float NdotH, LIGHTING_PRECISION float roughness)
 {
-	float alphaRoughnessSq = roughness * roughness;
-	float f                = (NdotH * alphaRoughnessSq - NdotH) * NdotH + 1.0;
+	LIGHTING_PRECISION float alphaRoughnessSq = roughness * roughness;
+	LIGHTING_PRECISION float f                = (NdotH * alphaRoughnessSq - NdotH) * NdotH + 1.0;
 	return alphaRoughnessSq / (PI * f * f);
 }
 
-vec3 normal()
+LIGHTING_PRECISION vec3 normal()
 {
 	vec3 pos_dx = dFdx(in_pos);
 	vec3 pos_dy = dFdy(in_pos);
@@ -153,33 +301,31 @@ vec3 normal()
 #endif
 }
 
-vec3 diffuse(vec3 albedo, float metallic)
+LIGHTING_PRECISION vec3 diffuse(LIGHTING_PRECISION vec3 albedo, LIGHTING_PRECISION float metallic)
 {
 	return albedo * (1.0 - metallic) + ((1.0 - metallic) * albedo) * metallic;
 }
 
-float saturate(float t)
+LIGHTING_PRECISION float saturate(LIGHTING_PRECISION float t)
 {
 	return clamp(t, 0.0, 1.0);
 }
 
-vec3 saturate(vec3 t)
+LIGHTING_PRECISION vec3 saturate(LIGHTING_PRECISION vec3 t)
 {
 	return clamp(t, 0.0, 1.0);
 }
 
-vec3 apply_directional_light(uint index, vec3 normal)
+LIGHTING_PRECISION vec3 apply_directional_light(uint index, LIGHTING_PRECISION vec3 normal)
 {
-	vec3 world_to_light = -lights.lights[index].direction.xyz;
+	LIGHTING_PRECISION vec3 world_to_light = normalize(-lights.lights[index].direction.xyz);
 
-	world_to_light = normalize(world_to_light);
-
-	float ndotl = clamp(dot(normal, world_to_light), 0.0, 1.0);
+	LIGHTING_PRECISION float ndotl = clamp(dot(normal, world_to_light), 0.0, 1.0);
 
 	return ndotl * lights.lights[index].color.w * lights.lights[index].color.rgb;
 }
 
-vec3 apply_point_light(uint index, vec3 normal)
+LIGHTING_PRECISION vec3 apply_point_light(uint index, LIGHTING_PRECISION vec3 normal)
 {
 	vec3 world_to_light = lights.lights[index].position.xyz - in_pos.xyz;
 
@@ -187,9 +333,9 @@ vec3 apply_point_light(uint index, vec3 normal)
 
 	float atten = 1.0 / (dist * dist);
 
-	world_to_light = normalize(world_to_light);
+	LIGHTING_PRECISION vec3 light_direction = normalize(world_to_light);
 
-	float ndotl = clamp(dot(normal, world_to_light), 0.0, 1.0);
+	LIGHTING_PRECISION float ndotl = clamp(dot(normal, light_direction), 0.0, 1.0);
 
 	return ndotl * lights.lights[index].color.w * atten * lights.lights[index].color.rgb;
 }
@@ -210,45 +356,63 @@ void main(void)
 {
 	// vec3 position = vec3(0, 0, 0);
 
-	float F90        = saturate(50.0 * F0.r);
-	vec4  base_color = vec4(1.0, 0.0, 0.0, 1.0);
+	LIGHTING_PRECISION float F90        = saturate(50.0 * F0.r);
+	LIGHTING_PRECISION vec4  base_color = vec4(1.0, 0.0, 0.0, 1.0);
 
-#ifdef HAS_BASE_COLOR_TEXTURE
+#if defined(BASE_COLOR_TEXTURE_ARRAY)
+	base_color = texture(base_color_texture, vec3(in_uv, float(pbr_material_uniform.base_color_texture_layer)));
+#elif defined(VIRTUAL_BASE_COLOR_TEXTURE)
+	base_color = sample_virtual_texture(in_uv);
+#elif defined(HAS_BASE_COLOR_TEXTURE)
 	base_color = texture(base_color_texture, in_uv);
 #else
 	base_color      = pbr_material_uniform.base_color_factor;
 #endif
 
 #ifdef HAS_METALLIC_ROUGHNESS_TEXTURE
-	float roughness = saturate(texture(metallic_roughness_texture, in_uv).g);
-	float metallic  = saturate(texture(metallic_roughness_texture, in_uv).b);
+	LIGHTING_PRECISION float roughness = saturate(texture(metallic_roughness_texture, in_uv).g);
+	LIGHTING_PRECISION float metallic  = saturate(texture(metallic_roughness_texture, in_uv).b);
 #else
-	float roughness = pbr_material_uniform.roughness_factor;
-	float metallic  = pbr_material_uniform.metallic_factor;
+	LIGHTING_PRECISION float roughness = pbr_material_uniform.roughness_factor;
+	LIGHTING_PRECISION float metallic  = pbr_material_uniform.metallic_factor;
+#endif
+
+#ifdef MEDIUMP_LIGHTING
+	// The fourth power of smaller roughnesses is below the range of 16-bit floats
+	roughness = max(roughness, 0.089);
 #endif
 
-	vec3  N     = normal();
-	vec3  V     = normalize(global_uniform.camera_position - in_pos);
-	float NdotV = saturate(dot(N, V));
+	LIGHTING_PRECISION vec3  N     = normal();
+	LIGHTING_PRECISION vec3  V     = normalize(global_uniform.camera_position - in_pos);
+	LIGHTING_PRECISION float NdotV = saturate(dot(N, V));
+
+	LIGHTING_PRECISION vec3 LightContribution = vec3(0.0);
+	LIGHTING_PRECISION vec3 diffuse_color     = base_color.rgb * (1.0 - metallic);
 
-	vec3 LightContribution = vec3(0.0);
-	vec3 diffuse_color     = base_color.rgb * (1.0 - metallic);
+#ifdef CLUSTERED_LIGHTS
+	uvec2 cluster = get_light_cluster(in_pos);
 
+	for (uint c = 0U; c < cluster.y; ++c)
+	{
+		uint i = cluster_lights.data[cluster.x + c];
+#else
 	for (uint i = 0U; i < lights.count; ++i)
 	{
-		vec3 L = get_light_direction(i);
-		vec3 H = normalize(V + L);
+#endif
+		// Normalized in highp, as the vector to a point light is in world units
+		LIGHTING_PRECISION vec3 L = normalize(get_light_direction(i));
+		LIGHTING_PRECISION vec3 H = normalize(V + L);
 
-		float LdotH = saturate(dot(L, H));
-		float NdotH = saturate(dot(N, H));
-		float NdotL = saturate(dot(N, L));
+		LIGHTING_PRECISION float LdotH = saturate(dot(L, H));
+		LIGHTING_PRECISION float NdotH = saturate(dot(N, H));
+		LIGHTING_PRECISION float NdotL = saturate(dot(N, L));
 
-		vec3  F   = F_Schlick(F0, F90, LdotH);
-		float Vis = V_SmithGGXCorrelated(NdotV, NdotL, roughness);
-		float D   = D_GGX(NdotH, roughness);
-		vec3  Fr  = F * D * Vis;
+		LIGHTING_PRECISION vec3  F   = F_Schlick(F0, F90, LdotH);
+		LIGHTING_PRECISION float Vis = V_SmithGGXCorrelated(NdotV, NdotL, roughness);
+		LIGHTING_PRECISION float D   = D_GGX(NdotH, roughness);
+		LIGHTING_PRECISION vec3  Fr  = F * D * Vis;
 
-		float Fd = Fr_DisneyDiffuse(NdotV, NdotL, LdotH, roughness);
+		LIGHTING_PRECISION float Fd = Fr_DisneyDiffuse(NdotV, NdotL, LdotH, roughness);
 
 		if (lights.lights[i].position.w == DIRECTIONAL_LIGHT)
 		{
@@ -260,13 +424,29 @@ void main(void)
 		}
 	}
 
+#ifdef IBL
+	// [1] Split sum approximation of the specular environment lighting, metals reflecting their base color
+	LIGHTING_PRECISION vec3 specular_color = mix(F0, base_color.rgb, metallic);
+	LIGHTING_PRECISION vec3 F              = F_Schlick_Roughness(specular_color, NdotV, roughness);
+
+	LIGHTING_PRECISION vec3  R          = reflect(-V, N);
+	LIGHTING_PRECISION float lod        = roughness * float(textureQueryLevels(prefiltered_map) - 1);
+	LIGHTING_PRECISION vec3  radiance   = textureLod(prefiltered_map, R, lod).rgb;
+	LIGHTING_PRECISION vec2  brdf       = texture(brdf_lut, vec2(NdotV, roughness)).rg;
+	LIGHTING_PRECISION vec3  irradiance = texture(irradiance_map, N).rgb;
+
+	LIGHTING_PRECISION vec3 ambient_color = irradiance * diffuse_color * (vec3(1.0) - F) + radiance * (specular_color * brdf.x + brdf.y);
+
+	o_color = vec4(ambient_color + LightContribution, base_color.a);
+#else
 	// [1] Tempory irradiance to fix dark metals
 	// TODO: add specular irradiance for realistic metals
-	vec3 irradiance  = vec3(0.5);
-	vec3 F           = F_Schlick_Roughness(F0, max(dot(N, V), 0.0), roughness * roughness * roughness * roughness);
-	vec3 ibl_diffuse = irradiance * base_color.rgb;
+	LIGHTING_PRECISION vec3 irradiance  = vec3(0.5);
+	LIGHTING_PRECISION vec3 F           = F_Schlick_Roughness(F0, max(dot(N, V), 0.0), roughness * roughness * roughness * roughness);
+	LIGHTING_PRECISION vec3 ibl_diffuse = irradiance * base_color.rgb;
 
-	vec3 ambient_color = ibl_diffuse;
+	LIGHTING_PRECISION vec3 ambient_color = ibl_diffuse;
 
 	o_color = vec4(0.3 * ambient_color + LightContribution, base_color.a);
+#endif
 }
@@ -21,42 +21,196 @@
 
 #define MAX_FORWARD_LIGHT_COUNT 16
 
+#ifdef VERTEX_PULLING
+#define FORMAT_R32G32B32_SFLOAT 1u
+#define FORMAT_R16G16B16A16_SFLOAT 2u
+#define FORMAT_R32G32_SFLOAT 3u
+#define FORMAT_R16G16_SNORM 4u
+#define FORMAT_R16G16_UNORM 5u
+#define FORMAT_R16G16_SFLOAT 6u
+
+// Offset and stride in words and format of each attribute, a zero format if the sub mesh has none
+layout(set = 0, binding = 11) uniform VertexLayout
+{
+	uvec4 position;
+	uvec4 normal;
+	uvec4 texcoord_0;
+}
+vertex_layout;
+
+layout(set = 0, binding = 12) readonly buffer PositionBuffer
+{
+	uint position_words[];
+};
+
+layout(set = 0, binding = 13) readonly buffer NormalBuffer
+{
+	uint normal_words[];
+};
+
+layout(set = 0, binding = 14) readonly buffer Texcoord0Buffer
+{
+	uint texcoord_0_words[];
+};
+#else
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec2 texcoord_0;
+#ifdef OCTAHEDRAL_NORMAL
+layout(location = 2) in vec2 normal;
+#else
 layout(location = 2) in vec3 normal;
+#endif
+#endif
+
+#ifdef INSTANCING
+layout(location = 3) in mat4 instance_model;
+#endif
+
+#ifdef SKINNING
+layout(location = 7) in uvec4 joints_0;
+layout(location = 8) in vec4 weights_0;
+
+// Joint matrices in world space, the transform of the skinned node is not applied
+layout(set = 0, binding = 10) readonly buffer JointMatrices
+{
+	mat4 joint_matrices[];
+};
+#endif
 
 layout(set = 0, binding = 1) uniform GlobalUniform
 {
-	mat4 model;
 	mat4 view_proj;
 	vec3 camera_position;
 }
 global_uniform;
 
+#if !defined(SKINNING) && !defined(INSTANCING)
+#if defined(MODEL_PUSH_CONSTANT)
+// Pushed for each draw, after the material push constants of the fragment shader
+layout(push_constant, std430) uniform ModelPushConstant
+{
+	layout(offset = 64) mat4 model;
+}
+model_uniform;
+#elif defined(MODEL_STORAGE_BUFFER)
+// Written once for all the draws, indexed by the first instance of each draw
+layout(set = 0, binding = 15) readonly buffer ModelBuffer
+{
+	mat4 models[];
+};
+#else
+// Written for each draw, bound at a dynamic offset into a single allocation
+layout(set = 0, binding = 15) uniform ModelUniform
+{
+	mat4 model;
+}
+model_uniform;
+#endif
+#endif
+
 struct Light
 {
 	vec4 position;
 	vec4 color;
 };
 
+#ifndef CLUSTERED_LIGHTS
 layout(set = 0, binding = 4) uniform LightsInfo
 {
 	uint  count;
 	Light lights[MAX_FORWARD_LIGHT_COUNT];
 }
 lights;
+#endif
 
 layout(location = 0) out vec3 o_pos;
 layout(location = 1) out vec2 o_uv;
 layout(location = 2) out vec3 o_normal;
 
+#ifdef VERTEX_PULLING
+vec3 pull_position()
+{
+	uint i = vertex_layout.position.x + uint(gl_VertexIndex) * vertex_layout.position.y;
+
+	if (vertex_layout.position.z == FORMAT_R16G16B16A16_SFLOAT)
+	{
+		return vec3(unpackHalf2x16(position_words[i]), unpackHalf2x16(position_words[i + 1]).x);
+	}
+
+	return uintBitsToFloat(uvec3(position_words[i], position_words[i + 1], position_words[i + 2]));
+}
+
+vec2 pull_texcoord_0()
+{
+	uint i = vertex_layout.texcoord_0.x + uint(gl_VertexIndex) * vertex_layout.texcoord_0.y;
+
+	switch (vertex_layout.texcoord_0.z)
+	{
+		case FORMAT_R32G32_SFLOAT:
+			return uintBitsToFloat(uvec2(texcoord_0_words[i], texcoord_0_words[i + 1]));
+		case FORMAT_R16G16_UNORM:
+			return unpackUnorm2x16(texcoord_0_words[i]);
+		case FORMAT_R16G16_SFLOAT:
+			return unpackHalf2x16(texcoord_0_words[i]);
+		default:
+			return vec2(0.0);
+	}
+}
+#endif
+
+vec3 get_normal()
+{
+#ifdef VERTEX_PULLING
+	uint i = vertex_layout.normal.x + uint(gl_VertexIndex) * vertex_layout.normal.y;
+
+	if (vertex_layout.normal.z == FORMAT_R32G32B32_SFLOAT)
+	{
+		return uintBitsToFloat(uvec3(normal_words[i], normal_words[i + 1], normal_words[i + 2]));
+	}
+	else if (vertex_layout.normal.z != FORMAT_R16G16_SNORM)
+	{
+		return vec3(0.0, 0.0, 1.0);
+	}
+
+	vec2 normal = unpackSnorm2x16(normal_words[i]);
+#endif
+#if defined(VERTEX_PULLING) || defined(OCTAHEDRAL_NORMAL)
+	// Unfold the octahedral encoding of the quantized normal
+	vec3  n = vec3(normal, 1.0 - abs(normal.x) - abs(normal.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+#else
+	return normal;
+#endif
+}
+
 void main(void)
 {
-	o_pos = vec3(global_uniform.model * vec4(position, 1.0));
+#ifdef VERTEX_PULLING
+	vec3 position   = pull_position();
+	vec2 texcoord_0 = pull_texcoord_0();
+#endif
+
+#if defined(SKINNING)
+	mat4 model = weights_0.x * joint_matrices[joints_0.x] +
+	             weights_0.y * joint_matrices[joints_0.y] +
+	             weights_0.z * joint_matrices[joints_0.z] +
+	             weights_0.w * joint_matrices[joints_0.w];
+#elif defined(INSTANCING)
+	mat4 model = instance_model;
+#elif defined(MODEL_STORAGE_BUFFER)
+	mat4 model = models[gl_InstanceIndex];
+#else
+	mat4 model = model_uniform.model;
+#endif
+
+	o_pos = vec3(model * vec4(position, 1.0));
 
 	o_uv = texcoord_0;
 
-	o_normal = mat3(global_uniform.model) * normal;
+	o_normal = mat3(model) * get_normal();
 
-	gl_Position = global_uniform.view_proj * global_uniform.model * vec4(position, 1.0);
+	gl_Position = global_uniform.view_proj * model * vec4(position, 1.0);
 }
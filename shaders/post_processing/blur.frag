@@ -0,0 +1,74 @@
+#version 450
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+precision highp float;
+
+layout(set = 0, binding = 0) uniform sampler2D source;
+
+layout(location = 0) in vec2 in_uv;
+
+layout(location = 0) out vec4 o_color;
+
+layout(push_constant) uniform PostProcessingConstants
+{
+	vec2  texel_size;
+	vec2  direction;
+	float exposure;
+	float bloom_threshold;
+	float bloom_intensity;
+}
+constants;
+
+// Weights of a 9 tap gaussian, the center one first
+const float weights[5] = float[](0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
+
+vec3 fetch(vec2 uv)
+{
+	vec3 color = texture(source, uv).rgb;
+
+#ifdef BLOOM_THRESHOLD
+	// Only the part of the luminance above the threshold blooms
+	float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+	color *= max(luminance - constants.bloom_threshold, 0.0) / max(luminance, 0.0001);
+#endif
+
+	return color;
+}
+
+vec3 blur(vec2 uv)
+{
+	vec2 step = constants.direction * constants.texel_size;
+
+	vec3 color = fetch(uv) * weights[0];
+
+	for (int i = 1; i < 5; ++i)
+	{
+		color += fetch(uv + step * float(i)) * weights[i];
+		color += fetch(uv - step * float(i)) * weights[i];
+	}
+
+	return color;
+}
+
+void main()
+{
+	o_color = vec4(blur(in_uv), 1.0);
+}
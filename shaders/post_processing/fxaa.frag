@@ -0,0 +1,87 @@
+#version 450
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+precision highp float;
+
+layout(set = 0, binding = 0) uniform sampler2D source;
+
+layout(location = 0) in vec2 in_uv;
+
+layout(location = 0) out vec4 o_color;
+
+layout(push_constant) uniform PostProcessingConstants
+{
+	vec2  texel_size;
+	vec2  direction;
+	float exposure;
+	float bloom_threshold;
+	float bloom_intensity;
+}
+constants;
+
+const float FXAA_REDUCE_MIN = 1.0 / 128.0;
+const float FXAA_REDUCE_MUL = 1.0 / 8.0;
+const float FXAA_SPAN_MAX   = 8.0;
+
+float luma(vec3 color)
+{
+	return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+// Blurs along the edge through the pixel, found from the luma of its diagonal neighbours
+vec3 fxaa(vec2 uv)
+{
+	vec2 texel = constants.texel_size;
+
+	vec3 rgb_m = texture(source, uv).rgb;
+
+	float luma_nw = luma(texture(source, uv + vec2(-1.0, -1.0) * texel).rgb);
+	float luma_ne = luma(texture(source, uv + vec2(1.0, -1.0) * texel).rgb);
+	float luma_sw = luma(texture(source, uv + vec2(-1.0, 1.0) * texel).rgb);
+	float luma_se = luma(texture(source, uv + vec2(1.0, 1.0) * texel).rgb);
+	float luma_m  = luma(rgb_m);
+
+	float luma_min = min(luma_m, min(min(luma_nw, luma_ne), min(luma_sw, luma_se)));
+	float luma_max = max(luma_m, max(max(luma_nw, luma_ne), max(luma_sw, luma_se)));
+
+	vec2 dir = vec2(-((luma_nw + luma_ne) - (luma_sw + luma_se)),
+	                ((luma_nw + luma_sw) - (luma_ne + luma_se)));
+
+	float dir_reduce  = max((luma_nw + luma_ne + luma_sw + luma_se) * (0.25 * FXAA_REDUCE_MUL), FXAA_REDUCE_MIN);
+	float rcp_dir_min = 1.0 / (min(abs(dir.x), abs(dir.y)) + dir_reduce);
+
+	dir = clamp(dir * rcp_dir_min, vec2(-FXAA_SPAN_MAX), vec2(FXAA_SPAN_MAX)) * texel;
+
+	vec3 rgb_a = 0.5 * (texture(source, uv + dir * (1.0 / 3.0 - 0.5)).rgb +
+	                    texture(source, uv + dir * (2.0 / 3.0 - 0.5)).rgb);
+	vec3 rgb_b = rgb_a * 0.5 + 0.25 * (texture(source, uv - dir * 0.5).rgb +
+	                                   texture(source, uv + dir * 0.5).rgb);
+
+	float luma_b = luma(rgb_b);
+
+	// The wider blur crossed another edge
+	return (luma_b < luma_min || luma_b > luma_max) ? rgb_a : rgb_b;
+}
+
+void main()
+{
+	o_color = vec4(fxaa(in_uv), 1.0);
+}
@@ -0,0 +1,62 @@
+#version 450
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+precision highp float;
+
+// The scene color of the same pixel, read from the tile memory
+layout(input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput scene_color;
+
+#ifdef BLOOM
+layout(set = 0, binding = 1) uniform sampler2D bloom;
+#endif
+
+layout(location = 0) in vec2 in_uv;
+
+layout(location = 0) out vec4 o_color;
+
+layout(push_constant) uniform PostProcessingConstants
+{
+	vec2  texel_size;
+	vec2  direction;
+	float exposure;
+	float bloom_threshold;
+	float bloom_intensity;
+}
+constants;
+
+// Fit of the ACES filmic curve by Krzysztof Narkowicz
+vec3 tonemap(vec3 color)
+{
+	color *= constants.exposure;
+
+	return clamp((color * (2.51 * color + 0.03)) / (color * (2.43 * color + 0.59) + 0.14), 0.0, 1.0);
+}
+
+void main()
+{
+	vec3 color = subpassLoad(scene_color).rgb;
+
+#ifdef BLOOM
+	color += texture(bloom, in_uv).rgb * constants.bloom_intensity;
+#endif
+
+	o_color = vec4(tonemap(color), 1.0);
+}
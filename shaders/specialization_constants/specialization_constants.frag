@@ -33,7 +33,6 @@ layout(location = 0) out vec4 o_color;
 
 layout(set = 0, binding = 1) uniform GlobalUniform
 {
-	mat4 model;
 	mat4 view_proj;
 	vec3 camera_position;
 }
@@ -0,0 +1,46 @@
+#version 450
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+precision highp float;
+
+// Sum of the weighted premultiplied colors (rgb) and of the weighted coverages (a)
+layout(input_attachment_index = 0, binding = 0) uniform subpassInput i_accumulation;
+
+// Product of the transmittances of the transparent surfaces
+layout(input_attachment_index = 1, binding = 1) uniform subpassInput i_revealage;
+
+layout(location = 0) out vec4 o_color;
+
+void main()
+{
+	float revealage = subpassLoad(i_revealage).r;
+
+	// Nothing transparent was drawn over the pixel
+	if (revealage >= 1.0)
+	{
+		discard;
+	}
+
+	vec4 accumulation = subpassLoad(i_accumulation);
+
+	// Average color of the surfaces, blended over the opaque color by their total coverage
+	o_color = vec4(accumulation.rgb / max(accumulation.a, 1e-5), 1.0 - revealage);
+}
@@ -0,0 +1,313 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+
+#include <json.hpp>
+
+namespace vkbbench
+{
+namespace
+{
+/// Iterations a benchmark is run for at most, whatever its minimum time
+const uint64_t MAX_ITERATIONS = 1000000000;
+
+struct Result
+{
+	std::string name;
+
+	uint64_t iterations{0};
+
+	/// Nanoseconds per iteration
+	double real_time{0.0};
+
+	double cpu_time{0.0};
+
+	double items_per_second{0.0};
+};
+
+std::vector<std::unique_ptr<Benchmark>> &get_benchmarks()
+{
+	static std::vector<std::unique_ptr<Benchmark>> benchmarks;
+
+	return benchmarks;
+}
+
+std::string get_option(int argc, char *argv[], const std::string &name, const std::string &default_value)
+{
+	std::string prefix = name + "=";
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg{argv[i]};
+
+		if (arg.compare(0, prefix.size(), prefix) == 0)
+		{
+			return arg.substr(prefix.size());
+		}
+	}
+
+	return default_value;
+}
+
+/**
+ * @brief Runs a benchmark with more iterations each time, until it runs for the minimum time
+ */
+Result run_benchmark(const Benchmark &benchmark, const std::string &name, int64_t argument, double min_time)
+{
+	uint64_t iterations = benchmark.get_iterations() ? benchmark.get_iterations() : 1;
+
+	while (true)
+	{
+		State state{iterations, argument};
+
+		benchmark.get_function()(state);
+
+		double real_time = state.get_real_time();
+
+		if (benchmark.get_iterations() || real_time >= min_time || iterations >= MAX_ITERATIONS)
+		{
+			Result result;
+			result.name       = name;
+			result.iterations = iterations;
+			result.real_time  = real_time * 1e9 / iterations;
+			result.cpu_time   = state.get_cpu_time() * 1e9 / iterations;
+
+			if (state.get_items_processed() && real_time > 0.0)
+			{
+				result.items_per_second = state.get_items_processed() / real_time;
+			}
+
+			return result;
+		}
+
+		// Aim a bit over the minimum time, growing by ten at most as the short runs are noisy
+		double scale = real_time > 0.0 ? 1.4 * min_time / real_time : 10.0;
+		iterations   = std::min(MAX_ITERATIONS, std::max(iterations + 1, static_cast<uint64_t>(iterations * std::min(scale, 10.0))));
+	}
+}
+
+nlohmann::json to_json(const std::vector<Result> &results, const std::string &executable)
+{
+	char   date[64];
+	time_t now = std::time(nullptr);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+	nlohmann::json benchmarks = nlohmann::json::array();
+
+	for (auto &result : results)
+	{
+		nlohmann::json benchmark{
+		    {"name", result.name},
+		    {"run_name", result.name},
+		    {"run_type", "iteration"},
+		    {"iterations", result.iterations},
+		    {"real_time", result.real_time},
+		    {"cpu_time", result.cpu_time},
+		    {"time_unit", "ns"}};
+
+		if (result.items_per_second > 0.0)
+		{
+			benchmark["items_per_second"] = result.items_per_second;
+		}
+
+		benchmarks.push_back(benchmark);
+	}
+
+#ifdef NDEBUG
+	const char *build_type = "release";
+#else
+	const char *build_type = "debug";
+#endif
+
+	return {{"context", {{"date", date}, {"executable", executable}, {"library_build_type", build_type}}},
+	        {"benchmarks", benchmarks}};
+}
+}        // namespace
+
+State::State(uint64_t max_iterations, int64_t argument) :
+    max_iterations{max_iterations},
+    argument{argument}
+{
+}
+
+void State::pause_timing()
+{
+	if (running)
+	{
+		real_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - real_start).count();
+		cpu_time += static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+		running = false;
+	}
+}
+
+void State::resume_timing()
+{
+	if (!running)
+	{
+		running    = true;
+		cpu_start  = std::clock();
+		real_start = std::chrono::steady_clock::now();
+	}
+}
+
+int64_t State::get_argument() const
+{
+	return argument;
+}
+
+uint64_t State::get_iterations() const
+{
+	return max_iterations;
+}
+
+void State::set_items_processed(uint64_t items)
+{
+	items_processed = items;
+}
+
+uint64_t State::get_items_processed() const
+{
+	return items_processed;
+}
+
+double State::get_real_time() const
+{
+	return real_time;
+}
+
+double State::get_cpu_time() const
+{
+	return cpu_time;
+}
+
+Benchmark::Benchmark(const std::string &name, Function &&function) :
+    name{name},
+    function{std::move(function)}
+{
+}
+
+Benchmark &Benchmark::argument(int64_t value)
+{
+	arguments.push_back(value);
+
+	return *this;
+}
+
+Benchmark &Benchmark::iterations(uint64_t count)
+{
+	fixed_iterations = count;
+
+	return *this;
+}
+
+const std::string &Benchmark::get_name() const
+{
+	return name;
+}
+
+const Function &Benchmark::get_function() const
+{
+	return function;
+}
+
+const std::vector<int64_t> &Benchmark::get_arguments() const
+{
+	return arguments;
+}
+
+uint64_t Benchmark::get_iterations() const
+{
+	return fixed_iterations;
+}
+
+Benchmark &register_benchmark(const std::string &name, Function &&function)
+{
+	auto &benchmarks = get_benchmarks();
+
+	benchmarks.push_back(std::make_unique<Benchmark>(name, std::move(function)));
+
+	return *benchmarks.back();
+}
+
+int run_benchmarks(int argc, char *argv[])
+{
+	std::string filter   = get_option(argc, argv, "--benchmark_filter", "");
+	double      min_time = std::stod(get_option(argc, argv, "--benchmark_min_time", "0.5"));
+	std::string out      = get_option(argc, argv, "--benchmark_out", "");
+
+	std::vector<Result> results;
+
+	printf("%-60s %15s %15s %12s\n", "Benchmark", "Time (ns)", "CPU (ns)", "Iterations");
+
+	for (auto &benchmark : get_benchmarks())
+	{
+		std::vector<int64_t> arguments = benchmark->get_arguments();
+
+		if (arguments.empty())
+		{
+			arguments.push_back(0);
+		}
+
+		for (auto argument : arguments)
+		{
+			std::string name = benchmark->get_name();
+
+			if (!benchmark->get_arguments().empty())
+			{
+				name += "/" + std::to_string(argument);
+			}
+
+			if (name.find(filter) == std::string::npos)
+			{
+				continue;
+			}
+
+			results.push_back(run_benchmark(*benchmark, name, argument, min_time));
+
+			auto &result = results.back();
+
+			printf("%-60s %15.1f %15.1f %12llu\n", result.name.c_str(), result.real_time, result.cpu_time, static_cast<unsigned long long>(result.iterations));
+		}
+	}
+
+	if (!out.empty())
+	{
+		std::ofstream out_stream{out, std::ios::out | std::ios::trunc};
+
+		if (!out_stream.good())
+		{
+			fprintf(stderr, "Failed to write the results to %s\n", out.c_str());
+
+			return 1;
+		}
+
+		out_stream << to_json(results, argv[0]).dump(2) << std::endl;
+	}
+
+	return 0;
+}
+}        // namespace vkbbench
@@ -0,0 +1,158 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace vkbbench
+{
+/**
+ * @brief Runs the iterations of a benchmark and measures them, as a benchmark::State of Google Benchmark:
+ *        the code measured is the body of a `while (state.keep_running())` loop
+ */
+class State
+{
+  public:
+	State(uint64_t max_iterations, int64_t argument);
+
+	/**
+	 * @return Whether to run another iteration, the timers start with the first and stop after the last
+	 */
+	bool keep_running()
+	{
+		if (iteration < max_iterations)
+		{
+			if (iteration++ == 0)
+			{
+				resume_timing();
+			}
+
+			return true;
+		}
+
+		pause_timing();
+
+		return false;
+	}
+
+	/**
+	 * @brief Stops the timers, so that the setup of the next iterations is not measured
+	 */
+	void pause_timing();
+
+	void resume_timing();
+
+	/**
+	 * @return The argument the benchmark is run with, such as the size of its data
+	 */
+	int64_t get_argument() const;
+
+	uint64_t get_iterations() const;
+
+	/**
+	 * @brief Counts the items processed by the iterations, which the results report per second
+	 */
+	void set_items_processed(uint64_t items);
+
+	uint64_t get_items_processed() const;
+
+	double get_real_time() const;
+
+	double get_cpu_time() const;
+
+  private:
+	uint64_t iteration{0};
+
+	uint64_t max_iterations;
+
+	int64_t argument;
+
+	uint64_t items_processed{0};
+
+	bool running{false};
+
+	std::chrono::steady_clock::time_point real_start;
+
+	std::clock_t cpu_start{0};
+
+	/// Seconds measured
+	double real_time{0.0};
+
+	double cpu_time{0.0};
+};
+
+using Function = std::function<void(State &)>;
+
+/**
+ * @brief A benchmark registered, run once for each of its arguments
+ */
+class Benchmark
+{
+  public:
+	Benchmark(const std::string &name, Function &&function);
+
+	/**
+	 * @brief Adds an argument to run the benchmark with, its name is suffixed with it
+	 */
+	Benchmark &argument(int64_t value);
+
+	/**
+	 * @brief Runs the benchmark for a fixed number of iterations, instead of as many as the minimum time needs
+	 */
+	Benchmark &iterations(uint64_t count);
+
+	const std::string &get_name() const;
+
+	const Function &get_function() const;
+
+	const std::vector<int64_t> &get_arguments() const;
+
+	uint64_t get_iterations() const;
+
+  private:
+	std::string name;
+
+	Function function;
+
+	std::vector<int64_t> arguments;
+
+	uint64_t fixed_iterations{0};
+};
+
+/**
+ * @brief Registers a benchmark, to be run by run_benchmarks
+ */
+Benchmark &register_benchmark(const std::string &name, Function &&function);
+
+/**
+ * @brief Runs the benchmarks registered and prints their results, with the options of Google Benchmark:
+ *        --benchmark_filter=TEXT runs the benchmarks whose name contains TEXT,
+ *        --benchmark_min_time=SECONDS sets the time each benchmark runs for at least,
+ *        --benchmark_out=FILE writes the results as JSON in the format of Google Benchmark
+ * @return The exit code of the program
+ */
+int run_benchmarks(int argc, char *argv[]);
+}        // namespace vkbbench
@@ -0,0 +1,678 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "framework_benchmarks.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "benchmark.h"
+#include "buffer_pool.h"
+#include "common/resource_caching.h"
+#include "job_system.h"
+#include "rendering/culling.h"
+#include "rendering/draw_list.h"
+#include "rendering/pipeline_state.h"
+#include "rendering/render_frame.h"
+#include "rendering/subpass.h"
+#include "rendering/subpasses/geometry_subpass.h"
+#include "resource_binding_state.h"
+#include "resource_cache.h"
+#include "scene_graph/components/aabb.h"
+#include "scene_graph/components/mesh.h"
+#include "scene_graph/components/pbr_material.h"
+#include "scene_graph/components/perspective_camera.h"
+#include "scene_graph/components/sub_mesh.h"
+#include "scene_graph/node.h"
+#include "scene_graph/scene.h"
+
+VKBP_DISABLE_WARNINGS()
+#include <glm/gtc/matrix_transform.hpp>
+VKBP_ENABLE_WARNINGS()
+
+namespace vkbbench
+{
+namespace
+{
+/// Reads a uniform buffer and writes a storage buffer, so that a dispatch flushes a set of two descriptors
+const char *COMPUTE_SHADER = R"(#version 320 es
+layout(local_size_x = 1) in;
+
+layout(set = 0, binding = 0) uniform Constants
+{
+	vec4 value;
+}
+constants;
+
+layout(set = 0, binding = 1) buffer Values
+{
+	vec4 values[];
+}
+values;
+
+void main()
+{
+	values.values[gl_GlobalInvocationID.x] = constants.value;
+}
+)";
+
+/// Places a triangle with a uniform buffer, so that a draw flushes a set of one descriptor
+const char *VERTEX_SHADER = R"(#version 320 es
+layout(set = 0, binding = 0) uniform Transform
+{
+	vec4 offset_scale;
+}
+transform;
+
+void main()
+{
+	vec2 position = vec2(float(gl_VertexIndex & 1), float(gl_VertexIndex >> 1));
+
+	gl_Position = vec4(position * transform.offset_scale.z + transform.offset_scale.xy, 0.0, 1.0);
+}
+)";
+
+const char *FRAGMENT_SHADER = R"(#version 320 es
+precision mediump float;
+
+layout(location = 0) out vec4 o_color;
+
+void main()
+{
+	o_color = vec4(1.0);
+}
+)";
+
+/// Sub meshes and materials shared by the nodes of the synthetic scenes
+const uint32_t SYNTHETIC_MESH_COUNT = 64;
+
+const uint32_t SYNTHETIC_MATERIAL_COUNT = 16;
+
+vkb::ShaderSource make_source(const char *source)
+{
+	return vkb::ShaderSource{std::vector<uint8_t>{source, source + std::strlen(source)}};
+}
+
+/**
+ * @brief Begins the render pass of the draw benchmarks, its draws are recorded by the benchmarks
+ */
+class DrawSubpass : public vkb::Subpass
+{
+  public:
+	DrawSubpass(vkb::RenderContext &render_context) :
+	    vkb::Subpass{render_context, make_source(VERTEX_SHADER), make_source(FRAGMENT_SHADER)}
+	{
+	}
+
+	void prepare() override
+	{
+	}
+
+	void draw(vkb::CommandBuffer &) override
+	{
+	}
+};
+
+/**
+ * @brief A grid of unit cubes in front of a camera, some of which the frustum culls
+ */
+struct SyntheticScene
+{
+	SyntheticScene(vkb::Device &device, uint32_t node_count);
+
+	vkb::sg::Scene scene;
+
+	std::unique_ptr<vkb::core::Buffer> positions;
+
+	vkb::sg::Camera *camera{nullptr};
+};
+
+SyntheticScene::SyntheticScene(vkb::Device &device, uint32_t node_count)
+{
+	const std::vector<glm::vec3> cube{
+	    {-0.5f, -0.5f, -0.5f}, {0.5f, -0.5f, -0.5f}, {-0.5f, 0.5f, -0.5f}, {0.5f, 0.5f, -0.5f},
+	    {-0.5f, -0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f}, {0.5f, 0.5f, 0.5f}};
+
+	positions = std::make_unique<vkb::core::Buffer>(device, cube.size() * sizeof(glm::vec3), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	positions->update(reinterpret_cast<const uint8_t *>(cube.data()), cube.size() * sizeof(glm::vec3));
+
+	std::vector<std::unique_ptr<vkb::sg::Node>> nodes;
+
+	nodes.push_back(std::make_unique<vkb::sg::Node>("root"));
+	auto &root = *nodes.back();
+
+	std::vector<vkb::sg::PBRMaterial *> materials;
+
+	for (uint32_t i = 0; i < SYNTHETIC_MATERIAL_COUNT; ++i)
+	{
+		auto material = std::make_unique<vkb::sg::PBRMaterial>("material " + std::to_string(i));
+		materials.push_back(material.get());
+		scene.add_component(std::move(material));
+	}
+
+	std::vector<vkb::sg::Mesh *> meshes;
+
+	for (uint32_t i = 0; i < SYNTHETIC_MESH_COUNT; ++i)
+	{
+		auto sub_mesh = std::make_unique<vkb::sg::SubMesh>();
+
+		vkb::sg::VertexAttribute position_attribute;
+		position_attribute.format = VK_FORMAT_R32G32B32_SFLOAT;
+		position_attribute.stride = sizeof(glm::vec3);
+
+		sub_mesh->set_attribute("position", position_attribute);
+		sub_mesh->shared_vertex_buffers["position"] = positions.get();
+		sub_mesh->vertices_count                    = vkb::to_u32(cube.size());
+		sub_mesh->set_material(*materials[i % SYNTHETIC_MATERIAL_COUNT]);
+
+		auto mesh = std::make_unique<vkb::sg::Mesh>("mesh " + std::to_string(i));
+		mesh->add_submesh(*sub_mesh);
+
+		meshes.push_back(mesh.get());
+		scene.add_component(std::move(sub_mesh));
+		scene.add_component(std::move(mesh));
+	}
+
+	// Square grid, spread over the ground in front of the camera
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(node_count))));
+
+	for (uint32_t i = 0; i < node_count; ++i)
+	{
+		nodes.push_back(std::make_unique<vkb::sg::Node>("node " + std::to_string(i)));
+		auto &node = *nodes.back();
+
+		node.get_transform().set_translation({2.0f * (i % side) - side, -1.0f, -2.0f * (i / side)});
+		node.set_parent(root);
+		root.add_child(node);
+
+		auto &mesh = *meshes[i % SYNTHETIC_MESH_COUNT];
+		mesh.add_node(node);
+		node.set_component(mesh);
+	}
+
+	nodes.push_back(std::make_unique<vkb::sg::Node>("camera"));
+	auto &camera_node = *nodes.back();
+	camera_node.set_parent(root);
+	root.add_child(camera_node);
+
+	auto perspective_camera = std::make_unique<vkb::sg::PerspectiveCamera>("camera");
+	perspective_camera->set_node(camera_node);
+	camera_node.set_component(*perspective_camera);
+	camera = perspective_camera.get();
+	scene.add_component(std::move(perspective_camera));
+
+	scene.set_root_node(root);
+	scene.set_nodes(std::move(nodes));
+	scene.publish_render_state();
+}
+
+void register_hashing_benchmarks()
+{
+	register_benchmark("hash_param", [](State &state) {
+		uint32_t binding = 0;
+
+		while (state.keep_running())
+		{
+			size_t hash{0};
+			vkb::hash_param(hash, binding++, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, 1.0f);
+
+			// Keeps the hash from being optimized out
+			binding += static_cast<uint32_t>(hash & 1);
+		}
+	});
+
+	register_benchmark("PipelineState::get_hash", [](State &state) {
+		vkb::PipelineState pipeline_state;
+
+		vkb::RasterizationState rasterization_state;
+
+		size_t hashes{0};
+
+		while (state.keep_running())
+		{
+			// Changing a state hashes it again, as the draws do
+			rasterization_state.cull_mode = rasterization_state.cull_mode == VK_CULL_MODE_BACK_BIT ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+			pipeline_state.set_rasterization_state(rasterization_state);
+
+			hashes += std::hash<vkb::PipelineState>{}(pipeline_state);
+		}
+
+		state.set_items_processed(state.get_iterations() + (hashes & 1));
+	});
+}
+
+/**
+ * @brief Unit boxes on a square grid in front of a camera looking down -z, some of which the frustum culls
+ */
+struct SyntheticBounds
+{
+	SyntheticBounds(uint32_t box_count);
+
+	std::vector<glm::mat4> world_matrices;
+
+	vkb::Frustum frustum;
+};
+
+SyntheticBounds::SyntheticBounds(uint32_t box_count) :
+    frustum{glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f)}
+{
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(box_count))));
+
+	world_matrices.reserve(box_count);
+
+	for (uint32_t i = 0; i < box_count; ++i)
+	{
+		glm::vec3 translation{2.0f * (i % side) - side, -1.0f, -2.0f * (i / side)};
+
+		world_matrices.push_back(glm::translate(glm::mat4{1.0f}, translation));
+	}
+}
+
+void register_culling_benchmarks()
+{
+	// Each iteration transforms and tests all the boxes, as the geometry subpass does once per frame
+	register_benchmark("BoundsBatch::transform+intersect", [](State &state) {
+		SyntheticBounds synthetic{static_cast<uint32_t>(state.get_argument())};
+
+		vkb::sg::AABB local_bounds{glm::vec3{-0.5f}, glm::vec3{0.5f}};
+
+		vkb::BoundsBatch batch;
+
+		for (auto &world_matrix : synthetic.world_matrices)
+		{
+			batch.add(local_bounds, world_matrix);
+		}
+
+		std::vector<uint8_t> visible;
+
+		while (state.keep_running())
+		{
+			batch.transform();
+			batch.intersect(synthetic.frustum, visible);
+		}
+
+		state.set_items_processed(state.get_iterations() * state.get_argument());
+	})
+	    .argument(10000)
+	    .argument(100000)
+	    .argument(1000000);
+
+	// The same work one box at a time, which the batched path is measured against
+	register_benchmark("AABB::transform+Frustum::intersects", [](State &state) {
+		SyntheticBounds synthetic{static_cast<uint32_t>(state.get_argument())};
+
+		vkb::sg::AABB local_bounds{glm::vec3{-0.5f}, glm::vec3{0.5f}};
+
+		std::vector<uint8_t> visible(synthetic.world_matrices.size());
+
+		while (state.keep_running())
+		{
+			for (size_t i = 0; i < synthetic.world_matrices.size(); ++i)
+			{
+				vkb::sg::AABB world_bounds{local_bounds.get_min(), local_bounds.get_max()};
+				world_bounds.transform(synthetic.world_matrices[i]);
+
+				visible[i] = synthetic.frustum.intersects(world_bounds);
+			}
+		}
+
+		state.set_items_processed(state.get_iterations() * state.get_argument());
+	})
+	    .argument(10000)
+	    .argument(100000)
+	    .argument(1000000);
+}
+
+void register_resource_cache_benchmarks(FrameworkContext &context)
+{
+	register_benchmark("ResourceCache::request_sampler/hit", [&context](State &state) {
+		auto &resource_cache = context.device->get_resource_cache();
+
+		VkSamplerCreateInfo sampler_info{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+		sampler_info.magFilter = VK_FILTER_LINEAR;
+		sampler_info.minFilter = VK_FILTER_LINEAR;
+		sampler_info.maxLod    = VK_LOD_CLAMP_NONE;
+
+		resource_cache.request_sampler(sampler_info);
+
+		while (state.keep_running())
+		{
+			resource_cache.request_sampler(sampler_info);
+		}
+	});
+
+	register_benchmark("ResourceCache::request_descriptor_set_layout/hit", [&context](State &state) {
+		auto &resource_cache = context.device->get_resource_cache();
+
+		vkb::ShaderResource resource{};
+		resource.stages     = VK_SHADER_STAGE_FRAGMENT_BIT;
+		resource.type       = vkb::ShaderResourceType::BufferUniform;
+		resource.array_size = 1;
+
+		std::vector<vkb::ShaderResource> set_resources{resource};
+
+		resource_cache.request_descriptor_set_layout(set_resources, false);
+
+		while (state.keep_running())
+		{
+			resource_cache.request_descriptor_set_layout(set_resources, false);
+		}
+	});
+
+	// Hits from several threads at once, as the recording threads make them, by thread count.
+	// The items per second scale with the threads as long as the hits do not contend
+	register_benchmark("ResourceCache::request_descriptor_set_layout/hit/threads", [&context](State &state) {
+		auto &resource_cache = context.device->get_resource_cache();
+
+		vkb::ShaderResource resource{};
+		resource.stages     = VK_SHADER_STAGE_FRAGMENT_BIT;
+		resource.type       = vkb::ShaderResourceType::BufferUniform;
+		resource.array_size = 1;
+
+		std::vector<vkb::ShaderResource> set_resources{resource};
+
+		resource_cache.request_descriptor_set_layout(set_resources, false);
+
+		const uint32_t thread_count = static_cast<uint32_t>(state.get_argument());
+
+		const uint32_t requests_per_thread = 4096;
+
+		vkb::JobSystem job_system{thread_count - 1};
+
+		while (state.keep_running())
+		{
+			job_system.parallel_for(thread_count, 1, [&](uint32_t, uint32_t, size_t) {
+				for (uint32_t i = 0; i < requests_per_thread; ++i)
+				{
+					resource_cache.request_descriptor_set_layout(set_resources, false);
+				}
+			});
+		}
+
+		state.set_items_processed(state.get_iterations() * thread_count * requests_per_thread);
+	})
+	    .argument(1)
+	    .argument(2)
+	    .argument(4)
+	    .argument(8);
+
+	// Each layout requested is new, the iterations are bounded as the layouts stay in the cache
+	register_benchmark("ResourceCache::request_descriptor_set_layout/miss", [&context](State &state) {
+		auto &resource_cache = context.device->get_resource_cache();
+
+		static uint32_t binding = 0;
+
+		vkb::ShaderResource resource{};
+		resource.stages     = VK_SHADER_STAGE_FRAGMENT_BIT;
+		resource.type       = vkb::ShaderResourceType::BufferUniform;
+		resource.array_size = 1;
+
+		std::vector<vkb::ShaderResource> set_resources{resource};
+
+		while (state.keep_running())
+		{
+			set_resources[0].binding = ++binding;
+
+			resource_cache.request_descriptor_set_layout(set_resources, false);
+		}
+	})
+	    .iterations(4096);
+}
+
+void register_frame_benchmarks(FrameworkContext &context)
+{
+	register_benchmark("CommandBuffer::flush_descriptor_state", [&context](State &state) {
+		auto &device = *context.device;
+		auto &frame  = context.render_context->get_active_frame();
+
+		auto  source          = make_source(COMPUTE_SHADER);
+		auto &shader_module   = device.get_resource_cache().request_shader_module(VK_SHADER_STAGE_COMPUTE_BIT, source);
+		auto &pipeline_layout = device.get_resource_cache().request_pipeline_layout({&shader_module}, false);
+
+		auto constants = frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 512);
+		auto values    = frame.allocate_buffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 256);
+
+		auto &command_buffer = frame.request_command_buffer(device.get_queue_by_flags(VK_QUEUE_COMPUTE_BIT, 0));
+		command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		command_buffer.bind_pipeline_layout(pipeline_layout);
+
+		uint32_t offset = 0;
+
+		while (state.keep_running())
+		{
+			// Two sets alternate, found in the cache of the frame after the first iterations
+			offset = 256 - offset;
+
+			command_buffer.bind_buffer(constants.get_buffer(), constants.get_offset() + offset, 16, 0, 0, 0);
+			command_buffer.bind_buffer(values.get_buffer(), values.get_offset(), 256, 0, 1, 0);
+
+			// Empty dispatches flush the state without any work for the GPU
+			command_buffer.dispatch(0, 0, 0);
+		}
+
+		// The command buffer is never submitted, the pool of the frame resets it
+		command_buffer.end();
+	})
+	    .iterations(100000);
+
+	// The resource bindings alone, as recorded for each draw before the descriptor state is flushed
+	register_benchmark("ResourceBindingState::bind_buffer", [&context](State &state) {
+		auto &frame = context.render_context->get_active_frame();
+
+		auto uniforms = frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 256);
+
+		vkb::ResourceBindingState binding_state;
+
+		uint64_t bound{0};
+
+		while (state.keep_running())
+		{
+			// A global, a material and a model uniform, then the sets are flushed
+			binding_state.bind_buffer(uniforms.get_buffer(), uniforms.get_offset(), 64, 0, 1, 0);
+			binding_state.bind_buffer(uniforms.get_buffer(), uniforms.get_offset() + 64, 64, 1, 0, 0);
+			binding_state.bind_buffer(uniforms.get_buffer(), uniforms.get_offset() + 128, 64, 2, 0, 0);
+
+			for (uint32_t set_mask = binding_state.get_dirty_sets(); set_mask != 0; set_mask &= set_mask - 1)
+			{
+				auto set = vkb::count_trailing_zeros(set_mask);
+
+				bound += binding_state.get_resource_set(set).get_bound_mask();
+
+				binding_state.clear_dirty(set);
+			}
+
+			binding_state.reset();
+		}
+
+		state.set_items_processed(state.get_iterations() + (bound & 1));
+	});
+
+	register_benchmark("CommandBuffer::bind_buffer+draw", [&context](State &state) {
+		auto &device        = *context.device;
+		auto &frame         = context.render_context->get_active_frame();
+		auto &render_target = frame.get_render_target();
+
+		std::vector<std::unique_ptr<vkb::Subpass>> subpasses;
+		subpasses.push_back(std::make_unique<DrawSubpass>(*context.render_context));
+
+		auto &resource_cache  = device.get_resource_cache();
+		auto &vertex_module   = resource_cache.request_shader_module(VK_SHADER_STAGE_VERTEX_BIT, subpasses[0]->get_vertex_shader());
+		auto &fragment_module = resource_cache.request_shader_module(VK_SHADER_STAGE_FRAGMENT_BIT, subpasses[0]->get_fragment_shader());
+		auto &pipeline_layout = resource_cache.request_pipeline_layout({&vertex_module, &fragment_module}, false);
+
+		auto uniforms = frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 512);
+
+		std::vector<vkb::LoadStoreInfo> load_store(render_target.get_attachments().size());
+		std::vector<VkClearValue>       clear_values(render_target.get_attachments().size());
+
+		auto &command_buffer = frame.request_command_buffer(device.get_queue_by_flags(VK_QUEUE_GRAPHICS_BIT, 0));
+		command_buffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		command_buffer.begin_render_pass(render_target, load_store, clear_values, subpasses);
+		command_buffer.bind_pipeline_layout(pipeline_layout);
+
+		uint32_t offset = 0;
+
+		while (state.keep_running())
+		{
+			// Two sets alternate, found in the cache of the frame after the first iterations
+			offset = 256 - offset;
+
+			command_buffer.bind_buffer(uniforms.get_buffer(), uniforms.get_offset() + offset, 16, 0, 0, 0);
+
+			command_buffer.draw(3, 1, 0, 0);
+		}
+
+		// The command buffer is never submitted, the pool of the frame resets it
+		command_buffer.end_render_pass();
+		command_buffer.end();
+	})
+	    .iterations(100000);
+
+	register_benchmark("RenderFrame::allocate_buffer", [&context](State &state) {
+		auto &frame = context.render_context->get_active_frame();
+
+		uint64_t allocations = 0;
+
+		while (state.keep_running())
+		{
+			frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 256);
+
+			// Frames are reset once their buffers are full, as the render context does
+			if (++allocations % 1024 == 0)
+			{
+				state.pause_timing();
+				frame.reset(false);
+				state.resume_timing();
+			}
+		}
+
+		frame.reset(false);
+	});
+
+	register_benchmark("BufferAllocation::update", [&context](State &state) {
+		auto &frame = context.render_context->get_active_frame();
+
+		auto allocation = frame.allocate_buffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(glm::mat4));
+
+		glm::mat4 matrix{1.0f};
+
+		while (state.keep_running())
+		{
+			matrix[3][0] += 1.0f;
+
+			allocation.update(matrix);
+		}
+	});
+}
+
+void register_scene_benchmarks(FrameworkContext &context)
+{
+	register_benchmark("GeometrySubpass::get_sorted_nodes", [&context](State &state) {
+		SyntheticScene synthetic{*context.device, static_cast<uint32_t>(state.get_argument())};
+
+		vkb::GeometrySubpass subpass{*context.render_context, make_source("void main() {}"), make_source("void main() {}"), synthetic.scene, *synthetic.camera};
+
+		vkb::DrawList draw_list;
+
+		while (state.keep_running())
+		{
+			subpass.get_sorted_nodes(draw_list);
+		}
+
+		state.set_items_processed(state.get_iterations() * state.get_argument());
+	})
+	    .argument(100)
+	    .argument(1000)
+	    .argument(10000);
+
+	register_benchmark("Transform::get_world_matrix", [&context](State &state) {
+		SyntheticScene synthetic{*context.device, static_cast<uint32_t>(state.get_argument())};
+
+		auto &root     = synthetic.scene.get_root_node();
+		auto &children = root.get_children();
+
+		float x = 0.0f;
+
+		while (state.keep_running())
+		{
+			// Moving the root invalidates the world matrices of all the nodes
+			root.get_transform().set_translation({x += 1.0f, 0.0f, 0.0f});
+
+			for (auto child : children)
+			{
+				child->get_transform().get_world_matrix();
+			}
+		}
+
+		state.set_items_processed(state.get_iterations() * children.size());
+	})
+	    .argument(1000)
+	    .argument(10000);
+
+	register_benchmark("Scene::update_transforms", [&context](State &state) {
+		SyntheticScene synthetic{*context.device, static_cast<uint32_t>(state.get_argument())};
+
+		auto &root = synthetic.scene.get_root_node();
+
+		float x = 0.0f;
+
+		while (state.keep_running())
+		{
+			root.get_transform().set_translation({x += 1.0f, 0.0f, 0.0f});
+
+			synthetic.scene.update_transforms(nullptr);
+		}
+
+		state.set_items_processed(state.get_iterations() * state.get_argument());
+	})
+	    .argument(1000)
+	    .argument(10000);
+}
+}        // namespace
+
+FrameworkContext::FrameworkContext()
+{
+	instance = std::make_unique<vkb::Instance>("vkb_benchmarks", std::vector<const char *>{}, std::vector<const char *>{}, true);
+
+	device = std::make_unique<vkb::Device>(instance->get_gpu(), VK_NULL_HANDLE);
+
+	render_context = std::make_unique<vkb::RenderContext>(*device, VK_NULL_HANDLE, 1920, 1080);
+	render_context->prepare();
+	render_context->begin_frame();
+}
+
+FrameworkContext::~FrameworkContext()
+{
+	device->wait_idle();
+}
+
+void register_framework_benchmarks(FrameworkContext &context)
+{
+	register_hashing_benchmarks();
+
+	register_culling_benchmarks();
+
+	register_resource_cache_benchmarks(context);
+
+	register_frame_benchmarks(context);
+
+	register_scene_benchmarks(context);
+}
+}        // namespace vkbbench
@@ -0,0 +1,52 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "core/device.h"
+#include "core/instance.h"
+#include "rendering/render_context.h"
+
+namespace vkbbench
+{
+/**
+ * @brief The device the benchmarks run with, headless so that they run without a display.
+ *        A frame of its render context is active for the benchmarks to allocate from
+ */
+struct FrameworkContext
+{
+	FrameworkContext();
+
+	~FrameworkContext();
+
+	std::unique_ptr<vkb::Instance> instance;
+
+	std::unique_ptr<vkb::Device> device;
+
+	std::unique_ptr<vkb::RenderContext> render_context;
+};
+
+/**
+ * @brief Registers the benchmarks of the CPU hot paths of the framework
+ */
+void register_framework_benchmarks(FrameworkContext &context);
+}        // namespace vkbbench
@@ -19,7 +19,7 @@
  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 '''
 
-import sys, os, math, platform, threading, datetime, subprocess, zipfile, argparse, shutil, struct, imghdr
+import sys, os, math, platform, threading, datetime, subprocess, zipfile, argparse, shutil, struct, imghdr, json
 from time import sleep
 from threading import Thread
 
@@ -43,21 +43,43 @@ android_timeout   = 60 # How long in seconds should we wait before timing out on
 check_step        = 5
 threshold         = 0.999 # How similar the images are allowed to be before they pass
 
+# Performance settings
+perf_mode         = False
+warmup_frames     = 30
+measured_frames   = 300
+resolutions       = ["1280x720"]
+tolerance         = 0.05 # How much slower than the baseline a stat is allowed to be before it fails
+update_baselines  = False
+graphs_path       = "output/graphs/"
+baselines_path    = os.path.join(script_path, "baselines/")
+perf_metrics      = ("median", "p95")
+
 class Subtest:
     result = False
     test_name = ""
     platform = ""
+    resolution = ""
 
-    def __init__(self, test_name, platform):
+    def __init__(self, test_name, platform, resolution = ""):
         self.test_name = test_name
         self.platform = platform
+        self.resolution = resolution
+
+    def get_report_name(self):
+        return self.test_name + "_benchmark.json"
 
     def run(self, application_path):
         result = True
         path = root_path + application_path
         arguments = ["--test", "{}".format(self.test_name), "--headless"]
+        if perf_mode:
+            width, height = self.resolution.split("x")
+            arguments += ["--benchmark", str(warmup_frames + measured_frames), "--width", width, "--height", height]
         try:
-            subprocess.run([path] + arguments, cwd=root_path)
+            completed = subprocess.run([path] + arguments, cwd=root_path)
+            if completed.returncode != 0:
+                print("\t\t\t(Error) Application exited with code {} ({})".format(completed.returncode, path))
+                result = False
         except FileNotFoundError:
             print("\t\t\t(Error) Couldn't find application ({})".format(path))
             result = False
@@ -69,6 +91,10 @@ class Subtest:
     def test(self):
         print("\t\t=== Test started: {} ===".format(self.test_name))
         self.result = True
+        if perf_mode:
+            self.result = self.perf_test()
+            print("\t\t=== Passed! ===" if self.result else "\t\t=== Failed. ===")
+            return
         screenshot_path = tmp_path + self.platform + "/"
         try:
             shutil.move(os.path.join(root_path, outputs_path) + self.test_name + image_ext, screenshot_path + self.test_name + image_ext)
@@ -83,20 +109,35 @@ class Subtest:
         else:
             print("\t\t=== Failed. ===")
 
+    def perf_test(self):
+        """
+        @brief   Compares the stats of the benchmark report against the baseline of the device
+        @return  True if no stat regressed by more than the tolerance
+        """
+        report_path = tmp_path + self.platform + "/" + self.test_name + "-" + self.resolution + ".json"
+        try:
+            shutil.move(os.path.join(root_path, graphs_path) + self.get_report_name(), report_path)
+        except FileNotFoundError:
+            print("\t\t\t(Error) Couldn't find benchmark report ({}), perhaps test crashed".format(os.path.join(root_path, graphs_path) + self.get_report_name()))
+            return False
+        with open(report_path) as report_file:
+            report = json.load(report_file)
+        return compare_perf(summarize_report(report), get_baseline_path(self.platform, self.test_name, self.resolution))
+
     def passed(self):
         return self.result
 
 class WindowsSubtest(Subtest):
-    def __init__(self, test_name):
-        super().__init__(test_name, "Windows")
+    def __init__(self, test_name, resolution = ""):
+        super().__init__(test_name, "Windows", resolution)
 
     def run(self):
         app_path = "{}vulkan_best_practice/bin/{}/{}/vulkan_best_practice.exe".format(build_path, build_config, platform.machine())
         return super().run(app_path)
 
 class UnixSubtest(Subtest):
-    def __init__(self, test_name, platform_type):
-        super().__init__(test_name, platform_type)
+    def __init__(self, test_name, platform_type, resolution = ""):
+        super().__init__(test_name, platform_type, resolution)
 
     def run(self):
         app_path = "{}vulkan_best_practice/bin/{}/{}/vulkan_best_practice".format(build_path, build_config, platform.machine())
@@ -104,11 +145,15 @@ class UnixSubtest(Subtest):
 
 class AndroidSubtest(Subtest):
     def __init__(self, test_name):
-        super().__init__(test_name, "Android")
+        # Android renders at the resolution of the device
+        super().__init__(test_name, "Android", "native")
 
     def run(self):
         subprocess.run("adb shell am force-stop com.arm.vulkan_best_practice")
-        subprocess.run(["adb", "shell", "am", "start", "-W", "-n", "com.arm.vulkan_best_practice/com.arm.vulkan_best_practice.BPSampleActivity", "-e", "test", "{0}".format(self.test_name)], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        extras = ["-e", "test", "{0}".format(self.test_name)]
+        if perf_mode:
+            extras += ["-e", "benchmark", str(warmup_frames + measured_frames)]
+        subprocess.run(["adb", "shell", "am", "start", "-W", "-n", "com.arm.vulkan_best_practice/com.arm.vulkan_best_practice.BPSampleActivity"] + extras, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
         output = subprocess.check_output("adb shell dumpsys window windows | grep -E 'mCurrentFocus|mFocusedApp' | cut -d . -f 5 | cut -d ' ' -f 1")
         activity = "".join(output.decode("utf-8").split())
         timeout_counter = 0
@@ -118,23 +163,27 @@ class AndroidSubtest(Subtest):
             output = subprocess.check_output("adb shell \"dumpsys window windows | grep -E 'mCurrentFocus|mFocusedApp' | cut -d . -f 5 | cut -d ' ' -f 1\"")
             activity = "".join(output.decode("utf-8").split())
         if timeout_counter <= android_timeout:
-            subprocess.run(["adb", "pull", "/sdcard/Android/data/com.arm.vulkan_best_practice/files/" + outputs_path + self.test_name + image_ext, os.path.join(root_path, outputs_path)], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+            if perf_mode:
+                subprocess.run(["adb", "pull", "/sdcard/Android/data/com.arm.vulkan_best_practice/files/" + graphs_path + self.get_report_name(), os.path.join(root_path, graphs_path)], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+            else:
+                subprocess.run(["adb", "pull", "/sdcard/Android/data/com.arm.vulkan_best_practice/files/" + outputs_path + self.test_name + image_ext, os.path.join(root_path, outputs_path)], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
             return True
         else:
             print("\t\t\t(Error) Timed out")
             return False
 
-def create_app(platform, test_name):
+def create_app(platform, test_name, resolution = ""):
     """
     @brief   Creates a buildable and runnable test, returning it
     @param   platform An integer representing what platform the app should be built for
     @param   test_name The name of the test, used to create the app
+    @param   resolution The resolution of a performance run on desktop, in the format (WxH)
     @return  A runnable application
     """
     if platform == "Windows":
-        return WindowsSubtest(test_name)
+        return WindowsSubtest(test_name, resolution)
     elif platform in ["Linux", "Darwin"]:
-        return UnixSubtest(test_name, platform)
+        return UnixSubtest(test_name, platform, resolution)
     elif platform == "Android":
         return AndroidSubtest(test_name)
     else:
@@ -203,6 +252,78 @@ def test(test_name, screenshot_path):
         result = True
     return result
 
+def percentile(sorted_values, fraction):
+    """
+    @brief   Nearest-rank percentile, computed like the benchmark report does
+    @param   sorted_values The values in ascending order
+    @param   fraction The percentile as a fraction between 0 and 1
+    @return  The value of the percentile
+    """
+    rank = int(math.ceil(fraction * len(sorted_values)))
+    return sorted_values[min(max(rank, 1), len(sorted_values)) - 1]
+
+def summarize_report(report):
+    """
+    @brief   Computes the metrics of each stat of a benchmark report, without the warmup frames
+    @param   report The benchmark report written by the application
+    @return  A dictionary of the metrics by stat name
+    """
+    summary = {}
+    for name, stat in report["stats"].items():
+        values = sorted(stat["values"][warmup_frames:])
+        if not values:
+            continue
+        summary[name] = {"median": percentile(values, 0.5), "p95": percentile(values, 0.95)}
+    return summary
+
+def get_device_name(platform_type):
+    """
+    @brief   Gets the name of the device running the tests, baselines are stored per device
+    @param   platform_type The platform the test runs on
+    @return  A name usable as a directory name
+    """
+    if platform_type == "Android":
+        name = subprocess.check_output("adb shell getprop ro.product.model").decode("utf-8").strip()
+    else:
+        name = platform.node()
+    return "".join(c if c.isalnum() or c in "-_" else "_" for c in name)
+
+def get_baseline_path(platform_type, test_name, resolution):
+    return os.path.join(baselines_path, get_device_name(platform_type), "{}-{}.json".format(test_name, resolution))
+
+def compare_perf(summary, baseline_path):
+    """
+    @brief   Compares the metrics of a run against a stored baseline, storing them as the baseline if there is none
+    @param   summary The metrics of each stat, as returned by summarize_report
+    @param   baseline_path The path to the baseline file
+    @return  True if no metric is slower than the baseline by more than the tolerance
+    """
+    if update_baselines or not os.path.isfile(baseline_path):
+        print("\t\t\t(Storing baseline) '{}'".format(baseline_path))
+        os.makedirs(os.path.dirname(baseline_path), exist_ok = True)
+        with open(baseline_path, "w") as baseline_file:
+            json.dump(summary, baseline_file, indent = 4, sort_keys = True)
+        return True
+    with open(baseline_path) as baseline_file:
+        baseline = json.load(baseline_file)
+    result = True
+    for name, metrics in baseline.items():
+        if name not in summary:
+            print("\t\t\t(Warning) Stat '{}' missing from the report".format(name))
+            continue
+        for metric in perf_metrics:
+            base_value = metrics.get(metric, 0.0)
+            value = summary[name][metric]
+            # Stats which are zero in the baseline are not available on the device
+            if base_value <= 0.0:
+                continue
+            change = (value - base_value) / base_value
+            regressed = change > tolerance
+            print("\t\t\t{} {}: {:.6g} (baseline {:.6g}, {:+.2f}%){}".format(name, metric, value, base_value, 100 * change, " REGRESSION" if regressed else ""))
+            if regressed:
+                result = False
+    return result
+
 def execute(app):
     print("\t=== Running {} on {} ===".format(app.test_name, app.platform))
     if app.run():
@@ -226,7 +347,9 @@ def main():
         if test_android:
             apps.append(create_app("Android", test_name))
         if test_desktop:
-            apps.append(create_app(platform.system(), test_name))
+            # Performance runs measure each resolution, the image comparison uses the default one
+            for resolution in (resolutions if perf_mode else [""]):
+                apps.append(create_app(platform.system(), test_name, resolution))
 
     # Run tests
     if not multithread:
@@ -273,6 +396,13 @@ if __name__ == "__main__":
     argparser.add_argument("-C", "--config", required=True, help="build configuration to use")
     argparser.add_argument("-S", "--subtests", default=os.listdir(os.path.join(script_path, "sub_tests")), nargs="+", help="if set the specified sub tests will be run instead")
     argparser.add_argument("-P", "--parallel", action='store_true', help="flag to deploy tests in parallel")
+    argparser.add_argument("--perf", action='store_true', help="flag to compare the performance of the sub tests against the baselines instead of their images")
+    argparser.add_argument("--warmup", type=int, default=warmup_frames, help="number of frames rendered before measuring in performance mode")
+    argparser.add_argument("--frames", type=int, default=measured_frames, help="number of frames measured in performance mode")
+    argparser.add_argument("--resolutions", default=resolutions, nargs="+", help="desktop resolutions measured in performance mode, in the format WxH")
+    argparser.add_argument("--tolerance", type=float, default=100 * tolerance, help="regression in percent above which a performance test fails")
+    argparser.add_argument("--baselines", default=baselines_path, help="directory of the performance baselines, stored per device")
+    argparser.add_argument("--update-baselines", action='store_true', help="flag to store the measured performance as the new baselines")
     build_group = argparser.add_mutually_exclusive_group()
     build_group.add_argument("-D", "--desktop", action='store_false', help="flag to only deploy tests on desktop")
     build_group.add_argument("-A", "--android", action='store_false', help="flag to only deploy tests on android")
@@ -284,6 +414,18 @@ if __name__ == "__main__":
     test_desktop  = args["android"]
     test_android  = args["desktop"]
     multithread   = args["parallel"]
+    perf_mode        = args["perf"]
+    warmup_frames    = args["warmup"]
+    measured_frames  = args["frames"]
+    resolutions      = args["resolutions"]
+    tolerance        = args["tolerance"] / 100
+    baselines_path   = args["baselines"]
+    update_baselines = args["update_baselines"]
+
+    # Performance runs are measured one at a time
+    if perf_mode:
+        multithread  = False
+        dependencies = tuple(dependency for dependency in dependencies if dependency != "magick")
 
     if build_path[-1] != "/":
         build_path += "/"
@@ -20,6 +20,7 @@
 
 #include "vulkan_test.h"
 
+#include "common/logging.h"
 #include "gltf_loader.h"
 #include "gui.h"
 #include "platform/platform.h"
@@ -30,6 +31,15 @@
 
 namespace vkbtest
 {
+namespace
+{
+/// Frames rendered before the allocations of a frame are checked, once the caches are warm
+const uint32_t allocation_warmup_frames = 10;
+
+/// Most heap allocations a frame can make after warming up, in builds with VKB_ALLOCATION_TRACKING
+const uint64_t max_frame_allocations = 256;
+}        // namespace
+
 bool VulkanTest::prepare(vkb::Platform &platform)
 {
 	if (!vkb::VulkanSample::prepare(platform))
@@ -39,6 +49,16 @@ bool VulkanTest::prepare(vkb::Platform &platform)
 
 	this->platform = &platform;
 
+	if (is_benchmark_mode())
+	{
+		// Performance runs compare these stats of the benchmark report against the baselines
+		std::set<vkb::StatIndex> enabled_stats{vkb::StatIndex::frame_times, vkb::StatIndex::cpu_cycles, vkb::StatIndex::gpu_cycles,
+		                                       vkb::StatIndex::vertex_compute_cycles, vkb::StatIndex::fragment_cycles,
+		                                       vkb::StatIndex::l2_ext_read_bytes, vkb::StatIndex::l2_ext_write_bytes};
+
+		stats = std::make_unique<vkb::Stats>(enabled_stats);
+	}
+
 	return true;
 }
 
@@ -46,13 +66,53 @@ void VulkanTest::update(float delta_time)
 {
 	VulkanSample::update(delta_time);
 
-	screenshot(get_render_context(), get_name());
+	if (frame_captured)
+	{
+		end();
+	}
+
+	// Performance runs render until the benchmark frames are done, the report is written when the test finishes
+	if (is_benchmark_mode())
+	{
+		return;
+	}
+
+	if (vkb::AllocationTracker::is_enabled())
+	{
+		// The first frames fill the caches, the test checks a frame once they are warm
+		if (++frame_count <= allocation_warmup_frames)
+		{
+			return;
+		}
+
+		auto frame_allocations = vkb::AllocationTracker::get_total(get_frame_allocations());
+
+		LOGI("Steady state frame made {} allocations ({} bytes)", frame_allocations.count, frame_allocations.bytes);
+
+		if (frame_allocations.count > max_frame_allocations)
+		{
+			for (size_t i = 0; i < get_frame_allocations().size(); i++)
+			{
+				LOGE("{}: {} allocations", vkb::AllocationTracker::get_scope_name(static_cast<vkb::AllocationScope>(i)), get_frame_allocations()[i].count);
+			}
 
-	end();
+			LOGE("Steady state frame exceeds {} allocations", max_frame_allocations);
+
+			platform->close();
+			exit(1);
+		}
+	}
+
+	// The capture is recorded by the next frame
+	get_frame_capture().request(get_name());
+
+	frame_captured = true;
 }
 
 void VulkanTest::end()
 {
+	get_frame_capture().flush();
+
 	platform->close();
 	exit(0);
 }
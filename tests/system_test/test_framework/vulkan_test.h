@@ -41,5 +41,10 @@ class VulkanTest : public vkb::VulkanSample
 
   private:
 	vkb::Platform *platform;
+
+	uint32_t frame_count{0};
+
+	/// Whether the frame to compare was captured, the test ends once its capture is written
+	bool frame_captured{false};
 };
 }        // namespace vkbtest
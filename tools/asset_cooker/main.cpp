@@ -0,0 +1,108 @@
+/* Copyright (c) 2019, Arm Limited and Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/logging.h"
+#include "core/device.h"
+#include "core/instance.h"
+#include "gltf_loader.h"
+#include "job_system.h"
+#include "platform/filesystem.h"
+#include "scene_cache.h"
+
+/**
+ * Cooks the packages of glTF scenes, which the framework loads without parsing the
+ * glTF file or decoding the images. The scenes are loaded once on a headless device,
+ * and each package is written next to its glTF file in the assets directory.
+ * With --archive, it rather stores the files given in the asset archive.
+ */
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		LOGE("Usage: vkb_asset_cooker <scene.gltf>... | --archive <file>... (paths relative to the assets directory)");
+
+		return 1;
+	}
+
+	if (std::string{argv[1]} == "--archive")
+	{
+		std::vector<std::string> filenames{argv + 2, argv + argc};
+
+		try
+		{
+			vkb::fs::write_asset_archive(filenames, vkb::fs::ASSET_ARCHIVE_NAME);
+		}
+		catch (const std::exception &e)
+		{
+			LOGE("Cannot write the asset archive: {}", e.what());
+
+			return 1;
+		}
+
+		LOGI("Stored {} files in {}", filenames.size(), vkb::fs::ASSET_ARCHIVE_NAME);
+
+		return 0;
+	}
+
+	int failed_count = 0;
+
+	try
+	{
+		auto instance = std::make_unique<vkb::Instance>("vkb_asset_cooker", std::vector<const char *>{}, std::vector<const char *>{}, true);
+
+		auto device = std::make_unique<vkb::Device>(instance->get_gpu(), VK_NULL_HANDLE);
+
+		vkb::JobSystem job_system;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string file_name{argv[i]};
+
+			vkb::GLTFLoader loader{*device, &job_system};
+			loader.set_cook_package(true);
+
+			auto scene = loader.read_scene_from_file(file_name);
+
+			if (!scene)
+			{
+				LOGE("Cannot cook {}", file_name);
+
+				failed_count++;
+				continue;
+			}
+
+			LOGI("Cooked {} into {}", file_name, vkb::get_scene_package_filename(file_name));
+		}
+
+		device->wait_idle();
+	}
+	catch (const std::exception &e)
+	{
+		LOGE("Asset cooking failed: {}", e.what());
+
+		return 1;
+	}
+
+	return failed_count == 0 ? 0 : 1;
+}
@@ -126,6 +126,10 @@ public class BPSampleActivity extends AppCompatActivity {
                 setRequestedOrientation(ActivityInfo.SCREEN_ORIENTATION_LANDSCAPE);
                 args.add("--test");
                 args.add(extras.getString("test"));
+                if (extras.containsKey("benchmark")) {
+                    args.add("--benchmark");
+                    args.add(extras.getString("benchmark"));
+                }
                 setArguments(args);
                 Intent intent = new Intent(BPSampleActivity.this, BPNativeActivity.class);
                 startActivity(intent);
@@ -20,7 +20,11 @@
 
 #include "vulkan_best_practice.h"
 
+#include <sstream>
+
 #include "common/logging.h"
+#include "cpu_profiler.h"
+#include "cpu_topology.h"
 #include "platform/platform.h"
 
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
@@ -113,7 +117,7 @@ VulkanBestPractice::VulkanBestPractice()
 	    R"(Vulkan Best Practice.
 	Usage:
 		vulkan_best_practice <sample>
-		vulkan_best_practice (--sample <arg> | --test <arg> | --batch <arg>) [--benchmark <frames>] [--width <arg>] [--height <arg>] [--headless] 
+		vulkan_best_practice (--sample <arg> | --test <arg> | --batch <arg>) [--benchmark <frames>] [--warmup <frames>] [--sweep] [--width <arg>] [--height <arg>] [--headless] [--trace <file>] [--gui-rate <hz>] [--record-input <file> | --replay-input <file>] [--camera-path <file>] [--fps <hz>] [--no-performance-hints] [--choreographer] [--pipelined] [--skip-redraws] [--on-demand] [--bandwidth-formats] [--infinite-far] [--spatial-index] [--defragment] [--core-affinity] [--thread-times] [--virtual-textures <mb>] [--weighted-blended] [--parallel-subpasses] [--compress-caches] [--perf-lint] [--performance-counters <names>] [--capture <frames>] [--draws <count> [--framework-draws]]
 		vulkan_best_practice --help
 
 	Options:
@@ -121,10 +125,38 @@ VulkanBestPractice::VulkanBestPractice()
 		--sample SAMPLE_ID        Run a sample.
 		--test TEST_ID            Run a test.
 		--batch CATEGORY_NAME     Run all samples within a category, specify 'all' to run all.
-		--benchmark FRAMES        Run a fixed time step of a sample for n frames.
+		--benchmark FRAMES        Run a fixed time step of a sample for n frames, logging the distributions of their CPU and GPU times.
+		--warmup FRAMES           Run n frames before the frames measured by a benchmark.
+		--sweep                   Benchmark every configuration of the sample in turn.
 		--width WIDTH             The width of the screen if visible [default: 1280].
 		--height HEIGHT           The height of the screen if visible [default: 720].
-		--headless                Renders directly to display, skipping window creation.
+		--headless                Renders offscreen without a window or a surface, at the rate of the GPU.
+		--trace FILE              Writes the scopes of the CPU profiler as a Chrome trace to output/graphs/FILE.
+		--gui-rate HZ             Renders the gui to its own layer HZ times per second, composited over the scene.
+		--record-input FILE       Steps by a fixed time step and records the input events to output/FILE.
+		--replay-input FILE       Steps by a fixed time step and replays the input events of output/FILE instead of the window ones.
+		--camera-path FILE        Moves the camera along the spline of output/FILE, see sg::CameraPath.
+		--fps HZ                  Paces the frames at HZ, lowered while the device reports it is throttling.
+		--no-performance-hints    Does not report the work duration of the frames to the scheduler, such as the ADPF session on Android.
+		--choreographer           Starts each frame from a vsync callback on Android, as late before its deadline as the frames take.
+		--pipelined               Updates the scene of the next frame while the current one is recorded.
+		--skip-redraws            Skips the frames in which nothing changed, and presents the damage of the gui alone.
+		--on-demand               Renders only when something changed, waiting for the window events in between.
+		--bandwidth-formats       Prefers the depth formats with the fewest bytes per pixel, such as D16.
+		--infinite-far            Moves the far plane of the perspective cameras to infinity, keeping the reversed depth.
+		--spatial-index           Culls the scene through a bounding volume hierarchy refitted to the moving nodes.
+		--defragment              Compacts the device memory of the scene geometry in the background, a few megabytes per frame.
+		--core-affinity           Pins the recording threads to the big cores and the background jobs to the little ones, on big.LITTLE CPUs.
+		--thread-times            Shows the CPU time of each thread of the job system per frame.
+		--virtual-textures MB     Pages the base color textures through sparse images or a page cache of MB megabytes.
+		--weighted-blended        Blends the transparent objects in any order with weighted blended transparency, instead of sorting them.
+		--parallel-subpasses      Records the subpasses of the render pipeline in parallel, each in a secondary command buffer, and the independent render passes each in a primary one.
+		--compress-caches         Compresses the pipeline, shader and scene caches, which are decompressed in parallel when loaded.
+		--perf-lint               Logs the performance mistakes found in the command buffers, such as stored transient attachments.
+		--performance-counters NAMES  Queries the GPU stats hwcpipe cannot measure, and the comma-separated driver counters NAMES or all, with VK_KHR_performance_query.
+		--capture FRAMES          Writes every n-th frame to an image, read back without stalling the frames.
+		--draws COUNT             Draws COUNT triangles per frame in hello_triangle (1000 to 100000), logging the CPU time per draw.
+		--framework-draws         Records the draws of --draws through the framework instead of raw Vulkan.
 	)");
 }
 
@@ -139,6 +171,22 @@ bool VulkanBestPractice::prepare(Platform &platform)
 		return false;
 	}
 
+	if (options.contains("--trace"))
+	{
+		CpuProfiler::get().set_enabled(true);
+	}
+
+	// The job system of a sample reads it when the sample is prepared
+	if (options.contains("--core-affinity"))
+	{
+		CpuTopology::get().set_affinity_enabled(true);
+	}
+
+	if (options.contains("--compress-caches"))
+	{
+		vkb::fs::set_temp_compression(true);
+	}
+
 	auto result = false;
 
 	if (options.contains("--batch"))
@@ -241,6 +289,44 @@ bool VulkanBestPractice::prepare_active_app(CreateAppFunc create_app_func, const
 		if (auto *active_app = dynamic_cast<vkb::VulkanSample *>(app))
 		{
 			active_app->get_configuration().reset();
+
+			// A sweep starts from the first configuration rather than from the defaults of the sample
+			if (is_benchmark_mode() && options.contains("--sweep"))
+			{
+				active_app->get_configuration().set();
+			}
+
+			if (options.contains("--gui-rate"))
+			{
+				active_app->set_gui_layer_rate(static_cast<float>(options.get_int("--gui-rate")));
+			}
+
+			if (options.contains("--bandwidth-formats"))
+			{
+				active_app->set_format_policy(vkb::FormatPolicy::Bandwidth);
+			}
+
+			if (options.contains("--infinite-far"))
+			{
+				active_app->set_infinite_far_plane(true);
+			}
+
+			if (options.contains("--virtual-textures"))
+			{
+				auto budget = std::max(options.get_int("--virtual-textures"), 1);
+
+				active_app->set_virtual_textures(static_cast<VkDeviceSize>(budget) * 1024 * 1024);
+			}
+
+			if (options.contains("--weighted-blended"))
+			{
+				active_app->set_weighted_blended_transparency(true);
+			}
+
+			if (options.contains("--parallel-subpasses"))
+			{
+				active_app->set_parallel_subpasses(true);
+			}
 		}
 	}
 
@@ -253,8 +339,19 @@ bool VulkanBestPractice::prepare_active_app(CreateAppFunc create_app_func, const
 		active_app->set_benchmark_mode(true);
 	}
 
+	active_app->set_fixed_time_step(is_fixed_time_step());
 	active_app->set_headless(is_headless());
 
+	if (options.contains("--draws"))
+	{
+		if (auto *hello_triangle = dynamic_cast<HelloTriangle *>(active_app.get()))
+		{
+			auto draw_count = std::min(std::max(options.get_int("--draws"), 1000), 100000);
+
+			hello_triangle->set_stress_mode(static_cast<uint32_t>(draw_count), options.contains("--framework-draws"));
+		}
+	}
+
 	auto result = active_app->prepare(*platform);
 
 	if (!result)
@@ -263,6 +360,98 @@ bool VulkanBestPractice::prepare_active_app(CreateAppFunc create_app_func, const
 		return result;
 	}
 
+	if (options.contains("--camera-path"))
+	{
+		if (auto *vulkan_app = dynamic_cast<vkb::VulkanSample *>(active_app.get()))
+		{
+			vulkan_app->set_camera_path(options.get_string("--camera-path"));
+		}
+	}
+
+	if (options.contains("--pipelined"))
+	{
+		if (auto *vulkan_app = dynamic_cast<vkb::VulkanSample *>(active_app.get()))
+		{
+			vulkan_app->set_pipelined_update(true);
+		}
+	}
+
+	if (options.contains("--skip-redraws"))
+	{
+		if (auto *vulkan_app = dynamic_cast<vkb::VulkanSample *>(active_app.get()))
+		{
+			vulkan_app->set_redraw_skipping(true);
+		}
+	}
+
+	if (options.contains("--on-demand"))
+	{
+		if (auto *vulkan_app = dynamic_cast<vkb::VulkanSample *>(active_app.get()))
+		{
+			vulkan_app->set_render_on_demand(true);
+		}
+	}
+
+	if (options.contains("--spatial-index"))
+	{
+		if (auto *vulkan_app = dynamic_cast<vkb::VulkanSample *>(active_app.get()))
+		{
+			vulkan_app->set_spatial_index(true);
+		}
+	}
+
+	if (options.contains("--defragment"))
+	{
+		if (auto *vulkan_app = dynamic_cast<vkb::VulkanSample *>(active_app.get()))
+		{
+			vulkan_app->set_memory_defragmentation(true);
+		}
+	}
+
+	if (options.contains("--thread-times"))
+	{
+		if (auto *vulkan_app = dynamic_cast<vkb::VulkanSample *>(active_app.get()))
+		{
+			vulkan_app->set_thread_cpu_times(true);
+		}
+	}
+
+	if (options.contains("--perf-lint"))
+	{
+		if (auto *vulkan_app = dynamic_cast<vkb::VulkanSample *>(active_app.get()))
+		{
+			vulkan_app->get_device().get_perf_lint().set_enabled(true);
+		}
+	}
+
+	if (options.contains("--performance-counters"))
+	{
+		if (auto *vulkan_app = dynamic_cast<vkb::VulkanSample *>(active_app.get()))
+		{
+			std::vector<std::string> names;
+
+			std::istringstream stream{options.get_string("--performance-counters")};
+			std::string        name;
+			while (std::getline(stream, name, ','))
+			{
+				if (!name.empty())
+				{
+					names.push_back(name);
+				}
+			}
+
+			vulkan_app->set_performance_counters(names);
+		}
+	}
+
+	if (options.contains("--capture"))
+	{
+		if (auto *vulkan_app = dynamic_cast<vkb::VulkanSample *>(active_app.get()))
+		{
+			vulkan_app->get_frame_capture().set_interval(static_cast<uint32_t>(options.get_int("--capture")), "capture-" + vulkan_app->get_name());
+		}
+	}
+
 	return result;
 }
 
@@ -324,6 +513,45 @@ void VulkanBestPractice::finish()
 	{
 		active_app->finish();
 	}
+
+	if (options.contains("--trace"))
+	{
+		auto &profiler = CpuProfiler::get();
+
+		// The worker threads are idle once the application has finished
+		profiler.set_enabled(false);
+		profiler.write_chrome_trace(options.get_string("--trace"));
+	}
+}
+
+void VulkanBestPractice::begin_benchmark_capture()
+{
+	Application::begin_benchmark_capture();
+
+	if (active_app)
+	{
+		active_app->begin_benchmark_capture();
+	}
+}
+
+void VulkanBestPractice::end_benchmark_capture()
+{
+	Application::end_benchmark_capture();
+
+	if (active_app)
+	{
+		active_app->end_benchmark_capture();
+	}
+}
+
+bool VulkanBestPractice::next_benchmark_configuration()
+{
+	return active_app && active_app->next_benchmark_configuration();
+}
+
+std::vector<int32_t> VulkanBestPractice::get_worker_thread_ids()
+{
+	return active_app ? active_app->get_worker_thread_ids() : std::vector<int32_t>{};
 }
 
 void VulkanBestPractice::resize(const uint32_t width, const uint32_t height)
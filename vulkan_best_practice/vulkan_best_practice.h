@@ -48,6 +48,14 @@ class VulkanBestPractice : public Application
 
 	virtual void input_event(const InputEvent &input_event) override;
 
+	virtual void begin_benchmark_capture() override;
+
+	virtual void end_benchmark_capture() override;
+
+	virtual bool next_benchmark_configuration() override;
+
+	virtual std::vector<int32_t> get_worker_thread_ids() override;
+
 	/** 
 	 * @brief Prepares a sample or a test to be run under certain conditions
 	 * @param run_info A struct containing the information needed to run